@@ -14,6 +14,8 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  * @{
  */
 
+#define ERRFILE_arm64_rndr	( ERRFILE_ARCH | ERRFILE_CORE | 0x00000000 )
+
 /** @} */
 
 #endif /* _BITS_ERRFILE_H */
@@ -100,3 +100,51 @@ void bigint_multiply_raw ( const uint32_t *multiplicand0,
 		}
 	}
 }
+
+/**
+ * Multiply big integer by a single element and accumulate
+ *
+ * @v multiplicand0	Element 0 of big integer to be multiplied
+ * @v multiplier	Element to multiply by
+ * @v value0		Element 0 of big integer to be added to
+ * @v size		Number of elements
+ * @ret carry		Carry out of most significant element
+ */
+uint32_t bigint_multiply_accumulate_raw ( const uint32_t *multiplicand0,
+					  uint32_t multiplier,
+					  uint32_t *value0,
+					  unsigned int size ) {
+	const bigint_t ( size ) __attribute__ (( may_alias )) *multiplicand =
+		( ( const void * ) multiplicand0 );
+	bigint_t ( size ) __attribute__ (( may_alias )) *value =
+		( ( void * ) value0 );
+	uint32_t carry = 0;
+	uint32_t element;
+	uint32_t low;
+	unsigned int i;
+
+	for ( i = 0 ; i < size ; i++ ) {
+		/* Multiply and add in the carry from the previous
+		 * element (using a single multiply-accumulate), then
+		 * add in the existing element.  The new carry can
+		 * never overflow a single element, since:
+		 *
+		 *     a, b, c, d < 2^{n} => ab + c + d < 2^{2n}
+		 */
+		element = value->element[i];
+		low = carry;
+		carry = 0;
+		__asm__ __volatile__ ( "umlal %1, %2, %3, %4\n\t"
+				       "adds %0, %1\n\t"
+				       "adc %2, #0\n\t"
+				       : "+l" ( element ),
+					 "+l" ( low ),
+					 "+l" ( carry )
+				       : "l" ( multiplicand->element[i] ),
+					 "l" ( multiplier )
+				       : "cc" );
+		value->element[i] = element;
+	}
+
+	return carry;
+}
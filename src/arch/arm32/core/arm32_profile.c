@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <ipxe/profile.h>
+
+/** @file
+ *
+ * ARM32 cycle counter
+ *
+ */
+
+/** Performance monitors control register enable bit */
+#define PMCR_E 0x00000001UL
+
+/** Performance monitors control register clock divider bit */
+#define PMCR_D 0x00000008UL
+
+/** Performance monitors count enable set register cycle counter bit */
+#define PMCNTENSET_C 0x80000000UL
+
+/** Cycle counter has been enabled */
+int arm32_pmccntr_enabled;
+
+/**
+ * Enable cycle counter
+ *
+ * The cycle counter is not necessarily enabled by firmware.  Enable
+ * all counters (without resetting them), disable the divide-by-64
+ * clock divider, and enable the cycle counter itself.
+ */
+void arm32_pmccntr_enable ( void ) {
+	uint32_t pmcr;
+
+	/* Enable counters and disable clock divider */
+	__asm__ __volatile__ ( "mrc p15, 0, %0, c9, c12, 0\n\t"
+			       : "=r" ( pmcr ) );
+	pmcr = ( ( pmcr | PMCR_E ) & ~PMCR_D );
+	__asm__ __volatile__ ( "mcr p15, 0, %0, c9, c12, 0\n\t"
+			       : : "r" ( pmcr ) );
+
+	/* Enable cycle counter */
+	__asm__ __volatile__ ( "mcr p15, 0, %0, c9, c12, 1\n\t"
+			       : : "r" ( PMCNTENSET_C ) );
+
+	arm32_pmccntr_enabled = 1;
+}
@@ -0,0 +1,44 @@
+#ifndef _BITS_AES_H
+#define _BITS_AES_H
+
+/** @file
+ *
+ * ARM32-specific AES acceleration
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/**
+ * Encrypt block using hardware acceleration, if available
+ *
+ * @v aes		AES context
+ * @v src		Data to encrypt
+ * @v dst		Buffer for encrypted data
+ * @ret accelerated	Block was encrypted using hardware acceleration
+ */
+static inline __attribute__ (( always_inline )) int
+aes_accel_encrypt ( const struct aes_context *aes __unused,
+		    const void *src __unused, void *dst __unused ) {
+
+	/* Not yet optimised */
+	return 0;
+}
+
+/**
+ * Decrypt block using hardware acceleration, if available
+ *
+ * @v aes		AES context
+ * @v src		Data to decrypt
+ * @v dst		Buffer for decrypted data
+ * @ret accelerated	Block was decrypted using hardware acceleration
+ */
+static inline __attribute__ (( always_inline )) int
+aes_accel_decrypt ( const struct aes_context *aes __unused,
+		    const void *src __unused, void *dst __unused ) {
+
+	/* Not yet optimised */
+	return 0;
+}
+
+#endif /* _BITS_AES_H */
@@ -0,0 +1,27 @@
+#ifndef _BITS_CPU_ENTROPY_H
+#define _BITS_CPU_ENTROPY_H
+
+/** @file
+ *
+ * ARM32-specific CPU hardware random number generator
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <errno.h>
+
+/**
+ * Get noise sample from CPU hardware random number generator
+ *
+ * @ret noise		Noise sample
+ * @ret rc		Return status code
+ */
+static inline __attribute__ (( always_inline )) int
+cpu_get_noise ( noise_sample_t *noise __unused ) {
+
+	/* No architecturally defined random number generator */
+	return -ENOTSUP;
+}
+
+#endif /* _BITS_CPU_ENTROPY_H */
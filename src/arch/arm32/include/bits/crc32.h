@@ -0,0 +1,44 @@
+#ifndef _BITS_CRC32_H
+#define _BITS_CRC32_H
+
+/** @file
+ *
+ * ARM32-specific CRC32 acceleration
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/**
+ * Calculate CRC32 using hardware acceleration, if available
+ *
+ * @v crc		CRC to update
+ * @v data		Data to checksum
+ * @v len		Length of data
+ * @ret done		Length of data processed
+ */
+static inline __attribute__ (( always_inline )) size_t
+crc32_accel_le ( uint32_t *crc __unused, const void *data __unused,
+		 size_t len __unused ) {
+
+	/* Not yet optimised */
+	return 0;
+}
+
+/**
+ * Calculate CRC32C using hardware acceleration, if available
+ *
+ * @v crc		CRC to update
+ * @v data		Data to checksum
+ * @v len		Length of data
+ * @ret done		Length of data processed
+ */
+static inline __attribute__ (( always_inline )) size_t
+crc32c_accel_le ( uint32_t *crc __unused, const void *data __unused,
+		  size_t len __unused ) {
+
+	/* Not yet optimised */
+	return 0;
+}
+
+#endif /* _BITS_CRC32_H */
@@ -11,6 +11,9 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 #include <stdint.h>
 
+extern int arm32_pmccntr_enabled;
+extern void arm32_pmccntr_enable ( void );
+
 /**
  * Get profiling timestamp
  *
@@ -20,10 +23,14 @@ static inline __attribute__ (( always_inline )) uint64_t
 profile_timestamp ( void ) {
 	uint32_t cycles;
 
+	/* Enable cycle counter, if not already enabled */
+	if ( ! arm32_pmccntr_enabled )
+		arm32_pmccntr_enable();
+
 	/* Read cycle counter */
-	__asm__ __volatile__ ( "mcr p15, 0, %1, c9, c12, 0\n\t"
+	__asm__ __volatile__ ( "isb\n\t"
 			       "mrc p15, 0, %0, c9, c13, 0\n\t"
-			       : "=r" ( cycles ) : "r" ( 1 ) );
+			       : "=r" ( cycles ) );
 	return cycles;
 }
 
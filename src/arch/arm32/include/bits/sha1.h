@@ -0,0 +1,26 @@
+#ifndef _BITS_SHA1_H
+#define _BITS_SHA1_H
+
+/** @file
+ *
+ * ARM32-specific SHA-1 acceleration
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/**
+ * Calculate digest of one block using hardware acceleration, if available
+ *
+ * @v digest		Digest (big-endian)
+ * @v data		Data block
+ * @ret accelerated	Block was digested using hardware acceleration
+ */
+static inline __attribute__ (( always_inline )) int
+sha1_accel_digest ( void *digest __unused, const void *data __unused ) {
+
+	/* Not yet optimised */
+	return 0;
+}
+
+#endif /* _BITS_SHA1_H */
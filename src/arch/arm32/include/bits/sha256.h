@@ -0,0 +1,28 @@
+#ifndef _BITS_SHA256_H
+#define _BITS_SHA256_H
+
+/** @file
+ *
+ * ARM32-specific SHA-256 acceleration
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/**
+ * Calculate digest of one block using hardware acceleration, if available
+ *
+ * @v digest		Digest (big-endian)
+ * @v data		Data block
+ * @v k			SHA-256 round constants
+ * @ret accelerated	Block was digested using hardware acceleration
+ */
+static inline __attribute__ (( always_inline )) int
+sha256_accel_digest ( void *digest __unused, const void *data __unused,
+		      const uint32_t *k __unused ) {
+
+	/* Not yet optimised */
+	return 0;
+}
+
+#endif /* _BITS_SHA256_H */
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * ARMv8 Cryptographic Extension AES acceleration
+ *
+ * The AESE/AESD instructions perform AddRoundKey before (rather than
+ * after) the substitution and shift steps.  The round keys
+ * constructed by the generic AES key expansion may therefore be used
+ * as-is, with the final round key applied by an explicit exclusive
+ * OR.  As on other architectures, the decryption keys are already in
+ * the order (with InvMixColumns pre-applied) expected by AESD.
+ *
+ * Only caller-saved SIMD registers are used.
+ *
+ */
+
+#include <stdint.h>
+#include <ipxe/init.h>
+#include <ipxe/aes.h>
+
+/** ID_AA64ISAR0_EL1 AES field */
+#define ID_AA64ISAR0_AES( isar0 ) ( ( (isar0) >> 4 ) & 0xf )
+
+/** AES instructions are usable */
+int arm64_aes_enabled;
+
+/**
+ * Encrypt block using ARMv8 Cryptographic Extension
+ *
+ * @v aes		AES context
+ * @v src		Data to encrypt
+ * @v dst		Buffer for encrypted data
+ */
+void __attribute__ (( target ( "+crypto" ) ))
+arm64_aes_encrypt ( const struct aes_context *aes, const void *src,
+		    void *dst ) {
+	const union aes_matrix *key = &aes->encrypt.key[0];
+	unsigned int count = ( aes->rounds - 2 );
+
+	__asm__ __volatile__ ( "ld1 {v0.16b}, [%[src]]\n\t"
+			       "\n1:\n\t"
+			       "ld1 {v1.16b}, [%[key]], #16\n\t"
+			       "aese v0.16b, v1.16b\n\t"
+			       "aesmc v0.16b, v0.16b\n\t"
+			       "subs %w[count], %w[count], #1\n\t"
+			       "b.ne 1b\n\t"
+			       "ld1 {v1.16b}, [%[key]], #16\n\t"
+			       "aese v0.16b, v1.16b\n\t"
+			       "ld1 {v1.16b}, [%[key]]\n\t"
+			       "eor v0.16b, v0.16b, v1.16b\n\t"
+			       "st1 {v0.16b}, [%[dst]]\n\t"
+			       : [key] "+r" ( key ), [count] "+r" ( count )
+			       : [src] "r" ( src ), [dst] "r" ( dst )
+			       : "v0", "v1", "memory", "cc" );
+}
+
+/**
+ * Decrypt block using ARMv8 Cryptographic Extension
+ *
+ * @v aes		AES context
+ * @v src		Data to decrypt
+ * @v dst		Buffer for decrypted data
+ */
+void __attribute__ (( target ( "+crypto" ) ))
+arm64_aes_decrypt ( const struct aes_context *aes, const void *src,
+		    void *dst ) {
+	const union aes_matrix *key = &aes->decrypt.key[0];
+	unsigned int count = ( aes->rounds - 2 );
+
+	__asm__ __volatile__ ( "ld1 {v0.16b}, [%[src]]\n\t"
+			       "\n1:\n\t"
+			       "ld1 {v1.16b}, [%[key]], #16\n\t"
+			       "aesd v0.16b, v1.16b\n\t"
+			       "aesimc v0.16b, v0.16b\n\t"
+			       "subs %w[count], %w[count], #1\n\t"
+			       "b.ne 1b\n\t"
+			       "ld1 {v1.16b}, [%[key]], #16\n\t"
+			       "aesd v0.16b, v1.16b\n\t"
+			       "ld1 {v1.16b}, [%[key]]\n\t"
+			       "eor v0.16b, v0.16b, v1.16b\n\t"
+			       "st1 {v0.16b}, [%[dst]]\n\t"
+			       : [key] "+r" ( key ), [count] "+r" ( count )
+			       : [src] "r" ( src ), [dst] "r" ( dst )
+			       : "v0", "v1", "memory", "cc" );
+}
+
+/**
+ * Detect AES instruction support
+ *
+ */
+static void arm64_aes_init ( void ) {
+	uint64_t isar0;
+
+	/* Read instruction set attribute register */
+	__asm__ ( "mrs %0, id_aa64isar0_el1" : "=r" ( isar0 ) );
+	DBGC ( &arm64_aes_enabled, "AESCE ID_AA64ISAR0_EL1 %#016llx\n",
+	       ( ( unsigned long long ) isar0 ) );
+
+	/* Enable AES instructions, if supported */
+	if ( ID_AA64ISAR0_AES ( isar0 ) ) {
+		DBGC ( &arm64_aes_enabled, "AESCE using AES instructions\n" );
+		arm64_aes_enabled = 1;
+	}
+}
+
+/** AES instruction detection initialisation function */
+struct init_fn arm64_aes_init_fn __init_fn ( INIT_EARLY ) = {
+	.initialise = arm64_aes_init,
+};
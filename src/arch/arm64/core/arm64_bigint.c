@@ -101,3 +101,52 @@ void bigint_multiply_raw ( const uint64_t *multiplicand0,
 		}
 	}
 }
+
+/**
+ * Multiply big integer by a single element and accumulate
+ *
+ * @v multiplicand0	Element 0 of big integer to be multiplied
+ * @v multiplier	Element to multiply by
+ * @v value0		Element 0 of big integer to be added to
+ * @v size		Number of elements
+ * @ret carry		Carry out of most significant element
+ */
+uint64_t bigint_multiply_accumulate_raw ( const uint64_t *multiplicand0,
+					  uint64_t multiplier,
+					  uint64_t *value0,
+					  unsigned int size ) {
+	const bigint_t ( size ) __attribute__ (( may_alias )) *multiplicand =
+		( ( const void * ) multiplicand0 );
+	bigint_t ( size ) __attribute__ (( may_alias )) *value =
+		( ( void * ) value0 );
+	uint64_t carry = 0;
+	uint64_t element;
+	uint64_t discard_low;
+	unsigned int i;
+
+	for ( i = 0 ; i < size ; i++ ) {
+		/* Multiply, then add in the existing element and the
+		 * carry from the previous element.  The new carry
+		 * can never overflow a single element, since:
+		 *
+		 *     a, b, c, d < 2^{n} => ab + c + d < 2^{2n}
+		 */
+		element = value->element[i];
+		__asm__ __volatile__ ( "mul %1, %3, %4\n\t"
+				       "umulh %2, %3, %4\n\t"
+				       "adds %1, %1, %5\n\t"
+				       "adc %2, %2, xzr\n\t"
+				       "adds %0, %0, %1\n\t"
+				       "adc %2, %2, xzr\n\t"
+				       : "+r" ( element ),
+					 "=&r" ( discard_low ),
+					 "=&r" ( carry )
+				       : "r" ( multiplicand->element[i] ),
+					 "r" ( multiplier ),
+					 "r" ( carry )
+				       : "cc" );
+		value->element[i] = element;
+	}
+
+	return carry;
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * ARMv8 CRC32 instruction acceleration
+ *
+ * The CRC32X/CRC32CX instructions process eight bytes at a time, and
+ * the CRC32B/CRC32CB instructions process any remaining bytes.  No
+ * inversion is applied to the CRC by these instructions.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <ipxe/init.h>
+#include <ipxe/crc32.h>
+
+/** ID_AA64ISAR0_EL1 CRC32 field */
+#define ID_AA64ISAR0_CRC32( isar0 ) ( ( (isar0) >> 16 ) & 0xf )
+
+/** CRC32 instructions are usable */
+int arm64_crc32_enabled;
+
+/**
+ * Calculate CRC32 using CRC32 instructions
+ *
+ * @v crc		CRC to update
+ * @v data		Data to checksum
+ * @v len		Length of data
+ * @ret done		Length of data processed
+ */
+size_t __attribute__ (( target ( "+crc" ) ))
+arm64_crc32 ( uint32_t *crc, const void *data, size_t len ) {
+	const uint8_t *byte = data;
+	uint32_t value = *crc;
+	uint64_t dword;
+	size_t remaining = len;
+
+	/* Process eight bytes at a time */
+	while ( remaining >= sizeof ( dword ) ) {
+		memcpy ( &dword, byte, sizeof ( dword ) );
+		__asm__ ( "crc32x %w0, %w0, %x1"
+			  : "+r" ( value ) : "r" ( dword ) );
+		byte += sizeof ( dword );
+		remaining -= sizeof ( dword );
+	}
+
+	/* Process any remaining bytes */
+	while ( remaining-- ) {
+		__asm__ ( "crc32b %w0, %w0, %w1"
+			  : "+r" ( value ) : "r" ( *(byte++) ) );
+	}
+
+	*crc = value;
+	return len;
+}
+
+/**
+ * Calculate CRC32C using CRC32C instructions
+ *
+ * @v crc		CRC to update
+ * @v data		Data to checksum
+ * @v len		Length of data
+ * @ret done		Length of data processed
+ */
+size_t __attribute__ (( target ( "+crc" ) ))
+arm64_crc32c ( uint32_t *crc, const void *data, size_t len ) {
+	const uint8_t *byte = data;
+	uint32_t value = *crc;
+	uint64_t dword;
+	size_t remaining = len;
+
+	/* Process eight bytes at a time */
+	while ( remaining >= sizeof ( dword ) ) {
+		memcpy ( &dword, byte, sizeof ( dword ) );
+		__asm__ ( "crc32cx %w0, %w0, %x1"
+			  : "+r" ( value ) : "r" ( dword ) );
+		byte += sizeof ( dword );
+		remaining -= sizeof ( dword );
+	}
+
+	/* Process any remaining bytes */
+	while ( remaining-- ) {
+		__asm__ ( "crc32cb %w0, %w0, %w1"
+			  : "+r" ( value ) : "r" ( *(byte++) ) );
+	}
+
+	*crc = value;
+	return len;
+}
+
+/**
+ * Detect CRC32 instruction support
+ *
+ */
+static void arm64_crc32_init ( void ) {
+	uint64_t isar0;
+
+	/* Read instruction set attribute register */
+	__asm__ ( "mrs %0, id_aa64isar0_el1" : "=r" ( isar0 ) );
+
+	/* Enable CRC32 instructions, if supported */
+	if ( ID_AA64ISAR0_CRC32 ( isar0 ) ) {
+		DBGC ( &arm64_crc32_enabled, "CRC32 using CRC32 "
+		       "instructions\n" );
+		arm64_crc32_enabled = 1;
+	}
+}
+
+/** CRC32 instruction detection initialisation function */
+struct init_fn arm64_crc32_init_fn __init_fn ( INIT_EARLY ) = {
+	.initialise = arm64_crc32_init,
+};
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * AArch64 generic timer high-resolution clock
+ *
+ */
+
+#include <ipxe/profile.h>
+#include <ipxe/hrclock.h>
+
+/**
+ * Read virtual counter
+ *
+ * @ret count		Current counter value
+ */
+static uint64_t arm64_hrclock_read ( void ) {
+
+	return profile_timestamp();
+}
+
+/**
+ * Probe AArch64 generic timer high-resolution clock
+ *
+ * @ret hz		Counter frequency (in Hz)
+ * @ret rc		Return status code
+ */
+static int arm64_hrclock_probe ( uint64_t *hz ) {
+	uint64_t frequency;
+
+	/* Read counter frequency as programmed by firmware */
+	__asm__ __volatile__ ( "mrs %0, CNTFRQ_EL0\n\t" : "=r" ( frequency ) );
+	*hz = frequency;
+
+	return 0;
+}
+
+/** AArch64 generic timer high-resolution clock */
+struct hrclock arm64_hrclock __hrclock ( HRCLOCK_PREFERRED ) = {
+	.name = "cntvct",
+	.probe = arm64_hrclock_probe,
+	.read = arm64_hrclock_read,
+};
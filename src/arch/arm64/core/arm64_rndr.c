@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * ARMv8.5 random number generator
+ *
+ * RNDRRS returns a random number from a DRBG that has been reseeded
+ * from the hardware entropy source immediately before generating the
+ * number, and so is preferred over RNDR (which may return numbers
+ * from a DRBG that has not been recently reseeded).
+ *
+ */
+
+#include <stdint.h>
+#include <errno.h>
+#include <ipxe/init.h>
+#include <ipxe/entropy.h>
+#include <bits/cpu_entropy.h>
+
+/** ID_AA64ISAR0_EL1 RNDR field */
+#define ID_AA64ISAR0_RNDR( isar0 ) ( ( (isar0) >> 60 ) & 0xf )
+
+/** Maximum number of attempts to read from RNDRRS
+ *
+ * RNDRRS may fail if the entropy source has been unable to generate
+ * sufficient entropy within an implementation-defined time period.
+ */
+#define RNDRRS_MAX_RETRY 10
+
+/** Maximum number of attempts to read from RNDR */
+#define RNDR_MAX_RETRY 10
+
+/** RNDR and RNDRRS registers are usable */
+static int arm64_rndr_enabled;
+
+/**
+ * Read from RNDRRS
+ *
+ * @v value		Value to fill in
+ * @ret ok		Value is valid
+ */
+static inline __attribute__ (( always_inline )) int
+arm64_rndrrs ( uint64_t *value ) {
+	uint32_t ok;
+
+	/* Use generic system register name for assembler compatibility */
+	__asm__ __volatile__ ( "mrs %0, s3_3_c2_c4_1\n\t"
+			       "cset %w1, ne\n\t"
+			       : "=r" ( *value ), "=r" ( ok ) : : "cc" );
+	return ok;
+}
+
+/**
+ * Read from RNDR
+ *
+ * @v value		Value to fill in
+ * @ret ok		Value is valid
+ */
+static inline __attribute__ (( always_inline )) int
+arm64_rndr ( uint64_t *value ) {
+	uint32_t ok;
+
+	/* Use generic system register name for assembler compatibility */
+	__asm__ __volatile__ ( "mrs %0, s3_3_c2_c4_0\n\t"
+			       "cset %w1, ne\n\t"
+			       : "=r" ( *value ), "=r" ( ok ) : : "cc" );
+	return ok;
+}
+
+/**
+ * Get noise sample from hardware random number generator
+ *
+ * @ret noise		Noise sample
+ * @ret rc		Return status code
+ */
+int arm64_rndr_get_noise ( noise_sample_t *noise ) {
+	uint64_t value;
+	unsigned int i;
+
+	/* Fail if RNDR is not implemented */
+	if ( ! arm64_rndr_enabled )
+		return -ENOTSUP;
+
+	/* Try RNDRRS first, falling back to RNDR */
+	for ( i = 0 ; i < RNDRRS_MAX_RETRY ; i++ ) {
+		if ( arm64_rndrrs ( &value ) )
+			goto got_value;
+	}
+	for ( i = 0 ; i < RNDR_MAX_RETRY ; i++ ) {
+		if ( arm64_rndr ( &value ) )
+			goto got_value;
+	}
+	DBGC ( &arm64_rndr_enabled, "RNDR failed after %d attempts\n",
+	       ( RNDRRS_MAX_RETRY + RNDR_MAX_RETRY ) );
+	return -EIO;
+
+ got_value:
+	/* Fold value into a single noise sample */
+	for ( *noise = 0 ; value ; value >>= ( 8 * sizeof ( *noise ) ) )
+		*noise ^= value;
+	return 0;
+}
+
+/**
+ * Detect random number generator support
+ *
+ */
+static void arm64_rndr_init ( void ) {
+	uint64_t isar0;
+
+	/* Read instruction set attribute register */
+	__asm__ ( "mrs %0, id_aa64isar0_el1" : "=r" ( isar0 ) );
+
+	/* Enable RNDR, if supported */
+	if ( ID_AA64ISAR0_RNDR ( isar0 ) ) {
+		DBGC ( &arm64_rndr_enabled, "RNDR using RNDRRS and RNDR\n" );
+		arm64_rndr_enabled = 1;
+	}
+}
+
+/** Random number generator initialisation function */
+struct init_fn arm64_rndr_init_fn __init_fn ( INIT_EARLY ) = {
+	.initialise = arm64_rndr_init,
+};
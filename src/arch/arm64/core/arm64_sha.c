@@ -0,0 +1,390 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * ARMv8 Cryptographic Extension SHA-1 and SHA-256 acceleration
+ *
+ * Only caller-saved SIMD registers (v0-v7 and v16-v31) are used.
+ *
+ */
+
+#include <stdint.h>
+#include <ipxe/init.h>
+#include <ipxe/sha1.h>
+#include <ipxe/sha256.h>
+
+/** ID_AA64ISAR0_EL1 SHA1 field */
+#define ID_AA64ISAR0_SHA1( isar0 ) ( ( (isar0) >> 8 ) & 0xf )
+
+/** ID_AA64ISAR0_EL1 SHA2 field */
+#define ID_AA64ISAR0_SHA2( isar0 ) ( ( (isar0) >> 12 ) & 0xf )
+
+/** SHA-1 instructions are usable */
+int arm64_sha1_enabled;
+
+/** SHA-256 instructions are usable */
+int arm64_sha256_enabled;
+
+/** SHA-1 round constants */
+static const uint32_t arm64_sha1_k[4] = {
+	0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6
+};
+
+/**
+ * Calculate SHA-1 digest of one block using ARMv8 Cryptographic Extension
+ *
+ * @v digest		Digest (big-endian)
+ * @v data		Data block
+ */
+void __attribute__ (( target ( "+crypto" ) ))
+arm64_sha1_digest ( struct sha1_digest *digest,
+		    const union sha1_block *data ) {
+	const uint32_t *k = arm64_sha1_k;
+
+	__asm__ __volatile__ ( /* Load constants, digest and message */
+			       "ld1r {v0.4s}, [%[k]], #4\n\t"
+			       "ld1r {v1.4s}, [%[k]], #4\n\t"
+			       "ld1r {v2.4s}, [%[k]], #4\n\t"
+			       "ld1r {v3.4s}, [%[k]]\n\t"
+			       "ld1 {v6.4s}, [%[digest]]\n\t"
+			       "rev32 v6.16b, v6.16b\n\t"
+			       "ldr s7, [%[digest], #16]\n\t"
+			       "rev32 v7.16b, v7.16b\n\t"
+			       "ld1 {v20.4s, v21.4s, v22.4s, v23.4s}, [%[data]]\n\t"
+			       "rev32 v20.16b, v20.16b\n\t"
+			       "rev32 v21.16b, v21.16b\n\t"
+			       "rev32 v22.16b, v22.16b\n\t"
+			       "rev32 v23.16b, v23.16b\n\t"
+			       "add v4.4s, v20.4s, v0.4s\n\t"
+			       "mov v16.16b, v6.16b\n\t"
+			       /* Rounds 0-3 */
+			       "sha1su0 v20.4s, v21.4s, v22.4s\n\t"
+			       "add v5.4s, v21.4s, v0.4s\n\t"
+			       "sha1h s18, s16\n\t"
+			       "sha1c q16, s7, v4.4s\n\t"
+			       "sha1su1 v20.4s, v23.4s\n\t"
+			       /* Rounds 4-7 */
+			       "sha1su0 v21.4s, v22.4s, v23.4s\n\t"
+			       "add v4.4s, v22.4s, v0.4s\n\t"
+			       "sha1h s17, s16\n\t"
+			       "sha1c q16, s18, v5.4s\n\t"
+			       "sha1su1 v21.4s, v20.4s\n\t"
+			       /* Rounds 8-11 */
+			       "sha1su0 v22.4s, v23.4s, v20.4s\n\t"
+			       "add v5.4s, v23.4s, v0.4s\n\t"
+			       "sha1h s18, s16\n\t"
+			       "sha1c q16, s17, v4.4s\n\t"
+			       "sha1su1 v22.4s, v21.4s\n\t"
+			       /* Rounds 12-15 */
+			       "sha1su0 v23.4s, v20.4s, v21.4s\n\t"
+			       "add v4.4s, v20.4s, v0.4s\n\t"
+			       "sha1h s17, s16\n\t"
+			       "sha1c q16, s18, v5.4s\n\t"
+			       "sha1su1 v23.4s, v22.4s\n\t"
+			       /* Rounds 16-19 */
+			       "sha1su0 v20.4s, v21.4s, v22.4s\n\t"
+			       "add v5.4s, v21.4s, v1.4s\n\t"
+			       "sha1h s18, s16\n\t"
+			       "sha1c q16, s17, v4.4s\n\t"
+			       "sha1su1 v20.4s, v23.4s\n\t"
+			       /* Rounds 20-23 */
+			       "sha1su0 v21.4s, v22.4s, v23.4s\n\t"
+			       "add v4.4s, v22.4s, v1.4s\n\t"
+			       "sha1h s17, s16\n\t"
+			       "sha1p q16, s18, v5.4s\n\t"
+			       "sha1su1 v21.4s, v20.4s\n\t"
+			       /* Rounds 24-27 */
+			       "sha1su0 v22.4s, v23.4s, v20.4s\n\t"
+			       "add v5.4s, v23.4s, v1.4s\n\t"
+			       "sha1h s18, s16\n\t"
+			       "sha1p q16, s17, v4.4s\n\t"
+			       "sha1su1 v22.4s, v21.4s\n\t"
+			       /* Rounds 28-31 */
+			       "sha1su0 v23.4s, v20.4s, v21.4s\n\t"
+			       "add v4.4s, v20.4s, v1.4s\n\t"
+			       "sha1h s17, s16\n\t"
+			       "sha1p q16, s18, v5.4s\n\t"
+			       "sha1su1 v23.4s, v22.4s\n\t"
+			       /* Rounds 32-35 */
+			       "sha1su0 v20.4s, v21.4s, v22.4s\n\t"
+			       "add v5.4s, v21.4s, v1.4s\n\t"
+			       "sha1h s18, s16\n\t"
+			       "sha1p q16, s17, v4.4s\n\t"
+			       "sha1su1 v20.4s, v23.4s\n\t"
+			       /* Rounds 36-39 */
+			       "sha1su0 v21.4s, v22.4s, v23.4s\n\t"
+			       "add v4.4s, v22.4s, v2.4s\n\t"
+			       "sha1h s17, s16\n\t"
+			       "sha1p q16, s18, v5.4s\n\t"
+			       "sha1su1 v21.4s, v20.4s\n\t"
+			       /* Rounds 40-43 */
+			       "sha1su0 v22.4s, v23.4s, v20.4s\n\t"
+			       "add v5.4s, v23.4s, v2.4s\n\t"
+			       "sha1h s18, s16\n\t"
+			       "sha1m q16, s17, v4.4s\n\t"
+			       "sha1su1 v22.4s, v21.4s\n\t"
+			       /* Rounds 44-47 */
+			       "sha1su0 v23.4s, v20.4s, v21.4s\n\t"
+			       "add v4.4s, v20.4s, v2.4s\n\t"
+			       "sha1h s17, s16\n\t"
+			       "sha1m q16, s18, v5.4s\n\t"
+			       "sha1su1 v23.4s, v22.4s\n\t"
+			       /* Rounds 48-51 */
+			       "sha1su0 v20.4s, v21.4s, v22.4s\n\t"
+			       "add v5.4s, v21.4s, v2.4s\n\t"
+			       "sha1h s18, s16\n\t"
+			       "sha1m q16, s17, v4.4s\n\t"
+			       "sha1su1 v20.4s, v23.4s\n\t"
+			       /* Rounds 52-55 */
+			       "sha1su0 v21.4s, v22.4s, v23.4s\n\t"
+			       "add v4.4s, v22.4s, v2.4s\n\t"
+			       "sha1h s17, s16\n\t"
+			       "sha1m q16, s18, v5.4s\n\t"
+			       "sha1su1 v21.4s, v20.4s\n\t"
+			       /* Rounds 56-59 */
+			       "sha1su0 v22.4s, v23.4s, v20.4s\n\t"
+			       "add v5.4s, v23.4s, v3.4s\n\t"
+			       "sha1h s18, s16\n\t"
+			       "sha1m q16, s17, v4.4s\n\t"
+			       "sha1su1 v22.4s, v21.4s\n\t"
+			       /* Rounds 60-63 */
+			       "sha1su0 v23.4s, v20.4s, v21.4s\n\t"
+			       "add v4.4s, v20.4s, v3.4s\n\t"
+			       "sha1h s17, s16\n\t"
+			       "sha1p q16, s18, v5.4s\n\t"
+			       "sha1su1 v23.4s, v22.4s\n\t"
+			       /* Rounds 64-67 */
+			       "add v5.4s, v21.4s, v3.4s\n\t"
+			       "sha1h s18, s16\n\t"
+			       "sha1p q16, s17, v4.4s\n\t"
+			       /* Rounds 68-71 */
+			       "add v4.4s, v22.4s, v3.4s\n\t"
+			       "sha1h s17, s16\n\t"
+			       "sha1p q16, s18, v5.4s\n\t"
+			       /* Rounds 72-75 */
+			       "add v5.4s, v23.4s, v3.4s\n\t"
+			       "sha1h s18, s16\n\t"
+			       "sha1p q16, s17, v4.4s\n\t"
+			       /* Rounds 76-79 */
+			       "sha1h s17, s16\n\t"
+			       "sha1p q16, s18, v5.4s\n\t"
+			       /* Add to digest and store */
+			       "add v7.2s, v7.2s, v17.2s\n\t"
+			       "add v6.4s, v6.4s, v16.4s\n\t"
+			       "rev32 v6.16b, v6.16b\n\t"
+			       "rev32 v7.16b, v7.16b\n\t"
+			       "st1 {v6.4s}, [%[digest]]\n\t"
+			       "str s7, [%[digest], #16]\n\t"
+			       : [k] "+r" ( k )
+			       : [digest] "r" ( digest ), [data] "r" ( data )
+			       : "v0", "v1", "v2", "v3", "v4", "v5", "v6", "v7",
+				 "v16", "v17", "v18", "v20", "v21", "v22",
+				 "v23", "memory" );
+}
+
+/**
+ * Calculate SHA-256 digest of one block using ARMv8 Cryptographic Extension
+ *
+ * @v digest		Digest (big-endian)
+ * @v data		Data block
+ * @v k			SHA-256 round constants
+ */
+void __attribute__ (( target ( "+crypto" ) ))
+arm64_sha256_digest ( struct sha256_digest *digest,
+		      const union sha256_block *data, const uint32_t *k ) {
+
+	__asm__ __volatile__ ( /* Load digest and message */
+			       "ld1 {v0.4s, v1.4s}, [%[digest]]\n\t"
+			       "rev32 v0.16b, v0.16b\n\t"
+			       "rev32 v1.16b, v1.16b\n\t"
+			       "ld1 {v16.4s, v17.4s, v18.4s, v19.4s}, [%[data]]\n\t"
+			       "rev32 v16.16b, v16.16b\n\t"
+			       "rev32 v17.16b, v17.16b\n\t"
+			       "rev32 v18.16b, v18.16b\n\t"
+			       "rev32 v19.16b, v19.16b\n\t"
+			       "ld1 {v22.4s}, [%[k]], #16\n\t"
+			       "add v20.4s, v16.4s, v22.4s\n\t"
+			       "mov v2.16b, v0.16b\n\t"
+			       "mov v3.16b, v1.16b\n\t"
+			       /* Rounds 0-3 */
+			       "sha256su0 v16.4s, v17.4s\n\t"
+			       "mov v4.16b, v2.16b\n\t"
+			       "ld1 {v22.4s}, [%[k]], #16\n\t"
+			       "add v21.4s, v17.4s, v22.4s\n\t"
+			       "sha256h q2, q3, v20.4s\n\t"
+			       "sha256h2 q3, q4, v20.4s\n\t"
+			       "sha256su1 v16.4s, v18.4s, v19.4s\n\t"
+			       /* Rounds 4-7 */
+			       "sha256su0 v17.4s, v18.4s\n\t"
+			       "mov v4.16b, v2.16b\n\t"
+			       "ld1 {v22.4s}, [%[k]], #16\n\t"
+			       "add v20.4s, v18.4s, v22.4s\n\t"
+			       "sha256h q2, q3, v21.4s\n\t"
+			       "sha256h2 q3, q4, v21.4s\n\t"
+			       "sha256su1 v17.4s, v19.4s, v16.4s\n\t"
+			       /* Rounds 8-11 */
+			       "sha256su0 v18.4s, v19.4s\n\t"
+			       "mov v4.16b, v2.16b\n\t"
+			       "ld1 {v22.4s}, [%[k]], #16\n\t"
+			       "add v21.4s, v19.4s, v22.4s\n\t"
+			       "sha256h q2, q3, v20.4s\n\t"
+			       "sha256h2 q3, q4, v20.4s\n\t"
+			       "sha256su1 v18.4s, v16.4s, v17.4s\n\t"
+			       /* Rounds 12-15 */
+			       "sha256su0 v19.4s, v16.4s\n\t"
+			       "mov v4.16b, v2.16b\n\t"
+			       "ld1 {v22.4s}, [%[k]], #16\n\t"
+			       "add v20.4s, v16.4s, v22.4s\n\t"
+			       "sha256h q2, q3, v21.4s\n\t"
+			       "sha256h2 q3, q4, v21.4s\n\t"
+			       "sha256su1 v19.4s, v17.4s, v18.4s\n\t"
+			       /* Rounds 16-19 */
+			       "sha256su0 v16.4s, v17.4s\n\t"
+			       "mov v4.16b, v2.16b\n\t"
+			       "ld1 {v22.4s}, [%[k]], #16\n\t"
+			       "add v21.4s, v17.4s, v22.4s\n\t"
+			       "sha256h q2, q3, v20.4s\n\t"
+			       "sha256h2 q3, q4, v20.4s\n\t"
+			       "sha256su1 v16.4s, v18.4s, v19.4s\n\t"
+			       /* Rounds 20-23 */
+			       "sha256su0 v17.4s, v18.4s\n\t"
+			       "mov v4.16b, v2.16b\n\t"
+			       "ld1 {v22.4s}, [%[k]], #16\n\t"
+			       "add v20.4s, v18.4s, v22.4s\n\t"
+			       "sha256h q2, q3, v21.4s\n\t"
+			       "sha256h2 q3, q4, v21.4s\n\t"
+			       "sha256su1 v17.4s, v19.4s, v16.4s\n\t"
+			       /* Rounds 24-27 */
+			       "sha256su0 v18.4s, v19.4s\n\t"
+			       "mov v4.16b, v2.16b\n\t"
+			       "ld1 {v22.4s}, [%[k]], #16\n\t"
+			       "add v21.4s, v19.4s, v22.4s\n\t"
+			       "sha256h q2, q3, v20.4s\n\t"
+			       "sha256h2 q3, q4, v20.4s\n\t"
+			       "sha256su1 v18.4s, v16.4s, v17.4s\n\t"
+			       /* Rounds 28-31 */
+			       "sha256su0 v19.4s, v16.4s\n\t"
+			       "mov v4.16b, v2.16b\n\t"
+			       "ld1 {v22.4s}, [%[k]], #16\n\t"
+			       "add v20.4s, v16.4s, v22.4s\n\t"
+			       "sha256h q2, q3, v21.4s\n\t"
+			       "sha256h2 q3, q4, v21.4s\n\t"
+			       "sha256su1 v19.4s, v17.4s, v18.4s\n\t"
+			       /* Rounds 32-35 */
+			       "sha256su0 v16.4s, v17.4s\n\t"
+			       "mov v4.16b, v2.16b\n\t"
+			       "ld1 {v22.4s}, [%[k]], #16\n\t"
+			       "add v21.4s, v17.4s, v22.4s\n\t"
+			       "sha256h q2, q3, v20.4s\n\t"
+			       "sha256h2 q3, q4, v20.4s\n\t"
+			       "sha256su1 v16.4s, v18.4s, v19.4s\n\t"
+			       /* Rounds 36-39 */
+			       "sha256su0 v17.4s, v18.4s\n\t"
+			       "mov v4.16b, v2.16b\n\t"
+			       "ld1 {v22.4s}, [%[k]], #16\n\t"
+			       "add v20.4s, v18.4s, v22.4s\n\t"
+			       "sha256h q2, q3, v21.4s\n\t"
+			       "sha256h2 q3, q4, v21.4s\n\t"
+			       "sha256su1 v17.4s, v19.4s, v16.4s\n\t"
+			       /* Rounds 40-43 */
+			       "sha256su0 v18.4s, v19.4s\n\t"
+			       "mov v4.16b, v2.16b\n\t"
+			       "ld1 {v22.4s}, [%[k]], #16\n\t"
+			       "add v21.4s, v19.4s, v22.4s\n\t"
+			       "sha256h q2, q3, v20.4s\n\t"
+			       "sha256h2 q3, q4, v20.4s\n\t"
+			       "sha256su1 v18.4s, v16.4s, v17.4s\n\t"
+			       /* Rounds 44-47 */
+			       "sha256su0 v19.4s, v16.4s\n\t"
+			       "mov v4.16b, v2.16b\n\t"
+			       "ld1 {v22.4s}, [%[k]], #16\n\t"
+			       "add v20.4s, v16.4s, v22.4s\n\t"
+			       "sha256h q2, q3, v21.4s\n\t"
+			       "sha256h2 q3, q4, v21.4s\n\t"
+			       "sha256su1 v19.4s, v17.4s, v18.4s\n\t"
+			       /* Rounds 48-51 */
+			       "mov v4.16b, v2.16b\n\t"
+			       "ld1 {v22.4s}, [%[k]], #16\n\t"
+			       "add v21.4s, v17.4s, v22.4s\n\t"
+			       "sha256h q2, q3, v20.4s\n\t"
+			       "sha256h2 q3, q4, v20.4s\n\t"
+			       /* Rounds 52-55 */
+			       "mov v4.16b, v2.16b\n\t"
+			       "ld1 {v22.4s}, [%[k]], #16\n\t"
+			       "add v20.4s, v18.4s, v22.4s\n\t"
+			       "sha256h q2, q3, v21.4s\n\t"
+			       "sha256h2 q3, q4, v21.4s\n\t"
+			       /* Rounds 56-59 */
+			       "mov v4.16b, v2.16b\n\t"
+			       "ld1 {v22.4s}, [%[k]], #16\n\t"
+			       "add v21.4s, v19.4s, v22.4s\n\t"
+			       "sha256h q2, q3, v20.4s\n\t"
+			       "sha256h2 q3, q4, v20.4s\n\t"
+			       /* Rounds 60-63 */
+			       "mov v4.16b, v2.16b\n\t"
+			       "sha256h q2, q3, v21.4s\n\t"
+			       "sha256h2 q3, q4, v21.4s\n\t"
+			       /* Add to digest and store */
+			       "add v0.4s, v0.4s, v2.4s\n\t"
+			       "add v1.4s, v1.4s, v3.4s\n\t"
+			       "rev32 v0.16b, v0.16b\n\t"
+			       "rev32 v1.16b, v1.16b\n\t"
+			       "st1 {v0.4s, v1.4s}, [%[digest]]\n\t"
+			       : [k] "+r" ( k )
+			       : [digest] "r" ( digest ), [data] "r" ( data )
+			       : "v0", "v1", "v2", "v3", "v4", "v16", "v17",
+				 "v18", "v19", "v20", "v21", "v22", "memory" );
+}
+
+/**
+ * Detect SHA instruction support
+ *
+ */
+static void arm64_sha_init ( void ) {
+	uint64_t isar0;
+
+	/* Read instruction set attribute register */
+	__asm__ ( "mrs %0, id_aa64isar0_el1" : "=r" ( isar0 ) );
+
+	/* Enable SHA-1 instructions, if supported */
+	if ( ID_AA64ISAR0_SHA1 ( isar0 ) ) {
+		DBGC ( &arm64_sha1_enabled, "SHACE using SHA-1 "
+		       "instructions\n" );
+		arm64_sha1_enabled = 1;
+	}
+
+	/* Enable SHA-256 instructions, if supported */
+	if ( ID_AA64ISAR0_SHA2 ( isar0 ) ) {
+		DBGC ( &arm64_sha1_enabled, "SHACE using SHA-256 "
+		       "instructions\n" );
+		arm64_sha256_enabled = 1;
+	}
+}
+
+/** SHA instruction detection initialisation function */
+struct init_fn arm64_sha_init_fn __init_fn ( INIT_EARLY ) = {
+	.initialise = arm64_sha_init,
+};
@@ -27,11 +27,32 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  *
  * TCP/IP checksum
  *
+ * Large blocks of data are summed using Advanced SIMD (NEON) where
+ * available, with any remainder being summed by the scalar loop.  The
+ * vector loop adds pairs of 32-bit words into 64-bit lanes, and so
+ * can never overflow for any realistic data length.
+ *
  */
 
 #include <strings.h>
+#include <ipxe/init.h>
 #include <ipxe/tcpip.h>
 
+/** ID_AA64PFR0_EL1 Advanced SIMD field */
+#define ID_AA64PFR0_ADVSIMD( pfr0 ) ( ( (pfr0) >> 20 ) & 0xf )
+
+/** ID_AA64PFR0_EL1 Advanced SIMD field value indicating no support */
+#define ID_AA64PFR0_ADVSIMD_NONE 0xf
+
+/** Block size for NEON checksumming loop */
+#define TCPIP_NEON_BLOCK 64
+
+/** Minimum length for NEON checksumming */
+#define TCPIP_NEON_MIN_LEN 128
+
+/** Usable vector instruction sets for checksumming */
+unsigned int arm64_tcpip_simd;
+
 /** Alignment used by main checksumming loop */
 #define TCPIP_CHKSUM_ALIGN 16
 
@@ -39,15 +60,15 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #define TCPIP_CHKSUM_UNROLL 4
 
 /**
- * Calculate continued TCP/IP checkum
+ * Calculate continued TCP/IP checkum using scalar instructions
  *
  * @v sum		Checksum of already-summed data, in network byte order
  * @v data		Data buffer
  * @v len		Length of data buffer
  * @ret sum		Updated checksum, in network byte order
  */
-uint16_t tcpip_continue_chksum ( uint16_t sum, const void *data,
-				 size_t len ) {
+static uint16_t __attribute__ (( noinline ))
+arm64_tcpip_scalar_chksum ( uint16_t sum, const void *data, size_t len ) {
 	intptr_t start;
 	intptr_t end;
 	intptr_t mid;
@@ -173,3 +194,102 @@ uint16_t tcpip_continue_chksum ( uint16_t sum, const void *data,
 
 	return sum;
 }
+
+/**
+ * Sum data using Advanced SIMD
+ *
+ * @v data		Data buffer
+ * @v len		Length of data buffer (a non-zero multiple of 64)
+ * @ret sum		Sum of native-endian 32-bit words
+ */
+static uint64_t __attribute__ (( target ( "+simd" ) ))
+arm64_tcpip_neon_sum ( const void *data, size_t len ) {
+	uint64_t sum;
+
+	__asm__ __volatile__ ( "movi v0.2d, #0\n\t"
+			       "movi v1.2d, #0\n\t"
+			       "movi v2.2d, #0\n\t"
+			       "movi v3.2d, #0\n\t"
+			       "\n1:\n\t"
+			       "ld1 {v4.4s, v5.4s, v6.4s, v7.4s}, "
+			       "[%[data]], #64\n\t"
+			       "uadalp v0.2d, v4.4s\n\t"
+			       "uadalp v1.2d, v5.4s\n\t"
+			       "uadalp v2.2d, v6.4s\n\t"
+			       "uadalp v3.2d, v7.4s\n\t"
+			       "subs %[len], %[len], #64\n\t"
+			       "b.ne 1b\n\t"
+			       "add v0.2d, v0.2d, v1.2d\n\t"
+			       "add v2.2d, v2.2d, v3.2d\n\t"
+			       "add v0.2d, v0.2d, v2.2d\n\t"
+			       "addp d0, v0.2d\n\t"
+			       "fmov %[sum], d0\n\t"
+			       : [data] "+r" ( data ), [len] "+r" ( len ),
+				 [sum] "=r" ( sum )
+			       :
+			       : "v0", "v1", "v2", "v3", "v4", "v5", "v6", "v7",
+				 "memory", "cc" );
+
+	return sum;
+}
+
+/**
+ * Calculate continued TCP/IP checkum
+ *
+ * @v sum		Checksum of already-summed data, in network byte order
+ * @v data		Data buffer
+ * @v len		Length of data buffer
+ * @ret sum		Updated checksum, in network byte order
+ */
+uint16_t tcpip_continue_chksum ( uint16_t sum, const void *data,
+				 size_t len ) {
+	uint64_t total;
+	size_t bulk;
+
+	/* Use scalar instructions for short blocks of data */
+	if ( ! ( ( arm64_tcpip_simd & ARM64_TCPIP_NEON ) &&
+		 ( len >= TCPIP_NEON_MIN_LEN ) ) ) {
+		return arm64_tcpip_scalar_chksum ( sum, data, len );
+	}
+
+	/* Sum as many whole blocks as possible using vector instructions */
+	bulk = ( len & ~( TCPIP_NEON_BLOCK - 1 ) );
+	total = arm64_tcpip_neon_sum ( data, bulk );
+
+	/* Fold down to a uint16_t, including the partial checksum */
+	total += ( ( ~sum ) & 0xffff );
+	total = ( ( total & 0xffffffffUL ) + ( total >> 32 ) );
+	total = ( ( total & 0xffffffffUL ) + ( total >> 32 ) );
+	total = ( ( total & 0xffff ) + ( total >> 16 ) );
+	total = ( ( total & 0xffff ) + ( total >> 16 ) );
+	total = ( ( total & 0xffff ) + ( total >> 16 ) );
+	sum = ( ~total & 0xffff );
+
+	/* Sum any remaining data using scalar instructions */
+	return arm64_tcpip_scalar_chksum ( sum, ( data + bulk ),
+					   ( len - bulk ) );
+}
+
+/**
+ * Detect Advanced SIMD support for checksumming
+ *
+ */
+static void arm64_tcpip_init ( void ) {
+	uint64_t pfr0;
+
+	/* Read processor feature register */
+	__asm__ ( "mrs %0, id_aa64pfr0_el1" : "=r" ( pfr0 ) );
+	DBGC ( &arm64_tcpip_simd, "TCPIP ID_AA64PFR0_EL1 %#016llx\n",
+	       ( ( unsigned long long ) pfr0 ) );
+
+	/* Enable Advanced SIMD, if supported */
+	if ( ID_AA64PFR0_ADVSIMD ( pfr0 ) != ID_AA64PFR0_ADVSIMD_NONE ) {
+		DBGC ( &arm64_tcpip_simd, "TCPIP using NEON checksumming\n" );
+		arm64_tcpip_simd |= ARM64_TCPIP_NEON;
+	}
+}
+
+/** Advanced SIMD detection initialisation function */
+struct init_fn arm64_tcpip_init_fn __init_fn ( INIT_EARLY ) = {
+	.initialise = arm64_tcpip_init,
+};
@@ -0,0 +1,55 @@
+#ifndef _BITS_AES_H
+#define _BITS_AES_H
+
+/** @file
+ *
+ * ARM64-specific AES acceleration
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+extern int arm64_aes_enabled;
+
+extern void arm64_aes_encrypt ( const struct aes_context *aes,
+				const void *src, void *dst );
+extern void arm64_aes_decrypt ( const struct aes_context *aes,
+				const void *src, void *dst );
+
+/**
+ * Encrypt block using hardware acceleration, if available
+ *
+ * @v aes		AES context
+ * @v src		Data to encrypt
+ * @v dst		Buffer for encrypted data
+ * @ret accelerated	Block was encrypted using hardware acceleration
+ */
+static inline __attribute__ (( always_inline )) int
+aes_accel_encrypt ( const struct aes_context *aes, const void *src,
+		    void *dst ) {
+
+	if ( ! arm64_aes_enabled )
+		return 0;
+	arm64_aes_encrypt ( aes, src, dst );
+	return 1;
+}
+
+/**
+ * Decrypt block using hardware acceleration, if available
+ *
+ * @v aes		AES context
+ * @v src		Data to decrypt
+ * @v dst		Buffer for decrypted data
+ * @ret accelerated	Block was decrypted using hardware acceleration
+ */
+static inline __attribute__ (( always_inline )) int
+aes_accel_decrypt ( const struct aes_context *aes, const void *src,
+		    void *dst ) {
+
+	if ( ! arm64_aes_enabled )
+		return 0;
+	arm64_aes_decrypt ( aes, src, dst );
+	return 1;
+}
+
+#endif /* _BITS_AES_H */
@@ -313,5 +313,9 @@ bigint_done_raw ( const uint64_t *value0, unsigned int size __unused,
 extern void bigint_multiply_raw ( const uint64_t *multiplicand0,
 				  const uint64_t *multiplier0,
 				  uint64_t *value0, unsigned int size );
+extern uint64_t bigint_multiply_accumulate_raw ( const uint64_t *multiplicand0,
+						 uint64_t multiplier,
+						 uint64_t *value0,
+						 unsigned int size );
 
 #endif /* _BITS_BIGINT_H */
@@ -0,0 +1,49 @@
+#ifndef _BITS_CRC32_H
+#define _BITS_CRC32_H
+
+/** @file
+ *
+ * ARM64-specific CRC32 acceleration
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+extern int arm64_crc32_enabled;
+
+extern size_t arm64_crc32 ( uint32_t *crc, const void *data, size_t len );
+extern size_t arm64_crc32c ( uint32_t *crc, const void *data, size_t len );
+
+/**
+ * Calculate CRC32 using hardware acceleration, if available
+ *
+ * @v crc		CRC to update
+ * @v data		Data to checksum
+ * @v len		Length of data
+ * @ret done		Length of data processed
+ */
+static inline __attribute__ (( always_inline )) size_t
+crc32_accel_le ( uint32_t *crc, const void *data, size_t len ) {
+
+	if ( ! arm64_crc32_enabled )
+		return 0;
+	return arm64_crc32 ( crc, data, len );
+}
+
+/**
+ * Calculate CRC32C using hardware acceleration, if available
+ *
+ * @v crc		CRC to update
+ * @v data		Data to checksum
+ * @v len		Length of data
+ * @ret done		Length of data processed
+ */
+static inline __attribute__ (( always_inline )) size_t
+crc32c_accel_le ( uint32_t *crc, const void *data, size_t len ) {
+
+	if ( ! arm64_crc32_enabled )
+		return 0;
+	return arm64_crc32c ( crc, data, len );
+}
+
+#endif /* _BITS_CRC32_H */
@@ -0,0 +1,27 @@
+#ifndef _BITS_GCM_H
+#define _BITS_GCM_H
+
+/** @file
+ *
+ * ARM64-specific GCM acceleration
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/**
+ * Multiply accumulated hash by hash key using hardware acceleration
+ *
+ * @v key		Hash key (H)
+ * @v hash		Accumulated hash (X)
+ * @ret accelerated	Hash was multiplied using hardware acceleration
+ */
+static inline __attribute__ (( always_inline )) int
+gcm_accel_multiply ( const union gcm_block *key __unused,
+		     union gcm_block *hash __unused ) {
+
+	/* Not yet optimised */
+	return 0;
+}
+
+#endif /* _BITS_GCM_H */
@@ -20,8 +20,12 @@ static inline __attribute__ (( always_inline )) uint64_t
 profile_timestamp ( void ) {
 	uint64_t cycles;
 
-	/* Read cycle counter */
-	__asm__ __volatile__ ( "mrs %0, CNTVCT_EL0\n\t" : "=r" ( cycles ) );
+	/* Read virtual counter.  The barrier prevents the read from
+	 * being speculatively executed ahead of the code being
+	 * profiled.
+	 */
+	__asm__ __volatile__ ( "isb\n\t"
+			       "mrs %0, CNTVCT_EL0\n\t" : "=r" ( cycles ) );
 	return cycles;
 }
 
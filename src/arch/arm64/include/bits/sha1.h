@@ -0,0 +1,33 @@
+#ifndef _BITS_SHA1_H
+#define _BITS_SHA1_H
+
+/** @file
+ *
+ * ARM64-specific SHA-1 acceleration
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+extern int arm64_sha1_enabled;
+
+extern void arm64_sha1_digest ( struct sha1_digest *digest,
+				const union sha1_block *data );
+
+/**
+ * Calculate digest of one block using hardware acceleration, if available
+ *
+ * @v digest		Digest (big-endian)
+ * @v data		Data block
+ * @ret accelerated	Block was digested using hardware acceleration
+ */
+static inline __attribute__ (( always_inline )) int
+sha1_accel_digest ( void *digest, const void *data ) {
+
+	if ( ! arm64_sha1_enabled )
+		return 0;
+	arm64_sha1_digest ( digest, data );
+	return 1;
+}
+
+#endif /* _BITS_SHA1_H */
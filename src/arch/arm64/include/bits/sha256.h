@@ -0,0 +1,35 @@
+#ifndef _BITS_SHA256_H
+#define _BITS_SHA256_H
+
+/** @file
+ *
+ * ARM64-specific SHA-256 acceleration
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+extern int arm64_sha256_enabled;
+
+extern void arm64_sha256_digest ( struct sha256_digest *digest,
+				  const union sha256_block *data,
+				  const uint32_t *k );
+
+/**
+ * Calculate digest of one block using hardware acceleration, if available
+ *
+ * @v digest		Digest (big-endian)
+ * @v data		Data block
+ * @v k			SHA-256 round constants
+ * @ret accelerated	Block was digested using hardware acceleration
+ */
+static inline __attribute__ (( always_inline )) int
+sha256_accel_digest ( void *digest, const void *data, const uint32_t *k ) {
+
+	if ( ! arm64_sha256_enabled )
+		return 0;
+	arm64_sha256_digest ( digest, data, k );
+	return 1;
+}
+
+#endif /* _BITS_SHA256_H */
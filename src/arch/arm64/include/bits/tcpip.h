@@ -9,6 +9,11 @@
 
 FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
+/** Advanced SIMD instructions are usable for checksumming */
+#define ARM64_TCPIP_NEON 0x0001
+
+extern unsigned int arm64_tcpip_simd;
+
 extern uint16_t tcpip_continue_chksum ( uint16_t sum, const void *data,
 					size_t len );
 
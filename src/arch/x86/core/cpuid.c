@@ -171,3 +171,25 @@ void x86_features ( struct x86_features *features ) {
 	/* Get AMD-defined features */
 	x86_amd_features ( features );
 }
+
+/**
+ * Check whether or not SSE instructions are usable
+ *
+ * @ret usable		SSE instructions are usable
+ */
+int x86_sse_usable ( void ) {
+	unsigned long cr4;
+	uint16_t cs;
+
+	/* If we are not running in ring 0 (e.g. as a Linux userspace
+	 * application) then the operating system will have enabled
+	 * SSE on our behalf.
+	 */
+	__asm__ ( "movw %%cs, %0" : "=r" ( cs ) );
+	if ( cs & 0x3 )
+		return 1;
+
+	/* Otherwise, SSE is usable only if the firmware has enabled it */
+	__asm__ ( "mov %%cr4, %0" : "=r" ( cr4 ) );
+	return ( cr4 & CR4_OSFXSR );
+}
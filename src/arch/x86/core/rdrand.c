@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * x86 hardware random number generator
+ *
+ * RDSEED returns the output of the CPU's conditioned entropy source,
+ * and is preferred where available.  RDRAND returns the output of a
+ * DRBG that is continuously reseeded from the same entropy source,
+ * and is used when RDSEED is unsupported or temporarily exhausted.
+ *
+ */
+
+#include <stdint.h>
+#include <errno.h>
+#include <ipxe/cpuid.h>
+#include <ipxe/init.h>
+#include <ipxe/entropy.h>
+#include <bits/cpu_entropy.h>
+
+/** Maximum number of attempts to read from RDSEED
+ *
+ * RDSEED may legitimately fail when the entropy source is being
+ * drained faster than it can be replenished (e.g. by other logical
+ * processors).
+ */
+#define RDSEED_MAX_RETRY 64
+
+/** Maximum number of attempts to read from RDRAND
+ *
+ * Intel's "Digital Random Number Generator Software Implementation
+ * Guide" states that ten consecutive RDRAND failures indicate a
+ * hardware fault.
+ */
+#define RDRAND_MAX_RETRY 10
+
+/** RDSEED instruction is usable */
+static int rdseed_enabled;
+
+/** RDRAND instruction is usable */
+static int rdrand_enabled;
+
+/**
+ * Read from RDSEED
+ *
+ * @v value		Value to fill in
+ * @ret ok		Value is valid
+ */
+static inline __attribute__ (( always_inline )) int
+rdseed ( unsigned long *value ) {
+	uint8_t ok;
+
+	__asm__ __volatile__ ( "rdseed %0\n\t"
+			       "setc %1\n\t"
+			       : "=r" ( *value ), "=qm" ( ok ) : : "cc" );
+	return ok;
+}
+
+/**
+ * Read from RDRAND
+ *
+ * @v value		Value to fill in
+ * @ret ok		Value is valid
+ */
+static inline __attribute__ (( always_inline )) int
+rdrand ( unsigned long *value ) {
+	uint8_t ok;
+
+	__asm__ __volatile__ ( "rdrand %0\n\t"
+			       "setc %1\n\t"
+			       : "=r" ( *value ), "=qm" ( ok ) : : "cc" );
+	return ok;
+}
+
+/**
+ * Get noise sample from hardware random number generator
+ *
+ * @ret noise		Noise sample
+ * @ret rc		Return status code
+ */
+int rdrand_get_noise ( noise_sample_t *noise ) {
+	unsigned long value;
+	unsigned int i;
+
+	/* Try RDSEED first */
+	if ( rdseed_enabled ) {
+		for ( i = 0 ; i < RDSEED_MAX_RETRY ; i++ ) {
+			if ( rdseed ( &value ) )
+				goto got_value;
+			__asm__ __volatile__ ( "pause" );
+		}
+	}
+
+	/* Fall back to RDRAND */
+	if ( rdrand_enabled ) {
+		for ( i = 0 ; i < RDRAND_MAX_RETRY ; i++ ) {
+			if ( rdrand ( &value ) )
+				goto got_value;
+		}
+		DBGC ( &rdrand_enabled, "RDRAND failed after %d attempts\n",
+		       RDRAND_MAX_RETRY );
+		return -EIO;
+	}
+
+	return -ENOTSUP;
+
+ got_value:
+	/* Fold value into a single noise sample */
+	for ( *noise = 0 ; value ; value >>= ( 8 * sizeof ( *noise ) ) )
+		*noise ^= value;
+	return 0;
+}
+
+/**
+ * Detect hardware random number generator
+ *
+ */
+static void rdrand_init ( void ) {
+	struct x86_features features;
+	uint32_t discard_a;
+	uint32_t discard_c;
+	uint32_t discard_d;
+	uint32_t ebx;
+
+	/* Check for RDRAND */
+	x86_features ( &features );
+	if ( features.intel.ecx & CPUID_FEATURES_INTEL_ECX_RDRAND ) {
+		DBGC ( &rdrand_enabled, "RDRAND using RDRAND\n" );
+		rdrand_enabled = 1;
+	}
+
+	/* Check for RDSEED */
+	if ( cpuid_supported ( CPUID_STRUCTURED ) != 0 )
+		return;
+	cpuid ( CPUID_STRUCTURED, 0, &discard_a, &ebx, &discard_c,
+		&discard_d );
+	if ( ebx & CPUID_STRUCTURED_EBX_RDSEED ) {
+		DBGC ( &rdrand_enabled, "RDRAND using RDSEED\n" );
+		rdseed_enabled = 1;
+	}
+}
+
+/** Hardware random number generator initialisation function */
+struct init_fn rdrand_init_fn __init_fn ( INIT_EARLY ) = {
+	.initialise = rdrand_init,
+};
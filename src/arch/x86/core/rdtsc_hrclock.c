@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * RDTSC high-resolution clock
+ *
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <ipxe/cpuid.h>
+#include <ipxe/profile.h>
+#include <ipxe/hrclock.h>
+
+/**
+ * Read TSC
+ *
+ * @ret count		Current counter value
+ */
+static uint64_t rdtsc_hrclock_read ( void ) {
+
+	return profile_timestamp();
+}
+
+/**
+ * Probe RDTSC high-resolution clock
+ *
+ * @ret hz		Counter frequency (in Hz)
+ * @ret rc		Return status code
+ */
+static int rdtsc_hrclock_probe ( uint64_t *hz ) {
+	uint32_t apm;
+	uint32_t discard_a;
+	uint32_t discard_b;
+	uint32_t discard_c;
+	int rc;
+
+	/* Check that TSC is invariant */
+	if ( ( rc = cpuid_supported ( CPUID_APM ) ) != 0 ) {
+		DBGC ( hz, "RDTSC cannot determine APM features: %s\n",
+		       strerror ( rc ) );
+		return rc;
+	}
+	cpuid ( CPUID_APM, 0, &discard_a, &discard_b, &discard_c, &apm );
+	if ( ! ( apm & CPUID_APM_EDX_TSC_INVARIANT ) ) {
+		DBGC ( hz, "RDTSC has non-invariant TSC (%#08x)\n", apm );
+		return -ENOTTY;
+	}
+
+	/* Calibrate TSC frequency */
+	*hz = hrclock_calibrate ( rdtsc_hrclock_read );
+
+	return 0;
+}
+
+/** RDTSC high-resolution clock */
+struct hrclock rdtsc_hrclock __hrclock ( HRCLOCK_PREFERRED ) = {
+	.name = "rdtsc",
+	.probe = rdtsc_hrclock_probe,
+	.read = rdtsc_hrclock_read,
+};
@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * x86 AES-NI and PCLMULQDQ acceleration
+ *
+ * The AES-NI routines reuse the round keys constructed by the generic
+ * AES key expansion: the encryption keys are already in the order
+ * expected by AESENC, and the decryption keys are already in the
+ * order (with InvMixColumns pre-applied) expected by AESDEC.
+ *
+ * iPXE is built without SSE code generation, and so the compiler will
+ * never allocate an SSE register on our behalf.  Only %xmm0-%xmm5 are
+ * used, since these are volatile under all calling conventions that
+ * we may encounter (including the UEFI x64 calling convention).
+ *
+ */
+
+#include <stdint.h>
+#include <ipxe/cpuid.h>
+#include <ipxe/init.h>
+#include <ipxe/aes.h>
+#include <ipxe/gcm.h>
+
+/** AES-NI instructions are usable */
+int aesni_enabled;
+
+/** PCLMULQDQ instruction is usable for GHASH */
+int pclmul_enabled;
+
+/** Byte-reversal mask for PSHUFB */
+static const uint8_t pclmul_bswap[16] = {
+	15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0
+};
+
+/**
+ * Encrypt block using AES-NI
+ *
+ * @v aes		AES context
+ * @v src		Data to encrypt
+ * @v dst		Buffer for encrypted data
+ */
+void __attribute__ (( target ( "sse2,aes" ) ))
+aesni_encrypt ( const struct aes_context *aes, const void *src, void *dst ) {
+	const union aes_matrix *key = &aes->encrypt.key[0];
+	unsigned int count = ( aes->rounds - 2 );
+
+	__asm__ __volatile__ ( "movdqu (%[src]), %%xmm0\n\t"
+			       "movdqu (%[key]), %%xmm1\n\t"
+			       "pxor %%xmm1, %%xmm0\n\t"
+			       "\n1:\n\t"
+			       "add $16, %[key]\n\t"
+			       "movdqu (%[key]), %%xmm1\n\t"
+			       "aesenc %%xmm1, %%xmm0\n\t"
+			       "dec %[count]\n\t"
+			       "jnz 1b\n\t"
+			       "movdqu 16(%[key]), %%xmm1\n\t"
+			       "aesenclast %%xmm1, %%xmm0\n\t"
+			       "movdqu %%xmm0, (%[dst])\n\t"
+			       : [key] "+r" ( key ), [count] "+r" ( count )
+			       : [src] "r" ( src ), [dst] "r" ( dst )
+			       : "xmm0", "xmm1", "memory", "cc" );
+}
+
+/**
+ * Decrypt block using AES-NI
+ *
+ * @v aes		AES context
+ * @v src		Data to decrypt
+ * @v dst		Buffer for decrypted data
+ */
+void __attribute__ (( target ( "sse2,aes" ) ))
+aesni_decrypt ( const struct aes_context *aes, const void *src, void *dst ) {
+	const union aes_matrix *key = &aes->decrypt.key[0];
+	unsigned int count = ( aes->rounds - 2 );
+
+	__asm__ __volatile__ ( "movdqu (%[src]), %%xmm0\n\t"
+			       "movdqu (%[key]), %%xmm1\n\t"
+			       "pxor %%xmm1, %%xmm0\n\t"
+			       "\n1:\n\t"
+			       "add $16, %[key]\n\t"
+			       "movdqu (%[key]), %%xmm1\n\t"
+			       "aesdec %%xmm1, %%xmm0\n\t"
+			       "dec %[count]\n\t"
+			       "jnz 1b\n\t"
+			       "movdqu 16(%[key]), %%xmm1\n\t"
+			       "aesdeclast %%xmm1, %%xmm0\n\t"
+			       "movdqu %%xmm0, (%[dst])\n\t"
+			       : [key] "+r" ( key ), [count] "+r" ( count )
+			       : [src] "r" ( src ), [dst] "r" ( dst )
+			       : "xmm0", "xmm1", "memory", "cc" );
+}
+
+/**
+ * Multiply accumulated hash by hash key using PCLMULQDQ
+ *
+ * @v key		Hash key (H)
+ * @v hash		Accumulated hash (X)
+ *
+ * This is the carry-less multiplication and reduction sequence
+ * described in Intel's "Carry-Less Multiplication Instruction and its
+ * Usage for Computing the GCM Mode" white paper, operating on
+ * byte-reversed copies of the big-endian GCM blocks.
+ */
+void __attribute__ (( target ( "sse2,ssse3,pclmul" ) ))
+pclmul_gcm_multiply ( const union gcm_block *key, union gcm_block *hash ) {
+
+	__asm__ __volatile__ ( /* Load byte-reversed X and H */
+			       "movdqu (%[bswap]), %%xmm2\n\t"
+			       "movdqu (%[hash]), %%xmm0\n\t"
+			       "pshufb %%xmm2, %%xmm0\n\t"
+			       "movdqu (%[key]), %%xmm1\n\t"
+			       "pshufb %%xmm2, %%xmm1\n\t"
+			       /* Calculate 256-bit product in %xmm0:%xmm3 */
+			       "movdqa %%xmm0, %%xmm3\n\t"
+			       "pclmulqdq $0x00, %%xmm1, %%xmm3\n\t"
+			       "movdqa %%xmm0, %%xmm4\n\t"
+			       "pclmulqdq $0x10, %%xmm1, %%xmm4\n\t"
+			       "movdqa %%xmm0, %%xmm5\n\t"
+			       "pclmulqdq $0x01, %%xmm1, %%xmm5\n\t"
+			       "pclmulqdq $0x11, %%xmm1, %%xmm0\n\t"
+			       "pxor %%xmm5, %%xmm4\n\t"
+			       "movdqa %%xmm4, %%xmm5\n\t"
+			       "pslldq $8, %%xmm5\n\t"
+			       "psrldq $8, %%xmm4\n\t"
+			       "pxor %%xmm5, %%xmm3\n\t"
+			       "pxor %%xmm4, %%xmm0\n\t"
+			       /* Shift product left by one bit */
+			       "movdqa %%xmm3, %%xmm4\n\t"
+			       "psrld $31, %%xmm4\n\t"
+			       "movdqa %%xmm0, %%xmm5\n\t"
+			       "psrld $31, %%xmm5\n\t"
+			       "pslld $1, %%xmm3\n\t"
+			       "pslld $1, %%xmm0\n\t"
+			       "movdqa %%xmm4, %%xmm1\n\t"
+			       "psrldq $12, %%xmm1\n\t"
+			       "pslldq $4, %%xmm5\n\t"
+			       "pslldq $4, %%xmm4\n\t"
+			       "por %%xmm4, %%xmm3\n\t"
+			       "por %%xmm5, %%xmm0\n\t"
+			       "por %%xmm1, %%xmm0\n\t"
+			       /* Reduce modulo x^128 + x^7 + x^2 + x + 1 */
+			       "movdqa %%xmm3, %%xmm4\n\t"
+			       "pslld $31, %%xmm4\n\t"
+			       "movdqa %%xmm3, %%xmm5\n\t"
+			       "pslld $30, %%xmm5\n\t"
+			       "movdqa %%xmm3, %%xmm1\n\t"
+			       "pslld $25, %%xmm1\n\t"
+			       "pxor %%xmm5, %%xmm4\n\t"
+			       "pxor %%xmm1, %%xmm4\n\t"
+			       "movdqa %%xmm4, %%xmm5\n\t"
+			       "psrldq $4, %%xmm5\n\t"
+			       "pslldq $12, %%xmm4\n\t"
+			       "pxor %%xmm4, %%xmm3\n\t"
+			       "movdqa %%xmm3, %%xmm2\n\t"
+			       "psrld $1, %%xmm2\n\t"
+			       "movdqa %%xmm3, %%xmm4\n\t"
+			       "psrld $2, %%xmm4\n\t"
+			       "movdqa %%xmm3, %%xmm1\n\t"
+			       "psrld $7, %%xmm1\n\t"
+			       "pxor %%xmm4, %%xmm2\n\t"
+			       "pxor %%xmm1, %%xmm2\n\t"
+			       "pxor %%xmm5, %%xmm2\n\t"
+			       "pxor %%xmm2, %%xmm3\n\t"
+			       "pxor %%xmm3, %%xmm0\n\t"
+			       /* Store byte-reversed result */
+			       "movdqu (%[bswap]), %%xmm2\n\t"
+			       "pshufb %%xmm2, %%xmm0\n\t"
+			       "movdqu %%xmm0, (%[hash])\n\t"
+			       :
+			       : [key] "r" ( key ), [hash] "r" ( hash ),
+				 [bswap] "r" ( pclmul_bswap )
+			       : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5",
+				 "memory" );
+}
+
+/**
+ * Detect AES-NI and PCLMULQDQ support
+ *
+ */
+static void x86_aes_init ( void ) {
+	struct x86_features features;
+	uint32_t ecx;
+
+	/* Check for SSE2 support */
+	x86_features ( &features );
+	ecx = features.intel.ecx;
+	if ( ! ( features.intel.edx & CPUID_FEATURES_INTEL_EDX_SSE2 ) ) {
+		DBGC ( &aesni_enabled, "AESNI CPU does not support SSE2\n" );
+		return;
+	}
+	if ( ! x86_sse_usable() ) {
+		DBGC ( &aesni_enabled, "AESNI SSE is not enabled\n" );
+		return;
+	}
+
+	/* Enable AES-NI, if supported */
+	if ( ecx & CPUID_FEATURES_INTEL_ECX_AES ) {
+		DBGC ( &aesni_enabled, "AESNI using AES-NI instructions\n" );
+		aesni_enabled = 1;
+	}
+
+	/* Enable PCLMULQDQ, if supported */
+	if ( ( ecx & CPUID_FEATURES_INTEL_ECX_PCLMULQDQ ) &&
+	     ( ecx & CPUID_FEATURES_INTEL_ECX_SSSE3 ) ) {
+		DBGC ( &aesni_enabled, "AESNI using PCLMULQDQ for GHASH\n" );
+		pclmul_enabled = 1;
+	}
+}
+
+/** AES-NI and PCLMULQDQ detection initialisation function */
+struct init_fn x86_aes_init_fn __init_fn ( INIT_EARLY ) = {
+	.initialise = x86_aes_init,
+};
@@ -93,3 +93,47 @@ void bigint_multiply_raw ( const uint32_t *multiplicand0,
 		}
 	}
 }
+
+/**
+ * Multiply big integer by a single element and accumulate
+ *
+ * @v multiplicand0	Element 0 of big integer to be multiplied
+ * @v multiplier	Element to multiply by
+ * @v value0		Element 0 of big integer to be added to
+ * @v size		Number of elements
+ * @ret carry		Carry out of most significant element
+ */
+uint32_t bigint_multiply_accumulate_raw ( const uint32_t *multiplicand0,
+					  uint32_t multiplier,
+					  uint32_t *value0,
+					  unsigned int size ) {
+	const bigint_t ( size ) __attribute__ (( may_alias )) *multiplicand =
+		( ( const void * ) multiplicand0 );
+	bigint_t ( size ) __attribute__ (( may_alias )) *value =
+		( ( void * ) value0 );
+	uint32_t carry = 0;
+	uint32_t discard_a;
+	unsigned int i;
+
+	for ( i = 0 ; i < size ; i++ ) {
+		/* Multiply, then add in the existing element and the
+		 * carry from the previous element.  The new carry
+		 * can never overflow a single element, since:
+		 *
+		 *     a, b, c, d < 2^{n} => ab + c + d < 2^{2n}
+		 */
+		__asm__ __volatile__ ( "mull %4\n\t"
+				       "addl %5, %%eax\n\t"
+				       "adcl $0, %%edx\n\t"
+				       "addl %%eax, %0\n\t"
+				       "adcl $0, %%edx\n\t"
+				       : "+m" ( value->element[i] ),
+					 "=&a" ( discard_a ),
+					 "=&d" ( carry )
+				       : "1" ( multiplicand->element[i] ),
+					 "rm" ( multiplier ),
+					 "r" ( carry ) );
+	}
+
+	return carry;
+}
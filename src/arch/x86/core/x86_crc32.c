@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * x86 CRC32 and CRC32C acceleration
+ *
+ * CRC32 is calculated using carry-less multiplication (PCLMULQDQ) to
+ * fold 64 bytes at a time, as described in Intel's "Fast CRC
+ * Computation for Generic Polynomials Using PCLMULQDQ Instruction"
+ * white paper, followed by a Barrett reduction to 32 bits.  Only the
+ * caller-saved registers %xmm0-%xmm5 are used.
+ *
+ * CRC32C is calculated using the SSE4.2 CRC32 instruction, which
+ * operates only on general-purpose registers.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <ipxe/cpuid.h>
+#include <ipxe/init.h>
+#include <ipxe/crc32.h>
+
+/** Usable CRC acceleration features */
+unsigned int x86_crc32_accel;
+
+/** Folding constants x^(4*128+32) mod P and x^(4*128-32) mod P */
+static const uint64_t x86_crc32_k1k2[2] = {
+	0x0000000154442bd4ULL, 0x00000001c6e41596ULL
+};
+
+/** Folding constants x^(128+32) mod P and x^(128-32) mod P */
+static const uint64_t x86_crc32_k3k4[2] = {
+	0x00000001751997d0ULL, 0x00000000ccaa009eULL
+};
+
+/** Folding constant x^64 mod P */
+static const uint64_t x86_crc32_k5[2] = {
+	0x0000000163cd6124ULL, 0
+};
+
+/** Barrett reduction constants P and floor(x^64/P) */
+static const uint64_t x86_crc32_poly[2] = {
+	0x00000001db710641ULL, 0x00000001f7011641ULL
+};
+
+/** Low 32-bit mask */
+static const uint64_t x86_crc32_mask32[2] = {
+	0x00000000ffffffffULL, 0
+};
+
+/**
+ * Calculate CRC32 using PCLMULQDQ
+ *
+ * @v crc		CRC to update
+ * @v data		Data to checksum
+ * @v len		Length of data
+ * @ret done		Length of data processed
+ *
+ * Data is processed in multiples of 16 bytes, with a minimum of 64
+ * bytes.  Any remaining data must be processed by the caller.
+ */
+size_t __attribute__ (( target ( "sse4.1,pclmul" ) ))
+x86_crc32_pclmul ( uint32_t *crc, const void *data, size_t len ) {
+	uint32_t value = *crc;
+	size_t done;
+	size_t remaining;
+
+	/* Do nothing unless there is enough data to fold */
+	if ( len < 64 )
+		return 0;
+	done = ( len & ~( ( size_t ) 15 ) );
+	remaining = done;
+
+	__asm__ __volatile__ ( /* Load first 64 bytes and initial CRC */
+			       "movdqu 0x00(%[data]), %%xmm1\n\t"
+			       "movdqu 0x10(%[data]), %%xmm2\n\t"
+			       "movdqu 0x20(%[data]), %%xmm3\n\t"
+			       "movdqu 0x30(%[data]), %%xmm4\n\t"
+			       "movd %[crc], %%xmm0\n\t"
+			       "pxor %%xmm0, %%xmm1\n\t"
+			       "sub $0x40, %[remaining]\n\t"
+			       "add $0x40, %[data]\n\t"
+			       "cmp $0x40, %[remaining]\n\t"
+			       "jb 2f\n\t"
+			       /* Fold 64 bytes at a time */
+			       "movdqu %[k1k2], %%xmm0\n\t"
+			       "\n1:\n\t"
+			       "movdqa %%xmm1, %%xmm5\n\t"
+			       "pclmulqdq $0x00, %%xmm0, %%xmm1\n\t"
+			       "pclmulqdq $0x11, %%xmm0, %%xmm5\n\t"
+			       "pxor %%xmm5, %%xmm1\n\t"
+			       "movdqu 0x00(%[data]), %%xmm5\n\t"
+			       "pxor %%xmm5, %%xmm1\n\t"
+			       "movdqa %%xmm2, %%xmm5\n\t"
+			       "pclmulqdq $0x00, %%xmm0, %%xmm2\n\t"
+			       "pclmulqdq $0x11, %%xmm0, %%xmm5\n\t"
+			       "pxor %%xmm5, %%xmm2\n\t"
+			       "movdqu 0x10(%[data]), %%xmm5\n\t"
+			       "pxor %%xmm5, %%xmm2\n\t"
+			       "movdqa %%xmm3, %%xmm5\n\t"
+			       "pclmulqdq $0x00, %%xmm0, %%xmm3\n\t"
+			       "pclmulqdq $0x11, %%xmm0, %%xmm5\n\t"
+			       "pxor %%xmm5, %%xmm3\n\t"
+			       "movdqu 0x20(%[data]), %%xmm5\n\t"
+			       "pxor %%xmm5, %%xmm3\n\t"
+			       "movdqa %%xmm4, %%xmm5\n\t"
+			       "pclmulqdq $0x00, %%xmm0, %%xmm4\n\t"
+			       "pclmulqdq $0x11, %%xmm0, %%xmm5\n\t"
+			       "pxor %%xmm5, %%xmm4\n\t"
+			       "movdqu 0x30(%[data]), %%xmm5\n\t"
+			       "pxor %%xmm5, %%xmm4\n\t"
+			       "sub $0x40, %[remaining]\n\t"
+			       "add $0x40, %[data]\n\t"
+			       "cmp $0x40, %[remaining]\n\t"
+			       "jae 1b\n\t"
+			       /* Fold 64 bytes down to 16 bytes */
+			       "\n2:\n\t"
+			       "movdqu %[k3k4], %%xmm0\n\t"
+			       "movdqa %%xmm1, %%xmm5\n\t"
+			       "pclmulqdq $0x00, %%xmm0, %%xmm1\n\t"
+			       "pclmulqdq $0x11, %%xmm0, %%xmm5\n\t"
+			       "pxor %%xmm5, %%xmm1\n\t"
+			       "pxor %%xmm2, %%xmm1\n\t"
+			       "movdqa %%xmm1, %%xmm5\n\t"
+			       "pclmulqdq $0x00, %%xmm0, %%xmm1\n\t"
+			       "pclmulqdq $0x11, %%xmm0, %%xmm5\n\t"
+			       "pxor %%xmm5, %%xmm1\n\t"
+			       "pxor %%xmm3, %%xmm1\n\t"
+			       "movdqa %%xmm1, %%xmm5\n\t"
+			       "pclmulqdq $0x00, %%xmm0, %%xmm1\n\t"
+			       "pclmulqdq $0x11, %%xmm0, %%xmm5\n\t"
+			       "pxor %%xmm5, %%xmm1\n\t"
+			       "pxor %%xmm4, %%xmm1\n\t"
+			       /* Fold remaining data 16 bytes at a time */
+			       "cmp $0x10, %[remaining]\n\t"
+			       "jb 4f\n\t"
+			       "\n3:\n\t"
+			       "movdqa %%xmm1, %%xmm5\n\t"
+			       "pclmulqdq $0x00, %%xmm0, %%xmm1\n\t"
+			       "pclmulqdq $0x11, %%xmm0, %%xmm5\n\t"
+			       "pxor %%xmm5, %%xmm1\n\t"
+			       "movdqu 0x00(%[data]), %%xmm5\n\t"
+			       "pxor %%xmm5, %%xmm1\n\t"
+			       "sub $0x10, %[remaining]\n\t"
+			       "add $0x10, %[data]\n\t"
+			       "cmp $0x10, %[remaining]\n\t"
+			       "jae 3b\n\t"
+			       /* Fold 128 bits down to 64 bits */
+			       "\n4:\n\t"
+			       "pclmulqdq $0x01, %%xmm1, %%xmm0\n\t"
+			       "psrldq $0x08, %%xmm1\n\t"
+			       "pxor %%xmm0, %%xmm1\n\t"
+			       /* Fold 64 bits down to 32 bits */
+			       "movdqa %%xmm1, %%xmm2\n\t"
+			       "movdqu %[k5], %%xmm0\n\t"
+			       "movdqu %[mask32], %%xmm3\n\t"
+			       "psrldq $0x04, %%xmm2\n\t"
+			       "pand %%xmm3, %%xmm1\n\t"
+			       "pclmulqdq $0x00, %%xmm0, %%xmm1\n\t"
+			       "pxor %%xmm2, %%xmm1\n\t"
+			       /* Barrett reduction to 32 bits */
+			       "movdqu %[poly], %%xmm0\n\t"
+			       "movdqa %%xmm1, %%xmm2\n\t"
+			       "pand %%xmm3, %%xmm1\n\t"
+			       "pclmulqdq $0x10, %%xmm0, %%xmm1\n\t"
+			       "pand %%xmm3, %%xmm1\n\t"
+			       "pclmulqdq $0x00, %%xmm0, %%xmm1\n\t"
+			       "pxor %%xmm2, %%xmm1\n\t"
+			       "pextrd $0x01, %%xmm1, %[crc]\n\t"
+			       : [crc] "+r" ( value ), [data] "+r" ( data ),
+				 [remaining] "+r" ( remaining )
+			       : [k1k2] "m" ( x86_crc32_k1k2 ),
+				 [k3k4] "m" ( x86_crc32_k3k4 ),
+				 [k5] "m" ( x86_crc32_k5 ),
+				 [poly] "m" ( x86_crc32_poly ),
+				 [mask32] "m" ( x86_crc32_mask32 )
+			       : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5",
+				 "memory", "cc" );
+
+	*crc = value;
+	return done;
+}
+
+/**
+ * Calculate CRC32C using the SSE4.2 CRC32 instruction
+ *
+ * @v crc		CRC to update
+ * @v data		Data to checksum
+ * @v len		Length of data
+ * @ret done		Length of data processed
+ */
+size_t x86_crc32c_sse42 ( uint32_t *crc, const void *data, size_t len ) {
+	const uint8_t *byte = data;
+	unsigned long value = *crc;
+	unsigned long word;
+	size_t remaining = len;
+
+	/* Process a native word at a time */
+	while ( remaining >= sizeof ( word ) ) {
+		memcpy ( &word, byte, sizeof ( word ) );
+		__asm__ ( "crc32 %1, %0" : "+r" ( value ) : "r" ( word ) );
+		byte += sizeof ( word );
+		remaining -= sizeof ( word );
+	}
+
+	/* Process any remaining bytes */
+	while ( remaining-- ) {
+		__asm__ ( "crc32b %1, %k0"
+			  : "+r" ( value ) : "q" ( *(byte++) ) );
+	}
+
+	*crc = value;
+	return len;
+}
+
+/**
+ * Detect CRC acceleration support
+ *
+ */
+static void x86_crc32_init ( void ) {
+	struct x86_features features;
+
+	/* Check for SSE4.2 CRC32 instruction */
+	x86_features ( &features );
+	if ( features.intel.ecx & CPUID_FEATURES_INTEL_ECX_SSE4_2 ) {
+		DBGC ( &x86_crc32_accel, "CRC32 using SSE4.2 for CRC32C\n" );
+		x86_crc32_accel |= X86_CRC32_SSE42;
+	}
+
+	/* Check for PCLMULQDQ instruction */
+	if ( ! ( ( features.intel.edx & CPUID_FEATURES_INTEL_EDX_SSE2 ) &&
+		 ( features.intel.ecx & CPUID_FEATURES_INTEL_ECX_SSE4_1 ) &&
+		 ( features.intel.ecx &
+		   CPUID_FEATURES_INTEL_ECX_PCLMULQDQ ) ) ) {
+		DBGC ( &x86_crc32_accel, "CRC32 CPU does not support "
+		       "PCLMULQDQ\n" );
+		return;
+	}
+	if ( ! x86_sse_usable() ) {
+		DBGC ( &x86_crc32_accel, "CRC32 SSE is not enabled\n" );
+		return;
+	}
+	DBGC ( &x86_crc32_accel, "CRC32 using PCLMULQDQ for CRC32\n" );
+	x86_crc32_accel |= X86_CRC32_PCLMUL;
+}
+
+/** CRC acceleration detection initialisation function */
+struct init_fn x86_crc32_init_fn __init_fn ( INIT_EARLY ) = {
+	.initialise = x86_crc32_init,
+};
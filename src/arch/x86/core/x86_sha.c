@@ -0,0 +1,497 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * x86 SHA extensions acceleration
+ *
+ * The instruction sequences follow those given in Intel's "Intel SHA
+ * Extensions" white paper.  All eight registers %xmm0-%xmm7 are
+ * required.  Since iPXE is built without SSE support, the compiler
+ * will not preserve %xmm6 and %xmm7 on our behalf when we are called
+ * via the UEFI x64 calling convention, and so we preserve them
+ * explicitly.
+ *
+ */
+
+#include <stdint.h>
+#include <ipxe/cpuid.h>
+#include <ipxe/init.h>
+#include <ipxe/sha1.h>
+#include <ipxe/sha256.h>
+
+/** SHA extensions are usable */
+int shani_enabled;
+
+/** Byte-reversal mask for PSHUFB (used for SHA-1) */
+static const uint8_t shani_bswap128[16] = {
+	15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0
+};
+
+/** Per-dword byte-reversal mask for PSHUFB (used for SHA-256) */
+static const uint8_t shani_bswap32[16] = {
+	3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+};
+
+/**
+ * Calculate SHA-1 digest of one block using SHA extensions
+ *
+ * @v digest		Digest (big-endian)
+ * @v data		Data block
+ */
+void __attribute__ (( target ( "sse4.1,sha" ) ))
+shani_sha1_digest ( struct sha1_digest *digest, const union sha1_block *data ) {
+	uint8_t save[32];
+
+	__asm__ __volatile__ ( /* Preserve %xmm6 and %xmm7 */
+			       "movdqu %%xmm6, 0(%[save])\n\t"
+			       "movdqu %%xmm7, 16(%[save])\n\t"
+			       /* Load ABCD and E */
+			       "movdqu (%[bswap]), %%xmm7\n\t"
+			       "movdqu 0(%[digest]), %%xmm1\n\t"
+			       "pshufb %%xmm7, %%xmm1\n\t"
+			       "movd 16(%[digest]), %%xmm2\n\t"
+			       "pshufb %%xmm7, %%xmm2\n\t"
+			       /* Rounds 0-3 */
+			       "movdqu 0(%[data]), %%xmm3\n\t"
+			       "pshufb %%xmm7, %%xmm3\n\t"
+			       "paddd %%xmm3, %%xmm2\n\t"
+			       "movdqa %%xmm1, %%xmm0\n\t"
+			       "sha1rnds4 $0, %%xmm2, %%xmm1\n\t"
+			       /* Rounds 4-7 */
+			       "movdqu 16(%[data]), %%xmm4\n\t"
+			       "pshufb %%xmm7, %%xmm4\n\t"
+			       "sha1nexte %%xmm4, %%xmm0\n\t"
+			       "movdqa %%xmm1, %%xmm2\n\t"
+			       "sha1rnds4 $0, %%xmm0, %%xmm1\n\t"
+			       "sha1msg1 %%xmm4, %%xmm3\n\t"
+			       /* Rounds 8-11 */
+			       "movdqu 32(%[data]), %%xmm5\n\t"
+			       "pshufb %%xmm7, %%xmm5\n\t"
+			       "sha1nexte %%xmm5, %%xmm2\n\t"
+			       "movdqa %%xmm1, %%xmm0\n\t"
+			       "sha1rnds4 $0, %%xmm2, %%xmm1\n\t"
+			       "sha1msg1 %%xmm5, %%xmm4\n\t"
+			       "pxor %%xmm5, %%xmm3\n\t"
+			       /* Rounds 12-15 */
+			       "movdqu 48(%[data]), %%xmm6\n\t"
+			       "pshufb %%xmm7, %%xmm6\n\t"
+			       "sha1nexte %%xmm6, %%xmm0\n\t"
+			       "movdqa %%xmm1, %%xmm2\n\t"
+			       "sha1msg2 %%xmm6, %%xmm3\n\t"
+			       "sha1rnds4 $0, %%xmm0, %%xmm1\n\t"
+			       "sha1msg1 %%xmm6, %%xmm5\n\t"
+			       "pxor %%xmm6, %%xmm4\n\t"
+			       /* Rounds 16-19 */
+			       "sha1nexte %%xmm3, %%xmm2\n\t"
+			       "movdqa %%xmm1, %%xmm0\n\t"
+			       "sha1msg2 %%xmm3, %%xmm4\n\t"
+			       "sha1rnds4 $0, %%xmm2, %%xmm1\n\t"
+			       "sha1msg1 %%xmm3, %%xmm6\n\t"
+			       "pxor %%xmm3, %%xmm5\n\t"
+			       /* Rounds 20-23 */
+			       "sha1nexte %%xmm4, %%xmm0\n\t"
+			       "movdqa %%xmm1, %%xmm2\n\t"
+			       "sha1msg2 %%xmm4, %%xmm5\n\t"
+			       "sha1rnds4 $1, %%xmm0, %%xmm1\n\t"
+			       "sha1msg1 %%xmm4, %%xmm3\n\t"
+			       "pxor %%xmm4, %%xmm6\n\t"
+			       /* Rounds 24-27 */
+			       "sha1nexte %%xmm5, %%xmm2\n\t"
+			       "movdqa %%xmm1, %%xmm0\n\t"
+			       "sha1msg2 %%xmm5, %%xmm6\n\t"
+			       "sha1rnds4 $1, %%xmm2, %%xmm1\n\t"
+			       "sha1msg1 %%xmm5, %%xmm4\n\t"
+			       "pxor %%xmm5, %%xmm3\n\t"
+			       /* Rounds 28-31 */
+			       "sha1nexte %%xmm6, %%xmm0\n\t"
+			       "movdqa %%xmm1, %%xmm2\n\t"
+			       "sha1msg2 %%xmm6, %%xmm3\n\t"
+			       "sha1rnds4 $1, %%xmm0, %%xmm1\n\t"
+			       "sha1msg1 %%xmm6, %%xmm5\n\t"
+			       "pxor %%xmm6, %%xmm4\n\t"
+			       /* Rounds 32-35 */
+			       "sha1nexte %%xmm3, %%xmm2\n\t"
+			       "movdqa %%xmm1, %%xmm0\n\t"
+			       "sha1msg2 %%xmm3, %%xmm4\n\t"
+			       "sha1rnds4 $1, %%xmm2, %%xmm1\n\t"
+			       "sha1msg1 %%xmm3, %%xmm6\n\t"
+			       "pxor %%xmm3, %%xmm5\n\t"
+			       /* Rounds 36-39 */
+			       "sha1nexte %%xmm4, %%xmm0\n\t"
+			       "movdqa %%xmm1, %%xmm2\n\t"
+			       "sha1msg2 %%xmm4, %%xmm5\n\t"
+			       "sha1rnds4 $1, %%xmm0, %%xmm1\n\t"
+			       "sha1msg1 %%xmm4, %%xmm3\n\t"
+			       "pxor %%xmm4, %%xmm6\n\t"
+			       /* Rounds 40-43 */
+			       "sha1nexte %%xmm5, %%xmm2\n\t"
+			       "movdqa %%xmm1, %%xmm0\n\t"
+			       "sha1msg2 %%xmm5, %%xmm6\n\t"
+			       "sha1rnds4 $2, %%xmm2, %%xmm1\n\t"
+			       "sha1msg1 %%xmm5, %%xmm4\n\t"
+			       "pxor %%xmm5, %%xmm3\n\t"
+			       /* Rounds 44-47 */
+			       "sha1nexte %%xmm6, %%xmm0\n\t"
+			       "movdqa %%xmm1, %%xmm2\n\t"
+			       "sha1msg2 %%xmm6, %%xmm3\n\t"
+			       "sha1rnds4 $2, %%xmm0, %%xmm1\n\t"
+			       "sha1msg1 %%xmm6, %%xmm5\n\t"
+			       "pxor %%xmm6, %%xmm4\n\t"
+			       /* Rounds 48-51 */
+			       "sha1nexte %%xmm3, %%xmm2\n\t"
+			       "movdqa %%xmm1, %%xmm0\n\t"
+			       "sha1msg2 %%xmm3, %%xmm4\n\t"
+			       "sha1rnds4 $2, %%xmm2, %%xmm1\n\t"
+			       "sha1msg1 %%xmm3, %%xmm6\n\t"
+			       "pxor %%xmm3, %%xmm5\n\t"
+			       /* Rounds 52-55 */
+			       "sha1nexte %%xmm4, %%xmm0\n\t"
+			       "movdqa %%xmm1, %%xmm2\n\t"
+			       "sha1msg2 %%xmm4, %%xmm5\n\t"
+			       "sha1rnds4 $2, %%xmm0, %%xmm1\n\t"
+			       "sha1msg1 %%xmm4, %%xmm3\n\t"
+			       "pxor %%xmm4, %%xmm6\n\t"
+			       /* Rounds 56-59 */
+			       "sha1nexte %%xmm5, %%xmm2\n\t"
+			       "movdqa %%xmm1, %%xmm0\n\t"
+			       "sha1msg2 %%xmm5, %%xmm6\n\t"
+			       "sha1rnds4 $2, %%xmm2, %%xmm1\n\t"
+			       "sha1msg1 %%xmm5, %%xmm4\n\t"
+			       "pxor %%xmm5, %%xmm3\n\t"
+			       /* Rounds 60-63 */
+			       "sha1nexte %%xmm6, %%xmm0\n\t"
+			       "movdqa %%xmm1, %%xmm2\n\t"
+			       "sha1msg2 %%xmm6, %%xmm3\n\t"
+			       "sha1rnds4 $3, %%xmm0, %%xmm1\n\t"
+			       "sha1msg1 %%xmm6, %%xmm5\n\t"
+			       "pxor %%xmm6, %%xmm4\n\t"
+			       /* Rounds 64-67 */
+			       "sha1nexte %%xmm3, %%xmm2\n\t"
+			       "movdqa %%xmm1, %%xmm0\n\t"
+			       "sha1msg2 %%xmm3, %%xmm4\n\t"
+			       "sha1rnds4 $3, %%xmm2, %%xmm1\n\t"
+			       "sha1msg1 %%xmm3, %%xmm6\n\t"
+			       "pxor %%xmm3, %%xmm5\n\t"
+			       /* Rounds 68-71 */
+			       "sha1nexte %%xmm4, %%xmm0\n\t"
+			       "movdqa %%xmm1, %%xmm2\n\t"
+			       "sha1msg2 %%xmm4, %%xmm5\n\t"
+			       "sha1rnds4 $3, %%xmm0, %%xmm1\n\t"
+			       "pxor %%xmm4, %%xmm6\n\t"
+			       /* Rounds 72-75 */
+			       "sha1nexte %%xmm5, %%xmm2\n\t"
+			       "movdqa %%xmm1, %%xmm0\n\t"
+			       "sha1msg2 %%xmm5, %%xmm6\n\t"
+			       "sha1rnds4 $3, %%xmm2, %%xmm1\n\t"
+			       /* Rounds 76-79 */
+			       "sha1nexte %%xmm6, %%xmm0\n\t"
+			       "movdqa %%xmm1, %%xmm2\n\t"
+			       "sha1rnds4 $3, %%xmm0, %%xmm1\n\t"
+			       /* Add to original digest */
+			       "movdqu 0(%[digest]), %%xmm3\n\t"
+			       "pshufb %%xmm7, %%xmm3\n\t"
+			       "paddd %%xmm3, %%xmm1\n\t"
+			       "movd 16(%[digest]), %%xmm4\n\t"
+			       "pshufb %%xmm7, %%xmm4\n\t"
+			       "sha1nexte %%xmm4, %%xmm2\n\t"
+			       /* Store ABCD and E */
+			       "pshufb %%xmm7, %%xmm1\n\t"
+			       "movdqu %%xmm1, 0(%[digest])\n\t"
+			       "pshufb %%xmm7, %%xmm2\n\t"
+			       "movd %%xmm2, 16(%[digest])\n\t"
+			       /* Restore %xmm6 and %xmm7 */
+			       "movdqu 0(%[save]), %%xmm6\n\t"
+			       "movdqu 16(%[save]), %%xmm7\n\t"
+			       :
+			       : [digest] "r" ( digest ), [data] "r" ( data ),
+				 [bswap] "r" ( shani_bswap128 ),
+				 [save] "r" ( save )
+			       : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5",
+				 "memory" );
+}
+
+/**
+ * Calculate SHA-256 digest of one block using SHA extensions
+ *
+ * @v digest		Digest (big-endian)
+ * @v data		Data block
+ * @v k			SHA-256 round constants
+ */
+void __attribute__ (( target ( "sse4.1,sha" ) ))
+shani_sha256_digest ( struct sha256_digest *digest,
+		      const union sha256_block *data, const uint32_t *k ) {
+	uint8_t save[32];
+
+	__asm__ __volatile__ ( /* Preserve %xmm6 and %xmm7 */
+			       "movdqu %%xmm6, 0(%[save])\n\t"
+			       "movdqu %%xmm7, 16(%[save])\n\t"
+			       /* Load state as ABEF and CDGH */
+			       "movdqu (%[bswap]), %%xmm7\n\t"
+			       "movdqu 0(%[digest]), %%xmm1\n\t"
+			       "pshufb %%xmm7, %%xmm1\n\t"
+			       "movdqu 16(%[digest]), %%xmm2\n\t"
+			       "pshufb %%xmm7, %%xmm2\n\t"
+			       "pshufd $0xb1, %%xmm1, %%xmm1\n\t"
+			       "pshufd $0x1b, %%xmm2, %%xmm2\n\t"
+			       "movdqa %%xmm1, %%xmm3\n\t"
+			       "palignr $8, %%xmm2, %%xmm1\n\t"
+			       "pblendw $0xf0, %%xmm3, %%xmm2\n\t"
+			       /* Rounds 0-3 */
+			       "movdqu 0(%[data]), %%xmm3\n\t"
+			       "pshufb %%xmm7, %%xmm3\n\t"
+			       "movdqu 0(%[k]), %%xmm0\n\t"
+			       "paddd %%xmm3, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm1, %%xmm2\n\t"
+			       "punpckhqdq %%xmm0, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm2, %%xmm1\n\t"
+			       /* Rounds 4-7 */
+			       "movdqu 16(%[data]), %%xmm4\n\t"
+			       "pshufb %%xmm7, %%xmm4\n\t"
+			       "movdqu 16(%[k]), %%xmm0\n\t"
+			       "paddd %%xmm4, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm1, %%xmm2\n\t"
+			       "punpckhqdq %%xmm0, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm2, %%xmm1\n\t"
+			       "sha256msg1 %%xmm4, %%xmm3\n\t"
+			       /* Rounds 8-11 */
+			       "movdqu 32(%[data]), %%xmm5\n\t"
+			       "pshufb %%xmm7, %%xmm5\n\t"
+			       "movdqu 32(%[k]), %%xmm0\n\t"
+			       "paddd %%xmm5, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm1, %%xmm2\n\t"
+			       "punpckhqdq %%xmm0, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm2, %%xmm1\n\t"
+			       "sha256msg1 %%xmm5, %%xmm4\n\t"
+			       /* Rounds 12-15 */
+			       "movdqu 48(%[data]), %%xmm6\n\t"
+			       "pshufb %%xmm7, %%xmm6\n\t"
+			       "movdqu 48(%[k]), %%xmm0\n\t"
+			       "paddd %%xmm6, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm1, %%xmm2\n\t"
+			       "movdqa %%xmm6, %%xmm7\n\t"
+			       "palignr $4, %%xmm5, %%xmm7\n\t"
+			       "paddd %%xmm7, %%xmm3\n\t"
+			       "sha256msg2 %%xmm6, %%xmm3\n\t"
+			       "punpckhqdq %%xmm0, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm2, %%xmm1\n\t"
+			       "sha256msg1 %%xmm6, %%xmm5\n\t"
+			       /* Rounds 16-19 */
+			       "movdqu 64(%[k]), %%xmm0\n\t"
+			       "paddd %%xmm3, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm1, %%xmm2\n\t"
+			       "movdqa %%xmm3, %%xmm7\n\t"
+			       "palignr $4, %%xmm6, %%xmm7\n\t"
+			       "paddd %%xmm7, %%xmm4\n\t"
+			       "sha256msg2 %%xmm3, %%xmm4\n\t"
+			       "punpckhqdq %%xmm0, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm2, %%xmm1\n\t"
+			       "sha256msg1 %%xmm3, %%xmm6\n\t"
+			       /* Rounds 20-23 */
+			       "movdqu 80(%[k]), %%xmm0\n\t"
+			       "paddd %%xmm4, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm1, %%xmm2\n\t"
+			       "movdqa %%xmm4, %%xmm7\n\t"
+			       "palignr $4, %%xmm3, %%xmm7\n\t"
+			       "paddd %%xmm7, %%xmm5\n\t"
+			       "sha256msg2 %%xmm4, %%xmm5\n\t"
+			       "punpckhqdq %%xmm0, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm2, %%xmm1\n\t"
+			       "sha256msg1 %%xmm4, %%xmm3\n\t"
+			       /* Rounds 24-27 */
+			       "movdqu 96(%[k]), %%xmm0\n\t"
+			       "paddd %%xmm5, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm1, %%xmm2\n\t"
+			       "movdqa %%xmm5, %%xmm7\n\t"
+			       "palignr $4, %%xmm4, %%xmm7\n\t"
+			       "paddd %%xmm7, %%xmm6\n\t"
+			       "sha256msg2 %%xmm5, %%xmm6\n\t"
+			       "punpckhqdq %%xmm0, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm2, %%xmm1\n\t"
+			       "sha256msg1 %%xmm5, %%xmm4\n\t"
+			       /* Rounds 28-31 */
+			       "movdqu 112(%[k]), %%xmm0\n\t"
+			       "paddd %%xmm6, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm1, %%xmm2\n\t"
+			       "movdqa %%xmm6, %%xmm7\n\t"
+			       "palignr $4, %%xmm5, %%xmm7\n\t"
+			       "paddd %%xmm7, %%xmm3\n\t"
+			       "sha256msg2 %%xmm6, %%xmm3\n\t"
+			       "punpckhqdq %%xmm0, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm2, %%xmm1\n\t"
+			       "sha256msg1 %%xmm6, %%xmm5\n\t"
+			       /* Rounds 32-35 */
+			       "movdqu 128(%[k]), %%xmm0\n\t"
+			       "paddd %%xmm3, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm1, %%xmm2\n\t"
+			       "movdqa %%xmm3, %%xmm7\n\t"
+			       "palignr $4, %%xmm6, %%xmm7\n\t"
+			       "paddd %%xmm7, %%xmm4\n\t"
+			       "sha256msg2 %%xmm3, %%xmm4\n\t"
+			       "punpckhqdq %%xmm0, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm2, %%xmm1\n\t"
+			       "sha256msg1 %%xmm3, %%xmm6\n\t"
+			       /* Rounds 36-39 */
+			       "movdqu 144(%[k]), %%xmm0\n\t"
+			       "paddd %%xmm4, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm1, %%xmm2\n\t"
+			       "movdqa %%xmm4, %%xmm7\n\t"
+			       "palignr $4, %%xmm3, %%xmm7\n\t"
+			       "paddd %%xmm7, %%xmm5\n\t"
+			       "sha256msg2 %%xmm4, %%xmm5\n\t"
+			       "punpckhqdq %%xmm0, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm2, %%xmm1\n\t"
+			       "sha256msg1 %%xmm4, %%xmm3\n\t"
+			       /* Rounds 40-43 */
+			       "movdqu 160(%[k]), %%xmm0\n\t"
+			       "paddd %%xmm5, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm1, %%xmm2\n\t"
+			       "movdqa %%xmm5, %%xmm7\n\t"
+			       "palignr $4, %%xmm4, %%xmm7\n\t"
+			       "paddd %%xmm7, %%xmm6\n\t"
+			       "sha256msg2 %%xmm5, %%xmm6\n\t"
+			       "punpckhqdq %%xmm0, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm2, %%xmm1\n\t"
+			       "sha256msg1 %%xmm5, %%xmm4\n\t"
+			       /* Rounds 44-47 */
+			       "movdqu 176(%[k]), %%xmm0\n\t"
+			       "paddd %%xmm6, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm1, %%xmm2\n\t"
+			       "movdqa %%xmm6, %%xmm7\n\t"
+			       "palignr $4, %%xmm5, %%xmm7\n\t"
+			       "paddd %%xmm7, %%xmm3\n\t"
+			       "sha256msg2 %%xmm6, %%xmm3\n\t"
+			       "punpckhqdq %%xmm0, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm2, %%xmm1\n\t"
+			       "sha256msg1 %%xmm6, %%xmm5\n\t"
+			       /* Rounds 48-51 */
+			       "movdqu 192(%[k]), %%xmm0\n\t"
+			       "paddd %%xmm3, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm1, %%xmm2\n\t"
+			       "movdqa %%xmm3, %%xmm7\n\t"
+			       "palignr $4, %%xmm6, %%xmm7\n\t"
+			       "paddd %%xmm7, %%xmm4\n\t"
+			       "sha256msg2 %%xmm3, %%xmm4\n\t"
+			       "punpckhqdq %%xmm0, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm2, %%xmm1\n\t"
+			       "sha256msg1 %%xmm3, %%xmm6\n\t"
+			       /* Rounds 52-55 */
+			       "movdqu 208(%[k]), %%xmm0\n\t"
+			       "paddd %%xmm4, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm1, %%xmm2\n\t"
+			       "movdqa %%xmm4, %%xmm7\n\t"
+			       "palignr $4, %%xmm3, %%xmm7\n\t"
+			       "paddd %%xmm7, %%xmm5\n\t"
+			       "sha256msg2 %%xmm4, %%xmm5\n\t"
+			       "punpckhqdq %%xmm0, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm2, %%xmm1\n\t"
+			       /* Rounds 56-59 */
+			       "movdqu 224(%[k]), %%xmm0\n\t"
+			       "paddd %%xmm5, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm1, %%xmm2\n\t"
+			       "movdqa %%xmm5, %%xmm7\n\t"
+			       "palignr $4, %%xmm4, %%xmm7\n\t"
+			       "paddd %%xmm7, %%xmm6\n\t"
+			       "sha256msg2 %%xmm5, %%xmm6\n\t"
+			       "punpckhqdq %%xmm0, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm2, %%xmm1\n\t"
+			       /* Rounds 60-63 */
+			       "movdqu 240(%[k]), %%xmm0\n\t"
+			       "paddd %%xmm6, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm1, %%xmm2\n\t"
+			       "punpckhqdq %%xmm0, %%xmm0\n\t"
+			       "sha256rnds2 %%xmm2, %%xmm1\n\t"
+			       /* Convert state back to ABCD and EFGH */
+			       "pshufd $0x1b, %%xmm1, %%xmm1\n\t"
+			       "pshufd $0xb1, %%xmm2, %%xmm2\n\t"
+			       "movdqa %%xmm1, %%xmm7\n\t"
+			       "pblendw $0xf0, %%xmm2, %%xmm1\n\t"
+			       "palignr $8, %%xmm7, %%xmm2\n\t"
+			       /* Add to original digest and store */
+			       "movdqu (%[bswap]), %%xmm7\n\t"
+			       "movdqu 0(%[digest]), %%xmm3\n\t"
+			       "pshufb %%xmm7, %%xmm3\n\t"
+			       "paddd %%xmm3, %%xmm1\n\t"
+			       "pshufb %%xmm7, %%xmm1\n\t"
+			       "movdqu %%xmm1, 0(%[digest])\n\t"
+			       "movdqu 16(%[digest]), %%xmm4\n\t"
+			       "pshufb %%xmm7, %%xmm4\n\t"
+			       "paddd %%xmm4, %%xmm2\n\t"
+			       "pshufb %%xmm7, %%xmm2\n\t"
+			       "movdqu %%xmm2, 16(%[digest])\n\t"
+			       /* Restore %xmm6 and %xmm7 */
+			       "movdqu 0(%[save]), %%xmm6\n\t"
+			       "movdqu 16(%[save]), %%xmm7\n\t"
+			       :
+			       : [digest] "r" ( digest ), [data] "r" ( data ),
+				 [k] "r" ( k ), [bswap] "r" ( shani_bswap32 ),
+				 [save] "r" ( save )
+			       : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5",
+				 "memory" );
+}
+
+/**
+ * Detect SHA extensions support
+ *
+ */
+static void x86_sha_init ( void ) {
+	struct x86_features features;
+	uint32_t discard_a;
+	uint32_t discard_c;
+	uint32_t discard_d;
+	uint32_t ebx;
+
+	/* Check for prerequisite SSE support */
+	x86_features ( &features );
+	if ( ! ( ( features.intel.edx & CPUID_FEATURES_INTEL_EDX_SSE2 ) &&
+		 ( features.intel.ecx & CPUID_FEATURES_INTEL_ECX_SSSE3 ) &&
+		 ( features.intel.ecx & CPUID_FEATURES_INTEL_ECX_SSE4_1 ) ) ) {
+		DBGC ( &shani_enabled, "SHANI CPU does not support SSE4.1\n" );
+		return;
+	}
+	if ( ! x86_sse_usable() ) {
+		DBGC ( &shani_enabled, "SHANI SSE is not enabled\n" );
+		return;
+	}
+
+	/* Check for SHA extensions */
+	if ( cpuid_supported ( CPUID_STRUCTURED ) != 0 )
+		return;
+	cpuid ( CPUID_STRUCTURED, 0, &discard_a, &ebx, &discard_c,
+		&discard_d );
+	if ( ! ( ebx & CPUID_STRUCTURED_EBX_SHA ) ) {
+		DBGC ( &shani_enabled, "SHANI CPU does not support SHA "
+		       "extensions\n" );
+		return;
+	}
+
+	DBGC ( &shani_enabled, "SHANI using SHA extensions\n" );
+	shani_enabled = 1;
+}
+
+/** SHA extensions detection initialisation function */
+struct init_fn x86_sha_init_fn __init_fn ( INIT_EARLY ) = {
+	.initialise = x86_sha_init,
+};
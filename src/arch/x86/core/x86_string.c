@@ -29,7 +29,21 @@
 
 FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
+#include <stdint.h>
 #include <string.h>
+#include <ipxe/init.h>
+#include <ipxe/cpuid.h>
+
+/** Minimum length for which to use a single "rep movsb"
+ *
+ * With enhanced "rep movsb" support, the microcode is able to copy
+ * in units of whole cache lines and will outperform "rep movsl" for
+ * anything other than very short copies.
+ */
+#define ERMS_MIN_LEN 128
+
+/** Enhanced "rep movsb" is usable */
+static int erms_enabled;
 
 /**
  * Copy memory area
@@ -45,6 +59,18 @@ void * __attribute__ (( noinline )) __memcpy ( void *dest, const void *src,
 	const void *esi = src;
 	int discard_ecx;
 
+	/* Use a single "rep movsb" for large copies, if the CPU
+	 * supports enhanced "rep movsb".
+	 */
+	if ( erms_enabled && ( len >= ERMS_MIN_LEN ) ) {
+		__asm__ __volatile__ ( "rep movsb"
+				       : "=&D" ( edi ), "=&S" ( esi ),
+					 "=&c" ( discard_ecx )
+				       : "0" ( edi ), "1" ( esi ), "2" ( len )
+				       : "memory" );
+		return dest;
+	}
+
 	/* We often do large dword-aligned and dword-length block
 	 * moves.  Using movsl rather than movsb speeds these up by
 	 * around 32%.
@@ -108,3 +134,67 @@ void * __memmove ( void *dest, const void *src, size_t len ) {
 		return __memcpy_reverse ( dest, src, len );
 	}
 }
+
+/**
+ * Fill memory region
+ *
+ * @v dest		Destination address
+ * @v fill		Fill pattern
+ * @v len		Length
+ * @ret dest		Destination address
+ */
+void * __attribute__ (( noinline )) __memset ( void *dest, int fill,
+					       size_t len ) {
+	void *edi = dest;
+	uint32_t eax;
+	int discard_ecx;
+
+	/* Use a single "rep stosb" for large fills, if the CPU
+	 * supports enhanced "rep movsb" (which implies enhanced "rep
+	 * stosb").  Otherwise, fill in dwords to avoid a very slow
+	 * bytewise fill of large regions (e.g. when zeroing the bss
+	 * portion of a loaded segment).
+	 */
+	eax = ( ( uint8_t ) fill );
+	if ( ! ( erms_enabled && ( len >= ERMS_MIN_LEN ) ) ) {
+		eax *= 0x01010101UL;
+		__asm__ __volatile__ ( "rep stosl"
+				       : "=&D" ( edi ), "=&c" ( discard_ecx )
+				       : "0" ( edi ), "1" ( len >> 2 ),
+					 "a" ( eax )
+				       : "memory" );
+		len &= 3;
+	}
+	__asm__ __volatile__ ( "rep stosb"
+			       : "=&D" ( edi ), "=&c" ( discard_ecx )
+			       : "0" ( edi ), "1" ( len ), "a" ( eax )
+			       : "memory" );
+	return dest;
+}
+
+/**
+ * Detect enhanced "rep movsb" support
+ *
+ */
+static void x86_string_init ( void ) {
+	uint32_t discard_a;
+	uint32_t discard_c;
+	uint32_t discard_d;
+	uint32_t ebx;
+
+	/* Check for enhanced "rep movsb" */
+	if ( cpuid_supported ( CPUID_STRUCTURED ) != 0 )
+		return;
+	cpuid ( CPUID_STRUCTURED, 0, &discard_a, &ebx, &discard_c,
+		&discard_d );
+	if ( ! ( ebx & CPUID_STRUCTURED_EBX_ERMS ) )
+		return;
+
+	DBGC ( &erms_enabled, "MEMCPY using enhanced rep movsb\n" );
+	erms_enabled = 1;
+}
+
+/** Enhanced "rep movsb" detection initialisation function */
+struct init_fn x86_string_init_fn __init_fn ( INIT_EARLY ) = {
+	.initialise = x86_string_init,
+};
@@ -27,23 +27,49 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  *
  * TCP/IP checksum
  *
+ * Large blocks of data are summed using SSE2 or AVX2 where available,
+ * with any remainder being summed by the scalar "lods;adc" loop.  The
+ * vector loops add each 32-bit dword into a 64-bit lane, and so can
+ * never overflow for any realistic data length.
+ *
+ * As with the AES-NI code, only %xmm0-%xmm5 (and the corresponding
+ * %ymm registers) are used, and SSE2 is used only if the CPU is
+ * already configured for SSE.
+ *
  */
 
 #include <limits.h>
+#include <ipxe/cpuid.h>
+#include <ipxe/init.h>
 #include <ipxe/tcpip.h>
 
+/** Block size for SSE2 checksumming loop */
+#define TCPIP_SSE2_BLOCK 32
+
+/** Minimum length for SSE2 checksumming */
+#define TCPIP_SSE2_MIN_LEN 64
+
+/** Block size for AVX2 checksumming loop */
+#define TCPIP_AVX2_BLOCK 64
+
+/** Minimum length for AVX2 checksumming */
+#define TCPIP_AVX2_MIN_LEN 256
+
+/** Usable vector instruction sets for checksumming */
+unsigned int x86_tcpip_simd;
+
 extern char x86_tcpip_loop_end[];
 
 /**
- * Calculate continued TCP/IP checkum
+ * Calculate continued TCP/IP checkum using scalar instructions
  *
  * @v partial		Checksum of already-summed data, in network byte order
  * @v data		Data buffer
  * @v len		Length of data buffer
  * @ret cksum		Updated checksum, in network byte order
  */
-uint16_t tcpip_continue_chksum ( uint16_t partial, const void *data,
-				 size_t len ) {
+static uint16_t __attribute__ (( noinline ))
+x86_tcpip_scalar_chksum ( uint16_t partial, const void *data, size_t len ) {
 	unsigned long sum = ( ( ~partial ) & 0xffff );
 	unsigned long initial_word_count;
 	unsigned long loop_count;
@@ -171,3 +197,181 @@ uint16_t tcpip_continue_chksum ( uint16_t partial, const void *data,
 
 	return ( ~sum & 0xffff );
 }
+
+/**
+ * Sum data using SSE2
+ *
+ * @v data		Data buffer
+ * @v len		Length of data buffer (a non-zero multiple of 32)
+ * @ret sum		Sum of native-endian 32-bit dwords
+ */
+static uint64_t __attribute__ (( target ( "sse2" ) ))
+x86_tcpip_sse2_sum ( const void *data, size_t len ) {
+	uint64_t sum[2];
+
+	__asm__ __volatile__ ( "pxor %%xmm0, %%xmm0\n\t"
+			       "pxor %%xmm1, %%xmm1\n\t"
+			       "pxor %%xmm5, %%xmm5\n\t"
+			       "\n1:\n\t"
+			       "movdqu (%[data]), %%xmm2\n\t"
+			       "movdqu 16(%[data]), %%xmm4\n\t"
+			       "movdqa %%xmm2, %%xmm3\n\t"
+			       "punpckldq %%xmm5, %%xmm2\n\t"
+			       "punpckhdq %%xmm5, %%xmm3\n\t"
+			       "paddq %%xmm2, %%xmm0\n\t"
+			       "paddq %%xmm3, %%xmm1\n\t"
+			       "movdqa %%xmm4, %%xmm3\n\t"
+			       "punpckldq %%xmm5, %%xmm4\n\t"
+			       "punpckhdq %%xmm5, %%xmm3\n\t"
+			       "paddq %%xmm4, %%xmm0\n\t"
+			       "paddq %%xmm3, %%xmm1\n\t"
+			       "add $32, %[data]\n\t"
+			       "sub $32, %[len]\n\t"
+			       "jnz 1b\n\t"
+			       "paddq %%xmm1, %%xmm0\n\t"
+			       "movdqu %%xmm0, (%[sum])\n\t"
+			       : [data] "+r" ( data ), [len] "+r" ( len )
+			       : [sum] "r" ( sum )
+			       : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5",
+				 "memory", "cc" );
+
+	return ( sum[0] + sum[1] );
+}
+
+/**
+ * Sum data using AVX2
+ *
+ * @v data		Data buffer
+ * @v len		Length of data buffer (a non-zero multiple of 64)
+ * @ret sum		Sum of native-endian 32-bit dwords
+ */
+static uint64_t __attribute__ (( target ( "avx2" ) ))
+x86_tcpip_avx2_sum ( const void *data, size_t len ) {
+	uint64_t sum[2];
+
+	__asm__ __volatile__ ( "vpxor %%ymm0, %%ymm0, %%ymm0\n\t"
+			       "vpxor %%ymm1, %%ymm1, %%ymm1\n\t"
+			       "vpxor %%ymm5, %%ymm5, %%ymm5\n\t"
+			       "\n1:\n\t"
+			       "vmovdqu (%[data]), %%ymm2\n\t"
+			       "vmovdqu 32(%[data]), %%ymm4\n\t"
+			       "vpunpckhdq %%ymm5, %%ymm2, %%ymm3\n\t"
+			       "vpunpckldq %%ymm5, %%ymm2, %%ymm2\n\t"
+			       "vpaddq %%ymm2, %%ymm0, %%ymm0\n\t"
+			       "vpaddq %%ymm3, %%ymm1, %%ymm1\n\t"
+			       "vpunpckhdq %%ymm5, %%ymm4, %%ymm3\n\t"
+			       "vpunpckldq %%ymm5, %%ymm4, %%ymm4\n\t"
+			       "vpaddq %%ymm4, %%ymm0, %%ymm0\n\t"
+			       "vpaddq %%ymm3, %%ymm1, %%ymm1\n\t"
+			       "add $64, %[data]\n\t"
+			       "sub $64, %[len]\n\t"
+			       "jnz 1b\n\t"
+			       "vpaddq %%ymm1, %%ymm0, %%ymm0\n\t"
+			       "vextracti128 $1, %%ymm0, %%xmm1\n\t"
+			       "vpaddq %%xmm1, %%xmm0, %%xmm0\n\t"
+			       "vmovdqu %%xmm0, (%[sum])\n\t"
+			       "vzeroupper\n\t"
+			       : [data] "+r" ( data ), [len] "+r" ( len )
+			       : [sum] "r" ( sum )
+			       : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5",
+				 "memory", "cc" );
+
+	return ( sum[0] + sum[1] );
+}
+
+/**
+ * Calculate continued TCP/IP checkum
+ *
+ * @v partial		Checksum of already-summed data, in network byte order
+ * @v data		Data buffer
+ * @v len		Length of data buffer
+ * @ret cksum		Updated checksum, in network byte order
+ */
+uint16_t tcpip_continue_chksum ( uint16_t partial, const void *data,
+				 size_t len ) {
+	uint64_t sum;
+	size_t bulk;
+
+	/* Sum as many whole blocks as possible using vector instructions */
+	if ( ( x86_tcpip_simd & X86_TCPIP_AVX2 ) &&
+	     ( len >= TCPIP_AVX2_MIN_LEN ) ) {
+		bulk = ( len & ~( TCPIP_AVX2_BLOCK - 1 ) );
+		sum = x86_tcpip_avx2_sum ( data, bulk );
+	} else if ( ( x86_tcpip_simd & X86_TCPIP_SSE2 ) &&
+		    ( len >= TCPIP_SSE2_MIN_LEN ) ) {
+		bulk = ( len & ~( TCPIP_SSE2_BLOCK - 1 ) );
+		sum = x86_tcpip_sse2_sum ( data, bulk );
+	} else {
+		return x86_tcpip_scalar_chksum ( partial, data, len );
+	}
+
+	/* Fold down to a uint16_t, including the partial checksum */
+	sum += ( ( ~partial ) & 0xffff );
+	sum = ( ( sum & 0xffffffffUL ) + ( sum >> 32 ) );
+	sum = ( ( sum & 0xffffffffUL ) + ( sum >> 32 ) );
+	sum = ( ( sum & 0xffff ) + ( sum >> 16 ) );
+	sum = ( ( sum & 0xffff ) + ( sum >> 16 ) );
+	sum = ( ( sum & 0xffff ) + ( sum >> 16 ) );
+	partial = ( ~sum & 0xffff );
+
+	/* Sum any remaining data using scalar instructions */
+	return x86_tcpip_scalar_chksum ( partial, ( data + bulk ),
+					 ( len - bulk ) );
+}
+
+/**
+ * Detect vector instruction support for checksumming
+ *
+ */
+static void x86_tcpip_init ( void ) {
+	struct x86_features features;
+	uint32_t discard_a;
+	uint32_t discard_c;
+	uint32_t discard_d;
+	uint32_t xcr0_lo;
+	uint32_t xcr0_hi;
+	uint32_t ebx;
+
+	/* Check for SSE2 support */
+	x86_features ( &features );
+	if ( ! ( features.intel.edx & CPUID_FEATURES_INTEL_EDX_SSE2 ) ) {
+		DBGC ( &x86_tcpip_simd, "TCPIP CPU does not support SSE2\n" );
+		return;
+	}
+	if ( ! x86_sse_usable() ) {
+		DBGC ( &x86_tcpip_simd, "TCPIP SSE is not enabled\n" );
+		return;
+	}
+	DBGC ( &x86_tcpip_simd, "TCPIP using SSE2 checksumming\n" );
+	x86_tcpip_simd |= X86_TCPIP_SSE2;
+
+	/* Check for AVX support enabled by the OS */
+	if ( ( features.intel.ecx &
+	       ( CPUID_FEATURES_INTEL_ECX_OSXSAVE |
+		 CPUID_FEATURES_INTEL_ECX_AVX ) ) !=
+	     ( CPUID_FEATURES_INTEL_ECX_OSXSAVE |
+	       CPUID_FEATURES_INTEL_ECX_AVX ) ) {
+		return;
+	}
+	__asm__ ( "xgetbv" : "=a" ( xcr0_lo ), "=d" ( xcr0_hi ) : "c" ( 0 ) );
+	if ( ( xcr0_lo & ( XCR0_SSE | XCR0_AVX ) ) !=
+	     ( XCR0_SSE | XCR0_AVX ) ) {
+		DBGC ( &x86_tcpip_simd, "TCPIP AVX is not enabled\n" );
+		return;
+	}
+
+	/* Check for AVX2 support */
+	if ( cpuid_supported ( CPUID_STRUCTURED ) != 0 )
+		return;
+	cpuid ( CPUID_STRUCTURED, 0, &discard_a, &ebx, &discard_c,
+		&discard_d );
+	if ( ! ( ebx & CPUID_STRUCTURED_EBX_AVX2 ) )
+		return;
+	DBGC ( &x86_tcpip_simd, "TCPIP using AVX2 checksumming\n" );
+	x86_tcpip_simd |= X86_TCPIP_AVX2;
+}
+
+/** Vector checksumming detection initialisation function */
+struct init_fn x86_tcpip_init_fn __init_fn ( INIT_EARLY ) = {
+	.initialise = x86_tcpip_init,
+};
@@ -79,11 +79,17 @@ struct undi_nic {
 #define UNDI_INITIALIZE_RETRY_DELAY_MS 200
 
 /** Maximum number of received packets per poll */
-#define UNDI_RX_QUOTA 4
+#define UNDI_RX_QUOTA 16
 
 /** Alignment of received frame payload */
 #define UNDI_RX_ALIGN 16
 
+/** Maximum number of frames retrieved per PXENV_UNDI_ISR batch */
+#define UNDI_RX_BATCH 4
+
+/** Maximum length of a frame retrieved within a PXENV_UNDI_ISR batch */
+#define UNDI_RX_BATCH_MTU 1536
+
 static void undinet_close ( struct net_device *netdev );
 
 /**
@@ -104,6 +110,34 @@ static union u_PXENV_ANY __bss16 ( undinet_params );
 SEGOFF16_t __bss16 ( undinet_entry_point );
 #define undinet_entry_point __use_data16 ( undinet_entry_point )
 
+/** A frame retrieved within a PXENV_UNDI_ISR batch */
+struct undi_rx_frame {
+	/** Frame length */
+	uint16_t len;
+	/** Frame header length */
+	uint16_t header_len;
+} __attribute__ (( packed ));
+
+/** A PXENV_UNDI_ISR batch */
+struct undi_rx_batch {
+	/** Number of frames retrieved */
+	uint16_t count;
+	/** Retrieved frames */
+	struct undi_rx_frame frame[UNDI_RX_BATCH];
+	/** Retrieved frame data */
+	uint8_t data[UNDI_RX_BATCH][UNDI_RX_BATCH_MTU];
+} __attribute__ (( packed ));
+
+/**
+ * UNDI receive batch
+ *
+ * Used to hold complete frames retrieved via repeated calls to
+ * PXENV_UNDI_ISR within a single real-mode transition.  Resides in
+ * base memory.
+ */
+static struct undi_rx_batch __bss16 ( undinet_batch );
+#define undinet_batch __use_data16 ( undinet_batch )
+
 /** IRQ profiler */
 static struct profiler undinet_irq_profiler __profiler =
 	{ .name = "undinet.irq" };
@@ -112,6 +146,14 @@ static struct profiler undinet_irq_profiler __profiler =
 static struct profiler undinet_rx_profiler __profiler =
 	{ .name = "undinet.rx" };
 
+/** PXENV_UNDI_ISR batch profiler */
+static struct profiler undinet_batch_profiler __profiler =
+	{ .name = "undinet.batch" };
+
+/** Frames retrieved per batched PXENV_UNDI_ISR transition profiler */
+static struct profiler undinet_rx_batch_profiler __profiler =
+	{ .name = "undinet.rx_batch" };
+
 /** A PXE API call breakdown profiler */
 struct undinet_profiler {
 	/** Total time spent performing REAL_CALL() */
@@ -348,6 +390,122 @@ static int undinet_call ( struct undi_nic *undinic, unsigned int function,
 	return rc;
 }
 
+/**
+ * Issue batched PXENV_UNDI_ISR calls
+ *
+ * @v undinic		UNDI NIC
+ * @v undi_isr		PXENV_UNDI_ISR parameter block
+ * @ret rc		Return status code
+ *
+ * PXENV_UNDI_ISR is called repeatedly within a single real-mode
+ * transition.  Transmit completions are skipped, and complete
+ * single-fragment frames are copied into the receive batch buffer.
+ * Processing returns to protected mode upon any other result, upon
+ * an error, or when the batch buffer is full; the final result is
+ * left in the parameter block for the caller to handle as normal.
+ */
+static int undinet_isr_batch ( struct undi_nic *undinic,
+			       struct s_PXENV_UNDI_ISR *undi_isr ) {
+	PXENV_EXIT_t exit;
+	int discard_D;
+	int rc;
+
+	/* Copy parameter block */
+	memcpy ( &undinet_params, undi_isr, sizeof ( *undi_isr ) );
+
+	/* Call real-mode entry point repeatedly */
+	profile_start ( &undinet_batch_profiler );
+	__asm__ __volatile__ ( REAL_CODE (
+		"pushl %%ebp\n\t" /* gcc bug */
+		"movw $0, undinet_batch\n\t"
+		/* Issue call */
+		"\n2:\n\t"
+		"pushw %%es\n\t"
+		"pushw %%di\n\t"
+		"pushw %%bx\n\t"
+		"lcall *undinet_entry_point\n\t"
+		"addw $6, %%sp\n\t"
+		"movw %%cs:rm_ds, %%cx\n\t"
+		"movw %%cx, %%ds\n\t"
+		"movw %%cx, %%es\n\t"
+		"testw %%ax, %%ax\n\t"
+		"jnz 4f\n\t"
+		/* Skip transmit completions */
+		"movw undinet_params+%c[flag], %%ax\n\t"
+		"cmpw %[out_tx], %%ax\n\t"
+		"je 3f\n\t"
+		/* Batch complete single-fragment received frames */
+		"cmpw %[out_rx], %%ax\n\t"
+		"jne 5f\n\t"
+		"movw undinet_params+%c[buf_len], %%cx\n\t"
+		"jcxz 5f\n\t"
+		"cmpw undinet_params+%c[frame_len], %%cx\n\t"
+		"jne 5f\n\t"
+		"cmpw %[mtu], %%cx\n\t"
+		"ja 5f\n\t"
+		"movw undinet_batch, %%bx\n\t"
+		"cmpw %[batch], %%bx\n\t"
+		"jae 5f\n\t"
+		"incw undinet_batch\n\t"
+		"movw %%bx, %%si\n\t"
+		"shlw $2, %%si\n\t"
+		"movw %%cx, undinet_batch+%c[frames](%%si)\n\t"
+		"movw undinet_params+%c[hdr_len], %%ax\n\t"
+		"movw %%ax, undinet_batch+%c[frames]+2(%%si)\n\t"
+		"imulw %[mtu], %%bx, %%di\n\t"
+		"addw $undinet_batch+%c[data], %%di\n\t"
+		"lds undinet_params+%c[frame], %%si\n\t"
+		"rep movsb\n\t"
+		"pushw %%es\n\t"
+		"popw %%ds\n\t"
+		/* Request next result */
+		"\n3:\n\t"
+		"movw %[get_next], undinet_params+%c[flag]\n\t"
+		"movw %[isr], %%bx\n\t"
+		"movw $undinet_params, %%di\n\t"
+		"jmp 2b\n\t"
+		/* Leave final result for caller */
+		"\n5:\n\t"
+		"xorw %%ax, %%ax\n\t"
+		"\n4:\n\t"
+		"movw %%ax, %%bx\n\t"
+		"popl %%ebp\n\t" /* gcc bug */ )
+		: "=b" ( exit ), "=D" ( discard_D )
+		: "b" ( PXENV_UNDI_ISR ),
+		  "D" ( __from_data16 ( &undinet_params ) ),
+		  [isr] "i" ( PXENV_UNDI_ISR ),
+		  [get_next] "i" ( PXENV_UNDI_ISR_IN_GET_NEXT ),
+		  [out_tx] "i" ( PXENV_UNDI_ISR_OUT_TRANSMIT ),
+		  [out_rx] "i" ( PXENV_UNDI_ISR_OUT_RECEIVE ),
+		  [mtu] "i" ( UNDI_RX_BATCH_MTU ),
+		  [batch] "i" ( UNDI_RX_BATCH ),
+		  [flag] "i" ( offsetof ( typeof ( *undi_isr ), FuncFlag ) ),
+		  [buf_len] "i" ( offsetof ( typeof ( *undi_isr ),
+					     BufferLength ) ),
+		  [frame_len] "i" ( offsetof ( typeof ( *undi_isr ),
+					       FrameLength ) ),
+		  [hdr_len] "i" ( offsetof ( typeof ( *undi_isr ),
+					     FrameHeaderLength ) ),
+		  [frame] "i" ( offsetof ( typeof ( *undi_isr ), Frame ) ),
+		  [frames] "i" ( offsetof ( struct undi_rx_batch, frame ) ),
+		  [data] "i" ( offsetof ( struct undi_rx_batch, data ) )
+		: "eax", "ecx", "edx", "esi", "memory" );
+	profile_stop ( &undinet_batch_profiler );
+
+	/* Determine return status code */
+	rc = ( ( exit == PXENV_EXIT_SUCCESS ) ?
+	       0 : -EPXECALL ( undinet_params.Status ) );
+	if ( rc != 0 ) {
+		DBGC ( undinic, "UNDINIC %p PXENV_UNDI_ISR failed: %s\n",
+		       undinic, strerror ( rc ) );
+	}
+
+	/* Copy parameter block back */
+	memcpy ( undi_isr, &undinet_params, sizeof ( *undi_isr ) );
+
+	return rc;
+}
+
 /*****************************************************************************
  *
  * UNDI interrupt service routine
@@ -533,6 +691,47 @@ static int undinet_transmit ( struct net_device *netdev,
 	return rc;
 }
 
+/**
+ * Deliver frames retrieved within a PXENV_UNDI_ISR batch
+ *
+ * @v netdev		Network device
+ * @ret count		Number of frames retrieved
+ */
+static unsigned int undinet_rx_batch ( struct net_device *netdev ) {
+	struct undi_nic *undinic = netdev->priv;
+	struct undi_rx_frame *frame;
+	struct io_buffer *iobuf;
+	unsigned int count = undinet_batch.count;
+	unsigned int i;
+	size_t reserve_len;
+	size_t len;
+
+	for ( i = 0 ; i < count ; i++ ) {
+		profile_start ( &undinet_rx_profiler );
+		frame = &undinet_batch.frame[i];
+		len = frame->len;
+		reserve_len = ( -frame->header_len & ( UNDI_RX_ALIGN - 1 ) );
+		iobuf = alloc_iob ( reserve_len + len );
+		if ( ! iobuf ) {
+			DBGC ( undinic, "UNDINIC %p could not allocate %zd "
+			       "bytes for RX buffer\n", undinic, len );
+			netdev_rx_err ( netdev, NULL, -ENOMEM );
+			continue;
+		}
+		iob_reserve ( iobuf, reserve_len );
+		memcpy ( iob_put ( iobuf, len ), undinet_batch.data[i], len );
+		netdev_rx ( netdev, iobuf );
+		/* Etherboot 5.4 fails to return all packets under
+		 * mild load; pretend it retriggered.
+		 */
+		if ( undinic->hacks & UNDI_HACK_EB54 )
+			--last_trigger_count;
+		profile_stop ( &undinet_rx_profiler );
+	}
+
+	return count;
+}
+
 /** 
  * Poll for received packets
  *
@@ -568,6 +767,7 @@ static void undinet_poll ( struct net_device *netdev ) {
 	struct s_PXENV_UNDI_ISR undi_isr;
 	struct io_buffer *iobuf = NULL;
 	unsigned int quota = UNDI_RX_QUOTA;
+	unsigned int count;
 	size_t len;
 	size_t reserve_len;
 	size_t frag_len;
@@ -605,10 +805,23 @@ static void undinet_poll ( struct net_device *netdev ) {
 		undi_isr.FuncFlag = PXENV_UNDI_ISR_IN_GET_NEXT;
 	}
 
-	/* Run through the ISR loop */
+	/* Run through the ISR loop.  Complete frames are retrieved in
+	 * batches within a single real-mode transition where
+	 * possible; a partially received frame is continued one
+	 * fragment at a time.
+	 */
 	while ( quota ) {
-		if ( ( rc = undinet_call ( undinic, PXENV_UNDI_ISR, &undi_isr,
-					   sizeof ( undi_isr ) ) ) != 0 ) {
+		if ( iobuf ) {
+			rc = undinet_call ( undinic, PXENV_UNDI_ISR, &undi_isr,
+					    sizeof ( undi_isr ) );
+		} else {
+			rc = undinet_isr_batch ( undinic, &undi_isr );
+			count = undinet_rx_batch ( netdev );
+			profile_custom ( &undinet_rx_batch_profiler, count );
+			/* Leave quota for the final result */
+			quota = ( ( quota > count ) ? ( quota - count ) : 1 );
+		}
+		if ( rc != 0 ) {
 			netdev_rx_err ( netdev, NULL, rc );
 			break;
 		}
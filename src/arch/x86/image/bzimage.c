@@ -326,32 +326,6 @@ static void bzimage_set_cmdline ( struct image *image,
 	DBGC ( image, "bzImage %p command line \"%s\"\n", image, cmdline );
 }
 
-/**
- * Parse standalone image command line for cpio parameters
- *
- * @v image		bzImage file
- * @v cpio		CPIO header
- * @v cmdline		Command line
- */
-static void bzimage_parse_cpio_cmdline ( struct image *image,
-					 struct cpio_header *cpio,
-					 const char *cmdline ) {
-	char *arg;
-	char *end;
-	unsigned int mode;
-
-	/* Look for "mode=" */
-	if ( ( arg = strstr ( cmdline, "mode=" ) ) ) {
-		arg += 5;
-		mode = strtoul ( arg, &end, 8 /* Octal for file mode */ );
-		if ( *end && ( *end != ' ' ) ) {
-			DBGC ( image, "bzImage %p strange \"mode=\""
-			       "terminator '%c'\n", image, *end );
-		}
-		cpio_set_field ( cpio->c_mode, ( 0100000 | mode ) );
-	}
-}
-
 /**
  * Align initrd length
  *
@@ -374,8 +348,7 @@ static inline size_t bzimage_align ( size_t len ) {
 static size_t bzimage_load_initrd ( struct image *image,
 				    struct image *initrd,
 				    userptr_t address ) {
-	char *filename = initrd->cmdline;
-	char *cmdline;
+	const char *filename = cpio_name ( initrd );
 	struct cpio_header cpio;
 	size_t offset;
 	size_t name_len;
@@ -386,29 +359,20 @@ static size_t bzimage_load_initrd ( struct image *image,
 		return 0;
 
 	/* Create cpio header for non-prebuilt images */
-	if ( filename && filename[0] ) {
-		cmdline = strchr ( filename, ' ' );
-		name_len = ( ( cmdline ? ( ( size_t ) ( cmdline - filename ) )
-			       : strlen ( filename ) ) + 1 /* NUL */ );
-		memset ( &cpio, '0', sizeof ( cpio ) );
-		memcpy ( cpio.c_magic, CPIO_MAGIC, sizeof ( cpio.c_magic ) );
-		cpio_set_field ( cpio.c_mode, 0100644 );
-		cpio_set_field ( cpio.c_nlink, 1 );
-		cpio_set_field ( cpio.c_filesize, initrd->len );
-		cpio_set_field ( cpio.c_namesize, name_len );
-		if ( cmdline ) {
-			bzimage_parse_cpio_cmdline ( image, &cpio,
-						     ( cmdline + 1 /* ' ' */ ));
-		}
-		offset = ( ( sizeof ( cpio ) + name_len + 0x03 ) & ~0x03 );
+	name_len = cpio_header ( initrd, &cpio );
+	if ( name_len ) {
+		offset = ( sizeof ( cpio ) + name_len );
+		offset += cpio_pad_len ( offset );
 	} else {
 		offset = 0;
-		name_len = 0;
 	}
 
 	/* Copy in initrd image body (and cpio header if applicable) */
 	if ( address ) {
-		memmove_user ( address, offset, initrd->data, 0, initrd->len );
+		if ( userptr_add ( address, offset ) != initrd->data ) {
+			memmove_user ( address, offset, initrd->data, 0,
+				       initrd->len );
+		}
 		if ( offset ) {
 			memset_user ( address, 0, 0, offset );
 			copy_to_user ( address, 0, &cpio, sizeof ( cpio ) );
@@ -501,7 +465,6 @@ static void bzimage_load_initrds ( struct image *image,
 				   struct bzimage_context *bzimg ) {
 	struct image *initrd;
 	struct image *highest = NULL;
-	struct image *other;
 	userptr_t top;
 	userptr_t dest;
 	size_t offset;
@@ -531,23 +494,27 @@ static void bzimage_load_initrds ( struct image *image,
 	DBGC ( image, "bzImage %p loading initrds from %#08lx downwards\n",
 	       image, user_to_phys ( top, -1 ) );
 
-	/* Load initrds in order */
+	/* Calculate total length of initrds (including padding).
+	 * Each initrd is placed immediately after its predecessor, so
+	 * that the whole set ends at the highest usable address.
+	 * Calculating the total length once (rather than the length
+	 * of all following initrds for each initrd in turn) keeps the
+	 * cost linear in the number of initrds, which matters when
+	 * there are hundreds of small injected files.
+	 */
+	offset = 0;
 	for_each_image ( initrd ) {
+		offset += bzimage_load_initrd ( image, initrd, UNULL );
+		offset = bzimage_align ( offset );
+	}
 
-		/* Calculate cumulative length of following
-		 * initrds (including padding).
-		 */
-		offset = 0;
-		for_each_image ( other ) {
-			if ( other == initrd )
-				offset = 0;
-			offset += bzimage_load_initrd ( image, other, UNULL );
-			offset = bzimage_align ( offset );
-		}
+	/* Load initrds in order */
+	for_each_image ( initrd ) {
 
 		/* Load initrd at this address */
 		dest = userptr_add ( top, -offset );
 		len = bzimage_load_initrd ( image, initrd, dest );
+		offset -= bzimage_align ( len );
 
 		/* Record initrd location */
 		if ( ! bzimg->ramdisk_image )
@@ -70,10 +70,14 @@ static userptr_t initrd_squash_high ( userptr_t top ) {
 		if ( ! highest )
 			break;
 
-		/* Move this image to its final position */
+		/* Move this image to its final position, if not
+		 * already there.
+		 */
 		len = ( ( highest->len + INITRD_ALIGN - 1 ) &
 			~( INITRD_ALIGN - 1 ) );
 		current = userptr_sub ( current, len );
+		if ( highest->data == current )
+			continue;
 		DBGC ( &images, "INITRD squashing %s [%#08lx,%#08lx)->"
 		       "[%#08lx,%#08lx)\n", highest->name,
 		       user_to_phys ( highest->data, 0 ),
@@ -215,6 +219,34 @@ static void initrd_dump ( void ) {
 	}
 }
 
+/**
+ * Check if initrds are already in the desired order
+ *
+ * @v bottom		Lowest address available for initrds
+ * @v top		Highest address available for initrds
+ * @ret end		End of highest initrd, or UNULL if not in order
+ *
+ * Initrds are in the desired order if they lie within the available
+ * region in ascending address order.  (This will typically be the
+ * case if the images were downloaded as a batch by imgdownloads().)
+ */
+static userptr_t initrd_ordered ( userptr_t bottom, userptr_t top ) {
+	struct image *initrd;
+	userptr_t end = bottom;
+	size_t len;
+
+	for_each_image ( initrd ) {
+		if ( userptr_sub ( initrd->data, end ) < 0 )
+			return UNULL;
+		len = ( ( initrd->len + INITRD_ALIGN - 1 ) &
+			~( INITRD_ALIGN - 1 ) );
+		end = userptr_add ( initrd->data, len );
+		if ( userptr_sub ( end, top ) > 0 )
+			return UNULL;
+	}
+	return end;
+}
+
 /**
  * Reshuffle initrds into desired order at top of memory
  *
@@ -227,6 +259,7 @@ static void initrd_dump ( void ) {
  * permitted.
  */
 void initrd_reshuffle ( userptr_t bottom ) {
+	userptr_t ordered;
 	userptr_t top;
 	userptr_t used;
 	userptr_t free;
@@ -242,6 +275,19 @@ void initrd_reshuffle ( userptr_t bottom ) {
 	       user_to_phys ( bottom, 0 ), user_to_phys ( top, 0 ) );
 	initrd_dump();
 
+	/* If initrds are already in the desired order, then squash
+	 * them only as high as the highest initrd.  Only those
+	 * initrds (if any) not already contiguous with the highest
+	 * initrd will then need to be moved, and no swapping will be
+	 * required.
+	 */
+	ordered = initrd_ordered ( bottom, top );
+	if ( ordered ) {
+		DBGC ( &images, "INITRD already ordered below %#08lx\n",
+		       user_to_phys ( ordered, 0 ) );
+		top = ordered;
+	}
+
 	/* Squash initrds as high as possible in memory */
 	used = initrd_squash_high ( top );
 
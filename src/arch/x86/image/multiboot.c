@@ -178,6 +178,26 @@ static physaddr_t multiboot_add_cmdline ( struct image *image ) {
 	return virt_to_phys ( mb_cmdline );
 }
 
+/**
+ * Check if multiboot module may be used in place
+ *
+ * @v module_image	Module image
+ * @ret in_place	Module may be used without being copied
+ *
+ * Downloaded images are allocated page-aligned in external memory
+ * that remains hidden from the memory map (and so cannot be
+ * overwritten by any other segment) until we shut down for booting.
+ * Such an image may be passed to the OS directly at its current
+ * location, provided that it lies within the 32-bit address space.
+ */
+static int multiboot_module_in_place ( struct image *module_image ) {
+	physaddr_t start = user_to_phys ( module_image->data, 0 );
+	physaddr_t end = ( start + module_image->len );
+
+	return ( ( ( start & 0xfff ) == 0 ) && ( end >= start ) &&
+		 ( ( end - 1 ) <= 0xffffffffUL ) );
+}
+
 /**
  * Add multiboot modules
  *
@@ -186,6 +206,9 @@ static physaddr_t multiboot_add_cmdline ( struct image *image ) {
  * @v mbinfo		Multiboot information structure
  * @v modules		Multiboot module list
  * @ret rc		Return status code
+ *
+ * Modules that can be used in place are not copied.  All other
+ * modules are copied to page-aligned addresses following the kernel.
  */
 static int multiboot_add_modules ( struct image *image, physaddr_t start,
 				   struct multiboot_info *mbinfo,
@@ -193,6 +216,7 @@ static int multiboot_add_modules ( struct image *image, physaddr_t start,
 				   unsigned int limit ) {
 	struct image *module_image;
 	struct multiboot_module *module;
+	physaddr_t mod_start;
 	int rc;
 
 	/* Add each image as a multiboot module */
@@ -208,33 +232,38 @@ static int multiboot_add_modules ( struct image *image, physaddr_t start,
 		if ( module_image == image )
 			continue;
 
-		/* Page-align the module */
-		start = ( ( start + 0xfff ) & ~0xfff );
-
-		/* Prepare segment */
-		if ( ( rc = prep_segment ( phys_to_user ( start ),
-					   module_image->len,
-					   module_image->len ) ) != 0 ) {
-			DBGC ( image, "MULTIBOOT %p could not prepare module "
-			       "%s: %s\n", image, module_image->name,
-			       strerror ( rc ) );
-			return rc;
+		/* Use module in place, if possible, otherwise copy to
+		 * the next page-aligned address.
+		 */
+		if ( multiboot_module_in_place ( module_image ) ) {
+			mod_start = user_to_phys ( module_image->data, 0 );
+			DBGC ( image, "MULTIBOOT %p using module %s in place\n",
+			       image, module_image->name );
+		} else {
+			mod_start = ( ( start + 0xfff ) & ~0xfff );
+			if ( ( rc = prep_segment ( phys_to_user ( mod_start ),
+						   module_image->len,
+						   module_image->len ) ) != 0 ){
+				DBGC ( image, "MULTIBOOT %p could not prepare "
+				       "module %s: %s\n", image,
+				       module_image->name, strerror ( rc ) );
+				return rc;
+			}
+			memcpy_user ( phys_to_user ( mod_start ), 0,
+				      module_image->data, 0,
+				      module_image->len );
+			start = ( mod_start + module_image->len );
 		}
 
-		/* Copy module */
-		memcpy_user ( phys_to_user ( start ), 0,
-			      module_image->data, 0, module_image->len );
-
 		/* Add module to list */
 		module = &modules[mbinfo->mods_count++];
-		module->mod_start = start;
-		module->mod_end = ( start + module_image->len );
+		module->mod_start = mod_start;
+		module->mod_end = ( mod_start + module_image->len );
 		module->string = multiboot_add_cmdline ( module_image );
 		module->reserved = 0;
 		DBGC ( image, "MULTIBOOT %p module %s is [%x,%x)\n",
 		       image, module_image->name, module->mod_start,
 		       module->mod_end );
-		start += module_image->len;
 	}
 
 	return 0;
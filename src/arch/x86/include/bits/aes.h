@@ -0,0 +1,55 @@
+#ifndef _BITS_AES_H
+#define _BITS_AES_H
+
+/** @file
+ *
+ * x86-specific AES acceleration
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+extern int aesni_enabled;
+
+extern void aesni_encrypt ( const struct aes_context *aes, const void *src,
+			    void *dst );
+extern void aesni_decrypt ( const struct aes_context *aes, const void *src,
+			    void *dst );
+
+/**
+ * Encrypt block using hardware acceleration, if available
+ *
+ * @v aes		AES context
+ * @v src		Data to encrypt
+ * @v dst		Buffer for encrypted data
+ * @ret accelerated	Block was encrypted using hardware acceleration
+ */
+static inline __attribute__ (( always_inline )) int
+aes_accel_encrypt ( const struct aes_context *aes, const void *src,
+		    void *dst ) {
+
+	if ( ! aesni_enabled )
+		return 0;
+	aesni_encrypt ( aes, src, dst );
+	return 1;
+}
+
+/**
+ * Decrypt block using hardware acceleration, if available
+ *
+ * @v aes		AES context
+ * @v src		Data to decrypt
+ * @v dst		Buffer for decrypted data
+ * @ret accelerated	Block was decrypted using hardware acceleration
+ */
+static inline __attribute__ (( always_inline )) int
+aes_accel_decrypt ( const struct aes_context *aes, const void *src,
+		    void *dst ) {
+
+	if ( ! aesni_enabled )
+		return 0;
+	aesni_decrypt ( aes, src, dst );
+	return 1;
+}
+
+#endif /* _BITS_AES_H */
@@ -40,7 +40,7 @@ bigint_init_raw ( uint32_t *value0, unsigned int size,
 			       : "=&D" ( discard_D ), "=&c" ( discard_c )
 			       : "r" ( data ), "g" ( pad_len ), "0" ( value0 ),
 				 "1" ( len )
-			       : "eax" );
+			       : "eax", "memory" );
 }
 
 /**
@@ -66,7 +66,7 @@ bigint_add_raw ( const uint32_t *addend0, uint32_t *value0,
 			       : "=&r" ( index ), "=&S" ( discard_S ),
 				 "=&c" ( discard_c )
 			       : "r" ( value0 ), "1" ( addend0 ), "2" ( size )
-			       : "eax" );
+			       : "eax", "memory" );
 }
 
 /**
@@ -93,7 +93,7 @@ bigint_subtract_raw ( const uint32_t *subtrahend0, uint32_t *value0,
 				 "=&c" ( discard_c )
 			       : "r" ( value0 ), "1" ( subtrahend0 ),
 				 "2" ( size )
-			       : "eax" );
+			       : "eax", "memory" );
 }
 
 /**
@@ -113,7 +113,8 @@ bigint_rol_raw ( uint32_t *value0, unsigned int size ) {
 			       "inc %0\n\t" /* Does not affect CF */
 			       "loop 1b\n\t"
 			       : "=&r" ( index ), "=&c" ( discard_c )
-			       : "r" ( value0 ), "1" ( size ) );
+			       : "r" ( value0 ), "1" ( size )
+			       : "memory" );
 }
 
 /**
@@ -131,7 +132,8 @@ bigint_ror_raw ( uint32_t *value0, unsigned int size ) {
 			       "rcrl $1, -4(%1,%0,4)\n\t"
 			       "loop 1b\n\t"
 			       : "=&c" ( discard_c )
-			       : "r" ( value0 ), "0" ( size ) );
+			       : "r" ( value0 ), "0" ( size )
+			       : "memory" );
 }
 
 /**
@@ -152,7 +154,8 @@ bigint_is_zero_raw ( const uint32_t *value0, unsigned int size ) {
 			       "sete %b0\n\t"
 			       : "=&a" ( result ), "=&D" ( discard_D ),
 				 "=&c" ( discard_c )
-			       : "1" ( value0 ), "2" ( size ) );
+			       : "1" ( value0 ), "2" ( size )
+			       : "memory" );
 	return result;
 }
 
@@ -188,7 +191,7 @@ bigint_is_geq_raw ( const uint32_t *value0, const uint32_t *reference0,
 			       : "0" ( 0 ), "1" ( &value->element[ size - 1 ] ),
 				 "2" ( &reference->element[ size - 1 ] ),
 				 "3" ( size )
-			       : "eax" );
+			       : "eax", "memory" );
 	return result;
 }
 
@@ -233,7 +236,8 @@ bigint_max_set_bit_raw ( const uint32_t *value0, unsigned int size ) {
 			       "xor %0, %0\n\t"
 			       "\n2:\n\t"
 			       : "=&r" ( result ), "=&c" ( discard_c )
-			       : "r" ( value0 ), "1" ( size ) );
+			       : "r" ( value0 ), "1" ( size )
+			       : "memory" );
 	return result;
 }
 
@@ -261,7 +265,7 @@ bigint_grow_raw ( const uint32_t *source0, unsigned int source_size,
 				 "=&c" ( discard_c )
 			       : "g" ( pad_size ), "0" ( dest0 ),
 				 "1" ( source0 ), "2" ( source_size )
-			       : "eax" );
+			       : "eax", "memory" );
 }
 
 /**
@@ -284,7 +288,7 @@ bigint_shrink_raw ( const uint32_t *source0, unsigned int source_size __unused,
 				 "=&c" ( discard_c )
 			       : "0" ( dest0 ), "1" ( source0 ),
 				 "2" ( dest_size )
-			       : "eax" );
+			       : "eax", "memory" );
 }
 
 /**
@@ -308,11 +312,15 @@ bigint_done_raw ( const uint32_t *value0, unsigned int size __unused,
 			       "loop 1b\n\t"
 			       : "=&D" ( discard_D ), "=&c" ( discard_c )
 			       : "r" ( value0 ), "0" ( out ), "1" ( len )
-			       : "eax" );
+			       : "eax", "memory" );
 }
 
 extern void bigint_multiply_raw ( const uint32_t *multiplicand0,
 				  const uint32_t *multiplier0,
 				  uint32_t *value0, unsigned int size );
+extern uint32_t bigint_multiply_accumulate_raw ( const uint32_t *multiplicand0,
+						 uint32_t multiplier,
+						 uint32_t *value0,
+						 unsigned int size );
 
 #endif /* _BITS_BIGINT_H */
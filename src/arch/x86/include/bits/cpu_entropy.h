@@ -0,0 +1,26 @@
+#ifndef _BITS_CPU_ENTROPY_H
+#define _BITS_CPU_ENTROPY_H
+
+/** @file
+ *
+ * x86-specific CPU hardware random number generator
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+extern int rdrand_get_noise ( noise_sample_t *noise );
+
+/**
+ * Get noise sample from CPU hardware random number generator
+ *
+ * @ret noise		Noise sample
+ * @ret rc		Return status code
+ */
+static inline __attribute__ (( always_inline )) int
+cpu_get_noise ( noise_sample_t *noise ) {
+
+	return rdrand_get_noise ( noise );
+}
+
+#endif /* _BITS_CPU_ENTROPY_H */
@@ -0,0 +1,57 @@
+#ifndef _BITS_CRC32_H
+#define _BITS_CRC32_H
+
+/** @file
+ *
+ * x86-specific CRC32 acceleration
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** PCLMULQDQ instruction is usable for CRC32 */
+#define X86_CRC32_PCLMUL 0x0001
+
+/** SSE4.2 CRC32 instruction is usable for CRC32C */
+#define X86_CRC32_SSE42 0x0002
+
+extern unsigned int x86_crc32_accel;
+
+extern size_t x86_crc32_pclmul ( uint32_t *crc, const void *data,
+				 size_t len );
+extern size_t x86_crc32c_sse42 ( uint32_t *crc, const void *data,
+				 size_t len );
+
+/**
+ * Calculate CRC32 using hardware acceleration, if available
+ *
+ * @v crc		CRC to update
+ * @v data		Data to checksum
+ * @v len		Length of data
+ * @ret done		Length of data processed
+ */
+static inline __attribute__ (( always_inline )) size_t
+crc32_accel_le ( uint32_t *crc, const void *data, size_t len ) {
+
+	if ( ! ( x86_crc32_accel & X86_CRC32_PCLMUL ) )
+		return 0;
+	return x86_crc32_pclmul ( crc, data, len );
+}
+
+/**
+ * Calculate CRC32C using hardware acceleration, if available
+ *
+ * @v crc		CRC to update
+ * @v data		Data to checksum
+ * @v len		Length of data
+ * @ret done		Length of data processed
+ */
+static inline __attribute__ (( always_inline )) size_t
+crc32c_accel_le ( uint32_t *crc, const void *data, size_t len ) {
+
+	if ( ! ( x86_crc32_accel & X86_CRC32_SSE42 ) )
+		return 0;
+	return x86_crc32c_sse42 ( crc, data, len );
+}
+
+#endif /* _BITS_CRC32_H */
@@ -0,0 +1,33 @@
+#ifndef _BITS_GCM_H
+#define _BITS_GCM_H
+
+/** @file
+ *
+ * x86-specific GCM acceleration
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+extern int pclmul_enabled;
+
+extern void pclmul_gcm_multiply ( const union gcm_block *key,
+				  union gcm_block *hash );
+
+/**
+ * Multiply accumulated hash by hash key using hardware acceleration
+ *
+ * @v key		Hash key (H)
+ * @v hash		Accumulated hash (X)
+ * @ret accelerated	Hash was multiplied using hardware acceleration
+ */
+static inline __attribute__ (( always_inline )) int
+gcm_accel_multiply ( const union gcm_block *key, union gcm_block *hash ) {
+
+	if ( ! pclmul_enabled )
+		return 0;
+	pclmul_gcm_multiply ( key, hash );
+	return 1;
+}
+
+#endif /* _BITS_GCM_H */
@@ -9,6 +9,14 @@
 
 FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
+/** SSE2 instructions are usable for checksumming */
+#define X86_TCPIP_SSE2 0x0001
+
+/** AVX2 instructions are usable for checksumming */
+#define X86_TCPIP_AVX2 0x0002
+
+extern unsigned int x86_tcpip_simd;
+
 extern uint16_t tcpip_continue_chksum ( uint16_t partial, const void *data,
 					size_t len );
 
@@ -0,0 +1,22 @@
+#ifndef _IPXE_BIOS_SAMPLER_H
+#define _IPXE_BIOS_SAMPLER_H
+
+/** @file
+ *
+ * BIOS sampling profiler timer source
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** Timer interrupt rate multiplier
+ *
+ * The PIT is reprogrammed to interrupt this many times faster than
+ * the standard 18.2Hz BIOS timer tick.  Must be a power of two no
+ * greater than 256.
+ */
+#define BIOS_SAMPLER_MULTIPLIER 64
+
+extern void bios_sampler_interrupt ( unsigned long ip );
+
+#endif /* _IPXE_BIOS_SAMPLER_H */
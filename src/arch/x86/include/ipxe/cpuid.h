@@ -39,9 +39,51 @@ struct x86_features {
 /** Get standard features */
 #define CPUID_FEATURES 0x00000001UL
 
+/** Carry-less multiplication instruction is supported */
+#define CPUID_FEATURES_INTEL_ECX_PCLMULQDQ 0x00000002UL
+
+/** Supplemental SSE3 instructions are supported */
+#define CPUID_FEATURES_INTEL_ECX_SSSE3 0x00000200UL
+
+/** SSE4.1 instructions are supported */
+#define CPUID_FEATURES_INTEL_ECX_SSE4_1 0x00080000UL
+
+/** SSE4.2 instructions are supported */
+#define CPUID_FEATURES_INTEL_ECX_SSE4_2 0x00100000UL
+
+/** AES instructions are supported */
+#define CPUID_FEATURES_INTEL_ECX_AES 0x02000000UL
+
+/** XSAVE instructions are enabled by the OS */
+#define CPUID_FEATURES_INTEL_ECX_OSXSAVE 0x08000000UL
+
+/** AVX instructions are supported */
+#define CPUID_FEATURES_INTEL_ECX_AVX 0x10000000UL
+
+/** RDRAND instruction is supported */
+#define CPUID_FEATURES_INTEL_ECX_RDRAND 0x40000000UL
+
 /** Hypervisor is present */
 #define CPUID_FEATURES_INTEL_ECX_HYPERVISOR 0x80000000UL
 
+/** SSE2 instructions are supported */
+#define CPUID_FEATURES_INTEL_EDX_SSE2 0x04000000UL
+
+/** Get structured extended features */
+#define CPUID_STRUCTURED 0x00000007UL
+
+/** AVX2 instructions are supported */
+#define CPUID_STRUCTURED_EBX_AVX2 0x00000020UL
+
+/** Enhanced REP MOVSB/STOSB is supported */
+#define CPUID_STRUCTURED_EBX_ERMS 0x00000200UL
+
+/** RDSEED instruction is supported */
+#define CPUID_STRUCTURED_EBX_RDSEED 0x00040000UL
+
+/** SHA instructions are supported */
+#define CPUID_STRUCTURED_EBX_SHA 0x20000000UL
+
 /** Get largest extended function */
 #define CPUID_AMD_MAX_FN 0x80000000UL
 
@@ -82,7 +124,17 @@ cpuid ( uint32_t function, uint32_t subfunction, uint32_t *eax, uint32_t *ebx,
 		  : "0" ( function ), "2" ( subfunction ) );
 }
 
+/** CR4 flag indicating that the OS supports FXSAVE/FXRSTOR (and SSE) */
+#define CR4_OSFXSR 0x00000200UL
+
+/** XCR0 flag indicating that the OS saves SSE state */
+#define XCR0_SSE 0x00000002UL
+
+/** XCR0 flag indicating that the OS saves AVX state */
+#define XCR0_AVX 0x00000004UL
+
 extern int cpuid_supported ( uint32_t function );
 extern void x86_features ( struct x86_features *features );
+extern int x86_sse_usable ( void );
 
 #endif /* _IPXE_CPUID_H */
@@ -10,6 +10,7 @@
 FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 #include <stdint.h>
+#include <bits/cpu_entropy.h>
 
 #ifdef ENTROPY_RTC
 #define ENTROPY_PREFIX_rtc
@@ -52,6 +53,12 @@ extern uint8_t rtc_sample ( void );
 static inline __always_inline int
 ENTROPY_INLINE ( rtc, get_noise ) ( noise_sample_t *noise ) {
 
+	/* Use CPU random number generator, if available, since
+	 * waiting for RTC interrupts is very slow.
+	 */
+	if ( cpu_get_noise ( noise ) == 0 )
+		return 0;
+
 	/* Get sample */
 	*noise = rtc_sample();
 
@@ -32,6 +32,8 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/keys.h>
 #include <ipxe/keymap.h>
 #include <ipxe/init.h>
+#include <ipxe/process.h>
+#include <ipxe/profile.h>
 #include <config/console.h>
 
 #define ATTR_BOLD		0x08
@@ -60,6 +62,9 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 #define ATTR_DEFAULT		ATTR_FCOL_WHITE
 
+/** Maximum number of characters to print in a single real-mode call */
+#define BIOS_OUTPUT_MAX 128
+
 /* Set default console usage if applicable */
 #if ! ( defined ( CONSOLE_PCBIOS ) && CONSOLE_EXPLICIT ( CONSOLE_PCBIOS ) )
 #undef CONSOLE_PCBIOS
@@ -69,6 +74,32 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 /** Current character attribute */
 static unsigned int bios_attr = ATTR_DEFAULT;
 
+/** A buffered output character */
+struct bios_output_char {
+	/** Character */
+	uint8_t character;
+	/** Attribute */
+	uint8_t attr;
+} __attribute__ (( packed ));
+
+/** Output buffer
+ *
+ * Each INT 10 call requires a round trip through real mode, and
+ * printing a single character may require up to three such calls.
+ * Characters are therefore accumulated here and printed in a single
+ * real-mode call.
+ */
+static struct bios_output_char __bss16_array ( bios_output,
+					       [BIOS_OUTPUT_MAX] );
+#define bios_output __use_data16 ( bios_output )
+
+/** Number of buffered output characters */
+static unsigned int bios_output_len;
+
+/** Output flush profiler */
+static struct profiler bios_flush_profiler __profiler =
+	{ .name = "bioscon.flush" };
+
 /** Keypress injection lock */
 static uint8_t __text16 ( bios_inject_lock );
 #define bios_inject_lock __use_text16 ( bios_inject_lock )
@@ -80,6 +111,61 @@ static struct segoff __text16 ( int16_vector );
 /** Assembly wrapper */
 extern void int16_wrapper ( void );
 
+/**
+ * Print buffered characters to BIOS console
+ *
+ */
+static void bios_flush ( void ) {
+	int discard_b, discard_c, discard_S, discard_D;
+
+	/* Do nothing unless there are buffered characters */
+	if ( ! bios_output_len )
+		return;
+
+	/* Record number of characters printed per real-mode call */
+	profile_custom ( &bios_flush_profiler, bios_output_len );
+
+	/* Print each character with its attribute */
+	__asm__ __volatile__ ( REAL_CODE ( "pushl %%ebp\n\t" /* gcc bug */
+					   "\n2:\n\t"
+					   "lodsw\n\t"
+					   "pushw %%si\n\t"
+					   "pushw %%di\n\t"
+					   "movzbw %%ah, %%bx\n\t"
+					   /* Skip non-printable characters */
+					   "cmpb $0x20, %%al\n\t"
+					   "jb 3f\n\t"
+					   /* Read attribute */
+					   "movb %%al, %%cl\n\t"
+					   "movb $0x08, %%ah\n\t"
+					   "int $0x10\n\t"
+					   "xchgb %%al, %%cl\n\t"
+					   /* Skip if attribute matches */
+					   "cmpb %%ah, %%bl\n\t"
+					   "je 3f\n\t"
+					   /* Set attribute */
+					   "movw $0x0001, %%cx\n\t"
+					   "movb $0x09, %%ah\n\t"
+					   "int $0x10\n\t"
+					   "\n3:\n\t"
+					   /* Print character */
+					   "xorw %%bx, %%bx\n\t"
+					   "movb $0x0e, %%ah\n\t"
+					   "int $0x10\n\t"
+					   /* Move to next character */
+					   "popw %%di\n\t"
+					   "popw %%si\n\t"
+					   "decw %%di\n\t"
+					   "jnz 2b\n\t"
+					   "popl %%ebp\n\t" /* gcc bug */ )
+			       : "=b" ( discard_b ), "=c" ( discard_c ),
+				 "=S" ( discard_S ), "=D" ( discard_D )
+			       : "S" ( __from_data16 ( bios_output ) ),
+				 "D" ( bios_output_len )
+			       : "eax", "memory" );
+	bios_output_len = 0;
+}
+
 /**
  * Handle ANSI CUP (cursor position)
  *
@@ -98,6 +184,7 @@ static void bios_handle_cup ( struct ansiesc_context *ctx __unused,
 	if ( cy < 0 )
 		cy = 0;
 
+	bios_flush();
 	__asm__ __volatile__ ( REAL_CODE ( "int $0x10\n\t" )
 			       : : "a" ( 0x0200 ), "b" ( 1 ),
 			           "d" ( ( cy << 8 ) | cx ) );
@@ -116,6 +203,7 @@ static void bios_handle_ed ( struct ansiesc_context *ctx __unused,
 	/* We assume that we always clear the whole screen */
 	assert ( params[0] == ANSIESC_ED_ALL );
 
+	bios_flush();
 	__asm__ __volatile__ ( REAL_CODE ( "int $0x10\n\t" )
 			       : : "a" ( 0x0600 ), "b" ( bios_attr << 8 ),
 				   "c" ( 0 ),
@@ -184,6 +272,7 @@ static void bios_handle_dectcem_set ( struct ansiesc_context *ctx __unused,
 	/* Get character height */
 	get_real ( height, BDA_SEG, BDA_CHAR_HEIGHT );
 
+	bios_flush();
 	__asm__ __volatile__ ( REAL_CODE ( "int $0x10\n\t" )
 			       : : "a" ( 0x0100 ),
 				   "c" ( ( ( height - 2 ) << 8 ) |
@@ -201,6 +290,7 @@ static void bios_handle_dectcem_reset ( struct ansiesc_context *ctx __unused,
 					unsigned int count __unused,
 					int params[] __unused ) {
 
+	bios_flush();
 	__asm__ __volatile__ ( REAL_CODE ( "int $0x10\n\t" )
 			       : : "a" ( 0x0100 ), "c" ( 0x2000 ) );
 }
@@ -226,39 +316,21 @@ static struct ansiesc_context bios_ansiesc_ctx = {
  * @v character		Character to be printed
  */
 static void bios_putchar ( int character ) {
-	int discard_a, discard_b, discard_c;
+	struct bios_output_char *output;
 
 	/* Intercept ANSI escape sequences */
 	character = ansiesc_process ( &bios_ansiesc_ctx, character );
 	if ( character < 0 )
 		return;
 
-	/* Print character with attribute */
-	__asm__ __volatile__ ( REAL_CODE ( "pushl %%ebp\n\t" /* gcc bug */
-					   /* Skip non-printable characters */
-					   "cmpb $0x20, %%al\n\t"
-					   "jb 1f\n\t"
-					   /* Read attribute */
-					   "movb %%al, %%cl\n\t"
-					   "movb $0x08, %%ah\n\t"
-					   "int $0x10\n\t"
-					   "xchgb %%al, %%cl\n\t"
-					   /* Skip if attribute matches */
-					   "cmpb %%ah, %%bl\n\t"
-					   "je 1f\n\t"
-					   /* Set attribute */
-					   "movw $0x0001, %%cx\n\t"
-					   "movb $0x09, %%ah\n\t"
-					   "int $0x10\n\t"
-					   "\n1:\n\t"
-					   /* Print character */
-					   "xorw %%bx, %%bx\n\t"
-					   "movb $0x0e, %%ah\n\t"
-					   "int $0x10\n\t"
-					   "popl %%ebp\n\t" /* gcc bug */ )
-			       : "=a" ( discard_a ), "=b" ( discard_b ),
-			         "=c" ( discard_c )
-			       : "a" ( character ), "b" ( bios_attr ) );
+	/* Buffer character with attribute */
+	output = &bios_output[ bios_output_len++ ];
+	output->character = character;
+	output->attr = bios_attr;
+
+	/* Print buffered characters at end of line or when full */
+	if ( ( character == '\n' ) || ( bios_output_len == BIOS_OUTPUT_MAX ) )
+		bios_flush();
 }
 
 /**
@@ -375,6 +447,9 @@ static int bios_getchar ( void ) {
 	if ( bios_inject_lock )
 		return 0;
 
+	/* Ensure any prompt is visible before waiting for input */
+	bios_flush();
+
 	/* Read character from real BIOS console */
 	bios_inject_lock++;
 	__asm__ __volatile__ ( REAL_CODE ( "sti\n\t"
@@ -417,6 +492,9 @@ static int bios_iskey ( void ) {
 	if ( bios_inject_lock )
 		return 0;
 
+	/* Print any buffered characters */
+	bios_flush();
+
 	/* Otherwise check the real BIOS console */
 	bios_inject_lock++;
 	__asm__ __volatile__ ( REAL_CODE ( "sti\n\t"
@@ -438,6 +516,22 @@ struct console_driver bios_console __console_driver = {
 	.usage = CONSOLE_PCBIOS,
 };
 
+/**
+ * Print buffered characters from process context
+ *
+ * @v process		Process
+ */
+static void bios_flush_step ( struct process *process __unused ) {
+
+	/* Ensure that partial lines do not remain invisible while
+	 * iPXE is waiting for an event.
+	 */
+	bios_flush();
+}
+
+/** BIOS console output flush process */
+PERMANENT_PROCESS ( bios_flush_process, bios_flush_step );
+
 /**
  * Inject keypresses
  *
@@ -550,3 +644,19 @@ struct startup_fn bios_inject_startup_fn __startup_fn ( STARTUP_NORMAL ) = {
 	.startup = bios_inject_startup,
 	.shutdown = bios_inject_shutdown,
 };
+
+/**
+ * Shut down BIOS console
+ *
+ * @v booting		System is shutting down for OS boot
+ */
+static void bios_console_shutdown ( int booting __unused ) {
+
+	/* Print any buffered characters */
+	bios_flush();
+}
+
+/** BIOS console startup function */
+struct startup_fn bios_console_startup_fn __startup_fn ( STARTUP_EARLY ) = {
+	.shutdown = bios_console_shutdown,
+};
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * BIOS image installation timing
+ *
+ */
+
+#include <stdint.h>
+#include <realmode.h>
+#include <ipxe/init.h>
+#include <ipxe/trace.h>
+
+/**
+ * Time taken to install .text and .data
+ *
+ * This is measured in timestamp counter cycles by the prefix, and
+ * will be zero if the CPU has no timestamp counter.  Installation
+ * time is dominated by decompression.
+ */
+uint32_t __data16 ( install_tsc ) = 0;
+#define install_tsc __use_data16 ( install_tsc )
+
+/**
+ * Record installation time in boot trace
+ *
+ */
+static void bios_install_trace ( void ) {
+
+	/* Do nothing unless a time was recorded */
+	if ( ! install_tsc )
+		return;
+
+	DBG ( "BIOS installed .textdata in %d cycles\n", install_tsc );
+	trace_mark ( "install: decompressed in %d kcycles",
+		     ( install_tsc / 1000 ) );
+}
+
+/** BIOS installation timing initialisation function */
+struct init_fn bios_install_init_fn __init_fn ( INIT_NORMAL ) = {
+	.initialise = bios_install_trace,
+};
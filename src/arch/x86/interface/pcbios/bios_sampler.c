@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * BIOS sampling profiler timer source
+ *
+ * The PIT is reprogrammed to generate timer interrupts at a multiple
+ * of the standard BIOS timer tick rate.  A real-mode INT 08 handler
+ * chains to the BIOS only for every Nth interrupt (thereby preserving
+ * the BIOS time of day), and acknowledges the others itself.
+ *
+ * Protected-mode code normally runs with interrupts disabled.  While
+ * sampling, interrupts are enabled on every return from a real-mode
+ * call, so that timer interrupts arriving during protected-mode
+ * execution are delivered via the protected-mode interrupt handler,
+ * which records the interrupted instruction pointer.  Timer
+ * interrupts arriving while in real mode (e.g. within the BIOS or a
+ * UNDI driver) are counted as external samples.
+ *
+ */
+
+#include <stdint.h>
+#include <ipxe/io.h>
+#include <ipxe/init.h>
+#include <ipxe/pit8254.h>
+#include <ipxe/sampler.h>
+#include <ipxe/bios_sampler.h>
+#include <realmode.h>
+#include <biosint.h>
+
+/** Start of text and data */
+extern char _textdata[];
+
+/** End of text and data */
+extern char _mtextdata[];
+
+/** Vector for chaining to other INT 08 handlers */
+static struct segoff __text16 ( int08_vector );
+#define int08_vector __use_text16 ( int08_vector )
+
+/** Number of timer interrupts */
+static uint32_t __text16 ( bios_sampler_ticks );
+#define bios_sampler_ticks __use_text16 ( bios_sampler_ticks )
+
+/** Assembly wrapper */
+extern void int08_wrapper ( void );
+
+/** Sampling is in progress */
+static int bios_sampler_running;
+
+/** Number of samples recorded from protected mode */
+static unsigned int bios_sampler_samples;
+
+/**
+ * Record sample from protected-mode timer interrupt
+ *
+ * @v ip		Interrupted instruction pointer
+ */
+void bios_sampler_interrupt ( unsigned long ip ) {
+	unsigned long offset;
+
+	/* Do nothing unless sampling is in progress */
+	if ( ! bios_sampler_running )
+		return;
+
+	/* Record sample */
+	offset = ( ip - ( ( intptr_t ) _textdata ) );
+	if ( offset >= ( ( size_t ) ( _mtextdata - _textdata ) ) )
+		offset = SAMPLER_EXTERNAL;
+	sampler_record ( offset );
+	bios_sampler_samples++;
+}
+
+/**
+ * Set PIT channel 0 divisor
+ *
+ * @v mode		Operating mode
+ * @v divisor		Divisor (or zero for 65536)
+ */
+static void bios_sampler_pit ( unsigned int mode, unsigned int divisor ) {
+
+	outb ( ( PIT8254_CMD_CHANNEL ( PIT8254_CH_IRQ0 ) |
+		 PIT8254_CMD_ACCESS_LOHI | mode | PIT8254_CMD_BINARY ),
+	       PIT8254_CMD );
+	outb ( ( divisor & 0xff ), PIT8254_DATA ( PIT8254_CH_IRQ0 ) );
+	outb ( ( divisor >> 8 ), PIT8254_DATA ( PIT8254_CH_IRQ0 ) );
+}
+
+/**
+ * Start sampling
+ *
+ * @ret rc		Return status code
+ */
+static int bios_sampler_start ( void ) {
+
+	/* Assembly wrapper to divide down timer interrupts */
+	__asm__ __volatile__ (
+		TEXT16_CODE ( "\nint08_wrapper:\n\t"
+			      "incl %%cs:bios_sampler_ticks\n\t"
+			      "testb $" _S2 ( BIOS_SAMPLER_MULTIPLIER - 1 ) ", "
+			      "%%cs:bios_sampler_ticks\n\t"
+			      "jz 1f\n\t"
+			      "pushw %%ax\n\t"
+			      "movb $0x20, %%al\n\t" /* Non-specific EOI */
+			      "outb %%al, $0x20\n\t"
+			      "popw %%ax\n\t"
+			      "iret\n\t"
+			      "\n1:\n\t"
+			      "ljmp *%%cs:int08_vector\n\t" ) : );
+
+	/* Hook INT 08 and speed up timer */
+	bios_sampler_ticks = 0;
+	bios_sampler_samples = 0;
+	hook_bios_interrupt ( 0x08, ( ( intptr_t ) int08_wrapper ),
+			      &int08_vector );
+	bios_sampler_pit ( PIT8254_CMD_OP_RATE,
+			   ( 0x10000 / BIOS_SAMPLER_MULTIPLIER ) );
+
+	/* Enable interrupts in protected mode */
+	bios_sampler_running = 1;
+	real_call_sti = 1;
+	__asm__ __volatile__ ( "sti" );
+
+	return 0;
+}
+
+/**
+ * Stop sampling
+ *
+ */
+static void bios_sampler_stop ( void ) {
+	unsigned int ticks;
+
+	/* Disable interrupts in protected mode */
+	__asm__ __volatile__ ( "cli" );
+	real_call_sti = 0;
+	bios_sampler_running = 0;
+
+	/* Restore standard timer rate and unhook INT 08 */
+	bios_sampler_pit ( PIT8254_CMD_OP_SQUARE, 0 );
+	unhook_bios_interrupt ( 0x08, ( ( intptr_t ) int08_wrapper ),
+				&int08_vector );
+
+	/* Count timer interrupts that arrived while in real mode */
+	ticks = bios_sampler_ticks;
+	if ( ticks > bios_sampler_samples )
+		sampler_external ( ticks - bios_sampler_samples );
+}
+
+/** BIOS sampling profiler timer source */
+struct sampler_source bios_sampler __sampler_source = {
+	.name = "BIOS",
+	.section = ".textdata",
+	.start = bios_sampler_start,
+	.stop = bios_sampler_stop,
+};
+
+/**
+ * Shut down sampling profiler
+ *
+ * @v booting		System is shutting down for OS boot
+ */
+static void bios_sampler_shutdown ( int booting __unused ) {
+
+	/* Ensure INT 08 is unhooked and timer is restored */
+	sampler_stop();
+}
+
+/** BIOS sampling profiler startup function */
+struct startup_fn bios_sampler_startup_fn __startup_fn ( STARTUP_NORMAL ) = {
+	.shutdown = bios_sampler_shutdown,
+};
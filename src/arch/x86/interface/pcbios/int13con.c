@@ -28,6 +28,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <errno.h>
 #include <ipxe/console.h>
 #include <ipxe/init.h>
+#include <ipxe/profile.h>
 #include <realmode.h>
 #include <int13.h>
 #include <config/console.h>
@@ -86,6 +87,10 @@ static size_t int13con_offset;
 /** Number of unwritten characters */
 static size_t int13con_unwritten;
 
+/** Log write profiler */
+static struct profiler int13con_write_profiler __profiler =
+	{ .name = "int13con.write" };
+
 struct console_driver int13con __console_driver;
 
 /**
@@ -147,6 +152,10 @@ static void int13con_putchar ( int character ) {
 	     ( int13con_unwritten == INT13CON_MAX_UNWRITTEN ) ||
 	     ( character == '\n' ) ) {
 
+		/* Record number of characters written per INT13 call */
+		profile_custom ( &int13con_write_profiler,
+				 int13con_unwritten );
+
 		/* Write sector to disk */
 		if ( ( rc = int13con_rw ( INT13_EXTENDED_WRITE,
 					  int13con_lba ) ) != 0 ) {
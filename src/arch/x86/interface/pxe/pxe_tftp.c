@@ -38,17 +38,25 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/tftp.h>
 #include <ipxe/iobuf.h>
 #include <ipxe/xfer.h>
+#include <ipxe/xferbuf.h>
 #include <ipxe/open.h>
 #include <ipxe/process.h>
 #include <ipxe/uri.h>
 #include <realmode.h>
 #include <pxe.h>
 
-/** A PXE TFTP connection */
+/** A PXE TFTP connection
+ *
+ * Files opened using PXENV_TFTP_OPEN are prefetched in their entirety
+ * into a local buffer, using whatever block size and window size the
+ * underlying protocol is able to negotiate, and PXENV_TFTP_READ calls
+ * are then satisfied from this buffer.  Files downloaded using
+ * PXENV_TFTP_READ_FILE are delivered directly to the caller's buffer.
+ */
 struct pxe_tftp_connection {
 	/** Data transfer interface */
 	struct interface xfer;
-	/** Data buffer */
+	/** Data buffer (for direct downloads), or UNULL to prefetch */
 	userptr_t buffer;
 	/** Size of data buffer */
 	size_t size;
@@ -62,6 +70,14 @@ struct pxe_tftp_connection {
 	size_t blksize;
 	/** Block index */
 	unsigned int blkidx;
+	/** Prefetched data */
+	userptr_t data;
+	/** Prefetch buffer */
+	struct xfer_buffer xferbuf;
+	/** Length of contiguous data present in prefetch buffer */
+	size_t filled;
+	/** Read position within prefetch buffer */
+	size_t pos;
 	/** Overall return status code */
 	int rc;
 };
@@ -77,17 +93,6 @@ static void pxe_tftp_close ( struct pxe_tftp_connection *pxe_tftp, int rc ) {
 	pxe_tftp->rc = rc;
 }
 
-/**
- * Check flow control window
- *
- * @v pxe_tftp		PXE TFTP connection
- * @ret len		Length of window
- */
-static size_t pxe_tftp_xfer_window ( struct pxe_tftp_connection *pxe_tftp ) {
-
-	return pxe_tftp->blksize;
-}
-
 /**
  * Receive new data
  *
@@ -110,6 +115,16 @@ static int pxe_tftp_xfer_deliver ( struct pxe_tftp_connection *pxe_tftp,
 	/* Copy data block to buffer */
 	if ( len == 0 ) {
 		/* No data (pure seek); treat as success */
+	} else if ( ! pxe_tftp->buffer ) {
+		/* Add to prefetch buffer */
+		if ( ( rc = xferbuf_write ( &pxe_tftp->xferbuf,
+					    pxe_tftp->offset, iobuf->data,
+					    len ) ) != 0 ) {
+			DBG ( " could not prefetch: %s", strerror ( rc ) );
+		} else if ( ( pxe_tftp->offset <= pxe_tftp->filled ) &&
+			    ( ( pxe_tftp->offset + len ) > pxe_tftp->filled ) ) {
+			pxe_tftp->filled = ( pxe_tftp->offset + len );
+		}
 	} else if ( pxe_tftp->offset < pxe_tftp->start ) {
 		DBG ( " buffer underrun at %zx (min %zx)",
 		      pxe_tftp->offset, pxe_tftp->start );
@@ -145,8 +160,6 @@ static int pxe_tftp_xfer_deliver ( struct pxe_tftp_connection *pxe_tftp,
 static struct interface_operation pxe_tftp_xfer_ops[] = {
 	INTF_OP ( xfer_deliver, struct pxe_tftp_connection *,
 		  pxe_tftp_xfer_deliver ),
-	INTF_OP ( xfer_window, struct pxe_tftp_connection *,
-		  pxe_tftp_xfer_window ),
 	INTF_OP ( intf_close, struct pxe_tftp_connection *, pxe_tftp_close ),
 };
 
@@ -157,6 +170,10 @@ static struct interface_descriptor pxe_tftp_xfer_desc =
 /** The PXE TFTP connection */
 static struct pxe_tftp_connection pxe_tftp = {
 	.xfer = INTF_INIT ( pxe_tftp_xfer_desc ),
+	.xferbuf = {
+		.data = &pxe_tftp.data,
+		.op = &xferbuf_umalloc_operations,
+	},
 };
 
 /**
@@ -177,9 +194,13 @@ static int pxe_tftp_open ( IP4_t ipaddress, UDP_PORT_t port,
 	struct uri *uri;
 	int rc;
 
+	/* Free any previous prefetch buffer */
+	xferbuf_free ( &pxe_tftp.xferbuf );
+
 	/* Reset PXE TFTP connection structure */
 	memset ( &pxe_tftp, 0, sizeof ( pxe_tftp ) );
 	intf_init ( &pxe_tftp.xfer, &pxe_tftp_xfer_desc, NULL );
+	xferbuf_umalloc_init ( &pxe_tftp.xferbuf, &pxe_tftp.data );
 	if ( blksize < TFTP_DEFAULT_BLKSIZE )
 		blksize = TFTP_DEFAULT_BLKSIZE;
 	pxe_tftp.blksize = blksize;
@@ -268,12 +289,15 @@ static PXENV_EXIT_t pxenv_tftp_open ( struct s_PXENV_TFTP_OPEN *tftp_open ) {
 		return PXENV_EXIT_FAILURE;
 	}
 
-	/* Wait for OACK to arrive so that we have the block size */
+	/* Wait for OACK (or first data block) to arrive, so that any
+	 * error in opening the file is reported to the caller.  The
+	 * underlying transfer uses the largest block size that it
+	 * can negotiate; we return blocks of the requested size.
+	 */
 	while ( ( ( rc = pxe_tftp.rc ) == -EINPROGRESS ) &&
 		( pxe_tftp.max_offset == 0 ) ) {
 		step();
 	}
-	pxe_tftp.blksize = xfer_window ( &pxe_tftp.xfer );
 	tftp_open->PacketSize = pxe_tftp.blksize;
 	DBG ( " blksize=%d", tftp_open->PacketSize );
 
@@ -306,6 +330,7 @@ static PXENV_EXIT_t pxenv_tftp_close ( struct s_PXENV_TFTP_CLOSE *tftp_close ) {
 	DBG ( "PXENV_TFTP_CLOSE" );
 
 	pxe_tftp_close ( &pxe_tftp, 0 );
+	xferbuf_free ( &pxe_tftp.xferbuf );
 	tftp_close->Status = PXENV_STATUS_SUCCESS;
 	return PXENV_EXIT_SUCCESS;
 }
@@ -372,29 +397,46 @@ static PXENV_EXIT_t pxenv_tftp_close ( struct s_PXENV_TFTP_CLOSE *tftp_close ) {
  * @ref pxe_x86_pmode16 "implementation note" for more details.)
  */
 static PXENV_EXIT_t pxenv_tftp_read ( struct s_PXENV_TFTP_READ *tftp_read ) {
+	size_t pos = pxe_tftp.pos;
+	size_t end = ( pos + pxe_tftp.blksize );
+	size_t len;
 	int rc;
 
 	DBG ( "PXENV_TFTP_READ to %04x:%04x",
 	      tftp_read->Buffer.segment, tftp_read->Buffer.offset );
 
-	/* Read single block into buffer */
-	pxe_tftp.buffer = real_to_user ( tftp_read->Buffer.segment,
-					 tftp_read->Buffer.offset );
-	pxe_tftp.size = pxe_tftp.blksize;
-	pxe_tftp.start = pxe_tftp.offset;
+	/* Poll at least once, so that the prefetch continues to make
+	 * progress even when the requested block is already present.
+	 */
+	step();
+
+	/* Wait for block to be prefetched, or for transfer to end */
 	while ( ( ( rc = pxe_tftp.rc ) == -EINPROGRESS ) &&
-		( pxe_tftp.offset == pxe_tftp.start ) )
+		( pxe_tftp.filled < end ) ) {
 		step();
-	pxe_tftp.buffer = UNULL;
-	tftp_read->BufferSize = ( pxe_tftp.offset - pxe_tftp.start );
-	tftp_read->PacketNumber = ++pxe_tftp.blkidx;
+	}
 
-	/* EINPROGRESS is normal if we haven't reached EOF yet */
-	if ( rc == -EINPROGRESS )
-		rc = 0;
+	/* Determine block length */
+	if ( pxe_tftp.filled >= end ) {
+		len = pxe_tftp.blksize;
+	} else if ( rc == 0 ) {
+		len = ( ( pxe_tftp.max_offset > pos ) ?
+			( pxe_tftp.max_offset - pos ) : 0 );
+	} else {
+		tftp_read->Status = PXENV_STATUS ( rc );
+		return PXENV_EXIT_FAILURE;
+	}
 
-	tftp_read->Status = PXENV_STATUS ( rc );
-	return ( rc ? PXENV_EXIT_FAILURE : PXENV_EXIT_SUCCESS );
+	/* Copy block from prefetch buffer */
+	memcpy_user ( real_to_user ( tftp_read->Buffer.segment,
+				     tftp_read->Buffer.offset ), 0,
+		      pxe_tftp.data, pos, len );
+	pxe_tftp.pos += len;
+	tftp_read->BufferSize = len;
+	tftp_read->PacketNumber = ++pxe_tftp.blkidx;
+
+	tftp_read->Status = PXENV_STATUS_SUCCESS;
+	return PXENV_EXIT_SUCCESS;
 }
 
 /**
@@ -573,8 +615,9 @@ static PXENV_EXIT_t pxenv_tftp_get_fsize ( struct s_PXENV_TFTP_GET_FSIZE
 	if ( rc == -EINPROGRESS )
 		rc = 0;
 
-	/* Close TFTP file */
+	/* Close TFTP file and discard any prefetched data */
 	pxe_tftp_close ( &pxe_tftp, rc );
+	xferbuf_free ( &pxe_tftp.xferbuf );
 
 	tftp_get_fsize->Status = PXENV_STATUS ( rc );
 	return ( rc ? PXENV_EXIT_FAILURE : PXENV_EXIT_SUCCESS );
@@ -14,6 +14,7 @@
 #include <ipxe/netdevice.h>
 #include <realmode.h>
 #include <pxe.h>
+#include <config/general.h>
 
 /*
  * Copyright (C) 2004 Michael Brown <mbrown@fensystems.co.uk>.
@@ -60,8 +61,30 @@ struct pxe_udp_connection {
 	struct sockaddr_in local;
 	/** List of received packets */
 	struct list_head list;
+	/** Number of received packets */
+	unsigned int count;
+	/** Number of received packets discarded due to a full queue */
+	unsigned int overflows;
+	/** Number of received packets discarded due to errors */
+	unsigned int errors;
 };
 
+/**
+ * Discard all queued PXE UDP packets
+ *
+ * @v pxe_udp			PXE UDP connection
+ */
+static void pxe_udp_discard ( struct pxe_udp_connection *pxe_udp ) {
+	struct io_buffer *iobuf;
+	struct io_buffer *tmp;
+
+	list_for_each_entry_safe ( iobuf, tmp, &pxe_udp->list, list ) {
+		list_del ( &iobuf->list );
+		free_iob ( iobuf );
+	}
+	pxe_udp->count = 0;
+}
+
 /**
  * Receive PXE UDP data
  *
@@ -79,6 +102,7 @@ static int pxe_udp_deliver ( struct pxe_udp_connection *pxe_udp,
 	struct pxe_udp_pseudo_header *pshdr;
 	struct sockaddr_in *sin_src;
 	struct sockaddr_in *sin_dest;
+	struct io_buffer *oldest;
 	int rc;
 
 	/* Extract metadata */
@@ -102,16 +126,61 @@ static int pxe_udp_deliver ( struct pxe_udp_connection *pxe_udp,
 	pshdr->dest_ip = sin_dest->sin_addr.s_addr;
 	pshdr->d_port = sin_dest->sin_port;
 
+	/* Discard oldest packet if queue is full */
+	if ( pxe_udp->count >= PXE_UDP_QUEUE_DEPTH ) {
+		oldest = list_first_entry ( &pxe_udp->list, struct io_buffer,
+					    list );
+		assert ( oldest != NULL );
+		list_del ( &oldest->list );
+		free_iob ( oldest );
+		pxe_udp->count--;
+		pxe_udp->overflows++;
+	}
+
 	/* Add to queue */
 	list_add_tail ( &iobuf->list, &pxe_udp->list );
+	pxe_udp->count++;
 
 	return 0;
 
  drop:
+	pxe_udp->errors++;
 	free_iob ( iobuf );
 	return rc;
 }
 
+/**
+ * Dequeue received PXE UDP packet
+ *
+ * @v pxe_udp			PXE UDP connection
+ * @v dest_ip			Destination IP address, or 0.0.0.0
+ * @v d_port			Destination UDP port, or 0
+ * @ret iobuf			I/O buffer (including pseudo-header), or NULL
+ *
+ * Packets that do not match the requested destination are left in
+ * the queue, to be collected by a subsequent call.
+ */
+static struct io_buffer * pxe_udp_dequeue ( struct pxe_udp_connection *pxe_udp,
+					    IP4_t dest_ip, UDP_PORT_t d_port ) {
+	struct pxe_udp_pseudo_header *pshdr;
+	struct io_buffer *iobuf;
+
+	/* Find oldest packet matching the destination filter */
+	list_for_each_entry ( iobuf, &pxe_udp->list, list ) {
+		assert ( iob_len ( iobuf ) >= sizeof ( *pshdr ) );
+		pshdr = iobuf->data;
+		if ( dest_ip && ( dest_ip != pshdr->dest_ip ) )
+			continue;
+		if ( d_port && ( d_port != pshdr->d_port ) )
+			continue;
+		list_del ( &iobuf->list );
+		pxe_udp->count--;
+		return iobuf;
+	}
+
+	return NULL;
+}
+
 /** PXE UDP data transfer interface operations */
 static struct interface_operation pxe_udp_xfer_operations[] = {
 	INTF_OP ( xfer_deliver, struct pxe_udp_connection *, pxe_udp_deliver ),
@@ -190,6 +259,10 @@ static PXENV_EXIT_t pxenv_udp_open ( struct s_PXENV_UDP_OPEN *pxenv_udp_open ) {
 		return PXENV_EXIT_FAILURE;
 	}
 
+	/* Reset statistics */
+	pxe_udp.overflows = 0;
+	pxe_udp.errors = 0;
+
 	/* Open promiscuous UDP connection */
 	intf_restart ( &pxe_udp.xfer, 0 );
 	if ( ( rc = udp_open_promisc ( &pxe_udp.xfer ) ) != 0 ) {
@@ -226,19 +299,15 @@ static PXENV_EXIT_t pxenv_udp_open ( struct s_PXENV_UDP_OPEN *pxenv_udp_open ) {
  */
 static PXENV_EXIT_t
 pxenv_udp_close ( struct s_PXENV_UDP_CLOSE *pxenv_udp_close ) {
-	struct io_buffer *iobuf;
-	struct io_buffer *tmp;
 
-	DBG ( "PXENV_UDP_CLOSE\n" );
+	DBG ( "PXENV_UDP_CLOSE (%d overflows, %d errors)\n",
+	      pxe_udp.overflows, pxe_udp.errors );
 
 	/* Close UDP connection */
 	intf_restart ( &pxe_udp.xfer, 0 );
 
 	/* Discard any received packets */
-	list_for_each_entry_safe ( iobuf, tmp, &pxe_udp.list, list ) {
-		list_del ( &iobuf->list );
-		free_iob ( iobuf );
-	}
+	pxe_udp_discard ( &pxe_udp );
 
 	pxenv_udp_close->Status = PXENV_STATUS_SUCCESS;
 	return PXENV_EXIT_SUCCESS;
@@ -393,49 +462,32 @@ pxenv_udp_write ( struct s_PXENV_UDP_WRITE *pxenv_udp_write ) {
  *
  */
 static PXENV_EXIT_t pxenv_udp_read ( struct s_PXENV_UDP_READ *pxenv_udp_read ) {
-	struct in_addr dest_ip_wanted = { .s_addr = pxenv_udp_read->dest_ip };
-	struct in_addr dest_ip;
 	struct io_buffer *iobuf;
 	struct pxe_udp_pseudo_header *pshdr;
-	uint16_t d_port_wanted = pxenv_udp_read->d_port;
-	uint16_t d_port;
 	userptr_t buffer;
 	size_t len;
 
-	/* Try receiving a packet, if the queue is empty */
-	if ( list_empty ( &pxe_udp.list ) )
-		step();
+	/* Poll for new packets.  Do this even if packets are already
+	 * queued, so that a burst of packets is moved promptly from
+	 * the (typically small) network device receive ring to our
+	 * own receive queue.
+	 */
+	step();
 
-	/* Remove first packet from the queue */
-	iobuf = list_first_entry ( &pxe_udp.list, struct io_buffer, list );
+	/* Remove first matching packet from the queue */
+	iobuf = pxe_udp_dequeue ( &pxe_udp, pxenv_udp_read->dest_ip,
+				  pxenv_udp_read->d_port );
 	if ( ! iobuf ) {
 		/* No packet received */
 		DBG2 ( "PXENV_UDP_READ\n" );
 		goto no_packet;
 	}
-	list_del ( &iobuf->list );
 
 	/* Strip pseudo-header */
-	assert ( iob_len ( iobuf ) >= sizeof ( *pshdr ) );
 	pshdr = iobuf->data;
 	iob_pull ( iobuf, sizeof ( *pshdr ) );
-	dest_ip.s_addr = pshdr->dest_ip;
-	d_port = pshdr->d_port;
 	DBG ( "PXENV_UDP_READ" );
 
-	/* Filter on destination address and/or port */
-	if ( dest_ip_wanted.s_addr &&
-	     ( dest_ip_wanted.s_addr != dest_ip.s_addr ) ) {
-		DBG ( " wrong IP %s", inet_ntoa ( dest_ip ) );
-		DBG ( " (wanted %s)\n", inet_ntoa ( dest_ip_wanted ) );
-		goto drop;
-	}
-	if ( d_port_wanted && ( d_port_wanted != d_port ) ) {
-		DBG ( " wrong port %d", htons ( d_port ) );
-		DBG ( " (wanted %d)\n", htons ( d_port_wanted ) );
-		goto drop;
-	}
-
 	/* Copy packet to buffer and record length */
 	buffer = real_to_user ( pxenv_udp_read->buffer.segment,
 				pxenv_udp_read->buffer.offset );
@@ -464,8 +516,6 @@ static PXENV_EXIT_t pxenv_udp_read ( struct s_PXENV_UDP_READ *pxenv_udp_read ) {
 	pxenv_udp_read->Status = PXENV_STATUS_SUCCESS;
 	return PXENV_EXIT_SUCCESS;
 
- drop:
-	free_iob ( iobuf );
  no_packet:
 	pxenv_udp_read->Status = PXENV_STATUS_FAILURE;
 	return PXENV_EXIT_FAILURE;
@@ -14,6 +14,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <realmode.h>
 #include <pic8259.h>
 #include <ipxe/shell.h>
+#include <ipxe/bios_sampler.h>
 
 /*
  * This file provides functions for managing librm.
@@ -234,6 +235,15 @@ interrupt_dump ( int intr, struct interrupt_frame32 *frame32,
 	DBGC_HDA ( &intr, sp, stack, STACK_DUMP_LEN );
 }
 
+/**
+ * Record sampling profiler sample (when sampling profiler is not present)
+ *
+ * @v ip		Interrupted instruction pointer
+ */
+__weak void bios_sampler_interrupt ( unsigned long ip __unused ) {
+	/* Nothing to do */
+}
+
 /**
  * Interrupt handler
  *
@@ -258,6 +268,13 @@ interrupt ( int intr, struct interrupt_frame32 *frame32,
 		shell();
 	}
 
+	/* Record sampling profiler sample, if applicable */
+	if ( intr == IRQ_INT ( 0 ) ) {
+		bios_sampler_interrupt ( ( ( sizeof ( physaddr_t ) <=
+					     sizeof ( uint32_t ) ) || frame32 ) ?
+					 frame32->eip : frame64->rip );
+	}
+
 	/* Reissue interrupt in real mode */
 	profile_start ( profiler );
 	__asm__ __volatile__ ( REAL_CODE ( "movb %%al, %%cs:(1f + 1)\n\t"
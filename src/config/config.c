@@ -123,6 +123,9 @@ REQUIRE_OBJECT ( nfs_open );
 #ifdef DOWNLOAD_PROTO_SLAM
 REQUIRE_OBJECT ( slam );
 #endif
+#ifdef DOWNLOAD_PROTO_ALC
+REQUIRE_OBJECT ( alc );
+#endif
 
 /*
  * Drag in all requested SAN boot protocols
@@ -134,6 +137,9 @@ REQUIRE_OBJECT ( iscsi );
 #ifdef SANBOOT_PROTO_HTTP
 REQUIRE_OBJECT ( httpblock );
 #endif
+#ifdef SANBOOT_PROTO_IMAGE
+REQUIRE_OBJECT ( imgblock );
+#endif
 
 /*
  * Drag in all requested resolvers
@@ -182,6 +188,15 @@ REQUIRE_OBJECT ( efi_image );
 #ifdef IMAGE_SDI
 REQUIRE_OBJECT ( sdi );
 #endif
+#ifdef IMAGE_GZIP
+REQUIRE_OBJECT ( gzip_image );
+#endif
+#ifdef IMAGE_ZSTD
+REQUIRE_OBJECT ( zstd_image );
+#endif
+#ifdef IMAGE_XZ
+REQUIRE_OBJECT ( xz_image );
+#endif
 
 /*
  * Drag in all requested commands
@@ -236,6 +251,9 @@ REQUIRE_OBJECT ( lotest_cmd );
 #ifdef VLAN_CMD
 REQUIRE_OBJECT ( vlan_cmd );
 #endif
+#ifdef BOND_CMD
+REQUIRE_OBJECT ( bond_cmd );
+#endif
 #ifdef POWEROFF_CMD
 REQUIRE_OBJECT ( poweroff_cmd );
 #endif
@@ -281,6 +299,27 @@ REQUIRE_OBJECT ( ntp_cmd );
 #ifdef CERT_CMD
 REQUIRE_OBJECT ( cert_cmd );
 #endif
+#ifdef TRACE_CMD
+REQUIRE_OBJECT ( trace_cmd );
+#endif
+#ifdef HEAPSTAT_CMD
+REQUIRE_OBJECT ( heapstat_cmd );
+#endif
+#ifdef BOOTSIM_CMD
+REQUIRE_OBJECT ( bootsim_cmd );
+#endif
+#ifdef IPERF_CMD
+REQUIRE_OBJECT ( iperf_cmd );
+#endif
+#ifdef PCAP_CMD
+REQUIRE_OBJECT ( pcap_cmd );
+#endif
+#ifdef SAMPLE_CMD
+REQUIRE_OBJECT ( sample_cmd );
+#endif
+#ifdef SANPUT_CMD
+REQUIRE_OBJECT ( sanput_cmd );
+#endif
 
 /*
  * Drag in miscellaneous objects
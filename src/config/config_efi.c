@@ -49,3 +49,12 @@ REQUIRE_OBJECT ( efi_fbcon );
 #ifdef DOWNLOAD_PROTO_FILE
 REQUIRE_OBJECT ( efi_local );
 #endif
+#ifdef HTTP_CACHE_LOCAL
+REQUIRE_OBJECT ( efi_cache );
+#endif
+#ifdef WORKER_CORES
+REQUIRE_OBJECT ( efi_mp );
+#endif
+#ifdef SAMPLE_CMD
+REQUIRE_OBJECT ( efi_sampler );
+#endif
@@ -46,6 +46,27 @@ REQUIRE_OBJECT ( httpntlm );
 #ifdef HTTP_ENC_PEERDIST
 REQUIRE_OBJECT ( peerdist );
 #endif
+#ifdef HTTP_PEERDIST_SERVER
+REQUIRE_OBJECT ( peerserv );
+#endif
+#ifdef HTTP_ENC_GZIP
+REQUIRE_OBJECT ( httpgzip );
+#endif
+#ifdef HTTP_ENC_ZSTD
+REQUIRE_OBJECT ( httpzstd );
+#endif
 #ifdef HTTP_HACK_GCE
 REQUIRE_OBJECT ( httpgce );
 #endif
+#ifdef HTTP_MULTI
+REQUIRE_OBJECT ( httpmulti );
+#endif
+#ifdef HTTP_VERSION_2
+REQUIRE_OBJECT ( http2 );
+#endif
+#ifdef HTTP_CACHE
+REQUIRE_OBJECT ( httpcache );
+#endif
+#ifdef HTTP_REDIRECT_CACHE
+REQUIRE_OBJECT ( httpredirect );
+#endif
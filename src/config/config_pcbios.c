@@ -21,6 +21,7 @@
 
 FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
+#include <config/general.h>
 #include <config/console.h>
 
 /** @file
@@ -48,3 +49,12 @@ REQUIRE_OBJECT ( vesafb );
 #ifdef CONSOLE_INT13
 REQUIRE_OBJECT ( int13con );
 #endif
+
+/*
+ * Drag in sampling profiler timer source
+ *
+ */
+
+#ifdef SAMPLE_CMD
+REQUIRE_OBJECT ( bios_sampler );
+#endif
@@ -12,9 +12,27 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 /** RSA public-key algorithm */
 #define CRYPTO_PUBKEY_RSA
 
+/** ECDSA public-key algorithm */
+#define CRYPTO_PUBKEY_ECDSA
+
+/** Ephemeral Elliptic Curve Diffie-Hellman key exchange */
+#define CRYPTO_EXCHANGE_ECDHE
+
+/** X25519 elliptic curve */
+#define CRYPTO_CURVE_X25519
+
+/** NIST P-256 elliptic curve */
+#define CRYPTO_CURVE_P256
+
 /** AES-CBC block cipher */
 #define CRYPTO_CIPHER_AES_CBC
 
+/** AES-GCM authenticated cipher */
+#define CRYPTO_CIPHER_AES_GCM
+
+/** ChaCha20-Poly1305 authenticated cipher */
+#define CRYPTO_CIPHER_CHACHA20_POLY1305
+
 /** MD5 digest algorithm
  *
  * Note that use of MD5 is implicit when using TLSv1.1 or earlier.
@@ -14,6 +14,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #define PCIAPI_EFI
 #define CONSOLE_EFI
 #define TIMER_EFI
+#define HRCLOCK_EFI
 #define UMALLOC_EFI
 #define SMBIOS_EFI
 #define SANBOOT_EFI
@@ -33,6 +34,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #define	SANBOOT_PROTO_IB_SRP	/* Infiniband SCSI RDMA protocol */
 #define	SANBOOT_PROTO_FCP	/* Fibre Channel protocol */
 #define	SANBOOT_PROTO_HTTP	/* HTTP SAN protocol */
+#define	SANBOOT_PROTO_IMAGE	/* Downloaded image SAN protocol */
 
 #define	USB_HCD_XHCI		/* xHCI USB host controller */
 #define	USB_HCD_EHCI		/* EHCI USB host controller */
@@ -44,6 +46,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #if defined ( __i386__ ) || defined ( __x86_64__ )
 #define IOAPI_X86
 #define NAP_EFIX86
+#define HRCLOCK_RDTSC
 #define	CPUID_CMD		/* x86 CPU feature detection command */
 #endif
 
@@ -52,4 +55,8 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #define NAP_EFIARM
 #endif
 
+#if defined ( __aarch64__ )
+#define HRCLOCK_ARM64
+#endif
+
 #endif /* CONFIG_DEFAULTS_EFI_H */
@@ -11,6 +11,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #define CONSOLE_LINUX
 #define TIMER_LINUX
+#define HRCLOCK_LINUX
 #define UACCESS_LINUX
 #define UMALLOC_LINUX
 #define NAP_LINUX
@@ -30,5 +31,6 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define SANBOOT_PROTO_IB_SRP
 #define SANBOOT_PROTO_FCP
 #define SANBOOT_PROTO_HTTP
+#define SANBOOT_PROTO_IMAGE
 
 #endif /* CONFIG_DEFAULTS_LINUX_H */
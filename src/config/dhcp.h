@@ -39,6 +39,14 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #define DHCP_DISC_PROXY_TIMEOUT_SEC	2
 //#define DHCP_DISC_PROXY_TIMEOUT_SEC	11	/* as per PXE spec */
 
+/*
+ * A request for a previously leased address (the RFC 2131
+ * INIT-REBOOT state) will receive no response from a server that has
+ * no record of the lease.  We'll give up and fall back to discovery
+ * after this timeout.
+ */
+#define DHCP_REBOOT_TIMEOUT_SEC		1
+
 /*
  * Per the PXE spec, requests are also tried 4 times, but at timeout
  * intervals of 1, 2, 3, 4 seconds.  To adapt this to an exponential
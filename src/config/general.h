@@ -57,6 +57,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #define	DOWNLOAD_PROTO_HTTPS	/* Secure Hypertext Transfer Protocol */
 #undef	DOWNLOAD_PROTO_FTP	/* File Transfer Protocol */
 #undef	DOWNLOAD_PROTO_SLAM	/* Scalable Local Area Multicast */
+#undef	DOWNLOAD_PROTO_ALC	/* Asynchronous Layered Coding multicast */
 #undef	DOWNLOAD_PROTO_NFS	/* Network File System Protocol */
 //#undef DOWNLOAD_PROTO_FILE	/* Local filesystem access */
 
@@ -70,6 +71,60 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 //#undef	SANBOOT_PROTO_IB_SRP	/* Infiniband SCSI RDMA protocol */
 //#undef	SANBOOT_PROTO_FCP	/* Fibre Channel protocol */
 //#undef	SANBOOT_PROTO_HTTP	/* HTTP SAN protocol */
+//#undef	SANBOOT_PROTO_IMAGE	/* Downloaded image SAN protocol */
+
+/*
+ * AoE tuning
+ *
+ * AOE_MAX_WINDOW sets the maximum number of AoE commands that may be
+ * outstanding to a single device.  The actual number is adapted to
+ * the observed packet loss, and is further limited by the target's
+ * advertised buffer count.
+ *
+ */
+#define AOE_MAX_WINDOW		32
+
+/*
+ * SCSI tuning
+ *
+ * SCSI_QUEUE_DEPTH sets the maximum number of command parts that may
+ * be outstanding to a single SCSI device.  Large reads and writes
+ * are split into up to this many parts, which are issued as the
+ * underlying transport's flow-control window permits.
+ *
+ */
+#define SCSI_QUEUE_DEPTH	8
+
+/*
+ * PXE UDP tuning
+ *
+ * PXE_UDP_QUEUE_DEPTH sets the maximum number of received packets
+ * that may be queued awaiting collection via PXENV_UDP_READ.  If the
+ * queue is full, the oldest queued packet will be discarded.
+ *
+ */
+#define PXE_UDP_QUEUE_DEPTH	32
+
+/*
+ * Heap size
+ *
+ * HEAP_TARGET_SIZE sets the size to which the internal heap may be
+ * extended, using external memory, when it would otherwise run out
+ * of space.  This may be overridden at runtime using the "heap-size"
+ * setting.  Set to zero to disable heap extension.
+ *
+ */
+#define HEAP_TARGET_SIZE	( 4 * 1024 * 1024 )
+
+/*
+ * SAN block cache
+ *
+ * SAN_CACHE_MAX_SIZE sets the size of the block cache allocated for
+ * each SAN device.  A smaller cache will be used if memory is short.
+ * Set to zero to disable caching.
+ *
+ */
+#define SAN_CACHE_MAX_SIZE	( 4 * 1024 * 1024 )
 
 /*
  * HTTP extensions
@@ -79,7 +134,15 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #define HTTP_AUTH_DIGEST	/* Digest authentication */
 //#define HTTP_AUTH_NTLM	/* NTLM authentication */
 //#define HTTP_ENC_PEERDIST	/* PeerDist content encoding */
+//#define HTTP_PEERDIST_SERVER	/* Serve PeerDist content to peers */
+//#define HTTP_ENC_GZIP		/* gzip content encoding */
+//#define HTTP_ENC_ZSTD		/* Zstandard content encoding */
 //#define HTTP_HACK_GCE		/* Google Compute Engine hacks */
+//#define HTTP_MULTI		/* Parallel multi-connection downloads */
+//#define HTTP_VERSION_2	/* HTTP/2 multiplexed connections via HTTPS */
+//#define HTTP_CACHE		/* Cache downloaded images for revalidation */
+//#define HTTP_CACHE_LOCAL	/* Persist image cache to local disk (EFI only) */
+//#define HTTP_REDIRECT_CACHE	/* Cache HTTP redirection targets */
 
 /*
  * 802.11 cryptosystems and handshaking protocols
@@ -116,6 +179,9 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #define	IMAGE_PNG		/* PNG image support */
 #define	IMAGE_DER		/* DER image support */
 #define	IMAGE_PEM		/* PEM image support */
+//#define	IMAGE_GZIP		/* gzip compressed image support */
+//#define	IMAGE_ZSTD		/* Zstandard compressed image support */
+//#define	IMAGE_XZ		/* xz compressed image support */
 
 /*
  * Command-line commands to include
@@ -141,6 +207,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 //#define DIGEST_CMD		/* Image crypto digest commands */
 //#define LOTEST_CMD		/* Loopback testing commands */
 //#define VLAN_CMD		/* VLAN commands */
+//#define BOND_CMD		/* Link aggregation commands */
 //#define PXE_CMD		/* PXE commands */
 //#define REBOOT_CMD		/* Reboot command */
 //#define POWEROFF_CMD		/* Power off command */
@@ -154,6 +221,30 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 //#define PROFSTAT_CMD		/* Profiling commands */
 //#define NTP_CMD		/* NTP commands */
 //#define CERT_CMD		/* Certificate management commands */
+//#define TRACE_CMD		/* Boot timeline tracing commands */
+//#define HEAPSTAT_CMD		/* Heap statistics command */
+//#define BOOTSIM_CMD		/* Multi-client boot simulation command */
+//#define IPERF_CMD		/* TCP throughput testing command */
+//#define PCAP_CMD		/* Packet capture commands */
+//#define SAMPLE_CMD		/* Sampling profiler commands */
+//#define SANPUT_CMD		/* SAN device upload command */
+
+/*
+ * Autoboot options
+ *
+ */
+#undef	AUTOBOOT_PARALLEL	/* Configure all network devices concurrently */
+
+/*
+ * PCI probe filter
+ *
+ * PCI_PROBE_FILTER restricts the PCI devices probed at startup to a
+ * comma-separated list of "vvvv:dddd" vendor and device IDs and/or
+ * "[ssss:]bb:dd.f" bus locations, e.g. "8086:1572,00:19.0".  Any
+ * skipped devices will be probed later only if no usable network
+ * device is found when attempting to autoboot.
+ */
+//#define PCI_PROBE_FILTER	"8086:1572,00:19.0"
 
 /*
  * ROM-specific options
@@ -162,6 +253,15 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #undef	NONPNP_HOOK_INT19	/* Hook INT19 on non-PnP BIOSes */
 #define	AUTOBOOT_ROM_FILTER	/* Autoboot only devices matching our ROM */
 
+/*
+ * BIOS image compression
+ *
+ * LZ4 decompresses much faster than LZMA, but produces a larger
+ * image which may exceed the size limit for an option ROM.
+ *
+ */
+//#define	COMPRESS_LZ4		/* Use LZ4 (faster to decompress) not LZMA */
+
 /*
  * Virtual network devices
  *
@@ -193,6 +293,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #undef	GDBUDP			/* Remote GDB debugging over UDP
 				 * (both may be set) */
 //#define EFI_DOWNGRADE_UX	/* Downgrade UEFI user experience */
+//#define WORKER_CORES		/* Offload work to secondary CPU cores (EFI only) */
 #define	TIVOLI_VMM_WORKAROUND	/* Work around the Tivoli VMM's garbling of SSE
 				 * registers when iPXE traps to it due to
 				 * privileged instructions */
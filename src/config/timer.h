@@ -13,6 +13,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 //#undef		TIMER_PCBIOS
 //#define		TIMER_RDTSC
+//#undef		HRCLOCK_RDTSC
 
 #include <config/local/timer.h>
 
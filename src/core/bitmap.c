@@ -24,6 +24,7 @@
 FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 #include <errno.h>
+#include <strings.h>
 #include <ipxe/bitmap.h>
 
 /** @file
@@ -100,7 +101,48 @@ void bitmap_set ( struct bitmap *bitmap, unsigned int bit ) {
 	bitmap->blocks[index] |= mask;
 
 	/* Update first gap counter */
-	while ( bitmap_test ( bitmap, bitmap->first_gap ) ) {
-		bitmap->first_gap++;
+	if ( bit == bitmap->first_gap )
+		bitmap->first_gap = bitmap_find ( bitmap, bit, 0 );
+}
+
+/**
+ * Find next bit with a given value
+ *
+ * @v bitmap		Bitmap
+ * @v bit		Starting bit index
+ * @v set		Find a set (rather than an unset) bit
+ * @ret bit		Index of next matching bit, or bitmap length if none
+ *
+ * Bits are examined a whole block at a time, so that long runs of
+ * received (or missing) bits can be skipped efficiently.
+ */
+unsigned int bitmap_find ( struct bitmap *bitmap, unsigned int bit,
+			   int set ) {
+	unsigned int index = BITMAP_INDEX ( bit );
+	bitmap_block_t block;
+
+	while ( bit < bitmap->length ) {
+
+		/* Find any matching bits within this block, excluding
+		 * bits before the starting bit.
+		 */
+		block = bitmap->blocks[index];
+		if ( ! set )
+			block = ~block;
+		block &= ~( BITMAP_MASK ( bit ) - 1 );
+		if ( block ) {
+			bit = ( ( index * BITMAP_BLKSIZE ) +
+				( ffsl ( block ) - 1 ) );
+			break;
+		}
+
+		/* Move to start of next block */
+		bit = ( ++index * BITMAP_BLKSIZE );
 	}
+
+	/* Clamp to length of bitmap */
+	if ( bit > bitmap->length )
+		bit = bitmap->length;
+
+	return bit;
 }
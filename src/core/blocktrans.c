@@ -28,6 +28,18 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  *
  * Block device translator
  *
+ * The translator presents a data transfer interface (such as an HTTP
+ * range request) as a block device command.  For a read, delivered
+ * data is written straight into the caller's data buffer at the
+ * delivered offset as each I/O buffer arrives.  No intermediate
+ * buffer is allocated, and the data is never copied a second time.
+ * Any attempt to deliver data beyond the end of the caller's buffer
+ * will fail, since the buffer cannot be reallocated.
+ *
+ * For a read capacity command, no data buffer is provided.  Only the
+ * length of the underlying resource (as reported via a seek) is
+ * recorded.
+ *
  */
 
 #include <stdlib.h>
@@ -2,6 +2,7 @@
 #include <ipxe/console.h>
 #include <ipxe/process.h>
 #include <ipxe/nap.h>
+#include <ipxe/hrclock.h>
 
 /** @file */
 
@@ -16,6 +17,23 @@ unsigned int console_width = CONSOLE_DEFAULT_WIDTH;
 /** Console height */
 unsigned int console_height = CONSOLE_DEFAULT_HEIGHT;
 
+/**
+ * Minimum interval between unsuccessful input checks (in microseconds)
+ *
+ * Checking for input may require a call into the firmware (e.g. a
+ * real-mode INT 16 call under BIOS).  Wait loops such as
+ * monojob_wait() check for a keypress on every scheduler iteration,
+ * which would otherwise spend a significant amount of time in the
+ * firmware while a download is in progress.
+ */
+#define CONSOLE_POLL_INTERVAL_US 5000
+
+/** Most recent input check found no input available */
+static int console_idle;
+
+/** Time of most recent unsuccessful input check (in microseconds) */
+static uint64_t console_idle_us;
+
 /**
  * Write a single character to each console device
  *
@@ -97,8 +115,12 @@ int getchar ( void ) {
 		 * power dissipation of a modern CPU considerably, and also
 		 * makes Etherboot waiting for user interaction waste a lot
 		 * less CPU time in a VMware session.
+		 *
+		 * Avoid dozing while there is network activity, since
+		 * that would limit packet processing to the timer
+		 * interrupt rate.
 		 */
-		cpu_nap();
+		cpu_idle();
 
 		/* Keep processing background tasks while we wait for
 		 * input.
@@ -106,6 +128,9 @@ int getchar ( void ) {
 		step();
 	}
 
+	/* Allow an immediate check for any following input */
+	console_idle = 0;
+
 	/* CR -> LF translation */
 	if ( character == '\r' )
 		character = '\n';
@@ -123,9 +148,28 @@ int getchar ( void ) {
  * device has input available, this call will return true.  If this
  * call returns true, you can then safely call getchar() without
  * blocking.
+ *
+ * To limit the cost of frequent checks, the consoles will not be
+ * rechecked within CONSOLE_POLL_INTERVAL_US of finding no input.
  */
 int iskey ( void ) {
-	return has_input() ? 1 : 0;
+	uint64_t now = hrclock_us();
+
+	/* Avoid rechecking too soon after finding no input */
+	if ( console_idle &&
+	     ( ( now - console_idle_us ) < CONSOLE_POLL_INTERVAL_US ) )
+		return 0;
+
+	/* Check for input */
+	if ( has_input() ) {
+		console_idle = 0;
+		return 1;
+	}
+
+	/* Record time of unsuccessful check */
+	console_idle = 1;
+	console_idle_us = now;
+	return 0;
 }
 
 /**
@@ -29,6 +29,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  *
  */
 
+#include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <ipxe/cpio.h>
@@ -45,3 +46,87 @@ void cpio_set_field ( char *field, unsigned long value ) {
 	snprintf ( buf, sizeof ( buf ), "%08lx", value );
 	memcpy ( field, buf, 8 );
 }
+
+/**
+ * Get CPIO image filename length
+ *
+ * @v image		Image
+ * @ret len		Length of filename (excluding NUL), or zero
+ *
+ * The filename is taken from the image command line, and is
+ * terminated by the first space (if any).  Any remaining portion of
+ * the command line is treated as a list of parameters.
+ */
+size_t cpio_name_len ( struct image *image ) {
+	const char *name = cpio_name ( image );
+	const char *sep;
+
+	/* Images with no command line are assumed to be prebuilt */
+	if ( ! name )
+		return 0;
+
+	/* Filename is terminated by the first space, if any */
+	sep = strchr ( name, ' ' );
+	return ( sep ? ( ( size_t ) ( sep - name ) ) : strlen ( name ) );
+}
+
+/**
+ * Parse CPIO image parameters
+ *
+ * @v image		Image
+ * @v cpio		CPIO header to fill in
+ */
+static void cpio_parse_cmdline ( struct image *image,
+				 struct cpio_header *cpio ) {
+	const char *cmdline;
+	char *arg;
+	char *end;
+	unsigned int mode;
+
+	/* Skip image filename */
+	cmdline = ( cpio_name ( image ) + cpio_name_len ( image ) );
+
+	/* Look for "mode=" */
+	if ( ( arg = strstr ( cmdline, "mode=" ) ) ) {
+		arg += 5;
+		mode = strtoul ( arg, &end, 8 /* Octal for file mode */ );
+		if ( *end && ( *end != ' ' ) ) {
+			DBGC ( image, "CPIO %p strange \"mode=\" "
+			       "terminator '%c'\n", image, *end );
+		}
+		cpio_set_field ( cpio->c_mode, ( 0100000 | mode ) );
+	}
+}
+
+/**
+ * Construct CPIO header for image, if applicable
+ *
+ * @v image		Image
+ * @v cpio		CPIO header to fill in
+ * @ret name_len	Length of filename (including NUL), or zero
+ *
+ * Images with no filename are assumed to already be CPIO archives
+ * (or other prebuilt initrds), and require no header.  The filename
+ * itself follows the header and is padded to CPIO_ALIGN; this is left
+ * to the caller.
+ */
+size_t cpio_header ( struct image *image, struct cpio_header *cpio ) {
+	size_t name_len;
+
+	/* Prebuilt images require no header */
+	name_len = cpio_name_len ( image );
+	if ( ! name_len )
+		return 0;
+	name_len += 1 /* NUL */;
+
+	/* Construct header */
+	memset ( cpio, '0', sizeof ( *cpio ) );
+	memcpy ( cpio->c_magic, CPIO_MAGIC, sizeof ( cpio->c_magic ) );
+	cpio_set_field ( cpio->c_mode, 0100644 );
+	cpio_set_field ( cpio->c_nlink, 1 );
+	cpio_set_field ( cpio->c_filesize, image->len );
+	cpio_set_field ( cpio->c_namesize, name_len );
+	cpio_parse_cmdline ( image, cpio );
+
+	return name_len;
+}
@@ -0,0 +1,733 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <ipxe/refcnt.h>
+#include <ipxe/interface.h>
+#include <ipxe/xfer.h>
+#include <ipxe/xferbuf.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/umalloc.h>
+#include <ipxe/uaccess.h>
+#include <ipxe/image.h>
+#include <ipxe/decompress.h>
+
+/** @file
+ *
+ * Streaming decompression
+ *
+ * A decompression filter may be inserted into a data transfer
+ * pipeline in order to decompress data as it is received.  The
+ * decompressed output is accumulated within a sliding window buffer
+ * (which retains the history required for back-references) and is
+ * delivered onwards as it is produced.
+ *
+ * A decompression filter may also be inserted into an image download
+ * without specifying a decompression algorithm, in which case the
+ * compression format will be detected from the magic signature at the
+ * start of the data.  Data in an unrecognised format will be passed
+ * through unmodified.
+ *
+ */
+
+/* Disambiguate the various error causes */
+#define EINVAL_TRUNCATED __einfo_error ( EINFO_EINVAL_TRUNCATED )
+#define EINFO_EINVAL_TRUNCATED						\
+	__einfo_uniqify ( EINFO_EINVAL, 0x01, "Truncated compressed data" )
+#define EINVAL_STALLED __einfo_error ( EINFO_EINVAL_STALLED )
+#define EINFO_EINVAL_STALLED						\
+	__einfo_uniqify ( EINFO_EINVAL, 0x02, "Decompression stalled" )
+#define ENOTSUP_ORDER __einfo_error ( EINFO_ENOTSUP_ORDER )
+#define EINFO_ENOTSUP_ORDER						\
+	__einfo_uniqify ( EINFO_ENOTSUP, 0x01, "Out-of-order compressed data" )
+
+/** Compressed data received out of order */
+struct decompress_queued {
+	/** List of out-of-order data */
+	struct list_head list;
+	/** Position within compressed data */
+	size_t pos;
+	/** I/O buffer */
+	struct io_buffer *iobuf;
+};
+
+/** A decompression filter */
+struct decompress_filter {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** Data transfer interface (for decompressed data) */
+	struct interface xfer;
+	/** Source interface (for compressed data) */
+	struct interface source;
+
+	/** Decompression algorithm (or NULL if not yet detected) */
+	struct decompressor *decompressor;
+	/** Decompressor context */
+	void *ctx;
+	/** Data is being passed through unmodified */
+	int passthru;
+
+	/** Current position within compressed data */
+	size_t pos;
+	/** Length of compressed data received in order */
+	size_t received;
+	/** Compressed data received out of order (sorted by position) */
+	struct list_head queue;
+	/** Maximum seek position (while detecting format) */
+	size_t presize;
+	/** Magic signature detection buffer */
+	uint8_t magic[DECOMPRESS_MAGIC_MAX];
+	/** Length of magic signature detection buffer */
+	size_t magic_len;
+
+	/** Window buffer */
+	userptr_t buffer;
+	/** Length of window buffer */
+	size_t len;
+	/** Current output offset within window buffer */
+	size_t offset;
+};
+
+/**
+ * Free decompression filter
+ *
+ * @v refcnt		Reference count
+ */
+static void decompress_free ( struct refcnt *refcnt ) {
+	struct decompress_filter *filter =
+		container_of ( refcnt, struct decompress_filter, refcnt );
+	struct decompress_queued *queued;
+	struct decompress_queued *tmp;
+
+	list_for_each_entry_safe ( queued, tmp, &filter->queue, list ) {
+		list_del ( &queued->list );
+		free_iob ( queued->iobuf );
+		free ( queued );
+	}
+	if ( filter->decompressor )
+		filter->decompressor->fini ( filter->ctx );
+	free ( filter->ctx );
+	ufree ( filter->buffer );
+	free ( filter );
+}
+
+/**
+ * Start decompression
+ *
+ * @v filter		Decompression filter
+ * @v decompressor	Decompression algorithm
+ * @ret rc		Return status code
+ */
+static int decompress_start ( struct decompress_filter *filter,
+			      struct decompressor *decompressor ) {
+	void *ctx;
+	int rc;
+
+	/* Allocate context */
+	ctx = zalloc ( decompressor->ctxsize );
+	if ( ! ctx )
+		return -ENOMEM;
+
+	/* Initialise decompressor */
+	if ( ( rc = decompressor->init ( ctx ) ) != 0 ) {
+		DBGC ( filter, "DECOMPRESS %p could not initialise %s: %s\n",
+		       filter, decompressor->name, strerror ( rc ) );
+		free ( ctx );
+		return rc;
+	}
+	filter->decompressor = decompressor;
+	filter->ctx = ctx;
+	DBGC ( filter, "DECOMPRESS %p using %s\n", filter, decompressor->name );
+
+	return 0;
+}
+
+/**
+ * Start passing through unmodified data
+ *
+ * @v filter		Decompression filter
+ * @v iobuf		I/O buffer, or NULL
+ * @v pos		Position of I/O buffer within data
+ * @ret rc		Return status code
+ *
+ * Any size hint and any data accumulated while attempting to detect
+ * the compression format will be replayed before delivering the I/O
+ * buffer.  Any data received out of order will be delivered after
+ * the I/O buffer.
+ */
+static int decompress_passthru ( struct decompress_filter *filter,
+				 struct io_buffer *iobuf, size_t pos ) {
+	struct decompress_queued *queued;
+	struct xfer_metadata meta;
+	int rc;
+
+	/* Mark as passing through */
+	DBGC ( filter, "DECOMPRESS %p passing through unrecognised data\n",
+	       filter );
+	filter->passthru = 1;
+
+	/* Replay size hint, if any */
+	if ( filter->presize &&
+	     ( ( ( rc = xfer_seek ( &filter->xfer, filter->presize ) ) != 0 ) ||
+	       ( ( rc = xfer_seek ( &filter->xfer, 0 ) ) != 0 ) ) )
+		goto err;
+
+	/* Replay accumulated data, if any */
+	if ( filter->magic_len &&
+	     ( ( rc = xfer_deliver_raw ( &filter->xfer, filter->magic,
+					 filter->magic_len ) ) != 0 ) )
+		goto err;
+
+	/* Deliver I/O buffer, if any */
+	memset ( &meta, 0, sizeof ( meta ) );
+	meta.flags = XFER_FL_ABS_OFFSET;
+	if ( iobuf ) {
+		meta.offset = pos;
+		if ( ( rc = xfer_deliver ( &filter->xfer, iob_disown ( iobuf ),
+					   &meta ) ) != 0 )
+			return rc;
+	}
+
+	/* Deliver any out-of-order data */
+	while ( ( queued = list_first_entry ( &filter->queue,
+					      struct decompress_queued,
+					      list ) ) ) {
+		list_del ( &queued->list );
+		iobuf = queued->iobuf;
+		meta.offset = queued->pos;
+		free ( queued );
+		if ( ( rc = xfer_deliver ( &filter->xfer, iobuf,
+					   &meta ) ) != 0 )
+			return rc;
+	}
+
+	return 0;
+
+ err:
+	free_iob ( iobuf );
+	return rc;
+}
+
+/**
+ * Close decompression filter
+ *
+ * @v filter		Decompression filter
+ * @v rc		Reason for close
+ */
+static void decompress_close ( struct decompress_filter *filter, int rc ) {
+
+	/* Pass through any data accumulated while attempting to
+	 * detect the compression format.
+	 */
+	if ( ( rc == 0 ) && ( ! filter->decompressor ) &&
+	     ( ! filter->passthru ) ) {
+		rc = decompress_passthru ( filter, NULL, 0 );
+	}
+
+	/* Treat a successful close as an error unless decompression
+	 * has finished and all data has been received in order.
+	 */
+	if ( ( rc == 0 ) && filter->decompressor &&
+	     ( ( ! filter->decompressor->finished ( filter->ctx ) ) ||
+	       ( ! list_empty ( &filter->queue ) ) ) ) {
+		DBGC ( filter, "DECOMPRESS %p %s data truncated\n",
+		       filter, filter->decompressor->name );
+		rc = -EINVAL_TRUNCATED;
+	}
+
+	/* Shut down interfaces */
+	intfs_shutdown ( rc, &filter->source, &filter->xfer, NULL );
+}
+
+/**
+ * Ensure that sufficient output space is available
+ *
+ * @v filter		Decompression filter
+ * @ret rc		Return status code
+ */
+static int decompress_space ( struct decompress_filter *filter ) {
+	size_t history;
+	size_t keep;
+	size_t len;
+	userptr_t buffer;
+
+	/* Do nothing if we already have sufficient space */
+	if ( ( filter->len - filter->offset ) >= DECOMPRESS_SPACE )
+		return 0;
+
+	/* Slide window, retaining only the required history */
+	history = filter->decompressor->history ( filter->ctx );
+	keep = ( ( filter->offset < history ) ? filter->offset : history );
+	memmove_user ( filter->buffer, 0, filter->buffer,
+		       ( filter->offset - keep ), keep );
+	filter->offset = keep;
+
+	/* Enlarge buffer if necessary */
+	len = ( keep + DECOMPRESS_SPACE );
+	if ( len > filter->len ) {
+		buffer = urealloc ( filter->buffer, len );
+		if ( ! buffer ) {
+			DBGC ( filter, "DECOMPRESS %p could not allocate %#zx "
+			       "byte window\n", filter, len );
+			return -ENOMEM;
+		}
+		filter->buffer = buffer;
+		filter->len = len;
+	}
+
+	return 0;
+}
+
+/**
+ * Deliver decompressed data
+ *
+ * @v filter		Decompression filter
+ * @v offset		Starting offset within window buffer
+ * @v len		Length of decompressed data
+ * @ret rc		Return status code
+ */
+static int decompress_output ( struct decompress_filter *filter,
+			       size_t offset, size_t len ) {
+	struct io_buffer *iobuf;
+	size_t frag;
+	int rc;
+
+	while ( len ) {
+
+		/* Allocate I/O buffer */
+		frag = len;
+		if ( frag > DECOMPRESS_MAX_IOB )
+			frag = DECOMPRESS_MAX_IOB;
+		iobuf = xfer_alloc_iob ( &filter->xfer, frag );
+		if ( ! iobuf )
+			return -ENOMEM;
+
+		/* Populate and deliver I/O buffer */
+		copy_from_user ( iob_put ( iobuf, frag ), filter->buffer,
+				 offset, frag );
+		if ( ( rc = xfer_deliver_iob ( &filter->xfer, iobuf ) ) != 0 )
+			return rc;
+		offset += frag;
+		len -= frag;
+	}
+
+	return 0;
+}
+
+/**
+ * Decompress data
+ *
+ * @v filter		Decompression filter
+ * @v data		Compressed data
+ * @v len		Length of compressed data
+ * @ret rc		Return status code
+ */
+static int decompress_inflate ( struct decompress_filter *filter,
+				const void *data, size_t len ) {
+	struct decompressor *decompressor = filter->decompressor;
+	struct deflate_chunk in;
+	struct deflate_chunk out;
+	size_t consumed;
+	size_t produced;
+	int rc;
+
+	/* Decompress data */
+	deflate_chunk_init ( &in, virt_to_user ( data ), 0, len );
+	while ( in.offset < in.len ) {
+
+		/* Ensure that we have space for the output */
+		if ( ( rc = decompress_space ( filter ) ) != 0 )
+			return rc;
+
+		/* Decompress as much as possible */
+		deflate_chunk_init ( &out, filter->buffer, filter->offset,
+				     filter->len );
+		consumed = in.offset;
+		rc = decompressor->inflate ( filter->ctx, &in, &out );
+		consumed = ( in.offset - consumed );
+		produced = ( out.offset - filter->offset );
+		if ( rc != 0 ) {
+			DBGC ( filter, "DECOMPRESS %p %s failed: %s\n",
+			       filter, decompressor->name, strerror ( rc ) );
+			return rc;
+		}
+
+		/* Deliver decompressed data */
+		if ( ( rc = decompress_output ( filter, filter->offset,
+						produced ) ) != 0 )
+			return rc;
+		filter->offset = out.offset;
+
+		/* Sanity check */
+		if ( ! ( consumed || produced ) ) {
+			DBGC ( filter, "DECOMPRESS %p %s stalled\n",
+			       filter, decompressor->name );
+			return -EINVAL_STALLED;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Detect compression format
+ *
+ * @v filter		Decompression filter
+ * @v iobuf		I/O buffer
+ * @v pos		Position of I/O buffer within compressed data
+ * @ret rc		Return status code
+ */
+static int decompress_detect ( struct decompress_filter *filter,
+			       struct io_buffer *iobuf, size_t pos ) {
+	struct image_decompressor *format;
+	size_t len = iob_len ( iobuf );
+	size_t total;
+	size_t cmp;
+	int partial = 0;
+	int rc;
+
+	/* Append to detection buffer */
+	total = ( filter->magic_len + len );
+	if ( total > sizeof ( filter->magic ) )
+		total = sizeof ( filter->magic );
+	memcpy ( &filter->magic[filter->magic_len], iobuf->data,
+		 ( total - filter->magic_len ) );
+
+	/* Identify compression format */
+	for_each_table_entry ( format, IMAGE_DECOMPRESSORS ) {
+
+		/* Skip non-matching formats */
+		assert ( format->len <= sizeof ( filter->magic ) );
+		cmp = ( ( total < format->len ) ? total : format->len );
+		if ( memcmp ( filter->magic, format->magic, cmp ) != 0 )
+			continue;
+
+		/* Wait for more data if the match is not yet complete */
+		if ( cmp < format->len ) {
+			partial = 1;
+			continue;
+		}
+
+		/* Decompress accumulated data and I/O buffer */
+		filter->received += len;
+		if ( ( rc = decompress_start ( filter,
+					       format->decompressor ) ) != 0 )
+			goto err;
+		if ( ( rc = decompress_inflate ( filter, filter->magic,
+						 filter->magic_len ) ) != 0 )
+			goto err;
+		if ( ( rc = decompress_inflate ( filter, iobuf->data,
+						 len ) ) != 0 )
+			goto err;
+		free_iob ( iobuf );
+		return 0;
+	}
+
+	/* Accumulate data if a format may still match */
+	if ( partial ) {
+		assert ( total == ( filter->magic_len + len ) );
+		filter->magic_len = total;
+		filter->received += len;
+		free_iob ( iobuf );
+		return 0;
+	}
+
+	/* Pass through unrecognised data */
+	return decompress_passthru ( filter, iobuf, pos );
+
+ err:
+	free_iob ( iobuf );
+	return rc;
+}
+
+/**
+ * Process compressed data received in order
+ *
+ * @v filter		Decompression filter
+ * @v iobuf		I/O buffer
+ * @v pos		Position of I/O buffer within compressed data
+ * @ret rc		Return status code
+ */
+static int decompress_process ( struct decompress_filter *filter,
+				struct io_buffer *iobuf, size_t pos ) {
+	size_t len = iob_len ( iobuf );
+	int rc;
+
+	/* Check that data is received in order */
+	if ( pos != filter->received ) {
+		DBGC ( filter, "DECOMPRESS %p received overlapping data at "
+		       "%#zx (expected %#zx)\n", filter, pos,
+		       filter->received );
+		rc = -ENOTSUP_ORDER;
+		goto err;
+	}
+
+	/* Detect compression format, if applicable */
+	if ( ! filter->decompressor )
+		return decompress_detect ( filter, iobuf, pos );
+
+	/* Decompress data */
+	filter->received += len;
+	if ( ( rc = decompress_inflate ( filter, iobuf->data, len ) ) != 0 )
+		goto err;
+
+	free_iob ( iobuf );
+	return 0;
+
+ err:
+	free_iob ( iobuf );
+	return rc;
+}
+
+/**
+ * Hold compressed data received out of order
+ *
+ * @v filter		Decompression filter
+ * @v iobuf		I/O buffer
+ * @v pos		Position of I/O buffer within compressed data
+ * @ret rc		Return status code
+ */
+static int decompress_enqueue ( struct decompress_filter *filter,
+				struct io_buffer *iobuf, size_t pos ) {
+	struct decompress_queued *queued;
+	struct decompress_queued *next;
+
+	/* Allocate and populate queue entry */
+	queued = malloc ( sizeof ( *queued ) );
+	if ( ! queued ) {
+		free_iob ( iobuf );
+		return -ENOMEM;
+	}
+	queued->pos = pos;
+	queued->iobuf = iobuf;
+	DBGC2 ( filter, "DECOMPRESS %p holding out-of-order data at %#zx "
+		"(expected %#zx)\n", filter, pos, filter->received );
+
+	/* Add to queue */
+	list_for_each_entry ( next, &filter->queue, list ) {
+		if ( pos < next->pos )
+			break;
+	}
+	list_add_tail ( &queued->list, &next->list );
+
+	return 0;
+}
+
+/**
+ * Receive compressed data
+ *
+ * @v filter		Decompression filter
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ *
+ * Any positioning metadata refers to the compressed data.  Seeks
+ * without data are ignored.  Data received out of order is held
+ * until all preceding data has been received, since neither format
+ * detection nor decompression can start in the middle of the data.
+ */
+static int decompress_deliver ( struct decompress_filter *filter,
+				struct io_buffer *iobuf,
+				struct xfer_metadata *meta ) {
+	struct decompress_queued *queued;
+	size_t len = iob_len ( iobuf );
+	size_t pos;
+	int rc;
+
+	/* Pass through unrecognised data unmodified */
+	if ( filter->passthru )
+		return xfer_deliver ( &filter->xfer, iobuf, meta );
+
+	/* Calculate position */
+	pos = ( ( meta->flags & XFER_FL_ABS_OFFSET ) ? 0 : filter->pos );
+	pos += meta->offset;
+	filter->pos = ( pos + len );
+
+	/* Ignore seeks, recording the maximum as a potential size hint */
+	if ( ! len ) {
+		if ( filter->presize < pos )
+			filter->presize = pos;
+		free_iob ( iobuf );
+		return 0;
+	}
+
+	/* Hold data received ahead of its turn */
+	if ( pos > filter->received ) {
+		if ( ( rc = decompress_enqueue ( filter, iobuf, pos ) ) != 0 )
+			goto err;
+		return 0;
+	}
+
+	/* Process data, followed by any held data that is now in order */
+	while ( 1 ) {
+		if ( ( rc = decompress_process ( filter, iobuf, pos ) ) != 0 )
+			goto err;
+		if ( filter->passthru )
+			break;
+		queued = list_first_entry ( &filter->queue,
+					    struct decompress_queued, list );
+		if ( ( ! queued ) || ( queued->pos > filter->received ) )
+			break;
+		list_del ( &queued->list );
+		iobuf = queued->iobuf;
+		pos = queued->pos;
+		free ( queued );
+	}
+
+	return 0;
+
+ err:
+	decompress_close ( filter, rc );
+	return rc;
+}
+
+/**
+ * Get underlying data transfer buffer
+ *
+ * @v filter		Decompression filter
+ * @ret xferbuf		Data transfer buffer, or NULL on error
+ *
+ * The decompressor has no meaningful relationship to any underlying
+ * data transfer buffer, and so must block access to it unless data
+ * is being passed through unmodified.
+ */
+static struct xfer_buffer *
+decompress_buffer ( struct decompress_filter *filter ) {
+
+	if ( filter->passthru )
+		return xfer_buffer ( &filter->xfer );
+	return NULL;
+}
+
+/** Data transfer interface operations */
+static struct interface_operation decompress_xfer_operations[] = {
+	INTF_OP ( intf_close, struct decompress_filter *, decompress_close ),
+};
+
+/** Data transfer interface descriptor */
+static struct interface_descriptor decompress_xfer_desc =
+	INTF_DESC_PASSTHRU ( struct decompress_filter, xfer,
+			     decompress_xfer_operations, source );
+
+/** Source interface operations */
+static struct interface_operation decompress_source_operations[] = {
+	INTF_OP ( xfer_deliver, struct decompress_filter *,
+		  decompress_deliver ),
+	INTF_OP ( xfer_buffer, struct decompress_filter *,
+		  decompress_buffer ),
+	INTF_OP ( intf_close, struct decompress_filter *, decompress_close ),
+};
+
+/** Source interface descriptor */
+static struct interface_descriptor decompress_source_desc =
+	INTF_DESC_PASSTHRU ( struct decompress_filter, source,
+			     decompress_source_operations, xfer );
+
+/**
+ * Allocate decompression filter
+ *
+ * @ret filter		Decompression filter, or NULL on error
+ */
+static struct decompress_filter * decompress_alloc ( void ) {
+	struct decompress_filter *filter;
+
+	/* Allocate and initialise structure */
+	filter = zalloc ( sizeof ( *filter ) );
+	if ( ! filter )
+		return NULL;
+	ref_init ( &filter->refcnt, decompress_free );
+	INIT_LIST_HEAD ( &filter->queue );
+	intf_init ( &filter->xfer, &decompress_xfer_desc, &filter->refcnt );
+	intf_init ( &filter->source, &decompress_source_desc,
+		    &filter->refcnt );
+
+	return filter;
+}
+
+/**
+ * Insert decompression filter
+ *
+ * @v xfer		Data transfer interface (for decompressed data)
+ * @v source		Source interface (for compressed data)
+ * @v decompressor	Decompression algorithm
+ * @ret rc		Return status code
+ */
+int decompress_filter ( struct interface *xfer, struct interface *source,
+			struct decompressor *decompressor ) {
+	struct decompress_filter *filter;
+	int rc;
+
+	/* Allocate and initialise structure */
+	filter = decompress_alloc();
+	if ( ! filter )
+		return -ENOMEM;
+
+	/* Initialise decompressor */
+	if ( ( rc = decompress_start ( filter, decompressor ) ) != 0 ) {
+		ref_put ( &filter->refcnt );
+		return rc;
+	}
+
+	/* Attach to parent interfaces, mortalise self, and return */
+	intf_plug_plug ( &filter->xfer, xfer );
+	intf_plug_plug ( &filter->source, source );
+	ref_put ( &filter->refcnt );
+	return 0;
+}
+
+/**
+ * Insert image decompression filter
+ *
+ * @v xfer		Data transfer interface (for image data)
+ * @v next		Interface to which to attach image source
+ * @ret rc		Return status code
+ *
+ * The compression format (if any) will be detected automatically
+ * from the start of the downloaded data.
+ */
+int image_decompress ( struct interface *xfer, struct interface **next ) {
+	struct decompress_filter *filter;
+
+	/* Do nothing unless at least one format is supported */
+	if ( ! table_num_entries ( IMAGE_DECOMPRESSORS ) ) {
+		*next = xfer;
+		return 0;
+	}
+
+	/* Allocate and initialise structure */
+	filter = decompress_alloc();
+	if ( ! filter )
+		return -ENOMEM;
+	DBGC ( filter, "DECOMPRESS %p detecting image format\n", filter );
+
+	/* Attach to parent interface, mortalise self, and return */
+	intf_plug_plug ( &filter->xfer, xfer );
+	*next = &filter->source;
+	ref_put ( &filter->refcnt );
+	return 0;
+}
@@ -28,6 +28,8 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/tables.h>
 #include <ipxe/init.h>
 #include <ipxe/interface.h>
+#include <ipxe/process.h>
+#include <ipxe/timer.h>
 #include <ipxe/device.h>
 
 /**
@@ -37,12 +39,18 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  *
  */
 
+/** Maximum time to wait for deferred device initialisation */
+#define DEVICE_DEFER_MAX_WAIT ( 15 * TICKS_PER_SEC )
+
 /** Registered root devices */
 static LIST_HEAD ( devices );
 
 /** Device removal inhibition counter */
 int device_keep_count = 0;
 
+/** Outstanding deferred device initialisation counter */
+int device_defer_count = 0;
+
 /**
  * Probe a root device
  *
@@ -72,6 +80,26 @@ static void rootdev_remove ( struct root_device *rootdev ) {
 	DBG ( "Removed %s root bus\n", rootdev->dev.name );
 }
 
+/**
+ * Wait for deferred device initialisations to complete
+ *
+ * Deferred initialisations run in parallel as background processes,
+ * so the total delay is that of the slowest device rather than the
+ * sum over all devices.
+ */
+static void wait_deferred_devices ( void ) {
+	unsigned long start = currticks();
+
+	while ( device_defer_count ) {
+		if ( ( currticks() - start ) >= DEVICE_DEFER_MAX_WAIT ) {
+			DBG ( "Abandoned waiting for %d deferred devices\n",
+			      device_defer_count );
+			break;
+		}
+		step();
+	}
+}
+
 /**
  * Probe all devices
  *
@@ -89,6 +117,28 @@ static void probe_devices ( void ) {
 		if ( ( rc = rootdev_probe ( rootdev ) ) != 0 )
 			list_del ( &rootdev->dev.siblings );
 	}
+
+	/* Wait for deferred initialisations */
+	wait_deferred_devices();
+}
+
+/**
+ * Probe devices skipped during initial probing
+ *
+ * Some buses may be configured to probe only a subset of devices at
+ * startup.  This probes any devices that were skipped, for use when
+ * the initially probed devices turn out to be insufficient.
+ */
+void probe_skipped_devices ( void ) {
+	struct root_device *rootdev;
+
+	list_for_each_entry ( rootdev, &devices, dev.siblings ) {
+		if ( rootdev->driver->probe_skipped )
+			rootdev->driver->probe_skipped ( rootdev );
+	}
+
+	/* Wait for deferred initialisations */
+	wait_deferred_devices();
 }
 
 /**
@@ -34,6 +34,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/umalloc.h>
 #include <ipxe/image.h>
 #include <ipxe/xferbuf.h>
+#include <ipxe/crypto.h>
 #include <ipxe/downloader.h>
 
 /** @file
@@ -56,6 +57,8 @@ struct downloader {
 	struct image *image;
 	/** Data transfer buffer */
 	struct xfer_buffer buffer;
+	/** Streaming digest context */
+	uint8_t digest_ctx[0];
 };
 
 /**
@@ -71,6 +74,30 @@ static void downloader_free ( struct refcnt *refcnt ) {
 	free ( downloader );
 }
 
+/**
+ * Record downloaded image in cache (when image caching is not present)
+ *
+ * @v image		Downloaded image
+ */
+__weak void downloader_cache ( struct image *image __unused ) {
+
+	/* Do nothing */
+}
+
+/**
+ * Find cached image by digest (when image caching is not present)
+ *
+ * @v digest		Digest algorithm
+ * @v value		Digest value
+ * @ret image		Cached image, or NULL
+ */
+__weak struct image *
+downloader_cached ( struct digest_algorithm *digest __unused,
+		    const void *value __unused ) {
+
+	return NULL;
+}
+
 /**
  * Terminate download
  *
@@ -78,6 +105,23 @@ static void downloader_free ( struct refcnt *refcnt ) {
  * @v rc		Reason for termination
  */
 static void downloader_finished ( struct downloader *downloader, int rc ) {
+	struct xfer_buffer *buffer = &downloader->buffer;
+
+	/* Release any unused space and update image length */
+	xferbuf_trim ( buffer );
+	downloader->image->len = buffer->len;
+
+	/* Record streaming digest, if it covers the whole image */
+	if ( ( rc == 0 ) && buffer->digest &&
+	     ( buffer->digest_len == buffer->len ) ) {
+		image_set_digest ( downloader->image, buffer->digest,
+				   buffer->digest_ctx );
+	}
+	buffer->digest = NULL;
+
+	/* Check expected digest, if applicable */
+	if ( rc == 0 )
+		rc = image_check_digest ( downloader->image );
 
 	/* Log download status */
 	if ( rc == 0 ) {
@@ -88,8 +132,9 @@ static void downloader_finished ( struct downloader *downloader, int rc ) {
 			 downloader->image->name, strerror ( rc ) );
 	}
 
-	/* Update image length */
-	downloader->image->len = downloader->buffer.len;
+	/* Record successfully downloaded image in cache, if applicable */
+	if ( rc == 0 )
+		downloader_cache ( downloader->image );
 
 	/* Shut down interfaces */
 	intf_shutdown ( &downloader->xfer, rc );
@@ -124,6 +169,7 @@ static int downloader_progress ( struct downloader *downloader,
 	if ( ! progress->total ) {
 		progress->completed = downloader->buffer.pos;
 		progress->total = downloader->buffer.len;
+		progress->flags |= JOB_PROGRESS_BYTES;
 	}
 
 	return 0;
@@ -245,6 +291,36 @@ static struct interface_descriptor downloader_job_desc =
  *
  */
 
+/**
+ * Get digest algorithm to be used while downloading images
+ *
+ * @ret digest		Digest algorithm, or NULL to not digest images
+ *
+ * This is a stub that is overridden when image signature
+ * verification support is present.
+ */
+__weak struct digest_algorithm * image_digest_algorithm ( void ) {
+
+	return NULL;
+}
+
+/**
+ * Insert image decompression filter
+ *
+ * @v xfer		Data transfer interface (for image data)
+ * @v next		Interface to which to attach image source
+ * @ret rc		Return status code
+ *
+ * This is a stub that is overridden when image decompression support
+ * is present.
+ */
+__weak int image_decompress ( struct interface *xfer,
+			      struct interface **next ) {
+
+	*next = xfer;
+	return 0;
+}
+
 /**
  * Instantiate a downloader
  *
@@ -256,11 +332,16 @@ static struct interface_descriptor downloader_job_desc =
  * specified image from its URI.
  */
 int create_downloader ( struct interface *job, struct image *image ) {
+	struct digest_algorithm *digest = ( image->expected ?
+					    image->expected :
+					    image_digest_algorithm() );
 	struct downloader *downloader;
+	size_t ctxsize = ( digest ? digest->ctxsize : 0 );
+	struct interface *xfer;
 	int rc;
 
 	/* Allocate and initialise structure */
-	downloader = zalloc ( sizeof ( *downloader ) );
+	downloader = zalloc ( sizeof ( *downloader ) + ctxsize );
 	if ( ! downloader )
 		return -ENOMEM;
 	ref_init ( &downloader->refcnt, downloader_free );
@@ -270,9 +351,15 @@ int create_downloader ( struct interface *job, struct image *image ) {
 		    &downloader->refcnt );
 	downloader->image = image_get ( image );
 	xferbuf_umalloc_init ( &downloader->buffer, &image->data );
+	if ( digest ) {
+		xferbuf_digest_init ( &downloader->buffer, digest,
+				      downloader->digest_ctx );
+	}
 
 	/* Instantiate child objects and attach to our interfaces */
-	if ( ( rc = xfer_open_uri ( &downloader->xfer, image->uri ) ) != 0 )
+	if ( ( rc = image_decompress ( &downloader->xfer, &xfer ) ) != 0 )
+		goto err;
+	if ( ( rc = xfer_open_uri ( xfer, image->uri ) ) != 0 )
 		goto err;
 
 	/* Attach parent interface, mortalise self, and return */
@@ -153,13 +153,20 @@ static void fbcon_store ( struct fbcon *fbcon, struct fbcon_text_cell *cell,
  * @v cell		Text cell
  * @v xpos		X position
  * @v ypos		Y position
+ *
+ * Each character row is rendered into a local buffer in the native
+ * pixel format and then written to the frame buffer as a single
+ * contiguous copy, since individual pixel writes to a (typically
+ * uncached) frame buffer are extremely slow.
  */
 static void fbcon_draw ( struct fbcon *fbcon, struct fbcon_text_cell *cell,
 			 unsigned int xpos, unsigned int ypos ) {
 	uint8_t glyph[fbcon->font->height];
+	uint8_t pixels[ FBCON_CHAR_WIDTH * sizeof ( uint32_t ) ];
+	uint8_t *dst;
 	size_t offset;
 	size_t pixel_len;
-	size_t skip_len;
+	size_t char_len;
 	unsigned int row;
 	unsigned int column;
 	uint8_t bitmask;
@@ -174,7 +181,7 @@ static void fbcon_draw ( struct fbcon *fbcon, struct fbcon_text_cell *cell,
 		   ( ypos * fbcon->character.stride ) +
 		   ( xpos * fbcon->character.len ) );
 	pixel_len = fbcon->pixel->len;
-	skip_len = ( fbcon->pixel->stride - fbcon->character.len );
+	char_len = fbcon->character.len;
 
 	/* Check for transparent background colour */
 	transparent = ( cell->background == FBCON_TRANSPARENT );
@@ -182,21 +189,20 @@ static void fbcon_draw ( struct fbcon *fbcon, struct fbcon_text_cell *cell,
 	/* Draw character rows */
 	for ( row = 0 ; row < fbcon->font->height ; row++ ) {
 
-		/* Draw background picture, if applicable */
+		/* Start with background picture, if applicable */
 		if ( transparent ) {
 			if ( fbcon->picture.start ) {
-				memcpy_user ( fbcon->start, offset,
-					      fbcon->picture.start, offset,
-					      fbcon->character.len );
+				copy_from_user ( pixels, fbcon->picture.start,
+						 offset, char_len );
 			} else {
-				memset_user ( fbcon->start, offset, 0,
-					      fbcon->character.len );
+				memset ( pixels, 0, char_len );
 			}
 		}
 
-		/* Draw character row */
-		for ( column = FBCON_CHAR_WIDTH, bitmask = glyph[row] ;
-		      column ; column--, bitmask <<= 1, offset += pixel_len ) {
+		/* Render character row */
+		for ( column = FBCON_CHAR_WIDTH, bitmask = glyph[row],
+			      dst = pixels ;
+		      column ; column--, bitmask <<= 1, dst += pixel_len ) {
 			if ( bitmask & 0x80 ) {
 				src = &cell->foreground;
 			} else if ( ! transparent ) {
@@ -204,11 +210,14 @@ static void fbcon_draw ( struct fbcon *fbcon, struct fbcon_text_cell *cell,
 			} else {
 				continue;
 			}
-			copy_to_user ( fbcon->start, offset, src, pixel_len );
+			memcpy ( dst, src, pixel_len );
 		}
 
+		/* Write character row to frame buffer */
+		copy_to_user ( fbcon->start, offset, pixels, char_len );
+
 		/* Move to next row */
-		offset += skip_len;
+		offset += fbcon->pixel->stride;
 	}
 }
 
@@ -238,24 +247,54 @@ static void fbcon_redraw ( struct fbcon *fbcon ) {
  * Scroll screen
  *
  * @v fbcon		Frame buffer console
+ *
+ * Only character cells whose contents actually change are redrawn.
+ * Console output typically contains large areas of blank space
+ * (e.g. the ends of short lines), which therefore do not need to be
+ * touched.
  */
 static void fbcon_scroll ( struct fbcon *fbcon ) {
+	struct fbcon_text_cell blank = {
+		.foreground = fbcon->foreground,
+		.background = fbcon->background,
+		.character = ' ',
+	};
+	struct fbcon_text_cell old;
+	struct fbcon_text_cell new;
 	size_t row_len;
+	size_t offset = 0;
+	unsigned int xpos;
+	unsigned int ypos;
 
 	/* Sanity check */
 	assert ( fbcon->ypos == fbcon->character.height );
 
-	/* Scroll up character array */
+	/* Redraw any cells that will change */
 	row_len = ( fbcon->character.width * sizeof ( struct fbcon_text_cell ));
+	for ( ypos = 0 ; ypos < fbcon->character.height ; ypos++ ) {
+		for ( xpos = 0 ; xpos < fbcon->character.width ; xpos++ ) {
+			copy_from_user ( &old, fbcon->text.start, offset,
+					 sizeof ( old ) );
+			if ( ypos < ( fbcon->character.height - 1 ) ) {
+				copy_from_user ( &new, fbcon->text.start,
+						 ( offset + row_len ),
+						 sizeof ( new ) );
+			} else {
+				memcpy ( &new, &blank, sizeof ( new ) );
+			}
+			if ( memcmp ( &old, &new, sizeof ( old ) ) != 0 )
+				fbcon_draw ( fbcon, &new, xpos, ypos );
+			offset += sizeof ( old );
+		}
+	}
+
+	/* Scroll up character array */
 	memmove_user ( fbcon->text.start, 0, fbcon->text.start, row_len,
 		       ( row_len * ( fbcon->character.height - 1 ) ) );
 	fbcon_clear ( fbcon, ( fbcon->character.height - 1 ) );
 
 	/* Update cursor position */
 	fbcon->ypos--;
-
-	/* Redraw all characters */
-	fbcon_redraw ( fbcon );
 }
 
 /**
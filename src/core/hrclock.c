@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <string.h>
+#include <errno.h>
+#include <ipxe/init.h>
+#include <ipxe/timer.h>
+#include <ipxe/hrclock.h>
+
+/** @file
+ *
+ * High-resolution monotonic clock
+ *
+ * The timer tick counter returned by currticks() is too coarse for
+ * purposes such as round-trip time estimation and fine-grained
+ * profiling.  A high-resolution clock source (such as a calibrated
+ * CPU cycle counter) is used to provide a nanosecond timestamp, with
+ * the timer tick counter used as a last resort.
+ *
+ */
+
+/** Current clock source */
+static struct hrclock *hrclock;
+
+/** Counter frequency (in Hz) */
+static uint64_t hrclock_hz;
+
+/** Counter value at initialisation */
+static uint64_t hrclock_base;
+
+/**
+ * Calibrate counter frequency against udelay()
+ *
+ * @v read		Counter read method
+ * @ret hz		Counter frequency (in Hz), or zero on error
+ */
+uint64_t hrclock_calibrate ( uint64_t ( * read ) ( void ) ) {
+	uint64_t before;
+	uint64_t after;
+
+	before = read();
+	udelay ( HRCLOCK_CALIBRATE_US );
+	after = read();
+	return ( ( ( after - before ) * 1000000ULL ) / HRCLOCK_CALIBRATE_US );
+}
+
+/**
+ * Get current high-resolution time in nanoseconds
+ *
+ * @ret nsecs		Time since initialisation, in nanoseconds
+ */
+uint64_t hrclock_ns ( void ) {
+	uint64_t count;
+
+	/* Guard against use during early initialisation */
+	if ( ! hrclock ) {
+		DBGC ( &hrclock, "HRCLOCK hrclock_ns() called before "
+		       "initialisation from %p\n",
+		       __builtin_return_address ( 0 ) );
+		return 0;
+	}
+
+	/* Convert elapsed count to nanoseconds without overflow */
+	count = ( hrclock->read() - hrclock_base );
+	return ( ( ( count / hrclock_hz ) * NSECS_PER_SEC ) +
+		 ( ( ( count % hrclock_hz ) * NSECS_PER_SEC ) / hrclock_hz ) );
+}
+
+/**
+ * Read timer tick counter
+ *
+ * @ret count		Current counter value
+ */
+static uint64_t ticks_hrclock_read ( void ) {
+
+	return currticks();
+}
+
+/**
+ * Probe timer tick counter
+ *
+ * @ret hz		Counter frequency (in Hz)
+ * @ret rc		Return status code
+ */
+static int ticks_hrclock_probe ( uint64_t *hz ) {
+
+	*hz = TICKS_PER_SEC;
+	return 0;
+}
+
+/** Timer tick counter clock source */
+struct hrclock ticks_hrclock __hrclock ( HRCLOCK_FALLBACK ) = {
+	.name = "ticks",
+	.probe = ticks_hrclock_probe,
+	.read = ticks_hrclock_read,
+};
+
+/**
+ * Find a working clock source
+ *
+ */
+static void hrclock_probe ( void ) {
+	struct hrclock *clock;
+	uint64_t hz;
+	int rc;
+
+	/* Use first working clock source */
+	for_each_table_entry ( clock, HRCLOCKS ) {
+		if ( ( rc = clock->probe ( &hz ) ) != 0 ) {
+			DBGC ( &hrclock, "HRCLOCK could not initialise %s: "
+			       "%s\n", clock->name, strerror ( rc ) );
+			continue;
+		}
+		if ( ! hz ) {
+			DBGC ( &hrclock, "HRCLOCK %s has zero frequency\n",
+			       clock->name );
+			continue;
+		}
+		DBGC ( &hrclock, "HRCLOCK using %s at %lld Hz\n",
+		       clock->name, hz );
+		hrclock_hz = hz;
+		hrclock_base = clock->read();
+		hrclock = clock;
+		return;
+	}
+}
+
+/** High-resolution clock initialisation function */
+struct init_fn hrclock_init_fn __init_fn ( INIT_NORMAL ) = {
+	.initialise = hrclock_probe,
+};
+
+/* Drag in high-resolution clock configuration */
+REQUIRING_SYMBOL ( hrclock_init_fn );
+REQUIRE_OBJECT ( config_hrclock );
@@ -35,6 +35,8 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/umalloc.h>
 #include <ipxe/uri.h>
 #include <ipxe/image.h>
+#include <ipxe/crypto.h>
+#include <ipxe/serial.h>
 
 /** @file
  *
@@ -51,6 +53,10 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 	__einfo_error ( EINFO_EACCES_PERMANENT )
 #define EINFO_EACCES_PERMANENT \
 	__einfo_uniqify ( EINFO_EACCES, 0x02, "Trust requirement is permanent" )
+#define EACCES_DIGEST \
+	__einfo_error ( EINFO_EACCES_DIGEST )
+#define EINFO_EACCES_DIGEST \
+	__einfo_uniqify ( EINFO_EACCES, 0x03, "Image digest mismatch" )
 
 /** List of registered images */
 struct list_head images = LIST_HEAD_INIT ( images );
@@ -77,6 +83,8 @@ static void free_image ( struct refcnt *refcnt ) {
 	free ( image->cmdline );
 	uri_put ( image->uri );
 	ufree ( image->data );
+	free ( image->digest_value );
+	free ( image->expected_value );
 	image_put ( image->replacement );
 	free ( image );
 }
@@ -278,6 +286,38 @@ struct image * find_image ( const char *name ) {
 	return NULL;
 }
 
+/**
+ * Find image by precalculated digest
+ *
+ * @v digest		Digest algorithm
+ * @v value		Digest value
+ * @ret image		Executable image, or NULL
+ */
+struct image * find_image_digest ( struct digest_algorithm *digest,
+				   const void *value ) {
+	struct image *image;
+
+	list_for_each_entry ( image, &images, list ) {
+		if ( ( image->digest == digest ) &&
+		     ( memcmp ( image->digest_value, value,
+				digest->digestsize ) == 0 ) )
+			return image;
+	}
+
+	return NULL;
+}
+
+/**
+ * Transmit all buffered serial console output
+ *
+ * This is a stub that is overridden when the serial console is
+ * present.
+ */
+__weak void serial_flush ( void ) {
+
+	/* Do nothing */
+}
+
 /**
  * Execute image
  *
@@ -326,6 +366,11 @@ int image_exec ( struct image *image ) {
 	/* Record boot attempt */
 	syslog ( LOG_NOTICE, "Executing \"%s\"\n", image->name );
 
+	/* Ensure that no buffered console output can be interleaved
+	 * with (or lost by) the image's own output.
+	 */
+	serial_flush();
+
 	/* Try executing the image */
 	if ( ( rc = image->type->exec ( image ) ) != 0 ) {
 		DBGC ( image, "IMAGE %s could not execute: %s\n",
@@ -481,3 +526,113 @@ int image_set_trust ( int require_trusted, int permanent ) {
 
 	return 0;
 }
+
+/**
+ * Check image trust requirement
+ *
+ * @ret require_trusted	Trusted images are required
+ */
+int image_trust_required ( void ) {
+
+	return require_trusted_images;
+}
+
+/**
+ * Record precalculated image digest
+ *
+ * @v image		Image
+ * @v digest		Digest algorithm
+ * @v ctx		Digest context covering the entire image
+ * @ret rc		Return status code
+ *
+ * The digest context will be finalised.
+ */
+int image_set_digest ( struct image *image, struct digest_algorithm *digest,
+		       void *ctx ) {
+	void *value;
+
+	/* Allocate digest value */
+	value = malloc ( digest->digestsize );
+	if ( ! value )
+		return -ENOMEM;
+
+	/* Finalise digest */
+	digest_final ( digest, ctx, value );
+
+	/* Replace any existing digest */
+	free ( image->digest_value );
+	image->digest = digest;
+	image->digest_value = value;
+	DBGC ( image, "IMAGE %s has %s digest:\n", image->name, digest->name );
+	DBGC_HDA ( image, 0, value, digest->digestsize );
+
+	return 0;
+}
+
+/**
+ * Record expected image digest
+ *
+ * @v image		Image
+ * @v digest		Digest algorithm
+ * @v value		Expected digest value
+ * @ret rc		Return status code
+ */
+int image_set_expected ( struct image *image, struct digest_algorithm *digest,
+			 const void *value ) {
+	void *copy;
+
+	/* Allocate and copy digest value */
+	copy = malloc ( digest->digestsize );
+	if ( ! copy )
+		return -ENOMEM;
+	memcpy ( copy, value, digest->digestsize );
+
+	/* Replace any existing expected digest */
+	free ( image->expected_value );
+	image->expected = digest;
+	image->expected_value = copy;
+
+	return 0;
+}
+
+/**
+ * Check image against expected digest
+ *
+ * @v image		Image
+ * @ret rc		Return status code
+ *
+ * The precalculated digest is used if it was calculated using the
+ * expected digest algorithm.  Otherwise, the digest is calculated
+ * (and recorded as the precalculated digest).
+ */
+int image_check_digest ( struct image *image ) {
+	struct digest_algorithm *digest = image->expected;
+	int rc;
+
+	/* Do nothing unless an expected digest is present */
+	if ( ! digest )
+		return 0;
+
+	/* Calculate digest, if necessary */
+	if ( image->digest != digest ) {
+		uint8_t ctx[ digest->ctxsize ];
+
+		digest_init ( digest, ctx );
+		digest_update ( digest, ctx, user_to_virt ( image->data, 0 ),
+				image->len );
+		if ( ( rc = image_set_digest ( image, digest, ctx ) ) != 0 )
+			return rc;
+	}
+
+	/* Compare digests */
+	if ( memcmp ( image->digest_value, image->expected_value,
+		      digest->digestsize ) != 0 ) {
+		DBGC ( image, "IMAGE %s does not match expected %s digest:\n",
+		       image->name, digest->name );
+		DBGC_HDA ( image, 0, image->expected_value,
+			   digest->digestsize );
+		return -EACCES_DIGEST;
+	}
+
+	return 0;
+}
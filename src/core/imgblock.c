@@ -0,0 +1,359 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * Downloaded image block device
+ *
+ * An image that has already been downloaded (e.g. via "imgfetch") may
+ * be presented as a SAN block device using a URI of the form
+ * "image:<name>".  All block device commands are then satisfied
+ * directly from the image's memory, with no further network
+ * activity.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <ipxe/refcnt.h>
+#include <ipxe/interface.h>
+#include <ipxe/xfer.h>
+#include <ipxe/open.h>
+#include <ipxe/uri.h>
+#include <ipxe/process.h>
+#include <ipxe/image.h>
+#include <ipxe/blockdev.h>
+
+/** Block size used for image block devices */
+#define IMGBLOCK_BLKSIZE 512
+
+/** An image block device */
+struct image_block {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** Block device interface */
+	struct interface block;
+	/** Image */
+	struct image *image;
+};
+
+/** An image block device command */
+struct image_block_command {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** Data interface */
+	struct interface data;
+	/** Completion process */
+	struct process process;
+	/** Block device capacity, if applicable */
+	struct block_device_capacity capacity;
+};
+
+/**
+ * Free image block device
+ *
+ * @v refcnt		Reference count
+ */
+static void imgblock_free ( struct refcnt *refcnt ) {
+	struct image_block *imgblock =
+		container_of ( refcnt, struct image_block, refcnt );
+
+	image_put ( imgblock->image );
+	free ( imgblock );
+}
+
+/**
+ * Close image block device
+ *
+ * @v imgblock		Image block device
+ * @v rc		Reason for close
+ */
+static void imgblock_close ( struct image_block *imgblock, int rc ) {
+
+	/* Shut down interfaces */
+	intf_shutdown ( &imgblock->block, rc );
+}
+
+/**
+ * Close image block device command
+ *
+ * @v command		Command
+ * @v rc		Reason for close
+ */
+static void imgblock_command_close ( struct image_block_command *command,
+				     int rc ) {
+
+	/* Stop process */
+	process_del ( &command->process );
+
+	/* Shut down interfaces */
+	intf_shutdown ( &command->data, rc );
+}
+
+/**
+ * Complete image block device command
+ *
+ * @v command		Command
+ *
+ * Completion is deferred to a process, since the caller will not yet
+ * be ready to receive it at the point that the command is issued.
+ */
+static void imgblock_command_step ( struct image_block_command *command ) {
+
+	/* Report capacity, if applicable */
+	if ( command->capacity.blksize )
+		block_capacity ( &command->data, &command->capacity );
+
+	/* Complete command */
+	imgblock_command_close ( command, 0 );
+}
+
+/** Image block device command data interface operations */
+static struct interface_operation imgblock_command_op[] = {
+	INTF_OP ( intf_close, struct image_block_command *,
+		  imgblock_command_close ),
+};
+
+/** Image block device command data interface descriptor */
+static struct interface_descriptor imgblock_command_desc =
+	INTF_DESC ( struct image_block_command, data, imgblock_command_op );
+
+/** Image block device command process descriptor */
+static struct process_descriptor imgblock_command_process_desc =
+	PROC_DESC_ONCE ( struct image_block_command, process,
+			 imgblock_command_step );
+
+/**
+ * Create image block device command
+ *
+ * @v data		Data interface
+ * @ret command		Command, or NULL on error
+ */
+static struct image_block_command *
+imgblock_command ( struct interface *data ) {
+	struct image_block_command *command;
+
+	/* Allocate and initialise structure */
+	command = zalloc ( sizeof ( *command ) );
+	if ( ! command )
+		return NULL;
+	ref_init ( &command->refcnt, NULL );
+	intf_init ( &command->data, &imgblock_command_desc,
+		    &command->refcnt );
+	process_init ( &command->process, &imgblock_command_process_desc,
+		       &command->refcnt );
+
+	/* Attach to parent interface, mortalise self, and return */
+	intf_plug_plug ( &command->data, data );
+	ref_put ( &command->refcnt );
+	return command;
+}
+
+/**
+ * Check image block device command range
+ *
+ * @v imgblock		Image block device
+ * @v lba		Starting logical block address
+ * @v count		Number of logical blocks
+ * @v len		Length of data buffer
+ * @ret offset		Offset within image
+ * @ret rc		Return status code
+ */
+static int imgblock_range ( struct image_block *imgblock, uint64_t lba,
+			    unsigned int count, size_t len, size_t *offset ) {
+	uint64_t blocks = ( imgblock->image->len / IMGBLOCK_BLKSIZE );
+
+	/* Check range */
+	if ( ( lba > blocks ) || ( count > ( blocks - lba ) ) ||
+	     ( len != ( count * IMGBLOCK_BLKSIZE ) ) ) {
+		DBGC ( imgblock, "IMGBLOCK %s invalid range %#llx+%#x\n",
+		       imgblock->image->name, ( ( unsigned long long ) lba ),
+		       count );
+		return -ERANGE;
+	}
+
+	*offset = ( lba * IMGBLOCK_BLKSIZE );
+	return 0;
+}
+
+/**
+ * Read from image block device
+ *
+ * @v imgblock		Image block device
+ * @v data		Data interface
+ * @v lba		Starting logical block address
+ * @v count		Number of logical blocks
+ * @v buffer		Data buffer
+ * @v len		Length of data buffer
+ * @ret rc		Return status code
+ */
+static int imgblock_read ( struct image_block *imgblock,
+			   struct interface *data, uint64_t lba,
+			   unsigned int count, userptr_t buffer, size_t len ) {
+	size_t offset;
+	int rc;
+
+	/* Check range */
+	if ( ( rc = imgblock_range ( imgblock, lba, count, len,
+				     &offset ) ) != 0 )
+		return rc;
+
+	/* Create command */
+	if ( ! imgblock_command ( data ) )
+		return -ENOMEM;
+
+	/* Copy data */
+	memcpy_user ( buffer, 0, imgblock->image->data, offset, len );
+
+	return 0;
+}
+
+/**
+ * Write to image block device
+ *
+ * @v imgblock		Image block device
+ * @v data		Data interface
+ * @v lba		Starting logical block address
+ * @v count		Number of logical blocks
+ * @v buffer		Data buffer
+ * @v len		Length of data buffer
+ * @ret rc		Return status code
+ */
+static int imgblock_write ( struct image_block *imgblock,
+			    struct interface *data, uint64_t lba,
+			    unsigned int count, userptr_t buffer, size_t len ) {
+	size_t offset;
+	int rc;
+
+	/* Check range */
+	if ( ( rc = imgblock_range ( imgblock, lba, count, len,
+				     &offset ) ) != 0 )
+		return rc;
+
+	/* Create command */
+	if ( ! imgblock_command ( data ) )
+		return -ENOMEM;
+
+	/* Copy data */
+	memcpy_user ( imgblock->image->data, offset, buffer, 0, len );
+
+	return 0;
+}
+
+/**
+ * Read image block device capacity
+ *
+ * @v imgblock		Image block device
+ * @v data		Data interface
+ * @ret rc		Return status code
+ */
+static int imgblock_read_capacity ( struct image_block *imgblock,
+				    struct interface *data ) {
+	struct image_block_command *command;
+
+	/* Create command */
+	command = imgblock_command ( data );
+	if ( ! command )
+		return -ENOMEM;
+
+	/* Record capacity */
+	command->capacity.blocks =
+		( imgblock->image->len / IMGBLOCK_BLKSIZE );
+	command->capacity.blksize = IMGBLOCK_BLKSIZE;
+	command->capacity.max_count = -1U;
+
+	return 0;
+}
+
+/**
+ * Check image block device flow control window
+ *
+ * @v imgblock		Image block device
+ * @ret len		Length of window
+ */
+static size_t imgblock_window ( struct image_block *imgblock __unused ) {
+
+	/* Always ready to accept commands */
+	return ~( ( size_t ) 0 );
+}
+
+/** Image block device block interface operations */
+static struct interface_operation imgblock_block_op[] = {
+	INTF_OP ( block_read, struct image_block *, imgblock_read ),
+	INTF_OP ( block_write, struct image_block *, imgblock_write ),
+	INTF_OP ( block_read_capacity, struct image_block *,
+		  imgblock_read_capacity ),
+	INTF_OP ( xfer_window, struct image_block *, imgblock_window ),
+	INTF_OP ( intf_close, struct image_block *, imgblock_close ),
+};
+
+/** Image block device block interface descriptor */
+static struct interface_descriptor imgblock_block_desc =
+	INTF_DESC ( struct image_block, block, imgblock_block_op );
+
+/**
+ * Open image block device URI
+ *
+ * @v parent		Parent interface
+ * @v uri		URI
+ * @ret rc		Return status code
+ */
+static int imgblock_open ( struct interface *parent, struct uri *uri ) {
+	struct image_block *imgblock;
+	struct image *image;
+
+	/* Identify image */
+	if ( ! uri->opaque )
+		return -EINVAL;
+	image = find_image ( uri->opaque );
+	if ( ! image ) {
+		DBGC ( uri, "IMGBLOCK could not find image \"%s\"\n",
+		       uri->opaque );
+		return -ENOENT;
+	}
+
+	/* Allocate and initialise structure */
+	imgblock = zalloc ( sizeof ( *imgblock ) );
+	if ( ! imgblock )
+		return -ENOMEM;
+	ref_init ( &imgblock->refcnt, imgblock_free );
+	intf_init ( &imgblock->block, &imgblock_block_desc,
+		    &imgblock->refcnt );
+	imgblock->image = image_get ( image );
+	DBGC ( imgblock, "IMGBLOCK %s opened with %#zx blocks\n",
+	       image->name, ( image->len / IMGBLOCK_BLKSIZE ) );
+
+	/* Attach to parent interface, mortalise self, and return */
+	intf_plug_plug ( &imgblock->block, parent );
+	ref_put ( &imgblock->refcnt );
+	return 0;
+}
+
+/** Image block device URI opener */
+struct uri_opener imgblock_uri_opener __uri_opener = {
+	.scheme = "image",
+	.open = imgblock_open,
+};
@@ -64,6 +64,9 @@ struct interface_descriptor null_intf_desc =
 /** The null interface */
 struct interface null_intf = INTF_INIT ( null_intf_desc );
 
+/** Current plumbing generation for cached operation lookups */
+unsigned int intf_generation = 1;
+
 /*****************************************************************************
  *
  * Object interface plumbing
@@ -87,6 +90,7 @@ void intf_plug ( struct interface *intf, struct interface *dest ) {
 	intf_get ( dest );
 	intf_put ( intf->dest );
 	intf->dest = dest;
+	intf_invalidate();
 }
 
 /**
@@ -114,6 +118,7 @@ void intf_unplug ( struct interface *intf ) {
 	       INTF_INTF_DBG ( intf, intf->dest ) );
 	intf_put ( intf->dest );
 	intf->dest = &null_intf;
+	intf_invalidate();
 }
 
 /**
@@ -123,6 +128,7 @@ void intf_unplug ( struct interface *intf ) {
  */
 void intf_nullify ( struct interface *intf ) {
 	intf->desc = &null_intf_desc;
+	intf_invalidate();
 }
 
 /**
@@ -206,22 +212,52 @@ void * intf_get_dest_op_no_passthru_untyped ( struct interface *intf,
  */
 void * intf_get_dest_op_untyped ( struct interface *intf, void *type,
 				  struct interface **dest ) {
+	struct interface_cache *cache = intf->cache;
+	struct interface *current = intf;
 	void *func;
+	unsigned int i;
+
+	/* Use cached lookup, if available */
+	if ( intf->generation == intf_generation ) {
+		for ( i = 0 ; i < INTF_CACHE_SIZE ; i++ ) {
+			if ( cache[i].type == type ) {
+				*dest = intf_get ( cache[i].dest );
+				return cache[i].func;
+			}
+		}
+	} else {
+		memset ( cache, 0, sizeof ( intf->cache ) );
+		intf->generation = intf_generation;
+	}
 
 	while ( 1 ) {
 
 		/* Search for an implementing method provided by the
 		 * current destination interface.
 		 */
-		func = intf_get_dest_op_no_passthru_untyped( intf, type, dest );
+		func = intf_get_dest_op_no_passthru_untyped ( current, type,
+							      dest );
 		if ( func )
-			return func;
+			break;
 
 		/* Pass through to the underlying interface, if applicable */
-		if ( ! ( intf = intf_get_passthru ( *dest ) ) )
-			return NULL;
+		if ( ! ( current = intf_get_passthru ( *dest ) ) )
+			break;
 		intf_put ( *dest );
 	}
+
+	/* Record lookup in cache, unless the plumbing has changed
+	 * during the lookup (which should never happen)
+	 */
+	if ( intf->generation == intf_generation ) {
+		memmove ( &cache[1], &cache[0],
+			  ( sizeof ( intf->cache ) - sizeof ( cache[0] ) ) );
+		cache[0].type = type;
+		cache[0].func = func;
+		cache[0].dest = *dest;
+	}
+
+	return func;
 }
 
 /*****************************************************************************
@@ -281,7 +317,9 @@ void intf_shutdown ( struct interface *intf, int rc ) {
 
 	/* Transfer destination to temporary interface */
 	tmp.dest = intf->dest;
+	tmp.generation = 0;
 	intf->dest = &null_intf;
+	intf_invalidate();
 
 	/* Notify destination of close via temporary interface */
 	intf_close ( &tmp, rc );
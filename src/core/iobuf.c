@@ -27,6 +27,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <strings.h>
 #include <errno.h>
 #include <ipxe/malloc.h>
+#include <ipxe/refcnt.h>
 #include <ipxe/iobuf.h>
 
 /** @file
@@ -112,6 +113,8 @@ struct io_buffer * alloc_iob_raw ( size_t len, size_t align, size_t offset ) {
 	/* Populate descriptor */
 	iobuf->head = iobuf->data = iobuf->tail = data;
 	iobuf->end = ( data + len );
+	iobuf->pool = NULL;
+	iobuf->flags = 0;
 
 	return iobuf;
 }
@@ -143,6 +146,7 @@ struct io_buffer * alloc_iob ( size_t len ) {
  * @v iobuf	I/O buffer
  */
 void free_iob ( struct io_buffer *iobuf ) {
+	struct io_buffer_pool *pool;
 	size_t len;
 
 	/* Allow free_iob(NULL) to be valid */
@@ -154,6 +158,21 @@ void free_iob ( struct io_buffer *iobuf ) {
 	assert ( iobuf->data <= iobuf->tail );
 	assert ( iobuf->tail <= iobuf->end );
 
+	/* Return to I/O buffer pool, if applicable */
+	pool = iobuf->pool;
+	if ( pool ) {
+		iobuf->pool = NULL;
+		len = ( iobuf->end - iobuf->head );
+		if ( ( pool->count < IOB_POOL_MAX ) && ( len >= pool->len ) ) {
+			list_add ( &iobuf->list, &pool->free );
+			pool->count++;
+		} else {
+			free_iob ( iobuf );
+		}
+		ref_put ( pool->refcnt );
+		return;
+	}
+
 	/* Free buffer */
 	len = ( iobuf->end - iobuf->head );
 	if ( iobuf->end == iobuf ) {
@@ -169,6 +188,67 @@ void free_iob ( struct io_buffer *iobuf ) {
 	}
 }
 
+/**
+ * Allocate I/O buffer from I/O buffer pool
+ *
+ * @v pool		I/O buffer pool
+ * @v len		Required length of buffer
+ * @ret iobuf		I/O buffer, or NULL if none available
+ *
+ * A free buffer will be reused if available, otherwise a new buffer
+ * will be allocated as per alloc_iob().
+ */
+struct io_buffer * alloc_pool_iob ( struct io_buffer_pool *pool,
+				    size_t len ) {
+	struct io_buffer *iobuf;
+
+	/* Discard any free buffers of a different length */
+	if ( len != pool->len ) {
+		iob_pool_flush ( pool );
+		pool->len = len;
+	}
+
+	/* Reuse a free buffer, if available */
+	iobuf = list_first_entry ( &pool->free, struct io_buffer, list );
+	if ( iobuf ) {
+		list_del ( &iobuf->list );
+		pool->count--;
+		iobuf->data = iobuf->tail = iobuf->head;
+		iobuf->flags = 0;
+	} else {
+		iobuf = alloc_iob ( len );
+		if ( ! iobuf )
+			return NULL;
+	}
+
+	/* Return to this pool when freed */
+	iobuf->pool = pool;
+	ref_get ( pool->refcnt );
+
+	return iobuf;
+}
+
+/**
+ * Free all free buffers held by I/O buffer pool
+ *
+ * @v pool		I/O buffer pool
+ * @ret discarded	Number of buffers freed
+ */
+unsigned int iob_pool_flush ( struct io_buffer_pool *pool ) {
+	struct io_buffer *iobuf;
+	struct io_buffer *tmp;
+	unsigned int discarded = 0;
+
+	list_for_each_entry_safe ( iobuf, tmp, &pool->free, list ) {
+		list_del ( &iobuf->list );
+		free_iob ( iobuf );
+		discarded++;
+	}
+	pool->count = 0;
+
+	return discarded;
+}
+
 /**
  * Ensure I/O buffer has sufficient headroom
  *
@@ -141,3 +141,50 @@ int line_buffer ( struct line_buffer *linebuf, const char *data, size_t len ) {
 
 	return consume;
 }
+
+/**
+ * Retrieve line, in place if possible
+ *
+ * @v linebuf			Line buffer
+ * @v data			New data to add (may be modified)
+ * @v len			Length of new data to add
+ * @v line			Completed line to fill in, or NULL
+ * @ret len			Consumed length, or negative error number
+ *
+ * If the line buffer is empty and the new data contains a complete
+ * line, then the line will be terminated in place within the new data
+ * and no copy or allocation will take place.  Otherwise, the data
+ * will be added to the line buffer as for line_buffer().
+ *
+ * Carriage returns and newlines will have been stripped, and the line
+ * will be NUL-terminated.  A line returned in place is valid only for
+ * as long as the new data is valid.  The caller should call
+ * empty_line_buffer() after processing each completed line, to allow
+ * subsequent lines to be returned in place.
+ */
+int line_buffer_inplace ( struct line_buffer *linebuf, char *data, size_t len,
+			  char **line ) {
+	char *eol;
+	size_t consume;
+	int consumed;
+
+	/* Use line buffer unless a complete line is present */
+	if ( linebuf->len || ( ! ( eol = memchr ( data, '\n', len ) ) ) ) {
+		consumed = line_buffer ( linebuf, data, len );
+		*line = buffered_line ( linebuf );
+		return consumed;
+	}
+	consume = ( eol - data + 1 );
+
+	/* Reject any embedded NULs within the line */
+	if ( memchr ( data, '\0', consume ) )
+		return -EINVAL;
+
+	/* Terminate line in place, trimming any trailing CR */
+	*eol = '\0';
+	if ( ( eol > data ) && ( eol[-1] == '\r' ) )
+		eol[-1] = '\0';
+	*line = data;
+
+	return consume;
+}
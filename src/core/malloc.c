@@ -32,7 +32,11 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/init.h>
 #include <ipxe/refcnt.h>
 #include <ipxe/malloc.h>
+#include <ipxe/umalloc.h>
+#include <ipxe/settings.h>
+#include <ipxe/profile.h>
 #include <valgrind/memcheck.h>
+#include <config/general.h>
 
 /** @file
  *
@@ -99,16 +103,91 @@ size_t usedmem;
 /** Maximum amount of used memory */
 size_t maxusedmem;
 
+/** Target heap size */
+size_t heaptarget = HEAP_TARGET_SIZE;
+
+/** Number of times the heap has been extended */
+unsigned int heapgrown;
+
+/** Memory allocation profiler */
+static struct profiler alloc_profiler __profiler =
+	{ .name = "malloc.alloc" };
+
+/** Memory allocation size profiler */
+static struct profiler alloc_size_profiler __profiler =
+	{ .name = "malloc.size" };
+
+/** Cache discard profiler */
+static struct profiler discard_profiler __profiler =
+	{ .name = "malloc.discard" };
+
 /**
- * Heap size
+ * Initial heap size
  *
- * Currently fixed at 512kB.
+ * This is the statically allocated portion of the heap.  The heap
+ * may subsequently be extended towards the target heap size.
  */
 #define HEAP_SIZE ( 512 * 1024 )
 
+/** Minimum heap extension size */
+#define HEAP_GROW_MIN ( 256 * 1024 )
+
 /** The heap itself */
 static char heap[HEAP_SIZE] __attribute__ (( aligned ( __alignof__(void *) )));
 
+/** Heap may be extended
+ *
+ * Extension is permitted only between startup and shutdown, since
+ * external memory allocation may not be available at other times.
+ */
+static int heap_growable;
+
+/** A cached free block of memory */
+struct slab_block {
+	/** Padding
+	 *
+	 * This padding serves the same purpose as the padding within
+	 * struct memory_block.
+	 */
+	char pad[ offsetof ( struct memory_block, list ) ];
+	/** Next cached free block */
+	struct slab_block *next;
+};
+
+/** A slab cache of free blocks of a single size class */
+struct slab_cache {
+	/** Block size */
+	size_t size;
+	/** Cached free blocks */
+	struct slab_block *blocks;
+	/** Number of allocations satisfied from the cache */
+	unsigned long hits;
+	/** Number of allocations not satisfied from the cache */
+	unsigned long misses;
+};
+
+/**
+ * Slab cache size classes
+ *
+ * Small allocations are rounded up to the nearest size class.  Freed
+ * blocks are retained in the cache for their size class, and reused
+ * by subsequent allocations without walking the free block list.
+ * Size classes are spaced at half powers of two, to limit the memory
+ * wasted by rounding.  The largest size class accommodates an I/O
+ * buffer for a maximum-sized Ethernet frame.
+ */
+static struct slab_cache slab_caches[] = {
+	{ .size = 64 }, { .size = 96 }, { .size = 128 }, { .size = 192 },
+	{ .size = 256 }, { .size = 384 }, { .size = 512 }, { .size = 768 },
+	{ .size = 1024 }, { .size = 1536 }, { .size = 2048 },
+};
+
+/** Maximum total size of blocks held in slab caches */
+#define SLAB_MAX_CACHED ( 64 * 1024 )
+
+/** Total size of blocks held in slab caches */
+static size_t slab_cached;
+
 /**
  * Mark all blocks in free list as defined
  *
@@ -241,14 +320,18 @@ static inline void check_blocks ( void ) {
  */
 static unsigned int discard_cache ( void ) {
 	struct cache_discarder *discarder;
-	unsigned int discarded;
+	unsigned int discarded = 0;
 
+	profile_start ( &discard_profiler );
 	for_each_table_entry ( discarder, CACHE_DISCARDERS ) {
 		discarded = discarder->discard();
+		discarder->invoked++;
+		discarder->discarded += discarded;
 		if ( discarded )
-			return discarded;
+			break;
 	}
-	return 0;
+	profile_stop ( &discard_profiler );
+	return discarded;
 }
 
 /**
@@ -264,19 +347,67 @@ static void discard_all_cache ( void ) {
 }
 
 /**
- * Allocate a memory block
+ * Extend the heap
+ *
+ * @v min_len		Minimum length required
+ * @ret grown		Heap has been extended
+ */
+static int heap_grow ( size_t min_len ) {
+	static int growing;
+	userptr_t region;
+	size_t size;
+	size_t len;
+
+	/* Do nothing unless extension is permitted and required */
+	if ( growing || ( ! heap_growable ) )
+		return 0;
+	size = ( freemem + usedmem );
+	if ( size >= heaptarget )
+		return 0;
+
+	/* Extend by as much as possible in a single step, up to
+	 * the target size, while making sure that the extension is
+	 * large enough to satisfy the pending allocation.
+	 */
+	len = ( heaptarget - size );
+	if ( len < HEAP_GROW_MIN )
+		len = HEAP_GROW_MIN;
+	if ( len < min_len )
+		len = min_len;
+
+	/* Allocate external memory.  Guard against recursion, in
+	 * case the external allocator itself requires heap memory.
+	 */
+	growing = 1;
+	region = umalloc ( len );
+	growing = 0;
+	if ( ! region ) {
+		DBGC ( &heap, "Could not extend heap by %zdkB\n",
+		       ( len >> 10 ) );
+		/* Do not try again */
+		heap_growable = 0;
+		return 0;
+	}
+
+	/* Add to allocation pool */
+	mpopulate ( user_to_virt ( region, 0 ), len );
+	heapgrown++;
+	DBGC ( &heap, "Extended heap by %zdkB to %zdkB\n",
+	       ( len >> 10 ), ( ( freemem + usedmem ) >> 10 ) );
+
+	return 1;
+}
+
+/**
+ * Allocate a memory block from the free block list
  *
  * @v size		Requested size
  * @v align		Physical alignment
  * @v offset		Offset from physical alignment
  * @ret ptr		Memory block, or NULL
- *
- * Allocates a memory block @b physically aligned as requested.  No
- * guarantees are provided for the alignment of the virtual address.
- *
- * @c align must be a power of two.  @c size may not be zero.
  */
-void * alloc_memblock ( size_t size, size_t align, size_t offset ) {
+static void * heap_alloc_memblock ( size_t size, size_t align,
+				    size_t offset ) {
 	struct memory_block *block;
 	size_t align_mask;
 	size_t actual_size;
@@ -371,11 +502,14 @@ void * alloc_memblock ( size_t size, size_t align, size_t offset ) {
 			goto done;
 		}
 
-		/* Try discarding some cached data to free up memory */
+		/* Try extending the heap or, failing that, discarding
+		 * some cached data to free up memory
+		 */
 		DBGC ( &heap, "Attempting discard for %#zx (aligned %#zx+%zx), "
 		       "used %zdkB\n", size, align, offset, ( usedmem >> 10 ) );
 		valgrind_make_blocks_noaccess();
-		discarded = discard_cache();
+		discarded = ( heap_grow ( actual_size + align_mask ) ||
+			      discard_cache() );
 		valgrind_make_blocks_defined();
 		check_blocks();
 		if ( ! discarded ) {
@@ -394,14 +528,12 @@ void * alloc_memblock ( size_t size, size_t align, size_t offset ) {
 }
 
 /**
- * Free a memory block
+ * Return a memory block to the free block list
  *
- * @v ptr		Memory allocated by alloc_memblock(), or NULL
+ * @v ptr		Memory block
  * @v size		Size of the memory
- *
- * If @c ptr is NULL, no action is taken.
  */
-void free_memblock ( void *ptr, size_t size ) {
+static void heap_free_memblock ( void *ptr, size_t size ) {
 	struct memory_block *freeing;
 	struct memory_block *block;
 	struct memory_block *tmp;
@@ -409,9 +541,6 @@ void free_memblock ( void *ptr, size_t size ) {
 	ssize_t gap_before;
 	ssize_t gap_after = -1;
 
-	/* Allow for ptr==NULL */
-	if ( ! ptr )
-		return;
 	VALGRIND_MAKE_MEM_NOACCESS ( ptr, size );
 
 	/* Sanity checks */
@@ -498,6 +627,189 @@ void free_memblock ( void *ptr, size_t size ) {
 	valgrind_make_blocks_noaccess();
 }
 
+/**
+ * Find slab cache for a memory block size
+ *
+ * @v size		Size of the memory
+ * @ret slab		Slab cache, or NULL
+ */
+static struct slab_cache * slab_find ( size_t size ) {
+	struct slab_cache *slab;
+	unsigned int i;
+
+	for ( i = 0 ; i < ARRAY_SIZE ( slab_caches ) ; i++ ) {
+		slab = &slab_caches[i];
+		if ( size <= slab->size )
+			return ( size ? slab : NULL );
+	}
+	return NULL;
+}
+
+/**
+ * Allocate a memory block from a slab cache
+ *
+ * @v slab		Slab cache
+ * @v align		Physical alignment
+ * @v offset		Offset from physical alignment
+ * @ret ptr		Memory block, or NULL
+ */
+static void * slab_alloc ( struct slab_cache *slab, size_t align,
+			   size_t offset ) {
+	struct slab_block **prev;
+	struct slab_block *block;
+	size_t align_mask;
+	size_t misalign;
+
+	/* Find the first cached block with the required alignment */
+	align_mask = ( ( align - 1 ) | ( MIN_MEMBLOCK_SIZE - 1 ) );
+	for ( prev = &slab->blocks ; ( block = *prev ) ; prev = &block->next ){
+		VALGRIND_MAKE_MEM_DEFINED ( block, sizeof ( *block ) );
+		misalign = ( ( offset - virt_to_phys ( block ) ) & align_mask );
+		if ( misalign == 0 ) {
+			*prev = block->next;
+			slab_cached -= slab->size;
+			slab->hits++;
+			VALGRIND_MAKE_MEM_UNDEFINED ( block, slab->size );
+			return block;
+		}
+		VALGRIND_MAKE_MEM_NOACCESS ( block, sizeof ( *block ) );
+	}
+
+	slab->misses++;
+	return NULL;
+}
+
+/**
+ * Return a memory block to a slab cache
+ *
+ * @v slab		Slab cache
+ * @v ptr		Memory block
+ * @ret cached		Memory block was retained in the slab cache
+ */
+static int slab_free ( struct slab_cache *slab, void *ptr ) {
+	struct slab_block *freeing = ptr;
+	struct slab_block *block;
+
+	/* Check that this block is not already cached */
+	if ( ASSERTING ) {
+		for ( block = slab->blocks ; block ; block = block->next ) {
+			VALGRIND_MAKE_MEM_DEFINED ( block, sizeof ( *block ) );
+			assert ( block != freeing );
+			VALGRIND_MAKE_MEM_NOACCESS ( block, sizeof ( *block ) );
+		}
+	}
+
+	/* Do not exceed the maximum total cached size */
+	if ( ( slab_cached + slab->size ) > SLAB_MAX_CACHED )
+		return 0;
+
+	/* Add to slab cache */
+	VALGRIND_MAKE_MEM_NOACCESS ( freeing, slab->size );
+	VALGRIND_MAKE_MEM_UNDEFINED ( freeing, sizeof ( *freeing ) );
+	freeing->next = slab->blocks;
+	slab->blocks = freeing;
+	slab_cached += slab->size;
+	VALGRIND_MAKE_MEM_NOACCESS ( freeing, sizeof ( *freeing ) );
+	return 1;
+}
+
+/**
+ * Discard all blocks held in slab caches
+ *
+ * @ret discarded	Number of cached items discarded
+ */
+static unsigned int slab_discard ( void ) {
+	struct slab_cache *slab;
+	struct slab_block *block;
+	unsigned int discarded = 0;
+	unsigned int i;
+
+	for ( i = 0 ; i < ARRAY_SIZE ( slab_caches ) ; i++ ) {
+		slab = &slab_caches[i];
+		while ( ( block = slab->blocks ) ) {
+			VALGRIND_MAKE_MEM_DEFINED ( block, sizeof ( *block ) );
+			slab->blocks = block->next;
+			slab_cached -= slab->size;
+			heap_free_memblock ( block, slab->size );
+			discarded++;
+		}
+	}
+	assert ( slab_cached == 0 );
+
+	return discarded;
+}
+
+/** Slab cache discarder */
+struct cache_discarder slab_discarder __cache_discarder ( CACHE_CHEAP ) = {
+	.name = "slab",
+	.discard = slab_discard,
+};
+
+/**
+ * Allocate a memory block
+ *
+ * @v size		Requested size
+ * @v align		Physical alignment
+ * @v offset		Offset from physical alignment
+ * @ret ptr		Memory block, or NULL
+ *
+ * Allocates a memory block @b physically aligned as requested.  No
+ * guarantees are provided for the alignment of the virtual address.
+ *
+ * @c align must be a power of two.  @c size may not be zero.
+ */
+void * alloc_memblock ( size_t size, size_t align, size_t offset ) {
+	struct slab_cache *slab;
+	void *ptr;
+
+	/* Record allocation size */
+	if ( PROFILING )
+		profile_update ( &alloc_size_profiler, size );
+	profile_start ( &alloc_profiler );
+
+	/* Use a cached block, if available */
+	slab = slab_find ( size );
+	if ( slab ) {
+		if ( ( ptr = slab_alloc ( slab, align, offset ) ) != NULL )
+			goto done;
+		size = slab->size;
+	}
+
+	/* Otherwise, allocate from the free block list */
+	ptr = heap_alloc_memblock ( size, align, offset );
+
+ done:
+	profile_stop ( &alloc_profiler );
+	return ptr;
+}
+
+/**
+ * Free a memory block
+ *
+ * @v ptr		Memory allocated by alloc_memblock(), or NULL
+ * @v size		Size of the memory
+ *
+ * If @c ptr is NULL, no action is taken.
+ */
+void free_memblock ( void *ptr, size_t size ) {
+	struct slab_cache *slab;
+
+	/* Allow for ptr==NULL */
+	if ( ! ptr )
+		return;
+
+	/* Retain in slab cache, if possible */
+	slab = slab_find ( size );
+	if ( slab ) {
+		if ( slab_free ( slab, ptr ) )
+			return;
+		size = slab->size;
+	}
+
+	/* Otherwise, return to the free block list */
+	heap_free_memblock ( ptr, size );
+}
+
 /**
  * Reallocate memory
  *
@@ -653,7 +965,7 @@ void mpopulate ( void *start, size_t len ) {
 	len &= ~( MIN_MEMBLOCK_SIZE - 1 );
 
 	/* Add to allocation pool */
-	free_memblock ( start, len );
+	heap_free_memblock ( start, len );
 
 	/* Fix up memory usage statistics */
 	usedmem += len;
@@ -674,20 +986,71 @@ struct init_fn heap_init_fn __init_fn ( INIT_EARLY ) = {
 	.initialise = init_heap,
 };
 
+/**
+ * Permit heap extension on startup
+ *
+ */
+static void startup_heap ( void ) {
+	heap_growable = 1;
+}
+
 /**
  * Discard all cached data on shutdown
  *
  */
 static void shutdown_cache ( int booting __unused ) {
+	struct slab_cache *slab;
+	unsigned int i;
+
+	heap_growable = 0;
 	discard_all_cache();
-	DBGC ( &heap, "Maximum heap usage %zdkB\n", ( maxusedmem >> 10 ) );
+	DBGC ( &heap, "Maximum heap usage %zdkB of %zdkB (extended %d "
+	       "times)\n", ( maxusedmem >> 10 ),
+	       ( ( freemem + usedmem ) >> 10 ), heapgrown );
+	for ( i = 0 ; i < ARRAY_SIZE ( slab_caches ) ; i++ ) {
+		slab = &slab_caches[i];
+		DBGC ( &heap, "Slab %#zx %ld hits %ld misses\n",
+		       slab->size, slab->hits, slab->misses );
+	}
 }
 
 /** Memory allocator shutdown function */
 struct startup_fn heap_startup_fn __startup_fn ( STARTUP_EARLY ) = {
+	.startup = startup_heap,
 	.shutdown = shutdown_cache,
 };
 
+/** The "heap-size" setting */
+const struct setting heap_size_setting __setting ( SETTING_MISC,
+						   heap-size ) = {
+	.name = "heap-size",
+	.description = "Target heap size",
+	.type = &setting_type_uint32,
+};
+
+/**
+ * Apply heap settings
+ *
+ * @ret rc		Return status code
+ */
+static int heap_apply ( void ) {
+	unsigned long target;
+
+	/* Apply "heap-size" setting.  The heap can never shrink, so
+	 * this affects only any future extension.
+	 */
+	if ( fetch_uint_setting ( NULL, &heap_size_setting, &target ) < 0 )
+		target = HEAP_TARGET_SIZE;
+	heaptarget = target;
+
+	return 0;
+}
+
+/** Settings applicator */
+struct settings_applicator heap_applicator __settings_applicator = {
+	.apply = heap_apply,
+};
+
 #if 0
 #include <stdio.h>
 /**
@@ -31,7 +31,9 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/keys.h>
 #include <ipxe/job.h>
 #include <ipxe/monojob.h>
+#include <ipxe/nap.h>
 #include <ipxe/timer.h>
+#include <ipxe/trace.h>
 
 /** @file
  *
@@ -71,6 +73,55 @@ static void monojob_clear ( size_t len ) {
 		putchar ( '\b' );
 }
 
+/**
+ * Display transfer rate
+ *
+ * @v bytes		Number of bytes transferred
+ * @v ticks		Time taken, in ticks
+ * @ret len		Length of displayed message
+ */
+static size_t monojob_rate ( unsigned long bytes, unsigned long ticks ) {
+	static const char units[] = "kMG";
+	unsigned long long rate;
+	unsigned int i;
+
+	/* Calculate rate in tenths of a kilobyte per second */
+	if ( ! ticks )
+		return 0;
+	rate = ( ( ( ( unsigned long long ) bytes ) * TICKS_PER_SEC * 10 ) /
+		 ( ticks * 1024ULL ) );
+
+	/* Scale to an appropriate unit */
+	for ( i = 0 ; ( ( rate >= 10240 ) && ( i < ( sizeof ( units ) - 2 ) ) ) ;
+	      i++ ) {
+		rate /= 1024;
+	}
+
+	return printf ( " %lld.%lld%cB/s", ( rate / 10 ), ( rate % 10 ),
+			units[i] );
+}
+
+/**
+ * Display estimated time remaining
+ *
+ * @v remaining		Number of bytes remaining
+ * @v bytes		Number of bytes transferred
+ * @v ticks		Time taken, in ticks
+ * @ret len		Length of displayed message
+ */
+static size_t monojob_eta ( unsigned long remaining, unsigned long bytes,
+			    unsigned long ticks ) {
+	unsigned long long secs;
+
+	/* Extrapolate from average rate so far */
+	if ( ! bytes )
+		return 0;
+	secs = ( ( ( ( unsigned long long ) remaining ) * ticks ) /
+		 ( ( ( unsigned long long ) bytes ) * TICKS_PER_SEC ) );
+
+	return printf ( " ETA %lld:%02lld", ( secs / 60 ), ( secs % 60 ) );
+}
+
 /**
  * Wait for single foreground job to complete
  *
@@ -83,21 +134,26 @@ int monojob_wait ( const char *string, unsigned long timeout ) {
 	unsigned long last_check;
 	unsigned long last_progress;
 	unsigned long last_display;
+	unsigned long start;
 	unsigned long now;
 	unsigned long elapsed;
 	unsigned long completed = 0;
+	unsigned long displayed = 0;
 	unsigned long scaled_completed;
 	unsigned long scaled_total;
 	unsigned int percentage;
 	size_t clear_len = 0;
+	unsigned int trace = 0;
 	int ongoing_rc;
 	int key;
 	int rc;
 
-	if ( string )
+	if ( string ) {
 		printf ( "%s...", string );
+		trace = trace_start ( "%s", string );
+	}
 	monojob_rc = -EINPROGRESS;
-	last_check = last_progress = last_display = currticks();
+	start = last_check = last_progress = last_display = currticks();
 	while ( monojob_rc == -EINPROGRESS ) {
 
 		/* Allow job to progress */
@@ -108,8 +164,11 @@ int monojob_wait ( const char *string, unsigned long timeout ) {
 		 * time wasted checking for progress and keypresses).
 		 */
 		elapsed = ( now - last_check );
-		if ( ! elapsed )
+		if ( ! elapsed ) {
+			/* Sleep until the next interrupt, if idle */
+			cpu_idle();
 			continue;
+		}
 		last_check = now;
 
 		/* Check for keypresses */
@@ -124,9 +183,13 @@ int monojob_wait ( const char *string, unsigned long timeout ) {
 		/* Monitor progress */
 		ongoing_rc = job_progress ( &monojob, &progress );
 
-		/* Reset timeout if progress has been made */
-		if ( completed != progress.completed )
+		/* Reset timeout (and inhibit sleeping) if progress has
+		 * been made
+		 */
+		if ( completed != progress.completed ) {
 			last_progress = now;
+			nap_activity();
+		}
 		completed = progress.completed;
 
 		/* Check for timeout, if applicable */
@@ -151,10 +214,23 @@ int monojob_wait ( const char *string, unsigned long timeout ) {
 				printf ( "." );
 				clear_len = 0;
 			}
+			if ( progress.flags & JOB_PROGRESS_BYTES ) {
+				clear_len += monojob_rate ( ( progress.completed
+							      - displayed ),
+							    elapsed );
+				if ( progress.total > progress.completed ) {
+					clear_len += monojob_eta (
+						( progress.total -
+						  progress.completed ),
+						progress.completed,
+						( now - start ) );
+				}
+			}
 			if ( progress.message[0] ) {
 				clear_len += printf ( " [%s]",
 						      progress.message );
 			}
+			displayed = progress.completed;
 			last_display = now;
 		}
 	}
@@ -163,6 +239,7 @@ int monojob_wait ( const char *string, unsigned long timeout ) {
 
 	monojob_clear ( clear_len );
 	if ( string ) {
+		trace_stop ( trace, rc );
 		if ( rc ) {
 			printf ( " %s\n", strerror ( rc ) );
 		} else {
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <ipxe/timer.h>
+#include <ipxe/nap.h>
+
+/** @file
+ *
+ * CPU idling
+ *
+ * Sleeping the CPU while waiting for input or for a foreground job
+ * to complete frees up host capacity (when running in a virtual
+ * machine) and reduces power consumption.  Since we are woken only
+ * by an interrupt (typically the timer interrupt), sleeping while
+ * there is network activity would limit us to processing packets at
+ * the timer interrupt rate.  We therefore sleep only after a period
+ * with no recorded activity.
+ *
+ */
+
+/** Minimum time since last activity before sleeping */
+#define NAP_IDLE_TICKS ( TICKS_PER_SEC / 4 )
+
+/** Activity has been recorded since the last call to cpu_idle() */
+int nap_busy;
+
+/** Time of most recently observed activity */
+static unsigned long nap_last_active;
+
+/**
+ * Sleep until next CPU interrupt, if idle
+ *
+ */
+void cpu_idle ( void ) {
+	unsigned long now = currticks();
+
+	/* Do not sleep if there has been any recent activity */
+	if ( nap_busy ) {
+		nap_busy = 0;
+		nap_last_active = now;
+		return;
+	}
+	if ( ( now - nap_last_active ) < NAP_IDLE_TICKS )
+		return;
+
+	/* Sleep until next interrupt */
+	cpu_nap();
+}
@@ -30,6 +30,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/uri.h>
 #include <ipxe/socket.h>
 #include <ipxe/open.h>
+#include <ipxe/trace.h>
 
 /** @file
  *
@@ -88,6 +89,9 @@ int xfer_open_uri ( struct interface *intf, struct uri *uri ) {
 	/* Call opener */
 	DBGC ( INTF_COL ( intf ), "INTF " INTF_FMT " opening %s URI\n",
 	       INTF_DBG ( intf ), resolved_uri->scheme );
+	trace_mark ( "open %s:%s", resolved_uri->scheme,
+		     ( resolved_uri->host ? resolved_uri->host :
+		       ( resolved_uri->opaque ? resolved_uri->opaque : "" ) ) );
 	if ( ( rc = opener->open ( intf, resolved_uri ) ) != 0 ) {
 		DBGC ( INTF_COL ( intf ), "INTF " INTF_FMT " could not open: "
 		       "%s\n", INTF_DBG ( intf ), strerror ( rc ) );
@@ -32,9 +32,27 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <stdlib.h>
 #include <errno.h>
 #include <ipxe/umalloc.h>
+#include <ipxe/malloc.h>
+#include <ipxe/crc32.h>
 #include <ipxe/image.h>
 #include <ipxe/pixbuf.h>
 
+/** Most recently created pixel buffer
+ *
+ * Decoding a large background picture is expensive, and the same
+ * image tends to be used repeatedly (e.g. by successive "console
+ * --picture" commands), so we retain the most recently decoded pixel
+ * buffer and reuse it when presented with identical image contents.
+ */
+static struct {
+	/** Pixel buffer (or NULL) */
+	struct pixel_buffer *pixbuf;
+	/** Length of image data */
+	size_t len;
+	/** CRC32 of image data */
+	uint32_t crc;
+} pixbuf_cache;
+
 /**
  * Free pixel buffer
  *
@@ -95,12 +113,23 @@ struct pixel_buffer * alloc_pixbuf ( unsigned int width, unsigned int height ) {
  * @ret rc		Return status code
  */
 int image_pixbuf ( struct image *image, struct pixel_buffer **pixbuf ) {
+	uint32_t crc;
 	int rc;
 
 	/* Check that this image can be used to create a pixel buffer */
 	if ( ! ( image->type && image->type->pixbuf ) )
 		return -ENOTSUP;
 
+	/* Reuse cached pixel buffer if image contents are identical */
+	crc = crc32_le ( 0, user_to_virt ( image->data, 0 ), image->len );
+	if ( pixbuf_cache.pixbuf && ( pixbuf_cache.len == image->len ) &&
+	     ( pixbuf_cache.crc == crc ) ) {
+		DBGC ( image, "IMAGE %s using cached pixel buffer\n",
+		       image->name );
+		*pixbuf = pixbuf_get ( pixbuf_cache.pixbuf );
+		return 0;
+	}
+
 	/* Try creating pixel buffer */
 	if ( ( rc = image->type->pixbuf ( image, pixbuf ) ) != 0 ) {
 		DBGC ( image, "IMAGE %s could not create pixel buffer: %s\n",
@@ -108,9 +137,41 @@ int image_pixbuf ( struct image *image, struct pixel_buffer **pixbuf ) {
 		return rc;
 	}
 
+	/* Cache pixel buffer */
+	if ( pixbuf_cache.pixbuf )
+		pixbuf_put ( pixbuf_cache.pixbuf );
+	pixbuf_cache.pixbuf = pixbuf_get ( *pixbuf );
+	pixbuf_cache.len = image->len;
+	pixbuf_cache.crc = crc;
+
 	return 0;
 }
 
+/**
+ * Discard cached pixel buffer
+ *
+ * @ret discarded	Number of cached items discarded
+ */
+static unsigned int pixbuf_discard ( void ) {
+
+	/* Do nothing unless a pixel buffer is cached */
+	if ( ! pixbuf_cache.pixbuf )
+		return 0;
+
+	/* Drop cached pixel buffer */
+	pixbuf_put ( pixbuf_cache.pixbuf );
+	pixbuf_cache.pixbuf = NULL;
+
+	return 1;
+}
+
+/** Pixel buffer cache discarder */
+struct cache_discarder pixbuf_discarder
+	__cache_discarder ( CACHE_EXPENSIVE ) = {
+	.name = "pixbuf",
+	.discard = pixbuf_discard,
+};
+
 /* Drag in objects via image_pixbuf() */
 REQUIRING_SYMBOL ( image_pixbuf );
 
@@ -23,8 +23,11 @@
 
 FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
+#include <assert.h>
 #include <ipxe/list.h>
 #include <ipxe/init.h>
+#include <ipxe/timer.h>
+#include <ipxe/profile.h>
 #include <ipxe/process.h>
 
 /** @file
@@ -35,8 +38,24 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  * all processes share a single stack and address space.
  */
 
-/** Process run queue */
-static LIST_HEAD ( run_queue );
+/** Process run queues, indexed by priority */
+static struct list_head run_queues[PROCESS_PRIORITIES] = {
+	[PROCESS_PRIORITY_NORMAL] =
+		LIST_HEAD_INIT ( run_queues[PROCESS_PRIORITY_NORMAL] ),
+	[PROCESS_PRIORITY_HIGH] =
+		LIST_HEAD_INIT ( run_queues[PROCESS_PRIORITY_HIGH] ),
+};
+
+/** Most recent step was of a high-priority process */
+static int stepped_high;
+
+/** List of process descriptors with recorded statistics */
+LIST_HEAD ( process_stats );
+
+/** Minimum duration of a single step for a process to be reported
+ * as hogging the CPU
+ */
+#define PROCESS_HOG_TICKS ( TICKS_PER_SEC / 10 )
 
 /**
  * Get pointer to object containing process
@@ -60,8 +79,10 @@ void process_add ( struct process *process ) {
 	if ( ! process_running ( process ) ) {
 		DBGC ( PROC_COL ( process ), "PROCESS " PROC_FMT
 		       " starting\n", PROC_DBG ( process ) );
+		assert ( process->desc->priority < PROCESS_PRIORITIES );
 		ref_get ( process->refcnt );
-		list_add_tail ( &process->list, &run_queue );
+		list_add_tail ( &process->list,
+				&run_queues[process->desc->priority] );
 	} else {
 		DBGC ( PROC_COL ( process ), "PROCESS " PROC_FMT
 		       " already started\n", PROC_DBG ( process ) );
@@ -89,37 +110,108 @@ void process_del ( struct process *process ) {
 	}
 }
 
+/**
+ * Record process execution statistics
+ *
+ * @v process		Process
+ * @v ticks		Time spent executing step (in profiler ticks)
+ * @v elapsed		Time spent executing step (in timer ticks)
+ */
+static void process_account ( struct process *process, unsigned long ticks,
+			      unsigned long elapsed ) {
+	struct process_descriptor *desc = process->desc;
+
+	/* Add to list of descriptors with recorded statistics */
+	if ( ! desc->steps )
+		list_add_tail ( &desc->stats, &process_stats );
+
+	/* Update statistics */
+	desc->steps++;
+	desc->ticks += ticks;
+	if ( ticks > desc->max )
+		desc->max = ticks;
+
+	/* Report processes hogging the CPU */
+	if ( elapsed >= PROCESS_HOG_TICKS ) {
+		DBGC ( PROC_COL ( process ), "PROCESS " PROC_FMT " hogged "
+		       "CPU for %ldms\n", PROC_DBG ( process ),
+		       ( ( elapsed * 1000 ) / TICKS_PER_SEC ) );
+	}
+}
+
 /**
  * Single-step a single process
  *
- * This executes a single step of the first process in the run queue,
- * and moves the process to the end of the run queue.
+ * This executes a single step of the first process in the selected
+ * run queue, and moves the process to the end of that run queue.
+ * High-priority and normal-priority run queues are selected
+ * alternately, so that high-priority processes are executed at least
+ * every other step without starving normal-priority processes.
  */
 void step ( void ) {
+	struct list_head *high = &run_queues[PROCESS_PRIORITY_HIGH];
+	struct list_head *normal = &run_queues[PROCESS_PRIORITY_NORMAL];
+	struct list_head *queue;
 	struct process *process;
 	struct process_descriptor *desc;
+	unsigned long started = 0;
+	unsigned long start_ticks = 0;
 	void *object;
 
-	if ( ( process = list_first_entry ( &run_queue, struct process,
+	/* Select run queue */
+	if ( list_empty ( high ) ||
+	     ( stepped_high && ( ! list_empty ( normal ) ) ) ) {
+		queue = normal;
+	} else {
+		queue = high;
+	}
+	stepped_high = ( queue == high );
+
+	if ( ( process = list_first_entry ( queue, struct process,
 					    list ) ) ) {
 		ref_get ( process->refcnt ); /* Inhibit destruction mid-step */
 		desc = process->desc;
 		object = process_object ( process );
 		if ( desc->reschedule ) {
 			list_del ( &process->list );
-			list_add_tail ( &process->list, &run_queue );
+			list_add_tail ( &process->list, queue );
 		} else {
 			process_del ( process );
 		}
 		DBGC2 ( PROC_COL ( process ), "PROCESS " PROC_FMT
 			" executing\n", PROC_DBG ( process ) );
+		if ( PROFILING ) {
+			start_ticks = currticks();
+			started = profile_timestamp();
+		}
 		desc->step ( object );
+		if ( PROFILING ) {
+			process_account ( process,
+					  ( profile_timestamp() - started ),
+					  ( currticks() - start_ticks ) );
+		}
 		DBGC2 ( PROC_COL ( process ), "PROCESS " PROC_FMT
 			" finished executing\n", PROC_DBG ( process ) );
 		ref_put ( process->refcnt ); /* Allow destruction */
 	}
 }
 
+/**
+ * Reset process execution statistics
+ *
+ */
+void process_stats_reset ( void ) {
+	struct process_descriptor *desc;
+	struct process_descriptor *tmp;
+
+	list_for_each_entry_safe ( desc, tmp, &process_stats, stats ) {
+		list_del ( &desc->stats );
+		desc->steps = 0;
+		desc->ticks = 0;
+		desc->max = 0;
+	}
+}
+
 /**
  * Initialise processes
  *
@@ -25,6 +25,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <strings.h>
 #include <limits.h>
 #include <assert.h>
@@ -108,6 +109,7 @@ static inline unsigned int profile_accvar_shift ( struct profiler *profiler ) {
  * @v sample		Sample value
  */
 void profile_update ( struct profiler *profiler, unsigned long sample ) {
+	unsigned int bucket;
 	unsigned int sample_msb;
 	unsigned int mean_shift;
 	unsigned int delta_shift;
@@ -127,6 +129,12 @@ void profile_update ( struct profiler *profiler, unsigned long sample ) {
 	if ( profiler->count < INT_MAX )
 		profiler->count++;
 
+	/* Update histogram */
+	bucket = flsl ( sample );
+	if ( bucket >= PROFILE_HISTOGRAM_BUCKETS )
+		bucket = ( PROFILE_HISTOGRAM_BUCKETS - 1 );
+	profiler->histogram[bucket]++;
+
 	/* Adjust mean sample value scale if necessary.  Skip if
 	 * sample is zero (in which case flsl(sample)-1 would
 	 * underflow): in the case of a zero sample we have no need to
@@ -232,6 +240,21 @@ void profile_update ( struct profiler *profiler, unsigned long sample ) {
 	}
 }
 
+/**
+ * Reset profiling statistics
+ *
+ * @v profiler		Profiler
+ */
+void profile_reset ( struct profiler *profiler ) {
+
+	profiler->count = 0;
+	profiler->mean = 0;
+	profiler->mean_msb = 0;
+	profiler->accvar = 0;
+	profiler->accvar_msb = 0;
+	memset ( profiler->histogram, 0, sizeof ( profiler->histogram ) );
+}
+
 /**
  * Get mean sample value
  *
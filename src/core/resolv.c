@@ -32,6 +32,9 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/process.h>
 #include <ipxe/socket.h>
 #include <ipxe/resolv.h>
+#include <ipxe/retry.h>
+#include <ipxe/timer.h>
+#include <ipxe/trace.h>
 
 /** @file
  *
@@ -150,6 +153,8 @@ struct resolv_mux {
 
 	/** Socket address to complete */
 	struct sockaddr sa;
+	/** Trace event identifier */
+	unsigned int trace;
 	/** Name to be resolved
 	 *
 	 * Must be at end of structure
@@ -223,6 +228,7 @@ static void resmux_child_close ( struct resolv_mux *mux, int rc ) {
 	return;
 
  finished:
+	trace_stop ( mux->trace, rc );
 	resmux_close ( mux, rc );
 }
 
@@ -278,8 +284,11 @@ int resolv ( struct interface *resolv, const char *name,
 	 * least one resolver (the numeric resolver), so no need to
 	 * check for the zero-resolvers-available case.
 	 */
-	if ( ( rc = resmux_try ( mux ) ) != 0 )
+	mux->trace = trace_start ( "resolve %s", name );
+	if ( ( rc = resmux_try ( mux ) ) != 0 ) {
+		trace_stop ( mux->trace, rc );
 		goto err;
+	}
 
 	/* Attach parent interface, mortalise self, and return */
 	intf_plug_plug ( &mux->parent, resolv );
@@ -298,6 +307,24 @@ int resolv ( struct interface *resolv, const char *name,
  ***************************************************************************
  */
 
+/** Maximum number of addresses used for connection attempts */
+#define NAMED_MAX_ATTEMPTS 4
+
+/** Connection attempt delay (as per RFC 8305 section 5) */
+#define NAMED_ATTEMPT_DELAY ( TICKS_PER_SEC / 4 )
+
+/** A named socket connection attempt */
+struct named_attempt {
+	/** Containing named socket */
+	struct named_socket *named;
+	/** Data transfer interface */
+	struct interface xfer;
+	/** Peer socket address */
+	struct sockaddr peer;
+	/** Connection attempt is in progress */
+	int running;
+};
+
 /** A named socket */
 struct named_socket {
 	/** Reference counter */
@@ -312,6 +339,19 @@ struct named_socket {
 	struct sockaddr local;
 	/** Stored local socket address exists */
 	int have_local;
+
+	/** Connection attempts */
+	struct named_attempt attempts[NAMED_MAX_ATTEMPTS];
+	/** Number of resolved addresses */
+	unsigned int count;
+	/** Number of connection attempts started */
+	unsigned int started;
+	/** Connection attempt delay timer */
+	struct retry_timer timer;
+	/** Name resolution is still in progress */
+	int resolving;
+	/** Most recent connection attempt failure status */
+	int rc;
 };
 
 /**
@@ -321,7 +361,14 @@ struct named_socket {
  * @v rc		Reason for termination
  */
 static void named_close ( struct named_socket *named, int rc ) {
+	unsigned int i;
+
+	/* Stop connection attempt delay timer */
+	stop_timer ( &named->timer );
+
 	/* Shut down interfaces */
+	for ( i = 0 ; i < NAMED_MAX_ATTEMPTS ; i++ )
+		intf_shutdown ( &named->attempts[i].xfer, rc );
 	intf_shutdown ( &named->resolv, rc );
 	intf_shutdown ( &named->xfer, rc );
 }
@@ -348,6 +395,158 @@ static struct interface_descriptor named_xfer_desc =
 	INTF_DESC_PASSTHRU ( struct named_socket, xfer, named_xfer_ops,
 			     resolv );
 
+/**
+ * Check if any connection attempt is in progress
+ *
+ * @v named		Named socket
+ * @ret running		A connection attempt is in progress
+ */
+static int named_running ( struct named_socket *named ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < named->started ; i++ ) {
+		if ( named->attempts[i].running )
+			return 1;
+	}
+	return 0;
+}
+
+/**
+ * Start next connection attempt
+ *
+ * @v named		Named socket
+ */
+static void named_next ( struct named_socket *named ) {
+	struct sockaddr *local = ( named->have_local ? &named->local : NULL );
+	struct named_attempt *attempt;
+	int rc;
+
+	/* Start the next connection attempt (if any) that can be
+	 * opened successfully.
+	 */
+	while ( named->started < named->count ) {
+		attempt = &named->attempts[ named->started++ ];
+		DBGC ( named, "NAMED %p attempting %s\n",
+		       named, sock_ntoa ( &attempt->peer ) );
+		rc = xfer_open_socket ( &attempt->xfer, named->semantics,
+					&attempt->peer, local );
+		if ( rc != 0 ) {
+			DBGC ( named, "NAMED %p could not open %s: %s\n",
+			       named, sock_ntoa ( &attempt->peer ),
+			       strerror ( rc ) );
+			named->rc = rc;
+			continue;
+		}
+		attempt->running = 1;
+		start_timer_fixed ( &named->timer, NAMED_ATTEMPT_DELAY );
+		return;
+	}
+
+	/* Fail if there is nothing left to try */
+	if ( ! ( named->resolving || named_running ( named ) ) )
+		named_close ( named, named->rc );
+}
+
+/**
+ * Handle connection attempt delay timer expiry
+ *
+ * @v timer		Connection attempt delay timer
+ * @v fail		Failure indicator
+ */
+static void named_expired ( struct retry_timer *timer, int fail __unused ) {
+	struct named_socket *named =
+		container_of ( timer, struct named_socket, timer );
+
+	/* Start next connection attempt, if an address is available.
+	 * (If no address is yet available, then the next connection
+	 * attempt will start as soon as the address is resolved.)
+	 */
+	if ( named->started < named->count )
+		named_next ( named );
+}
+
+/**
+ * Handle connection attempt window change
+ *
+ * @v attempt		Connection attempt
+ */
+static void named_attempt_window_changed ( struct named_attempt *attempt ) {
+	struct named_socket *named = attempt->named;
+
+	/* Do nothing until the connection is established */
+	if ( ! xfer_window ( &attempt->xfer ) )
+		return;
+	DBGC ( named, "NAMED %p connected to %s\n",
+	       named, sock_ntoa ( &attempt->peer ) );
+
+	/* Plug our parent directly into the winning socket, and
+	 * notify our parent that the window has opened.
+	 */
+	intf_plug_plug ( named->xfer.dest, attempt->xfer.dest );
+	xfer_window_changed ( &named->xfer );
+	intf_unplug ( &named->xfer );
+	intf_unplug ( &attempt->xfer );
+	attempt->running = 0;
+
+	/* Abandon all other connection attempts */
+	named_close ( named, 0 );
+}
+
+/**
+ * Handle connection attempt failure
+ *
+ * @v attempt		Connection attempt
+ * @v rc		Reason for close
+ */
+static void named_attempt_close ( struct named_attempt *attempt, int rc ) {
+	struct named_socket *named = attempt->named;
+
+	DBGC ( named, "NAMED %p could not connect to %s: %s\n",
+	       named, sock_ntoa ( &attempt->peer ), strerror ( rc ) );
+
+	/* Mark attempt as failed */
+	intf_restart ( &attempt->xfer, rc );
+	attempt->running = 0;
+	named->rc = ( rc ? rc : -ECONNRESET );
+
+	/* Start next connection attempt immediately, if possible */
+	if ( ! named_running ( named ) )
+		named_next ( named );
+}
+
+/** Named socket connection attempt interface operations */
+static struct interface_operation named_attempt_ops[] = {
+	INTF_OP ( xfer_window_changed, struct named_attempt *,
+		  named_attempt_window_changed ),
+	INTF_OP ( intf_close, struct named_attempt *, named_attempt_close ),
+};
+
+/** Named socket connection attempt interface descriptor */
+static struct interface_descriptor named_attempt_desc =
+	INTF_DESC ( struct named_attempt, xfer, named_attempt_ops );
+
+/**
+ * Check if connection attempts may be raced
+ *
+ * @v named		Named socket
+ * @ret race		Connection attempts may be raced
+ *
+ * Racing connection attempts is meaningful only for stream sockets.
+ * The winning connection is plugged directly into our parent, which
+ * is equivalent to the default handling of a redirection.  Parents
+ * that intercept redirections (e.g. to record the peer address)
+ * receive a redirection to the first resolved address instead.
+ */
+static int named_can_race ( struct named_socket *named ) {
+	struct interface *dest;
+	xfer_vredirect_TYPE ( void * ) *op =
+		intf_get_dest_op_no_passthru ( &named->xfer, xfer_vredirect,
+					       &dest );
+
+	intf_put ( dest );
+	return ( ( named->semantics == SOCK_STREAM ) && ( ! op ) );
+}
+
 /**
  * Name resolved
  *
@@ -356,8 +555,31 @@ static struct interface_descriptor named_xfer_desc =
  */
 static void named_resolv_done ( struct named_socket *named,
 				struct sockaddr *sa ) {
+	struct named_attempt *attempt;
 	int rc;
 
+	/* Race connection attempts to each address, if possible, as
+	 * described in RFC 8305.
+	 */
+	if ( named_can_race ( named ) ) {
+
+		/* Ignore excess addresses */
+		if ( named->count >= NAMED_MAX_ATTEMPTS )
+			return;
+
+		/* Record address */
+		attempt = &named->attempts[ named->count++ ];
+		memcpy ( &attempt->peer, sa, sizeof ( attempt->peer ) );
+
+		/* Start connection attempt immediately unless we are
+		 * still within the connection attempt delay of a
+		 * previous connection attempt.
+		 */
+		if ( ! timer_running ( &named->timer ) )
+			named_next ( named );
+		return;
+	}
+
 	/* Nullify data transfer interface */
 	intf_nullify ( &named->xfer );
 
@@ -379,9 +601,36 @@ static void named_resolv_done ( struct named_socket *named,
 	named_close ( named, rc );
 }
 
+/**
+ * Name resolution complete
+ *
+ * @v named		Named socket
+ * @v rc		Reason for close
+ */
+static void named_resolv_close ( struct named_socket *named, int rc ) {
+
+	/* Terminate named socket opener on failure, or if no
+	 * connection attempts will be made.
+	 */
+	intf_restart ( &named->resolv, rc );
+	named->resolving = 0;
+	if ( ! named->count ) {
+		named_close ( named, ( rc ? rc : -ENXIO ) );
+		return;
+	}
+
+	/* Otherwise, terminate only if all connection attempts
+	 * have failed.
+	 */
+	if ( ! ( named_running ( named ) ||
+		 ( named->started < named->count ) ) ) {
+		named_close ( named, named->rc );
+	}
+}
+
 /** Named socket opener resolver interface operations */
 static struct interface_operation named_resolv_op[] = {
-	INTF_OP ( intf_close, struct named_socket *, named_close ),
+	INTF_OP ( intf_close, struct named_socket *, named_resolv_close ),
 	INTF_OP ( resolv_done, struct named_socket *, named_resolv_done ),
 };
 
@@ -403,6 +652,8 @@ int xfer_open_named_socket ( struct interface *xfer, int semantics,
 			     struct sockaddr *peer, const char *name,
 			     struct sockaddr *local ) {
 	struct named_socket *named;
+	struct named_attempt *attempt;
+	unsigned int i;
 	int rc;
 
 	/* Allocate and initialise structure */
@@ -412,7 +663,16 @@ int xfer_open_named_socket ( struct interface *xfer, int semantics,
 	ref_init ( &named->refcnt, NULL );
 	intf_init ( &named->xfer, &named_xfer_desc, &named->refcnt );
 	intf_init ( &named->resolv, &named_resolv_desc, &named->refcnt );
+	for ( i = 0 ; i < NAMED_MAX_ATTEMPTS ; i++ ) {
+		attempt = &named->attempts[i];
+		attempt->named = named;
+		intf_init ( &attempt->xfer, &named_attempt_desc,
+			    &named->refcnt );
+	}
+	timer_init ( &named->timer, named_expired, &named->refcnt );
 	named->semantics = semantics;
+	named->resolving = 1;
+	named->rc = -ENXIO;
 	if ( local ) {
 		memcpy ( &named->local, local, sizeof ( named->local ) );
 		named->have_local = 1;
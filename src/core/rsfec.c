@@ -0,0 +1,445 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <ipxe/rsfec.h>
+
+/** @file
+ *
+ * Reed-Solomon forward error correction
+ *
+ * This is a systematic Reed-Solomon erasure code over GF(2^8), using
+ * the primitive polynomial x^8+x^4+x^3+x^2+1 as specified for m=8 in
+ * RFC 5510.
+ *
+ * The generator matrix is derived from the n x k Vandermonde matrix
+ * V with V[i][j] = x_i^j, where x_0 = 0 and x_i = alpha^(i-1).  This
+ * matrix is multiplied by the inverse of its own upper k x k portion
+ * to obtain a systematic generator matrix, in which the first k
+ * encoding symbols are the source symbols and any k rows are
+ * linearly independent.  This is the construction used by Rizzo's
+ * widely deployed erasure code, on which RFC 5510 is based.
+ *
+ * Any k distinct encoding symbols are therefore sufficient to
+ * reconstruct a source block.
+ */
+
+/** Primitive polynomial (excluding the x^8 term) */
+#define RSFEC_POLY 0x1d
+
+/** Exponent table (duplicated to avoid the need for modular reduction) */
+static uint8_t rsfec_exp[ 2 * 255 ];
+
+/** Logarithm table */
+static uint8_t rsfec_log[256];
+
+/**
+ * Construct exponent and logarithm tables
+ *
+ */
+static void rsfec_tables ( void ) {
+	unsigned int value;
+	unsigned int i;
+
+	/* Do nothing if tables have already been constructed */
+	if ( rsfec_exp[0] )
+		return;
+
+	/* Construct tables */
+	value = 1;
+	for ( i = 0 ; i < 255 ; i++ ) {
+		rsfec_exp[i] = value;
+		rsfec_exp[ i + 255 ] = value;
+		rsfec_log[value] = i;
+		value <<= 1;
+		if ( value & 0x100 )
+			value ^= ( 0x100 | RSFEC_POLY );
+	}
+}
+
+/**
+ * Multiply field elements
+ *
+ * @v a			Multiplicand
+ * @v b			Multiplier
+ * @ret product		Product
+ */
+static inline uint8_t rsfec_mul ( uint8_t a, uint8_t b ) {
+
+	if ( ! ( a && b ) )
+		return 0;
+	return rsfec_exp[ rsfec_log[a] + rsfec_log[b] ];
+}
+
+/**
+ * Calculate multiplicative inverse of (non-zero) field element
+ *
+ * @v a			Field element
+ * @ret inverse		Inverse
+ */
+static inline uint8_t rsfec_inverse ( uint8_t a ) {
+
+	return rsfec_exp[ 255 - rsfec_log[a] ];
+}
+
+/**
+ * Calculate power of field element
+ *
+ * @v x			Field element
+ * @v power		Power
+ * @ret result		Result
+ */
+static uint8_t rsfec_pow ( uint8_t x, unsigned int power ) {
+
+	if ( ! power )
+		return 1;
+	if ( ! x )
+		return 0;
+	return rsfec_exp[ ( rsfec_log[x] * power ) % 255 ];
+}
+
+/**
+ * Add multiple of one symbol to another
+ *
+ * @v dst		Destination symbol
+ * @v src		Source symbol
+ * @v coeff		Coefficient
+ * @v len		Symbol length
+ */
+static void rsfec_addmul ( uint8_t *dst, const uint8_t *src, uint8_t coeff,
+			   size_t len ) {
+	unsigned int log_coeff;
+
+	/* Handle trivial coefficients */
+	if ( ! coeff )
+		return;
+	if ( coeff == 1 ) {
+		while ( len-- )
+			*(dst++) ^= *(src++);
+		return;
+	}
+
+	/* Add multiple of source */
+	log_coeff = rsfec_log[coeff];
+	for ( ; len-- ; dst++, src++ ) {
+		if ( *src )
+			*dst ^= rsfec_exp[ log_coeff + rsfec_log[*src] ];
+	}
+}
+
+/**
+ * Invert square matrix
+ *
+ * @v matrix		Matrix (will be destroyed)
+ * @v inverse		Inverse matrix to fill in
+ * @v size		Number of rows (and columns)
+ * @ret rc		Return status code
+ */
+static int rsfec_invert ( uint8_t *matrix, uint8_t *inverse,
+			  unsigned int size ) {
+	uint8_t *pivot_row;
+	uint8_t *row;
+	uint8_t coeff;
+	uint8_t tmp;
+	unsigned int col;
+	unsigned int i;
+	unsigned int j;
+
+	/* Start with identity matrix */
+	memset ( inverse, 0, ( size * size ) );
+	for ( i = 0 ; i < size ; i++ )
+		inverse[ i * size + i ] = 1;
+
+	/* Perform Gauss-Jordan elimination */
+	for ( col = 0 ; col < size ; col++ ) {
+
+		/* Find a pivot row */
+		for ( i = col ; i < size ; i++ ) {
+			if ( matrix[ i * size + col ] )
+				break;
+		}
+		if ( i == size )
+			return -EINVAL;
+
+		/* Swap pivot row into place */
+		if ( i != col ) {
+			for ( j = 0 ; j < size ; j++ ) {
+				tmp = matrix[ i * size + j ];
+				matrix[ i * size + j ] =
+					matrix[ col * size + j ];
+				matrix[ col * size + j ] = tmp;
+				tmp = inverse[ i * size + j ];
+				inverse[ i * size + j ] =
+					inverse[ col * size + j ];
+				inverse[ col * size + j ] = tmp;
+			}
+		}
+
+		/* Normalise pivot row */
+		pivot_row = &matrix[ col * size ];
+		coeff = rsfec_inverse ( pivot_row[col] );
+		for ( j = 0 ; j < size ; j++ ) {
+			pivot_row[j] = rsfec_mul ( pivot_row[j], coeff );
+			inverse[ col * size + j ] =
+				rsfec_mul ( inverse[ col * size + j ], coeff );
+		}
+
+		/* Eliminate column from all other rows */
+		for ( i = 0 ; i < size ; i++ ) {
+			row = &matrix[ i * size ];
+			coeff = row[col];
+			if ( ( i == col ) || ( ! coeff ) )
+				continue;
+			rsfec_addmul ( row, pivot_row, coeff, size );
+			rsfec_addmul ( &inverse[ i * size ],
+				       &inverse[ col * size ], coeff, size );
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Initialise Reed-Solomon erasure code
+ *
+ * @v code		Erasure code
+ * @v k			Number of source symbols per block
+ * @v n			Number of encoding symbols per block
+ * @ret rc		Return status code
+ */
+int rsfec_init ( struct rsfec_code *code, unsigned int k, unsigned int n ) {
+	uint8_t *vandermonde;
+	uint8_t *inverse;
+	uint8_t *repair;
+	uint8_t coeff;
+	unsigned int i;
+	unsigned int j;
+	unsigned int r;
+	int rc;
+
+	/* Sanity checks */
+	if ( ( k == 0 ) || ( k > n ) || ( n > RSFEC_MAX_N ) )
+		return -EINVAL;
+
+	/* Construct tables, if not already done */
+	rsfec_tables();
+
+	/* Allocate repair coefficients and temporary matrices */
+	code->k = k;
+	code->n = n;
+	code->repair = malloc ( ( n - k ) * k );
+	vandermonde = malloc ( 2 * k * k );
+	if ( ! ( code->repair && vandermonde ) ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	inverse = ( vandermonde + ( k * k ) );
+
+	/* Construct and invert upper portion of Vandermonde matrix */
+	for ( i = 0 ; i < k ; i++ ) {
+		coeff = ( i ? rsfec_exp[ i - 1 ] : 0 );
+		for ( j = 0 ; j < k ; j++ )
+			vandermonde[ i * k + j ] = rsfec_pow ( coeff, j );
+	}
+	if ( ( rc = rsfec_invert ( vandermonde, inverse, k ) ) != 0 )
+		goto err_invert;
+
+	/* Construct repair coefficients */
+	for ( r = k ; r < n ; r++ ) {
+		repair = &code->repair[ ( r - k ) * k ];
+		memset ( repair, 0, k );
+		for ( i = 0 ; i < k ; i++ ) {
+			coeff = rsfec_pow ( rsfec_exp[ r - 1 ], i );
+			rsfec_addmul ( repair, &inverse[ i * k ], coeff, k );
+		}
+	}
+
+	free ( vandermonde );
+	return 0;
+
+ err_invert:
+ err_alloc:
+	free ( vandermonde );
+	rsfec_fini ( code );
+	return rc;
+}
+
+/**
+ * Free Reed-Solomon erasure code
+ *
+ * @v code		Erasure code
+ */
+void rsfec_fini ( struct rsfec_code *code ) {
+
+	free ( code->repair );
+	code->repair = NULL;
+}
+
+/**
+ * Construct encoding symbol
+ *
+ * @v code		Erasure code
+ * @v source		Source symbols
+ * @v esi		Encoding symbol ID
+ * @v symbol		Encoding symbol to fill in
+ * @v len		Symbol length
+ * @ret rc		Return status code
+ */
+int rsfec_encode ( struct rsfec_code *code, const void **source,
+		   unsigned int esi, void *symbol, size_t len ) {
+	const uint8_t *repair;
+	unsigned int i;
+
+	/* Sanity check */
+	if ( esi >= code->n )
+		return -EINVAL;
+
+	/* Source symbols are transmitted as-is */
+	if ( esi < code->k ) {
+		memcpy ( symbol, source[esi], len );
+		return 0;
+	}
+
+	/* Construct repair symbol */
+	repair = &code->repair[ ( esi - code->k ) * code->k ];
+	memset ( symbol, 0, len );
+	for ( i = 0 ; i < code->k ; i++ )
+		rsfec_addmul ( symbol, source[i], repair[i], len );
+
+	return 0;
+}
+
+/**
+ * Reconstruct source symbols
+ *
+ * @v code		Erasure code
+ * @v symbols		Received encoding symbols
+ * @v esis		Received encoding symbol IDs
+ * @v len		Symbol length
+ * @ret rc		Return status code
+ *
+ * The caller must provide exactly k distinct received encoding
+ * symbols, in any order.  On successful return, the symbol buffers
+ * (and the corresponding encoding symbol IDs) will have been
+ * rearranged and overwritten such that @c symbols[i] holds source
+ * symbol @c i.
+ */
+int rsfec_decode ( struct rsfec_code *code, void **symbols,
+		   unsigned int *esis, size_t len ) {
+	uint8_t seen[ ( RSFEC_MAX_N + 7 ) / 8 ];
+	uint8_t missing[RSFEC_MAX_N];
+	unsigned int k = code->k;
+	const uint8_t *repair;
+	uint8_t *matrix;
+	uint8_t *inverse;
+	uint8_t *output;
+	unsigned int count;
+	unsigned int esi;
+	unsigned int i;
+	unsigned int j;
+	void *tmp;
+	int rc;
+
+	/* Check that encoding symbol IDs are valid and distinct */
+	memset ( seen, 0, sizeof ( seen ) );
+	for ( i = 0 ; i < k ; i++ ) {
+		esi = esis[i];
+		if ( esi >= code->n )
+			return -EINVAL;
+		if ( seen[ esi / 8 ] & ( 1 << ( esi % 8 ) ) )
+			return -EINVAL;
+		seen[ esi / 8 ] |= ( 1 << ( esi % 8 ) );
+	}
+
+	/* Move each received source symbol into its own position */
+	for ( i = 0 ; i < k ; i++ ) {
+		while ( ( ( esi = esis[i] ) < k ) && ( esi != i ) ) {
+			tmp = symbols[esi];
+			symbols[esi] = symbols[i];
+			symbols[i] = tmp;
+			esis[i] = esis[esi];
+			esis[esi] = esi;
+		}
+	}
+
+	/* Identify missing source symbols (whose positions now hold
+	 * repair symbols).
+	 */
+	count = 0;
+	for ( i = 0 ; i < k ; i++ ) {
+		if ( esis[i] >= k )
+			missing[count++] = i;
+	}
+	if ( ! count )
+		return 0;
+
+	/* Allocate reduced decoding matrices and output symbols */
+	matrix = malloc ( ( 2 * count * count ) + ( count * len ) );
+	if ( ! matrix )
+		return -ENOMEM;
+	inverse = ( matrix + ( count * count ) );
+	output = ( inverse + ( count * count ) );
+
+	/* Remove the contribution of all received source symbols from
+	 * each repair symbol, and construct the reduced matrix
+	 * relating the remainders to the missing source symbols.
+	 */
+	for ( i = 0 ; i < count ; i++ ) {
+		repair = &code->repair[ ( esis[ missing[i] ] - k ) * k ];
+		for ( j = 0 ; j < k ; j++ ) {
+			if ( esis[j] < k ) {
+				rsfec_addmul ( symbols[ missing[i] ],
+					       symbols[j], repair[j], len );
+			}
+		}
+		for ( j = 0 ; j < count ; j++ )
+			matrix[ i * count + j ] = repair[ missing[j] ];
+	}
+
+	/* Invert reduced matrix */
+	if ( ( rc = rsfec_invert ( matrix, inverse, count ) ) != 0 )
+		goto err_invert;
+
+	/* Reconstruct missing source symbols */
+	memset ( output, 0, ( count * len ) );
+	for ( i = 0 ; i < count ; i++ ) {
+		for ( j = 0 ; j < count ; j++ ) {
+			rsfec_addmul ( &output[ i * len ],
+				       symbols[ missing[j] ],
+				       inverse[ i * count + j ], len );
+		}
+	}
+	for ( i = 0 ; i < count ; i++ ) {
+		memcpy ( symbols[ missing[i] ], &output[ i * len ], len );
+		esis[ missing[i] ] = missing[i];
+	}
+
+ err_invert:
+	free ( matrix );
+	return rc;
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * Sampling profiler
+ *
+ * A platform timer interrupt periodically records the interrupted
+ * instruction pointer (as an offset within iPXE's text section) into
+ * a fixed-size histogram.  This reveals hot spots in code that has
+ * not been explicitly instrumented using profile_start() and
+ * profile_stop().  Offsets may be symbolised offline against the
+ * build's ELF file, e.g. using addr2line.
+ *
+ * Samples are recorded from interrupt context, and so the histogram
+ * is a statically allocated open-addressed hash table that is never
+ * resized.
+ *
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <ipxe/sampler.h>
+
+/** Sampling profiler histogram */
+static struct sampler_bucket sampler_buckets[SAMPLER_BUCKETS];
+
+/** Sampling profiler statistics */
+static struct sampler_statistics sampler_stats;
+
+/**
+ * Record sample
+ *
+ * @v offset		Instruction pointer offset, or SAMPLER_EXTERNAL
+ *
+ * This is called from interrupt context.
+ */
+void sampler_record ( unsigned long offset ) {
+	struct sampler_bucket *bucket;
+	unsigned int index;
+	unsigned int i;
+
+	/* Count sample */
+	sampler_stats.total++;
+	if ( offset == SAMPLER_EXTERNAL ) {
+		sampler_stats.external++;
+		return;
+	}
+
+	/* Find or allocate bucket */
+	index = ( ( offset ^ ( offset >> 12 ) ) * 0x9e3779b1UL );
+	for ( i = 0 ; i < SAMPLER_MAX_PROBES ; i++, index++ ) {
+		bucket = &sampler_buckets[ index % SAMPLER_BUCKETS ];
+		if ( bucket->count && ( bucket->offset != offset ) )
+			continue;
+		bucket->offset = offset;
+		bucket->count++;
+		return;
+	}
+
+	/* Histogram is full */
+	sampler_stats.lost++;
+}
+
+/**
+ * Record samples taken outside iPXE
+ *
+ * @v count		Number of samples
+ *
+ * This may be used by timer sources that can only count (rather than
+ * sample) interrupts that occur outside iPXE.
+ */
+void sampler_external ( unsigned int count ) {
+
+	sampler_stats.total += count;
+	sampler_stats.external += count;
+}
+
+/**
+ * Discard recorded samples
+ *
+ */
+void sampler_clear ( void ) {
+
+	memset ( sampler_buckets, 0, sizeof ( sampler_buckets ) );
+	sampler_stats.total = 0;
+	sampler_stats.external = 0;
+	sampler_stats.lost = 0;
+}
+
+/**
+ * Start sampling
+ *
+ * @ret rc		Return status code
+ *
+ * Any previously recorded samples will be discarded.
+ */
+int sampler_start ( void ) {
+	struct sampler_source *source;
+	int rc;
+
+	/* Stop any existing sampling */
+	sampler_stop();
+	sampler_clear();
+
+	/* Use first available timer source */
+	for_each_table_entry ( source, SAMPLER_SOURCES ) {
+		if ( ( rc = source->start() ) != 0 ) {
+			DBGC ( &sampler_stats, "SAMPLER could not start %s: "
+			       "%s\n", source->name, strerror ( rc ) );
+			continue;
+		}
+		DBGC ( &sampler_stats, "SAMPLER started %s\n", source->name );
+		sampler_stats.source = source;
+		sampler_stats.section = source->section;
+		return 0;
+	}
+
+	return -ENOTSUP;
+}
+
+/**
+ * Stop sampling
+ *
+ * Recorded samples are retained until the next call to
+ * sampler_start() or sampler_clear().
+ */
+void sampler_stop ( void ) {
+	struct sampler_source *source = sampler_stats.source;
+
+	if ( source ) {
+		source->stop();
+		sampler_stats.source = NULL;
+	}
+}
+
+/**
+ * Get sampling profiler statistics
+ *
+ * @v stats		Statistics to fill in
+ */
+void sampler_statistics ( struct sampler_statistics *stats ) {
+
+	memcpy ( stats, &sampler_stats, sizeof ( *stats ) );
+}
+
+/**
+ * Get most frequently sampled offsets
+ *
+ * @v buckets		Buckets to fill in
+ * @v max		Maximum number of buckets to fill in
+ * @ret count		Number of buckets filled in
+ *
+ * Buckets are returned in order of decreasing sample count.  Sampling
+ * should be stopped before calling this function.
+ */
+unsigned int sampler_sort ( struct sampler_bucket *buckets,
+			    unsigned int max ) {
+	struct sampler_bucket *bucket;
+	unsigned int count = 0;
+	unsigned int i;
+	unsigned int j;
+
+	/* Insertion sort into (short) output list */
+	for ( i = 0 ; i < SAMPLER_BUCKETS ; i++ ) {
+		bucket = &sampler_buckets[i];
+		if ( ! bucket->count )
+			continue;
+		for ( j = count ; j > 0 ; j-- ) {
+			if ( buckets[ j - 1 ].count >= bucket->count )
+				break;
+			if ( j < max )
+				buckets[j] = buckets[ j - 1 ];
+		}
+		if ( j < max ) {
+			buckets[j] = *bucket;
+			if ( count < max )
+				count++;
+		}
+	}
+
+	return count;
+}
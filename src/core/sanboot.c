@@ -34,6 +34,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <stdlib.h>
 #include <errno.h>
 #include <assert.h>
+#include <string.h>
 #include <ipxe/xfer.h>
 #include <ipxe/open.h>
 #include <ipxe/timer.h>
@@ -42,7 +43,9 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/dhcp.h>
 #include <ipxe/settings.h>
 #include <ipxe/quiesce.h>
+#include <ipxe/umalloc.h>
 #include <ipxe/sanboot.h>
+#include <config/general.h>
 
 /**
  * Default SAN drive number
@@ -85,12 +88,54 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  */
 #define SAN_REOPEN_DELAY_SECS 5
 
+/**
+ * Smoothed command latency scaling factor (log2)
+ *
+ * Each path's smoothed latency is an exponentially weighted moving
+ * average with a gain of 1/8, stored scaled up by 8 to retain
+ * precision.
+ */
+#define SAN_LATENCY_SCALE 3
+
+/**
+ * Maximum multipath fragment size
+ *
+ * Transfers are split into fragments of at most this size so that
+ * they may be spread across all available paths, even when the
+ * underlying device imposes no limit of its own.
+ */
+#define SAN_MULTIPATH_FRAG_SIZE ( 64 * 1024 )
+
+/**
+ * SAN device cache line size
+ *
+ * Bootloaders tend to issue many small reads, each of which would
+ * otherwise cost at least one network round trip.  Reads smaller
+ * than a cache line are satisfied by reading the whole cache line
+ * from the device.
+ */
+#define SAN_CACHE_LINE_SIZE ( 64 * 1024 )
+
+/** Minimum usable SAN device cache size */
+#define SAN_CACHE_MIN_SIZE ( 4 * SAN_CACHE_LINE_SIZE )
+
+/**
+ * Maximum SAN device read-ahead window (in cache lines)
+ *
+ * The read-ahead window doubles on each sequential cache miss, and
+ * reverts to a single cache line on any non-sequential miss.
+ */
+#define SAN_CACHE_MAX_READAHEAD 8
+
 /** List of SAN devices */
 LIST_HEAD ( san_devices );
 
 /** Number of times to retry commands */
 static unsigned long san_retries = SAN_DEFAULT_RETRIES;
 
+/** Use all available paths concurrently */
+static unsigned long san_multipath;
+
 /**
  * Find SAN device by drive number
  *
@@ -124,6 +169,8 @@ static void sandev_free ( struct refcnt *refcnt ) {
 		uri_put ( sandev->path[i].uri );
 		assert ( sandev->path[i].desc == NULL );
 	}
+	free ( sandev->cache.tags );
+	ufree ( sandev->cache.data );
 	free ( sandev );
 }
 
@@ -182,6 +229,72 @@ static void sandev_command_expired ( struct retry_timer *timer,
 	sandev_command_close ( sandev, -ETIMEDOUT );
 }
 
+/**
+ * Close SAN path multipath command
+ *
+ * @v sanpath		SAN path
+ * @v rc		Reason for close
+ */
+static void sanpath_command_close ( struct san_path *sanpath, int rc ) {
+	struct san_device *sandev = sanpath->sandev;
+	unsigned long elapsed;
+
+	/* Restart interface */
+	intf_restart ( &sanpath->command, rc );
+
+	/* Update smoothed latency */
+	elapsed = ( currticks() - sanpath->started );
+	if ( ! elapsed )
+		elapsed = 1;
+	if ( sanpath->latency ) {
+		sanpath->latency -= ( sanpath->latency >> SAN_LATENCY_SCALE );
+		sanpath->latency += elapsed;
+	} else {
+		sanpath->latency = ( elapsed << SAN_LATENCY_SCALE );
+	}
+
+	/* Record command status */
+	sanpath->command_rc = rc;
+	if ( rc == 0 ) {
+		sanpath->count = 0;
+	} else {
+		DBGC ( sandev, "SAN %#02x.%d failed blocks %#llx+%#x: %s\n",
+		       sandev->drive, sanpath->index,
+		       ( ( unsigned long long ) sanpath->lba ), sanpath->count,
+		       strerror ( rc ) );
+		sanpath->retries++;
+	}
+}
+
+/**
+ * Check if SAN path has a multipath command in progress
+ *
+ * @v sanpath		SAN path
+ * @ret busy		Command is in progress
+ */
+static inline int sanpath_busy ( struct san_path *sanpath ) {
+	return ( sanpath->count && ( sanpath->command_rc == -EINPROGRESS ) );
+}
+
+/**
+ * Check if SAN path holds a failed multipath command
+ *
+ * @v sanpath		SAN path
+ * @ret failed		Command has failed and must be reissued
+ */
+static inline int sanpath_failed ( struct san_path *sanpath ) {
+	return ( sanpath->count && ( sanpath->command_rc != -EINPROGRESS ) );
+}
+
+/** SAN path multipath command interface operations */
+static struct interface_operation sanpath_command_op[] = {
+	INTF_OP ( intf_close, struct san_path *, sanpath_command_close ),
+};
+
+/** SAN path multipath command interface descriptor */
+static struct interface_descriptor sanpath_command_desc =
+	INTF_DESC ( struct san_path, command, sanpath_command_op );
+
 /**
  * Open SAN path
  *
@@ -232,6 +345,7 @@ static int sanpath_open ( struct san_path *sanpath ) {
  */
 static void sanpath_close ( struct san_path *sanpath, int rc ) {
 	struct san_device *sandev = sanpath->sandev;
+	struct san_path *other;
 
 	/* Record status */
 	sanpath->path_rc = rc;
@@ -243,6 +357,10 @@ static void sanpath_close ( struct san_path *sanpath, int rc ) {
 	/* Stop process */
 	process_del ( &sanpath->process );
 
+	/* Abort any multipath command */
+	if ( sanpath_busy ( sanpath ) )
+		sanpath_command_close ( sanpath, ( rc ? rc : -ECONNRESET ) );
+
 	/* Restart interfaces, avoiding potential loops */
 	if ( sanpath == sandev->active ) {
 		intfs_restart ( rc, &sandev->command, &sanpath->block, NULL );
@@ -251,6 +369,18 @@ static void sanpath_close ( struct san_path *sanpath, int rc ) {
 	} else {
 		intf_restart ( &sanpath->block, rc );
 	}
+
+	/* Fail over to any other available path */
+	if ( ! sandev->active ) {
+		list_for_each_entry ( other, &sandev->opened, list ) {
+			if ( other->path_rc != 0 )
+				continue;
+			DBGC ( sandev, "SAN %#02x.%d is active\n",
+			       sandev->drive, other->index );
+			sandev->active = other;
+			break;
+		}
+	}
 }
 
 /**
@@ -305,11 +435,16 @@ static void sanpath_step ( struct san_path *sanpath ) {
 	/* Record status */
 	sanpath->path_rc = 0;
 
-	/* Mark as active path or close as applicable */
+	/* Mark as active path, or leave open for multipath use, or
+	 * close as applicable.
+	 */
 	if ( ! sandev->active ) {
 		DBGC ( sandev, "SAN %#02x.%d is active\n",
 		       sandev->drive, sanpath->index );
 		sandev->active = sanpath;
+	} else if ( san_multipath ) {
+		DBGC ( sandev, "SAN %#02x.%d is available for multipath\n",
+		       sandev->drive, sanpath->index );
 	} else {
 		DBGC ( sandev, "SAN %#02x.%d is available\n",
 		       sandev->drive, sanpath->index );
@@ -575,21 +710,23 @@ int sandev_reset ( struct san_device *sandev ) {
 }
 
 /**
- * Read from or write to SAN device
+ * Read from or write to SAN device via active path
  *
  * @v sandev		SAN device
- * @v lba		Starting logical block address
- * @v count		Number of logical blocks
+ * @v lba		Starting underlying block address
+ * @v count		Number of underlying blocks
  * @v buffer		Data buffer
  * @v block_rw		Block read/write method
  * @ret rc		Return status code
  */
-static int sandev_rw ( struct san_device *sandev, uint64_t lba,
-		       unsigned int count, userptr_t buffer,
-		       int ( * block_rw ) ( struct interface *control,
-					    struct interface *data,
-					    uint64_t lba, unsigned int count,
-					    userptr_t buffer, size_t len ) ) {
+static int sandev_rw_single ( struct san_device *sandev, uint64_t lba,
+			      unsigned int count, userptr_t buffer,
+			      int ( * block_rw ) ( struct interface *control,
+						   struct interface *data,
+						   uint64_t lba,
+						   unsigned int count,
+						   userptr_t buffer,
+						   size_t len ) ) {
 	union san_command_params params;
 	unsigned int remaining;
 	size_t frag_len;
@@ -598,9 +735,9 @@ static int sandev_rw ( struct san_device *sandev, uint64_t lba,
 	/* Initialise command parameters */
 	params.rw.block_rw = block_rw;
 	params.rw.buffer = buffer;
-	params.rw.lba = ( lba << sandev->blksize_shift );
+	params.rw.lba = lba;
 	params.rw.count = sandev->capacity.max_count;
-	remaining = ( count << sandev->blksize_shift );
+	remaining = count;
 
 	/* Read/write fragments */
 	while ( remaining ) {
@@ -624,6 +761,531 @@ static int sandev_rw ( struct san_device *sandev, uint64_t lba,
 	return 0;
 }
 
+/**
+ * Calculate SAN device multipath fragment length
+ *
+ * @v sandev		SAN device
+ * @ret max_count	Maximum number of underlying blocks per fragment
+ */
+static unsigned int sandev_multipath_count ( struct san_device *sandev ) {
+	unsigned int max_count;
+
+	max_count = ( SAN_MULTIPATH_FRAG_SIZE / sandev->capacity.blksize );
+	if ( max_count > sandev->capacity.max_count )
+		max_count = sandev->capacity.max_count;
+	if ( ! max_count )
+		max_count = 1;
+	return max_count;
+}
+
+/**
+ * Check if SAN device should use multipath I/O
+ *
+ * @v sandev		SAN device
+ * @v count		Number of underlying blocks
+ * @ret multipath	Use multipath I/O
+ */
+static int sandev_multipath ( struct san_device *sandev, unsigned int count ) {
+	struct san_path *sanpath;
+	unsigned int available = 0;
+
+	/* Do nothing unless enabled and worthwhile */
+	if ( ! san_multipath )
+		return 0;
+	if ( count <= sandev_multipath_count ( sandev ) )
+		return 0;
+	if ( sandev_needs_reopen ( sandev ) )
+		return 0;
+
+	/* Require at least two available paths */
+	list_for_each_entry ( sanpath, &sandev->opened, list ) {
+		if ( sanpath->path_rc == 0 )
+			available++;
+	}
+	return ( available > 1 );
+}
+
+/**
+ * Find idle SAN path for multipath I/O
+ *
+ * @v sandev		SAN device
+ * @v frags		Number of fragments remaining to be issued
+ * @ret sanpath		SAN path, or NULL
+ *
+ * The fastest idle path is chosen.  A path that is much slower than
+ * the fastest available path is left idle unless there are enough
+ * remaining fragments that issuing one to the slower path will not
+ * delay overall completion.  Paths with no latency measurement yet
+ * are always eligible, so that they will be measured.
+ */
+static struct san_path * sanpath_idle ( struct san_device *sandev,
+					unsigned int frags ) {
+	struct san_path *sanpath;
+	struct san_path *idle = NULL;
+	unsigned long fastest = 0;
+
+	/* Find fastest measured latency of any available path */
+	list_for_each_entry ( sanpath, &sandev->opened, list ) {
+		if ( ( sanpath->path_rc == 0 ) && sanpath->latency &&
+		     ( ( ! fastest ) || ( sanpath->latency < fastest ) ) ) {
+			fastest = sanpath->latency;
+		}
+	}
+
+	/* Find fastest eligible idle path */
+	list_for_each_entry ( sanpath, &sandev->opened, list ) {
+		if ( ( sanpath->path_rc != 0 ) || sanpath->count ||
+		     ( ! xfer_window ( &sanpath->block ) ) )
+			continue;
+		if ( fastest && ( ( sanpath->latency / frags ) > fastest ) )
+			continue;
+		if ( ( ! idle ) || ( sanpath->latency < idle->latency ) )
+			idle = sanpath;
+	}
+
+	return idle;
+}
+
+/**
+ * Find failed SAN path multipath command
+ *
+ * @v sandev		SAN device
+ * @ret sanpath		SAN path holding failed command, or NULL
+ */
+static struct san_path * sandev_failed ( struct san_device *sandev ) {
+	struct san_path *sanpath;
+	unsigned int i;
+
+	for ( i = 0 ; i < sandev->paths ; i++ ) {
+		sanpath = &sandev->path[i];
+		if ( sanpath_failed ( sanpath ) )
+			return sanpath;
+	}
+	return NULL;
+}
+
+/**
+ * Cancel all SAN path multipath commands
+ *
+ * @v sandev		SAN device
+ * @v rc		Reason for cancellation
+ */
+static void sandev_cancel ( struct san_device *sandev, int rc ) {
+	struct san_path *sanpath;
+	unsigned int i;
+
+	for ( i = 0 ; i < sandev->paths ; i++ ) {
+		sanpath = &sandev->path[i];
+		if ( sanpath_busy ( sanpath ) )
+			sanpath_command_close ( sanpath, rc );
+		sanpath->count = 0;
+	}
+}
+
+/**
+ * Read from or write to SAN device via all available paths
+ *
+ * @v sandev		SAN device
+ * @v lba		Starting underlying block address
+ * @v count		Number of underlying blocks
+ * @v buffer		Data buffer
+ * @v block_rw		Block read/write method
+ * @ret rc		Return status code
+ *
+ * Fragments are issued concurrently, one per idle path.  Faster
+ * paths become idle sooner and so naturally carry a greater share of
+ * the load.  A failed fragment is reissued on whichever path next
+ * becomes idle.  If no paths remain usable, any outstanding
+ * fragments are completed via the active path (reopening the device
+ * if necessary).
+ */
+static int sandev_rw_multipath ( struct san_device *sandev, uint64_t lba,
+				 unsigned int count, userptr_t buffer,
+				 int ( * block_rw ) ( struct interface *control,
+						      struct interface *data,
+						      uint64_t lba,
+						      unsigned int count,
+						      userptr_t buffer,
+						      size_t len ) ) {
+	unsigned int max_count = sandev_multipath_count ( sandev );
+	struct san_path *sanpath;
+	struct san_path *failed;
+	unsigned int busy;
+	unsigned int frags;
+	unsigned int frag_count;
+	unsigned int i;
+	size_t len;
+	int rc;
+
+	/* Unquiesce system */
+	unquiesce();
+
+	while ( 1 ) {
+
+		/* Issue failed and new fragments to idle paths */
+		while ( 1 ) {
+
+			/* Abort if a fragment has exhausted its retries */
+			failed = sandev_failed ( sandev );
+			if ( failed && ( failed->retries > san_retries ) ) {
+				rc = failed->command_rc;
+				goto err;
+			}
+
+			/* Find an idle path, if any work remains */
+			frags = ( ( count + max_count - 1 ) / max_count );
+			if ( failed )
+				frags++;
+			if ( ! frags )
+				break;
+			sanpath = sanpath_idle ( sandev, frags );
+			if ( ! sanpath )
+				break;
+
+			/* Assign fragment to idle path */
+			if ( failed ) {
+				sanpath->lba = failed->lba;
+				sanpath->buffer = failed->buffer;
+				sanpath->retries = failed->retries;
+				sanpath->count = failed->count;
+				failed->count = 0;
+			} else {
+				sanpath->lba = lba;
+				sanpath->buffer = buffer;
+				sanpath->retries = 0;
+				sanpath->count = count;
+				if ( sanpath->count > max_count )
+					sanpath->count = max_count;
+				len = ( sanpath->count *
+					sandev->capacity.blksize );
+				buffer = userptr_add ( buffer, len );
+				lba += sanpath->count;
+				count -= sanpath->count;
+			}
+
+			/* Initiate command */
+			sanpath->started = currticks();
+			sanpath->command_rc = -EINPROGRESS;
+			len = ( sanpath->count * sandev->capacity.blksize );
+			if ( ( rc = block_rw ( &sanpath->block,
+					       &sanpath->command, sanpath->lba,
+					       sanpath->count, sanpath->buffer,
+					       len ) ) != 0 ) {
+				DBGC ( sandev, "SAN %#02x.%d could not initiate "
+				       "read/write: %s\n", sandev->drive,
+				       sanpath->index, strerror ( rc ) );
+				intf_restart ( &sanpath->command, rc );
+				sanpath->command_rc = rc;
+				sanpath->retries++;
+			}
+		}
+
+		/* Time out any stalled commands */
+		busy = 0;
+		for ( i = 0 ; i < sandev->paths ; i++ ) {
+			sanpath = &sandev->path[i];
+			if ( ! sanpath_busy ( sanpath ) )
+				continue;
+			if ( ( currticks() - sanpath->started ) >=
+			     SAN_COMMAND_TIMEOUT ) {
+				sanpath_command_close ( sanpath, -ETIMEDOUT );
+				continue;
+			}
+			busy++;
+		}
+
+		/* Stop when nothing is in progress and no path can make
+		 * further progress.
+		 */
+		if ( ! busy ) {
+			if ( ( count || sandev_failed ( sandev ) ) &&
+			     sanpath_idle ( sandev, 1 ) )
+				continue;
+			break;
+		}
+
+		/* Wait for progress */
+		step();
+	}
+
+	/* Complete any remaining fragments via the active path */
+	while ( ( failed = sandev_failed ( sandev ) ) ) {
+		frag_count = failed->count;
+		failed->count = 0;
+		if ( ( rc = sandev_rw_single ( sandev, failed->lba, frag_count,
+					       failed->buffer,
+					       block_rw ) ) != 0 )
+			goto err;
+	}
+	if ( count &&
+	     ( ( rc = sandev_rw_single ( sandev, lba, count, buffer,
+					 block_rw ) ) != 0 ) )
+		goto err;
+
+	return 0;
+
+ err:
+	sandev_cancel ( sandev, -ECANCELED );
+	return rc;
+}
+
+/**
+ * Read from or write to SAN device
+ *
+ * @v sandev		SAN device
+ * @v lba		Starting underlying block address
+ * @v count		Number of underlying blocks
+ * @v buffer		Data buffer
+ * @v block_rw		Block read/write method
+ * @ret rc		Return status code
+ */
+static int sandev_rw ( struct san_device *sandev, uint64_t lba,
+		       unsigned int count, userptr_t buffer,
+		       int ( * block_rw ) ( struct interface *control,
+					    struct interface *data,
+					    uint64_t lba, unsigned int count,
+					    userptr_t buffer, size_t len ) ) {
+
+	/* Use all available paths, if applicable */
+	if ( sandev_multipath ( sandev, count ) ) {
+		return sandev_rw_multipath ( sandev, lba, count, buffer,
+					     block_rw );
+	}
+
+	return sandev_rw_single ( sandev, lba, count, buffer, block_rw );
+}
+
+/**
+ * Find SAN device cache line
+ *
+ * @v cache		Block cache
+ * @v tag		Cache line tag
+ * @ret index		Cache line index, or negative error
+ */
+static int sandev_cache_find ( struct san_cache *cache, uint64_t tag ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < cache->lines ; i++ ) {
+		if ( cache->tags[i] == tag )
+			return i;
+	}
+	return -ENOENT;
+}
+
+/**
+ * Fill SAN device cache line
+ *
+ * @v sandev		SAN device
+ * @v tag		Cache line tag
+ * @ret index		Cache line index, or negative error
+ *
+ * Sequential cache misses will also read ahead into the following
+ * cache lines.
+ */
+static int sandev_cache_fill ( struct san_device *sandev, uint64_t tag ) {
+	struct san_cache *cache = &sandev->cache;
+	uint64_t blocks = sandev->capacity.blocks;
+	uint64_t next;
+	unsigned int max_lines;
+	unsigned int lines;
+	unsigned int count;
+	unsigned int index;
+	unsigned int i;
+	userptr_t buffer;
+	int rc;
+
+	/* Update read-ahead window */
+	max_lines = ( cache->lines / 2 );
+	if ( max_lines > SAN_CACHE_MAX_READAHEAD )
+		max_lines = SAN_CACHE_MAX_READAHEAD;
+	if ( tag != cache->expected ) {
+		cache->window = 1;
+	} else if ( cache->window < max_lines ) {
+		cache->window <<= 1;
+	}
+
+	/* Limit read-ahead to the end of the device, and stop at any
+	 * cache line that is already present.
+	 */
+	for ( lines = 1 ; lines < cache->window ; lines++ ) {
+		next = ( tag + ( lines * cache->count ) );
+		if ( ( next >= blocks ) ||
+		     ( sandev_cache_find ( cache, next ) >= 0 ) )
+			break;
+	}
+
+	/* Replace consecutive cache lines, wrapping to the start of
+	 * the cache if necessary.
+	 */
+	if ( ( cache->next + lines ) > cache->lines )
+		cache->next = 0;
+	index = cache->next;
+	for ( i = 0 ; i < lines ; i++ )
+		cache->tags[ index + i ] = SAN_CACHE_INVALID;
+
+	/* Read cache lines from device */
+	count = ( lines * cache->count );
+	if ( count > ( blocks - tag ) )
+		count = ( blocks - tag );
+	buffer = userptr_add ( cache->data, ( index * cache->len ) );
+	if ( ( rc = sandev_rw ( sandev, tag, count, buffer,
+				block_read ) ) != 0 ) {
+		cache->expected = SAN_CACHE_INVALID;
+		return rc;
+	}
+
+	/* Record cache lines */
+	for ( i = 0 ; i < lines ; i++ )
+		cache->tags[ index + i ] = ( tag + ( i * cache->count ) );
+	cache->next = ( index + lines );
+	cache->expected = ( tag + count );
+	cache->misses++;
+	DBGC2 ( sandev, "SAN %#02x cached [%#08llx,%#08llx) in line %d\n",
+		sandev->drive, ( ( unsigned long long ) tag ),
+		( ( unsigned long long ) ( tag + count ) ), index );
+
+	return index;
+}
+
+/**
+ * Read from SAN device via block cache
+ *
+ * @v sandev		SAN device
+ * @v lba		Starting underlying block address
+ * @v count		Number of underlying blocks
+ * @v buffer		Data buffer
+ * @ret rc		Return status code
+ */
+static int sandev_cache_read ( struct san_device *sandev, uint64_t lba,
+			       unsigned int count, userptr_t buffer ) {
+	struct san_cache *cache = &sandev->cache;
+	size_t blksize = sandev->capacity.blksize;
+	uint64_t tag;
+	unsigned int offset;
+	unsigned int frag;
+	int index;
+
+	/* Read directly from device if there is no cache, if the read
+	 * is large enough to amortise the round trip time, or if the
+	 * read extends beyond the end of the device.
+	 */
+	if ( ( ! cache->lines ) || ( count >= cache->count ) ||
+	     ( lba > sandev->capacity.blocks ) ||
+	     ( count > ( sandev->capacity.blocks - lba ) ) ) {
+		return sandev_rw ( sandev, lba, count, buffer, block_read );
+	}
+
+	/* Read each cache line in turn */
+	while ( count ) {
+
+		/* Locate cache line, filling if necessary */
+		tag = ( lba & ~( ( uint64_t ) ( cache->count - 1 ) ) );
+		index = sandev_cache_find ( cache, tag );
+		if ( index >= 0 ) {
+			cache->hits++;
+		} else {
+			index = sandev_cache_fill ( sandev, tag );
+			if ( index < 0 )
+				return index;
+		}
+
+		/* Copy out data */
+		offset = ( lba - tag );
+		frag = ( cache->count - offset );
+		if ( frag > count )
+			frag = count;
+		memcpy_user ( buffer, 0, cache->data,
+			      ( ( index * cache->len ) + ( offset * blksize ) ),
+			      ( frag * blksize ) );
+
+		/* Move to next cache line */
+		buffer = userptr_add ( buffer, ( frag * blksize ) );
+		lba += frag;
+		count -= frag;
+	}
+
+	return 0;
+}
+
+/**
+ * Invalidate SAN device cache lines
+ *
+ * @v sandev		SAN device
+ * @v lba		Starting underlying block address
+ * @v count		Number of underlying blocks
+ */
+static void sandev_cache_invalidate ( struct san_device *sandev,
+				      uint64_t lba, unsigned int count ) {
+	struct san_cache *cache = &sandev->cache;
+	uint64_t tag;
+	unsigned int i;
+
+	for ( i = 0 ; i < cache->lines ; i++ ) {
+		tag = cache->tags[i];
+		if ( ( tag != SAN_CACHE_INVALID ) &&
+		     ( tag < ( lba + count ) ) &&
+		     ( ( tag + cache->count ) > lba ) ) {
+			cache->tags[i] = SAN_CACHE_INVALID;
+		}
+	}
+}
+
+/**
+ * Allocate SAN device block cache
+ *
+ * @v sandev		SAN device
+ *
+ * The cache is an optimisation, and failure to allocate it is not an
+ * error.
+ */
+static void sandev_cache_alloc ( struct san_device *sandev ) {
+	struct san_cache *cache = &sandev->cache;
+	size_t blksize = sandev->capacity.blksize;
+	size_t size;
+	unsigned int i;
+
+	/* Sanity check */
+	assert ( cache->data == UNULL );
+
+	/* Check that block size is usable */
+	if ( ( blksize == 0 ) || ( blksize & ( blksize - 1 ) ) ||
+	     ( blksize > SAN_CACHE_LINE_SIZE ) ) {
+		DBGC ( sandev, "SAN %#02x cannot cache block size %zd\n",
+		       sandev->drive, blksize );
+		return;
+	}
+
+	/* Allocate the largest cache that memory permits */
+	for ( size = SAN_CACHE_MAX_SIZE ; size >= SAN_CACHE_MIN_SIZE ;
+	      size >>= 1 ) {
+		cache->data = umalloc ( size );
+		if ( cache->data )
+			break;
+	}
+	if ( ! cache->data ) {
+		DBGC ( sandev, "SAN %#02x has no block cache\n",
+		       sandev->drive );
+		return;
+	}
+	cache->lines = ( size / SAN_CACHE_LINE_SIZE );
+	cache->tags = malloc ( cache->lines * sizeof ( cache->tags[0] ) );
+	if ( ! cache->tags ) {
+		ufree ( cache->data );
+		cache->data = UNULL;
+		cache->lines = 0;
+		return;
+	}
+
+	/* Initialise cache */
+	for ( i = 0 ; i < cache->lines ; i++ )
+		cache->tags[i] = SAN_CACHE_INVALID;
+	cache->count = ( SAN_CACHE_LINE_SIZE / blksize );
+	cache->len = SAN_CACHE_LINE_SIZE;
+	cache->expected = SAN_CACHE_INVALID;
+	DBGC ( sandev, "SAN %#02x using %zdkB block cache\n",
+	       sandev->drive, ( size / 1024 ) );
+}
+
 /**
  * Read from SAN device
  *
@@ -637,8 +1299,12 @@ int sandev_read ( struct san_device *sandev, uint64_t lba,
 		  unsigned int count, userptr_t buffer ) {
 	int rc;
 
-	/* Read from device */
-	if ( ( rc = sandev_rw ( sandev, lba, count, buffer, block_read ) ) != 0 )
+	/* Convert to underlying blocks */
+	lba <<= sandev->blksize_shift;
+	count <<= sandev->blksize_shift;
+
+	/* Read from cache or device */
+	if ( ( rc = sandev_cache_read ( sandev, lba, count, buffer ) ) != 0 )
 		return rc;
 
 	return 0;
@@ -657,6 +1323,13 @@ int sandev_write ( struct san_device *sandev, uint64_t lba,
 		   unsigned int count, userptr_t buffer ) {
 	int rc;
 
+	/* Convert to underlying blocks */
+	lba <<= sandev->blksize_shift;
+	count <<= sandev->blksize_shift;
+
+	/* Invalidate any cached copies */
+	sandev_cache_invalidate ( sandev, lba, count );
+
 	/* Write to device */
 	if ( ( rc = sandev_rw ( sandev, lba, count, buffer, block_write ) ) != 0 )
 		return rc;
@@ -849,6 +1522,8 @@ struct san_device * alloc_sandev ( struct uri **uris, unsigned int count,
 		list_add_tail ( &sanpath->list, &sandev->closed );
 		intf_init ( &sanpath->block, &sanpath_block_desc,
 			    &sandev->refcnt );
+		intf_init ( &sanpath->command, &sanpath_command_desc,
+			    &sandev->refcnt );
 		process_init_stopped ( &sanpath->process, &sanpath_process_desc,
 				       &sandev->refcnt );
 		sanpath->path_rc = -EINPROGRESS;
@@ -896,6 +1571,9 @@ int register_sandev ( struct san_device *sandev, unsigned int drive,
 				     NULL ) ) != 0 )
 		goto err_capacity;
 
+	/* Allocate block cache */
+	sandev_cache_alloc ( sandev );
+
 	/* Configure as a CD-ROM, if applicable */
 	if ( ( rc = sandev_parse_iso9660 ( sandev ) ) != 0 )
 		goto err_iso9660;
@@ -936,7 +1614,8 @@ void unregister_sandev ( struct san_device *sandev ) {
 	/* Remove ACPI descriptors */
 	sandev_undescribe ( sandev );
 
-	DBGC ( sandev, "SAN %#02x unregistered\n", sandev->drive );
+	DBGC ( sandev, "SAN %#02x unregistered (cache %ld hits, %ld misses)\n",
+	       sandev->drive, sandev->cache.hits, sandev->cache.misses );
 }
 
 /** The "san-drive" setting */
@@ -973,6 +1652,14 @@ const struct setting san_retries_setting __setting ( SETTING_SANBOOT_EXTRA,
 	.type = &setting_type_int8,
 };
 
+/** The "san-multipath" setting */
+const struct setting san_multipath_setting __setting ( SETTING_SANBOOT_EXTRA,
+						       san-multipath ) = {
+	.name = "san-multipath",
+	.description = "Use all SAN paths concurrently",
+	.type = &setting_type_uint8,
+};
+
 /**
  * Apply SAN boot settings
  *
@@ -986,6 +1673,12 @@ static int sandev_apply ( void ) {
 		san_retries = SAN_DEFAULT_RETRIES;
 	}
 
+	/* Apply "san-multipath" setting */
+	if ( fetch_uint_setting ( NULL, &san_multipath_setting,
+				  &san_multipath ) < 0 ) {
+		san_multipath = 0;
+	}
+
 	return 0;
 }
 
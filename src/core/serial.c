@@ -32,6 +32,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <stddef.h>
 #include <string.h>
 #include <ipxe/init.h>
+#include <ipxe/process.h>
 #include <ipxe/uart.h>
 #include <ipxe/console.h>
 #include <ipxe/serial.h>
@@ -65,22 +66,98 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #define CONSOLE_LCR UART_LCR_WPS ( COMDATA, COMPARITY, COMSTOP )
 #endif
 
+/** Serial console transmit buffer length (must be a power of two) */
+#define SERIAL_TX_LEN 4096
+
 /** Serial console UART */
 struct uart serial_console;
 
+/** Serial console transmit buffer */
+static uint8_t serial_tx[SERIAL_TX_LEN];
+
+/** Serial console transmit buffer producer counter */
+static unsigned int serial_tx_prod;
+
+/** Serial console transmit buffer consumer counter */
+static unsigned int serial_tx_cons;
+
+/** Transmit buffered characters without waiting */
+static void serial_drain ( void ) {
+	unsigned int index;
+	size_t len;
+
+	/* Transmit as much as the UART will currently accept */
+	while ( serial_tx_cons != serial_tx_prod ) {
+		index = ( serial_tx_cons & ( SERIAL_TX_LEN - 1 ) );
+		len = ( serial_tx_prod - serial_tx_cons );
+		if ( len > ( SERIAL_TX_LEN - index ) )
+			len = ( SERIAL_TX_LEN - index );
+		len = uart_send ( &serial_console, &serial_tx[index], len );
+		if ( ! len )
+			break;
+		serial_tx_cons += len;
+	}
+}
+
+/**
+ * Transmit all buffered characters
+ *
+ * This must be called before handing control to any external code
+ * (e.g. an executable image), since the transmit buffer is otherwise
+ * drained only from within iPXE's main processing loop.
+ */
+void serial_flush ( void ) {
+	unsigned int index;
+
+	/* Do nothing if we have no UART */
+	if ( ! serial_console.base )
+		return;
+
+	/* Transmit remaining characters, waiting as necessary */
+	while ( serial_tx_cons != serial_tx_prod ) {
+		index = ( serial_tx_cons++ & ( SERIAL_TX_LEN - 1 ) );
+		uart_transmit ( &serial_console, serial_tx[index] );
+	}
+}
+
 /**
  * Print a character to serial console
  *
  * @v character		Character to be printed
+ *
+ * Characters are added to a transmit buffer, which is drained into
+ * the UART's transmit FIFO whenever space is available.  We wait
+ * for the UART only if the transmit buffer is full.
+ *
+ * Debug output is transmitted immediately, since it is most valuable
+ * precisely when the main processing loop is not running (e.g. when
+ * the system has hung or is busy-waiting).
  */
 static void serial_putchar ( int character ) {
+	unsigned int index;
 
 	/* Do nothing if we have no UART */
 	if ( ! serial_console.base )
 		return;
 
-	/* Transmit character */
-	uart_transmit ( &serial_console, character );
+	/* Make space in transmit buffer, if necessary */
+	if ( ( serial_tx_prod - serial_tx_cons ) >= SERIAL_TX_LEN ) {
+		index = ( serial_tx_cons++ & ( SERIAL_TX_LEN - 1 ) );
+		uart_transmit ( &serial_console, serial_tx[index] );
+	}
+
+	/* Add character to transmit buffer */
+	index = ( serial_tx_prod++ & ( SERIAL_TX_LEN - 1 ) );
+	serial_tx[index] = character;
+
+	/* Transmit debug output immediately, and otherwise transmit
+	 * whatever the UART will currently accept.
+	 */
+	if ( console_usage & CONSOLE_USAGE_DEBUG ) {
+		serial_flush();
+	} else {
+		serial_drain();
+	}
 }
 
 /**
@@ -169,11 +246,30 @@ static void serial_shutdown ( int flags __unused ) {
 		return;
 
 	/* Flush any pending output */
+	serial_flush();
 	uart_flush ( &serial_console );
 
 	/* Leave console enabled; it's still usable */
 }
 
+/**
+ * Drain serial console transmit buffer
+ *
+ * @v process		Process
+ */
+static void serial_step ( struct process *process __unused ) {
+
+	/* Do nothing if we have no UART */
+	if ( ! serial_console.base )
+		return;
+
+	/* Transmit whatever the UART will currently accept */
+	serial_drain();
+}
+
+/** Serial console transmit process */
+PERMANENT_PROCESS ( serial_process, serial_step );
+
 /** Serial console initialisation function */
 struct init_fn serial_console_init_fn __init_fn ( INIT_CONSOLE ) = {
 	.initialise = serial_init,
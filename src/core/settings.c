@@ -66,6 +66,10 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 struct generic_setting {
 	/** List of generic settings */
 	struct list_head list;
+	/** Next generic setting in name hash bucket */
+	struct generic_setting *next_name;
+	/** Next generic setting in tag hash bucket */
+	struct generic_setting *next_tag;
 	/** Setting */
 	struct setting setting;
 	/** Size of setting name */
@@ -95,23 +99,171 @@ static inline void * generic_setting_data ( struct generic_setting *generic ) {
 		 generic->name_len );
 }
 
+/**
+ * Calculate setting name hash
+ *
+ * @v name		Setting name
+ * @ret hash		Hash value
+ */
+static unsigned int setting_name_hash ( const char *name ) {
+	unsigned int hash = 0;
+
+	while ( *name )
+		hash = ( ( hash * 33 ) ^ *(name++) );
+	return hash;
+}
+
+/**
+ * Calculate setting tag hash
+ *
+ * @v tag		Setting tag
+ * @ret hash		Hash value
+ */
+static unsigned int setting_tag_hash ( uint64_t tag ) {
+
+	/* Fold encapsulated option numbers together */
+	return ( tag ^ ( tag >> 8 ) ^ ( tag >> 24 ) ^ ( tag >> 40 ) );
+}
+
+/**
+ * Check if setting can match by name
+ *
+ * @v setting		Setting
+ * @ret has_name	Setting has a non-empty name
+ */
+static inline int setting_has_name ( const struct setting *setting ) {
+	return ( setting->name && setting->name[0] );
+}
+
+/**
+ * Get generic setting name hash bucket
+ *
+ * @v generics		Generic settings block
+ * @v name		Setting name
+ * @ret bucket		Hash bucket
+ */
+static inline struct generic_setting **
+generic_name_bucket ( struct generic_settings *generics, const char *name ) {
+	unsigned int hash = setting_name_hash ( name );
+
+	return &generics->names[ hash & ( GENERIC_SETTINGS_BUCKETS - 1 ) ];
+}
+
+/**
+ * Get generic setting tag hash bucket
+ *
+ * @v generics		Generic settings block
+ * @v tag		Setting tag
+ * @ret bucket		Hash bucket
+ */
+static inline struct generic_setting **
+generic_tag_bucket ( struct generic_settings *generics, uint64_t tag ) {
+	unsigned int hash = setting_tag_hash ( tag );
+
+	return &generics->tags[ hash & ( GENERIC_SETTINGS_BUCKETS - 1 ) ];
+}
+
 /**
  * Find generic setting
  *
  * @v generics		Generic settings block
  * @v setting		Setting to find
  * @ret generic		Generic setting, or NULL
+ *
+ * A generic setting may match either by tag or by name.  If distinct
+ * generic settings match in each way, the most recently stored
+ * setting (i.e. the first in the list) is returned.
  */
 static struct generic_setting *
 find_generic_setting ( struct generic_settings *generics,
 		       const struct setting *setting ) {
+	struct generic_setting *by_name = NULL;
+	struct generic_setting *by_tag = NULL;
 	struct generic_setting *generic;
 
-	list_for_each_entry ( generic, &generics->list, list ) {
-		if ( setting_cmp ( &generic->setting, setting ) == 0 )
-			return generic;
+	/* Find first setting matching by tag, if applicable */
+	if ( setting->tag ) {
+		for ( generic = *generic_tag_bucket ( generics, setting->tag ) ;
+		      generic ; generic = generic->next_tag ) {
+			if ( ( generic->setting.tag == setting->tag ) &&
+			     ( generic->setting.scope == setting->scope ) ) {
+				by_tag = generic;
+				break;
+			}
+		}
+	}
+
+	/* Find first setting matching by name, if applicable */
+	if ( setting->name ) {
+		for ( generic = *generic_name_bucket ( generics,
+						       setting->name ) ;
+		      generic ; generic = generic->next_name ) {
+			if ( strcmp ( generic->setting.name,
+				      setting->name ) == 0 ) {
+				by_name = generic;
+				break;
+			}
+		}
+	}
+
+	/* Resolve ambiguity (which should never happen in practice)
+	 * by returning whichever setting appears first in the list.
+	 */
+	if ( by_tag && by_name && ( by_tag != by_name ) ) {
+		list_for_each_entry ( generic, &generics->list, list ) {
+			if ( ( generic == by_tag ) || ( generic == by_name ) )
+				return generic;
+		}
+	}
+
+	return ( by_tag ? by_tag : by_name );
+}
+
+/**
+ * Add generic setting to hash buckets
+ *
+ * @v generics		Generic settings block
+ * @v generic		Generic setting
+ */
+static void generic_settings_hash ( struct generic_settings *generics,
+				    struct generic_setting *generic ) {
+	struct generic_setting **bucket;
+
+	if ( generic->setting.tag ) {
+		bucket = generic_tag_bucket ( generics, generic->setting.tag );
+		generic->next_tag = *bucket;
+		*bucket = generic;
+	}
+	if ( setting_has_name ( &generic->setting ) ) {
+		bucket = generic_name_bucket ( generics,
+					       generic->setting.name );
+		generic->next_name = *bucket;
+		*bucket = generic;
+	}
+}
+
+/**
+ * Remove generic setting from hash buckets
+ *
+ * @v generics		Generic settings block
+ * @v generic		Generic setting
+ */
+static void generic_settings_unhash ( struct generic_settings *generics,
+				      struct generic_setting *generic ) {
+	struct generic_setting **prev;
+
+	if ( generic->setting.tag ) {
+		prev = generic_tag_bucket ( generics, generic->setting.tag );
+		while ( *prev != generic )
+			prev = &(*prev)->next_tag;
+		*prev = generic->next_tag;
+	}
+	if ( setting_has_name ( &generic->setting ) ) {
+		prev = generic_name_bucket ( generics, generic->setting.name );
+		while ( *prev != generic )
+			prev = &(*prev)->next_name;
+		*prev = generic->next_name;
 	}
-	return NULL;
 }
 
 /**
@@ -155,13 +307,16 @@ int generic_settings_store ( struct settings *settings,
 
 	/* Delete existing generic setting, if any */
 	if ( old ) {
+		generic_settings_unhash ( generics, old );
 		list_del ( &old->list );
 		free ( old );
 	}
 
 	/* Add new setting to list, if any */
-	if ( new )
+	if ( new ) {
 		list_add ( &new->list, &generics->list );
+		generic_settings_hash ( generics, new );
+	}
 
 	return 0;
 }
@@ -215,6 +370,8 @@ void generic_settings_clear ( struct settings *settings ) {
 		free ( generic );
 	}
 	assert ( list_empty ( &generics->list ) );
+	memset ( generics->names, 0, sizeof ( generics->names ) );
+	memset ( generics->tags, 0, sizeof ( generics->tags ) );
 }
 
 /** Generic settings operations */
@@ -576,6 +733,205 @@ int setting_applies ( struct settings *settings,
 		 settings->op->applies ( settings, setting ) : 1 );
 }
 
+/** Number of predefined setting index hash buckets
+ *
+ * Must be a power of two.
+ */
+#define SETTING_INDEX_BUCKETS 64
+
+/**
+ * Predefined setting index
+ *
+ * Each hash chain holds indices (plus one, so that zero terminates
+ * the chain) into the predefined settings table, in table order.
+ */
+static struct {
+	/** First predefined setting in each name hash bucket */
+	uint16_t names[SETTING_INDEX_BUCKETS];
+	/** First predefined setting in each tag hash bucket */
+	uint16_t tags[SETTING_INDEX_BUCKETS];
+	/** Next predefined setting in name hash chain */
+	uint16_t *next_name;
+	/** Next predefined setting in tag hash chain */
+	uint16_t *next_tag;
+	/** Predefined settings table */
+	struct setting *predefined;
+} setting_index;
+
+/**
+ * Get predefined setting by index
+ *
+ * @v i			Predefined setting index
+ * @ret predefined	Predefined setting
+ */
+static inline struct setting * setting_index_entry ( unsigned int i ) {
+	return ( setting_index.predefined + i );
+}
+
+/**
+ * Construct predefined setting index
+ *
+ * @ret rc		Return status code
+ */
+static int setting_index_init ( void ) {
+	unsigned int count = table_num_entries ( SETTINGS );
+	struct setting *predefined;
+	unsigned int bucket;
+	unsigned int i;
+
+	/* Do nothing if index is already constructed */
+	if ( setting_index.next_name )
+		return 0;
+
+	/* Allocate hash chains */
+	setting_index.next_name =
+		malloc ( 2 * count * sizeof ( setting_index.next_name[0] ) );
+	if ( ! setting_index.next_name )
+		return -ENOMEM;
+	setting_index.next_tag = ( setting_index.next_name + count );
+	setting_index.predefined = table_start ( SETTINGS );
+
+	/* Populate hash chains in reverse order, so that each chain
+	 * ends up in table order.
+	 */
+	for_each_table_entry_reverse ( predefined, SETTINGS ) {
+		i = table_index ( SETTINGS, predefined );
+		if ( setting_has_name ( predefined ) ) {
+			bucket = ( setting_name_hash ( predefined->name ) &
+				   ( SETTING_INDEX_BUCKETS - 1 ) );
+			setting_index.next_name[i] =
+				setting_index.names[bucket];
+			setting_index.names[bucket] = ( i + 1 );
+		}
+		if ( predefined->tag ) {
+			bucket = ( setting_tag_hash ( predefined->tag ) &
+				   ( SETTING_INDEX_BUCKETS - 1 ) );
+			setting_index.next_tag[i] = setting_index.tags[bucket];
+			setting_index.tags[bucket] = ( i + 1 );
+		}
+	}
+	DBG ( "Settings indexed %d predefined settings\n", count );
+
+	return 0;
+}
+
+/**
+ * Find next predefined setting matching by tag
+ *
+ * @v setting		Setting to match
+ * @v i			Starting point in tag hash chain (plus one)
+ * @ret i		Matching predefined setting index (plus one), or zero
+ */
+static unsigned int setting_index_tag ( const struct setting *setting,
+					unsigned int i ) {
+	struct setting *predefined;
+
+	for ( ; i ; i = setting_index.next_tag[ i - 1 ] ) {
+		predefined = setting_index_entry ( i - 1 );
+		if ( ( predefined->tag == setting->tag ) &&
+		     ( predefined->scope == setting->scope ) )
+			break;
+	}
+	return i;
+}
+
+/**
+ * Find next predefined setting matching by name
+ *
+ * @v setting		Setting to match
+ * @v i			Starting point in name hash chain (plus one)
+ * @ret i		Matching predefined setting index (plus one), or zero
+ */
+static unsigned int setting_index_name ( const struct setting *setting,
+					 unsigned int i ) {
+	struct setting *predefined;
+
+	for ( ; i ; i = setting_index.next_name[ i - 1 ] ) {
+		predefined = setting_index_entry ( i - 1 );
+		if ( strcmp ( predefined->name, setting->name ) == 0 )
+			break;
+	}
+	return i;
+}
+
+/**
+ * Find predefined setting matching a setting
+ *
+ * @v settings		Settings block to which setting must apply, or NULL
+ * @v setting		Setting to match
+ * @ret predefined	Predefined setting, or NULL
+ *
+ * Returns the first predefined setting (in table order) for which
+ * setting_cmp() reports a match and which, if a settings block is
+ * specified, applies to that settings block.
+ */
+static struct setting *
+find_predefined_setting ( struct settings *settings,
+			  const struct setting *setting ) {
+	struct setting *predefined;
+	unsigned int by_name;
+	unsigned int by_tag;
+	unsigned int bucket;
+	unsigned int i;
+
+	/* Fall back to a linear search if index is unavailable */
+	if ( setting_index_init() != 0 ) {
+		for_each_table_entry ( predefined, SETTINGS ) {
+			if ( ( setting_cmp ( predefined, setting ) == 0 ) &&
+			     ( ( ! settings ) ||
+			       setting_applies ( settings, predefined ) ) )
+				return predefined;
+		}
+		return NULL;
+	}
+
+	/* Find first predefined settings matching by tag and by name */
+	by_tag = 0;
+	if ( setting->tag ) {
+		bucket = ( setting_tag_hash ( setting->tag ) &
+			   ( SETTING_INDEX_BUCKETS - 1 ) );
+		by_tag = setting_index_tag ( setting,
+					     setting_index.tags[bucket] );
+	}
+	by_name = 0;
+	if ( setting->name ) {
+		bucket = ( setting_name_hash ( setting->name ) &
+			   ( SETTING_INDEX_BUCKETS - 1 ) );
+		by_name = setting_index_name ( setting,
+					       setting_index.names[bucket] );
+	}
+
+	/* Merge matches in table order */
+	while ( by_tag || by_name ) {
+
+		/* Identify earliest remaining match */
+		if ( by_tag && ( ( ! by_name ) || ( by_tag <= by_name ) ) ) {
+			i = by_tag;
+		} else {
+			i = by_name;
+		}
+		predefined = setting_index_entry ( i - 1 );
+
+		/* Use this setting if it applies */
+		if ( ( ! settings ) ||
+		     setting_applies ( settings, predefined ) ) {
+			return predefined;
+		}
+
+		/* Move on to next matches */
+		if ( by_tag == i ) {
+			by_tag = setting_index_tag ( setting,
+					setting_index.next_tag[ i - 1 ] );
+		}
+		if ( by_name == i ) {
+			by_name = setting_index_name ( setting,
+					setting_index.next_name[ i - 1 ] );
+		}
+	}
+
+	return NULL;
+}
+
 /**
  * Find setting applicable to settings block, if any
  *
@@ -585,20 +941,13 @@ int setting_applies ( struct settings *settings,
  */
 static const struct setting *
 applicable_setting ( struct settings *settings, const struct setting *setting ){
-	const struct setting *applicable;
 
 	/* If setting is already applicable, use it */
 	if ( setting_applies ( settings, setting ) )
 		return setting;
 
 	/* Otherwise, look for a matching predefined setting which does apply */
-	for_each_table_entry ( applicable, SETTINGS ) {
-		if ( ( setting_cmp ( setting, applicable ) == 0 ) &&
-		     ( setting_applies ( settings, applicable ) ) )
-			return applicable;
-	}
-
-	return NULL;
+	return find_predefined_setting ( settings, setting );
 }
 
 /**
@@ -1463,13 +1812,11 @@ int storen_setting ( struct settings *settings, const struct setting *setting,
  * @ret setting		Setting, or NULL
  */
 struct setting * find_setting ( const char *name ) {
-	struct setting *setting;
+	struct setting setting = {
+		.name = name,
+	};
 
-	for_each_table_entry ( setting, SETTINGS ) {
-		if ( strcmp ( name, setting->name ) == 0 )
-			return setting;
-	}
-	return NULL;
+	return find_predefined_setting ( NULL, &setting );
 }
 
 /**
@@ -1563,12 +1910,9 @@ int parse_setting_name ( char *name, get_child_settings_t get_child,
 	setting->tag = parse_setting_tag ( setting_name );
 	setting->scope = (*settings)->default_scope;
 	setting->name = setting_name;
-	for_each_table_entry ( predefined, SETTINGS ) {
+	if ( ( predefined = find_predefined_setting ( NULL, setting ) ) ) {
 		/* Matches a predefined setting; use that setting */
-		if ( setting_cmp ( predefined, setting ) == 0 ) {
-			memcpy ( setting, predefined, sizeof ( *setting ) );
-			break;
-		}
+		memcpy ( setting, predefined, sizeof ( *setting ) );
 	}
 
 	/* Identify setting type, if specified */
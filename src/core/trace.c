@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <ipxe/hrclock.h>
+#include <ipxe/trace.h>
+
+/** @file
+ *
+ * Boot timeline tracing
+ *
+ * Trace events are recorded into a fixed-size ring buffer, and may
+ * be used to reconstruct a timeline of the activities (such as
+ * network configuration, name resolution, downloads and image
+ * verification) that take place during a boot attempt.
+ *
+ */
+
+/** Identifier of next trace event to be recorded */
+unsigned int trace_next;
+
+/** Identifier of first trace event since trace was last cleared */
+static unsigned int trace_base;
+
+/** Trace event buffer */
+static struct trace_event trace_events[TRACE_MAX_EVENTS];
+
+/**
+ * Record trace event
+ *
+ * @v type		Event type
+ * @v fmt		Format string for event name
+ * @v args		Arguments
+ * @ret id		Event identifier
+ */
+static unsigned int trace_record ( unsigned int type, const char *fmt,
+				   va_list args ) {
+	unsigned int id = trace_next++;
+	struct trace_event *event = &trace_events[ id % TRACE_MAX_EVENTS ];
+
+	/* Populate event */
+	event->nsecs = hrclock_ns();
+	event->start = id;
+	event->rc = 0;
+	event->type = type;
+	vsnprintf ( event->name, sizeof ( event->name ), fmt, args );
+
+	return id;
+}
+
+/**
+ * Record start of an activity
+ *
+ * @v fmt		Format string for activity name
+ * @v ...		Arguments
+ * @ret id		Event identifier
+ */
+unsigned int trace_start ( const char *fmt, ... ) {
+	va_list args;
+	unsigned int id;
+
+	va_start ( args, fmt );
+	id = trace_record ( TRACE_START, fmt, args );
+	va_end ( args );
+	return id;
+}
+
+/**
+ * Record end of an activity
+ *
+ * @v start		Event identifier returned by trace_start()
+ * @v rc		Status code
+ */
+void trace_stop ( unsigned int start, int rc ) {
+	struct trace_event *started = trace_event ( start );
+	struct trace_event *event;
+	unsigned int id;
+
+	/* Record event, copying name from start event if still present */
+	id = trace_start ( "%s", ( started ? started->name : "" ) );
+	event = trace_event ( id );
+	event->type = TRACE_STOP;
+	event->start = start;
+	event->rc = rc;
+}
+
+/**
+ * Record instantaneous event
+ *
+ * @v fmt		Format string for event name
+ * @v ...		Arguments
+ */
+void trace_mark ( const char *fmt, ... ) {
+	va_list args;
+
+	va_start ( args, fmt );
+	trace_record ( TRACE_MARK, fmt, args );
+	va_end ( args );
+}
+
+/**
+ * Get first retained trace event identifier
+ *
+ * @ret id		Event identifier
+ */
+unsigned int trace_first ( void ) {
+
+	if ( ( trace_next - trace_base ) > TRACE_MAX_EVENTS )
+		return ( trace_next - TRACE_MAX_EVENTS );
+	return trace_base;
+}
+
+/**
+ * Get trace event
+ *
+ * @v id		Event identifier
+ * @ret event		Trace event, or NULL if no longer retained
+ */
+struct trace_event * trace_event ( unsigned int id ) {
+
+	if ( ( id - trace_first() ) >= ( trace_next - trace_first() ) )
+		return NULL;
+	return &trace_events[ id % TRACE_MAX_EVENTS ];
+}
+
+/**
+ * Discard all recorded trace events
+ *
+ */
+void trace_clear ( void ) {
+
+	trace_base = trace_next;
+}
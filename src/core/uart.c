@@ -61,6 +61,38 @@ void uart_transmit ( struct uart *uart, uint8_t data ) {
 	uart_write ( uart, UART_THR, data );
 }
 
+/**
+ * Transmit data without waiting
+ *
+ * @v uart		UART
+ * @v data		Data
+ * @v len		Length of data
+ * @ret len		Length of data transmitted
+ *
+ * Transmits as much data as will fit into the transmit FIFO (if
+ * empty), without waiting for the transmitter to become ready.
+ */
+size_t uart_send ( struct uart *uart, const void *data, size_t len ) {
+	const uint8_t *bytes = data;
+	size_t max;
+	size_t i;
+	uint8_t lsr;
+
+	/* Do nothing unless transmitter holding register is empty */
+	lsr = uart_read ( uart, UART_LSR );
+	if ( ! ( lsr & UART_LSR_THRE ) )
+		return 0;
+
+	/* Fill transmit FIFO */
+	max = ( uart->fifo_len ? uart->fifo_len : 1 );
+	if ( len > max )
+		len = max;
+	for ( i = 0 ; i < len ; i++ )
+		uart_write ( uart, UART_THR, bytes[i] );
+
+	return len;
+}
+
 /**
  * Flush data
  *
@@ -113,6 +145,7 @@ int uart_exists ( struct uart *uart ) {
 int uart_init ( struct uart *uart, unsigned int baud, uint8_t lcr ) {
 	uint8_t dlm;
 	uint8_t dll;
+	uint8_t iir;
 	int rc;
 
 	/* Check for existence of UART */
@@ -142,6 +175,9 @@ int uart_init ( struct uart *uart, unsigned int baud, uint8_t lcr ) {
 
 	/* Enable FIFOs */
 	uart_write ( uart, UART_FCR, UART_FCR_FE );
+	iir = uart_read ( uart, UART_IIR );
+	uart->fifo_len = ( ( ( iir & UART_IIR_FIFO ) == UART_IIR_FIFO ) ?
+			   UART_FIFO_LEN : 1 );
 
 	/* Assert DTR and RTS */
 	uart_write ( uart, UART_MCR, ( UART_MCR_DTR | UART_MCR_RTS ) );
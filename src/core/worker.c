@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * Worker CPU cores
+ *
+ * Self-contained jobs (such as hashing or decrypting a buffer) may be
+ * handed off to secondary CPU cores provided by the platform.
+ * Completions are reaped from the main loop.  If no worker cores are
+ * available, queued jobs are run on the boot CPU from the main loop
+ * instead.
+ *
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <ipxe/process.h>
+#include <ipxe/nap.h>
+#include <ipxe/crypto.h>
+#include <ipxe/worker.h>
+
+/** List of queued jobs */
+static LIST_HEAD ( worker_queue );
+
+/** List of worker cores */
+static LIST_HEAD ( worker_cores );
+
+/**
+ * Submit job to be run
+ *
+ * @v job		Worker job
+ */
+void worker_submit ( struct worker_job *job ) {
+
+	/* Sanity check */
+	assert ( list_empty ( &job->list ) );
+
+	/* Add to queue */
+	list_add_tail ( &job->list, &worker_queue );
+}
+
+/**
+ * Wait for worker core to finish running its current job
+ *
+ * @v core		Worker core
+ * @ret job		Finished job
+ */
+static struct worker_job * worker_wait ( struct worker_core *core ) {
+	struct worker_job *job = core->job;
+
+	/* Wait for job to finish */
+	while ( ! core->op->poll ( core ) )
+		cpu_nap();
+
+	/* Mark core as idle */
+	core->job = NULL;
+
+	return job;
+}
+
+/**
+ * Cancel job
+ *
+ * @v job		Worker job
+ *
+ * A job that is already running cannot be interrupted; this will
+ * wait for it to finish.  The job's completion method will not be
+ * called.
+ */
+void worker_cancel ( struct worker_job *job ) {
+	struct worker_core *core;
+
+	/* Remove from queue, if applicable */
+	if ( ! list_empty ( &job->list ) ) {
+		list_del ( &job->list );
+		INIT_LIST_HEAD ( &job->list );
+		return;
+	}
+
+	/* Wait for job to finish, if running */
+	list_for_each_entry ( core, &worker_cores, list ) {
+		if ( core->job == job ) {
+			worker_wait ( core );
+			return;
+		}
+	}
+}
+
+/**
+ * Register worker core
+ *
+ * @v core		Worker core
+ */
+void worker_register ( struct worker_core *core ) {
+
+	/* Add to list of worker cores */
+	core->job = NULL;
+	list_add_tail ( &core->list, &worker_cores );
+	DBGC ( core, "WORKER %s registered\n", core->name );
+}
+
+/**
+ * Unregister worker core
+ *
+ * @v core		Worker core
+ *
+ * Any job running on the core will be allowed to finish, and will be
+ * completed as normal.
+ */
+void worker_unregister ( struct worker_core *core ) {
+	struct worker_job *job;
+
+	/* Remove from list of worker cores */
+	list_del ( &core->list );
+	INIT_LIST_HEAD ( &core->list );
+
+	/* Complete any running job */
+	if ( core->job ) {
+		job = worker_wait ( core );
+		job->op->done ( job );
+	}
+	DBGC ( core, "WORKER %s unregistered\n", core->name );
+}
+
+/**
+ * Count worker cores
+ *
+ * @ret count		Number of worker cores
+ */
+unsigned int worker_count ( void ) {
+	struct worker_core *core;
+	unsigned int count = 0;
+
+	list_for_each_entry ( core, &worker_cores, list )
+		count++;
+	return count;
+}
+
+/**
+ * Dequeue next queued job
+ *
+ * @ret job		Worker job, or NULL if queue is empty
+ */
+static struct worker_job * worker_dequeue ( void ) {
+	struct worker_job *job;
+
+	job = list_first_entry ( &worker_queue, struct worker_job, list );
+	if ( job ) {
+		list_del ( &job->list );
+		INIT_LIST_HEAD ( &job->list );
+	}
+	return job;
+}
+
+/**
+ * Reap completed jobs and dispatch queued jobs
+ *
+ * @v process		Process
+ */
+static void worker_step ( struct process *process __unused ) {
+	struct worker_core *core;
+	struct worker_core *tmp;
+	struct worker_job *job;
+	int rc;
+
+	/* Reap completed jobs */
+	list_for_each_entry ( core, &worker_cores, list ) {
+		job = core->job;
+		if ( job && core->op->poll ( core ) ) {
+			core->job = NULL;
+			job->op->done ( job );
+		}
+	}
+
+	/* Dispatch queued jobs to idle worker cores */
+	list_for_each_entry_safe ( core, tmp, &worker_cores, list ) {
+		if ( core->job )
+			continue;
+		if ( ! ( job = worker_dequeue() ) )
+			break;
+		core->job = job;
+		if ( ( rc = core->op->start ( core, job ) ) != 0 ) {
+			DBGC ( core, "WORKER %s could not start: %s\n",
+			       core->name, strerror ( rc ) );
+			core->job = NULL;
+			list_add ( &job->list, &worker_queue );
+			/* Stop using this core */
+			list_del ( &core->list );
+			INIT_LIST_HEAD ( &core->list );
+		}
+	}
+
+	/* Run a queued job on the boot CPU if no worker cores exist */
+	if ( list_empty ( &worker_cores ) && ( job = worker_dequeue() ) ) {
+		job->op->run ( job );
+		job->op->done ( job );
+	}
+}
+
+/** Worker process */
+PERMANENT_PROCESS ( worker_process, worker_step );
+
+/**
+ * Run digest worker job
+ *
+ * @v job		Worker job
+ */
+static void worker_digest_run ( struct worker_job *job ) {
+	struct worker_digest *wdigest =
+		container_of ( job, struct worker_digest, job );
+
+	digest_update ( wdigest->digest, wdigest->ctx, wdigest->data,
+			wdigest->len );
+}
+
+/**
+ * Complete digest worker job
+ *
+ * @v job		Worker job
+ */
+static void worker_digest_done ( struct worker_job *job ) {
+	struct worker_digest *wdigest =
+		container_of ( job, struct worker_digest, job );
+
+	wdigest->done = 1;
+}
+
+/** Digest worker job operations */
+static struct worker_job_operations worker_digest_operations = {
+	.run = worker_digest_run,
+	.done = worker_digest_done,
+};
+
+/**
+ * Submit digest update to be run on a worker core
+ *
+ * @v wdigest		Digest worker job
+ * @v digest		Digest algorithm
+ * @v ctx		Digest context
+ * @v data		Data
+ * @v len		Length of data
+ *
+ * The digest is calculated on a worker core (or on the boot CPU, if
+ * no worker cores exist) while the main loop continues to run.  The
+ * caller may submit any number of digest updates (for independent
+ * digest contexts) before waiting for any of them to complete.
+ */
+void worker_digest_submit ( struct worker_digest *wdigest,
+			    struct digest_algorithm *digest, void *ctx,
+			    const void *data, size_t len ) {
+
+	/* Initialise job */
+	worker_job_init ( &wdigest->job, &worker_digest_operations );
+	wdigest->digest = digest;
+	wdigest->ctx = ctx;
+	wdigest->data = data;
+	wdigest->len = len;
+	wdigest->done = 0;
+
+	/* Submit job */
+	worker_submit ( &wdigest->job );
+}
+
+/**
+ * Wait for digest update to complete
+ *
+ * @v wdigest		Digest worker job
+ *
+ * This must not be called from within a process.
+ */
+void worker_digest_wait ( struct worker_digest *wdigest ) {
+
+	/* Run main loop until job has completed */
+	while ( ! wdigest->done )
+		step();
+}
+
+/**
+ * Update digest using a worker core
+ *
+ * @v digest		Digest algorithm
+ * @v ctx		Digest context
+ * @v data		Data
+ * @v len		Length of data
+ *
+ * This must not be called from within a process.
+ */
+void worker_digest ( struct digest_algorithm *digest, void *ctx,
+		     const void *data, size_t len ) {
+	struct worker_digest wdigest;
+
+	/* Submit job and wait for it to complete */
+	worker_digest_submit ( &wdigest, digest, ctx, data, len );
+	worker_digest_wait ( &wdigest );
+}
@@ -30,6 +30,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/iobuf.h>
 #include <ipxe/umalloc.h>
 #include <ipxe/profile.h>
+#include <ipxe/crypto.h>
 #include <ipxe/xferbuf.h>
 
 /** @file
@@ -46,10 +47,69 @@ static struct profiler xferbuf_deliver_profiler __profiler =
 static struct profiler xferbuf_write_profiler __profiler =
 	{ .name = "xferbuf.write" };
 
+/** Data reallocation profiler */
+static struct profiler xferbuf_realloc_profiler __profiler =
+	{ .name = "xferbuf.realloc" };
+
 /** Data read profiler */
 static struct profiler xferbuf_read_profiler __profiler =
 	{ .name = "xferbuf.read" };
 
+/** Data copy profiler (bytes copied per hundred bytes delivered) */
+static struct profiler xferbuf_copy_profiler __profiler =
+	{ .name = "xferbuf.copy" };
+
+/** Number of bytes copied during current delivery */
+static size_t xferbuf_copied;
+
+/**
+ * Start streaming digest of data transfer buffer
+ *
+ * @v xferbuf		Data transfer buffer
+ * @v digest		Digest algorithm
+ * @v ctx		Digest context
+ *
+ * The data transfer buffer must currently be empty.
+ */
+void xferbuf_digest_init ( struct xfer_buffer *xferbuf,
+			   struct digest_algorithm *digest, void *ctx ) {
+
+	digest_init ( digest, ctx );
+	xferbuf->digest = digest;
+	xferbuf->digest_ctx = ctx;
+	xferbuf->digest_len = 0;
+}
+
+/**
+ * Update streaming digest of data transfer buffer
+ *
+ * @v xferbuf		Data transfer buffer
+ * @v offset		Starting offset
+ * @v data		Data written
+ * @v len		Length of data
+ */
+static void xferbuf_digest_update ( struct xfer_buffer *xferbuf,
+				    size_t offset, const void *data,
+				    size_t len ) {
+
+	/* Ignore empty writes (e.g. used to presize the buffer) */
+	if ( ! len )
+		return;
+
+	/* Abandon digest on any out-of-order write */
+	if ( offset != xferbuf->digest_len ) {
+		DBGC ( xferbuf, "XFERBUF %p abandoning digest on write at "
+		       "%#zx (expected %#zx)\n",
+		       xferbuf, offset, xferbuf->digest_len );
+		xferbuf->digest = NULL;
+		return;
+	}
+
+	/* Update digest */
+	digest_update ( xferbuf->digest, xferbuf->digest_ctx, data, len );
+	xferbuf->digest_len += len;
+}
+
 /**
  * Free data transfer buffer
  *
@@ -58,10 +118,36 @@ static struct profiler xferbuf_read_profiler __profiler =
 void xferbuf_free ( struct xfer_buffer *xferbuf ) {
 
 	xferbuf->op->realloc ( xferbuf, 0 );
+	xferbuf->digest = NULL;
 	xferbuf->len = 0;
+	xferbuf->alloc = 0;
 	xferbuf->pos = 0;
 }
 
+/**
+ * Release any unused space within data transfer buffer
+ *
+ * @v xferbuf		Data transfer buffer
+ * @ret rc		Return status code
+ */
+int xferbuf_trim ( struct xfer_buffer *xferbuf ) {
+	int rc;
+
+	/* If there is no unused space, do nothing */
+	if ( xferbuf->alloc <= xferbuf->len )
+		return 0;
+
+	/* Shrink buffer */
+	if ( ( rc = xferbuf->op->realloc ( xferbuf, xferbuf->len ) ) != 0 ) {
+		DBGC ( xferbuf, "XFERBUF %p could not shrink buffer to "
+		       "%zd bytes: %s\n", xferbuf, xferbuf->len, strerror ( rc ) );
+		return rc;
+	}
+	xferbuf->alloc = xferbuf->len;
+
+	return 0;
+}
+
 /**
  * Ensure that data transfer buffer is large enough for the specified size
  *
@@ -70,17 +156,39 @@ void xferbuf_free ( struct xfer_buffer *xferbuf ) {
  * @ret rc		Return status code
  */
 static int xferbuf_ensure_size ( struct xfer_buffer *xferbuf, size_t len ) {
+	size_t alloc;
 	int rc;
 
 	/* If buffer is already large enough, do nothing */
 	if ( len <= xferbuf->len )
 		return 0;
 
-	/* Extend buffer */
-	if ( ( rc = xferbuf->op->realloc ( xferbuf, len ) ) != 0 ) {
-		DBGC ( xferbuf, "XFERBUF %p could not extend buffer to "
-		       "%zd bytes: %s\n", xferbuf, len, strerror ( rc ) );
-		return rc;
+	/* Extend buffer, if necessary.  Reallocation may require all
+	 * existing data to be copied, so grow the allocation
+	 * geometrically in order to avoid a quadratic copying cost
+	 * when the final length is not known in advance.  (An empty
+	 * buffer, such as one being presized to a known length, is
+	 * allocated exactly.)
+	 */
+	if ( len > xferbuf->alloc ) {
+		profile_start ( &xferbuf_realloc_profiler );
+		alloc = ( xferbuf->alloc + ( xferbuf->alloc / 2 ) );
+		if ( alloc <= len ) {
+			alloc = len;
+		} else if ( xferbuf->op->realloc ( xferbuf, alloc ) != 0 ) {
+			/* Fall back to an exact allocation */
+			alloc = len;
+		}
+		if ( ( alloc == len ) &&
+		     ( ( rc = xferbuf->op->realloc ( xferbuf, len ) ) != 0 ) ) {
+			profile_stop ( &xferbuf_realloc_profiler );
+			DBGC ( xferbuf, "XFERBUF %p could not extend buffer to "
+			       "%zd bytes: %s\n", xferbuf, len, strerror ( rc ) );
+			return rc;
+		}
+		xferbuf->alloc = alloc;
+		xferbuf_copied += xferbuf->len;
+		profile_stop ( &xferbuf_realloc_profiler );
 	}
 	xferbuf->len = len;
 
@@ -113,6 +221,11 @@ int xferbuf_write ( struct xfer_buffer *xferbuf, size_t offset,
 	profile_start ( &xferbuf_write_profiler );
 	xferbuf->op->write ( xferbuf, offset, data, len );
 	profile_stop ( &xferbuf_write_profiler );
+	xferbuf_copied += len;
+
+	/* Update streaming digest, if applicable */
+	if ( xferbuf->digest )
+		xferbuf_digest_update ( xferbuf, offset, data, len );
 
 	return 0;
 }
@@ -157,6 +270,7 @@ int xferbuf_deliver ( struct xfer_buffer *xferbuf, struct io_buffer *iobuf,
 
 	/* Start profiling */
 	profile_start ( &xferbuf_deliver_profiler );
+	xferbuf_copied = 0;
 
 	/* Calculate new buffer position */
 	pos = xferbuf->pos;
@@ -171,6 +285,14 @@ int xferbuf_deliver ( struct xfer_buffer *xferbuf, struct io_buffer *iobuf,
 	/* Update current buffer position */
 	xferbuf->pos = ( pos + len );
 
+	/* Record number of bytes copied (including any data moved by
+	 * reallocation) relative to the number of bytes delivered.
+	 */
+	if ( len ) {
+		profile_custom ( &xferbuf_copy_profiler,
+				 ( ( xferbuf_copied * 100 ) / len ) );
+	}
+
  done:
 	free_iob ( iobuf );
 	profile_stop ( &xferbuf_deliver_profiler );
@@ -38,6 +38,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/crypto.h>
 #include <ipxe/ecb.h>
 #include <ipxe/cbc.h>
+#include <ipxe/gcm.h>
 #include <ipxe/aes.h>
 
 /** AES strides
@@ -404,6 +405,10 @@ static void aes_encrypt ( void *ctx, const void *src, void *dst, size_t len ) {
 	/* Sanity check */
 	assert ( len == sizeof ( *in ) );
 
+	/* Use hardware acceleration, if available */
+	if ( aes_accel_encrypt ( aes, src, dst ) )
+		return;
+
 	/* Initialise input state */
 	memcpy ( in, src, sizeof ( *in ) );
 
@@ -440,6 +445,10 @@ static void aes_decrypt ( void *ctx, const void *src, void *dst, size_t len ) {
 	/* Sanity check */
 	assert ( len == sizeof ( *in ) );
 
+	/* Use hardware acceleration, if available */
+	if ( aes_accel_decrypt ( aes, src, dst ) )
+		return;
+
 	/* Initialise input state */
 	memcpy ( in, src, sizeof ( *in ) );
 
@@ -806,3 +815,7 @@ ECB_CIPHER ( aes_ecb, aes_ecb_algorithm,
 /* AES in Cipher Block Chaining mode */
 CBC_CIPHER ( aes_cbc, aes_cbc_algorithm,
 	     aes_algorithm, struct aes_context, AES_BLOCKSIZE );
+
+/* AES in Galois/Counter mode */
+GCM_CIPHER ( aes_gcm, aes_gcm_algorithm,
+	     aes_algorithm, struct aes_context, AES_BLOCKSIZE );
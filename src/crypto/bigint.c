@@ -90,6 +90,125 @@ void bigint_mod_multiply_raw ( const bigint_element_t *multiplicand0,
 	assert ( bigint_is_geq ( modulus, result ) );
 }
 
+/**
+ * Calculate Montgomery inverse of modulus
+ *
+ * @v modulus		Element 0 of (odd) big integer modulus
+ * @ret inverse		Inverse -N^-1 (mod 2^w), where w is the element width
+ */
+static bigint_element_t bigint_montgomery_inverse ( bigint_element_t modulus ){
+	bigint_element_t inverse;
+	unsigned int bits;
+
+	/* Calculate N^-1 by Newton iteration.  Any odd N is its own
+	 * inverse modulo 2^3, and each iteration doubles the number
+	 * of correct bits.
+	 */
+	inverse = modulus;
+	for ( bits = 3 ; bits < ( 8 * sizeof ( inverse ) ) ; bits *= 2 )
+		inverse *= ( 2 - ( modulus * inverse ) );
+
+	return ( -inverse );
+}
+
+/**
+ * Perform Montgomery reduction of big integer
+ *
+ * @v modulus0		Element 0 of big integer (odd) modulus
+ * @v inverse		Montgomery inverse -N^-1 (mod 2^w)
+ * @v value0		Element 0 of double-sized big integer to be reduced
+ * @v result0		Element 0 of big integer to hold result
+ * @v size		Number of elements in modulus and result
+ *
+ * Calculates T * R^-1 (mod N), where R = 2^(w * size), as per
+ * algorithm 14.32 in the Handbook of Applied Cryptography.  The
+ * value to be reduced must be less than N * R, and is overwritten.
+ */
+static void bigint_montgomery_raw ( const bigint_element_t *modulus0,
+				    bigint_element_t inverse,
+				    bigint_element_t *value0,
+				    bigint_element_t *result0,
+				    unsigned int size ) {
+	const bigint_t ( size ) __attribute__ (( may_alias )) *modulus =
+		( ( const void * ) modulus0 );
+	bigint_t ( size * 2 ) __attribute__ (( may_alias )) *value =
+		( ( void * ) value0 );
+	bigint_t ( size ) __attribute__ (( may_alias )) *result =
+		( ( void * ) result0 );
+	bigint_element_t multiple;
+	bigint_element_t element;
+	bigint_element_t carry;
+	int overflow = 0;
+	unsigned int i;
+
+	/* Add the multiple of the modulus that zeroes each element in
+	 * turn, propagating the carry (plus the single overflow bit
+	 * from the previous step) into the upper half.
+	 */
+	for ( i = 0 ; i < size ; i++ ) {
+		multiple = ( value->element[i] * inverse );
+		carry = bigint_multiply_accumulate_raw ( modulus->element,
+							 multiple,
+							 &value->element[i],
+							 size );
+		element = ( value->element[ i + size ] + carry );
+		carry = ( element < carry );
+		element += overflow;
+		carry |= ( element < ( bigint_element_t ) overflow );
+		value->element[ i + size ] = element;
+		overflow = carry;
+	}
+
+	/* Result is the upper half, which is less than 2N */
+	memcpy ( result, &value->element[size], sizeof ( *result ) );
+	if ( overflow || bigint_is_geq ( result, modulus ) )
+		bigint_subtract ( modulus, result );
+}
+
+/**
+ * Perform Montgomery multiplication of big integers
+ *
+ * @v multiplicand0	Element 0 of big integer to be multiplied
+ * @v multiplier0	Element 0 of big integer to be multiplied
+ * @v modulus0		Element 0 of big integer (odd) modulus
+ * @v inverse		Montgomery inverse -N^-1 (mod 2^w)
+ * @v result0		Element 0 of big integer to hold result
+ * @v product0		Element 0 of double-sized big integer working space
+ * @v size		Number of elements
+ *
+ * The result may safely overlap either input.
+ */
+static void bigint_montgomery_multiply_raw ( const bigint_element_t
+					     *multiplicand0,
+					     const bigint_element_t
+					     *multiplier0,
+					     const bigint_element_t *modulus0,
+					     bigint_element_t inverse,
+					     bigint_element_t *result0,
+					     bigint_element_t *product0,
+					     unsigned int size ) {
+
+	bigint_multiply_raw ( multiplicand0, multiplier0, product0, size );
+	bigint_montgomery_raw ( modulus0, inverse, product0, result0, size );
+}
+
+/**
+ * Choose window size for modular exponentiation
+ *
+ * @v bits		Number of bits in exponent
+ * @ret window		Window size
+ */
+static unsigned int bigint_mod_exp_window ( unsigned int bits ) {
+
+	if ( bits > 239 )
+		return 5;
+	if ( bits > 79 )
+		return 4;
+	if ( bits > 23 )
+		return 3;
+	return 1;
+}
+
 /**
  * Perform modular exponentiation of big integers
  *
@@ -100,6 +219,10 @@ void bigint_mod_multiply_raw ( const bigint_element_t *multiplicand0,
  * @v size		Number of elements in base, modulus, and result
  * @v exponent_size	Number of elements in exponent
  * @v tmp		Temporary working space
+ *
+ * Odd moduli (including all RSA moduli) are handled using Montgomery
+ * multiplication with a sliding window over the exponent.  Even
+ * moduli fall back to simple square-and-multiply.
  */
 void bigint_mod_exp_raw ( const bigint_element_t *base0,
 			  const bigint_element_t *modulus0,
@@ -119,21 +242,127 @@ void bigint_mod_exp_raw ( const bigint_element_t *base0,
 	struct {
 		bigint_t ( size ) base;
 		bigint_t ( exponent_size ) exponent;
+		bigint_t ( size ) square;
+		bigint_t ( size * 2 ) product;
+		bigint_t ( size ) table[BIGINT_MOD_EXP_TABLE_LEN];
 		uint8_t mod_multiply[mod_multiply_len];
 	} *temp = tmp;
 	static const uint8_t start[1] = { 0x01 };
+	bigint_element_t inverse;
+	unsigned int window;
+	unsigned int index;
+	unsigned int i;
+	int bit;
+	int low;
 
-	memcpy ( &temp->base, base, sizeof ( temp->base ) );
-	memcpy ( &temp->exponent, exponent, sizeof ( temp->exponent ) );
-	bigint_init ( result, start, sizeof ( start ) );
+	/* Sanity check */
+	assert ( sizeof ( *temp ) ==
+		 bigint_mod_exp_tmp_len ( modulus, exponent ) );
 
-	while ( ! bigint_is_zero ( &temp->exponent ) ) {
-		if ( bigint_bit_is_set ( &temp->exponent, 0 ) ) {
-			bigint_mod_multiply ( result, &temp->base, modulus,
-					      result, temp->mod_multiply );
+	/* Use simple square-and-multiply for an even modulus */
+	if ( ! bigint_bit_is_set ( modulus, 0 ) ) {
+		memcpy ( &temp->base, base, sizeof ( temp->base ) );
+		memcpy ( &temp->exponent, exponent,
+			 sizeof ( temp->exponent ) );
+		bigint_init ( result, start, sizeof ( start ) );
+		while ( ! bigint_is_zero ( &temp->exponent ) ) {
+			if ( bigint_bit_is_set ( &temp->exponent, 0 ) ) {
+				bigint_mod_multiply ( result, &temp->base,
+						      modulus, result,
+						      temp->mod_multiply );
+			}
+			bigint_ror ( &temp->exponent );
+			bigint_mod_multiply ( &temp->base, &temp->base,
+					      modulus, &temp->base,
+					      temp->mod_multiply );
 		}
-		bigint_ror ( &temp->exponent );
-		bigint_mod_multiply ( &temp->base, &temp->base, modulus,
-				      &temp->base, temp->mod_multiply );
+		return;
 	}
+
+	/* Calculate Montgomery constants R (mod N) and R^2 (mod N),
+	 * using (R - N) as a representation of R.
+	 */
+	inverse = bigint_montgomery_inverse ( modulus->element[0] );
+	bigint_init ( &temp->base, start, sizeof ( start ) );
+	memset ( result, 0, sizeof ( *result ) );
+	bigint_subtract ( modulus, result );
+	bigint_mod_multiply ( result, &temp->base, modulus, result,
+			      temp->mod_multiply );
+	bigint_mod_multiply ( result, result, modulus, &temp->square,
+			      temp->mod_multiply );
+
+	/* Precalculate odd powers b, b^3, b^5, ... in Montgomery form */
+	bit = bigint_max_set_bit ( exponent );
+	window = bigint_mod_exp_window ( bit );
+	bigint_montgomery_multiply_raw ( base->element, temp->square.element,
+					 modulus->element, inverse,
+					 temp->table[0].element,
+					 temp->product.element, size );
+	bigint_montgomery_multiply_raw ( temp->table[0].element,
+					 temp->table[0].element,
+					 modulus->element, inverse,
+					 temp->square.element,
+					 temp->product.element, size );
+	for ( i = 1 ; i < ( 1U << ( window - 1 ) ) ; i++ ) {
+		bigint_montgomery_multiply_raw ( temp->table[ i - 1 ].element,
+						 temp->square.element,
+						 modulus->element, inverse,
+						 temp->table[i].element,
+						 temp->product.element, size );
+	}
+
+	/* Scan exponent from most significant bit, starting from the
+	 * Montgomery form of 1 (i.e. R mod N, already held in result).
+	 */
+	bit--;
+	while ( bit >= 0 ) {
+
+		/* Square once for each zero bit */
+		if ( ! bigint_bit_is_set ( exponent, bit ) ) {
+			bigint_montgomery_multiply_raw ( result->element,
+							 result->element,
+							 modulus->element,
+							 inverse,
+							 result->element,
+							 temp->product.element,
+							 size );
+			bit--;
+			continue;
+		}
+
+		/* Find longest window ending in a set bit */
+		low = ( bit - window + 1 );
+		if ( low < 0 )
+			low = 0;
+		while ( ! bigint_bit_is_set ( exponent, low ) )
+			low++;
+
+		/* Square once per bit in window, accumulating window value */
+		index = 0;
+		for ( ; bit >= low ; bit-- ) {
+			bigint_montgomery_multiply_raw ( result->element,
+							 result->element,
+							 modulus->element,
+							 inverse,
+							 result->element,
+							 temp->product.element,
+							 size );
+			index = ( ( index << 1 ) |
+				  ( bigint_bit_is_set ( exponent, bit ) ?
+				    1 : 0 ) );
+		}
+
+		/* Multiply by precalculated odd power */
+		index /= 2;
+		bigint_montgomery_multiply_raw ( result->element,
+						 temp->table[index].element,
+						 modulus->element, inverse,
+						 result->element,
+						 temp->product.element, size );
+	}
+
+	/* Convert result out of Montgomery form */
+	bigint_grow ( result, &temp->product );
+	bigint_montgomery_raw ( modulus->element, inverse,
+				temp->product.element, result->element, size );
 }
@@ -25,14 +25,17 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 #include <string.h>
 #include <stdlib.h>
+#include <errno.h>
 #include <ipxe/init.h>
 #include <ipxe/dhcp.h>
 #include <ipxe/settings.h>
 #include <ipxe/malloc.h>
 #include <ipxe/crypto.h>
 #include <ipxe/asn1.h>
+#include <ipxe/sha256.h>
 #include <ipxe/x509.h>
 #include <ipxe/certstore.h>
+#include <config/crypto.h>
 
 /** @file
  *
@@ -42,9 +45,10 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 /** Raw certificate data for all permanent stored certificates */
 #undef CERT
-#define CERT( _index, _path )						\
+#define CERT( _index, _path, _fp_path )					\
 	extern char stored_cert_ ## _index ## _data[];			\
 	extern char stored_cert_ ## _index ## _len[];			\
+	extern uint8_t stored_cert_ ## _index ## _fingerprint[];	\
 	__asm__ ( ".section \".rodata\", \"a\", " PROGBITS "\n\t"	\
 		  "\nstored_cert_" #_index "_data:\n\t"			\
 		  ".incbin \"" _path "\"\n\t"				\
@@ -52,12 +56,14 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 		  ".equ stored_cert_" #_index "_len, "			\
 			"( stored_cert_" #_index "_end - "		\
 			"  stored_cert_" #_index "_data )\n\t"		\
+		  "\nstored_cert_" #_index "_fingerprint:\n\t"		\
+		  ".incbin \"" _fp_path "\"\n\t"			\
 		  ".previous\n\t" );
 CERT_ALL
 
 /** Raw certificate cursors for all permanent stored certificates */
 #undef CERT
-#define CERT( _index, _path ) {						\
+#define CERT( _index, _path, _fp_path ) {				\
 	.data = stored_cert_ ## _index ## _data,			\
 	.len = ( size_t ) stored_cert_ ## _index ## _len, 		\
 },
@@ -65,6 +71,19 @@ static struct asn1_cursor certstore_raw[] = {
 	CERT_ALL
 };
 
+/** SHA-256 fingerprints for all permanent stored certificates
+ *
+ * These are calculated at build time, to avoid hashing each
+ * permanent certificate on the target whenever it is checked against
+ * the root certificate list or the cached validation results.
+ */
+#undef CERT
+#define CERT( _index, _path, _fp_path )					\
+	stored_cert_ ## _index ## _fingerprint,
+static uint8_t *certstore_fingerprints[] = {
+	CERT_ALL
+};
+
 /** X.509 certificate structures for all permanent stored certificates */
 static struct x509_certificate certstore_certs[ sizeof ( certstore_raw ) /
 						sizeof ( certstore_raw[0] ) ];
@@ -196,9 +215,218 @@ static unsigned int certstore_discard ( void ) {
 
 /** Certificate store cache discarder */
 struct cache_discarder certstore_discarder __cache_discarder ( CACHE_NORMAL ) ={
+	.name = "certstore",
 	.discard = certstore_discard,
 };
 
+/** A cached certificate validation result */
+struct certstore_validation {
+	/** List of cached validation results */
+	struct list_head list;
+	/** Certificate fingerprint */
+	uint8_t fingerprint[SHA256_DIGEST_SIZE];
+	/** Root certificate list used for validation */
+	struct x509_root *root;
+	/** Root certificate list generation */
+	unsigned int generation;
+	/** Effective validity period (including all issuers) */
+	struct x509_validity validity;
+	/** Maximum number of subsequent intermediate certificates */
+	unsigned int path_remaining;
+};
+
+/** Cached certificate validation results
+ *
+ * Certificates may be discarded from the store under memory
+ * pressure, and will then be parsed afresh when next encountered.
+ * Validation results are retained (by fingerprint) for the lifetime
+ * of iPXE, so that a previously validated certificate can be
+ * accepted without repeating any public-key signature checks.
+ */
+static LIST_HEAD ( certstore_validations );
+
+/**
+ * Find cached certificate validation result
+ *
+ * @v fingerprint	Certificate fingerprint
+ * @v root		Root certificate list
+ * @ret validation	Cached validation result, or NULL if not found
+ */
+static struct certstore_validation *
+certstore_find_validation ( const uint8_t *fingerprint,
+			    struct x509_root *root ) {
+	struct certstore_validation *validation;
+
+	/* Search for a result from the current root certificate list */
+	list_for_each_entry ( validation, &certstore_validations, list ) {
+		if ( ( validation->root == root ) &&
+		     ( validation->generation == root->generation ) &&
+		     ( memcmp ( validation->fingerprint, fingerprint,
+				sizeof ( validation->fingerprint ) ) == 0 ) ) {
+
+			/* Mark as most recently used */
+			list_del ( &validation->list );
+			list_add ( &validation->list, &certstore_validations );
+			return validation;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Check for cached certificate validation result
+ *
+ * @v cert		X.509 certificate
+ * @v time		Time at which to validate certificate
+ * @v root		Root certificate list
+ * @ret rc		Return status code
+ *
+ * If the certificate has previously been validated using the same
+ * root certificate list, and the specified time lies within the
+ * validity period of the certificate and all of its issuers, then the
+ * certificate will be marked as valid.
+ */
+int certstore_is_validated ( struct x509_certificate *cert, time_t time,
+			     struct x509_root *root ) {
+	struct certstore_validation *validation;
+	struct x509_validity *validity;
+	uint8_t fingerprint[SHA256_DIGEST_SIZE];
+
+	/* Find cached validation result */
+	x509_fingerprint ( cert, &sha256_algorithm, fingerprint );
+	validation = certstore_find_validation ( fingerprint, root );
+	if ( ! validation )
+		return -ENOENT;
+
+	/* Check effective validity period */
+	validity = &validation->validity;
+	if ( ( validity->not_before.time > ( time + TIMESTAMP_ERROR_MARGIN ) )||
+	     ( validity->not_after.time < ( time - TIMESTAMP_ERROR_MARGIN ) ) ){
+		DBGC2 ( &certstore, "CERTSTORE cached validation of %s is not "
+			"valid at time %lld\n", x509_name ( cert ), time );
+		return -ENOENT;
+	}
+
+	/* Mark certificate as valid */
+	cert->flags |= X509_FL_VALIDATED;
+	cert->path_remaining = validation->path_remaining;
+	DBGC ( &certstore, "CERTSTORE found cached validation of %s\n",
+	       x509_name ( cert ) );
+
+	return 0;
+}
+
+/**
+ * Record certificate validation result
+ *
+ * @v cert		X.509 certificate
+ * @v issuer		Issuing X.509 certificate (or NULL)
+ * @v root		Root certificate list
+ *
+ * Failure to record a validation result is not an error, since the
+ * certificate may always be validated again.
+ */
+void certstore_mark_validated ( struct x509_certificate *cert,
+				struct x509_certificate *issuer,
+				struct x509_root *root ) {
+	struct certstore_validation *validation;
+	struct certstore_validation *issuer_validation;
+	struct x509_validity *validity;
+	uint8_t fingerprint[SHA256_DIGEST_SIZE];
+
+	/* Find or create cached validation result */
+	x509_fingerprint ( cert, &sha256_algorithm, fingerprint );
+	validation = certstore_find_validation ( fingerprint, root );
+	if ( ! validation ) {
+		validation = zalloc ( sizeof ( *validation ) );
+		if ( ! validation )
+			return;
+		memcpy ( validation->fingerprint, fingerprint,
+			 sizeof ( validation->fingerprint ) );
+		validation->root = root;
+		validation->generation = root->generation;
+		list_add ( &validation->list, &certstore_validations );
+	}
+
+	/* Record validation result */
+	memcpy ( &validation->validity, &cert->validity,
+		 sizeof ( validation->validity ) );
+	validation->path_remaining = cert->path_remaining;
+
+	/* Restrict validity period to that of the issuer (including
+	 * the issuer's own issuers, if known).
+	 */
+	if ( issuer ) {
+		x509_fingerprint ( issuer, &sha256_algorithm, fingerprint );
+		issuer_validation =
+			certstore_find_validation ( fingerprint, root );
+		validity = ( issuer_validation ?
+			     &issuer_validation->validity :
+			     &issuer->validity );
+		if ( validation->validity.not_before.time <
+		     validity->not_before.time ) {
+			validation->validity.not_before.time =
+				validity->not_before.time;
+		}
+		if ( validation->validity.not_after.time >
+		     validity->not_after.time ) {
+			validation->validity.not_after.time =
+				validity->not_after.time;
+		}
+	}
+
+	DBGC2 ( &certstore, "CERTSTORE cached validation of %s\n",
+		x509_name ( cert ) );
+}
+
+/**
+ * Discard cached certificate validation results
+ *
+ * @v cert		X.509 certificate
+ */
+void certstore_unmark_validated ( struct x509_certificate *cert ) {
+	struct certstore_validation *validation;
+	struct certstore_validation *tmp;
+	uint8_t fingerprint[SHA256_DIGEST_SIZE];
+
+	/* Discard results from all root certificate lists */
+	x509_fingerprint ( cert, &sha256_algorithm, fingerprint );
+	list_for_each_entry_safe ( validation, tmp, &certstore_validations,
+				   list ) {
+		if ( memcmp ( validation->fingerprint, fingerprint,
+			      sizeof ( validation->fingerprint ) ) != 0 )
+			continue;
+		list_del ( &validation->list );
+		free ( validation );
+	}
+}
+
+/**
+ * Discard a cached certificate validation result
+ *
+ * @ret discarded	Number of cached items discarded
+ */
+static unsigned int certstore_discard_validation ( void ) {
+	struct certstore_validation *validation;
+
+	/* Discard the least recently used validation result */
+	list_for_each_entry_reverse ( validation, &certstore_validations,
+				      list ) {
+		list_del ( &validation->list );
+		free ( validation );
+		return 1;
+	}
+
+	return 0;
+}
+
+/** Cached certificate validation result discarder */
+struct cache_discarder certstore_validation_discarder
+	__cache_discarder ( CACHE_NORMAL ) = {
+	.name = "certstore.validation",
+	.discard = certstore_discard_validation,
+};
+
 /**
  * Construct permanent certificate store
  *
@@ -235,6 +463,11 @@ static void certstore_init ( void ) {
 			continue;
 		}
 
+		/* Use fingerprint calculated at build time */
+		memcpy ( cert->fingerprint, certstore_fingerprints[i],
+			 sizeof ( cert->fingerprint ) );
+		cert->flags |= X509_FL_FINGERPRINT;
+
 		/* Add certificate to store.  Certificate will never
 		 * be discarded from the store, since we retain a
 		 * permanent reference to it.
@@ -0,0 +1,392 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * ChaCha20 stream cipher
+ *
+ * This implements ChaCha20 and the ChaCha20-Poly1305 authenticated
+ * encryption construction as described in RFC 8439.  ChaCha20 uses
+ * only 32-bit additions, rotations and exclusive-ORs, and so runs in
+ * constant time and at a reasonable speed on CPUs lacking any form
+ * of AES acceleration.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <byteswap.h>
+#include <ipxe/rotate.h>
+#include <ipxe/crypto.h>
+#include <ipxe/poly1305.h>
+#include <ipxe/chacha20.h>
+
+/** ChaCha20 constant ("expand 32-byte k") */
+static const uint32_t chacha20_constant[4] = {
+	0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+};
+
+/**
+ * Perform ChaCha20 quarter round
+ *
+ * @v x			Working state
+ * @v a			First word index
+ * @v b			Second word index
+ * @v c			Third word index
+ * @v d			Fourth word index
+ */
+#define CHACHA20_QUARTER_ROUND( x, a, b, c, d ) do {			\
+	x[a] += x[b]; x[d] = rol32 ( ( x[d] ^ x[a] ), 16 );		\
+	x[c] += x[d]; x[b] = rol32 ( ( x[b] ^ x[c] ), 12 );		\
+	x[a] += x[b]; x[d] = rol32 ( ( x[d] ^ x[a] ), 8 );		\
+	x[c] += x[d]; x[b] = rol32 ( ( x[b] ^ x[c] ), 7 );		\
+	} while ( 0 )
+
+/**
+ * Generate next keystream block
+ *
+ * @v ctx		ChaCha20 context
+ */
+static void chacha20_block ( struct chacha20_context *ctx ) {
+	uint32_t x[CHACHA20_WORDS];
+	unsigned int i;
+
+	/* Perform 20 rounds (as 10 double rounds) */
+	memcpy ( x, ctx->state, sizeof ( x ) );
+	for ( i = 0 ; i < 10 ; i++ ) {
+		CHACHA20_QUARTER_ROUND ( x, 0, 4, 8, 12 );
+		CHACHA20_QUARTER_ROUND ( x, 1, 5, 9, 13 );
+		CHACHA20_QUARTER_ROUND ( x, 2, 6, 10, 14 );
+		CHACHA20_QUARTER_ROUND ( x, 3, 7, 11, 15 );
+		CHACHA20_QUARTER_ROUND ( x, 0, 5, 10, 15 );
+		CHACHA20_QUARTER_ROUND ( x, 1, 6, 11, 12 );
+		CHACHA20_QUARTER_ROUND ( x, 2, 7, 8, 13 );
+		CHACHA20_QUARTER_ROUND ( x, 3, 4, 9, 14 );
+	}
+
+	/* Add input state to produce keystream block */
+	for ( i = 0 ; i < CHACHA20_WORDS ; i++ )
+		ctx->stream.word[i] = cpu_to_le32 ( x[i] + ctx->state[i] );
+
+	/* Increment block counter */
+	ctx->state[12]++;
+	ctx->offset = 0;
+}
+
+/**
+ * Encrypt or decrypt data
+ *
+ * @v ctx		ChaCha20 context
+ * @v src		Input data
+ * @v dst		Output data
+ * @v len		Length of data
+ */
+static void chacha20_xor ( struct chacha20_context *ctx, const void *src,
+			   void *dst, size_t len ) {
+	const uint8_t *in = src;
+	uint8_t *out = dst;
+	uint32_t block[CHACHA20_WORDS];
+	unsigned int i;
+
+	/* Process complete blocks a word at a time, where possible */
+	while ( ( len >= CHACHA20_BLOCKSIZE ) &&
+		( ctx->offset == CHACHA20_BLOCKSIZE ) ) {
+		chacha20_block ( ctx );
+		memcpy ( block, in, sizeof ( block ) );
+		for ( i = 0 ; i < CHACHA20_WORDS ; i++ )
+			block[i] ^= ctx->stream.word[i];
+		memcpy ( out, block, sizeof ( block ) );
+		ctx->offset = CHACHA20_BLOCKSIZE;
+		in += CHACHA20_BLOCKSIZE;
+		out += CHACHA20_BLOCKSIZE;
+		len -= CHACHA20_BLOCKSIZE;
+	}
+
+	/* Process remaining bytes */
+	while ( len-- ) {
+		if ( ctx->offset == CHACHA20_BLOCKSIZE )
+			chacha20_block ( ctx );
+		*(out++) = ( *(in++) ^ ctx->stream.byte[ctx->offset++] );
+	}
+}
+
+/**
+ * Set key
+ *
+ * @v ctx		ChaCha20 context
+ * @v key		Key
+ * @v keylen		Key length
+ * @ret rc		Return status code
+ */
+static int chacha20_key ( struct chacha20_context *ctx, const void *key,
+			  size_t keylen ) {
+	const uint32_t *words = key;
+	uint32_t word;
+	unsigned int i;
+
+	/* Check key length */
+	if ( keylen != CHACHA20_KEY_LEN )
+		return -EINVAL;
+
+	/* Construct constant and key portions of input state */
+	memcpy ( ctx->state, chacha20_constant, sizeof ( chacha20_constant ) );
+	for ( i = 0 ; i < ( CHACHA20_KEY_LEN / sizeof ( word ) ) ; i++ ) {
+		memcpy ( &word, &words[i], sizeof ( word ) );
+		ctx->state[ 4 + i ] = le32_to_cpu ( word );
+	}
+	ctx->offset = CHACHA20_BLOCKSIZE;
+
+	return 0;
+}
+
+/**
+ * Set block counter and nonce
+ *
+ * @v ctx		ChaCha20 context
+ * @v counter		Initial block counter
+ * @v nonce		Nonce (of length CHACHA20_NONCE_LEN)
+ */
+static void chacha20_nonce ( struct chacha20_context *ctx, uint32_t counter,
+			     const void *nonce ) {
+	const uint32_t *words = nonce;
+	uint32_t word;
+	unsigned int i;
+
+	/* Construct counter and nonce portions of input state */
+	ctx->state[12] = counter;
+	for ( i = 0 ; i < ( CHACHA20_NONCE_LEN / sizeof ( word ) ) ; i++ ) {
+		memcpy ( &word, &words[i], sizeof ( word ) );
+		ctx->state[ 13 + i ] = le32_to_cpu ( word );
+	}
+	ctx->offset = CHACHA20_BLOCKSIZE;
+}
+
+/**
+ * Set ChaCha20 key
+ *
+ * @v ctx		Context
+ * @v key		Key
+ * @v keylen		Key length
+ * @ret rc		Return status code
+ */
+static int chacha20_setkey ( void *ctx, const void *key, size_t keylen ) {
+	struct chacha20_context *chacha20 = ctx;
+
+	return chacha20_key ( chacha20, key, keylen );
+}
+
+/**
+ * Set ChaCha20 initialisation vector
+ *
+ * @v ctx		Context
+ * @v iv		Initialisation vector (of length CHACHA20_IV_LEN)
+ */
+static void chacha20_setiv ( void *ctx, const void *iv ) {
+	struct chacha20_context *chacha20 = ctx;
+	uint32_t counter;
+
+	memcpy ( &counter, iv, sizeof ( counter ) );
+	chacha20_nonce ( chacha20, le32_to_cpu ( counter ),
+			 ( iv + sizeof ( counter ) ) );
+}
+
+/**
+ * Encrypt or decrypt data using ChaCha20
+ *
+ * @v ctx		Context
+ * @v src		Input data
+ * @v dst		Output data
+ * @v len		Length of data
+ */
+static void chacha20_crypt ( void *ctx, const void *src, void *dst,
+			     size_t len ) {
+	struct chacha20_context *chacha20 = ctx;
+
+	chacha20_xor ( chacha20, src, dst, len );
+}
+
+/** ChaCha20 stream cipher */
+struct cipher_algorithm chacha20_algorithm = {
+	.name = "chacha20",
+	.ctxsize = sizeof ( struct chacha20_context ),
+	.blocksize = 1,
+	.setkey = chacha20_setkey,
+	.setiv = chacha20_setiv,
+	.encrypt = chacha20_crypt,
+	.decrypt = chacha20_crypt,
+};
+
+/** Zero padding for Poly1305 */
+static const uint8_t chacha20_poly1305_zero[POLY1305_BLOCKSIZE];
+
+/**
+ * Pad Poly1305 input to a block boundary
+ *
+ * @v ctx		ChaCha20-Poly1305 context
+ * @v len		Length of data processed so far
+ */
+static void chacha20_poly1305_pad ( struct chacha20_poly1305_context *ctx,
+				    uint64_t len ) {
+	size_t pad_len = ( ( -len ) & ( POLY1305_BLOCKSIZE - 1 ) );
+
+	poly1305_update ( &ctx->poly1305, chacha20_poly1305_zero, pad_len );
+}
+
+/**
+ * Set ChaCha20-Poly1305 key
+ *
+ * @v ctx		Context
+ * @v key		Key
+ * @v keylen		Key length
+ * @ret rc		Return status code
+ */
+static int chacha20_poly1305_setkey ( void *ctx, const void *key,
+				      size_t keylen ) {
+	struct chacha20_poly1305_context *aead = ctx;
+
+	return chacha20_key ( &aead->chacha20, key, keylen );
+}
+
+/**
+ * Set ChaCha20-Poly1305 initialisation vector
+ *
+ * @v ctx		Context
+ * @v iv		Nonce (of length CHACHA20_NONCE_LEN)
+ *
+ * This also derives the Poly1305 one-time key, and so must be called
+ * before processing each message.
+ */
+static void chacha20_poly1305_setiv ( void *ctx, const void *iv ) {
+	struct chacha20_poly1305_context *aead = ctx;
+	struct chacha20_context *chacha20 = &aead->chacha20;
+
+	/* Generate one-time key from block zero */
+	chacha20_nonce ( chacha20, 0, iv );
+	chacha20_block ( chacha20 );
+	poly1305_init ( &aead->poly1305, chacha20->stream.byte );
+
+	/* Discard remainder of block zero */
+	chacha20->offset = CHACHA20_BLOCKSIZE;
+	aead->aad_len = 0;
+	aead->data_len = 0;
+}
+
+/**
+ * Encrypt data using ChaCha20-Poly1305
+ *
+ * @v ctx		Context
+ * @v src		Data to encrypt
+ * @v dst		Buffer for encrypted data, or NULL for additional data
+ * @v len		Length of data
+ */
+static void chacha20_poly1305_encrypt ( void *ctx, const void *src,
+					void *dst, size_t len ) {
+	struct chacha20_poly1305_context *aead = ctx;
+
+	/* Process additional data, if applicable */
+	if ( ! dst ) {
+		poly1305_update ( &aead->poly1305, src, len );
+		aead->aad_len += len;
+		return;
+	}
+
+	/* Pad additional data before first encrypted data */
+	if ( len && ( aead->data_len == 0 ) )
+		chacha20_poly1305_pad ( aead, aead->aad_len );
+
+	/* Encrypt and authenticate ciphertext */
+	chacha20_xor ( &aead->chacha20, src, dst, len );
+	poly1305_update ( &aead->poly1305, dst, len );
+	aead->data_len += len;
+}
+
+/**
+ * Decrypt data using ChaCha20-Poly1305
+ *
+ * @v ctx		Context
+ * @v src		Data to decrypt
+ * @v dst		Buffer for decrypted data, or NULL for additional data
+ * @v len		Length of data
+ */
+static void chacha20_poly1305_decrypt ( void *ctx, const void *src,
+					void *dst, size_t len ) {
+	struct chacha20_poly1305_context *aead = ctx;
+
+	/* Process additional data, if applicable */
+	if ( ! dst ) {
+		poly1305_update ( &aead->poly1305, src, len );
+		aead->aad_len += len;
+		return;
+	}
+
+	/* Pad additional data before first encrypted data */
+	if ( len && ( aead->data_len == 0 ) )
+		chacha20_poly1305_pad ( aead, aead->aad_len );
+
+	/* Authenticate ciphertext (before it is overwritten, since
+	 * decryption may take place in situ) and decrypt.
+	 */
+	poly1305_update ( &aead->poly1305, src, len );
+	chacha20_xor ( &aead->chacha20, src, dst, len );
+	aead->data_len += len;
+}
+
+/**
+ * Generate ChaCha20-Poly1305 authentication tag
+ *
+ * @v ctx		Context
+ * @v auth		Authentication tag (of length POLY1305_MAC_LEN)
+ */
+static void chacha20_poly1305_auth ( void *ctx, void *auth ) {
+	struct chacha20_poly1305_context *aead = ctx;
+	uint64_t lengths[2];
+
+	/* Pad additional data (if not already padded) and ciphertext */
+	if ( ! aead->data_len )
+		chacha20_poly1305_pad ( aead, aead->aad_len );
+	chacha20_poly1305_pad ( aead, aead->data_len );
+
+	/* Authenticate lengths */
+	lengths[0] = cpu_to_le64 ( aead->aad_len );
+	lengths[1] = cpu_to_le64 ( aead->data_len );
+	poly1305_update ( &aead->poly1305, lengths, sizeof ( lengths ) );
+
+	/* Construct authentication tag */
+	poly1305_final ( &aead->poly1305, auth );
+}
+
+/** ChaCha20-Poly1305 authenticated cipher */
+struct cipher_algorithm chacha20_poly1305_algorithm = {
+	.name = "chacha20_poly1305",
+	.ctxsize = sizeof ( struct chacha20_poly1305_context ),
+	.blocksize = 1,
+	.authsize = POLY1305_MAC_LEN,
+	.setkey = chacha20_poly1305_setkey,
+	.setiv = chacha20_poly1305_setiv,
+	.encrypt = chacha20_poly1305_encrypt,
+	.decrypt = chacha20_poly1305_decrypt,
+	.auth = chacha20_poly1305_auth,
+};
@@ -574,12 +574,14 @@ static void cms_digest ( struct cms_signature *sig,
  * @v cert		Corresponding certificate
  * @v data		Signed data
  * @v len		Length of signed data
+ * @v precalc		Precalculated digest, or NULL
  * @ret rc		Return status code
  */
 static int cms_verify_digest ( struct cms_signature *sig,
 			       struct cms_signer_info *info,
 			       struct x509_certificate *cert,
-			       userptr_t data, size_t len ) {
+			       userptr_t data, size_t len,
+			       const struct cms_digest *precalc ) {
 	struct digest_algorithm *digest = info->digest;
 	struct pubkey_algorithm *pubkey = info->pubkey;
 	struct x509_public_key *public_key = &cert->subject.public_key;
@@ -587,8 +589,14 @@ static int cms_verify_digest ( struct cms_signature *sig,
 	uint8_t ctx[ pubkey->ctxsize ];
 	int rc;
 
-	/* Generate digest */
-	cms_digest ( sig, info, data, len, digest_out );
+	/* Use precalculated digest if available, otherwise generate */
+	if ( precalc && ( precalc->digest == digest ) ) {
+		DBGC ( sig, "CMS %p/%p using precalculated digest\n",
+		       sig, info );
+		memcpy ( digest_out, precalc->value, sizeof ( digest_out ) );
+	} else {
+		cms_digest ( sig, info, data, len, digest_out );
+	}
 
 	/* Initialise public-key algorithm */
 	if ( ( rc = pubkey_init ( pubkey, ctx, public_key->raw.data,
@@ -620,6 +628,7 @@ static int cms_verify_digest ( struct cms_signature *sig,
  * @v info		Signer information
  * @v data		Signed data
  * @v len		Length of signed data
+ * @v precalc		Precalculated digest, or NULL
  * @v time		Time at which to validate certificates
  * @v store		Certificate store, or NULL to use default
  * @v root		Root certificate list, or NULL to use default
@@ -628,6 +637,7 @@ static int cms_verify_digest ( struct cms_signature *sig,
 static int cms_verify_signer_info ( struct cms_signature *sig,
 				    struct cms_signer_info *info,
 				    userptr_t data, size_t len,
+				    const struct cms_digest *precalc,
 				    time_t time, struct x509_chain *store,
 				    struct x509_root *root ) {
 	struct x509_certificate *cert;
@@ -653,14 +663,15 @@ static int cms_verify_signer_info ( struct cms_signature *sig,
 	}
 
 	/* Check that certificate can sign code */
-	if ( ! ( cert->extensions.ext_usage.bits & X509_CODE_SIGNING ) ) {
+	if ( ! x509_has_ext_usage ( cert, X509_CODE_SIGNING ) ) {
 		DBGC ( sig, "CMS %p/%p certificate is not code-signing\n",
 		       sig, info );
 		return -EACCES_NON_CODE_SIGNING;
 	}
 
 	/* Verify digest */
-	if ( ( rc = cms_verify_digest ( sig, info, cert, data, len ) ) != 0 )
+	if ( ( rc = cms_verify_digest ( sig, info, cert, data, len,
+					precalc ) ) != 0 )
 		return rc;
 
 	return 0;
@@ -672,15 +683,21 @@ static int cms_verify_signer_info ( struct cms_signature *sig,
  * @v sig		CMS signature
  * @v data		Signed data
  * @v len		Length of signed data
+ * @v precalc		Precalculated digest of signed data, or NULL
  * @v name		Required common name, or NULL to check all signatures
  * @v time		Time at which to validate certificates
  * @v store		Certificate store, or NULL to use default
  * @v root		Root certificate list, or NULL to use default
  * @ret rc		Return status code
+ *
+ * If a precalculated digest is provided, it will be used in place of
+ * reading the signed data for any signer information using the same
+ * digest algorithm.
  */
-int cms_verify ( struct cms_signature *sig, userptr_t data, size_t len,
-		 const char *name, time_t time, struct x509_chain *store,
-		 struct x509_root *root ) {
+int cms_verify_digested ( struct cms_signature *sig, userptr_t data,
+			  size_t len, const struct cms_digest *precalc,
+			  const char *name, time_t time,
+			  struct x509_chain *store, struct x509_root *root ) {
 	struct cms_signer_info *info;
 	struct x509_certificate *cert;
 	int count = 0;
@@ -691,8 +708,9 @@ int cms_verify ( struct cms_signature *sig, userptr_t data, size_t len,
 		cert = x509_first ( info->chain );
 		if ( name && ( x509_check_name ( cert, name ) != 0 ) )
 			continue;
-		if ( ( rc = cms_verify_signer_info ( sig, info, data, len, time,
-						     store, root ) ) != 0 )
+		if ( ( rc = cms_verify_signer_info ( sig, info, data, len,
+						     precalc, time, store,
+						     root ) ) != 0 )
 			return rc;
 		count++;
 	}
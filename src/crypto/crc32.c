@@ -21,10 +21,125 @@
 
 FILE_LICENCE ( GPL2_OR_LATER );
 
+/** @file
+ *
+ * Little-endian CRC32 and CRC32C
+ *
+ * The generic implementation uses the "slice-by-8" algorithm, which
+ * consumes eight bytes per iteration using eight 256-entry lookup
+ * tables.  The tables are constructed on first use, to avoid
+ * increasing the size of the binary.  Architecture-specific code may
+ * provide hardware acceleration for some or all of the data.
+ *
+ */
+
+#include <stdint.h>
+#include <byteswap.h>
 #include <ipxe/crc32.h>
 
+/** CRC32 polynomial (bit-reversed) */
 #define CRCPOLY		0xedb88320
 
+/** CRC32C (Castagnoli) polynomial (bit-reversed) */
+#define CRC32C_POLY	0x82f63b78
+
+/** A set of slice-by-8 lookup tables */
+struct crc32_tables {
+	/** Lookup tables */
+	uint32_t table[8][256];
+	/** Tables have been constructed */
+	int ready;
+};
+
+/** CRC32 lookup tables */
+static struct crc32_tables crc32_tables;
+
+/** CRC32C lookup tables */
+static struct crc32_tables crc32c_tables;
+
+/**
+ * Construct slice-by-8 lookup tables
+ *
+ * @v tables		Lookup tables
+ * @v poly		Polynomial (bit-reversed)
+ */
+static void crc32_construct ( struct crc32_tables *tables, uint32_t poly ) {
+	uint32_t crc;
+	unsigned int i;
+	unsigned int j;
+
+	/* Construct byte-wise table */
+	for ( i = 0 ; i < 256 ; i++ ) {
+		crc = i;
+		for ( j = 0 ; j < 8 ; j++ )
+			crc = ( ( crc >> 1 ) ^ ( ( crc & 1 ) ? poly : 0 ) );
+		tables->table[0][i] = crc;
+	}
+
+	/* Construct tables for subsequent bytes */
+	for ( i = 0 ; i < 256 ; i++ ) {
+		crc = tables->table[0][i];
+		for ( j = 1 ; j < 8 ; j++ ) {
+			crc = ( ( crc >> 8 ) ^ tables->table[0][ crc & 0xff ] );
+			tables->table[j][i] = crc;
+		}
+	}
+
+	tables->ready = 1;
+}
+
+/**
+ * Calculate CRC using slice-by-8 lookup tables
+ *
+ * @v tables		Lookup tables
+ * @v poly		Polynomial (bit-reversed)
+ * @v crc		Initial value
+ * @v data		Data to checksum
+ * @v len		Length of data
+ * @ret crc		CRC
+ */
+static uint32_t crc32_slice8 ( struct crc32_tables *tables, uint32_t poly,
+			       uint32_t crc, const void *data, size_t len ) {
+	const uint32_t ( * table )[256] = tables->table;
+	const uint8_t *byte = data;
+	const uint32_t *dword;
+	uint32_t lo;
+	uint32_t hi;
+
+	/* Construct tables, if necessary */
+	if ( ! tables->ready )
+		crc32_construct ( tables, poly );
+
+	/* Process bytes until data is aligned */
+	while ( len && ( ( ( intptr_t ) byte ) & ( sizeof ( *dword ) - 1 ) ) ) {
+		crc = ( ( crc >> 8 ) ^ table[0][ ( crc ^ *(byte++) ) & 0xff ] );
+		len--;
+	}
+
+	/* Process eight bytes at a time */
+	dword = ( ( const void * ) byte );
+	while ( len >= 8 ) {
+		lo = ( le32_to_cpu ( *(dword++) ) ^ crc );
+		hi = le32_to_cpu ( *(dword++) );
+		crc = ( table[7][ lo & 0xff ] ^
+			table[6][ ( lo >> 8 ) & 0xff ] ^
+			table[5][ ( lo >> 16 ) & 0xff ] ^
+			table[4][ lo >> 24 ] ^
+			table[3][ hi & 0xff ] ^
+			table[2][ ( hi >> 8 ) & 0xff ] ^
+			table[1][ ( hi >> 16 ) & 0xff ] ^
+			table[0][ hi >> 24 ] );
+		len -= 8;
+	}
+
+	/* Process any remaining bytes */
+	byte = ( ( const void * ) dword );
+	while ( len-- )
+		crc = ( ( crc >> 8 ) ^ table[0][ ( crc ^ *(byte++) ) & 0xff ] );
+
+	return crc;
+}
+
 /**
  * Calculate 32-bit little-endian CRC checksum
  *
@@ -38,18 +153,37 @@ FILE_LICENCE ( GPL2_OR_LATER );
  */
 u32 crc32_le ( u32 seed, const void *data, size_t len )
 {
-	u32 crc = seed;
-	const u8 *src = data;
-	u32 mult;
-	int i;
-
-	while ( len-- ) {
-		crc ^= *src++;
-		for ( i = 0; i < 8; i++ ) {
-			mult = ( crc & 1 ) ? CRCPOLY : 0;
-			crc = ( crc >> 1 ) ^ mult;
-		}
-	}
+	uint32_t crc = seed;
+	size_t done;
 
-	return crc;
+	/* Use hardware acceleration for as much data as possible */
+	done = crc32_accel_le ( &crc, data, len );
+
+	/* Process remaining data */
+	return crc32_slice8 ( &crc32_tables, CRCPOLY, crc,
+			      ( data + done ), ( len - done ) );
+}
+
+/**
+ * Calculate 32-bit little-endian CRC32C (Castagnoli) checksum
+ *
+ * @v seed	Initial value
+ * @v data	Data to checksum
+ * @v len	Length of data
+ *
+ * As with crc32_le(), no inversion is applied to the seed or to the
+ * result.  Protocols such as iSCSI use an initial value of all one
+ * bits and invert the result.
+ */
+u32 crc32c_le ( u32 seed, const void *data, size_t len )
+{
+	uint32_t crc = seed;
+	size_t done;
+
+	/* Use hardware acceleration for as much data as possible */
+	done = crc32c_accel_le ( &crc, data, len );
+
+	/* Process remaining data */
+	return crc32_slice8 ( &crc32c_tables, CRC32C_POLY, crc,
+			      ( data + done ), ( len - done ) );
 }
@@ -28,6 +28,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <errno.h>
 #include <assert.h>
 #include <ctype.h>
+#include <byteswap.h>
 #include <ipxe/uaccess.h>
 #include <ipxe/deflate.h>
 
@@ -110,6 +111,23 @@ static const char * deflate_bin ( unsigned long value, unsigned int bits ) {
 	return buf;
 }
 
+/**
+ * Reverse bit order of a Huffman-coded value
+ *
+ * @v value		Value
+ * @v bits		Length of value (in bits)
+ * @ret reversed	Bit-reversed value
+ */
+static inline unsigned int deflate_reverse_bits ( unsigned int value,
+						  unsigned int bits ) {
+	unsigned int reversed;
+
+	/* Reverse as a 16-bit value and normalise */
+	reversed = ( ( deflate_reverse[ value & 0xff ] << 8 ) |
+		     deflate_reverse[ ( value >> 8 ) & 0xff ] );
+	return ( reversed >> ( 16 - bits ) );
+}
+
 /**
  * Set Huffman symbol length
  *
@@ -196,7 +214,9 @@ static void deflate_dump_alphabet ( struct deflate *deflate,
 		deflate_alphabet_name ( deflate, alphabet ) );
 	for ( i = 0 ; i < ( sizeof ( alphabet->lookup ) /
 			    sizeof ( alphabet->lookup[0] ) ) ; i++ ) {
-		DBGC2 ( alphabet, " %d", ( alphabet->lookup[i] + 1 ) );
+		DBGC2 ( alphabet, " %03x/%d",
+			( alphabet->lookup[i] >> DEFLATE_HUFFMAN_QL_RAW_SHIFT ),
+			( alphabet->lookup[i] & DEFLATE_HUFFMAN_QL_LEN_MASK ) );
 	}
 	DBGC2 ( alphabet, "\n" );
 }
@@ -220,6 +240,8 @@ static int deflate_alphabet ( struct deflate *deflate,
 	unsigned int raw;
 	unsigned int adjustment;
 	unsigned int prefix;
+	unsigned int entry;
+	unsigned int i;
 	int complete;
 
 	/* Clear symbol table */
@@ -267,6 +289,7 @@ static int deflate_alphabet ( struct deflate *deflate,
 	/* Adjust Huffman-coded symbol table raw pointers and populate
 	 * quick lookup table.
 	 */
+	memset ( alphabet->lookup, 0, sizeof ( alphabet->lookup ) );
 	for ( bits = 1 ; bits <= ( sizeof ( alphabet->huf ) /
 				   sizeof ( alphabet->huf[0] ) ) ; bits++ ) {
 		huf_sym = &alphabet->huf[ bits - 1 ];
@@ -276,10 +299,22 @@ static int deflate_alphabet ( struct deflate *deflate,
 		adjustment = ( huf_sym->start >> huf_sym->shift );
 		huf_sym->raw -= adjustment; /* Adjust for quick indexing */
 
-		/* Populate quick lookup table */
-		for ( prefix = ( huf_sym->start >> DEFLATE_HUFFMAN_QL_SHIFT ) ;
-		      prefix < ( 1 << DEFLATE_HUFFMAN_QL_BITS ) ; prefix++ ) {
-			alphabet->lookup[prefix] = ( bits - 1 );
+		/* Populate quick lookup table.  The input bits arrive
+		 * in bit-reversed order, and so each symbol occupies
+		 * every (1<<bits)'th entry starting from its
+		 * bit-reversed value.
+		 */
+		if ( bits > DEFLATE_HUFFMAN_QL_BITS )
+			continue;
+		for ( i = 0 ; i < huf_sym->freq ; i++ ) {
+			huf = ( adjustment + i );
+			entry = ( ( huf_sym->raw[huf] <<
+				    DEFLATE_HUFFMAN_QL_RAW_SHIFT ) | bits );
+			for ( prefix = deflate_reverse_bits ( huf, bits ) ;
+			      prefix < ( 1 << DEFLATE_HUFFMAN_QL_BITS ) ;
+			      prefix += ( 1 << bits ) ) {
+				alphabet->lookup[prefix] = entry;
+			}
 		}
 	}
 
@@ -320,9 +355,6 @@ static int deflate_accumulate ( struct deflate *deflate,
 				 sizeof ( byte ) );
 		deflate->accumulator = ( deflate->accumulator |
 					 ( byte << deflate->bits ) );
-		deflate->rotalumucca = ( deflate->rotalumucca |
-					 ( deflate_reverse[byte] <<
-					   ( 24 - deflate->bits ) ) );
 		deflate->bits += 8;
 
 		/* Sanity check */
@@ -349,7 +381,6 @@ static int deflate_consume ( struct deflate *deflate, unsigned int count ) {
 	/* Extract data and consume bits */
 	data = ( deflate->accumulator & ( ( 1 << count ) - 1 ) );
 	deflate->accumulator >>= count;
-	deflate->rotalumucca <<= count;
 	deflate->bits -= count;
 
 	return data;
@@ -385,6 +416,42 @@ static int deflate_extract ( struct deflate *deflate, struct deflate_chunk *in,
 	return data;
 }
 
+/**
+ * Look up a Huffman-coded symbol
+ *
+ * @v alphabet		Huffman alphabet
+ * @v accumulator	Accumulated input bits
+ * @ret entry		Quick lookup table entry
+ *
+ * Accumulated bits beyond the end of the input stream must be zero.
+ */
+static inline __attribute__ (( always_inline )) unsigned int
+deflate_lookup ( struct deflate_alphabet *alphabet,
+		 unsigned long accumulator ) {
+	struct deflate_huf_symbols *huf_sym;
+	unsigned int entry;
+	unsigned int huf;
+	unsigned int raw;
+
+	/* Use quick lookup table if possible */
+	entry = alphabet->lookup[ accumulator &
+				  ( ( 1 << DEFLATE_HUFFMAN_QL_BITS ) - 1 ) ];
+	if ( entry )
+		return entry;
+
+	/* Otherwise, normalise the bit-reversed accumulated value to
+	 * 16 bits and find the symbol set for this length.
+	 */
+	huf = deflate_reverse_bits ( accumulator, 16 );
+	huf_sym = &alphabet->huf[ DEFLATE_HUFFMAN_BITS - 1 ];
+	while ( huf < huf_sym->start )
+		huf_sym--;
+
+	/* Look up raw symbol */
+	raw = huf_sym->raw[ huf >> huf_sym->shift ];
+	return ( ( raw << DEFLATE_HUFFMAN_QL_RAW_SHIFT ) | huf_sym->bits );
+}
+
 /**
  * Attempt to decode a Huffman-coded symbol from input stream
  *
@@ -396,11 +463,10 @@ static int deflate_extract ( struct deflate *deflate, struct deflate_chunk *in,
 static int deflate_decode ( struct deflate *deflate,
 			    struct deflate_chunk *in,
 			    struct deflate_alphabet *alphabet ) {
-	struct deflate_huf_symbols *huf_sym;
-	uint16_t huf;
-	unsigned int lookup_index;
-	int excess;
+	unsigned int entry;
+	unsigned int bits;
 	unsigned int raw;
+	int excess;
 
 	/* Attempt to accumulate maximum required number of bits.
 	 * There may be fewer bits than this remaining in the stream,
@@ -409,28 +475,21 @@ static int deflate_decode ( struct deflate *deflate,
 	 */
 	deflate_accumulate ( deflate, in, DEFLATE_HUFFMAN_BITS );
 
-	/* Normalise the bit-reversed accumulated value to 16 bits */
-	huf = ( deflate->rotalumucca >> 16 );
-
-	/* Find symbol set for this length */
-	lookup_index = ( huf >> DEFLATE_HUFFMAN_QL_SHIFT );
-	huf_sym = &alphabet->huf[ alphabet->lookup[ lookup_index ] ];
-	while ( huf < huf_sym->start )
-		huf_sym--;
+	/* Look up symbol */
+	entry = deflate_lookup ( alphabet, deflate->accumulator );
+	bits = ( entry & DEFLATE_HUFFMAN_QL_LEN_MASK );
+	raw = ( entry >> DEFLATE_HUFFMAN_QL_RAW_SHIFT );
 
 	/* Calculate number of excess bits, and return if not yet complete */
-	excess = ( deflate->bits - huf_sym->bits );
+	excess = ( deflate->bits - bits );
 	if ( excess < 0 )
 		return excess;
 
 	/* Consume bits */
-	deflate_consume ( deflate, huf_sym->bits );
-
-	/* Look up raw symbol */
-	raw = huf_sym->raw[ huf >> huf_sym->shift ];
 	DBGCP ( deflate, "DEFLATE %p decoded %s = %#x = %d\n", deflate,
-		deflate_bin ( ( huf >> huf_sym->shift ), huf_sym->bits ),
-		raw, raw );
+		deflate_bin ( deflate_reverse_bits ( deflate->accumulator,
+						     bits ), bits ), raw, raw );
+	deflate_consume ( deflate, bits );
 
 	return raw;
 }
@@ -457,20 +516,190 @@ static void deflate_copy ( struct deflate_chunk *out,
 			   userptr_t start, size_t offset, size_t len ) {
 	size_t out_offset = out->offset;
 	size_t copy_len;
+	size_t frag_len;
 
-	/* Copy data one byte at a time, to allow for overlap */
+	/* Copy data in non-overlapping fragments */
 	if ( out_offset < out->len ) {
 		copy_len = ( out->len - out_offset );
 		if ( copy_len > len )
 			copy_len = len;
-		while ( copy_len-- ) {
-			memcpy_user ( out->data, out_offset++,
-				      start, offset++, 1 );
+		while ( copy_len ) {
+			frag_len = copy_len;
+			if ( ( start == out->data ) &&
+			     ( frag_len > ( out_offset - offset ) ) ) {
+				frag_len = ( out_offset - offset );
+			}
+			memcpy_user ( out->data, out_offset, start, offset,
+				      frag_len );
+			out_offset += frag_len;
+			offset += frag_len;
+			copy_len -= frag_len;
 		}
 	}
 	out->offset += len;
 }
 
+/**
+ * Decode Huffman-coded data using the fast path
+ *
+ * @v deflate		Decompressor
+ * @v in		Compressed input data
+ * @v out		Output data buffer
+ * @ret rc		Return status code, or positive at end of block
+ *
+ * The fast path decodes complete literal/length/distance sequences
+ * directly between the input and output buffers, for as long as
+ * there is sufficient input data and output space that no sequence
+ * can be blocked partway through.  The caller must fall back to the
+ * state machine for any remaining data.
+ */
+static int deflate_fast ( struct deflate *deflate, struct deflate_chunk *in,
+			  struct deflate_chunk *out ) {
+	const uint8_t *in_start;
+	const uint8_t *in_pos;
+	const uint8_t *in_limit;
+	uint8_t *out_start;
+	uint8_t *out_pos;
+	uint8_t *out_limit;
+	uint8_t *dup;
+	uint8_t *end;
+	uint64_t accumulator;
+	uint64_t word;
+	size_t dup_len;
+	size_t dup_distance;
+	size_t used;
+	unsigned int bits;
+	unsigned int entry;
+	unsigned int code;
+	unsigned int len;
+	int rc = 0;
+
+	/* Do nothing unless there is sufficient input and output space */
+	if ( ( ( in->len - in->offset ) < DEFLATE_FAST_IN_LEN ) ||
+	     ( out->offset >= out->len ) ||
+	     ( ( out->len - out->offset ) < DEFLATE_FAST_OUT_LEN ) ) {
+		return 0;
+	}
+	in_start = user_to_virt ( in->data, 0 );
+	in_pos = ( in_start + in->offset );
+	in_limit = ( in_start + in->len - DEFLATE_FAST_IN_LEN );
+	out_start = user_to_virt ( out->data, 0 );
+	out_pos = ( out_start + out->offset );
+	out_limit = ( out_start + out->len - DEFLATE_FAST_OUT_LEN );
+	accumulator = deflate->accumulator;
+	bits = deflate->bits;
+
+	/* Decode sequences */
+	while ( ( in_pos <= in_limit ) && ( out_pos <= out_limit ) ) {
+
+		/* Refill accumulator to at least 56 bits, which is
+		 * sufficient for a complete sequence.
+		 */
+		memcpy ( &word, in_pos, sizeof ( word ) );
+		accumulator |= ( le64_to_cpu ( word ) << bits );
+		len = ( ( 63 - bits ) / 8 );
+		in_pos += len;
+		bits += ( 8 * len );
+
+		/* Decode literal/length code */
+		entry = deflate_lookup ( &deflate->litlen, accumulator );
+		len = ( entry & DEFLATE_HUFFMAN_QL_LEN_MASK );
+		code = ( entry >> DEFLATE_HUFFMAN_QL_RAW_SHIFT );
+		accumulator >>= len;
+		bits -= len;
+
+		/* Handle literals and end of block */
+		if ( code < DEFLATE_LITLEN_END ) {
+			*(out_pos++) = code;
+			continue;
+		} else if ( code == DEFLATE_LITLEN_END ) {
+			rc = 1;
+			break;
+		}
+
+		/* Calculate duplicate length */
+		code -= ( DEFLATE_LITLEN_END + 1 );
+		if ( code < 28 ) {
+			len = ( code / 4 );
+			if ( len )
+				len--;
+			dup_len = ( deflate_litlen_base[code] +
+				    ( accumulator & ( ( 1 << len ) - 1 ) ) );
+			accumulator >>= len;
+			bits -= len;
+		} else {
+			dup_len = 258;
+		}
+
+		/* Decode distance code */
+		entry = deflate_lookup ( &deflate->distance_codelen,
+					 accumulator );
+		len = ( entry & DEFLATE_HUFFMAN_QL_LEN_MASK );
+		code = ( entry >> DEFLATE_HUFFMAN_QL_RAW_SHIFT );
+		accumulator >>= len;
+		bits -= len;
+
+		/* Calculate duplicate distance */
+		len = ( code / 2 );
+		if ( len )
+			len--;
+		dup_distance = ( deflate_distance_base[code] +
+				 ( accumulator & ( ( 1 << len ) - 1 ) ) );
+		accumulator >>= len;
+		bits -= len;
+
+		/* Sanity check */
+		if ( ( dup_distance == 0 ) ||
+		     ( dup_distance > ( size_t ) ( out_pos - out_start ) ) ) {
+			DBGC ( deflate, "DEFLATE %p bad distance %zd (max "
+			       "%zd)\n", deflate, dup_distance,
+			       ( out_pos - out_start ) );
+			rc = -EINVAL;
+			break;
+		}
+
+		/* Copy data, a word at a time where the distance
+		 * allows.  This may overrun the end of the duplicated
+		 * string by up to one word.
+		 */
+		dup = ( out_pos - dup_distance );
+		end = ( out_pos + dup_len );
+		if ( dup_distance >= sizeof ( word ) ) {
+			do {
+				memcpy ( &word, dup, sizeof ( word ) );
+				memcpy ( out_pos, &word, sizeof ( word ) );
+				dup += sizeof ( word );
+				out_pos += sizeof ( word );
+			} while ( out_pos < end );
+		} else {
+			do {
+				*(out_pos++) = *(dup++);
+			} while ( out_pos < end );
+		}
+		out_pos = end;
+	}
+
+	/* Return any unused whole bytes read by this call to the
+	 * input buffer, leaving no more bits than will fit in the
+	 * state machine's accumulator.
+	 */
+	used = ( in_pos - in_start - in->offset );
+	len = ( bits / 8 );
+	if ( len > used )
+		len = used;
+	in_pos -= len;
+	bits -= ( 8 * len );
+	assert ( bits <= ( 8 * sizeof ( deflate->accumulator ) ) );
+	deflate->accumulator = ( accumulator & ( ( 1ULL << bits ) - 1 ) );
+	deflate->bits = bits;
+
+	/* Update buffer offsets */
+	in->offset = ( in_pos - in_start );
+	out->offset = ( out_pos - out_start );
+
+	return rc;
+}
+
 /**
  * Inflate compressed data
  *
@@ -826,7 +1055,14 @@ int deflate_inflate ( struct deflate *deflate,
 		unsigned int extra;
 		unsigned int bits;
 
-		/* Decode Huffman codes */
+		/* Decode as much as possible using the fast path */
+		code = deflate_fast ( deflate, in, out );
+		if ( code < 0 )
+			return code;
+		if ( code > 0 )
+			goto block_done;
+
+		/* Decode any remaining Huffman codes */
 		while ( 1 ) {
 
 			/* Decode Huffman code */
@@ -927,7 +1163,7 @@ int deflate_inflate ( struct deflate *deflate,
 			"%zd\n", deflate, dup_len, dup_distance );
 
 		/* Sanity check */
-		if ( dup_distance > out->offset ) {
+		if ( ( dup_distance == 0 ) || ( dup_distance > out->offset ) ) {
 			DBGC ( deflate, "DEFLATE %p bad distance %zd (max "
 			       "%zd)\n", deflate, dup_distance, out->offset );
 			return -EINVAL;
@@ -990,6 +1226,34 @@ int deflate_inflate ( struct deflate *deflate,
 	}
 }
 
+/**
+ * Extract residual input data
+ *
+ * @v deflate		Decompressor
+ * @v data		Buffer to fill in
+ * @v len		Length of buffer
+ * @ret len		Length of residual data
+ *
+ * The decompressor may have accumulated input bytes beyond the end of
+ * the compressed data.  Once decompression has finished, this
+ * function may be used to discard the padding bits within the final
+ * byte of compressed data and retrieve any whole bytes that follow.
+ */
+size_t deflate_residue ( struct deflate *deflate, void *data, size_t len ) {
+	uint8_t *bytes = data;
+	size_t used = 0;
+
+	/* Sanity check */
+	assert ( deflate_finished ( deflate ) );
+
+	/* Discard padding and extract whole bytes */
+	deflate_discard_to_byte ( deflate );
+	while ( ( deflate->bits >= 8 ) && ( used < len ) )
+		bytes[used++] = deflate_consume ( deflate, 8 );
+
+	return used;
+}
+
 /**
  * Initialise decompressor
  *
@@ -0,0 +1,320 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * Elliptic curve digital signature algorithm (ECDSA)
+ *
+ * ECDSA is documented in FIPS 186-4, and its use within X.509
+ * certificates is documented in RFC 5480.  Only signature
+ * verification using the P-256 curve is supported.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <ipxe/asn1.h>
+#include <ipxe/crypto.h>
+#include <ipxe/p256.h>
+#include <ipxe/ecdsa.h>
+
+/* Disambiguate the various error causes */
+#define ENOTSUP_CURVE \
+	__einfo_error ( EINFO_ENOTSUP_CURVE )
+#define EINFO_ENOTSUP_CURVE \
+	__einfo_uniqify ( EINFO_ENOTSUP, 0x01, "Unsupported curve" )
+
+/** "id-ecPublicKey" object identifier */
+static uint8_t oid_ecpublickey[] = { ASN1_OID_ECPUBLICKEY };
+
+/** "id-ecPublicKey" OID-identified algorithm */
+struct asn1_algorithm ecpublickey_algorithm __asn1_algorithm = {
+	.name = "ecPublicKey",
+	.pubkey = &ecdsa_algorithm,
+	.digest = NULL,
+	.oid = ASN1_OID_CURSOR ( oid_ecpublickey ),
+};
+
+/** "prime256v1" object identifier */
+static uint8_t oid_prime256v1[] = { ASN1_OID_PRIME256V1 };
+
+/** "prime256v1" object identifier cursor */
+static struct asn1_cursor oid_prime256v1_cursor =
+	ASN1_OID_CURSOR ( oid_prime256v1 );
+
+/**
+ * Parse ECDSA integer
+ *
+ * @v raw		ASN.1 cursor
+ * @v value		Big-endian integer to fill in
+ * @ret rc		Return status code
+ */
+static int ecdsa_parse_integer ( const struct asn1_cursor *raw,
+				 uint8_t *value ) {
+	struct asn1_cursor integer;
+	int rc;
+
+	/* Enter integer */
+	memcpy ( &integer, raw, sizeof ( integer ) );
+	if ( ( rc = asn1_enter ( &integer, ASN1_INTEGER ) ) != 0 )
+		return rc;
+
+	/* Skip leading zero bytes */
+	while ( integer.len && ( *( ( uint8_t * ) integer.data ) == 0x00 ) ) {
+		integer.data++;
+		integer.len--;
+	}
+
+	/* Fail if integer is too long */
+	if ( integer.len > P256_SIZE )
+		return -ERANGE;
+
+	/* Construct zero-padded value */
+	memset ( value, 0, P256_SIZE );
+	memcpy ( ( value + P256_SIZE - integer.len ), integer.data,
+		 integer.len );
+
+	return 0;
+}
+
+/**
+ * Initialise ECDSA public key
+ *
+ * @v ctx		ECDSA context
+ * @v key		Key
+ * @v key_len		Length of key
+ * @ret rc		Return status code
+ */
+static int ecdsa_init ( void *ctx, const void *key, size_t key_len ) {
+	struct ecdsa_context *context = ctx;
+	struct asn1_bit_string bits;
+	struct asn1_cursor algorithm;
+	struct asn1_cursor cursor;
+	int rc;
+
+	/* Initialise context */
+	memset ( context, 0, sizeof ( *context ) );
+
+	/* Enter subjectPublicKeyInfo */
+	cursor.data = key;
+	cursor.len = key_len;
+	asn1_enter ( &cursor, ASN1_SEQUENCE );
+
+	/* Check named curve */
+	memcpy ( &algorithm, &cursor, sizeof ( algorithm ) );
+	asn1_enter ( &algorithm, ASN1_SEQUENCE );
+	asn1_skip ( &algorithm, ASN1_OID );
+	asn1_enter ( &algorithm, ASN1_OID );
+	if ( asn1_compare ( &algorithm, &oid_prime256v1_cursor ) != 0 ) {
+		DBGC ( context, "ECDSA %p unsupported curve:\n", context );
+		DBGC_HDA ( context, 0, algorithm.data, algorithm.len );
+		return -ENOTSUP_CURVE;
+	}
+	asn1_skip ( &cursor, ASN1_SEQUENCE );
+
+	/* Extract subjectPublicKey */
+	if ( ( rc = asn1_integral_bit_string ( &cursor, &bits ) ) != 0 ) {
+		DBGC ( context, "ECDSA %p invalid public key:\n", context );
+		DBGC_HDA ( context, 0, key, key_len );
+		return rc;
+	}
+	if ( bits.len != sizeof ( context->public ) ) {
+		DBGC ( context, "ECDSA %p invalid public key length:\n",
+		       context );
+		DBGC_HDA ( context, 0, bits.data, bits.len );
+		return -EINVAL;
+	}
+	memcpy ( context->public, bits.data, sizeof ( context->public ) );
+	DBGC ( context, "ECDSA %p public key:\n", context );
+	DBGC_HDA ( context, 0, context->public, sizeof ( context->public ) );
+
+	return 0;
+}
+
+/**
+ * Calculate ECDSA maximum output length
+ *
+ * @v ctx		ECDSA context
+ * @ret max_len		Maximum output length
+ */
+static size_t ecdsa_max_len ( void *ctx __unused ) {
+
+	return ECDSA_MAX_SIGNATURE_LEN;
+}
+
+/**
+ * Encrypt using ECDSA
+ *
+ * @v ctx		ECDSA context
+ * @v plaintext		Plaintext
+ * @v plaintext_len	Length of plaintext
+ * @v ciphertext	Ciphertext
+ * @ret ciphertext_len	Length of ciphertext, or negative error
+ */
+static int ecdsa_encrypt ( void *ctx __unused, const void *plaintext __unused,
+			   size_t plaintext_len __unused,
+			   void *ciphertext __unused ) {
+
+	/* ECDSA is a signature algorithm only */
+	return -ENOTSUP;
+}
+
+/**
+ * Decrypt using ECDSA
+ *
+ * @v ctx		ECDSA context
+ * @v ciphertext	Ciphertext
+ * @v ciphertext_len	Ciphertext length
+ * @v plaintext		Plaintext
+ * @ret plaintext_len	Plaintext length, or negative error
+ */
+static int ecdsa_decrypt ( void *ctx __unused, const void *ciphertext __unused,
+			   size_t ciphertext_len __unused,
+			   void *plaintext __unused ) {
+
+	/* ECDSA is a signature algorithm only */
+	return -ENOTSUP;
+}
+
+/**
+ * Sign digest value using ECDSA
+ *
+ * @v ctx		ECDSA context
+ * @v digest		Digest algorithm
+ * @v value		Digest value
+ * @v signature		Signature
+ * @ret signature_len	Signature length, or negative error
+ */
+static int ecdsa_sign ( void *ctx __unused,
+			struct digest_algorithm *digest __unused,
+			const void *value __unused,
+			void *signature __unused ) {
+
+	/* ECDSA private keys are not supported */
+	return -ENOTSUP;
+}
+
+/**
+ * Verify signed digest value using ECDSA
+ *
+ * @v ctx		ECDSA context
+ * @v digest		Digest algorithm
+ * @v value		Digest value
+ * @v signature		Signature
+ * @v signature_len	Signature length
+ * @ret rc		Return status code
+ */
+static int ecdsa_verify ( void *ctx, struct digest_algorithm *digest,
+			  const void *value, const void *signature,
+			  size_t signature_len ) {
+	struct ecdsa_context *context = ctx;
+	struct asn1_cursor cursor;
+	uint8_t hash[P256_SIZE];
+	uint8_t r[P256_SIZE];
+	uint8_t s[P256_SIZE];
+	size_t len;
+	int rc;
+
+	DBGC ( context, "ECDSA %p verifying %s digest:\n",
+	       context, digest->name );
+	DBGC_HDA ( context, 0, value, digest->digestsize );
+	DBGC_HDA ( context, 0, signature, signature_len );
+
+	/* Parse Ecdsa-Sig-Value */
+	cursor.data = signature;
+	cursor.len = signature_len;
+	if ( ( rc = asn1_enter ( &cursor, ASN1_SEQUENCE ) ) != 0 )
+		goto err_parse;
+	if ( ( rc = ecdsa_parse_integer ( &cursor, r ) ) != 0 )
+		goto err_parse;
+	asn1_skip_any ( &cursor );
+	if ( ( rc = ecdsa_parse_integer ( &cursor, s ) ) != 0 )
+		goto err_parse;
+
+	/* Use leftmost bits of digest value, zero-padding if needed */
+	len = digest->digestsize;
+	if ( len > sizeof ( hash ) )
+		len = sizeof ( hash );
+	memset ( hash, 0, sizeof ( hash ) );
+	memcpy ( ( hash + sizeof ( hash ) - len ), value, len );
+
+	/* Verify signature */
+	if ( ( rc = p256_verify ( context->public, hash, r, s ) ) != 0 ) {
+		DBGC ( context, "ECDSA %p signature verification failed: "
+		       "%s\n", context, strerror ( rc ) );
+		return rc;
+	}
+
+	DBGC ( context, "ECDSA %p signature verified successfully\n",
+	       context );
+	return 0;
+
+ err_parse:
+	DBGC ( context, "ECDSA %p invalid signature: %s\n",
+	       context, strerror ( rc ) );
+	return rc;
+}
+
+/**
+ * Finalise ECDSA
+ *
+ * @v ctx		ECDSA context
+ */
+static void ecdsa_final ( void *ctx __unused ) {
+
+	/* Nothing to do */
+}
+
+/**
+ * Check for matching ECDSA public/private key pair
+ *
+ * @v private_key	Private key
+ * @v private_key_len	Private key length
+ * @v public_key	Public key
+ * @v public_key_len	Public key length
+ * @ret rc		Return status code
+ */
+static int ecdsa_match ( const void *private_key __unused,
+			 size_t private_key_len __unused,
+			 const void *public_key __unused,
+			 size_t public_key_len __unused ) {
+
+	/* ECDSA private keys are not supported */
+	return -ENOTTY;
+}
+
+/** ECDSA public-key algorithm */
+struct pubkey_algorithm ecdsa_algorithm = {
+	.name		= "ecdsa",
+	.ctxsize	= ECDSA_CTX_SIZE,
+	.init		= ecdsa_init,
+	.max_len	= ecdsa_max_len,
+	.encrypt	= ecdsa_encrypt,
+	.decrypt	= ecdsa_decrypt,
+	.sign		= ecdsa_sign,
+	.verify		= ecdsa_verify,
+	.final		= ecdsa_final,
+	.match		= ecdsa_match,
+};
@@ -38,6 +38,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <errno.h>
 #include <ipxe/crypto.h>
 #include <ipxe/hash_df.h>
+#include <ipxe/profile.h>
 #include <ipxe/entropy.h>
 
 /* Disambiguate the various error causes */
@@ -50,6 +51,10 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #define EINFO_EPIPE_ADAPTIVE_PROPORTION_TEST \
 	__einfo_uniqify ( EINFO_EPIPE, 0x02, "Adaptive proportion test failed" )
 
+/** Entropy gathering profiler */
+static struct profiler entropy_profiler __profiler =
+	{ .name = "entropy.input" };
+
 /**
  * Calculate cutoff value for the repetition count test
  *
@@ -428,6 +433,7 @@ int get_entropy_input_tmp ( unsigned int num_samples, uint8_t *tmp,
 	int rc;
 
 	/* Enable entropy gathering */
+	profile_start ( &entropy_profiler );
 	if ( ( rc = entropy_enable() ) != 0 )
 		return rc;
 
@@ -475,6 +481,7 @@ int get_entropy_input_tmp ( unsigned int num_samples, uint8_t *tmp,
 
 	/* Disable entropy gathering */
 	entropy_disable();
+	profile_stop ( &entropy_profiler );
 
 	return 0;
 
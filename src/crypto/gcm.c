@@ -0,0 +1,404 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * Galois/Counter Mode (GCM)
+ *
+ * This implements GCM as described in NIST SP 800-38D.  GHASH uses
+ * the 4-bit table-driven multiplication method described by Shoup,
+ * requiring 256 bytes of precomputed table per key and processing
+ * four bits of each input block per table lookup.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <byteswap.h>
+#include <ipxe/crypto.h>
+#include <ipxe/gcm.h>
+
+/** Reduction constants for each 4-bit value shifted out of a product */
+static const uint16_t gcm_reduce[16] = {
+	0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+	0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0,
+};
+
+/**
+ * Construct hash key multiplication table
+ *
+ * @v table		Multiplication table to fill in
+ * @v key		Hash key (H)
+ */
+static void gcm_table ( struct gcm_table *table, const union gcm_block *key ) {
+	uint64_t hi = be64_to_cpu ( key->dword[0] );
+	uint64_t lo = be64_to_cpu ( key->dword[1] );
+	uint64_t carry;
+	unsigned int i;
+	unsigned int j;
+
+	/* Construct products for each single bit.  Bit ordering
+	 * within GCM is reflected, so the entry for the value 8 holds
+	 * the key itself and each lower power of two is obtained by
+	 * multiplying by x (i.e. shifting right, with reduction).
+	 */
+	table->hi[0] = 0;
+	table->lo[0] = 0;
+	table->hi[8] = hi;
+	table->lo[8] = lo;
+	for ( i = 4 ; i ; i >>= 1 ) {
+		carry = ( ( lo & 1 ) ? 0xe100000000000000ULL : 0 );
+		lo = ( ( hi << 63 ) | ( lo >> 1 ) );
+		hi = ( ( hi >> 1 ) ^ carry );
+		table->hi[i] = hi;
+		table->lo[i] = lo;
+	}
+
+	/* Construct remaining products by linearity */
+	for ( i = 2 ; i < 16 ; i <<= 1 ) {
+		for ( j = 1 ; j < i ; j++ ) {
+			table->hi[ i + j ] = ( table->hi[i] ^ table->hi[j] );
+			table->lo[ i + j ] = ( table->lo[i] ^ table->lo[j] );
+		}
+	}
+}
+
+/**
+ * Multiply accumulated hash by hash key
+ *
+ * @v gcm_ctx		GCM context
+ */
+static void gcm_multiply ( struct gcm_context *gcm_ctx ) {
+	const struct gcm_table *table = &gcm_ctx->key;
+	union gcm_block *hash = &gcm_ctx->hash;
+	uint64_t hi = 0;
+	uint64_t lo = 0;
+	unsigned int rem;
+	unsigned int nibble;
+	unsigned int byte;
+	int i;
+
+	/* Use hardware acceleration, if available */
+	if ( gcm_accel_multiply ( &gcm_ctx->hkey, hash ) )
+		return;
+
+	/* Process each 4-bit value, starting from the end of the block */
+	for ( i = ( GCM_BLOCKSIZE - 1 ) ; i >= 0 ; i-- ) {
+		byte = hash->byte[i];
+
+		/* Low nibble */
+		nibble = ( byte & 0x0f );
+		rem = ( lo & 0x0f );
+		lo = ( ( hi << 60 ) | ( lo >> 4 ) );
+		hi = ( ( hi >> 4 ) ^ ( ( ( uint64_t ) gcm_reduce[rem] ) << 48 ));
+		hi ^= table->hi[nibble];
+		lo ^= table->lo[nibble];
+
+		/* High nibble */
+		nibble = ( byte >> 4 );
+		rem = ( lo & 0x0f );
+		lo = ( ( hi << 60 ) | ( lo >> 4 ) );
+		hi = ( ( hi >> 4 ) ^ ( ( ( uint64_t ) gcm_reduce[rem] ) << 48 ));
+		hi ^= table->hi[nibble];
+		lo ^= table->lo[nibble];
+	}
+
+	/* Store result */
+	hash->dword[0] = cpu_to_be64 ( hi );
+	hash->dword[1] = cpu_to_be64 ( lo );
+}
+
+/**
+ * Complete any partial block of hashed data
+ *
+ * @v gcm_ctx		GCM context
+ * @v len		Total length of data hashed so far
+ *
+ * A partial block is implicitly padded with zeros, since the hash
+ * accumulator has already absorbed the data bytes that are present.
+ */
+static void gcm_flush ( struct gcm_context *gcm_ctx, uint64_t len ) {
+
+	if ( len % GCM_BLOCKSIZE )
+		gcm_multiply ( gcm_ctx );
+}
+
+/**
+ * Hash additional data
+ *
+ * @v gcm_ctx		GCM context
+ * @v data		Additional data
+ * @v len		Length of additional data
+ *
+ * All additional data must be provided before any data is encrypted
+ * or decrypted.
+ */
+static void gcm_additional ( struct gcm_context *gcm_ctx, const void *data,
+			     size_t len ) {
+	const uint8_t *bytes = data;
+	unsigned int offset;
+
+	while ( len-- ) {
+		offset = ( gcm_ctx->aad_len++ % GCM_BLOCKSIZE );
+		gcm_ctx->hash.byte[offset] ^= *(bytes++);
+		if ( offset == ( GCM_BLOCKSIZE - 1 ) )
+			gcm_multiply ( gcm_ctx );
+	}
+}
+
+/**
+ * Encrypt or decrypt a complete block
+ *
+ * @v ctx		Context
+ * @v src		Input block
+ * @v dst		Output block
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm_ctx		GCM context
+ * @v encrypting	Data is being encrypted
+ *
+ * The caller must ensure that the current position is aligned to a
+ * block boundary.
+ */
+static void gcm_block ( void *ctx, const void *src, void *dst,
+			struct cipher_algorithm *raw_cipher,
+			struct gcm_context *gcm_ctx, int encrypting ) {
+	union gcm_block *stream = &gcm_ctx->stream;
+	union gcm_block *hash = &gcm_ctx->hash;
+	union gcm_block in;
+	union gcm_block out;
+	uint32_t count;
+
+	/* Generate keystream block */
+	count = be32_to_cpu ( gcm_ctx->ctr.word[3] );
+	gcm_ctx->ctr.word[3] = cpu_to_be32 ( count + 1 );
+	cipher_encrypt ( raw_cipher, ctx, &gcm_ctx->ctr, stream,
+			 GCM_BLOCKSIZE );
+
+	/* Encrypt or decrypt block */
+	memcpy ( &in, src, sizeof ( in ) );
+	out.dword[0] = ( in.dword[0] ^ stream->dword[0] );
+	out.dword[1] = ( in.dword[1] ^ stream->dword[1] );
+	memcpy ( dst, &out, sizeof ( out ) );
+
+	/* Hash the ciphertext */
+	if ( encrypting ) {
+		hash->dword[0] ^= out.dword[0];
+		hash->dword[1] ^= out.dword[1];
+	} else {
+		hash->dword[0] ^= in.dword[0];
+		hash->dword[1] ^= in.dword[1];
+	}
+	gcm_multiply ( gcm_ctx );
+	gcm_ctx->data_len += GCM_BLOCKSIZE;
+}
+
+/**
+ * Encrypt or decrypt data
+ *
+ * @v ctx		Context
+ * @v src		Input data
+ * @v dst		Output data
+ * @v len		Length of data
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm_ctx		GCM context
+ * @v encrypting	Data is being encrypted
+ */
+static void gcm_crypt ( void *ctx, const void *src, void *dst, size_t len,
+			struct cipher_algorithm *raw_cipher,
+			struct gcm_context *gcm_ctx, int encrypting ) {
+	const uint8_t *in = src;
+	uint8_t *out = dst;
+	unsigned int offset;
+	uint8_t ciphertext;
+	uint8_t byte;
+	uint32_t count;
+
+	/* Complete any partial block of additional data */
+	if ( len && ( gcm_ctx->data_len == 0 ) )
+		gcm_flush ( gcm_ctx, gcm_ctx->aad_len );
+
+	/* Process complete blocks, where possible */
+	while ( ( len >= GCM_BLOCKSIZE ) &&
+		( ( gcm_ctx->data_len % GCM_BLOCKSIZE ) == 0 ) ) {
+		gcm_block ( ctx, in, out, raw_cipher, gcm_ctx, encrypting );
+		in += GCM_BLOCKSIZE;
+		out += GCM_BLOCKSIZE;
+		len -= GCM_BLOCKSIZE;
+	}
+
+	while ( len-- ) {
+
+		/* Generate next keystream block, if applicable */
+		offset = ( gcm_ctx->data_len++ % GCM_BLOCKSIZE );
+		if ( offset == 0 ) {
+			count = be32_to_cpu ( gcm_ctx->ctr.word[3] );
+			gcm_ctx->ctr.word[3] = cpu_to_be32 ( count + 1 );
+			cipher_encrypt ( raw_cipher, ctx, &gcm_ctx->ctr,
+					 &gcm_ctx->stream, GCM_BLOCKSIZE );
+		}
+
+		/* Encrypt or decrypt byte, and hash the ciphertext */
+		byte = *(in++);
+		ciphertext = ( encrypting ?
+			       ( byte ^ gcm_ctx->stream.byte[offset] ) : byte);
+		*(out++) = ( byte ^ gcm_ctx->stream.byte[offset] );
+		gcm_ctx->hash.byte[offset] ^= ciphertext;
+		if ( offset == ( GCM_BLOCKSIZE - 1 ) )
+			gcm_multiply ( gcm_ctx );
+	}
+}
+
+/**
+ * Set key
+ *
+ * @v ctx		Context
+ * @v key		Key
+ * @v keylen		Key length
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm_ctx		GCM context
+ * @ret rc		Return status code
+ */
+int gcm_setkey ( void *ctx, const void *key, size_t keylen,
+		 struct cipher_algorithm *raw_cipher,
+		 struct gcm_context *gcm_ctx ) {
+	union gcm_block hash_key;
+	int rc;
+
+	/* Set underlying cipher key */
+	if ( ( rc = cipher_setkey ( raw_cipher, ctx, key, keylen ) ) != 0 )
+		return rc;
+
+	/* Construct hash key multiplication table */
+	memset ( &hash_key, 0, sizeof ( hash_key ) );
+	cipher_encrypt ( raw_cipher, ctx, &hash_key, &hash_key,
+			 sizeof ( hash_key ) );
+	gcm_table ( &gcm_ctx->key, &hash_key );
+	memcpy ( &gcm_ctx->hkey, &hash_key, sizeof ( gcm_ctx->hkey ) );
+
+	return 0;
+}
+
+/**
+ * Set initialisation vector
+ *
+ * @v ctx		Context
+ * @v iv		Initialisation vector (of length GCM_IV_LEN)
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm_ctx		GCM context
+ *
+ * This also resets the accumulated hash, and so must be called
+ * before processing each message.
+ */
+void gcm_setiv ( void *ctx, const void *iv,
+		 struct cipher_algorithm *raw_cipher,
+		 struct gcm_context *gcm_ctx ) {
+
+	/* Reset hash */
+	memset ( &gcm_ctx->hash, 0, sizeof ( gcm_ctx->hash ) );
+	gcm_ctx->aad_len = 0;
+	gcm_ctx->data_len = 0;
+
+	/* Construct initial counter block */
+	memcpy ( &gcm_ctx->ctr, iv, GCM_IV_LEN );
+	gcm_ctx->ctr.word[3] = cpu_to_be32 ( 1 );
+
+	/* Construct authentication tag mask */
+	cipher_encrypt ( raw_cipher, ctx, &gcm_ctx->ctr, &gcm_ctx->mask,
+			 sizeof ( gcm_ctx->mask ) );
+}
+
+/**
+ * Encrypt data
+ *
+ * @v ctx		Context
+ * @v src		Data to encrypt
+ * @v dst		Buffer for encrypted data, or NULL for additional data
+ * @v len		Length of data
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm_ctx		GCM context
+ */
+void gcm_encrypt ( void *ctx, const void *src, void *dst, size_t len,
+		   struct cipher_algorithm *raw_cipher,
+		   struct gcm_context *gcm_ctx ) {
+
+	if ( dst ) {
+		gcm_crypt ( ctx, src, dst, len, raw_cipher, gcm_ctx, 1 );
+	} else {
+		gcm_additional ( gcm_ctx, src, len );
+	}
+}
+
+/**
+ * Decrypt data
+ *
+ * @v ctx		Context
+ * @v src		Data to decrypt
+ * @v dst		Buffer for decrypted data, or NULL for additional data
+ * @v len		Length of data
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm_ctx		GCM context
+ */
+void gcm_decrypt ( void *ctx, const void *src, void *dst, size_t len,
+		   struct cipher_algorithm *raw_cipher,
+		   struct gcm_context *gcm_ctx ) {
+
+	if ( dst ) {
+		gcm_crypt ( ctx, src, dst, len, raw_cipher, gcm_ctx, 0 );
+	} else {
+		gcm_additional ( gcm_ctx, src, len );
+	}
+}
+
+/**
+ * Generate authentication tag
+ *
+ * @v ctx		Context
+ * @v auth		Authentication tag (of length GCM_AUTH_LEN)
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm_ctx		GCM context
+ */
+void gcm_auth ( void *ctx __unused, void *auth,
+		struct cipher_algorithm *raw_cipher __unused,
+		struct gcm_context *gcm_ctx ) {
+	union gcm_block *tag = auth;
+	unsigned int i;
+
+	/* Complete any partial blocks */
+	if ( gcm_ctx->data_len ) {
+		gcm_flush ( gcm_ctx, gcm_ctx->data_len );
+	} else {
+		gcm_flush ( gcm_ctx, gcm_ctx->aad_len );
+	}
+
+	/* Hash lengths (in bits) */
+	gcm_ctx->hash.dword[0] ^= cpu_to_be64 ( gcm_ctx->aad_len * 8 );
+	gcm_ctx->hash.dword[1] ^= cpu_to_be64 ( gcm_ctx->data_len * 8 );
+	gcm_multiply ( gcm_ctx );
+
+	/* Construct authentication tag */
+	for ( i = 0 ; i < GCM_BLOCKSIZE ; i++ )
+		tag->byte[i] = ( gcm_ctx->hash.byte[i] ^
+				 gcm_ctx->mask.byte[i] );
+}
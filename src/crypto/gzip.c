@@ -0,0 +1,429 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <byteswap.h>
+#include <ipxe/uaccess.h>
+#include <ipxe/crc32.h>
+#include <ipxe/deflate.h>
+#include <ipxe/decompress.h>
+#include <ipxe/gzip.h>
+
+/** @file
+ *
+ * gzip decompression
+ *
+ * This file implements the gzip file format specified in RFC 1952,
+ * using the DEFLATE decompressor for the compressed data.  Multiple
+ * concatenated members are supported.
+ *
+ */
+
+/** Maximum DEFLATE expansion
+ *
+ * A 258-byte match may be encoded using as little as two bits, and
+ * so each byte of input may produce up to 1032 bytes of output.
+ */
+#define GZIP_EXPANSION ( 4 * 258 )
+
+/** Maximum output from input already held within the decompressor */
+#define GZIP_SLACK ( sizeof ( uint32_t ) * GZIP_EXPANSION )
+
+/**
+ * Accumulate header
+ *
+ * @v gzip		Decompressor
+ * @v in		Compressed input data
+ * @v len		Required header length
+ * @ret complete	Header is complete
+ */
+static int gzip_accumulate ( struct gzip *gzip, struct deflate_chunk *in,
+			     size_t len ) {
+	size_t frag;
+
+	/* Copy as much as possible of the header */
+	assert ( len <= sizeof ( gzip->buf ) );
+	assert ( gzip->buf_len <= len );
+	frag = ( len - gzip->buf_len );
+	if ( frag > ( in->len - in->offset ) )
+		frag = ( in->len - in->offset );
+	copy_from_user ( &gzip->buf.bytes[gzip->buf_len], in->data,
+			 in->offset, frag );
+	in->offset += frag;
+	gzip->buf_len += frag;
+
+	/* Check for completion */
+	if ( gzip->buf_len < len )
+		return 0;
+	gzip->buf_len = 0;
+	return 1;
+}
+
+/**
+ * Skip NUL-terminated header string
+ *
+ * @v in		Compressed input data
+ * @ret complete	String is complete
+ */
+static int gzip_skip_string ( struct deflate_chunk *in ) {
+	uint8_t byte;
+
+	while ( in->offset < in->len ) {
+		copy_from_user ( &byte, in->data, in->offset++,
+				 sizeof ( byte ) );
+		if ( ! byte )
+			return 1;
+	}
+	return 0;
+}
+
+/**
+ * Select next header state
+ *
+ * @v gzip		Decompressor
+ */
+static void gzip_next_header ( struct gzip *gzip ) {
+	unsigned int flags = gzip->flags;
+
+	if ( flags & GZIP_FEXTRA ) {
+		gzip->state = GZIP_STATE_EXTRA_LEN;
+	} else if ( flags & GZIP_FNAME ) {
+		gzip->state = GZIP_STATE_NAME;
+	} else if ( flags & GZIP_FCOMMENT ) {
+		gzip->state = GZIP_STATE_COMMENT;
+	} else if ( flags & GZIP_FHCRC ) {
+		gzip->state = GZIP_STATE_HCRC;
+	} else {
+		deflate_init ( &gzip->deflate, DEFLATE_RAW );
+		gzip->crc = 0;
+		gzip->len = 0;
+		gzip->state = GZIP_STATE_DATA;
+	}
+}
+
+/**
+ * Parse member header
+ *
+ * @v gzip		Decompressor
+ * @ret rc		Return status code
+ */
+static int gzip_header ( struct gzip *gzip ) {
+	struct gzip_header *header = &gzip->buf.header;
+
+	/* Validate header */
+	if ( header->magic != cpu_to_le16 ( GZIP_MAGIC ) ) {
+		DBGC ( gzip, "GZIP %p invalid magic %#04x\n",
+		       gzip, le16_to_cpu ( header->magic ) );
+		return -EINVAL;
+	}
+	if ( header->method != GZIP_METHOD_DEFLATE ) {
+		DBGC ( gzip, "GZIP %p unsupported method %d\n",
+		       gzip, header->method );
+		return -ENOTSUP;
+	}
+	if ( header->flags & GZIP_RESERVED ) {
+		DBGC ( gzip, "GZIP %p reserved flags %#02x\n",
+		       gzip, header->flags );
+		return -ENOTSUP;
+	}
+	gzip->flags = header->flags;
+	gzip->started = 1;
+	DBGC2 ( gzip, "GZIP %p member flags %#02x\n", gzip, gzip->flags );
+
+	return 0;
+}
+
+/**
+ * Decompress member data
+ *
+ * @v gzip		Decompressor
+ * @v in		Compressed input data
+ * @v out		Output data buffer
+ * @ret rc		Return status code
+ *
+ * The DEFLATE decompressor does not pause when the output buffer
+ * becomes full.  We therefore pass it only as much input as could
+ * possibly fit within the available output space.
+ */
+static int gzip_data ( struct gzip *gzip, struct deflate_chunk *in,
+		       struct deflate_chunk *out ) {
+	struct deflate_chunk slice;
+	size_t space;
+	size_t start;
+	size_t len;
+	size_t max;
+	int rc;
+
+	/* Calculate the largest slice of input that we can process */
+	space = ( out->len - out->offset );
+	if ( space < ( GZIP_SLACK + GZIP_EXPANSION ) )
+		return 0;
+	max = ( ( space - GZIP_SLACK ) / GZIP_EXPANSION );
+	len = ( in->len - in->offset );
+	if ( len > max )
+		len = max;
+	deflate_chunk_init ( &slice, in->data, in->offset,
+			     ( in->offset + len ) );
+
+	/* Decompress slice */
+	start = out->offset;
+	rc = deflate_inflate ( &gzip->deflate, &slice, out );
+	in->offset = slice.offset;
+	assert ( out->offset <= out->len );
+
+	/* Update CRC and length */
+	len = ( out->offset - start );
+	gzip->crc = ~crc32_le ( ~gzip->crc, user_to_virt ( out->data, start ),
+				len );
+	gzip->len += len;
+	if ( rc != 0 )
+		return rc;
+
+	/* Collect any residual data if decompression has finished */
+	if ( deflate_finished ( &gzip->deflate ) ) {
+		gzip->buf_len = deflate_residue ( &gzip->deflate,
+						  &gzip->buf.footer,
+						  sizeof ( gzip->buf.footer ) );
+		gzip->state = GZIP_STATE_FOOTER;
+	}
+
+	return 0;
+}
+
+/**
+ * Parse member footer
+ *
+ * @v gzip		Decompressor
+ * @ret rc		Return status code
+ */
+static int gzip_footer ( struct gzip *gzip ) {
+	struct gzip_footer *footer = &gzip->buf.footer;
+
+	/* Verify CRC and length */
+	if ( le32_to_cpu ( footer->crc ) != gzip->crc ) {
+		DBGC ( gzip, "GZIP %p CRC mismatch (got %08x, expected "
+		       "%08x)\n", gzip, gzip->crc,
+		       le32_to_cpu ( footer->crc ) );
+		return -EINVAL;
+	}
+	if ( le32_to_cpu ( footer->len ) != gzip->len ) {
+		DBGC ( gzip, "GZIP %p length mismatch (got %#08x, expected "
+		       "%#08x)\n", gzip, gzip->len,
+		       le32_to_cpu ( footer->len ) );
+		return -EINVAL;
+	}
+
+	/* Await next member */
+	gzip->state = GZIP_STATE_HEADER;
+	return 0;
+}
+
+/**
+ * Inflate compressed data
+ *
+ * @v gzip		Decompressor
+ * @v in		Compressed input data
+ * @v out		Output data buffer
+ * @ret rc		Return status code
+ *
+ * The caller can use gzip_finished() to determine whether a
+ * successful return indicates that the decompressor is merely waiting
+ * for more input data.
+ *
+ * Data will never be written beyond the end of the output buffer.
+ * The decompressor will return successfully (with input data
+ * remaining) if it requires more output space in order to continue.
+ * At least GZIP_HISTORY bytes of history must be retained before the
+ * current output offset.
+ */
+int gzip_inflate ( struct gzip *gzip, struct deflate_chunk *in,
+		   struct deflate_chunk *out ) {
+	size_t frag;
+	size_t offset;
+	int rc;
+
+	while ( 1 ) {
+		switch ( gzip->state ) {
+
+		case GZIP_STATE_HEADER:
+			if ( ! gzip_accumulate ( gzip, in,
+						 sizeof ( gzip->buf.header ) ) )
+				return 0;
+			if ( ( rc = gzip_header ( gzip ) ) != 0 )
+				return rc;
+			gzip_next_header ( gzip );
+			break;
+
+		case GZIP_STATE_EXTRA_LEN:
+			if ( ! gzip_accumulate ( gzip, in,
+						 sizeof ( uint16_t ) ) )
+				return 0;
+			gzip->remaining = le16_to_cpu ( gzip->buf.extra_len );
+			gzip->state = GZIP_STATE_EXTRA;
+			break;
+
+		case GZIP_STATE_EXTRA:
+			frag = ( in->len - in->offset );
+			if ( frag > gzip->remaining )
+				frag = gzip->remaining;
+			in->offset += frag;
+			gzip->remaining -= frag;
+			if ( gzip->remaining )
+				return 0;
+			gzip->flags &= ~GZIP_FEXTRA;
+			gzip_next_header ( gzip );
+			break;
+
+		case GZIP_STATE_NAME:
+			if ( ! gzip_skip_string ( in ) )
+				return 0;
+			gzip->flags &= ~GZIP_FNAME;
+			gzip_next_header ( gzip );
+			break;
+
+		case GZIP_STATE_COMMENT:
+			if ( ! gzip_skip_string ( in ) )
+				return 0;
+			gzip->flags &= ~GZIP_FCOMMENT;
+			gzip_next_header ( gzip );
+			break;
+
+		case GZIP_STATE_HCRC:
+			/* We do not bother to verify the header CRC */
+			if ( ! gzip_accumulate ( gzip, in,
+						 sizeof ( uint16_t ) ) )
+				return 0;
+			gzip->flags &= ~GZIP_FHCRC;
+			gzip_next_header ( gzip );
+			break;
+
+		case GZIP_STATE_DATA:
+			offset = out->offset;
+			frag = in->offset;
+			if ( ( rc = gzip_data ( gzip, in, out ) ) != 0 )
+				return rc;
+			if ( ( gzip->state == GZIP_STATE_DATA ) &&
+			     ( ( in->offset == in->len ) ||
+			       ( ( in->offset == frag ) &&
+				 ( out->offset == offset ) ) ) )
+				return 0;
+			break;
+
+		case GZIP_STATE_FOOTER:
+			if ( ! gzip_accumulate ( gzip, in,
+						 sizeof ( gzip->buf.footer ) ) )
+				return 0;
+			if ( ( rc = gzip_footer ( gzip ) ) != 0 )
+				return rc;
+			break;
+
+		default:
+			assert ( 0 );
+			return -EINVAL;
+		}
+	}
+}
+
+/**
+ * Initialise decompressor
+ *
+ * @v gzip		Decompressor
+ */
+void gzip_init ( struct gzip *gzip ) {
+
+	memset ( gzip, 0, sizeof ( *gzip ) );
+}
+
+/**
+ * Initialise gzip decompressor
+ *
+ * @v ctx		Context
+ * @ret rc		Return status code
+ */
+static int gzip_decompress_init ( void *ctx ) {
+
+	gzip_init ( ctx );
+	return 0;
+}
+
+/**
+ * Inflate gzip-compressed data
+ *
+ * @v ctx		Context
+ * @v in		Compressed input data
+ * @v out		Output data buffer
+ * @ret rc		Return status code
+ */
+static int gzip_decompress_inflate ( void *ctx, struct deflate_chunk *in,
+				     struct deflate_chunk *out ) {
+
+	return gzip_inflate ( ctx, in, out );
+}
+
+/**
+ * Check if gzip decompression has finished
+ *
+ * @v ctx		Context
+ * @ret finished	Decompression has finished
+ */
+static int gzip_decompress_finished ( void *ctx ) {
+
+	return gzip_finished ( ctx );
+}
+
+/**
+ * Get gzip history length
+ *
+ * @v ctx		Context
+ * @ret len		Length of output history that must be retained
+ */
+static size_t gzip_decompress_history ( void *ctx __unused ) {
+
+	return GZIP_HISTORY;
+}
+
+/**
+ * Finalise gzip decompressor
+ *
+ * @v ctx		Context
+ */
+static void gzip_decompress_fini ( void *ctx __unused ) {
+
+	/* Nothing to do */
+}
+
+/** gzip decompression algorithm */
+struct decompressor gzip_decompressor = {
+	.name = "gzip",
+	.ctxsize = sizeof ( struct gzip ),
+	.init = gzip_decompress_init,
+	.inflate = gzip_decompress_inflate,
+	.finished = gzip_decompress_finished,
+	.history = gzip_decompress_history,
+	.fini = gzip_decompress_fini,
+};
@@ -0,0 +1,351 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * gzip compression
+ *
+ * This file implements a simple single-pass gzip compressor (RFC
+ * 1951 and RFC 1952), intended for compressing data on the fly
+ * rather than for achieving the best possible compression ratio.
+ * Each input buffer is encoded as a single fixed-Huffman DEFLATE
+ * block, using greedy matching against earlier data within the same
+ * buffer.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <byteswap.h>
+#include <ipxe/crc32.h>
+#include <ipxe/gzipenc.h>
+
+/** Minimum match length */
+#define GZIPENC_MIN_MATCH 3
+
+/** Maximum match length */
+#define GZIPENC_MAX_MATCH 258
+
+/** Maximum distance for a minimum-length match
+ *
+ * A minimum-length match at a larger distance may be encoded using
+ * more bits than the equivalent literals.
+ */
+#define GZIPENC_MIN_MATCH_DISTANCE 4096
+
+/** DEFLATE end-of-block symbol */
+#define GZIPENC_END_OF_BLOCK 256
+
+/** DEFLATE fixed-Huffman block type */
+#define GZIPENC_FIXED 0x1
+
+/** gzip "unknown" operating system */
+#define GZIPENC_OS_UNKNOWN 0xff
+
+/** Length code base values */
+static const uint16_t gzipenc_length_base[] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+/** Length code extra bits */
+static const uint8_t gzipenc_length_extra[] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+/** Distance code base values */
+static const uint16_t gzipenc_distance_base[] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+	8193, 12289, 16385, 24577
+};
+
+/** A fixed-Huffman literal/length code */
+struct gzipenc_code {
+	/** Bit-reversed code */
+	uint16_t code;
+	/** Width in bits */
+	uint8_t width;
+};
+
+/** Fixed-Huffman literal/length codes */
+static struct gzipenc_code gzipenc_codes[288];
+
+/**
+ * Reverse bits
+ *
+ * @v value		Value
+ * @v width		Width in bits
+ * @ret reversed	Bit-reversed value
+ */
+static unsigned int gzipenc_reverse ( unsigned int value,
+				      unsigned int width ) {
+	unsigned int reversed = 0;
+
+	while ( width-- ) {
+		reversed = ( ( reversed << 1 ) | ( value & 1 ) );
+		value >>= 1;
+	}
+	return reversed;
+}
+
+/**
+ * Append bits to output
+ *
+ * @v enc		Compressor
+ * @v value		Value (least significant bit first)
+ * @v width		Width in bits
+ */
+static inline __attribute__ (( always_inline )) void
+gzipenc_bits ( struct gzip_encoder *enc, unsigned int value,
+	       unsigned int width ) {
+
+	enc->bits |= ( value << enc->bit_count );
+	enc->bit_count += width;
+	while ( enc->bit_count >= 8 ) {
+		*(enc->out++) = enc->bits;
+		enc->bits >>= 8;
+		enc->bit_count -= 8;
+	}
+}
+
+/**
+ * Append fixed-Huffman literal/length symbol to output
+ *
+ * @v enc		Compressor
+ * @v symbol		Literal/length symbol
+ */
+static inline __attribute__ (( always_inline )) void
+gzipenc_symbol ( struct gzip_encoder *enc, unsigned int symbol ) {
+
+	gzipenc_bits ( enc, gzipenc_codes[symbol].code,
+		       gzipenc_codes[symbol].width );
+}
+
+/**
+ * Append match to output
+ *
+ * @v enc		Compressor
+ * @v len		Match length
+ * @v distance		Match distance
+ */
+static void gzipenc_match ( struct gzip_encoder *enc, unsigned int len,
+			    unsigned int distance ) {
+	unsigned int code;
+	unsigned int extra;
+
+	/* Encode length */
+	for ( code = ( ( sizeof ( gzipenc_length_base ) /
+			 sizeof ( gzipenc_length_base[0] ) ) - 1 ) ;
+	      gzipenc_length_base[code] > len ; code-- ) {}
+	gzipenc_symbol ( enc, ( GZIPENC_END_OF_BLOCK + 1 + code ) );
+	extra = gzipenc_length_extra[code];
+	gzipenc_bits ( enc, ( len - gzipenc_length_base[code] ), extra );
+
+	/* Encode distance */
+	for ( code = ( ( sizeof ( gzipenc_distance_base ) /
+			 sizeof ( gzipenc_distance_base[0] ) ) - 1 ) ;
+	      gzipenc_distance_base[code] > distance ; code-- ) {}
+	gzipenc_bits ( enc, gzipenc_reverse ( code, 5 ), 5 );
+	extra = ( ( code < 2 ) ? 0 : ( ( code / 2 ) - 1 ) );
+	gzipenc_bits ( enc, ( distance - gzipenc_distance_base[code] ),
+		       extra );
+}
+
+/**
+ * Calculate hash of three bytes
+ *
+ * @v data		Data
+ * @ret hash		Hash table index
+ */
+static inline __attribute__ (( always_inline )) unsigned int
+gzipenc_hash ( const uint8_t *data ) {
+	uint32_t triplet;
+	uint32_t hash;
+
+	triplet = ( ( data[0] << 16 ) | ( data[1] << 8 ) | data[2] );
+	hash = ( triplet * 0x9e3779b1UL );
+	return ( hash >> ( 32 - GZIPENC_HASH_ORDER ) );
+}
+
+/**
+ * Initialise compressor
+ *
+ * @v enc		Compressor
+ */
+void gzip_encode_init ( struct gzip_encoder *enc ) {
+	struct gzipenc_code *code;
+	unsigned int symbol;
+	unsigned int value;
+
+	/* Construct fixed-Huffman codes, if not already done */
+	if ( ! gzipenc_codes[0].width ) {
+		for ( symbol = 0 ; symbol < ( sizeof ( gzipenc_codes ) /
+					      sizeof ( gzipenc_codes[0] ) ) ;
+		      symbol++ ) {
+			code = &gzipenc_codes[symbol];
+			if ( symbol < 144 ) {
+				value = ( 0x30 + symbol );
+				code->width = 8;
+			} else if ( symbol < 256 ) {
+				value = ( 0x190 + symbol - 144 );
+				code->width = 9;
+			} else if ( symbol < 280 ) {
+				value = ( symbol - 256 );
+				code->width = 7;
+			} else {
+				value = ( 0xc0 + symbol - 280 );
+				code->width = 8;
+			}
+			code->code = gzipenc_reverse ( value, code->width );
+		}
+	}
+
+	/* Initialise state */
+
+	enc->started = 0;
+	enc->crc = 0;
+	enc->len = 0;
+	enc->bits = 0;
+	enc->bit_count = 0;
+}
+
+/**
+ * Compress data
+ *
+ * @v enc		Compressor
+ * @v data		Uncompressed data
+ * @v len		Length of uncompressed data
+ * @v out		Output buffer
+ * @v final		This is the final portion of data
+ * @ret out_len		Length of compressed data
+ *
+ * The output buffer must be at least gzip_encode_max_len(len) bytes.
+ * Data is compressed independently of any previous portions, and so
+ * the caller should use reasonably large portions in order to obtain
+ * a useful compression ratio.
+ */
+size_t gzip_encode ( struct gzip_encoder *enc, const void *data,
+		     size_t len, void *out, int final ) {
+	const uint8_t *bytes = data;
+	struct gzip_header *header;
+	struct gzip_footer *footer;
+	const uint8_t *match;
+	unsigned int distance = 0;
+	unsigned int hash;
+	size_t match_len;
+	size_t max_len;
+	size_t pos = 0;
+	size_t i;
+
+	/* Start output */
+	enc->out = out;
+
+	/* Construct member header, if applicable */
+	if ( ! enc->started ) {
+		header = out;
+		memset ( header, 0, sizeof ( *header ) );
+		header->magic = cpu_to_le16 ( GZIP_MAGIC );
+		header->method = GZIP_METHOD_DEFLATE;
+		header->os = GZIPENC_OS_UNKNOWN;
+		enc->out += sizeof ( *header );
+		enc->started = 1;
+	}
+
+	/* Update CRC and length */
+	enc->crc = ~crc32_le ( ~enc->crc, data, len );
+	enc->len += len;
+
+	/* Start block, unless there is nothing to encode */
+	if ( ! ( len || final ) )
+		goto done;
+	gzipenc_bits ( enc, ( final ? 1 : 0 ), 1 );
+	gzipenc_bits ( enc, GZIPENC_FIXED, 2 );
+
+	/* Encode data using greedy matching */
+	memset ( enc->head, 0, sizeof ( enc->head ) );
+	while ( pos < len ) {
+
+		/* Find most recent candidate match, if any */
+		match_len = 0;
+		if ( ( pos + GZIPENC_MIN_MATCH ) <= len ) {
+			hash = gzipenc_hash ( &bytes[pos] );
+			if ( enc->head[hash] ) {
+				match = &bytes[ enc->head[hash] - 1 ];
+				distance = ( &bytes[pos] - match );
+				max_len = ( len - pos );
+				if ( max_len > GZIPENC_MAX_MATCH )
+					max_len = GZIPENC_MAX_MATCH;
+				while ( ( match_len < max_len ) &&
+					( match[match_len] ==
+					  bytes[ pos + match_len ] ) ) {
+					match_len++;
+				}
+				if ( ( distance > GZIP_HISTORY ) ||
+				     ( match_len < GZIPENC_MIN_MATCH ) ||
+				     ( ( match_len == GZIPENC_MIN_MATCH ) &&
+				       ( distance >
+					 GZIPENC_MIN_MATCH_DISTANCE ) ) ) {
+					match_len = 0;
+				}
+			}
+			enc->head[hash] = ( pos + 1 );
+		}
+
+		/* Encode match or literal */
+		if ( match_len ) {
+			gzipenc_match ( enc, match_len, distance );
+			for ( i = 1 ; i < match_len ; i++ ) {
+				if ( ( pos + i + GZIPENC_MIN_MATCH ) > len )
+					break;
+				hash = gzipenc_hash ( &bytes[ pos + i ] );
+				enc->head[hash] = ( pos + i + 1 );
+			}
+			pos += match_len;
+		} else {
+			gzipenc_symbol ( enc, bytes[pos] );
+			pos++;
+		}
+	}
+
+	/* End block */
+	gzipenc_symbol ( enc, GZIPENC_END_OF_BLOCK );
+
+	/* Construct member footer, if applicable */
+	if ( final ) {
+		if ( enc->bit_count )
+			gzipenc_bits ( enc, 0, ( 8 - enc->bit_count ) );
+		footer = ( ( void * ) enc->out );
+		footer->crc = cpu_to_le32 ( enc->crc );
+		footer->len = cpu_to_le32 ( enc->len );
+		enc->out += sizeof ( *footer );
+	}
+
+ done:
+	return ( enc->out - ( ( uint8_t * ) out ) );
+}
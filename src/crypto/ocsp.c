@@ -24,6 +24,8 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <ipxe/list.h>
+#include <ipxe/malloc.h>
 #include <ipxe/asn1.h>
 #include <ipxe/x509.h>
 #include <ipxe/sha1.h>
@@ -118,6 +120,165 @@ static const uint8_t oid_basic_response_type[] = { ASN1_OID_OCSP_BASIC };
 static struct asn1_cursor oid_basic_response_type_cursor =
 	ASN1_OID_CURSOR ( oid_basic_response_type );
 
+/** A cached OCSP response */
+struct ocsp_cached_response {
+	/** List of cached responses */
+	struct list_head list;
+	/** Raw issuer of certificate */
+	struct asn1_cursor issuer;
+	/** Raw serial number of certificate */
+	struct asn1_cursor serial;
+	/** Time at which newer status information will be available
+	 *
+	 * This is zero for a response that has not yet been validated
+	 * (e.g. a response that was stapled to a TLS handshake).
+	 */
+	time_t next_update;
+	/** Raw response */
+	struct asn1_cursor raw;
+};
+
+/** Cached OCSP responses
+ *
+ * Responses are identified by the certificate issuer and serial
+ * number, which (unlike the certificate ID used within the OCSP
+ * request) can be determined without reference to the issuing
+ * certificate.
+ */
+static LIST_HEAD ( ocsp_cache );
+
+/**
+ * Find cached OCSP response
+ *
+ * @v cert		Certificate
+ * @ret cached		Cached response, or NULL if not found
+ */
+static struct ocsp_cached_response *
+ocsp_cache_find ( struct x509_certificate *cert ) {
+	struct ocsp_cached_response *cached;
+
+	list_for_each_entry ( cached, &ocsp_cache, list ) {
+		if ( ( asn1_compare ( &cached->serial,
+				      &cert->serial.raw ) == 0 ) &&
+		     ( asn1_compare ( &cached->issuer,
+				      &cert->issuer.raw ) == 0 ) ) {
+			return cached;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Discard cached OCSP response
+ *
+ * @v cached		Cached response, or NULL
+ */
+static void ocsp_cache_del ( struct ocsp_cached_response *cached ) {
+
+	if ( cached ) {
+		list_del ( &cached->list );
+		free ( cached );
+	}
+}
+
+/**
+ * Add OCSP response to cache
+ *
+ * @v cert		Certificate
+ * @v data		Raw response
+ * @v len		Length of raw response
+ * @v next_update	Time at which newer status will be available, or zero
+ * @ret rc		Return status code
+ *
+ * Any existing cached response for the certificate will be replaced.
+ */
+static int ocsp_cache_add ( struct x509_certificate *cert, const void *data,
+			    size_t len, time_t next_update ) {
+	struct ocsp_cached_response *cached;
+	size_t issuer_len = cert->issuer.raw.len;
+	size_t serial_len = cert->serial.raw.len;
+	void *issuer;
+	void *serial;
+	void *raw;
+
+	/* Discard any existing cached response */
+	ocsp_cache_del ( ocsp_cache_find ( cert ) );
+
+	/* Allocate and populate cached response */
+	cached = malloc ( sizeof ( *cached ) + issuer_len + serial_len + len );
+	if ( ! cached )
+		return -ENOMEM;
+	issuer = ( ( ( void * ) cached ) + sizeof ( *cached ) );
+	serial = ( issuer + issuer_len );
+	raw = ( serial + serial_len );
+	memcpy ( issuer, cert->issuer.raw.data, issuer_len );
+	memcpy ( serial, cert->serial.raw.data, serial_len );
+	memcpy ( raw, data, len );
+	cached->issuer.data = issuer;
+	cached->issuer.len = issuer_len;
+	cached->serial.data = serial;
+	cached->serial.len = serial_len;
+	cached->raw.data = raw;
+	cached->raw.len = len;
+	cached->next_update = next_update;
+
+	/* Add to cache */
+	list_add ( &cached->list, &ocsp_cache );
+
+	return 0;
+}
+
+/**
+ * Record stapled OCSP response
+ *
+ * @v cert		Certificate
+ * @v data		Raw response
+ * @v len		Length of raw response
+ * @ret rc		Return status code
+ *
+ * The response will not be validated until an OCSP check is
+ * required for the certificate.
+ */
+int ocsp_staple ( struct x509_certificate *cert, const void *data,
+		  size_t len ) {
+	int rc;
+
+	/* Add unvalidated response to cache */
+	if ( ( rc = ocsp_cache_add ( cert, data, len, 0 ) ) != 0 ) {
+		DBGC ( cert, "OCSP %p \"%s\" could not record stapled "
+		       "response: %s\n", cert, x509_name ( cert ),
+		       strerror ( rc ) );
+		return rc;
+	}
+	DBGC2 ( cert, "OCSP %p \"%s\" recorded stapled response\n",
+		cert, x509_name ( cert ) );
+
+	return 0;
+}
+
+/**
+ * Discard a cached OCSP response
+ *
+ * @ret discarded	Number of cached items discarded
+ */
+static unsigned int ocsp_discard ( void ) {
+	struct ocsp_cached_response *cached;
+
+	/* Discard the oldest cached response */
+	list_for_each_entry_reverse ( cached, &ocsp_cache, list ) {
+		ocsp_cache_del ( cached );
+		return 1;
+	}
+
+	return 0;
+}
+
+/** OCSP response cache discarder */
+struct cache_discarder ocsp_discarder __cache_discarder ( CACHE_NORMAL ) = {
+	.name = "ocsp",
+	.discard = ocsp_discard,
+};
+
 /**
  * Free OCSP check
  *
@@ -273,6 +434,9 @@ static int ocsp_uri_string ( struct ocsp_check *ocsp ) {
  * @v issuer		Issuing certificate
  * @ret ocsp		OCSP check
  * @ret rc		Return status code
+ *
+ * The issuing certificate need not yet have been validated, but must
+ * be validated before the OCSP response can itself be validated.
  */
 int ocsp_check ( struct x509_certificate *cert,
 		 struct x509_certificate *issuer,
@@ -282,7 +446,10 @@ int ocsp_check ( struct x509_certificate *cert,
 	/* Sanity checks */
 	assert ( cert != NULL );
 	assert ( issuer != NULL );
-	assert ( x509_is_valid ( issuer ) );
+
+	/* Parse authority information access */
+	if ( ( rc = x509_parse_deferred ( cert ) ) != 0 )
+		goto err_deferred;
 
 	/* Allocate and initialise check */
 	*ocsp = zalloc ( sizeof ( **ocsp ) );
@@ -308,6 +475,7 @@ int ocsp_check ( struct x509_certificate *cert,
  err_request:
 	ocsp_put ( *ocsp );
  err_alloc:
+ err_deferred:
 	*ocsp = NULL;
 	return rc;
 }
@@ -790,10 +958,12 @@ int ocsp_response ( struct ocsp_check *ocsp, const void *data, size_t len ) {
 	x509_put ( response->signer );
 	response->signer = NULL;
 	free ( response->data );
+	response->len = 0;
 	response->data = malloc ( len );
 	if ( ! response->data )
 		return -ENOMEM;
 	memcpy ( response->data, data, len );
+	response->len = len;
 	cursor.data = response->data;
 	cursor.len = len;
 
@@ -910,8 +1080,7 @@ int ocsp_validate ( struct ocsp_check *ocsp, time_t time ) {
 		/* If signer is not the issuer, then it must have the
 		 * extendedKeyUsage id-kp-OCSPSigning.
 		 */
-		if ( ! ( signer->extensions.ext_usage.bits &
-			 X509_OCSP_SIGNING ) ) {
+		if ( ! x509_has_ext_usage ( signer, X509_OCSP_SIGNING ) ) {
 			DBGC ( ocsp, "OCSP %p \"%s\" ",
 			       ocsp, x509_name ( ocsp->cert ) );
 			DBGC ( ocsp, "signer \"%s\" is not an OCSP-signing "
@@ -954,5 +1123,83 @@ int ocsp_validate ( struct ocsp_check *ocsp, time_t time ) {
 	       ocsp, x509_name ( ocsp->cert ) );
 	DBGC ( ocsp, "using \"%s\"\n", x509_name ( signer ) );
 
+	/* Cache response for future use.  Failure to cache the
+	 * response is not an error.
+	 */
+	ocsp_cache_add ( ocsp->cert, response->data, response->len,
+			 response->next_update );
+
+	return 0;
+}
+
+/**
+ * Check for a usable cached (or stapled) OCSP response
+ *
+ * @v cert		Certificate
+ * @v time		Time at which response must be valid
+ * @ret is_cached	A cached response is available
+ */
+int ocsp_is_cached ( struct x509_certificate *cert, time_t time ) {
+	struct ocsp_cached_response *cached;
+
+	/* Find cached response */
+	cached = ocsp_cache_find ( cert );
+	if ( ! cached )
+		return 0;
+
+	/* Ignore response if known to be stale */
+	if ( cached->next_update &&
+	     ( cached->next_update < ( time - TIMESTAMP_ERROR_MARGIN ) ) )
+		return 0;
+
+	return 1;
+}
+
+/**
+ * Validate certificate using a cached (or stapled) OCSP response
+ *
+ * @v ocsp		OCSP check
+ * @v time		Time at which to validate response
+ * @ret rc		Return status code
+ *
+ * Any cached response that fails validation will be discarded.
+ */
+int ocsp_cached ( struct ocsp_check *ocsp, time_t time ) {
+	struct ocsp_cached_response *cached;
+	int rc;
+
+	/* Find cached response */
+	cached = ocsp_cache_find ( ocsp->cert );
+	if ( ! cached ) {
+		rc = -ENOENT;
+		goto err_find;
+	}
+
+	/* Discard response if known to be stale */
+	if ( cached->next_update &&
+	     ( cached->next_update < ( time - TIMESTAMP_ERROR_MARGIN ) ) ) {
+		DBGC ( ocsp, "OCSP %p \"%s\" cached response is stale\n",
+		       ocsp, x509_name ( ocsp->cert ) );
+		rc = -EACCES_STALE;
+		goto err_stale;
+	}
+
+	/* Record and validate response */
+	DBGC ( ocsp, "OCSP %p \"%s\" using %s response\n",
+	       ocsp, x509_name ( ocsp->cert ),
+	       ( cached->next_update ? "cached" : "stapled" ) );
+	if ( ( rc = ocsp_response ( ocsp, cached->raw.data,
+				    cached->raw.len ) ) != 0 )
+		goto err_response;
+	if ( ( rc = ocsp_validate ( ocsp, time ) ) != 0 )
+		goto err_validate;
+
 	return 0;
+
+ err_validate:
+ err_response:
+ err_stale:
+	ocsp_cache_del ( ocsp_cache_find ( ocsp->cert ) );
+ err_find:
+	return rc;
 }
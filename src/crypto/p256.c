@@ -0,0 +1,699 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * NIST P-256 elliptic curve
+ *
+ * The curve P-256 (also known as secp256r1 or prime256v1) is
+ * documented in FIPS 186-4.
+ *
+ * All arithmetic on secret values is performed in constant time:
+ * field operations use fixed-length Montgomery multiplication and
+ * masked conditional subtractions, and points are represented in
+ * projective coordinates using the complete addition formulae of
+ * Renes, Costello and Batina ("Complete addition formulas for prime
+ * order elliptic curves", 2016), which have no exceptional cases.
+ * Scalar multiplication uses a Montgomery ladder with constant-time
+ * conditional swaps.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <byteswap.h>
+#include <ipxe/crypto.h>
+#include <ipxe/p256.h>
+
+/* Disambiguate the various error causes */
+#define EINVAL_POINT \
+	__einfo_error ( EINFO_EINVAL_POINT )
+#define EINFO_EINVAL_POINT \
+	__einfo_uniqify ( EINFO_EINVAL, 0x01, "Invalid point" )
+#define EINVAL_INFINITY \
+	__einfo_error ( EINFO_EINVAL_INFINITY )
+#define EINFO_EINVAL_INFINITY \
+	__einfo_uniqify ( EINFO_EINVAL, 0x02, "Point at infinity" )
+#define EINVAL_SIGNATURE \
+	__einfo_error ( EINFO_EINVAL_SIGNATURE )
+#define EINFO_EINVAL_SIGNATURE \
+	__einfo_uniqify ( EINFO_EINVAL, 0x03, "Signature out of range" )
+#define EACCES_VERIFY \
+	__einfo_error ( EINFO_EACCES_VERIFY )
+#define EINFO_EACCES_VERIFY \
+	__einfo_uniqify ( EINFO_EACCES, 0x01, "ECDSA signature incorrect" )
+
+/** Field prime p = 2^256 - 2^224 + 2^192 + 2^96 - 1 */
+static const struct p256_modulus p256_p = {
+	.modulus = { 0xffffffff, 0xffffffff, 0xffffffff, 0x00000000,
+		     0x00000000, 0x00000000, 0x00000001, 0xffffffff },
+	.square = { 0x00000003, 0x00000000, 0xffffffff, 0xfffffffb,
+		    0xfffffffe, 0xffffffff, 0xfffffffd, 0x00000004 },
+	.inverse = 0x00000001,
+};
+
+/** Group order n */
+static const struct p256_modulus p256_n = {
+	.modulus = { 0xfc632551, 0xf3b9cac2, 0xa7179e84, 0xbce6faad,
+		     0xffffffff, 0xffffffff, 0x00000000, 0xffffffff },
+	.square = { 0xbe79eea2, 0x83244c95, 0x49bd6fa6, 0x4699799c,
+		    0x2b6bec59, 0x2845b239, 0xf3d95620, 0x66e12d94 },
+	.inverse = 0xee00bc4f,
+};
+
+/** Curve constant b (in Montgomery form) */
+static const uint32_t p256_b[P256_LIMBS] = {
+	0x29c4bddf, 0xd89cdf62, 0x78843090, 0xacf005cd,
+	0xf7212ed6, 0xe5a220ab, 0x04874834, 0xdc30061d
+};
+
+/** Generator base point */
+static const uint8_t p256_base[P256_POINT_SIZE] = {
+	P256_UNCOMPRESSED,
+	/* x */
+	0x6b, 0x17, 0xd1, 0xf2, 0xe1, 0x2c, 0x42, 0x47,
+	0xf8, 0xbc, 0xe6, 0xe5, 0x63, 0xa4, 0x40, 0xf2,
+	0x77, 0x03, 0x7d, 0x81, 0x2d, 0xeb, 0x33, 0xa0,
+	0xf4, 0xa1, 0x39, 0x45, 0xd8, 0x98, 0xc2, 0x96,
+	/* y */
+	0x4f, 0xe3, 0x42, 0xe2, 0xfe, 0x1a, 0x7f, 0x9b,
+	0x8e, 0xe7, 0xeb, 0x4a, 0x7c, 0x0f, 0x9e, 0x16,
+	0x2b, 0xce, 0x33, 0x57, 0x6b, 0x31, 0x5e, 0xce,
+	0xcb, 0xb6, 0x40, 0x68, 0x37, 0xbf, 0x51, 0xf5,
+};
+
+/** Integer value one (in normal form) */
+static const uint32_t p256_one[P256_LIMBS] = { 1 };
+
+/**
+ * Import integer from big-endian byte string
+ *
+ * @v data		Big-endian byte string
+ * @v value		Integer to fill in
+ */
+static void p256_import ( const uint8_t *data, uint32_t *value ) {
+	uint32_t word;
+	unsigned int i;
+
+	for ( i = 0 ; i < P256_LIMBS ; i++ ) {
+		memcpy ( &word, ( data + P256_SIZE - ( ( i + 1 ) *
+						       sizeof ( word ) ) ),
+			 sizeof ( word ) );
+		value[i] = be32_to_cpu ( word );
+	}
+}
+
+/**
+ * Export integer to big-endian byte string
+ *
+ * @v value		Integer
+ * @v data		Big-endian byte string to fill in
+ */
+static void p256_export ( const uint32_t *value, uint8_t *data ) {
+	uint32_t word;
+	unsigned int i;
+
+	for ( i = 0 ; i < P256_LIMBS ; i++ ) {
+		word = cpu_to_be32 ( value[i] );
+		memcpy ( ( data + P256_SIZE - ( ( i + 1 ) * sizeof ( word ) ) ),
+			 &word, sizeof ( word ) );
+	}
+}
+
+/**
+ * Add integers
+ *
+ * @v a			Addend
+ * @v b			Addend
+ * @v sum		Sum to fill in
+ * @ret carry		Carry out
+ */
+static uint32_t p256_add_raw ( const uint32_t *a, const uint32_t *b,
+			       uint32_t *sum ) {
+	uint64_t carry = 0;
+	unsigned int i;
+
+	for ( i = 0 ; i < P256_LIMBS ; i++ ) {
+		carry += ( ( ( uint64_t ) a[i] ) + b[i] );
+		sum[i] = carry;
+		carry >>= 32;
+	}
+	return carry;
+}
+
+/**
+ * Subtract integers
+ *
+ * @v a			Minuend
+ * @v b			Subtrahend
+ * @v diff		Difference to fill in
+ * @ret borrow		Borrow out
+ */
+static uint32_t p256_subtract_raw ( const uint32_t *a, const uint32_t *b,
+				    uint32_t *diff ) {
+	uint64_t borrow = 0;
+	unsigned int i;
+
+	for ( i = 0 ; i < P256_LIMBS ; i++ ) {
+		borrow = ( ( ( uint64_t ) a[i] ) - b[i] - borrow );
+		diff[i] = borrow;
+		borrow = ( ( borrow >> 32 ) & 1 );
+	}
+	return borrow;
+}
+
+/**
+ * Select integer (in constant time)
+ *
+ * @v mask		Selection mask (all ones to select a, zero to select b)
+ * @v a			Integer
+ * @v b			Integer
+ * @v result		Result to fill in
+ */
+static void p256_select ( uint32_t mask, const uint32_t *a,
+			  const uint32_t *b, uint32_t *result ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < P256_LIMBS ; i++ )
+		result[i] = ( ( a[i] & mask ) | ( b[i] & ~mask ) );
+}
+
+/**
+ * Check if integer is zero
+ *
+ * @v value		Integer
+ * @ret is_zero		Integer is zero
+ */
+static int p256_is_zero ( const uint32_t *value ) {
+	uint32_t accumulated = 0;
+	unsigned int i;
+
+	for ( i = 0 ; i < P256_LIMBS ; i++ )
+		accumulated |= value[i];
+	return ( accumulated == 0 );
+}
+
+/**
+ * Check if integer is fully reduced
+ *
+ * @v mod		Modulus
+ * @v value		Integer
+ * @ret is_reduced	Integer is less than the modulus
+ */
+static int p256_is_reduced ( const struct p256_modulus *mod,
+			     const uint32_t *value ) {
+	uint32_t tmp[P256_LIMBS];
+
+	return p256_subtract_raw ( value, mod->modulus, tmp );
+}
+
+/**
+ * Add integers modulo m
+ *
+ * @v mod		Modulus
+ * @v a			Addend (must be less than m)
+ * @v b			Addend (must be less than m)
+ * @v sum		Sum to fill in
+ */
+static void p256_add ( const struct p256_modulus *mod, const uint32_t *a,
+		       const uint32_t *b, uint32_t *sum ) {
+	uint32_t reduced[P256_LIMBS];
+	uint32_t carry;
+	uint32_t borrow;
+
+	carry = p256_add_raw ( a, b, sum );
+	borrow = p256_subtract_raw ( sum, mod->modulus, reduced );
+	p256_select ( -( carry | ( borrow ^ 1 ) ), reduced, sum, sum );
+}
+
+/**
+ * Subtract integers modulo m
+ *
+ * @v mod		Modulus
+ * @v a			Minuend (must be less than m)
+ * @v b			Subtrahend (must be less than m)
+ * @v diff		Difference to fill in
+ */
+static void p256_subtract ( const struct p256_modulus *mod, const uint32_t *a,
+			    const uint32_t *b, uint32_t *diff ) {
+	uint32_t corrected[P256_LIMBS];
+	uint32_t borrow;
+
+	borrow = p256_subtract_raw ( a, b, diff );
+	p256_add_raw ( diff, mod->modulus, corrected );
+	p256_select ( -borrow, corrected, diff, diff );
+}
+
+/**
+ * Multiply integers using Montgomery multiplication
+ *
+ * @v mod		Modulus
+ * @v a			Multiplicand (must be less than m)
+ * @v b			Multiplier (must be less than m)
+ * @v product		Product a*b/R (mod m) to fill in
+ *
+ * The product may safely overlap either input.
+ */
+static void p256_multiply ( const struct p256_modulus *mod, const uint32_t *a,
+			    const uint32_t *b, uint32_t *product ) {
+	uint32_t t[ P256_LIMBS + 2 ];
+	uint32_t reduced[P256_LIMBS];
+	uint32_t borrow;
+	uint32_t factor;
+	uint64_t carry;
+	unsigned int i;
+	unsigned int j;
+
+	/* Use coarsely integrated operand scanning */
+	memset ( t, 0, sizeof ( t ) );
+	for ( i = 0 ; i < P256_LIMBS ; i++ ) {
+
+		/* Accumulate a * b[i] */
+		carry = 0;
+		for ( j = 0 ; j < P256_LIMBS ; j++ ) {
+			carry += ( t[j] + ( ( ( uint64_t ) a[j] ) * b[i] ) );
+			t[j] = carry;
+			carry >>= 32;
+		}
+		carry += t[P256_LIMBS];
+		t[P256_LIMBS] = carry;
+		t[ P256_LIMBS + 1 ] = ( carry >> 32 );
+
+		/* Add a multiple of m to clear the lowest limb, and
+		 * shift down by one limb.
+		 */
+		factor = ( t[0] * mod->inverse );
+		carry = ( ( t[0] + ( ( ( uint64_t ) factor ) *
+				     mod->modulus[0] ) ) >> 32 );
+		for ( j = 1 ; j < P256_LIMBS ; j++ ) {
+			carry += ( t[j] + ( ( ( uint64_t ) factor ) *
+					    mod->modulus[j] ) );
+			t[ j - 1 ] = carry;
+			carry >>= 32;
+		}
+		carry += t[P256_LIMBS];
+		t[ P256_LIMBS - 1 ] = carry;
+		t[P256_LIMBS] = ( t[ P256_LIMBS + 1 ] + ( carry >> 32 ) );
+	}
+
+	/* Result is less than 2m: subtract m if applicable */
+	borrow = p256_subtract_raw ( t, mod->modulus, reduced );
+	p256_select ( -( t[P256_LIMBS] | ( borrow ^ 1 ) ), reduced, t,
+		      product );
+}
+
+/**
+ * Convert integer to Montgomery form
+ *
+ * @v mod		Modulus
+ * @v value		Integer (must be less than m)
+ * @v mont		Montgomery form to fill in
+ */
+static void p256_to_mont ( const struct p256_modulus *mod,
+			   const uint32_t *value, uint32_t *mont ) {
+
+	p256_multiply ( mod, value, mod->square, mont );
+}
+
+/**
+ * Convert integer from Montgomery form
+ *
+ * @v mod		Modulus
+ * @v mont		Montgomery form
+ * @v value		Integer to fill in
+ */
+static void p256_from_mont ( const struct p256_modulus *mod,
+			     const uint32_t *mont, uint32_t *value ) {
+
+	p256_multiply ( mod, mont, p256_one, value );
+}
+
+/**
+ * Invert integer modulo a prime
+ *
+ * @v mod		Prime modulus
+ * @v mont		Integer (in Montgomery form)
+ * @v inverse		Inverse (in Montgomery form) to fill in
+ *
+ * The inverse is calculated as x^(m-2) using a fixed sequence of
+ * squarings and multiplications determined only by the (public)
+ * modulus.
+ */
+static void p256_invert ( const struct p256_modulus *mod,
+			  const uint32_t *mont, uint32_t *inverse ) {
+	uint32_t exponent[P256_LIMBS];
+	uint32_t result[P256_LIMBS];
+	int i;
+
+	/* Construct exponent m-2 (neither modulus has a least
+	 * significant limb less than two, so no borrow is required).
+	 */
+	memcpy ( exponent, mod->modulus, sizeof ( exponent ) );
+	exponent[0] -= 2;
+
+	/* Calculate x^(m-2) */
+	p256_to_mont ( mod, p256_one, result );
+	for ( i = ( ( 8 * P256_SIZE ) - 1 ) ; i >= 0 ; i-- ) {
+		p256_multiply ( mod, result, result, result );
+		if ( exponent[ i / 32 ] & ( 1U << ( i % 32 ) ) )
+			p256_multiply ( mod, result, mont, result );
+	}
+	memcpy ( inverse, result, sizeof ( result ) );
+}
+
+/**
+ * Add points
+ *
+ * @v p1		Point
+ * @v p2		Point
+ * @v sum		Sum to fill in
+ *
+ * This is algorithm 4 from Renes, Costello and Batina, which is
+ * complete (i.e. valid for all inputs including doubling and the
+ * point at infinity).  The sum may safely overlap either input.
+ */
+static void p256_point_add ( const struct p256_point *p1,
+			     const struct p256_point *p2,
+			     struct p256_point *sum ) {
+	const struct p256_modulus *p = &p256_p;
+	uint32_t t0[P256_LIMBS];
+	uint32_t t1[P256_LIMBS];
+	uint32_t t2[P256_LIMBS];
+	uint32_t t3[P256_LIMBS];
+	uint32_t t4[P256_LIMBS];
+	uint32_t x3[P256_LIMBS];
+	uint32_t y3[P256_LIMBS];
+	uint32_t z3[P256_LIMBS];
+
+	p256_multiply ( p, p1->x, p2->x, t0 );
+	p256_multiply ( p, p1->y, p2->y, t1 );
+	p256_multiply ( p, p1->z, p2->z, t2 );
+	p256_add ( p, p1->x, p1->y, t3 );
+	p256_add ( p, p2->x, p2->y, t4 );
+	p256_multiply ( p, t3, t4, t3 );
+	p256_add ( p, t0, t1, t4 );
+	p256_subtract ( p, t3, t4, t3 );
+	p256_add ( p, p1->y, p1->z, t4 );
+	p256_add ( p, p2->y, p2->z, x3 );
+	p256_multiply ( p, t4, x3, t4 );
+	p256_add ( p, t1, t2, x3 );
+	p256_subtract ( p, t4, x3, t4 );
+	p256_add ( p, p1->x, p1->z, x3 );
+	p256_add ( p, p2->x, p2->z, y3 );
+	p256_multiply ( p, x3, y3, x3 );
+	p256_add ( p, t0, t2, y3 );
+	p256_subtract ( p, x3, y3, y3 );
+	p256_multiply ( p, p256_b, t2, z3 );
+	p256_subtract ( p, y3, z3, x3 );
+	p256_add ( p, x3, x3, z3 );
+	p256_add ( p, x3, z3, x3 );
+	p256_subtract ( p, t1, x3, z3 );
+	p256_add ( p, t1, x3, x3 );
+	p256_multiply ( p, p256_b, y3, y3 );
+	p256_add ( p, t2, t2, t1 );
+	p256_add ( p, t1, t2, t2 );
+	p256_subtract ( p, y3, t2, y3 );
+	p256_subtract ( p, y3, t0, y3 );
+	p256_add ( p, y3, y3, t1 );
+	p256_add ( p, t1, y3, y3 );
+	p256_add ( p, t0, t0, t1 );
+	p256_add ( p, t1, t0, t0 );
+	p256_subtract ( p, t0, t2, t0 );
+	p256_multiply ( p, t4, y3, t1 );
+	p256_multiply ( p, t0, y3, t2 );
+	p256_multiply ( p, x3, z3, y3 );
+	p256_add ( p, y3, t2, y3 );
+	p256_multiply ( p, x3, t3, x3 );
+	p256_subtract ( p, x3, t1, x3 );
+	p256_multiply ( p, z3, t4, z3 );
+	p256_multiply ( p, t3, t0, t1 );
+	p256_add ( p, z3, t1, z3 );
+
+	memcpy ( sum->x, x3, sizeof ( sum->x ) );
+	memcpy ( sum->y, y3, sizeof ( sum->y ) );
+	memcpy ( sum->z, z3, sizeof ( sum->z ) );
+}
+
+/**
+ * Conditionally swap points (in constant time)
+ *
+ * @v p1		Point
+ * @v p2		Point
+ * @v swap		Swap points (must be 0 or 1)
+ */
+static void p256_point_swap ( struct p256_point *p1, struct p256_point *p2,
+			      unsigned int swap ) {
+	uint32_t *a = ( ( uint32_t * ) p1 );
+	uint32_t *b = ( ( uint32_t * ) p2 );
+	uint32_t mask = -swap;
+	uint32_t diff;
+	unsigned int i;
+
+	for ( i = 0 ; i < ( sizeof ( *p1 ) / sizeof ( a[0] ) ) ; i++ ) {
+		diff = ( mask & ( a[i] ^ b[i] ) );
+		a[i] ^= diff;
+		b[i] ^= diff;
+	}
+}
+
+/**
+ * Multiply point by scalar
+ *
+ * @v base		Base point
+ * @v scalar		Scalar
+ * @v result		Result point to fill in
+ */
+static void p256_point_multiply ( const struct p256_point *base,
+				  const uint32_t *scalar,
+				  struct p256_point *result ) {
+	struct p256_point r0;
+	struct p256_point r1;
+	unsigned int bit;
+	int i;
+
+	/* Initialise ladder: r0 = infinity = (0:1:0), r1 = base */
+	memset ( &r0, 0, sizeof ( r0 ) );
+	p256_to_mont ( &p256_p, p256_one, r0.y );
+	memcpy ( &r1, base, sizeof ( r1 ) );
+
+	/* Perform Montgomery ladder */
+	for ( i = ( ( 8 * P256_SIZE ) - 1 ) ; i >= 0 ; i-- ) {
+		bit = ( ( scalar[ i / 32 ] >> ( i % 32 ) ) & 1 );
+		p256_point_swap ( &r0, &r1, bit );
+		p256_point_add ( &r0, &r1, &r1 );
+		p256_point_add ( &r0, &r0, &r0 );
+		p256_point_swap ( &r0, &r1, bit );
+	}
+
+	memcpy ( result, &r0, sizeof ( *result ) );
+}
+
+/**
+ * Import point from uncompressed form
+ *
+ * @v data		Uncompressed point
+ * @v point		Point to fill in
+ * @ret rc		Return status code
+ */
+static int p256_point_import ( const uint8_t *data,
+			       struct p256_point *point ) {
+	const struct p256_modulus *p = &p256_p;
+	uint32_t lhs[P256_LIMBS];
+	uint32_t rhs[P256_LIMBS];
+	uint32_t tmp[P256_LIMBS];
+
+	/* Check format */
+	if ( data[0] != P256_UNCOMPRESSED )
+		return -EINVAL_POINT;
+
+	/* Import coordinates */
+	p256_import ( ( data + 1 ), point->x );
+	p256_import ( ( data + 1 + P256_SIZE ), point->y );
+	if ( ! ( p256_is_reduced ( p, point->x ) &&
+		 p256_is_reduced ( p, point->y ) ) )
+		return -EINVAL_POINT;
+	p256_to_mont ( p, point->x, point->x );
+	p256_to_mont ( p, point->y, point->y );
+	p256_to_mont ( p, p256_one, point->z );
+
+	/* Check that point lies on the curve y^2 = x^3 - 3x + b */
+	p256_multiply ( p, point->y, point->y, lhs );
+	p256_multiply ( p, point->x, point->x, rhs );
+	p256_multiply ( p, rhs, point->x, rhs );
+	p256_add ( p, point->x, point->x, tmp );
+	p256_add ( p, tmp, point->x, tmp );
+	p256_subtract ( p, rhs, tmp, rhs );
+	p256_add ( p, rhs, p256_b, rhs );
+	if ( memcmp ( lhs, rhs, sizeof ( lhs ) ) != 0 )
+		return -EINVAL_POINT;
+
+	return 0;
+}
+
+/**
+ * Convert point to affine coordinates
+ *
+ * @v point		Point
+ * @v x			Affine x coordinate (in normal form) to fill in
+ * @v y			Affine y coordinate (in normal form) to fill in
+ * @ret rc		Return status code
+ */
+static int p256_point_affine ( const struct p256_point *point,
+			       uint32_t *x, uint32_t *y ) {
+	const struct p256_modulus *p = &p256_p;
+	uint32_t inverse[P256_LIMBS];
+
+	/* Reject point at infinity */
+	if ( p256_is_zero ( point->z ) )
+		return -EINVAL_INFINITY;
+
+	/* Calculate x = X/Z and y = Y/Z */
+	p256_invert ( p, point->z, inverse );
+	p256_multiply ( p, point->x, inverse, x );
+	p256_multiply ( p, point->y, inverse, y );
+	p256_from_mont ( p, x, x );
+	p256_from_mont ( p, y, y );
+
+	return 0;
+}
+
+/**
+ * Multiply scalar by curve point
+ *
+ * @v base		Base point (in uncompressed form)
+ * @v scalar		Scalar multiple (big-endian)
+ * @v result		Result point (in uncompressed form) to fill in
+ * @ret rc		Return status code
+ *
+ * The result may safely overlap either input.
+ */
+int p256_key ( const void *base, const void *scalar, void *result ) {
+	struct p256_point point;
+	uint32_t multiple[P256_LIMBS];
+	uint32_t x[P256_LIMBS];
+	uint32_t y[P256_LIMBS];
+	uint8_t *out = result;
+	int rc;
+
+	/* Import base point and scalar */
+	if ( ( rc = p256_point_import ( base, &point ) ) != 0 )
+		return rc;
+	p256_import ( scalar, multiple );
+
+	/* Calculate result */
+	p256_point_multiply ( &point, multiple, &point );
+	if ( ( rc = p256_point_affine ( &point, x, y ) ) != 0 )
+		return rc;
+
+	/* Export result */
+	out[0] = P256_UNCOMPRESSED;
+	p256_export ( x, ( out + 1 ) );
+	p256_export ( y, ( out + 1 + P256_SIZE ) );
+
+	return 0;
+}
+
+/**
+ * Verify ECDSA signature
+ *
+ * @v public		Public key point (in uncompressed form)
+ * @v hash		Message hash (big-endian, truncated to 256 bits)
+ * @v r			Signature value r (big-endian)
+ * @v s			Signature value s (big-endian)
+ * @ret rc		Return status code
+ *
+ * Signature verification operates only upon public values, and so
+ * does not need to be performed in constant time.
+ */
+int p256_verify ( const void *public, const void *hash,
+		  const void *r, const void *s ) {
+	const struct p256_modulus *n = &p256_n;
+	struct p256_point generator;
+	struct p256_point key;
+	uint32_t e[P256_LIMBS];
+	uint32_t rr[P256_LIMBS];
+	uint32_t ss[P256_LIMBS];
+	uint32_t w[P256_LIMBS];
+	uint32_t u1[P256_LIMBS];
+	uint32_t u2[P256_LIMBS];
+	uint32_t x[P256_LIMBS];
+	uint32_t y[P256_LIMBS];
+	uint32_t tmp[P256_LIMBS];
+	int rc;
+
+	/* Import points */
+	if ( ( rc = p256_point_import ( p256_base, &generator ) ) != 0 )
+		return rc;
+	if ( ( rc = p256_point_import ( public, &key ) ) != 0 )
+		return rc;
+
+	/* Import signature, and check that 0 < r,s < n */
+	p256_import ( r, rr );
+	p256_import ( s, ss );
+	if ( p256_is_zero ( rr ) || ( ! p256_is_reduced ( n, rr ) ) ||
+	     p256_is_zero ( ss ) || ( ! p256_is_reduced ( n, ss ) ) )
+		return -EINVAL_SIGNATURE;
+
+	/* Import hash, and reduce modulo n (at most one subtraction
+	 * is required since 2n > 2^256).
+	 */
+	p256_import ( hash, e );
+	if ( ! p256_subtract_raw ( e, n->modulus, tmp ) )
+		memcpy ( e, tmp, sizeof ( e ) );
+
+	/* Calculate w = s^-1, u1 = e*w, and u2 = r*w (mod n).  Since
+	 * w is held in Montgomery form, a single Montgomery
+	 * multiplication of a normal-form value by w produces a
+	 * normal-form result.
+	 */
+	p256_to_mont ( n, ss, w );
+	p256_invert ( n, w, w );
+	p256_multiply ( n, e, w, u1 );
+	p256_multiply ( n, rr, w, u2 );
+
+	/* Calculate u1*G + u2*Q */
+	p256_point_multiply ( &generator, u1, &generator );
+	p256_point_multiply ( &key, u2, &key );
+	p256_point_add ( &generator, &key, &key );
+	if ( ( rc = p256_point_affine ( &key, x, y ) ) != 0 )
+		return rc;
+
+	/* Verify that x = r (mod n) */
+	if ( ! p256_subtract_raw ( x, n->modulus, tmp ) )
+		memcpy ( x, tmp, sizeof ( x ) );
+	if ( memcmp ( x, rr, sizeof ( x ) ) != 0 )
+		return -EACCES_VERIFY;
+
+	return 0;
+}
+
+/** P-256 elliptic curve */
+struct elliptic_curve p256_curve = {
+	.name = "p256",
+	.pointsize = P256_POINT_SIZE,
+	.keysize = P256_SIZE,
+	.base = p256_base,
+	.multiply = p256_key,
+};
@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * Poly1305 message authentication code
+ *
+ * This implements Poly1305 as described in RFC 8439.  Arithmetic
+ * modulo 2^130-5 is performed using five 26-bit limbs, so that all
+ * partial products fit within 64-bit integers without requiring any
+ * 128-bit arithmetic support.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <byteswap.h>
+#include <ipxe/poly1305.h>
+
+/** Mask for a 26-bit limb */
+#define POLY1305_LIMB_MASK 0x3ffffff
+
+/**
+ * Load little-endian 32-bit value
+ *
+ * @v data		Data (may be unaligned)
+ * @ret value		Value
+ */
+static inline uint32_t poly1305_le32 ( const uint8_t *data ) {
+	uint32_t value;
+
+	memcpy ( &value, data, sizeof ( value ) );
+	return le32_to_cpu ( value );
+}
+
+/**
+ * Process block
+ *
+ * @v ctx		Poly1305 context
+ * @v data		Block
+ * @v hibit		High bit to add (2^128, or zero for a padded block)
+ */
+static void poly1305_block ( struct poly1305_context *ctx,
+			     const uint8_t *data, uint32_t hibit ) {
+	uint32_t r0 = ctx->r[0];
+	uint32_t r1 = ctx->r[1];
+	uint32_t r2 = ctx->r[2];
+	uint32_t r3 = ctx->r[3];
+	uint32_t r4 = ctx->r[4];
+	uint32_t s1 = ( r1 * 5 );
+	uint32_t s2 = ( r2 * 5 );
+	uint32_t s3 = ( r3 * 5 );
+	uint32_t s4 = ( r4 * 5 );
+	uint32_t h0 = ctx->h[0];
+	uint32_t h1 = ctx->h[1];
+	uint32_t h2 = ctx->h[2];
+	uint32_t h3 = ctx->h[3];
+	uint32_t h4 = ctx->h[4];
+	uint64_t d0;
+	uint64_t d1;
+	uint64_t d2;
+	uint64_t d3;
+	uint64_t d4;
+	uint32_t carry;
+
+	/* Add block to accumulator */
+	h0 += ( poly1305_le32 ( data + 0 ) & POLY1305_LIMB_MASK );
+	h1 += ( ( poly1305_le32 ( data + 3 ) >> 2 ) & POLY1305_LIMB_MASK );
+	h2 += ( ( poly1305_le32 ( data + 6 ) >> 4 ) & POLY1305_LIMB_MASK );
+	h3 += ( ( poly1305_le32 ( data + 9 ) >> 6 ) & POLY1305_LIMB_MASK );
+	h4 += ( ( poly1305_le32 ( data + 12 ) >> 8 ) | hibit );
+
+	/* Multiply accumulator by r (with partial reduction, using
+	 * 2^130 = 5 modulo 2^130-5).
+	 */
+	d0 = ( ( ( uint64_t ) h0 * r0 ) + ( ( uint64_t ) h1 * s4 ) +
+	       ( ( uint64_t ) h2 * s3 ) + ( ( uint64_t ) h3 * s2 ) +
+	       ( ( uint64_t ) h4 * s1 ) );
+	d1 = ( ( ( uint64_t ) h0 * r1 ) + ( ( uint64_t ) h1 * r0 ) +
+	       ( ( uint64_t ) h2 * s4 ) + ( ( uint64_t ) h3 * s3 ) +
+	       ( ( uint64_t ) h4 * s2 ) );
+	d2 = ( ( ( uint64_t ) h0 * r2 ) + ( ( uint64_t ) h1 * r1 ) +
+	       ( ( uint64_t ) h2 * r0 ) + ( ( uint64_t ) h3 * s4 ) +
+	       ( ( uint64_t ) h4 * s3 ) );
+	d3 = ( ( ( uint64_t ) h0 * r3 ) + ( ( uint64_t ) h1 * r2 ) +
+	       ( ( uint64_t ) h2 * r1 ) + ( ( uint64_t ) h3 * r0 ) +
+	       ( ( uint64_t ) h4 * s4 ) );
+	d4 = ( ( ( uint64_t ) h0 * r4 ) + ( ( uint64_t ) h1 * r3 ) +
+	       ( ( uint64_t ) h2 * r2 ) + ( ( uint64_t ) h3 * r1 ) +
+	       ( ( uint64_t ) h4 * r0 ) );
+
+	/* Propagate carries */
+	carry = ( d0 >> 26 );
+	h0 = ( d0 & POLY1305_LIMB_MASK );
+	d1 += carry;
+	carry = ( d1 >> 26 );
+	h1 = ( d1 & POLY1305_LIMB_MASK );
+	d2 += carry;
+	carry = ( d2 >> 26 );
+	h2 = ( d2 & POLY1305_LIMB_MASK );
+	d3 += carry;
+	carry = ( d3 >> 26 );
+	h3 = ( d3 & POLY1305_LIMB_MASK );
+	d4 += carry;
+	carry = ( d4 >> 26 );
+	h4 = ( d4 & POLY1305_LIMB_MASK );
+	h0 += ( carry * 5 );
+	carry = ( h0 >> 26 );
+	h0 &= POLY1305_LIMB_MASK;
+	h1 += carry;
+
+	/* Store accumulator */
+	ctx->h[0] = h0;
+	ctx->h[1] = h1;
+	ctx->h[2] = h2;
+	ctx->h[3] = h3;
+	ctx->h[4] = h4;
+}
+
+/**
+ * Initialise Poly1305 context
+ *
+ * @v ctx		Poly1305 context
+ * @v key		One-time key (of length POLY1305_KEY_LEN)
+ */
+void poly1305_init ( struct poly1305_context *ctx, const void *key ) {
+	const uint8_t *bytes = key;
+	unsigned int i;
+
+	/* Construct clamped multiplier */
+	ctx->r[0] = ( poly1305_le32 ( bytes + 0 ) & 0x3ffffff );
+	ctx->r[1] = ( ( poly1305_le32 ( bytes + 3 ) >> 2 ) & 0x3ffff03 );
+	ctx->r[2] = ( ( poly1305_le32 ( bytes + 6 ) >> 4 ) & 0x3ffc0ff );
+	ctx->r[3] = ( ( poly1305_le32 ( bytes + 9 ) >> 6 ) & 0x3f03fff );
+	ctx->r[4] = ( ( poly1305_le32 ( bytes + 12 ) >> 8 ) & 0x00fffff );
+
+	/* Record final addend */
+	for ( i = 0 ; i < 4 ; i++ )
+		ctx->pad[i] = poly1305_le32 ( bytes + 16 + ( 4 * i ) );
+
+	/* Reset accumulator */
+	memset ( ctx->h, 0, sizeof ( ctx->h ) );
+	ctx->len = 0;
+}
+
+/**
+ * Update Poly1305 with data
+ *
+ * @v ctx		Poly1305 context
+ * @v data		Data
+ * @v len		Length of data
+ */
+void poly1305_update ( struct poly1305_context *ctx, const void *data,
+		       size_t len ) {
+	const uint8_t *bytes = data;
+	size_t frag_len;
+
+	/* Complete any partial block */
+	if ( ctx->len ) {
+		frag_len = ( POLY1305_BLOCKSIZE - ctx->len );
+		if ( frag_len > len )
+			frag_len = len;
+		memcpy ( &ctx->buf[ctx->len], bytes, frag_len );
+		ctx->len += frag_len;
+		bytes += frag_len;
+		len -= frag_len;
+		if ( ctx->len < POLY1305_BLOCKSIZE )
+			return;
+		poly1305_block ( ctx, ctx->buf, ( 1 << 24 ) );
+		ctx->len = 0;
+	}
+
+	/* Process complete blocks directly from the input data */
+	while ( len >= POLY1305_BLOCKSIZE ) {
+		poly1305_block ( ctx, bytes, ( 1 << 24 ) );
+		bytes += POLY1305_BLOCKSIZE;
+		len -= POLY1305_BLOCKSIZE;
+	}
+
+	/* Store any remaining partial block */
+	memcpy ( ctx->buf, bytes, len );
+	ctx->len = len;
+}
+
+/**
+ * Finalise Poly1305
+ *
+ * @v ctx		Poly1305 context
+ * @v mac		MAC to fill in (of length POLY1305_MAC_LEN)
+ */
+void poly1305_final ( struct poly1305_context *ctx, void *mac ) {
+	uint32_t h0;
+	uint32_t h1;
+	uint32_t h2;
+	uint32_t h3;
+	uint32_t h4;
+	uint32_t g0;
+	uint32_t g1;
+	uint32_t g2;
+	uint32_t g3;
+	uint32_t g4;
+	uint32_t carry;
+	uint32_t mask;
+	uint64_t sum;
+	uint32_t out[4];
+
+	/* Process any final partial block, padded with a single one bit */
+	if ( ctx->len ) {
+		ctx->buf[ctx->len] = 1;
+		memset ( &ctx->buf[ ctx->len + 1 ], 0,
+			 ( POLY1305_BLOCKSIZE - ctx->len - 1 ) );
+		poly1305_block ( ctx, ctx->buf, 0 );
+	}
+
+	/* Fully propagate carries */
+	h0 = ctx->h[0];
+	h1 = ctx->h[1];
+	h2 = ctx->h[2];
+	h3 = ctx->h[3];
+	h4 = ctx->h[4];
+	carry = ( h1 >> 26 );
+	h1 &= POLY1305_LIMB_MASK;
+	h2 += carry;
+	carry = ( h2 >> 26 );
+	h2 &= POLY1305_LIMB_MASK;
+	h3 += carry;
+	carry = ( h3 >> 26 );
+	h3 &= POLY1305_LIMB_MASK;
+	h4 += carry;
+	carry = ( h4 >> 26 );
+	h4 &= POLY1305_LIMB_MASK;
+	h0 += ( carry * 5 );
+	carry = ( h0 >> 26 );
+	h0 &= POLY1305_LIMB_MASK;
+	h1 += carry;
+
+	/* Calculate h + -p = h - (2^130-5), in constant time */
+	g0 = ( h0 + 5 );
+	carry = ( g0 >> 26 );
+	g0 &= POLY1305_LIMB_MASK;
+	g1 = ( h1 + carry );
+	carry = ( g1 >> 26 );
+	g1 &= POLY1305_LIMB_MASK;
+	g2 = ( h2 + carry );
+	carry = ( g2 >> 26 );
+	g2 &= POLY1305_LIMB_MASK;
+	g3 = ( h3 + carry );
+	carry = ( g3 >> 26 );
+	g3 &= POLY1305_LIMB_MASK;
+	g4 = ( h4 + carry - ( 1 << 26 ) );
+
+	/* Select h if h < p, otherwise h - p */
+	mask = ( ( g4 >> 31 ) - 1 );
+	h0 = ( ( h0 & ~mask ) | ( g0 & mask ) );
+	h1 = ( ( h1 & ~mask ) | ( g1 & mask ) );
+	h2 = ( ( h2 & ~mask ) | ( g2 & mask ) );
+	h3 = ( ( h3 & ~mask ) | ( g3 & mask ) );
+	h4 = ( ( h4 & ~mask ) | ( g4 & mask ) );
+
+	/* Convert to 32-bit words and add final addend (mod 2^128) */
+	sum = ( ( uint64_t ) ( h0 | ( h1 << 26 ) ) + ctx->pad[0] );
+	out[0] = cpu_to_le32 ( sum );
+	sum = ( ( uint64_t ) ( ( h1 >> 6 ) | ( h2 << 20 ) ) + ctx->pad[1] +
+		( sum >> 32 ) );
+	out[1] = cpu_to_le32 ( sum );
+	sum = ( ( uint64_t ) ( ( h2 >> 12 ) | ( h3 << 14 ) ) + ctx->pad[2] +
+		( sum >> 32 ) );
+	out[2] = cpu_to_le32 ( sum );
+	sum = ( ( uint64_t ) ( ( h3 >> 18 ) | ( h4 << 8 ) ) + ctx->pad[3] +
+		( sum >> 32 ) );
+	out[3] = cpu_to_le32 ( sum );
+	memcpy ( mac, out, sizeof ( out ) );
+}
@@ -109,6 +109,7 @@ static void rootcert_init ( void ) {
 						      &external ) ) >= 0 ) {
 			root_certificates.fingerprints = external;
 			root_certificates.count = ( len / FINGERPRINT_LEN );
+			root_certificates.generation++;
 		}
 
 		/* Prevent subsequent modifications */
@@ -46,6 +46,10 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 	__einfo_error ( EINFO_EACCES_VERIFY )
 #define EINFO_EACCES_VERIFY \
 	__einfo_uniqify ( EINFO_EACCES, 0x01, "RSA signature incorrect" )
+#define EIO_BLIND \
+	__einfo_error ( EINFO_EIO_BLIND )
+#define EINFO_EIO_BLIND \
+	__einfo_uniqify ( EINFO_EIO, 0x01, "RSA blinding factor not invertible" )
 
 /** "rsaEncryption" object identifier */
 static uint8_t oid_rsa_encryption[] = { ASN1_OID_RSAENCRYPTION };
@@ -58,6 +62,24 @@ struct asn1_algorithm rsa_encryption_algorithm __asn1_algorithm = {
 	.oid = ASN1_OID_CURSOR ( oid_rsa_encryption ),
 };
 
+/** RSA private key Chinese Remainder Theorem parameters */
+struct rsa_crt_params {
+	/** Public exponent */
+	struct asn1_cursor public;
+	/** First prime factor */
+	struct asn1_cursor prime1;
+	/** Second prime factor */
+	struct asn1_cursor prime2;
+	/** First factor's CRT exponent */
+	struct asn1_cursor exponent1;
+	/** Second factor's CRT exponent */
+	struct asn1_cursor exponent2;
+	/** CRT coefficient */
+	struct asn1_cursor coefficient;
+	/** Maximum length of any prime factor parameter */
+	size_t len;
+};
+
 /**
  * Identify RSA prefix
  *
@@ -86,27 +108,97 @@ static void rsa_free ( struct rsa_context *context ) {
 	context->dynamic = NULL;
 }
 
+/**
+ * Calculate temporary working space required for CRT modular exponentiation
+ *
+ * @v size		Modulus size
+ * @v public_size	Public exponent size
+ * @v crt_size		Prime factor size
+ * @ret len		Length of temporary working space
+ */
+static size_t rsa_crt_exp_tmp_len ( unsigned int size,
+				    unsigned int public_size,
+				    unsigned int crt_size ) {
+	bigint_t ( size ) *modulus;
+	bigint_t ( public_size ) *public;
+	bigint_t ( crt_size ) *prime;
+	size_t blind_len = bigint_mod_exp_tmp_len ( modulus, public );
+	size_t crt_len = bigint_mod_exp_tmp_len ( prime, prime );
+
+	return ( ( blind_len > crt_len ) ? blind_len : crt_len );
+}
+
+/**
+ * Calculate temporary working space required for CRT private-key operation
+ *
+ * @v size		Modulus size
+ * @v public_size	Public exponent size
+ * @v crt_size		Prime factor size
+ * @ret len		Length of temporary working space
+ */
+static size_t rsa_crt_tmp_len ( unsigned int size, unsigned int public_size,
+				unsigned int crt_size ) {
+	size_t tmp_len = rsa_crt_exp_tmp_len ( size, public_size, crt_size );
+	struct {
+		bigint_t ( size ) random;
+		bigint_t ( size ) blind;
+		bigint_t ( size ) unblind;
+		bigint_t ( size ) one;
+		bigint_t ( size ) prime;
+		bigint_t ( size ) reduced;
+		bigint_t ( size + 1 ) modulus;
+		bigint_t ( size + 1 ) u;
+		bigint_t ( size + 1 ) v;
+		bigint_t ( size + 1 ) x1;
+		bigint_t ( size + 1 ) x2;
+		bigint_t ( crt_size ) residue;
+		bigint_t ( crt_size ) m1;
+		bigint_t ( crt_size ) m2;
+		bigint_t ( crt_size ) h;
+		bigint_t ( crt_size * 2 ) product;
+		bigint_t ( crt_size * 2 ) sum;
+		uint8_t tmp[tmp_len];
+	} __attribute__ (( packed )) *temp;
+
+	return sizeof ( *temp );
+}
+
 /**
  * Allocate RSA dynamic storage
  *
  * @v context		RSA context
  * @v modulus_len	Modulus length
  * @v exponent_len	Exponent length
+ * @v crt		CRT parameters, or NULL
  * @ret rc		Return status code
  */
 static int rsa_alloc ( struct rsa_context *context, size_t modulus_len,
-		       size_t exponent_len ) {
+		       size_t exponent_len,
+		       const struct rsa_crt_params *crt ) {
 	unsigned int size = bigint_required_size ( modulus_len );
 	unsigned int exponent_size = bigint_required_size ( exponent_len );
+	unsigned int public_size =
+		( crt ? bigint_required_size ( crt->public.len ) : 0 );
+	unsigned int crt_size =
+		( crt ? bigint_required_size ( crt->len ) : 0 );
 	bigint_t ( size ) *modulus;
 	bigint_t ( exponent_size ) *exponent;
 	size_t tmp_len = bigint_mod_exp_tmp_len ( modulus, exponent );
+	size_t crt_tmp_len =
+		( crt ? rsa_crt_tmp_len ( size, public_size, crt_size ) : 0 );
 	struct {
 		bigint_t ( size ) modulus;
 		bigint_t ( exponent_size ) exponent;
 		bigint_t ( size ) input;
 		bigint_t ( size ) output;
-		uint8_t tmp[tmp_len];
+		bigint_t ( public_size ) public;
+		bigint_t ( crt_size ) prime1;
+		bigint_t ( crt_size ) prime2;
+		bigint_t ( crt_size ) exponent1;
+		bigint_t ( crt_size ) exponent2;
+		bigint_t ( crt_size ) coefficient;
+		uint8_t tmp[ ( crt_tmp_len > tmp_len ) ?
+			     crt_tmp_len : tmp_len ];
 	} __attribute__ (( packed )) *dynamic;
 
 	/* Free any existing dynamic storage */
@@ -126,6 +218,14 @@ static int rsa_alloc ( struct rsa_context *context, size_t modulus_len,
 	context->exponent_size = exponent_size;
 	context->input0 = &dynamic->input.element[0];
 	context->output0 = &dynamic->output.element[0];
+	context->public0 = &dynamic->public.element[0];
+	context->public_size = public_size;
+	context->prime1_0 = &dynamic->prime1.element[0];
+	context->prime2_0 = &dynamic->prime2.element[0];
+	context->exponent1_0 = &dynamic->exponent1.element[0];
+	context->exponent2_0 = &dynamic->exponent2.element[0];
+	context->coefficient0 = &dynamic->coefficient.element[0];
+	context->crt_size = crt_size;
 	context->tmp = &dynamic->tmp;
 
 	return 0;
@@ -222,6 +322,60 @@ static int rsa_parse_mod_exp ( struct asn1_cursor *modulus,
 	return 0;
 }
 
+/**
+ * Parse RSA private key CRT parameters
+ *
+ * @v crt		CRT parameters to fill in
+ * @v raw		ASN.1 cursor
+ * @ret rc		Return status code
+ *
+ * Keys that do not carry usable CRT parameters (e.g. public keys)
+ * will fail to parse, and must be handled using the private exponent
+ * alone.
+ */
+static int rsa_parse_crt ( struct rsa_crt_params *crt,
+			   const struct asn1_cursor *raw ) {
+	struct asn1_cursor *params[] = {
+		&crt->prime1, &crt->prime2, &crt->exponent1,
+		&crt->exponent2, &crt->coefficient,
+	};
+	struct asn1_cursor cursor;
+	unsigned int i;
+	int rc;
+
+	/* Enter RSAPrivateKey */
+	memcpy ( &cursor, raw, sizeof ( cursor ) );
+	asn1_enter ( &cursor, ASN1_SEQUENCE );
+
+	/* Fail unless this is a private key */
+	if ( asn1_type ( &cursor ) != ASN1_INTEGER )
+		return -ENOTTY;
+
+	/* Skip version and modulus */
+	asn1_skip_any ( &cursor );
+	asn1_skip ( &cursor, ASN1_INTEGER );
+
+	/* Extract public exponent */
+	if ( ( rc = rsa_parse_integer ( &crt->public, &cursor ) ) != 0 )
+		return rc;
+	asn1_skip_any ( &cursor );
+
+	/* Skip private exponent */
+	asn1_skip ( &cursor, ASN1_INTEGER );
+
+	/* Extract prime factors, exponents, and coefficient */
+	crt->len = 0;
+	for ( i = 0 ; i < ( sizeof ( params ) / sizeof ( params[0] ) ) ; i++ ){
+		if ( ( rc = rsa_parse_integer ( params[i], &cursor ) ) != 0 )
+			return rc;
+		asn1_skip_any ( &cursor );
+		if ( crt->len < params[i]->len )
+			crt->len = params[i]->len;
+	}
+
+	return 0;
+}
+
 /**
  * Initialise RSA cipher
  *
@@ -232,6 +386,8 @@ static int rsa_parse_mod_exp ( struct asn1_cursor *modulus,
  */
 static int rsa_init ( void *ctx, const void *key, size_t key_len ) {
 	struct rsa_context *context = ctx;
+	struct rsa_crt_params params;
+	struct rsa_crt_params *crt = &params;
 	struct asn1_cursor modulus;
 	struct asn1_cursor exponent;
 	struct asn1_cursor cursor;
@@ -256,8 +412,20 @@ static int rsa_init ( void *ctx, const void *key, size_t key_len ) {
 	DBGC ( context, "RSA %p exponent:\n", context );
 	DBGC_HDA ( context, 0, exponent.data, exponent.len );
 
+	/* Use CRT parameters for private keys, if present and sane.
+	 * Products of the prime factors must fit within twice the
+	 * prime factor size.
+	 */
+	if ( ( rsa_parse_crt ( crt, &cursor ) != 0 ) ||
+	     ( ( 2 * crt->len ) < modulus.len ) ) {
+		crt = NULL;
+	}
+	DBGC ( context, "RSA %p %s CRT\n",
+	       context, ( crt ? "using" : "not using" ) );
+
 	/* Allocate dynamic storage */
-	if ( ( rc = rsa_alloc ( context, modulus.len, exponent.len ) ) != 0 )
+	if ( ( rc = rsa_alloc ( context, modulus.len, exponent.len,
+				crt ) ) != 0 )
 		goto err_alloc;
 
 	/* Construct big integers */
@@ -265,6 +433,26 @@ static int rsa_init ( void *ctx, const void *key, size_t key_len ) {
 		      modulus.data, modulus.len );
 	bigint_init ( ( ( bigint_t ( context->exponent_size ) * )
 			context->exponent0 ), exponent.data, exponent.len );
+	if ( crt ) {
+		bigint_init ( ( ( bigint_t ( context->public_size ) * )
+				context->public0 ),
+			      crt->public.data, crt->public.len );
+		bigint_init ( ( ( bigint_t ( context->crt_size ) * )
+				context->prime1_0 ),
+			      crt->prime1.data, crt->prime1.len );
+		bigint_init ( ( ( bigint_t ( context->crt_size ) * )
+				context->prime2_0 ),
+			      crt->prime2.data, crt->prime2.len );
+		bigint_init ( ( ( bigint_t ( context->crt_size ) * )
+				context->exponent1_0 ),
+			      crt->exponent1.data, crt->exponent1.len );
+		bigint_init ( ( ( bigint_t ( context->crt_size ) * )
+				context->exponent2_0 ),
+			      crt->exponent2.data, crt->exponent2.len );
+		bigint_init ( ( ( bigint_t ( context->crt_size ) * )
+				context->coefficient0 ),
+			      crt->coefficient.data, crt->coefficient.len );
+	}
 
 	return 0;
 
@@ -286,29 +474,192 @@ static size_t rsa_max_len ( void *ctx ) {
 	return context->max_len;
 }
 
+/**
+ * Perform RSA private-key operation using the Chinese Remainder Theorem
+ *
+ * @v context		RSA context
+ * @ret rc		Return status code
+ *
+ * The input buffer is exponentiated to form the output buffer, using
+ * the prime factors as per RFC 3447 section 5.1.2.  The input is
+ * first blinded using a random value r (as r^e), and the output is
+ * unblinded by multiplying by r^-1, so that the timing of the
+ * exponentiations is unrelated to the input.
+ */
+static int rsa_crt ( struct rsa_context *context ) {
+	unsigned int size = context->size;
+	unsigned int public_size = context->public_size;
+	unsigned int crt_size = context->crt_size;
+	bigint_t ( size ) *input = ( ( void * ) context->input0 );
+	bigint_t ( size ) *output = ( ( void * ) context->output0 );
+	bigint_t ( size ) *modulus = ( ( void * ) context->modulus0 );
+	bigint_t ( public_size ) *public = ( ( void * ) context->public0 );
+	bigint_t ( crt_size ) *prime1 = ( ( void * ) context->prime1_0 );
+	bigint_t ( crt_size ) *prime2 = ( ( void * ) context->prime2_0 );
+	bigint_t ( crt_size ) *exponent1 = ( ( void * ) context->exponent1_0 );
+	bigint_t ( crt_size ) *exponent2 = ( ( void * ) context->exponent2_0 );
+	bigint_t ( crt_size ) *coefficient =
+		( ( void * ) context->coefficient0 );
+	size_t tmp_len = rsa_crt_exp_tmp_len ( size, public_size, crt_size );
+	struct {
+		bigint_t ( size ) random;
+		bigint_t ( size ) blind;
+		bigint_t ( size ) unblind;
+		bigint_t ( size ) one;
+		bigint_t ( size ) prime;
+		bigint_t ( size ) reduced;
+		bigint_t ( size + 1 ) modulus;
+		bigint_t ( size + 1 ) u;
+		bigint_t ( size + 1 ) v;
+		bigint_t ( size + 1 ) x1;
+		bigint_t ( size + 1 ) x2;
+		bigint_t ( crt_size ) residue;
+		bigint_t ( crt_size ) m1;
+		bigint_t ( crt_size ) m2;
+		bigint_t ( crt_size ) h;
+		bigint_t ( crt_size * 2 ) product;
+		bigint_t ( crt_size * 2 ) sum;
+		uint8_t tmp[tmp_len];
+	} __attribute__ (( packed )) *temp = context->tmp;
+	static const uint8_t one[1] = { 0x01 };
+	uint8_t *random;
+	int rc;
+
+	/* Sanity check */
+	assert ( sizeof ( *temp ) ==
+		 rsa_crt_tmp_len ( size, public_size, crt_size ) );
+
+	/* Generate a nonzero random value r less than the modulus
+	 * (using the output buffer as temporary storage)
+	 */
+	random = ( ( void * ) output );
+	if ( ( rc = get_random_nz ( random, ( context->max_len - 1 ) ) ) != 0){
+		DBGC ( context, "RSA %p could not generate blinding factor: "
+		       "%s\n", context, strerror ( rc ) );
+		return rc;
+	}
+	bigint_init ( &temp->random, random, ( context->max_len - 1 ) );
+	bigint_init ( &temp->one, one, sizeof ( one ) );
+
+	/* Calculate r^-1 (mod n) using the binary extended Euclidean
+	 * algorithm, maintaining x1 * r = u and x2 * r = v (mod n).
+	 * Working values are one element wider than the modulus, so
+	 * that x + n cannot overflow.
+	 */
+	bigint_grow ( modulus, &temp->modulus );
+	bigint_grow ( &temp->random, &temp->u );
+	memcpy ( &temp->v, &temp->modulus, sizeof ( temp->v ) );
+	bigint_grow ( &temp->one, &temp->x1 );
+	memset ( &temp->x2, 0, sizeof ( temp->x2 ) );
+	while ( ! bigint_is_zero ( &temp->u ) ) {
+		while ( ! bigint_bit_is_set ( &temp->u, 0 ) ) {
+			bigint_ror ( &temp->u );
+			if ( bigint_bit_is_set ( &temp->x1, 0 ) )
+				bigint_add ( &temp->modulus, &temp->x1 );
+			bigint_ror ( &temp->x1 );
+		}
+		while ( ! bigint_bit_is_set ( &temp->v, 0 ) ) {
+			bigint_ror ( &temp->v );
+			if ( bigint_bit_is_set ( &temp->x2, 0 ) )
+				bigint_add ( &temp->modulus, &temp->x2 );
+			bigint_ror ( &temp->x2 );
+		}
+		if ( bigint_is_geq ( &temp->u, &temp->v ) ) {
+			bigint_subtract ( &temp->v, &temp->u );
+			if ( ! bigint_is_geq ( &temp->x1, &temp->x2 ) )
+				bigint_add ( &temp->modulus, &temp->x1 );
+			bigint_subtract ( &temp->x2, &temp->x1 );
+		} else {
+			bigint_subtract ( &temp->u, &temp->v );
+			if ( ! bigint_is_geq ( &temp->x2, &temp->x1 ) )
+				bigint_add ( &temp->modulus, &temp->x2 );
+			bigint_subtract ( &temp->x1, &temp->x2 );
+		}
+	}
+	if ( bigint_max_set_bit ( &temp->v ) != 1 ) {
+		DBGC ( context, "RSA %p blinding factor not invertible\n",
+		       context );
+		return -EIO_BLIND;
+	}
+	bigint_shrink ( &temp->x2, &temp->unblind );
+
+	/* Blind input as c * r^e (mod n) */
+	bigint_mod_exp ( &temp->random, modulus, public, &temp->blind,
+			 temp->tmp );
+	bigint_mod_multiply ( input, &temp->blind, modulus, input, temp->tmp );
+
+	/* Calculate m1 = c^dP (mod p) and m2 = c^dQ (mod q) */
+	bigint_grow ( prime1, &temp->prime );
+	bigint_mod_multiply ( input, &temp->one, &temp->prime, &temp->reduced,
+			      temp->tmp );
+	bigint_shrink ( &temp->reduced, &temp->residue );
+	bigint_mod_exp ( &temp->residue, prime1, exponent1, &temp->m1,
+			 temp->tmp );
+	bigint_grow ( prime2, &temp->prime );
+	bigint_mod_multiply ( input, &temp->one, &temp->prime, &temp->reduced,
+			      temp->tmp );
+	bigint_shrink ( &temp->reduced, &temp->residue );
+	bigint_mod_exp ( &temp->residue, prime2, exponent2, &temp->m2,
+			 temp->tmp );
+
+	/* Calculate h = qInv * ( m1 - m2 ) (mod p).  The subtraction
+	 * may wrap, but adding p first leaves the correct result.
+	 */
+	bigint_shrink ( &temp->one, &temp->h );
+	bigint_mod_multiply ( &temp->m2, &temp->h, prime1, &temp->residue,
+			      temp->tmp );
+	if ( ! bigint_is_geq ( &temp->m1, &temp->residue ) )
+		bigint_add ( prime1, &temp->m1 );
+	bigint_subtract ( &temp->residue, &temp->m1 );
+	bigint_mod_multiply ( &temp->m1, coefficient, prime1, &temp->h,
+			      temp->tmp );
+
+	/* Calculate m = m2 + q * h */
+	bigint_multiply ( &temp->h, prime2, &temp->product );
+	bigint_grow ( &temp->m2, &temp->sum );
+	bigint_add ( &temp->product, &temp->sum );
+	bigint_shrink ( &temp->sum, output );
+
+	/* Unblind output */
+	bigint_mod_multiply ( output, &temp->unblind, modulus, output,
+			      temp->tmp );
+
+	return 0;
+}
+
 /**
  * Perform RSA cipher operation
  *
  * @v context		RSA context
  * @v in		Input buffer
  * @v out		Output buffer
+ * @ret rc		Return status code
  */
-static void rsa_cipher ( struct rsa_context *context,
-			 const void *in, void *out ) {
+static int rsa_cipher ( struct rsa_context *context,
+			const void *in, void *out ) {
 	bigint_t ( context->size ) *input = ( ( void * ) context->input0 );
 	bigint_t ( context->size ) *output = ( ( void * ) context->output0 );
 	bigint_t ( context->size ) *modulus = ( ( void * ) context->modulus0 );
 	bigint_t ( context->exponent_size ) *exponent =
 		( ( void * ) context->exponent0 );
+	int rc;
 
 	/* Initialise big integer */
 	bigint_init ( input, in, context->max_len );
 
 	/* Perform modular exponentiation */
-	bigint_mod_exp ( input, modulus, exponent, output, context->tmp );
+	if ( context->crt_size ) {
+		if ( ( rc = rsa_crt ( context ) ) != 0 )
+			return rc;
+	} else {
+		bigint_mod_exp ( input, modulus, exponent, output,
+				 context->tmp );
+	}
 
 	/* Copy out result */
 	bigint_done ( output, out, context->max_len );
+
+	return 0;
 }
 
 /**
@@ -355,7 +706,8 @@ static int rsa_encrypt ( void *ctx, const void *plaintext,
 		 plaintext, plaintext_len );
 
 	/* Encipher the encoded message */
-	rsa_cipher ( context, encoded, ciphertext );
+	if ( ( rc = rsa_cipher ( context, encoded, ciphertext ) ) != 0 )
+		return rc;
 	DBGC ( context, "RSA %p encrypted:\n", context );
 	DBGC_HDA ( context, 0, ciphertext, context->max_len );
 
@@ -380,6 +732,7 @@ static int rsa_decrypt ( void *ctx, const void *ciphertext,
 	uint8_t *zero;
 	uint8_t *start;
 	size_t plaintext_len;
+	int rc;
 
 	/* Sanity check */
 	if ( ciphertext_len != context->max_len ) {
@@ -396,7 +749,8 @@ static int rsa_decrypt ( void *ctx, const void *ciphertext,
 	 */
 	temp = context->input0;
 	encoded = temp;
-	rsa_cipher ( context, ciphertext, encoded );
+	if ( ( rc = rsa_cipher ( context, ciphertext, encoded ) ) != 0 )
+		return rc;
 
 	/* Parse the message */
 	end = ( encoded + context->max_len );
@@ -505,7 +859,8 @@ static int rsa_sign ( void *ctx, struct digest_algorithm *digest,
 		return rc;
 
 	/* Encipher the encoded digest */
-	rsa_cipher ( context, temp, signature );
+	if ( ( rc = rsa_cipher ( context, temp, signature ) ) != 0 )
+		return rc;
 	DBGC ( context, "RSA %p signed %s digest:\n", context, digest->name );
 	DBGC_HDA ( context, 0, signature, context->max_len );
 
@@ -548,7 +903,8 @@ static int rsa_verify ( void *ctx, struct digest_algorithm *digest,
 	 */
 	temp = context->input0;
 	expected = temp;
-	rsa_cipher ( context, signature, expected );
+	if ( ( rc = rsa_cipher ( context, signature, expected ) ) != 0 )
+		return rc;
 	DBGC ( context, "RSA %p deciphered signature:\n", context );
 	DBGC_HDA ( context, 0, expected, context->max_len );
 
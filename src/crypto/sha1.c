@@ -153,6 +153,11 @@ static void sha1_digest ( struct sha1_context *context ) {
 	linker_assert ( &u.ddd.dd.digest.h[4] == e, sha1_bad_layout );
 	linker_assert ( &u.ddd.dd.data.dword[0] == w, sha1_bad_layout );
 
+	/* Use hardware acceleration, if available */
+	if ( sha1_accel_digest ( &context->ddd.dd.digest,
+				 &context->ddd.dd.data ) )
+		return;
+
 	DBGC ( context, "SHA1 digesting:\n" );
 	DBGC_HDA ( context, 0, &context->ddd.dd.digest,
 		   sizeof ( context->ddd.dd.digest ) );
@@ -210,14 +215,20 @@ static void sha1_update ( void *ctx, const void *data, size_t len ) {
 	struct sha1_context *context = ctx;
 	const uint8_t *byte = data;
 	size_t offset;
+	size_t frag_len;
 
-	/* Accumulate data a byte at a time, performing the digest
-	 * whenever we fill the data buffer
+	/* Accumulate data, performing the digest whenever we fill
+	 * the data buffer
 	 */
-	while ( len-- ) {
+	while ( len ) {
 		offset = ( context->len % sizeof ( context->ddd.dd.data ) );
-		context->ddd.dd.data.byte[offset] = *(byte++);
-		context->len++;
+		frag_len = ( sizeof ( context->ddd.dd.data ) - offset );
+		if ( frag_len > len )
+			frag_len = len;
+		memcpy ( &context->ddd.dd.data.byte[offset], byte, frag_len );
+		byte += frag_len;
+		len -= frag_len;
+		context->len += frag_len;
 		if ( ( context->len % sizeof ( context->ddd.dd.data ) ) == 0 )
 			sha1_digest ( context );
 	}
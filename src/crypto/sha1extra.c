@@ -92,6 +92,11 @@ void prf_sha1 ( const void *key, size_t key_len, const char *label,
  * @ret block		SHA1_SIZE bytes of PBKDF2 data
  *
  * The operation of this function is described in RFC 2898.
+ *
+ * The HMAC key is the same for every iteration, so the digest
+ * contexts resulting from absorbing the inner and outer pads are
+ * computed only once.  This halves the number of SHA1 block
+ * operations required.
  */
 static void pbkdf2_sha1_f ( const void *passphrase, size_t pass_len,
 			    const void *salt, size_t salt_len,
@@ -100,6 +105,10 @@ static void pbkdf2_sha1_f ( const void *passphrase, size_t pass_len,
 	u8 pass[pass_len];	/* modifiable passphrase */
 	u8 in[salt_len + 4];	/* input buffer to first round */
 	u8 last[SHA1_DIGEST_SIZE]; /* output of round N, input of N+1 */
+	u8 inner[SHA1_DIGEST_SIZE]; /* inner hash of round N */
+	u8 k_opad[sizeof ( union sha1_block )]; /* HMAC outer pad */
+	u8 opad_ctx[SHA1_CTX_SIZE]; /* context after absorbing outer pad */
+	u8 ipad_ctx[SHA1_CTX_SIZE]; /* context after absorbing inner pad */
 	u8 sha1_ctx[SHA1_CTX_SIZE];
 	u8 *next_in = in;	/* changed to `last' after first round */
 	int next_size = sizeof ( in );
@@ -113,10 +122,27 @@ static void pbkdf2_sha1_f ( const void *passphrase, size_t pass_len,
 	memcpy ( in + salt_len, &blocknr, 4 );
 	memset ( block, 0, sizeof ( last ) );
 
+	/* Precompute contexts after absorbing the inner and outer
+	 * pads.  (hmac_init() will have reduced the key if
+	 * necessary.)
+	 */
+	hmac_init ( &sha1_algorithm, ipad_ctx, pass, &pass_len );
+	memset ( k_opad, 0, sizeof ( k_opad ) );
+	memcpy ( k_opad, pass, pass_len );
+	for ( j = 0; j < sizeof ( k_opad ); j++ ) {
+		k_opad[j] ^= 0x5c;
+	}
+	digest_init ( &sha1_algorithm, opad_ctx );
+	digest_update ( &sha1_algorithm, opad_ctx, k_opad, sizeof ( k_opad ) );
+
 	for ( i = 0; i < iterations; i++ ) {
-		hmac_init ( &sha1_algorithm, sha1_ctx, pass, &pass_len );
-		hmac_update ( &sha1_algorithm, sha1_ctx, next_in, next_size );
-		hmac_final ( &sha1_algorithm, sha1_ctx, pass, &pass_len, last );
+		memcpy ( sha1_ctx, ipad_ctx, sizeof ( sha1_ctx ) );
+		digest_update ( &sha1_algorithm, sha1_ctx, next_in, next_size );
+		digest_final ( &sha1_algorithm, sha1_ctx, inner );
+		memcpy ( sha1_ctx, opad_ctx, sizeof ( sha1_ctx ) );
+		digest_update ( &sha1_algorithm, sha1_ctx, inner,
+				sizeof ( inner ) );
+		digest_final ( &sha1_algorithm, sha1_ctx, last );
 
 		for ( j = 0; j < sizeof ( last ); j++ ) {
 			block[j] ^= last[j];
@@ -151,6 +151,11 @@ static void sha256_digest ( struct sha256_context *context ) {
 	linker_assert ( &u.ddd.dd.digest.h[7] == h, sha256_bad_layout );
 	linker_assert ( &u.ddd.dd.data.dword[0] == w, sha256_bad_layout );
 
+	/* Use hardware acceleration, if available */
+	if ( sha256_accel_digest ( &context->ddd.dd.digest,
+				   &context->ddd.dd.data, k ) )
+		return;
+
 	DBGC ( context, "SHA256 digesting:\n" );
 	DBGC_HDA ( context, 0, &context->ddd.dd.digest,
 		   sizeof ( context->ddd.dd.digest ) );
@@ -218,14 +223,20 @@ void sha256_update ( void *ctx, const void *data, size_t len ) {
 	struct sha256_context *context = ctx;
 	const uint8_t *byte = data;
 	size_t offset;
+	size_t frag_len;
 
-	/* Accumulate data a byte at a time, performing the digest
-	 * whenever we fill the data buffer
+	/* Accumulate data, performing the digest whenever we fill
+	 * the data buffer
 	 */
-	while ( len-- ) {
+	while ( len ) {
 		offset = ( context->len % sizeof ( context->ddd.dd.data ) );
-		context->ddd.dd.data.byte[offset] = *(byte++);
-		context->len++;
+		frag_len = ( sizeof ( context->ddd.dd.data ) - offset );
+		if ( frag_len > len )
+			frag_len = len;
+		memcpy ( &context->ddd.dd.data.byte[offset], byte, frag_len );
+		byte += frag_len;
+		len -= frag_len;
+		context->len += frag_len;
 		if ( ( context->len % sizeof ( context->ddd.dd.data ) ) == 0 )
 			sha256_digest ( context );
 	}
@@ -0,0 +1,335 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * X25519 key exchange
+ *
+ * X25519 is documented in RFC 7748.
+ *
+ * All field arithmetic is performed in constant time: there are no
+ * branches or memory accesses that depend upon secret values.  The
+ * representation of field elements (sixteen signed 64-bit limbs,
+ * each nominally holding 16 bits) is chosen for simplicity and
+ * portability to 32-bit CPUs rather than for speed.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <ipxe/crypto.h>
+#include <ipxe/x25519.h>
+
+/** Constant (A-2)/4 = 121665 used by the Montgomery ladder */
+static const struct x25519_field x25519_a24 = {
+	.limb = { 0xdb41, 1 },
+};
+
+/** Generator base point (u=9) */
+static const uint8_t x25519_base[X25519_SIZE] = { 9 };
+
+/**
+ * Propagate carries within field element
+ *
+ * @v f			Field element
+ *
+ * On exit, each limb will hold a value in the range [0,0xffff],
+ * except for the least significant limb which may temporarily
+ * absorb a small wraparound value.
+ */
+static void x25519_carry ( struct x25519_field *f ) {
+	int64_t carry;
+	unsigned int i;
+
+	for ( i = 0 ; i < 16 ; i++ ) {
+		f->limb[i] += ( 1LL << 16 );
+		carry = ( f->limb[i] >> 16 );
+		if ( i < 15 ) {
+			f->limb[ i + 1 ] += ( carry - 1 );
+		} else {
+			/* 2^256 = 38 (mod 2^255-19) */
+			f->limb[0] += ( 38 * ( carry - 1 ) );
+		}
+		f->limb[i] -= ( carry * ( 1LL << 16 ) );
+	}
+}
+
+/**
+ * Conditionally swap field elements (in constant time)
+ *
+ * @v p			Field element
+ * @v q			Field element
+ * @v swap		Swap elements (must be 0 or 1)
+ */
+static void x25519_swap ( struct x25519_field *p, struct x25519_field *q,
+			  unsigned int swap ) {
+	int64_t mask = ~( ( ( int64_t ) swap ) - 1 );
+	int64_t diff;
+	unsigned int i;
+
+	for ( i = 0 ; i < 16 ; i++ ) {
+		diff = ( mask & ( p->limb[i] ^ q->limb[i] ) );
+		p->limb[i] ^= diff;
+		q->limb[i] ^= diff;
+	}
+}
+
+/**
+ * Unpack field element from little-endian byte string
+ *
+ * @v f			Field element to fill in
+ * @v data		Little-endian byte string
+ */
+static void x25519_unpack ( struct x25519_field *f, const uint8_t *data ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < 16 ; i++ ) {
+		f->limb[i] = ( data[ 2 * i ] |
+			       ( ( ( int64_t ) data[ 2 * i + 1 ] ) << 8 ) );
+	}
+
+	/* Ignore most significant bit, as per RFC 7748 section 5 */
+	f->limb[15] &= 0x7fff;
+}
+
+/**
+ * Pack field element into (fully reduced) little-endian byte string
+ *
+ * @v f			Field element
+ * @v data		Little-endian byte string to fill in
+ */
+static void x25519_pack ( const struct x25519_field *f, uint8_t *data ) {
+	struct x25519_field t;
+	struct x25519_field m;
+	unsigned int borrow;
+	unsigned int i;
+	unsigned int j;
+
+	/* Ensure that all limbs are in range */
+	memcpy ( &t, f, sizeof ( t ) );
+	x25519_carry ( &t );
+	x25519_carry ( &t );
+	x25519_carry ( &t );
+
+	/* Subtract the modulus (at most twice) if no borrow results */
+	for ( j = 0 ; j < 2 ; j++ ) {
+		m.limb[0] = ( t.limb[0] - 0xffed );
+		for ( i = 1 ; i < 15 ; i++ ) {
+			m.limb[i] = ( t.limb[i] - 0xffff -
+				      ( ( m.limb[ i - 1 ] >> 16 ) & 1 ) );
+			m.limb[ i - 1 ] &= 0xffff;
+		}
+		m.limb[15] = ( t.limb[15] - 0x7fff -
+			       ( ( m.limb[14] >> 16 ) & 1 ) );
+		borrow = ( ( m.limb[15] >> 16 ) & 1 );
+		m.limb[14] &= 0xffff;
+		x25519_swap ( &t, &m, ( 1 - borrow ) );
+	}
+
+	/* Construct byte string */
+	for ( i = 0 ; i < 16 ; i++ ) {
+		data[ 2 * i ] = ( t.limb[i] & 0xff );
+		data[ 2 * i + 1 ] = ( ( t.limb[i] >> 8 ) & 0xff );
+	}
+}
+
+/**
+ * Add field elements
+ *
+ * @v a			Addend
+ * @v b			Addend
+ * @v sum		Sum to fill in
+ */
+static void x25519_add ( const struct x25519_field *a,
+			 const struct x25519_field *b,
+			 struct x25519_field *sum ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < 16 ; i++ )
+		sum->limb[i] = ( a->limb[i] + b->limb[i] );
+}
+
+/**
+ * Subtract field elements
+ *
+ * @v a			Minuend
+ * @v b			Subtrahend
+ * @v diff		Difference to fill in
+ */
+static void x25519_subtract ( const struct x25519_field *a,
+			      const struct x25519_field *b,
+			      struct x25519_field *diff ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < 16 ; i++ )
+		diff->limb[i] = ( a->limb[i] - b->limb[i] );
+}
+
+/**
+ * Multiply field elements
+ *
+ * @v a			Multiplicand
+ * @v b			Multiplier
+ * @v product		Product to fill in
+ *
+ * The product may safely overlap either input.
+ */
+static void x25519_multiply ( const struct x25519_field *a,
+			      const struct x25519_field *b,
+			      struct x25519_field *product ) {
+	int64_t t[31];
+	unsigned int i;
+	unsigned int j;
+
+	/* Calculate double-width product */
+	memset ( t, 0, sizeof ( t ) );
+	for ( i = 0 ; i < 16 ; i++ ) {
+		for ( j = 0 ; j < 16 ; j++ )
+			t[ i + j ] += ( a->limb[i] * b->limb[j] );
+	}
+
+	/* Reduce using 2^256 = 38 (mod 2^255-19) */
+	for ( i = 0 ; i < 15 ; i++ )
+		t[i] += ( 38 * t[ i + 16 ] );
+	for ( i = 0 ; i < 16 ; i++ )
+		product->limb[i] = t[i];
+	x25519_carry ( product );
+	x25519_carry ( product );
+}
+
+/**
+ * Invert field element
+ *
+ * @v in		Field element
+ * @v inverse		Inverse to fill in
+ *
+ * The inverse is calculated as in^(p-2) using a fixed sequence of
+ * squarings and multiplications.
+ */
+static void x25519_invert ( const struct x25519_field *in,
+			    struct x25519_field *inverse ) {
+	struct x25519_field c;
+	int i;
+
+	memcpy ( &c, in, sizeof ( c ) );
+	for ( i = 253 ; i >= 0 ; i-- ) {
+		x25519_multiply ( &c, &c, &c );
+		if ( ( i != 2 ) && ( i != 4 ) )
+			x25519_multiply ( &c, in, &c );
+	}
+	memcpy ( inverse, &c, sizeof ( *inverse ) );
+}
+
+/**
+ * Calculate X25519 function
+ *
+ * @v base		Base point u-coordinate (32 bytes)
+ * @v scalar		Scalar (32 bytes)
+ * @v result		Result u-coordinate to fill in (32 bytes)
+ * @ret rc		Return status code
+ *
+ * The result may safely overlap either input.
+ */
+int x25519_key ( const void *base, const void *scalar, void *result ) {
+	static const uint8_t zero[X25519_SIZE];
+	struct x25519_field x;
+	struct x25519_field a;
+	struct x25519_field b;
+	struct x25519_field c;
+	struct x25519_field d;
+	struct x25519_field e;
+	struct x25519_field f;
+	uint8_t k[X25519_SIZE];
+	uint8_t out[X25519_SIZE];
+	unsigned int bit;
+	int i;
+
+	/* Decode scalar, as per RFC 7748 section 5 */
+	memcpy ( k, scalar, sizeof ( k ) );
+	k[0] &= 0xf8;
+	k[31] &= 0x7f;
+	k[31] |= 0x40;
+
+	/* Decode base point */
+	x25519_unpack ( &x, base );
+
+	/* Initialise ladder: (a:c) = (1:0), (b:d) = (x:1) */
+	memset ( &a, 0, sizeof ( a ) );
+	memset ( &c, 0, sizeof ( c ) );
+	memset ( &d, 0, sizeof ( d ) );
+	memcpy ( &b, &x, sizeof ( b ) );
+	a.limb[0] = 1;
+	d.limb[0] = 1;
+
+	/* Perform Montgomery ladder */
+	for ( i = 254 ; i >= 0 ; i-- ) {
+		bit = ( ( k[ i / 8 ] >> ( i % 8 ) ) & 1 );
+		x25519_swap ( &a, &b, bit );
+		x25519_swap ( &c, &d, bit );
+		x25519_add ( &a, &c, &e );
+		x25519_subtract ( &a, &c, &a );
+		x25519_add ( &b, &d, &c );
+		x25519_subtract ( &b, &d, &b );
+		x25519_multiply ( &e, &e, &d );
+		x25519_multiply ( &a, &a, &f );
+		x25519_multiply ( &c, &a, &a );
+		x25519_multiply ( &b, &e, &c );
+		x25519_add ( &a, &c, &e );
+		x25519_subtract ( &a, &c, &a );
+		x25519_multiply ( &a, &a, &b );
+		x25519_subtract ( &d, &f, &c );
+		x25519_multiply ( &c, &x25519_a24, &a );
+		x25519_add ( &a, &d, &a );
+		x25519_multiply ( &c, &a, &c );
+		x25519_multiply ( &d, &f, &a );
+		x25519_multiply ( &b, &x, &d );
+		x25519_multiply ( &e, &e, &b );
+		x25519_swap ( &a, &b, bit );
+		x25519_swap ( &c, &d, bit );
+	}
+
+	/* Convert result to affine coordinate u = a/c */
+	x25519_invert ( &c, &c );
+	x25519_multiply ( &a, &c, &a );
+	x25519_pack ( &a, out );
+	memcpy ( result, out, sizeof ( out ) );
+
+	/* Reject an all-zero result (which arises from a low-order
+	 * base point), as per RFC 7748 section 6.1.
+	 */
+	if ( memcmp ( out, zero, sizeof ( out ) ) == 0 )
+		return -EPERM;
+
+	return 0;
+}
+
+/** X25519 elliptic curve */
+struct elliptic_curve x25519_curve = {
+	.name = "x25519",
+	.pointsize = X25519_SIZE,
+	.keysize = X25519_SIZE,
+	.base = x25519_base,
+	.multiply = x25519_key,
+};
@@ -744,6 +744,81 @@ static int x509_parse_subject_alt_name ( struct x509_certificate *cert,
 	return 0;
 }
 
+/**
+ * Record X.509 certificate extended key usage for deferred parsing
+ *
+ * @v cert		X.509 certificate
+ * @v raw		ASN.1 cursor
+ * @ret rc		Return status code
+ */
+static int x509_defer_extended_key_usage ( struct x509_certificate *cert,
+					   const struct asn1_cursor *raw ) {
+	struct x509_extended_key_usage *ext_usage = &cert->extensions.ext_usage;
+
+	memcpy ( &ext_usage->raw, raw, sizeof ( ext_usage->raw ) );
+	return 0;
+}
+
+/**
+ * Record X.509 certificate authority information access for deferred parsing
+ *
+ * @v cert		X.509 certificate
+ * @v raw		ASN.1 cursor
+ * @ret rc		Return status code
+ */
+static int x509_defer_authority_info_access ( struct x509_certificate *cert,
+					      const struct asn1_cursor *raw ) {
+	struct x509_authority_info_access *auth_info =
+		&cert->extensions.auth_info;
+
+	memcpy ( &auth_info->raw, raw, sizeof ( auth_info->raw ) );
+	return 0;
+}
+
+/**
+ * Parse deferred X.509 certificate extensions
+ *
+ * @v cert		X.509 certificate
+ * @ret rc		Return status code
+ *
+ * The extended key usage and authority information access extensions
+ * are required only for some certificates (such as code-signing
+ * certificates, or those being checked via OCSP).  These extensions
+ * are recorded when the certificate is parsed, and are parsed only
+ * on first use.
+ */
+int x509_parse_deferred ( struct x509_certificate *cert ) {
+	struct x509_extensions *extensions = &cert->extensions;
+	int rc;
+
+	/* Do nothing if already parsed */
+	if ( cert->flags & X509_FL_DEFERRED )
+		return 0;
+
+	/* Parse extended key usage, if present */
+	if ( extensions->ext_usage.raw.len &&
+	     ( ( rc = x509_parse_extended_key_usage ( cert,
+				&extensions->ext_usage.raw ) ) != 0 ) ) {
+		DBGC ( cert, "X509 %p \"%s\" invalid extKeyUsage: %s\n",
+		       cert, x509_name ( cert ), strerror ( rc ) );
+		return rc;
+	}
+
+	/* Parse authority information access, if present */
+	if ( extensions->auth_info.raw.len &&
+	     ( ( rc = x509_parse_authority_info_access ( cert,
+				&extensions->auth_info.raw ) ) != 0 ) ) {
+		DBGC ( cert, "X509 %p \"%s\" invalid authorityInfoAccess: "
+		       "%s\n", cert, x509_name ( cert ), strerror ( rc ) );
+		return rc;
+	}
+
+	/* Mark as parsed */
+	cert->flags |= X509_FL_DEFERRED;
+
+	return 0;
+}
+
 /** "id-ce-basicConstraints" object identifier */
 static uint8_t oid_ce_basic_constraints[] =
 	{ ASN1_OID_BASICCONSTRAINTS };
@@ -779,12 +854,12 @@ static struct x509_extension x509_extensions[] = {
 	{
 		.name = "extKeyUsage",
 		.oid = ASN1_OID_CURSOR ( oid_ce_ext_key_usage ),
-		.parse = x509_parse_extended_key_usage,
+		.parse = x509_defer_extended_key_usage,
 	},
 	{
 		.name = "authorityInfoAccess",
 		.oid = ASN1_OID_CURSOR ( oid_pe_authority_info_access ),
-		.parse = x509_parse_authority_info_access,
+		.parse = x509_defer_authority_info_access,
 	},
 	{
 		.name = "subjectAltName",
@@ -1230,10 +1305,25 @@ void x509_fingerprint ( struct x509_certificate *cert,
 			void *fingerprint ) {
 	uint8_t ctx[ digest->ctxsize ];
 
+	/* Use cached SHA-256 fingerprint, if available */
+	if ( ( digest == &sha256_algorithm ) &&
+	     ( cert->flags & X509_FL_FINGERPRINT ) ) {
+		memcpy ( fingerprint, cert->fingerprint,
+			 sizeof ( cert->fingerprint ) );
+		return;
+	}
+
 	/* Calculate fingerprint */
 	digest_init ( digest, ctx );
 	digest_update ( digest, ctx, cert->raw.data, cert->raw.len );
 	digest_final ( digest, ctx, fingerprint );
+
+	/* Cache SHA-256 fingerprint */
+	if ( digest == &sha256_algorithm ) {
+		memcpy ( cert->fingerprint, fingerprint,
+			 sizeof ( cert->fingerprint ) );
+		cert->flags |= X509_FL_FINGERPRINT;
+	}
 }
 
 /**
@@ -1295,6 +1385,22 @@ int x509_check_time ( struct x509_certificate *cert, time_t time ) {
 	return 0;
 }
 
+/**
+ * Invalidate X.509 certificate
+ *
+ * @v cert		X.509 certificate
+ *
+ * Any cached validation results for this certificate will also be
+ * discarded, so that a subsequent validation must be performed in
+ * full.
+ */
+void x509_invalidate ( struct x509_certificate *cert ) {
+
+	cert->flags &= ~X509_FL_VALIDATED;
+	cert->path_remaining = 0;
+	certstore_unmark_validated ( cert );
+}
+
 /**
  * Validate X.509 certificate
  *
@@ -1309,6 +1415,12 @@ int x509_check_time ( struct x509_certificate *cert, time_t time ) {
  * Validation results are cached: if a certificate has already been
  * successfully validated then @c issuer, @c time, and @c root will be
  * ignored.
+ *
+ * Validation results are additionally recorded in the certificate
+ * store, so that a certificate which has previously been validated
+ * using the same root certificate list may be validated as a
+ * standalone certificate (i.e. with no @c issuer) even if it has
+ * since been discarded and reparsed.
  */
 int x509_validate ( struct x509_certificate *cert,
 		    struct x509_certificate *issuer,
@@ -1335,8 +1447,13 @@ int x509_validate ( struct x509_certificate *cert,
 		return 0;
 	}
 
-	/* Fail unless we have an issuer */
+	/* Fail unless we have an issuer or a cached validation result
+	 * (which must not be used to bypass a required OCSP check).
+	 */
 	if ( ! issuer ) {
+		if ( ( ! ocsp_required ( cert ) ) &&
+		     ( certstore_is_validated ( cert, time, root ) == 0 ) )
+			return 0;
 		DBGC2 ( cert, "X509 %p \"%s\" has no issuer\n",
 			cert, x509_name ( cert ) );
 		return -EACCES_UNTRUSTED;
@@ -1377,6 +1494,7 @@ int x509_validate ( struct x509_certificate *cert,
 
 	/* Mark certificate as valid */
 	cert->flags |= X509_FL_VALIDATED;
+	certstore_mark_validated ( cert, issuer, root );
 
 	DBGC ( cert, "X509 %p \"%s\" successfully validated using ",
 	       cert, x509_name ( cert ) );
@@ -0,0 +1,1543 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <byteswap.h>
+#include <ipxe/crc32.h>
+#include <ipxe/crypto.h>
+#include <ipxe/sha256.h>
+#include <ipxe/umalloc.h>
+#include <ipxe/uaccess.h>
+#include <ipxe/decompress.h>
+#include <ipxe/xz.h>
+
+/** @file
+ *
+ * xz decompression algorithm
+ *
+ * This file implements decompression of the xz container format
+ * using the LZMA2 filter, as produced by the standard "xz" utility.
+ * Only a single LZMA2 filter per block is supported: branch/call/jump
+ * and delta filters are not supported, and the dictionary size is
+ * limited to 64MB (as used by the highest "xz" preset).
+ *
+ * LZMA2 packed chunks are accumulated in full before being decoded,
+ * and are decoded directly into the output buffer.  Decoding may be
+ * suspended after any output byte, and so there is no minimum output
+ * space requirement beyond the dictionary's worth of history.
+ *
+ */
+
+/** Stream header magic */
+static const uint8_t xz_magic[XZ_MAGIC_LEN] = {
+	0xfd, '7', 'z', 'X', 'Z', 0x00
+};
+
+/** Integrity check lengths (indexed by check type) */
+static const uint8_t xz_check_len[ XZ_CHECK_MASK + 1 ] = {
+	0, 4, 4, 4, 8, 8, 8, 16, 16, 16, 32, 32, 32, 64, 64, 64
+};
+
+/** CRC64 polynomial (bit-reversed ECMA-182) */
+#define XZ_CRC64_POLY 0xc96c5795d7870f42ULL
+
+/** Range decoder probability bits */
+#define XZ_RC_BITS 11
+
+/** Range decoder initial probability */
+#define XZ_RC_PROB_INIT ( 1 << ( XZ_RC_BITS - 1 ) )
+
+/** Range decoder probability adaptation shift */
+#define XZ_RC_MOVE 5
+
+/** Range decoder normalisation threshold */
+#define XZ_RC_TOP ( 1UL << 24 )
+
+/** Length of range decoder initialisation */
+#define XZ_RC_INIT_LEN 5
+
+/** LZMA state after a literal following a match */
+#define XZ_LZMA_STATE_LIT_MATCH 7
+
+/** LZMA state after a long repeated match following a literal */
+#define XZ_LZMA_STATE_LIT_LONGREP 8
+
+/** LZMA state after a short repeated match following a literal */
+#define XZ_LZMA_STATE_LIT_SHORTREP 9
+
+/** LZMA state after a match following a non-literal */
+#define XZ_LZMA_STATE_NONLIT_MATCH 10
+
+/** LZMA state after a repeated match following a non-literal */
+#define XZ_LZMA_STATE_NONLIT_REP 11
+
+/**
+ * Read unaligned little-endian 32-bit value
+ *
+ * @v data		Data
+ * @ret value		Value
+ */
+static inline uint32_t xz_le32 ( const void *data ) {
+	uint32_t value;
+
+	memcpy ( &value, data, sizeof ( value ) );
+	return le32_to_cpu ( value );
+}
+
+/**
+ * Read unaligned little-endian 64-bit value
+ *
+ * @v data		Data
+ * @ret value		Value
+ */
+static inline uint64_t xz_le64 ( const void *data ) {
+	uint64_t value;
+
+	memcpy ( &value, data, sizeof ( value ) );
+	return le64_to_cpu ( value );
+}
+
+/**
+ * Read unaligned big-endian 16-bit value
+ *
+ * @v data		Data
+ * @ret value		Value
+ */
+static inline uint16_t xz_be16 ( const void *data ) {
+	uint16_t value;
+
+	memcpy ( &value, data, sizeof ( value ) );
+	return be16_to_cpu ( value );
+}
+
+/**
+ * Calculate CRC32
+ *
+ * @v crc		Initial CRC32 value
+ * @v data		Data
+ * @v len		Length of data
+ * @ret crc		Updated CRC32 value
+ */
+static uint32_t xz_crc32 ( uint32_t crc, const void *data, size_t len ) {
+
+	return ~crc32_le ( ~crc, data, len );
+}
+
+/**
+ * Calculate CRC64
+ *
+ * @v crc		Initial CRC64 value
+ * @v data		Data
+ * @v len		Length of data
+ * @ret crc		Updated CRC64 value
+ */
+static uint64_t xz_crc64 ( uint64_t crc, const void *data, size_t len ) {
+	const uint8_t *bytes = data;
+	unsigned int i;
+
+	crc = ~crc;
+	while ( len-- ) {
+		crc ^= *(bytes++);
+		for ( i = 0 ; i < 8 ; i++ ) {
+			crc = ( ( crc >> 1 ) ^
+				( ( crc & 1 ) ? XZ_CRC64_POLY : 0 ) );
+		}
+	}
+	return ~crc;
+}
+
+/**
+ * Update variable-length integer
+ *
+ * @v value		Partial integer value
+ * @v shift		Partial integer shift
+ * @v byte		Next byte
+ * @ret complete	Integer is complete, or negative error
+ */
+static int xz_vli_update ( uint64_t *value, unsigned int *shift,
+			   uint8_t byte ) {
+
+	/* Reject overlength or non-minimal encodings */
+	if ( ( *shift >= 63 ) || ( ( byte == 0 ) && *shift ) )
+		return -EINVAL;
+
+	/* Accumulate value */
+	*value |= ( ( ( uint64_t ) ( byte & 0x7f ) ) << *shift );
+	*shift += 7;
+
+	return ( ! ( byte & 0x80 ) );
+}
+
+/**
+ * Parse variable-length integer
+ *
+ * @v data		Data
+ * @v len		Length of data
+ * @v offset		Offset within data (updated)
+ * @v value		Integer value to fill in
+ * @ret rc		Return status code
+ */
+static int xz_vli ( const uint8_t *data, size_t len, size_t *offset,
+		    uint64_t *value ) {
+	unsigned int shift = 0;
+	int complete;
+
+	*value = 0;
+	do {
+		if ( *offset >= len )
+			return -EINVAL;
+		complete = xz_vli_update ( value, &shift, data[(*offset)++] );
+		if ( complete < 0 )
+			return complete;
+	} while ( ! complete );
+
+	return 0;
+}
+
+/******************************************************************************
+ *
+ * Integrity checks
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Get integrity check type
+ *
+ * @v xz		Decompressor
+ * @ret type		Check type
+ */
+static inline unsigned int xz_check_type ( struct xz *xz ) {
+
+	return ( le16_to_cpu ( xz->flags ) >> 8 );
+}
+
+/**
+ * Initialise integrity check
+ *
+ * @v xz		Decompressor
+ */
+static void xz_check_init ( struct xz *xz ) {
+
+	memset ( &xz->check, 0, sizeof ( xz->check ) );
+	if ( xz_check_type ( xz ) == XZ_CHECK_SHA256 )
+		digest_init ( &sha256_algorithm, &xz->check.sha256 );
+}
+
+/**
+ * Update integrity check
+ *
+ * @v xz		Decompressor
+ * @v data		Uncompressed data
+ * @v len		Length of uncompressed data
+ */
+static void xz_check_update ( struct xz *xz, const void *data, size_t len ) {
+
+	switch ( xz_check_type ( xz ) ) {
+	case XZ_CHECK_CRC32:
+		xz->check.crc32 = xz_crc32 ( xz->check.crc32, data, len );
+		break;
+	case XZ_CHECK_CRC64:
+		xz->check.crc64 = xz_crc64 ( xz->check.crc64, data, len );
+		break;
+	case XZ_CHECK_SHA256:
+		digest_update ( &sha256_algorithm, &xz->check.sha256,
+				data, len );
+		break;
+	default:
+		/* Other check types are not verified */
+		break;
+	}
+}
+
+/**
+ * Verify integrity check
+ *
+ * @v xz		Decompressor
+ * @ret rc		Return status code
+ */
+static int xz_check_verify ( struct xz *xz ) {
+	uint8_t digest[SHA256_DIGEST_SIZE];
+	int ok;
+
+	switch ( xz_check_type ( xz ) ) {
+	case XZ_CHECK_CRC32:
+		ok = ( xz_le32 ( xz->header ) == xz->check.crc32 );
+		break;
+	case XZ_CHECK_CRC64:
+		ok = ( xz_le64 ( xz->header ) == xz->check.crc64 );
+		break;
+	case XZ_CHECK_SHA256:
+		digest_final ( &sha256_algorithm, &xz->check.sha256, digest );
+		ok = ( memcmp ( xz->header, digest, sizeof ( digest ) ) == 0 );
+		break;
+	default:
+		ok = 1;
+		break;
+	}
+	if ( ! ok ) {
+		DBGC ( xz, "XZ %p check mismatch\n", xz );
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/******************************************************************************
+ *
+ * Range decoder
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Initialise range decoder
+ *
+ * @v rc		Range decoder
+ * @v data		Packed chunk
+ * @v len		Length of packed chunk
+ * @ret rc		Return status code
+ */
+static int xz_rc_init ( struct xz_rc *rc, const uint8_t *data, size_t len ) {
+
+	/* Sanity check */
+	if ( ( len < XZ_RC_INIT_LEN ) || ( data[0] != 0 ) )
+		return -EINVAL;
+
+	/* Initialise decoder */
+	rc->data = data;
+	rc->len = len;
+	rc->offset = XZ_RC_INIT_LEN;
+	rc->range = 0xffffffffUL;
+	rc->code = ( ( ( ( uint32_t ) data[1] ) << 24 ) | ( data[2] << 16 ) |
+		     ( data[3] << 8 ) | ( data[4] << 0 ) );
+
+	return 0;
+}
+
+/**
+ * Normalise range decoder
+ *
+ * @v rc		Range decoder
+ *
+ * Reading beyond the end of the packed chunk supplies zero bytes,
+ * and is detected via rc->offset exceeding rc->len.
+ */
+static inline __attribute__ (( always_inline )) void
+xz_rc_normalise ( struct xz_rc *rc ) {
+	uint8_t byte;
+
+	if ( rc->range < XZ_RC_TOP ) {
+		byte = ( ( rc->offset < rc->len ) ? rc->data[rc->offset] : 0 );
+		rc->offset++;
+		rc->range <<= 8;
+		rc->code = ( ( rc->code << 8 ) | byte );
+	}
+}
+
+/**
+ * Check for range decoder overrun
+ *
+ * @v rc		Range decoder
+ * @ret overrun		Decoder has read beyond the end of the chunk
+ */
+static inline int xz_rc_overrun ( struct xz_rc *rc ) {
+
+	return ( rc->offset > rc->len );
+}
+
+/**
+ * Decode bit
+ *
+ * @v rc		Range decoder
+ * @v prob		Probability
+ * @ret bit		Decoded bit
+ */
+static inline __attribute__ (( always_inline )) unsigned int
+xz_rc_bit ( struct xz_rc *rc, uint16_t *prob ) {
+	uint32_t bound;
+
+	xz_rc_normalise ( rc );
+	bound = ( ( rc->range >> XZ_RC_BITS ) * ( *prob ) );
+	if ( rc->code < bound ) {
+		rc->range = bound;
+		*prob += ( ( ( 1 << XZ_RC_BITS ) - *prob ) >> XZ_RC_MOVE );
+		return 0;
+	} else {
+		rc->range -= bound;
+		rc->code -= bound;
+		*prob -= ( *prob >> XZ_RC_MOVE );
+		return 1;
+	}
+}
+
+/**
+ * Decode bit tree
+ *
+ * @v rc		Range decoder
+ * @v probs		Probabilities (indexed from one)
+ * @v limit		Number of symbols
+ * @ret symbol		Decoded symbol
+ */
+static unsigned int xz_rc_tree ( struct xz_rc *rc, uint16_t *probs,
+				 unsigned int limit ) {
+	unsigned int symbol = 1;
+
+	do {
+		symbol = ( ( symbol << 1 ) | xz_rc_bit ( rc, &probs[symbol] ) );
+	} while ( symbol < limit );
+
+	return ( symbol - limit );
+}
+
+/**
+ * Decode reverse bit tree
+ *
+ * @v rc		Range decoder
+ * @v probs		Probabilities (indexed from zero)
+ * @v bits		Number of bits
+ * @ret value		Decoded value
+ */
+static uint32_t xz_rc_reverse ( struct xz_rc *rc, uint16_t *probs,
+				unsigned int bits ) {
+	unsigned int symbol = 1;
+	unsigned int bit;
+	uint32_t value = 0;
+	unsigned int i;
+
+	for ( i = 0 ; i < bits ; i++ ) {
+		bit = xz_rc_bit ( rc, &probs[ symbol - 1 ] );
+		symbol = ( ( symbol << 1 ) | bit );
+		value |= ( bit << i );
+	}
+
+	return value;
+}
+
+/**
+ * Decode direct bits
+ *
+ * @v rc		Range decoder
+ * @v bits		Number of bits
+ * @ret value		Decoded value
+ */
+static uint32_t xz_rc_direct ( struct xz_rc *rc, unsigned int bits ) {
+	uint32_t value = 0;
+	uint32_t mask;
+
+	while ( bits-- ) {
+		xz_rc_normalise ( rc );
+		rc->range >>= 1;
+		rc->code -= rc->range;
+		mask = ( 0 - ( rc->code >> 31 ) );
+		rc->code += ( rc->range & mask );
+		value = ( ( value << 1 ) + ( mask + 1 ) );
+	}
+
+	return value;
+}
+
+/******************************************************************************
+ *
+ * LZMA decoder
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Reset LZMA state
+ *
+ * @v lzma		LZMA decoder
+ */
+static void xz_lzma_reset ( struct xz_lzma *lzma ) {
+	uint16_t *probs = ( ( uint16_t * ) &lzma->probs );
+	unsigned int i;
+
+	lzma->state = 0;
+	memset ( lzma->rep, 0, sizeof ( lzma->rep ) );
+	lzma->len = 0;
+	for ( i = 0 ; i < ( sizeof ( lzma->probs ) / sizeof ( *probs ) ) ; i++ )
+		probs[i] = XZ_RC_PROB_INIT;
+}
+
+/**
+ * Set LZMA properties
+ *
+ * @v lzma		LZMA decoder
+ * @v props		Properties byte
+ * @ret rc		Return status code
+ */
+static int xz_lzma_props ( struct xz_lzma *lzma, unsigned int props ) {
+	unsigned int lc;
+	unsigned int lp;
+	unsigned int pb;
+
+	/* Parse properties */
+	if ( props >= ( 9 * 5 * 5 ) )
+		return -EINVAL;
+	lc = ( props % 9 );
+	props /= 9;
+	lp = ( props % 5 );
+	pb = ( props / 5 );
+	if ( ( lc + lp ) > 4 )
+		return -EINVAL;
+
+	/* Record properties and reset state */
+	lzma->lc = lc;
+	lzma->lp_mask = ( ( 1 << lp ) - 1 );
+	lzma->pb_mask = ( ( 1 << pb ) - 1 );
+	xz_lzma_reset ( lzma );
+
+	return 0;
+}
+
+/**
+ * Decode LZMA length
+ *
+ * @v rc		Range decoder
+ * @v length		Length decoder
+ * @v pos_state		Position state
+ * @ret len		Length
+ */
+static unsigned int xz_lzma_len ( struct xz_rc *rc,
+				  struct xz_lzma_length *length,
+				  unsigned int pos_state ) {
+
+	if ( ! xz_rc_bit ( rc, &length->choice ) ) {
+		return ( XZ_LZMA_MATCH_LEN_MIN +
+			 xz_rc_tree ( rc, length->low[pos_state],
+				      XZ_LZMA_LEN_LOW ) );
+	}
+	if ( ! xz_rc_bit ( rc, &length->choice2 ) ) {
+		return ( XZ_LZMA_MATCH_LEN_MIN + XZ_LZMA_LEN_LOW +
+			 xz_rc_tree ( rc, length->mid[pos_state],
+				      XZ_LZMA_LEN_LOW ) );
+	}
+	return ( XZ_LZMA_MATCH_LEN_MIN + ( 2 * XZ_LZMA_LEN_LOW ) +
+		 xz_rc_tree ( rc, length->high, XZ_LZMA_LEN_HIGH ) );
+}
+
+/**
+ * Decode LZMA match distance
+ *
+ * @v lzma		LZMA decoder
+ * @v len		Match length
+ * @ret dist		Match distance (minus one)
+ */
+static uint32_t xz_lzma_dist ( struct xz_lzma *lzma, unsigned int len ) {
+	struct xz_lzma_probs *probs = &lzma->probs;
+	struct xz_rc *rc = &lzma->rc;
+	unsigned int dist_state;
+	unsigned int slot;
+	unsigned int bits;
+	uint32_t dist;
+
+	/* Decode distance slot */
+	dist_state = ( len - XZ_LZMA_MATCH_LEN_MIN );
+	if ( dist_state >= XZ_LZMA_DIST_STATES )
+		dist_state = ( XZ_LZMA_DIST_STATES - 1 );
+	slot = xz_rc_tree ( rc, probs->dist_slot[dist_state],
+			    XZ_LZMA_DIST_SLOTS );
+	if ( slot < XZ_LZMA_DIST_MODEL_START )
+		return slot;
+
+	/* Decode extra bits */
+	bits = ( ( slot >> 1 ) - 1 );
+	dist = ( ( 2 | ( slot & 1 ) ) << bits );
+	if ( slot < XZ_LZMA_DIST_MODEL_END ) {
+		dist += xz_rc_reverse ( rc,
+					&probs->dist_special[ dist - slot ],
+					bits );
+	} else {
+		dist += ( xz_rc_direct ( rc, ( bits - XZ_LZMA_ALIGN_BITS ) )
+			  << XZ_LZMA_ALIGN_BITS );
+		dist += xz_rc_reverse ( rc, probs->dist_align,
+					XZ_LZMA_ALIGN_BITS );
+	}
+
+	return dist;
+}
+
+/**
+ * Decode LZMA literal
+ *
+ * @v lzma		LZMA decoder
+ * @v data		Output data
+ * @v offset		Current offset within output data
+ * @v pos		Position within dictionary
+ * @ret byte		Decoded byte
+ */
+static uint8_t xz_lzma_literal ( struct xz_lzma *lzma, const uint8_t *data,
+				 size_t offset, size_t pos ) {
+	struct xz_rc *rc = &lzma->rc;
+	unsigned int prev;
+	unsigned int match;
+	unsigned int match_bit;
+	unsigned int mask;
+	unsigned int symbol;
+	unsigned int bit;
+	uint16_t *probs;
+
+	/* Select literal coder */
+	prev = ( pos ? data[ offset - 1 ] : 0 );
+	probs = lzma->probs.literal[ ( ( pos & lzma->lp_mask ) << lzma->lc ) +
+				     ( prev >> ( 8 - lzma->lc ) ) ];
+
+	/* Decode plain literal, if applicable */
+	if ( lzma->state < XZ_LZMA_LIT_STATES )
+		return xz_rc_tree ( rc, probs, 0x100 );
+
+	/* Decode matched literal, using the byte at the most recent
+	 * match distance until the first mismatching bit.
+	 */
+	match = ( data[ offset - lzma->rep[0] - 1 ] << 1 );
+	mask = 0x100;
+	symbol = 1;
+	do {
+		match_bit = ( match & mask );
+		match <<= 1;
+		bit = xz_rc_bit ( rc, &probs[ mask + match_bit + symbol ] );
+		symbol = ( ( symbol << 1 ) | bit );
+		mask &= ( bit ? match_bit : ~match_bit );
+	} while ( symbol < 0x100 );
+
+	return ( symbol - 0x100 );
+}
+
+/**
+ * Decode LZMA packed chunk data
+ *
+ * @v xz		Decompressor
+ * @v out		Output data buffer
+ * @ret rc		Return status code
+ */
+static int xz_lzma_decode ( struct xz *xz, struct deflate_chunk *out ) {
+	struct xz_lzma *lzma = &xz->lzma;
+	struct xz_lzma_probs *probs = &lzma->probs;
+	struct xz_rc *rc = &lzma->rc;
+	uint8_t *data = user_to_virt ( out->data, 0 );
+	unsigned int pos_state;
+	unsigned int state;
+	unsigned int len;
+	uint32_t dist;
+	uint8_t byte;
+	size_t history;
+	size_t offset;
+	size_t limit;
+	size_t pos;
+
+	/* Calculate output limit */
+	limit = ( out->len - out->offset );
+	if ( limit > xz->remaining )
+		limit = xz->remaining;
+	limit += out->offset;
+
+	for ( offset = out->offset ; offset < limit ; ) {
+
+		/* Calculate position within dictionary */
+		pos = ( lzma->pos + ( offset - out->offset ) );
+
+		/* Continue any partial match */
+		if ( lzma->len ) {
+			len = lzma->len;
+			if ( len > ( limit - offset ) )
+				len = ( limit - offset );
+			lzma->len -= len;
+			dist = ( lzma->rep[0] + 1 );
+			for ( ; len ; len-- ) {
+				data[offset] = data[ offset - dist ];
+				offset++;
+			}
+			continue;
+		}
+
+		/* Fail if we have read beyond the end of the chunk */
+		if ( xz_rc_overrun ( rc ) ) {
+			DBGC ( xz, "XZ %p LZMA overrun\n", xz );
+			return -EINVAL;
+		}
+
+		/* Decode literal, if applicable */
+		pos_state = ( pos & lzma->pb_mask );
+		state = lzma->state;
+		if ( ! xz_rc_bit ( rc, &probs->is_match[state][pos_state] ) ) {
+			byte = xz_lzma_literal ( lzma, data, offset, pos );
+			data[offset++] = byte;
+			if ( state < 4 ) {
+				lzma->state = 0;
+			} else if ( state < 10 ) {
+				lzma->state = ( state - 3 );
+			} else {
+				lzma->state = ( state - 6 );
+			}
+			continue;
+		}
+
+		/* Decode match */
+		if ( ! xz_rc_bit ( rc, &probs->is_rep[state] ) ) {
+			lzma->state = ( ( state < XZ_LZMA_LIT_STATES ) ?
+					XZ_LZMA_STATE_LIT_MATCH :
+					XZ_LZMA_STATE_NONLIT_MATCH );
+			lzma->rep[3] = lzma->rep[2];
+			lzma->rep[2] = lzma->rep[1];
+			lzma->rep[1] = lzma->rep[0];
+			len = xz_lzma_len ( rc, &probs->match_len, pos_state );
+			lzma->rep[0] = xz_lzma_dist ( lzma, len );
+		} else if ( ! xz_rc_bit ( rc, &probs->is_rep0[state] ) ) {
+			if ( ! xz_rc_bit ( rc, &probs->is_rep0_long[state]
+							      [pos_state] ) ) {
+				lzma->state = ( ( state < XZ_LZMA_LIT_STATES ) ?
+						XZ_LZMA_STATE_LIT_SHORTREP :
+						XZ_LZMA_STATE_NONLIT_REP );
+				len = 1;
+			} else {
+				lzma->state = ( ( state < XZ_LZMA_LIT_STATES ) ?
+						XZ_LZMA_STATE_LIT_LONGREP :
+						XZ_LZMA_STATE_NONLIT_REP );
+				len = xz_lzma_len ( rc, &probs->rep_len,
+						    pos_state );
+			}
+		} else {
+			if ( ! xz_rc_bit ( rc, &probs->is_rep1[state] ) ) {
+				dist = lzma->rep[1];
+			} else if ( ! xz_rc_bit ( rc,
+						  &probs->is_rep2[state] ) ) {
+				dist = lzma->rep[2];
+				lzma->rep[2] = lzma->rep[1];
+			} else {
+				dist = lzma->rep[3];
+				lzma->rep[3] = lzma->rep[2];
+				lzma->rep[2] = lzma->rep[1];
+			}
+			lzma->rep[1] = lzma->rep[0];
+			lzma->rep[0] = dist;
+			lzma->state = ( ( state < XZ_LZMA_LIT_STATES ) ?
+					XZ_LZMA_STATE_LIT_LONGREP :
+					XZ_LZMA_STATE_NONLIT_REP );
+			len = xz_lzma_len ( rc, &probs->rep_len, pos_state );
+		}
+
+		/* Validate match distance */
+		history = pos;
+		if ( history > xz->dict_size )
+			history = xz->dict_size;
+		if ( history > offset )
+			history = offset;
+		if ( lzma->rep[0] >= history ) {
+			DBGC ( xz, "XZ %p invalid distance %#x (history "
+			       "%#zx)\n", xz, ( lzma->rep[0] + 1 ), history );
+			return -EINVAL;
+		}
+		lzma->len = len;
+	}
+
+	/* Record produced length */
+	len = ( offset - out->offset );
+	xz_check_update ( xz, user_to_virt ( out->data, out->offset ), len );
+	out->offset = offset;
+	xz->uncompressed += len;
+	xz->remaining -= len;
+	lzma->pos += len;
+
+	/* Fail if we have read beyond the end of the chunk */
+	if ( xz_rc_overrun ( rc ) ) {
+		DBGC ( xz, "XZ %p LZMA overrun\n", xz );
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * Complete LZMA packed chunk
+ *
+ * @v xz		Decompressor
+ * @ret rc		Return status code
+ */
+static int xz_lzma_done ( struct xz *xz ) {
+	struct xz_lzma *lzma = &xz->lzma;
+	struct xz_rc *rc = &lzma->rc;
+
+	/* Check that the range decoder has consumed exactly the
+	 * packed chunk and has finished cleanly.
+	 */
+	xz_rc_normalise ( rc );
+	if ( lzma->len || ( rc->offset != rc->len ) || rc->code ) {
+		DBGC ( xz, "XZ %p LZMA chunk ended uncleanly (%#x bytes "
+		       "left, %#zx/%#zx consumed, code %#08x)\n", xz,
+		       lzma->len, rc->offset, rc->len, rc->code );
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/******************************************************************************
+ *
+ * Container format
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Accumulate header
+ *
+ * @v xz		Decompressor
+ * @v in		Compressed input data
+ * @v len		Required header length
+ * @ret complete	Header is complete
+ */
+static int xz_accumulate ( struct xz *xz, struct deflate_chunk *in,
+			   size_t len ) {
+	size_t frag;
+
+	/* Copy as much as possible of the header */
+	assert ( len <= sizeof ( xz->header ) );
+	assert ( xz->header_len <= len );
+	frag = ( len - xz->header_len );
+	if ( frag > ( in->len - in->offset ) )
+		frag = ( in->len - in->offset );
+	copy_from_user ( &xz->header[xz->header_len], in->data,
+			 in->offset, frag );
+	in->offset += frag;
+	xz->header_len += frag;
+
+	return ( xz->header_len == len );
+}
+
+/**
+ * Parse stream header
+ *
+ * @v xz		Decompressor
+ * @ret rc		Return status code
+ */
+static int xz_stream_header ( struct xz *xz ) {
+	const uint8_t *header = xz->header;
+	uint16_t flags;
+
+	/* Check magic */
+	if ( memcmp ( header, xz_magic, sizeof ( xz_magic ) ) != 0 ) {
+		DBGC ( xz, "XZ %p invalid magic\n", xz );
+		return -EINVAL;
+	}
+
+	/* Check CRC */
+	if ( xz_crc32 ( 0, &header[XZ_MAGIC_LEN], sizeof ( flags ) ) !=
+	     xz_le32 ( &header[ XZ_MAGIC_LEN + sizeof ( flags ) ] ) ) {
+		DBGC ( xz, "XZ %p stream header CRC mismatch\n", xz );
+		return -EINVAL;
+	}
+
+	/* Parse flags */
+	memcpy ( &flags, &header[XZ_MAGIC_LEN], sizeof ( flags ) );
+	if ( le16_to_cpu ( flags ) & ~( XZ_CHECK_MASK << 8 ) ) {
+		DBGC ( xz, "XZ %p unsupported stream flags %#04x\n",
+		       xz, le16_to_cpu ( flags ) );
+		return -ENOTSUP;
+	}
+	xz->flags = flags;
+	xz->check_len = xz_check_len[ xz_check_type ( xz ) ];
+	DBGC2 ( xz, "XZ %p stream check type %d\n",
+		xz, xz_check_type ( xz ) );
+
+	/* Reset stream totals */
+	memset ( &xz->blocks, 0, sizeof ( xz->blocks ) );
+	memset ( &xz->index, 0, sizeof ( xz->index ) );
+
+	return 0;
+}
+
+/**
+ * Parse block header
+ *
+ * @v xz		Decompressor
+ * @ret rc		Return status code
+ */
+static int xz_block_header ( struct xz *xz ) {
+	const uint8_t *header = xz->header;
+	size_t len = ( xz->block_header_len - sizeof ( uint32_t ) );
+	size_t offset = 2;
+	uint64_t filter;
+	uint64_t props_len;
+	unsigned int props;
+	uint64_t dict_size;
+	int rc;
+
+	/* Check CRC */
+	if ( xz_crc32 ( 0, header, len ) != xz_le32 ( &header[len] ) ) {
+		DBGC ( xz, "XZ %p block header CRC mismatch\n", xz );
+		return -EINVAL;
+	}
+
+	/* Parse flags */
+	xz->block_flags = header[1];
+	if ( xz->block_flags & XZ_BLOCK_RESERVED ) {
+		DBGC ( xz, "XZ %p unsupported block flags %#02x\n",
+		       xz, xz->block_flags );
+		return -ENOTSUP;
+	}
+	if ( xz->block_flags & XZ_BLOCK_FILTERS_MASK ) {
+		DBGC ( xz, "XZ %p unsupported filter chain\n", xz );
+		return -ENOTSUP;
+	}
+
+	/* Parse optional sizes */
+	if ( ( xz->block_flags & XZ_BLOCK_COMPRESSED ) &&
+	     ( ( rc = xz_vli ( header, len, &offset,
+			       &xz->expected_compressed ) ) != 0 ) )
+		goto err_vli;
+	if ( ( xz->block_flags & XZ_BLOCK_UNCOMPRESSED ) &&
+	     ( ( rc = xz_vli ( header, len, &offset,
+			       &xz->expected_uncompressed ) ) != 0 ) )
+		goto err_vli;
+
+	/* Parse filter */
+	if ( ( rc = xz_vli ( header, len, &offset, &filter ) ) != 0 )
+		goto err_vli;
+	if ( ( rc = xz_vli ( header, len, &offset, &props_len ) ) != 0 )
+		goto err_vli;
+	if ( filter != XZ_FILTER_LZMA2 ) {
+		DBGC ( xz, "XZ %p unsupported filter %#llx\n",
+		       xz, ( ( unsigned long long ) filter ) );
+		return -ENOTSUP;
+	}
+	if ( ( props_len != 1 ) || ( offset >= len ) ) {
+		DBGC ( xz, "XZ %p invalid LZMA2 properties\n", xz );
+		return -EINVAL;
+	}
+	props = header[offset++];
+
+	/* Check padding */
+	for ( ; offset < len ; offset++ ) {
+		if ( header[offset] ) {
+			DBGC ( xz, "XZ %p invalid block header padding\n",
+			       xz );
+			return -EINVAL;
+		}
+	}
+
+	/* Calculate dictionary size */
+	if ( props > 40 ) {
+		DBGC ( xz, "XZ %p invalid dictionary size %#02x\n",
+		       xz, props );
+		return -EINVAL;
+	}
+	dict_size = ( ( props == 40 ) ? 0xffffffffUL :
+		      ( ( 2ULL | ( props & 1 ) ) << ( ( props / 2 ) + 11 ) ) );
+	if ( dict_size > XZ_DICT_MAX ) {
+		DBGC ( xz, "XZ %p unsupported dictionary size %#llx\n",
+		       xz, ( ( unsigned long long ) dict_size ) );
+		return -ENOTSUP;
+	}
+	xz->dict_size = dict_size;
+	DBGC2 ( xz, "XZ %p block dictionary size %#zx\n", xz, xz->dict_size );
+
+	/* Reset block state */
+	xz->compressed = 0;
+	xz->uncompressed = 0;
+	xz->need_dict_reset = 1;
+	xz->need_props = 1;
+	xz_check_init ( xz );
+
+	return 0;
+
+ err_vli:
+	DBGC ( xz, "XZ %p invalid block header\n", xz );
+	return rc;
+}
+
+/**
+ * Complete block data
+ *
+ * @v xz		Decompressor
+ * @ret rc		Return status code
+ */
+static int xz_block_done ( struct xz *xz ) {
+
+	/* Check sizes, if present */
+	if ( ( ( xz->block_flags & XZ_BLOCK_COMPRESSED ) &&
+	       ( xz->compressed != xz->expected_compressed ) ) ||
+	     ( ( xz->block_flags & XZ_BLOCK_UNCOMPRESSED ) &&
+	       ( xz->uncompressed != xz->expected_uncompressed ) ) ) {
+		DBGC ( xz, "XZ %p block size mismatch\n", xz );
+		return -EINVAL;
+	}
+
+	/* Skip padding to a multiple of four bytes */
+	xz->block_padding = ( ( 0 - ( xz->block_header_len +
+				      xz->compressed ) ) & 3 );
+	xz->state = XZ_STATE_BLOCK_PADDING;
+
+	return 0;
+}
+
+/**
+ * Complete block
+ *
+ * @v xz		Decompressor
+ * @ret rc		Return status code
+ */
+static int xz_block_check ( struct xz *xz ) {
+	int rc;
+
+	/* Verify integrity check */
+	if ( ( rc = xz_check_verify ( xz ) ) != 0 )
+		return rc;
+
+	/* Record block in totals */
+	xz->blocks.count++;
+	xz->blocks.unpadded += ( xz->block_header_len + xz->compressed +
+				 xz->check_len );
+	xz->blocks.uncompressed += xz->uncompressed;
+	xz->state = XZ_STATE_BLOCK_HEADER_SIZE;
+
+	return 0;
+}
+
+/**
+ * Parse LZMA2 control byte
+ *
+ * @v xz		Decompressor
+ * @ret len		Length of chunk header, or negative error
+ */
+static int xz_lzma2_control ( struct xz *xz ) {
+	uint8_t control = xz->control;
+
+	/* Handle end of data */
+	if ( control == XZ_LZMA2_END )
+		return 0;
+
+	/* Handle dictionary reset */
+	if ( ( control >= XZ_LZMA2_DICT_RESET ) ||
+	     ( control == XZ_LZMA2_COPY_RESET ) ) {
+		xz->need_props = 1;
+		xz->need_dict_reset = 0;
+		xz->lzma.pos = 0;
+	} else if ( xz->need_dict_reset ) {
+		DBGC ( xz, "XZ %p missing dictionary reset\n", xz );
+		return -EINVAL;
+	}
+
+	/* Handle uncompressed chunks */
+	if ( control < XZ_LZMA2_LZMA ) {
+		if ( control > XZ_LZMA2_COPY ) {
+			DBGC ( xz, "XZ %p invalid LZMA2 control %#02x\n",
+			       xz, control );
+			return -EINVAL;
+		}
+		return sizeof ( uint16_t );
+	}
+
+	/* Handle LZMA chunks */
+	if ( control >= XZ_LZMA2_PROPS_RESET ) {
+		xz->need_props = 0;
+		return ( ( 2 * sizeof ( uint16_t ) ) + 1 );
+	}
+	if ( xz->need_props ) {
+		DBGC ( xz, "XZ %p missing LZMA properties\n", xz );
+		return -EINVAL;
+	}
+	if ( control >= XZ_LZMA2_STATE_RESET )
+		xz_lzma_reset ( &xz->lzma );
+	return ( 2 * sizeof ( uint16_t ) );
+}
+
+/**
+ * Parse LZMA2 chunk header
+ *
+ * @v xz		Decompressor
+ * @ret rc		Return status code
+ */
+static int xz_lzma2_header ( struct xz *xz ) {
+	const uint8_t *header = xz->header;
+	uint8_t control = xz->control;
+	int rc;
+
+	/* Handle uncompressed chunks */
+	if ( control < XZ_LZMA2_LZMA ) {
+		xz->remaining = ( xz_be16 ( &header[0] ) + 1 );
+		xz->compressed += ( 1 + xz->header_len + xz->remaining );
+		xz->state = XZ_STATE_LZMA2_COPY;
+		return 0;
+	}
+
+	/* Parse sizes */
+	xz->remaining = ( ( ( control & 0x1f ) << 16 ) +
+			  xz_be16 ( &header[0] ) + 1 );
+	xz->packed_len = ( xz_be16 ( &header[2] ) + 1 );
+	xz->buffer_len = 0;
+	xz->compressed += ( 1 + xz->header_len + xz->packed_len );
+
+	/* Parse properties, if present */
+	if ( ( control >= XZ_LZMA2_PROPS_RESET ) &&
+	     ( ( rc = xz_lzma_props ( &xz->lzma, header[4] ) ) != 0 ) ) {
+		DBGC ( xz, "XZ %p invalid LZMA properties %#02x\n",
+		       xz, header[4] );
+		return rc;
+	}
+
+	xz->state = XZ_STATE_LZMA2_PACKED;
+	return 0;
+}
+
+/**
+ * Parse index byte
+ *
+ * @v xz		Decompressor
+ * @ret rc		Return status code
+ */
+static int xz_index_byte ( struct xz *xz ) {
+	uint8_t byte = xz->header[0];
+	int complete;
+
+	/* Accumulate integer */
+	xz->index_crc = xz_crc32 ( xz->index_crc, &byte, sizeof ( byte ) );
+	xz->index_len++;
+	complete = xz_vli_update ( &xz->vli, &xz->vli_shift, byte );
+	if ( complete < 0 ) {
+		DBGC ( xz, "XZ %p invalid index\n", xz );
+		return complete;
+	}
+	if ( ! complete )
+		return 0;
+
+	/* Record field */
+	if ( xz->index_fields == 0 ) {
+		xz->index.count = xz->vli;
+	} else if ( xz->index_fields & 1 ) {
+		xz->index.unpadded += xz->vli;
+	} else {
+		xz->index.uncompressed += xz->vli;
+	}
+	xz->index_fields++;
+	xz->vli = 0;
+	xz->vli_shift = 0;
+
+	/* Check record count */
+	if ( xz->index.count != xz->blocks.count ) {
+		DBGC ( xz, "XZ %p index has %lld records, expected %lld\n",
+		       xz, ( ( unsigned long long ) xz->index.count ),
+		       ( ( unsigned long long ) xz->blocks.count ) );
+		return -EINVAL;
+	}
+
+	/* Check totals once all records are complete */
+	if ( xz->index_fields == ( 1 + ( 2 * xz->index.count ) ) ) {
+		if ( memcmp ( &xz->index, &xz->blocks,
+			      sizeof ( xz->index ) ) != 0 ) {
+			DBGC ( xz, "XZ %p index mismatch\n", xz );
+			return -EINVAL;
+		}
+		xz->state = XZ_STATE_INDEX_PADDING;
+	}
+
+	return 0;
+}
+
+/**
+ * Parse stream footer
+ *
+ * @v xz		Decompressor
+ * @ret rc		Return status code
+ */
+static int xz_stream_footer ( struct xz *xz ) {
+	const uint8_t *footer = xz->header;
+	uint32_t backward;
+
+	/* Check CRC */
+	if ( xz_crc32 ( 0, &footer[4], ( sizeof ( backward ) +
+					 sizeof ( xz->flags ) ) ) !=
+	     xz_le32 ( &footer[0] ) ) {
+		DBGC ( xz, "XZ %p stream footer CRC mismatch\n", xz );
+		return -EINVAL;
+	}
+
+	/* Check backward size, flags, and magic */
+	backward = xz_le32 ( &footer[4] );
+	if ( ( ( ( ( uint64_t ) backward ) + 1 ) * 4 ) != xz->index_len ) {
+		DBGC ( xz, "XZ %p backward size mismatch\n", xz );
+		return -EINVAL;
+	}
+	if ( memcmp ( &footer[8], &xz->flags, sizeof ( xz->flags ) ) != 0 ) {
+		DBGC ( xz, "XZ %p stream flags mismatch\n", xz );
+		return -EINVAL;
+	}
+	if ( memcmp ( &footer[10], XZ_FOOTER_MAGIC,
+		      ( sizeof ( XZ_FOOTER_MAGIC ) - 1 ) ) != 0 ) {
+		DBGC ( xz, "XZ %p invalid footer magic\n", xz );
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * Inflate compressed data
+ *
+ * @v xz		Decompressor
+ * @v in		Compressed input data
+ * @v out		Output data buffer
+ * @ret rc		Return status code
+ *
+ * The caller can use xz_finished() to determine whether a successful
+ * return indicates that the decompressor is merely waiting for more
+ * input data.
+ *
+ * Data will never be written beyond the end of the output buffer.
+ * The decompressor will return successfully (with input data
+ * remaining) if it requires more output space in order to continue.
+ * At least xz_history() bytes of history must be retained before the
+ * current output offset.
+ */
+int xz_inflate ( struct xz *xz, struct deflate_chunk *in,
+		 struct deflate_chunk *out ) {
+	size_t in_remaining;
+	size_t out_remaining;
+	size_t frag;
+	uint8_t byte;
+	int len;
+	int rc;
+
+	while ( 1 ) {
+
+		in_remaining = ( in->len - in->offset );
+		out_remaining = ( out->len - out->offset );
+
+		switch ( xz->state ) {
+
+		case XZ_STATE_STREAM_HEADER:
+			if ( ! xz_accumulate ( xz, in, XZ_STREAM_HEADER_LEN ) )
+				return 0;
+			xz->header_len = 0;
+			if ( ( rc = xz_stream_header ( xz ) ) != 0 )
+				return rc;
+			xz->started = 1;
+			xz->state = XZ_STATE_BLOCK_HEADER_SIZE;
+			break;
+
+		case XZ_STATE_BLOCK_HEADER_SIZE:
+			if ( ! xz_accumulate ( xz, in, 1 ) )
+				return 0;
+			if ( xz->header[0] == 0 ) {
+				xz->header_len = 0;
+				xz->index_crc = xz_crc32 ( 0, xz->header, 1 );
+				xz->index_len = 1;
+				xz->index_fields = 0;
+				xz->vli = 0;
+				xz->vli_shift = 0;
+				xz->state = XZ_STATE_INDEX;
+				break;
+			}
+			xz->block_header_len = ( ( xz->header[0] + 1 ) * 4 );
+			xz->state = XZ_STATE_BLOCK_HEADER;
+			break;
+
+		case XZ_STATE_BLOCK_HEADER:
+			if ( ! xz_accumulate ( xz, in, xz->block_header_len ) )
+				return 0;
+			xz->header_len = 0;
+			if ( ( rc = xz_block_header ( xz ) ) != 0 )
+				return rc;
+			xz->state = XZ_STATE_LZMA2_CONTROL;
+			break;
+
+		case XZ_STATE_LZMA2_CONTROL:
+			if ( ! xz_accumulate ( xz, in, 1 ) )
+				return 0;
+			xz->header_len = 0;
+			xz->control = xz->header[0];
+			len = xz_lzma2_control ( xz );
+			if ( len < 0 )
+				return len;
+			if ( len == 0 ) {
+				xz->compressed++;
+				if ( ( rc = xz_block_done ( xz ) ) != 0 )
+					return rc;
+				break;
+			}
+			xz->remaining = len;
+			xz->state = XZ_STATE_LZMA2_HEADER;
+			break;
+
+		case XZ_STATE_LZMA2_HEADER:
+			if ( ! xz_accumulate ( xz, in, xz->remaining ) )
+				return 0;
+			if ( ( rc = xz_lzma2_header ( xz ) ) != 0 )
+				return rc;
+			xz->header_len = 0;
+			break;
+
+		case XZ_STATE_LZMA2_COPY:
+			frag = xz->remaining;
+			if ( frag > in_remaining )
+				frag = in_remaining;
+			if ( frag > out_remaining )
+				frag = out_remaining;
+			memcpy_user ( out->data, out->offset, in->data,
+				      in->offset, frag );
+			xz_check_update ( xz, user_to_virt ( out->data,
+							     out->offset ),
+					  frag );
+			in->offset += frag;
+			out->offset += frag;
+			xz->uncompressed += frag;
+			xz->lzma.pos += frag;
+			xz->remaining -= frag;
+			if ( xz->remaining ) {
+				if ( ! frag )
+					return 0;
+				break;
+			}
+			xz->state = XZ_STATE_LZMA2_CONTROL;
+			break;
+
+		case XZ_STATE_LZMA2_PACKED:
+			frag = ( xz->packed_len - xz->buffer_len );
+			if ( frag > in_remaining )
+				frag = in_remaining;
+			memcpy_user ( xz->buffer, xz->buffer_len, in->data,
+				      in->offset, frag );
+			in->offset += frag;
+			xz->buffer_len += frag;
+			if ( xz->buffer_len < xz->packed_len )
+				return 0;
+			if ( ( rc = xz_rc_init ( &xz->lzma.rc,
+						 user_to_virt ( xz->buffer, 0 ),
+						 xz->packed_len ) ) != 0 ) {
+				DBGC ( xz, "XZ %p invalid LZMA chunk\n", xz );
+				return rc;
+			}
+			xz->state = XZ_STATE_LZMA2_DECODE;
+			break;
+
+		case XZ_STATE_LZMA2_DECODE:
+			if ( xz->remaining && ! out_remaining )
+				return 0;
+			if ( ( rc = xz_lzma_decode ( xz, out ) ) != 0 )
+				return rc;
+			if ( xz->remaining )
+				break;
+			if ( ( rc = xz_lzma_done ( xz ) ) != 0 )
+				return rc;
+			xz->state = XZ_STATE_LZMA2_CONTROL;
+			break;
+
+		case XZ_STATE_BLOCK_PADDING:
+			if ( xz->block_padding ) {
+				if ( ! xz_accumulate ( xz, in, 1 ) )
+					return 0;
+				xz->header_len = 0;
+				if ( xz->header[0] ) {
+					DBGC ( xz, "XZ %p invalid block "
+					       "padding\n", xz );
+					return -EINVAL;
+				}
+				xz->block_padding--;
+				break;
+			}
+			xz->state = XZ_STATE_CHECK;
+			break;
+
+		case XZ_STATE_CHECK:
+			if ( ! xz_accumulate ( xz, in, xz->check_len ) )
+				return 0;
+			xz->header_len = 0;
+			if ( ( rc = xz_block_check ( xz ) ) != 0 )
+				return rc;
+			break;
+
+		case XZ_STATE_INDEX:
+			if ( ! xz_accumulate ( xz, in, 1 ) )
+				return 0;
+			xz->header_len = 0;
+			if ( ( rc = xz_index_byte ( xz ) ) != 0 )
+				return rc;
+			break;
+
+		case XZ_STATE_INDEX_PADDING:
+			if ( xz->index_len % 4 ) {
+				if ( ! xz_accumulate ( xz, in, 1 ) )
+					return 0;
+				xz->header_len = 0;
+				if ( xz->header[0] ) {
+					DBGC ( xz, "XZ %p invalid index "
+					       "padding\n", xz );
+					return -EINVAL;
+				}
+				xz->index_crc = xz_crc32 ( xz->index_crc,
+							   xz->header, 1 );
+				xz->index_len++;
+				break;
+			}
+			xz->state = XZ_STATE_INDEX_CRC;
+			break;
+
+		case XZ_STATE_INDEX_CRC:
+			if ( ! xz_accumulate ( xz, in, sizeof ( uint32_t ) ) )
+				return 0;
+			xz->header_len = 0;
+			if ( xz_le32 ( xz->header ) != xz->index_crc ) {
+				DBGC ( xz, "XZ %p index CRC mismatch\n", xz );
+				return -EINVAL;
+			}
+			xz->index_len += sizeof ( uint32_t );
+			xz->state = XZ_STATE_STREAM_FOOTER;
+			break;
+
+		case XZ_STATE_STREAM_FOOTER:
+			if ( ! xz_accumulate ( xz, in, XZ_STREAM_HEADER_LEN ) )
+				return 0;
+			xz->header_len = 0;
+			if ( ( rc = xz_stream_footer ( xz ) ) != 0 )
+				return rc;
+			xz->padding = 0;
+			xz->state = XZ_STATE_STREAM_PADDING;
+			break;
+
+		case XZ_STATE_STREAM_PADDING:
+			if ( ! in_remaining )
+				return 0;
+			copy_from_user ( &byte, in->data, in->offset,
+					 sizeof ( byte ) );
+			if ( byte == 0 ) {
+				in->offset++;
+				xz->padding++;
+				break;
+			}
+			if ( xz->padding % 4 ) {
+				DBGC ( xz, "XZ %p invalid stream padding\n",
+				       xz );
+				return -EINVAL;
+			}
+			xz->state = XZ_STATE_STREAM_HEADER;
+			break;
+
+		default:
+			assert ( 0 );
+			return -EINVAL;
+		}
+	}
+}
+
+/**
+ * Initialise decompressor
+ *
+ * @v xz		Decompressor
+ * @ret rc		Return status code
+ */
+int xz_init ( struct xz *xz ) {
+
+	/* Reset state */
+	memset ( xz, 0, sizeof ( *xz ) );
+
+	/* Allocate packed chunk buffer */
+	xz->buffer = umalloc ( XZ_LZMA2_PACKED_MAX );
+	if ( ! xz->buffer )
+		return -ENOMEM;
+
+	return 0;
+}
+
+/**
+ * Finalise decompressor
+ *
+ * @v xz		Decompressor
+ */
+void xz_fini ( struct xz *xz ) {
+
+	ufree ( xz->buffer );
+	xz->buffer = UNULL;
+}
+
+/**
+ * Initialise xz decompressor
+ *
+ * @v ctx		Context
+ * @ret rc		Return status code
+ */
+static int xz_decompress_init ( void *ctx ) {
+
+	return xz_init ( ctx );
+}
+
+/**
+ * Inflate xz-compressed data
+ *
+ * @v ctx		Context
+ * @v in		Compressed input data
+ * @v out		Output data buffer
+ * @ret rc		Return status code
+ */
+static int xz_decompress_inflate ( void *ctx, struct deflate_chunk *in,
+				   struct deflate_chunk *out ) {
+
+	return xz_inflate ( ctx, in, out );
+}
+
+/**
+ * Check if xz decompression has finished
+ *
+ * @v ctx		Context
+ * @ret finished	Decompression has finished
+ */
+static int xz_decompress_finished ( void *ctx ) {
+
+	return xz_finished ( ctx );
+}
+
+/**
+ * Get xz history length
+ *
+ * @v ctx		Context
+ * @ret len		Length of output history that must be retained
+ */
+static size_t xz_decompress_history ( void *ctx ) {
+
+	return xz_history ( ctx );
+}
+
+/**
+ * Finalise xz decompressor
+ *
+ * @v ctx		Context
+ */
+static void xz_decompress_fini ( void *ctx ) {
+
+	xz_fini ( ctx );
+}
+
+/** xz decompression algorithm */
+struct decompressor xz_decompressor = {
+	.name = "xz",
+	.ctxsize = sizeof ( struct xz ),
+	.init = xz_decompress_init,
+	.inflate = xz_decompress_inflate,
+	.finished = xz_decompress_finished,
+	.history = xz_decompress_history,
+	.fini = xz_decompress_fini,
+};
@@ -0,0 +1,1806 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <assert.h>
+#include <byteswap.h>
+#include <ipxe/rotate.h>
+#include <ipxe/umalloc.h>
+#include <ipxe/uaccess.h>
+#include <ipxe/decompress.h>
+#include <ipxe/zstd.h>
+
+/** @file
+ *
+ * Zstandard decompression algorithm
+ *
+ * This file implements the decompression half of the Zstandard
+ * algorithm specified in RFC 8878.  Dictionaries are not supported,
+ * and the window size is limited to the 8MB that the specification
+ * requires all decoders to support.
+ *
+ * Compressed blocks are accumulated in full before being decoded,
+ * and are decoded directly into the output buffer.  The caller must
+ * therefore provide at least one maximum-sized block's worth of
+ * output space (in addition to the window's worth of history) in
+ * order to make progress through a compressed block.
+ *
+ */
+
+/** Offset of literals buffer within block buffer */
+#define ZSTD_LITERALS_OFFSET ZSTD_BLOCK_MAX
+
+/** Total length of block buffer */
+#define ZSTD_BUFFER_LEN ( ZSTD_LITERALS_OFFSET + ZSTD_BLOCK_MAX )
+
+/** A length code */
+struct zstd_length {
+	/** Baseline value */
+	uint32_t base;
+	/** Number of extra bits */
+	uint8_t bits;
+};
+
+/** Literals length codes */
+static const struct zstd_length zstd_ll[ ZSTD_LL_MAX_CODE + 1 ] = {
+	{ 0, 0 }, { 1, 0 }, { 2, 0 }, { 3, 0 }, { 4, 0 }, { 5, 0 },
+	{ 6, 0 }, { 7, 0 }, { 8, 0 }, { 9, 0 }, { 10, 0 }, { 11, 0 },
+	{ 12, 0 }, { 13, 0 }, { 14, 0 }, { 15, 0 }, { 16, 1 }, { 18, 1 },
+	{ 20, 1 }, { 22, 1 }, { 24, 2 }, { 28, 2 }, { 32, 3 }, { 40, 3 },
+	{ 48, 4 }, { 64, 6 }, { 128, 7 }, { 256, 8 }, { 512, 9 },
+	{ 1024, 10 }, { 2048, 11 }, { 4096, 12 }, { 8192, 13 },
+	{ 16384, 14 }, { 32768, 15 }, { 65536, 16 },
+};
+
+/** Match length codes */
+static const struct zstd_length zstd_ml[ ZSTD_ML_MAX_CODE + 1 ] = {
+	{ 3, 0 }, { 4, 0 }, { 5, 0 }, { 6, 0 }, { 7, 0 }, { 8, 0 },
+	{ 9, 0 }, { 10, 0 }, { 11, 0 }, { 12, 0 }, { 13, 0 }, { 14, 0 },
+	{ 15, 0 }, { 16, 0 }, { 17, 0 }, { 18, 0 }, { 19, 0 }, { 20, 0 },
+	{ 21, 0 }, { 22, 0 }, { 23, 0 }, { 24, 0 }, { 25, 0 }, { 26, 0 },
+	{ 27, 0 }, { 28, 0 }, { 29, 0 }, { 30, 0 }, { 31, 0 }, { 32, 0 },
+	{ 33, 0 }, { 34, 0 }, { 35, 1 }, { 37, 1 }, { 39, 1 }, { 41, 1 },
+	{ 43, 2 }, { 47, 2 }, { 51, 3 }, { 59, 3 }, { 67, 4 }, { 83, 4 },
+	{ 99, 5 }, { 131, 7 }, { 259, 8 }, { 515, 9 }, { 1027, 10 },
+	{ 2051, 11 }, { 4099, 12 }, { 8195, 13 }, { 16387, 14 },
+	{ 32771, 15 }, { 65539, 16 },
+};
+
+/** Predefined literals length distribution */
+static const int16_t zstd_ll_default[ ZSTD_LL_MAX_CODE + 1 ] = {
+	4, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1, 2, 2, 2, 2, 2, 2,
+	2, 2, 2, 3, 2, 1, 1, 1, 1, 1, -1, -1, -1, -1,
+};
+
+/** Predefined literals length accuracy log */
+#define ZSTD_LL_DEFAULT_LOG 6
+
+/** Predefined match length distribution */
+static const int16_t zstd_ml_default[ ZSTD_ML_MAX_CODE + 1 ] = {
+	1, 4, 3, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+/** Predefined match length accuracy log */
+#define ZSTD_ML_DEFAULT_LOG 6
+
+/** Predefined offset distribution */
+static const int16_t zstd_of_default[] = {
+	1, 1, 1, 1, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, -1, -1, -1, -1, -1,
+};
+
+/** Predefined offset accuracy log */
+#define ZSTD_OF_DEFAULT_LOG 5
+
+/******************************************************************************
+ *
+ * XXH64 content checksum
+ *
+ ******************************************************************************
+ */
+
+/** XXH64 prime 1 */
+#define XXH64_PRIME1 0x9e3779b185ebca87ULL
+
+/** XXH64 prime 2 */
+#define XXH64_PRIME2 0xc2b2ae3d27d4eb4fULL
+
+/** XXH64 prime 3 */
+#define XXH64_PRIME3 0x165667b19e3779f9ULL
+
+/** XXH64 prime 4 */
+#define XXH64_PRIME4 0x85ebca77c2b2ae63ULL
+
+/** XXH64 prime 5 */
+#define XXH64_PRIME5 0x27d4eb2f165667c5ULL
+
+/**
+ * Read unaligned little-endian 64-bit value
+ *
+ * @v data		Data
+ * @ret value		Value
+ */
+static inline uint64_t zstd_le64 ( const void *data ) {
+	uint64_t value;
+
+	memcpy ( &value, data, sizeof ( value ) );
+	return le64_to_cpu ( value );
+}
+
+/**
+ * Read unaligned little-endian 32-bit value
+ *
+ * @v data		Data
+ * @ret value		Value
+ */
+static inline uint32_t zstd_le32 ( const void *data ) {
+	uint32_t value;
+
+	memcpy ( &value, data, sizeof ( value ) );
+	return le32_to_cpu ( value );
+}
+
+/**
+ * Perform XXH64 accumulator round
+ *
+ * @v acc		Accumulator
+ * @v input		Input value
+ * @ret acc		Updated accumulator
+ */
+static inline uint64_t zstd_xxh64_round ( uint64_t acc, uint64_t input ) {
+
+	acc += ( input * XXH64_PRIME2 );
+	acc = rol64 ( acc, 31 );
+	return ( acc * XXH64_PRIME1 );
+}
+
+/**
+ * Initialise XXH64 calculation
+ *
+ * @v xxh64		XXH64 calculation
+ */
+static void zstd_xxh64_init ( struct zstd_xxh64 *xxh64 ) {
+
+	/* Initialise accumulators (with a zero seed) */
+	xxh64->acc[0] = ( XXH64_PRIME1 + XXH64_PRIME2 );
+	xxh64->acc[1] = XXH64_PRIME2;
+	xxh64->acc[2] = 0;
+	xxh64->acc[3] = -XXH64_PRIME1;
+	xxh64->len = 0;
+}
+
+/**
+ * Process XXH64 stripe
+ *
+ * @v xxh64		XXH64 calculation
+ * @v data		32-byte stripe
+ */
+static void zstd_xxh64_stripe ( struct zstd_xxh64 *xxh64,
+				const uint8_t *data ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < 4 ; i++ ) {
+		xxh64->acc[i] = zstd_xxh64_round ( xxh64->acc[i],
+						   zstd_le64 ( data ) );
+		data += sizeof ( uint64_t );
+	}
+}
+
+/**
+ * Update XXH64 calculation
+ *
+ * @v xxh64		XXH64 calculation
+ * @v data		Data
+ * @v len		Length of data
+ */
+static void zstd_xxh64_update ( struct zstd_xxh64 *xxh64, const void *data,
+				size_t len ) {
+	const uint8_t *bytes = data;
+	size_t used = ( xxh64->len % sizeof ( xxh64->buf ) );
+	size_t frag;
+
+	xxh64->len += len;
+	while ( len ) {
+		if ( ( used == 0 ) && ( len >= sizeof ( xxh64->buf ) ) ) {
+			zstd_xxh64_stripe ( xxh64, bytes );
+			frag = sizeof ( xxh64->buf );
+		} else {
+			frag = ( sizeof ( xxh64->buf ) - used );
+			if ( frag > len )
+				frag = len;
+			memcpy ( &xxh64->buf[used], bytes, frag );
+			used += frag;
+			if ( used == sizeof ( xxh64->buf ) ) {
+				zstd_xxh64_stripe ( xxh64, xxh64->buf );
+				used = 0;
+			}
+		}
+		bytes += frag;
+		len -= frag;
+	}
+}
+
+/**
+ * Finalise XXH64 calculation
+ *
+ * @v xxh64		XXH64 calculation
+ * @ret checksum	Content checksum (low 32 bits of hash)
+ */
+static uint32_t zstd_xxh64_final ( struct zstd_xxh64 *xxh64 ) {
+	static const unsigned int rotations[4] = { 1, 7, 12, 18 };
+	const uint8_t *bytes = xxh64->buf;
+	size_t remaining = ( xxh64->len % sizeof ( xxh64->buf ) );
+	uint64_t hash;
+	unsigned int i;
+
+	/* Merge accumulators */
+	if ( xxh64->len >= sizeof ( xxh64->buf ) ) {
+		hash = 0;
+		for ( i = 0 ; i < 4 ; i++ )
+			hash += rol64 ( xxh64->acc[i], rotations[i] );
+		for ( i = 0 ; i < 4 ; i++ ) {
+			hash ^= zstd_xxh64_round ( 0, xxh64->acc[i] );
+			hash = ( ( hash * XXH64_PRIME1 ) + XXH64_PRIME4 );
+		}
+	} else {
+		hash = XXH64_PRIME5;
+	}
+	hash += xxh64->len;
+
+	/* Process remaining data */
+	for ( ; remaining >= 8 ; bytes += 8, remaining -= 8 ) {
+		hash ^= zstd_xxh64_round ( 0, zstd_le64 ( bytes ) );
+		hash = ( ( rol64 ( hash, 27 ) * XXH64_PRIME1 ) + XXH64_PRIME4 );
+	}
+	if ( remaining >= 4 ) {
+		hash ^= ( zstd_le32 ( bytes ) * XXH64_PRIME1 );
+		hash = ( ( rol64 ( hash, 23 ) * XXH64_PRIME2 ) + XXH64_PRIME3 );
+		bytes += 4;
+		remaining -= 4;
+	}
+	for ( ; remaining ; bytes++, remaining-- ) {
+		hash ^= ( *bytes * XXH64_PRIME5 );
+		hash = ( rol64 ( hash, 11 ) * XXH64_PRIME1 );
+	}
+
+	/* Avalanche */
+	hash ^= ( hash >> 33 );
+	hash *= XXH64_PRIME2;
+	hash ^= ( hash >> 29 );
+	hash *= XXH64_PRIME3;
+	hash ^= ( hash >> 32 );
+
+	return ( hash & 0xffffffffUL );
+}
+
+/******************************************************************************
+ *
+ * Bitstreams
+ *
+ ******************************************************************************
+ */
+
+/** A backward bitstream */
+struct zstd_bitstream {
+	/** Data */
+	const uint8_t *data;
+	/** Length of data */
+	size_t len;
+	/** Number of unconsumed bits (may go negative on overread) */
+	ssize_t pos;
+};
+
+/**
+ * Extract bits from little-endian bit sequence
+ *
+ * @v data		Data
+ * @v len		Length of data
+ * @v start		Starting bit position (may be negative)
+ * @v count		Number of bits (at most 32)
+ * @ret value		Extracted value
+ *
+ * Bits outside of the data are read as zero.
+ */
+static uint32_t zstd_bits ( const uint8_t *data, size_t len, ssize_t start,
+			    unsigned int count ) {
+	uint64_t value = 0;
+	size_t offset;
+	unsigned int shift;
+	unsigned int i;
+
+	/* Treat bits before the start of the data as zero */
+	if ( start < 0 ) {
+		if ( ( start + ( ssize_t ) count ) <= 0 )
+			return 0;
+		return ( zstd_bits ( data, len, 0, ( count + start ) )
+			 << ( -start ) );
+	}
+
+	/* Gather bytes */
+	offset = ( start / 8 );
+	shift = ( start % 8 );
+	for ( i = 0 ; ( 8 * i ) < ( shift + count ) ; i++ ) {
+		if ( ( offset + i ) < len )
+			value |= ( ( ( uint64_t ) data[ offset + i ] ) <<
+				   ( 8 * i ) );
+	}
+
+	return ( ( value >> shift ) & ( ( 1ULL << count ) - 1 ) );
+}
+
+/**
+ * Initialise backward bitstream
+ *
+ * @v bits		Bitstream
+ * @v data		Data
+ * @v len		Length of data
+ * @ret rc		Return status code
+ */
+static int zstd_bitstream_init ( struct zstd_bitstream *bits,
+				 const uint8_t *data, size_t len ) {
+	unsigned int last;
+
+	/* Locate padding marker bit in final byte */
+	if ( ! len )
+		return -EINVAL;
+	last = data[ len - 1 ];
+	if ( ! last )
+		return -EINVAL;
+	bits->data = data;
+	bits->len = len;
+	bits->pos = ( ( 8 * ( len - 1 ) ) + fls ( last ) - 1 );
+
+	return 0;
+}
+
+/**
+ * Peek at bits from backward bitstream
+ *
+ * @v bits		Bitstream
+ * @v count		Number of bits
+ * @ret value		Value
+ */
+static inline uint32_t zstd_bitstream_peek ( struct zstd_bitstream *bits,
+					     unsigned int count ) {
+
+	return zstd_bits ( bits->data, bits->len,
+			   ( bits->pos - ( ssize_t ) count ), count );
+}
+
+/**
+ * Read bits from backward bitstream
+ *
+ * @v bits		Bitstream
+ * @v count		Number of bits
+ * @ret value		Value
+ */
+static inline uint32_t zstd_bitstream_read ( struct zstd_bitstream *bits,
+					     unsigned int count ) {
+	uint32_t value;
+
+	value = zstd_bitstream_peek ( bits, count );
+	bits->pos -= count;
+	return value;
+}
+
+/******************************************************************************
+ *
+ * Finite State Entropy tables
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Build FSE decoding table
+ *
+ * @v fse		FSE table to fill in
+ * @v norm		Normalised probabilities
+ * @v count		Number of symbols
+ * @v log		Accuracy log
+ * @ret rc		Return status code
+ */
+static int zstd_fse_build ( struct zstd_fse *fse, const int16_t *norm,
+			    unsigned int count, unsigned int log ) {
+	uint16_t next[ ZSTD_ML_MAX_CODE + 1 ];
+	unsigned int size = ( 1 << log );
+	unsigned int mask = ( size - 1 );
+	unsigned int step = ( ( size >> 1 ) + ( size >> 3 ) + 3 );
+	unsigned int high = ( size - 1 );
+	unsigned int pos = 0;
+	unsigned int symbol;
+	unsigned int state;
+	unsigned int bits;
+	int i;
+
+	/* Sanity checks */
+	assert ( log <= ZSTD_FSE_MAX_LOG );
+	assert ( count <= ( sizeof ( next ) / sizeof ( next[0] ) ) );
+
+	/* Place low-probability symbols at the top of the table */
+	for ( symbol = 0 ; symbol < count ; symbol++ ) {
+		if ( norm[symbol] < 0 ) {
+			fse->entry[ high-- ].symbol = symbol;
+			next[symbol] = 1;
+		} else {
+			next[symbol] = norm[symbol];
+		}
+	}
+
+	/* Spread remaining symbols */
+	for ( symbol = 0 ; symbol < count ; symbol++ ) {
+		for ( i = 0 ; i < norm[symbol] ; i++ ) {
+			fse->entry[pos].symbol = symbol;
+			do {
+				pos = ( ( pos + step ) & mask );
+			} while ( pos > high );
+		}
+	}
+	if ( pos != 0 )
+		return -EINVAL;
+
+	/* Calculate state transitions */
+	for ( pos = 0 ; pos < size ; pos++ ) {
+		symbol = fse->entry[pos].symbol;
+		state = next[symbol]++;
+		bits = ( log + 1 - fls ( state ) );
+		fse->entry[pos].bits = bits;
+		fse->entry[pos].base = ( ( state << bits ) - size );
+	}
+	fse->log = log;
+	fse->valid = 1;
+
+	return 0;
+}
+
+/**
+ * Parse FSE table description
+ *
+ * @v fse		FSE table to fill in
+ * @v data		Data
+ * @v len		Length of data
+ * @v max_log		Maximum accuracy log
+ * @v max_symbol	Maximum symbol value
+ * @v used		Length of description to fill in
+ * @ret rc		Return status code
+ */
+static int zstd_fse_parse ( struct zstd_fse *fse, const uint8_t *data,
+			    size_t len, unsigned int max_log,
+			    unsigned int max_symbol, size_t *used ) {
+	int16_t norm[ ZSTD_ML_MAX_CODE + 1 ];
+	ssize_t pos = 0;
+	unsigned int symbol = 0;
+	unsigned int log;
+	unsigned int bits;
+	unsigned int repeat;
+	unsigned int i;
+	int threshold;
+	int remaining;
+	int previous0 = 0;
+	int value;
+	int max;
+	int count;
+
+	/* Sanity check */
+	assert ( max_symbol < ( sizeof ( norm ) / sizeof ( norm[0] ) ) );
+
+	/* Parse accuracy log */
+	log = ( zstd_bits ( data, len, pos, 4 ) + 5 );
+	pos += 4;
+	if ( log > max_log )
+		return -EINVAL;
+
+	/* Parse probabilities */
+	threshold = ( 1 << log );
+	remaining = ( threshold + 1 );
+	bits = ( log + 1 );
+	while ( remaining > 1 ) {
+
+		/* Parse runs of zero probabilities */
+		if ( previous0 ) {
+			do {
+				repeat = zstd_bits ( data, len, pos, 2 );
+				pos += 2;
+				for ( i = 0 ; i < repeat ; i++ ) {
+					if ( symbol > max_symbol )
+						return -EINVAL;
+					norm[ symbol++ ] = 0;
+				}
+			} while ( repeat == 3 );
+		}
+		if ( symbol > max_symbol )
+			return -EINVAL;
+
+		/* Parse probability */
+		max = ( ( 2 * threshold ) - 1 - remaining );
+		value = zstd_bits ( data, len, pos, bits );
+		if ( ( value & ( threshold - 1 ) ) < max ) {
+			count = ( value & ( threshold - 1 ) );
+			pos += ( bits - 1 );
+		} else {
+			count = ( value & ( ( 2 * threshold ) - 1 ) );
+			if ( count >= threshold )
+				count -= max;
+			pos += bits;
+		}
+		count--;
+		remaining -= ( ( count < 0 ) ? -count : count );
+		norm[ symbol++ ] = count;
+		previous0 = ( count == 0 );
+		while ( remaining < threshold ) {
+			bits--;
+			threshold >>= 1;
+		}
+	}
+	if ( ( remaining != 1 ) || ( pos > ( ssize_t ) ( 8 * len ) ) )
+		return -EINVAL;
+	*used = ( ( pos + 7 ) / 8 );
+
+	return zstd_fse_build ( fse, norm, symbol, log );
+}
+
+/**
+ * Construct single-symbol FSE table
+ *
+ * @v fse		FSE table to fill in
+ * @v symbol		Symbol
+ */
+static void zstd_fse_rle ( struct zstd_fse *fse, unsigned int symbol ) {
+
+	fse->entry[0].symbol = symbol;
+	fse->entry[0].bits = 0;
+	fse->entry[0].base = 0;
+	fse->log = 0;
+	fse->valid = 1;
+}
+
+/**
+ * Select FSE table for sequence decoding
+ *
+ * @v fse		FSE table
+ * @v mode		Compression mode
+ * @v data		Data
+ * @v len		Length of data
+ * @v norm		Predefined distribution
+ * @v count		Number of symbols in predefined distribution
+ * @v log		Predefined accuracy log
+ * @v max_log		Maximum accuracy log
+ * @v max_symbol	Maximum symbol value
+ * @v used		Length of table description to fill in
+ * @ret rc		Return status code
+ */
+static int zstd_fse_select ( struct zstd_fse *fse, unsigned int mode,
+			     const uint8_t *data, size_t len,
+			     const int16_t *norm, unsigned int count,
+			     unsigned int log, unsigned int max_log,
+			     unsigned int max_symbol, size_t *used ) {
+
+	*used = 0;
+	switch ( mode ) {
+	case ZSTD_MODE_PREDEFINED:
+		return zstd_fse_build ( fse, norm, count, log );
+	case ZSTD_MODE_RLE:
+		if ( ( len < 1 ) || ( data[0] > max_symbol ) )
+			return -EINVAL;
+		zstd_fse_rle ( fse, data[0] );
+		*used = 1;
+		return 0;
+	case ZSTD_MODE_FSE:
+		fse->valid = 0;
+		return zstd_fse_parse ( fse, data, len, max_log, max_symbol,
+					used );
+	case ZSTD_MODE_REPEAT:
+		return ( fse->valid ? 0 : -EINVAL );
+	default:
+		assert ( 0 );
+		return -EINVAL;
+	}
+}
+
+/**
+ * Read initial FSE state
+ *
+ * @v fse		FSE table
+ * @v bits		Bitstream
+ * @ret state		State
+ */
+static inline unsigned int zstd_fse_init ( struct zstd_fse *fse,
+					   struct zstd_bitstream *bits ) {
+
+	return zstd_bitstream_read ( bits, fse->log );
+}
+
+/**
+ * Update FSE state
+ *
+ * @v fse		FSE table
+ * @v bits		Bitstream
+ * @v state		Current state
+ * @ret state		Next state
+ */
+static inline unsigned int zstd_fse_next ( struct zstd_fse *fse,
+					   struct zstd_bitstream *bits,
+					   unsigned int state ) {
+	struct zstd_fse_entry *entry = &fse->entry[state];
+
+	return ( entry->base + zstd_bitstream_read ( bits, entry->bits ) );
+}
+
+/******************************************************************************
+ *
+ * Literals
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Parse Huffman tree description
+ *
+ * @v zstd		Decompressor
+ * @v data		Data
+ * @v len		Length of data
+ * @v used		Length of description to fill in
+ * @ret rc		Return status code
+ */
+static int zstd_huffman_parse ( struct zstd *zstd, const uint8_t *data,
+				size_t len, size_t *used ) {
+	struct zstd_huffman *huffman = &zstd->huffman;
+	struct zstd_fse *fse = &zstd->weights;
+	struct zstd_bitstream bits;
+	uint8_t weights[ ZSTD_HUFFMAN_MAX_WEIGHTS + 1 ];
+	struct zstd_huffman_entry *entry;
+	unsigned int count = 0;
+	unsigned int header;
+	unsigned int state[2];
+	unsigned int weight;
+	unsigned int symbol;
+	unsigned int total;
+	unsigned int sum;
+	unsigned int rest;
+	unsigned int max;
+	unsigned int i;
+	size_t desc_len;
+	size_t fse_len;
+	int rc;
+
+	/* Invalidate any existing table */
+	huffman->bits = 0;
+
+	/* Parse header byte */
+	if ( ! len )
+		return -EINVAL;
+	header = data[0];
+	if ( header >= 128 ) {
+
+		/* Weights are stored directly as 4-bit values */
+		count = ( header - 127 );
+		desc_len = ( 1 + ( ( count + 1 ) / 2 ) );
+		if ( desc_len > len )
+			return -EINVAL;
+		for ( i = 0 ; i < count ; i++ ) {
+			weight = data[ 1 + ( i / 2 ) ];
+			weights[i] = ( ( i & 1 ) ? ( weight & 0x0f ) :
+				       ( weight >> 4 ) );
+		}
+
+	} else {
+
+		/* Weights are FSE-compressed */
+		desc_len = ( 1 + header );
+		if ( desc_len > len )
+			return -EINVAL;
+		if ( ( rc = zstd_fse_parse ( fse, &data[1], header,
+					     ZSTD_HUFFMAN_FSE_MAX_LOG,
+					     ZSTD_HUFFMAN_MAX_BITS,
+					     &fse_len ) ) != 0 )
+			return rc;
+		if ( ( rc = zstd_bitstream_init ( &bits, &data[ 1 + fse_len ],
+						  ( header - fse_len ) ) ) != 0)
+			return rc;
+
+		/* Decode weights using two interleaved states */
+		state[0] = zstd_fse_init ( fse, &bits );
+		state[1] = zstd_fse_init ( fse, &bits );
+		for ( i = 0 ; ; i ^= 1 ) {
+			if ( count >= ZSTD_HUFFMAN_MAX_WEIGHTS )
+				return -EINVAL;
+			weights[ count++ ] = fse->entry[ state[i] ].symbol;
+			state[i] = zstd_fse_next ( fse, &bits, state[i] );
+			if ( bits.pos < 0 ) {
+				if ( count >= ZSTD_HUFFMAN_MAX_WEIGHTS )
+					return -EINVAL;
+				weights[ count++ ] =
+					fse->entry[ state[ i ^ 1 ] ].symbol;
+				break;
+			}
+		}
+	}
+
+	/* Calculate implied final weight */
+	sum = 0;
+	for ( i = 0 ; i < count ; i++ ) {
+		weight = weights[i];
+		if ( weight > ZSTD_HUFFMAN_MAX_BITS )
+			return -EINVAL;
+		if ( weight )
+			sum += ( 1 << ( weight - 1 ) );
+	}
+	if ( ! sum )
+		return -EINVAL;
+	max = fls ( sum );
+	if ( max > ZSTD_HUFFMAN_MAX_BITS )
+		return -EINVAL;
+	total = ( 1 << max );
+	rest = ( total - sum );
+	if ( rest & ( rest - 1 ) )
+		return -EINVAL;
+	weights[ count++ ] = fls ( rest );
+
+	/* Construct decoding table, in order of increasing weight */
+	entry = huffman->entry;
+	for ( weight = 1 ; weight <= max ; weight++ ) {
+		for ( symbol = 0 ; symbol < count ; symbol++ ) {
+			if ( weights[symbol] != weight )
+				continue;
+			for ( i = ( 1 << ( weight - 1 ) ) ; i ; i-- ) {
+				entry->symbol = symbol;
+				entry->bits = ( max + 1 - weight );
+				entry++;
+			}
+		}
+	}
+	assert ( entry == &huffman->entry[total] );
+	huffman->bits = max;
+	DBGC2 ( zstd, "ZSTD %p Huffman table with %d symbols of up to %d "
+		"bits\n", zstd, count, max );
+
+	*used = desc_len;
+	return 0;
+}
+
+/**
+ * Decode Huffman-coded literals stream
+ *
+ * @v huffman		Huffman table
+ * @v data		Data
+ * @v len		Length of data
+ * @v out		Output buffer
+ * @v count		Number of literals to decode
+ * @ret rc		Return status code
+ */
+static int zstd_huffman_stream ( struct zstd_huffman *huffman,
+				 const uint8_t *data, size_t len,
+				 uint8_t *out, size_t count ) {
+	struct zstd_huffman_entry *entry;
+	struct zstd_bitstream bits;
+	unsigned int index;
+	int rc;
+
+	/* Initialise bitstream */
+	if ( ( rc = zstd_bitstream_init ( &bits, data, len ) ) != 0 )
+		return rc;
+
+	/* Decode literals */
+	while ( count-- ) {
+		index = zstd_bitstream_peek ( &bits, huffman->bits );
+		entry = &huffman->entry[index];
+		*(out++) = entry->symbol;
+		bits.pos -= entry->bits;
+	}
+
+	/* Check that stream was consumed exactly */
+	if ( bits.pos != 0 )
+		return -EINVAL;
+
+	return 0;
+}
+
+/**
+ * Parse literals section
+ *
+ * @v zstd		Decompressor
+ * @v data		Data
+ * @v len		Length of data
+ * @v literals		Literals to fill in
+ * @v count		Number of literals to fill in
+ * @v used		Length of literals section to fill in
+ * @ret rc		Return status code
+ */
+static int zstd_literals ( struct zstd *zstd, const uint8_t *data,
+			   size_t len, const uint8_t **literals,
+			   size_t *count, size_t *used ) {
+	uint8_t *buffer = user_to_virt ( zstd->buffer, ZSTD_LITERALS_OFFSET );
+	const uint8_t *jump;
+	unsigned int type;
+	unsigned int format;
+	unsigned int streams;
+	uint64_t header;
+	size_t header_len;
+	size_t regen;
+	size_t compressed;
+	size_t tree_len;
+	size_t stream_len;
+	size_t segment;
+	size_t frag;
+	unsigned int i;
+	int rc;
+
+	/* Parse literals section header */
+	if ( ! len )
+		return -EINVAL;
+	type = ( data[0] & 0x03 );
+	format = ( ( data[0] >> 2 ) & 0x03 );
+	if ( ( type == ZSTD_LITERALS_RAW ) || ( type == ZSTD_LITERALS_RLE ) ) {
+		switch ( format ) {
+		case 1:
+			header_len = 2;
+			break;
+		case 3:
+			header_len = 3;
+			break;
+		default:
+			header_len = 1;
+			break;
+		}
+		if ( header_len > len )
+			return -EINVAL;
+		if ( header_len == 1 ) {
+			regen = ( data[0] >> 3 );
+		} else {
+			regen = ( ( data[0] >> 4 ) | ( data[1] << 4 ) );
+			if ( header_len == 3 )
+				regen |= ( data[2] << 12 );
+		}
+		if ( regen > ZSTD_BLOCK_MAX )
+			return -EINVAL;
+		*count = regen;
+		if ( type == ZSTD_LITERALS_RAW ) {
+			if ( ( header_len + regen ) > len )
+				return -EINVAL;
+			*literals = &data[header_len];
+			*used = ( header_len + regen );
+		} else {
+			if ( ( header_len + 1 ) > len )
+				return -EINVAL;
+			memset ( buffer, data[header_len], regen );
+			*literals = buffer;
+			*used = ( header_len + 1 );
+		}
+		return 0;
+	}
+
+	/* Parse Huffman-coded literals section header */
+	streams = ( format ? 4 : 1 );
+	header_len = ( ( format < 2 ) ? 3 : ( format + 2 ) );
+	if ( header_len > len )
+		return -EINVAL;
+	header = 0;
+	for ( i = 0 ; i < header_len ; i++ )
+		header |= ( ( ( uint64_t ) data[i] ) << ( 8 * i ) );
+	header >>= 4;
+	switch ( format ) {
+	case 2:
+		regen = ( header & 0x3fff );
+		compressed = ( ( header >> 14 ) & 0x3fff );
+		break;
+	case 3:
+		regen = ( header & 0x3ffff );
+		compressed = ( ( header >> 18 ) & 0x3ffff );
+		break;
+	default:
+		regen = ( header & 0x3ff );
+		compressed = ( ( header >> 10 ) & 0x3ff );
+		break;
+	}
+	if ( ( regen > ZSTD_BLOCK_MAX ) ||
+	     ( ( header_len + compressed ) > len ) )
+		return -EINVAL;
+	data += header_len;
+	*used = ( header_len + compressed );
+	*literals = buffer;
+	*count = regen;
+
+	/* Parse Huffman tree description, if present */
+	if ( type == ZSTD_LITERALS_COMPRESSED ) {
+		if ( ( rc = zstd_huffman_parse ( zstd, data, compressed,
+						 &tree_len ) ) != 0 )
+			return rc;
+		data += tree_len;
+		compressed -= tree_len;
+	} else if ( ! zstd->huffman.bits ) {
+		DBGC ( zstd, "ZSTD %p treeless literals without table\n",
+		       zstd );
+		return -EINVAL;
+	}
+
+	/* Decode single stream, if applicable */
+	if ( streams == 1 ) {
+		return zstd_huffman_stream ( &zstd->huffman, data, compressed,
+					     buffer, regen );
+	}
+
+	/* Decode four streams using jump table */
+	if ( compressed < 6 )
+		return -EINVAL;
+	segment = ( ( regen + 3 ) / 4 );
+	if ( ( 3 * segment ) > regen )
+		return -EINVAL;
+	jump = data;
+	data += 6;
+	stream_len = ( compressed - 6 );
+	for ( i = 0 ; i < 4 ; i++ ) {
+		if ( i < 3 ) {
+			frag = ( jump[ 2 * i ] | ( jump[ 2 * i + 1 ] << 8 ) );
+			if ( frag > stream_len )
+				return -EINVAL;
+			stream_len -= frag;
+		} else {
+			frag = stream_len;
+			segment = regen;
+		}
+		if ( ( rc = zstd_huffman_stream ( &zstd->huffman, data, frag,
+						  buffer, segment ) ) != 0 )
+			return rc;
+		data += frag;
+		buffer += segment;
+		regen -= segment;
+	}
+
+	return 0;
+}
+
+/******************************************************************************
+ *
+ * Sequences
+ *
+ ******************************************************************************
+ */
+
+/** Block output */
+struct zstd_output {
+	/** Output buffer */
+	uint8_t *data;
+	/** Length of output produced */
+	size_t len;
+	/** Maximum length of output */
+	size_t max;
+	/** Length of history available before output buffer */
+	size_t history;
+};
+
+/**
+ * Copy literals to block output
+ *
+ * @v output		Block output
+ * @v literals		Literals
+ * @v count		Number of literals
+ * @ret rc		Return status code
+ */
+static int zstd_copy_literals ( struct zstd_output *output,
+				const uint8_t *literals, size_t count ) {
+
+	if ( count > ( output->max - output->len ) )
+		return -EINVAL;
+	memcpy ( &output->data[output->len], literals, count );
+	output->len += count;
+	return 0;
+}
+
+/**
+ * Copy match to block output
+ *
+ * @v zstd		Decompressor
+ * @v output		Block output
+ * @v offset		Match offset
+ * @v len		Match length
+ * @ret rc		Return status code
+ */
+static int zstd_copy_match ( struct zstd *zstd, struct zstd_output *output,
+			     size_t offset, size_t len ) {
+	uint8_t *dst = &output->data[output->len];
+	const uint8_t *src = ( dst - offset );
+
+	/* Validate offset and length */
+	if ( ( offset > ( output->history + output->len ) ) ||
+	     ( offset > zstd->window ) ) {
+		DBGC ( zstd, "ZSTD %p invalid offset %zd\n", zstd, offset );
+		return -EINVAL;
+	}
+	if ( len > ( output->max - output->len ) )
+		return -EINVAL;
+	output->len += len;
+
+	/* Copy match, allowing for overlap */
+	if ( offset >= len ) {
+		memcpy ( dst, src, len );
+	} else {
+		while ( len-- )
+			*(dst++) = *(src++);
+	}
+
+	return 0;
+}
+
+/**
+ * Parse and execute sequences section
+ *
+ * @v zstd		Decompressor
+ * @v data		Data
+ * @v len		Length of data
+ * @v literals		Literals
+ * @v count		Number of literals
+ * @v output		Block output
+ * @ret rc		Return status code
+ */
+static int zstd_sequences ( struct zstd *zstd, const uint8_t *data,
+			    size_t len, const uint8_t *literals, size_t count,
+			    struct zstd_output *output ) {
+	struct zstd_bitstream bits;
+	unsigned int ll_state;
+	unsigned int of_state;
+	unsigned int ml_state;
+	unsigned int ll_code;
+	unsigned int of_code;
+	unsigned int ml_code;
+	unsigned int modes;
+	unsigned int index;
+	unsigned int sequences;
+	uint32_t *repeat = zstd->repeat;
+	uint32_t value;
+	size_t offset;
+	size_t ll;
+	size_t ml;
+	size_t used;
+	size_t frag;
+	int rc;
+
+	/* Parse number of sequences */
+	if ( len < 1 )
+		return -EINVAL;
+	if ( data[0] < 128 ) {
+		sequences = data[0];
+		used = 1;
+	} else if ( data[0] < 255 ) {
+		if ( len < 2 )
+			return -EINVAL;
+		sequences = ( ( ( data[0] - 128 ) << 8 ) + data[1] );
+		used = 2;
+	} else {
+		if ( len < 3 )
+			return -EINVAL;
+		sequences = ( data[1] + ( data[2] << 8 ) + 0x7f00 );
+		used = 3;
+	}
+
+	/* Parse symbol compression modes and tables, if applicable */
+	if ( sequences ) {
+		if ( used >= len )
+			return -EINVAL;
+		modes = data[ used++ ];
+		if ( modes & 0x03 )
+			return -EINVAL;
+		if ( ( rc = zstd_fse_select ( &zstd->ll, ( modes >> 6 ),
+					      &data[used], ( len - used ),
+					      zstd_ll_default,
+					      ( ZSTD_LL_MAX_CODE + 1 ),
+					      ZSTD_LL_DEFAULT_LOG,
+					      ZSTD_LL_MAX_LOG,
+					      ZSTD_LL_MAX_CODE,
+					      &frag ) ) != 0 )
+			return rc;
+		used += frag;
+		if ( ( rc = zstd_fse_select ( &zstd->of,
+					      ( ( modes >> 4 ) & 0x03 ),
+					      &data[used], ( len - used ),
+					      zstd_of_default,
+					      ( sizeof ( zstd_of_default ) /
+						sizeof ( zstd_of_default[0] ) ),
+					      ZSTD_OF_DEFAULT_LOG,
+					      ZSTD_OF_MAX_LOG,
+					      ZSTD_OF_MAX_CODE,
+					      &frag ) ) != 0 )
+			return rc;
+		used += frag;
+		if ( ( rc = zstd_fse_select ( &zstd->ml,
+					      ( ( modes >> 2 ) & 0x03 ),
+					      &data[used], ( len - used ),
+					      zstd_ml_default,
+					      ( ZSTD_ML_MAX_CODE + 1 ),
+					      ZSTD_ML_DEFAULT_LOG,
+					      ZSTD_ML_MAX_LOG,
+					      ZSTD_ML_MAX_CODE,
+					      &frag ) ) != 0 )
+			return rc;
+		used += frag;
+		if ( ( rc = zstd_bitstream_init ( &bits, &data[used],
+						  ( len - used ) ) ) != 0 )
+			return rc;
+		ll_state = zstd_fse_init ( &zstd->ll, &bits );
+		of_state = zstd_fse_init ( &zstd->of, &bits );
+		ml_state = zstd_fse_init ( &zstd->ml, &bits );
+	} else {
+		if ( used != len )
+			return -EINVAL;
+		ll_state = of_state = ml_state = 0;
+		memset ( &bits, 0, sizeof ( bits ) );
+	}
+
+	/* Execute sequences */
+	while ( sequences-- ) {
+
+		/* Decode codes */
+		ll_code = zstd->ll.entry[ll_state].symbol;
+		of_code = zstd->of.entry[of_state].symbol;
+		ml_code = zstd->ml.entry[ml_state].symbol;
+
+		/* Decode values, in bitstream order */
+		value = ( ( 1UL << of_code ) |
+			  zstd_bitstream_read ( &bits, of_code ) );
+		ml = ( zstd_ml[ml_code].base +
+		       zstd_bitstream_read ( &bits, zstd_ml[ml_code].bits ) );
+		ll = ( zstd_ll[ll_code].base +
+		       zstd_bitstream_read ( &bits, zstd_ll[ll_code].bits ) );
+
+		/* Resolve offset and update repeated offsets */
+		if ( value > ZSTD_REPEAT_COUNT ) {
+			offset = ( value - ZSTD_REPEAT_COUNT );
+			repeat[2] = repeat[1];
+			repeat[1] = repeat[0];
+			repeat[0] = offset;
+		} else {
+			index = ( value - ( ll ? 1 : 0 ) );
+			if ( index == 0 ) {
+				offset = repeat[0];
+			} else {
+				offset = ( ( index < ZSTD_REPEAT_COUNT ) ?
+					   repeat[index] : ( repeat[0] - 1 ) );
+				if ( index != 1 )
+					repeat[2] = repeat[1];
+				repeat[1] = repeat[0];
+				repeat[0] = offset;
+			}
+		}
+		if ( ! offset )
+			return -EINVAL;
+
+		/* Execute sequence */
+		if ( ll > count )
+			return -EINVAL;
+		if ( ( rc = zstd_copy_literals ( output, literals, ll ) ) != 0)
+			return rc;
+		literals += ll;
+		count -= ll;
+		if ( ( rc = zstd_copy_match ( zstd, output, offset,
+					      ml ) ) != 0 )
+			return rc;
+
+		/* Update states, unless this was the final sequence */
+		if ( sequences ) {
+			ll_state = zstd_fse_next ( &zstd->ll, &bits, ll_state );
+			ml_state = zstd_fse_next ( &zstd->ml, &bits, ml_state );
+			of_state = zstd_fse_next ( &zstd->of, &bits, of_state );
+		}
+		if ( bits.pos < 0 )
+			return -EINVAL;
+	}
+	if ( bits.pos != 0 )
+		return -EINVAL;
+
+	/* Copy any remaining literals */
+	return zstd_copy_literals ( output, literals, count );
+}
+
+/******************************************************************************
+ *
+ * Frames and blocks
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Get maximum block size
+ *
+ * @v zstd		Decompressor
+ * @ret max		Maximum block size
+ */
+static inline size_t zstd_block_max ( struct zstd *zstd ) {
+
+	return ( ( zstd->window < ZSTD_BLOCK_MAX ) ?
+		 zstd->window : ZSTD_BLOCK_MAX );
+}
+
+/**
+ * Record produced content
+ *
+ * @v zstd		Decompressor
+ * @v out		Output data buffer
+ * @v len		Length of content produced
+ */
+static void zstd_produced ( struct zstd *zstd, struct deflate_chunk *out,
+			    size_t len ) {
+
+	if ( zstd->descriptor & ZSTD_FHD_CHECKSUM ) {
+		zstd_xxh64_update ( &zstd->xxh64,
+				    user_to_virt ( out->data, out->offset ),
+				    len );
+	}
+	out->offset += len;
+	zstd->produced += len;
+}
+
+/**
+ * Decode compressed block
+ *
+ * @v zstd		Decompressor
+ * @v out		Output data buffer
+ * @ret rc		Return status code
+ */
+static int zstd_block ( struct zstd *zstd, struct deflate_chunk *out ) {
+	const uint8_t *data = user_to_virt ( zstd->buffer, 0 );
+	size_t len = zstd->block_len;
+	struct zstd_output output;
+	const uint8_t *literals;
+	size_t count;
+	size_t used;
+	int rc;
+
+	/* Construct block output */
+	output.data = user_to_virt ( out->data, out->offset );
+	output.len = 0;
+	output.max = zstd_block_max ( zstd );
+	assert ( output.max <= ( out->len - out->offset ) );
+	output.history = ( ( zstd->produced < out->offset ) ?
+			   zstd->produced : out->offset );
+
+	/* Parse literals section */
+	if ( ( rc = zstd_literals ( zstd, data, len, &literals, &count,
+				    &used ) ) != 0 ) {
+		DBGC ( zstd, "ZSTD %p invalid literals section: %s\n",
+		       zstd, strerror ( rc ) );
+		return rc;
+	}
+
+	/* Parse and execute sequences section */
+	if ( ( rc = zstd_sequences ( zstd, &data[used], ( len - used ),
+				     literals, count, &output ) ) != 0 ) {
+		DBGC ( zstd, "ZSTD %p invalid sequences section: %s\n",
+		       zstd, strerror ( rc ) );
+		return rc;
+	}
+
+	/* Record produced content */
+	zstd_produced ( zstd, out, output.len );
+
+	return 0;
+}
+
+/**
+ * Accumulate header
+ *
+ * @v zstd		Decompressor
+ * @v in		Compressed input data
+ * @v len		Required header length
+ * @ret complete	Header is complete
+ */
+static int zstd_accumulate ( struct zstd *zstd, struct deflate_chunk *in,
+			     size_t len ) {
+	size_t frag;
+
+	/* Copy as much as possible of the header */
+	assert ( len <= sizeof ( zstd->header ) );
+	assert ( zstd->header_len <= len );
+	frag = ( len - zstd->header_len );
+	if ( frag > ( in->len - in->offset ) )
+		frag = ( in->len - in->offset );
+	copy_from_user ( &zstd->header[zstd->header_len], in->data,
+			 in->offset, frag );
+	in->offset += frag;
+	zstd->header_len += frag;
+
+	return ( zstd->header_len == len );
+}
+
+/**
+ * Get length of frame header (excluding magic and descriptor)
+ *
+ * @v descriptor	Frame header descriptor
+ * @ret len		Length of frame header
+ */
+static size_t zstd_frame_header_len ( unsigned int descriptor ) {
+	static const uint8_t did_len[4] = { 0, 1, 2, 4 };
+	static const uint8_t fcs_len[4] = { 0, 2, 4, 8 };
+	unsigned int fcs = ( descriptor >> ZSTD_FHD_FCS_SHIFT );
+	size_t len;
+
+	len = ( did_len[ descriptor & ZSTD_FHD_DID_MASK ] + fcs_len[fcs] );
+	if ( descriptor & ZSTD_FHD_SINGLE ) {
+		if ( ! fcs )
+			len += 1;
+	} else {
+		len += 1;
+	}
+	return len;
+}
+
+/**
+ * Parse frame header
+ *
+ * @v zstd		Decompressor
+ * @ret rc		Return status code
+ */
+static int zstd_frame_header ( struct zstd *zstd ) {
+	unsigned int descriptor = zstd->descriptor;
+	unsigned int fcs = ( descriptor >> ZSTD_FHD_FCS_SHIFT );
+	const uint8_t *header = zstd->header;
+	unsigned int exponent;
+	unsigned int mantissa;
+	uint64_t window;
+	uint32_t did = 0;
+	unsigned int i;
+
+	/* Parse window descriptor, if present */
+	if ( ! ( descriptor & ZSTD_FHD_SINGLE ) ) {
+		exponent = ( ( *header >> 3 ) + ZSTD_WINDOW_LOG_MIN );
+		mantissa = ( *header & 0x07 );
+		header++;
+		if ( exponent > 32 ) {
+			DBGC ( zstd, "ZSTD %p unsupported window size 2^%d\n",
+			       zstd, exponent );
+			return -ENOTSUP;
+		}
+		window = ( 1ULL << exponent );
+		window += ( ( window / 8 ) * mantissa );
+	} else {
+		window = 0;
+	}
+
+	/* Parse dictionary ID, if present */
+	for ( i = 0 ; i < ( ( 1U << ( descriptor & ZSTD_FHD_DID_MASK ) ) >> 1 );
+	      i++ ) {
+		did |= ( *(header++) << ( 8 * i ) );
+	}
+	if ( did ) {
+		DBGC ( zstd, "ZSTD %p unsupported dictionary %#08x\n",
+		       zstd, did );
+		return -ENOTSUP;
+	}
+
+	/* Parse frame content size, if present */
+	zstd->content_len = 0;
+	if ( fcs || ( descriptor & ZSTD_FHD_SINGLE ) ) {
+		for ( i = 0 ; i < ( 1U << fcs ) ; i++ ) {
+			zstd->content_len |=
+				( ( ( uint64_t ) *(header++) ) << ( 8 * i ) );
+		}
+		if ( fcs == 1 )
+			zstd->content_len += 256;
+	}
+	if ( descriptor & ZSTD_FHD_SINGLE )
+		window = zstd->content_len;
+
+	/* Check window size */
+	if ( window > ZSTD_WINDOW_MAX ) {
+		DBGC ( zstd, "ZSTD %p unsupported window size %#llx\n",
+		       zstd, ( ( unsigned long long ) window ) );
+		return -ENOTSUP;
+	}
+	zstd->window = window;
+	DBGC2 ( zstd, "ZSTD %p frame descriptor %#02x window %#zx\n",
+		zstd, descriptor, zstd->window );
+
+	/* Reset frame state */
+	zstd->produced = 0;
+	zstd->repeat[0] = 1;
+	zstd->repeat[1] = 4;
+	zstd->repeat[2] = 8;
+	zstd->huffman.bits = 0;
+	zstd->ll.valid = 0;
+	zstd->of.valid = 0;
+	zstd->ml.valid = 0;
+	zstd_xxh64_init ( &zstd->xxh64 );
+
+	return 0;
+}
+
+/**
+ * Complete frame
+ *
+ * @v zstd		Decompressor
+ * @ret rc		Return status code
+ */
+static int zstd_frame_done ( struct zstd *zstd ) {
+	unsigned int descriptor = zstd->descriptor;
+
+	/* Check frame content size, if present */
+	if ( ( ( descriptor >> ZSTD_FHD_FCS_SHIFT ) ||
+	       ( descriptor & ZSTD_FHD_SINGLE ) ) &&
+	     ( zstd->produced != zstd->content_len ) ) {
+		DBGC ( zstd, "ZSTD %p produced %#llx bytes, expected %#llx\n",
+		       zstd, ( ( unsigned long long ) zstd->produced ),
+		       ( ( unsigned long long ) zstd->content_len ) );
+		return -EINVAL;
+	}
+
+	/* Await next frame */
+	zstd->state = ZSTD_STATE_MAGIC;
+	return 0;
+}
+
+/**
+ * Complete block
+ *
+ * @v zstd		Decompressor
+ * @ret rc		Return status code
+ */
+static int zstd_block_done ( struct zstd *zstd ) {
+
+	/* Await next block header, unless this was the last block */
+	if ( ! ( zstd->block_header & ZSTD_BLOCK_LAST ) ) {
+		zstd->state = ZSTD_STATE_BLOCK_HEADER;
+		return 0;
+	}
+
+	/* Await checksum, if present */
+	if ( zstd->descriptor & ZSTD_FHD_CHECKSUM ) {
+		zstd->state = ZSTD_STATE_CHECKSUM;
+		return 0;
+	}
+
+	return zstd_frame_done ( zstd );
+}
+
+/**
+ * Parse block header
+ *
+ * @v zstd		Decompressor
+ * @ret rc		Return status code
+ */
+static int zstd_block_header ( struct zstd *zstd ) {
+	unsigned int header = ( zstd->header[0] | ( zstd->header[1] << 8 ) |
+				( zstd->header[2] << 16 ) );
+	unsigned int type;
+	size_t len;
+
+	/* Parse header */
+	zstd->block_header = header;
+	type = ( ( header >> ZSTD_BLOCK_TYPE_SHIFT ) & ZSTD_BLOCK_TYPE_MASK );
+	len = ( header >> ZSTD_BLOCK_SIZE_SHIFT );
+	DBGC2 ( zstd, "ZSTD %p block type %d length %#zx%s\n", zstd, type,
+		len, ( ( header & ZSTD_BLOCK_LAST ) ? " (last)" : "" ) );
+	if ( len > zstd_block_max ( zstd ) ) {
+		DBGC ( zstd, "ZSTD %p block length %#zx exceeds %#zx\n",
+		       zstd, len, zstd_block_max ( zstd ) );
+		return -EINVAL;
+	}
+	zstd->remaining = len;
+
+	/* Select next state */
+	switch ( type ) {
+	case ZSTD_BLOCK_RAW:
+		zstd->state = ZSTD_STATE_RAW;
+		break;
+	case ZSTD_BLOCK_RLE:
+		zstd->state = ZSTD_STATE_RLE_BYTE;
+		break;
+	case ZSTD_BLOCK_COMPRESSED:
+		zstd->block_len = 0;
+		zstd->state = ZSTD_STATE_COMPRESSED;
+		break;
+	default:
+		DBGC ( zstd, "ZSTD %p reserved block type\n", zstd );
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * Inflate compressed data
+ *
+ * @v zstd		Decompressor
+ * @v in		Compressed input data
+ * @v out		Output data buffer
+ * @ret rc		Return status code
+ *
+ * The caller can use zstd_finished() to determine whether a
+ * successful return indicates that the decompressor is merely waiting
+ * for more input data.
+ *
+ * Data will never be written beyond the end of the output buffer.
+ * The decompressor will return successfully (with input data
+ * remaining) if it requires more output space in order to continue.
+ * At least zstd_history() bytes of history must be retained before
+ * the current output offset.
+ */
+int zstd_inflate ( struct zstd *zstd, struct deflate_chunk *in,
+		   struct deflate_chunk *out ) {
+	size_t in_remaining;
+	size_t out_remaining;
+	size_t frag;
+	uint32_t magic;
+	int rc;
+
+	while ( 1 ) {
+
+		in_remaining = ( in->len - in->offset );
+		out_remaining = ( out->len - out->offset );
+
+		switch ( zstd->state ) {
+
+		case ZSTD_STATE_MAGIC:
+			if ( ! zstd_accumulate ( zstd, in, sizeof ( magic ) ) )
+				return 0;
+			zstd->header_len = 0;
+			magic = zstd_le32 ( zstd->header );
+			if ( magic == ZSTD_MAGIC ) {
+				zstd->state = ZSTD_STATE_DESCRIPTOR;
+			} else if ( ( magic & ZSTD_SKIPPABLE_MASK ) ==
+				    ZSTD_SKIPPABLE_MAGIC ) {
+				zstd->state = ZSTD_STATE_SKIP_LEN;
+			} else {
+				DBGC ( zstd, "ZSTD %p invalid magic %#08x\n",
+				       zstd, magic );
+				return -EINVAL;
+			}
+			zstd->started = 1;
+			break;
+
+		case ZSTD_STATE_SKIP_LEN:
+			if ( ! zstd_accumulate ( zstd, in,
+						 sizeof ( uint32_t ) ) )
+				return 0;
+			zstd->header_len = 0;
+			zstd->remaining = zstd_le32 ( zstd->header );
+			zstd->state = ZSTD_STATE_SKIP;
+			break;
+
+		case ZSTD_STATE_SKIP:
+			frag = zstd->remaining;
+			if ( frag > in_remaining )
+				frag = in_remaining;
+			in->offset += frag;
+			zstd->remaining -= frag;
+			if ( zstd->remaining )
+				return 0;
+			zstd->state = ZSTD_STATE_MAGIC;
+			break;
+
+		case ZSTD_STATE_DESCRIPTOR:
+			if ( ! zstd_accumulate ( zstd, in, 1 ) )
+				return 0;
+			zstd->header_len = 0;
+			zstd->descriptor = zstd->header[0];
+			if ( zstd->descriptor & ZSTD_FHD_RESERVED ) {
+				DBGC ( zstd, "ZSTD %p invalid descriptor "
+				       "%#02x\n", zstd, zstd->descriptor );
+				return -EINVAL;
+			}
+			zstd->state = ZSTD_STATE_FRAME_HEADER;
+			break;
+
+		case ZSTD_STATE_FRAME_HEADER:
+			frag = zstd_frame_header_len ( zstd->descriptor );
+			if ( ! zstd_accumulate ( zstd, in, frag ) )
+				return 0;
+			zstd->header_len = 0;
+			if ( ( rc = zstd_frame_header ( zstd ) ) != 0 )
+				return rc;
+			zstd->state = ZSTD_STATE_BLOCK_HEADER;
+			break;
+
+		case ZSTD_STATE_BLOCK_HEADER:
+			if ( ! zstd_accumulate ( zstd, in,
+						 ZSTD_BLOCK_HEADER_LEN ) )
+				return 0;
+			zstd->header_len = 0;
+			if ( ( rc = zstd_block_header ( zstd ) ) != 0 )
+				return rc;
+			break;
+
+		case ZSTD_STATE_RAW:
+			frag = zstd->remaining;
+			if ( frag > in_remaining )
+				frag = in_remaining;
+			if ( frag > out_remaining )
+				frag = out_remaining;
+			memcpy_user ( out->data, out->offset, in->data,
+				      in->offset, frag );
+			in->offset += frag;
+			zstd_produced ( zstd, out, frag );
+			zstd->remaining -= frag;
+			if ( zstd->remaining ) {
+				if ( ! frag )
+					return 0;
+				break;
+			}
+			if ( ( rc = zstd_block_done ( zstd ) ) != 0 )
+				return rc;
+			break;
+
+		case ZSTD_STATE_RLE_BYTE:
+			if ( ! zstd_accumulate ( zstd, in, 1 ) )
+				return 0;
+			zstd->header_len = 0;
+			zstd->rle = zstd->header[0];
+			zstd->state = ZSTD_STATE_RLE;
+			break;
+
+		case ZSTD_STATE_RLE:
+			frag = zstd->remaining;
+			if ( frag > out_remaining )
+				frag = out_remaining;
+			memset_user ( out->data, out->offset, zstd->rle, frag );
+			zstd_produced ( zstd, out, frag );
+			zstd->remaining -= frag;
+			if ( zstd->remaining ) {
+				if ( ! frag )
+					return 0;
+				break;
+			}
+			if ( ( rc = zstd_block_done ( zstd ) ) != 0 )
+				return rc;
+			break;
+
+		case ZSTD_STATE_COMPRESSED:
+			frag = zstd->remaining;
+			if ( frag > in_remaining )
+				frag = in_remaining;
+			memcpy_user ( zstd->buffer, zstd->block_len, in->data,
+				      in->offset, frag );
+			in->offset += frag;
+			zstd->block_len += frag;
+			zstd->remaining -= frag;
+			if ( zstd->remaining )
+				return 0;
+			if ( out_remaining < zstd_block_max ( zstd ) )
+				return 0;
+			if ( ( rc = zstd_block ( zstd, out ) ) != 0 )
+				return rc;
+			if ( ( rc = zstd_block_done ( zstd ) ) != 0 )
+				return rc;
+			break;
+
+		case ZSTD_STATE_CHECKSUM:
+			if ( ! zstd_accumulate ( zstd, in, ZSTD_CHECKSUM_LEN ) )
+				return 0;
+			zstd->header_len = 0;
+			if ( zstd_le32 ( zstd->header ) !=
+			     zstd_xxh64_final ( &zstd->xxh64 ) ) {
+				DBGC ( zstd, "ZSTD %p checksum mismatch\n",
+				       zstd );
+				return -EINVAL;
+			}
+			if ( ( rc = zstd_frame_done ( zstd ) ) != 0 )
+				return rc;
+			break;
+
+		default:
+			assert ( 0 );
+			return -EINVAL;
+		}
+	}
+}
+
+/**
+ * Initialise decompressor
+ *
+ * @v zstd		Decompressor
+ * @ret rc		Return status code
+ */
+int zstd_init ( struct zstd *zstd ) {
+
+	/* Reset state */
+	memset ( zstd, 0, sizeof ( *zstd ) );
+
+	/* Allocate block buffer */
+	zstd->buffer = umalloc ( ZSTD_BUFFER_LEN );
+	if ( ! zstd->buffer )
+		return -ENOMEM;
+
+	return 0;
+}
+
+/**
+ * Finalise decompressor
+ *
+ * @v zstd		Decompressor
+ */
+void zstd_fini ( struct zstd *zstd ) {
+
+	ufree ( zstd->buffer );
+	zstd->buffer = UNULL;
+}
+
+/**
+ * Initialise Zstandard decompressor
+ *
+ * @v ctx		Context
+ * @ret rc		Return status code
+ */
+static int zstd_decompress_init ( void *ctx ) {
+
+	return zstd_init ( ctx );
+}
+
+/**
+ * Inflate Zstandard-compressed data
+ *
+ * @v ctx		Context
+ * @v in		Compressed input data
+ * @v out		Output data buffer
+ * @ret rc		Return status code
+ */
+static int zstd_decompress_inflate ( void *ctx, struct deflate_chunk *in,
+				     struct deflate_chunk *out ) {
+
+	return zstd_inflate ( ctx, in, out );
+}
+
+/**
+ * Check if Zstandard decompression has finished
+ *
+ * @v ctx		Context
+ * @ret finished	Decompression has finished
+ */
+static int zstd_decompress_finished ( void *ctx ) {
+
+	return zstd_finished ( ctx );
+}
+
+/**
+ * Get Zstandard history length
+ *
+ * @v ctx		Context
+ * @ret len		Length of output history that must be retained
+ */
+static size_t zstd_decompress_history ( void *ctx ) {
+
+	return zstd_history ( ctx );
+}
+
+/**
+ * Finalise Zstandard decompressor
+ *
+ * @v ctx		Context
+ */
+static void zstd_decompress_fini ( void *ctx ) {
+
+	zstd_fini ( ctx );
+}
+
+/** Zstandard decompression algorithm */
+struct decompressor zstd_decompressor = {
+	.name = "zstd",
+	.ctxsize = sizeof ( struct zstd ),
+	.init = zstd_decompress_init,
+	.inflate = zstd_decompress_inflate,
+	.finished = zstd_decompress_finished,
+	.history = zstd_decompress_history,
+	.fini = zstd_decompress_fini,
+};
@@ -26,6 +26,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include <assert.h>
 #include <byteswap.h>
 #include <errno.h>
 #include <ipxe/list.h>
@@ -33,6 +34,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/xfer.h>
 #include <ipxe/blockdev.h>
 #include <ipxe/scsi.h>
+#include <config/general.h>
 
 /** @file
  *
@@ -43,6 +45,9 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 /** Maximum number of TEST UNIT READY retries */
 #define SCSI_READY_MAX_RETRIES 10
 
+/** Minimum length of each part of a split command */
+#define SCSI_MIN_PART_LEN 32768
+
 /* Error numbers generated by SCSI sense data */
 #define EIO_NO_SENSE __einfo_error ( EINFO_EIO_NO_SENSE )
 #define EINFO_EIO_NO_SENSE \
@@ -163,6 +168,61 @@ void scsi_parse_sense ( const void *data, size_t len,
 	sense->additional = sns->fixed.additional;
 }
 
+/**
+ * Identify block range of SCSI READ or WRITE command
+ *
+ * @v cdb		SCSI CDB
+ * @v lba		Starting logical block address to fill in
+ * @v count		Number of blocks to fill in
+ * @ret rc		Return status code
+ */
+int scsi_cdb_range ( union scsi_cdb *cdb, uint64_t *lba,
+		     unsigned int *count ) {
+
+	/* The READ and WRITE CDBs share a common layout */
+	switch ( cdb->bytes[0] ) {
+	case SCSI_OPCODE_READ_10:
+	case SCSI_OPCODE_WRITE_10:
+		*lba = be32_to_cpu ( cdb->read10.lba );
+		*count = be16_to_cpu ( cdb->read10.len );
+		return 0;
+	case SCSI_OPCODE_READ_16:
+	case SCSI_OPCODE_WRITE_16:
+		*lba = be64_to_cpu ( cdb->read16.lba );
+		*count = be32_to_cpu ( cdb->read16.len );
+		return 0;
+	default:
+		return -ENOTSUP;
+	}
+}
+
+/**
+ * Set block range of SCSI READ or WRITE command
+ *
+ * @v cdb		SCSI CDB
+ * @v lba		Starting logical block address
+ * @v count		Number of blocks
+ */
+void scsi_cdb_set_range ( union scsi_cdb *cdb, uint64_t lba,
+			 unsigned int count ) {
+
+	switch ( cdb->bytes[0] ) {
+	case SCSI_OPCODE_READ_10:
+	case SCSI_OPCODE_WRITE_10:
+		cdb->read10.lba = cpu_to_be32 ( lba );
+		cdb->read10.len = cpu_to_be16 ( count );
+		break;
+	case SCSI_OPCODE_READ_16:
+	case SCSI_OPCODE_WRITE_16:
+		cdb->read16.lba = cpu_to_be64 ( lba );
+		cdb->read16.len = cpu_to_be32 ( count );
+		break;
+	default:
+		assert ( 0 );
+		break;
+	}
+}
+
 /******************************************************************************
  *
  * Interface methods
@@ -248,6 +308,8 @@ struct scsi_device {
 
 	/** List of commands */
 	struct list_head cmds;
+	/** Number of outstanding command parts */
+	unsigned int active;
 };
 
 /** SCSI device flags */
@@ -285,6 +347,15 @@ struct scsi_command {
 	/** Command tag */
 	uint32_t tag;
 
+	/** Parent command (for a part of a split command), or NULL */
+	struct scsi_command *parent;
+	/** List of outstanding parts (for a split command) */
+	struct list_head parts;
+	/** Number of blocks per part (for a split command), or zero */
+	unsigned int part_count;
+	/** Number of blocks issued so far (for a split command) */
+	unsigned int issued;
+
 	/** Private data */
 	uint8_t priv[0];
 };
@@ -376,6 +447,10 @@ static void scsicmd_free ( struct refcnt *refcnt ) {
 	struct scsi_command *scsicmd =
 		container_of ( refcnt, struct scsi_command, refcnt );
 
+	/* Drop reference to parent command, if applicable */
+	if ( scsicmd->parent )
+		scsicmd_put ( scsicmd->parent );
+
 	/* Drop reference to SCSI device */
 	scsidev_put ( scsicmd->scsidev );
 
@@ -391,18 +466,28 @@ static void scsicmd_free ( struct refcnt *refcnt ) {
  */
 static void scsicmd_close ( struct scsi_command *scsicmd, int rc ) {
 	struct scsi_device *scsidev = scsicmd->scsidev;
+	struct scsi_command *part;
 
 	if ( rc != 0 ) {
 		DBGC ( scsidev, "SCSI %p tag %08x closed: %s\n",
 		       scsidev, scsicmd->tag, strerror ( rc ) );
 	}
 
-	/* Remove from list of commands */
+	/* Remove from list of commands (or list of parts) */
 	list_del ( &scsicmd->list );
+	if ( scsicmd->parent )
+		scsidev->active--;
 
 	/* Shut down interfaces */
 	intfs_shutdown ( rc, &scsicmd->scsi, &scsicmd->block, NULL );
 
+	/* Close any outstanding parts */
+	while ( ( part = list_first_entry ( &scsicmd->parts,
+					    struct scsi_command,
+					    list ) ) != NULL ) {
+		scsicmd_close ( part, rc );
+	}
+
 	/* Drop list's reference */
 	scsicmd_put ( scsicmd );
 }
@@ -445,6 +530,34 @@ static int scsicmd_command ( struct scsi_command *scsicmd ) {
 	return 0;
 }
 
+/**
+ * Handle completion of part of a split SCSI command
+ *
+ * @v part		SCSI command part
+ * @v rc		Reason for completion
+ */
+static void scsicmd_part_done ( struct scsi_command *part, int rc ) {
+	struct scsi_command *scsicmd = scsicmd_get ( part->parent );
+	struct scsi_device *scsidev = scsicmd->scsidev;
+
+	/* Close part */
+	scsicmd_close ( part, rc );
+
+	/* Complete command on failure or once all parts have completed,
+	 * otherwise schedule issuing of any remaining parts.
+	 */
+	if ( rc != 0 ) {
+		scsicmd->type->done ( scsicmd, rc );
+	} else if ( ( scsicmd->issued == scsicmd->count ) &&
+		    list_empty ( &scsicmd->parts ) ) {
+		scsicmd->type->done ( scsicmd, 0 );
+	} else {
+		process_add ( &scsidev->process );
+	}
+
+	scsicmd_put ( scsicmd );
+}
+
 /**
  * Handle SCSI command completion
  *
@@ -456,6 +569,12 @@ static void scsicmd_done ( struct scsi_command *scsicmd, int rc ) {
 	/* Restart SCSI interface */
 	intf_restart ( &scsicmd->scsi, rc );
 
+	/* Hand over parts of split commands to the parent command */
+	if ( scsicmd->parent ) {
+		scsicmd_part_done ( scsicmd, rc );
+		return;
+	}
+
 	/* Hand over to the command completion handler */
 	scsicmd->type->done ( scsicmd, rc );
 }
@@ -505,7 +624,8 @@ static void scsicmd_response ( struct scsi_command *scsicmd,
 static void scsicmd_read_cmd ( struct scsi_command *scsicmd,
 			       struct scsi_cmd *command ) {
 
-	if ( ( scsicmd->lba + scsicmd->count ) > SCSI_MAX_BLOCK_10 ) {
+	if ( ( ( scsicmd->lba + scsicmd->count ) > SCSI_MAX_BLOCK_10 ) ||
+	     ( scsicmd->count > SCSI_MAX_COUNT_10 ) ) {
 		/* Use READ (16) */
 		command->cdb.read16.opcode = SCSI_OPCODE_READ_16;
 		command->cdb.read16.lba = cpu_to_be64 ( scsicmd->lba );
@@ -536,7 +656,8 @@ static struct scsi_command_type scsicmd_read = {
 static void scsicmd_write_cmd ( struct scsi_command *scsicmd,
 				struct scsi_cmd *command ) {
 
-	if ( ( scsicmd->lba + scsicmd->count ) > SCSI_MAX_BLOCK_10 ) {
+	if ( ( ( scsicmd->lba + scsicmd->count ) > SCSI_MAX_BLOCK_10 ) ||
+	     ( scsicmd->count > SCSI_MAX_COUNT_10 ) ) {
 		/* Use WRITE (16) */
 		command->cdb.write16.opcode = SCSI_OPCODE_WRITE_16;
 		command->cdb.write16.lba = cpu_to_be64 ( scsicmd->lba );
@@ -701,6 +822,82 @@ static struct interface_descriptor scsicmd_scsi_desc =
 	INTF_DESC_PASSTHRU ( struct scsi_command, scsi,
 			     scsicmd_scsi_op, block );
 
+/**
+ * Allocate SCSI command
+ *
+ * @v scsidev		SCSI device
+ * @v type		SCSI command type
+ * @v lba		Starting logical block address
+ * @v count		Number of blocks to transfer
+ * @v buffer		Data buffer
+ * @v len		Length of data buffer
+ * @ret scsicmd		SCSI command, or NULL on allocation failure
+ */
+static struct scsi_command * scsicmd_alloc ( struct scsi_device *scsidev,
+					     struct scsi_command_type *type,
+					     uint64_t lba, unsigned int count,
+					     userptr_t buffer, size_t len ) {
+	struct scsi_command *scsicmd;
+
+	/* Allocate and initialise structure */
+	scsicmd = zalloc ( sizeof ( *scsicmd ) + type->priv_len );
+	if ( ! scsicmd )
+		return NULL;
+	ref_init ( &scsicmd->refcnt, scsicmd_free );
+	intf_init ( &scsicmd->block, &scsicmd_block_desc, &scsicmd->refcnt );
+	intf_init ( &scsicmd->scsi, &scsicmd_scsi_desc,
+		    &scsicmd->refcnt );
+	scsicmd->scsidev = scsidev_get ( scsidev );
+	INIT_LIST_HEAD ( &scsicmd->parts );
+	scsicmd->type = type;
+	scsicmd->lba = lba;
+	scsicmd->count = count;
+	scsicmd->buffer = buffer;
+	scsicmd->len = len;
+
+	return scsicmd;
+}
+
+/**
+ * Construct and issue next part of a split SCSI command
+ *
+ * @v scsicmd		SCSI command
+ * @ret rc		Return status code
+ */
+static int scsicmd_part ( struct scsi_command *scsicmd ) {
+	struct scsi_device *scsidev = scsicmd->scsidev;
+	struct scsi_command *part;
+	size_t blksize = ( scsicmd->len / scsicmd->count );
+	unsigned int count;
+	int rc;
+
+	/* Calculate part size */
+	count = ( scsicmd->count - scsicmd->issued );
+	if ( count > scsicmd->part_count )
+		count = scsicmd->part_count;
+
+	/* Allocate part */
+	part = scsicmd_alloc ( scsidev, scsicmd->type,
+			       ( scsicmd->lba + scsicmd->issued ), count,
+			       userptr_add ( scsicmd->buffer,
+					     ( scsicmd->issued * blksize ) ),
+			       ( count * blksize ) );
+	if ( ! part )
+		return -ENOMEM;
+	part->parent = scsicmd_get ( scsicmd );
+	list_add_tail ( &part->list, &scsicmd->parts );
+	scsidev->active++;
+	scsicmd->issued += count;
+
+	/* Issue part, transferring reference to list of parts */
+	if ( ( rc = scsicmd_command ( part ) ) != 0 ) {
+		scsicmd_close ( part, rc );
+		return rc;
+	}
+
+	return 0;
+}
+
 /**
  * Create SCSI command
  *
@@ -719,29 +916,35 @@ static int scsidev_command ( struct scsi_device *scsidev,
 			     uint64_t lba, unsigned int count,
 			     userptr_t buffer, size_t len ) {
 	struct scsi_command *scsicmd;
+	unsigned int parts;
 	int rc;
 
 	/* Allocate and initialise structure */
-	scsicmd = zalloc ( sizeof ( *scsicmd ) + type->priv_len );
+	scsicmd = scsicmd_alloc ( scsidev, type, lba, count, buffer, len );
 	if ( ! scsicmd ) {
 		rc = -ENOMEM;
-		goto err_zalloc;
+		goto err_alloc;
 	}
-	ref_init ( &scsicmd->refcnt, scsicmd_free );
-	intf_init ( &scsicmd->block, &scsicmd_block_desc, &scsicmd->refcnt );
-	intf_init ( &scsicmd->scsi, &scsicmd_scsi_desc,
-		    &scsicmd->refcnt );
-	scsicmd->scsidev = scsidev_get ( scsidev );
-	list_add ( &scsicmd->list, &scsidev->cmds );
-	scsicmd->type = type;
-	scsicmd->lba = lba;
-	scsicmd->count = count;
-	scsicmd->buffer = buffer;
-	scsicmd->len = len;
+	list_add_tail ( &scsicmd->list, &scsidev->cmds );
 
-	/* Issue SCSI command */
-	if ( ( rc = scsicmd_command ( scsicmd ) ) != 0 )
-		goto err_command;
+	/* Split large transfers into parts, to allow the underlying
+	 * transport to process several parts concurrently.
+	 */
+	parts = ( len / SCSI_MIN_PART_LEN );
+	if ( parts > SCSI_QUEUE_DEPTH )
+		parts = SCSI_QUEUE_DEPTH;
+	if ( count && ( parts > 1 ) )
+		scsicmd->part_count = ( ( count + parts - 1 ) / parts );
+
+	/* Issue SCSI command (or the first part of a split command) */
+	if ( scsicmd->part_count ) {
+		if ( ( rc = scsicmd_part ( scsicmd ) ) != 0 )
+			goto err_command;
+		process_add ( &scsidev->process );
+	} else {
+		if ( ( rc = scsicmd_command ( scsicmd ) ) != 0 )
+			goto err_command;
+	}
 
 	/* Attach to parent interface, transfer reference to list, and return */
 	intf_plug_plug ( &scsicmd->block, block );
@@ -750,7 +953,7 @@ static int scsidev_command ( struct scsi_device *scsidev,
  err_command:
 	scsicmd_close ( scsicmd, rc );
 	ref_put ( &scsicmd->refcnt );
- err_zalloc:
+ err_alloc:
 	return rc;
 }
 
@@ -926,13 +1129,53 @@ static struct interface_descriptor scsidev_ready_desc =
 	INTF_DESC ( struct scsi_device, ready, scsidev_ready_op );
 
 /**
- * SCSI TEST UNIT READY process
+ * Find oldest SCSI command with parts waiting to be issued
+ *
+ * @v scsidev		SCSI device
+ * @ret scsicmd		SCSI command, or NULL
+ */
+static struct scsi_command * scsidev_queued ( struct scsi_device *scsidev ) {
+	struct scsi_command *scsicmd;
+
+	list_for_each_entry ( scsicmd, &scsidev->cmds, list ) {
+		if ( scsicmd->part_count &&
+		     ( scsicmd->issued < scsicmd->count ) )
+			return scsicmd;
+	}
+	return NULL;
+}
+
+/**
+ * Issue queued SCSI command parts
+ *
+ * @v scsidev		SCSI device
+ */
+static void scsidev_issue ( struct scsi_device *scsidev ) {
+	struct scsi_command *scsicmd;
+	int rc;
+
+	/* Issue parts while the queue depth and the underlying
+	 * transport's flow-control window both permit.
+	 */
+	while ( ( scsidev->active < SCSI_QUEUE_DEPTH ) &&
+		( xfer_window ( &scsidev->scsi ) != 0 ) &&
+		( ( scsicmd = scsidev_queued ( scsidev ) ) != NULL ) ) {
+		if ( ( rc = scsicmd_part ( scsicmd ) ) != 0 )
+			scsicmd->type->done ( scsicmd, rc );
+	}
+}
+
+/**
+ * SCSI device process
  *
  * @v scsidev		SCSI device
  */
 static void scsidev_step ( struct scsi_device *scsidev ) {
 	int rc;
 
+	/* Issue any queued command parts */
+	scsidev_issue ( scsidev );
+
 	/* Do nothing if we have already issued TEST UNIT READY */
 	if ( scsidev->flags & SCSIDEV_UNIT_TESTED )
 		return;
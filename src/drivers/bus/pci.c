@@ -34,6 +34,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/tables.h>
 #include <ipxe/device.h>
 #include <ipxe/pci.h>
+#include <config/general.h>
 
 /** @file
  *
@@ -41,6 +42,16 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  *
  */
 
+/** PCI probe filter (empty to probe all devices at startup) */
+#ifdef PCI_PROBE_FILTER
+static const char pci_probe_filter[] = PCI_PROBE_FILTER;
+#else
+static const char pci_probe_filter[] = "";
+#endif
+
+/** Some PCI devices were skipped by the probe filter */
+static int pcibus_skipped;
+
 static void pcibus_remove ( struct root_device *rootdev );
 
 /**
@@ -311,14 +322,105 @@ void pci_remove ( struct pci_device *pci ) {
 }
 
 /**
- * Probe PCI root bus
+ * Check if PCI device is permitted by the probe filter
+ *
+ * @v pci		PCI device
+ * @ret permitted	PCI device may be probed at startup
+ *
+ * The probe filter is a comma-separated list of entries, each of
+ * which is either a "vvvv:dddd" vendor and device ID pair or a
+ * "[ssss:]bb:dd.f" bus location.
+ */
+static int pci_filter_permits ( struct pci_device *pci ) {
+	const char *filter = pci_probe_filter;
+	unsigned long fields[4];
+	unsigned int busdevfn;
+	unsigned int count;
+	unsigned long value;
+	int is_location;
+	char *endp;
+
+	/* Permit all devices if no filter is configured */
+	if ( ! filter[0] )
+		return 1;
+
+	/* Check each entry in turn */
+	while ( *filter ) {
+
+		/* Parse entry as a sequence of hex fields */
+		count = 0;
+		is_location = 0;
+		while ( 1 ) {
+			value = strtoul ( filter, &endp, 16 );
+			if ( count < ( sizeof ( fields ) /
+				       sizeof ( fields[0] ) ) ) {
+				fields[count++] = value;
+			}
+			if ( *endp == '.' )
+				is_location = 1;
+			if ( ( endp == filter ) ||
+			     ( ( *endp != ':' ) && ( *endp != '.' ) ) )
+				break;
+			filter = ( endp + 1 );
+		}
+		if ( *endp == ',' ) {
+			endp++;
+		} else if ( *endp ) {
+			DBGC ( pci, "PCI invalid probe filter \"%s\"\n",
+			       pci_probe_filter );
+			return 1;
+		}
+		filter = endp;
+
+		/* Check for a match */
+		if ( is_location && ( count == 3 ) ) {
+			busdevfn = PCI_BUSDEVFN ( PCI_SEG ( pci->busdevfn ),
+						  fields[0], fields[1],
+						  fields[2] );
+		} else if ( is_location && ( count == 4 ) ) {
+			busdevfn = PCI_BUSDEVFN ( fields[0], fields[1],
+						  fields[2], fields[3] );
+		} else if ( count == 2 ) {
+			if ( ( pci->vendor == fields[0] ) &&
+			     ( pci->device == fields[1] ) )
+				return 1;
+			continue;
+		} else {
+			continue;
+		}
+		if ( pci->busdevfn == busdevfn )
+			return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Check if PCI device has already been probed
  *
  * @v rootdev		PCI bus root device
+ * @v busdevfn		PCI bus:dev.fn address
+ * @ret probed		PCI device has already been probed
+ */
+static int pcibus_probed ( struct root_device *rootdev,
+			   unsigned int busdevfn ) {
+	struct pci_device *pci;
+
+	list_for_each_entry ( pci, &rootdev->dev.children, dev.siblings ) {
+		if ( pci->busdevfn == busdevfn )
+			return 1;
+	}
+	return 0;
+}
+
+/**
+ * Scan PCI bus and probe devices
  *
- * Scans the PCI bus for devices and registers all devices it can
- * find.
+ * @v rootdev		PCI bus root device
+ * @v filter		Apply probe filter
+ * @ret rc		Return status code
  */
-static int pcibus_probe ( struct root_device *rootdev ) {
+static int pcibus_scan ( struct root_device *rootdev, int filter ) {
 	struct pci_device *pci = NULL;
 	int busdevfn = 0;
 	int rc;
@@ -338,6 +440,19 @@ static int pcibus_probe ( struct root_device *rootdev ) {
 		if ( busdevfn < 0 )
 			break;
 
+		/* Skip devices that have already been probed */
+		if ( pcibus_probed ( rootdev, busdevfn ) )
+			continue;
+
+		/* Skip devices not permitted by the probe filter */
+		if ( filter && ( ! pci_filter_permits ( pci ) ) ) {
+			DBGC ( pci, PCI_FMT " (%04x:%04x) skipped by probe "
+			       "filter\n", PCI_ARGS ( pci ), pci->vendor,
+			       pci->device );
+			pcibus_skipped = 1;
+			continue;
+		}
+
 		/* Look for a driver */
 		if ( ( rc = pci_find_driver ( pci ) ) != 0 ) {
 			DBGC ( pci, PCI_FMT " (%04x:%04x class %06x) has no "
@@ -365,10 +480,44 @@ static int pcibus_probe ( struct root_device *rootdev ) {
 
  err:
 	free ( pci );
-	pcibus_remove ( rootdev );
 	return rc;
 }
 
+/**
+ * Probe PCI root bus
+ *
+ * @v rootdev		PCI bus root device
+ *
+ * Scans the PCI bus for devices and registers all devices it can
+ * find (subject to the probe filter).
+ */
+static int pcibus_probe ( struct root_device *rootdev ) {
+	int rc;
+
+	if ( ( rc = pcibus_scan ( rootdev, 1 ) ) != 0 ) {
+		pcibus_remove ( rootdev );
+		return rc;
+	}
+
+	return 0;
+}
+
+/**
+ * Probe PCI devices skipped by the probe filter
+ *
+ * @v rootdev		PCI bus root device
+ */
+static void pcibus_probe_skipped ( struct root_device *rootdev ) {
+
+	/* Do nothing unless some devices were skipped */
+	if ( ! pcibus_skipped )
+		return;
+	pcibus_skipped = 0;
+
+	/* Probe all remaining devices */
+	pcibus_scan ( rootdev, 0 );
+}
+
 /**
  * Remove PCI root bus
  *
@@ -389,6 +538,7 @@ static void pcibus_remove ( struct root_device *rootdev ) {
 /** PCI bus root device driver */
 static struct root_driver pci_root_driver = {
 	.probe = pcibus_probe,
+	.probe_skipped = pcibus_probe_skipped,
 	.remove = pcibus_remove,
 };
 
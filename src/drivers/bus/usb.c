@@ -31,6 +31,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <errno.h>
 #include <assert.h>
 #include <byteswap.h>
+#include <ipxe/nap.h>
 #include <ipxe/usb.h>
 #include <ipxe/cdc.h>
 
@@ -573,6 +574,7 @@ void usb_complete_err ( struct usb_endpoint *ep, struct io_buffer *iobuf,
 	/* Decrement fill level */
 	assert ( ep->fill > 0 );
 	ep->fill--;
+	nap_activity();
 
 	/* Schedule reset, if applicable */
 	if ( ( rc != 0 ) && ep->open ) {
@@ -674,6 +676,13 @@ int usb_refill ( struct usb_endpoint *ep ) {
 		/* Enqueue buffer */
 		if ( ( rc = usb_stream ( ep, iobuf, 0 ) ) != 0 ) {
 			list_add ( &iobuf->list, &ep->recycled );
+			/* A host controller ring that fills up before
+			 * the endpoint reaches its maximum fill level
+			 * is not an error, provided that at least one
+			 * transfer remains outstanding.
+			 */
+			if ( ( rc == -ENOBUFS ) && ( ep->fill > 0 ) )
+				return 0;
 			return rc;
 		}
 	}
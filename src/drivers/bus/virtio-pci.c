@@ -24,7 +24,7 @@
 static int vp_alloc_vq(struct vring_virtqueue *vq, u16 num)
 {
     size_t queue_size = PAGE_MASK + vring_size(num);
-    size_t vdata_size = num * sizeof(void *);
+    size_t vdata_size = vring_vdata_size(num);
 
     vq->queue = zalloc(queue_size + vdata_size);
     if (!vq->queue) {
@@ -347,16 +347,15 @@ void vpm_notify(struct virtio_pci_modern_device *vdev,
     vpm_iowrite16(vdev, &vq->notification, (u16)vq->queue_index, 0);
 }
 
-int vpm_find_vqs(struct virtio_pci_modern_device *vdev,
-                 unsigned nvqs, struct vring_virtqueue *vqs)
+int vpm_find_vq(struct virtio_pci_modern_device *vdev,
+                unsigned index, struct vring_virtqueue *vq)
 {
-    unsigned i;
-    struct vring_virtqueue *vq;
+    void *desc, *driver, *device;
     u16 size, off;
     u32 notify_offset_multiplier;
     int err;
 
-    if (nvqs > vpm_ioread16(vdev, &vdev->common, COMMON_OFFSET(num_queues))) {
+    if (index >= vpm_ioread16(vdev, &vdev->common, COMMON_OFFSET(num_queues))) {
         return -ENOENT;
     }
 
@@ -366,60 +365,93 @@ int vpm_find_vqs(struct virtio_pci_modern_device *vdev,
         notify_off_multiplier),
         &notify_offset_multiplier);
 
-    for (i = 0; i < nvqs; i++) {
-        /* Select the queue we're interested in */
-        vpm_iowrite16(vdev, &vdev->common, (u16)i, COMMON_OFFSET(queue_select));
+    /* Select the queue we're interested in */
+    vpm_iowrite16(vdev, &vdev->common, (u16)index, COMMON_OFFSET(queue_select));
 
-        /* Check if queue is either not available or already active. */
-        size = vpm_ioread16(vdev, &vdev->common, COMMON_OFFSET(queue_size));
-        /* QEMU has a bug where queues don't revert to inactive on device
-         * reset. Skip checking the queue_enable field until it is fixed.
-         */
-        if (!size /*|| vpm_ioread16(vdev, &vdev->common.queue_enable)*/)
-            return -ENOENT;
+    /* Check if queue is either not available or already active. */
+    size = vpm_ioread16(vdev, &vdev->common, COMMON_OFFSET(queue_size));
+    /* QEMU has a bug where queues don't revert to inactive on device
+     * reset. Skip checking the queue_enable field until it is fixed.
+     */
+    if (!size /*|| vpm_ioread16(vdev, &vdev->common.queue_enable)*/)
+        return -ENOENT;
 
-        if (size & (size - 1)) {
-            DBG("VIRTIO-PCI %p: bad queue size %d\n", vdev, size);
-            return -EINVAL;
-        }
+    if (size & (size - 1)) {
+        DBG("VIRTIO-PCI %p: bad queue size %d\n", vdev, size);
+        return -EINVAL;
+    }
 
-        if (size > MAX_QUEUE_NUM) {
-            /* iPXE networking tends to be not perf critical so there's no
-             * need to accept large queue sizes.
-             */
-            size = MAX_QUEUE_NUM;
-        }
+    if (size > MAX_QUEUE_NUM) {
+        /* iPXE networking tends to be not perf critical so there's no
+         * need to accept large queue sizes.
+         */
+        size = MAX_QUEUE_NUM;
+    }
 
-        vq = &vqs[i];
-        vq->queue_index = i;
+    vq->queue_index = index;
 
-        /* get offset of notification word for this vq */
-        off = vpm_ioread16(vdev, &vdev->common, COMMON_OFFSET(queue_notify_off));
+    /* get offset of notification word for this vq */
+    off = vpm_ioread16(vdev, &vdev->common, COMMON_OFFSET(queue_notify_off));
 
-        err = vp_alloc_vq(vq, size);
-        if (err) {
-            DBG("VIRTIO-PCI %p: failed to allocate queue memory\n", vdev);
-            return err;
-        }
+    err = vp_alloc_vq(vq, size);
+    if (err) {
+        DBG("VIRTIO-PCI %p: failed to allocate queue memory\n", vdev);
+        return err;
+    }
+    if (vdev->packed) {
+        vring_packed_init(vq, size);
+        desc = vq->packed_ring.desc;
+        driver = vq->packed_ring.driver;
+        device = vq->packed_ring.device;
+    } else {
         vring_init(&vq->vring, size, vq->queue);
+        desc = vq->vring.desc;
+        driver = vq->vring.avail;
+        device = vq->vring.used;
+    }
+
+    /* activate the queue */
+    vpm_iowrite16(vdev, &vdev->common, size, COMMON_OFFSET(queue_size));
+
+    vpm_iowrite64(vdev, &vdev->common, virt_to_phys(desc),
+                  COMMON_OFFSET(queue_desc_lo),
+                  COMMON_OFFSET(queue_desc_hi));
+    vpm_iowrite64(vdev, &vdev->common, virt_to_phys(driver),
+                  COMMON_OFFSET(queue_avail_lo),
+                  COMMON_OFFSET(queue_avail_hi));
+    vpm_iowrite64(vdev, &vdev->common, virt_to_phys(device),
+                  COMMON_OFFSET(queue_used_lo),
+                  COMMON_OFFSET(queue_used_hi));
+
+    return virtio_pci_map_capability(vdev->pci,
+        vdev->notify_cap_pos, 2, 2,
+        off * notify_offset_multiplier, 2,
+        &vq->notification);
+}
+
+void vpm_enable_vq(struct virtio_pci_modern_device *vdev,
+                   struct vring_virtqueue *vq)
+{
+    /* Has to be done last: once we do this, there's no way to go
+     * back except reset.
+     */
+    vpm_iowrite16(vdev, &vdev->common, (u16)vq->queue_index,
+                  COMMON_OFFSET(queue_select));
+    vpm_iowrite16(vdev, &vdev->common, 1, COMMON_OFFSET(queue_enable));
+}
+
+int vpm_find_vqs(struct virtio_pci_modern_device *vdev,
+                 unsigned nvqs, struct vring_virtqueue *vqs)
+{
+    unsigned i;
+    int err;
 
-        /* activate the queue */
-        vpm_iowrite16(vdev, &vdev->common, size, COMMON_OFFSET(queue_size));
-
-        vpm_iowrite64(vdev, &vdev->common, virt_to_phys(vq->vring.desc),
-                      COMMON_OFFSET(queue_desc_lo),
-                      COMMON_OFFSET(queue_desc_hi));
-        vpm_iowrite64(vdev, &vdev->common, virt_to_phys(vq->vring.avail),
-                      COMMON_OFFSET(queue_avail_lo),
-                      COMMON_OFFSET(queue_avail_hi));
-        vpm_iowrite64(vdev, &vdev->common, virt_to_phys(vq->vring.used),
-                      COMMON_OFFSET(queue_used_lo),
-                      COMMON_OFFSET(queue_used_hi));
-
-        err = virtio_pci_map_capability(vdev->pci,
-            vdev->notify_cap_pos, 2, 2,
-            off * notify_offset_multiplier, 2,
-            &vq->notification);
+    if (nvqs > vpm_ioread16(vdev, &vdev->common, COMMON_OFFSET(num_queues))) {
+        return -ENOENT;
+    }
+
+    for (i = 0; i < nvqs; i++) {
+        err = vpm_find_vq(vdev, i, &vqs[i]);
         if (err) {
             return err;
         }
@@ -429,10 +461,7 @@ int vpm_find_vqs(struct virtio_pci_modern_device *vdev,
      * this, there's no way to go back except reset.
      */
     for (i = 0; i < nvqs; i++) {
-        vq = &vqs[i];
-        vpm_iowrite16(vdev, &vdev->common, (u16)vq->queue_index,
-                      COMMON_OFFSET(queue_select));
-        vpm_iowrite16(vdev, &vdev->common, 1, COMMON_OFFSET(queue_enable));
+        vpm_enable_vq(vdev, &vqs[i]);
     }
     return 0;
 }
@@ -28,6 +28,44 @@ FILE_LICENCE ( GPL2_OR_LATER );
 } while (0)
 #define BUG_ON(condition) do { if (condition) BUG(); } while (0)
 
+/*
+ * vring_packed_init
+ *
+ * set up a packed virtqueue within the memory allocated for the queue
+ *
+ */
+
+void vring_packed_init(struct vring_virtqueue *vq, unsigned int num)
+{
+   struct vring_packed *vp = &vq->packed_ring;
+   unsigned int i;
+   unsigned long pa;
+
+   vq->packed = 1;
+   vq->vring.num = num;
+   vq->free_head = 0;
+   vq->last_used_idx = 0;
+
+   /* physical address of desc must be page aligned */
+
+   pa = virt_to_phys(vq->queue);
+   pa = (pa + PAGE_MASK) & ~PAGE_MASK;
+   vp->desc = phys_to_virt(pa);
+   vp->driver = (struct vring_packed_desc_event *)&vp->desc[num];
+   vp->device = &vp->driver[1];
+
+   /* buffer ID tracking immediately follows the driver data */
+
+   vp->id_next = (u16 *)&vq->vdata[num];
+   vp->id_count = &vp->id_next[num];
+   for (i = 0; i < num; i++)
+           vp->id_next[i] = i + 1;
+
+   vp->avail_idx = 0;
+   vp->avail_wrap = 1;
+   vp->used_wrap = 1;
+}
+
 /*
  * vring_free
  *
@@ -59,6 +97,101 @@ void vring_detach(struct vring_virtqueue *vq, unsigned int head)
  *
  */
 
+/*
+ * vring_packed_get_buf
+ *
+ * get a buffer from a packed virtqueue
+ *
+ */
+
+static void *vring_packed_get_buf(struct vring_virtqueue *vq,
+                                  unsigned int *len)
+{
+   struct vring_packed *vp = &vq->packed_ring;
+   struct vring_packed_desc *desc;
+   u16 id;
+   void *opaque;
+
+   desc = &vp->desc[vq->last_used_idx];
+   wmb();
+   id = desc->id;
+   if (len != NULL)
+           *len = desc->len;
+
+   opaque = vq->vdata[id];
+
+   /* the device writes a single used descriptor for each buffer, so
+    * skip over the remaining descriptors that the buffer occupied */
+
+   vq->last_used_idx += vp->id_count[id];
+   if (vq->last_used_idx >= vq->vring.num) {
+           vq->last_used_idx -= vq->vring.num;
+           vp->used_wrap ^= 1;
+   }
+
+   vp->id_next[id] = vq->free_head;
+   vq->free_head = id;
+
+   return opaque;
+}
+
+/*
+ * vring_packed_add_buf
+ *
+ * make a buffer available in a packed virtqueue
+ *
+ */
+
+static void vring_packed_add_buf(struct vring_virtqueue *vq,
+                                 struct vring_list list[],
+                                 unsigned int out, unsigned int in,
+                                 void *opaque)
+{
+   struct vring_packed *vp = &vq->packed_ring;
+   struct vring_packed_desc *desc;
+   unsigned int total = out + in;
+   unsigned int i;
+   u16 id = vq->free_head;
+   u16 idx = vp->avail_idx;
+   u16 wrap = vp->avail_wrap;
+   u16 head = idx;
+   u16 head_flags = 0;
+   u16 flags;
+
+   for (i = 0; i < total; i++, list++) {
+
+           desc = &vp->desc[idx];
+           desc->addr = (u64)virt_to_phys(list->addr);
+           desc->len = list->length;
+           desc->id = id;
+           flags = (((i + 1) < total) ? VRING_DESC_F_NEXT : 0) |
+                   ((i >= out) ? VRING_DESC_F_WRITE : 0) |
+                   (wrap ? (1 << VRING_PACKED_DESC_F_AVAIL) :
+                           (1 << VRING_PACKED_DESC_F_USED));
+
+           /* the head descriptor is made available last */
+           if (i == 0)
+                   head_flags = flags;
+           else
+                   desc->flags = flags;
+
+           if (++idx >= vq->vring.num) {
+                   idx = 0;
+                   wrap ^= 1;
+           }
+   }
+
+   vq->free_head = vp->id_next[id];
+   vp->id_count[id] = total;
+   vq->vdata[id] = opaque;
+
+   vp->avail_idx = idx;
+   vp->avail_wrap = wrap;
+
+   wmb();
+   vp->desc[head].flags = head_flags;
+}
+
 void *vring_get_buf(struct vring_virtqueue *vq, unsigned int *len)
 {
    struct vring *vr = &vq->vring;
@@ -68,6 +201,9 @@ void *vring_get_buf(struct vring_virtqueue *vq, unsigned int *len)
 
    BUG_ON(!vring_more_used(vq));
 
+   if (vq->packed)
+           return vring_packed_get_buf(vq, len);
+
    elem = &vr->used->ring[vq->last_used_idx % vr->num];
    wmb();
    id = elem->id;
@@ -93,6 +229,12 @@ void vring_add_buf(struct vring_virtqueue *vq,
 
    BUG_ON(out + in == 0);
 
+   /* packed virtqueue buffers become available immediately */
+   if (vq->packed) {
+           vring_packed_add_buf(vq, list, out, in, opaque);
+           return;
+   }
+
    prev = 0;
    head = vq->free_head;
    for (i = head; out; i = vr->desc[i].next, out--) {
@@ -126,12 +268,20 @@ void vring_kick(struct virtio_pci_modern_device *vdev, unsigned int ioaddr,
                 struct vring_virtqueue *vq, int num_added)
 {
    struct vring *vr = &vq->vring;
+   int notify;
 
    wmb();
-   vr->avail->idx += num_added;
+   if (vq->packed) {
+           mb();
+           notify = (vq->packed_ring.device->flags !=
+                     VRING_PACKED_EVENT_FLAG_DISABLE);
+   } else {
+           vr->avail->idx += num_added;
+           mb();
+           notify = !(vr->used->flags & VRING_USED_F_NO_NOTIFY);
+   }
 
-   mb();
-   if (!(vr->used->flags & VRING_USED_F_NO_NOTIFY)) {
+   if (notify) {
            if (vdev) {
                    /* virtio 1.0 */
                    vpm_notify(vdev, vq);
@@ -28,6 +28,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/if_ether.h>
 #include <ipxe/ethernet.h>
 #include <ipxe/vlan.h>
+#include <ipxe/settings.h>
 #include <ipxe/io.h>
 #include "flexboot_nodnic.h"
 #include "mlx_utils/include/public/mlx_types.h"
@@ -744,11 +745,18 @@ static void flexboot_nodnic_port_disable_dma ( struct flexboot_nodnic_port *port
  ***************************************************************************
  */
 
-/** Number of flexboot_nodnic Ethernet send work queue entries */
+/** Default number of flexboot_nodnic Ethernet send work queue entries */
 #define FLEXBOOT_NODNIC_ETH_NUM_SEND_WQES 64
 
-/** Number of flexboot_nodnic Ethernet receive work queue entries */
-#define FLEXBOOT_NODNIC_ETH_NUM_RECV_WQES 64
+/** Default number of flexboot_nodnic Ethernet receive work queue entries */
+#define FLEXBOOT_NODNIC_ETH_NUM_RECV_WQES 256
+
+/** Minimum number of flexboot_nodnic Ethernet work queue entries */
+#define FLEXBOOT_NODNIC_ETH_MIN_WQES 8
+
+/** Maximum number of flexboot_nodnic Ethernet work queue entries */
+#define FLEXBOOT_NODNIC_ETH_MAX_WQES 1024
+
 /** flexboot nodnic Ethernet queue pair operations */
 static struct ib_queue_pair_operations flexboot_nodnic_eth_qp_op = {
 	.alloc_iob = alloc_iob,
@@ -842,8 +850,13 @@ static struct ib_completion_queue_operations flexboot_nodnic_eth_cq_op = {
 static void flexboot_nodnic_eth_poll ( struct net_device *netdev) {
 	struct flexboot_nodnic_port *port = netdev->priv;
 	struct ib_device *ibdev = port->ibdev;
+	struct ib_work_queue *recv = &port->eth_qp->recv;
 
 	ib_poll_eq ( ibdev );
+
+	/* Record receive buffer exhaustion if refilling fell short */
+	if ( recv->fill < recv->num_wqes )
+		netdev_rx_nobuf ( netdev );
 }
 
 /**
@@ -862,6 +875,9 @@ static int flexboot_nodnic_eth_open ( struct net_device *netdev ) {
 	mlx_uint64	cq_size = 0;
 	mlx_uint32	qpn = 0;
 	nodnic_port_state state = nodnic_port_state_down;
+	unsigned int max_wqes;
+	unsigned int num_send_wqes;
+	unsigned int num_recv_wqes;
 	int rc;
 
 	if ( port->port_priv.port_state & NODNIC_PORT_OPENED ) {
@@ -880,9 +896,42 @@ static int flexboot_nodnic_eth_open ( struct net_device *netdev ) {
 	}
 	INIT_LIST_HEAD ( &dummy_cq->work_queues );
 
+	status = nodnic_port_get_cq_size(&port->port_priv, &cq_size);
+	MLX_FATAL_CHECK_STATUS(status, get_cq_size_err,
+			"nodnic_port_get_cq_size failed");
+
+	/* Determine work queue sizes.  Both work queues share a
+	 * single completion queue (whose size is dictated by the
+	 * device), and neither may exceed the device's maximum ring
+	 * size.
+	 */
+	max_wqes = ( 1U << flexboot_nodnic->device_priv.device_cap.
+		     log_max_ring_size );
+	if ( max_wqes > ( cq_size / 2 ) )
+		max_wqes = ( cq_size / 2 );
+	if ( max_wqes > FLEXBOOT_NODNIC_ETH_MAX_WQES )
+		max_wqes = FLEXBOOT_NODNIC_ETH_MAX_WQES;
+	if ( max_wqes < FLEXBOOT_NODNIC_ETH_MIN_WQES )
+		max_wqes = FLEXBOOT_NODNIC_ETH_MIN_WQES;
+	num_send_wqes = netdev_ring_size ( netdev, &txring_setting,
+					   FLEXBOOT_NODNIC_ETH_NUM_SEND_WQES,
+					   FLEXBOOT_NODNIC_ETH_MIN_WQES,
+					   max_wqes );
+	if ( num_send_wqes > max_wqes )
+		num_send_wqes = max_wqes;
+	num_recv_wqes = netdev_ring_size ( netdev, &rxring_setting,
+					   FLEXBOOT_NODNIC_ETH_NUM_RECV_WQES,
+					   FLEXBOOT_NODNIC_ETH_MIN_WQES,
+					   max_wqes );
+	if ( num_recv_wqes > max_wqes )
+		num_recv_wqes = max_wqes;
+	DBGC ( flexboot_nodnic, "flexboot_nodnic %p port %d using %d TX and "
+	       "%d RX entries\n", flexboot_nodnic, ibdev->port,
+	       num_send_wqes, num_recv_wqes );
+
 	if ( ( rc = ib_create_qp ( ibdev, IB_QPT_ETH,
-				   FLEXBOOT_NODNIC_ETH_NUM_SEND_WQES, dummy_cq,
-				   FLEXBOOT_NODNIC_ETH_NUM_RECV_WQES, dummy_cq,
+				   num_send_wqes, dummy_cq,
+				   num_recv_wqes, dummy_cq,
 				   &flexboot_nodnic_eth_qp_op, netdev->name,
 				   &port->eth_qp ) ) != 0 ) {
 		DBGC ( flexboot_nodnic, "flexboot_nodnic %p port %d could not create queue pair\n",
@@ -893,10 +942,6 @@ static int flexboot_nodnic_eth_open ( struct net_device *netdev ) {
 
 	ib_qp_set_ownerdata ( port->eth_qp, netdev );
 
-	status = nodnic_port_get_cq_size(&port->port_priv, &cq_size);
-	MLX_FATAL_CHECK_STATUS(status, get_cq_size_err,
-			"nodnic_port_get_cq_size failed");
-
 	if ( ( rc = ib_create_cq ( ibdev, cq_size, &flexboot_nodnic_eth_cq_op,
 				   &port->eth_cq ) ) != 0 ) {
 		DBGC ( flexboot_nodnic,
@@ -966,9 +1011,9 @@ init_err:
 	nodnic_port_free_eq(&port->port_priv);
 eq_alloc_err:
 err_create_cq:
-get_cq_size_err:
 	ib_destroy_qp(ibdev, port->eth_qp );
 err_create_qp:
+get_cq_size_err:
 	free(dummy_cq);
 err_create_dummy_cq:
 	port->port_priv.port_state &= ~NODNIC_PORT_OPENED;
@@ -1846,10 +1846,11 @@ static void golan_poll_cq(struct ib_device *ibdev,
 
 		/* Update completion queue's index */
 		cq->next_idx++;
+	}
 
-		/* Update doorbell record */
+	/* Update doorbell record once for all consumed entries */
+	if (i)
 		*(golan_cq->doorbell_record) = cpu_to_be32(cq->next_idx & 0xffffff);
-	}
 }
 
 static const char *golan_eqe_type_str(u8 type)
@@ -45,9 +45,31 @@
 #define LINUX_SOCK_RAW 3
 #define LINUX_SIOCGIFINDEX 0x8933
 #define LINUX_SIOCGIFHWADDR 0x8927
+#define LINUX_SOL_PACKET 263
 
 #define RX_BUF_SIZE 1536
 
+/** Packet ring frame size */
+#define AF_PACKET_FRAME_LEN 2048
+
+/** Packet ring block size */
+#define AF_PACKET_BLOCK_LEN 65536
+
+/** Number of frames per packet ring block */
+#define AF_PACKET_BLOCK_FRAMES ( AF_PACKET_BLOCK_LEN / AF_PACKET_FRAME_LEN )
+
+/** Default number of receive ring frames */
+#define AF_PACKET_RX_COUNT 256
+
+/** Maximum number of receive ring frames */
+#define AF_PACKET_RX_MAX 4096
+
+/** Number of transmit ring frames */
+#define AF_PACKET_TX_COUNT 64
+
+/** Offset of packet data within a transmit ring frame */
+#define AF_PACKET_TX_DATA TPACKET_ALIGN ( sizeof ( struct tpacket2_hdr ) )
+
 /** @file
  *
  * The AF_PACKET driver.
@@ -62,13 +84,180 @@ struct af_packet_nic {
 	int fd;
 	/** ifindex */
 	int ifindex;
+	/** Memory-mapped packet rings, or NULL if not in use */
+	void *ring;
+	/** Length of memory-mapped packet rings */
+	size_t ring_len;
+	/** Number of receive ring frames */
+	unsigned int rx_count;
+	/** Receive ring consumer index */
+	unsigned int rx_cons;
+	/** Transmit ring producer index */
+	unsigned int tx_prod;
+	/** Transmit ring contains frames awaiting transmission */
+	int tx_pending;
+	/** Interface is in promiscuous mode */
+	int promisc;
+	/** File descriptor watch */
+	struct linux_nap_watch watch;
 };
 
+/**
+ * Check whether or not a received frame is addressed to us
+ *
+ * @v netdev		Network device
+ * @v data		Frame data
+ * @v len		Length of frame
+ * @ret wanted		Frame is addressed to us
+ *
+ * When the interface is in promiscuous mode, unicast frames for
+ * other MAC addresses must be discarded.
+ */
+static int af_packet_nic_wanted ( struct net_device *netdev,
+				  const void *data, size_t len )
+{
+	struct af_packet_nic * nic = netdev->priv;
+	const struct ethhdr *eh = data;
+
+	if (! nic->promisc)
+		return 1;
+	if (len < sizeof(*eh))
+		return 0;
+	return (is_multicast_ether_addr(eh->h_dest) ||
+		(memcmp(eh->h_dest, netdev->ll_addr, ETH_ALEN) == 0));
+}
+
+/**
+ * Set up memory-mapped packet rings
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ *
+ * Memory-mapped (TPACKET_V2) rings allow received packets to be
+ * collected and transmitted packets to be queued without a system
+ * call per packet.
+ */
+static int af_packet_nic_map ( struct net_device *netdev )
+{
+	struct af_packet_nic * nic = netdev->priv;
+	struct tpacket_req req;
+	int version = TPACKET_V2;
+	void *ring;
+	int ret;
+
+	nic->rx_count = netdev_ring_size(netdev, &rxring_setting,
+					 AF_PACKET_RX_COUNT,
+					 AF_PACKET_BLOCK_FRAMES,
+					 AF_PACKET_RX_MAX);
+	nic->rx_cons = 0;
+	nic->tx_prod = 0;
+	nic->tx_pending = 0;
+
+	ret = linux_setsockopt(nic->fd, LINUX_SOL_PACKET, PACKET_VERSION,
+			       &version, sizeof(version));
+	if (ret != 0) {
+		DBGC(nic, "af_packet %p setsockopt(PACKET_VERSION) = %d "
+		     "(%s)\n", nic, ret, linux_strerror(linux_errno));
+		return ret;
+	}
+
+	memset(&req, 0, sizeof(req));
+	req.tp_block_size = AF_PACKET_BLOCK_LEN;
+	req.tp_frame_size = AF_PACKET_FRAME_LEN;
+	req.tp_frame_nr = nic->rx_count;
+	req.tp_block_nr = (nic->rx_count / AF_PACKET_BLOCK_FRAMES);
+	ret = linux_setsockopt(nic->fd, LINUX_SOL_PACKET, PACKET_RX_RING,
+			       &req, sizeof(req));
+	if (ret != 0) {
+		DBGC(nic, "af_packet %p setsockopt(PACKET_RX_RING) = %d "
+		     "(%s)\n", nic, ret, linux_strerror(linux_errno));
+		return ret;
+	}
+
+	req.tp_frame_nr = AF_PACKET_TX_COUNT;
+	req.tp_block_nr = (AF_PACKET_TX_COUNT / AF_PACKET_BLOCK_FRAMES);
+	ret = linux_setsockopt(nic->fd, LINUX_SOL_PACKET, PACKET_TX_RING,
+			       &req, sizeof(req));
+	if (ret != 0) {
+		DBGC(nic, "af_packet %p setsockopt(PACKET_TX_RING) = %d "
+		     "(%s)\n", nic, ret, linux_strerror(linux_errno));
+		return ret;
+	}
+
+	/* The transmit ring immediately follows the receive ring */
+	nic->ring_len = ((nic->rx_count + AF_PACKET_TX_COUNT) *
+			 AF_PACKET_FRAME_LEN);
+	ring = linux_mmap(NULL, nic->ring_len, (PROT_READ | PROT_WRITE),
+			  MAP_SHARED, nic->fd, 0);
+	if (ring == MAP_FAILED) {
+		DBGC(nic, "af_packet %p mmap() failed (%s)\n",
+		     nic, linux_strerror(linux_errno));
+		return -ENOMEM;
+	}
+	nic->ring = ring;
+
+	DBGC(nic, "af_packet %p using %d RX and %d TX ring frames\n",
+	     nic, nic->rx_count, AF_PACKET_TX_COUNT);
+	return 0;
+}
+
+/**
+ * Get receive ring frame
+ *
+ * @v nic		AF_PACKET NIC
+ * @v index		Frame index
+ * @ret hdr		Frame header
+ */
+static inline struct tpacket2_hdr * af_packet_rx_frame ( struct af_packet_nic
+							 *nic,
+							 unsigned int index )
+{
+	return (nic->ring +
+		((index & (nic->rx_count - 1)) * AF_PACKET_FRAME_LEN));
+}
+
+/**
+ * Get transmit ring frame
+ *
+ * @v nic		AF_PACKET NIC
+ * @v index		Frame index
+ * @ret hdr		Frame header
+ */
+static inline struct tpacket2_hdr * af_packet_tx_frame ( struct af_packet_nic
+							 *nic,
+							 unsigned int index )
+{
+	return (nic->ring +
+		((nic->rx_count + (index & (AF_PACKET_TX_COUNT - 1))) *
+		 AF_PACKET_FRAME_LEN));
+}
+
+/**
+ * Ask kernel to transmit any queued transmit ring frames
+ *
+ * @v nic		AF_PACKET NIC
+ */
+static void af_packet_nic_kick ( struct af_packet_nic *nic )
+{
+	int rc;
+
+	if (! nic->tx_pending)
+		return;
+	nic->tx_pending = 0;
+
+	rc = linux_sendto(nic->fd, NULL, 0, 0, NULL, 0);
+	if (rc < 0) {
+		DBGC(nic, "af_packet %p TX ring send failed (%s)\n",
+		     nic, linux_strerror(linux_errno));
+	}
+}
+
 /** Open the linux interface */
 static int af_packet_nic_open ( struct net_device * netdev )
 {
 	struct af_packet_nic * nic = netdev->priv;
 	struct sockaddr_ll socket_address;
+	struct packet_mreq mreq;
 	struct ifreq if_data;
 	int ret;
 
@@ -107,6 +296,28 @@ static int af_packet_nic_open ( struct net_device * netdev )
 		return ret;
 	}
 
+	/* If our MAC address has been overridden (e.g. to allow
+	 * several network devices to share a single interface), then
+	 * we must receive frames addressed to other MAC addresses.
+	 */
+	nic->promisc = 0;
+	if (memcmp(netdev->ll_addr, netdev->hw_addr, ETH_ALEN) != 0) {
+		memset(&mreq, 0, sizeof(mreq));
+		mreq.mr_ifindex = nic->ifindex;
+		mreq.mr_type = PACKET_MR_PROMISC;
+		ret = linux_setsockopt(nic->fd, LINUX_SOL_PACKET,
+				       PACKET_ADD_MEMBERSHIP, &mreq,
+				       sizeof(mreq));
+		if (ret != 0) {
+			DBGC(nic, "af_packet %p setsockopt("
+			     "PACKET_ADD_MEMBERSHIP) = %d (%s)\n",
+			     nic, ret, linux_strerror(linux_errno));
+			linux_close(nic->fd);
+			return ret;
+		}
+		nic->promisc = 1;
+	}
+
 	/* Set nonblocking mode to make af_packet_nic_poll() easier */
 	ret = linux_fcntl(nic->fd, F_SETFL, O_NONBLOCK);
 	if (ret != 0) {
@@ -116,6 +327,14 @@ static int af_packet_nic_open ( struct net_device * netdev )
 		return ret;
 	}
 
+	/* Use memory-mapped rings if available, otherwise fall back
+	 * to one system call per packet.
+	 */
+	af_packet_nic_map(netdev);
+
+	/* Wake up from sleep when a packet arrives */
+	linux_nap_watch(&nic->watch, nic->fd);
+
 	return 0;
 }
 
@@ -123,6 +342,13 @@ static int af_packet_nic_open ( struct net_device * netdev )
 static void af_packet_nic_close ( struct net_device *netdev )
 {
 	struct af_packet_nic * nic = netdev->priv;
+
+	linux_nap_unwatch(&nic->watch);
+	if (nic->ring) {
+		af_packet_nic_kick(nic);
+		linux_munmap(nic->ring, nic->ring_len);
+		nic->ring = NULL;
+	}
 	linux_close(nic->fd);
 }
 
@@ -137,8 +363,38 @@ static int af_packet_nic_transmit ( struct net_device *netdev,
 	struct af_packet_nic * nic = netdev->priv;
 	struct sockaddr_ll socket_address;
 	const struct ethhdr * eh;
+	struct tpacket2_hdr *hdr;
+	size_t len = iob_len(iobuf);
 	int rc;
 
+	/* Queue to transmit ring if possible.  The kernel is asked to
+	 * process the ring once per poll, rather than once per packet.
+	 */
+	if (nic->ring &&
+	    (len <= (AF_PACKET_FRAME_LEN - AF_PACKET_TX_DATA))) {
+		hdr = af_packet_tx_frame(nic, nic->tx_prod);
+		if (hdr->tp_status & (TP_STATUS_SEND_REQUEST |
+				      TP_STATUS_SENDING)) {
+			/* Ring is full: flush and try again */
+			af_packet_nic_kick(nic);
+		}
+		__sync_synchronize();
+		if (! (hdr->tp_status & (TP_STATUS_SEND_REQUEST |
+					 TP_STATUS_SENDING))) {
+			memcpy(((void *)hdr + AF_PACKET_TX_DATA),
+			       iobuf->data, len);
+			hdr->tp_len = len;
+			__sync_synchronize();
+			hdr->tp_status = TP_STATUS_SEND_REQUEST;
+			nic->tx_prod++;
+			nic->tx_pending = 1;
+			DBGC2(nic, "af_packet %p queued %zd bytes\n",
+			      nic, len);
+			netdev_tx_complete(netdev, iobuf);
+			return 0;
+		}
+	}
+
 	memset(&socket_address, 0, sizeof(socket_address));
 	socket_address.sll_family = LINUX_AF_PACKET;
 	socket_address.sll_ifindex = nic->ifindex;
@@ -157,6 +413,60 @@ static int af_packet_nic_transmit ( struct net_device *netdev,
 	return 0;
 }
 
+/**
+ * Poll for new packets in receive ring
+ *
+ * @v netdev		Network device
+ */
+static void af_packet_nic_poll_ring ( struct net_device *netdev )
+{
+	struct af_packet_nic * nic = netdev->priv;
+	struct tpacket2_hdr *hdr;
+	struct sockaddr_ll *sll;
+	struct io_buffer *iobuf;
+	struct list_head burst;
+	unsigned int quota;
+
+	/* Transmit any queued frames */
+	af_packet_nic_kick(nic);
+
+	/* Collect received frames, without any system call */
+	INIT_LIST_HEAD(&burst);
+	for (quota = nic->rx_count; quota; quota--) {
+
+		hdr = af_packet_rx_frame(nic, nic->rx_cons);
+		if (! (hdr->tp_status & TP_STATUS_USER))
+			break;
+		__sync_synchronize();
+
+		/* Ignore copies of our own transmissions */
+		sll = ((void *)hdr +
+		       TPACKET_ALIGN(sizeof(struct tpacket2_hdr)));
+		if ((sll->sll_pkttype != PACKET_OUTGOING) &&
+		    af_packet_nic_wanted(netdev, ((void *)hdr + hdr->tp_mac),
+					 hdr->tp_snaplen)) {
+			DBGC2(nic, "af_packet %p ring read %d bytes\n",
+			      nic, hdr->tp_snaplen);
+			iobuf = alloc_rx_iob(netdev, RX_BUF_SIZE);
+			if (iobuf && (hdr->tp_snaplen <= RX_BUF_SIZE)) {
+				memcpy(iob_put(iobuf, hdr->tp_snaplen),
+				       ((void *)hdr + hdr->tp_mac),
+				       hdr->tp_snaplen);
+				list_add_tail(&iobuf->list, &burst);
+			} else {
+				netdev_rx_err(netdev, iobuf, -ENOBUFS);
+			}
+		}
+
+		/* Return frame to kernel */
+		__sync_synchronize();
+		hdr->tp_status = TP_STATUS_KERNEL;
+		nic->rx_cons++;
+	}
+
+	netdev_rx_burst(netdev, &burst);
+}
+
 /** Poll for new packets */
 static void af_packet_nic_poll ( struct net_device *netdev )
 {
@@ -165,6 +475,11 @@ static void af_packet_nic_poll ( struct net_device *netdev )
 	struct io_buffer * iobuf;
 	int r;
 
+	if (nic->ring) {
+		af_packet_nic_poll_ring(netdev);
+		return;
+	}
+
 	pfd.fd = nic->fd;
 	pfd.events = POLLIN;
 	if (linux_poll(&pfd, 1, 0) == -1) {
@@ -183,6 +498,8 @@ static void af_packet_nic_poll ( struct net_device *netdev )
 
 	while ((r = linux_read(nic->fd, iobuf->data, RX_BUF_SIZE)) > 0) {
 		DBGC2(nic, "af_packet %p read %d bytes\n", nic, r);
+		if (! af_packet_nic_wanted(netdev, iobuf->data, r))
+			continue;
 
 		iob_put(iobuf, r);
 		netdev_rx(netdev, iobuf);
@@ -239,7 +556,7 @@ static int af_packet_update_properties ( struct net_device *netdev )
 
 	linux_close(fd);
 	/* struct sockaddr = { u16 family, u8 pad[14] (equiv. sa_data) }; */
-	memcpy(netdev->ll_addr, if_data.ifr_hwaddr.pad, ETH_ALEN);
+	memcpy(netdev->hw_addr, if_data.ifr_hwaddr.pad, ETH_ALEN);
 	return 0;
 }
 
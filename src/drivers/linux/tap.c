@@ -54,6 +54,8 @@ struct tap_nic {
 	char * interface;
 	/** File descriptor of the opened tap device */
 	int fd;
+	/** File descriptor watch */
+	struct linux_nap_watch watch;
 };
 
 /** Open the TAP device */
@@ -92,6 +94,9 @@ static int tap_open(struct net_device * netdev)
 		return ret;
 	}
 
+	/* Wake up from sleep when a packet arrives */
+	linux_nap_watch(&nic->watch, nic->fd);
+
 	return 0;
 }
 
@@ -99,6 +104,7 @@ static int tap_open(struct net_device * netdev)
 static void tap_close(struct net_device *netdev)
 {
 	struct tap_nic * nic = netdev->priv;
+	linux_nap_unwatch(&nic->watch);
 	linux_close(nic->fd);
 }
 
@@ -142,7 +148,7 @@ static void tap_poll(struct net_device *netdev)
 
 	/* At this point we know there is at least one new packet to be read */
 
-	iobuf = alloc_iob(RX_BUF_SIZE);
+	iobuf = alloc_rx_iob(netdev, RX_BUF_SIZE);
 	if (! iobuf)
 		goto allocfail;
 
@@ -153,7 +159,7 @@ static void tap_poll(struct net_device *netdev)
 		iob_put(iobuf, r);
 		netdev_rx(netdev, iobuf);
 
-		iobuf = alloc_iob(RX_BUF_SIZE);
+		iobuf = alloc_rx_iob(netdev, RX_BUF_SIZE);
 		if (! iobuf)
 			goto allocfail;
 	}
@@ -440,6 +440,8 @@ static int acm_probe ( struct usb_function *func,
 		goto err_alloc;
 	}
 	rndis_init ( rndis, &acm_operations );
+	rndis->rx_mtu = ACM_IN_MTU;
+	rndis->tx_mtu = ACM_OUT_MTU;
 	rndis->netdev->dev = &func->dev;
 	acm = rndis->priv;
 	acm->usb = usb;
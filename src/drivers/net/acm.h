@@ -52,13 +52,22 @@ struct acm_device {
  *
  * This is a policy decision.
  */
-#define ACM_IN_MAX_FILL 8
+#define ACM_IN_MAX_FILL 16
 
 /** Bulk IN buffer size
  *
- * This is a policy decision.
+ * This is a policy decision.  This is advertised to the device as
+ * the maximum transfer size, allowing several packets to be received
+ * within each transfer.
+ */
+#define ACM_IN_MTU 8192
+
+/** Bulk OUT maximum transfer size
+ *
+ * This is a policy decision.  Several packets may be combined within
+ * a single transfer, up to the limits reported by the device.
  */
-#define ACM_IN_MTU 2048
+#define ACM_OUT_MTU 8192
 
 /** Encapsulated response buffer size
  *
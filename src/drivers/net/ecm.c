@@ -30,6 +30,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/if_ether.h>
 #include <ipxe/base16.h>
 #include <ipxe/profile.h>
+#include <ipxe/settings.h>
 #include <ipxe/usb.h>
 #include "ecm.h"
 
@@ -319,8 +320,16 @@ static int ecm_open ( struct net_device *netdev ) {
 	struct ecm_device *ecm = netdev->priv;
 	struct usb_device *usb = ecm->usb;
 	unsigned int filter;
+	unsigned int fill;
 	int rc;
 
+	/* Keep many bulk IN transfers outstanding, since each
+	 * transfer can carry only a single packet.
+	 */
+	fill = netdev_ring_size ( netdev, &rxring_setting, ECM_IN_MAX_FILL,
+				  ECM_IN_FILL_MIN, ECM_IN_FILL_MAX );
+	usb_refill_init ( &ecm->usbnet.in, 0, ECM_IN_MTU, fill );
+
 	/* Open USB network device */
 	if ( ( rc = usbnet_open ( &ecm->usbnet ) ) != 0 ) {
 		DBGC ( ecm, "ECM %p could not open: %s\n",
@@ -75,7 +75,13 @@ struct ecm_device {
  *
  * This is a policy decision.
  */
-#define ECM_IN_MAX_FILL 8
+#define ECM_IN_MAX_FILL 32
+
+/** Bulk IN minimum configurable fill level */
+#define ECM_IN_FILL_MIN 4
+
+/** Bulk IN maximum configurable fill level */
+#define ECM_IN_FILL_MAX 128
 
 /** Bulk IN buffer size
  *
@@ -196,7 +196,7 @@ struct nii_nic {
 };
 
 /** Maximum number of received packets per poll */
-#define NII_RX_QUOTA 4
+#define NII_RX_QUOTA 32
 
 /**
  * Open PCI I/O protocol and identify BARs
@@ -1012,16 +1012,18 @@ static void nii_poll_rx ( struct net_device *netdev ) {
 	struct nii_nic *nii = netdev->priv;
 	PXE_CPB_RECEIVE cpb;
 	PXE_DB_RECEIVE db;
+	struct list_head burst;
 	unsigned int quota;
 	int stat;
 	int rc;
 
 	/* Retrieve up to NII_RX_QUOTA packets */
+	INIT_LIST_HEAD ( &burst );
 	for ( quota = NII_RX_QUOTA ; quota ; quota-- ) {
 
-		/* Allocate buffer, if required */
+		/* Allocate buffer from receive pool, if required */
 		if ( ! nii->rxbuf ) {
-			nii->rxbuf = alloc_iob ( nii->mtu );
+			nii->rxbuf = alloc_rx_iob ( netdev, nii->mtu );
 			if ( ! nii->rxbuf ) {
 				/* Leave for next poll */
 				break;
@@ -1052,11 +1054,14 @@ static void nii_poll_rx ( struct net_device *netdev ) {
 			break;
 		}
 
-		/* Hand off to network stack */
+		/* Add to burst for network stack */
 		iob_put ( nii->rxbuf, db.FrameLen );
-		netdev_rx ( netdev, nii->rxbuf );
+		list_add_tail ( &nii->rxbuf->list, &burst );
 		nii->rxbuf = NULL;
 	}
+
+	/* Hand off to network stack */
+	netdev_rx_burst ( netdev, &burst );
 }
 
 /**
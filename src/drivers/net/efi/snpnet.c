@@ -61,8 +61,14 @@ struct snp_nic {
 	struct io_buffer *rxbuf;
 };
 
-/** Maximum number of received packets per poll */
-#define SNP_RX_QUOTA 4
+/** Maximum number of received packets per poll
+ *
+ * Each receive call into the firmware may carry a substantial fixed
+ * overhead, so we drain as many packets as are available (up to this
+ * limit) on each poll and hand them to the network stack as a
+ * single burst.
+ */
+#define SNP_RX_QUOTA 32
 
 /**
  * Format SNP MAC address (for debugging)
@@ -226,16 +232,21 @@ static void snpnet_poll_tx ( struct net_device *netdev ) {
 static void snpnet_poll_rx ( struct net_device *netdev ) {
 	struct snp_nic *snp = netdev->priv;
 	UINTN len;
+	struct list_head burst;
 	unsigned int quota;
 	EFI_STATUS efirc;
 	int rc;
 
 	/* Retrieve up to SNP_RX_QUOTA packets */
+	INIT_LIST_HEAD ( &burst );
 	for ( quota = SNP_RX_QUOTA ; quota ; quota-- ) {
 
-		/* Allocate buffer, if required */
+		/* Allocate buffer, if required.  Buffers are recycled
+		 * via the receive buffer pool, to avoid repeated heap
+		 * allocations.
+		 */
 		if ( ! snp->rxbuf ) {
-			snp->rxbuf = alloc_iob ( snp->mtu );
+			snp->rxbuf = alloc_rx_iob ( netdev, snp->mtu );
 			if ( ! snp->rxbuf ) {
 				/* Leave for next poll */
 				break;
@@ -262,11 +273,14 @@ static void snpnet_poll_rx ( struct net_device *netdev ) {
 			break;
 		}
 
-		/* Hand off to network stack */
+		/* Add to burst for network stack */
 		iob_put ( snp->rxbuf, len );
-		netdev_rx ( netdev, snp->rxbuf );
+		list_add_tail ( &snp->rxbuf->list, &burst );
 		snp->rxbuf = NULL;
 	}
+
+	/* Hand off to network stack */
+	netdev_rx_burst ( netdev, &burst );
 }
 
 /**
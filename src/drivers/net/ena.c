@@ -25,6 +25,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 #include <stdint.h>
 #include <string.h>
+#include <strings.h>
 #include <unistd.h>
 #include <errno.h>
 #include <byteswap.h>
@@ -34,6 +35,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/iobuf.h>
 #include <ipxe/malloc.h>
 #include <ipxe/pci.h>
+#include <ipxe/settings.h>
 #include "ena.h"
 
 /** @file
@@ -337,23 +339,27 @@ static int ena_create_sq ( struct ena_nic *ena, struct ena_sq *sq,
 	union ena_acq_rsp *rsp;
 	int rc;
 
-	/* Allocate submission queue entries */
-	sq->sqe.raw = malloc_dma ( sq->len, ENA_ALIGN );
-	if ( ! sq->sqe.raw ) {
-		rc = -ENOMEM;
-		goto err_alloc;
+	/* Allocate submission queue entries, if located in host memory */
+	if ( sq->policy != ENA_SQ_DEVICE_MEMORY ) {
+		sq->sqe.raw = malloc_dma ( sq->len, ENA_ALIGN );
+		if ( ! sq->sqe.raw ) {
+			rc = -ENOMEM;
+			goto err_alloc;
+		}
+		memset ( sq->sqe.raw, 0, sq->len );
 	}
-	memset ( sq->sqe.raw, 0, sq->len );
 
 	/* Construct request */
 	req = ena_admin_req ( ena );
 	req->header.opcode = ENA_CREATE_SQ;
 	req->create_sq.direction = sq->direction;
-	req->create_sq.policy = cpu_to_le16 ( ENA_SQ_HOST_MEMORY |
-					      ENA_SQ_CONTIGUOUS );
+	req->create_sq.policy = cpu_to_le16 ( sq->policy );
 	req->create_sq.cq_id = cpu_to_le16 ( cq->id );
 	req->create_sq.count = cpu_to_le16 ( sq->count );
-	req->create_sq.address = cpu_to_le64 ( virt_to_bus ( sq->sqe.raw ) );
+	if ( sq->sqe.raw ) {
+		req->create_sq.address =
+			cpu_to_le64 ( virt_to_bus ( sq->sqe.raw ) );
+	}
 
 	/* Issue request */
 	if ( ( rc = ena_admin ( ena, req, &rsp ) ) != 0 )
@@ -362,20 +368,33 @@ static int ena_create_sq ( struct ena_nic *ena, struct ena_sq *sq,
 	/* Parse response */
 	sq->id = le16_to_cpu ( rsp->create_sq.id );
 	sq->doorbell = le32_to_cpu ( rsp->create_sq.doorbell );
+	if ( ! sq->sqe.raw ) {
+		sq->llq = ( ena->mem +
+			    le32_to_cpu ( rsp->create_sq.llq_desc ) );
+	}
 
-	/* Reset producer counter and phase */
+	/* Reset producer counters and phase */
 	sq->prod = 0;
+	sq->notified = 0;
 	sq->phase = ENA_SQE_PHASE;
 
-	DBGC ( ena, "ENA %p %s SQ%d at [%08lx,%08lx) db +%04x CQ%d\n",
-	       ena, ena_direction ( sq->direction ), sq->id,
-	       virt_to_phys ( sq->sqe.raw ),
-	       ( virt_to_phys ( sq->sqe.raw ) + sq->len ),
-	       sq->doorbell, cq->id );
+	if ( sq->llq ) {
+		DBGC ( ena, "ENA %p %s SQ%d LLQ at +%04x db +%04x CQ%d\n",
+		       ena, ena_direction ( sq->direction ), sq->id,
+		       le32_to_cpu ( rsp->create_sq.llq_desc ),
+		       sq->doorbell, cq->id );
+	} else {
+		DBGC ( ena, "ENA %p %s SQ%d at [%08lx,%08lx) db +%04x CQ%d\n",
+		       ena, ena_direction ( sq->direction ), sq->id,
+		       virt_to_phys ( sq->sqe.raw ),
+		       ( virt_to_phys ( sq->sqe.raw ) + sq->len ),
+		       sq->doorbell, cq->id );
+	}
 	return 0;
 
  err_admin:
 	free_dma ( sq->sqe.raw, sq->len );
+	sq->sqe.raw = NULL;
  err_alloc:
 	return rc;
 }
@@ -404,6 +423,8 @@ static int ena_destroy_sq ( struct ena_nic *ena, struct ena_sq *sq ) {
 
 	/* Free submission queue entries */
 	free_dma ( sq->sqe.raw, sq->len );
+	sq->sqe.raw = NULL;
+	sq->llq = NULL;
 
 	DBGC ( ena, "ENA %p %s SQ%d destroyed\n",
 	       ena, ena_direction ( sq->direction ), sq->id );
@@ -566,12 +587,203 @@ static int ena_get_device_attributes ( struct net_device *netdev ) {
 	memcpy ( netdev->hw_addr, feature->device.mac, ETH_ALEN );
 	netdev->max_pkt_len = le32_to_cpu ( feature->device.mtu );
 	netdev->mtu = ( netdev->max_pkt_len - ETH_HLEN );
+	ena->features = le32_to_cpu ( feature->device.features );
+
+	DBGC ( ena, "ENA %p MAC %s MTU %zd features %#08x\n",
+	       ena, eth_ntoa ( netdev->hw_addr ), netdev->max_pkt_len,
+	       ena->features );
+	return 0;
+}
+
+/**
+ * Round down queue depth limit to a power of two
+ *
+ * @v limit		Queue depth limit reported by device
+ * @ret limit		Usable queue depth limit
+ */
+static unsigned int ena_limit ( uint32_t limit ) {
+
+	/* Treat a missing limit as allowing only the fallback depth */
+	if ( ! limit )
+		return ENA_FALLBACK_COUNT;
+
+	return ( 1UL << ( fls ( limit ) - 1 ) );
+}
+
+/**
+ * Get queue depth limits
+ *
+ * @v ena		ENA device
+ * @ret rc		Return status code
+ */
+static int ena_get_limits ( struct ena_nic *ena ) {
+	struct ena_limits *limits = &ena->limits;
+	union ena_aq_req *req;
+	union ena_acq_rsp *rsp;
+	union ena_feature *feature;
+	uint32_t tx_sq;
+	uint32_t tx_cq;
+	uint32_t rx_sq;
+	uint32_t rx_cq;
+	int rc;
+
+	/* Use fallback depth if device does not report limits */
+	limits->tx = ENA_FALLBACK_COUNT;
+	limits->rx = ENA_FALLBACK_COUNT;
+
+	/* Prefer extended limits, which distinguish transmit and receive */
+	if ( ENA_FEATURE_SUPPORTED ( ena->features, ENA_MAX_QUEUES_EXT ) ) {
+		req = ena_admin_req ( ena );
+		req->header.opcode = ENA_GET_FEATURE;
+		req->get_feature.id = ENA_MAX_QUEUES_EXT;
+		req->get_feature.version = ENA_MAX_QUEUES_EXT_VERSION;
+	} else if ( ENA_FEATURE_SUPPORTED ( ena->features, ENA_MAX_QUEUES ) ) {
+		req = ena_admin_req ( ena );
+		req->header.opcode = ENA_GET_FEATURE;
+		req->get_feature.id = ENA_MAX_QUEUES;
+	} else {
+		DBGC ( ena, "ENA %p does not report queue depth limits\n",
+		       ena );
+		return 0;
+	}
+
+	/* Issue request */
+	if ( ( rc = ena_admin ( ena, req, &rsp ) ) != 0 )
+		return rc;
+
+	/* Parse response */
+	feature = &rsp->get_feature.feature;
+	if ( ENA_FEATURE_SUPPORTED ( ena->features, ENA_MAX_QUEUES_EXT ) ) {
+		tx_sq = le32_to_cpu ( feature->max_queues_ext.tx_sq_depth );
+		tx_cq = le32_to_cpu ( feature->max_queues_ext.tx_cq_depth );
+		rx_sq = le32_to_cpu ( feature->max_queues_ext.rx_sq_depth );
+		rx_cq = le32_to_cpu ( feature->max_queues_ext.rx_cq_depth );
+	} else {
+		tx_sq = rx_sq = le32_to_cpu ( feature->max_queues.sq_depth );
+		tx_cq = rx_cq = le32_to_cpu ( feature->max_queues.cq_depth );
+	}
+	limits->tx = ena_limit ( ( tx_sq < tx_cq ) ? tx_sq : tx_cq );
+	limits->rx = ena_limit ( ( rx_sq < rx_cq ) ? rx_sq : rx_cq );
+
+	DBGC ( ena, "ENA %p maximum queue depths TX %d RX %d\n",
+	       ena, limits->tx, limits->rx );
+	return 0;
+}
+
+/**
+ * Enable low latency queues, if supported
+ *
+ * @v ena		ENA device
+ * @ret rc		Return status code
+ *
+ * Low latency queues place the transmit descriptors (and the start
+ * of each packet) directly in device memory, saving the device from
+ * having to fetch them via DMA.  Failure to enable low latency
+ * queues is not fatal: the transmit queue will simply be placed in
+ * host memory.
+ */
+static int ena_enable_llq ( struct ena_nic *ena ) {
+	struct ena_limits *limits = &ena->limits;
+	union ena_aq_req *req;
+	union ena_acq_rsp *rsp;
+	struct ena_llq *llq;
+	unsigned int stride;
+	uint16_t supported;
+	unsigned int count;
+	int rc;
+
+	/* Do nothing unless device memory is mapped */
+	if ( ! ena->mem )
+		return -ENOTSUP;
+
+	/* Get low latency queue capabilities */
+	req = ena_admin_req ( ena );
+	req->header.opcode = ENA_GET_FEATURE;
+	req->get_feature.id = ENA_LLQ;
+	if ( ( rc = ena_admin ( ena, req, &rsp ) ) != 0 )
+		return rc;
+	llq = &rsp->get_feature.feature.llq;
+
+	/* Check for a supported layout: 128-byte entries holding two
+	 * descriptors followed by an inline header.
+	 */
+	if ( ! ( le16_to_cpu ( llq->header.supported ) &
+		 ENA_LLQ_HEADER_INLINE ) ) {
+		DBGC ( ena, "ENA %p LLQ lacks inline headers\n", ena );
+		return -ENOTSUP;
+	}
+	if ( ! ( le16_to_cpu ( llq->size.supported ) & ENA_LLQ_SIZE_128 ) ) {
+		DBGC ( ena, "ENA %p LLQ lacks 128-byte entries\n", ena );
+		return -ENOTSUP;
+	}
+	if ( ! ( le16_to_cpu ( llq->desc.supported ) & ENA_LLQ_DESC_2 ) ) {
+		DBGC ( ena, "ENA %p LLQ lacks two-descriptor headers\n", ena );
+		return -ENOTSUP;
+	}
+	supported = le16_to_cpu ( llq->stride.supported );
+	if ( supported & ENA_LLQ_STRIDE_MULTIPLE ) {
+		stride = ENA_LLQ_STRIDE_MULTIPLE;
+	} else if ( supported & ENA_LLQ_STRIDE_SINGLE ) {
+		stride = ENA_LLQ_STRIDE_SINGLE;
+	} else {
+		DBGC ( ena, "ENA %p LLQ lacks usable stride\n", ena );
+		return -ENOTSUP;
+	}
+	count = le32_to_cpu ( llq->count );
+	if ( ! ( llq->queues && count ) ) {
+		DBGC ( ena, "ENA %p LLQ has no queues\n", ena );
+		return -ENOTSUP;
+	}
+
+	/* Enable low latency queues */
+	req = ena_admin_req ( ena );
+	req->header.opcode = ENA_SET_FEATURE;
+	req->set_feature.id = ENA_LLQ;
+	llq = &req->set_feature.feature.llq;
+	llq->header.enabled = cpu_to_le16 ( ENA_LLQ_HEADER_INLINE );
+	llq->size.enabled = cpu_to_le16 ( ENA_LLQ_SIZE_128 );
+	llq->desc.enabled = cpu_to_le16 ( ENA_LLQ_DESC_2 );
+	llq->stride.enabled = cpu_to_le16 ( stride );
+	if ( ( rc = ena_admin ( ena, req, &rsp ) ) != 0 )
+		return rc;
+
+	/* Record low latency queue depth limit */
+	limits->llq = ena_limit ( count );
+	if ( limits->llq > limits->tx )
+		limits->llq = limits->tx;
 
-	DBGC ( ena, "ENA %p MAC %s MTU %zd\n",
-	       ena, eth_ntoa ( netdev->hw_addr ), netdev->max_pkt_len );
+	DBGC ( ena, "ENA %p LLQ enabled (stride %d, maximum depth %d)\n",
+	       ena, stride, limits->llq );
 	return 0;
 }
 
+/**
+ * Choose queue depth
+ *
+ * @v netdev		Network device
+ * @v setting		Ring size setting
+ * @v count		Default number of entries
+ * @v max		Maximum supported number of entries
+ * @v limit		Device queue depth limit
+ * @ret count		Number of entries
+ */
+static unsigned int ena_ring_size ( struct net_device *netdev,
+				    const struct setting *setting,
+				    unsigned int count, unsigned int max,
+				    unsigned int limit ) {
+	unsigned int min = ENA_MIN_COUNT;
+
+	/* Apply device limit */
+	if ( max > limit )
+		max = limit;
+	if ( min > max )
+		min = max;
+	if ( count > max )
+		count = max;
+
+	return netdev_ring_size ( netdev, setting, count, min, max );
+}
+
 /**
  * Get statistics (for debugging)
  *
@@ -631,20 +843,26 @@ static void ena_refill_rx ( struct net_device *netdev ) {
 	unsigned int index;
 	physaddr_t address;
 	size_t len = netdev->max_pkt_len;
+	unsigned int count = ena->rx.sq.count;
 	unsigned int refilled = 0;
 
+	/* Refill only in batches, to minimise doorbell writes */
+	if ( ( count - ( ena->rx.sq.prod - ena->rx.cq.cons ) ) <
+	     ENA_RX_REFILL_BATCH ( count ) )
+		return;
+
 	/* Refill queue */
-	while ( ( ena->rx.sq.prod - ena->rx.cq.cons ) < ENA_RX_COUNT ) {
+	while ( ( ena->rx.sq.prod - ena->rx.cq.cons ) < count ) {
 
 		/* Allocate I/O buffer */
-		iobuf = alloc_iob ( len );
+		iobuf = alloc_rx_iob ( netdev, len );
 		if ( ! iobuf ) {
 			/* Wait for next refill */
 			break;
 		}
 
 		/* Get next submission queue entry */
-		index = ( ena->rx.sq.prod % ENA_RX_COUNT );
+		index = ( ena->rx.sq.prod & ( count - 1 ) );
 		sqe = &ena->rx.sq.sqe.rx[index];
 
 		/* Construct submission queue entry */
@@ -658,7 +876,7 @@ static void ena_refill_rx ( struct net_device *netdev ) {
 
 		/* Increment producer counter */
 		ena->rx.sq.prod++;
-		if ( ( ena->rx.sq.prod % ENA_RX_COUNT ) == 0 )
+		if ( ( ena->rx.sq.prod & ( count - 1 ) ) == 0 )
 			ena->rx.sq.phase ^= ENA_SQE_PHASE;
 
 		/* Record I/O buffer */
@@ -686,7 +904,7 @@ static void ena_refill_rx ( struct net_device *netdev ) {
 static void ena_empty_rx ( struct ena_nic *ena ) {
 	unsigned int i;
 
-	for ( i = 0 ; i < ENA_RX_COUNT ; i++ ) {
+	for ( i = 0 ; i < ENA_RX_MAX_COUNT ; i++ ) {
 		if ( ena->rx_iobuf[i] )
 			free_iob ( ena->rx_iobuf[i] );
 		ena->rx_iobuf[i] = NULL;
@@ -701,8 +919,30 @@ static void ena_empty_rx ( struct ena_nic *ena ) {
  */
 static int ena_open ( struct net_device *netdev ) {
 	struct ena_nic *ena = netdev->priv;
+	struct ena_limits *limits = &ena->limits;
+	unsigned int tx_policy;
+	unsigned int tx_count;
+	unsigned int rx_count;
 	int rc;
 
+	/* Choose queue depths */
+	tx_policy = ( limits->llq ? ENA_SQ_DEVICE_MEMORY :
+		      ( ENA_SQ_HOST_MEMORY | ENA_SQ_CONTIGUOUS ) );
+	tx_count = ena_ring_size ( netdev, &txring_setting, ENA_TX_COUNT,
+				   ENA_TX_MAX_COUNT,
+				   ( limits->llq ? limits->llq : limits->tx ) );
+	rx_count = ena_ring_size ( netdev, &rxring_setting, ENA_RX_COUNT,
+				   ENA_RX_MAX_COUNT, limits->rx );
+	ena_cq_init ( &ena->tx.cq, tx_count,
+		      sizeof ( ena->tx.cq.cqe.tx[0] ) );
+	ena_sq_init ( &ena->tx.sq, ENA_SQ_TX, tx_policy, tx_count,
+		      sizeof ( ena->tx.sq.sqe.tx[0] ) );
+	ena_cq_init ( &ena->rx.cq, rx_count,
+		      sizeof ( ena->rx.cq.cqe.rx[0] ) );
+	ena_sq_init ( &ena->rx.sq, ENA_SQ_RX,
+		      ( ENA_SQ_HOST_MEMORY | ENA_SQ_CONTIGUOUS ), rx_count,
+		      sizeof ( ena->rx.sq.sqe.rx[0] ) );
+
 	/* Create transmit queue pair */
 	if ( ( rc = ena_create_qp ( ena, &ena->tx ) ) != 0 )
 		goto err_create_tx;
@@ -744,6 +984,64 @@ static void ena_close ( struct net_device *netdev ) {
 	ena_destroy_qp ( ena, &ena->tx );
 }
 
+/**
+ * Ring transmit doorbell, if applicable
+ *
+ * @v ena		ENA device
+ */
+static void ena_notify_tx ( struct ena_nic *ena ) {
+
+	/* Do nothing unless new entries have been submitted */
+	if ( ena->tx.sq.notified == ena->tx.sq.prod )
+		return;
+
+	/* Ring doorbell */
+	wmb();
+	writel ( ena->tx.sq.prod, ( ena->regs + ena->tx.sq.doorbell ) );
+	ena->tx.sq.notified = ena->tx.sq.prod;
+}
+
+/**
+ * Construct low latency queue entry
+ *
+ * @v ena		ENA device
+ * @v index		Submission queue index
+ * @v iobuf		I/O buffer
+ * @v flags		Submission queue entry flags
+ *
+ * As much of the packet as will fit is pushed inline with the
+ * descriptor, and the descriptor covers only the remainder (if any).
+ */
+static void ena_transmit_llq ( struct ena_nic *ena, unsigned int index,
+			       struct io_buffer *iobuf, unsigned int flags ) {
+	union ena_llq_entry entry;
+	struct ena_tx_sqe *sqe = &entry.sqe[0];
+	uint64_t *dest;
+	uint64_t address;
+	size_t len = iob_len ( iobuf );
+	size_t inlined;
+	unsigned int i;
+
+	/* Construct entry */
+	memset ( &entry, 0, sizeof ( entry ) );
+	inlined = len;
+	if ( inlined > sizeof ( entry.header ) )
+		inlined = sizeof ( entry.header );
+	memcpy ( entry.header, iobuf->data, inlined );
+	address = ( virt_to_bus ( iobuf->data ) + inlined );
+	sqe->len = cpu_to_le16 ( len - inlined );
+	sqe->id = ena->tx.sq.prod;
+	sqe->address = cpu_to_le64 ( address | ENA_TX_SQE_INLINE ( inlined ) );
+	sqe->flags = flags;
+
+	/* Copy entry to device memory */
+	dest = ( ena->tx.sq.llq + ( index * sizeof ( entry ) ) );
+	for ( i = 0 ; i < ( sizeof ( entry.raw ) /
+			    sizeof ( entry.raw[0] ) ) ; i++ ) {
+		writeq ( entry.raw[i], &dest[i] );
+	}
+}
+
 /**
  * Transmit packet
  *
@@ -754,40 +1052,52 @@ static void ena_close ( struct net_device *netdev ) {
 static int ena_transmit ( struct net_device *netdev, struct io_buffer *iobuf ) {
 	struct ena_nic *ena = netdev->priv;
 	struct ena_tx_sqe *sqe;
+	unsigned int count = ena->tx.sq.count;
 	unsigned int index;
+	unsigned int flags;
 	physaddr_t address;
 	size_t len;
 
 	/* Get next submission queue entry */
-	if ( ( ena->tx.sq.prod - ena->tx.cq.cons ) >= ENA_TX_COUNT ) {
+	if ( ( ena->tx.sq.prod - ena->tx.cq.cons ) >= count ) {
 		DBGC ( ena, "ENA %p out of transmit descriptors\n", ena );
 		return -ENOBUFS;
 	}
-	index = ( ena->tx.sq.prod % ENA_TX_COUNT );
-	sqe = &ena->tx.sq.sqe.tx[index];
-
-	/* Construct submission queue entry */
+	index = ( ena->tx.sq.prod & ( count - 1 ) );
 	address = virt_to_bus ( iobuf->data );
 	len = iob_len ( iobuf );
-	sqe->len = cpu_to_le16 ( len );
-	sqe->id = ena->tx.sq.prod;
-	sqe->address = cpu_to_le64 ( address );
-	wmb();
-	sqe->flags = ( ENA_SQE_FIRST | ENA_SQE_LAST | ENA_SQE_CPL |
-		       ena->tx.sq.phase );
-	wmb();
+	flags = ( ENA_SQE_FIRST | ENA_SQE_LAST | ENA_SQE_CPL |
+		  ena->tx.sq.phase );
+
+	/* Construct submission queue entry */
+	if ( ena->tx.sq.llq ) {
+		ena_transmit_llq ( ena, index, iobuf, flags );
+	} else {
+		sqe = &ena->tx.sq.sqe.tx[index];
+		sqe->len = cpu_to_le16 ( len );
+		sqe->id = ena->tx.sq.prod;
+		sqe->address = cpu_to_le64 ( address );
+		wmb();
+		sqe->flags = flags;
+	}
+	DBGC2 ( ena, "ENA %p TX %d at [%08llx,%08llx)\n",
+		ena, ( ena->tx.sq.prod & 0xff ),
+		( ( unsigned long long ) address ),
+		( ( unsigned long long ) address + len ) );
 
 	/* Increment producer counter */
 	ena->tx.sq.prod++;
-	if ( ( ena->tx.sq.prod % ENA_TX_COUNT ) == 0 )
+	if ( ( ena->tx.sq.prod & ( count - 1 ) ) == 0 )
 		ena->tx.sq.phase ^= ENA_SQE_PHASE;
 
-	/* Ring doorbell */
-	writel ( ena->tx.sq.prod, ( ena->regs + ena->tx.sq.doorbell ) );
+	/* Ring doorbell once a batch has accumulated.  Any remaining
+	 * entries will be notified when the device is next polled.
+	 */
+	if ( ( ena->tx.sq.prod - ena->tx.sq.notified ) >=
+	     ENA_TX_DOORBELL_BATCH ) {
+		ena_notify_tx ( ena );
+	}
 
-	DBGC2 ( ena, "ENA %p TX %d at [%08llx,%08llx)\n", ena, sqe->id,
-		( ( unsigned long long ) address ),
-		( ( unsigned long long ) address + len ) );
 	return 0;
 }
 
@@ -833,19 +1143,22 @@ static void ena_poll_rx ( struct net_device *netdev ) {
 	struct ena_nic *ena = netdev->priv;
 	struct ena_rx_cqe *cqe;
 	struct io_buffer *iobuf;
+	struct list_head burst;
 	unsigned int index;
+	unsigned int proto;
 	size_t len;
 
 	/* Check for received packets */
+	INIT_LIST_HEAD ( &burst );
 	while ( ena->rx.cq.cons != ena->rx.sq.prod ) {
 
 		/* Get next completion queue entry */
-		index = ( ena->rx.cq.cons % ENA_RX_COUNT );
-		cqe = &ena->rx.cq.cqe.rx[index];
+		index = ( ena->rx.cq.cons & ( ena->rx.sq.count - 1 ) );
+		cqe = &ena->rx.cq.cqe.rx[ ena->rx.cq.cons & ena->rx.cq.mask ];
 
 		/* Stop if completion queue entry is empty */
 		if ( ( cqe->flags ^ ena->rx.cq.phase ) & ENA_CQE_PHASE )
-			return;
+			break;
 
 		/* Increment consumer counter */
 		ena->rx.cq.cons++;
@@ -858,11 +1171,24 @@ static void ena_poll_rx ( struct net_device *netdev ) {
 		len = le16_to_cpu ( cqe->len );
 		iob_put ( iobuf, len );
 
-		/* Hand off to network stack */
+		/* Record hardware checksum verification, if applicable */
+		proto = ENA_RX_CQE_L4_PROTO ( cqe->l4 );
+		if ( ( ( proto == ENA_RX_CQE_L4_TCP ) ||
+		       ( proto == ENA_RX_CQE_L4_UDP ) ) &&
+		     ( cqe->csum & ENA_RX_CQE_CSUM_L4_CHECKED ) &&
+		     ! ( cqe->l4 & ( ENA_RX_CQE_L4_CSUM_ERR |
+				     ENA_RX_CQE_L4_IPV4_FRAG ) ) ) {
+			iobuf->flags |= IOB_CSUM_VERIFIED;
+		}
+
+		/* Add to burst */
 		DBGC2 ( ena, "ENA %p RX %d complete (length %zd)\n",
 			ena, le16_to_cpu ( cqe->id ), len );
-		netdev_rx ( netdev, iobuf );
+		list_add_tail ( &iobuf->list, &burst );
 	}
+
+	/* Hand off completed packets to network stack */
+	netdev_rx_burst ( netdev, &burst );
 }
 
 /**
@@ -871,6 +1197,10 @@ static void ena_poll_rx ( struct net_device *netdev ) {
  * @v netdev		Network device
  */
 static void ena_poll ( struct net_device *netdev ) {
+	struct ena_nic *ena = netdev->priv;
+
+	/* Notify any transmissions submitted since the last poll */
+	ena_notify_tx ( ena );
 
 	/* Poll for transmit completions */
 	ena_poll_tx ( netdev );
@@ -880,6 +1210,9 @@ static void ena_poll ( struct net_device *netdev ) {
 
 	/* Refill receive ring */
 	ena_refill_rx ( netdev );
+
+	/* Notify any transmissions generated by received packets */
+	ena_notify_tx ( ena );
 }
 
 /** ENA network device operations */
@@ -906,6 +1239,8 @@ static struct net_device_operations ena_operations = {
 static int ena_probe ( struct pci_device *pci ) {
 	struct net_device *netdev;
 	struct ena_nic *ena;
+	unsigned long bar_start;
+	unsigned long bar_size;
 	int rc;
 
 	/* Allocate and initialise net device */
@@ -920,14 +1255,6 @@ static int ena_probe ( struct pci_device *pci ) {
 	netdev->dev = &pci->dev;
 	memset ( ena, 0, sizeof ( *ena ) );
 	ena->acq.phase = ENA_ACQ_PHASE;
-	ena_cq_init ( &ena->tx.cq, ENA_TX_COUNT,
-		      sizeof ( ena->tx.cq.cqe.tx[0] ) );
-	ena_sq_init ( &ena->tx.sq, ENA_SQ_TX, ENA_TX_COUNT,
-		      sizeof ( ena->tx.sq.sqe.tx[0] ) );
-	ena_cq_init ( &ena->rx.cq, ENA_RX_COUNT,
-		      sizeof ( ena->rx.cq.cqe.rx[0] ) );
-	ena_sq_init ( &ena->rx.sq, ENA_SQ_RX, ENA_RX_COUNT,
-		      sizeof ( ena->rx.sq.sqe.rx[0] ) );
 
 	/* Fix up PCI device */
 	adjust_pci_device ( pci );
@@ -939,6 +1266,12 @@ static int ena_probe ( struct pci_device *pci ) {
 		goto err_ioremap;
 	}
 
+	/* Map device memory, if present (used for low latency queues) */
+	bar_start = pci_bar_start ( pci, ENA_MEM_BAR );
+	bar_size = pci_bar_size ( pci, ENA_MEM_BAR );
+	if ( bar_start && bar_size )
+		ena->mem = ioremap ( bar_start, bar_size );
+
 	/* Reset the NIC */
 	if ( ( rc = ena_reset ( ena ) ) != 0 )
 		goto err_reset;
@@ -951,6 +1284,14 @@ static int ena_probe ( struct pci_device *pci ) {
 	if ( ( rc = ena_get_device_attributes ( netdev ) ) != 0 )
 		goto err_get_device_attributes;
 
+	/* Get queue depth limits */
+	if ( ( rc = ena_get_limits ( ena ) ) != 0 )
+		goto err_get_limits;
+
+	/* Enable low latency queues, if supported */
+	if ( ENA_FEATURE_SUPPORTED ( ena->features, ENA_LLQ ) )
+		ena_enable_llq ( ena );
+
 	/* Register network device */
 	if ( ( rc = register_netdev ( netdev ) ) != 0 )
 		goto err_register_netdev;
@@ -964,11 +1305,14 @@ static int ena_probe ( struct pci_device *pci ) {
 
 	unregister_netdev ( netdev );
  err_register_netdev:
+ err_get_limits:
  err_get_device_attributes:
 	ena_destroy_admin ( ena );
  err_create_admin:
 	ena_reset ( ena );
  err_reset:
+	if ( ena->mem )
+		iounmap ( ena->mem );
 	iounmap ( ena->regs );
  err_ioremap:
 	netdev_nullify ( netdev );
@@ -996,6 +1340,8 @@ static void ena_remove ( struct pci_device *pci ) {
 	ena_reset ( ena );
 
 	/* Free network device */
+	if ( ena->mem )
+		iounmap ( ena->mem );
 	iounmap ( ena->regs );
 	netdev_nullify ( netdev );
 	netdev_put ( netdev );
@@ -15,6 +15,9 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 /** BAR size */
 #define ENA_BAR_SIZE 16384
 
+/** Memory BAR (used for low latency queues) */
+#define ENA_MEM_BAR PCI_BASE_ADDRESS_2
+
 /** Queue alignment */
 #define ENA_ALIGN 4096
 
@@ -24,11 +27,43 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 /** Number of admin completion queue entries */
 #define ENA_ACQ_COUNT 2
 
-/** Number of transmit queue entries */
-#define ENA_TX_COUNT 16
+/** Default number of transmit queue entries
+ *
+ * This may be overridden at runtime via the "txring" setting.
+ */
+#define ENA_TX_COUNT 64
+
+/** Maximum number of transmit queue entries */
+#define ENA_TX_MAX_COUNT 256
+
+/** Default number of receive queue entries
+ *
+ * This may be overridden at runtime via the "rxring" setting.
+ */
+#define ENA_RX_COUNT 64
+
+/** Maximum number of receive queue entries */
+#define ENA_RX_MAX_COUNT 256
 
-/** Number of receive queue entries */
-#define ENA_RX_COUNT 16
+/** Minimum number of transmit or receive queue entries */
+#define ENA_MIN_COUNT 8
+
+/** Fallback number of queue entries, if device limits are unknown */
+#define ENA_FALLBACK_COUNT 16
+
+/** Receive queue refill batch size
+ *
+ * The receive queue is refilled only once at least this fraction of
+ * the queue is empty, to minimise the number of doorbell writes.
+ */
+#define ENA_RX_REFILL_BATCH( count ) ( (count) / 4 )
+
+/** Transmit doorbell batch size
+ *
+ * The transmit doorbell is written when this many packets are
+ * pending, or when the device is next polled.
+ */
+#define ENA_TX_DOORBELL_BATCH 8
 
 /** Base address low register offset */
 #define ENA_BASE_LO 0x0
@@ -105,6 +140,14 @@ struct ena_acq_header {
 /** Device attributes */
 #define ENA_DEVICE_ATTRIBUTES 1
 
+/** Feature is supported
+ *
+ * @v features		Supported features bitmask
+ * @v id		Feature identifier
+ * @ret supported	Feature is supported
+ */
+#define ENA_FEATURE_SUPPORTED( features, id ) ( (features) & ( 1UL << (id) ) )
+
 /** Device attributes */
 struct ena_device_attributes {
 	/** Implementation */
@@ -127,10 +170,121 @@ struct ena_device_attributes {
 	uint32_t mtu;
 } __attribute__ (( packed ));
 
+/** Maximum queue sizes */
+#define ENA_MAX_QUEUES 2
+
+/** Maximum queue sizes */
+struct ena_max_queues {
+	/** Maximum number of submission queues */
+	uint32_t sq_num;
+	/** Maximum submission queue depth */
+	uint32_t sq_depth;
+	/** Maximum number of completion queues */
+	uint32_t cq_num;
+	/** Maximum completion queue depth */
+	uint32_t cq_depth;
+	/** Maximum number of low latency queues */
+	uint32_t llq_num;
+	/** Maximum low latency queue depth */
+	uint32_t llq_depth;
+	/** Maximum header size */
+	uint32_t header;
+	/** Maximum transmit descriptors per packet */
+	uint16_t tx_descs;
+	/** Maximum receive descriptors per packet */
+	uint16_t rx_descs;
+} __attribute__ (( packed ));
+
+/** Low latency queues */
+#define ENA_LLQ 4
+
+/** Low latency queue option */
+struct ena_llq_option {
+	/** Bitmask of supported option values */
+	uint16_t supported;
+	/** Single-entry bitmask of the enabled option value */
+	uint16_t enabled;
+} __attribute__ (( packed ));
+
+/** Low latency queues */
+struct ena_llq {
+	/** Maximum number of low latency queues */
+	uint32_t queues;
+	/** Maximum queue depth */
+	uint32_t count;
+	/** Header locations */
+	struct ena_llq_option header;
+	/** Entry sizes */
+	struct ena_llq_option size;
+	/** Descriptor counts before inline header */
+	struct ena_llq_option desc;
+	/** Descriptor strides */
+	struct ena_llq_option stride;
+	/** Reserved */
+	uint8_t reserved[12];
+} __attribute__ (( packed ));
+
+/** Low latency queue header is inline with the descriptors */
+#define ENA_LLQ_HEADER_INLINE 0x0001
+
+/** Low latency queue entries are 128 bytes */
+#define ENA_LLQ_SIZE_128 0x0001
+
+/** Low latency queue has two descriptors before inline header */
+#define ENA_LLQ_DESC_2 0x0002
+
+/** Low latency queue has a single descriptor per entry */
+#define ENA_LLQ_STRIDE_SINGLE 0x0001
+
+/** Low latency queue has multiple descriptors per entry */
+#define ENA_LLQ_STRIDE_MULTIPLE 0x0002
+
+/** Maximum queue sizes (extended) */
+#define ENA_MAX_QUEUES_EXT 7
+
+/** Maximum queue sizes (extended) feature version */
+#define ENA_MAX_QUEUES_EXT_VERSION 1
+
+/** Maximum queue sizes (extended) */
+struct ena_max_queues_ext {
+	/** Version */
+	uint8_t version;
+	/** Reserved */
+	uint8_t reserved[3];
+	/** Maximum number of transmit submission queues */
+	uint32_t tx_sq_num;
+	/** Maximum number of transmit completion queues */
+	uint32_t tx_cq_num;
+	/** Maximum number of receive submission queues */
+	uint32_t rx_sq_num;
+	/** Maximum number of receive completion queues */
+	uint32_t rx_cq_num;
+	/** Maximum transmit submission queue depth */
+	uint32_t tx_sq_depth;
+	/** Maximum transmit completion queue depth */
+	uint32_t tx_cq_depth;
+	/** Maximum receive submission queue depth */
+	uint32_t rx_sq_depth;
+	/** Maximum receive completion queue depth */
+	uint32_t rx_cq_depth;
+	/** Maximum transmit header size */
+	uint32_t header;
+	/** Maximum transmit descriptors per packet */
+	uint16_t tx_descs;
+	/** Maximum receive descriptors per packet */
+	uint16_t rx_descs;
+} __attribute__ (( packed ));
+
 /** Feature */
 union ena_feature {
 	/** Device attributes */
 	struct ena_device_attributes device;
+	/** Maximum queue sizes */
+	struct ena_max_queues max_queues;
+	/** Low latency queues */
+	struct ena_llq llq;
+	/** Maximum queue sizes (extended) */
+	struct ena_max_queues_ext max_queues_ext;
 };
 
 /** Submission queue direction */
@@ -170,6 +324,8 @@ struct ena_create_sq_req {
 enum ena_sq_policy {
 	/** Use host memory */
 	ENA_SQ_HOST_MEMORY = 0x0001,
+	/** Use device memory (low latency queue) */
+	ENA_SQ_DEVICE_MEMORY = 0x0003,
 	/** Memory is contiguous */
 	ENA_SQ_CONTIGUOUS = 0x0100,
 };
@@ -280,8 +436,10 @@ struct ena_get_feature_req {
 	uint8_t flags;
 	/** Feature identifier */
 	uint8_t id;
+	/** Feature version */
+	uint8_t version;
 	/** Reserved */
-	uint8_t reserved[2];
+	uint8_t reserved;
 } __attribute__ (( packed ));
 
 /** Get feature response */
@@ -292,6 +450,35 @@ struct ena_get_feature_rsp {
 	union ena_feature feature;
 } __attribute__ (( packed ));
 
+/** Set feature */
+#define ENA_SET_FEATURE 9
+
+/** Set feature request */
+struct ena_set_feature_req {
+	/** Header */
+	struct ena_aq_header header;
+	/** Length */
+	uint32_t len;
+	/** Address */
+	uint64_t address;
+	/** Flags */
+	uint8_t flags;
+	/** Feature identifier */
+	uint8_t id;
+	/** Feature version */
+	uint8_t version;
+	/** Reserved */
+	uint8_t reserved;
+	/** Feature */
+	union ena_feature feature;
+} __attribute__ (( packed ));
+
+/** Set feature response */
+struct ena_set_feature_rsp {
+	/** Header */
+	struct ena_acq_header header;
+} __attribute__ (( packed ));
+
 /** Get statistics */
 #define ENA_GET_STATS 11
 
@@ -352,6 +539,8 @@ union ena_aq_req {
 	struct ena_destroy_cq_req destroy_cq;
 	/** Get feature */
 	struct ena_get_feature_req get_feature;
+	/** Set feature */
+	struct ena_set_feature_req set_feature;
 	/** Get statistics */
 	struct ena_get_stats_req get_stats;
 	/** Padding */
@@ -372,6 +561,8 @@ union ena_acq_rsp {
 	struct ena_destroy_cq_rsp destroy_cq;
 	/** Get feature */
 	struct ena_get_feature_rsp get_feature;
+	/** Set feature */
+	struct ena_set_feature_rsp set_feature;
 	/** Get statistics */
 	struct ena_get_stats_rsp get_stats;
 	/** Padding */
@@ -408,10 +599,33 @@ struct ena_tx_sqe {
 	uint8_t reserved_b[3];
 	/** Request identifier */
 	uint8_t id;
-	/** Address */
+	/** Address (and inline header length) */
 	uint64_t address;
 } __attribute__ (( packed ));
 
+/** Transmit submission queue entry inline header length */
+#define ENA_TX_SQE_INLINE( len ) ( ( ( uint64_t ) (len) ) << 56 )
+
+/** Low latency queue entry size */
+#define ENA_LLQ_ENTRY_SIZE 128
+
+/** Number of descriptors before inline header in a low latency queue */
+#define ENA_LLQ_DESC_COUNT 2
+
+/** A low latency queue entry */
+union ena_llq_entry {
+	struct {
+		/** Descriptors */
+		struct ena_tx_sqe sqe[ENA_LLQ_DESC_COUNT];
+		/** Inline header */
+		uint8_t header[ ENA_LLQ_ENTRY_SIZE -
+				( ENA_LLQ_DESC_COUNT *
+				  sizeof ( struct ena_tx_sqe ) ) ];
+	} __attribute__ (( packed ));
+	/** Raw data (for copying to device memory) */
+	uint64_t raw[ ENA_LLQ_ENTRY_SIZE / sizeof ( uint64_t ) ];
+};
+
 /** Receive submission queue entry */
 struct ena_rx_sqe {
 	/** Length */
@@ -456,8 +670,12 @@ struct ena_tx_cqe {
 
 /** Receive completion queue entry */
 struct ena_rx_cqe {
-	/** Reserved */
-	uint8_t reserved_a[3];
+	/** Layer 3 protocol */
+	uint8_t l3;
+	/** Layer 4 protocol and checksum errors */
+	uint8_t l4;
+	/** Checksum status */
+	uint8_t csum;
 	/** Flags */
 	uint8_t flags;
 	/** Length */
@@ -468,6 +686,24 @@ struct ena_rx_cqe {
 	uint8_t reserved_b[8];
 } __attribute__ (( packed ));
 
+/** Receive completion layer 4 protocol */
+#define ENA_RX_CQE_L4_PROTO( l4 ) ( (l4) & 0x1f )
+
+/** Receive completion layer 4 protocol is TCP */
+#define ENA_RX_CQE_L4_TCP 12
+
+/** Receive completion layer 4 protocol is UDP */
+#define ENA_RX_CQE_L4_UDP 13
+
+/** Receive completion layer 4 checksum error */
+#define ENA_RX_CQE_L4_CSUM_ERR 0x40
+
+/** Receive completion is an IPv4 fragment */
+#define ENA_RX_CQE_L4_IPV4_FRAG 0x80
+
+/** Receive completion layer 4 checksum was checked */
+#define ENA_RX_CQE_CSUM_L4_CHECKED 0x01
+
 /** Completion queue ownership phase flag */
 #define ENA_CQE_PHASE 0x01
 
@@ -482,20 +718,26 @@ struct ena_sq {
 		/** Raw data */
 		void *raw;
 	} sqe;
+	/** Low latency queue entries (in device memory), if applicable */
+	void *llq;
 	/** Doorbell register offset */
 	unsigned int doorbell;
 	/** Total length of entries */
 	size_t len;
 	/** Producer counter */
 	unsigned int prod;
+	/** Producer counter last written to doorbell */
+	unsigned int notified;
 	/** Phase */
 	unsigned int phase;
 	/** Submission queue identifier */
 	uint16_t id;
+	/** Placement policy */
+	uint16_t policy;
 	/** Direction */
 	uint8_t direction;
 	/** Number of entries */
-	uint8_t count;
+	uint16_t count;
 };
 
 /**
@@ -503,15 +745,17 @@ struct ena_sq {
  *
  * @v sq		Submission queue
  * @v direction		Direction
+ * @v policy		Placement policy
  * @v count		Number of entries
  * @v size		Size of each entry
  */
 static inline __attribute__ (( always_inline )) void
-ena_sq_init ( struct ena_sq *sq, unsigned int direction, unsigned int count,
-	      size_t size ) {
+ena_sq_init ( struct ena_sq *sq, unsigned int direction, unsigned int policy,
+	      unsigned int count, size_t size ) {
 
 	sq->len = ( count * size );
 	sq->direction = direction;
+	sq->policy = policy;
 	sq->count = count;
 }
 
@@ -539,11 +783,11 @@ struct ena_cq {
 	/** Entry size (in 32-bit words) */
 	uint8_t size;
 	/** Requested number of entries */
-	uint8_t requested;
+	uint16_t requested;
 	/** Actual number of entries */
-	uint8_t actual;
+	uint16_t actual;
 	/** Actual number of entries minus one */
-	uint8_t mask;
+	uint16_t mask;
 };
 
 /**
@@ -569,10 +813,26 @@ struct ena_qp {
 	struct ena_cq cq;
 };
 
+/** Queue depth limits */
+struct ena_limits {
+	/** Maximum transmit queue depth */
+	unsigned int tx;
+	/** Maximum receive queue depth */
+	unsigned int rx;
+	/** Maximum low latency transmit queue depth, or zero */
+	unsigned int llq;
+};
+
 /** An ENA network card */
 struct ena_nic {
 	/** Registers */
 	void *regs;
+	/** Device memory (for low latency queues), if mapped */
+	void *mem;
+	/** Supported features */
+	uint32_t features;
+	/** Queue depth limits */
+	struct ena_limits limits;
 	/** Admin queue */
 	struct ena_aq aq;
 	/** Admin completion queue */
@@ -582,7 +842,7 @@ struct ena_nic {
 	/** Receive queue */
 	struct ena_qp rx;
 	/** Receive I/O buffers */
-	struct io_buffer *rx_iobuf[ENA_RX_COUNT];
+	struct io_buffer *rx_iobuf[ENA_RX_MAX_COUNT];
 };
 
 #endif /* _ENA_H */
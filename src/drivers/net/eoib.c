@@ -176,6 +176,7 @@ static unsigned int eoib_discard ( void ) {
 
 /** EoIB cache discarder */
 struct cache_discarder eoib_discarder __cache_discarder ( CACHE_EXPENSIVE ) = {
+	.name = "eoib",
 	.discard = eoib_discard,
 };
 
@@ -35,6 +35,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/malloc.h>
 #include <ipxe/pci.h>
 #include <ipxe/profile.h>
+#include <ipxe/vlan.h>
 #include "intel.h"
 
 /** @file
@@ -489,6 +490,30 @@ void intel_reset_ring ( struct intel_nic *intel, unsigned int reg ) {
 	writel ( 0, ( intel->regs + reg + INTEL_xDT ) );
 }
 
+/**
+ * Set descriptor ring sizes
+ *
+ * @v netdev		Network device
+ *
+ * Ring sizes default to INTEL_NUM_TX_DESC and INTEL_NUM_RX_DESC, and
+ * may be overridden via the "txring" and "rxring" settings.  This
+ * must be called before the rings are created.
+ */
+void intel_size_rings ( struct net_device *netdev ) {
+	struct intel_nic *intel = netdev->priv;
+	unsigned int count;
+
+	/* Size transmit ring */
+	count = netdev_ring_size ( netdev, &txring_setting, INTEL_NUM_TX_DESC,
+				   INTEL_MIN_TX_DESC, INTEL_MAX_TX_DESC );
+	intel_size_ring ( &intel->tx, count );
+
+	/* Size receive ring */
+	count = netdev_ring_size ( netdev, &rxring_setting, INTEL_NUM_RX_DESC,
+				   INTEL_MIN_RX_DESC, INTEL_MAX_RX_DESC );
+	intel_size_ring ( &intel->rx, count );
+}
+
 /**
  * Create descriptor ring
  *
@@ -562,9 +587,10 @@ void intel_destroy_ring ( struct intel_nic *intel, struct intel_ring *ring ) {
 /**
  * Refill receive descriptor ring
  *
- * @v intel		Intel device
+ * @v netdev		Network device
  */
-void intel_refill_rx ( struct intel_nic *intel ) {
+void intel_refill_rx ( struct net_device *netdev ) {
+	struct intel_nic *intel = netdev->priv;
 	struct intel_descriptor *rx;
 	struct io_buffer *iobuf;
 	unsigned int rx_idx;
@@ -573,17 +599,18 @@ void intel_refill_rx ( struct intel_nic *intel ) {
 	unsigned int refilled = 0;
 
 	/* Refill ring */
-	while ( ( intel->rx.prod - intel->rx.cons ) < INTEL_RX_FILL ) {
+	while ( ( intel->rx.prod - intel->rx.cons ) <
+		INTEL_RX_FILL ( intel->rx.count ) ) {
 
 		/* Allocate I/O buffer */
-		iobuf = alloc_iob ( INTEL_RX_MAX_LEN );
+		iobuf = alloc_rx_iob ( netdev, INTEL_RX_MAX_LEN );
 		if ( ! iobuf ) {
 			/* Wait for next refill */
 			break;
 		}
 
 		/* Get next receive descriptor */
-		rx_idx = ( intel->rx.prod++ % INTEL_NUM_RX_DESC );
+		rx_idx = ( intel->rx.prod++ % intel->rx.count );
 		rx = &intel->rx.desc[rx_idx];
 
 		/* Populate receive descriptor */
@@ -603,7 +630,7 @@ void intel_refill_rx ( struct intel_nic *intel ) {
 	/* Push descriptors to card, if applicable */
 	if ( refilled ) {
 		wmb();
-		rx_tail = ( intel->rx.prod % INTEL_NUM_RX_DESC );
+		rx_tail = ( intel->rx.prod % intel->rx.count );
 		profile_start ( &intel_vm_refill_profiler );
 		writel ( rx_tail, intel->regs + intel->rx.reg + INTEL_xDT );
 		profile_stop ( &intel_vm_refill_profiler );
@@ -619,7 +646,7 @@ void intel_refill_rx ( struct intel_nic *intel ) {
 void intel_empty_rx ( struct intel_nic *intel ) {
 	unsigned int i;
 
-	for ( i = 0 ; i < INTEL_NUM_RX_DESC ; i++ ) {
+	for ( i = 0 ; i < INTEL_MAX_RX_DESC ; i++ ) {
 		if ( intel->rx_iobuf[i] )
 			free_iob ( intel->rx_iobuf[i] );
 		intel->rx_iobuf[i] = NULL;
@@ -636,6 +663,7 @@ static int intel_open ( struct net_device *netdev ) {
 	struct intel_nic *intel = netdev->priv;
 	union intel_receive_address mac;
 	uint32_t fextnvm11;
+	uint32_t ctrl;
 	uint32_t tctl;
 	uint32_t rctl;
 	int rc;
@@ -653,6 +681,7 @@ static int intel_open ( struct net_device *netdev ) {
 	}
 
 	/* Create transmit descriptor ring */
+	intel_size_rings ( netdev );
 	if ( ( rc = intel_create_ring ( intel, &intel->tx ) ) != 0 )
 		goto err_create_tx;
 
@@ -681,8 +710,12 @@ static int intel_open ( struct net_device *netdev ) {
 		  INTEL_RCTL_BAM | INTEL_RCTL_BSIZE_2048 | INTEL_RCTL_SECRC );
 	writel ( rctl, intel->regs + INTEL_RCTL );
 
+	/* Enable VLAN tag stripping */
+	ctrl = readl ( intel->regs + INTEL_CTRL );
+	writel ( ( ctrl | INTEL_CTRL_VME ), intel->regs + INTEL_CTRL );
+
 	/* Fill receive ring */
-	intel_refill_rx ( intel );
+	intel_refill_rx ( netdev );
 
 	/* Update link state */
 	intel_check_link ( netdev );
@@ -746,12 +779,13 @@ int intel_transmit ( struct net_device *netdev, struct io_buffer *iobuf ) {
 	size_t len;
 
 	/* Get next transmit descriptor */
-	if ( ( intel->tx.prod - intel->tx.cons ) >= INTEL_TX_FILL ) {
+	if ( ( intel->tx.prod - intel->tx.cons ) >=
+	     INTEL_TX_FILL ( intel->tx.count ) ) {
 		DBGC ( intel, "INTEL %p out of transmit descriptors\n", intel );
 		return -ENOBUFS;
 	}
-	tx_idx = ( intel->tx.prod++ % INTEL_NUM_TX_DESC );
-	tx_tail = ( intel->tx.prod % INTEL_NUM_TX_DESC );
+	tx_idx = ( intel->tx.prod++ % intel->tx.count );
+	tx_tail = ( intel->tx.prod % intel->tx.count );
 	tx = &intel->tx.desc[tx_idx];
 
 	/* Populate transmit descriptor */
@@ -787,7 +821,7 @@ void intel_poll_tx ( struct net_device *netdev ) {
 	while ( intel->tx.cons != intel->tx.prod ) {
 
 		/* Get next transmit descriptor */
-		tx_idx = ( intel->tx.cons % INTEL_NUM_TX_DESC );
+		tx_idx = ( intel->tx.cons % intel->tx.count );
 		tx = &intel->tx.desc[tx_idx];
 
 		/* Stop if descriptor is still in use */
@@ -811,19 +845,24 @@ void intel_poll_rx ( struct net_device *netdev ) {
 	struct intel_nic *intel = netdev->priv;
 	struct intel_descriptor *rx;
 	struct io_buffer *iobuf;
+	struct list_head burst;
 	unsigned int rx_idx;
+	unsigned int tag;
+	uint32_t status;
 	size_t len;
 
 	/* Check for received packets */
+	INIT_LIST_HEAD ( &burst );
 	while ( intel->rx.cons != intel->rx.prod ) {
 
 		/* Get next receive descriptor */
-		rx_idx = ( intel->rx.cons % INTEL_NUM_RX_DESC );
+		rx_idx = ( intel->rx.cons % intel->rx.count );
 		rx = &intel->rx.desc[rx_idx];
 
 		/* Stop if descriptor is still in use */
-		if ( ! ( rx->status & cpu_to_le32 ( INTEL_DESC_STATUS_DD ) ) )
-			return;
+		status = le32_to_cpu ( rx->status );
+		if ( ! ( status & INTEL_DESC_STATUS_DD ) )
+			break;
 
 		/* Populate I/O buffer */
 		iobuf = intel->rx_iobuf[rx_idx];
@@ -831,19 +870,34 @@ void intel_poll_rx ( struct net_device *netdev ) {
 		len = le16_to_cpu ( rx->length );
 		iob_put ( iobuf, len );
 
+		/* Record hardware checksum verification, if applicable */
+		if ( ( status & ( INTEL_DESC_STATUS_TCPCS |
+				  INTEL_DESC_STATUS_UDPCS ) ) &&
+		     ! ( status & ( INTEL_DESC_STATUS_IXSM |
+				    INTEL_DESC_STATUS_TCPE ) ) ) {
+			iobuf->flags |= IOB_CSUM_VERIFIED;
+		}
+
 		/* Hand off to network stack */
-		if ( rx->status & cpu_to_le32 ( INTEL_DESC_STATUS_RXE ) ) {
+		if ( status & INTEL_DESC_STATUS_RXE ) {
 			DBGC ( intel, "INTEL %p RX %d error (length %zd, "
-			       "status %08x)\n", intel, rx_idx, len,
-			       le32_to_cpu ( rx->status ) );
+			       "status %08x)\n", intel, rx_idx, len, status );
 			netdev_rx_err ( netdev, iobuf, -EIO );
+		} else if ( status & INTEL_DESC_STATUS_VP ) {
+			tag = VLAN_TAG ( INTEL_DESC_STATUS_VLAN ( status ) );
+			DBGC2 ( intel, "INTEL %p RX %d complete (length %zd, "
+				"VLAN %d)\n", intel, rx_idx, len, tag );
+			vlan_netdev_rx ( netdev, tag, iobuf );
 		} else {
 			DBGC2 ( intel, "INTEL %p RX %d complete (length %zd)\n",
 				intel, rx_idx, len );
-			netdev_rx ( netdev, iobuf );
+			list_add_tail ( &iobuf->list, &burst );
 		}
 		intel->rx.cons++;
 	}
+
+	/* Hand off completed packets to network stack */
+	netdev_rx_burst ( netdev, &burst );
 }
 
 /**
@@ -873,8 +927,10 @@ static void intel_poll ( struct net_device *netdev ) {
 		intel_poll_rx ( netdev );
 
 	/* Report receive overruns */
-	if ( icr & INTEL_IRQ_RXO )
+	if ( icr & INTEL_IRQ_RXO ) {
+		netdev_rx_nobuf ( netdev );
 		netdev_rx_err ( netdev, NULL, -ENOBUFS );
+	}
 
 	/* Check link state, if applicable */
 	if ( icr & INTEL_IRQ_LSC )
@@ -889,7 +945,7 @@ static void intel_poll ( struct net_device *netdev ) {
 	}
 
 	/* Refill RX ring */
-	intel_refill_rx ( intel );
+	intel_refill_rx ( netdev );
 }
 
 /**
@@ -49,9 +49,27 @@ struct intel_descriptor {
 /** Descriptor done */
 #define INTEL_DESC_STATUS_DD 0x00000001UL
 
+/** Ignore checksum indication */
+#define INTEL_DESC_STATUS_IXSM 0x00000004UL
+
+/** Packet is VLAN tagged */
+#define INTEL_DESC_STATUS_VP 0x00000008UL
+
+/** UDP checksum calculated */
+#define INTEL_DESC_STATUS_UDPCS 0x00000010UL
+
+/** TCP checksum calculated */
+#define INTEL_DESC_STATUS_TCPCS 0x00000020UL
+
 /** Receive error */
 #define INTEL_DESC_STATUS_RXE 0x00000100UL
 
+/** TCP/UDP checksum error */
+#define INTEL_DESC_STATUS_TCPE 0x00002000UL
+
+/** VLAN tag control information (if stripped by hardware) */
+#define INTEL_DESC_STATUS_VLAN( status ) ( (status) >> 16 )
+
 /** Payload length */
 #define INTEL_DESC_STATUS_PAYLEN( len ) ( (len) << 14 )
 
@@ -63,6 +81,8 @@ struct intel_descriptor {
 #define INTEL_CTRL_FRCSPD	0x00000800UL	/**< Force speed */
 #define INTEL_CTRL_FRCDPLX	0x00001000UL	/**< Force duplex */
 #define INTEL_CTRL_RST		0x04000000UL	/**< Device reset */
+#define INTEL_CTRL_VME		0x40000000UL	/**< VLAN mode enable */
+#define INTEL_CTRL_VME		0x40000000UL	/**< VLAN mode enable */
 #define INTEL_CTRL_PHY_RST	0x80000000UL	/**< PHY reset */
 
 /** Time to delay for device reset, in milliseconds */
@@ -140,15 +160,24 @@ struct intel_descriptor {
 /** Receive Descriptor register block */
 #define INTEL_RD 0x02800UL
 
-/** Number of receive descriptors
+/** Default number of receive descriptors
+ *
+ * This may be overridden at runtime via the "rxring" setting.
+ */
+#define INTEL_NUM_RX_DESC 32
+
+/** Minimum number of receive descriptors
  *
  * Minimum value is 8, since the descriptor ring length must be a
  * multiple of 128.
  */
-#define INTEL_NUM_RX_DESC 16
+#define INTEL_MIN_RX_DESC 8
+
+/** Maximum number of receive descriptors */
+#define INTEL_MAX_RX_DESC 256
 
 /** Receive descriptor ring fill level */
-#define INTEL_RX_FILL 8
+#define INTEL_RX_FILL( count ) ( (count) / 2 )
 
 /** Receive buffer length */
 #define INTEL_RX_MAX_LEN 2048
@@ -156,15 +185,24 @@ struct intel_descriptor {
 /** Transmit Descriptor register block */
 #define INTEL_TD 0x03800UL
 
-/** Number of transmit descriptors
+/** Default number of transmit descriptors
+ *
+ * This may be overridden at runtime via the "txring" setting.
+ */
+#define INTEL_NUM_TX_DESC 32
+
+/** Minimum number of transmit descriptors
  *
  * Descriptor ring length must be a multiple of 16.  ICH8/9/10
  * requires a minimum of 16 TX descriptors.
  */
-#define INTEL_NUM_TX_DESC 16
+#define INTEL_MIN_TX_DESC 16
+
+/** Maximum number of transmit descriptors */
+#define INTEL_MAX_TX_DESC 256
 
 /** Transmit descriptor ring maximum fill level */
-#define INTEL_TX_FILL ( INTEL_NUM_TX_DESC - 1 )
+#define INTEL_TX_FILL( count ) ( (count) - 1 )
 
 /** Receive/Transmit Descriptor Base Address Low (offset) */
 #define INTEL_xDBAL 0x00
@@ -219,6 +257,8 @@ struct intel_ring {
 
 	/** Register block */
 	unsigned int reg;
+	/** Number of descriptors */
+	unsigned int count;
 	/** Length (in bytes) */
 	size_t len;
 
@@ -232,6 +272,19 @@ struct intel_ring {
 			      size_t len );
 };
 
+/**
+ * Set descriptor ring size
+ *
+ * @v ring		Descriptor ring
+ * @v count		Number of descriptors
+ */
+static inline __attribute__ (( always_inline)) void
+intel_size_ring ( struct intel_ring *ring, unsigned int count ) {
+
+	ring->count = count;
+	ring->len = ( count * sizeof ( ring->desc[0] ) );
+}
+
 /**
  * Initialise descriptor ring
  *
@@ -245,7 +298,7 @@ intel_init_ring ( struct intel_ring *ring, unsigned int count, unsigned int reg,
 		  void ( * describe ) ( struct intel_descriptor *desc,
 					physaddr_t addr, size_t len ) ) {
 
-	ring->len = ( count * sizeof ( ring->desc[0] ) );
+	intel_size_ring ( ring, count );
 	ring->reg = reg;
 	ring->describe = describe;
 }
@@ -299,7 +352,7 @@ struct intel_nic {
 	/** Receive descriptor ring */
 	struct intel_ring rx;
 	/** Receive I/O buffers */
-	struct io_buffer *rx_iobuf[INTEL_NUM_RX_DESC];
+	struct io_buffer *rx_iobuf[INTEL_MAX_RX_DESC];
 };
 
 /** Driver flags */
@@ -345,11 +398,12 @@ extern void intel_describe_tx_adv ( struct intel_descriptor *tx,
 extern void intel_describe_rx ( struct intel_descriptor *rx,
 				physaddr_t addr, size_t len );
 extern void intel_reset_ring ( struct intel_nic *intel, unsigned int reg );
+extern void intel_size_rings ( struct net_device *netdev );
 extern int intel_create_ring ( struct intel_nic *intel,
 			       struct intel_ring *ring );
 extern void intel_destroy_ring ( struct intel_nic *intel,
 				 struct intel_ring *ring );
-extern void intel_refill_rx ( struct intel_nic *intel );
+extern void intel_refill_rx ( struct net_device *netdev );
 extern void intel_empty_rx ( struct intel_nic *intel );
 extern int intel_transmit ( struct net_device *netdev,
 			    struct io_buffer *iobuf );
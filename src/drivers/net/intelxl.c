@@ -36,6 +36,10 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/malloc.h>
 #include <ipxe/pci.h>
 #include <ipxe/version.h>
+#include <ipxe/settings.h>
+#include <ipxe/vlan.h>
+#include <ipxe/timer.h>
+#include <ipxe/device.h>
 #include "intelxl.h"
 
 /** @file
@@ -52,18 +56,30 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  */
 
 /**
- * Reset hardware
+ * Initiate hardware reset
  *
  * @v intelxl		Intel device
- * @ret rc		Return status code
  */
-static int intelxl_reset ( struct intelxl_nic *intelxl ) {
+static void intelxl_reset_start ( struct intelxl_nic *intelxl ) {
 	uint32_t pfgen_ctrl;
 
 	/* Perform a global software reset */
 	pfgen_ctrl = readl ( intelxl->regs + INTELXL_PFGEN_CTRL );
 	writel ( ( pfgen_ctrl | INTELXL_PFGEN_CTRL_PFSWR ),
 		 intelxl->regs + INTELXL_PFGEN_CTRL );
+	intelxl->reset = currticks();
+}
+
+/**
+ * Reset hardware
+ *
+ * @v intelxl		Intel device
+ * @ret rc		Return status code
+ */
+static int intelxl_reset ( struct intelxl_nic *intelxl ) {
+
+	/* Perform a global software reset */
+	intelxl_reset_start ( intelxl );
 	mdelay ( INTELXL_RESET_DELAY_MS );
 
 	return 0;
@@ -550,6 +566,44 @@ static int intelxl_admin_link ( struct net_device *netdev ) {
 	return 0;
 }
 
+/**
+ * Clear PXE mode
+ *
+ * @v intelxl		Intel device
+ * @ret rc		Return status code
+ *
+ * PXE mode restricts the receive queue to 8 descriptors.  Leaving
+ * PXE mode allows for larger receive rings.
+ */
+static int intelxl_admin_clear_pxe ( struct intelxl_nic *intelxl ) {
+	struct intelxl_admin_descriptor cmd;
+	struct intelxl_admin_clear_pxe_params *pxe = &cmd.params.pxe;
+	int rc;
+
+	/* Do nothing if device is already out of PXE mode */
+	if ( ! ( readl ( intelxl->regs + INTELXL_GLLAN_RCTL_0 ) &
+		 INTELXL_GLLAN_RCTL_0_PXE_MODE ) ) {
+		DBGC2 ( intelxl, "INTELXL %p already in non-PXE mode\n",
+			intelxl );
+		return 0;
+	}
+
+	/* Populate descriptor */
+	memset ( &cmd, 0, sizeof ( cmd ) );
+	cmd.opcode = cpu_to_le16 ( INTELXL_ADMIN_CLEAR_PXE );
+	pxe->magic = INTELXL_ADMIN_CLEAR_PXE_MAGIC;
+
+	/* Issue command */
+	if ( ( rc = intelxl_admin_command ( intelxl, &cmd ) ) != 0 )
+		return rc;
+
+	/* Acknowledge change of mode */
+	writel ( INTELXL_GLLAN_RCTL_0_PXE_MODE,
+		 ( intelxl->regs + INTELXL_GLLAN_RCTL_0 ) );
+
+	return 0;
+}
+
 /**
  * Refill admin event queue
  *
@@ -829,7 +883,7 @@ static int intelxl_context_tx ( struct intelxl_nic *intelxl,
 	ctx.tx.flags = cpu_to_le16 ( INTELXL_CTX_TX_FL_NEW );
 	ctx.tx.base = cpu_to_le64 ( INTELXL_CTX_TX_BASE ( address ) );
 	ctx.tx.count =
-		cpu_to_le16 ( INTELXL_CTX_TX_COUNT ( INTELXL_TX_NUM_DESC ) );
+		cpu_to_le16 ( INTELXL_CTX_TX_COUNT ( intelxl->tx.count ) );
 	ctx.tx.qset = INTELXL_CTX_TX_QSET ( intelxl->qset );
 
 	/* Program context */
@@ -854,13 +908,15 @@ static int intelxl_context_rx ( struct intelxl_nic *intelxl,
 		struct intelxl_context_line line;
 	} ctx;
 	uint64_t base_count;
+	uint16_t len_count;
 	int rc;
 
 	/* Initialise context */
 	memset ( &ctx, 0, sizeof ( ctx ) );
-	base_count = INTELXL_CTX_RX_BASE_COUNT ( address, INTELXL_RX_NUM_DESC );
+	base_count = INTELXL_CTX_RX_BASE_COUNT ( address, intelxl->rx.count );
 	ctx.rx.base_count = cpu_to_le64 ( base_count );
-	ctx.rx.len = cpu_to_le16 ( INTELXL_CTX_RX_LEN ( intelxl->mfs ) );
+	len_count = INTELXL_CTX_RX_LEN_COUNT ( intelxl->mfs, intelxl->rx.count );
+	ctx.rx.len = cpu_to_le16 ( len_count );
 	ctx.rx.flags = INTELXL_CTX_RX_FL_CRCSTRIP;
 	ctx.rx.mfs = cpu_to_le16 ( INTELXL_CTX_RX_MFS ( intelxl->mfs ) );
 
@@ -968,6 +1024,7 @@ static int intelxl_create_ring ( struct intelxl_nic *intelxl,
 	/* Reset counters */
 	ring->prod = 0;
 	ring->cons = 0;
+	ring->tail = 0;
 
 	DBGC ( intelxl, "INTELXL %p ring %06x is at [%08llx,%08llx)\n",
 	       intelxl, ring->reg, ( ( unsigned long long ) address ),
@@ -1012,13 +1069,16 @@ static void intelxl_destroy_ring ( struct intelxl_nic *intelxl,
 static void intelxl_refill_rx ( struct intelxl_nic *intelxl ) {
 	struct intelxl_rx_data_descriptor *rx;
 	struct io_buffer *iobuf;
+	unsigned int count = intelxl->rx.count;
+	unsigned int batch = intelxl->rx_batch;
 	unsigned int rx_idx;
 	unsigned int rx_tail;
+	unsigned int tail;
 	physaddr_t address;
-	unsigned int refilled = 0;
 
 	/* Refill ring */
-	while ( ( intelxl->rx.prod - intelxl->rx.cons ) < INTELXL_RX_FILL ) {
+	while ( ( intelxl->rx.prod - intelxl->rx.cons ) <
+		INTELXL_RX_FILL ( count, batch ) ) {
 
 		/* Allocate I/O buffer */
 		iobuf = alloc_iob ( intelxl->mfs );
@@ -1028,7 +1088,7 @@ static void intelxl_refill_rx ( struct intelxl_nic *intelxl ) {
 		}
 
 		/* Get next receive descriptor */
-		rx_idx = ( intelxl->rx.prod++ % INTELXL_RX_NUM_DESC );
+		rx_idx = ( intelxl->rx.prod++ % count );
 		rx = &intelxl->rx.desc[rx_idx].rx;
 
 		/* Populate receive descriptor */
@@ -1043,16 +1103,82 @@ static void intelxl_refill_rx ( struct intelxl_nic *intelxl ) {
 		DBGC2 ( intelxl, "INTELXL %p RX %d is [%llx,%llx)\n", intelxl,
 			rx_idx, ( ( unsigned long long ) address ),
 			( ( unsigned long long ) address + intelxl->mfs ) );
-		refilled++;
 	}
 
-	/* Push descriptors to card, if applicable */
-	if ( refilled ) {
+	/* Push descriptors to card, if applicable.  Descriptors are
+	 * pushed only in whole batches; any remainder will be pushed
+	 * by a subsequent refill.
+	 */
+	tail = ( intelxl->rx.prod & ~( batch - 1 ) );
+	if ( tail != intelxl->rx.tail ) {
 		wmb();
-		rx_tail = ( intelxl->rx.prod % INTELXL_RX_NUM_DESC );
+		rx_tail = ( tail % count );
 		writel ( rx_tail,
 			 ( intelxl->regs + intelxl->rx.reg + INTELXL_QXX_TAIL));
+		intelxl->rx.tail = tail;
+	}
+}
+
+/**
+ * Check for receive discards
+ *
+ * @v netdev		Network device
+ */
+static void intelxl_check_discards ( struct net_device *netdev ) {
+	struct intelxl_nic *intelxl = netdev->priv;
+	uint32_t discards;
+	uint32_t delta;
+
+	/* Read port receive discard counter */
+	discards = readl ( intelxl->regs +
+			   INTELXL_GLPRT_RDPC ( intelxl->port ) );
+	delta = ( discards - intelxl->rx_discards );
+	if ( ! delta )
+		return;
+	intelxl->rx_discards = discards;
+
+	/* Report receive discards */
+	DBGC ( intelxl, "INTELXL %p discarded %d packets (total %d)\n",
+	       intelxl, delta, discards );
+	netdev_rx_nobuf ( netdev );
+	netdev_rx_err ( netdev, NULL, -ENOBUFS );
+}
+
+/**
+ * Set descriptor ring sizes
+ *
+ * @v netdev		Network device
+ *
+ * Ring sizes default to INTELXL_TX_NUM_DESC and INTELXL_RX_NUM_DESC,
+ * and may be overridden via the "txring" and "rxring" settings.  The
+ * receive ring is fixed at INTELXL_RX_PXE_NUM_DESC if the device
+ * remains in PXE mode.  This must be called before the rings are
+ * created.
+ */
+static void intelxl_size_rings ( struct net_device *netdev ) {
+	struct intelxl_nic *intelxl = netdev->priv;
+	unsigned int count;
+
+	/* Size transmit ring */
+	count = netdev_ring_size ( netdev, &txring_setting,
+				   INTELXL_TX_NUM_DESC, INTELXL_MIN_TX_DESC,
+				   INTELXL_MAX_TX_DESC );
+	intelxl_size_ring ( &intelxl->tx, count );
+
+	/* Size receive ring */
+	if ( readl ( intelxl->regs + INTELXL_GLLAN_RCTL_0 ) &
+	     INTELXL_GLLAN_RCTL_0_PXE_MODE ) {
+		DBGC ( intelxl, "INTELXL %p is in PXE mode\n", intelxl );
+		count = INTELXL_RX_PXE_NUM_DESC;
+		intelxl->rx_batch = 1;
+	} else {
+		count = netdev_ring_size ( netdev, &rxring_setting,
+					   INTELXL_RX_NUM_DESC,
+					   INTELXL_MIN_RX_DESC,
+					   INTELXL_MAX_RX_DESC );
+		intelxl->rx_batch = INTELXL_RX_BATCH;
 	}
+	intelxl_size_ring ( &intelxl->rx, count );
 }
 
 /******************************************************************************
@@ -1103,6 +1229,16 @@ static int intelxl_open ( struct net_device *netdev ) {
 	/* Reset transmit queue head */
 	writel ( 0, ( intelxl->regs + INTELXL_QTX_HEAD ( intelxl->queue ) ) );
 
+	/* Leave PXE mode, if possible, to allow for larger receive rings */
+	intelxl_admin_clear_pxe ( intelxl );
+
+	/* Size descriptor rings */
+	intelxl_size_rings ( netdev );
+
+	/* Record initial receive discard count */
+	intelxl->rx_discards =
+		readl ( intelxl->regs + INTELXL_GLPRT_RDPC ( intelxl->port ) );
+
 	/* Create receive descriptor ring */
 	if ( ( rc = intelxl_create_ring ( intelxl, &intelxl->rx ) ) != 0 )
 		goto err_create_rx;
@@ -1163,7 +1299,7 @@ static void intelxl_close ( struct net_device *netdev ) {
 	intelxl_destroy_ring ( intelxl, &intelxl->rx );
 
 	/* Discard any unused receive buffers */
-	for ( i = 0 ; i < INTELXL_RX_NUM_DESC ; i++ ) {
+	for ( i = 0 ; i < INTELXL_MAX_RX_DESC ; i++ ) {
 		if ( intelxl->rx_iobuf[i] )
 			free_iob ( intelxl->rx_iobuf[i] );
 		intelxl->rx_iobuf[i] = NULL;
@@ -1181,28 +1317,49 @@ static int intelxl_transmit ( struct net_device *netdev,
 			      struct io_buffer *iobuf ) {
 	struct intelxl_nic *intelxl = netdev->priv;
 	struct intelxl_tx_data_descriptor *tx;
+	struct ethhdr *ethhdr = iobuf->data;
 	unsigned int tx_idx;
 	unsigned int tx_tail;
 	physaddr_t address;
+	uint32_t flags;
+	uint32_t len_flags;
+	size_t iplen;
 	size_t len;
 
 	/* Get next transmit descriptor */
-	if ( ( intelxl->tx.prod - intelxl->tx.cons ) >= INTELXL_TX_FILL ) {
+	if ( ( intelxl->tx.prod - intelxl->tx.cons ) >=
+	     INTELXL_TX_FILL ( intelxl->tx.count ) ) {
 		DBGC ( intelxl, "INTELXL %p out of transmit descriptors\n",
 		       intelxl );
 		return -ENOBUFS;
 	}
-	tx_idx = ( intelxl->tx.prod++ % INTELXL_TX_NUM_DESC );
-	tx_tail = ( intelxl->tx.prod % INTELXL_TX_NUM_DESC );
+	tx_idx = ( intelxl->tx.prod++ % intelxl->tx.count );
+	tx_tail = ( intelxl->tx.prod % intelxl->tx.count );
 	tx = &intelxl->tx.desc[tx_idx].tx;
 
+	/* Request checksum offload, if applicable */
+	flags = ( INTELXL_TX_DATA_DTYP | INTELXL_TX_DATA_EOP |
+		  INTELXL_TX_DATA_RS | INTELXL_TX_DATA_JFDI );
+	len = iob_len ( iobuf );
+	len_flags = INTELXL_TX_DATA_LEN ( len );
+	if ( iobuf->flags & IOB_TX_CSUM ) {
+		assert ( ! ( iobuf->flags & IOB_TX_TSO ) );
+		iplen = ( iobuf->trans - iobuf->data - ETH_HLEN );
+		flags |= ( ( ( ethhdr->h_protocol == htons ( ETH_P_IPV6 ) ) ?
+			     INTELXL_TX_DATA_IIPT_IPV6 :
+			     INTELXL_TX_DATA_IIPT_IPV4 ) |
+			   INTELXL_TX_DATA_L4T_TCP |
+			   INTELXL_TX_DATA_MACLEN ( ETH_HLEN ) |
+			   INTELXL_TX_DATA_IPLEN ( iplen ) |
+			   INTELXL_TX_DATA_L4LEN_LO ( iobuf->trans_len ) );
+		len_flags |= INTELXL_TX_DATA_L4LEN_HI ( iobuf->trans_len );
+	}
+
 	/* Populate transmit descriptor */
 	address = virt_to_bus ( iobuf->data );
-	len = iob_len ( iobuf );
 	tx->address = cpu_to_le64 ( address );
-	tx->len = cpu_to_le32 ( INTELXL_TX_DATA_LEN ( len ) );
-	tx->flags = cpu_to_le32 ( INTELXL_TX_DATA_DTYP | INTELXL_TX_DATA_EOP |
-				  INTELXL_TX_DATA_RS | INTELXL_TX_DATA_JFDI );
+	tx->len = cpu_to_le32 ( len_flags );
+	tx->flags = cpu_to_le32 ( flags );
 	wmb();
 
 	/* Notify card that there are packets ready to transmit */
@@ -1229,7 +1386,7 @@ static void intelxl_poll_tx ( struct net_device *netdev ) {
 	while ( intelxl->tx.cons != intelxl->tx.prod ) {
 
 		/* Get next transmit descriptor */
-		tx_idx = ( intelxl->tx.cons % INTELXL_TX_NUM_DESC );
+		tx_idx = ( intelxl->tx.cons % intelxl->tx.count );
 		tx_wb = &intelxl->tx.desc[tx_idx].tx_wb;
 
 		/* Stop if descriptor is still in use */
@@ -1253,39 +1410,66 @@ static void intelxl_poll_rx ( struct net_device *netdev ) {
 	struct intelxl_nic *intelxl = netdev->priv;
 	struct intelxl_rx_writeback_descriptor *rx_wb;
 	struct io_buffer *iobuf;
+	struct list_head burst;
 	unsigned int rx_idx;
+	unsigned int ptype;
+	unsigned int tag;
+	uint32_t flags;
+	uint32_t raw_len;
 	size_t len;
 
 	/* Check for received packets */
+	INIT_LIST_HEAD ( &burst );
 	while ( intelxl->rx.cons != intelxl->rx.prod ) {
 
 		/* Get next receive descriptor */
-		rx_idx = ( intelxl->rx.cons % INTELXL_RX_NUM_DESC );
+		rx_idx = ( intelxl->rx.cons % intelxl->rx.count );
 		rx_wb = &intelxl->rx.desc[rx_idx].rx_wb;
 
 		/* Stop if descriptor is still in use */
-		if ( ! ( rx_wb->flags & cpu_to_le32 ( INTELXL_RX_WB_FL_DD ) ) )
-			return;
+		flags = le32_to_cpu ( rx_wb->flags );
+		if ( ! ( flags & INTELXL_RX_WB_FL_DD ) )
+			break;
 
 		/* Populate I/O buffer */
 		iobuf = intelxl->rx_iobuf[rx_idx];
 		intelxl->rx_iobuf[rx_idx] = NULL;
-		len = INTELXL_RX_WB_LEN ( le32_to_cpu ( rx_wb->len ) );
+		raw_len = le32_to_cpu ( rx_wb->len );
+		len = INTELXL_RX_WB_LEN ( raw_len );
 		iob_put ( iobuf, len );
 
+		/* Record hardware checksum verification, if applicable */
+		ptype = INTELXL_RX_WB_PTYPE ( flags, raw_len );
+		if ( ( flags & INTELXL_RX_WB_FL_L3L4P ) &&
+		     ! ( flags & ( INTELXL_RX_WB_FL_IPE | INTELXL_RX_WB_FL_L4E |
+				   INTELXL_RX_WB_FL_EIPE ) ) &&
+		     ( ( ptype == INTELXL_RX_PTYPE_IPV4_UDP ) ||
+		       ( ptype == INTELXL_RX_PTYPE_IPV4_TCP ) ||
+		       ( ptype == INTELXL_RX_PTYPE_IPV6_UDP ) ||
+		       ( ptype == INTELXL_RX_PTYPE_IPV6_TCP ) ) ) {
+			iobuf->flags |= IOB_CSUM_VERIFIED;
+		}
+
 		/* Hand off to network stack */
-		if ( rx_wb->flags & cpu_to_le32 ( INTELXL_RX_WB_FL_RXE ) ) {
+		if ( flags & INTELXL_RX_WB_FL_RXE ) {
 			DBGC ( intelxl, "INTELXL %p RX %d error (length %zd, "
-			       "flags %08x)\n", intelxl, rx_idx, len,
-			       le32_to_cpu ( rx_wb->flags ) );
+			       "flags %08x)\n", intelxl, rx_idx, len, flags );
 			netdev_rx_err ( netdev, iobuf, -EIO );
+		} else if ( flags & INTELXL_RX_WB_FL_VLAN ) {
+			tag = VLAN_TAG ( le16_to_cpu ( rx_wb->vlan ) );
+			DBGC2 ( intelxl, "INTELXL %p RX %d complete (length "
+				"%zd, VLAN %d)\n", intelxl, rx_idx, len, tag );
+			vlan_netdev_rx ( netdev, tag, iobuf );
 		} else {
 			DBGC2 ( intelxl, "INTELXL %p RX %d complete (length "
 				"%zd)\n", intelxl, rx_idx, len );
-			netdev_rx ( netdev, iobuf );
+			list_add_tail ( &iobuf->list, &burst );
 		}
 		intelxl->rx.cons++;
 	}
+
+	/* Hand off completed packets to network stack */
+	netdev_rx_burst ( netdev, &burst );
 }
 
 /**
@@ -1309,6 +1493,10 @@ static void intelxl_poll ( struct net_device *netdev ) {
 	/* Poll for received packets */
 	intelxl_poll_rx ( netdev );
 
+	/* Check for receive discards, if the ring was exhausted */
+	if ( intelxl->rx.cons == intelxl->rx.prod )
+		intelxl_check_discards ( netdev );
+
 	/* Poll for admin events */
 	intelxl_poll_admin ( netdev );
 
@@ -1350,51 +1538,17 @@ static struct net_device_operations intelxl_operations = {
  */
 
 /**
- * Probe PCI device
+ * Complete device initialisation
  *
- * @v pci		PCI device
+ * @v netdev		Network device
  * @ret rc		Return status code
  */
-static int intelxl_probe ( struct pci_device *pci ) {
-	struct net_device *netdev;
-	struct intelxl_nic *intelxl;
+static int intelxl_init ( struct net_device *netdev ) {
+	struct intelxl_nic *intelxl = netdev->priv;
 	uint32_t pfgen_portnum;
 	uint32_t pflan_qalloc;
 	int rc;
 
-	/* Allocate and initialise net device */
-	netdev = alloc_etherdev ( sizeof ( *intelxl ) );
-	if ( ! netdev ) {
-		rc = -ENOMEM;
-		goto err_alloc;
-	}
-	netdev_init ( netdev, &intelxl_operations );
-	intelxl = netdev->priv;
-	pci_set_drvdata ( pci, netdev );
-	netdev->dev = &pci->dev;
-	memset ( intelxl, 0, sizeof ( *intelxl ) );
-	intelxl->pf = PCI_FUNC ( pci->busdevfn );
-	intelxl_init_admin ( &intelxl->command, INTELXL_ADMIN_CMD );
-	intelxl_init_admin ( &intelxl->event, INTELXL_ADMIN_EVT );
-	intelxl_init_ring ( &intelxl->tx, INTELXL_TX_NUM_DESC,
-			    intelxl_context_tx );
-	intelxl_init_ring ( &intelxl->rx, INTELXL_RX_NUM_DESC,
-			    intelxl_context_rx );
-
-	/* Fix up PCI device */
-	adjust_pci_device ( pci );
-
-	/* Map registers */
-	intelxl->regs = ioremap ( pci->membase, INTELXL_BAR_SIZE );
-	if ( ! intelxl->regs ) {
-		rc = -ENODEV;
-		goto err_ioremap;
-	}
-
-	/* Reset the NIC */
-	if ( ( rc = intelxl_reset ( intelxl ) ) != 0 )
-		goto err_reset;
-
 	/* Get port number and base queue number */
 	pfgen_portnum = readl ( intelxl->regs + INTELXL_PFGEN_PORTNUM );
 	intelxl->port = INTELXL_PFGEN_PORTNUM_PORT_NUM ( pfgen_portnum );
@@ -1428,6 +1582,9 @@ static int intelxl_probe ( struct pci_device *pci ) {
 	intelxl->tx.reg = INTELXL_QTX ( intelxl->queue );
 	intelxl->rx.reg = INTELXL_QRX ( intelxl->queue );
 
+	/* Record transmit offload capabilities */
+	netdev->offload = NETDEV_TX_CSUM;
+
 	/* Configure interrupt causes */
 	writel ( ( INTELXL_QINT_TQCTL_NEXTQ_INDX_NONE |
 		   INTELXL_QINT_TQCTL_CAUSE_ENA ),
@@ -1459,8 +1616,90 @@ static int intelxl_probe ( struct pci_device *pci ) {
 	intelxl_close_admin ( intelxl );
  err_open_admin:
  err_fetch_mac:
-	intelxl_reset ( intelxl );
- err_reset:
+	return rc;
+}
+
+/**
+ * Complete deferred device initialisation
+ *
+ * @v intelxl		Intel device
+ *
+ * Device initialisation is deferred until the reset has completed,
+ * so that the resets of multiple devices may proceed in parallel.
+ */
+static void intelxl_step ( struct intelxl_nic *intelxl ) {
+	struct net_device *netdev = pci_get_drvdata ( intelxl->pci );
+	unsigned long elapsed;
+
+	/* Wait for reset to complete */
+	elapsed = ( currticks() - intelxl->reset );
+	if ( elapsed < ( ( INTELXL_RESET_DELAY_MS * TICKS_PER_SEC ) / 1000 ) )
+		return;
+
+	/* Complete initialisation */
+	process_del ( &intelxl->process );
+	if ( ( intelxl->rc = intelxl_init ( netdev ) ) != 0 ) {
+		DBGC ( intelxl, "INTELXL %p could not initialise: %s\n",
+		       intelxl, strerror ( intelxl->rc ) );
+	}
+	device_ready ( &intelxl->pci->dev );
+}
+
+/** Deferred initialisation process descriptor */
+static struct process_descriptor intelxl_process_desc =
+	PROC_DESC ( struct intelxl_nic, process, intelxl_step );
+
+/**
+ * Probe PCI device
+ *
+ * @v pci		PCI device
+ * @ret rc		Return status code
+ */
+static int intelxl_probe ( struct pci_device *pci ) {
+	struct net_device *netdev;
+	struct intelxl_nic *intelxl;
+	int rc;
+
+	/* Allocate and initialise net device */
+	netdev = alloc_etherdev ( sizeof ( *intelxl ) );
+	if ( ! netdev ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	netdev_init ( netdev, &intelxl_operations );
+	intelxl = netdev->priv;
+	pci_set_drvdata ( pci, netdev );
+	netdev->dev = &pci->dev;
+	memset ( intelxl, 0, sizeof ( *intelxl ) );
+	intelxl->pci = pci;
+	intelxl->pf = PCI_FUNC ( pci->busdevfn );
+	intelxl->rc = -EINPROGRESS;
+	process_init_stopped ( &intelxl->process, &intelxl_process_desc,
+			       &netdev->refcnt );
+	intelxl_init_admin ( &intelxl->command, INTELXL_ADMIN_CMD );
+	intelxl_init_admin ( &intelxl->event, INTELXL_ADMIN_EVT );
+	intelxl_init_ring ( &intelxl->tx, INTELXL_TX_NUM_DESC,
+			    intelxl_context_tx );
+	intelxl_init_ring ( &intelxl->rx, INTELXL_RX_NUM_DESC,
+			    intelxl_context_rx );
+
+	/* Fix up PCI device */
+	adjust_pci_device ( pci );
+
+	/* Map registers */
+	intelxl->regs = ioremap ( pci->membase, INTELXL_BAR_SIZE );
+	if ( ! intelxl->regs ) {
+		rc = -ENODEV;
+		goto err_ioremap;
+	}
+
+	/* Reset the NIC, and complete initialisation in the background */
+	intelxl_reset_start ( intelxl );
+	process_add ( &intelxl->process );
+	device_defer ( &pci->dev );
+
+	return 0;
+
 	iounmap ( intelxl->regs );
  err_ioremap:
 	netdev_nullify ( netdev );
@@ -1478,11 +1717,21 @@ static void intelxl_remove ( struct pci_device *pci ) {
 	struct net_device *netdev = pci_get_drvdata ( pci );
 	struct intelxl_nic *intelxl = netdev->priv;
 
-	/* Unregister network device */
-	unregister_netdev ( netdev );
+	/* Abandon or undo initialisation */
+	if ( process_running ( &intelxl->process ) ) {
 
-	/* Close admin queues */
-	intelxl_close_admin ( intelxl );
+		/* Abandon deferred initialisation */
+		process_del ( &intelxl->process );
+		device_ready ( &pci->dev );
+
+	} else if ( intelxl->rc == 0 ) {
+
+		/* Unregister network device */
+		unregister_netdev ( netdev );
+
+		/* Close admin queues */
+		intelxl_close_admin ( intelxl );
+	}
 
 	/* Reset the NIC */
 	intelxl_reset ( intelxl );
@@ -11,6 +11,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 #include <stdint.h>
 #include <ipxe/if_ether.h>
+#include <ipxe/process.h>
 
 struct intelxl_nic;
 
@@ -271,6 +272,20 @@ struct intelxl_admin_link_params {
 /** Link is up */
 #define INTELXL_ADMIN_LINK_UP 0x01
 
+/** Admin queue Clear PXE Mode command */
+#define INTELXL_ADMIN_CLEAR_PXE 0x0110
+
+/** Admin queue Clear PXE Mode command parameters */
+struct intelxl_admin_clear_pxe_params {
+	/** Magic value */
+	uint8_t magic;
+	/** Reserved */
+	uint8_t reserved[15];
+} __attribute__ (( packed ));
+
+/** Clear PXE Mode magic value */
+#define INTELXL_ADMIN_CLEAR_PXE_MAGIC 0x02
+
 /** Admin queue command parameters */
 union intelxl_admin_params {
 	/** Additional data buffer command parameters */
@@ -291,6 +306,8 @@ union intelxl_admin_params {
 	struct intelxl_admin_autoneg_params autoneg;
 	/** Get Link Status command parameters */
 	struct intelxl_admin_link_params link;
+	/** Clear PXE Mode command parameters */
+	struct intelxl_admin_clear_pxe_params pxe;
 } __attribute__ (( packed ));
 
 /** Admin queue data buffer */
@@ -459,12 +476,13 @@ struct intelxl_context_rx {
 	uint16_t mfs;
 } __attribute__ (( packed ));
 
-/** Receive queue base address and queue count */
+/** Receive queue base address and queue count (low 7 bits) */
 #define INTELXL_CTX_RX_BASE_COUNT( base, count ) \
 	( ( (base) >> 7 ) | ( ( ( uint64_t ) (count) ) << 57 ) )
 
-/** Receive queue data buffer length */
-#define INTELXL_CTX_RX_LEN( len ) ( (len) >> 1 )
+/** Receive queue data buffer length and queue count (high 6 bits) */
+#define INTELXL_CTX_RX_LEN_COUNT( len, count ) \
+	( ( (len) >> 1 ) | ( ( (count) >> 7 ) & 0x3f ) )
 
 /** Strip CRC from received packets */
 #define INTELXL_CTX_RX_FL_CRCSTRIP 0x20
@@ -491,6 +509,10 @@ struct intelxl_context_rx {
  ******************************************************************************
  */
 
+/** Global RLAN Control 0 register */
+#define INTELXL_GLLAN_RCTL_0 0x12a500
+#define INTELXL_GLLAN_RCTL_0_PXE_MODE	0x00000001UL	/**< PXE mode */
+
 /** Global Transmit Queue Head register */
 #define INTELXL_QTX_HEAD(x) ( 0x0e4000 + ( 0x4 * (x) ) )
 
@@ -553,6 +575,28 @@ struct intelxl_tx_data_descriptor {
  */
 #define INTELXL_TX_DATA_JFDI 0x40
 
+/** Transmit data descriptor IPv6 packet */
+#define INTELXL_TX_DATA_IIPT_IPV6 0x200
+
+/** Transmit data descriptor IPv4 packet (without checksum offload) */
+#define INTELXL_TX_DATA_IIPT_IPV4 0x400
+
+/** Transmit data descriptor TCP checksum offload */
+#define INTELXL_TX_DATA_L4T_TCP 0x1000
+
+/** Transmit data descriptor MAC header length (in 2-byte words) */
+#define INTELXL_TX_DATA_MACLEN( len ) ( ( (len) / 2 ) << 16 )
+
+/** Transmit data descriptor IP header length (in 4-byte words) */
+#define INTELXL_TX_DATA_IPLEN( len ) ( ( (len) / 4 ) << 23 )
+
+/** Transmit data descriptor L4 header length (in 4-byte words)
+ *
+ * This field straddles the flags and length fields.
+ */
+#define INTELXL_TX_DATA_L4LEN_LO( len ) ( ( ( (len) / 4 ) & 0x3 ) << 30 )
+#define INTELXL_TX_DATA_L4LEN_HI( len ) ( ( (len) / 4 ) >> 2 )
+
 /** Transmit data descriptor length */
 #define INTELXL_TX_DATA_LEN( len ) ( (len) << 2 )
 
@@ -582,7 +626,11 @@ struct intelxl_rx_data_descriptor {
 /** Receive writeback descriptor */
 struct intelxl_rx_writeback_descriptor {
 	/** Reserved */
-	uint8_t reserved[8];
+	uint8_t reserved_a[2];
+	/** VLAN tag (if stripped by hardware) */
+	uint16_t vlan;
+	/** Reserved */
+	uint8_t reserved_b[4];
 	/** Flags */
 	uint32_t flags;
 	/** Length */
@@ -592,9 +640,40 @@ struct intelxl_rx_writeback_descriptor {
 /** Receive writeback descriptor complete */
 #define INTELXL_RX_WB_FL_DD 0x00000001UL
 
+/** Receive writeback descriptor VLAN tag present */
+#define INTELXL_RX_WB_FL_VLAN 0x00000004UL
+
+/** Receive writeback descriptor L3 and L4 integrity checks processed */
+#define INTELXL_RX_WB_FL_L3L4P 0x00000008UL
+
 /** Receive writeback descriptor error */
 #define INTELXL_RX_WB_FL_RXE 0x00080000UL
 
+/** Receive writeback descriptor IP checksum error */
+#define INTELXL_RX_WB_FL_IPE 0x00400000UL
+
+/** Receive writeback descriptor L4 checksum error */
+#define INTELXL_RX_WB_FL_L4E 0x00800000UL
+
+/** Receive writeback descriptor outer IP checksum error */
+#define INTELXL_RX_WB_FL_EIPE 0x01000000UL
+
+/** Receive writeback descriptor packet type */
+#define INTELXL_RX_WB_PTYPE( flags, len ) \
+	( ( ( (flags) >> 30 ) | ( (len) << 2 ) ) & 0xff )
+
+/** Packet type for IPv4 UDP */
+#define INTELXL_RX_PTYPE_IPV4_UDP 24
+
+/** Packet type for IPv4 TCP */
+#define INTELXL_RX_PTYPE_IPV4_TCP 26
+
+/** Packet type for IPv6 UDP */
+#define INTELXL_RX_PTYPE_IPV6_UDP 90
+
+/** Packet type for IPv6 TCP */
+#define INTELXL_RX_PTYPE_IPV6_TCP 92
+
 /** Receive writeback descriptor length */
 #define INTELXL_RX_WB_LEN(len) ( ( (len) >> 6 ) & 0x3fff )
 
@@ -618,9 +697,13 @@ struct intelxl_ring {
 	unsigned int prod;
 	/** Consumer index */
 	unsigned int cons;
+	/** Producer index last written to tail register */
+	unsigned int tail;
 
 	/** Register block */
 	unsigned int reg;
+	/** Number of descriptors */
+	unsigned int count;
 	/** Length (in bytes) */
 	size_t len;
 	/** Program queue context
@@ -631,6 +714,19 @@ struct intelxl_ring {
 	int ( * context ) ( struct intelxl_nic *intelxl, physaddr_t address );
 };
 
+/**
+ * Set descriptor ring size
+ *
+ * @v ring		Descriptor ring
+ * @v count		Number of descriptors
+ */
+static inline __attribute__ (( always_inline)) void
+intelxl_size_ring ( struct intelxl_ring *ring, unsigned int count ) {
+
+	ring->count = count;
+	ring->len = ( count * sizeof ( ring->desc[0] ) );
+}
+
 /**
  * Initialise descriptor ring
  *
@@ -643,26 +739,62 @@ intelxl_init_ring ( struct intelxl_ring *ring, unsigned int count,
 		    int ( * context ) ( struct intelxl_nic *intelxl,
 					physaddr_t address ) ) {
 
-	ring->len = ( count * sizeof ( ring->desc[0] ) );
+	intelxl_size_ring ( ring, count );
 	ring->context = context;
 }
 
-/** Number of transmit descriptors */
-#define INTELXL_TX_NUM_DESC 16
+/** Default number of transmit descriptors
+ *
+ * This may be overridden at runtime via the "txring" setting.
+ */
+#define INTELXL_TX_NUM_DESC 64
+
+/** Minimum number of transmit descriptors */
+#define INTELXL_MIN_TX_DESC 16
+
+/** Maximum number of transmit descriptors */
+#define INTELXL_MAX_TX_DESC 512
 
 /** Transmit descriptor ring maximum fill level */
-#define INTELXL_TX_FILL ( INTELXL_TX_NUM_DESC - 1 )
+#define INTELXL_TX_FILL( count ) ( (count) - 1 )
 
-/** Number of receive descriptors
+/** Default number of receive descriptors
+ *
+ * This may be overridden at runtime via the "rxring" setting.
+ */
+#define INTELXL_RX_NUM_DESC 128
+
+/** Minimum number of receive descriptors
+ *
+ * Outside of PXE mode, the ring length must be a multiple of 32.
+ */
+#define INTELXL_MIN_RX_DESC 32
+
+/** Maximum number of receive descriptors */
+#define INTELXL_MAX_RX_DESC 512
+
+/** Number of receive descriptors in PXE mode
  *
  * In PXE mode (i.e. able to post single receive descriptors), 8
  * descriptors is the only permitted value covering all possible
  * numbers of PFs.
  */
-#define INTELXL_RX_NUM_DESC 8
+#define INTELXL_RX_PXE_NUM_DESC 8
 
-/** Receive descriptor ring fill level */
-#define INTELXL_RX_FILL ( INTELXL_RX_NUM_DESC - 1 )
+/** Receive tail update granularity
+ *
+ * Outside of PXE mode, receive descriptors must be posted in
+ * multiples of 8.
+ */
+#define INTELXL_RX_BATCH 8
+
+/** Receive descriptor ring fill level
+ *
+ * @v count		Number of descriptors
+ * @v batch		Receive tail update granularity
+ * @ret fill		Fill level
+ */
+#define INTELXL_RX_FILL( count, batch ) ( (count) - (batch) )
 
 /******************************************************************************
  *
@@ -737,6 +869,9 @@ intelxl_init_ring ( struct intelxl_ring *ring, unsigned int count,
 #define INTELXL_PFGEN_PORTNUM_PORT_NUM(x) \
 	( ( (x) >> 0 ) & 0x3 )				/**< Port number */
 
+/** Port Receive Discards Counter Register */
+#define INTELXL_GLPRT_RDPC(x) ( 0x300600 + ( 0x8 * (x) ) )
+
 /** Port MAC Address Low Register */
 #define INTELXL_PRTGL_SAL 0x1e2120
 
@@ -783,8 +918,21 @@ struct intelxl_nic {
 	struct intelxl_ring tx;
 	/** Receive descriptor ring */
 	struct intelxl_ring rx;
+	/** Receive tail update granularity */
+	unsigned int rx_batch;
+	/** Last observed port receive discard count */
+	uint32_t rx_discards;
 	/** Receive I/O buffers */
-	struct io_buffer *rx_iobuf[INTELXL_RX_NUM_DESC];
+	struct io_buffer *rx_iobuf[INTELXL_MAX_RX_DESC];
+
+	/** PCI device */
+	struct pci_device *pci;
+	/** Deferred initialisation process */
+	struct process process;
+	/** Time at which reset was initiated */
+	unsigned long reset;
+	/** Initialisation status */
+	int rc;
 };
 
 #endif /* _INTELXL_H */
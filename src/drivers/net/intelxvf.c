@@ -276,6 +276,7 @@ static int intelxvf_open ( struct net_device *netdev ) {
 	}
 
 	/* Create transmit descriptor ring */
+	intel_size_rings ( netdev );
 	if ( ( rc = intel_create_ring ( intel, &intel->tx ) ) != 0 )
 		goto err_create_tx;
 
@@ -310,7 +311,7 @@ static int intelxvf_open ( struct net_device *netdev ) {
 	writel ( dca_rxctrl, intel->regs + INTELXVF_DCA_RXCTRL );
 
 	/* Fill receive ring */
-	intel_refill_rx ( intel );
+	intel_refill_rx ( netdev );
 
 	/* Update link state */
 	intelxvf_check_link ( netdev );
@@ -387,7 +388,7 @@ static void intelxvf_poll ( struct net_device *netdev ) {
 	}
 
 	/* Refill RX ring */
-	intel_refill_rx ( intel );
+	intel_refill_rx ( netdev );
 }
 
 /**
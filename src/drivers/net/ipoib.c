@@ -28,6 +28,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <stdio.h>
 #include <unistd.h>
 #include <string.h>
+#include <strings.h>
 #include <byteswap.h>
 #include <errno.h>
 #include <ipxe/errortab.h>
@@ -39,6 +40,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/ip.h>
 #include <ipxe/iobuf.h>
 #include <ipxe/netdevice.h>
+#include <ipxe/settings.h>
 #include <ipxe/infiniband.h>
 #include <ipxe/ib_pathrec.h>
 #include <ipxe/ib_mcast.h>
@@ -64,14 +66,17 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 	__einfo_uniqify ( EINFO_ENXIO, 0x03,				\
 			  "Missing REMAC for IPv4 packet (ARP sent)" )
 
-/** Number of IPoIB send work queue entries */
-#define IPOIB_NUM_SEND_WQES 8
+/** Default number of IPoIB send work queue entries */
+#define IPOIB_NUM_SEND_WQES 32
 
-/** Number of IPoIB receive work queue entries */
-#define IPOIB_NUM_RECV_WQES 4
+/** Default number of IPoIB receive work queue entries */
+#define IPOIB_NUM_RECV_WQES 32
 
-/** Number of IPoIB completion entries */
-#define IPOIB_NUM_CQES 16
+/** Minimum number of IPoIB work queue entries */
+#define IPOIB_MIN_WQES 4
+
+/** Maximum number of IPoIB work queue entries */
+#define IPOIB_MAX_WQES 256
 
 /** An IPoIB broadcast address */
 struct ipoib_broadcast {
@@ -260,6 +265,7 @@ static unsigned int ipoib_discard_remac ( void ) {
 
 /** IPoIB cache discarder */
 struct cache_discarder ipoib_discarder __cache_discarder ( CACHE_EXPENSIVE ) = {
+	.name = "ipoib",
 	.discard = ipoib_discard_remac,
 };
 
@@ -844,8 +850,24 @@ static void ipoib_link_state_changed ( struct ipoib_device *ipoib ) {
 static int ipoib_open ( struct net_device *netdev ) {
 	struct ipoib_device *ipoib = netdev->priv;
 	struct ib_device *ibdev = ipoib->ibdev;
+	unsigned int num_send_wqes;
+	unsigned int num_recv_wqes;
+	unsigned int num_cqes;
 	int rc;
 
+	/* Determine work queue sizes.  Each receive work queue entry
+	 * carries at most one (2kB) datagram, so a deep receive queue
+	 * is required to sustain bulk transfers at a high packet
+	 * rate.
+	 */
+	num_send_wqes = netdev_ring_size ( netdev, &txring_setting,
+					   IPOIB_NUM_SEND_WQES,
+					   IPOIB_MIN_WQES, IPOIB_MAX_WQES );
+	num_recv_wqes = netdev_ring_size ( netdev, &rxring_setting,
+					   IPOIB_NUM_RECV_WQES,
+					   IPOIB_MIN_WQES, IPOIB_MAX_WQES );
+	num_cqes = ( 1 << fls ( num_send_wqes + num_recv_wqes - 1 ) );
+
 	/* Open IB device */
 	if ( ( rc = ib_open ( ibdev ) ) != 0 ) {
 		DBGC ( ipoib, "IPoIB %p could not open device: %s\n",
@@ -854,7 +876,7 @@ static int ipoib_open ( struct net_device *netdev ) {
 	}
 
 	/* Allocate completion queue */
-	if ( ( rc = ib_create_cq ( ibdev, IPOIB_NUM_CQES, &ipoib_cq_op,
+	if ( ( rc = ib_create_cq ( ibdev, num_cqes, &ipoib_cq_op,
 				   &ipoib->cq ) ) != 0 ) {
 		DBGC ( ipoib, "IPoIB %p could not create completion queue: "
 		       "%s\n", ipoib, strerror ( rc ) );
@@ -862,8 +884,8 @@ static int ipoib_open ( struct net_device *netdev ) {
 	}
 
 	/* Allocate queue pair */
-	if ( ( rc = ib_create_qp ( ibdev, IB_QPT_UD, IPOIB_NUM_SEND_WQES,
-				   ipoib->cq, IPOIB_NUM_RECV_WQES, ipoib->cq,
+	if ( ( rc = ib_create_qp ( ibdev, IB_QPT_UD, num_send_wqes,
+				   ipoib->cq, num_recv_wqes, ipoib->cq,
 				   &ipoib_qp_op, netdev->name,
 				   &ipoib->qp ) ) != 0 ) {
 		DBGC ( ipoib, "IPoIB %p could not create queue pair: %s\n",
@@ -29,6 +29,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/ethernet.h>
 #include <ipxe/if_ether.h>
 #include <ipxe/profile.h>
+#include <ipxe/settings.h>
 #include <ipxe/usb.h>
 #include <ipxe/usbnet.h>
 #include "ecm.h"
@@ -159,6 +160,7 @@ static struct usb_endpoint_driver_operations ncm_intr_operations = {
 static int ncm_in_prefill ( struct ncm_device *ncm ) {
 	struct usb_bus *bus = ncm->bus;
 	size_t mtu;
+	unsigned int fill;
 	unsigned int count;
 	int rc;
 
@@ -173,7 +175,14 @@ static int ncm_in_prefill ( struct ncm_device *ncm ) {
 	 * large and working downwards until allocation succeeds.
 	 * Smaller buffers will still work, albeit with a higher
 	 * chance of packet loss and so lower overall throughput.
+	 *
+	 * Keeping several large transfers outstanding allows the
+	 * device to continue streaming NTBs while we are processing
+	 * earlier completions, and so the requested fill level may
+	 * be reduced in order to limit the total buffer size.
 	 */
+	fill = netdev_ring_size ( ncm->netdev, &rxring_setting, NCM_IN_COUNT,
+				  NCM_IN_MIN_COUNT, NCM_IN_MAX_COUNT );
 	for ( mtu = ncm->mtu ; mtu >= NCM_MIN_NTB_INPUT_SIZE ; mtu >>= 1 ) {
 
 		/* Attempt allocation at this MTU */
@@ -182,9 +191,11 @@ static int ncm_in_prefill ( struct ncm_device *ncm ) {
 		if ( mtu > bus->mtu )
 			continue;
 		count = ( NCM_IN_MIN_SIZE / mtu );
-		if ( count < NCM_IN_MIN_COUNT )
-			count = NCM_IN_MIN_COUNT;
+		if ( count < fill )
+			count = fill;
 		if ( ( count * mtu ) > NCM_IN_MAX_SIZE )
+			count = ( NCM_IN_MAX_SIZE / mtu );
+		if ( count < NCM_IN_MIN_COUNT )
 			continue;
 		usb_refill_init ( &ncm->usbnet.in, 0, mtu, count );
 		if ( ( rc = usb_prefill ( &ncm->usbnet.in ) ) != 0 ) {
@@ -218,6 +229,7 @@ static void ncm_in_complete ( struct usb_endpoint *ep, struct io_buffer *iobuf,
 	struct ncm_datagram_pointer *ndp;
 	struct ncm_datagram_descriptor *desc;
 	struct io_buffer *pkt;
+	struct list_head burst;
 	unsigned int remaining;
 	size_t ndp_offset;
 	size_t ndp_len;
@@ -228,6 +240,7 @@ static void ncm_in_complete ( struct usb_endpoint *ep, struct io_buffer *iobuf,
 
 	/* Profile overall bulk IN completion */
 	profile_start ( &ncm_in_profiler );
+	INIT_LIST_HEAD ( &burst );
 
 	/* Ignore packets cancelled when the endpoint closes */
 	if ( ! ep->open )
@@ -322,11 +335,14 @@ static void ncm_in_complete ( struct usb_endpoint *ep, struct io_buffer *iobuf,
 		if ( ndp->magic & cpu_to_le32 ( NCM_DATAGRAM_POINTER_MAGIC_CRC))
 			iob_unput ( pkt, 4 /* CRC32 */ );
 
-		/* Hand off to network stack */
-		netdev_rx ( netdev, pkt );
+		/* Add to burst for network stack */
+		list_add_tail ( &pkt->list, &burst );
 		profile_stop ( &ncm_in_datagram_profiler );
 	}
 
+	/* Hand off all datagrams within this NTB to network stack */
+	netdev_rx_burst ( netdev, &burst );
+
 	/* Recycle I/O buffer */
 	usb_recycle ( &ncm->usbnet.in, iobuf );
 	profile_stop ( &ncm_in_profiler );
@@ -334,6 +350,9 @@ static void ncm_in_complete ( struct usb_endpoint *ep, struct io_buffer *iobuf,
 	return;
 
  error:
+	/* Hand off any datagrams preceding the error */
+	netdev_rx_burst ( netdev, &burst );
+
 	/* Record error against network device */
 	DBGC_HDA ( ncm, 0, iobuf->data, iob_len ( iobuf ) );
 	netdev_rx_err ( netdev, NULL, rc );
@@ -394,6 +413,153 @@ static int ncm_out_transmit ( struct ncm_device *ncm,
 	return 0;
 }
 
+/**
+ * Calculate aligned offset for next aggregated datagram
+ *
+ * @v ncm		CDC-NCM device
+ * @v offset		Current end of NTB
+ * @ret offset		Aligned offset for next datagram
+ */
+static size_t ncm_out_align ( struct ncm_device *ncm, size_t offset ) {
+
+	return ( offset + ( ( ncm->remainder - offset - ETH_HLEN ) &
+			    ( ncm->divisor - 1 ) ) );
+}
+
+/**
+ * Transmit pending aggregated NTB
+ *
+ * @v ncm		CDC-NCM device
+ * @ret rc		Return status code
+ *
+ * The pending NTB is retained if it cannot be enqueued, and will be
+ * retried on a subsequent call.
+ */
+static int ncm_out_flush ( struct ncm_device *ncm ) {
+	struct io_buffer *ntb = ncm->ntb;
+	struct ncm_ntb_aggregate_header *header;
+	size_t len;
+	int rc;
+
+	/* Do nothing unless an NTB is pending */
+	if ( ! ntb )
+		return 0;
+	header = ntb->data;
+	len = iob_len ( ntb );
+
+	/* Populate header */
+	header->nth.magic = cpu_to_le32 ( NCM_TRANSFER_HEADER_MAGIC );
+	header->nth.header_len = cpu_to_le16 ( sizeof ( header->nth ) );
+	header->nth.sequence = cpu_to_le16 ( ncm->sequence );
+	header->nth.len = cpu_to_le16 ( len );
+	header->nth.offset =
+		cpu_to_le16 ( offsetof ( typeof ( *header ), ndp ) );
+	header->ndp.magic = cpu_to_le32 ( NCM_DATAGRAM_POINTER_MAGIC );
+	header->ndp.header_len =
+		cpu_to_le16 ( sizeof ( header->ndp ) +
+			      ( ( ncm->count + 1 ) *
+				sizeof ( header->desc[0] ) ) );
+	header->ndp.offset = cpu_to_le16 ( 0 );
+	memset ( &header->desc[ncm->count], 0, sizeof ( header->desc[0] ) );
+
+	/* Enqueue NTB, terminating with a short packet unless the
+	 * NTB is of the maximum size.
+	 */
+	if ( ( rc = usb_stream ( &ncm->usbnet.out, ntb,
+				 ( len < ncm->out_mtu ) ) ) != 0 ) {
+		DBGC ( ncm, "NCM %p could not transmit %d-datagram NTB: "
+		       "%s\n", ncm, ncm->count, strerror ( rc ) );
+		return rc;
+	}
+	DBGC2 ( ncm, "NCM %p transmitted %d-datagram %zd-byte NTB\n",
+		ncm, ncm->count, len );
+
+	/* Increment sequence number */
+	ncm->sequence++;
+
+	/* NTB is now owned by the bulk OUT endpoint */
+	ncm->ntb = NULL;
+	ncm->count = 0;
+
+	return 0;
+}
+
+/**
+ * Transmit packet via aggregated NTB
+ *
+ * @v ncm		CDC-NCM device
+ * @v iobuf		I/O buffer
+ * @ret rc		Return status code
+ *
+ * The packet is copied into the pending NTB and is completed
+ * immediately.  The NTB is transmitted once it is full, or on the
+ * next poll.
+ */
+static int ncm_out_aggregate ( struct ncm_device *ncm,
+			       struct io_buffer *iobuf ) {
+	struct net_device *netdev = ncm->netdev;
+	struct ncm_ntb_aggregate_header *header;
+	struct ncm_datagram_descriptor *desc;
+	struct io_buffer *ntb;
+	size_t len = iob_len ( iobuf );
+	size_t offset;
+	int rc;
+
+	/* Profile transmissions */
+	profile_start ( &ncm_out_profiler );
+
+	/* Transmit pending NTB if this datagram will not fit */
+	if ( ( ntb = ncm->ntb ) ) {
+		offset = ncm_out_align ( ncm, iob_len ( ntb ) );
+		if ( ( ncm->count >= ncm->out_max ) ||
+		     ( ( offset + len ) > ncm->out_mtu ) ) {
+			if ( ( rc = ncm_out_flush ( ncm ) ) != 0 )
+				return rc;
+		}
+	}
+
+	/* Start a new NTB, if applicable */
+	if ( ! ncm->ntb ) {
+		ntb = alloc_iob ( ncm->out_mtu );
+		if ( ! ntb )
+			return -ENOMEM;
+		header = iob_put ( ntb, sizeof ( *header ) );
+		memset ( header, 0, sizeof ( *header ) );
+		ncm->ntb = ntb;
+		ncm->count = 0;
+	}
+	ntb = ncm->ntb;
+	header = ntb->data;
+
+	/* Check that datagram fits within an empty NTB */
+	offset = ncm_out_align ( ncm, iob_len ( ntb ) );
+	if ( ( offset + len ) > ncm->out_mtu ) {
+		DBGC ( ncm, "NCM %p cannot aggregate %zd-byte datagram\n",
+		       ncm, len );
+		return -ERANGE;
+	}
+
+	/* Append datagram */
+	memset ( iob_put ( ntb, ( offset - iob_len ( ntb ) ) ), 0,
+		 ( offset - iob_len ( ntb ) ) );
+	memcpy ( iob_put ( ntb, len ), iobuf->data, len );
+	desc = &header->desc[ ncm->count++ ];
+	desc->offset = cpu_to_le16 ( offset );
+	desc->len = cpu_to_le16 ( len );
+
+	/* Complete packet */
+	netdev_tx_complete ( netdev, iobuf );
+
+	/* Transmit NTB immediately if full.  Any failure will be
+	 * retried on the next poll.
+	 */
+	if ( ncm->count >= ncm->out_max )
+		ncm_out_flush ( ncm );
+
+	profile_stop ( &ncm_out_profiler );
+	return 0;
+}
+
 /**
  * Complete bulk OUT transfer
  *
@@ -407,6 +573,20 @@ static void ncm_out_complete ( struct usb_endpoint *ep, struct io_buffer *iobuf,
 						usbnet.out );
 	struct net_device *netdev = ncm->netdev;
 
+	/* Aggregated NTBs are owned by the driver, and the packets
+	 * within them have already been completed.
+	 */
+	if ( ncm->out_mtu ) {
+		if ( ( rc != 0 ) && ep->open ) {
+			DBGC ( ncm, "NCM %p bulk OUT failed: %s\n",
+			       ncm, strerror ( rc ) );
+			netdev_tx_err ( netdev, iobuf, rc );
+		} else {
+			free_iob ( iobuf );
+		}
+		return;
+	}
+
 	/* Report TX completion */
 	netdev_tx_complete_err ( netdev, iobuf, rc );
 }
@@ -435,8 +615,10 @@ static int ncm_open ( struct net_device *netdev ) {
 	struct ncm_set_ntb_input_size size;
 	int rc;
 
-	/* Reset sequence number */
+	/* Reset sequence number and aggregated transmit NTB */
 	ncm->sequence = 0;
+	ncm->ntb = NULL;
+	ncm->count = 0;
 
 	/* Prefill I/O buffers */
 	if ( ( rc = ncm_in_prefill ( ncm ) ) != 0 )
@@ -489,6 +671,10 @@ static void ncm_close ( struct net_device *netdev ) {
 
 	/* Close USB network device */
 	usbnet_close ( &ncm->usbnet );
+
+	/* Discard any pending aggregated transmit NTB */
+	free_iob ( ncm->ntb );
+	ncm->ntb = NULL;
 }
 
 /**
@@ -503,6 +689,10 @@ static int ncm_transmit ( struct net_device *netdev,
 	struct ncm_device *ncm = netdev->priv;
 	int rc;
 
+	/* Aggregate packet, if applicable */
+	if ( ncm->out_mtu )
+		return ncm_out_aggregate ( ncm, iobuf );
+
 	/* Transmit packet */
 	if ( ( rc = ncm_out_transmit ( ncm, iobuf ) ) != 0 )
 		return rc;
@@ -519,6 +709,12 @@ static void ncm_poll ( struct net_device *netdev ) {
 	struct ncm_device *ncm = netdev->priv;
 	int rc;
 
+	/* Transmit any pending aggregated NTB */
+	if ( ( rc = ncm_out_flush ( ncm ) ) != 0 ) {
+		DBGC2 ( ncm, "NCM %p deferring NTB: %s\n",
+			ncm, strerror ( rc ) );
+	}
+
 	/* Poll USB bus */
 	usb_poll ( ncm->bus );
 
@@ -625,6 +821,27 @@ static int ncm_probe ( struct usb_function *func,
 		     ETH_HLEN ) % le16_to_cpu ( params.out.divisor ) ) ==
 		 le16_to_cpu ( params.out.remainder ) );
 
+	/* Aggregate transmitted packets if the device can accept at
+	 * least two maximum-length datagrams within a single NTB.
+	 */
+	ncm->divisor = le16_to_cpu ( params.out.divisor );
+	ncm->remainder = le16_to_cpu ( params.out.remainder );
+	ncm->out_max = le16_to_cpu ( params.max );
+	if ( ( ! ncm->out_max ) || ( ncm->out_max > NCM_OUT_MAX_DATAGRAMS ) )
+		ncm->out_max = NCM_OUT_MAX_DATAGRAMS;
+	ncm->out_mtu = le32_to_cpu ( params.out.mtu );
+	if ( ncm->out_mtu > NCM_OUT_MAX_SIZE )
+		ncm->out_mtu = NCM_OUT_MAX_SIZE;
+	if ( ( ncm->out_max < 2 ) ||
+	     ( ncm->out_mtu < ( sizeof ( struct ncm_ntb_aggregate_header ) +
+				( 2 * ( ncm->divisor +
+					netdev->max_pkt_len ) ) ) ) ) {
+		ncm->out_mtu = 0;
+	}
+	DBGC2 ( ncm, "NCM %p %s aggregate up to %dx datagrams in %zd-byte "
+		"NTBs\n", ncm, ( ncm->out_mtu ? "will" : "will not" ),
+		ncm->out_max, ncm->out_mtu );
+
 	/* Register network device */
 	if ( ( rc = register_netdev ( netdev ) ) != 0 )
 		goto err_register;
@@ -132,6 +132,28 @@ struct ncm_ntb_header {
 	struct ncm_datagram_descriptor desc[2];
 } __attribute__ (( packed ));
 
+/** Maximum number of datagrams aggregated into a transmitted NTB
+ *
+ * This is a policy decision.
+ */
+#define NCM_OUT_MAX_DATAGRAMS 8
+
+/** Maximum size of an aggregated transmitted NTB
+ *
+ * This is a policy decision.
+ */
+#define NCM_OUT_MAX_SIZE 16384
+
+/** NTB constructed for aggregated transmitted packets */
+struct ncm_ntb_aggregate_header {
+	/** Transfer header */
+	struct ncm_transfer_header nth;
+	/** Datagram pointer */
+	struct ncm_datagram_pointer ndp;
+	/** Datagram descriptors */
+	struct ncm_datagram_descriptor desc[ NCM_OUT_MAX_DATAGRAMS + 1 ];
+} __attribute__ (( packed ));
+
 /** A CDC-NCM network device */
 struct ncm_device {
 	/** USB device */
@@ -149,14 +171,39 @@ struct ncm_device {
 	uint16_t sequence;
 	/** Alignment padding required on transmitted packets */
 	size_t padding;
+
+	/** Aggregated transmit NTB size, or zero if not aggregating */
+	size_t out_mtu;
+	/** Maximum number of datagrams per aggregated transmit NTB */
+	unsigned int out_max;
+	/** Transmit datagram alignment divisor */
+	size_t divisor;
+	/** Transmit datagram alignment remainder */
+	size_t remainder;
+	/** Pending aggregated transmit NTB (if any) */
+	struct io_buffer *ntb;
+	/** Number of datagrams in pending aggregated transmit NTB */
+	unsigned int count;
 };
 
+/** Bulk IN ring default buffer count
+ *
+ * This is a policy decision.
+ */
+#define NCM_IN_COUNT 8
+
 /** Bulk IN ring minimum buffer count
  *
  * This is a policy decision.
  */
 #define NCM_IN_MIN_COUNT 3
 
+/** Bulk IN ring maximum buffer count
+ *
+ * This is a policy decision.
+ */
+#define NCM_IN_MAX_COUNT 64
+
 /** Bulk IN ring minimum total buffer size
  *
  * This is a policy decision.
@@ -167,7 +214,7 @@ struct ncm_device {
  *
  * This is a policy decision.
  */
-#define NCM_IN_MAX_SIZE 131072
+#define NCM_IN_MAX_SIZE 524288
 
 /** Interrupt ring buffer count
  *
@@ -27,6 +27,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <stdlib.h>
 #include <errno.h>
 #include <ipxe/netdevice.h>
+#include <ipxe/settings.h>
 #include <ipxe/ethernet.h>
 #include <ipxe/if_ether.h>
 #include <ipxe/malloc.h>
@@ -516,10 +517,13 @@ static void netfront_refill_rx ( struct net_device *netdev ) {
 	int rc;
 
 	/* Refill ring */
-	while ( netfront_ring_fill ( &netfront->rx ) < NETFRONT_RX_FILL ) {
+	while ( netfront_ring_fill ( &netfront->rx ) < netfront->rx_fill ) {
 
-		/* Allocate I/O buffer */
-		iobuf = alloc_iob ( PAGE_SIZE );
+		/* Allocate I/O buffer.  Buffers are recycled via the
+		 * receive buffer pool, avoiding repeated page-aligned
+		 * heap allocations.
+		 */
+		iobuf = alloc_rx_iob ( netdev, PAGE_SIZE );
 		if ( ! iobuf ) {
 			/* Wait for next refill */
 			break;
@@ -617,6 +621,14 @@ static int netfront_open ( struct net_device *netdev ) {
 		goto err_backend_wait;
 	}
 
+	/* Determine receive ring fill level */
+	netfront->rx_fill = netdev_ring_size ( netdev, &rxring_setting,
+					       NETFRONT_RX_FILL,
+					       NETFRONT_RX_FILL_MIN,
+					       NETFRONT_NUM_RX_DESC );
+	if ( netfront->rx_fill < NETFRONT_RX_FILL_MIN )
+		netfront->rx_fill = NETFRONT_RX_FILL_MIN;
+
 	/* Refill receive descriptor ring */
 	netfront_refill_rx ( netdev );
 
@@ -785,11 +797,13 @@ static void netfront_poll_rx ( struct net_device *netdev ) {
 	struct xen_device *xendev = netfront->xendev;
 	struct netif_rx_response *response;
 	struct io_buffer *iobuf;
+	struct list_head burst;
 	int status;
 	size_t len;
 	int rc;
 
 	/* Consume any unconsumed responses */
+	INIT_LIST_HEAD ( &burst );
 	while ( RING_HAS_UNCONSUMED_RESPONSES ( &netfront->rx_fring ) ) {
 
 		/* Get next response */
@@ -806,7 +820,7 @@ static void netfront_poll_rx ( struct net_device *netdev ) {
 			DBGC2 ( netfront, "NETFRONT %s RX id %d complete "
 				"%#08lx+%zx\n", xendev->key, response->id,
 				virt_to_phys ( iobuf->data ), len );
-			netdev_rx ( netdev, iobuf );
+			list_add_tail ( &iobuf->list, &burst );
 		} else {
 			rc = -EIO_NETIF_RSP ( status );
 			DBGC2 ( netfront, "NETFRONT %s RX id %d error %d: %s\n",
@@ -815,6 +829,9 @@ static void netfront_poll_rx ( struct net_device *netdev ) {
 			netdev_rx_err ( netdev, iobuf, rc );
 		}
 	}
+
+	/* Hand received packets to the network stack */
+	netdev_rx_burst ( netdev, &burst );
 }
 
 /**
@@ -13,12 +13,19 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <xen/io/netif.h>
 
 /** Number of transmit ring entries */
-#define NETFRONT_NUM_TX_DESC 16
+#define NETFRONT_NUM_TX_DESC 64
 
-/** Number of receive ring entries */
-#define NETFRONT_NUM_RX_DESC 32
+/** Number of receive ring entries
+ *
+ * This is the largest number of entries that will fit within a
+ * single-page shared ring.
+ */
+#define NETFRONT_NUM_RX_DESC 256
+
+/** Default receive ring fill level */
+#define NETFRONT_RX_FILL 64
 
-/** Receive ring fill level
+/** Minimum receive ring fill level
  *
  * The xen-netback driver from kernels 3.18 to 4.2 inclusive have a
  * bug (CA-163395) which prevents packet reception if fewer than 18
@@ -26,10 +33,10 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  * kernel commit d5d4852 ("xen-netback: require fewer guest Rx slots
  * when not using GSO").
  *
- * We provide 18 receive descriptors to avoid unpleasant silent
- * failures on these kernel versions.
+ * We always provide at least 18 receive descriptors to avoid
+ * unpleasant silent failures on these kernel versions.
  */
-#define NETFRONT_RX_FILL 18
+#define NETFRONT_RX_FILL_MIN 18
 
 /** Grant reference indices */
 enum netfront_ref_index {
@@ -164,6 +171,8 @@ struct netfront_nic {
 	struct io_buffer *rx_iobufs[NETFRONT_NUM_RX_DESC];
 	/** Receive I/O buffer IDs */
 	uint8_t rx_ids[NETFRONT_NUM_RX_DESC];
+	/** Receive ring fill level */
+	unsigned int rx_fill;
 
 	/** Event channel */
 	struct evtchn_send event;
@@ -247,6 +247,50 @@ static int netvsc_rx_established_buffer ( struct netvsc_device *netvsc,
 	return 0;
 }
 
+/**
+ * Handle establish transmit data buffer completion
+ *
+ * @v netvsc		NetVSC device
+ * @v data		Data
+ * @v len		Length of data
+ * @ret rc		Return status code
+ */
+static int netvsc_tx_established_buffer ( struct netvsc_device *netvsc,
+					  const void *data, size_t len ) {
+	const struct netvsc_tx_establish_buffer_completion *cmplt = data;
+	size_t section_len;
+	unsigned int sections;
+
+	/* Check completion */
+	if ( len < sizeof ( *cmplt ) ) {
+		DBGC ( netvsc, "NETVSC %s underlength buffer completion (%zd "
+		       "bytes)\n", netvsc->name, len );
+		return -EINVAL;
+	}
+	if ( cmplt->header.type != cpu_to_le32 ( NETVSC_TX_ESTABLISH_CMPLT ) ) {
+		DBGC ( netvsc, "NETVSC %s unexpected buffer completion type "
+		       "%d\n", netvsc->name, le32_to_cpu ( cmplt->header.type));
+		return -EPROTO;
+	}
+	if ( cmplt->status != cpu_to_le32 ( NETVSC_OK ) ) {
+		DBGC ( netvsc, "NETVSC %s buffer failure status %d\n",
+		       netvsc->name, le32_to_cpu ( cmplt->status ) );
+		return -EPROTO;
+	}
+
+	/* Record section length and number of usable sections */
+	section_len = le32_to_cpu ( cmplt->len );
+	sections = ( section_len ? ( netvsc->tx_buf.len / section_len ) : 0 );
+	if ( sections > NETVSC_TX_NUM_DESC )
+		sections = NETVSC_TX_NUM_DESC;
+	netvsc->tx_section_len = section_len;
+	netvsc->tx_sections = sections;
+	DBGC ( netvsc, "NETVSC %s using %d %zd-byte transmit sections\n",
+	       netvsc->name, sections, section_len );
+
+	return 0;
+}
+
 /**
  * Revoke data buffer
  *
@@ -403,6 +447,8 @@ static int netvsc_recv_completion ( struct vmbus_device *vmdev, uint64_t xid,
 		completion = netvsc_initialised;
 	} else if ( xrid == NETVSC_RX_ESTABLISH_XRID ) {
 		completion = netvsc_rx_established_buffer;
+	} else if ( xrid == NETVSC_TX_ESTABLISH_XRID ) {
+		completion = netvsc_tx_established_buffer;
 	} else if ( ( netvsc->wait_xrid != 0 ) &&
 		    ( xrid == netvsc->wait_xrid ) ) {
 		completion = netvsc_completed;
@@ -459,8 +505,7 @@ static void netvsc_poll ( struct rndis_device *rndis ) {
 	struct vmbus_device *vmdev = netvsc->vmdev;
 
 	/* Poll VMBus device */
-	while ( vmbus_has_data ( vmdev ) )
-		vmbus_poll ( vmdev );
+	vmbus_drain ( vmdev );
 }
 
 /**
@@ -478,6 +523,7 @@ static int netvsc_transmit ( struct rndis_device *rndis,
 	struct netvsc_device *netvsc = rndis->priv;
 	struct rndis_header *header = iobuf->data;
 	struct netvsc_rndis_message msg;
+	size_t len = iob_len ( iobuf );
 	unsigned int tx_id;
 	unsigned int xrid;
 	uint64_t xid;
@@ -492,8 +538,8 @@ static int netvsc_transmit ( struct rndis_device *rndis,
 		return -EPIPE;
 
 	/* Sanity check */
-	assert ( iob_len ( iobuf ) >= sizeof ( *header ) );
-	assert ( iob_len ( iobuf ) == le32_to_cpu ( header->len ) );
+	assert ( len >= sizeof ( *header ) );
+	assert ( len == le32_to_cpu ( header->len ) );
 
 	/* Check that we have space in the transmit ring */
 	if ( netvsc_ring_is_full ( &netvsc->tx ) )
@@ -510,11 +556,26 @@ static int netvsc_transmit ( struct rndis_device *rndis,
 	msg.header.type = cpu_to_le32 ( NETVSC_RNDIS_MSG );
 	msg.channel = ( ( header->type == cpu_to_le32 ( RNDIS_PACKET_MSG ) ) ?
 			NETVSC_RNDIS_DATA : NETVSC_RNDIS_CONTROL );
-	msg.buffer = cpu_to_le32 ( NETVSC_RNDIS_NO_BUFFER );
 
-	/* Send message */
-	if ( ( rc = vmbus_send_data ( netvsc->vmdev, xid, &msg, sizeof ( msg ),
-				      iobuf ) ) != 0 ) {
+	/* Send message, copying the packet into this buffer ID's
+	 * section of the transmit buffer if possible.  This avoids
+	 * the need for the host to map the I/O buffer's pages.
+	 */
+	if ( ( tx_id < netvsc->tx_sections ) &&
+	     ( len <= netvsc->tx_section_len ) ) {
+		copy_to_user ( netvsc->tx_buf.data,
+			       ( tx_id * netvsc->tx_section_len ),
+			       iobuf->data, len );
+		msg.buffer = cpu_to_le32 ( tx_id );
+		msg.len = cpu_to_le32 ( len );
+		rc = vmbus_send_control ( netvsc->vmdev, xid, &msg,
+					  sizeof ( msg ) );
+	} else {
+		msg.buffer = cpu_to_le32 ( NETVSC_RNDIS_NO_BUFFER );
+		rc = vmbus_send_data ( netvsc->vmdev, xid, &msg,
+				       sizeof ( msg ), iobuf );
+	}
+	if ( rc != 0 ) {
 		DBGC ( netvsc, "NETVSC %s could not send RNDIS message: %s\n",
 		       netvsc->name, strerror ( rc ) );
 		return rc;
@@ -726,9 +787,16 @@ static int netvsc_open ( struct rndis_device *rndis ) {
 	if ( ( rc = netvsc_create_buffer ( netvsc, &netvsc->rx ) ) != 0 )
 		goto err_create_rx;
 
+	/* Initialise transmit buffer */
+	netvsc->tx_section_len = 0;
+	netvsc->tx_sections = 0;
+	if ( ( rc = netvsc_create_buffer ( netvsc, &netvsc->tx_buf ) ) != 0 )
+		goto err_create_tx_buf;
+
 	/* Open channel */
 	if ( ( rc = vmbus_open ( netvsc->vmdev, &netvsc_channel_operations,
-				 PAGE_SIZE, PAGE_SIZE, NETVSC_MTU ) ) != 0 ) {
+				 NETVSC_RING_LEN, NETVSC_RING_LEN,
+				 NETVSC_MTU ) ) != 0 ) {
 		DBGC ( netvsc, "NETVSC %s could not open VMBus: %s\n",
 		       netvsc->name, strerror ( rc ) );
 		goto err_vmbus_open;
@@ -748,8 +816,15 @@ static int netvsc_open ( struct rndis_device *rndis ) {
 	if ( ( rc = netvsc_establish_buffer ( netvsc, &netvsc->rx ) ) != 0 )
 		goto err_establish_rx;
 
+	/* Establish transmit buffer */
+	if ( ( rc = netvsc_establish_buffer ( netvsc,
+					      &netvsc->tx_buf ) ) != 0 )
+		goto err_establish_tx_buf;
+
 	return 0;
 
+	netvsc_revoke_buffer ( netvsc, &netvsc->tx_buf );
+ err_establish_tx_buf:
 	netvsc_revoke_buffer ( netvsc, &netvsc->rx );
  err_establish_rx:
 	netvsc_destroy_ring ( netvsc, &netvsc->tx, NULL );
@@ -758,6 +833,8 @@ static int netvsc_open ( struct rndis_device *rndis ) {
  err_initialise:
 	vmbus_close ( netvsc->vmdev );
  err_vmbus_open:
+	netvsc_destroy_buffer ( netvsc, &netvsc->tx_buf );
+ err_create_tx_buf:
 	netvsc_destroy_buffer ( netvsc, &netvsc->rx );
  err_create_rx:
 	return rc;
@@ -771,7 +848,8 @@ static int netvsc_open ( struct rndis_device *rndis ) {
 static void netvsc_close ( struct rndis_device *rndis ) {
 	struct netvsc_device *netvsc = rndis->priv;
 
-	/* Revoke receive buffer */
+	/* Revoke transmit and receive buffers */
+	netvsc_revoke_buffer ( netvsc, &netvsc->tx_buf );
 	netvsc_revoke_buffer ( netvsc, &netvsc->rx );
 
 	/* Destroy transmit ring */
@@ -780,7 +858,8 @@ static void netvsc_close ( struct rndis_device *rndis ) {
 	/* Close channel */
 	vmbus_close ( netvsc->vmdev );
 
-	/* Destroy receive buffer */
+	/* Destroy transmit and receive buffers */
+	netvsc_destroy_buffer ( netvsc, &netvsc->tx_buf );
 	netvsc_destroy_buffer ( netvsc, &netvsc->rx );
 }
 
@@ -822,6 +901,11 @@ static int netvsc_probe ( struct vmbus_device *vmdev ) {
 			     NETVSC_RX_ESTABLISH_MSG, NETVSC_RX_ESTABLISH_XRID,
 			     NETVSC_RX_REVOKE_MSG, NETVSC_RX_REVOKE_XRID,
 			     NETVSC_RX_BUF_LEN );
+	netvsc_init_buffer ( &netvsc->tx_buf, NETVSC_TX_BUF_PAGESET,
+			     &netvsc_xfer_pages_operations,
+			     NETVSC_TX_ESTABLISH_MSG, NETVSC_TX_ESTABLISH_XRID,
+			     NETVSC_TX_REVOKE_MSG, NETVSC_TX_REVOKE_XRID,
+			     NETVSC_TX_BUF_LEN );
 	vmbus_set_drvdata ( vmdev, rndis );
 
 	/* Register RNDIS device */
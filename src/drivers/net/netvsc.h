@@ -18,13 +18,19 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  */
 #define NETVSC_MAX_WAIT_MS 1000
 
+/** VMBus ring buffer length (in each direction)
+ *
+ * Must be a power of two.  This is a policy decision.
+ */
+#define NETVSC_RING_LEN ( 4 * PAGE_SIZE )
+
 /** Number of transmit ring entries
  *
  * Must be a power of two.  This is a policy decision.  This value
  * must be sufficiently small to guarantee that we never run out of
  * space in the VMBus outbound ring buffer.
  */
-#define NETVSC_TX_NUM_DESC 32
+#define NETVSC_TX_NUM_DESC 64
 
 /** RX data buffer page set ID
  *
@@ -36,7 +42,21 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  *
  * This is a policy decision.
  */
-#define NETVSC_RX_BUF_LEN ( 16 * PAGE_SIZE )
+#define NETVSC_RX_BUF_LEN ( 256 * PAGE_SIZE )
+
+/** TX data buffer ID
+ *
+ * This is a policy decision.
+ */
+#define NETVSC_TX_BUF_PAGESET 0xbeef
+
+/** TX data buffer length
+ *
+ * This is a policy decision.  The host divides the buffer into
+ * fixed-size sections (typically of around 6kB); we use one section
+ * per transmit buffer ID.
+ */
+#define NETVSC_TX_BUF_LEN ( 128 * PAGE_SIZE )
 
 /** Base transaction ID
  *
@@ -56,6 +76,10 @@ enum netvsc_xrid {
 	NETVSC_RX_ESTABLISH_XRID,
 	/** Revoke receive buffer */
 	NETVSC_RX_REVOKE_XRID,
+	/** Establish transmit buffer */
+	NETVSC_TX_ESTABLISH_XRID,
+	/** Revoke transmit buffer */
+	NETVSC_TX_REVOKE_XRID,
 };
 
 /** NetVSC status codes */
@@ -353,6 +377,13 @@ struct netvsc_device {
 	/** Transmit I/O buffers */
 	struct io_buffer *tx_iobufs[NETVSC_TX_NUM_DESC];
 
+	/** Transmit buffer */
+	struct netvsc_buffer tx_buf;
+	/** Transmit buffer section length */
+	size_t tx_section_len;
+	/** Number of usable transmit buffer sections */
+	unsigned int tx_sections;
+
 	/** Receive buffer */
 	struct netvsc_buffer rx;
 
@@ -40,6 +40,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/threewire.h>
 #include <ipxe/bitbash.h>
 #include <ipxe/mii.h>
+#include <ipxe/settings.h>
 #include "realtek.h"
 
 /** @file
@@ -628,22 +629,90 @@ static void realtek_destroy_ring ( struct realtek_nic *rtl,
 }
 
 /**
- * Refill receive descriptor ring
+ * Set descriptor ring sizes
+ *
+ * @v netdev		Network device
+ *
+ * Ring sizes default to RTL_NUM_TX_DESC and RTL_NUM_RX_DESC, and may
+ * be overridden via the "txring" and "rxring" settings.  Legacy mode
+ * always uses RTL_LEGACY_NUM_TX_DESC transmit descriptors.  This must
+ * be called before the rings are created.
+ */
+static void realtek_size_rings ( struct net_device *netdev ) {
+	struct realtek_nic *rtl = netdev->priv;
+	unsigned int count;
+
+	/* Legacy mode has a fixed number of transmit descriptors, and
+	 * no receive descriptors.
+	 */
+	if ( rtl->legacy ) {
+		realtek_size_ring ( &rtl->tx, RTL_LEGACY_NUM_TX_DESC );
+		return;
+	}
+
+	/* Size transmit ring */
+	count = netdev_ring_size ( netdev, &txring_setting, RTL_NUM_TX_DESC,
+				   RTL_MIN_TX_DESC, RTL_MAX_TX_DESC );
+	realtek_size_ring ( &rtl->tx, count );
+
+	/* Size receive ring */
+	count = netdev_ring_size ( netdev, &rxring_setting, RTL_NUM_RX_DESC,
+				   RTL_MIN_RX_DESC, RTL_MAX_RX_DESC );
+	realtek_size_ring ( &rtl->rx, count );
+}
+
+/**
+ * Post receive buffer
  *
  * @v rtl		Realtek device
+ * @v iobuf		I/O buffer
+ *
+ * The caller must ensure that a receive descriptor is available.
  */
-static void realtek_refill_rx ( struct realtek_nic *rtl ) {
+static void realtek_post_rx ( struct realtek_nic *rtl,
+			      struct io_buffer *iobuf ) {
 	struct realtek_descriptor *rx;
-	struct io_buffer *iobuf;
 	unsigned int rx_idx;
 	physaddr_t address;
 	int is_last;
 
+	/* Get next receive descriptor */
+	assert ( ( rtl->rx.prod - rtl->rx.cons ) < rtl->rx.count );
+	rx_idx = ( rtl->rx.prod++ % rtl->rx.count );
+	is_last = ( rx_idx == ( rtl->rx.count - 1 ) );
+	rx = &rtl->rx.desc[rx_idx];
+
+	/* Populate receive descriptor */
+	address = virt_to_bus ( iobuf->data );
+	rx->address = cpu_to_le64 ( address );
+	rx->length = cpu_to_le16 ( RTL_RX_MAX_LEN );
+	wmb();
+	rx->flags = ( cpu_to_le16 ( RTL_DESC_OWN ) |
+		      ( is_last ? cpu_to_le16 ( RTL_DESC_EOR ) : 0 ) );
+	wmb();
+
+	/* Record I/O buffer */
+	assert ( rtl->rx_iobuf[rx_idx] == NULL );
+	rtl->rx_iobuf[rx_idx] = iobuf;
+
+	DBGC2 ( rtl, "REALTEK %p RX %d is [%llx,%llx)\n", rtl, rx_idx,
+		( ( unsigned long long ) address ),
+		( ( unsigned long long ) address + RTL_RX_MAX_LEN ) );
+}
+
+/**
+ * Refill receive descriptor ring
+ *
+ * @v rtl		Realtek device
+ */
+static void realtek_refill_rx ( struct realtek_nic *rtl ) {
+	struct io_buffer *iobuf;
+
 	/* Do nothing in legacy mode */
 	if ( rtl->legacy )
 		return;
 
-	while ( ( rtl->rx.prod - rtl->rx.cons ) < RTL_NUM_RX_DESC ) {
+	while ( ( rtl->rx.prod - rtl->rx.cons ) < rtl->rx.count ) {
 
 		/* Allocate I/O buffer */
 		iobuf = alloc_iob ( RTL_RX_MAX_LEN );
@@ -652,27 +721,8 @@ static void realtek_refill_rx ( struct realtek_nic *rtl ) {
 			return;
 		}
 
-		/* Get next receive descriptor */
-		rx_idx = ( rtl->rx.prod++ % RTL_NUM_RX_DESC );
-		is_last = ( rx_idx == ( RTL_NUM_RX_DESC - 1 ) );
-		rx = &rtl->rx.desc[rx_idx];
-
-		/* Populate receive descriptor */
-		address = virt_to_bus ( iobuf->data );
-		rx->address = cpu_to_le64 ( address );
-		rx->length = cpu_to_le16 ( RTL_RX_MAX_LEN );
-		wmb();
-		rx->flags = ( cpu_to_le16 ( RTL_DESC_OWN ) |
-			      ( is_last ? cpu_to_le16 ( RTL_DESC_EOR ) : 0 ) );
-		wmb();
-
-		/* Record I/O buffer */
-		assert ( rtl->rx_iobuf[rx_idx] == NULL );
-		rtl->rx_iobuf[rx_idx] = iobuf;
-
-		DBGC2 ( rtl, "REALTEK %p RX %d is [%llx,%llx)\n", rtl, rx_idx,
-			( ( unsigned long long ) address ),
-			( ( unsigned long long ) address + RTL_RX_MAX_LEN ) );
+		/* Post I/O buffer */
+		realtek_post_rx ( rtl, iobuf );
 	}
 }
 
@@ -688,6 +738,9 @@ static int realtek_open ( struct net_device *netdev ) {
 	uint32_t rcr;
 	int rc;
 
+	/* Size descriptor rings */
+	realtek_size_rings ( netdev );
+
 	/* Create transmit descriptor ring */
 	if ( ( rc = realtek_create_ring ( rtl, &rtl->tx ) ) != 0 )
 		goto err_create_tx;
@@ -760,7 +813,7 @@ static void realtek_close ( struct net_device *netdev ) {
 	realtek_destroy_ring ( rtl, &rtl->rx );
 
 	/* Discard any unused receive buffers */
-	for ( i = 0 ; i < RTL_NUM_RX_DESC ; i++ ) {
+	for ( i = 0 ; i < RTL_MAX_RX_DESC ; i++ ) {
 		if ( rtl->rx_iobuf[i] )
 			free_iob ( rtl->rx_iobuf[i] );
 		rtl->rx_iobuf[i] = NULL;
@@ -786,11 +839,11 @@ static int realtek_transmit ( struct net_device *netdev,
 	int is_last;
 
 	/* Get next transmit descriptor */
-	if ( ( rtl->tx.prod - rtl->tx.cons ) >= RTL_NUM_TX_DESC ) {
+	if ( ( rtl->tx.prod - rtl->tx.cons ) >= rtl->tx.count ) {
 		netdev_tx_defer ( netdev, iobuf );
 		return 0;
 	}
-	tx_idx = ( rtl->tx.prod++ % RTL_NUM_TX_DESC );
+	tx_idx = ( rtl->tx.prod++ % rtl->tx.count );
 
 	/* Transmit packet */
 	if ( rtl->legacy ) {
@@ -815,7 +868,7 @@ static int realtek_transmit ( struct net_device *netdev,
 
 		/* Populate transmit descriptor */
 		address = virt_to_bus ( iobuf->data );
-		is_last = ( tx_idx == ( RTL_NUM_TX_DESC - 1 ) );
+		is_last = ( tx_idx == ( rtl->tx.count - 1 ) );
 		tx = &rtl->tx.desc[tx_idx];
 		tx->address = cpu_to_le64 ( address );
 		tx->length = cpu_to_le16 ( iob_len ( iobuf ) );
@@ -851,7 +904,7 @@ static void realtek_poll_tx ( struct net_device *netdev ) {
 	while ( rtl->tx.cons != rtl->tx.prod ) {
 
 		/* Get next transmit descriptor */
-		tx_idx = ( rtl->tx.cons % RTL_NUM_TX_DESC );
+		tx_idx = ( rtl->tx.cons % rtl->tx.count );
 
 		/* Stop if descriptor is still in use */
 		if ( rtl->legacy ) {
@@ -942,7 +995,9 @@ static void realtek_poll_rx ( struct net_device *netdev ) {
 	struct realtek_nic *rtl = netdev->priv;
 	struct realtek_descriptor *rx;
 	struct io_buffer *iobuf;
+	struct io_buffer *copy;
 	unsigned int rx_idx;
+	uint16_t flags;
 	size_t len;
 
 	/* Poll receive buffer if in legacy mode */
@@ -955,31 +1010,44 @@ static void realtek_poll_rx ( struct net_device *netdev ) {
 	while ( rtl->rx.cons != rtl->rx.prod ) {
 
 		/* Get next receive descriptor */
-		rx_idx = ( rtl->rx.cons % RTL_NUM_RX_DESC );
+		rx_idx = ( rtl->rx.cons % rtl->rx.count );
 		rx = &rtl->rx.desc[rx_idx];
 
 		/* Stop if descriptor is still in use */
-		if ( rx->flags & cpu_to_le16 ( RTL_DESC_OWN ) )
+		flags = le16_to_cpu ( rx->flags );
+		if ( flags & RTL_DESC_OWN )
 			return;
 
-		/* Populate I/O buffer */
+		/* Consume descriptor */
 		iobuf = rtl->rx_iobuf[rx_idx];
 		rtl->rx_iobuf[rx_idx] = NULL;
 		len = ( le16_to_cpu ( rx->length ) & RTL_DESC_SIZE_MASK );
-		iob_put ( iobuf, ( len - 4 /* strip CRC */ ) );
+		rtl->rx.cons++;
 
-		/* Hand off to network stack */
-		if ( rx->flags & cpu_to_le16 ( RTL_DESC_RES ) ) {
+		/* Report receive errors */
+		if ( flags & RTL_DESC_RES ) {
 			DBGC ( rtl, "REALTEK %p RX %d error (length %zd, "
-			       "flags %04x)\n", rtl, rx_idx, len,
-			       le16_to_cpu ( rx->flags ) );
+			       "flags %04x)\n", rtl, rx_idx, len, flags );
+			iob_put ( iobuf, ( len - 4 /* strip CRC */ ) );
 			netdev_rx_err ( netdev, iobuf, -EIO );
+			continue;
+		}
+		DBGC2 ( rtl, "REALTEK %p RX %d complete (length %zd)\n",
+			rtl, rx_idx, len );
+
+		/* Copy small packets, and recycle the receive buffer */
+		len -= 4 /* strip CRC */;
+		if ( ( len <= RTL_RX_COPYBREAK ) &&
+		     ( ( copy = alloc_iob ( len ) ) != NULL ) ) {
+			memcpy ( iob_put ( copy, len ), iobuf->data, len );
+			realtek_post_rx ( rtl, iobuf );
+			iobuf = copy;
 		} else {
-			DBGC2 ( rtl, "REALTEK %p RX %d complete (length "
-				"%zd)\n", rtl, rx_idx, len );
-			netdev_rx ( netdev, iobuf );
+			iob_put ( iobuf, len );
 		}
-		rtl->rx.cons++;
+
+		/* Hand off to network stack */
+		netdev_rx ( netdev, iobuf );
 	}
 }
 
@@ -86,11 +86,23 @@ enum realtek_legacy_status {
 /** Transmit Normal Priority Descriptors (qword) */
 #define RTL_TNPDS 0x20
 
-/** Number of transmit descriptors
+/** Number of transmit descriptors in legacy mode
  *
  * This is a hardware limit when using legacy mode.
  */
-#define RTL_NUM_TX_DESC 4
+#define RTL_LEGACY_NUM_TX_DESC 4
+
+/** Default number of transmit descriptors
+ *
+ * This may be overridden at runtime via the "txring" setting.
+ */
+#define RTL_NUM_TX_DESC 64
+
+/** Minimum number of transmit descriptors */
+#define RTL_MIN_TX_DESC 4
+
+/** Maximum number of transmit descriptors */
+#define RTL_MAX_TX_DESC 256
 
 /** Receive Buffer Start Address (dword, 8139 only) */
 #define RTL_RBSTART 0x30
@@ -236,8 +248,25 @@ enum realtek_legacy_status {
 /** Receive Descriptor Start Address Register (qword) */
 #define RTL_RDSAR 0xe4
 
-/** Number of receive descriptors */
-#define RTL_NUM_RX_DESC 4
+/** Default number of receive descriptors
+ *
+ * This may be overridden at runtime via the "rxring" setting.
+ */
+#define RTL_NUM_RX_DESC 64
+
+/** Minimum number of receive descriptors */
+#define RTL_MIN_RX_DESC 4
+
+/** Maximum number of receive descriptors */
+#define RTL_MAX_RX_DESC 256
+
+/** Receive copy-break threshold
+ *
+ * Received packets up to this length are copied into a newly
+ * allocated I/O buffer, allowing the full-sized receive buffer to be
+ * returned immediately to the receive ring.
+ */
+#define RTL_RX_COPYBREAK 256
 
 /** Receive buffer length */
 #define RTL_RX_MAX_LEN \
@@ -254,10 +283,24 @@ struct realtek_ring {
 
 	/** Descriptor start address register */
 	unsigned int reg;
+	/** Number of descriptors */
+	unsigned int count;
 	/** Length (in bytes) */
 	size_t len;
 };
 
+/**
+ * Set descriptor ring size
+ *
+ * @v ring		Descriptor ring
+ * @v count		Number of descriptors
+ */
+static inline __attribute__ (( always_inline)) void
+realtek_size_ring ( struct realtek_ring *ring, unsigned int count ) {
+	ring->count = count;
+	ring->len = ( count * sizeof ( ring->desc[0] ) );
+}
+
 /**
  * Initialise descriptor ring
  *
@@ -268,7 +311,7 @@ struct realtek_ring {
 static inline __attribute__ (( always_inline)) void
 realtek_init_ring ( struct realtek_ring *ring, unsigned int count,
 		    unsigned int reg ) {
-	ring->len = ( count * sizeof ( ring->desc[0] ) );
+	realtek_size_ring ( ring, count );
 	ring->reg = reg;
 }
 
@@ -299,7 +342,7 @@ struct realtek_nic {
 	/** Receive descriptor ring */
 	struct realtek_ring rx;
 	/** Receive I/O buffers */
-	struct io_buffer *rx_iobuf[RTL_NUM_RX_DESC];
+	struct io_buffer *rx_iobuf[RTL_MAX_RX_DESC];
 	/** Receive buffer (legacy mode) */
 	void *rx_buffer;
 	/** Offset within receive buffer (legacy mode) */
@@ -13,6 +13,7 @@ FILE_LICENCE ( GPL2_ONLY );
 #include <ipxe/if_ether.h>
 #include <ipxe/ethernet.h>
 #include <ipxe/netdevice.h>
+#include <ipxe/settings.h>
 
 #include "tg3.h"
 
@@ -190,7 +191,7 @@ static void tg3_rx_prodring_free(struct tg3_rx_prodring_set *tpr)
 
 	unsigned int i;
 
-	for (i = 0; i < TG3_DEF_RX_RING_PENDING; i++)
+	for (i = 0; i < TG3_MAX_RX_RING_PENDING; i++)
 		tg3_rx_iob_free(tpr->rx_iobufs, i);
 }
 
@@ -247,6 +248,10 @@ static int tg3_open(struct net_device *dev)
 		return err;
 
 	tpr->rx_std_iob_cnt = 0;
+	tpr->rx_pending = netdev_ring_size(dev, &rxring_setting,
+					   TG3_DEF_RX_RING_PENDING,
+					   TG3_MIN_RX_RING_PENDING,
+					   TG3_MAX_RX_RING_PENDING);
 
 	err = tg3_init_hw(tp, 1);
 	if (err != 0)
@@ -386,7 +391,7 @@ static int tg3_alloc_rx_iob(struct tg3_rx_prodring_set *tpr, u32 dest_idx_unmask
 	if (iob == NULL)
 		return -ENOMEM;
 
-	iob_idx = dest_idx % TG3_DEF_RX_RING_PENDING;
+	iob_idx = dest_idx % tpr->rx_pending;
 	tpr->rx_iobufs[iob_idx] = iob;
 
 	mapping = virt_to_bus(iob->data);
@@ -405,10 +410,11 @@ static void tg3_refill_prod_ring(struct tg3 *tp)
 
 	DBGCP(tp->dev, "%s\n", __func__);
 
-	while (tpr->rx_std_iob_cnt < TG3_DEF_RX_RING_PENDING) {
-		if (tpr->rx_iobufs[idx % TG3_DEF_RX_RING_PENDING] == NULL) {
+	while (tpr->rx_std_iob_cnt < tpr->rx_pending) {
+		if (tpr->rx_iobufs[idx % tpr->rx_pending] == NULL) {
 			if (tg3_alloc_rx_iob(tpr, idx) < 0) {
 				DBGC(tp->dev, "alloc_iob() failed for descriptor %d\n", idx);
+				netdev_rx_nobuf(tp->dev);
 				break;
 			}
 			DBGC2(tp->dev, "allocated iob_buffer for descriptor %d\n", idx);
@@ -438,7 +444,7 @@ static void tg3_rx_complete(struct net_device *dev)
 	while (sw_idx != hw_idx) {
 		struct tg3_rx_buffer_desc *desc = &tp->rx_rcb[sw_idx];
 		u32 desc_idx = desc->opaque & RXD_OPAQUE_INDEX_MASK;
-		int iob_idx = desc_idx % TG3_DEF_RX_RING_PENDING;
+		int iob_idx = desc_idx % tpr->rx_pending;
 		struct io_buffer *iob = tpr->rx_iobufs[iob_idx];
 		unsigned int len;
 
@@ -472,7 +478,11 @@ static void tg3_rx_complete(struct net_device *dev)
 		tp->rx_rcb_ptr = sw_idx;
 	}
 
-	tg3_refill_prod_ring(tp);
+	/* Refill in batches of TG3_RX_REFILL_BATCH(tpr) buffers, to
+	 * avoid writing the producer index mailbox for every packet
+	 */
+	if (tpr->rx_std_iob_cnt <= tpr->rx_pending - TG3_RX_REFILL_BATCH(tpr))
+		tg3_refill_prod_ring(tp);
 }
 
 static void tg3_poll(struct net_device *dev)
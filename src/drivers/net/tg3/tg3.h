@@ -2945,15 +2945,24 @@ struct tg3_ethtool_stats {
 	u64		mbuf_lwm_thresh_hit;
 };
 
-/* number of io_buffers to allocate */
-#define TG3_DEF_RX_RING_PENDING		8
+/* default number of io_buffers to allocate */
+#define TG3_DEF_RX_RING_PENDING		64
+
+/* minimum and maximum number of io_buffers to allocate */
+#define TG3_MIN_RX_RING_PENDING		8
+#define TG3_MAX_RX_RING_PENDING		TG3_RX_STD_MAX_SIZE_5700
+
+/* number of consumed io_buffers to accumulate before refilling */
+#define TG3_RX_REFILL_BATCH(tpr)	((tpr)->rx_pending / 4)
 
 struct tg3_rx_prodring_set {
 	u32				rx_std_prod_idx;
 	u32				rx_std_cons_idx;
 	u32				rx_std_iob_cnt;
+	/* number of io_buffers to allocate (a power of two) */
+	u32				rx_pending;
 	struct tg3_rx_buffer_desc	*rx_std;
-	struct io_buffer		*rx_iobufs[TG3_DEF_RX_RING_PENDING];
+	struct io_buffer		*rx_iobufs[TG3_MAX_RX_RING_PENDING];
 	dma_addr_t			rx_std_mapping;
 };
 
@@ -25,12 +25,17 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <errno.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <strings.h>
 #include <ipxe/list.h>
 #include <ipxe/iobuf.h>
 #include <ipxe/netdevice.h>
 #include <ipxe/pci.h>
 #include <ipxe/if_ether.h>
 #include <ipxe/ethernet.h>
+#include <ipxe/ip.h>
+#include <ipxe/ipv6.h>
+#include <ipxe/tcpip.h>
+#include <ipxe/settings.h>
 #include <ipxe/virtio-pci.h>
 #include <ipxe/virtio-ring.h>
 #include "virtio-net.h"
@@ -70,15 +75,61 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  * Linux source.
  */
 
-/* Virtqueue indices */
+/* Virtqueue indices within a queue pair */
 enum {
 	RX_INDEX = 0,
 	TX_INDEX,
 	QUEUE_NB
 };
 
-/** Max number of pending rx packets */
-#define NUM_RX_BUF 8
+/** Default max number of pending rx packets (per queue pair)
+ *
+ * This may be overridden at runtime via the "rxring" setting.
+ */
+#define NUM_RX_BUF 32
+
+/** Maximum number of queue pairs that we use */
+#define VIRTNET_MAX_PAIRS 8
+
+/** Default number of queue pairs
+ *
+ * This may be overridden at runtime via the "rxqueues" setting.
+ */
+#define VIRTNET_DEF_PAIRS 4
+
+/** Maximum time to wait for a control command to complete, in ms */
+#define VIRTNET_CTRL_MAX_WAIT_MS 100
+
+/** A virtio-net receive/transmit queue pair */
+struct virtnet_pair {
+	/** RX/TX virtqueues */
+	struct vring_virtqueue virtqueue[QUEUE_NB];
+
+	/** Pending rx packet count */
+	unsigned int rx_num_iobufs;
+
+	/** Transmit packet headers, indexed by descriptor */
+	struct virtio_net_hdr_modern *tx_headers;
+
+	/** First buffer of a partially received multi-buffer packet */
+	struct io_buffer *rx_head;
+
+	/** Reassembled multi-buffer packet, if any */
+	struct io_buffer *rx_merged;
+
+	/** Number of further buffers expected for current packet */
+	unsigned int rx_remaining;
+};
+
+/** A virtio-net multiqueue control command */
+struct virtnet_mq_command {
+	/** Command header */
+	struct virtio_net_ctrl_hdr hdr;
+	/** Command data */
+	struct virtio_net_ctrl_mq mq;
+	/** Acknowledgement */
+	virtio_net_ctrl_ack ack;
+} __attribute__ (( packed ));
 
 struct virtnet_nic {
 	/** Base pio register address */
@@ -90,47 +141,145 @@ struct virtnet_nic {
 	/** Virtio 1.0 device data */
 	struct virtio_pci_modern_device vdev;
 
-	/** RX/TX virtqueues */
-	struct vring_virtqueue *virtqueue;
+	/** RX/TX virtqueue pairs */
+	struct virtnet_pair *pairs;
+
+	/** Number of RX/TX virtqueue pairs */
+	unsigned int num_pairs;
+
+	/** Control virtqueue, if used */
+	struct vring_virtqueue *ctrl_vq;
+
+	/** Control command */
+	struct virtnet_mq_command mq_cmd;
 
 	/** RX packets handed to the NIC waiting to be filled in */
 	struct list_head rx_iobufs;
 
-	/** Pending rx packet count */
-	unsigned int rx_num_iobufs;
+	/** Max number of pending rx packets (per queue pair) */
+	unsigned int rx_fill;
+
+	/** Receive buffer length (excluding packet header) */
+	size_t rx_len;
 
-	/** Virtio net dummy packet headers */
-	struct virtio_net_hdr_modern empty_header[QUEUE_NB];
+	/** Packets may span multiple receive buffers */
+	int mergeable;
+
+	/** Host may coalesce received packets */
+	int lro;
 };
 
+/** Maximum transmit segmentation offload packet length
+ *
+ * This is limited by the IPv4 total length field.
+ */
+#define VIRTNET_TSO_MAX_LEN ( ETH_HLEN + 65535 )
+
+/** Maximum length of a packet coalesced by the host
+ *
+ * This is limited by the IPv4 total length field.
+ */
+#define VIRTNET_LRO_MAX_LEN ( ETH_HLEN + 65535 )
+
+/** Receive offload features that we request, if enabled */
+#define VIRTNET_LRO_FEATURES ( ( 1ULL << VIRTIO_NET_F_GUEST_TSO4 ) |	\
+			       ( 1ULL << VIRTIO_NET_F_GUEST_TSO6 ) )
+
+/** Transmit offload features that we request */
+#define VIRTNET_OFFLOAD_FEATURES ( ( 1ULL << VIRTIO_NET_F_CSUM ) |	\
+				   ( 1ULL << VIRTIO_NET_F_HOST_TSO4 ) |	\
+				   ( 1ULL << VIRTIO_NET_F_HOST_TSO6 ) )
+
+/** Get virtio net packet header length
+ *
+ * @v virtnet		Virtio-net device
+ * @ret len		Packet header length
+ */
+static inline size_t virtnet_header_len ( struct virtnet_nic *virtnet ) {
+	return ( virtnet->virtio_version ?
+		 sizeof ( struct virtio_net_hdr_modern ) :
+		 sizeof ( struct virtio_net_hdr ) );
+}
+
+/** Record transmit offload capabilities
+ *
+ * @v netdev		Network device
+ * @v features		Negotiated features
+ */
+static void virtnet_offload ( struct net_device *netdev, u64 features ) {
+
+	netdev->offload = 0;
+	if ( features & ( 1ULL << VIRTIO_NET_F_CSUM ) ) {
+		netdev->offload |= NETDEV_TX_CSUM;
+		if ( features & ( 1ULL << VIRTIO_NET_F_HOST_TSO4 ) )
+			netdev->offload |= NETDEV_TX_TSO4;
+		if ( features & ( 1ULL << VIRTIO_NET_F_HOST_TSO6 ) )
+			netdev->offload |= NETDEV_TX_TSO6;
+	}
+	netdev->tso_max_len = VIRTNET_TSO_MAX_LEN;
+}
+
+/** Construct transmit packet header
+ *
+ * @v iobuf		I/O buffer
+ * @v header		Packet header to fill in
+ */
+static void virtnet_tx_header ( struct io_buffer *iobuf,
+				struct virtio_net_hdr_modern *header ) {
+	struct ethhdr *ethhdr = iobuf->data;
+	size_t start;
+
+	/* Clear header */
+	memset ( header, 0, sizeof ( *header ) );
+
+	/* Request checksum completion, if applicable */
+	if ( ! ( iobuf->flags & IOB_TX_CSUM ) )
+		return;
+	start = ( iobuf->trans - iobuf->data );
+	header->legacy.flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+	header->legacy.csum_start = cpu_to_le16 ( start );
+	header->legacy.csum_offset = cpu_to_le16 ( iobuf->csum_offset );
+
+	/* Request segmentation, if applicable */
+	if ( ! ( iobuf->flags & IOB_TX_TSO ) )
+		return;
+	header->legacy.gso_type =
+		( ( ethhdr->h_protocol == htons ( ETH_P_IPV6 ) ) ?
+		  VIRTIO_NET_HDR_GSO_TCPV6 : VIRTIO_NET_HDR_GSO_TCPV4 );
+	header->legacy.hdr_len = cpu_to_le16 ( start + iobuf->trans_len );
+	header->legacy.gso_size = cpu_to_le16 ( iobuf->mss );
+}
+
 /** Add an iobuf to a virtqueue
  *
  * @v netdev		Network device
+ * @v pair		Virtqueue pair
  * @v vq_idx		Virtqueue index (RX_INDEX or TX_INDEX)
  * @v iobuf		I/O buffer
  *
  * The virtqueue is kicked after the iobuf has been added.
  */
 static void virtnet_enqueue_iob ( struct net_device *netdev,
-				  int vq_idx, struct io_buffer *iobuf ) {
+				  struct virtnet_pair *pair, int vq_idx,
+				  struct io_buffer *iobuf ) {
 	struct virtnet_nic *virtnet = netdev->priv;
-	struct vring_virtqueue *vq = &virtnet->virtqueue[vq_idx];
-	struct virtio_net_hdr_modern *header = &virtnet->empty_header[vq_idx];
+	struct vring_virtqueue *vq = &pair->virtqueue[vq_idx];
 	unsigned int out = ( vq_idx == TX_INDEX ) ? 2 : 0;
 	unsigned int in = ( vq_idx == TX_INDEX ) ? 0 : 2;
-	size_t header_len = ( virtnet->virtio_version ?
-			      sizeof ( *header ) : sizeof ( header->legacy ) );
+	size_t header_len = virtnet_header_len ( virtnet );
+	void *header = ( ( vq_idx == TX_INDEX ) ?
+			 &pair->tx_headers[vq->free_head] :
+			 ( iobuf->data - header_len ) );
 	struct vring_list list[] = {
 		{
-			/* Share a single zeroed virtio net header between all
-			 * packets in a ring.  This works because this driver
-			 * does not use any advanced features so none of the
-			 * header fields get used.
+			/* Each transmitted packet uses the header
+			 * associated with its first descriptor, since the
+			 * header conveys per-packet offload requests.
 			 *
-			 * Some host implementations (notably Google Compute
-			 * Platform) are known to unconditionally write back
-			 * to header->flags for received packets.  Work around
-			 * this by using separate RX and TX headers.
+			 * Received packets each have their own header,
+			 * placed immediately before the packet data, since
+			 * the host reports per-packet checksum status via
+			 * header->flags.
 			 */
 			.addr = ( char* ) header,
 			.length = header_len,
@@ -142,37 +291,108 @@ static void virtnet_enqueue_iob ( struct net_device *netdev,
 	};
 
 	DBGC2 ( virtnet, "VIRTIO-NET %p enqueuing iobuf %p on vq %d\n",
-		virtnet, iobuf, vq_idx );
+		virtnet, iobuf, vq->queue_index );
+
+	if ( vq_idx == TX_INDEX )
+		virtnet_tx_header ( iobuf, header );
 
 	vring_add_buf ( vq, list, out, in, iobuf, 0 );
 	vring_kick ( virtnet->virtio_version ? &virtnet->vdev : NULL,
 		     virtnet->ioaddr, vq, 1 );
 }
 
-/** Try to keep rx virtqueue filled with iobufs
+/** Determine max number of pending rx packets
+ *
+ * @v netdev		Network device
+ * @ret fill		Max number of pending rx packets
+ */
+static unsigned int virtnet_rx_fill ( struct net_device *netdev ) {
+	struct virtnet_nic *virtnet = netdev->priv;
+	unsigned int max;
+	unsigned int fill;
+
+	/* Each packet consumes two descriptors (header and data) */
+	max = ( virtnet->pairs[0].virtqueue[RX_INDEX].vring.num / 2 );
+	fill = netdev_ring_size ( netdev, &rxring_setting, NUM_RX_BUF, 1, max );
+	if ( fill > max )
+		fill = max;
+
+	return fill;
+}
+
+/** Determine receive buffer length
  *
  * @v netdev		Network device
+ * @ret len		Receive buffer length (excluding packet header)
  */
-static void virtnet_refill_rx_virtqueue ( struct net_device *netdev ) {
+static size_t virtnet_rx_len ( struct net_device *netdev ) {
 	struct virtnet_nic *virtnet = netdev->priv;
 	size_t len = ( netdev->max_pkt_len + 4 /* VLAN */ );
+	size_t lro_len;
+
+	/* Packets coalesced by the host may span multiple buffers.
+	 * Ensure that a full ring can hold at least two such packets,
+	 * so that the host never has to wait for a refill.
+	 */
+	if ( virtnet->lro ) {
+		lro_len = ( ( ( 2 * VIRTNET_LRO_MAX_LEN ) + virtnet->rx_fill
+			      - 1 ) / virtnet->rx_fill );
+		if ( len < lro_len )
+			len = lro_len;
+	}
+
+	return len;
+}
+
+/** Try to keep rx virtqueue filled with iobufs
+ *
+ * @v netdev		Network device
+ * @v pair		Virtqueue pair
+ */
+static void virtnet_refill_rx_virtqueue ( struct net_device *netdev,
+					  struct virtnet_pair *pair ) {
+	struct virtnet_nic *virtnet = netdev->priv;
+	size_t header_len = virtnet_header_len ( virtnet );
+	size_t len = virtnet->rx_len;
 
-	while ( virtnet->rx_num_iobufs < NUM_RX_BUF ) {
+	while ( pair->rx_num_iobufs < virtnet->rx_fill ) {
 		struct io_buffer *iobuf;
 
 		/* Try to allocate a buffer, stop for now if out of memory */
-		iobuf = alloc_iob ( len );
-		if ( ! iobuf )
+		iobuf = alloc_rx_iob ( netdev, ( header_len + len ) );
+		if ( ! iobuf ) {
+			netdev_rx_nobuf ( netdev );
 			break;
+		}
 
 		/* Keep track of iobuf so close() can free it */
 		list_add ( &iobuf->list, &virtnet->rx_iobufs );
 
-		/* Mark packet length until we know the actual size */
+		/* Leave space for the packet header, and mark packet
+		 * length until we know the actual size
+		 */
+		iob_reserve ( iobuf, header_len );
 		iob_put ( iobuf, len );
 
-		virtnet_enqueue_iob ( netdev, RX_INDEX, iobuf );
-		virtnet->rx_num_iobufs++;
+		virtnet_enqueue_iob ( netdev, pair, RX_INDEX, iobuf );
+		pair->rx_num_iobufs++;
+	}
+}
+
+/** Initialise rx packets
+ *
+ * @v netdev		Network device
+ */
+static void virtnet_init_rx ( struct net_device *netdev ) {
+	struct virtnet_nic *virtnet = netdev->priv;
+	unsigned int i;
+
+	INIT_LIST_HEAD ( &virtnet->rx_iobufs );
+	virtnet->rx_fill = virtnet_rx_fill ( netdev );
+	virtnet->rx_len = virtnet_rx_len ( netdev );
+	for ( i = 0 ; i < virtnet->num_pairs ; i++ ) {
+		virtnet->pairs[i].rx_num_iobufs = 0;
+		virtnet_refill_rx_virtqueue ( netdev, &virtnet->pairs[i] );
 	}
 }
 
@@ -182,15 +402,215 @@ static void virtnet_refill_rx_virtqueue ( struct net_device *netdev ) {
  */
 static void virtnet_free_virtqueues ( struct net_device *netdev ) {
 	struct virtnet_nic *virtnet = netdev->priv;
-	int i;
+	struct virtnet_pair *pair;
+	unsigned int i;
+	int j;
+
+	for ( i = 0 ; virtnet->pairs && ( i < virtnet->num_pairs ) ; i++ ) {
+		pair = &virtnet->pairs[i];
+		for ( j = 0; j < QUEUE_NB; j++ ) {
+			virtio_pci_unmap_capability (
+				&pair->virtqueue[j].notification );
+			vp_free_vq ( &pair->virtqueue[j] );
+		}
+		free ( pair->tx_headers );
+		free_iob ( pair->rx_head );
+		free_iob ( pair->rx_merged );
+	}
+	free ( virtnet->pairs );
+	virtnet->pairs = NULL;
+	virtnet->num_pairs = 0;
+
+	if ( virtnet->ctrl_vq ) {
+		virtio_pci_unmap_capability ( &virtnet->ctrl_vq->notification );
+		vp_free_vq ( virtnet->ctrl_vq );
+		free ( virtnet->ctrl_vq );
+		virtnet->ctrl_vq = NULL;
+	}
+}
 
-	for ( i = 0; i < QUEUE_NB; i++ ) {
-		virtio_pci_unmap_capability ( &virtnet->virtqueue[i].notification );
-		vp_free_vq ( &virtnet->virtqueue[i] );
+/** Allocate virtqueue pairs
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ */
+static int virtnet_alloc_pairs ( struct net_device *netdev ) {
+	struct virtnet_nic *virtnet = netdev->priv;
+
+	virtnet->pairs = zalloc ( virtnet->num_pairs *
+				  sizeof ( virtnet->pairs[0] ) );
+	if ( ! virtnet->pairs )
+		return -ENOMEM;
+
+	return 0;
+}
+
+/** Allocate transmit packet headers
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ */
+static int virtnet_alloc_tx_headers ( struct net_device *netdev ) {
+	struct virtnet_nic *virtnet = netdev->priv;
+	struct virtnet_pair *pair;
+	unsigned int num;
+	unsigned int i;
+
+	for ( i = 0 ; i < virtnet->num_pairs ; i++ ) {
+		pair = &virtnet->pairs[i];
+		num = pair->virtqueue[TX_INDEX].vring.num;
+		pair->tx_headers = zalloc ( num *
+					    sizeof ( pair->tx_headers[0] ) );
+		if ( ! pair->tx_headers )
+			return -ENOMEM;
 	}
 
-	free ( virtnet->virtqueue );
-	virtnet->virtqueue = NULL;
+	return 0;
+}
+
+/** Determine number of queue pairs to use
+ *
+ * @v netdev		Network device
+ * @v features		Offered features
+ * @ret max_pairs	Maximum number of queue pairs supported by device
+ * @ret num_pairs	Number of queue pairs
+ */
+static unsigned int virtnet_num_pairs ( struct net_device *netdev,
+					u64 features,
+					unsigned int *max_pairs ) {
+	struct virtnet_nic *virtnet = netdev->priv;
+	u64 mq = ( ( 1ULL << VIRTIO_NET_F_MQ ) |
+		   ( 1ULL << VIRTIO_NET_F_CTRL_VQ ) );
+	unsigned int max;
+	unsigned int num;
+	u16 pairs;
+
+	/* Use a single queue pair unless multiqueue is supported */
+	*max_pairs = 1;
+	if ( ( ( features & mq ) != mq ) || ( ! virtnet->vdev.device.length ) )
+		return 1;
+	vpm_get ( &virtnet->vdev,
+		  offsetof ( struct virtio_net_config, max_virtqueue_pairs ),
+		  &pairs, sizeof ( pairs ) );
+	*max_pairs = le16_to_cpu ( pairs );
+	DBGC ( virtnet, "VIRTIO-NET %p supports %d queue pairs\n",
+	       virtnet, *max_pairs );
+	if ( ( *max_pairs < VIRTIO_NET_CTRL_MQ_VQ_PAIRS_MIN ) ||
+	     ( *max_pairs > VIRTIO_NET_CTRL_MQ_VQ_PAIRS_MAX ) ) {
+		*max_pairs = 1;
+		return 1;
+	}
+	max = *max_pairs;
+	if ( max > VIRTNET_MAX_PAIRS )
+		max = VIRTNET_MAX_PAIRS;
+	max = ( 1 << ( fls ( max ) - 1 ) );
+	num = netdev_ring_size ( netdev, &rxqueues_setting, VIRTNET_DEF_PAIRS,
+				 1, max );
+	if ( num > max )
+		num = max;
+
+	return num;
+}
+
+/** Initialize virtqueues, modern virtio 1.0
+ *
+ * @v netdev		Network device
+ * @v max_pairs		Maximum number of queue pairs supported by device
+ * @ret rc		Return status code
+ */
+static int virtnet_find_vqs_modern ( struct net_device *netdev,
+				     unsigned int max_pairs ) {
+	struct virtnet_nic *virtnet = netdev->priv;
+	struct virtnet_pair *pair;
+	unsigned int i;
+	int j;
+	int rc;
+
+	/* Queue pair N uses virtqueues 2N and 2N+1; the control
+	 * virtqueue (if any) follows the maximum number of queue pairs
+	 * supported by the device.
+	 */
+	for ( i = 0 ; i < virtnet->num_pairs ; i++ ) {
+		pair = &virtnet->pairs[i];
+		for ( j = 0 ; j < QUEUE_NB ; j++ ) {
+			if ( ( rc = vpm_find_vq ( &virtnet->vdev,
+						  ( ( i * QUEUE_NB ) + j ),
+						  &pair->virtqueue[j] ) ) != 0 )
+				goto err;
+		}
+	}
+	if ( virtnet->ctrl_vq &&
+	     ( ( rc = vpm_find_vq ( &virtnet->vdev, ( max_pairs * QUEUE_NB ),
+				    virtnet->ctrl_vq ) ) != 0 ) )
+		goto err;
+
+	/* Activate all queues */
+	for ( i = 0 ; i < virtnet->num_pairs ; i++ ) {
+		pair = &virtnet->pairs[i];
+		for ( j = 0 ; j < QUEUE_NB ; j++ )
+			vpm_enable_vq ( &virtnet->vdev, &pair->virtqueue[j] );
+	}
+	if ( virtnet->ctrl_vq )
+		vpm_enable_vq ( &virtnet->vdev, virtnet->ctrl_vq );
+
+	return 0;
+
+ err:
+	DBGC ( virtnet, "VIRTIO-NET %p cannot register queues\n", virtnet );
+	return rc;
+}
+
+/** Set number of active queue pairs
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ */
+static int virtnet_set_pairs ( struct net_device *netdev ) {
+	struct virtnet_nic *virtnet = netdev->priv;
+	struct virtnet_mq_command *cmd = &virtnet->mq_cmd;
+	struct vring_virtqueue *vq = virtnet->ctrl_vq;
+	struct vring_list list[] = {
+		{
+			.addr = ( char * ) &cmd->hdr,
+			.length = sizeof ( cmd->hdr ),
+		},
+		{
+			.addr = ( char * ) &cmd->mq,
+			.length = sizeof ( cmd->mq ),
+		},
+		{
+			.addr = ( char * ) &cmd->ack,
+			.length = sizeof ( cmd->ack ),
+		},
+	};
+	unsigned int i;
+
+	/* Issue command */
+	cmd->hdr.class = VIRTIO_NET_CTRL_MQ;
+	cmd->hdr.cmd = VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET;
+	cmd->mq.virtqueue_pairs = cpu_to_le16 ( virtnet->num_pairs );
+	cmd->ack = VIRTIO_NET_ERR;
+	vring_add_buf ( vq, list, 2, 1, cmd, 0 );
+	vring_kick ( &virtnet->vdev, virtnet->ioaddr, vq, 1 );
+
+	/* Wait for command to complete */
+	for ( i = 0 ; i < VIRTNET_CTRL_MAX_WAIT_MS ; i++ ) {
+		if ( vring_more_used ( vq ) ) {
+			vring_get_buf ( vq, NULL );
+			if ( cmd->ack != VIRTIO_NET_OK ) {
+				DBGC ( virtnet, "VIRTIO-NET %p could not set "
+				       "%d queue pairs\n",
+				       virtnet, virtnet->num_pairs );
+				return -EIO;
+			}
+			return 0;
+		}
+		mdelay ( 1 );
+	}
+
+	DBGC ( virtnet, "VIRTIO-NET %p timed out setting queue pairs\n",
+	       virtnet );
+	return -ETIMEDOUT;
 }
 
 /** Open network device, legacy virtio 0.9.5
@@ -203,19 +623,20 @@ static int virtnet_open_legacy ( struct net_device *netdev ) {
 	unsigned long ioaddr = virtnet->ioaddr;
 	u32 features;
 	int i;
+	int rc;
 
 	/* Reset for sanity */
 	vp_reset ( ioaddr );
 
 	/* Allocate virtqueues */
-	virtnet->virtqueue = zalloc ( QUEUE_NB *
-				      sizeof ( *virtnet->virtqueue ) );
-	if ( ! virtnet->virtqueue )
-		return -ENOMEM;
+	virtnet->num_pairs = 1;
+	if ( ( rc = virtnet_alloc_pairs ( netdev ) ) != 0 )
+		return rc;
 
 	/* Initialize rx/tx virtqueues */
 	for ( i = 0; i < QUEUE_NB; i++ ) {
-		if ( vp_find_vq ( ioaddr, i, &virtnet->virtqueue[i] ) == -1 ) {
+		if ( vp_find_vq ( ioaddr, i,
+				  &virtnet->pairs[0].virtqueue[i] ) == -1 ) {
 			DBGC ( virtnet, "VIRTIO-NET %p cannot register queue %d\n",
 			       virtnet, i );
 			virtnet_free_virtqueues ( netdev );
@@ -223,18 +644,26 @@ static int virtnet_open_legacy ( struct net_device *netdev ) {
 		}
 	}
 
+	/* Allocate transmit packet headers */
+	if ( ( rc = virtnet_alloc_tx_headers ( netdev ) ) != 0 ) {
+		virtnet_free_virtqueues ( netdev );
+		return rc;
+	}
+
 	/* Initialize rx packets */
-	INIT_LIST_HEAD ( &virtnet->rx_iobufs );
-	virtnet->rx_num_iobufs = 0;
-	virtnet_refill_rx_virtqueue ( netdev );
+	virtnet_init_rx ( netdev );
 
 	/* Disable interrupts before starting */
 	netdev_irq ( netdev, 0 );
 
 	/* Driver is ready */
-	features = vp_get_features ( ioaddr );
-	vp_set_features ( ioaddr, features & ( ( 1 << VIRTIO_NET_F_MAC ) |
-					       ( 1 << VIRTIO_NET_F_MTU ) ) );
+	features = ( vp_get_features ( ioaddr ) &
+		     ( ( 1 << VIRTIO_NET_F_MAC ) |
+		       ( 1 << VIRTIO_NET_F_MTU ) |
+		       ( 1 << VIRTIO_NET_F_GUEST_CSUM ) |
+		       VIRTNET_OFFLOAD_FEATURES ) );
+	vp_set_features ( ioaddr, features );
+	virtnet_offload ( netdev, features );
 	vp_set_status ( ioaddr, VIRTIO_CONFIG_S_DRIVER | VIRTIO_CONFIG_S_DRIVER_OK );
 	return 0;
 }
@@ -246,8 +675,12 @@ static int virtnet_open_legacy ( struct net_device *netdev ) {
  */
 static int virtnet_open_modern ( struct net_device *netdev ) {
 	struct virtnet_nic *virtnet = netdev->priv;
+	unsigned int max_pairs;
 	u64 features;
+	u64 mq;
+	u64 lro;
 	u8 status;
+	int rc;
 
 	/* Negotiate features */
 	features = vpm_get_features ( &virtnet->vdev );
@@ -255,12 +688,41 @@ static int virtnet_open_modern ( struct net_device *netdev ) {
 		vpm_add_status ( &virtnet->vdev, VIRTIO_CONFIG_S_FAILED );
 		return -EINVAL;
 	}
-	vpm_set_features ( &virtnet->vdev, features & (
-		( 1ULL << VIRTIO_NET_F_MAC ) |
-		( 1ULL << VIRTIO_NET_F_MTU ) |
-		( 1ULL << VIRTIO_F_VERSION_1 ) |
-		( 1ULL << VIRTIO_F_ANY_LAYOUT ) |
-		( 1ULL << VIRTIO_F_IOMMU_PLATFORM ) ) );
+	virtnet->num_pairs = virtnet_num_pairs ( netdev, features,
+						 &max_pairs );
+	mq = ( ( virtnet->num_pairs > 1 ) ?
+	       ( ( 1ULL << VIRTIO_NET_F_MQ ) |
+		 ( 1ULL << VIRTIO_NET_F_CTRL_VQ ) ) : 0 );
+	lro = ( fetch_intz_setting ( netdev_settings ( netdev ),
+				     &lro_setting ) ? VIRTNET_LRO_FEATURES : 0 );
+	features &= ( ( 1ULL << VIRTIO_NET_F_MAC ) |
+		      ( 1ULL << VIRTIO_NET_F_MTU ) |
+		      ( 1ULL << VIRTIO_NET_F_GUEST_CSUM ) |
+		      ( 1ULL << VIRTIO_NET_F_MRG_RXBUF ) |
+		      VIRTNET_OFFLOAD_FEATURES | mq | lro |
+		      ( 1ULL << VIRTIO_F_VERSION_1 ) |
+		      ( 1ULL << VIRTIO_F_ANY_LAYOUT ) |
+		      ( 1ULL << VIRTIO_F_IOMMU_PLATFORM ) |
+		      ( 1ULL << VIRTIO_F_RING_PACKED ) );
+
+	/* Accept host-coalesced packets only if they can be received
+	 * into multiple ordinary buffers, and only if the host will
+	 * supply checksum information for them.
+	 */
+	if ( ! ( ( features & ( 1ULL << VIRTIO_NET_F_MRG_RXBUF ) ) &&
+		 ( features & ( 1ULL << VIRTIO_NET_F_GUEST_CSUM ) ) ) ) {
+		features &= ~VIRTNET_LRO_FEATURES;
+	}
+	virtnet->mergeable =
+		( !! ( features & ( 1ULL << VIRTIO_NET_F_MRG_RXBUF ) ) );
+	virtnet->lro = ( !! ( features & VIRTNET_LRO_FEATURES ) );
+	virtnet->vdev.packed =
+		( !! ( features & ( 1ULL << VIRTIO_F_RING_PACKED ) ) );
+	DBGC ( virtnet, "VIRTIO-NET %p using %s virtqueues%s%s\n",
+	       virtnet, ( virtnet->vdev.packed ? "packed" : "split" ),
+	       ( virtnet->mergeable ? ", mergeable buffers" : "" ),
+	       ( virtnet->lro ? ", LRO" : "" ) );
+	vpm_set_features ( &virtnet->vdev, features );
 	vpm_add_status ( &virtnet->vdev, VIRTIO_CONFIG_S_FEATURES_OK );
 
 	status = vpm_get_status ( &virtnet->vdev );
@@ -272,32 +734,49 @@ static int virtnet_open_modern ( struct net_device *netdev ) {
 	}
 
 	/* Allocate virtqueues */
-	virtnet->virtqueue = zalloc ( QUEUE_NB *
-				      sizeof ( *virtnet->virtqueue ) );
-	if ( ! virtnet->virtqueue ) {
-		vpm_add_status ( &virtnet->vdev, VIRTIO_CONFIG_S_FAILED );
-		return -ENOMEM;
+	if ( ( rc = virtnet_alloc_pairs ( netdev ) ) != 0 )
+		goto err_alloc;
+	if ( mq ) {
+		virtnet->ctrl_vq = zalloc ( sizeof ( *virtnet->ctrl_vq ) );
+		if ( ! virtnet->ctrl_vq ) {
+			rc = -ENOMEM;
+			goto err_alloc;
+		}
 	}
 
 	/* Initialize rx/tx virtqueues */
-	if ( vpm_find_vqs ( &virtnet->vdev, QUEUE_NB, virtnet->virtqueue ) ) {
-		DBGC ( virtnet, "VIRTIO-NET %p cannot register queues\n",
-		       virtnet );
-		virtnet_free_virtqueues ( netdev );
-		vpm_add_status ( &virtnet->vdev, VIRTIO_CONFIG_S_FAILED );
-		return -ENOENT;
-	}
+	if ( ( rc = virtnet_find_vqs_modern ( netdev, max_pairs ) ) != 0 )
+		goto err_find_vqs;
+
+	/* Allocate transmit packet headers */
+	if ( ( rc = virtnet_alloc_tx_headers ( netdev ) ) != 0 )
+		goto err_alloc_tx_headers;
+	virtnet_offload ( netdev, features );
 
 	/* Disable interrupts before starting */
 	netdev_irq ( netdev, 0 );
 
 	vpm_add_status ( &virtnet->vdev, VIRTIO_CONFIG_S_DRIVER_OK );
 
+	/* Enable multiple queue pairs, if applicable */
+	if ( virtnet->ctrl_vq &&
+	     ( ( rc = virtnet_set_pairs ( netdev ) ) != 0 ) )
+		goto err_set_pairs;
+	DBGC ( virtnet, "VIRTIO-NET %p using %d queue pair(s)\n",
+	       virtnet, virtnet->num_pairs );
+
 	/* Initialize rx packets */
-	INIT_LIST_HEAD ( &virtnet->rx_iobufs );
-	virtnet->rx_num_iobufs = 0;
-	virtnet_refill_rx_virtqueue ( netdev );
+	virtnet_init_rx ( netdev );
 	return 0;
+
+ err_set_pairs:
+	vpm_reset ( &virtnet->vdev );
+ err_alloc_tx_headers:
+ err_find_vqs:
+ err_alloc:
+	virtnet_free_virtqueues ( netdev );
+	vpm_add_status ( &virtnet->vdev, VIRTIO_CONFIG_S_FAILED );
+	return rc;
 }
 
 /** Open network device
@@ -338,7 +817,75 @@ static void virtnet_close ( struct net_device *netdev ) {
 		free_iob ( iobuf );
 	}
 	INIT_LIST_HEAD ( &virtnet->rx_iobufs );
-	virtnet->rx_num_iobufs = 0;
+}
+
+/** Select transmit queue pair
+ *
+ * @v virtnet		Virtio-net device
+ * @v iobuf		I/O buffer
+ * @ret pair		Virtqueue pair
+ *
+ * The device steers received packets to the receive queue paired
+ * with the transmit queue on which the flow was most recently
+ * transmitted, so all packets for a flow must use the same transmit
+ * queue.  We therefore hash the IP addresses and (for unfragmented
+ * TCP and UDP packets) ports to select a queue pair, which both
+ * preserves packet ordering within each flow and spreads independent
+ * flows across the receive queues.
+ */
+static struct virtnet_pair * virtnet_tx_pair ( struct virtnet_nic *virtnet,
+					       struct io_buffer *iobuf ) {
+	struct ethhdr *ethhdr = iobuf->data;
+	struct iphdr *iphdr;
+	struct ipv6_header *ip6hdr;
+	size_t len = iob_len ( iobuf );
+	size_t hdrlen;
+	uint32_t hash;
+	uint16_t *ports;
+	uint8_t proto;
+	unsigned int i;
+
+	/* Use first queue pair if there is no choice to make */
+	if ( virtnet->num_pairs == 1 )
+		return &virtnet->pairs[0];
+
+	/* Hash network-layer addresses */
+	if ( ( ethhdr->h_protocol == htons ( ETH_P_IP ) ) &&
+	     ( len >= ( sizeof ( *ethhdr ) + sizeof ( *iphdr ) ) ) ) {
+		iphdr = ( iobuf->data + sizeof ( *ethhdr ) );
+		hash = ( iphdr->src.s_addr ^ iphdr->dest.s_addr );
+		hdrlen = ( sizeof ( *ethhdr ) +
+			   ( ( iphdr->verhdrlen & IP_MASK_HLEN ) * 4 ) );
+		proto = ( ( iphdr->frags & htons ( IP_MASK_OFFSET |
+						   IP_MASK_MOREFRAGS ) ) ?
+			  0 : iphdr->protocol );
+	} else if ( ( ethhdr->h_protocol == htons ( ETH_P_IPV6 ) ) &&
+		    ( len >= ( sizeof ( *ethhdr ) + sizeof ( *ip6hdr ) ) ) ) {
+		ip6hdr = ( iobuf->data + sizeof ( *ethhdr ) );
+		hash = 0;
+		for ( i = 0 ; i < ( sizeof ( ip6hdr->src.s6_addr32 ) /
+				    sizeof ( ip6hdr->src.s6_addr32[0] ) ) ;
+		      i++ ) {
+			hash ^= ( ip6hdr->src.s6_addr32[i] ^
+				  ip6hdr->dest.s6_addr32[i] );
+		}
+		hdrlen = ( sizeof ( *ethhdr ) + sizeof ( *ip6hdr ) );
+		proto = ip6hdr->next_header;
+	} else {
+		return &virtnet->pairs[0];
+	}
+
+	/* Hash transport-layer ports, if applicable */
+	if ( ( ( proto == IP_TCP ) || ( proto == IP_UDP ) ) &&
+	     ( len >= ( hdrlen + ( 2 * sizeof ( ports[0] ) ) ) ) ) {
+		ports = ( iobuf->data + hdrlen );
+		hash ^= ( ports[0] ^ ports[1] );
+	}
+
+	/* Fold hash to select queue pair */
+	hash ^= ( hash >> 16 );
+	hash ^= ( hash >> 8 );
+	return &virtnet->pairs[ hash % virtnet->num_pairs ];
 }
 
 /** Transmit packet
@@ -349,17 +896,22 @@ static void virtnet_close ( struct net_device *netdev ) {
  */
 static int virtnet_transmit ( struct net_device *netdev,
 			      struct io_buffer *iobuf ) {
-	virtnet_enqueue_iob ( netdev, TX_INDEX, iobuf );
+	struct virtnet_nic *virtnet = netdev->priv;
+
+	virtnet_enqueue_iob ( netdev, virtnet_tx_pair ( virtnet, iobuf ),
+			      TX_INDEX, iobuf );
 	return 0;
 }
 
 /** Complete packet transmission
  *
  * @v netdev	Network device
+ * @v pair	Virtqueue pair
  */
-static void virtnet_process_tx_packets ( struct net_device *netdev ) {
+static void virtnet_process_tx_packets ( struct net_device *netdev,
+					 struct virtnet_pair *pair ) {
 	struct virtnet_nic *virtnet = netdev->priv;
-	struct vring_virtqueue *tx_vq = &virtnet->virtqueue[TX_INDEX];
+	struct vring_virtqueue *tx_vq = &pair->virtqueue[TX_INDEX];
 
 	while ( vring_more_used ( tx_vq ) ) {
 		struct io_buffer *iobuf = vring_get_buf ( tx_vq, NULL );
@@ -371,13 +923,140 @@ static void virtnet_process_tx_packets ( struct net_device *netdev ) {
 	}
 }
 
+/** Record received packet checksum status
+ *
+ * @v virtnet		Virtio-net device
+ * @v iobuf		I/O buffer
+ * @v header		Packet header
+ */
+static void virtnet_rx_csum ( struct virtnet_nic *virtnet,
+			      struct io_buffer *iobuf,
+			      struct virtio_net_hdr *header ) {
+	size_t start = le16_to_cpu ( header->csum_start );
+	size_t offset = le16_to_cpu ( header->csum_offset );
+	uint16_t *csum;
+
+	/* Accept checksums already validated by the host */
+	if ( header->flags & VIRTIO_NET_HDR_F_DATA_VALID ) {
+		iobuf->flags |= IOB_CSUM_VERIFIED;
+		return;
+	}
+
+	/* Complete partial checksums on packets originating from
+	 * within the host, which are never corrupted in transit.  The
+	 * packet may subsequently be handed to an external consumer
+	 * (e.g. via SNP), so the checksum must be filled in.
+	 */
+	if ( header->flags & VIRTIO_NET_HDR_F_NEEDS_CSUM ) {
+		if ( ( start + offset + sizeof ( *csum ) ) >
+		     iob_len ( iobuf ) ) {
+			DBGC ( virtnet, "VIRTIO-NET %p invalid partial "
+			       "checksum %#zx+%#zx\n", virtnet, start, offset );
+			return;
+		}
+		csum = ( iobuf->data + start + offset );
+		*csum = tcpip_chksum ( ( iobuf->data + start ),
+				       ( iob_len ( iobuf ) - start ) );
+		iobuf->flags |= IOB_CSUM_VERIFIED;
+	}
+}
+
+/** Start reception of a packet spanning multiple buffers
+ *
+ * @v netdev	Network device
+ * @v pair	Virtqueue pair
+ * @v iobuf	First I/O buffer
+ * @v count	Total number of buffers
+ */
+static void virtnet_rx_merge_start ( struct net_device *netdev,
+				     struct virtnet_pair *pair,
+				     struct io_buffer *iobuf,
+				     unsigned int count ) {
+	struct virtnet_nic *virtnet = netdev->priv;
+	size_t header_len = virtnet_header_len ( virtnet );
+	size_t len = ( count * ( header_len + virtnet->rx_len ) );
+
+	/* Record first buffer, which holds the packet header */
+	pair->rx_head = iobuf;
+	pair->rx_remaining = ( count - 1 );
+
+	/* Allocate buffer for reassembled packet.  If allocation
+	 * fails, we must still consume (and discard) the remaining
+	 * buffers.
+	 */
+	pair->rx_merged = alloc_iob ( len );
+	if ( ! pair->rx_merged ) {
+		netdev_rx_err ( netdev, NULL, -ENOMEM );
+		return;
+	}
+	memcpy ( iob_put ( pair->rx_merged, iob_len ( iobuf ) ),
+		 iobuf->data, iob_len ( iobuf ) );
+}
+
+/** Continue reception of a packet spanning multiple buffers
+ *
+ * @v netdev	Network device
+ * @v pair	Virtqueue pair
+ * @v iobuf	I/O buffer
+ * @v len	Length of received data
+ * @v burst	List of received packets
+ */
+static void virtnet_rx_merge ( struct net_device *netdev,
+			       struct virtnet_pair *pair,
+			       struct io_buffer *iobuf, size_t len,
+			       struct list_head *burst ) {
+	struct virtnet_nic *virtnet = netdev->priv;
+	struct io_buffer *merged = pair->rx_merged;
+	size_t header_len = virtnet_header_len ( virtnet );
+
+	/* Append data.  Only the first buffer contains a packet
+	 * header; subsequent buffers are filled with packet data from
+	 * the start, including the space reserved for the header.
+	 */
+	if ( merged ) {
+		if ( len <= iob_tailroom ( merged ) ) {
+			memcpy ( iob_put ( merged, len ),
+				 ( iobuf->data - header_len ), len );
+		} else {
+			DBGC ( virtnet, "VIRTIO-NET %p invalid merged "
+			       "buffer length %#zx\n", virtnet, len );
+			netdev_rx_err ( netdev, merged, -EINVAL );
+			merged = pair->rx_merged = NULL;
+		}
+	}
+	free_iob ( iobuf );
+
+	/* Wait for any remaining buffers */
+	if ( --pair->rx_remaining )
+		return;
+
+	/* Hand off reassembled packet */
+	if ( merged ) {
+		virtnet_rx_csum ( virtnet, merged,
+				  ( pair->rx_head->data - header_len ) );
+		DBGC2 ( virtnet, "VIRTIO-NET %p rx complete merged iobuf %p "
+			"len %zd\n", virtnet, merged, iob_len ( merged ) );
+		list_add_tail ( &merged->list, burst );
+	}
+	free_iob ( pair->rx_head );
+	pair->rx_head = NULL;
+	pair->rx_merged = NULL;
+}
+
 /** Complete packet reception
  *
  * @v netdev	Network device
+ * @v pair	Virtqueue pair
+ * @v burst	List of received packets
  */
-static void virtnet_process_rx_packets ( struct net_device *netdev ) {
+static void virtnet_process_rx_packets ( struct net_device *netdev,
+					 struct virtnet_pair *pair,
+					 struct list_head *burst ) {
 	struct virtnet_nic *virtnet = netdev->priv;
-	struct vring_virtqueue *rx_vq = &virtnet->virtqueue[RX_INDEX];
+	struct vring_virtqueue *rx_vq = &pair->virtqueue[RX_INDEX];
+	size_t header_len = virtnet_header_len ( virtnet );
+	struct virtio_net_hdr_modern *header;
+	unsigned int count;
 
 	while ( vring_more_used ( rx_vq ) ) {
 		unsigned int len;
@@ -385,20 +1064,36 @@ static void virtnet_process_rx_packets ( struct net_device *netdev ) {
 
 		/* Release ownership of iobuf */
 		list_del ( &iobuf->list );
-		virtnet->rx_num_iobufs--;
+		pair->rx_num_iobufs--;
+
+		/* Continue any packet spanning multiple buffers */
+		if ( pair->rx_remaining ) {
+			virtnet_rx_merge ( netdev, pair, iobuf, len, burst );
+			continue;
+		}
 
 		/* Update iobuf length */
+		header = ( iobuf->data - header_len );
 		iob_unput ( iobuf, iob_len ( iobuf ) );
-		iob_put ( iobuf, len - sizeof ( struct virtio_net_hdr ) );
+		iob_put ( iobuf, len - header_len );
+
+		/* Start any packet spanning multiple buffers */
+		count = ( virtnet->mergeable ?
+			  le16_to_cpu ( header->num_buffers ) : 1 );
+		if ( count > 1 ) {
+			virtnet_rx_merge_start ( netdev, pair, iobuf, count );
+			continue;
+		}
+
+		/* Record checksum status */
+		virtnet_rx_csum ( virtnet, iobuf, &header->legacy );
 
 		DBGC2 ( virtnet, "VIRTIO-NET %p rx complete iobuf %p len %zd\n",
 			virtnet, iobuf, iob_len ( iobuf ) );
 
-		/* Pass completed packet to the network stack */
-		netdev_rx ( netdev, iobuf );
+		/* Add completed packet to burst */
+		list_add_tail ( &iobuf->list, burst );
 	}
-
-	virtnet_refill_rx_virtqueue ( netdev );
 }
 
 /** Poll for completed and received packets
@@ -407,6 +1102,8 @@ static void virtnet_process_rx_packets ( struct net_device *netdev ) {
  */
 static void virtnet_poll ( struct net_device *netdev ) {
 	struct virtnet_nic *virtnet = netdev->priv;
+	struct list_head burst;
+	unsigned int i;
 
 	/* Acknowledge interrupt.  This is necessary for UNDI operation and
 	 * interrupts that are raised despite VRING_AVAIL_F_NO_INTERRUPT being
@@ -419,8 +1116,20 @@ static void virtnet_poll ( struct net_device *netdev ) {
 		vp_get_isr ( virtnet->ioaddr );
 	}
 
-	virtnet_process_tx_packets ( netdev );
-	virtnet_process_rx_packets ( netdev );
+	/* Complete packets on all queue pairs */
+	INIT_LIST_HEAD ( &burst );
+	for ( i = 0 ; i < virtnet->num_pairs ; i++ ) {
+		virtnet_process_tx_packets ( netdev, &virtnet->pairs[i] );
+		virtnet_process_rx_packets ( netdev, &virtnet->pairs[i],
+					     &burst );
+	}
+
+	/* Pass completed packets to the network stack */
+	netdev_rx_burst ( netdev, &burst );
+
+	/* Refill all receive queues */
+	for ( i = 0 ; i < virtnet->num_pairs ; i++ )
+		virtnet_refill_rx_virtqueue ( netdev, &virtnet->pairs[i] );
 }
 
 /** Enable or disable interrupts
@@ -430,13 +1139,18 @@ static void virtnet_poll ( struct net_device *netdev ) {
  */
 static void virtnet_irq ( struct net_device *netdev, int enable ) {
 	struct virtnet_nic *virtnet = netdev->priv;
-	int i;
-
-	for ( i = 0; i < QUEUE_NB; i++ ) {
-		if ( enable )
-			vring_enable_cb ( &virtnet->virtqueue[i] );
-		else
-			vring_disable_cb ( &virtnet->virtqueue[i] );
+	struct vring_virtqueue *vq;
+	unsigned int i;
+	int j;
+
+	for ( i = 0 ; i < virtnet->num_pairs ; i++ ) {
+		for ( j = 0; j < QUEUE_NB; j++ ) {
+			vq = &virtnet->pairs[i].virtqueue[j];
+			if ( enable )
+				vring_enable_cb ( vq );
+			else
+				vring_disable_cb ( vq );
+		}
 	}
 }
 
@@ -21,6 +21,7 @@
 #define VIRTIO_NET_F_CTRL_RX    18      /* Control channel RX mode support. */
 #define VIRTIO_NET_F_CTRL_VLAN  19      /* Control channel VLAN filtering. */
 #define VIRTIO_NET_F_GUEST_ANNOUNCE 21  /* Driver can send gratuitous packets. */
+#define VIRTIO_NET_F_MQ         22      /* Device supports multiqueue with automatic receive steering */
 
 struct virtio_net_config
 {
@@ -43,6 +44,7 @@ struct virtio_net_config
 struct virtio_net_hdr
 {
 #define VIRTIO_NET_HDR_F_NEEDS_CSUM     1       // Use csum_start, csum_offset
+#define VIRTIO_NET_HDR_F_DATA_VALID     2       // Checksum is valid
    uint8_t flags;
 #define VIRTIO_NET_HDR_GSO_NONE         0       // Not a GSO frame
 #define VIRTIO_NET_HDR_GSO_TCPV4        1       // GSO frame, IPv4 TCP (TSO)
@@ -67,4 +69,31 @@ struct virtio_net_hdr_modern
    uint16_t num_buffers;
 };
 
+/* Control virtqueue command header.  The command-specific data follows
+ * the header, and a device-writable acknowledgement byte follows the
+ * command-specific data. */
+struct virtio_net_ctrl_hdr
+{
+   u8 class;
+   u8 cmd;
+} __attribute__((packed));
+
+typedef u8 virtio_net_ctrl_ack;
+
+#define VIRTIO_NET_OK   0
+#define VIRTIO_NET_ERR  1
+
+/* Control multiqueue operation.  The device steers each flow's received
+ * packets to the receive queue matching the transmit queue on which the
+ * flow was most recently transmitted. */
+struct virtio_net_ctrl_mq
+{
+   u16 virtqueue_pairs;
+} __attribute__((packed));
+
+#define VIRTIO_NET_CTRL_MQ                      4
+#define VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET         0
+#define VIRTIO_NET_CTRL_MQ_VQ_PAIRS_MIN         1
+#define VIRTIO_NET_CTRL_MQ_VQ_PAIRS_MAX         0x8000
+
 #endif /* _VIRTIO_NET_H_ */
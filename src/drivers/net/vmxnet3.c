@@ -35,6 +35,8 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/netdevice.h>
 #include <ipxe/if_ether.h>
 #include <ipxe/ethernet.h>
+#include <ipxe/tcpip.h>
+#include <ipxe/settings.h>
 #include "vmxnet3.h"
 
 /**
@@ -60,6 +62,18 @@ static struct profiler vmxnet3_vm_refill_profiler __profiler =
 static struct profiler vmxnet3_vm_event_profiler __profiler =
 	{ .name = "vmxnet3.vm_event" };
 
+/** RSS hash key
+ *
+ * This is the default Toeplitz key from the Microsoft RSS
+ * specification.
+ */
+static const uint8_t vmxnet3_rss_key[VMXNET3_RSS_KEY_LEN] = {
+	0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2, 0x41, 0x67,
+	0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0, 0xd0, 0xca, 0x2b, 0xcb,
+	0xae, 0x7b, 0x30, 0xb4, 0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30,
+	0xf2, 0x0c, 0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa,
+};
+
 /**
  * Issue command
  *
@@ -81,6 +95,47 @@ static inline uint32_t vmxnet3_command ( struct vmxnet3_nic *vmxnet,
 	return result;
 }
 
+/**
+ * Request transmit offload
+ *
+ * @v iobuf		I/O buffer
+ * @v tx_desc		Transmit descriptor
+ */
+static void vmxnet3_offload ( struct io_buffer *iobuf,
+			      struct vmxnet3_tx_desc *tx_desc ) {
+	uint16_t *csum;
+	uint16_t len;
+	size_t start;
+	size_t hlen;
+
+	/* Do nothing unless checksum offload is requested */
+	if ( ! ( iobuf->flags & IOB_TX_CSUM ) )
+		return;
+	start = ( iobuf->trans - iobuf->data );
+
+	/* Request checksum completion, if applicable */
+	if ( ! ( iobuf->flags & IOB_TX_TSO ) ) {
+		tx_desc->flags[0] |= cpu_to_le32 ( VMXNET3_TXF_MSSCOF (
+					start + iobuf->csum_offset ) );
+		tx_desc->flags[1] |= cpu_to_le32 ( VMXNET3_TXF_OM_CSUM |
+						   VMXNET3_TXF_HLEN ( start ) );
+		return;
+	}
+
+	/* The device expects the pseudo-header checksum to exclude
+	 * the length, since this will differ for each segment.
+	 */
+	csum = ( iobuf->trans + iobuf->csum_offset );
+	len = ~htons ( iobuf->tail - iobuf->trans );
+	*csum = ~tcpip_continue_chksum ( ~*csum, &len, sizeof ( len ) );
+
+	/* Request segmentation */
+	hlen = ( start + iobuf->trans_len );
+	tx_desc->flags[0] |= cpu_to_le32 ( VMXNET3_TXF_MSSCOF ( iobuf->mss ) );
+	tx_desc->flags[1] |= cpu_to_le32 ( VMXNET3_TXF_OM_TSO |
+					   VMXNET3_TXF_HLEN ( hlen ) );
+}
+
 /**
  * Transmit packet
  *
@@ -121,6 +176,7 @@ static int vmxnet3_transmit ( struct net_device *netdev,
 	tx_desc->address = cpu_to_le64 ( virt_to_bus ( iobuf->data ) );
 	tx_desc->flags[0] = ( generation | cpu_to_le32 ( iob_len ( iobuf ) ) );
 	tx_desc->flags[1] = cpu_to_le32 ( VMXNET3_TXF_CQ | VMXNET3_TXF_EOP );
+	vmxnet3_offload ( iobuf, tx_desc );
 
 	/* Hand over descriptor to NIC */
 	wmb();
@@ -204,52 +260,57 @@ static void vmxnet3_flush_tx ( struct net_device *netdev ) {
  * Refill receive ring
  *
  * @v netdev		Network device
+ * @v queue		Receive queue index
  */
-static void vmxnet3_refill_rx ( struct net_device *netdev ) {
+static void vmxnet3_refill_rx ( struct net_device *netdev,
+				unsigned int queue ) {
 	struct vmxnet3_nic *vmxnet = netdev_priv ( netdev );
+	struct vmxnet3_rx *rx = &vmxnet->rx[queue];
 	struct vmxnet3_rx_desc *rx_desc;
 	struct io_buffer *iobuf;
-	unsigned int orig_rx_prod = vmxnet->count.rx_prod;
+	unsigned int orig_rx_prod = rx->prod;
 	unsigned int desc_idx;
 	unsigned int generation;
 
 	/* Fill receive ring to specified fill level */
-	while ( vmxnet->count.rx_fill < VMXNET3_RX_FILL ) {
+	while ( rx->fill < vmxnet->rx_fill ) {
 
 		/* Locate receive descriptor */
-		desc_idx = ( vmxnet->count.rx_prod % VMXNET3_NUM_RX_DESC );
-		generation = ( ( vmxnet->count.rx_prod & VMXNET3_NUM_RX_DESC ) ?
+		desc_idx = ( rx->prod % VMXNET3_NUM_RX_DESC );
+		generation = ( ( rx->prod & VMXNET3_NUM_RX_DESC ) ?
 			       0 : cpu_to_le32 ( VMXNET3_RXF_GEN ) );
-		assert ( vmxnet->rx_iobuf[desc_idx] == NULL );
+		assert ( rx->iobuf[desc_idx] == NULL );
 
 		/* Allocate I/O buffer */
 		iobuf = alloc_iob ( VMXNET3_MTU + NET_IP_ALIGN );
 		if ( ! iobuf ) {
 			/* Non-fatal low memory condition */
+			netdev_rx_nobuf ( netdev );
 			break;
 		}
 		iob_reserve ( iobuf, NET_IP_ALIGN );
 
 		/* Increment producer counter and fill level */
-		vmxnet->count.rx_prod++;
-		vmxnet->count.rx_fill++;
+		rx->prod++;
+		rx->fill++;
 
 		/* Store I/O buffer for later completion */
-		vmxnet->rx_iobuf[desc_idx] = iobuf;
+		rx->iobuf[desc_idx] = iobuf;
 
 		/* Populate receive descriptor */
-		rx_desc = &vmxnet->dma->rx_desc[desc_idx];
+		rx_desc = &vmxnet->dma->rx[queue].desc[desc_idx];
 		rx_desc->address = cpu_to_le64 ( virt_to_bus ( iobuf->data ) );
 		rx_desc->flags = ( generation | cpu_to_le32 ( VMXNET3_MTU ) );
 
 	}
 
 	/* Hand over any new descriptors to NIC */
-	if ( vmxnet->count.rx_prod != orig_rx_prod ) {
+	if ( rx->prod != orig_rx_prod ) {
 		wmb();
 		profile_start ( &vmxnet3_vm_refill_profiler );
-		writel ( ( vmxnet->count.rx_prod % VMXNET3_NUM_RX_DESC ),
-			 ( vmxnet->pt + VMXNET3_PT_RXPROD ) );
+		writel ( ( rx->prod % VMXNET3_NUM_RX_DESC ),
+			 ( vmxnet->pt + VMXNET3_PT_RXPROD +
+			   ( queue * VMXNET3_PT_RXPROD_STRIDE ) ) );
 		profile_stop ( &vmxnet3_vm_refill_profiler );
 		profile_exclude ( &vmxnet3_vm_refill_profiler );
 	}
@@ -259,52 +320,69 @@ static void vmxnet3_refill_rx ( struct net_device *netdev ) {
  * Poll for received packets
  *
  * @v netdev		Network device
+ * @v queue		Receive queue index
  */
-static void vmxnet3_poll_rx ( struct net_device *netdev ) {
+static void vmxnet3_poll_rx ( struct net_device *netdev,
+			      unsigned int queue ) {
 	struct vmxnet3_nic *vmxnet = netdev_priv ( netdev );
+	struct vmxnet3_rx *rx = &vmxnet->rx[queue];
 	struct vmxnet3_rx_comp *rx_comp;
 	struct io_buffer *iobuf;
 	unsigned int comp_idx;
 	unsigned int desc_idx;
 	unsigned int generation;
+	uint32_t flags;
 	size_t len;
 
 	while ( 1 ) {
 
 		/* Look for completed descriptors */
-		comp_idx = ( vmxnet->count.rx_cons % VMXNET3_NUM_RX_COMP );
-		generation = ( ( vmxnet->count.rx_cons & VMXNET3_NUM_RX_COMP ) ?
+		comp_idx = ( rx->cons % VMXNET3_NUM_RX_COMP );
+		generation = ( ( rx->cons & VMXNET3_NUM_RX_COMP ) ?
 			       0 : cpu_to_le32 ( VMXNET3_RXCF_GEN ) );
-		rx_comp = &vmxnet->dma->rx_comp[comp_idx];
+		rx_comp = &vmxnet->dma->rx[queue].comp[comp_idx];
 		if ( generation != ( rx_comp->flags &
 				     cpu_to_le32 ( VMXNET3_RXCF_GEN ) ) ) {
 			break;
 		}
 
 		/* Increment consumer counter */
-		vmxnet->count.rx_cons++;
+		rx->cons++;
 
 		/* Locate corresponding receive descriptor */
 		desc_idx = ( le32_to_cpu ( rx_comp->index ) %
 			     VMXNET3_NUM_RX_DESC );
-		iobuf = vmxnet->rx_iobuf[desc_idx];
+		iobuf = rx->iobuf[desc_idx];
 		if ( ! iobuf ) {
 			DBGC ( vmxnet, "VMXNET3 %p completed on empty receive "
-			       "buffer %#x/%#x\n", vmxnet, comp_idx, desc_idx );
+			       "buffer %d:%#x/%#x\n",
+			       vmxnet, queue, comp_idx, desc_idx );
 			netdev_rx_err ( netdev, NULL, -ENOTTY );
 			continue;
 		}
 
 		/* Remove I/O buffer from receive queue */
-		vmxnet->rx_iobuf[desc_idx] = NULL;
-		vmxnet->count.rx_fill--;
+		rx->iobuf[desc_idx] = NULL;
+		rx->fill--;
 
-		/* Deliver packet to network layer */
+		/* Populate I/O buffer */
 		len = ( le32_to_cpu ( rx_comp->len ) &
 			( VMXNET3_MAX_PACKET_LEN - 1 ) );
-		DBGC2 ( vmxnet, "VMXNET3 %p completed RX %#x/%#x (len %#zx)\n",
-			vmxnet, comp_idx, desc_idx, len );
+		DBGC2 ( vmxnet, "VMXNET3 %p completed RX %d:%#x/%#x (len "
+			"%#zx)\n", vmxnet, queue, comp_idx, desc_idx, len );
 		iob_put ( iobuf, len );
+
+		/* Record hardware checksum verification, if applicable */
+		flags = le32_to_cpu ( rx_comp->flags );
+		if ( ( ! ( rx_comp->index &
+			   cpu_to_le32 ( VMXNET3_RXCI_CNC ) ) ) &&
+		     ( flags & VMXNET3_RXCF_TUC ) &&
+		     ( flags & ( VMXNET3_RXCF_TCP | VMXNET3_RXCF_UDP ) ) &&
+		     ! ( flags & VMXNET3_RXCF_FRG ) ) {
+			iobuf->flags |= IOB_CSUM_VERIFIED;
+		}
+
+		/* Deliver packet to network layer */
 		netdev_rx ( netdev, iobuf );
 	}
 }
@@ -316,13 +394,18 @@ static void vmxnet3_poll_rx ( struct net_device *netdev ) {
  */
 static void vmxnet3_flush_rx ( struct net_device *netdev ) {
 	struct vmxnet3_nic *vmxnet = netdev_priv ( netdev );
+	struct vmxnet3_rx *rx;
 	struct io_buffer *iobuf;
+	unsigned int queue;
 	unsigned int i;
 
-	for ( i = 0 ; i < VMXNET3_NUM_RX_DESC ; i++ ) {
-		if ( ( iobuf = vmxnet->rx_iobuf[i] ) != NULL ) {
-			netdev_rx_err ( netdev, iobuf, -ECANCELED );
-			vmxnet->rx_iobuf[i] = NULL;
+	for ( queue = 0 ; queue < VMXNET3_NUM_RX_QUEUES ; queue++ ) {
+		rx = &vmxnet->rx[queue];
+		for ( i = 0 ; i < VMXNET3_NUM_RX_DESC ; i++ ) {
+			if ( ( iobuf = rx->iobuf[i] ) != NULL ) {
+				netdev_rx_err ( netdev, iobuf, -ECANCELED );
+				rx->iobuf[i] = NULL;
+			}
 		}
 	}
 }
@@ -361,7 +444,9 @@ static void vmxnet3_check_link ( struct net_device *netdev ) {
  */
 static void vmxnet3_poll_events ( struct net_device *netdev ) {
 	struct vmxnet3_nic *vmxnet = netdev_priv ( netdev );
+	uint32_t rx_error;
 	uint32_t events;
+	unsigned int queue;
 
 	/* Do nothing unless there are events to process */
 	if ( ! vmxnet->dma->shared.ecr )
@@ -383,10 +468,15 @@ static void vmxnet3_poll_events ( struct net_device *netdev ) {
 	/* Check for queue errors */
 	if ( events & ( VMXNET3_ECR_TQERR | VMXNET3_ECR_RQERR ) ) {
 		vmxnet3_command ( vmxnet, VMXNET3_CMD_GET_QUEUE_STATUS );
+		rx_error = 0;
+		for ( queue = 0 ; queue < vmxnet->rx_queues ; queue++ ) {
+			rx_error |= le32_to_cpu ( vmxnet->dma->queues.rx[queue]
+						  .status.error );
+		}
 		DBGC ( vmxnet, "VMXNET3 %p queue error status (TX %08x, RX "
 		       "%08x)\n", vmxnet,
 		       le32_to_cpu ( vmxnet->dma->queues.tx.status.error ),
-		       le32_to_cpu ( vmxnet->dma->queues.rx.status.error ) );
+		       rx_error );
 		/* Report errors to allow for visibility via "ifstat" */
 		if ( events & VMXNET3_ECR_TQERR )
 			netdev_tx_err ( netdev, NULL, -EPIPE );
@@ -410,11 +500,15 @@ static void vmxnet3_poll_events ( struct net_device *netdev ) {
  * @v netdev		Network device
  */
 static void vmxnet3_poll ( struct net_device *netdev ) {
+	struct vmxnet3_nic *vmxnet = netdev_priv ( netdev );
+	unsigned int queue;
 
 	vmxnet3_poll_events ( netdev );
 	vmxnet3_poll_tx ( netdev );
-	vmxnet3_poll_rx ( netdev );
-	vmxnet3_refill_rx ( netdev );
+	for ( queue = 0 ; queue < vmxnet->rx_queues ; queue++ ) {
+		vmxnet3_poll_rx ( netdev, queue );
+		vmxnet3_refill_rx ( netdev, queue );
+	}
 }
 
 /**
@@ -459,11 +553,25 @@ static int vmxnet3_open ( struct net_device *netdev ) {
 	struct vmxnet3_nic *vmxnet = netdev_priv ( netdev );
 	struct vmxnet3_shared *shared;
 	struct vmxnet3_queues *queues;
+	struct vmxnet3_rx_queue *rx_queue;
+	struct vmxnet3_rss_config *rss;
 	uint64_t shared_bus;
 	uint64_t queues_bus;
+	size_t queues_len;
 	uint32_t status;
+	unsigned int queue;
+	unsigned int i;
 	int rc;
 
+	/* Determine number of receive queues and fill level */
+	vmxnet->rx_queues = netdev_ring_size ( netdev, &rxqueues_setting,
+					       VMXNET3_DEF_RX_QUEUES, 1,
+					       VMXNET3_NUM_RX_QUEUES );
+	vmxnet->rx_fill = netdev_ring_size ( netdev, &rxring_setting,
+					     VMXNET3_RX_FILL,
+					     VMXNET3_MIN_RX_FILL,
+					     VMXNET3_MAX_RX_FILL );
+
 	/* Allocate DMA areas */
 	vmxnet->dma = malloc_dma ( sizeof ( *vmxnet->dma ), VMXNET3_DMA_ALIGN );
 	if ( ! vmxnet->dma ) {
@@ -482,15 +590,20 @@ static int vmxnet3_open ( struct net_device *netdev ) {
 		cpu_to_le64 ( virt_to_bus ( &vmxnet->dma->tx_comp ) );
 	queues->tx.cfg.num_desc = cpu_to_le32 ( VMXNET3_NUM_TX_DESC );
 	queues->tx.cfg.num_comp = cpu_to_le32 ( VMXNET3_NUM_TX_COMP );
-	queues->rx.cfg.desc_address[0] =
-		cpu_to_le64 ( virt_to_bus ( &vmxnet->dma->rx_desc ) );
-	queues->rx.cfg.comp_address =
-		cpu_to_le64 ( virt_to_bus ( &vmxnet->dma->rx_comp ) );
-	queues->rx.cfg.num_desc[0] = cpu_to_le32 ( VMXNET3_NUM_RX_DESC );
-	queues->rx.cfg.num_comp = cpu_to_le32 ( VMXNET3_NUM_RX_COMP );
+	for ( queue = 0 ; queue < vmxnet->rx_queues ; queue++ ) {
+		rx_queue = &queues->rx[queue];
+		rx_queue->cfg.desc_address[0] = cpu_to_le64 (
+			virt_to_bus ( &vmxnet->dma->rx[queue].desc ) );
+		rx_queue->cfg.comp_address = cpu_to_le64 (
+			virt_to_bus ( &vmxnet->dma->rx[queue].comp ) );
+		rx_queue->cfg.num_desc[0] = cpu_to_le32 ( VMXNET3_NUM_RX_DESC );
+		rx_queue->cfg.num_comp = cpu_to_le32 ( VMXNET3_NUM_RX_COMP );
+	}
 	queues_bus = virt_to_bus ( queues );
+	queues_len = ( offsetof ( typeof ( *queues ), rx ) +
+		       ( vmxnet->rx_queues * sizeof ( queues->rx[0] ) ) );
 	DBGC ( vmxnet, "VMXNET3 %p queue descriptors at %08llx+%zx\n",
-	       vmxnet, queues_bus, sizeof ( *queues ) );
+	       vmxnet, queues_bus, queues_len );
 
 	/* Populate shared area */
 	shared = &vmxnet->dma->shared;
@@ -499,11 +612,12 @@ static int vmxnet3_open ( struct net_device *netdev ) {
 	shared->misc.version_support = cpu_to_le32 ( VMXNET3_VERSION_SELECT );
 	shared->misc.upt_version_support =
 		cpu_to_le32 ( VMXNET3_UPT_VERSION_SELECT );
+	shared->misc.upt_features = cpu_to_le64 ( VMXNET3_UPT_F_RXCSUM );
 	shared->misc.queue_desc_address = cpu_to_le64 ( queues_bus );
-	shared->misc.queue_desc_len = cpu_to_le32 ( sizeof ( *queues ) );
+	shared->misc.queue_desc_len = cpu_to_le32 ( queues_len );
 	shared->misc.mtu = cpu_to_le32 ( VMXNET3_MTU );
 	shared->misc.num_tx_queues = 1;
-	shared->misc.num_rx_queues = 1;
+	shared->misc.num_rx_queues = vmxnet->rx_queues;
 	shared->interrupt.num_intrs = 1;
 	shared->interrupt.control = cpu_to_le32 ( VMXNET3_IC_DISABLE_ALL );
 	shared->rx_filter.mode = cpu_to_le32 ( VMXNET3_RXM_UCAST |
@@ -513,8 +627,35 @@ static int vmxnet3_open ( struct net_device *netdev ) {
 	DBGC ( vmxnet, "VMXNET3 %p shared area at %08llx+%zx\n",
 	       vmxnet, shared_bus, sizeof ( *shared ) );
 
+	/* Spread received flows across receive queues, if applicable */
+	if ( vmxnet->rx_queues > 1 ) {
+		rss = &vmxnet->dma->rss;
+		rss->hash_type = cpu_to_le16 ( VMXNET3_RSS_HASH_IPV4 |
+					       VMXNET3_RSS_HASH_TCP_IPV4 |
+					       VMXNET3_RSS_HASH_IPV6 |
+					       VMXNET3_RSS_HASH_TCP_IPV6 );
+		rss->hash_func = cpu_to_le16 ( VMXNET3_RSS_HASH_FUNC_TOEPLITZ );
+		rss->hash_key_len = cpu_to_le16 ( sizeof ( rss->hash_key ) );
+		memcpy ( rss->hash_key, vmxnet3_rss_key,
+			 sizeof ( rss->hash_key ) );
+		rss->ind_table_len = cpu_to_le16 ( VMXNET3_RSS_IND_TABLE_LEN );
+		for ( i = 0 ; i < VMXNET3_RSS_IND_TABLE_LEN ; i++ )
+			rss->ind_table[i] = ( i % vmxnet->rx_queues );
+		shared->misc.upt_features |= cpu_to_le64 ( VMXNET3_UPT_F_RSS );
+		shared->rss.version = cpu_to_le32 ( VMXNET3_RSS_VERSION );
+		shared->rss.length = cpu_to_le32 ( sizeof ( *rss ) );
+		shared->rss.address = cpu_to_le64 ( virt_to_bus ( rss ) );
+	}
+	DBGC ( vmxnet, "VMXNET3 %p using %d receive queue(s) with fill "
+	       "level %d\n", vmxnet, vmxnet->rx_queues, vmxnet->rx_fill );
+
 	/* Zero counters */
 	memset ( &vmxnet->count, 0, sizeof ( vmxnet->count ) );
+	for ( queue = 0 ; queue < VMXNET3_NUM_RX_QUEUES ; queue++ ) {
+		vmxnet->rx[queue].prod = 0;
+		vmxnet->rx[queue].fill = 0;
+		vmxnet->rx[queue].cons = 0;
+	}
 
 	/* Set MAC address */
 	vmxnet3_set_ll_addr ( vmxnet, &netdev->ll_addr );
@@ -532,8 +673,9 @@ static int vmxnet3_open ( struct net_device *netdev ) {
 		goto err_activate;
 	}
 
-	/* Fill receive ring */
-	vmxnet3_refill_rx ( netdev );
+	/* Fill receive rings */
+	for ( queue = 0 ; queue < vmxnet->rx_queues ; queue++ )
+		vmxnet3_refill_rx ( netdev, queue );
 
 	return 0;
 
@@ -665,6 +807,10 @@ static int vmxnet3_probe ( struct pci_device *pci ) {
 	/* Read initial MAC address */
 	vmxnet3_get_hw_addr ( vmxnet, &netdev->hw_addr );
 
+	/* Record transmit offload capabilities */
+	netdev->offload = ( NETDEV_TX_CSUM | NETDEV_TX_TSO4 | NETDEV_TX_TSO6 );
+	netdev->tso_max_len = VMXNET3_TSO_MAX_LEN;
+
 	/* Register network device */
 	if ( ( rc = register_netdev ( netdev ) ) != 0 ) {
 		DBGC ( vmxnet, "VMXNET3 %p could not register net device: "
@@ -65,6 +65,9 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 /** Rx producer index for ring 2 */
 #define VMXNET3_PT_RXPROD2 0xa00
 
+/** Spacing between per-queue Rx producer index registers */
+#define VMXNET3_PT_RXPROD_STRIDE 0x8
+
 /** "VD" PCI BAR address */
 #define VMXNET3_VD_BAR PCI_BASE_ADDRESS_1
 
@@ -205,6 +208,48 @@ enum vmxnet3_rx_filter_mode {
 	VMXNET3_RXM_PROMISC	= 0x10,  /**< Promiscuous */
 };
 
+/** RSS hash key length */
+#define VMXNET3_RSS_KEY_LEN 40
+
+/** Maximum RSS indirection table length */
+#define VMXNET3_RSS_MAX_IND_TABLE_LEN 128
+
+/** RSS configuration */
+struct vmxnet3_rss_config {
+	/** Hash types */
+	uint16_t hash_type;
+	/** Hash function */
+	uint16_t hash_func;
+	/** Hash key length */
+	uint16_t hash_key_len;
+	/** Indirection table length */
+	uint16_t ind_table_len;
+	/** Hash key */
+	uint8_t hash_key[VMXNET3_RSS_KEY_LEN];
+	/** Indirection table */
+	uint8_t ind_table[VMXNET3_RSS_MAX_IND_TABLE_LEN];
+} __attribute__ (( packed ));
+
+/** RSS hash types */
+enum vmxnet3_rss_hash_type {
+	VMXNET3_RSS_HASH_IPV4		= 0x01,	/**< IPv4 addresses */
+	VMXNET3_RSS_HASH_TCP_IPV4	= 0x02,	/**< IPv4 addresses and ports */
+	VMXNET3_RSS_HASH_IPV6		= 0x04,	/**< IPv6 addresses */
+	VMXNET3_RSS_HASH_TCP_IPV6	= 0x08,	/**< IPv6 addresses and ports */
+};
+
+/** RSS Toeplitz hash function */
+#define VMXNET3_RSS_HASH_FUNC_TOEPLITZ 0x01
+
+/** RSS indirection table length
+ *
+ * We use four entries per queue, to allow for an even spread.
+ */
+#define VMXNET3_RSS_IND_TABLE_LEN ( 4 * VMXNET3_NUM_RX_QUEUES )
+
+/** RSS configuration version */
+#define VMXNET3_RSS_VERSION 1
+
 /** Variable-length configuration descriptor */
 struct vmxnet3_variable_config {
 	uint32_t version;
@@ -253,6 +298,18 @@ struct vmxnet3_tx_desc {
 /** Transmit generation flag */
 #define VMXNET3_TXF_GEN 0x00004000UL
 
+/** Transmit checksum offset or maximum segment size */
+#define VMXNET3_TXF_MSSCOF( msscof ) ( (msscof) << 18 )
+
+/** Transmit header length */
+#define VMXNET3_TXF_HLEN( hlen ) ( (hlen) << 0 )
+
+/** Transmit checksum offload mode */
+#define VMXNET3_TXF_OM_CSUM 0x000000800UL
+
+/** Transmit segmentation offload mode */
+#define VMXNET3_TXF_OM_TSO 0x000000c00UL
+
 /** Transmit end-of-packet flag */
 #define VMXNET3_TXF_EOP 0x000001000UL
 
@@ -336,6 +393,21 @@ struct vmxnet3_rx_comp {
 	uint32_t flags;
 } __attribute__ (( packed ));
 
+/** Receive completion checksum not calculated */
+#define VMXNET3_RXCI_CNC 0x40000000UL
+
+/** Receive completion TCP/UDP checksum correct */
+#define VMXNET3_RXCF_TUC 0x00010000UL
+
+/** Receive completion is UDP */
+#define VMXNET3_RXCF_UDP 0x00020000UL
+
+/** Receive completion is TCP */
+#define VMXNET3_RXCF_TCP 0x00040000UL
+
+/** Receive completion is an IP fragment */
+#define VMXNET3_RXCF_FRG 0x00400000UL
+
 /** Receive completion generation flag */
 #define VMXNET3_RXCF_GEN 0x80000000UL
 
@@ -399,16 +471,27 @@ struct vmxnet3_rx_queue {
 	uint8_t reserved[88];
 } __attribute__ (( packed ));
 
+/** Maximum number of RX queues that we use */
+#define VMXNET3_NUM_RX_QUEUES 8
+
+/** Default number of RX queues
+ *
+ * This may be overridden at runtime via the "rxqueues" setting.
+ */
+#define VMXNET3_DEF_RX_QUEUES 4
+
 /**
  * Queue descriptor set
  *
- * We use only a single TX and RX queue
+ * We use only a single TX queue, and up to VMXNET3_NUM_RX_QUEUES RX
+ * queues.  Only the descriptors for the RX queues in use are passed
+ * to the device.
  */
 struct vmxnet3_queues {
 	/** Transmit queue descriptor(s) */
 	struct vmxnet3_tx_queue tx;
 	/** Receive queue descriptor(s) */
-	struct vmxnet3_rx_queue rx;
+	struct vmxnet3_rx_queue rx[VMXNET3_NUM_RX_QUEUES];
 } __attribute__ (( packed ));
 
 /** Alignment of queue descriptor set */
@@ -423,11 +506,19 @@ struct vmxnet3_queues {
 /** Number of TX completion descriptors */
 #define VMXNET3_NUM_TX_COMP 32
 
-/** Number of RX descriptors */
-#define VMXNET3_NUM_RX_DESC 32
+/** Number of RX descriptors (per queue) */
+#define VMXNET3_NUM_RX_DESC 64
 
-/** Number of RX completion descriptors */
-#define VMXNET3_NUM_RX_COMP 32
+/** Number of RX completion descriptors (per queue) */
+#define VMXNET3_NUM_RX_COMP 64
+
+/** RX rings for a single queue */
+struct vmxnet3_rx_rings {
+	/** RX descriptor ring */
+	struct vmxnet3_rx_desc desc[VMXNET3_NUM_RX_DESC];
+	/** RX completion ring */
+	struct vmxnet3_rx_comp comp[VMXNET3_NUM_RX_COMP];
+} __attribute__ (( packed ));
 
 /**
  * DMA areas
@@ -440,14 +531,14 @@ struct vmxnet3_dma {
 	struct vmxnet3_tx_desc tx_desc[VMXNET3_NUM_TX_DESC];
 	/** TX completion ring */
 	struct vmxnet3_tx_comp tx_comp[VMXNET3_NUM_TX_COMP];
-	/** RX descriptor ring */
-	struct vmxnet3_rx_desc rx_desc[VMXNET3_NUM_RX_DESC];
-	/** RX completion ring */
-	struct vmxnet3_rx_comp rx_comp[VMXNET3_NUM_RX_COMP];
+	/** RX rings */
+	struct vmxnet3_rx_rings rx[VMXNET3_NUM_RX_QUEUES];
 	/** Queue descriptors */
 	struct vmxnet3_queues queues;
 	/** Shared area */
 	struct vmxnet3_shared shared;
+	/** RSS configuration */
+	struct vmxnet3_rss_config rss;
 } __attribute__ (( packed ));
 
 /** DMA area alignment */
@@ -459,12 +550,18 @@ struct vmxnet3_counters {
 	unsigned int tx_prod;
 	/** Transmit completion consumer counter */
 	unsigned int tx_cons;
+};
+
+/** A vmxnet3 receive queue */
+struct vmxnet3_rx {
 	/** Receive producer counter */
-	unsigned int rx_prod;
+	unsigned int prod;
 	/** Receive fill level */
-	unsigned int rx_fill;
+	unsigned int fill;
 	/** Receive consumer counter */
-	unsigned int rx_cons;
+	unsigned int cons;
+	/** Receive I/O buffers */
+	struct io_buffer *iobuf[VMXNET3_NUM_RX_DESC];
 };
 
 /** A vmxnet3 NIC */
@@ -480,8 +577,12 @@ struct vmxnet3_nic {
 	struct vmxnet3_counters count;
 	/** Transmit I/O buffers */
 	struct io_buffer *tx_iobuf[VMXNET3_NUM_TX_DESC];
-	/** Receive I/O buffers */
-	struct io_buffer *rx_iobuf[VMXNET3_NUM_RX_DESC];
+	/** Receive queues */
+	struct vmxnet3_rx rx[VMXNET3_NUM_RX_QUEUES];
+	/** Number of receive queues in use */
+	unsigned int rx_queues;
+	/** Receive ring fill level (per queue) */
+	unsigned int rx_fill;
 };
 
 /** vmxnet3 version that we support */
@@ -490,14 +591,38 @@ struct vmxnet3_nic {
 /** UPT version that we support */
 #define VMXNET3_UPT_VERSION_SELECT 1
 
+/** UPT receive checksum offload feature */
+#define VMXNET3_UPT_F_RXCSUM 0x0001ULL
+
+/** UPT receive-side scaling feature */
+#define VMXNET3_UPT_F_RSS 0x0002ULL
+
+/** Maximum transmit segmentation offload packet length
+ *
+ * This is limited by the size of a single transmit descriptor.
+ */
+#define VMXNET3_TSO_MAX_LEN ( VMXNET3_MAX_PACKET_LEN - 1 )
+
 /** MTU size */
 #define VMXNET3_MTU ( ETH_FRAME_LEN + 4 /* VLAN */ + 4 /* FCS */ )
 
 /** Transmit ring maximum fill level */
 #define VMXNET3_TX_FILL ( VMXNET3_NUM_TX_DESC - 1 )
 
-/** Receive ring maximum fill level */
-#define VMXNET3_RX_FILL 8
+/** Default receive ring fill level (per queue)
+ *
+ * This may be overridden at runtime via the "rxring" setting.
+ */
+#define VMXNET3_RX_FILL 16
+
+/** Minimum receive ring fill level */
+#define VMXNET3_MIN_RX_FILL 1
+
+/** Maximum receive ring fill level
+ *
+ * This must be less than the ring size, and a power of two.
+ */
+#define VMXNET3_MAX_RX_FILL ( VMXNET3_NUM_RX_DESC / 2 )
 
 /** Received packet alignment padding */
 #define NET_IP_ALIGN 2
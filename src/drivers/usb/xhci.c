@@ -60,6 +60,14 @@ static struct profiler xhci_event_profiler __profiler =
 static struct profiler xhci_transfer_profiler __profiler =
 	{ .name = "xhci.transfer" };
 
+/** Events per poll profiler */
+static struct profiler xhci_events_profiler __profiler =
+	{ .name = "xhci.events" };
+
+/** Transfers per doorbell profiler */
+static struct profiler xhci_doorbell_profiler __profiler =
+	{ .name = "xhci.doorbell" };
+
 /* Disambiguate the various error causes */
 #define EIO_DATA							\
 	__einfo_error ( EINFO_EIO_DATA )
@@ -1399,6 +1407,59 @@ xhci_doorbell ( struct xhci_trb_ring *ring ) {
 	writel ( ring->dbval, ring->db );
 }
 
+/**
+ * Ring endpoint doorbell register
+ *
+ * @v endpoint		Endpoint
+ *
+ * Any deferred doorbell for this endpoint is cancelled.
+ */
+static void xhci_endpoint_doorbell ( struct xhci_endpoint *endpoint ) {
+
+	/* Remove from deferred doorbell list, if applicable */
+	if ( endpoint->deferred ) {
+		profile_custom ( &xhci_doorbell_profiler, endpoint->deferred );
+		list_del ( &endpoint->doorbell );
+		endpoint->deferred = 0;
+	}
+
+	/* Ring doorbell */
+	xhci_doorbell ( &endpoint->ring );
+}
+
+/**
+ * Defer ringing endpoint doorbell register
+ *
+ * @v endpoint		Endpoint
+ *
+ * The doorbell will be rung on the next bus poll, or immediately if
+ * the batch limit has been reached.
+ */
+static void xhci_endpoint_defer ( struct xhci_endpoint *endpoint ) {
+	struct xhci_device *xhci = endpoint->xhci;
+
+	/* Add to deferred doorbell list, if applicable */
+	if ( ! endpoint->deferred++ )
+		list_add_tail ( &endpoint->doorbell, &xhci->doorbells );
+
+	/* Ring doorbell if batch is complete */
+	if ( endpoint->deferred >= XHCI_DOORBELL_BATCH )
+		xhci_endpoint_doorbell ( endpoint );
+}
+
+/**
+ * Ring all deferred doorbell registers
+ *
+ * @v xhci		xHCI device
+ */
+static void xhci_doorbells ( struct xhci_device *xhci ) {
+	struct xhci_endpoint *endpoint;
+	struct xhci_endpoint *tmp;
+
+	list_for_each_entry_safe ( endpoint, tmp, &xhci->doorbells, doorbell )
+		xhci_endpoint_doorbell ( endpoint );
+}
+
 /******************************************************************************
  *
  * Command and event rings
@@ -1748,6 +1809,7 @@ static void xhci_event_poll ( struct xhci_device *xhci ) {
 		xhci_writeq ( xhci, virt_to_phys ( trb ),
 			      xhci->run + XHCI_RUN_ERDP ( 0 ) );
 		profile_stop ( &xhci_event_profiler );
+		profile_custom ( &xhci_events_profiler, consumed );
 	}
 }
 
@@ -2418,6 +2480,10 @@ static void xhci_endpoint_close ( struct usb_endpoint *ep ) {
 	struct io_buffer *iobuf;
 	unsigned int ctx = endpoint->ctx;
 
+	/* Cancel any deferred doorbell */
+	if ( endpoint->deferred )
+		list_del ( &endpoint->doorbell );
+
 	/* Deconfigure endpoint, if applicable */
 	if ( ctx != XHCI_CTX_EP0 )
 		xhci_deconfigure_endpoint ( xhci, slot, endpoint );
@@ -2455,7 +2521,7 @@ static int xhci_endpoint_reset ( struct usb_endpoint *ep ) {
 		return rc;
 
 	/* Ring doorbell to resume processing */
-	xhci_doorbell ( &endpoint->ring );
+	xhci_endpoint_doorbell ( endpoint );
 
 	DBGC ( xhci, "XHCI %s slot %d ctx %d reset\n",
 	       xhci->name, slot->id, endpoint->ctx );
@@ -2542,7 +2608,7 @@ static int xhci_endpoint_message ( struct usb_endpoint *ep,
 		return rc;
 
 	/* Ring the doorbell */
-	xhci_doorbell ( &endpoint->ring );
+	xhci_endpoint_doorbell ( endpoint );
 
 	profile_stop ( &xhci_message_profiler );
 	return 0;
@@ -2585,6 +2651,7 @@ static int xhci_endpoint_stream ( struct usb_endpoint *ep,
 	union xhci_trb trbs[count];
 	union xhci_trb *trb = trbs;
 	struct xhci_trb_normal *normal;
+	unsigned int idle;
 	unsigned int i;
 	size_t trb_len;
 	int rc;
@@ -2622,12 +2689,20 @@ static int xhci_endpoint_stream ( struct usb_endpoint *ep,
 	trb[-1].normal.flags = XHCI_TRB_IOC;
 
 	/* Enqueue TRBs */
+	idle = ( xhci_ring_fill ( &endpoint->ring ) == 0 );
 	if ( ( rc = xhci_enqueue_multi ( &endpoint->ring, iobuf, trbs,
 					 count ) ) != 0 )
 		return rc;
 
-	/* Ring the doorbell */
-	xhci_doorbell ( &endpoint->ring );
+	/* Ring the doorbell immediately if the endpoint was idle, to
+	 * minimise latency.  Otherwise, defer the doorbell so that
+	 * subsequent transfers may be submitted as a single batch.
+	 */
+	if ( idle ) {
+		xhci_endpoint_doorbell ( endpoint );
+	} else {
+		xhci_endpoint_defer ( endpoint );
+	}
 
 	profile_stop ( &xhci_stream_profiler );
 	return 0;
@@ -2881,6 +2956,9 @@ static void xhci_bus_close ( struct usb_bus *bus ) {
 static void xhci_bus_poll ( struct usb_bus *bus ) {
 	struct xhci_device *xhci = usb_bus_get_hostdata ( bus );
 
+	/* Ring any deferred doorbells */
+	xhci_doorbells ( xhci );
+
 	/* Poll event ring */
 	xhci_event_poll ( xhci );
 }
@@ -3246,6 +3324,7 @@ static int xhci_probe ( struct pci_device *pci ) {
 	}
 	xhci->name = pci->dev.name;
 	xhci->quirks = pci->id->driver_data;
+	INIT_LIST_HEAD ( &xhci->doorbells );
 
 	/* Fix up PCI device */
 	adjust_pci_device ( pci );
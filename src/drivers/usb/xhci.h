@@ -963,13 +963,22 @@ xhci_ring_consumed ( struct xhci_trb_ring *ring ) {
  *
  * This is a policy decision.
  */
-#define XHCI_EVENT_TRBS_LOG2 6
+#define XHCI_EVENT_TRBS_LOG2 8
 
 /** Number of TRBs in a transfer ring
  *
- * This is a policy decision.
+ * This is a policy decision.  The ring (including the Link TRB) must
+ * not cross a page boundary.
+ */
+#define XHCI_TRANSFER_TRBS_LOG2 7
+
+/** Maximum number of stream transfers enqueued before ringing doorbell
+ *
+ * Doorbells for stream transfers are deferred until the next bus
+ * poll, to allow many transfers to be submitted with a single
+ * doorbell write.  This is a policy decision.
  */
-#define XHCI_TRANSFER_TRBS_LOG2 6
+#define XHCI_DOORBELL_BATCH 16
 
 /** Maximum time to wait for BIOS to release ownership
  *
@@ -1090,6 +1099,8 @@ struct xhci_device {
 	struct xhci_event_ring event;
 	/** Current command (if any) */
 	union xhci_trb *pending;
+	/** Endpoints with deferred doorbells */
+	struct list_head doorbells;
 
 	/** Device slots, indexed by slot ID */
 	struct xhci_slot **slot;
@@ -1145,6 +1156,10 @@ struct xhci_endpoint {
 	struct xhci_endpoint_context *context;
 	/** Transfer ring */
 	struct xhci_trb_ring ring;
+	/** Deferred doorbell list */
+	struct list_head doorbell;
+	/** Number of transfers enqueued since doorbell was last rung */
+	unsigned int deferred;
 };
 
 #endif /* _IPXE_XHCI_H */
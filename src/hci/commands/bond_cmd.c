@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <ipxe/netdevice.h>
+#include <ipxe/command.h>
+#include <ipxe/parseopt.h>
+#include <ipxe/bond.h>
+
+/** @file
+ *
+ * Link aggregation commands
+ *
+ */
+
+/** "bondcreate" options */
+struct bondcreate_options {};
+
+/** "bondcreate" option list */
+static struct option_descriptor bondcreate_opts[] = {};
+
+/** "bondcreate" command descriptor */
+static struct command_descriptor bondcreate_cmd =
+	COMMAND_DESC ( struct bondcreate_options, bondcreate_opts,
+		       1, BOND_MAX_MEMBERS, "<member interface>..." );
+
+/**
+ * "bondcreate" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int bondcreate_exec ( int argc, char **argv ) {
+	struct bondcreate_options opts;
+	struct net_device *members[BOND_MAX_MEMBERS];
+	unsigned int count;
+	unsigned int i;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &bondcreate_cmd,
+				    &opts ) ) != 0 )
+		return rc;
+
+	/* Parse member interfaces */
+	count = ( argc - optind );
+	for ( i = 0 ; i < count ; i++ ) {
+		if ( ( rc = parse_netdev ( argv[ optind + i ],
+					   &members[i] ) ) != 0 )
+			return rc;
+	}
+
+	/* Create bonded device */
+	if ( ( rc = bond_create ( members, count ) ) != 0 ) {
+		printf ( "Could not create bonded device: %s\n",
+			 strerror ( rc ) );
+		return rc;
+	}
+
+	return 0;
+}
+
+/** "bonddestroy" options */
+struct bonddestroy_options {};
+
+/** "bonddestroy" option list */
+static struct option_descriptor bonddestroy_opts[] = {};
+
+/** "bonddestroy" command descriptor */
+static struct command_descriptor bonddestroy_cmd =
+	COMMAND_DESC ( struct bonddestroy_options, bonddestroy_opts, 1, 1,
+		       "<bonded interface>" );
+
+/**
+ * "bonddestroy" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int bonddestroy_exec ( int argc, char **argv ) {
+	struct bonddestroy_options opts;
+	struct net_device *netdev;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &bonddestroy_cmd,
+				    &opts ) ) != 0 )
+		return rc;
+
+	/* Parse bonded interface */
+	if ( ( rc = parse_netdev ( argv[optind], &netdev ) ) != 0 )
+		return rc;
+
+	/* Destroy bonded device */
+	if ( ( rc = bond_destroy ( netdev ) ) != 0 ) {
+		printf ( "Could not destroy bonded device: %s\n",
+			 strerror ( rc ) );
+		return rc;
+	}
+
+	return 0;
+}
+
+/** Link aggregation commands */
+struct command bond_commands[] __command = {
+	{
+		.name = "bondcreate",
+		.exec = bondcreate_exec,
+	},
+	{
+		.name = "bonddestroy",
+		.exec = bonddestroy_exec,
+	},
+};
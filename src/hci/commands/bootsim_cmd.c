@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <ipxe/command.h>
+#include <ipxe/parseopt.h>
+#include <ipxe/uri.h>
+#include <usr/bootsim.h>
+
+/** @file
+ *
+ * Boot simulation commands
+ *
+ */
+
+/** "bootsim" options */
+struct bootsim_options {
+	/** Inactivity timeout */
+	unsigned long timeout;
+};
+
+/** "bootsim" option list */
+static struct option_descriptor bootsim_opts[] = {
+	OPTION_DESC ( "timeout", 't', required_argument,
+		      struct bootsim_options, timeout, parse_timeout ),
+};
+
+/** "bootsim" command descriptor */
+static struct command_descriptor bootsim_cmd =
+	COMMAND_DESC ( struct bootsim_options, bootsim_opts, 0, 1,
+		       "[<uri>]" );
+
+/**
+ * "bootsim" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int bootsim_exec ( int argc, char **argv ) {
+	struct bootsim_options opts;
+	struct uri *uri = NULL;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &bootsim_cmd, &opts ) ) != 0 )
+		goto err_parse_options;
+
+	/* Parse URI, if present */
+	if ( optind < argc ) {
+		uri = parse_uri ( argv[optind] );
+		if ( ! uri ) {
+			rc = -ENOMEM;
+			goto err_parse_uri;
+		}
+	}
+
+	/* Simulate boot of all network devices */
+	if ( ( rc = bootsim ( uri, opts.timeout ) ) != 0 ) {
+		printf ( "Simulation failed: %s\n", strerror ( rc ) );
+		goto err_bootsim;
+	}
+
+ err_bootsim:
+	uri_put ( uri );
+ err_parse_uri:
+ err_parse_options:
+	return rc;
+}
+
+/** Boot simulation commands */
+struct command bootsim_command __command = {
+	.name = "bootsim",
+	.exec = bootsim_exec,
+};
@@ -195,6 +195,8 @@ static int ifstat_exec ( int argc, char **argv ) {
 struct ifconf_options {
 	/** Configurator */
 	struct net_device_configurator *configurator;
+	/** Configure interfaces concurrently */
+	int parallel;
 };
 
 /** "ifconf" option list */
@@ -202,6 +204,8 @@ static struct option_descriptor ifconf_opts[] = {
 	OPTION_DESC ( "configurator", 'c', required_argument,
 		      struct ifconf_options, configurator,
 		      parse_netdev_configurator ),
+	OPTION_DESC ( "parallel", 'p', no_argument,
+		      struct ifconf_options, parallel, parse_flag ),
 };
 
 /**
@@ -241,7 +245,33 @@ static struct ifcommon_command_descriptor ifconf_cmd =
  * @ret rc		Return status code
  */
 int ifconf_exec ( int argc, char **argv ) {
-	return ifcommon_exec ( argc, argv, &ifconf_cmd );
+	struct ifconf_options opts;
+	struct net_device *netdev;
+	int i;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &ifconf_cmd.cmd,
+				    &opts ) ) != 0 )
+		return rc;
+
+	/* Configure interfaces one at a time, unless requested otherwise */
+	if ( ! opts.parallel )
+		return ifcommon_exec ( argc, argv, &ifconf_cmd );
+
+	/* Open specified interfaces, or all interfaces */
+	if ( optind != argc ) {
+		for ( i = optind ; i < argc ; i++ ) {
+			if ( parse_netdev ( argv[i], &netdev ) == 0 )
+				ifopen ( netdev );
+		}
+	} else {
+		for_each_netdev ( netdev )
+			ifopen ( netdev );
+	}
+
+	/* Configure all open interfaces concurrently */
+	return ifconf_parallel ( opts.configurator, &netdev );
 }
 
 /** Interface management commands */
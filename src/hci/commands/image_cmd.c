@@ -29,6 +29,9 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <errno.h>
 #include <getopt.h>
 #include <ipxe/image.h>
+#include <ipxe/uri.h>
+#include <ipxe/sha256.h>
+#include <ipxe/base16.h>
 #include <ipxe/command.h>
 #include <ipxe/parseopt.h>
 #include <ipxe/shell.h>
@@ -40,6 +43,14 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  *
  */
 
+/* Disambiguate the various error causes */
+#define EINVAL_DIGEST __einfo_error ( EINFO_EINVAL_DIGEST )
+#define EINFO_EINVAL_DIGEST \
+	__einfo_uniqify ( EINFO_EINVAL, 0x01, "Invalid SHA-256 digest" )
+#define EINVAL_BACKGROUND __einfo_error ( EINFO_EINVAL_BACKGROUND )
+#define EINFO_EINVAL_BACKGROUND \
+	__einfo_uniqify ( EINFO_EINVAL, 0x02, "Cannot verify in background" )
+
 /** "img{single}" options */
 struct imgsingle_options {
 	/** Image name */
@@ -50,6 +61,10 @@ struct imgsingle_options {
 	int replace;
 	/** Free image after execution */
 	int autofree;
+	/** Download image in background */
+	int background;
+	/** Expected SHA-256 digest */
+	char *sha256;
 };
 
 /** "img{single}" option list */
@@ -73,6 +88,20 @@ static union {
 	},
 };
 
+/** "imgfetch" option list */
+static struct option_descriptor imgfetch_opts[] = {
+	OPTION_DESC ( "name", 'n', required_argument,
+		      struct imgsingle_options, name, parse_string ),
+	OPTION_DESC ( "timeout", 't', required_argument,
+		      struct imgsingle_options, timeout, parse_timeout),
+	OPTION_DESC ( "autofree", 'a', no_argument,
+		      struct imgsingle_options, autofree, parse_flag ),
+	OPTION_DESC ( "background", 'b', no_argument,
+		      struct imgsingle_options, background, parse_flag ),
+	OPTION_DESC ( "sha256", 's', required_argument,
+		      struct imgsingle_options, sha256, parse_string ),
+};
+
 /** An "img{single}" family command descriptor */
 struct imgsingle_descriptor {
 	/** Command descriptor */
@@ -89,6 +118,42 @@ struct imgsingle_descriptor {
 	const char *verb;
 };
 
+/**
+ * Download an image with an expected SHA-256 digest
+ *
+ * @v uri_string	URI string
+ * @v timeout		Download timeout
+ * @v sha256		Expected SHA-256 digest (as a hex string)
+ * @v image		Image to fill in
+ * @ret rc		Return status code
+ */
+static int imgdownload_sha256 ( const char *uri_string, unsigned long timeout,
+				const char *sha256, struct image **image ) {
+	struct sha256_digest digest;
+	struct uri *uri;
+	int len;
+	int rc;
+
+	/* Parse digest */
+	len = base16_decode ( sha256, &digest, sizeof ( digest ) );
+	if ( len != ( ( int ) sizeof ( digest ) ) ) {
+		printf ( "\"%s\": invalid SHA-256 digest\n", sha256 );
+		return -EINVAL_DIGEST;
+	}
+
+	/* Parse URI */
+	uri = parse_uri ( uri_string );
+	if ( ! uri )
+		return -ENOMEM;
+
+	/* Download image */
+	rc = imgdownload_digest ( uri, timeout, &sha256_algorithm, &digest,
+				  image );
+
+	uri_put ( uri );
+	return rc;
+}
+
 /**
  * The "img{single}" family of commands
  *
@@ -104,6 +169,8 @@ static int imgsingle_exec ( int argc, char **argv,
 	struct imgsingle_options opts;
 	char *name_uri = NULL;
 	char *cmdline = NULL;
+	int ( * acquire ) ( const char *name, unsigned long timeout,
+			    struct image **image );
 	struct image *image;
 	int rc;
 
@@ -124,9 +191,18 @@ static int imgsingle_exec ( int argc, char **argv,
 	}
 
 	/* Acquire the image */
-	if ( name_uri ) {
-		if ( ( rc = desc->acquire ( name_uri, opts.timeout,
-					    &image ) ) != 0 )
+	if ( name_uri && opts.sha256 ) {
+		if ( opts.background ) {
+			printf ( "Cannot verify background download\n" );
+			rc = -EINVAL_BACKGROUND;
+			goto err_acquire;
+		}
+		if ( ( rc = imgdownload_sha256 ( name_uri, opts.timeout,
+						 opts.sha256, &image ) ) != 0 )
+			goto err_acquire;
+	} else if ( name_uri ) {
+		acquire = ( opts.background ? imgprefetch : desc->acquire );
+		if ( ( rc = acquire ( name_uri, opts.timeout, &image ) ) != 0 )
 			goto err_acquire;
 	} else {
 		image = image_find_selected();
@@ -186,7 +262,7 @@ static int imgsingle_exec ( int argc, char **argv,
 
 /** "imgfetch" command descriptor */
 static struct command_descriptor imgfetch_cmd =
-	COMMAND_DESC ( struct imgsingle_options, opts.imgsingle,
+	COMMAND_DESC ( struct imgsingle_options, imgfetch_opts,
 		       1, MAX_ARGUMENTS, "<uri> [<arguments>...]" );
 
 /** "imgfetch" family command descriptor */
@@ -206,6 +282,75 @@ static int imgfetch_exec ( int argc, char **argv ) {
 	return imgsingle_exec ( argc, argv, &imgfetch_desc );
 }
 
+/** "imgfetchall" options */
+struct imgfetchall_options {
+	/** Download timeout */
+	unsigned long timeout;
+};
+
+/** "imgfetchall" option list */
+static struct option_descriptor imgfetchall_opts[] = {
+	OPTION_DESC ( "timeout", 't', required_argument,
+		      struct imgfetchall_options, timeout, parse_timeout ),
+};
+
+/** "imgfetchall" command descriptor */
+static struct command_descriptor imgfetchall_cmd =
+	COMMAND_DESC ( struct imgfetchall_options, imgfetchall_opts,
+		       1, MAX_ARGUMENTS, "<uri> [<uri>...]" );
+
+/**
+ * The "imgfetchall" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int imgfetchall_exec ( int argc, char **argv ) {
+	struct imgfetchall_options opts;
+	struct uri **uris;
+	unsigned int count;
+	unsigned int i;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &imgfetchall_cmd,
+				    &opts ) ) != 0 )
+		goto err_parse_options;
+
+	/* Allocate URI list */
+	count = ( argc - optind );
+	uris = zalloc ( count * sizeof ( uris[0] ) );
+	if ( ! uris ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+
+	/* Parse URIs */
+	for ( i = 0 ; i < count ; i++ ) {
+		uris[i] = parse_uri ( argv[ optind + i ] );
+		if ( ! uris[i] ) {
+			rc = -ENOMEM;
+			goto err_parse_uri;
+		}
+	}
+
+	/* Download images */
+	if ( ( rc = imgdownloads ( uris, count, opts.timeout ) ) != 0 ) {
+		printf ( "Could not download: %s\n", strerror ( rc ) );
+		goto err_download;
+	}
+
+ err_download:
+ err_parse_uri:
+	for ( i = 0 ; i < count ; i++ )
+		uri_put ( uris[i] );
+	free ( uris );
+ err_alloc:
+ err_parse_options:
+	return rc;
+}
+
 /**
  * "imgselect" command action
  *
@@ -257,6 +402,10 @@ static struct command_descriptor imgexec_cmd =
 static int imgexec ( struct image *image, struct imgsingle_options *opts ) {
 	int rc;
 
+	/* Wait for any background downloads (e.g. initrds) */
+	if ( ( rc = imgprefetch_wait ( NULL, opts->timeout ) ) != 0 )
+		return rc;
+
 	/* Perform replacement or execution as applicable */
 	if ( opts->replace ) {
 
@@ -352,6 +501,8 @@ static int imgmulti_exec ( int argc, char **argv,
 
 	/* If no images are explicitly specified, process all images */
 	if ( optind == argc ) {
+		if ( ( rc = imgprefetch_wait ( NULL, 0 ) ) != 0 )
+			return rc;
 		for_each_image_safe ( image, tmp )
 			payload ( image );
 		return 0;
@@ -359,6 +510,8 @@ static int imgmulti_exec ( int argc, char **argv,
 
 	/* Otherwise, process specified images */
 	for ( i = optind ; i < argc ; i++ ) {
+		if ( ( rc = imgprefetch_wait ( argv[i], 0 ) ) != 0 )
+			return rc;
 		image = find_image ( argv[i] );
 		if ( ! image ) {
 			printf ( "\"%s\": no such image\n", argv[i] );
@@ -406,6 +559,10 @@ struct command image_commands[] __command = {
 		.name = "initrd",
 		.exec = imgfetch_exec, /* synonym for "imgfetch" */
 	},
+	{
+		.name = "imgfetchall",
+		.exec = imgfetchall_exec,
+	},
 	{
 		.name = "kernel",
 		.exec = imgselect_exec, /* synonym for "imgselect" */
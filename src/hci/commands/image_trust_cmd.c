@@ -106,8 +106,8 @@ static struct option_descriptor imgverify_opts[] = {
 
 /** "imgverify" command descriptor */
 static struct command_descriptor imgverify_cmd =
-	COMMAND_DESC ( struct imgverify_options, imgverify_opts, 2, 2,
-		       "<uri|image> <signature uri|image>" );
+	COMMAND_DESC ( struct imgverify_options, imgverify_opts, 1, 2,
+		       "<uri|image> [<signature uri|image>]" );
 
 /**
  * The "imgverify" command
@@ -131,13 +131,22 @@ static int imgverify_exec ( int argc, char **argv ) {
 	/* Parse image name/URI string */
 	image_name_uri = argv[optind];
 
-	/* Parse signature name/URI string */
+	/* Parse signature name/URI string, if present */
 	signature_name_uri = argv[ optind + 1 ];
 
 	/* Acquire the image */
 	if ( ( rc = imgacquire ( image_name_uri, opts.timeout, &image ) ) != 0 )
 		goto err_acquire_image;
 
+	/* Verify image using signed manifest, if no signature is given */
+	if ( ! signature_name_uri ) {
+		if ( ( rc = imgverify_manifest ( image ) ) != 0 ) {
+			printf ( "Could not verify: %s\n", strerror ( rc ) );
+			goto err_verify_manifest;
+		}
+		return 0;
+	}
+
 	/* Acquire the signature image */
 	if ( ( rc = imgacquire ( signature_name_uri, opts.timeout,
 				 &signature ) ) != 0 )
@@ -157,10 +166,90 @@ static int imgverify_exec ( int argc, char **argv ) {
 	if ( ! opts.keep )
 		unregister_image ( signature );
  err_acquire_signature:
+ err_verify_manifest:
  err_acquire_image:
 	return rc;
 }
 
+/** "imgmanifest" options */
+struct imgmanifest_options {
+	/** Required signer common name */
+	char *signer;
+	/** Keep manifest and signature after verification */
+	int keep;
+	/** Download timeout */
+	unsigned long timeout;
+};
+
+/** "imgmanifest" option list */
+static struct option_descriptor imgmanifest_opts[] = {
+	OPTION_DESC ( "signer", 's', required_argument,
+		      struct imgmanifest_options, signer, parse_string ),
+	OPTION_DESC ( "keep", 'k', no_argument,
+		      struct imgmanifest_options, keep, parse_flag ),
+	OPTION_DESC ( "timeout", 't', required_argument,
+		      struct imgmanifest_options, timeout, parse_timeout),
+};
+
+/** "imgmanifest" command descriptor */
+static struct command_descriptor imgmanifest_cmd =
+	COMMAND_DESC ( struct imgmanifest_options, imgmanifest_opts, 2, 2,
+		       "<manifest uri|image> <signature uri|image>" );
+
+/**
+ * The "imgmanifest" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int imgmanifest_exec ( int argc, char **argv ) {
+	struct imgmanifest_options opts;
+	const char *manifest_name_uri;
+	const char *signature_name_uri;
+	struct image *manifest;
+	struct image *signature;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &imgmanifest_cmd,
+				    &opts ) ) != 0 )
+		return rc;
+
+	/* Parse manifest and signature name/URI strings */
+	manifest_name_uri = argv[optind];
+	signature_name_uri = argv[ optind + 1 ];
+
+	/* Acquire the manifest */
+	if ( ( rc = imgacquire ( manifest_name_uri, opts.timeout,
+				 &manifest ) ) != 0 )
+		goto err_acquire_manifest;
+
+	/* Acquire the signature image */
+	if ( ( rc = imgacquire ( signature_name_uri, opts.timeout,
+				 &signature ) ) != 0 )
+		goto err_acquire_signature;
+
+	/* Verify and load manifest */
+	if ( ( rc = imgmanifest ( manifest, signature, opts.signer ) ) != 0 ) {
+		printf ( "Could not load manifest: %s\n", strerror ( rc ) );
+		goto err_manifest;
+	}
+
+	/* Success */
+	rc = 0;
+
+ err_manifest:
+	/* Discard manifest and signature unless --keep was specified */
+	if ( ! opts.keep )
+		unregister_image ( signature );
+ err_acquire_signature:
+	if ( ! opts.keep )
+		unregister_image ( manifest );
+ err_acquire_manifest:
+	return rc;
+}
+
 /** Image trust management commands */
 struct command image_trust_commands[] __command = {
 	{
@@ -171,4 +260,8 @@ struct command image_trust_commands[] __command = {
 		.name = "imgverify",
 		.exec = imgverify_exec,
 	},
+	{
+		.name = "imgmanifest",
+		.exec = imgmanifest_exec,
+	},
 };
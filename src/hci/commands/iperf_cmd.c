@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <ipxe/command.h>
+#include <ipxe/parseopt.h>
+#include <ipxe/timer.h>
+#include <usr/iperf.h>
+
+/** @file
+ *
+ * TCP throughput testing command
+ *
+ */
+
+/** Default test duration (in seconds) */
+#define IPERF_DEFAULT_TIME 10
+
+/** Default buffer length */
+#define IPERF_DEFAULT_LEN 8192
+
+/** "iperf" options */
+struct iperf_options {
+	/** Run as server */
+	int server;
+	/** Port number */
+	unsigned int port;
+	/** Test duration (in seconds) */
+	unsigned int time;
+	/** Buffer length */
+	unsigned int len;
+};
+
+/** "iperf" option list */
+static struct option_descriptor iperf_opts[] = {
+	OPTION_DESC ( "server", 's', no_argument,
+		      struct iperf_options, server, parse_flag ),
+	OPTION_DESC ( "port", 'p', required_argument,
+		      struct iperf_options, port, parse_integer ),
+	OPTION_DESC ( "time", 't', required_argument,
+		      struct iperf_options, time, parse_integer ),
+	OPTION_DESC ( "len", 'l', required_argument,
+		      struct iperf_options, len, parse_integer ),
+};
+
+/** "iperf" command descriptor */
+static struct command_descriptor iperf_cmd =
+	COMMAND_DESC ( struct iperf_options, iperf_opts, 0, 1, "[<host>]" );
+
+/**
+ * The "iperf" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int iperf_exec ( int argc, char **argv ) {
+	struct iperf_options opts;
+	const char *hostname;
+	int rc;
+
+	/* Initialise options */
+	memset ( &opts, 0, sizeof ( opts ) );
+	opts.port = IPERF_PORT;
+	opts.time = IPERF_DEFAULT_TIME;
+	opts.len = IPERF_DEFAULT_LEN;
+
+	/* Parse options */
+	if ( ( rc = reparse_options ( argc, argv, &iperf_cmd, &opts ) ) != 0 )
+		return rc;
+
+	/* Run server, if applicable */
+	if ( opts.server )
+		return iperf_server ( opts.port );
+
+	/* Parse hostname */
+	if ( optind == argc ) {
+		printf ( "No server specified\n" );
+		return -EINVAL;
+	}
+	hostname = argv[optind];
+
+	/* Run client */
+	if ( ( rc = iperf_client ( hostname, opts.port,
+				   ( opts.time * TICKS_PER_SEC ),
+				   opts.len ) ) != 0 )
+		return rc;
+
+	return 0;
+}
+
+/** iperf command */
+struct command iperf_command __command = {
+	.name = "iperf",
+	.exec = iperf_exec,
+};
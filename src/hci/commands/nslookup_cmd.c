@@ -20,6 +20,7 @@
 FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <stdio.h>
+#include <errno.h>
 #include <getopt.h>
 #include <ipxe/command.h>
 #include <ipxe/parseopt.h>
@@ -32,15 +33,21 @@ FILE_LICENCE ( GPL2_OR_LATER );
  */
 
 /** "nslookup" options */
-struct nslookup_options {};
+struct nslookup_options {
+	/** Show DNS cache */
+	int cache;
+};
 
 /** "nslookup" option list */
-static struct option_descriptor nslookup_opts[] = {};
+static struct option_descriptor nslookup_opts[] = {
+	OPTION_DESC ( "cache", 'c', no_argument,
+		      struct nslookup_options, cache, parse_flag ),
+};
 
 /** "nslookup" command descriptor */
 static struct command_descriptor nslookup_cmd =
-	COMMAND_DESC ( struct nslookup_options, nslookup_opts, 2, 2,
-		       "<setting> <name>" );
+	COMMAND_DESC ( struct nslookup_options, nslookup_opts, 0, 2,
+		       "[<setting> <name>]" );
 
 /**
  * The "nslookup" command
@@ -59,6 +66,18 @@ static int nslookup_exec ( int argc, char **argv ) {
 	if ( ( rc = parse_options ( argc, argv, &nslookup_cmd, &opts ) ) != 0 )
 		return rc;
 
+	/* Show DNS cache, if applicable */
+	if ( opts.cache ) {
+		nslookup_cache();
+		return 0;
+	}
+
+	/* Check arguments */
+	if ( ( argc - optind ) != 2 ) {
+		print_usage ( &nslookup_cmd, argv );
+		return -EINVAL;
+	}
+
 	/* Parse setting name */
 	setting_name = argv[optind];
 
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <ipxe/command.h>
+#include <ipxe/parseopt.h>
+#include <ipxe/pcap.h>
+#include <usr/pcapmgmt.h>
+
+/** @file
+ *
+ * Packet capture commands
+ *
+ */
+
+/** Default name for saved packet capture image */
+#define PCAP_DEFAULT_NAME "capture.pcapng"
+
+/** "pcapstart" options */
+struct pcapstart_options {
+	/** Number of packets to retain */
+	unsigned int count;
+	/** Number of bytes to capture from each packet */
+	unsigned int snaplen;
+};
+
+/** "pcapstart" option list */
+static struct option_descriptor pcapstart_opts[] = {
+	OPTION_DESC ( "count", 'c', required_argument,
+		      struct pcapstart_options, count, parse_integer ),
+	OPTION_DESC ( "snaplen", 's', required_argument,
+		      struct pcapstart_options, snaplen, parse_integer ),
+};
+
+/** "pcapstart" command descriptor */
+static struct command_descriptor pcapstart_cmd =
+	COMMAND_DESC ( struct pcapstart_options, pcapstart_opts, 0, 0, NULL );
+
+/**
+ * The "pcapstart" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int pcapstart_exec ( int argc, char **argv ) {
+	struct pcapstart_options opts;
+	int rc;
+
+	/* Initialise options */
+	memset ( &opts, 0, sizeof ( opts ) );
+	opts.count = PCAP_DEFAULT_COUNT;
+	opts.snaplen = PCAP_DEFAULT_SNAPLEN;
+
+	/* Parse options */
+	if ( ( rc = reparse_options ( argc, argv, &pcapstart_cmd,
+				      &opts ) ) != 0 )
+		return rc;
+
+	/* Start capture */
+	if ( ( rc = pcap_start ( opts.count, opts.snaplen ) ) != 0 ) {
+		printf ( "Could not start capture: %s\n", strerror ( rc ) );
+		return rc;
+	}
+
+	return 0;
+}
+
+/** "pcapstop" options */
+struct pcapstop_options {
+	/** Discard captured packets */
+	int clear;
+};
+
+/** "pcapstop" option list */
+static struct option_descriptor pcapstop_opts[] = {
+	OPTION_DESC ( "clear", 'c', no_argument,
+		      struct pcapstop_options, clear, parse_flag ),
+};
+
+/** "pcapstop" command descriptor */
+static struct command_descriptor pcapstop_cmd =
+	COMMAND_DESC ( struct pcapstop_options, pcapstop_opts, 0, 0, NULL );
+
+/**
+ * The "pcapstop" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int pcapstop_exec ( int argc, char **argv ) {
+	struct pcapstop_options opts;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &pcapstop_cmd, &opts ) ) != 0 )
+		return rc;
+
+	/* Stop capture */
+	pcap_stop();
+	pcap_show();
+
+	/* Discard captured packets, if applicable */
+	if ( opts.clear )
+		pcap_clear();
+
+	return 0;
+}
+
+/** "pcapsave" options */
+struct pcapsave_options {
+	/** Submit capture to URI */
+	char *post;
+	/** Submission timeout */
+	unsigned long timeout;
+};
+
+/** "pcapsave" option list */
+static struct option_descriptor pcapsave_opts[] = {
+	OPTION_DESC ( "post", 'p', required_argument,
+		      struct pcapsave_options, post, parse_string ),
+	OPTION_DESC ( "timeout", 't', required_argument,
+		      struct pcapsave_options, timeout, parse_timeout ),
+};
+
+/** "pcapsave" command descriptor */
+static struct command_descriptor pcapsave_cmd =
+	COMMAND_DESC ( struct pcapsave_options, pcapsave_opts, 0, 1,
+		       "[<name>]" );
+
+/**
+ * The "pcapsave" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int pcapsave_exec ( int argc, char **argv ) {
+	struct pcapsave_options opts;
+	const char *name;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &pcapsave_cmd, &opts ) ) != 0 )
+		return rc;
+
+	/* Submit capture, if applicable */
+	if ( opts.post ) {
+		if ( ( rc = pcap_post ( opts.post, opts.timeout ) ) != 0 ) {
+			printf ( "Could not submit capture: %s\n",
+				 strerror ( rc ) );
+			return rc;
+		}
+		return 0;
+	}
+
+	/* Save capture as an image */
+	name = ( ( optind < argc ) ? argv[optind] : PCAP_DEFAULT_NAME );
+	if ( ( rc = pcap_save ( name ) ) != 0 ) {
+		printf ( "Could not save capture: %s\n", strerror ( rc ) );
+		return rc;
+	}
+
+	return 0;
+}
+
+/** Packet capture commands */
+struct command pcap_commands[] __command = {
+	{
+		.name = "pcapstart",
+		.exec = pcapstart_exec,
+	},
+	{
+		.name = "pcapstop",
+		.exec = pcapstop_exec,
+	},
+	{
+		.name = "pcapsave",
+		.exec = pcapsave_exec,
+	},
+};
@@ -36,10 +36,24 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  */
 
 /** "profstat" options */
-struct profstat_options {};
+struct profstat_options {
+	/** Show histograms */
+	int histogram;
+	/** Record to system log */
+	int log;
+	/** Reset statistics */
+	int reset;
+};
 
 /** "profstat" option list */
-static struct option_descriptor profstat_opts[] = {};
+static struct option_descriptor profstat_opts[] = {
+	OPTION_DESC ( "histogram", 'H', no_argument,
+		      struct profstat_options, histogram, parse_flag ),
+	OPTION_DESC ( "log", 'l', no_argument,
+		      struct profstat_options, log, parse_flag ),
+	OPTION_DESC ( "reset", 'r', no_argument,
+		      struct profstat_options, reset, parse_flag ),
+};
 
 /** "profstat" command descriptor */
 static struct command_descriptor profstat_cmd =
@@ -60,7 +74,18 @@ static int profstat_exec ( int argc, char **argv ) {
 	if ( ( rc = parse_options ( argc, argv, &profstat_cmd, &opts ) ) != 0 )
 		return rc;
 
-	profstat();
+	/* Report statistics */
+	if ( opts.log ) {
+		profstat_log();
+	} else if ( opts.histogram ) {
+		profstat_histogram();
+	} else {
+		profstat();
+	}
+
+	/* Reset statistics, if applicable */
+	if ( opts.reset )
+		profstat_reset();
 
 	return 0;
 }
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <ipxe/command.h>
+#include <ipxe/parseopt.h>
+#include <ipxe/sampler.h>
+#include <usr/samplemgmt.h>
+
+/** @file
+ *
+ * Sampling profiler commands
+ *
+ */
+
+/** "samplestart" options */
+struct samplestart_options {};
+
+/** "samplestart" option list */
+static struct option_descriptor samplestart_opts[] = {};
+
+/** "samplestart" command descriptor */
+static struct command_descriptor samplestart_cmd =
+	COMMAND_DESC ( struct samplestart_options, samplestart_opts, 0, 0,
+		       NULL );
+
+/**
+ * The "samplestart" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int samplestart_exec ( int argc, char **argv ) {
+	struct samplestart_options opts;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &samplestart_cmd,
+				    &opts ) ) != 0 )
+		return rc;
+
+	/* Start sampling */
+	if ( ( rc = sampler_start() ) != 0 ) {
+		printf ( "Could not start sampling: %s\n", strerror ( rc ) );
+		return rc;
+	}
+
+	return 0;
+}
+
+/** "samplestop" options */
+struct samplestop_options {
+	/** Submit results to URI */
+	char *post;
+	/** Submission timeout */
+	unsigned long timeout;
+};
+
+/** "samplestop" option list */
+static struct option_descriptor samplestop_opts[] = {
+	OPTION_DESC ( "post", 'p', required_argument,
+		      struct samplestop_options, post, parse_string ),
+	OPTION_DESC ( "timeout", 't', required_argument,
+		      struct samplestop_options, timeout, parse_timeout ),
+};
+
+/** "samplestop" command descriptor */
+static struct command_descriptor samplestop_cmd =
+	COMMAND_DESC ( struct samplestop_options, samplestop_opts, 0, 0,
+		       NULL );
+
+/**
+ * The "samplestop" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int samplestop_exec ( int argc, char **argv ) {
+	struct samplestop_options opts;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &samplestop_cmd,
+				    &opts ) ) != 0 )
+		return rc;
+
+	/* Stop sampling */
+	sampler_stop();
+
+	/* Submit or show results */
+	if ( opts.post ) {
+		if ( ( rc = sampler_post ( opts.post, opts.timeout ) ) != 0 ) {
+			printf ( "Could not submit samples: %s\n",
+				 strerror ( rc ) );
+			return rc;
+		}
+	} else {
+		sampler_show();
+	}
+
+	return 0;
+}
+
+/** Sampling profiler commands */
+struct command sample_commands[] __command = {
+	{
+		.name = "samplestart",
+		.exec = samplestart_exec,
+	},
+	{
+		.name = "samplestop",
+		.exec = samplestop_exec,
+	},
+};
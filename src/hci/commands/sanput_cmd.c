@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <ipxe/command.h>
+#include <ipxe/parseopt.h>
+#include <ipxe/sanboot.h>
+#include <usr/sanput.h>
+
+/** @file
+ *
+ * SAN device upload command
+ *
+ */
+
+/** "sanput" options */
+struct sanput_options {
+	/** Drive number */
+	unsigned int drive;
+	/** Compress using gzip */
+	int gzip;
+};
+
+/** "sanput" option list */
+static struct option_descriptor sanput_opts[] = {
+	OPTION_DESC ( "drive", 'd', required_argument,
+		      struct sanput_options, drive, parse_integer ),
+	OPTION_DESC ( "gzip", 'z', no_argument,
+		      struct sanput_options, gzip, parse_flag ),
+};
+
+/** "sanput" command descriptor */
+static struct command_descriptor sanput_cmd =
+	COMMAND_DESC ( struct sanput_options, sanput_opts, 1, 1, "<uri>" );
+
+/**
+ * The "sanput" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int sanput_exec ( int argc, char **argv ) {
+	struct sanput_options opts;
+	unsigned int flags = 0;
+	int rc;
+
+	/* Initialise options */
+	memset ( &opts, 0, sizeof ( opts ) );
+	opts.drive = san_default_drive();
+
+	/* Parse options */
+	if ( ( rc = reparse_options ( argc, argv, &sanput_cmd, &opts ) ) != 0 )
+		return rc;
+
+	/* Upload SAN device */
+	if ( opts.gzip )
+		flags |= SANPUT_GZIP;
+	if ( ( rc = sanput ( opts.drive, argv[optind], flags ) ) != 0 )
+		return rc;
+
+	return 0;
+}
+
+/** SAN device upload command */
+struct command sanput_command __command = {
+	.name = "sanput",
+	.exec = sanput_exec,
+};
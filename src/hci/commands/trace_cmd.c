@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <ipxe/command.h>
+#include <ipxe/parseopt.h>
+#include <ipxe/trace.h>
+#include <usr/tracemgmt.h>
+
+/** @file
+ *
+ * Boot timeline tracing commands
+ *
+ */
+
+/** "trace" options */
+struct trace_options {
+	/** Submit trace to URI */
+	char *post;
+	/** Discard trace */
+	int clear;
+	/** Submission timeout */
+	unsigned long timeout;
+};
+
+/** "trace" option list */
+static struct option_descriptor trace_opts[] = {
+	OPTION_DESC ( "post", 'p', required_argument,
+		      struct trace_options, post, parse_string ),
+	OPTION_DESC ( "clear", 'c', no_argument,
+		      struct trace_options, clear, parse_flag ),
+	OPTION_DESC ( "timeout", 't', required_argument,
+		      struct trace_options, timeout, parse_timeout ),
+};
+
+/** "trace" command descriptor */
+static struct command_descriptor trace_cmd =
+	COMMAND_DESC ( struct trace_options, trace_opts, 0, 0, NULL );
+
+/**
+ * The "trace" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int trace_exec ( int argc, char **argv ) {
+	struct trace_options opts;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &trace_cmd, &opts ) ) != 0 )
+		return rc;
+
+	/* Submit or show trace */
+	if ( opts.post ) {
+		if ( ( rc = trace_post ( opts.post, opts.timeout ) ) != 0 ) {
+			printf ( "Could not submit trace: %s\n",
+				 strerror ( rc ) );
+			return rc;
+		}
+	} else if ( ! opts.clear ) {
+		trace_show();
+	}
+
+	/* Discard trace, if applicable */
+	if ( opts.clear )
+		trace_clear();
+
+	return 0;
+}
+
+/** Boot timeline tracing commands */
+struct command trace_commands[] __command = {
+	{
+		.name = "trace",
+		.exec = trace_exec,
+	},
+};
@@ -29,7 +29,10 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  *
  */
 
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <ctype.h>
 #include <errno.h>
 #include <curses.h>
 #include <ipxe/keys.h>
@@ -47,32 +50,40 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #define MENU_COLS	( COLS - 2U )
 #define MENU_PAD	2U
 
+/** Maximum length of type-ahead search string */
+#define MENU_SEARCH_LEN	32
+
+/** Idle time after which a type-ahead search string is discarded */
+#define MENU_SEARCH_TIMEOUT ( TICKS_PER_SEC )
+
 /** A menu user interface */
 struct menu_ui {
 	/** Menu */
 	struct menu *menu;
+	/** Menu items, indexed by position */
+	struct menu_item **items;
 	/** Jump scroller */
 	struct jump_scroller scroll;
 	/** Timeout (0=indefinite) */
 	unsigned long timeout;
+	/** Type-ahead search string */
+	char search[ MENU_SEARCH_LEN + 1 /* NUL */ ];
+	/** Length of type-ahead search string */
+	size_t search_len;
+	/** Time of last type-ahead keypress */
+	unsigned long search_time;
 };
 
 /**
  * Return a numbered menu item
  *
- * @v menu		Menu
+ * @v ui		Menu user interface
  * @v index		Index
  * @ret item		Menu item, or NULL
  */
-static struct menu_item * menu_item ( struct menu *menu, unsigned int index ) {
-	struct menu_item *item;
-
-	list_for_each_entry ( item, &menu->items, list ) {
-		if ( index-- == 0 )
-			return item;
-	}
+static struct menu_item * menu_item ( struct menu_ui *ui, unsigned int index ) {
 
-	return NULL;
+	return ( ( index < ui->scroll.count ) ? ui->items[index] : NULL );
 }
 
 /**
@@ -95,7 +106,7 @@ static void draw_menu_item ( struct menu_ui *ui, unsigned int index ) {
 	move ( ( MENU_ROW + row_offset ), MENU_COL );
 
 	/* Get menu item */
-	item = menu_item ( ui->menu, index );
+	item = menu_item ( ui, index );
 	if ( item ) {
 
 		/* Draw separators in a different colour */
@@ -164,6 +175,57 @@ static void draw_menu_items ( struct menu_ui *ui ) {
 		draw_menu_item ( ui, ( ui->scroll.first + i ) );
 }
 
+/**
+ * Handle type-ahead search key
+ *
+ * @v ui		Menu user interface
+ * @v key		Key pressed
+ *
+ * Printable keys which are not item shortcuts are accumulated into a
+ * search string, and the selection is moved to the first labelled
+ * item (at or after the current selection) whose text begins with
+ * that string.  Repeatedly typing the same single character cycles
+ * through the items beginning with that character.
+ */
+static void menu_search ( struct menu_ui *ui, int key ) {
+	struct menu_item *item;
+	unsigned long now = currticks();
+	unsigned int start;
+	unsigned int index;
+	unsigned int i;
+
+	/* Ignore non-printable keys */
+	if ( ( key > 0xff ) || ! isprint ( key ) )
+		return;
+
+	/* Discard stale search string */
+	if ( ( now - ui->search_time ) > MENU_SEARCH_TIMEOUT )
+		ui->search_len = 0;
+	ui->search_time = now;
+
+	/* Extend search string, or cycle on a repeated character */
+	start = ui->scroll.current;
+	if ( ( ui->search_len == 1 ) &&
+	     ( tolower ( ui->search[0] ) == tolower ( key ) ) ) {
+		start++;
+	} else if ( ui->search_len < MENU_SEARCH_LEN ) {
+		ui->search[ ui->search_len++ ] = key;
+		ui->search[ ui->search_len ] = '\0';
+	}
+
+	/* Find first matching labelled item */
+	for ( i = 0 ; i < ui->scroll.count ; i++ ) {
+		index = ( ( start + i ) % ui->scroll.count );
+		item = menu_item ( ui, index );
+		if ( item->label &&
+		     ( strncasecmp ( item->text, ui->search,
+				     ui->search_len ) == 0 ) ) {
+			ui->scroll.current = index;
+			return;
+		}
+	}
+}
+
 /**
  * Menu main loop
  *
@@ -175,8 +237,9 @@ static int menu_loop ( struct menu_ui *ui, struct menu_item **selected ) {
 	struct menu_item *item;
 	unsigned long timeout;
 	unsigned int previous;
+	unsigned int i;
+	int shortcut;
 	int key;
-	int i;
 	int move;
 	int chosen = 0;
 	int rc = 0;
@@ -216,21 +279,22 @@ static int menu_loop ( struct menu_ui *ui, struct menu_item **selected ) {
 				chosen = 1;
 				break;
 			default:
-				i = 0;
-				list_for_each_entry ( item, &ui->menu->items,
-						      list ) {
+				shortcut = 0;
+				for ( i = 0 ; i < ui->scroll.count ; i++ ) {
+					item = menu_item ( ui, i );
 					if ( ! ( item->shortcut &&
-						 ( item->shortcut == key ) ) ) {
-						i++;
+						 ( item->shortcut == key ) ) )
 						continue;
-					}
 					ui->scroll.current = i;
+					shortcut = 1;
 					if ( item->label ) {
 						chosen = 1;
 					} else {
 						move = +1;
 					}
 				}
+				if ( ( ! shortcut ) && ( ! move ) )
+					menu_search ( ui, key );
 				break;
 			}
 		}
@@ -238,21 +302,27 @@ static int menu_loop ( struct menu_ui *ui, struct menu_item **selected ) {
 		/* Move selection, if applicable */
 		while ( move ) {
 			move = jump_scroll_move ( &ui->scroll, move );
-			item = menu_item ( ui->menu, ui->scroll.current );
+			item = menu_item ( ui, ui->scroll.current );
 			if ( item->label )
 				break;
 		}
 
-		/* Redraw selection if necessary */
-		if ( ( ui->scroll.current != previous ) || ( timeout != 0 ) ) {
-			draw_menu_item ( ui, previous );
-			if ( jump_scroll ( &ui->scroll ) )
+		/* Redraw only the lines that have changed, unless the
+		 * visible block of items has moved.
+		 */
+		if ( ui->scroll.current != previous ) {
+			if ( jump_scroll ( &ui->scroll ) ) {
 				draw_menu_items ( ui );
+			} else {
+				draw_menu_item ( ui, previous );
+			}
+			draw_menu_item ( ui, ui->scroll.current );
+		} else if ( timeout != 0 ) {
 			draw_menu_item ( ui, ui->scroll.current );
 		}
 
 		/* Record selection */
-		item = menu_item ( ui->menu, ui->scroll.current );
+		item = menu_item ( ui, ui->scroll.current );
 		assert ( item != NULL );
 		assert ( item->label != NULL );
 		*selected = item;
@@ -275,6 +345,7 @@ int show_menu ( struct menu *menu, unsigned long timeout,
 	struct menu_item *item;
 	struct menu_ui ui;
 	char buf[ MENU_COLS + 1 /* NUL */ ];
+	unsigned int count = 0;
 	int labelled_count = 0;
 	int rc;
 
@@ -283,7 +354,15 @@ int show_menu ( struct menu *menu, unsigned long timeout,
 	ui.menu = menu;
 	ui.scroll.rows = MENU_ROWS;
 	ui.timeout = timeout;
+
+	/* Index menu items, to allow for very large menus */
+	list_for_each_entry ( item, &menu->items, list )
+		count++;
+	ui.items = malloc ( count * sizeof ( ui.items[0] ) );
+	if ( ! ui.items )
+		return -ENOMEM;
 	list_for_each_entry ( item, &menu->items, list ) {
+		ui.items[ui.scroll.count] = item;
 		if ( item->label ) {
 			if ( ! labelled_count )
 				ui.scroll.current = ui.scroll.count;
@@ -303,7 +382,8 @@ int show_menu ( struct menu *menu, unsigned long timeout,
 		 * from, and will seriously confuse the navigation
 		 * logic.  Refuse to display any such menus.
 		 */
-		return -ENOENT;
+		rc = -ENOENT;
+		goto err_no_labels;
 	}
 
 	/* Initialise screen */
@@ -329,5 +409,7 @@ int show_menu ( struct menu *menu, unsigned long timeout,
 	/* Clear screen */
 	endwin();
 
+ err_no_labels:
+	free ( ui.items );
 	return rc;
 }
@@ -352,71 +352,83 @@ static int png_image_data ( struct image *image, struct png_context *png,
 }
 
 /**
- * Unfilter byte using the "None" filter
+ * Unfilter scanline using the "None" filter
  *
- * @v current		Filtered current byte
- * @v left		Unfiltered left byte
- * @v above		Unfiltered above byte
- * @v above_left	Unfiltered above-left byte
- * @ret current		Unfiltered current byte
+ * @v current		Filtered current scanline
+ * @v above		Unfiltered above scanline
+ * @v len		Length of scanline (excluding filter byte)
+ * @v pixel_len		Pixel length
  */
-static unsigned int png_unfilter_none ( unsigned int current,
-					unsigned int left __unused,
-					unsigned int above __unused,
-					unsigned int above_left __unused ) {
+static void png_unfilter_none ( uint8_t *current __unused,
+				const uint8_t *above __unused,
+				size_t len __unused, size_t pixel_len __unused ) {
 
-	return current;
+	/* Nothing to do */
 }
 
 /**
- * Unfilter byte using the "Sub" filter
+ * Unfilter scanline using the "Sub" filter
  *
- * @v current		Filtered current byte
- * @v left		Unfiltered left byte
- * @v above		Unfiltered above byte
- * @v above_left	Unfiltered above-left byte
- * @ret current		Unfiltered current byte
+ * @v current		Filtered current scanline
+ * @v above		Unfiltered above scanline
+ * @v len		Length of scanline (excluding filter byte)
+ * @v pixel_len		Pixel length
  */
-static unsigned int png_unfilter_sub ( unsigned int current,
-				       unsigned int left,
-				       unsigned int above __unused,
-				       unsigned int above_left __unused ) {
+static void png_unfilter_sub ( uint8_t *current,
+			       const uint8_t *above __unused,
+			       size_t len, size_t pixel_len ) {
+	size_t i;
 
-	return ( current + left );
+	for ( i = pixel_len ; i < len ; i++ )
+		current[i] += current[ i - pixel_len ];
 }
 
 /**
- * Unfilter byte using the "Up" filter
+ * Unfilter scanline using the "Up" filter
  *
- * @v current		Filtered current byte
- * @v left		Unfiltered left byte
- * @v above		Unfiltered above byte
- * @v above_left	Unfiltered above-left byte
- * @ret current		Unfiltered current byte
+ * @v current		Filtered current scanline
+ * @v above		Unfiltered above scanline
+ * @v len		Length of scanline (excluding filter byte)
+ * @v pixel_len		Pixel length
+ *
+ * There is no dependency between adjacent bytes, so we add a whole
+ * word at a time, preventing carries from propagating between bytes.
  */
-static unsigned int png_unfilter_up ( unsigned int current,
-				      unsigned int left __unused,
-				      unsigned int above,
-				      unsigned int above_left __unused ) {
-
-	return ( current + above );
+static void png_unfilter_up ( uint8_t *current, const uint8_t *above,
+			      size_t len, size_t pixel_len __unused ) {
+	const unsigned long high = ( ~0UL / 0xff * 0x80 );
+	unsigned long cur;
+	unsigned long abv;
+	size_t i;
+
+	for ( i = 0 ; ( i + sizeof ( cur ) ) <= len ; i += sizeof ( cur ) ) {
+		memcpy ( &cur, &current[i], sizeof ( cur ) );
+		memcpy ( &abv, &above[i], sizeof ( abv ) );
+		cur = ( ( ( cur & ~high ) + ( abv & ~high ) ) ^
+			( ( cur ^ abv ) & high ) );
+		memcpy ( &current[i], &cur, sizeof ( cur ) );
+	}
+	for ( ; i < len ; i++ )
+		current[i] += above[i];
 }
 
 /**
- * Unfilter byte using the "Average" filter
+ * Unfilter scanline using the "Average" filter
  *
- * @v current		Filtered current byte
- * @v left		Unfiltered left byte
- * @v above		Unfiltered above byte
- * @v above_left	Unfiltered above-left byte
- * @ret current		Unfiltered current byte
+ * @v current		Filtered current scanline
+ * @v above		Unfiltered above scanline
+ * @v len		Length of scanline (excluding filter byte)
+ * @v pixel_len		Pixel length
  */
-static unsigned int png_unfilter_average ( unsigned int current,
-					   unsigned int left,
-					   unsigned int above,
-					   unsigned int above_left __unused ) {
-
-	return ( current + ( ( above + left ) >> 1 ) );
+static void png_unfilter_average ( uint8_t *current, const uint8_t *above,
+				   size_t len, size_t pixel_len ) {
+	size_t i;
+
+	for ( i = 0 ; i < pixel_len ; i++ )
+		current[i] += ( above[i] >> 1 );
+	for ( ; i < len ; i++ ) {
+		current[i] += ( ( current[ i - pixel_len ] + above[i] ) >> 1 );
+	}
 }
 
 /**
@@ -427,18 +439,18 @@ static unsigned int png_unfilter_average ( unsigned int current,
  * @v c			Pixel C
  * @ret predictor	Predictor pixel
  */
-static unsigned int png_paeth_predictor ( unsigned int a, unsigned int b,
-					  unsigned int c ) {
-	unsigned int p;
-	unsigned int pa;
-	unsigned int pb;
-	unsigned int pc;
-
-	/* Algorithm as defined in RFC 2083 section 6.6 */
-	p = ( a + b - c );
-	pa = abs ( p - a );
-	pb = abs ( p - b );
-	pc = abs ( p - c );
+static inline __attribute__ (( always_inline )) unsigned int
+png_paeth_predictor ( unsigned int a, unsigned int b, unsigned int c ) {
+	int pa;
+	int pb;
+	int pc;
+
+	/* Algorithm as defined in RFC 2083 section 6.6, with the
+	 * common subexpressions eliminated.
+	 */
+	pa = abs ( ( int ) b - ( int ) c );
+	pb = abs ( ( int ) a - ( int ) c );
+	pc = abs ( ( int ) ( a + b ) - ( int ) ( 2 * c ) );
 	if ( ( pa <= pb ) && ( pa <= pc ) ) {
 		return a;
 	} else if ( pb <= pc ) {
@@ -449,37 +461,41 @@ static unsigned int png_paeth_predictor ( unsigned int a, unsigned int b,
 }
 
 /**
- * Unfilter byte using the "Paeth" filter
+ * Unfilter scanline using the "Paeth" filter
  *
- * @v current		Filtered current byte
- * @v above_left	Unfiltered above-left byte
- * @v above		Unfiltered above byte
- * @v left		Unfiltered left byte
- * @ret current		Unfiltered current byte
+ * @v current		Filtered current scanline
+ * @v above		Unfiltered above scanline
+ * @v len		Length of scanline (excluding filter byte)
+ * @v pixel_len		Pixel length
  */
-static unsigned int png_unfilter_paeth ( unsigned int current,
-					 unsigned int left,
-					 unsigned int above,
-					 unsigned int above_left ) {
+static void png_unfilter_paeth ( uint8_t *current, const uint8_t *above,
+				 size_t len, size_t pixel_len ) {
+	size_t i;
 
-	return ( current + png_paeth_predictor ( left, above, above_left ) );
+	/* Left and above-left bytes are zero for the first pixel, in
+	 * which case the predictor is always the above byte.
+	 */
+	for ( i = 0 ; i < pixel_len ; i++ )
+		current[i] += above[i];
+	for ( ; i < len ; i++ ) {
+		current[i] += png_paeth_predictor ( current[ i - pixel_len ],
+						    above[i],
+						    above[ i - pixel_len ] );
+	}
 }
 
 /** A PNG filter */
 struct png_filter {
 	/**
-	 * Unfilter byte
+	 * Unfilter scanline
 	 *
-	 * @v current		Filtered current byte
-	 * @v left		Unfiltered left byte
-	 * @v above		Unfiltered above byte
-	 * @v above_left	Unfiltered above-left byte
-	 * @ret current		Unfiltered current byte
+	 * @v current		Filtered current scanline
+	 * @v above		Unfiltered above scanline
+	 * @v len		Length of scanline (excluding filter byte)
+	 * @v pixel_len		Pixel length
 	 */
-	unsigned int ( * unfilter ) ( unsigned int current,
-				      unsigned int left,
-				      unsigned int above,
-				      unsigned int above_left );
+	void ( * unfilter ) ( uint8_t *current, const uint8_t *above,
+			      size_t len, size_t pixel_len );
 };
 
 /** PNG filter types */
@@ -509,76 +525,63 @@ static int png_unfilter_pass ( struct image *image, struct png_context *png,
 	size_t scanline_len = png_scanline_len ( png, interlace );
 	struct png_filter *filter;
 	unsigned int scanline;
-	unsigned int byte;
 	uint8_t filter_type;
-	uint8_t left;
-	uint8_t above;
-	uint8_t above_left;
-	uint8_t current;
+	uint8_t *current;
+	uint8_t *above;
+	uint8_t *tmp;
+	int rc;
 
-	/* On the first scanline of a pass, above bytes are assumed to
-	 * be zero.
+	/* Allocate scanline buffers.  On the first scanline of a
+	 * pass, above bytes are assumed to be zero.
 	 */
-	above = 0;
+	current = zalloc ( 2 * scanline_len );
+	if ( ! current ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	above = ( current + scanline_len );
 
 	/* Iterate over each scanline in turn */
 	for ( scanline = 0 ; scanline < interlace->height ; scanline++ ) {
 
+		/* Fetch scanline */
+		copy_from_user ( current, png->raw.data, offset,
+				 scanline_len );
+
 		/* Extract filter byte and determine filter type */
-		copy_from_user ( &filter_type, png->raw.data, offset++,
-				 sizeof ( filter_type ) );
+		filter_type = current[0];
 		if ( filter_type >= ( sizeof ( png_filters ) /
 				      sizeof ( png_filters[0] ) ) ) {
 			DBGC ( image, "PNG %s unknown filter type %d\n",
 			       image->name, filter_type );
-			return -ENOTSUP;
+			rc = -ENOTSUP;
+			goto err_filter;
 		}
 		filter = &png_filters[filter_type];
 		assert ( filter->unfilter != NULL );
 		DBGC2 ( image, "PNG %s pass %d scanline %d filter type %d\n",
 			image->name, interlace->pass, scanline, filter_type );
 
-		/* At the start of a line, both above-left and left
-		 * bytes are taken to be zero.
-		 */
-		left = 0;
-		above_left = 0;
+		/* Unfilter scanline */
+		filter->unfilter ( ( current + 1 ), ( above + 1 ),
+				   ( scanline_len - 1 ), pixel_len );
+		copy_to_user ( png->raw.data, offset, current, scanline_len );
+		offset += scanline_len;
 
-		/* Iterate over each byte (not pixel) in turn */
-		for ( byte = 0 ; byte < ( scanline_len - 1 ) ; byte++ ) {
-
-			/* Extract predictor bytes, if applicable */
-			if ( byte >= pixel_len ) {
-				copy_from_user ( &left, png->raw.data,
-						 ( offset - pixel_len ),
-						 sizeof ( left ) );
-			}
-			if ( scanline > 0 ) {
-				copy_from_user ( &above, png->raw.data,
-						 ( offset - scanline_len ),
-						 sizeof ( above ) );
-			}
-			if ( ( scanline > 0 ) && ( byte >= pixel_len ) ) {
-				copy_from_user ( &above_left, png->raw.data,
-						 ( offset - scanline_len -
-						   pixel_len ),
-						 sizeof ( above_left ) );
-			}
-
-			/* Unfilter current byte */
-			copy_from_user ( &current, png->raw.data,
-					 offset, sizeof ( current ) );
-			current = filter->unfilter ( current, left, above,
-						     above_left );
-			copy_to_user ( png->raw.data, offset++,
-				       &current, sizeof ( current ) );
-		}
+		/* Use this scanline as the next above scanline */
+		tmp = above;
+		above = current;
+		current = tmp;
 	}
 
 	/* Update offset */
 	png->raw.offset = offset;
 
-	return 0;
+	rc = 0;
+ err_filter:
+	free ( ( current < above ) ? current : above );
+ err_alloc:
+	return rc;
 }
 
 /**
@@ -643,15 +646,17 @@ static inline unsigned int png_pixel ( unsigned int raw, unsigned int alpha,
  * @v image		PNG image
  * @v png		PNG context
  * @v interlace		Interlace pass
+ * @ret rc		Return status code
  *
  * This routine may assume that it is impossible to overrun either the
  * raw data buffer or the pixel buffer, since the sizes of both are
  * determined by the image dimensions.
  */
-static void png_pixels_pass ( struct image *image,
-			      struct png_context *png,
-			      struct png_interlace *interlace ) {
+static int png_pixels_pass ( struct image *image,
+			     struct png_context *png,
+			     struct png_interlace *interlace ) {
 	size_t raw_offset = png->raw.offset;
+	size_t scanline_len = png_scanline_len ( png, interlace );
 	uint8_t channel[png->channels];
 	int is_indexed = ( png->colour_type & PNG_COLOUR_TYPE_PALETTE );
 	int is_rgb = ( png->colour_type & PNG_COLOUR_TYPE_RGB );
@@ -661,6 +666,9 @@ static void png_pixels_pass ( struct image *image,
 	size_t pixbuf_x_stride;
 	size_t pixbuf_y_stride;
 	size_t raw_stride;
+	const uint8_t *raw_data;
+	uint8_t *scanline;
+	uint32_t *pixels;
 	unsigned int y;
 	unsigned int x;
 	unsigned int c;
@@ -673,6 +681,13 @@ static void png_pixels_pass ( struct image *image,
 	uint8_t current = 0;
 	uint32_t pixel;
 
+	/* Allocate scanline and pixel row buffers */
+	scanline = malloc ( scanline_len +
+			    ( interlace->width * sizeof ( pixels[0] ) ) );
+	if ( ! scanline )
+		return -ENOMEM;
+	pixels = ( ( ( void * ) scanline ) + scanline_len );
+
 	/* We only ever use the top byte of 16-bit pixels.  Model this
 	 * as a bit depth of 8 with a stride of more than one.
 	 */
@@ -696,12 +711,14 @@ static void png_pixels_pass ( struct image *image,
 	/* Iterate over each scanline in turn */
 	for ( y = 0 ; y < interlace->height ; y++ ) {
 
-		/* Skip filter byte */
-		raw_offset++;
+		/* Fetch scanline, skipping filter byte */
+		copy_from_user ( scanline, png->raw.data, raw_offset,
+				 scanline_len );
+		raw_offset += scanline_len;
+		raw_data = ( scanline + 1 );
 
 		/* Iterate over each pixel in turn */
 		bits = depth;
-		pixbuf_offset = pixbuf_y_offset;
 		for ( x = 0 ; x < interlace->width ; x++ ) {
 
 			/* Extract sample value */
@@ -711,11 +728,8 @@ static void png_pixels_pass ( struct image *image,
 				current <<= depth;
 				bits -= depth;
 				if ( ! bits ) {
-					copy_from_user ( &current,
-							 png->raw.data,
-							 raw_offset,
-							 sizeof ( current ) );
-					raw_offset += raw_stride;
+					current = *raw_data;
+					raw_data += raw_stride;
 					bits = 8;
 				}
 
@@ -744,11 +758,23 @@ static void png_pixels_pass ( struct image *image,
 					pixel = ( ( pixel << 8 ) | value );
 				}
 			}
+			pixels[x] = pixel;
+		}
 
-			/* Store pixel */
-			copy_to_user ( png->pixbuf->data, pixbuf_offset,
-				       &pixel, sizeof ( pixel ) );
-			pixbuf_offset += pixbuf_x_stride;
+		/* Store pixels */
+		if ( interlace->x_stride == 1 ) {
+			copy_to_user ( png->pixbuf->data, pixbuf_y_offset,
+				       pixels,
+				       ( interlace->width *
+					 sizeof ( pixels[0] ) ) );
+		} else {
+			pixbuf_offset = pixbuf_y_offset;
+			for ( x = 0 ; x < interlace->width ; x++ ) {
+				copy_to_user ( png->pixbuf->data,
+					       pixbuf_offset, &pixels[x],
+					       sizeof ( pixels[0] ) );
+				pixbuf_offset += pixbuf_x_stride;
+			}
 		}
 
 		/* Move to next output row */
@@ -757,6 +783,9 @@ static void png_pixels_pass ( struct image *image,
 
 	/* Update offset */
 	png->raw.offset = raw_offset;
+
+	free ( scanline );
+	return 0;
 }
 
 /**
@@ -764,14 +793,16 @@ static void png_pixels_pass ( struct image *image,
  *
  * @v image		PNG image
  * @v png		PNG context
+ * @ret rc		Return status code
  *
  * This routine may assume that it is impossible to overrun either the
  * raw data buffer or the pixel buffer, since the sizes of both are
  * determined by the image dimensions.
  */
-static void png_pixels ( struct image *image, struct png_context *png ) {
+static int png_pixels ( struct image *image, struct png_context *png ) {
 	struct png_interlace interlace;
 	unsigned int pass;
+	int rc;
 
 	/* Process each interlace pass */
 	png->raw.offset = 0;
@@ -784,10 +815,13 @@ static void png_pixels ( struct image *image, struct png_context *png ) {
 		if ( interlace.width == 0 )
 			continue;
 
-		/* Unfilter this pass */
-		png_pixels_pass ( image, png, &interlace );
+		/* Fill pixels for this pass */
+		if ( ( rc = png_pixels_pass ( image, png, &interlace ) ) != 0 )
+			return rc;
 	}
 	assert ( png->raw.offset == png->raw.len );
+
+	return 0;
 }
 
 /**
@@ -830,7 +864,8 @@ static int png_image_end ( struct image *image, struct png_context *png,
 		return rc;
 
 	/* Fill pixel buffer */
-	png_pixels ( image, png );
+	if ( ( rc = png_pixels ( image, png ) ) != 0 )
+		return rc;
 
 	return 0;
 }
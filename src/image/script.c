@@ -35,6 +35,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <stdio.h>
 #include <ctype.h>
 #include <errno.h>
+#include <assert.h>
 #include <getopt.h>
 #include <ipxe/command.h>
 #include <ipxe/parseopt.h>
@@ -43,82 +44,168 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <usr/prompt.h>
 #include <ipxe/script.h>
 
-/** Offset within current script
+/** Number of label hash buckets */
+#define SCRIPT_LABEL_BUCKETS 32
+
+/** A compiled script line */
+struct script_line {
+	/** Offset within script */
+	size_t offset;
+	/** Label, or NULL */
+	const char *label;
+	/** Command */
+	const char *command;
+	/** Next line (plus one) with a label in the same hash bucket */
+	unsigned int next_label;
+};
+
+/** A compiled script
+ *
+ * A script is split into lines (with continuations joined, and
+ * labels separated from commands) once before execution begins, so
+ * that neither executing a line nor jumping to a label requires the
+ * script image to be rescanned.  Commands are not tokenised at this
+ * point: tokenisation must take place after expansion of settings,
+ * which may change between executions of the same line.
+ */
+struct script {
+	/** Script image */
+	struct image *image;
+	/** Line text */
+	char *text;
+	/** Number of lines */
+	unsigned int count;
+	/** Status code for any incomplete trailing line */
+	int rc;
+	/** First line (plus one) with a label in each hash bucket */
+	unsigned int labels[SCRIPT_LABEL_BUCKETS];
+	/** Lines */
+	struct script_line lines[0];
+};
+
+/** Currently executing script
+ *
+ * This is a global in order to allow goto_exec() to find the label
+ * index.
+ */
+static struct script *script;
+
+/** Index of next line to execute within current script
  *
  * This is a global in order to allow goto_exec() to update the
- * offset.
+ * position.
+ */
+static unsigned int script_index;
+
+/**
+ * Calculate label hash bucket
+ *
+ * @v label		Label
+ * @ret bucket		Hash bucket
  */
-static size_t script_offset;
+static unsigned int script_label_bucket ( const char *label ) {
+	unsigned int hash = 0;
+
+	while ( *label )
+		hash = ( ( hash * 33 ) ^ *(label++) );
+	return ( hash % SCRIPT_LABEL_BUCKETS );
+}
 
 /**
- * Process script lines
+ * Free compiled script
+ *
+ * @v script		Compiled script
+ */
+static void script_free ( struct script *script ) {
+
+	free ( script->text );
+	free ( script );
+}
+
+/**
+ * Compile script
  *
  * @v image		Script
- * @v process_line	Line processor
- * @v terminate		Termination check
- * @ret rc		Return status code
+ * @ret script		Compiled script, or NULL on error
  */
-static int process_script ( struct image *image,
-			    int ( * process_line ) ( struct image *image,
-						     size_t offset,
-						     const char *label,
-						     const char *command ),
-			    int ( * terminate ) ( int rc ) ) {
-	size_t len = 0;
-	char *line = NULL;
+static struct script * script_compile ( struct image *image ) {
+	struct script *script;
+	struct script_line *line;
+	unsigned int *bucket;
+	unsigned int max_count;
+	unsigned int index;
 	size_t line_offset;
+	size_t offset;
+	size_t start;
+	size_t len;
+	char *text;
 	char *label;
 	char *command;
 	off_t eol;
 	size_t frag_len;
-	char *tmp;
-	int rc;
 
-	/* Initialise script and line offsets */
-	script_offset = 0;
-	line_offset = 0;
+	/* Count maximum number of lines */
+	max_count = 1;
+	offset = 0;
+	while ( ( eol = memchr_user ( image->data, offset, '\n',
+				      ( image->len - offset ) ) ) >= 0 ) {
+		offset = ( eol + 1 );
+		max_count++;
+	}
 
+	/* Allocate and initialise compiled script */
+	script = zalloc ( sizeof ( *script ) +
+			  ( max_count * sizeof ( script->lines[0] ) ) );
+	if ( ! script )
+		goto err_alloc;
+	script->image = image;
+	text = malloc ( image->len + 1 /* NUL */ );
+	if ( ! text )
+		goto err_alloc_text;
+	script->text = text;
+	copy_from_user ( text, image->data, 0, image->len );
+
+	/* Join and split lines in place.  The joined text of a line
+	 * can never be longer than the raw text consumed, so the
+	 * output never overtakes the input.
+	 */
+	offset = 0;
+	line_offset = 0;
+	start = 0;
+	len = 0;
 	do {
 
 		/* Find length of next line, excluding any terminating '\n' */
-		eol = memchr_user ( image->data, script_offset, '\n',
-				    ( image->len - script_offset ) );
+		eol = memchr_user ( image->data, offset, '\n',
+				    ( image->len - offset ) );
 		if ( eol < 0 )
 			eol = image->len;
-		frag_len = ( eol - script_offset );
-
-		/* Allocate buffer for line */
-		tmp = realloc ( line, ( len + frag_len + 1 /* NUL */ ) );
-		if ( ! tmp ) {
-			rc = -ENOMEM;
-			goto err_alloc;
-		}
-		line = tmp;
+		frag_len = ( eol - offset );
 
 		/* Copy line */
-		copy_from_user ( ( line + len ), image->data, script_offset,
-				 frag_len );
+		memmove ( ( text + len ), ( text + offset ), frag_len );
 		len += frag_len;
 
 		/* Move to next line in script */
-		script_offset += ( frag_len + 1 );
+		offset += ( frag_len + 1 );
 
 		/* Strip trailing CR, if present */
-		if ( len && ( line[ len - 1 ] == '\r' ) )
+		if ( ( len > start ) && ( text[ len - 1 ] == '\r' ) )
 			len--;
 
 		/* Handle backslash continuations */
-		if ( len && ( line[ len - 1 ] == '\\' ) ) {
+		if ( ( len > start ) && ( text[ len - 1 ] == '\\' ) ) {
 			len--;
-			rc = -EINVAL;
+			script->rc = -EINVAL;
 			continue;
 		}
+		script->rc = 0;
 
 		/* Terminate line */
-		line[len] = '\0';
+		text[len++] = '\0';
 
 		/* Split line into (optional) label and command */
-		command = line;
+		command = ( text + start );
 		while ( isspace ( *command ) )
 			command++;
 		if ( *command == ':' ) {
@@ -131,25 +218,60 @@ static int process_script ( struct image *image,
 			label = NULL;
 		}
 
-		/* Process line */
-		rc = process_line ( image, line_offset, label, command );
-		if ( terminate ( rc ) )
-			goto err_process;
+		/* Record line */
+		assert ( script->count < max_count );
+		line = &script->lines[ script->count++ ];
+		line->offset = line_offset;
+		line->label = label;
+		line->command = command;
 
-		/* Free line */
-		free ( line );
-		line = NULL;
-		len = 0;
+		/* Start next line */
+		line_offset = offset;
+		start = len;
 
-		/* Update line offset */
-		line_offset = script_offset;
+	} while ( offset < image->len );
 
-	} while ( script_offset < image->len );
+	/* Construct label index.  Lines are added in reverse order,
+	 * so that each hash chain is in ascending order and the first
+	 * occurrence of any duplicated label will be found first.
+	 */
+	for ( index = script->count ; index-- ; ) {
+		line = &script->lines[index];
+		if ( ! line->label )
+			continue;
+		bucket = &script->labels[ script_label_bucket ( line->label ) ];
+		line->next_label = *bucket;
+		*bucket = ( index + 1 );
+	}
+
+	DBGC ( image, "SCRIPT %s compiled %d lines\n",
+	       image->name, script->count );
+	return script;
 
- err_process:
+ err_alloc_text:
+	free ( script );
  err_alloc:
-	free ( line );
-	return rc;
+	return NULL;
+}
+
+/**
+ * Find label within compiled script
+ *
+ * @v script		Compiled script
+ * @v label		Label
+ * @ret index		Line index, or negative error
+ */
+static int script_find_label ( struct script *script, const char *label ) {
+	struct script_line *line;
+	unsigned int next;
+
+	for ( next = script->labels[ script_label_bucket ( label ) ] ; next ;
+	      next = line->next_label ) {
+		line = &script->lines[ next - 1 ];
+		if ( strcmp ( line->label, label ) == 0 )
+			return ( next - 1 );
+	}
+	return -ENOENT;
 }
 
 /**
@@ -165,26 +287,28 @@ static int terminate_on_exit_or_failure ( int rc ) {
 }
 
 /**
- * Execute script line
+ * Execute compiled script
  *
- * @v image		Script
- * @v offset		Offset within script
- * @v label		Label, or NULL
- * @v command		Command
+ * @v script		Compiled script
  * @ret rc		Return status code
  */
-static int script_exec_line ( struct image *image, size_t offset,
-			      const char *label __unused,
-			      const char *command ) {
+static int script_run ( struct script *script ) {
+	struct image *image = script->image;
+	struct script_line *line;
 	int rc;
 
-	DBGC ( image, "[%04zx] $ %s\n", offset, command );
+	/* Execute each line in turn */
+	for ( script_index = 0 ; script_index < script->count ; ) {
 
-	/* Execute command */
-	if ( ( rc = system ( command ) ) != 0 )
-		return rc;
+		/* Execute command */
+		line = &script->lines[ script_index++ ];
+		DBGC ( image, "[%04zx] $ %s\n", line->offset, line->command );
+		rc = system ( line->command );
+		if ( terminate_on_exit_or_failure ( rc ) )
+			return rc;
+	}
 
-	return 0;
+	return script->rc;
 }
 
 /**
@@ -194,7 +318,8 @@ static int script_exec_line ( struct image *image, size_t offset,
  * @ret rc		Return status code
  */
 static int script_exec ( struct image *image ) {
-	size_t saved_offset;
+	struct script *saved_script;
+	unsigned int saved_index;
 	int rc;
 
 	/* Temporarily de-register image, so that a "boot" command
@@ -203,14 +328,21 @@ static int script_exec ( struct image *image ) {
 	unregister_image ( image );
 
 	/* Preserve state of any currently-running script */
-	saved_offset = script_offset;
-
-	/* Process script */
-	rc = process_script ( image, script_exec_line,
-			      terminate_on_exit_or_failure );
+	saved_script = script;
+	saved_index = script_index;
+
+	/* Compile and execute script */
+	script = script_compile ( image );
+	if ( script ) {
+		rc = script_run ( script );
+		script_free ( script );
+	} else {
+		rc = -ENOMEM;
+	}
 
 	/* Restore saved state */
-	script_offset = saved_offset;
+	script = saved_script;
+	script_index = saved_index;
 
 	/* Re-register image (unless we have been replaced) */
 	if ( ! image->replacement )
@@ -268,50 +400,6 @@ static struct option_descriptor goto_opts[] = {};
 static struct command_descriptor goto_cmd =
 	COMMAND_DESC ( struct goto_options, goto_opts, 1, 1, "<label>" );
 
-/**
- * Current "goto" label
- *
- * Valid only during goto_exec().  Consider this part of a closure.
- */
-static const char *goto_label;
-
-/**
- * Check for presence of label
- *
- * @v image		Script
- * @v offset		Offset within script
- * @v label		Label
- * @v command		Command
- * @ret rc		Return status code
- */
-static int goto_find_label ( struct image *image, size_t offset,
-			     const char *label, const char *command __unused ) {
-
-	/* Check label exists */
-	if ( ! label )
-		return -ENOENT;
-
-	/* Check label matches */
-	if ( strcmp ( goto_label, label ) != 0 )
-		return -ENOENT;
-
-	/* Update script offset */
-	script_offset = offset;
-	DBGC ( image, "[%04zx] Gone to :%s\n", offset, label );
-
-	return 0;
-}
-
-/**
- * Terminate script processing when label is found
- *
- * @v rc		Line processing status
- * @ret terminate	Terminate script processing
- */
-static int terminate_on_label_found ( int rc ) {
-	return ( rc == 0 );
-}
-
 /**
  * "goto" command
  *
@@ -321,7 +409,8 @@ static int terminate_on_label_found ( int rc ) {
  */
 static int goto_exec ( int argc, char **argv ) {
 	struct goto_options opts;
-	size_t saved_offset;
+	const char *label;
+	int index;
 	int rc;
 
 	/* Parse options */
@@ -329,25 +418,30 @@ static int goto_exec ( int argc, char **argv ) {
 		return rc;
 
 	/* Sanity check */
-	if ( ! current_image ) {
+	if ( ! ( current_image && script &&
+		 ( script->image == current_image ) ) ) {
 		rc = -ENOTTY;
 		printf ( "Not in a script: %s\n", strerror ( rc ) );
 		return rc;
 	}
 
 	/* Parse label */
-	goto_label = argv[optind];
+	label = argv[optind];
 
 	/* Find label */
-	saved_offset = script_offset;
-	if ( ( rc = process_script ( current_image, goto_find_label,
-				     terminate_on_label_found ) ) != 0 ) {
-		script_offset = saved_offset;
+	index = script_find_label ( script, label );
+	if ( index < 0 ) {
+		rc = index;
 		DBGC ( current_image, "[%04zx] No such label :%s\n",
-		       script_offset, goto_label );
+		       script->lines[ script_index - 1 ].offset, label );
 		return rc;
 	}
 
+	/* Update script position */
+	script_index = index;
+	DBGC ( current_image, "[%04zx] Gone to :%s\n",
+	       script->lines[index].offset, label );
+
 	/* Terminate processing of current command */
 	shell_stop ( SHELL_STOP_COMMAND );
 
@@ -41,12 +41,15 @@ struct aes_context {
 	unsigned int rounds;
 };
 
+#include <bits/aes.h>
+
 /** AES context size */
 #define AES_CTX_SIZE sizeof ( struct aes_context )
 
 extern struct cipher_algorithm aes_algorithm;
 extern struct cipher_algorithm aes_ecb_algorithm;
 extern struct cipher_algorithm aes_cbc_algorithm;
+extern struct cipher_algorithm aes_gcm_algorithm;
 
 int aes_wrap ( const void *kek, const void *src, void *dest, int nblk );
 int aes_unwrap ( const void *kek, const void *src, void *dest, int nblk );
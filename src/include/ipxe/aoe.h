@@ -106,9 +106,17 @@ struct aoehdr {
 /** AoE tag magic marker */
 #define AOE_TAG_MAGIC 0x18ae0000
 
-/** Maximum number of sectors per packet */
+/** Default maximum number of sectors per packet */
 #define AOE_MAX_COUNT 2
 
+/** Maximum number of sectors per ATA command
+ *
+ * ATA commands are split into as many AoE commands as necessary, so
+ * this may be much larger than the number of sectors per packet.
+ * This should be large enough to keep the AoE window full.
+ */
+#define AOE_MAX_SECTORS 256
+
 /** AoE boot firmware table signature */
 #define ABFT_SIG ACPI_SIGNATURE ( 'a', 'B', 'F', 'T' )
 
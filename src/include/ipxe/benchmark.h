@@ -0,0 +1,72 @@
+#ifndef _IPXE_BENCHMARK_H
+#define _IPXE_BENCHMARK_H
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * Benchmark infrastructure
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <ipxe/tables.h>
+#include <ipxe/profile.h>
+
+/** A benchmark set */
+struct benchmark {
+	/** Benchmark set name */
+	const char *name;
+	/** Run benchmarks */
+	void ( * exec ) ( void );
+};
+
+/** Benchmark table */
+#define BENCHMARKS __table ( struct benchmark, "benchmarks" )
+
+/** Declare a benchmark set */
+#define __benchmark __table_entry ( BENCHMARKS, 01 )
+
+/** A benchmark measurement */
+struct bench_measurement {
+	/** Description */
+	char name[32];
+	/** Per-operation profiler */
+	struct profiler profiler;
+	/** Start time (in ticks) */
+	unsigned long started;
+	/** Elapsed time (in ticks) */
+	unsigned long elapsed;
+	/** Number of operations */
+	unsigned long count;
+	/** Number of bytes processed */
+	uint64_t len;
+};
+
+/** Number of operations between checks for measurement completion */
+#define BENCH_CHECK_INTERVAL 64
+
+extern void bench_start ( struct bench_measurement *bench,
+			  const char *fmt, ... )
+	__attribute__ (( format ( printf, 2, 3 ) ));
+extern int bench_check ( struct bench_measurement *bench );
+extern void bench_report ( struct bench_measurement *bench );
+
+/**
+ * Record completion of a benchmarked operation
+ *
+ * @v bench		Benchmark measurement
+ * @v len		Number of bytes processed by operation
+ * @ret more		Measurement should continue
+ */
+static inline __attribute__ (( always_inline )) int
+bench_continue ( struct bench_measurement *bench, size_t len ) {
+
+	bench->len += len;
+	if ( ( ++bench->count % BENCH_CHECK_INTERVAL ) != 0 )
+		return 1;
+	return bench_check ( bench );
+}
+
+#endif /* _IPXE_BENCHMARK_H */
@@ -238,6 +238,12 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 			     size, exponent_size, tmp );		\
 	} while ( 0 )
 
+/** Maximum window size (in bits) used for modular exponentiation */
+#define BIGINT_MOD_EXP_WINDOW 5
+
+/** Number of precalculated odd powers used for modular exponentiation */
+#define BIGINT_MOD_EXP_TABLE_LEN ( 1 << ( BIGINT_MOD_EXP_WINDOW - 1 ) )
+
 /**
  * Calculate temporary working space required for moduluar exponentiation
  *
@@ -253,6 +259,9 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 	sizeof ( struct {						\
 		bigint_t ( size ) temp_base;				\
 		bigint_t ( exponent_size ) temp_exponent;		\
+		bigint_t ( size ) temp_square;				\
+		bigint_t ( size * 2 ) temp_product;			\
+		bigint_t ( size ) temp_table[BIGINT_MOD_EXP_TABLE_LEN];	\
 		uint8_t mod_multiply[mod_multiply_len];			\
 	} ); } )
 
@@ -286,6 +295,10 @@ void bigint_multiply_raw ( const bigint_element_t *multiplicand0,
 			   const bigint_element_t *multiplier0,
 			   bigint_element_t *result0,
 			   unsigned int size );
+bigint_element_t
+bigint_multiply_accumulate_raw ( const bigint_element_t *multiplicand0,
+				 bigint_element_t multiplier,
+				 bigint_element_t *value0, unsigned int size );
 void bigint_mod_multiply_raw ( const bigint_element_t *multiplicand0,
 			       const bigint_element_t *multiplier0,
 			       const bigint_element_t *modulus0,
@@ -0,0 +1,20 @@
+#ifndef _IPXE_BOND_H
+#define _IPXE_BOND_H
+
+/** @file
+ *
+ * Link aggregation (bonding)
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+struct net_device;
+
+/** Maximum number of members within a bonded device */
+#define BOND_MAX_MEMBERS 8
+
+extern int bond_create ( struct net_device **members, unsigned int count );
+extern int bond_destroy ( struct net_device *netdev );
+
+#endif /* _IPXE_BOND_H */
@@ -18,5 +18,11 @@ extern struct x509_certificate * certstore_find ( struct asn1_cursor *raw );
 extern struct x509_certificate * certstore_find_key ( struct asn1_cursor *key );
 extern void certstore_add ( struct x509_certificate *cert );
 extern void certstore_del ( struct x509_certificate *cert );
+extern int certstore_is_validated ( struct x509_certificate *cert, time_t time,
+				    struct x509_root *root );
+extern void certstore_mark_validated ( struct x509_certificate *cert,
+				       struct x509_certificate *issuer,
+				       struct x509_root *root );
+extern void certstore_unmark_validated ( struct x509_certificate *cert );
 
 #endif /* _IPXE_CERTSTORE_H */
@@ -0,0 +1,66 @@
+#ifndef _IPXE_CHACHA20_H
+#define _IPXE_CHACHA20_H
+
+/** @file
+ *
+ * ChaCha20 stream cipher
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <ipxe/crypto.h>
+#include <ipxe/poly1305.h>
+
+/** ChaCha20 key length */
+#define CHACHA20_KEY_LEN 32
+
+/** ChaCha20 nonce length */
+#define CHACHA20_NONCE_LEN 12
+
+/** ChaCha20 initialisation vector length
+ *
+ * The raw ChaCha20 cipher takes an initialisation vector comprising
+ * the 32-bit little-endian initial block counter followed by the
+ * nonce.
+ */
+#define CHACHA20_IV_LEN ( 4 + CHACHA20_NONCE_LEN )
+
+/** ChaCha20 block size */
+#define CHACHA20_BLOCKSIZE 64
+
+/** Number of 32-bit words in ChaCha20 state */
+#define CHACHA20_WORDS ( CHACHA20_BLOCKSIZE / sizeof ( uint32_t ) )
+
+/** ChaCha20 context */
+struct chacha20_context {
+	/** Input state */
+	uint32_t state[CHACHA20_WORDS];
+	/** Current keystream block */
+	union {
+		/** Raw bytes */
+		uint8_t byte[CHACHA20_BLOCKSIZE];
+		/** Little-endian 32-bit words */
+		uint32_t word[CHACHA20_WORDS];
+	} stream;
+	/** Number of bytes of keystream block consumed */
+	unsigned int offset;
+};
+
+/** ChaCha20-Poly1305 context */
+struct chacha20_poly1305_context {
+	/** ChaCha20 context */
+	struct chacha20_context chacha20;
+	/** Poly1305 context */
+	struct poly1305_context poly1305;
+	/** Length of additional data */
+	uint64_t aad_len;
+	/** Length of encrypted data */
+	uint64_t data_len;
+};
+
+extern struct cipher_algorithm chacha20_algorithm;
+extern struct cipher_algorithm chacha20_poly1305_algorithm;
+
+#endif /* _IPXE_CHACHA20_H */
@@ -67,10 +67,40 @@ cms_put ( struct cms_signature *sig ) {
 	ref_put ( &sig->refcnt );
 }
 
+/** A precalculated digest of CMS-signed data */
+struct cms_digest {
+	/** Digest algorithm */
+	struct digest_algorithm *digest;
+	/** Digest value */
+	const void *value;
+};
+
 extern int cms_signature ( const void *data, size_t len,
 			   struct cms_signature **sig );
-extern int cms_verify ( struct cms_signature *sig, userptr_t data, size_t len,
-			const char *name, time_t time, struct x509_chain *store,
-			struct x509_root *root );
+extern int cms_verify_digested ( struct cms_signature *sig, userptr_t data,
+				 size_t len, const struct cms_digest *precalc,
+				 const char *name, time_t time,
+				 struct x509_chain *store,
+				 struct x509_root *root );
+
+/**
+ * Verify CMS signature
+ *
+ * @v sig		CMS signature
+ * @v data		Signed data
+ * @v len		Length of signed data
+ * @v name		Required common name, or NULL to check all signatures
+ * @v time		Time at which to validate certificates
+ * @v store		Certificate store, or NULL to use default
+ * @v root		Root certificate list, or NULL to use default
+ * @ret rc		Return status code
+ */
+static inline int cms_verify ( struct cms_signature *sig, userptr_t data,
+			       size_t len, const char *name, time_t time,
+			       struct x509_chain *store,
+			       struct x509_root *root ) {
+	return cms_verify_digested ( sig, data, len, NULL, name, time,
+				     store, root );
+}
 
 #endif /* _IPXE_CMS_H */
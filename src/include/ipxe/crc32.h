@@ -4,7 +4,9 @@
 FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 #include <stdint.h>
+#include <bits/crc32.h>
 
 u32 crc32_le ( u32 seed, const void *data, size_t len );
+u32 crc32c_le ( u32 seed, const void *data, size_t len );
 
 #endif
@@ -52,6 +52,12 @@ struct cipher_algorithm {
 	size_t ctxsize;
 	/** Block size */
 	size_t blocksize;
+	/** Authentication tag size
+	 *
+	 * This is zero for ciphers which do not provide
+	 * authenticated encryption.
+	 */
+	size_t authsize;
 	/** Set key
 	 *
 	 * @v ctx		Context
@@ -74,6 +80,10 @@ struct cipher_algorithm {
 	 * @v len		Length of data
 	 *
 	 * @v len is guaranteed to be a multiple of @c blocksize.
+	 *
+	 * For authenticated ciphers, a NULL @c dst indicates that @c
+	 * src is additional data to be authenticated but not
+	 * encrypted.
 	 */
 	void ( * encrypt ) ( void *ctx, const void *src, void *dst,
 			     size_t len );
@@ -85,9 +95,21 @@ struct cipher_algorithm {
 	 * @v len		Length of data
 	 *
 	 * @v len is guaranteed to be a multiple of @c blocksize.
+	 *
+	 * For authenticated ciphers, a NULL @c dst indicates that @c
+	 * src is additional data to be authenticated but not
+	 * decrypted.
 	 */
 	void ( * decrypt ) ( void *ctx, const void *src, void *dst,
 			     size_t len );
+	/** Generate authentication tag
+	 *
+	 * @v ctx		Context
+	 * @v auth		Authentication tag
+	 *
+	 * This method is present only for authenticated ciphers.
+	 */
+	void ( * auth ) ( void *ctx, void *auth );
 };
 
 /** A public key algorithm */
@@ -169,6 +191,27 @@ struct pubkey_algorithm {
 			  const void *public_key, size_t public_key_len );
 };
 
+/** An elliptic curve */
+struct elliptic_curve {
+	/** Curve name */
+	const char *name;
+	/** Point (and public key) size */
+	size_t pointsize;
+	/** Scalar (and private key) size */
+	size_t keysize;
+	/** Generator base point */
+	const void *base;
+	/** Multiply scalar by curve point
+	 *
+	 * @v base		Base point
+	 * @v scalar		Scalar multiple
+	 * @v result		Result point to fill in
+	 * @ret rc		Return status code
+	 */
+	int ( * multiply ) ( const void *base, const void *scalar,
+			     void *result );
+};
+
 static inline void digest_init ( struct digest_algorithm *digest,
 				 void *ctx ) {
 	digest->init ( ctx );
@@ -214,10 +257,19 @@ static inline void cipher_decrypt ( struct cipher_algorithm *cipher,
 	cipher_decrypt ( (cipher), (ctx), (src), (dst), (len) );	\
 	} while ( 0 )
 
+static inline void cipher_auth ( struct cipher_algorithm *cipher, void *ctx,
+				 void *auth ) {
+	cipher->auth ( ctx, auth );
+}
+
 static inline int is_stream_cipher ( struct cipher_algorithm *cipher ) {
 	return ( cipher->blocksize == 1 );
 }
 
+static inline int is_auth_cipher ( struct cipher_algorithm *cipher ) {
+	return ( cipher->authsize != 0 );
+}
+
 static inline int pubkey_init ( struct pubkey_algorithm *pubkey, void *ctx,
 				const void *key, size_t key_len ) {
 	return pubkey->init ( ctx, key, key_len );
@@ -263,6 +315,12 @@ static inline int pubkey_match ( struct pubkey_algorithm *pubkey,
 			       public_key_len );
 }
 
+static inline int elliptic_multiply ( struct elliptic_curve *curve,
+				      const void *base, const void *scalar,
+				      void *result ) {
+	return curve->multiply ( base, scalar, result );
+}
+
 extern struct digest_algorithm digest_null;
 extern struct cipher_algorithm cipher_null;
 extern struct pubkey_algorithm pubkey_null;
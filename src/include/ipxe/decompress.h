@@ -0,0 +1,92 @@
+#ifndef _IPXE_DECOMPRESS_H
+#define _IPXE_DECOMPRESS_H
+
+/** @file
+ *
+ * Streaming decompression
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <ipxe/tables.h>
+#include <ipxe/deflate.h>
+
+struct interface;
+
+/** A streaming decompression algorithm */
+struct decompressor {
+	/** Name */
+	const char *name;
+	/** Context size */
+	size_t ctxsize;
+	/** Initialise decompressor
+	 *
+	 * @v ctx		Context
+	 * @ret rc		Return status code
+	 */
+	int ( * init ) ( void *ctx );
+	/** Inflate compressed data
+	 *
+	 * @v ctx		Context
+	 * @v in		Compressed input data
+	 * @v out		Output data buffer
+	 * @ret rc		Return status code
+	 *
+	 * The decompressor must never write beyond the end of the
+	 * output buffer, and must return successfully if it requires
+	 * more input data or more output space in order to continue.
+	 */
+	int ( * inflate ) ( void *ctx, struct deflate_chunk *in,
+			    struct deflate_chunk *out );
+	/** Check if decompression has finished
+	 *
+	 * @v ctx		Context
+	 * @ret finished	Decompression has finished
+	 */
+	int ( * finished ) ( void *ctx );
+	/** Get required history length
+	 *
+	 * @v ctx		Context
+	 * @ret len		Length of output history that must be retained
+	 */
+	size_t ( * history ) ( void *ctx );
+	/** Finalise decompressor
+	 *
+	 * @v ctx		Context
+	 */
+	void ( * fini ) ( void *ctx );
+};
+
+/** Minimum free output space provided to a decompressor */
+#define DECOMPRESS_SPACE ( 128 * 1024 )
+
+/** Maximum length of a single delivered I/O buffer */
+#define DECOMPRESS_MAX_IOB ( 16 * 1024 )
+
+/** An automatically detected image compression format */
+struct image_decompressor {
+	/** Decompression algorithm */
+	struct decompressor *decompressor;
+	/** Magic signature */
+	const void *magic;
+	/** Length of magic signature */
+	size_t len;
+};
+
+/** Maximum length of an image compression format magic signature */
+#define DECOMPRESS_MAGIC_MAX 6
+
+/** Image compression format table */
+#define IMAGE_DECOMPRESSORS \
+	__table ( struct image_decompressor, "image_decompressors" )
+
+/** Declare an image compression format */
+#define __image_decompressor __table_entry ( IMAGE_DECOMPRESSORS, 01 )
+
+extern int decompress_filter ( struct interface *xfer,
+			       struct interface *source,
+			       struct decompressor *decompressor );
+
+#endif /* _IPXE_DECOMPRESS_H */
@@ -74,12 +74,20 @@ enum deflate_format {
 
 /** Quick lookup length for a Huffman symbol (in bits)
  *
- * This is a policy decision.
+ * This is a policy decision.  Symbols of up to this length can be
+ * decoded using a single table lookup.
  */
-#define DEFLATE_HUFFMAN_QL_BITS 7
+#define DEFLATE_HUFFMAN_QL_BITS 9
 
-/** Quick lookup shift */
-#define DEFLATE_HUFFMAN_QL_SHIFT ( 16 - DEFLATE_HUFFMAN_QL_BITS )
+/** Quick lookup table entry symbol length mask
+ *
+ * A zero length indicates that the symbol is longer than the quick
+ * lookup length.
+ */
+#define DEFLATE_HUFFMAN_QL_LEN_MASK 0x0f
+
+/** Quick lookup table entry raw symbol shift */
+#define DEFLATE_HUFFMAN_QL_RAW_SHIFT 4
 
 /** Literal/length end of block code */
 #define DEFLATE_LITLEN_END 256
@@ -93,6 +101,20 @@ enum deflate_format {
 /** Maximum value of a code length code */
 #define DEFLATE_CODELEN_MAX_CODE 18
 
+/** Minimum input data length for the fast decoding path
+ *
+ * The fast path refills its accumulator using a single unaligned
+ * 64-bit read.
+ */
+#define DEFLATE_FAST_IN_LEN sizeof ( uint64_t )
+
+/** Minimum output space for the fast decoding path
+ *
+ * The fast path must be able to write a maximum-length duplicated
+ * string, and may overrun the end of the string by up to one word.
+ */
+#define DEFLATE_FAST_OUT_LEN ( 258 + sizeof ( uint64_t ) )
+
 /** ZLIB header length (in bits) */
 #define ZLIB_HEADER_BITS 16
 
@@ -134,8 +156,12 @@ struct deflate_huf_symbols {
 struct deflate_alphabet {
 	/** Huffman-coded symbol set for each length */
 	struct deflate_huf_symbols huf[DEFLATE_HUFFMAN_BITS];
-	/** Quick lookup table */
-	uint8_t lookup[ 1 << DEFLATE_HUFFMAN_QL_BITS ];
+	/** Quick lookup table
+	 *
+	 * Indexed by the next (bit-reversed) input bits, and
+	 * containing the raw symbol and symbol length.
+	 */
+	uint16_t lookup[ 1 << DEFLATE_HUFFMAN_QL_BITS ];
 	/** Raw symbols
 	 *
 	 * Ordered by Huffman-coded symbol length, then by symbol
@@ -165,11 +191,6 @@ struct deflate {
 
 	/** Accumulator */
 	uint32_t accumulator;
-	/** Bit-reversed accumulator
-	 *
-	 * Don't ask.
-	 */
-	uint32_t rotalumucca;
 	/** Number of bits within the accumulator */
 	unsigned int bits;
 
@@ -279,5 +300,7 @@ extern void deflate_init ( struct deflate *deflate,
 extern int deflate_inflate ( struct deflate *deflate,
 			     struct deflate_chunk *in,
 			     struct deflate_chunk *out );
+extern size_t deflate_residue ( struct deflate *deflate, void *data,
+				size_t len );
 
 #endif /* _IPXE_DEFLATE_H */
@@ -114,6 +114,15 @@ struct root_driver {
 	 * Called from probe_devices() for all root devices in the build.
 	 */
 	int ( * probe ) ( struct root_device *rootdev );
+	/**
+	 * Probe devices skipped during initial probing (optional)
+	 *
+	 * @v rootdev	Root device
+	 *
+	 * Called from probe_skipped_devices() for all
+	 * successfully-probed root devices.
+	 */
+	void ( * probe_skipped ) ( struct root_device *rootdev );
 	/**
 	 * Remove root device
 	 *
@@ -170,6 +179,33 @@ static inline void devices_put ( void ) {
 	device_keep_count--;
 }
 
+extern int device_defer_count;
+
+/**
+ * Mark device initialisation as continuing in the background
+ *
+ * @v dev		Device
+ *
+ * A driver may complete slow parts of its initialisation (such as
+ * waiting for a firmware reset) from a background process, so that
+ * the initialisation of multiple devices can overlap.  The driver
+ * must call device_ready() once initialisation has completed (or
+ * been abandoned).
+ */
+static inline void device_defer ( struct device *dev __unused ) {
+	device_defer_count++;
+}
+
+/**
+ * Mark deferred device initialisation as complete
+ *
+ * @v dev		Device
+ */
+static inline void device_ready ( struct device *dev __unused ) {
+	device_defer_count--;
+}
+
+extern void probe_skipped_devices ( void );
 extern struct device * identify_device ( struct interface *intf );
 #define identify_device_TYPE( object_type ) \
 	typeof ( struct device * ( object_type ) )
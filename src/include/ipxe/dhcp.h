@@ -264,6 +264,14 @@ struct dhcp_client_id {
 /** User class identifier */
 #define DHCP_USER_CLASS_ID 77
 
+/** Rapid commit
+ *
+ * This option has no value.  A client includes it in a DHCPDISCOVER
+ * to indicate that it will accept an immediate DHCPACK, and a server
+ * includes it in such a DHCPACK (RFC 4039).
+ */
+#define DHCP_RAPID_COMMIT 80
+
 /** Client system architecture */
 #define DHCP_CLIENT_ARCHITECTURE 93
 
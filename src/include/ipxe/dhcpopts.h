@@ -31,6 +31,8 @@ struct dhcp_options {
 extern int dhcpopt_applies ( unsigned int tag );
 extern int dhcpopt_store ( struct dhcp_options *options, unsigned int tag,
 			   const void *data, size_t len );
+extern int dhcpopt_store_empty ( struct dhcp_options *options,
+				 unsigned int tag );
 extern int dhcpopt_fetch ( struct dhcp_options *options, unsigned int tag,
 			   void *data, size_t len );
 extern void dhcpopt_init ( struct dhcp_options *options,
@@ -11,6 +11,8 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 #include <stdint.h>
 #include <ipxe/in.h>
+#include <ipxe/list.h>
+#include <ipxe/timer.h>
 
 /** DNS server port */
 #define DNS_PORT 53
@@ -146,10 +148,55 @@ union dns_rr {
 	struct dns_rr_cname cname;
 };
 
+/** Maximum number of DNS cache entries
+ *
+ * This is a policy decision.
+ */
+#define DNS_CACHE_MAX 16
+
+/** Maximum DNS cache time to live (in seconds)
+ *
+ * This is a policy decision.
+ */
+#define DNS_CACHE_MAX_TTL 3600
+
+/** DNS negative cache time to live (in seconds)
+ *
+ * This is a policy decision.
+ */
+#define DNS_CACHE_NEGATIVE_TTL 30
+
+/** DNS resolution delay (as per RFC 8305 section 3) */
+#define DNS_RESOLUTION_DELAY ( TICKS_PER_SEC / 20 )
+
+/** A DNS cache entry */
+struct dns_cache_entry {
+	/** List of DNS cache entries */
+	struct list_head list;
+	/** Resolved address (for a positive entry) */
+	union {
+		struct sockaddr sa;
+		struct sockaddr_in sin;
+		struct sockaddr_in6 sin6;
+	} address;
+	/** Query type */
+	uint16_t qtype;
+	/** Status code (zero for a positive entry) */
+	int rc;
+	/** Expiry time (in ticks) */
+	unsigned long expiry;
+	/** Name as originally requested */
+	char name[0];
+};
+
+extern struct list_head dns_cache;
+
 extern int dns_encode ( const char *string, struct dns_name *name );
 extern int dns_decode ( struct dns_name *name, char *data, size_t len );
 extern int dns_compare ( struct dns_name *first, struct dns_name *second );
 extern int dns_copy ( struct dns_name *src, struct dns_name *dst );
 extern int dns_skip ( struct dns_name *name );
+extern void dns_cache_expire ( void );
+extern void dns_cache_flush ( void );
 
 #endif /* _IPXE_DNS_H */
@@ -11,7 +11,11 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 struct interface;
 struct image;
+struct digest_algorithm;
 
 extern int create_downloader ( struct interface *job, struct image *image );
+extern void downloader_cache ( struct image *image );
+extern struct image * downloader_cached ( struct digest_algorithm *digest,
+					  const void *value );
 
 #endif /* _IPXE_DOWNLOADER_H */
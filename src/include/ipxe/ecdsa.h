@@ -0,0 +1,34 @@
+#ifndef _IPXE_ECDSA_H
+#define _IPXE_ECDSA_H
+
+/** @file
+ *
+ * Elliptic curve digital signature algorithm (ECDSA)
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <ipxe/crypto.h>
+#include <ipxe/p256.h>
+
+/** Maximum length of a DER-encoded ECDSA signature
+ *
+ * A signature is a SEQUENCE of two INTEGERs, each of which may
+ * require an additional leading zero byte.
+ */
+#define ECDSA_MAX_SIGNATURE_LEN ( 2 + 2 * ( 2 + 1 + P256_SIZE ) )
+
+/** An ECDSA context */
+struct ecdsa_context {
+	/** Public key point (in uncompressed form) */
+	uint8_t public[P256_POINT_SIZE];
+};
+
+/** ECDSA context size */
+#define ECDSA_CTX_SIZE sizeof ( struct ecdsa_context )
+
+extern struct pubkey_algorithm ecdsa_algorithm;
+
+#endif /* _IPXE_ECDSA_H */
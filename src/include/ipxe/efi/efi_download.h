@@ -121,6 +121,50 @@ EFI_STATUS
   IN EFI_STATUS Status
   );
 
+/**
+ * Start downloading a file directly into a caller-supplied buffer.
+ *
+ * Received data is written directly to Buffer at its offset within the
+ * file, without invoking the Data callback for each packet.  The Data
+ * callback is instead invoked with a pointer into Buffer describing a
+ * contiguous range of newly written data, once at least Granularity
+ * bytes have accumulated (or when data arrives out of order), and
+ * once more for any remaining data before the Finish callback.  A
+ * Granularity of zero requests a single callback upon completion.
+ *
+ * The download fails with EFI_BUFFER_TOO_SMALL if the file does not
+ * fit within the buffer.
+ *
+ * While any such download is in progress, iPXE will run its network
+ * stack from a periodic timer event at TPL_CALLBACK, and so the
+ * client does not need to call Poll.  Callbacks may therefore be
+ * invoked at TPL_CALLBACK.
+ *
+ * @v This		iPXE Download Protocol instance
+ * @v Url		URL to download from
+ * @v Buffer		Buffer to receive data
+ * @v BufferLength	Length of buffer
+ * @v Granularity	Minimum length of data per Data callback
+ * @v DataCallback	Callback that will be invoked when data arrives
+ * @v FinishCallback	Callback that will be invoked when the download ends
+ * @v Context		Context passed to the Data and Finish callbacks
+ * @v File		Token that can be used to abort the download
+ * @ret Status		EFI status code
+ */
+typedef
+EFI_STATUS
+(EFIAPI *IPXE_DOWNLOAD_START_BUFFER)(
+  IN IPXE_DOWNLOAD_PROTOCOL *This,
+  IN CHAR8 *Url,
+  IN VOID *Buffer,
+  IN UINTN BufferLength,
+  IN UINTN Granularity,
+  IN IPXE_DOWNLOAD_DATA_CALLBACK DataCallback,
+  IN IPXE_DOWNLOAD_FINISH_CALLBACK FinishCallback,
+  IN VOID *Context,
+  OUT IPXE_DOWNLOAD_FILE *File
+  );
+
 /**
  * Poll for more data from iPXE. This function will invoke the registered
  * callbacks if data is available or if downloads complete.
@@ -139,11 +183,15 @@ EFI_STATUS
  *
  * iPXE will attach a iPXE Download Protocol to the DeviceHandle in the Loaded
  * Image Protocol of all child EFI applications.
+ *
+ * The StartBuffer member is present only if the protocol was located
+ * via IPXE_DOWNLOAD_PROTOCOL_V2_GUID.
  */
 struct _IPXE_DOWNLOAD_PROTOCOL {
    IPXE_DOWNLOAD_START Start;
    IPXE_DOWNLOAD_ABORT Abort;
    IPXE_DOWNLOAD_POLL Poll;
+   IPXE_DOWNLOAD_START_BUFFER StartBuffer;
 };
 
 #define IPXE_DOWNLOAD_PROTOCOL_GUID \
@@ -151,6 +199,11 @@ struct _IPXE_DOWNLOAD_PROTOCOL {
     0x3eaeaebd, 0xdecf, 0x493b, { 0x9b, 0xd1, 0xcd, 0xb2, 0xde, 0xca, 0xe7, 0x19 } \
   }
 
+#define IPXE_DOWNLOAD_PROTOCOL_V2_GUID \
+  { \
+    0x5c5bb0f1, 0x8c3e, 0x4d5a, { 0xa4, 0x1b, 0x6e, 0x27, 0x90, 0xd3, 0x4f, 0x82 } \
+  }
+
 extern int efi_download_install ( EFI_HANDLE handle );
 extern void efi_download_uninstall ( EFI_HANDLE handle );
 
@@ -23,6 +23,14 @@ FILE_LICENCE ( GPL2_OR_LATER );
 /** SNP transmit completion ring size */
 #define EFI_SNP_NUM_TX 32
 
+/** SNP maximum receive queue length
+ *
+ * Received packets are held until retrieved by the SNP consumer.
+ * This limit prevents a consumer that never retrieves packets from
+ * exhausting the heap.
+ */
+#define EFI_SNP_MAX_RX 256
+
 /** An SNP device */
 struct efi_snp_device {
 	/** List of SNP devices */
@@ -49,6 +57,8 @@ struct efi_snp_device {
 	unsigned int tx_cons;
 	/** Receive queue */
 	struct list_head rx;
+	/** Receive queue length */
+	unsigned int rx_count;
 	/** The network interface identifier */
 	EFI_NETWORK_INTERFACE_IDENTIFIER_PROTOCOL nii;
 	/** Component name protocol */
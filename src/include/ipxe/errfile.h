@@ -74,6 +74,15 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #define ERRFILE_efi_block	       ( ERRFILE_CORE | 0x00220000 )
 #define ERRFILE_sanboot		       ( ERRFILE_CORE | 0x00230000 )
 #define ERRFILE_dummy_sanboot	       ( ERRFILE_CORE | 0x00240000 )
+#define ERRFILE_trace		       ( ERRFILE_CORE | 0x00250000 )
+#define ERRFILE_decompress	       ( ERRFILE_CORE | 0x00260000 )
+#define ERRFILE_rsfec		       ( ERRFILE_CORE | 0x00270000 )
+#define ERRFILE_bench		       ( ERRFILE_CORE | 0x00280000 )
+#define ERRFILE_worker		       ( ERRFILE_CORE | 0x00290000 )
+#define ERRFILE_sampler		       ( ERRFILE_CORE | 0x002a0000 )
+#define ERRFILE_cachedhcp	       ( ERRFILE_CORE | 0x002b0000 )
+#define ERRFILE_hrclock		       ( ERRFILE_CORE | 0x002c0000 )
+#define ERRFILE_imgblock	       ( ERRFILE_CORE | 0x002d0000 )
 
 #define ERRFILE_eisa		     ( ERRFILE_DRIVER | 0x00000000 )
 #define ERRFILE_isa		     ( ERRFILE_DRIVER | 0x00010000 )
@@ -281,6 +290,18 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #define ERRFILE_xsigo			( ERRFILE_NET | 0x00480000 )
 #define ERRFILE_ntp			( ERRFILE_NET | 0x00490000 )
 #define ERRFILE_httpntlm		( ERRFILE_NET | 0x004a0000 )
+#define ERRFILE_httpmulti		( ERRFILE_NET | 0x004b0000 )
+#define ERRFILE_newreno			( ERRFILE_NET | 0x004c0000 )
+#define ERRFILE_http2			( ERRFILE_NET | 0x004d0000 )
+#define ERRFILE_hpack			( ERRFILE_NET | 0x004e0000 )
+#define ERRFILE_peerserv		( ERRFILE_NET | 0x004f0000 )
+#define ERRFILE_alc			( ERRFILE_NET | 0x00500000 )
+#define ERRFILE_httpblock		( ERRFILE_NET | 0x00510000 )
+#define ERRFILE_httpcache		( ERRFILE_NET | 0x00520000 )
+#define ERRFILE_fragment		( ERRFILE_NET | 0x00530000 )
+#define ERRFILE_bond			( ERRFILE_NET | 0x00540000 )
+#define ERRFILE_syslog			( ERRFILE_NET | 0x00550000 )
+#define ERRFILE_pcap			( ERRFILE_NET | 0x00560000 )
 
 #define ERRFILE_image		      ( ERRFILE_IMAGE | 0x00000000 )
 #define ERRFILE_elf		      ( ERRFILE_IMAGE | 0x00010000 )
@@ -375,6 +396,32 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #define ERRFILE_cert_cmd	      ( ERRFILE_OTHER | 0x004f0000 )
 #define ERRFILE_acpi_settings	      ( ERRFILE_OTHER | 0x00500000 )
 #define ERRFILE_ntlm		      ( ERRFILE_OTHER | 0x00510000 )
+#define ERRFILE_tracemgmt	      ( ERRFILE_OTHER | 0x00520000 )
+#define ERRFILE_x25519		      ( ERRFILE_OTHER | 0x00530000 )
+#define ERRFILE_p256		      ( ERRFILE_OTHER | 0x00540000 )
+#define ERRFILE_ecdsa		      ( ERRFILE_OTHER | 0x00550000 )
+#define ERRFILE_certstore	      ( ERRFILE_OTHER | 0x00560000 )
+#define ERRFILE_gzip		      ( ERRFILE_OTHER | 0x00570000 )
+#define ERRFILE_zstd		      ( ERRFILE_OTHER | 0x00580000 )
+#define ERRFILE_xz		      ( ERRFILE_OTHER | 0x00590000 )
+#define ERRFILE_nslookup_cmd	      ( ERRFILE_OTHER | 0x005a0000 )
+#define ERRFILE_efi_cache	      ( ERRFILE_OTHER | 0x005b0000 )
+#define ERRFILE_bootsim		      ( ERRFILE_OTHER | 0x005c0000 )
+#define ERRFILE_bootsim_cmd	      ( ERRFILE_OTHER | 0x005d0000 )
+#define ERRFILE_efi_mp		      ( ERRFILE_OTHER | 0x005e0000 )
+#define ERRFILE_chacha20	      ( ERRFILE_OTHER | 0x005f0000 )
+#define ERRFILE_iperf		      ( ERRFILE_OTHER | 0x00600000 )
+#define ERRFILE_iperf_cmd	      ( ERRFILE_OTHER | 0x00610000 )
+#define ERRFILE_pcapmgmt	      ( ERRFILE_OTHER | 0x00620000 )
+#define ERRFILE_pcap_cmd	      ( ERRFILE_OTHER | 0x00630000 )
+#define ERRFILE_efi_sampler	      ( ERRFILE_OTHER | 0x00640000 )
+#define ERRFILE_samplemgmt	      ( ERRFILE_OTHER | 0x00650000 )
+#define ERRFILE_sample_cmd	      ( ERRFILE_OTHER | 0x00660000 )
+#define ERRFILE_efi_cachedhcp	      ( ERRFILE_OTHER | 0x00670000 )
+#define ERRFILE_efi_hrclock	      ( ERRFILE_OTHER | 0x00680000 )
+#define ERRFILE_sanput		      ( ERRFILE_OTHER | 0x00690000 )
+#define ERRFILE_worker_test	      ( ERRFILE_OTHER | 0x006a0000 )
+#define ERRFILE_decompress_test	      ( ERRFILE_OTHER | 0x006b0000 )
 
 /** @} */
 
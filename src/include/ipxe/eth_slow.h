@@ -9,6 +9,8 @@
 
 FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
+#include <ipxe/netdevice.h>
+
 /** Slow protocols header */
 struct eth_slow_header {
 	/** Slow protocols subtype */
@@ -258,4 +260,6 @@ union eth_slow_packet {
 	struct eth_slow_marker marker;
 } __attribute__ (( packed ));
 
+extern struct net_protocol eth_slow_protocol __net_protocol;
+
 #endif /* _IPXE_ETH_SLOW_H */
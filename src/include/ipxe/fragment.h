@@ -17,14 +17,53 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 /** Fragment reassembly timeout */
 #define FRAGMENT_TIMEOUT ( TICKS_PER_SEC / 2 )
 
+/** Maximum memory used by fragments awaiting reassembly
+ *
+ * This is sufficient to hold two concurrent maximum-sized datagrams
+ * received via a standard Ethernet MTU.  When this limit is reached,
+ * the least recently started reassemblies will be discarded to make
+ * space for new fragments.
+ */
+#define FRAGMENT_MAX_USED ( 192 * 1024 )
+
+/** A received fragment */
+struct fragment_part {
+	/** List of received fragments */
+	struct list_head list;
+	/** I/O buffer */
+	struct io_buffer *iobuf;
+	/** Length of non-fragmentable portion of I/O buffer */
+	size_t hdrlen;
+	/** Offset of fragment data within reassembled packet */
+	size_t offset;
+	/** Length of fragment data */
+	size_t len;
+	/** Memory used by this fragment */
+	size_t used;
+};
+
 /** A fragment reassembly buffer */
 struct fragment {
 	/* List of fragment reassembly buffers */
 	struct list_head list;
-	/** Reassembled packet */
+	/** First received fragment
+	 *
+	 * This is used to identify subsequent fragments belonging to
+	 * the same packet, and is owned by the list of received
+	 * fragments.
+	 */
 	struct io_buffer *iobuf;
-	/** Length of non-fragmentable portion of reassembled packet */
+	/** Length of non-fragmentable portion of first received fragment */
 	size_t hdrlen;
+	/** Received fragments, in order of offset */
+	struct list_head parts;
+	/** Total length of received fragment data */
+	size_t len;
+	/** Length of reassembled packet data
+	 *
+	 * This is zero until the final fragment has been received.
+	 */
+	size_t total;
 	/** Reassembly timer */
 	struct retry_timer timer;
 	/** Fragment reassembler */
@@ -63,6 +102,8 @@ struct fragment_reassembler {
 	int ( * more_fragments ) ( struct io_buffer *iobuf, size_t hdrlen );
 	/** Associated IP statistics */
 	struct ip_statistics *stats;
+	/** Memory used by fragments awaiting reassembly */
+	size_t used;
 };
 
 extern struct io_buffer *
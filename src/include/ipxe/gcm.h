@@ -0,0 +1,146 @@
+#ifndef _IPXE_GCM_H
+#define _IPXE_GCM_H
+
+/** @file
+ *
+ * Galois/Counter Mode (GCM)
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <assert.h>
+#include <ipxe/crypto.h>
+
+/** GCM block size */
+#define GCM_BLOCKSIZE 16
+
+/** GCM initialisation vector length
+ *
+ * Only the recommended 96-bit initialisation vector length is
+ * supported.
+ */
+#define GCM_IV_LEN 12
+
+/** GCM authentication tag length */
+#define GCM_AUTH_LEN GCM_BLOCKSIZE
+
+/** A GCM block */
+union gcm_block {
+	/** Raw bytes */
+	uint8_t byte[GCM_BLOCKSIZE];
+	/** Big-endian 32-bit words */
+	uint32_t word[ GCM_BLOCKSIZE / sizeof ( uint32_t ) ];
+	/** Big-endian 64-bit words */
+	uint64_t dword[ GCM_BLOCKSIZE / sizeof ( uint64_t ) ];
+};
+
+/** A GCM hash key multiplication table
+ *
+ * This holds the products of the hash key with each possible 4-bit
+ * value, allowing GHASH to process four bits per table lookup.
+ */
+struct gcm_table {
+	/** High 64 bits of each product */
+	uint64_t hi[16];
+	/** Low 64 bits of each product */
+	uint64_t lo[16];
+};
+
+/** GCM context */
+struct gcm_context {
+	/** Accumulated hash (X) */
+	union gcm_block hash;
+	/** Counter (Y) */
+	union gcm_block ctr;
+	/** Encrypted initial counter block */
+	union gcm_block mask;
+	/** Current keystream block */
+	union gcm_block stream;
+	/** Length of additional data */
+	uint64_t aad_len;
+	/** Length of encrypted data */
+	uint64_t data_len;
+	/** Hash key (H) */
+	union gcm_block hkey;
+	/** Hash key multiplication table */
+	struct gcm_table key;
+};
+
+#include <bits/gcm.h>
+
+extern int gcm_setkey ( void *ctx, const void *key, size_t keylen,
+			struct cipher_algorithm *raw_cipher,
+			struct gcm_context *gcm_ctx );
+extern void gcm_setiv ( void *ctx, const void *iv,
+			struct cipher_algorithm *raw_cipher,
+			struct gcm_context *gcm_ctx );
+extern void gcm_encrypt ( void *ctx, const void *src, void *dst,
+			  size_t len, struct cipher_algorithm *raw_cipher,
+			  struct gcm_context *gcm_ctx );
+extern void gcm_decrypt ( void *ctx, const void *src, void *dst,
+			  size_t len, struct cipher_algorithm *raw_cipher,
+			  struct gcm_context *gcm_ctx );
+extern void gcm_auth ( void *ctx, void *auth,
+		       struct cipher_algorithm *raw_cipher,
+		       struct gcm_context *gcm_ctx );
+
+/**
+ * Create a GCM mode of behaviour of an existing cipher
+ *
+ * @v _gcm_name		Name for the new GCM cipher
+ * @v _gcm_cipher	New cipher algorithm
+ * @v _raw_cipher	Underlying cipher algorithm
+ * @v _raw_context	Context structure for the underlying cipher
+ * @v _blocksize	Cipher block size
+ */
+#define GCM_CIPHER( _gcm_name, _gcm_cipher, _raw_cipher, _raw_context,	\
+		    _blocksize )					\
+struct _gcm_name ## _context {						\
+	_raw_context raw_ctx;						\
+	struct gcm_context gcm_ctx;					\
+};									\
+static int _gcm_name ## _setkey ( void *ctx, const void *key,		\
+				  size_t keylen ) {			\
+	struct _gcm_name ## _context * _gcm_name ## _ctx = ctx;		\
+	linker_assert ( _blocksize == GCM_BLOCKSIZE,			\
+			_gcm_name ## _unsupported_blocksize );		\
+	return gcm_setkey ( &_gcm_name ## _ctx->raw_ctx, key, keylen,	\
+			    &_raw_cipher, &_gcm_name ## _ctx->gcm_ctx );\
+}									\
+static void _gcm_name ## _setiv ( void *ctx, const void *iv ) {		\
+	struct _gcm_name ## _context * _gcm_name ## _ctx = ctx;		\
+	gcm_setiv ( &_gcm_name ## _ctx->raw_ctx, iv,			\
+		    &_raw_cipher, &_gcm_name ## _ctx->gcm_ctx );	\
+}									\
+static void _gcm_name ## _encrypt ( void *ctx, const void *src,		\
+				    void *dst, size_t len ) {		\
+	struct _gcm_name ## _context * _gcm_name ## _ctx = ctx;		\
+	gcm_encrypt ( &_gcm_name ## _ctx->raw_ctx, src, dst, len,	\
+		      &_raw_cipher, &_gcm_name ## _ctx->gcm_ctx );	\
+}									\
+static void _gcm_name ## _decrypt ( void *ctx, const void *src,		\
+				    void *dst, size_t len ) {		\
+	struct _gcm_name ## _context * _gcm_name ## _ctx = ctx;		\
+	gcm_decrypt ( &_gcm_name ## _ctx->raw_ctx, src, dst, len,	\
+		      &_raw_cipher, &_gcm_name ## _ctx->gcm_ctx );	\
+}									\
+static void _gcm_name ## _auth ( void *ctx, void *auth ) {		\
+	struct _gcm_name ## _context * _gcm_name ## _ctx = ctx;		\
+	gcm_auth ( &_gcm_name ## _ctx->raw_ctx, auth,			\
+		   &_raw_cipher, &_gcm_name ## _ctx->gcm_ctx );		\
+}									\
+struct cipher_algorithm _gcm_cipher = {					\
+	.name		= #_gcm_name,					\
+	.ctxsize	= sizeof ( struct _gcm_name ## _context ),	\
+	.blocksize	= 1,						\
+	.authsize	= GCM_AUTH_LEN,					\
+	.setkey		= _gcm_name ## _setkey,				\
+	.setiv		= _gcm_name ## _setiv,				\
+	.encrypt	= _gcm_name ## _encrypt,			\
+	.decrypt	= _gcm_name ## _decrypt,			\
+	.auth		= _gcm_name ## _auth,				\
+};
+
+#endif /* _IPXE_GCM_H */
@@ -0,0 +1,135 @@
+#ifndef _IPXE_GZIP_H
+#define _IPXE_GZIP_H
+
+/** @file
+ *
+ * gzip decompression
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <ipxe/deflate.h>
+#include <ipxe/decompress.h>
+
+/** gzip member header */
+struct gzip_header {
+	/** Magic number */
+	uint16_t magic;
+	/** Compression method */
+	uint8_t method;
+	/** Flags */
+	uint8_t flags;
+	/** Modification time */
+	uint32_t mtime;
+	/** Extra flags */
+	uint8_t xfl;
+	/** Operating system */
+	uint8_t os;
+} __attribute__ (( packed ));
+
+/** gzip magic number */
+#define GZIP_MAGIC 0x8b1f
+
+/** gzip DEFLATE compression method */
+#define GZIP_METHOD_DEFLATE 8
+
+/** gzip header CRC present */
+#define GZIP_FHCRC 0x02
+
+/** gzip extra field present */
+#define GZIP_FEXTRA 0x04
+
+/** gzip original file name present */
+#define GZIP_FNAME 0x08
+
+/** gzip file comment present */
+#define GZIP_FCOMMENT 0x10
+
+/** gzip reserved flags */
+#define GZIP_RESERVED 0xe0
+
+/** gzip member footer */
+struct gzip_footer {
+	/** CRC32 of uncompressed data */
+	uint32_t crc;
+	/** Length of uncompressed data (modulo 2^32) */
+	uint32_t len;
+} __attribute__ (( packed ));
+
+/** gzip history length
+ *
+ * This is the maximum DEFLATE back-reference distance.
+ */
+#define GZIP_HISTORY ( 32 * 1024 )
+
+/** Decompressor state */
+enum gzip_state {
+	/** Awaiting member header */
+	GZIP_STATE_HEADER = 0,
+	/** Awaiting extra field length */
+	GZIP_STATE_EXTRA_LEN,
+	/** Skipping extra field */
+	GZIP_STATE_EXTRA,
+	/** Skipping original file name */
+	GZIP_STATE_NAME,
+	/** Skipping file comment */
+	GZIP_STATE_COMMENT,
+	/** Skipping header CRC */
+	GZIP_STATE_HCRC,
+	/** Decompressing data */
+	GZIP_STATE_DATA,
+	/** Awaiting member footer */
+	GZIP_STATE_FOOTER,
+};
+
+/** Decompressor */
+struct gzip {
+	/** Current state */
+	enum gzip_state state;
+	/** At least one member header has been seen */
+	int started;
+	/** Header accumulation buffer */
+	union {
+		/** Member header */
+		struct gzip_header header;
+		/** Member footer */
+		struct gzip_footer footer;
+		/** Extra field length */
+		uint16_t extra_len;
+		/** Raw bytes */
+		uint8_t bytes[ sizeof ( struct gzip_header ) ];
+	} __attribute__ (( packed )) buf;
+	/** Length of accumulated header */
+	size_t buf_len;
+	/** Member flags */
+	unsigned int flags;
+	/** Remaining length of extra field */
+	size_t remaining;
+	/** CRC32 of uncompressed data */
+	uint32_t crc;
+	/** Length of uncompressed data */
+	uint32_t len;
+	/** DEFLATE decompressor */
+	struct deflate deflate;
+};
+
+/**
+ * Check if decompression has finished
+ *
+ * @v gzip		Decompressor
+ * @ret finished	Decompression has finished
+ */
+static inline int gzip_finished ( struct gzip *gzip ) {
+	return ( gzip->started && ( gzip->state == GZIP_STATE_HEADER ) &&
+		 ( gzip->buf_len == 0 ) );
+}
+
+extern void gzip_init ( struct gzip *gzip );
+extern int gzip_inflate ( struct gzip *gzip, struct deflate_chunk *in,
+			  struct deflate_chunk *out );
+
+extern struct decompressor gzip_decompressor;
+
+#endif /* _IPXE_GZIP_H */
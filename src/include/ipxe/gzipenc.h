@@ -0,0 +1,59 @@
+#ifndef _IPXE_GZIPENC_H
+#define _IPXE_GZIPENC_H
+
+/** @file
+ *
+ * gzip compression
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <ipxe/gzip.h>
+
+/** Number of compressor hash table entries (log2) */
+#define GZIPENC_HASH_ORDER 13
+
+/** Number of compressor hash table entries */
+#define GZIPENC_HASH_SIZE ( 1 << GZIPENC_HASH_ORDER )
+
+/** Compressor */
+struct gzip_encoder {
+	/** Member header has been produced */
+	int started;
+	/** CRC32 of uncompressed data */
+	uint32_t crc;
+	/** Length of uncompressed data */
+	uint32_t len;
+	/** Pending output bits */
+	uint32_t bits;
+	/** Number of pending output bits */
+	unsigned int bit_count;
+	/** Output buffer */
+	uint8_t *out;
+	/** Most recent position (plus one) of each hashed triplet */
+	uint32_t head[GZIPENC_HASH_SIZE];
+};
+
+/**
+ * Calculate maximum compressed length
+ *
+ * @v len		Length of uncompressed data
+ * @ret max_len		Maximum length of compressed data
+ *
+ * A fixed-Huffman literal occupies at most nine bits.  We allow for
+ * the member header and footer, two block headers, an end-of-block
+ * code and any pending bits.
+ */
+static inline __attribute__ (( always_inline )) size_t
+gzip_encode_max_len ( size_t len ) {
+	return ( len + ( ( len + 7 ) / 8 ) + sizeof ( struct gzip_header ) +
+		 sizeof ( struct gzip_footer ) + 8 );
+}
+
+extern void gzip_encode_init ( struct gzip_encoder *enc );
+extern size_t gzip_encode ( struct gzip_encoder *enc, const void *data,
+			    size_t len, void *out, int final );
+
+#endif /* _IPXE_GZIPENC_H */
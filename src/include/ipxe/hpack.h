@@ -0,0 +1,93 @@
+#ifndef _IPXE_HPACK_H
+#define _IPXE_HPACK_H
+
+/** @file
+ *
+ * HPACK header compression for HTTP/2
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <ipxe/list.h>
+
+/** An HPACK dynamic table entry */
+struct hpack_entry {
+	/** List of entries (most recently added first) */
+	struct list_head list;
+	/** Entry size (as defined by RFC 7541) */
+	size_t size;
+	/** Value (NUL-terminated) */
+	char *value;
+	/** Name (NUL-terminated) */
+	char name[0];
+};
+
+/** Per-entry overhead used when calculating dynamic table sizes */
+#define HPACK_ENTRY_OVERHEAD 32
+
+/** Default maximum size of the dynamic table */
+#define HPACK_DEFAULT_TABLE_SIZE 4096
+
+/** An HPACK dynamic table */
+struct hpack_table {
+	/** List of entries (most recently added first) */
+	struct list_head entries;
+	/** Total size of all entries */
+	size_t used;
+	/** Current maximum size */
+	size_t size;
+	/** Maximum size permitted by protocol settings */
+	size_t limit;
+};
+
+/** Number of entries in the HPACK static table */
+#define HPACK_STATIC_COUNT 61
+
+/** Maximum length of an HPACK Huffman code */
+#define HPACK_HUFFMAN_MAX_LEN 30
+
+/** HPACK indexed header field representation */
+#define HPACK_INDEXED 0x80
+
+/** HPACK literal header field with incremental indexing */
+#define HPACK_LITERAL_INDEXED 0x40
+
+/** HPACK dynamic table size update */
+#define HPACK_SIZE_UPDATE 0x20
+
+/** HPACK literal header field never indexed */
+#define HPACK_LITERAL_NEVER 0x10
+
+/** HPACK literal header field without indexing */
+#define HPACK_LITERAL 0x00
+
+/** HPACK Huffman-encoded string */
+#define HPACK_HUFFMAN 0x80
+
+/**
+ * Initialise HPACK dynamic table
+ *
+ * @v table		Dynamic table
+ * @v limit		Maximum size permitted by protocol settings
+ */
+static inline __attribute__ (( always_inline )) void
+hpack_init ( struct hpack_table *table, size_t limit ) {
+
+	INIT_LIST_HEAD ( &table->entries );
+	table->used = 0;
+	table->size = limit;
+	table->limit = limit;
+}
+
+extern void hpack_fini ( struct hpack_table *table );
+extern int hpack_decode ( struct hpack_table *table, const void *data,
+			  size_t len,
+			  int ( * header ) ( void *opaque, const char *name,
+					     const char *value ),
+			  void *opaque );
+extern size_t hpack_encode ( void *data, const char *name, size_t name_len,
+			     const char *value, size_t value_len );
+
+#endif /* _IPXE_HPACK_H */
@@ -0,0 +1,74 @@
+#ifndef _IPXE_HRCLOCK_H
+#define _IPXE_HRCLOCK_H
+
+/** @file
+ *
+ * High-resolution monotonic clock
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <ipxe/tables.h>
+
+/** Number of nanoseconds per second */
+#define NSECS_PER_SEC 1000000000ULL
+
+/** Number of microseconds to use for clock calibration */
+#define HRCLOCK_CALIBRATE_US 10000
+
+/** A high-resolution clock source */
+struct hrclock {
+	/** Name */
+	const char *name;
+	/**
+	 * Probe clock source
+	 *
+	 * @ret hz		Counter frequency (in Hz)
+	 * @ret rc		Return status code
+	 */
+	int ( * probe ) ( uint64_t *hz );
+	/**
+	 * Read counter
+	 *
+	 * @ret count		Current counter value
+	 *
+	 * The counter must increase monotonically at a fixed rate,
+	 * and must not wrap within a realistic timescale.
+	 */
+	uint64_t ( * read ) ( void );
+};
+
+/** High-resolution clock source table */
+#define HRCLOCKS __table ( struct hrclock, "hrclocks" )
+
+/** Declare a high-resolution clock source */
+#define __hrclock( order ) __table_entry ( HRCLOCKS, order )
+
+/** @defgroup hrclock_order High-resolution clock source detection order
+ *
+ * @{
+ */
+
+#define HRCLOCK_PREFERRED	01	/**< Preferred clock source */
+#define HRCLOCK_NORMAL		02	/**< Normal clock source */
+#define HRCLOCK_FALLBACK	03	/**< Fallback clock source */
+
+/** @} */
+
+extern uint64_t hrclock_calibrate ( uint64_t ( * read ) ( void ) );
+extern uint64_t hrclock_ns ( void );
+
+/**
+ * Get current high-resolution time in microseconds
+ *
+ * @ret usecs		Current time, in microseconds
+ */
+static inline __attribute__ (( always_inline )) uint64_t
+hrclock_us ( void ) {
+
+	return ( hrclock_ns() / 1000 );
+}
+
+#endif /* _IPXE_HRCLOCK_H */
@@ -21,6 +21,8 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/ntlm.h>
 
 struct http_transaction;
+struct xfer_buffer;
+struct image;
 
 /******************************************************************************
  *
@@ -88,8 +90,72 @@ struct http_connection {
 	struct interface xfer;
 	/** Pooled connection */
 	struct pooled_connection pool;
+	/** List of connections accepting pipelined requests */
+	struct list_head list;
+	/** Pipelined requests awaiting responses */
+	struct list_head pipeline;
+	/** Flags */
+	unsigned int flags;
+	/** Network device scope ID, or zero to use any network device */
+	unsigned int scope_id;
+};
+
+/** HTTP connection flags */
+enum http_connection_flags {
+	/** Connection may accept pipelined requests */
+	HTTP_CONN_PIPELINE = 0x0001,
+	/** Current request has been transmitted */
+	HTTP_CONN_SENT = 0x0002,
+	/** Application-layer protocol negotiation is complete */
+	HTTP_CONN_NEGOTIATED = 0x0004,
+	/** Server has indicated support for persistent connections */
+	HTTP_CONN_PERSISTENT = 0x0008,
+};
+
+/** Maximum number of pipelined requests per HTTP connection */
+#define HTTP_CONN_PIPELINE_MAX 8
+
+/** An alternative HTTP application-layer protocol
+ *
+ * An alternative protocol (such as HTTP/2) may be negotiated during
+ * the TLS handshake.  Requests made before negotiation is complete
+ * are queued on the new connection, and will be handed over to the
+ * alternative protocol if it is selected by the server.
+ */
+struct http_protocol {
+	/** Protocol name (as used for application-layer protocol
+	 * negotiation)
+	 */
+	const char *name;
+	/** Attach request to an existing connection
+	 *
+	 * @v xfer		Data transfer interface
+	 * @v scheme		HTTP scheme
+	 * @v uri		Server URI
+	 * @v port		Server port
+	 * @ret attached	Request was attached, or negative error
+	 *
+	 * Returns zero if there is no suitable existing connection.
+	 */
+	int ( * connect ) ( struct interface *xfer, struct http_scheme *scheme,
+			    struct uri *uri, unsigned int port );
+	/** Take over newly negotiated connection, if applicable
+	 *
+	 * @v conn		HTTP connection
+	 * @ret upgraded	Connection was taken over, or negative error
+	 *
+	 * On success, the connection's transport layer interface
+	 * will have been unplugged.
+	 */
+	int ( * upgrade ) ( struct http_connection *conn );
 };
 
+/** HTTP application-layer protocol table */
+#define HTTP_PROTOCOLS __table ( struct http_protocol, "http_protocols" )
+
+/** Declare an HTTP application-layer protocol */
+#define __http_protocol __table_entry ( HTTP_PROTOCOLS, 01 )
+
 /******************************************************************************
  *
  * HTTP methods
@@ -106,6 +172,7 @@ struct http_method {
 extern struct http_method http_head;
 extern struct http_method http_get;
 extern struct http_method http_post;
+extern struct http_method http_put;
 
 /******************************************************************************
  *
@@ -149,6 +216,39 @@ struct http_request_content {
 	const void *data;
 	/** Content length */
 	size_t len;
+	/** Content is streamed via the data transfer interface
+	 *
+	 * Streamed content is sent using chunked transfer encoding,
+	 * and is terminated by a delivery with the XFER_FL_OUT flag.
+	 */
+	int stream;
+};
+
+/** Maximum length of a streamed content chunk header
+ *
+ * This is the length of a 64-bit hexadecimal chunk length followed
+ * by a CRLF.
+ */
+#define HTTP_STREAM_HEADER_LEN ( 16 + 2 /* "\r\n" */ )
+
+/** Maximum length of a streamed content chunk trailer
+ *
+ * This is a CRLF terminating the chunk data, optionally followed by
+ * the final (empty) chunk.
+ */
+#define HTTP_STREAM_TRAILER_LEN ( 2 /* "\r\n" */ + 5 /* "0\r\n\r\n" */ )
+
+/** HTTP request resumption descriptor */
+struct http_request_resume {
+	/** Resumption offset, or zero if not resuming */
+	size_t offset;
+	/** Validator (strong entity tag or modification time), or NULL
+	 *
+	 * This is recorded from the original response, and is used
+	 * to ensure that a resumed transfer refers to the same
+	 * content.
+	 */
+	char *validator;
 };
 
 /** HTTP request Basic authentication descriptor */
@@ -189,6 +289,13 @@ struct http_request_auth_ntlm {
 struct http_request_auth {
 	/** Authentication scheme (if any) */
 	struct http_authentication *auth;
+	/** Authentication was sent preemptively
+	 *
+	 * A preemptively authenticated request uses a cached
+	 * challenge, and so may be retried if the server responds
+	 * with a new challenge.
+	 */
+	int preemptive;
 	/** Per-scheme information */
 	union {
 		/** Basic authentication descriptor */
@@ -220,6 +327,8 @@ struct http_request {
 	struct http_request_range range;
 	/** Content descriptor */
 	struct http_request_content content;
+	/** Resumption descriptor */
+	struct http_request_resume resume;
 	/** Authentication descriptor */
 	struct http_request_auth auth;
 };
@@ -263,10 +372,22 @@ struct http_response_transfer {
 struct http_response_content {
 	/** Content length (may be zero) */
 	size_t len;
+	/** Content range start (for partial content) */
+	size_t start;
 	/** Content encoding */
 	struct http_content_encoding *encoding;
 };
 
+/** HTTP response cache validator descriptor */
+struct http_response_cache {
+	/** Entity tag (if any) */
+	const char *etag;
+	/** Last modification time (if any) */
+	const char *modified;
+	/** Maximum age in seconds (if HTTP_RESPONSE_MAX_AGE is set) */
+	unsigned long max_age;
+};
+
 /** HTTP response Basic authorization descriptor */
 struct http_response_auth_basic {
 };
@@ -344,6 +465,8 @@ struct http_response {
 	struct http_response_transfer transfer;
 	/** Content descriptor */
 	struct http_response_content content;
+	/** Cache validator descriptor */
+	struct http_response_cache cache;
 	/** Authorization descriptor */
 	struct http_response_auth auth;
 	/** Retry delay (in seconds) */
@@ -360,6 +483,16 @@ enum http_response_flags {
 	HTTP_RESPONSE_CONTENT_LEN = 0x0002,
 	/** Transaction may be retried on failure */
 	HTTP_RESPONSE_RETRY = 0x0004,
+	/** Content was restored from cache */
+	HTTP_RESPONSE_CACHED = 0x0008,
+	/** Content range start is present */
+	HTTP_RESPONSE_CONTENT_RANGE = 0x0010,
+	/** Maximum age is present */
+	HTTP_RESPONSE_MAX_AGE = 0x0020,
+	/** Response must not be stored in any cache */
+	HTTP_RESPONSE_NO_STORE = 0x0040,
+	/** Server is temporarily overloaded */
+	HTTP_RESPONSE_OVERLOAD = 0x0080,
 };
 
 /** An HTTP response header */
@@ -445,6 +578,20 @@ struct http_transaction {
 	size_t len;
 	/** Chunk length remaining */
 	size_t remaining;
+	/** Content-decoded position */
+	size_t pos;
+	/** Number of resumption attempts without progress */
+	unsigned int resumes;
+	/** Number of retries due to server overload */
+	unsigned int overloads;
+	/** Cached redirection location (if any) */
+	struct uri *location;
+	/** Streamed request content is being transmitted */
+	int streaming;
+	/** Network device scope ID for connections, or zero to use
+	 * any network device
+	 */
+	unsigned int scope_id;
 };
 
 /******************************************************************************
@@ -540,8 +687,21 @@ struct http_authentication {
 	 */
 	int ( * format ) ( struct http_transaction *http, char *buf,
 			   size_t len );
+	/** Flags */
+	unsigned int flags;
 };
 
+/** HTTP authentication scheme may be used preemptively
+ *
+ * Schemes which are not tied to a particular connection may reuse a
+ * challenge received in response to an earlier request, avoiding
+ * the need for a further request and response.
+ */
+#define HTTP_AUTH_PREEMPTIVE 0x0001
+
+/** Number of cached HTTP authentication challenges */
+#define HTTP_AUTH_CACHE_SIZE 4
+
 /** HTTP authentication scheme table */
 #define HTTP_AUTHENTICATIONS \
 	__table ( struct http_authentication, "http_authentications" )
@@ -549,6 +709,58 @@ struct http_authentication {
 /** Declare an HTTP authentication scheme */
 #define __http_authentication __table_entry ( HTTP_AUTHENTICATIONS, 01 )
 
+/******************************************************************************
+ *
+ * Caching
+ *
+ ******************************************************************************
+ */
+
+/** A persistent HTTP image cache store */
+struct http_cache_store {
+	/** Name */
+	const char *name;
+	/** Look up cached validators
+	 *
+	 * @v uri		URI string
+	 * @v etag		Entity tag to fill in (if any)
+	 * @v modified		Last modification time to fill in (if any)
+	 * @ret rc		Return status code
+	 *
+	 * The caller is responsible for freeing the returned strings.
+	 */
+	int ( * lookup ) ( const char *uri, char **etag, char **modified );
+	/** Restore cached content
+	 *
+	 * @v uri		URI string
+	 * @v xferbuf		Data transfer buffer
+	 * @ret rc		Return status code
+	 */
+	int ( * restore ) ( const char *uri, struct xfer_buffer *xferbuf );
+	/** Save content to cache
+	 *
+	 * @v uri		URI string
+	 * @v etag		Entity tag, or NULL
+	 * @v modified		Last modification time, or NULL
+	 * @v image		Downloaded image
+	 * @ret rc		Return status code
+	 */
+	int ( * save ) ( const char *uri, const char *etag,
+			 const char *modified, struct image *image );
+	/** Discard cached content
+	 *
+	 * @v uri		URI string
+	 */
+	void ( * discard ) ( const char *uri );
+};
+
+/** Persistent HTTP image cache store table */
+#define HTTP_CACHE_STORES \
+	__table ( struct http_cache_store, "http_cache_stores" )
+
+/** Declare a persistent HTTP image cache store */
+#define __http_cache_store __table_entry ( HTTP_CACHE_STORES, 01 )
+
 /******************************************************************************
  *
  * General
@@ -557,10 +769,24 @@ struct http_authentication {
  */
 
 extern char * http_token ( char **line, char **value );
-extern int http_connect ( struct interface *xfer, struct uri *uri );
+extern int http_connect ( struct interface *xfer, struct uri *uri,
+			  int pipeline, unsigned int scope_id );
+extern int http_pushback ( struct interface *intf, struct io_buffer *iobuf );
+#define http_pushback_TYPE( object_type ) \
+	typeof ( int ( object_type, struct io_buffer *iobuf ) )
+extern int http_open_via ( struct interface *xfer, struct http_method *method,
+			   struct uri *uri, struct http_request_range *range,
+			   struct http_request_content *content,
+			   unsigned int scope_id );
 extern int http_open ( struct interface *xfer, struct http_method *method,
 		       struct uri *uri, struct http_request_range *range,
 		       struct http_request_content *content );
 extern int http_open_uri ( struct interface *xfer, struct uri *uri );
+extern int http_cache_response ( struct http_transaction *http );
+extern void http_auth_preempt ( struct http_transaction *http );
+extern struct uri * http_redirect_cached ( struct http_transaction *http );
+extern void http_redirect_record ( struct http_transaction *http,
+				   struct uri *location );
+extern int http_multi_open ( struct interface *xfer, struct uri *uri );
 
 #endif /* _IPXE_HTTP_H */
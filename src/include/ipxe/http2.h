@@ -0,0 +1,292 @@
+#ifndef _IPXE_HTTP2_H
+#define _IPXE_HTTP2_H
+
+/** @file
+ *
+ * Hyper Text Transfer Protocol version 2 (HTTP/2)
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <ipxe/refcnt.h>
+#include <ipxe/interface.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/process.h>
+#include <ipxe/retry.h>
+#include <ipxe/list.h>
+#include <ipxe/hpack.h>
+
+/** HTTP/2 application-layer protocol name */
+#define HTTP2_PROTOCOL "h2"
+
+/** HTTP/2 connection preface */
+#define HTTP2_PREFACE "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+
+/** An HTTP/2 frame header */
+struct http2_frame_header {
+	/** Payload length (24-bit big-endian) */
+	uint8_t len[3];
+	/** Frame type */
+	uint8_t type;
+	/** Flags */
+	uint8_t flags;
+	/** Stream identifier (top bit reserved) */
+	uint32_t stream;
+} __attribute__ (( packed ));
+
+/** Stream identifier mask */
+#define HTTP2_STREAM_MASK 0x7fffffffUL
+
+/** HTTP/2 DATA frame */
+#define HTTP2_DATA 0x00
+
+/** HTTP/2 HEADERS frame */
+#define HTTP2_HEADERS 0x01
+
+/** HTTP/2 PRIORITY frame */
+#define HTTP2_PRIORITY 0x02
+
+/** HTTP/2 RST_STREAM frame */
+#define HTTP2_RST_STREAM 0x03
+
+/** HTTP/2 SETTINGS frame */
+#define HTTP2_SETTINGS 0x04
+
+/** HTTP/2 PUSH_PROMISE frame */
+#define HTTP2_PUSH_PROMISE 0x05
+
+/** HTTP/2 PING frame */
+#define HTTP2_PING 0x06
+
+/** HTTP/2 GOAWAY frame */
+#define HTTP2_GOAWAY 0x07
+
+/** HTTP/2 WINDOW_UPDATE frame */
+#define HTTP2_WINDOW_UPDATE 0x08
+
+/** HTTP/2 CONTINUATION frame */
+#define HTTP2_CONTINUATION 0x09
+
+/** End of stream flag */
+#define HTTP2_END_STREAM 0x01
+
+/** Acknowledgement flag (SETTINGS and PING frames) */
+#define HTTP2_ACK 0x01
+
+/** End of header block flag */
+#define HTTP2_END_HEADERS 0x04
+
+/** Padded frame flag */
+#define HTTP2_PADDED 0x08
+
+/** Priority information present flag (HEADERS frames) */
+#define HTTP2_PRIORITY_INFO 0x20
+
+/** Length of priority information */
+#define HTTP2_PRIORITY_LEN 5
+
+/** An HTTP/2 setting */
+struct http2_setting {
+	/** Identifier */
+	uint16_t id;
+	/** Value */
+	uint32_t value;
+} __attribute__ (( packed ));
+
+/** Dynamic table size setting */
+#define HTTP2_SETTINGS_HEADER_TABLE_SIZE 0x0001
+
+/** Server push setting */
+#define HTTP2_SETTINGS_ENABLE_PUSH 0x0002
+
+/** Maximum concurrent streams setting */
+#define HTTP2_SETTINGS_MAX_CONCURRENT_STREAMS 0x0003
+
+/** Initial window size setting */
+#define HTTP2_SETTINGS_INITIAL_WINDOW_SIZE 0x0004
+
+/** Maximum frame size setting */
+#define HTTP2_SETTINGS_MAX_FRAME_SIZE 0x0005
+
+/** An HTTP/2 RST_STREAM frame payload */
+struct http2_rst_stream {
+	/** Error code */
+	uint32_t code;
+} __attribute__ (( packed ));
+
+/** An HTTP/2 GOAWAY frame payload */
+struct http2_goaway {
+	/** Last stream identifier */
+	uint32_t last;
+	/** Error code */
+	uint32_t code;
+} __attribute__ (( packed ));
+
+/** An HTTP/2 WINDOW_UPDATE frame payload */
+struct http2_window_update {
+	/** Window size increment (top bit reserved) */
+	uint32_t increment;
+} __attribute__ (( packed ));
+
+/** Length of an HTTP/2 PING frame payload */
+#define HTTP2_PING_LEN 8
+
+/** No error */
+#define HTTP2_NO_ERROR 0x00
+
+/** Protocol error */
+#define HTTP2_PROTOCOL_ERROR 0x01
+
+/** Internal error */
+#define HTTP2_INTERNAL_ERROR 0x02
+
+/** Flow control error */
+#define HTTP2_FLOW_CONTROL_ERROR 0x03
+
+/** Frame size error */
+#define HTTP2_FRAME_SIZE_ERROR 0x06
+
+/** Stream refused before any processing */
+#define HTTP2_REFUSED_STREAM 0x07
+
+/** Stream cancelled */
+#define HTTP2_CANCEL 0x08
+
+/** Header compression error */
+#define HTTP2_COMPRESSION_ERROR 0x09
+
+/** Default (and minimum) maximum frame size */
+#define HTTP2_DEFAULT_FRAME_SIZE 16384
+
+/** Largest permitted maximum frame size */
+#define HTTP2_MAX_FRAME_SIZE 0xffffffUL
+
+/** Default initial flow control window size */
+#define HTTP2_DEFAULT_WINDOW 65535
+
+/** Largest permitted flow control window size */
+#define HTTP2_MAX_WINDOW 0x7fffffffL
+
+/** Receive window size for each stream */
+#define HTTP2_RX_WINDOW ( 256 * 1024 )
+
+/** Receive window size for each connection */
+#define HTTP2_RX_CONN_WINDOW ( 1024 * 1024 )
+
+/** Maximum number of streams per connection
+ *
+ * Further concurrent requests will be made via a new connection.
+ */
+#define HTTP2_MAX_STREAMS 32
+
+/** Maximum length of a received header block */
+#define HTTP2_MAX_HEADER_BLOCK ( 64 * 1024 )
+
+/** An HTTP/2 connection */
+struct http2_connection {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** Connection URI */
+	struct uri *uri;
+	/** HTTP scheme */
+	struct http_scheme *scheme;
+	/** Transport layer interface */
+	struct interface socket;
+	/** List of connections accepting new streams */
+	struct list_head list;
+	/** List of streams */
+	struct list_head streams;
+	/** Stream notification process */
+	struct process process;
+	/** Idle timer */
+	struct retry_timer timer;
+	/** Flags */
+	unsigned int flags;
+	/** Next stream identifier */
+	uint32_t next_id;
+
+	/** Transmit flow control window */
+	int32_t tx_window;
+	/** Initial transmit flow control window for each stream */
+	int32_t tx_initial;
+	/** Maximum transmitted frame size */
+	size_t tx_frame_size;
+	/** Maximum number of concurrently active streams */
+	unsigned int max_streams;
+
+	/** Received data not yet included in a window update */
+	size_t rx_consumed;
+	/** Current received frame header */
+	struct http2_frame_header rx_header;
+	/** Length of current received frame header */
+	size_t rx_header_len;
+	/** Length of current received frame payload */
+	size_t rx_len;
+	/** Remaining length of current received frame payload */
+	size_t rx_remaining;
+	/** Current received frame payload (for frames other than
+	 * unpadded DATA frames, which are passed through directly)
+	 */
+	uint8_t rx_payload[HTTP2_DEFAULT_FRAME_SIZE];
+
+	/** HPACK dynamic table */
+	struct hpack_table hpack;
+	/** Header block being received */
+	void *block;
+	/** Length of header block being received */
+	size_t block_len;
+	/** Stream identifier of header block being received (if any) */
+	uint32_t block_stream;
+	/** Flags of HEADERS frame starting header block */
+	unsigned int block_flags;
+};
+
+/** HTTP/2 connection flags */
+enum http2_connection_flags {
+	/** Server has sent GOAWAY */
+	HTTP2_CONN_GOAWAY = 0x0001,
+	/** At least one stream has completed successfully */
+	HTTP2_CONN_REUSED = 0x0002,
+	/** Connection has been closed */
+	HTTP2_CONN_CLOSED = 0x0004,
+	/** Current received frame is being passed through directly */
+	HTTP2_CONN_RX_DATA = 0x0008,
+};
+
+/** An HTTP/2 stream */
+struct http2_stream {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** HTTP/2 connection */
+	struct http2_connection *conn;
+	/** List of streams */
+	struct list_head list;
+	/** Data transfer interface */
+	struct interface xfer;
+	/** Stream identifier (once request has been transmitted) */
+	uint32_t id;
+	/** Flags */
+	unsigned int flags;
+	/** Transmit flow control window */
+	int32_t tx_window;
+	/** Request content not yet transmitted (if any) */
+	struct io_buffer *tx_pending;
+	/** Received data not yet included in a window update */
+	size_t rx_consumed;
+};
+
+/** HTTP/2 stream flags */
+enum http2_stream_flags {
+	/** Request headers have been transmitted */
+	HTTP2_STREAM_SENT = 0x0001,
+	/** Request has been completely transmitted */
+	HTTP2_STREAM_LOCAL_CLOSED = 0x0002,
+	/** Response has been completely received */
+	HTTP2_STREAM_REMOTE_CLOSED = 0x0004,
+	/** Final response headers have been received */
+	HTTP2_STREAM_RESPONSE = 0x0008,
+};
+
+#endif /* _IPXE_HTTP2_H */
@@ -37,6 +37,18 @@ struct icmp_echo {
 	uint8_t data[0];
 } __attribute__ (( packed ));
 
+/** An ICMP destination unreachable message */
+struct icmp_unreachable {
+	/** ICMP header */
+	struct icmp_header icmp;
+	/** Unused */
+	uint16_t unused;
+	/** Next-hop MTU (for "fragmentation needed" errors) */
+	uint16_t mtu;
+	/** Original datagram */
+	uint8_t data[0];
+} __attribute__ (( packed ));
+
 /** An ICMP echo protocol */
 struct icmp_echo_protocol {
 	/** Address family */
@@ -59,8 +71,12 @@ struct icmp_echo_protocol {
 #define __icmp_echo_protocol __table_entry ( ICMP_ECHO_PROTOCOLS, 01 )
 
 #define ICMP_ECHO_REPLY 0
+#define ICMP_DESTINATION_UNREACHABLE 3
 #define ICMP_ECHO_REQUEST 8
 
+/** ICMP "fragmentation needed" destination unreachable code */
+#define ICMP_FRAGMENTATION_NEEDED 4
+
 extern int icmp_tx_echo_request ( struct io_buffer *iobuf,
 				  struct sockaddr_tcpip *st_dest );
 
@@ -40,6 +40,16 @@ struct icmpv6_handler {
 /** Declare an ICMPv6 handler */
 #define __icmpv6_handler __table_entry ( ICMPV6_HANDLERS, 01 )
 
+/** An ICMPv6 packet too big message */
+struct icmpv6_packet_too_big {
+	/** ICMPv6 header */
+	struct icmp_header icmp;
+	/** MTU */
+	uint32_t mtu;
+	/** Original packet */
+	uint8_t data[0];
+} __attribute__ (( packed ));
+
 /** ICMPv6 destination unreachable */
 #define ICMPV6_DESTINATION_UNREACHABLE 1
 
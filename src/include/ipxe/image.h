@@ -19,6 +19,8 @@ struct uri;
 struct pixel_buffer;
 struct asn1_cursor;
 struct image_type;
+struct digest_algorithm;
+struct interface;
 
 /** An executable image */
 struct image {
@@ -41,6 +43,14 @@ struct image {
 	userptr_t data;
 	/** Length of raw file image */
 	size_t len;
+	/** Digest algorithm used for precalculated digest, if any */
+	struct digest_algorithm *digest;
+	/** Precalculated digest of raw file image */
+	void *digest_value;
+	/** Digest algorithm used for expected digest, if any */
+	struct digest_algorithm *expected;
+	/** Expected digest of raw file image */
+	void *expected_value;
 
 	/** Image type, if known */
 	struct image_type *type;
@@ -178,11 +188,23 @@ extern int image_set_cmdline ( struct image *image, const char *cmdline );
 extern int register_image ( struct image *image );
 extern void unregister_image ( struct image *image );
 struct image * find_image ( const char *name );
+extern struct image * find_image_digest ( struct digest_algorithm *digest,
+					  const void *value );
 extern int image_exec ( struct image *image );
 extern int image_replace ( struct image *replacement );
 extern int image_select ( struct image *image );
 extern struct image * image_find_selected ( void );
 extern int image_set_trust ( int require_trusted, int permanent );
+extern int image_trust_required ( void );
+extern int image_set_digest ( struct image *image,
+			      struct digest_algorithm *digest, void *ctx );
+extern int image_set_expected ( struct image *image,
+			       struct digest_algorithm *digest,
+			       const void *value );
+extern int image_check_digest ( struct image *image );
+extern struct digest_algorithm * image_digest_algorithm ( void );
+extern int image_decompress ( struct interface *xfer,
+			      struct interface **next );
 extern int image_pixbuf ( struct image *image, struct pixel_buffer **pixbuf );
 extern int image_asn1 ( struct image *image, size_t offset,
 			struct asn1_cursor **cursor );
@@ -105,6 +105,19 @@ struct interface_descriptor {
 		.passthru_offset = 0,					      \
 	}
 
+/** A cached object interface operation lookup */
+struct interface_cache {
+	/** Operation type */
+	void *type;
+	/** Implementing method, or NULL */
+	void *func;
+	/** Destination interface */
+	struct interface *dest;
+};
+
+/** Number of cached operation lookups per object interface */
+#define INTF_CACHE_SIZE 2
+
 /** An object interface */
 struct interface {
 	/** Destination object interface
@@ -129,8 +142,33 @@ struct interface {
 	 * Used by intf_reinit().
 	 */
 	struct interface_descriptor *original;
+	/** Plumbing generation of cached operation lookups
+	 *
+	 * Cached lookups are valid only if this matches the current
+	 * value of @c intf_generation.  Zero indicates that there are
+	 * no cached lookups.
+	 */
+	unsigned int generation;
+	/** Cached operation lookups (most recently used first) */
+	struct interface_cache cache[INTF_CACHE_SIZE];
 };
 
+extern unsigned int intf_generation;
+
+/**
+ * Invalidate all cached object interface operation lookups
+ *
+ * This must be called whenever any interface's destination or
+ * descriptor is changed.
+ */
+static inline __attribute__ (( always_inline )) void
+intf_invalidate ( void ) {
+
+	/* Skip zero, which is used to indicate an empty cache */
+	if ( ! ++intf_generation )
+		intf_generation++;
+}
+
 extern void intf_plug ( struct interface *intf, struct interface *dest );
 extern void intf_plug_plug ( struct interface *a, struct interface *b );
 extern void intf_unplug ( struct interface *intf );
@@ -177,6 +215,8 @@ static inline void intf_init ( struct interface *intf,
 	intf->refcnt = refcnt;
 	intf->desc = desc;
 	intf->original = desc;
+	intf->generation = 0;
+	intf_invalidate();
 }
 
 /**
@@ -257,6 +297,7 @@ static inline void intf_reinit ( struct interface *intf ) {
 
 	/* Restore original interface descriptor */
 	intf->desc = intf->original;
+	intf_invalidate();
 }
 
 #endif /* _IPXE_INTERFACE_H */
@@ -22,6 +22,12 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  */
 #define IOB_ZLEN 128
 
+/** Maximum number of free I/O buffers retained by an I/O buffer pool */
+#define IOB_POOL_MAX 32
+
+struct refcnt;
+struct io_buffer_pool;
+
 /**
  * A persistent I/O buffer
  *
@@ -46,6 +52,62 @@ struct io_buffer {
 	void *tail;
 	/** End of the buffer */
         void *end;
+
+	/** I/O buffer pool to which this buffer will be returned, if any */
+	struct io_buffer_pool *pool;
+	/** Flags */
+	unsigned int flags;
+
+	/** Transport-layer header, for transmit offload */
+	void *trans;
+	/** Transport-layer header length, for transmit offload */
+	uint16_t trans_len;
+	/** Offset of checksum within transport-layer header
+	 *
+	 * The checksum field contains the (non-inverted) checksum of
+	 * the pseudo-header, and must be completed by summing over
+	 * the whole of the transport-layer segment.
+	 */
+	uint16_t csum_offset;
+	/** Maximum segment size, for transmit segmentation offload */
+	uint16_t mss;
+};
+
+/** Transport-layer checksum has been verified by hardware
+ *
+ * A network device driver may set this flag on a received packet if
+ * the hardware has already verified the TCP or UDP checksum, in
+ * which case the transport layer will not verify it again.
+ */
+#define IOB_CSUM_VERIFIED 0x0001
+
+/** Transport-layer checksum is to be completed by hardware */
+#define IOB_TX_CSUM 0x0002
+
+/** Transport-layer segment is to be split by hardware
+ *
+ * The segment is to be split into segments of at most @c mss bytes
+ * of payload, each carrying a copy of all headers.  This flag is
+ * only ever used in conjunction with @c IOB_TX_CSUM.
+ */
+#define IOB_TX_TSO 0x0004
+
+/**
+ * A pool of recycled I/O buffers
+ *
+ * Buffers allocated from the pool are returned to the pool (rather
+ * than to the heap) when freed via free_iob().  Each allocated buffer
+ * holds a reference to the object containing the pool.
+ */
+struct io_buffer_pool {
+	/** Reference counter of containing object */
+	struct refcnt *refcnt;
+	/** Buffer length */
+	size_t len;
+	/** Free buffers */
+	struct list_head free;
+	/** Number of free buffers */
+	unsigned int count;
 };
 
 /**
@@ -188,6 +250,19 @@ static inline void iob_populate ( struct io_buffer *iobuf,
 	iobuf->head = iobuf->data = data;
 	iobuf->tail = ( data + len );
 	iobuf->end = ( data + max_len );
+	iobuf->flags = 0;
+}
+
+/**
+ * Initialise I/O buffer pool
+ *
+ * @v pool		I/O buffer pool
+ * @v refcnt		Reference counter of containing object
+ */
+static inline void iob_pool_init ( struct io_buffer_pool *pool,
+				   struct refcnt *refcnt ) {
+	pool->refcnt = refcnt;
+	INIT_LIST_HEAD ( &pool->free );
 }
 
 /**
@@ -214,6 +289,9 @@ extern struct io_buffer * __malloc alloc_iob_raw ( size_t len, size_t align,
 						   size_t offset );
 extern struct io_buffer * __malloc alloc_iob ( size_t len );
 extern void free_iob ( struct io_buffer *iobuf );
+extern struct io_buffer * alloc_pool_iob ( struct io_buffer_pool *pool,
+					   size_t len );
+extern unsigned int iob_pool_flush ( struct io_buffer_pool *pool );
 extern void iob_pad ( struct io_buffer *iobuf, size_t min_len );
 extern int iob_ensure_headroom ( struct io_buffer *iobuf, size_t len );
 extern struct io_buffer * iob_concatenate ( struct list_head *list );
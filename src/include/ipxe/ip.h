@@ -27,6 +27,13 @@ struct io_buffer;
 #define IP_MASK_MOREFRAGS	0x2000U
 #define IP_PSHLEN 	12
 
+/** Minimum path MTU
+ *
+ * This is the minimum datagram size that all IPv4 hosts are required
+ * to accept (RFC 791).
+ */
+#define IP_MIN_MTU	576
+
 /* IP header defaults */
 #define IP_TOS		0
 #define IP_TTL		64
@@ -108,6 +108,23 @@ struct ip_statistics {
 	 * combining them as they are received.
 	 */
 	unsigned long reasm_fails;
+	/** Number of IP fragments received out of order
+	 *
+	 * This is not part of the IP-MIB, and counts fragments which
+	 * did not immediately follow the previously received data.
+	 */
+	unsigned long reasm_reorders;
+	/** Number of duplicate IP fragments discarded
+	 *
+	 * This is not part of the IP-MIB.
+	 */
+	unsigned long reasm_duplicates;
+	/** Number of incomplete IP datagrams discarded to reclaim memory
+	 *
+	 * This is not part of the IP-MIB.  Each such datagram is also
+	 * counted in ipSystemStatsReasmFails.
+	 */
+	unsigned long reasm_evictions;
 	/** ipSystemStatsInDelivers
 	 *
 	 * The total number of datagrams successfully delivered to IP
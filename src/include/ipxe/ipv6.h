@@ -31,6 +31,9 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 /** IPv6 maximum prefix length */
 #define IPV6_MAX_PREFIX_LEN 128
 
+/** IPv6 minimum link MTU (RFC 8200) */
+#define IPV6_MIN_MTU 1280
+
 /** IPv6 header */
 struct ipv6_header {
 	/** Version (4 bits), Traffic class (8 bits), Flow label (20 bits) */
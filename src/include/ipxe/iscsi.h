@@ -121,8 +121,10 @@ struct iscsi_bhs_common_response {
 	uint32_t statsn;
 	/** Expected command sequence number */
 	uint32_t expcmdsn;
+	/** Maximum command sequence number */
+	uint32_t maxcmdsn;
 	/** Fields specific to the PDU type */
-	uint8_t other_d[16];
+	uint8_t other_d[12];
 };
 
 /**
@@ -515,8 +517,12 @@ enum iscsi_tx_state {
 	ISCSI_TX_BHS,
 	/** Sending the additional header segment */
 	ISCSI_TX_AHS,
+	/** Sending the header digest */
+	ISCSI_TX_HEADER_DIGEST,
 	/** Sending the data segment */
 	ISCSI_TX_DATA,
+	/** Sending the data digest */
+	ISCSI_TX_DATA_DIGEST,
 };
 
 /** State of an iSCSI RX engine */
@@ -525,10 +531,105 @@ enum iscsi_rx_state {
 	ISCSI_RX_BHS = 0,
 	/** Receiving the additional header segment */
 	ISCSI_RX_AHS,
+	/** Receiving the header digest */
+	ISCSI_RX_HEADER_DIGEST,
 	/** Receiving the data segment */
 	ISCSI_RX_DATA,
 	/** Receiving the data segment padding */
 	ISCSI_RX_DATA_PADDING,
+	/** Receiving the data digest */
+	ISCSI_RX_DATA_DIGEST,
+};
+
+/** Header digest (CRC32C) is in use */
+#define ISCSI_HEADER_DIGEST 0x01
+
+/** Data digest (CRC32C) is in use */
+#define ISCSI_DATA_DIGEST 0x02
+
+/** Maximum number of concurrent iSCSI tasks */
+#define ISCSI_MAX_TASKS 8
+
+/** Minimum length of data transferred by each part of a split command
+ *
+ * Large READ and WRITE commands are split into several concurrent
+ * iSCSI tasks, each of which transfers at least this much data.
+ */
+#define ISCSI_MIN_SPLIT_LEN 16384
+
+/** Maximum data segment length that we are prepared to receive */
+#define ISCSI_MAX_RECV_LEN 65536
+
+/** Maximum burst length that we request */
+#define ISCSI_MAX_BURST_LEN 16776192
+
+/** First burst length that we request */
+#define ISCSI_FIRST_BURST_LEN 262144
+
+/** Default maximum data segment length (as per RFC 7143) */
+#define ISCSI_DEFAULT_MAX_RECV_LEN 8192
+
+/** Default first burst length (as per RFC 7143) */
+#define ISCSI_DEFAULT_FIRST_BURST_LEN 65536
+
+/** An iSCSI task
+ *
+ * A SCSI command may be split into several iSCSI tasks, which may be
+ * outstanding simultaneously.  The first task (the "lead" task) holds
+ * the SCSI command interface and collects the results of the others.
+ */
+struct iscsi_task {
+	/** iSCSI session */
+	struct iscsi_session *iscsi;
+	/** SCSI command interface (used only by the lead task) */
+	struct interface data;
+	/** Lead task, or NULL if this task is unused */
+	struct iscsi_task *lead;
+	/** Number of incomplete tasks (used only by the lead task) */
+	unsigned int pending;
+	/** SCSI response (used only by the lead task) */
+	struct scsi_rsp rsp;
+	/** SCSI response is valid (used only by the lead task) */
+	int have_rsp;
+
+	/** Task flags */
+	unsigned int flags;
+	/** SCSI command */
+	struct scsi_cmd command;
+	/** Initiator task tag */
+	uint32_t itt;
+	/** Command sequence number */
+	uint32_t cmdsn;
+	/** Length of immediate data sent with the command */
+	size_t immediate_len;
+
+	/** Target transfer tag for the current data-out sequence */
+	uint32_t ttt;
+	/** Next data sequence number within the data-out sequence */
+	uint32_t datasn;
+	/** Offset of next data-out PDU */
+	size_t offset;
+	/** End offset of the current data-out sequence */
+	size_t end;
+
+	/** Target transfer tag of pending R2T */
+	uint32_t r2t_ttt;
+	/** Offset of pending R2T */
+	size_t r2t_offset;
+	/** Length of pending R2T */
+	size_t r2t_len;
+};
+
+/** iSCSI task flags */
+enum iscsi_task_flags {
+	/** Command PDU has not yet been transmitted */
+	ISCSI_TASK_TX_COMMAND = 0x0001,
+	/** Data-out sequence is in progress */
+	ISCSI_TASK_TX_DATA = 0x0002,
+	/** R2T is awaiting the end of the current data-out sequence */
+	ISCSI_TASK_R2T = 0x0004,
+	/** Task is awaiting completion */
+	ISCSI_TASK_ACTIVE = 0x0008,
 };
 
 /** An iSCSI session */
@@ -538,8 +639,6 @@ struct iscsi_session {
 
 	/** SCSI command-issuing interface */
 	struct interface control;
-	/** SCSI command interface */
-	struct interface data;
 	/** Transport-layer socket */
 	struct interface socket;
 
@@ -585,36 +684,24 @@ struct iscsi_session {
 	uint16_t isid_iana_qual;
 	/** Initiator task tag
 	 *
-	 * This is the tag of the current command.  It is incremented
-	 * whenever a new command is started.
+	 * This is the tag used for login requests.  It is changed
+	 * whenever a new connection is opened.
 	 */
 	uint32_t itt;
-	/** Target transfer tag
-	 *
-	 * This is the tag attached to a sequence of data-out PDUs in
-	 * response to an R2T.
-	 */
-	uint32_t ttt;
-	/** Transfer offset
-	 *
-	 * This is the offset for an in-progress sequence of data-out
-	 * PDUs in response to an R2T.
-	 */
-	uint32_t transfer_offset;
-	/** Transfer length
-	 *
-	 * This is the length for an in-progress sequence of data-out
-	 * PDUs in response to an R2T.
-	 */
-	uint32_t transfer_len;
 	/** Command sequence number
 	 *
-	 * This is the sequence number of the current command, used to
-	 * fill out the CmdSN field in iSCSI request PDUs.  It is
-	 * updated with the value of the ExpCmdSN field whenever we
-	 * receive an iSCSI response PDU containing such a field.
+	 * This is the sequence number to be used for the next
+	 * command, used to fill out the CmdSN field in iSCSI request
+	 * PDUs.  During login, it is updated with the value of the
+	 * ExpCmdSN field whenever we receive a login response PDU.
 	 */
 	uint32_t cmdsn;
+	/** Maximum command sequence number
+	 *
+	 * This is the highest command sequence number that the
+	 * target is currently prepared to accept.
+	 */
+	uint32_t maxcmdsn;
 	/** Status sequence number
 	 *
 	 * This is the most recent status sequence number present in
@@ -623,11 +710,34 @@ struct iscsi_session {
 	 * the ExpStatSN field with this value plus one.
 	 */
 	uint32_t statsn;
-	
+
+	/** Target requires an R2T before all data-out sequences */
+	int initial_r2t;
+	/** Target accepts immediate data */
+	int immediate_data;
+	/** Maximum length of unsolicited data */
+	size_t first_burst_len;
+	/** Maximum data segment length that the target can receive */
+	size_t max_send_len;
+	/** Prefer to use digests */
+	int digest_preferred;
+	/** Digests negotiated for the full feature phase
+	 *
+	 * This is the bitwise-OR of zero or more ISCSI_XXX_DIGEST
+	 * constants.
+	 */
+	unsigned int digests;
+
 	/** Basic header segment for current TX PDU */
 	union iscsi_bhs tx_bhs;
 	/** State of the TX engine */
 	enum iscsi_tx_state tx_state;
+	/** Task for current TX PDU, if any */
+	struct iscsi_task *tx_task;
+	/** Digests in use for current TX PDU */
+	unsigned int tx_digests;
+	/** Data digest for current TX PDU */
+	uint32_t tx_crc;
 	/** TX process */
 	struct process process;
 
@@ -641,9 +751,15 @@ struct iscsi_session {
 	size_t rx_len;
 	/** Buffer for received data (not always used) */
 	void *rx_buffer;
-
-	/** Current SCSI command, if any */
-	struct scsi_cmd *command;
+	/** Digests in use for current RX PDU */
+	unsigned int rx_digests;
+	/** Running digest for current RX PDU header or data segment */
+	uint32_t rx_crc;
+	/** Received digest */
+	uint8_t rx_digest[4];
+
+	/** iSCSI tasks */
+	struct iscsi_task tasks[ISCSI_MAX_TASKS];
 
 	/** Target socket address (for boot firmware table) */
 	struct sockaddr target_sockaddr;
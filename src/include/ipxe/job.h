@@ -28,10 +28,15 @@ struct job_progress {
 	 * account before calculating @c completed/total.
 	 */
 	unsigned long total;
+	/** Flags */
+	unsigned int flags;
 	/** Message (optional) */
 	char message[32];
 };
 
+/** Progress is measured in bytes */
+#define JOB_PROGRESS_BYTES 0x0001
+
 extern int job_progress ( struct interface *intf,
 			  struct job_progress *progress );
 #define job_progress_TYPE( object_type ) \
@@ -148,5 +148,16 @@ struct linux_setting *linux_find_setting(char *name, struct list_head *settings)
  */
 extern void linux_apply_settings(struct list_head *new_settings, struct settings *settings_block);
 
+/** A file descriptor watched while sleeping */
+struct linux_nap_watch {
+	/** List of watched file descriptors */
+	struct list_head list;
+	/** File descriptor */
+	int fd;
+};
+
+extern void linux_nap_watch(struct linux_nap_watch *watch, int fd);
+extern void linux_nap_unwatch(struct linux_nap_watch *watch);
+
 
 #endif /* _IPXE_LINUX_H */
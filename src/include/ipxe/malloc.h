@@ -24,6 +24,8 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 extern size_t freemem;
 extern size_t usedmem;
 extern size_t maxusedmem;
+extern size_t heaptarget;
+extern unsigned int heapgrown;
 
 extern void * __malloc alloc_memblock ( size_t size, size_t align,
 					size_t offset );
@@ -85,12 +87,18 @@ static inline void free_dma ( void *ptr, size_t size ) {
 
 /** A cache discarder */
 struct cache_discarder {
+	/** Name */
+	const char *name;
 	/**
 	 * Discard some cached data
 	 *
 	 * @ret discarded	Number of cached items discarded
 	 */
 	unsigned int ( * discard ) ( void );
+	/** Number of times invoked */
+	unsigned long invoked;
+	/** Number of cached items discarded */
+	unsigned long discarded;
 };
 
 /** Cache discarder table */
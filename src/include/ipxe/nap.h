@@ -54,4 +54,18 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  */
 void cpu_nap ( void );
 
+extern int nap_busy;
+
+/**
+ * Record activity that should prevent the CPU from sleeping
+ *
+ * This should be called whenever work is performed that is likely to
+ * be followed by further work (e.g. when a packet is received).
+ */
+static inline __attribute__ (( always_inline )) void nap_activity ( void ) {
+	nap_busy = 1;
+}
+
+extern void cpu_idle ( void );
+
 #endif /* _IPXE_NAP_H */
@@ -39,6 +39,8 @@ struct neighbour {
 	struct refcnt refcnt;
 	/** List of neighbour cache entries */
 	struct list_head list;
+	/** List of entries within the same hash bucket */
+	struct list_head hash;
 
 	/** Network device */
 	struct net_device *netdev;
@@ -55,6 +57,8 @@ struct neighbour {
 	uint8_t net_source[MAX_NET_ADDR_LEN];
 	/** Retransmission timer */
 	struct retry_timer timer;
+	/** Time of last resolution or refresh request */
+	unsigned long refreshed;
 
 	/** Pending I/O buffers */
 	struct list_head tx_queue;
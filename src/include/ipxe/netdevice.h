@@ -16,8 +16,8 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/settings.h>
 #include <ipxe/interface.h>
 #include <ipxe/retry.h>
+#include <ipxe/iobuf.h>
 
-struct io_buffer;
 struct net_device;
 struct net_protocol;
 struct ll_protocol;
@@ -289,6 +289,8 @@ struct net_device_stats {
 	unsigned int good;
 	/** Count of error completions */
 	unsigned int bad;
+	/** Count of occasions on which no buffer was available */
+	unsigned int nobuf;
 	/** Error breakdowns */
 	struct net_device_error errors[NETDEV_MAX_UNIQUE_ERRORS];
 };
@@ -407,12 +409,27 @@ struct net_device {
 	 * link-layer headers) configured for the link.
 	 */
 	size_t mtu;
+	/** Transmit offload capabilities
+	 *
+	 * This is the bitwise-OR of zero or more NETDEV_TX_XXX
+	 * constants.
+	 */
+	unsigned int offload;
+	/** Maximum transmit segmentation offload packet length
+	 *
+	 * This is the maximum packet length (including any link-layer
+	 * headers) that may be submitted for transmit segmentation
+	 * offload.
+	 */
+	size_t tso_max_len;
 	/** TX packet queue */
 	struct list_head tx_queue;
 	/** Deferred TX packet queue */
 	struct list_head tx_deferred;
 	/** RX packet queue */
 	struct list_head rx_queue;
+	/** RX buffer pool */
+	struct io_buffer_pool rx_pool;
 	/** TX statistics */
 	struct net_device_stats tx_stats;
 	/** RX statistics */
@@ -445,6 +462,15 @@ struct net_device {
  */
 #define NETDEV_IRQ_UNSUPPORTED 0x0008
 
+/** Network device can complete TCP checksums */
+#define NETDEV_TX_CSUM 0x0001
+
+/** Network device can segment TCP over IPv4 */
+#define NETDEV_TX_TSO4 0x0002
+
+/** Network device can segment TCP over IPv6 */
+#define NETDEV_TX_TSO6 0x0004
+
 /** Link-layer protocol table */
 #define LL_PROTOCOLS __table ( struct ll_protocol, "ll_protocols" )
 
@@ -556,6 +582,21 @@ netdev_put ( struct net_device *netdev ) {
 	ref_put ( &netdev->refcnt );
 }
 
+/**
+ * Allocate receive I/O buffer
+ *
+ * @v netdev		Network device
+ * @v len		Required length of buffer
+ * @ret iobuf		I/O buffer, or NULL if none available
+ *
+ * The buffer is allocated from the network device's RX buffer pool,
+ * and will be returned to the pool when freed.
+ */
+static inline __attribute__ (( always_inline )) struct io_buffer *
+alloc_rx_iob ( struct net_device *netdev, size_t len ) {
+	return alloc_pool_iob ( &netdev->rx_pool, len );
+}
+
 /**
  * Get driver private area for this network device
  *
@@ -703,6 +744,8 @@ extern void netdev_tx_complete_err ( struct net_device *netdev,
 				 struct io_buffer *iobuf, int rc );
 extern void netdev_tx_complete_next_err ( struct net_device *netdev, int rc );
 extern void netdev_rx ( struct net_device *netdev, struct io_buffer *iobuf );
+extern void netdev_rx_burst ( struct net_device *netdev,
+			      struct list_head *burst );
 extern void netdev_rx_err ( struct net_device *netdev,
 			    struct io_buffer *iobuf, int rc );
 extern void netdev_poll ( struct net_device *netdev );
@@ -734,6 +777,23 @@ extern int netdev_configure ( struct net_device *netdev,
 extern int netdev_configure_all ( struct net_device *netdev );
 extern int netdev_configuration_in_progress ( struct net_device *netdev );
 extern int netdev_configuration_ok ( struct net_device *netdev );
+extern unsigned int netdev_ring_size ( struct net_device *netdev,
+				       const struct setting *setting,
+				       unsigned int count, unsigned int min,
+				       unsigned int max );
+
+/**
+ * Record receive buffer exhaustion
+ *
+ * @v netdev		Network device
+ *
+ * Drivers should call this whenever a receive descriptor could not
+ * be refilled, or the hardware reports that a packet was dropped due
+ * to the lack of an available receive descriptor.
+ */
+static inline void netdev_rx_nobuf ( struct net_device *netdev ) {
+	netdev->rx_stats.nobuf++;
+}
 
 /**
  * Complete network transmission
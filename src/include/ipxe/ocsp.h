@@ -65,6 +65,8 @@ struct ocsp_responder {
 struct ocsp_response {
 	/** Raw response */
 	void *data;
+	/** Length of raw response */
+	size_t len;
 	/** Raw tbsResponseData */
 	struct asn1_cursor tbs;
 	/** Responder */
@@ -131,6 +133,12 @@ static inline int ocsp_required ( struct x509_certificate *cert ) {
 	if ( ! OCSP_ENABLED )
 		return 0;
 
+	/* An OCSP check is required (and will fail) if the OCSP URI
+	 * cannot be determined.
+	 */
+	if ( x509_parse_deferred ( cert ) != 0 )
+		return 1;
+
 	/* An OCSP check is required if an OCSP URI exists but the
 	 * OCSP status is not (yet) good.
 	 */
@@ -144,5 +152,9 @@ extern int ocsp_check ( struct x509_certificate *cert,
 extern int ocsp_response ( struct ocsp_check *ocsp, const void *data,
 			   size_t len );
 extern int ocsp_validate ( struct ocsp_check *check, time_t time );
+extern int ocsp_is_cached ( struct x509_certificate *cert, time_t time );
+extern int ocsp_cached ( struct ocsp_check *ocsp, time_t time );
+extern int ocsp_staple ( struct x509_certificate *cert, const void *data,
+			 size_t len );
 
 #endif /* _IPXE_OCSP_H */
@@ -0,0 +1,59 @@
+#ifndef _IPXE_P256_H
+#define _IPXE_P256_H
+
+/** @file
+ *
+ * NIST P-256 elliptic curve
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <ipxe/crypto.h>
+
+/** P-256 field element (and scalar) size */
+#define P256_SIZE 32
+
+/** P-256 uncompressed point format identifier */
+#define P256_UNCOMPRESSED 0x04
+
+/** P-256 uncompressed point size */
+#define P256_POINT_SIZE ( 1 /* format */ + 2 * P256_SIZE )
+
+/** Number of 32-bit limbs in a P-256 field element */
+#define P256_LIMBS ( P256_SIZE / sizeof ( uint32_t ) )
+
+/** A P-256 modulus
+ *
+ * Arithmetic is performed using Montgomery multiplication, with
+ * integers held as little-endian arrays of 32-bit limbs.  The same
+ * code is used for arithmetic modulo the field prime p and modulo
+ * the group order n.
+ */
+struct p256_modulus {
+	/** Modulus */
+	uint32_t modulus[P256_LIMBS];
+	/** Montgomery constant R^2 (mod m), where R = 2^256 */
+	uint32_t square[P256_LIMBS];
+	/** Montgomery constant -m^-1 (mod 2^32) */
+	uint32_t inverse;
+};
+
+/** A P-256 point in projective coordinates (Montgomery form) */
+struct p256_point {
+	/** X coordinate */
+	uint32_t x[P256_LIMBS];
+	/** Y coordinate */
+	uint32_t y[P256_LIMBS];
+	/** Z coordinate */
+	uint32_t z[P256_LIMBS];
+};
+
+extern int p256_key ( const void *base, const void *scalar, void *result );
+extern int p256_verify ( const void *public, const void *hash,
+			 const void *r, const void *s );
+
+extern struct elliptic_curve p256_curve;
+
+#endif /* _IPXE_P256_H */
@@ -0,0 +1,195 @@
+#ifndef _IPXE_PCAP_H
+#define _IPXE_PCAP_H
+
+/** @file
+ *
+ * Packet capture
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <ipxe/uaccess.h>
+
+struct net_device;
+struct io_buffer;
+
+/** Default number of captured packets retained */
+#define PCAP_DEFAULT_COUNT 4096
+
+/** Default number of bytes captured from each packet */
+#define PCAP_DEFAULT_SNAPLEN 128
+
+/** Maximum number of distinct network devices within a capture */
+#define PCAP_MAX_INTERFACES 8
+
+/** Packet capture directions */
+enum pcap_direction {
+	/** Received packet */
+	PCAP_RX = 1,
+	/** Transmitted packet */
+	PCAP_TX = 2,
+};
+
+/** A captured packet header */
+struct pcap_packet {
+	/** Timestamp (in timer ticks) */
+	unsigned long ticks;
+	/** Original packet length */
+	uint32_t len;
+	/** Captured length */
+	uint16_t caplen;
+	/** Interface number */
+	uint8_t interface;
+	/** Direction */
+	uint8_t direction;
+} __attribute__ (( packed ));
+
+/** pcapng block types */
+enum pcapng_block_type {
+	/** Section header block */
+	PCAPNG_SHB = 0x0a0d0d0a,
+	/** Interface description block */
+	PCAPNG_IDB = 0x00000001,
+	/** Enhanced packet block */
+	PCAPNG_EPB = 0x00000006,
+};
+
+/** pcapng byte-order magic */
+#define PCAPNG_MAGIC 0x1a2b3c4d
+
+/** pcapng block header */
+struct pcapng_block_header {
+	/** Block type */
+	uint32_t type;
+	/** Total block length (including header and trailer) */
+	uint32_t len;
+} __attribute__ (( packed ));
+
+/** pcapng block trailer */
+struct pcapng_block_trailer {
+	/** Total block length (repeated) */
+	uint32_t len;
+} __attribute__ (( packed ));
+
+/** pcapng section header block */
+struct pcapng_shb {
+	/** Block header */
+	struct pcapng_block_header hdr;
+	/** Byte-order magic */
+	uint32_t magic;
+	/** Major version */
+	uint16_t major;
+	/** Minor version */
+	uint16_t minor;
+	/** Section length (or -1 if unspecified) */
+	int64_t section_len;
+	/** Block trailer */
+	struct pcapng_block_trailer trailer;
+} __attribute__ (( packed ));
+
+/** pcapng option header */
+struct pcapng_option {
+	/** Option code */
+	uint16_t code;
+	/** Option length (excluding padding) */
+	uint16_t len;
+} __attribute__ (( packed ));
+
+/** pcapng end of options */
+#define PCAPNG_OPT_END 0
+
+/** pcapng interface name option */
+#define PCAPNG_IF_NAME 2
+
+/** pcapng interface timestamp resolution option */
+#define PCAPNG_IF_TSRESOL 9
+
+/** pcapng enhanced packet flags option */
+#define PCAPNG_EPB_FLAGS 2
+
+/** pcapng interface description block */
+struct pcapng_idb {
+	/** Block header */
+	struct pcapng_block_header hdr;
+	/** Link type */
+	uint16_t linktype;
+	/** Reserved */
+	uint16_t reserved;
+	/** Snapshot length */
+	uint32_t snaplen;
+	/** Interface name option */
+	struct pcapng_option name_opt;
+	/** Interface name (NUL-padded) */
+	char name[16];
+	/** Timestamp resolution option */
+	struct pcapng_option tsresol_opt;
+	/** Timestamp resolution (and padding) */
+	uint8_t tsresol[4];
+	/** End of options */
+	struct pcapng_option end_opt;
+	/** Block trailer */
+	struct pcapng_block_trailer trailer;
+} __attribute__ (( packed ));
+
+/** pcapng enhanced packet block header */
+struct pcapng_epb {
+	/** Block header */
+	struct pcapng_block_header hdr;
+	/** Interface ID */
+	uint32_t interface;
+	/** Timestamp (upper 32 bits) */
+	uint32_t ts_high;
+	/** Timestamp (lower 32 bits) */
+	uint32_t ts_low;
+	/** Captured length */
+	uint32_t caplen;
+	/** Original length */
+	uint32_t len;
+} __attribute__ (( packed ));
+
+/** pcapng enhanced packet block options */
+struct pcapng_epb_options {
+	/** Flags option */
+	struct pcapng_option flags_opt;
+	/** Flags (direction in bits 0-1) */
+	uint32_t flags;
+	/** End of options */
+	struct pcapng_option end_opt;
+	/** Block trailer */
+	struct pcapng_block_trailer trailer;
+} __attribute__ (( packed ));
+
+/** Ethernet link type */
+#define LINKTYPE_ETHERNET 1
+
+/** IEEE 802.11 link type */
+#define LINKTYPE_IEEE802_11 105
+
+/** Private use link type */
+#define LINKTYPE_USER0 147
+
+/** Packet capture statistics */
+struct pcap_statistics {
+	/** Capture is in progress */
+	int running;
+	/** Maximum number of packets retained */
+	unsigned int count;
+	/** Number of packets overwritten */
+	unsigned int dropped;
+	/** Number of packets retained */
+	unsigned int retained;
+	/** Number of bytes captured from each packet */
+	size_t snaplen;
+};
+
+extern void pcap_capture ( struct net_device *netdev, struct io_buffer *iobuf,
+			   unsigned int direction );
+extern int pcap_start ( unsigned int count, size_t snaplen );
+extern void pcap_stop ( void );
+extern void pcap_clear ( void );
+extern void pcap_statistics ( struct pcap_statistics *stats );
+extern size_t pcap_export ( userptr_t data, size_t len );
+
+#endif /* _IPXE_PCAP_H */
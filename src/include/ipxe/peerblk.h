@@ -42,6 +42,9 @@ enum peerdist_block_decrypt_index {
 	PEERBLK_NUM_BUFFERS
 };
 
+/** Maximum number of peers attempted in each download attempt cycle */
+#define PEERBLK_MAX_PEER_ATTEMPTS 4
+
 /** A PeerDist block download */
 struct peerdist_block {
 	/** Reference count */
@@ -52,6 +55,8 @@ struct peerdist_block {
 	struct interface raw;
 	/** Retrieval protocol interface */
 	struct interface retrieval;
+	/** Raced raw data interface */
+	struct interface race;
 
 	/** Original URI */
 	struct uri *uri;
@@ -109,8 +114,20 @@ struct peerdist_block {
 
 	/** Discovery client */
 	struct peerdisc_client discovery;
-	/** Current position in discovered peer list */
+	/** Current peer (or head of discovered peer list for a raw
+	 * download attempt)
+	 */
 	struct peerdisc_peer *peer;
+	/** Peers attempted in current download attempt cycle */
+	struct peerdisc_peer *tried[PEERBLK_MAX_PEER_ATTEMPTS];
+	/** Number of peers attempted in current download attempt cycle */
+	unsigned int attempts;
+	/** A retrieval protocol download attempt is in progress */
+	int retrieving;
+	/** Time at which retrieval protocol attempt was requested */
+	unsigned long requested;
+	/** Time at which retrieval protocol attempt first responded */
+	unsigned long responded;
 	/** Retry timer */
 	struct retry_timer timer;
 	/** Number of full attempt cycles completed */
@@ -122,6 +139,17 @@ struct peerdist_block {
 	unsigned long started;
 	/** Time at which most recent attempt was started */
 	unsigned long attempted;
+
+	/** A raced raw block download attempt is in progress */
+	int racing;
+	/** Raced raw block download data buffer */
+	struct xfer_buffer race_buffer;
+	/** Raced raw block download digest context (statically
+	 * allocated at instantiation time)
+	 */
+	void *race_digestctx;
+	/** Raced raw block download timer */
+	struct retry_timer race_timer;
 };
 
 /** Retrieval protocol block fetch response (including transport header)
@@ -138,6 +166,10 @@ struct peerdist_block {
 				     blksize ) msg;			\
 	} __attribute__ (( packed ))
 
+extern int peerblk_urgent ( struct interface *intf );
+#define peerblk_urgent_TYPE( object_type ) \
+	typeof ( int ( object_type ) )
+
 extern int peerblk_open ( struct interface *xfer, struct uri *uri,
 			  struct peerdist_info_block *block );
 
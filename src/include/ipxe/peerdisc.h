@@ -67,10 +67,28 @@ struct peerdisc_segment {
 	struct retry_timer timer;
 };
 
+/** PeerDist discovery peer statistics
+ *
+ * Statistics are shared between all discovery segments in which the
+ * same peer location appears.
+ */
+struct peerdisc_peer_stats {
+	/** Number of download attempts in progress */
+	unsigned int busy;
+	/** Number of consecutive failed download attempts */
+	unsigned int failures;
+	/** Smoothed response latency (in ticks) */
+	unsigned long latency;
+	/** Smoothed throughput (in bytes per tick), or zero if unknown */
+	unsigned long rate;
+};
+
 /** A PeerDist discovery peer */
 struct peerdisc_peer {
 	/** List of peers */
 	struct list_head list;
+	/** Statistics */
+	struct peerdisc_peer_stats stats;
 	/** Peer location */
 	char location[0];
 };
@@ -115,6 +133,14 @@ extern void peerdisc_stat ( struct interface *intf, struct peerdisc_peer *peer,
 	typeof ( void ( object_type, struct peerdisc_peer *peer,	\
 			struct list_head *peers ) )
 
+extern void peerdisc_start ( struct peerdisc_peer *peer );
+extern void peerdisc_finish ( struct peerdisc_peer *peer, int rc,
+			      unsigned long latency, size_t len,
+			      unsigned long duration );
+extern struct peerdisc_peer *
+peerdisc_select ( struct peerdisc_segment *segment, size_t len,
+		  struct peerdisc_peer **exclude, unsigned int count );
+
 extern int peerdisc_open ( struct peerdisc_client *peerdisc, const void *id,
 			   size_t len );
 extern void peerdisc_close ( struct peerdisc_client *peerdisc );
@@ -19,7 +19,27 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/pccrc.h>
 
 /** Maximum number of concurrent block downloads */
-#define PEERMUX_MAX_BLOCKS 32
+#define PEERMUX_MAX_BLOCKS 64
+
+/** Initial block download window
+ *
+ * The window is the maximum distance (in blocks) that a new block
+ * download may lie beyond the write frontier (i.e. the oldest block
+ * download still in progress).  It adapts to the measured download
+ * throughput.
+ */
+#define PEERMUX_INITIAL_WINDOW 16
+
+/** Minimum block download window */
+#define PEERMUX_MIN_WINDOW 4
+
+/** Number of block downloads near the write frontier treated as urgent
+ *
+ * A slow retrieval protocol download attempt for an urgent block
+ * will be raced against a raw download attempt from the origin
+ * server.
+ */
+#define PEERMUX_URGENT_BLOCKS 2
 
 /** PeerDist download content information cache */
 struct peerdist_info_cache {
@@ -39,6 +59,8 @@ struct peerdist_multiplexed_block {
 	struct list_head list;
 	/** Data transfer interface */
 	struct interface xfer;
+	/** Sequence number */
+	unsigned int sequence;
 };
 
 /** PeerDist statistics */
@@ -75,6 +97,17 @@ struct peerdist_multiplexer {
 	struct list_head idle;
 	/** Block downloads */
 	struct peerdist_multiplexed_block block[PEERMUX_MAX_BLOCKS];
+	/** Next block download sequence number */
+	unsigned int sequence;
+	/** Block download window */
+	unsigned int window;
+
+	/** Start time of current throughput sample */
+	unsigned long sampled;
+	/** Length of data received in current throughput sample */
+	size_t sample_len;
+	/** Most recent measured throughput (in bytes per tick) */
+	unsigned long rate;
 
 	/** Statistics */
 	struct peerdist_statistics stats;
@@ -0,0 +1,67 @@
+#ifndef _IPXE_PEERSERV_H
+#define _IPXE_PEERSERV_H
+
+/** @file
+ *
+ * Peer Content Caching and Retrieval (PeerDist) protocol content server
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <ipxe/refcnt.h>
+#include <ipxe/list.h>
+#include <ipxe/interface.h>
+#include <ipxe/retry.h>
+#include <ipxe/pccrc.h>
+
+struct uri;
+
+/** PeerDist content server retrieval port */
+#define PEERSERV_PORT 80
+
+/** Maximum number of published contents retained */
+#define PEERSERV_MAX_CONTENTS 8
+
+/** Maximum number of concurrent retrieval connections */
+#define PEERSERV_MAX_CONNECTIONS 8
+
+/** Maximum length of a retrieval request (including HTTP headers) */
+#define PEERSERV_MAX_REQUEST 2048
+
+/** Retrieval connection idle timeout */
+#define PEERSERV_IDLE_TIMEOUT ( 30 * TICKS_PER_SEC )
+
+/** A published PeerDist content */
+struct peerserv_content {
+	/** List of published contents */
+	struct list_head list;
+	/** Original URI string */
+	char *uri;
+	/** Content information */
+	struct peerdist_info info;
+};
+
+/** A PeerDist content server retrieval connection */
+struct peerserv_connection {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** List of connections */
+	struct list_head list;
+	/** Data transfer interface */
+	struct interface xfer;
+	/** Idle timer */
+	struct retry_timer timer;
+	/** Connection should be closed after the current response */
+	int close;
+	/** Length of received request data */
+	size_t len;
+	/** Received request data */
+	char request[PEERSERV_MAX_REQUEST];
+};
+
+extern void peerserv_publish ( struct uri *uri,
+			       const struct peerdist_info *info );
+
+#endif /* _IPXE_PEERSERV_H */
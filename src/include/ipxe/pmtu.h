@@ -0,0 +1,43 @@
+#ifndef _IPXE_PMTU_H
+#define _IPXE_PMTU_H
+
+/** @file
+ *
+ * Path MTU discovery
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <ipxe/tcpip.h>
+#include <ipxe/timer.h>
+
+/** Number of path MTU cache entries */
+#define PMTU_CACHE_SIZE 8
+
+/** Path MTU cache entry lifetime
+ *
+ * RFC 1191 and RFC 8201 both recommend that a reduced path MTU be
+ * discarded after ten minutes, in case the path has since changed.
+ */
+#define PMTU_TIMEOUT ( 10 * 60 * TICKS_PER_SEC )
+
+/** A path MTU cache entry */
+struct path_mtu {
+	/** Destination address (without port) */
+	struct sockaddr_tcpip dest;
+	/** Path MTU, or zero if entry is unused */
+	size_t mtu;
+	/** Time at which entry was last updated */
+	unsigned long updated;
+};
+
+extern unsigned int pmtu_generation;
+
+extern size_t pmtu_limit ( struct tcpip_net_protocol *tcpip_net,
+			   struct sockaddr_tcpip *st_dest, size_t mtu );
+extern void pmtu_update ( struct sockaddr_tcpip *st_dest, size_t mtu );
+extern void pmtu_flush ( void );
+
+#endif /* _IPXE_PMTU_H */
@@ -0,0 +1,42 @@
+#ifndef _IPXE_POLY1305_H
+#define _IPXE_POLY1305_H
+
+/** @file
+ *
+ * Poly1305 message authentication code
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+
+/** Poly1305 key length */
+#define POLY1305_KEY_LEN 32
+
+/** Poly1305 block size */
+#define POLY1305_BLOCKSIZE 16
+
+/** Poly1305 MAC length */
+#define POLY1305_MAC_LEN 16
+
+/** Poly1305 context */
+struct poly1305_context {
+	/** Clamped multiplier (r), as 26-bit limbs */
+	uint32_t r[5];
+	/** Accumulator (h), as 26-bit limbs */
+	uint32_t h[5];
+	/** Final addend (s) */
+	uint32_t pad[4];
+	/** Partial block */
+	uint8_t buf[POLY1305_BLOCKSIZE];
+	/** Length of partial block */
+	unsigned int len;
+};
+
+extern void poly1305_init ( struct poly1305_context *ctx, const void *key );
+extern void poly1305_update ( struct poly1305_context *ctx, const void *data,
+			      size_t len );
+extern void poly1305_final ( struct poly1305_context *ctx, void *mac );
+
+#endif /* _IPXE_POLY1305_H */
@@ -43,8 +43,30 @@ struct process_descriptor {
 	void ( * step ) ( void *object );
 	/** Automatically reschedule the process */
 	int reschedule;
+	/** Scheduling priority */
+	unsigned int priority;
+	/** List of descriptors with recorded statistics */
+	struct list_head stats;
+	/** Number of steps executed */
+	unsigned long steps;
+	/** Total time spent executing steps (in profiler ticks) */
+	unsigned long ticks;
+	/** Longest single step (in profiler ticks) */
+	unsigned long max;
 };
 
+/** Process priorities
+ *
+ * High-priority processes (such as network device polling and retry
+ * timers) are given at least every other step.
+ *
+ * @{
+ */
+#define PROCESS_PRIORITY_NORMAL	0	/**< Normal priority */
+#define PROCESS_PRIORITY_HIGH	1	/**< High priority */
+#define PROCESS_PRIORITIES	2	/**< Number of priority levels */
+/** @} */
+
 /**
  * Define a process step() method
  *
@@ -109,11 +131,22 @@ struct process_descriptor {
  * @v step		Process' step() method
  * @ret desc		Object interface descriptor
  */
-#define PROC_DESC_PURE( _step ) {					      \
+#define PROC_DESC_PURE( _step ) \
+	PROC_DESC_PURE_PRIORITY ( _step, PROCESS_PRIORITY_NORMAL )
+
+/**
+ * Define a process descriptor for a pure process with a given priority
+ *
+ * @v step		Process' step() method
+ * @v priority		Scheduling priority
+ * @ret desc		Object interface descriptor
+ */
+#define PROC_DESC_PURE_PRIORITY( _step, _priority ) {			      \
 		.name = #_step,						      \
 		.offset = 0,						      \
 		.step = PROC_STEP ( struct process, _step ),		      \
 		.reschedule = 1,					      \
+		.priority = _priority,					      \
 	}
 
 extern void * __attribute__ (( pure ))
@@ -122,6 +155,9 @@ extern void process_add ( struct process *process );
 extern void process_del ( struct process *process );
 extern void step ( void );
 
+extern struct list_head process_stats;
+extern void process_stats_reset ( void );
+
 /**
  * Initialise process without adding to process list
  *
@@ -179,7 +215,14 @@ process_running ( struct process *process ) {
  *
  */
 #define PERMANENT_PROCESS( name, step )					      \
-static struct process_descriptor name ## _desc = PROC_DESC_PURE ( step );     \
+	PERMANENT_PROCESS_PRIORITY ( name, step, PROCESS_PRIORITY_NORMAL )
+
+/** Define a permanent process with a given priority
+ *
+ */
+#define PERMANENT_PROCESS_PRIORITY( name, step, priority )		      \
+static struct process_descriptor name ## _desc =			      \
+	PROC_DESC_PURE_PRIORITY ( step, priority );			      \
 struct process name __permanent_process = {				      \
 	.list = LIST_HEAD_INIT ( name.list ),				      \
 	.desc = & name ## _desc,					      \
@@ -20,6 +20,14 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #endif
 #endif
 
+/** Number of profiling histogram buckets
+ *
+ * Bucket zero counts zero-valued samples, and bucket N (for N>0)
+ * counts samples in the range [2^(N-1),2^N).  Samples too large to
+ * fit are counted in the final bucket.
+ */
+#define PROFILE_HISTOGRAM_BUCKETS 32
+
 /**
  * A data structure for storing profiling information
  */
@@ -48,6 +56,8 @@ struct profiler {
 	 * (i.e. one less than would be returned by flsll(raw_accvar)).
 	 */
 	unsigned int accvar_msb;
+	/** Sample value histogram (log2 buckets) */
+	unsigned int histogram[PROFILE_HISTOGRAM_BUCKETS];
 };
 
 /** Profiler table */
@@ -63,6 +73,7 @@ struct profiler {
 extern unsigned long profile_excluded;
 
 extern void profile_update ( struct profiler *profiler, unsigned long sample );
+extern void profile_reset ( struct profiler *profiler );
 extern unsigned long profile_mean ( struct profiler *profiler );
 extern unsigned long profile_variance ( struct profiler *profiler );
 extern unsigned long profile_stddev ( struct profiler *profiler );
@@ -19,7 +19,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 /** A retry timer */
 struct retry_timer {
-	/** List of active timers */
+	/** List of active timers within timer wheel slot */
 	struct list_head list;
 	/** Timer is currently running */
 	unsigned int running;
@@ -88,6 +88,9 @@ extern void start_timer_fixed ( struct retry_timer *timer,
 				unsigned long timeout );
 extern void stop_timer ( struct retry_timer *timer );
 extern void retry_poll ( void );
+extern unsigned long retry_remaining ( unsigned long max );
+
+extern unsigned int retry_running;
 
 /**
  * Start timer with no delay
@@ -54,12 +54,18 @@ struct rndis_initialise_message {
 /** RNDIS minor version */
 #define RNDIS_VERSION_MINOR 0
 
-/** RNDIS maximum transfer size
+/** RNDIS default maximum transfer size
  *
  * This is a policy decision.
  */
 #define RNDIS_MTU 2048
 
+/** RNDIS maximum supported packet alignment factor (log2)
+ *
+ * This is a policy decision.
+ */
+#define RNDIS_MAX_ALIGN 7
+
 /** RNDIS initialise completion */
 #define RNDIS_INITIALISE_CMPLT 0x80000002UL
 
@@ -328,6 +334,35 @@ struct rndis_device {
 	unsigned int wait_id;
 	/** Return status code for current blocking request */
 	int wait_rc;
+
+	/** Maximum received transfer size
+	 *
+	 * This is advertised to the device, which may then combine
+	 * several packet messages within a single transfer.
+	 */
+	size_t rx_mtu;
+	/** Maximum transmitted transfer size supported by transport
+	 *
+	 * If greater than zero, then several packet messages may be
+	 * combined within a single transmitted transfer, up to the
+	 * limits reported by the device.
+	 */
+	size_t tx_mtu;
+	/** Maximum number of packets per transmitted transfer */
+	unsigned int tx_max_pkts;
+	/** Maximum transmitted transfer size */
+	size_t tx_max_len;
+	/** Packet alignment for transmitted transfers */
+	size_t tx_align;
+	/** Pending transmitted transfer, if any
+	 *
+	 * This is either a single unmodified packet from the network
+	 * device's transmit queue, or a transfer containing copies of
+	 * two or more packets (which have already been completed).
+	 */
+	struct io_buffer *tx_pending;
+	/** Number of packets within pending transmitted transfer */
+	unsigned int tx_count;
 };
 
 /**
@@ -340,6 +375,7 @@ static inline void rndis_init ( struct rndis_device *rndis,
 				struct rndis_operations *op ) {
 
 	rndis->op = op;
+	rndis->rx_mtu = RNDIS_MTU;
 }
 
 extern void rndis_tx_complete_err ( struct rndis_device *rndis,
@@ -73,7 +73,23 @@ struct rsa_context {
 	bigint_element_t *input0;
 	/** Output buffer */
 	bigint_element_t *output0;
-	/** Temporary working space for modular exponentiation */
+	/** Public exponent (for blinding private-key operations) */
+	bigint_element_t *public0;
+	/** Public exponent size */
+	unsigned int public_size;
+	/** First prime factor */
+	bigint_element_t *prime1_0;
+	/** Second prime factor */
+	bigint_element_t *prime2_0;
+	/** First factor's CRT exponent */
+	bigint_element_t *exponent1_0;
+	/** Second factor's CRT exponent */
+	bigint_element_t *exponent2_0;
+	/** CRT coefficient */
+	bigint_element_t *coefficient0;
+	/** Prime factor size, or zero if CRT is not in use */
+	unsigned int crt_size;
+	/** Temporary working space */
 	void *tmp;
 };
 
@@ -0,0 +1,41 @@
+#ifndef _IPXE_RSFEC_H
+#define _IPXE_RSFEC_H
+
+/** @file
+ *
+ * Reed-Solomon forward error correction
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Maximum number of encoding symbols per source block */
+#define RSFEC_MAX_N 255
+
+/** A Reed-Solomon erasure code */
+struct rsfec_code {
+	/** Number of source symbols per block */
+	unsigned int k;
+	/** Number of encoding symbols per block */
+	unsigned int n;
+	/** Repair symbol coefficients
+	 *
+	 * This is the lower ( n - k ) x k portion of the systematic
+	 * generator matrix (the upper k x k portion being the
+	 * identity matrix), stored in row-major order.
+	 */
+	uint8_t *repair;
+};
+
+extern int rsfec_init ( struct rsfec_code *code, unsigned int k,
+			unsigned int n );
+extern void rsfec_fini ( struct rsfec_code *code );
+extern int rsfec_encode ( struct rsfec_code *code, const void **source,
+			  unsigned int esi, void *symbol, size_t len );
+extern int rsfec_decode ( struct rsfec_code *code, void **symbols,
+			  unsigned int *esis, size_t len );
+
+#endif /* _IPXE_RSFEC_H */
@@ -0,0 +1,87 @@
+#ifndef _IPXE_SAMPLER_H
+#define _IPXE_SAMPLER_H
+
+/** @file
+ *
+ * Sampling profiler
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <ipxe/tables.h>
+
+/** Number of sampling profiler histogram buckets
+ *
+ * Must be a power of two.
+ */
+#define SAMPLER_BUCKETS 4096
+
+/** Maximum number of buckets probed when recording a sample */
+#define SAMPLER_MAX_PROBES 16
+
+/** Sample offset used for instruction pointers outside iPXE */
+#define SAMPLER_EXTERNAL ( ~0UL )
+
+/** A sampling profiler histogram bucket */
+struct sampler_bucket {
+	/** Instruction pointer offset within text section */
+	unsigned long offset;
+	/** Number of samples */
+	unsigned int count;
+};
+
+/** A sampling profiler timer source */
+struct sampler_source {
+	/** Name */
+	const char *name;
+	/** Name of section containing sampled offsets
+	 *
+	 * This is the section name that should be passed to
+	 * e.g. "addr2line -j <section>" when symbolising samples
+	 * against the build's ELF file.
+	 */
+	const char *section;
+	/** Start sampling
+	 *
+	 * @ret rc		Return status code
+	 *
+	 * Each timer interrupt should call sampler_record() with the
+	 * offset of the interrupted instruction pointer.
+	 */
+	int ( * start ) ( void );
+	/** Stop sampling */
+	void ( * stop ) ( void );
+};
+
+/** Sampling profiler timer source table */
+#define SAMPLER_SOURCES __table ( struct sampler_source, "sampler_sources" )
+
+/** Declare a sampling profiler timer source */
+#define __sampler_source __table_entry ( SAMPLER_SOURCES, 01 )
+
+/** Sampling profiler statistics */
+struct sampler_statistics {
+	/** Timer source (or NULL if not running) */
+	struct sampler_source *source;
+	/** Name of section containing sampled offsets */
+	const char *section;
+	/** Total number of samples */
+	unsigned int total;
+	/** Number of samples outside iPXE */
+	unsigned int external;
+	/** Number of samples lost due to a full histogram */
+	unsigned int lost;
+};
+
+extern void sampler_record ( unsigned long offset );
+extern void sampler_external ( unsigned int count );
+extern int sampler_start ( void );
+extern void sampler_stop ( void );
+extern void sampler_clear ( void );
+extern void sampler_statistics ( struct sampler_statistics *stats );
+extern unsigned int sampler_sort ( struct sampler_bucket *buckets,
+				   unsigned int max );
+
+#endif /* _IPXE_SAMPLER_H */
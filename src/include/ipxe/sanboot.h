@@ -39,10 +39,60 @@ struct san_path {
 	/** Path status */
 	int path_rc;
 
+	/** Multipath command interface */
+	struct interface command;
+	/** Multipath command status */
+	int command_rc;
+	/** Multipath command start time */
+	unsigned long started;
+	/** Multipath command starting LBA */
+	uint64_t lba;
+	/** Multipath command block count, or zero if idle */
+	unsigned int count;
+	/** Multipath command data buffer */
+	userptr_t buffer;
+	/** Number of times the multipath command has failed */
+	unsigned int retries;
+	/** Smoothed command latency (in ticks, scaled by 8), or zero
+	 * if not yet measured
+	 */
+	unsigned long latency;
+
 	/** ACPI descriptor (if applicable) */
 	struct acpi_descriptor *desc;
 };
 
+/** A SAN device block cache */
+struct san_cache {
+	/** Cache data buffer */
+	userptr_t data;
+	/** Cache line tags
+	 *
+	 * Each tag is the starting underlying block address of the
+	 * corresponding cache line, or SAN_CACHE_INVALID.
+	 */
+	uint64_t *tags;
+	/** Number of cache lines */
+	unsigned int lines;
+	/** Number of underlying blocks per cache line */
+	unsigned int count;
+	/** Length of each cache line */
+	size_t len;
+	/** Next cache line to be replaced */
+	unsigned int next;
+	/** Read-ahead window (in cache lines) */
+	unsigned int window;
+	/** Next expected cache line tag for sequential reads */
+	uint64_t expected;
+	/** Number of cache hits */
+	unsigned long hits;
+	/** Number of cache misses */
+	unsigned long misses;
+};
+
+/** An invalid SAN device cache line tag */
+#define SAN_CACHE_INVALID ( ~( ( uint64_t ) 0 ) )
+
 /** A SAN device */
 struct san_device {
 	/** Reference count */
@@ -73,6 +123,8 @@ struct san_device {
 	unsigned int blksize_shift;
 	/** Drive is a CD-ROM */
 	int is_cdrom;
+	/** Block cache */
+	struct san_cache cache;
 
 	/** Driver private data */
 	void *priv;
@@ -16,6 +16,9 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 /** Maximum block for READ/WRITE (10) commands */
 #define SCSI_MAX_BLOCK_10 0xffffffffULL
 
+/** Maximum number of blocks for a READ/WRITE (10) command */
+#define SCSI_MAX_COUNT_10 0xffffU
+
 /**
  * @defgroup scsiops SCSI operation codes
  * @{
@@ -336,6 +339,10 @@ struct scsi_rsp {
 extern int scsi_parse_lun ( const char *lun_string, struct scsi_lun *lun );
 extern void scsi_parse_sense ( const void *data, size_t len,
 			       struct scsi_sns_descriptor *sense );
+extern int scsi_cdb_range ( union scsi_cdb *cdb, uint64_t *lba,
+			    unsigned int *count );
+extern void scsi_cdb_set_range ( union scsi_cdb *cdb, uint64_t lba,
+				 unsigned int count );
 
 extern int scsi_command ( struct interface *control, struct interface *data,
 			  struct scsi_cmd *command );
@@ -13,4 +13,6 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 extern struct uart serial_console;
 
+extern void serial_flush ( void );
+
 #endif /* _IPXE_SERIAL_H */
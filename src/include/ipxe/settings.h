@@ -10,6 +10,7 @@
 FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 #include <stdint.h>
+#include <string.h>
 #include <ipxe/tables.h>
 #include <ipxe/list.h>
 #include <ipxe/refcnt.h>
@@ -291,6 +292,14 @@ extern const struct settings_scope ipv6_settings_scope;
 /** DHCPv6 setting scope */
 extern const struct settings_scope dhcpv6_scope;
 
+/** Number of generic settings hash buckets
+ *
+ * Must be a power of two.
+ */
+#define GENERIC_SETTINGS_BUCKETS 16
+
+struct generic_setting;
+
 /**
  * A generic settings block
  *
@@ -300,6 +309,10 @@ struct generic_settings {
 	struct settings settings;
 	/** List of generic settings */
 	struct list_head list;
+	/** Generic settings hashed by name */
+	struct generic_setting *names[GENERIC_SETTINGS_BUCKETS];
+	/** Generic settings hashed by tag */
+	struct generic_setting *tags[GENERIC_SETTINGS_BUCKETS];
 };
 
 /** A child settings block locator function */
@@ -468,6 +481,14 @@ mac_setting __setting ( SETTING_NETDEV, mac );
 extern const struct setting
 busid_setting __setting ( SETTING_NETDEV, busid );
 extern const struct setting
+rxring_setting __setting ( SETTING_NETDEV_EXTRA, rxring );
+extern const struct setting
+txring_setting __setting ( SETTING_NETDEV_EXTRA, txring );
+extern const struct setting
+rxqueues_setting __setting ( SETTING_NETDEV_EXTRA, rxqueues );
+extern const struct setting
+lro_setting __setting ( SETTING_NETDEV_EXTRA, lro );
+extern const struct setting
 user_class_setting __setting ( SETTING_HOST_EXTRA, user-class );
 extern const struct setting
 vendor_class_setting __setting ( SETTING_HOST_EXTRA, vendor-class );
@@ -514,6 +535,8 @@ static inline void generic_settings_init ( struct generic_settings *generics,
 	settings_init ( &generics->settings, &generic_settings_operations,
 			refcnt, NULL );
 	INIT_LIST_HEAD ( &generics->list );
+	memset ( generics->names, 0, sizeof ( generics->names ) );
+	memset ( generics->tags, 0, sizeof ( generics->tags ) );
 }
 
 /**
@@ -62,6 +62,8 @@ struct sha1_context {
 	union sha1_digest_data_dwords ddd;
 } __attribute__ (( packed ));
 
+#include <bits/sha1.h>
+
 /** SHA-1 context size */
 #define SHA1_CTX_SIZE sizeof ( struct sha1_context )
 
@@ -67,6 +67,8 @@ struct sha256_context {
 	union sha256_digest_data_dwords ddd;
 } __attribute__ (( packed ));
 
+#include <bits/sha256.h>
+
 /** SHA-256 context size */
 #define SHA256_CTX_SIZE sizeof ( struct sha256_context )
 
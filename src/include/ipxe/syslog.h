@@ -9,6 +9,7 @@
 
 FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
+#include <stddef.h>
 #include <syslog.h>
 
 /** Syslog server port */
@@ -20,6 +21,12 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  */
 #define SYSLOG_BUFSIZE 128
 
+/** Syslog message queue size
+ *
+ * This is a policy decision
+ */
+#define SYSLOG_QUEUE_SIZE 4096
+
 /** Syslog default facility
  *
  * This is a policy decision
@@ -35,7 +42,34 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 /** Syslog priority */
 #define SYSLOG_PRIORITY( facility, severity ) ( 8 * (facility) + (severity) )
 
-extern int syslog_send ( struct interface *xfer, unsigned int severity,
-			 const char *message, const char *terminator );
+/** A syslog message queue
+ *
+ * Log messages are queued as they are produced, and transmitted in
+ * batches from a process.  Messages are dropped (and counted) rather
+ * than blocking console output when the queue is full.
+ */
+struct syslog_queue {
+	/** Data transfer interface */
+	struct interface *xfer;
+	/** Queue buffer */
+	char *buffer;
+	/** Size of queue buffer */
+	size_t size;
+	/** Length of queued messages */
+	size_t len;
+	/** Messages are transmitted as a byte stream
+	 *
+	 * Stream messages are newline-terminated, and as many as
+	 * possible are coalesced into each transmission.  Otherwise,
+	 * each message is transmitted as a separate datagram.
+	 */
+	int stream;
+	/** Number of messages dropped */
+	unsigned int dropped;
+};
+
+extern int syslog_queue ( struct syslog_queue *queue, unsigned int severity,
+			  const char *message );
+extern void syslog_flush ( struct syslog_queue *queue );
 
 #endif /* _IPXE_SYSLOG_H */
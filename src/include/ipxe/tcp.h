@@ -11,6 +11,8 @@
 
 FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
+#include <ipxe/list.h>
+#include <ipxe/tables.h>
 #include <ipxe/tcpip.h>
 
 /**
@@ -112,6 +114,13 @@ struct tcp_sack_block {
  */
 #define TCP_SACK_MAX 3
 
+/** Maximum number of remembered peer selective acknowledgement blocks
+ *
+ * Each received ACK carries at most @c TCP_SACK_MAX blocks, but the
+ * holes reported by successive ACKs may accumulate.
+ */
+#define TCP_SND_SACK_MAX 8
+
 /** Padded TCP selective acknowledgement option (used for sending) */
 struct tcp_sack_padded_option {
 	uint8_t nop[2];
@@ -138,14 +147,50 @@ struct tcp_timestamp_padded_option {
 /** Code for the TCP timestamp option */
 #define TCP_OPTION_TS 8
 
+/** TCP Fast Open option
+ *
+ * The option is followed by the cookie (if any).
+ */
+struct tcp_fastopen_option {
+	uint8_t kind;
+	uint8_t length;
+} __attribute__ (( packed ));
+
+/** Minimum length of a TCP Fast Open cookie */
+#define TCP_FASTOPEN_COOKIE_MIN 4
+
+/** Maximum length of a TCP Fast Open cookie
+ *
+ * RFC 7413 allows cookies of up to 16 bytes, but this would not fit
+ * into a SYN alongside the other options that we send.  Longer
+ * cookies are never cached.
+ */
+#define TCP_FASTOPEN_COOKIE_MAX 12
+
+/** Padded TCP Fast Open option (used for sending) */
+struct tcp_fastopen_padded_option {
+	uint8_t nop[2];
+	struct tcp_fastopen_option tfoopt;
+	uint8_t cookie[TCP_FASTOPEN_COOKIE_MAX];
+} __attribute__ (( packed ));
+
+/** Code for the TCP Fast Open option */
+#define TCP_OPTION_FASTOPEN 34
+
 /** Parsed TCP options */
 struct tcp_options {
+	/** Maximum segment size option, if present */
+	const struct tcp_mss_option *mssopt;
 	/** Window scale option, if present */
 	const struct tcp_window_scale_option *wsopt;
 	/** SACK permitted option, if present */
 	const struct tcp_sack_permitted_option *spopt;
 	/** Timestamp option, if present */
 	const struct tcp_timestamp_option *tsopt;
+	/** Selective acknowledgement option, if present */
+	const struct tcp_sack_option *sackopt;
+	/** Fast Open option, if present */
+	const struct tcp_fastopen_option *tfoopt;
 };
 
 /** @} */
@@ -203,8 +248,9 @@ struct tcp_options {
 
 /** LISTEN
  *
- * Not currently used as a state; we have no support for listening
- * connections.  Given a unique value to avoid compiler warnings.
+ * Not currently used as a state; listening is handled by a struct
+ * tcp_listener rather than by a connection.  Given a unique value to
+ * avoid compiler warnings.
  */
 #define TCP_LISTEN 0
 
@@ -327,7 +373,7 @@ struct tcp_options {
 #define TCP_MIN_PORT 1
 
 /**
- * Maxmimum advertised TCP window size
+ * Default maxmimum advertised TCP window size
  *
  * The maximum bandwidth on any link is limited by
  *
@@ -351,20 +397,48 @@ struct tcp_options {
  * bandwidth), since in the event of a lost packet the window size
  * represents the maximum amount that will need to be retransmitted.
  *
- * We therefore choose a maximum window size of 256kB.
+ * We therefore choose a default maximum window size of 256kB.  The
+ * maximum window size for each connection will be grown dynamically
+ * (up to @c TCP_MAX_AUTOTUNE_WINDOW_SIZE) if the measured bandwidth
+ * and round-trip time indicate that a larger window is required.
  */
 #define TCP_MAX_WINDOW_SIZE	( 256 * 1024 )
 
 /**
- * Path MTU
+ * Maximum auto-tuned TCP window size
+ *
+ * This must be representable using our advertised window scale
+ * factor @c TCP_RX_WINDOW_SCALE.  A window of 16MB is sufficient for
+ * a bandwidth of 10Gbps with an RTT of around 13ms, or for a
+ * bandwidth of 1Gbps with an RTT of around 130ms.
+ */
+#define TCP_MAX_AUTOTUNE_WINDOW_SIZE ( 16 * 1024 * 1024 )
+
+/**
+ * Assumed round-trip time for receive rate limiting
+ *
+ * This is used to calculate the rate-limited receive window before
+ * any round-trip time has been measured.
+ */
+#define TCP_RX_RATE_DEFAULT_RTT ( TICKS_PER_SEC / 10 )
+
+/**
+ * Round-trip time scale factor (as a power of two)
+ *
+ * Smoothed round-trip times are held as a fixed-point number of
+ * ticks, in order to retain precision when averaging over RTTs that
+ * are comparable to the tick length.
+ */
+#define TCP_RTT_SCALE 3
+
+/**
+ * Initial path MTU
  *
  * IPv6 requires all data link layers to support a datagram size of
- * 1280 bytes.  We choose to use this as our maximum transmitted
- * datagram size, on the assumption that any practical link layer we
- * encounter will allow this size.  This is a very conservative
- * assumption in practice, but the impact of making such a
- * conservative assumption is insignificant since the amount of data
- * that we transmit (rather than receive) is negligible.
+ * 1280 bytes.  We use this as our maximum transmitted datagram size
+ * until the peer's maximum segment size is known, after which the
+ * segment size is derived from the path MTU (which may be reduced by
+ * ICMP errors from routers along the path).
  *
  * We allow space within this 1280 bytes for an IPv6 header, a TCP
  * header, and a (padded) TCP timestamp option.
@@ -372,6 +446,76 @@ struct tcp_options {
 #define TCP_PATH_MTU							\
 	( 1280 - 40 /* IPv6 */ - 20 /* TCP */ - 12 /* TCP timestamp */ )
 
+/**
+ * Default peer maximum segment size
+ *
+ * This is used if the peer does not send a maximum segment size
+ * option (RFC 9293).
+ */
+#define TCP_DEFAULT_MSS 536
+
+/**
+ * Maximum number of segments in a segmentation offload packet
+ *
+ * I/O buffers are aligned on their own size, so this is chosen to
+ * keep each transmitted I/O buffer within 32kB.
+ */
+#define TCP_TSO_MAX_SEGMENTS 16
+
+/**
+ * Maximum amount of unacknowledged transmitted data
+ *
+ * Data remains in the transmit queue (and so consumes heap space)
+ * until it has been acknowledged.  We limit the amount of data that
+ * the application may queue for transmission, and hence the amount
+ * of data in flight, to a small fraction of the available heap.
+ */
+#define TCP_MAX_SEND_WINDOW_SIZE ( 128 * 1024 )
+
+/**
+ * Minimum retransmission timeout
+ *
+ * RFC 6298 suggests a minimum of one second, but permits a smaller
+ * value.  We choose to match the historical retransmission timer
+ * minimum, since local networks typically have round-trip times of
+ * well under a millisecond.
+ */
+#define TCP_MIN_RTO ( TICKS_PER_SEC / 4 )
+
+/**
+ * Initial retransmission timeout
+ *
+ * This is used until the first round-trip time measurement has been
+ * made.
+ */
+#define TCP_INITIAL_RTO TCP_MIN_RTO
+
+/**
+ * Minimum tail loss probe timeout
+ *
+ * RFC 8985 suggests a probe timeout of twice the smoothed round-trip
+ * time.  We impose a minimum of a few ticks to allow for the timer
+ * granularity.
+ */
+#define TCP_TLP_MIN ( TICKS_PER_SEC / 100 )
+
+/**
+ * Tail loss probe allowance for a delayed acknowledgement
+ *
+ * This is the worst-case delayed acknowledgement timer (WCDelAckT)
+ * suggested by RFC 8985.
+ */
+#define TCP_TLP_DELACK ( TICKS_PER_SEC / 5 )
+
+/**
+ * Duplicate acknowledgement threshold
+ *
+ * We enter fast retransmission upon receiving this many duplicate
+ * ACKs (or upon receiving selective acknowledgements covering this
+ * many segments beyond a hole), as per RFC 5681.
+ */
+#define TCP_DUPACK_THRESHOLD 3
+
 /** TCP maximum segment lifetime
  *
  * Currently set to 2 minutes, as per RFC 793.
@@ -386,6 +530,45 @@ struct tcp_options {
  */
 #define TCP_KEEPALIVE_DELAY ( 15 * TICKS_PER_SEC )
 
+/**
+ * TCP delayed acknowledgement timeout
+ *
+ * Acknowledgements for in-order data are delayed (as per RFC 1122
+ * section 4.2.3.2) for at most this period.
+ */
+#define TCP_DELACK_TIMEOUT ( TICKS_PER_SEC / 25 )
+
+/**
+ * TCP delayed acknowledgement segment threshold
+ *
+ * An acknowledgement is sent for at least every second received
+ * segment, as per RFC 5681 section 4.2.
+ */
+#define TCP_DELACK_SEGMENTS 2
+
+/** Number of TCP Fast Open cookie cache entries */
+#define TCP_FASTOPEN_CACHE_SIZE 4
+
+/**
+ * TCP Fast Open SYN delay
+ *
+ * When we hold a Fast Open cookie for the peer, the initial SYN is
+ * held back for up to this period to allow the application to
+ * provide data to be sent along with the SYN.
+ */
+#define TCP_FASTOPEN_DELAY ( TICKS_PER_SEC / 50 )
+
+/**
+ * TCP maximum length of options within a SYN
+ *
+ */
+#define TCP_MAX_SYN_OPTIONS_LEN					\
+	( sizeof ( struct tcp_mss_option ) +			\
+	  sizeof ( struct tcp_window_scale_padded_option ) +	\
+	  sizeof ( struct tcp_sack_permitted_padded_option ) +	\
+	  sizeof ( struct tcp_timestamp_padded_option ) +	\
+	  sizeof ( struct tcp_fastopen_padded_option ) )
+
 /**
  * TCP maximum header length
  *
@@ -395,7 +578,8 @@ struct tcp_options {
 	  sizeof ( struct tcp_header ) +			\
 	  sizeof ( struct tcp_mss_option ) +			\
 	  sizeof ( struct tcp_window_scale_padded_option ) +	\
-	  sizeof ( struct tcp_timestamp_padded_option ) )
+	  sizeof ( struct tcp_timestamp_padded_option ) +	\
+	  sizeof ( struct tcp_fastopen_padded_option ) )
 
 /**
  * Compare TCP sequence numbers
@@ -426,6 +610,13 @@ static inline int tcp_in_window ( uint32_t seq, uint32_t start,
 	return ( ( seq - start ) < len );
 }
 
+/**
+ * Number of TCP connection hash buckets
+ *
+ * Must be a power of two.
+ */
+#define TCP_HASH_BUCKETS 64
+
 /** TCP finish wait time
  *
  * Currently set to one second, since we should not allow a slowly
@@ -433,6 +624,144 @@ static inline int tcp_in_window ( uint32_t seq, uint32_t start,
  */
 #define TCP_FINISH_TIMEOUT ( 1 * TICKS_PER_SEC )
 
+/** TCP congestion control state */
+struct tcp_congestion {
+	/** Congestion window (in bytes) */
+	uint32_t cwnd;
+	/** Slow start threshold (in bytes) */
+	uint32_t ssthresh;
+	/** Sender maximum segment size */
+	size_t mss;
+	/** Bytes acknowledged since last congestion window increase */
+	uint32_t acked;
+};
+
+/** A TCP congestion control algorithm */
+struct tcp_congestion_algorithm {
+	/** Name */
+	const char *name;
+	/** Initialise congestion control state
+	 *
+	 * @v cong		Congestion control state
+	 *
+	 * The sender maximum segment size will already have been
+	 * filled in.
+	 */
+	void ( * init ) ( struct tcp_congestion *cong );
+	/** Handle acknowledgement of new data
+	 *
+	 * @v cong		Congestion control state
+	 * @v len		Length of newly acknowledged data
+	 */
+	void ( * acked ) ( struct tcp_congestion *cong, uint32_t len );
+	/** Handle retransmission timeout
+	 *
+	 * @v cong		Congestion control state
+	 * @v flight		Amount of data in flight
+	 */
+	void ( * timeout ) ( struct tcp_congestion *cong, uint32_t flight );
+	/** Handle entry to fast recovery
+	 *
+	 * @v cong		Congestion control state
+	 * @v flight		Amount of data in flight
+	 */
+	void ( * recovery ) ( struct tcp_congestion *cong, uint32_t flight );
+	/** Handle exit from fast recovery
+	 *
+	 * @v cong		Congestion control state
+	 */
+	void ( * recovered ) ( struct tcp_congestion *cong );
+};
+
+/** TCP congestion control algorithm table */
+#define TCP_CONGESTION_ALGORITHMS \
+	__table ( struct tcp_congestion_algorithm, "tcp_congestion_algorithms" )
+
+/** Declare a TCP congestion control algorithm
+ *
+ * The first algorithm in the table will be used.
+ */
+#define __tcp_congestion_algorithm( order ) \
+	__table_entry ( TCP_CONGESTION_ALGORITHMS, order )
+
+/** Preferred TCP congestion control algorithm */
+#define TCP_CONGESTION_PREFERRED 01
+
+/** Default TCP congestion control algorithm */
+#define TCP_CONGESTION_DEFAULT 02
+
+/** TCP connection statistics */
+struct tcp_statistics {
+	/** Remote socket address */
+	struct sockaddr_tcpip peer;
+	/** Local port */
+	unsigned int local_port;
+	/** Name of current TCP state */
+	const char *state;
+	/** Current advertised receive window */
+	uint32_t rcv_win;
+	/** Maximum advertised receive window */
+	uint32_t rcv_win_max;
+	/** Smoothed round-trip time (in milliseconds) */
+	unsigned long rtt;
+	/** Retransmission timeout (in milliseconds) */
+	unsigned long rto;
+	/** Congestion window */
+	uint32_t cwnd;
+	/** Slow start threshold */
+	uint32_t ssthresh;
+	/** Sender maximum segment size */
+	size_t mss;
+	/** Name of congestion control algorithm */
+	const char *congestion;
+	/** Number of retransmission events */
+	unsigned long retransmits;
+	/** Number of retransmission timeouts */
+	unsigned long timeouts;
+	/** Number of tail loss probes */
+	unsigned long probes;
+	/** Number of data bytes received in order */
+	unsigned long in_octets;
+	/** Number of data bytes acknowledged by peer */
+	unsigned long out_octets;
+	/** Maximum span of out-of-order received data */
+	uint32_t rcv_ooo_max;
+	/** Number of times the peer closed its receive window */
+	unsigned long snd_zero_win;
+	/** Number of times we closed our receive window */
+	unsigned long rcv_zero_win;
+	/** Current send window */
+	uint32_t snd_win;
+};
+
+struct interface;
+
+/** A TCP listener */
+struct tcp_listener {
+	/** List of TCP listeners */
+	struct list_head list;
+	/** Local port */
+	unsigned int port;
+	/** Accept incoming connection
+	 *
+	 * @v listener		TCP listener
+	 * @v xfer		Data transfer interface for new connection
+	 * @v peer		Remote socket address
+	 * @ret rc		Return status code
+	 *
+	 * The listener must attach to the new connection's data
+	 * transfer interface.
+	 */
+	int ( * accept ) ( struct tcp_listener *listener,
+			   struct interface *xfer,
+			   struct sockaddr_tcpip *peer );
+};
+
 extern struct tcpip_protocol tcp_protocol __tcpip_protocol;
 
+extern int tcp_listen ( struct tcp_listener *listener );
+extern void tcp_unlisten ( struct tcp_listener *listener );
+extern int tcp_statistics ( unsigned int index,
+			    struct tcp_statistics *stats );
+
 #endif /* _IPXE_TCP_H */
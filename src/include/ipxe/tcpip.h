@@ -126,6 +126,13 @@ struct tcpip_protocol {
 	 * zero (0xffff).
 	 */
 	uint16_t zero_csum;
+	/** Protocol uses path MTU discovery
+	 *
+	 * If set, IPv4 packets for this protocol will be transmitted
+	 * with the "don't fragment" flag set, so that any router
+	 * unable to forward them will report the path MTU.
+	 */
+	uint8_t pmtud;
         /** 
 	 * Transport-layer protocol number
 	 *
@@ -144,6 +151,11 @@ struct tcpip_net_protocol {
 	sa_family_t sa_family;
 	/** Fixed header length */
 	size_t header_len;
+	/** Minimum MTU
+	 *
+	 * Reported path MTUs below this value will be ignored.
+	 */
+	size_t min_mtu;
 	/** Network-layer protocol */
 	struct net_protocol *net_protocol;
 	/**
@@ -199,6 +211,9 @@ extern int tcpip_tx ( struct io_buffer *iobuf, struct tcpip_protocol *tcpip,
 extern struct tcpip_net_protocol * tcpip_net_protocol ( sa_family_t sa_family );
 extern struct net_device * tcpip_netdev ( struct sockaddr_tcpip *st_dest );
 extern size_t tcpip_mtu ( struct sockaddr_tcpip *st_dest );
+extern int tcpip_tx_offload ( struct io_buffer *iobuf,
+			      struct net_device *netdev, unsigned int tso,
+			      uint16_t *trans_csum );
 extern uint16_t tcpip_chksum ( const void *data, size_t len );
 extern int tcpip_bind ( struct sockaddr_tcpip *st_local,
 			int ( * available ) ( int port ) );
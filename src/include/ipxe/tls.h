@@ -17,10 +17,12 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/md5.h>
 #include <ipxe/sha1.h>
 #include <ipxe/sha256.h>
+#include <ipxe/sha512.h>
 #include <ipxe/x509.h>
 #include <ipxe/pending.h>
 #include <ipxe/iobuf.h>
 #include <ipxe/tables.h>
+#include <ipxe/list.h>
 
 /** A TLS header */
 struct tls_header {
@@ -38,6 +40,18 @@ struct tls_header {
 	uint16_t length;
 } __attribute__ (( packed ));
 
+/** TLS authentication header
+ *
+ * This is the additional data authenticated (but not encrypted) by
+ * an authenticated encryption cipher.
+ */
+struct tls_auth_header {
+	/** Sequence number */
+	uint64_t seq;
+	/** TLS header */
+	struct tls_header header;
+} __attribute__ (( packed ));
+
 /** TLS version 1.0 */
 #define TLS_VERSION_TLS_1_0 0x0301
 
@@ -63,6 +77,7 @@ struct tls_header {
 #define TLS_HELLO_REQUEST 0
 #define TLS_CLIENT_HELLO 1
 #define TLS_SERVER_HELLO 2
+#define TLS_NEW_SESSION_TICKET 4
 #define TLS_CERTIFICATE 11
 #define TLS_SERVER_KEY_EXCHANGE 12
 #define TLS_CERTIFICATE_REQUEST 13
@@ -70,6 +85,7 @@ struct tls_header {
 #define TLS_CERTIFICATE_VERIFY 15
 #define TLS_CLIENT_KEY_EXCHANGE 16
 #define TLS_FINISHED 20
+#define TLS_CERTIFICATE_STATUS 22
 
 /* TLS alert levels */
 #define TLS_ALERT_WARNING 1
@@ -82,6 +98,20 @@ struct tls_header {
 #define TLS_RSA_WITH_AES_256_CBC_SHA 0x0035
 #define TLS_RSA_WITH_AES_128_CBC_SHA256 0x003c
 #define TLS_RSA_WITH_AES_256_CBC_SHA256 0x003d
+#define TLS_RSA_WITH_AES_128_GCM_SHA256 0x009c
+#define TLS_RSA_WITH_AES_256_GCM_SHA384 0x009d
+#define TLS_ECDHE_ECDSA_WITH_AES_128_CBC_SHA 0xc009
+#define TLS_ECDHE_ECDSA_WITH_AES_256_CBC_SHA 0xc00a
+#define TLS_ECDHE_RSA_WITH_AES_128_CBC_SHA 0xc013
+#define TLS_ECDHE_RSA_WITH_AES_256_CBC_SHA 0xc014
+#define TLS_ECDHE_ECDSA_WITH_AES_128_CBC_SHA256 0xc023
+#define TLS_ECDHE_RSA_WITH_AES_128_CBC_SHA256 0xc027
+#define TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256 0xc02b
+#define TLS_ECDHE_ECDSA_WITH_AES_256_GCM_SHA384 0xc02c
+#define TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256 0xc02f
+#define TLS_ECDHE_RSA_WITH_AES_256_GCM_SHA384 0xc030
+#define TLS_ECDHE_RSA_WITH_CHACHA20_POLY1305_SHA256 0xcca8
+#define TLS_ECDHE_ECDSA_WITH_CHACHA20_POLY1305_SHA256 0xcca9
 
 /* TLS hash algorithm identifiers */
 #define TLS_MD5_ALGORITHM 1
@@ -93,6 +123,7 @@ struct tls_header {
 
 /* TLS signature algorithm identifiers */
 #define TLS_RSA_ALGORITHM 1
+#define TLS_ECDSA_ALGORITHM 3
 
 /* TLS server name extension */
 #define TLS_SERVER_NAME 0
@@ -105,9 +136,32 @@ struct tls_header {
 #define TLS_MAX_FRAGMENT_LENGTH_2048 3
 #define TLS_MAX_FRAGMENT_LENGTH_4096 4
 
+/* TLS record size limit extension */
+#define TLS_RECORD_SIZE_LIMIT 28
+#define TLS_RECORD_SIZE_LIMIT_MIN 64
+
+/* TLS named curve (supported groups) extension */
+#define TLS_NAMED_CURVE 10
+#define TLS_NAMED_CURVE_SECP256R1 23
+#define TLS_NAMED_CURVE_X25519 29
+
+/* TLS EC point formats extension */
+#define TLS_POINT_FORMATS 11
+#define TLS_POINT_FORMAT_UNCOMPRESSED 0
+
+/* TLS certificate status request extension */
+#define TLS_STATUS_REQUEST 5
+#define TLS_STATUS_REQUEST_OCSP 1
+
+/* TLS application-layer protocol negotiation extension */
+#define TLS_ALPN 16
+
 /* TLS signature algorithms extension */
 #define TLS_SIGNATURE_ALGORITHMS 13
 
+/* TLS session ticket extension */
+#define TLS_SESSION_TICKET 35
+
 /* TLS renegotiation information extension */
 #define TLS_RENEGOTIATION_INFO 0xff01
 
@@ -135,16 +189,47 @@ enum tls_tx_pending {
 	TLS_TX_FINISHED = 0x0020,
 };
 
+/** ECDHE curve type for a named curve */
+#define TLS_NAMED_CURVE_TYPE 3
+
+struct tls_connection;
+
+/** A TLS key exchange algorithm */
+struct tls_key_exchange_algorithm {
+	/** Algorithm name */
+	const char *name;
+	/**
+	 * Transmit Client Key Exchange record
+	 *
+	 * @v tls		TLS connection
+	 * @ret rc		Return status code
+	 *
+	 * The key exchange algorithm must generate the master secret
+	 * and key material before returning.
+	 */
+	int ( * exchange ) ( struct tls_connection *tls );
+};
+
 /** A TLS cipher suite */
 struct tls_cipher_suite {
+	/** Key exchange algorithm */
+	struct tls_key_exchange_algorithm *exchange;
 	/** Public-key encryption algorithm */
 	struct pubkey_algorithm *pubkey;
 	/** Bulk encryption cipher algorithm */
 	struct cipher_algorithm *cipher;
 	/** MAC digest algorithm */
 	struct digest_algorithm *digest;
+	/** Handshake digest algorithm (for TLSv1.2 and above) */
+	struct digest_algorithm *handshake;
 	/** Key length */
-	uint16_t key_len;
+	uint8_t key_len;
+	/** Fixed initialisation vector length */
+	uint8_t fixed_iv_len;
+	/** Record initialisation vector length (for TLSv1.1 and above) */
+	uint8_t record_iv_len;
+	/** MAC length */
+	uint8_t mac_len;
 	/** Numeric code (in network-endian order) */
 	uint16_t code;
 };
@@ -171,6 +256,8 @@ struct tls_cipherspec {
 	void *cipher_next_ctx;
 	/** MAC secret */
 	void *mac_secret;
+	/** Fixed initialisation vector */
+	void *fixed_iv;
 };
 
 /** A TLS signature and hash algorithm identifier */
@@ -204,6 +291,31 @@ struct tls_signature_hash_algorithm {
 #define __tls_sig_hash_algorithm					\
 	__table_entry ( TLS_SIG_HASH_ALGORITHMS, 01 )
 
+/** A TLS named curve */
+struct tls_named_curve {
+	/** Elliptic curve */
+	struct elliptic_curve *curve;
+	/** Numeric code (in network-endian order) */
+	uint16_t code;
+	/** Point format identifier byte, or zero if not applicable
+	 *
+	 * Points on some curves (such as P-256) are encoded with a
+	 * leading format identifier byte, which must be excluded
+	 * when using a shared point as the pre-master secret.
+	 */
+	uint8_t format;
+	/** Pre-master secret length */
+	uint8_t pre_master_secret_len;
+};
+
+/** TLS named curve table */
+#define TLS_NAMED_CURVES						\
+	__table ( struct tls_named_curve, "tls_named_curves" )
+
+/** Declare a TLS named curve */
+#define __tls_named_curve( pref )					\
+	__table_entry ( TLS_NAMED_CURVES, pref )
+
 /** TLS pre-master secret */
 struct tls_pre_master_secret {
 	/** TLS version */
@@ -242,13 +354,57 @@ struct md5_sha1_digest {
 /** MD5+SHA1 digest size */
 #define MD5_SHA1_DIGEST_SIZE sizeof ( struct md5_sha1_digest )
 
+/** Maximum TLS session ID length */
+#define TLS_MAX_SESSION_ID_LEN 32
+
+/** A TLS session
+ *
+ * A session records the master secret negotiated with a server, along
+ * with the session ID and/or session ticket (as per RFC 5077) that
+ * may be used to resume the session via an abbreviated handshake.
+ */
+struct tls_session {
+	/** Reference counter */
+	struct refcnt refcnt;
+	/** List of sessions */
+	struct list_head list;
+
+	/** Server name */
+	const char *name;
+	/** Session ID */
+	uint8_t id[TLS_MAX_SESSION_ID_LEN];
+	/** Length of session ID */
+	size_t id_len;
+	/** Session ticket */
+	void *ticket;
+	/** Length of session ticket */
+	size_t ticket_len;
+	/** Master secret */
+	uint8_t master_secret[48];
+};
+
 /** A TLS connection */
 struct tls_connection {
 	/** Reference counter */
 	struct refcnt refcnt;
 
+	/** Session */
+	struct tls_session *session;
 	/** Server name */
 	const char *name;
+	/** Offered application-layer protocols (if any)
+	 *
+	 * This is a list of protocol names in the format used by the
+	 * application-layer protocol negotiation extension, i.e. each
+	 * name is preceded by a single-byte length.
+	 */
+	void *alpn;
+	/** Length of offered application-layer protocols */
+	size_t alpn_len;
+	/** Negotiated application-layer protocol (if any) */
+	char *protocol;
+	/** Handshake trace event identifier */
+	unsigned int trace;
 	/** Plaintext stream */
 	struct interface plainstream;
 	/** Ciphertext stream */
@@ -264,8 +420,20 @@ struct tls_connection {
 	struct tls_cipherspec rx_cipherspec;
 	/** Next RX cipher specification */
 	struct tls_cipherspec rx_cipherspec_pending;
-	/** Premaster secret */
+	/** Premaster secret (for public-key encryption key exchange) */
 	struct tls_pre_master_secret pre_master_secret;
+	/** Server Key Exchange record (if any) */
+	void *server_key;
+	/** Server Key Exchange record length */
+	size_t server_key_len;
+	/** Session ID */
+	uint8_t session_id[TLS_MAX_SESSION_ID_LEN];
+	/** Length of session ID */
+	size_t session_id_len;
+	/** Session ticket */
+	void *session_ticket;
+	/** Length of session ticket */
+	size_t session_ticket_len;
 	/** Master secret */
 	uint8_t master_secret[48];
 	/** Server random bytes */
@@ -276,6 +444,8 @@ struct tls_connection {
 	uint8_t handshake_md5_sha1_ctx[MD5_SHA1_CTX_SIZE];
 	/** SHA256 context for handshake verification */
 	uint8_t handshake_sha256_ctx[SHA256_CTX_SIZE];
+	/** SHA384 context for handshake verification */
+	uint8_t handshake_sha384_ctx[SHA512_CTX_SIZE];
 	/** Digest algorithm used for handshake verification */
 	struct digest_algorithm *handshake_digest;
 	/** Digest algorithm context used for handshake verification */
@@ -284,6 +454,8 @@ struct tls_connection {
 	struct x509_certificate *cert;
 	/** Secure renegotiation flag */
 	int secure_renegotiation;
+	/** Session resumption flag (for an abbreviated handshake) */
+	int resumed;
 	/** Verification data */
 	struct tls_verify_data verify;
 
@@ -299,6 +471,10 @@ struct tls_connection {
 
 	/** TX sequence number */
 	uint64_t tx_seq;
+	/** Maximum TX record plaintext length */
+	size_t tx_max_len;
+	/** Pending coalesced TX application data (if any) */
+	struct io_buffer *tx_data;
 	/** TX pending transmissions */
 	unsigned int tx_pending;
 	/** TX process */
@@ -316,6 +492,9 @@ struct tls_connection {
 	struct list_head rx_data;
 };
 
+/** Maximum record plaintext length */
+#define TLS_MAX_RECORD_LEN 16384
+
 /** RX I/O buffer size
  *
  * The maximum fragment length extension is optional, and many common
@@ -337,6 +516,16 @@ struct tls_connection {
 /** RX I/O buffer alignment */
 #define TLS_RX_ALIGN 16
 
+extern struct tls_key_exchange_algorithm tls_pubkey_exchange_algorithm;
+extern struct tls_key_exchange_algorithm tls_ecdhe_exchange_algorithm;
+
+extern const char * tls_protocol ( struct interface *intf );
+#define tls_protocol_TYPE( object_type ) \
+	typeof ( const char * ( object_type ) )
+
+extern int add_tls_alpn ( struct interface *xfer, const char *name,
+			  const void *alpn, size_t alpn_len,
+			  struct interface **next );
 extern int add_tls ( struct interface *xfer, const char *name,
 		     struct interface **next );
 
@@ -0,0 +1,60 @@
+#ifndef _IPXE_TRACE_H
+#define _IPXE_TRACE_H
+
+/** @file
+ *
+ * Boot timeline tracing
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+
+/** Number of trace events retained
+ *
+ * Must be a power of two.  Older events are overwritten once the
+ * trace buffer is full.
+ */
+#define TRACE_MAX_EVENTS 128
+
+/** Maximum length of a trace event name (including terminating NUL) */
+#define TRACE_NAME_LEN 48
+
+/** Trace event types */
+enum trace_type {
+	/** Start of an activity */
+	TRACE_START = 'B',
+	/** End of an activity */
+	TRACE_STOP = 'E',
+	/** Instantaneous event */
+	TRACE_MARK = 'I',
+};
+
+/** A trace event */
+struct trace_event {
+	/** Timestamp (in nanoseconds) */
+	uint64_t nsecs;
+	/** Event identifier of corresponding start event (if a stop event) */
+	unsigned int start;
+	/** Status code (if a stop event) */
+	int rc;
+	/** Event type */
+	uint8_t type;
+	/** Name */
+	char name[TRACE_NAME_LEN];
+};
+
+/** Identifier of next trace event to be recorded */
+extern unsigned int trace_next;
+
+extern unsigned int trace_start ( const char *fmt, ... )
+	__attribute__ (( format ( printf, 1, 2 ) ));
+extern void trace_stop ( unsigned int start, int rc );
+extern void trace_mark ( const char *fmt, ... )
+	__attribute__ (( format ( printf, 1, 2 ) ));
+extern struct trace_event * trace_event ( unsigned int id );
+extern unsigned int trace_first ( void );
+extern void trace_clear ( void );
+
+#endif /* _IPXE_TRACE_H */
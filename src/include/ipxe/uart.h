@@ -9,6 +9,7 @@
 
 FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
+#include <stddef.h>
 #include <stdint.h>
 
 /** Transmitter holding register */
@@ -24,6 +25,13 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #define UART_FCR 0x02
 #define UART_FCR_FE	0x01	/**< FIFO enable */
 
+/** Interrupt identification register */
+#define UART_IIR 0x02
+#define UART_IIR_FIFO	0xc0	/**< FIFOs enabled */
+
+/** Transmit FIFO length (for 16550A-compatible UARTs) */
+#define UART_FIFO_LEN 16
+
 /** Line control register */
 #define UART_LCR 0x03
 #define UART_LCR_WLS0	0x01	/**< Word length select bit 0 */
@@ -84,6 +92,8 @@ struct uart {
 	uint16_t divisor;
 	/** Line control register */
 	uint8_t lcr;
+	/** Transmit FIFO length */
+	uint8_t fifo_len;
 };
 
 /** Symbolic names for port indexes */
@@ -125,6 +135,7 @@ static inline uint8_t uart_receive ( struct uart *uart ) {
 }
 
 extern void uart_transmit ( struct uart *uart, uint8_t data );
+extern size_t uart_send ( struct uart *uart, const void *data, size_t len );
 extern void uart_flush ( struct uart *uart );
 extern int uart_exists ( struct uart *uart );
 extern int uart_init ( struct uart *uart, unsigned int baud, uint8_t lcr );
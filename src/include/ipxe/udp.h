@@ -37,6 +37,13 @@ struct udp_header {
 	uint16_t chksum;
 };
 
+/**
+ * Number of UDP connection hash buckets
+ *
+ * Must be a power of two.
+ */
+#define UDP_HASH_BUCKETS 16
+
 extern int udp_open_promisc ( struct interface *xfer );
 extern int udp_open ( struct interface *xfer, struct sockaddr *peer,
 		      struct sockaddr *local );
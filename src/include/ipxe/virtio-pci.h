@@ -133,6 +133,9 @@ struct virtio_pci_modern_device {
 
     /* VIRTIO_PCI_CAP_NOTIFY_CFG data */
     int notify_cap_pos;
+
+    /* Use packed virtqueues (VIRTIO_F_RING_PACKED negotiated) */
+    int packed;
 };
 
 static inline u32 vp_get_features(unsigned int ioaddr)
@@ -297,6 +300,12 @@ static inline u8 vpm_get_isr(struct virtio_pci_modern_device *vdev)
 void vpm_notify(struct virtio_pci_modern_device *vdev,
                 struct vring_virtqueue *vq);
 
+int vpm_find_vq(struct virtio_pci_modern_device *vdev,
+                unsigned index, struct vring_virtqueue *vq);
+
+void vpm_enable_vq(struct virtio_pci_modern_device *vdev,
+                   struct vring_virtqueue *vq);
+
 int vpm_find_vqs(struct virtio_pci_modern_device *vdev,
                  unsigned nvqs, struct vring_virtqueue *vqs);
 
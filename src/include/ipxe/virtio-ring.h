@@ -21,6 +21,8 @@
 /* v1.0 compliant. */
 #define VIRTIO_F_VERSION_1              32
 #define VIRTIO_F_IOMMU_PLATFORM         33
+/* Packed virtqueue layout */
+#define VIRTIO_F_RING_PACKED            34
 
 #define MAX_QUEUE_NUM      (256)
 
@@ -31,6 +33,14 @@
 
 #define VRING_USED_F_NO_NOTIFY     1
 
+/* Packed virtqueue descriptor flag bit positions */
+#define VRING_PACKED_DESC_F_AVAIL  7
+#define VRING_PACKED_DESC_F_USED   15
+
+/* Packed virtqueue event suppression flags */
+#define VRING_PACKED_EVENT_FLAG_ENABLE  0x0
+#define VRING_PACKED_EVENT_FLAG_DISABLE 0x1
+
 struct vring_desc
 {
    u64 addr;
@@ -66,18 +76,58 @@ struct vring {
    struct vring_used *used;
 };
 
+struct vring_packed_desc
+{
+   u64 addr;
+   u32 len;
+   u16 id;
+   u16 flags;
+};
+
+struct vring_packed_desc_event
+{
+   u16 off_wrap;
+   u16 flags;
+};
+
+/* Packed virtqueue state.  The descriptor ring, driver event suppression
+ * area and device event suppression area all fit within the memory
+ * allocated for a split virtqueue of the same size. */
+struct vring_packed {
+   struct vring_packed_desc *desc;
+   struct vring_packed_desc_event *driver;
+   struct vring_packed_desc_event *device;
+   /* next descriptor to make available, and its wrap counter */
+   u16 avail_idx;
+   u16 avail_wrap;
+   /* wrap counter for the descriptor at last_used_idx */
+   u16 used_wrap;
+   /* buffer ID free list, and descriptor count for each buffer ID */
+   u16 *id_next;
+   u16 *id_count;
+};
+
 #define vring_size(num) \
    (((((sizeof(struct vring_desc) * num) + \
       (sizeof(struct vring_avail) + sizeof(u16) * num)) \
          + PAGE_MASK) & ~PAGE_MASK) + \
          (sizeof(struct vring_used) + sizeof(struct vring_used_elem) * num))
 
+/* Per-buffer driver data size */
+#define vring_vdata_size(num) \
+   ((sizeof(void *) + 2 * sizeof(u16)) * num)
+
 struct vring_virtqueue {
    unsigned char *queue;
    struct vring vring;
+   /* split: first free descriptor; packed: first free buffer ID */
    u16 free_head;
+   /* split: used ring index; packed: next used descriptor */
    u16 last_used_idx;
    void **vdata;
+   /* packed virtqueue (if VIRTIO_F_RING_PACKED is negotiated) */
+   int packed;
+   struct vring_packed packed_ring;
    /* PCI */
    int queue_index;
    struct virtio_pci_region notification;
@@ -117,12 +167,18 @@ static inline void vring_init(struct vring *vr,
 
 static inline void vring_enable_cb(struct vring_virtqueue *vq)
 {
-   vq->vring.avail->flags &= ~VRING_AVAIL_F_NO_INTERRUPT;
+   if (vq->packed)
+           vq->packed_ring.driver->flags = VRING_PACKED_EVENT_FLAG_ENABLE;
+   else
+           vq->vring.avail->flags &= ~VRING_AVAIL_F_NO_INTERRUPT;
 }
 
 static inline void vring_disable_cb(struct vring_virtqueue *vq)
 {
-   vq->vring.avail->flags |= VRING_AVAIL_F_NO_INTERRUPT;
+   if (vq->packed)
+           vq->packed_ring.driver->flags = VRING_PACKED_EVENT_FLAG_DISABLE;
+   else
+           vq->vring.avail->flags |= VRING_AVAIL_F_NO_INTERRUPT;
 }
 
 
@@ -135,10 +191,23 @@ static inline void vring_disable_cb(struct vring_virtqueue *vq)
 
 static inline int vring_more_used(struct vring_virtqueue *vq)
 {
+   u16 flags;
+   int avail;
+   int used;
+
    wmb();
-   return vq->last_used_idx != vq->vring.used->idx;
+   if (!vq->packed)
+           return vq->last_used_idx != vq->vring.used->idx;
+
+   /* a descriptor has been used when its AVAIL and USED flags both
+    * match the current used wrap counter */
+   flags = vq->packed_ring.desc[vq->last_used_idx].flags;
+   avail = !!(flags & (1 << VRING_PACKED_DESC_F_AVAIL));
+   used = !!(flags & (1 << VRING_PACKED_DESC_F_USED));
+   return (avail == used) && (used == vq->packed_ring.used_wrap);
 }
 
+void vring_packed_init(struct vring_virtqueue *vq, unsigned int num);
 void vring_detach(struct vring_virtqueue *vq, unsigned int head);
 void *vring_get_buf(struct vring_virtqueue *vq, unsigned int *len);
 void vring_add_buf(struct vring_virtqueue *vq, struct vring_list list[],
@@ -510,6 +510,10 @@ struct vmbus_device {
 	void *packet;
 	/** List of transfer page sets */
 	struct list_head pages;
+	/** Inbound ring buffer is being drained */
+	int draining;
+	/** Signal to host has been deferred */
+	int signal_pending;
 
 	/** Driver */
 	struct vmbus_driver *driver;
@@ -651,6 +655,7 @@ extern int vmbus_send_completion ( struct vmbus_device *vmdev, uint64_t xid,
 				   const void *data, size_t len );
 extern int vmbus_send_cancellation ( struct vmbus_device *vmdev, uint64_t xid );
 extern int vmbus_poll ( struct vmbus_device *vmdev );
+extern void vmbus_drain ( struct vmbus_device *vmdev );
 extern void vmbus_dump_channel ( struct vmbus_device *vmdev );
 
 extern int vmbus_probe ( struct hv_hypervisor *hv, struct device *parent );
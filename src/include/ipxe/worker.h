@@ -0,0 +1,118 @@
+#ifndef _IPXE_WORKER_H
+#define _IPXE_WORKER_H
+
+/** @file
+ *
+ * Worker CPU cores
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stddef.h>
+#include <ipxe/list.h>
+
+struct worker_job;
+struct worker_core;
+struct digest_algorithm;
+
+/** Worker job operations */
+struct worker_job_operations {
+	/** Run job
+	 *
+	 * @v job		Worker job
+	 *
+	 * This method may be called on a secondary CPU core,
+	 * concurrently with the main loop.  It must touch only data
+	 * owned by the job, and must not allocate memory, generate
+	 * debug output, or call any firmware services.
+	 */
+	void ( * run ) ( struct worker_job *job );
+	/** Handle job completion
+	 *
+	 * @v job		Worker job
+	 *
+	 * This method is called from the main loop once the job has
+	 * finished running.
+	 */
+	void ( * done ) ( struct worker_job *job );
+};
+
+/** A worker job */
+struct worker_job {
+	/** List of queued jobs */
+	struct list_head list;
+	/** Job operations */
+	struct worker_job_operations *op;
+};
+
+/** Worker core operations */
+struct worker_core_operations {
+	/** Start running job
+	 *
+	 * @v core		Worker core
+	 * @v job		Worker job
+	 * @ret rc		Return status code
+	 */
+	int ( * start ) ( struct worker_core *core, struct worker_job *job );
+	/** Check for job completion
+	 *
+	 * @v core		Worker core
+	 * @ret done		Job has finished running
+	 */
+	int ( * poll ) ( struct worker_core *core );
+};
+
+/** A worker CPU core */
+struct worker_core {
+	/** List of worker cores */
+	struct list_head list;
+	/** Name */
+	const char *name;
+	/** Core operations */
+	struct worker_core_operations *op;
+	/** Currently running job, or NULL if idle */
+	struct worker_job *job;
+};
+
+/** A digest worker job */
+struct worker_digest {
+	/** Worker job */
+	struct worker_job job;
+	/** Digest algorithm */
+	struct digest_algorithm *digest;
+	/** Digest context */
+	void *ctx;
+	/** Data */
+	const void *data;
+	/** Length of data */
+	size_t len;
+	/** Job has completed */
+	int done;
+};
+
+/**
+ * Initialise a worker job
+ *
+ * @v job		Worker job
+ * @v op		Job operations
+ */
+static inline __attribute__ (( always_inline )) void
+worker_job_init ( struct worker_job *job, struct worker_job_operations *op ) {
+	INIT_LIST_HEAD ( &job->list );
+	job->op = op;
+}
+
+extern void worker_submit ( struct worker_job *job );
+extern void worker_cancel ( struct worker_job *job );
+extern void worker_register ( struct worker_core *core );
+extern void worker_unregister ( struct worker_core *core );
+extern unsigned int worker_count ( void );
+extern void worker_digest_submit ( struct worker_digest *wdigest,
+				   struct digest_algorithm *digest, void *ctx,
+				   const void *data, size_t len );
+extern void worker_digest_wait ( struct worker_digest *wdigest );
+extern void worker_digest ( struct digest_algorithm *digest, void *ctx,
+			    const void *data, size_t len );
+
+#endif /* _IPXE_WORKER_H */
@@ -0,0 +1,33 @@
+#ifndef _IPXE_X25519_H
+#define _IPXE_X25519_H
+
+/** @file
+ *
+ * X25519 key exchange
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <ipxe/crypto.h>
+
+/** X25519 key (and point) size */
+#define X25519_SIZE 32
+
+/** An X25519 field element
+ *
+ * Field elements are held in sixteen signed limbs, each nominally
+ * holding 16 bits.  The use of wide signed limbs allows additions and
+ * subtractions to be performed without immediate carry propagation.
+ */
+struct x25519_field {
+	/** Limbs (least significant first) */
+	int64_t limb[16];
+};
+
+extern int x25519_key ( const void *base, const void *scalar, void *result );
+
+extern struct elliptic_curve x25519_curve;
+
+#endif /* _IPXE_X25519_H */
@@ -15,6 +15,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/asn1.h>
 #include <ipxe/refcnt.h>
 #include <ipxe/list.h>
+#include <ipxe/sha256.h>
 
 struct image;
 
@@ -110,6 +111,8 @@ enum x509_key_usage_bits {
 
 /** An X.509 certificate extended key usage */
 struct x509_extended_key_usage {
+	/** Raw extended key usage (parsed on demand) */
+	struct asn1_cursor raw;
 	/** Usage bits */
 	unsigned int bits;
 };
@@ -134,6 +137,8 @@ struct x509_ocsp_responder {
 
 /** X.509 certificate authority information access */
 struct x509_authority_info_access {
+	/** Raw authority information access (parsed on demand) */
+	struct asn1_cursor raw;
 	/** OCSP responder */
 	struct x509_ocsp_responder ocsp;
 };
@@ -196,6 +201,8 @@ struct x509_certificate {
 
 	/** Raw certificate */
 	struct asn1_cursor raw;
+	/** SHA-256 fingerprint (if X509_FL_FINGERPRINT is set) */
+	uint8_t fingerprint[SHA256_DIGEST_SIZE];
 	/** Version */
 	unsigned int version;
 	/** Serial number */
@@ -224,6 +231,10 @@ enum x509_flags {
 	X509_FL_PERMANENT = 0x0002,
 	/** Certificate was added explicitly at run time */
 	X509_FL_EXPLICIT = 0x0004,
+	/** SHA-256 fingerprint has been calculated */
+	X509_FL_FINGERPRINT = 0x0008,
+	/** Deferred extensions have been parsed */
+	X509_FL_DEFERRED = 0x0010,
 };
 
 /**
@@ -348,9 +359,17 @@ struct x509_root {
 	unsigned int count;
 	/** Certificate fingerprints */
 	const void *fingerprints;
+	/** Generation
+	 *
+	 * This must be incremented whenever the list of certificate
+	 * fingerprints is changed, to invalidate any cached
+	 * validation results.
+	 */
+	unsigned int generation;
 };
 
 extern const char * x509_name ( struct x509_certificate *cert );
+extern int x509_parse_deferred ( struct x509_certificate *cert );
 extern int x509_parse ( struct x509_certificate *cert,
 			const struct asn1_cursor *raw );
 extern int x509_certificate ( const void *data, size_t len,
@@ -382,6 +401,7 @@ extern void x509_fingerprint ( struct x509_certificate *cert,
 extern int x509_check_root ( struct x509_certificate *cert,
 			     struct x509_root *root );
 extern int x509_check_time ( struct x509_certificate *cert, time_t time );
+extern void x509_invalidate ( struct x509_certificate *cert );
 
 /**
  * Check if X.509 certificate is valid
@@ -393,13 +413,20 @@ static inline int x509_is_valid ( struct x509_certificate *cert ) {
 }
 
 /**
- * Invalidate X.509 certificate
+ * Check X.509 certificate extended key usage
  *
  * @v cert		X.509 certificate
+ * @v bits		Required extended key usage bits
+ * @ret has_usage	Certificate has all required extended key usages
  */
-static inline void x509_invalidate ( struct x509_certificate *cert ) {
-	cert->flags &= ~X509_FL_VALIDATED;
-	cert->path_remaining = 0;
+static inline int x509_has_ext_usage ( struct x509_certificate *cert,
+				       unsigned int bits ) {
+
+	/* Treat an unparseable extension as granting no usages */
+	if ( x509_parse_deferred ( cert ) != 0 )
+		return 0;
+
+	return ( ( cert->extensions.ext_usage.bits & bits ) == bits );
 }
 
 /**
@@ -15,16 +15,35 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/interface.h>
 #include <ipxe/xfer.h>
 
+struct digest_algorithm;
+
 /** A data transfer buffer */
 struct xfer_buffer {
 	/** Data */
 	void *data;
 	/** Size of data */
 	size_t len;
+	/** Allocated size of data
+	 *
+	 * This may exceed the size of data, in order to allow for
+	 * future growth without reallocation.
+	 */
+	size_t alloc;
 	/** Current offset within data */
 	size_t pos;
 	/** Data transfer buffer operations */
 	struct xfer_buffer_operations *op;
+	/** Streaming digest algorithm, or NULL
+	 *
+	 * If present, the digest is updated as data is written
+	 * sequentially to the buffer.  Any out-of-order write will
+	 * cause the streaming digest to be abandoned.
+	 */
+	struct digest_algorithm *digest;
+	/** Streaming digest context */
+	void *digest_ctx;
+	/** Length of data included in streaming digest */
+	size_t digest_len;
 };
 
 /** Data transfer buffer operations */
@@ -89,7 +108,10 @@ xferbuf_umalloc_init ( struct xfer_buffer *xferbuf, userptr_t *data ) {
 	xferbuf->op = &xferbuf_umalloc_operations;
 }
 
+extern void xferbuf_digest_init ( struct xfer_buffer *xferbuf,
+				 struct digest_algorithm *digest, void *ctx );
 extern void xferbuf_free ( struct xfer_buffer *xferbuf );
+extern int xferbuf_trim ( struct xfer_buffer *xferbuf );
 extern int xferbuf_write ( struct xfer_buffer *xferbuf, size_t offset,
 			   const void *data, size_t len );
 extern int xferbuf_read ( struct xfer_buffer *xferbuf, size_t offset,
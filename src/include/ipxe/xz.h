@@ -0,0 +1,373 @@
+#ifndef _IPXE_XZ_H
+#define _IPXE_XZ_H
+
+/** @file
+ *
+ * xz decompression
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <ipxe/uaccess.h>
+#include <ipxe/sha256.h>
+#include <ipxe/deflate.h>
+#include <ipxe/decompress.h>
+
+/** Length of stream header magic */
+#define XZ_MAGIC_LEN 6
+
+/** Length of stream header (and stream footer) */
+#define XZ_STREAM_HEADER_LEN 12
+
+/** Stream footer magic */
+#define XZ_FOOTER_MAGIC "YZ"
+
+/** Stream flags check type mask */
+#define XZ_CHECK_MASK 0x0f
+
+/** Check type: none */
+#define XZ_CHECK_NONE 0x00
+
+/** Check type: CRC32 */
+#define XZ_CHECK_CRC32 0x01
+
+/** Check type: CRC64 */
+#define XZ_CHECK_CRC64 0x04
+
+/** Check type: SHA-256 */
+#define XZ_CHECK_SHA256 0x0a
+
+/** Maximum length of integrity check */
+#define XZ_CHECK_MAX 64
+
+/** Maximum length of block header */
+#define XZ_BLOCK_HEADER_MAX 1024
+
+/** Block flags number of filters mask */
+#define XZ_BLOCK_FILTERS_MASK 0x03
+
+/** Block flags reserved bits */
+#define XZ_BLOCK_RESERVED 0x3c
+
+/** Block flags compressed size present */
+#define XZ_BLOCK_COMPRESSED 0x40
+
+/** Block flags uncompressed size present */
+#define XZ_BLOCK_UNCOMPRESSED 0x80
+
+/** LZMA2 filter ID */
+#define XZ_FILTER_LZMA2 0x21
+
+/** Maximum supported dictionary size */
+#define XZ_DICT_MAX ( 64 * 1024 * 1024 )
+
+/** Maximum length of LZMA2 chunk header (excluding control byte) */
+#define XZ_LZMA2_HEADER_MAX 5
+
+/** LZMA2 end of data control byte */
+#define XZ_LZMA2_END 0x00
+
+/** LZMA2 uncompressed chunk with dictionary reset control byte */
+#define XZ_LZMA2_COPY_RESET 0x01
+
+/** LZMA2 uncompressed chunk control byte */
+#define XZ_LZMA2_COPY 0x02
+
+/** LZMA2 LZMA chunk control byte */
+#define XZ_LZMA2_LZMA 0x80
+
+/** LZMA2 LZMA chunk with state reset control byte */
+#define XZ_LZMA2_STATE_RESET 0xa0
+
+/** LZMA2 LZMA chunk with new properties control byte */
+#define XZ_LZMA2_PROPS_RESET 0xc0
+
+/** LZMA2 LZMA chunk with dictionary reset control byte */
+#define XZ_LZMA2_DICT_RESET 0xe0
+
+/** Maximum length of LZMA2 packed chunk */
+#define XZ_LZMA2_PACKED_MAX ( 64 * 1024 )
+
+/** Number of LZMA states */
+#define XZ_LZMA_STATES 12
+
+/** Number of LZMA states following a literal */
+#define XZ_LZMA_LIT_STATES 7
+
+/** Maximum number of LZMA position states */
+#define XZ_LZMA_POS_STATES_MAX 16
+
+/** Maximum number of LZMA literal coders */
+#define XZ_LZMA_LITERALS_MAX 16
+
+/** Number of probabilities in each LZMA literal coder */
+#define XZ_LZMA_LITERAL_SIZE 0x300
+
+/** Minimum LZMA match length */
+#define XZ_LZMA_MATCH_LEN_MIN 2
+
+/** Number of LZMA low (and middle) length symbols */
+#define XZ_LZMA_LEN_LOW 8
+
+/** Number of LZMA high length symbols */
+#define XZ_LZMA_LEN_HIGH 256
+
+/** Number of LZMA distance states */
+#define XZ_LZMA_DIST_STATES 4
+
+/** Number of LZMA distance slots */
+#define XZ_LZMA_DIST_SLOTS 64
+
+/** First LZMA distance slot using extra bits */
+#define XZ_LZMA_DIST_MODEL_START 4
+
+/** First LZMA distance slot using direct bits */
+#define XZ_LZMA_DIST_MODEL_END 14
+
+/** Number of LZMA distances covered by distance model */
+#define XZ_LZMA_FULL_DISTANCES 128
+
+/** Number of LZMA alignment bits */
+#define XZ_LZMA_ALIGN_BITS 4
+
+/** An LZMA length decoder */
+struct xz_lzma_length {
+	/** Choice between low and higher lengths */
+	uint16_t choice;
+	/** Choice between middle and high lengths */
+	uint16_t choice2;
+	/** Low lengths */
+	uint16_t low[XZ_LZMA_POS_STATES_MAX][XZ_LZMA_LEN_LOW];
+	/** Middle lengths */
+	uint16_t mid[XZ_LZMA_POS_STATES_MAX][XZ_LZMA_LEN_LOW];
+	/** High lengths */
+	uint16_t high[XZ_LZMA_LEN_HIGH];
+};
+
+/** LZMA probabilities */
+struct xz_lzma_probs {
+	/** Match flags */
+	uint16_t is_match[XZ_LZMA_STATES][XZ_LZMA_POS_STATES_MAX];
+	/** Repeated match flags */
+	uint16_t is_rep[XZ_LZMA_STATES];
+	/** First repeated distance flags */
+	uint16_t is_rep0[XZ_LZMA_STATES];
+	/** Second repeated distance flags */
+	uint16_t is_rep1[XZ_LZMA_STATES];
+	/** Third repeated distance flags */
+	uint16_t is_rep2[XZ_LZMA_STATES];
+	/** Long first repeated distance flags */
+	uint16_t is_rep0_long[XZ_LZMA_STATES][XZ_LZMA_POS_STATES_MAX];
+	/** Distance slots */
+	uint16_t dist_slot[XZ_LZMA_DIST_STATES][XZ_LZMA_DIST_SLOTS];
+	/** Distance extra bits */
+	uint16_t dist_special[ XZ_LZMA_FULL_DISTANCES -
+			       XZ_LZMA_DIST_MODEL_END ];
+	/** Distance alignment bits */
+	uint16_t dist_align[ 1 << XZ_LZMA_ALIGN_BITS ];
+	/** Match length decoder */
+	struct xz_lzma_length match_len;
+	/** Repeated match length decoder */
+	struct xz_lzma_length rep_len;
+	/** Literal coders */
+	uint16_t literal[XZ_LZMA_LITERALS_MAX][XZ_LZMA_LITERAL_SIZE];
+};
+
+/** An LZMA range decoder */
+struct xz_rc {
+	/** Input data */
+	const uint8_t *data;
+	/** Length of input data */
+	size_t len;
+	/** Current offset within input data */
+	size_t offset;
+	/** Range */
+	uint32_t range;
+	/** Code */
+	uint32_t code;
+};
+
+/** LZMA decoder */
+struct xz_lzma {
+	/** Number of literal context bits */
+	unsigned int lc;
+	/** Literal position mask */
+	unsigned int lp_mask;
+	/** Position mask */
+	unsigned int pb_mask;
+	/** Current state */
+	unsigned int state;
+	/** Repeated distances */
+	uint32_t rep[4];
+	/** Remaining length of current match */
+	unsigned int len;
+	/** Position within dictionary (since last dictionary reset) */
+	size_t pos;
+	/** Range decoder */
+	struct xz_rc rc;
+	/** Probabilities */
+	struct xz_lzma_probs probs;
+};
+
+/** Integrity check */
+union xz_check {
+	/** CRC32 */
+	uint32_t crc32;
+	/** CRC64 */
+	uint64_t crc64;
+	/** SHA-256 */
+	struct sha256_context sha256;
+	/** Raw bytes */
+	uint8_t bytes[XZ_CHECK_MAX];
+};
+
+/** Decompressor state */
+enum xz_state {
+	/** Awaiting stream header */
+	XZ_STATE_STREAM_HEADER = 0,
+	/** Awaiting block header size (or index indicator) */
+	XZ_STATE_BLOCK_HEADER_SIZE,
+	/** Awaiting block header */
+	XZ_STATE_BLOCK_HEADER,
+	/** Awaiting LZMA2 control byte */
+	XZ_STATE_LZMA2_CONTROL,
+	/** Awaiting LZMA2 chunk header */
+	XZ_STATE_LZMA2_HEADER,
+	/** Copying LZMA2 uncompressed chunk */
+	XZ_STATE_LZMA2_COPY,
+	/** Accumulating LZMA2 packed chunk */
+	XZ_STATE_LZMA2_PACKED,
+	/** Decoding LZMA2 packed chunk */
+	XZ_STATE_LZMA2_DECODE,
+	/** Skipping block padding */
+	XZ_STATE_BLOCK_PADDING,
+	/** Awaiting block check */
+	XZ_STATE_CHECK,
+	/** Parsing index records */
+	XZ_STATE_INDEX,
+	/** Skipping index padding */
+	XZ_STATE_INDEX_PADDING,
+	/** Awaiting index CRC */
+	XZ_STATE_INDEX_CRC,
+	/** Awaiting stream footer */
+	XZ_STATE_STREAM_FOOTER,
+	/** Skipping stream padding */
+	XZ_STATE_STREAM_PADDING,
+};
+
+/** Index totals */
+struct xz_index {
+	/** Number of records */
+	uint64_t count;
+	/** Total unpadded size */
+	uint64_t unpadded;
+	/** Total uncompressed size */
+	uint64_t uncompressed;
+};
+
+/** Decompressor */
+struct xz {
+	/** Current state */
+	enum xz_state state;
+	/** At least one stream header has been seen */
+	int started;
+	/** Header accumulation buffer */
+	uint8_t header[XZ_BLOCK_HEADER_MAX];
+	/** Length of accumulated header */
+	size_t header_len;
+
+	/** Stream flags */
+	uint16_t flags;
+	/** Length of integrity check */
+	size_t check_len;
+	/** Integrity check */
+	union xz_check check;
+	/** Length of stream padding */
+	size_t padding;
+	/** Remaining length of block padding */
+	size_t block_padding;
+
+	/** Block header length */
+	size_t block_header_len;
+	/** Block flags */
+	uint8_t block_flags;
+	/** Expected block compressed size (if present) */
+	uint64_t expected_compressed;
+	/** Expected block uncompressed size (if present) */
+	uint64_t expected_uncompressed;
+	/** Block compressed size */
+	uint64_t compressed;
+	/** Block uncompressed size */
+	uint64_t uncompressed;
+	/** Dictionary size */
+	size_t dict_size;
+
+	/** Decoded block totals */
+	struct xz_index blocks;
+	/** Index record totals */
+	struct xz_index index;
+	/** Index length */
+	uint64_t index_len;
+	/** Index CRC32 */
+	uint32_t index_crc;
+	/** Number of index fields parsed (including record count) */
+	uint64_t index_fields;
+	/** Partial index integer value */
+	uint64_t vli;
+	/** Partial index integer shift */
+	unsigned int vli_shift;
+
+	/** LZMA2 control byte */
+	uint8_t control;
+	/** LZMA2 dictionary reset is required */
+	int need_dict_reset;
+	/** LZMA2 properties are required */
+	int need_props;
+	/** Remaining uncompressed length of LZMA2 chunk */
+	size_t remaining;
+	/** LZMA2 packed chunk buffer */
+	userptr_t buffer;
+	/** Length of LZMA2 packed chunk */
+	size_t packed_len;
+	/** Length of accumulated LZMA2 packed chunk */
+	size_t buffer_len;
+
+	/** LZMA decoder */
+	struct xz_lzma lzma;
+};
+
+/**
+ * Check if decompression has finished
+ *
+ * @v xz		Decompressor
+ * @ret finished	Decompression has finished
+ *
+ * Decompression is finished if at least one stream has been seen, no
+ * stream is currently in progress, and any stream padding is a
+ * multiple of four bytes.
+ */
+static inline int xz_finished ( struct xz *xz ) {
+	return ( xz->started && ( xz->state == XZ_STATE_STREAM_PADDING ) &&
+		 ( ( xz->padding % 4 ) == 0 ) );
+}
+
+/**
+ * Get required history length
+ *
+ * @v xz		Decompressor
+ * @ret len		Length of output history that must be retained
+ */
+static inline size_t xz_history ( struct xz *xz ) {
+	return xz->dict_size;
+}
+
+extern int xz_init ( struct xz *xz );
+extern void xz_fini ( struct xz *xz );
+extern int xz_inflate ( struct xz *xz, struct deflate_chunk *in,
+			struct deflate_chunk *out );
+
+extern struct decompressor xz_decompressor;
+
+#endif /* _IPXE_XZ_H */
@@ -0,0 +1,291 @@
+#ifndef _IPXE_ZSTD_H
+#define _IPXE_ZSTD_H
+
+/** @file
+ *
+ * Zstandard decompression algorithm
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <ipxe/uaccess.h>
+#include <ipxe/deflate.h>
+#include <ipxe/decompress.h>
+
+/** Zstandard frame magic number */
+#define ZSTD_MAGIC 0xfd2fb528UL
+
+/** Zstandard skippable frame magic number */
+#define ZSTD_SKIPPABLE_MAGIC 0x184d2a50UL
+
+/** Zstandard skippable frame magic number mask */
+#define ZSTD_SKIPPABLE_MASK 0xfffffff0UL
+
+/** Frame header descriptor content size field size shift */
+#define ZSTD_FHD_FCS_SHIFT 6
+
+/** Frame header descriptor single segment flag */
+#define ZSTD_FHD_SINGLE 0x20
+
+/** Frame header descriptor reserved bit */
+#define ZSTD_FHD_RESERVED 0x08
+
+/** Frame header descriptor content checksum flag */
+#define ZSTD_FHD_CHECKSUM 0x04
+
+/** Frame header descriptor dictionary ID field size mask */
+#define ZSTD_FHD_DID_MASK 0x03
+
+/** Maximum length of frame header (excluding magic and descriptor) */
+#define ZSTD_FRAME_HEADER_MAX ( 1 /* window */ + 4 /* DID */ + 8 /* FCS */ )
+
+/** Minimum window size exponent */
+#define ZSTD_WINDOW_LOG_MIN 10
+
+/** Maximum supported window size
+ *
+ * This is the minimum window size that the specification requires
+ * decoders to support.
+ */
+#define ZSTD_WINDOW_MAX ( 8 * 1024 * 1024 )
+
+/** Block header length */
+#define ZSTD_BLOCK_HEADER_LEN 3
+
+/** Block header last block flag */
+#define ZSTD_BLOCK_LAST 0x01
+
+/** Block header type shift */
+#define ZSTD_BLOCK_TYPE_SHIFT 1
+
+/** Block header type mask */
+#define ZSTD_BLOCK_TYPE_MASK 0x03
+
+/** Block header size shift */
+#define ZSTD_BLOCK_SIZE_SHIFT 3
+
+/** Raw block */
+#define ZSTD_BLOCK_RAW 0
+
+/** RLE block */
+#define ZSTD_BLOCK_RLE 1
+
+/** Compressed block */
+#define ZSTD_BLOCK_COMPRESSED 2
+
+/** Maximum block size */
+#define ZSTD_BLOCK_MAX ( 128 * 1024 )
+
+/** Content checksum length */
+#define ZSTD_CHECKSUM_LEN 4
+
+/** Raw literals block */
+#define ZSTD_LITERALS_RAW 0
+
+/** RLE literals block */
+#define ZSTD_LITERALS_RLE 1
+
+/** Compressed literals block */
+#define ZSTD_LITERALS_COMPRESSED 2
+
+/** Treeless literals block (reusing previous Huffman table) */
+#define ZSTD_LITERALS_TREELESS 3
+
+/** Maximum Huffman code length */
+#define ZSTD_HUFFMAN_MAX_BITS 11
+
+/** Maximum number of Huffman weights transmitted */
+#define ZSTD_HUFFMAN_MAX_WEIGHTS 255
+
+/** Maximum accuracy log for FSE-compressed Huffman weights */
+#define ZSTD_HUFFMAN_FSE_MAX_LOG 6
+
+/** Maximum accuracy log for any FSE table */
+#define ZSTD_FSE_MAX_LOG 9
+
+/** Maximum literals length code */
+#define ZSTD_LL_MAX_CODE 35
+
+/** Maximum literals length accuracy log */
+#define ZSTD_LL_MAX_LOG 9
+
+/** Maximum match length code */
+#define ZSTD_ML_MAX_CODE 52
+
+/** Maximum match length accuracy log */
+#define ZSTD_ML_MAX_LOG 9
+
+/** Maximum offset code */
+#define ZSTD_OF_MAX_CODE 31
+
+/** Maximum offset accuracy log */
+#define ZSTD_OF_MAX_LOG 8
+
+/** Symbol compression mode: predefined distribution */
+#define ZSTD_MODE_PREDEFINED 0
+
+/** Symbol compression mode: RLE */
+#define ZSTD_MODE_RLE 1
+
+/** Symbol compression mode: FSE-compressed distribution */
+#define ZSTD_MODE_FSE 2
+
+/** Symbol compression mode: repeat previous table */
+#define ZSTD_MODE_REPEAT 3
+
+/** Number of repeated offsets */
+#define ZSTD_REPEAT_COUNT 3
+
+/** An FSE decoding table entry */
+struct zstd_fse_entry {
+	/** Symbol */
+	uint8_t symbol;
+	/** Number of bits to read for next state */
+	uint8_t bits;
+	/** Base value for next state */
+	uint16_t base;
+};
+
+/** An FSE decoding table */
+struct zstd_fse {
+	/** Accuracy log */
+	uint8_t log;
+	/** Table is valid (and may be repeated) */
+	uint8_t valid;
+	/** Table entries */
+	struct zstd_fse_entry entry[ 1 << ZSTD_FSE_MAX_LOG ];
+};
+
+/** A Huffman decoding table entry */
+struct zstd_huffman_entry {
+	/** Symbol */
+	uint8_t symbol;
+	/** Code length */
+	uint8_t bits;
+};
+
+/** A Huffman decoding table */
+struct zstd_huffman {
+	/** Maximum code length (or zero if table is not valid) */
+	unsigned int bits;
+	/** Table entries */
+	struct zstd_huffman_entry entry[ 1 << ZSTD_HUFFMAN_MAX_BITS ];
+};
+
+/** An XXH64 hash calculation */
+struct zstd_xxh64 {
+	/** Accumulators */
+	uint64_t acc[4];
+	/** Total length */
+	uint64_t len;
+	/** Partial stripe */
+	uint8_t buf[32];
+};
+
+/** Decompressor state */
+enum zstd_state {
+	/** Awaiting frame magic number */
+	ZSTD_STATE_MAGIC = 0,
+	/** Awaiting skippable frame length */
+	ZSTD_STATE_SKIP_LEN,
+	/** Skipping skippable frame */
+	ZSTD_STATE_SKIP,
+	/** Awaiting frame header descriptor */
+	ZSTD_STATE_DESCRIPTOR,
+	/** Awaiting remainder of frame header */
+	ZSTD_STATE_FRAME_HEADER,
+	/** Awaiting block header */
+	ZSTD_STATE_BLOCK_HEADER,
+	/** Copying raw block */
+	ZSTD_STATE_RAW,
+	/** Awaiting RLE block byte */
+	ZSTD_STATE_RLE_BYTE,
+	/** Generating RLE block */
+	ZSTD_STATE_RLE,
+	/** Accumulating compressed block */
+	ZSTD_STATE_COMPRESSED,
+	/** Awaiting content checksum */
+	ZSTD_STATE_CHECKSUM,
+};
+
+/** Decompressor */
+struct zstd {
+	/** Current state */
+	enum zstd_state state;
+	/** At least one frame header has been seen */
+	int started;
+	/** Header accumulation buffer */
+	uint8_t header[ZSTD_FRAME_HEADER_MAX];
+	/** Length of accumulated header */
+	size_t header_len;
+
+	/** Frame header descriptor */
+	uint8_t descriptor;
+	/** Window size */
+	size_t window;
+	/** Frame content size (if present) */
+	uint64_t content_len;
+	/** Total length of content produced within frame */
+	uint64_t produced;
+	/** Content checksum */
+	struct zstd_xxh64 xxh64;
+	/** Repeated offsets */
+	uint32_t repeat[ZSTD_REPEAT_COUNT];
+
+	/** Current block header */
+	unsigned int block_header;
+	/** Remaining length of current block */
+	size_t remaining;
+	/** RLE block byte */
+	uint8_t rle;
+	/** Compressed block and literals buffer */
+	userptr_t buffer;
+	/** Length of accumulated compressed block */
+	size_t block_len;
+
+	/** Huffman table for literals */
+	struct zstd_huffman huffman;
+	/** Literals length FSE table */
+	struct zstd_fse ll;
+	/** Offset FSE table */
+	struct zstd_fse of;
+	/** Match length FSE table */
+	struct zstd_fse ml;
+	/** Huffman weights FSE table */
+	struct zstd_fse weights;
+};
+
+/**
+ * Check if decompression has finished
+ *
+ * @v zstd		Decompressor
+ * @ret finished	Decompression has finished
+ *
+ * Decompression is finished if at least one frame has been seen, and
+ * no frame is currently in progress.
+ */
+static inline int zstd_finished ( struct zstd *zstd ) {
+	return ( zstd->started && ( zstd->state == ZSTD_STATE_MAGIC ) &&
+		 ( zstd->header_len == 0 ) );
+}
+
+/**
+ * Get required history length
+ *
+ * @v zstd		Decompressor
+ * @ret len		Length of output history that must be retained
+ */
+static inline size_t zstd_history ( struct zstd *zstd ) {
+	return zstd->window;
+}
+
+extern int zstd_init ( struct zstd *zstd );
+extern void zstd_fini ( struct zstd *zstd );
+extern int zstd_inflate ( struct zstd *zstd, struct deflate_chunk *in,
+			  struct deflate_chunk *out );
+
+extern struct decompressor zstd_decompressor;
+
+#endif /* _IPXE_ZSTD_H */
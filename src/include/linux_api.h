@@ -73,6 +73,8 @@ extern int linux_munmap ( void *addr, __kernel_size_t length );
 extern int linux_socket ( int domain, int type_, int protocol );
 extern int linux_bind ( int fd, const struct sockaddr *addr,
 			socklen_t addrlen );
+extern int linux_setsockopt ( int fd, int level, int optname,
+			      const void *optval, socklen_t optlen );
 extern ssize_t linux_sendto ( int fd, const void *buf, size_t len, int flags,
 			      const struct sockaddr *daddr, socklen_t addrlen );
 
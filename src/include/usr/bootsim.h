@@ -0,0 +1,16 @@
+#ifndef _USR_BOOTSIM_H
+#define _USR_BOOTSIM_H
+
+/** @file
+ *
+ * Multi-client boot simulation
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+struct uri;
+
+extern int bootsim ( struct uri *uri, unsigned long timeout );
+
+#endif /* _USR_BOOTSIM_H */
@@ -11,10 +11,20 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 #include <ipxe/image.h>
 
+struct digest_algorithm;
+
+extern int imgdownload_digest ( struct uri *uri, unsigned long timeout,
+				struct digest_algorithm *digest,
+				const void *value, struct image **image );
 extern int imgdownload ( struct uri *uri, unsigned long timeout,
 			 struct image **image );
 extern int imgdownload_string ( const char *uri_string, unsigned long timeout,
 				struct image **image );
+extern int imgdownloads ( struct uri **uris, unsigned int count,
+			  unsigned long timeout );
+extern int imgprefetch ( const char *uri_string, unsigned long timeout,
+			 struct image **image );
+extern int imgprefetch_wait ( const char *name, unsigned long timeout );
 extern int imgacquire ( const char *name, unsigned long timeout,
 			struct image **image );
 extern void imgstat ( struct image *image );
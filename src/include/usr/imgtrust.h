@@ -13,5 +13,8 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 extern int imgverify ( struct image *image, struct image *signature,
 		       const char *name );
+extern int imgmanifest ( struct image *manifest, struct image *signature,
+			 const char *name );
+extern int imgverify_manifest ( struct image *image );
 
 #endif /* _USR_IMGTRUST_H */
@@ -0,0 +1,21 @@
+#ifndef _USR_IPERF_H
+#define _USR_IPERF_H
+
+/** @file
+ *
+ * TCP throughput testing
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stddef.h>
+
+/** Default iperf port */
+#define IPERF_PORT 5001
+
+extern int iperf_client ( const char *hostname, unsigned int port,
+			  unsigned long duration, size_t len );
+extern int iperf_server ( unsigned int port );
+
+#endif /* _USR_IPERF_H */
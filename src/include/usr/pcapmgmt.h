@@ -0,0 +1,16 @@
+#ifndef _USR_PCAPMGMT_H
+#define _USR_PCAPMGMT_H
+
+/** @file
+ *
+ * Packet capture management
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+extern void pcap_show ( void );
+extern int pcap_save ( const char *name );
+extern int pcap_post ( const char *uri_string, unsigned long timeout );
+
+#endif /* _USR_PCAPMGMT_H */
@@ -10,5 +10,8 @@
 FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 extern void profstat ( void );
+extern void profstat_histogram ( void );
+extern void profstat_log ( void );
+extern void profstat_reset ( void );
 
 #endif /* _USR_PROFSTAT_H */
@@ -0,0 +1,15 @@
+#ifndef _USR_SAMPLEMGMT_H
+#define _USR_SAMPLEMGMT_H
+
+/** @file
+ *
+ * Sampling profiler management
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+extern void sampler_show ( void );
+extern int sampler_post ( const char *uri_string, unsigned long timeout );
+
+#endif /* _USR_SAMPLEMGMT_H */
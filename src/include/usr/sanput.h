@@ -0,0 +1,18 @@
+#ifndef _USR_SANPUT_H
+#define _USR_SANPUT_H
+
+/** @file
+ *
+ * SAN device upload
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** Compress uploaded data using gzip */
+#define SANPUT_GZIP 0x0001
+
+extern int sanput ( unsigned int drive, const char *uri_string,
+		    unsigned int flags );
+
+#endif /* _USR_SANPUT_H */
@@ -0,0 +1,15 @@
+#ifndef _USR_TRACEMGMT_H
+#define _USR_TRACEMGMT_H
+
+/** @file
+ *
+ * Boot timeline tracing
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+extern void trace_show ( void );
+extern int trace_post ( const char *uri_string, unsigned long timeout );
+
+#endif /* _USR_TRACEMGMT_H */
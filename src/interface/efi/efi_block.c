@@ -49,6 +49,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/acpi.h>
 #include <ipxe/efi/efi.h>
 #include <ipxe/efi/Protocol/BlockIo.h>
+#include <ipxe/efi/Protocol/BlockIo2.h>
 #include <ipxe/efi/Protocol/SimpleFileSystem.h>
 #include <ipxe/efi/Protocol/AcpiTable.h>
 #include <ipxe/efi/efi_driver.h>
@@ -91,6 +92,8 @@ struct efi_block_data {
 	EFI_BLOCK_IO_MEDIA media;
 	/** Block I/O protocol */
 	EFI_BLOCK_IO_PROTOCOL block_io;
+	/** Block I/O 2 protocol */
+	EFI_BLOCK_IO2_PROTOCOL block_io2;
 	/** Device path protocol */
 	EFI_DEVICE_PATH_PROTOCOL *path;
 };
@@ -224,6 +227,128 @@ efi_block_io_flush ( EFI_BLOCK_IO_PROTOCOL *block_io ) {
 	return 0;
 }
 
+/**
+ * Complete EFI block I/O 2 request
+ *
+ * @v token		Block I/O 2 token, or NULL
+ * @v rc		Completion status code
+ * @ret efirc		EFI status code
+ *
+ * Requests are always completed before returning to the caller.  A
+ * caller requesting non-blocking I/O is notified via the token's
+ * event; as required by the specification, the event is signalled
+ * only for a request that is returned as successful.
+ */
+static EFI_STATUS efi_block_io2_complete ( EFI_BLOCK_IO2_TOKEN *token,
+					   int rc ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+
+	/* Report failures directly to the caller */
+	if ( rc != 0 )
+		return EFIRC ( rc );
+
+	/* Signal completion, if applicable */
+	if ( token && token->Event ) {
+		token->TransactionStatus = 0;
+		bs->SignalEvent ( token->Event );
+	}
+
+	return 0;
+}
+
+/**
+ * Reset EFI block device (via block I/O 2 protocol)
+ *
+ * @v block_io2		Block I/O 2 protocol
+ * @v verify		Perform extended verification
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS EFIAPI
+efi_block_io2_reset ( EFI_BLOCK_IO2_PROTOCOL *block_io2, BOOLEAN verify ) {
+	struct efi_block_data *block =
+		container_of ( block_io2, struct efi_block_data, block_io2 );
+
+	return efi_block_io_reset ( &block->block_io, verify );
+}
+
+/**
+ * Read from EFI block device (via block I/O 2 protocol)
+ *
+ * @v block_io2		Block I/O 2 protocol
+ * @v media		Media identifier
+ * @v lba		Starting LBA
+ * @v token		Block I/O 2 token
+ * @v len		Size of buffer
+ * @v data		Data buffer
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS EFIAPI
+efi_block_io2_read ( EFI_BLOCK_IO2_PROTOCOL *block_io2, UINT32 media __unused,
+		     EFI_LBA lba, EFI_BLOCK_IO2_TOKEN *token, UINTN len,
+		     VOID *data ) {
+	struct efi_block_data *block =
+		container_of ( block_io2, struct efi_block_data, block_io2 );
+	struct san_device *sandev = block->sandev;
+	int rc;
+
+	DBGC2 ( sandev, "EFIBLK %#02x read%s LBA %#08llx to %p+%#08zx\n",
+		sandev->drive, ( ( token && token->Event ) ? "ex" : "" ),
+		lba, data, ( ( size_t ) len ) );
+	efi_snp_claim();
+	rc = efi_block_rw ( sandev, lba, data, len, sandev_read );
+	efi_snp_release();
+	return efi_block_io2_complete ( token, rc );
+}
+
+/**
+ * Write to EFI block device (via block I/O 2 protocol)
+ *
+ * @v block_io2		Block I/O 2 protocol
+ * @v media		Media identifier
+ * @v lba		Starting LBA
+ * @v token		Block I/O 2 token
+ * @v len		Size of buffer
+ * @v data		Data buffer
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS EFIAPI
+efi_block_io2_write ( EFI_BLOCK_IO2_PROTOCOL *block_io2, UINT32 media __unused,
+		      EFI_LBA lba, EFI_BLOCK_IO2_TOKEN *token, UINTN len,
+		      VOID *data ) {
+	struct efi_block_data *block =
+		container_of ( block_io2, struct efi_block_data, block_io2 );
+	struct san_device *sandev = block->sandev;
+	int rc;
+
+	DBGC2 ( sandev, "EFIBLK %#02x write%s LBA %#08llx from %p+%#08zx\n",
+		sandev->drive, ( ( token && token->Event ) ? "ex" : "" ),
+		lba, data, ( ( size_t ) len ) );
+	efi_snp_claim();
+	rc = efi_block_rw ( sandev, lba, data, len, sandev_write );
+	efi_snp_release();
+	return efi_block_io2_complete ( token, rc );
+}
+
+/**
+ * Flush data to EFI block device (via block I/O 2 protocol)
+ *
+ * @v block_io2		Block I/O 2 protocol
+ * @v token		Block I/O 2 token
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS EFIAPI
+efi_block_io2_flush ( EFI_BLOCK_IO2_PROTOCOL *block_io2,
+		      EFI_BLOCK_IO2_TOKEN *token ) {
+	struct efi_block_data *block =
+		container_of ( block_io2, struct efi_block_data, block_io2 );
+	struct san_device *sandev = block->sandev;
+
+	DBGC2 ( sandev, "EFIBLK %#02x flushex\n", sandev->drive );
+
+	/* Nothing to do */
+	return efi_block_io2_complete ( token, 0 );
+}
+
 /**
  * Connect all possible drivers to EFI block device
  *
@@ -311,6 +436,11 @@ static int efi_block_hook ( unsigned int drive, struct uri **uris,
 	block->block_io.ReadBlocks = efi_block_io_read;
 	block->block_io.WriteBlocks = efi_block_io_write;
 	block->block_io.FlushBlocks = efi_block_io_flush;
+	block->block_io2.Media = &block->media;
+	block->block_io2.Reset = efi_block_io2_reset;
+	block->block_io2.ReadBlocksEx = efi_block_io2_read;
+	block->block_io2.WriteBlocksEx = efi_block_io2_write;
+	block->block_io2.FlushBlocksEx = efi_block_io2_flush;
 	uri_buf = ( ( ( void * ) block ) + sizeof ( *block ) );
 	block->path = ( ( ( void * ) uri_buf ) + uri_len + 1 /* NUL */ );
 
@@ -349,6 +479,7 @@ static int efi_block_hook ( unsigned int drive, struct uri **uris,
 	if ( ( efirc = bs->InstallMultipleProtocolInterfaces (
 			&block->handle,
 			&efi_block_io_protocol_guid, &block->block_io,
+			&efi_block_io2_protocol_guid, &block->block_io2,
 			&efi_device_path_protocol_guid, block->path,
 			NULL ) ) != 0 ) {
 		rc = -EEFI ( efirc );
@@ -365,6 +496,7 @@ static int efi_block_hook ( unsigned int drive, struct uri **uris,
 	bs->UninstallMultipleProtocolInterfaces (
 			block->handle,
 			&efi_block_io_protocol_guid, &block->block_io,
+			&efi_block_io2_protocol_guid, &block->block_io2,
 			&efi_device_path_protocol_guid, block->path, NULL );
  err_install:
 	unregister_sandev ( sandev );
@@ -398,6 +530,7 @@ static void efi_block_unhook ( unsigned int drive ) {
 	bs->UninstallMultipleProtocolInterfaces (
 			block->handle,
 			&efi_block_io_protocol_guid, &block->block_io,
+			&efi_block_io2_protocol_guid, &block->block_io2,
 			&efi_device_path_protocol_guid, block->path, NULL );
 
 	/* Unregister SAN device */
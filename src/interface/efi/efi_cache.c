@@ -0,0 +1,539 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <ipxe/crc32.h>
+#include <ipxe/image.h>
+#include <ipxe/xferbuf.h>
+#include <ipxe/http.h>
+#include <ipxe/efi/efi.h>
+#include <ipxe/efi/efi_strings.h>
+#include <ipxe/efi/Protocol/SimpleFileSystem.h>
+
+/** @file
+ *
+ * EFI local disk HTTP image cache store
+ *
+ * Downloaded images are saved within a cache directory on a local
+ * EFI filesystem, so that subsequent boots may revalidate the cached
+ * copy with a conditional HTTP request rather than downloading it
+ * again.  The filesystem containing our own loaded image is used if
+ * possible; otherwise the first available filesystem is used.
+ *
+ * Each cached image is stored as a pair of files named by the CRC32
+ * of its URI: a content file and a header file containing the URI,
+ * validators, and content length.  The header file is written only
+ * after the content file is complete, and is checked against both
+ * the URI and the content file length before use.
+ */
+
+/* Disambiguate the various error causes */
+#define EIO_LENGTH __einfo_error ( EINFO_EIO_LENGTH )
+#define EINFO_EIO_LENGTH \
+	__einfo_uniqify ( EINFO_EIO, 0x01, "Cached content truncated" )
+#define EINVAL_HEADER __einfo_error ( EINFO_EINVAL_HEADER )
+#define EINFO_EINVAL_HEADER \
+	__einfo_uniqify ( EINFO_EINVAL, 0x01, "Invalid cache header" )
+#define ENOENT_URI __einfo_error ( EINFO_ENOENT_URI )
+#define EINFO_ENOENT_URI \
+	__einfo_uniqify ( EINFO_ENOENT, 0x01, "Cached URI mismatch" )
+
+/** Cache directory path components */
+static const char *efi_cache_dirs[] = { "ipxe", "cache" };
+
+/** Maximum length of a cache header file */
+#define EFI_CACHE_HEADER_MAX 4096
+
+/** Content transfer blocksize */
+#define EFI_CACHE_BLKSIZE 65536
+
+/** Cache file name suffixes */
+enum efi_cache_suffix {
+	/** Header file */
+	EFI_CACHE_HEADER = 'h',
+	/** Content file */
+	EFI_CACHE_CONTENT = 'd',
+};
+
+/**
+ * Open root directory of filesystem on device
+ *
+ * @v device		Device handle
+ * @v root		Root directory to fill in
+ * @ret rc		Return status code
+ */
+static int efi_cache_open_device ( EFI_HANDLE device,
+				   EFI_FILE_PROTOCOL **root ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+	union {
+		void *interface;
+		EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *fs;
+	} u;
+	EFI_STATUS efirc;
+	int rc;
+
+	/* Open file system protocol */
+	if ( ( efirc = bs->OpenProtocol ( device,
+					  &efi_simple_file_system_protocol_guid,
+					  &u.interface, efi_image_handle,
+					  device,
+					  EFI_OPEN_PROTOCOL_GET_PROTOCOL ))!=0){
+		rc = -EEFI ( efirc );
+		goto err_filesystem;
+	}
+
+	/* Open root directory */
+	if ( ( efirc = u.fs->OpenVolume ( u.fs, root ) ) != 0 ) {
+		rc = -EEFI ( efirc );
+		DBGC ( &efi_cache_dirs, "EFICACHE could not open volume on %s: "
+		       "%s\n", efi_handle_name ( device ), strerror ( rc ) );
+		goto err_volume;
+	}
+
+	/* Success */
+	rc = 0;
+
+ err_volume:
+	bs->CloseProtocol ( device, &efi_simple_file_system_protocol_guid,
+			    efi_image_handle, device );
+ err_filesystem:
+	return rc;
+}
+
+/**
+ * Open root directory of cache filesystem
+ *
+ * @v root		Root directory to fill in
+ * @ret rc		Return status code
+ */
+static int efi_cache_open_root ( EFI_FILE_PROTOCOL **root ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+	EFI_HANDLE *handles;
+	UINTN num_handles;
+	UINTN i;
+	EFI_STATUS efirc;
+	int rc;
+
+	/* Use our own device, if it has a filesystem */
+	if ( ( rc = efi_cache_open_device ( efi_loaded_image->DeviceHandle,
+					    root ) ) == 0 )
+		return 0;
+
+	/* Otherwise, use the first available filesystem */
+	if ( ( efirc = bs->LocateHandleBuffer ( ByProtocol,
+				&efi_simple_file_system_protocol_guid,
+				NULL, &num_handles, &handles ) ) != 0 ) {
+		rc = -EEFI ( efirc );
+		DBGC ( &efi_cache_dirs, "EFICACHE could not enumerate "
+		       "filesystems: %s\n", strerror ( rc ) );
+		return rc;
+	}
+	rc = -ENOENT;
+	for ( i = 0 ; i < num_handles ; i++ ) {
+		if ( ( rc = efi_cache_open_device ( handles[i], root ) ) == 0 )
+			break;
+	}
+	bs->FreePool ( handles );
+
+	return rc;
+}
+
+/**
+ * Open cache file
+ *
+ * @v uri		URI string
+ * @v suffix		File name suffix
+ * @v create		Create file (and directories) if missing
+ * @v file		File to fill in
+ * @ret rc		Return status code
+ */
+static int efi_cache_open ( const char *uri, enum efi_cache_suffix suffix,
+			    int create, EFI_FILE_PROTOCOL **file ) {
+	UINT64 mode = ( EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE |
+			( create ? EFI_FILE_MODE_CREATE : 0 ) );
+	EFI_FILE_PROTOCOL *dir;
+	EFI_FILE_PROTOCOL *next;
+	CHAR16 name[ 8 /* "xxxxxxxx" */ + 2 /* ".x" */ + 1 /* wNUL */ ];
+	unsigned int i;
+	EFI_STATUS efirc;
+	int rc;
+
+	/* Open root directory */
+	if ( ( rc = efi_cache_open_root ( &dir ) ) != 0 )
+		return rc;
+
+	/* Open cache directory */
+	for ( i = 0 ; i < ( sizeof ( efi_cache_dirs ) /
+			    sizeof ( efi_cache_dirs[0] ) ) ; i++ ) {
+		efi_snprintf ( name, ( sizeof ( name ) /
+				       sizeof ( name[0] ) ),
+			       "%s", efi_cache_dirs[i] );
+		efirc = dir->Open ( dir, &next, name, mode,
+				    ( create ? EFI_FILE_DIRECTORY : 0 ) );
+		dir->Close ( dir );
+		if ( efirc != 0 ) {
+			rc = -EEFI ( efirc );
+			DBGC2 ( &efi_cache_dirs, "EFICACHE could not open "
+				"directory \"%s\": %s\n",
+				efi_cache_dirs[i], strerror ( rc ) );
+			return rc;
+		}
+		dir = next;
+	}
+
+	/* Open file */
+	efi_snprintf ( name, ( sizeof ( name ) / sizeof ( name[0] ) ),
+		       "%08x.%c", crc32_le ( 0, uri, strlen ( uri ) ), suffix );
+	efirc = dir->Open ( dir, file, name, mode, 0 );
+	dir->Close ( dir );
+	if ( efirc != 0 ) {
+		rc = -EEFI ( efirc );
+		DBGC2 ( &efi_cache_dirs, "EFICACHE could not open \"%ls\" for "
+			"%s: %s\n", name, uri, strerror ( rc ) );
+		return rc;
+	}
+
+	return 0;
+}
+
+/**
+ * Read cache header
+ *
+ * @v uri		URI string
+ * @v etag		Entity tag to fill in (if not NULL)
+ * @v modified		Last modification time to fill in (if not NULL)
+ * @v len		Content length to fill in
+ * @ret rc		Return status code
+ */
+static int efi_cache_read_header ( const char *uri, char **etag,
+				   char **modified, size_t *len ) {
+	EFI_FILE_PROTOCOL *file;
+	char *fields[4];
+	char *buf;
+	char *tmp;
+	char *endp;
+	UINTN size;
+	unsigned int i;
+	EFI_STATUS efirc;
+	int rc;
+
+	/* Open header file */
+	if ( ( rc = efi_cache_open ( uri, EFI_CACHE_HEADER, 0, &file ) ) != 0 )
+		goto err_open;
+
+	/* Allocate buffer */
+	buf = malloc ( EFI_CACHE_HEADER_MAX + 1 /* NUL */ );
+	if ( ! buf ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+
+	/* Read header file */
+	size = EFI_CACHE_HEADER_MAX;
+	if ( ( efirc = file->Read ( file, &size, buf ) ) != 0 ) {
+		rc = -EEFI ( efirc );
+		DBGC ( &efi_cache_dirs, "EFICACHE could not read header for "
+		       "%s: %s\n", uri, strerror ( rc ) );
+		goto err_read;
+	}
+	buf[size] = '\0';
+
+	/* Split into lines */
+	tmp = buf;
+	for ( i = 0 ; i < ( sizeof ( fields ) / sizeof ( fields[0] ) ) ; i++ ){
+		fields[i] = tmp;
+		tmp = strchr ( tmp, '\n' );
+		if ( ! tmp ) {
+			DBGC ( &efi_cache_dirs, "EFICACHE invalid header for "
+			       "%s\n", uri );
+			rc = -EINVAL_HEADER;
+			goto err_parse;
+		}
+		*(tmp++) = '\0';
+	}
+
+	/* Check URI */
+	if ( strcmp ( fields[0], uri ) != 0 ) {
+		DBGC ( &efi_cache_dirs, "EFICACHE header for %s is for %s\n",
+		       uri, fields[0] );
+		rc = -ENOENT_URI;
+		goto err_uri;
+	}
+
+	/* Parse length */
+	*len = strtoul ( fields[3], &endp, 10 );
+	if ( *endp ) {
+		DBGC ( &efi_cache_dirs, "EFICACHE invalid length \"%s\" for "
+		       "%s\n", fields[3], uri );
+		rc = -EINVAL_HEADER;
+		goto err_len;
+	}
+
+	/* Copy validators, if applicable */
+	if ( etag && fields[1][0] && ( ! ( *etag = strdup ( fields[1] ) ) ) ) {
+		rc = -ENOMEM;
+		goto err_etag;
+	}
+	if ( modified && fields[2][0] &&
+	     ( ! ( *modified = strdup ( fields[2] ) ) ) ) {
+		rc = -ENOMEM;
+		goto err_modified;
+	}
+
+	/* Success */
+	rc = 0;
+	goto done;
+
+ err_modified:
+	if ( etag ) {
+		free ( *etag );
+		*etag = NULL;
+	}
+ err_etag:
+ done:
+ err_len:
+ err_uri:
+ err_parse:
+ err_read:
+	free ( buf );
+ err_alloc:
+	file->Close ( file );
+ err_open:
+	return rc;
+}
+
+/**
+ * Look up cached validators
+ *
+ * @v uri		URI string
+ * @v etag		Entity tag to fill in (if any)
+ * @v modified		Last modification time to fill in (if any)
+ * @ret rc		Return status code
+ */
+static int efi_cache_lookup ( const char *uri, char **etag,
+			      char **modified ) {
+	size_t len;
+
+	return efi_cache_read_header ( uri, etag, modified, &len );
+}
+
+/**
+ * Restore cached content
+ *
+ * @v uri		URI string
+ * @v xferbuf		Data transfer buffer
+ * @ret rc		Return status code
+ */
+static int efi_cache_restore ( const char *uri, struct xfer_buffer *xferbuf ) {
+	EFI_FILE_PROTOCOL *file;
+	size_t offset;
+	size_t len;
+	UINTN size;
+	void *buf;
+	EFI_STATUS efirc;
+	int rc;
+
+	/* Read header */
+	if ( ( rc = efi_cache_read_header ( uri, NULL, NULL, &len ) ) != 0 )
+		goto err_header;
+
+	/* Open content file */
+	if ( ( rc = efi_cache_open ( uri, EFI_CACHE_CONTENT, 0,
+				     &file ) ) != 0 )
+		goto err_open;
+
+	/* Allocate bounce buffer */
+	buf = malloc ( EFI_CACHE_BLKSIZE );
+	if ( ! buf ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+
+	/* Copy content to data transfer buffer */
+	for ( offset = 0 ; offset < len ; offset += size ) {
+		size = EFI_CACHE_BLKSIZE;
+		if ( ( efirc = file->Read ( file, &size, buf ) ) != 0 ) {
+			rc = -EEFI ( efirc );
+			DBGC ( &efi_cache_dirs, "EFICACHE could not read %s: "
+			       "%s\n", uri, strerror ( rc ) );
+			goto err_read;
+		}
+		if ( ( size == 0 ) || ( size > ( len - offset ) ) ) {
+			DBGC ( &efi_cache_dirs, "EFICACHE content length "
+			       "mismatch for %s\n", uri );
+			rc = -EIO_LENGTH;
+			goto err_read;
+		}
+		if ( ( rc = xferbuf_write ( xferbuf, offset, buf,
+					    size ) ) != 0 )
+			goto err_write;
+	}
+	xferbuf->pos = len;
+
+ err_write:
+ err_read:
+	free ( buf );
+ err_alloc:
+	file->Close ( file );
+ err_open:
+ err_header:
+	return rc;
+}
+
+/**
+ * Discard cached content
+ *
+ * @v uri		URI string
+ */
+static void efi_cache_discard ( const char *uri ) {
+	EFI_FILE_PROTOCOL *file;
+
+	/* Delete header file first, to invalidate content */
+	if ( efi_cache_open ( uri, EFI_CACHE_HEADER, 0, &file ) == 0 )
+		file->Delete ( file );
+	if ( efi_cache_open ( uri, EFI_CACHE_CONTENT, 0, &file ) == 0 )
+		file->Delete ( file );
+}
+
+/**
+ * Write data to cache file
+ *
+ * @v file		File
+ * @v data		Data
+ * @v len		Length of data
+ * @ret rc		Return status code
+ */
+static int efi_cache_write ( EFI_FILE_PROTOCOL *file, const void *data,
+			     size_t len ) {
+	size_t offset;
+	UINTN size;
+	EFI_STATUS efirc;
+
+	/* Write in blocks, since some filesystem drivers cannot
+	 * handle arbitrarily large writes.
+	 */
+	for ( offset = 0 ; offset < len ; offset += size ) {
+		size = ( len - offset );
+		if ( size > EFI_CACHE_BLKSIZE )
+			size = EFI_CACHE_BLKSIZE;
+		if ( ( efirc = file->Write ( file, &size,
+					     ( ( void * ) data +
+					       offset ) ) ) != 0 ) {
+			return -EEFI ( efirc );
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Save content to cache
+ *
+ * @v uri		URI string
+ * @v etag		Entity tag, or NULL
+ * @v modified		Last modification time, or NULL
+ * @v image		Downloaded image
+ * @ret rc		Return status code
+ */
+static int efi_cache_save ( const char *uri, const char *etag,
+			    const char *modified, struct image *image ) {
+	EFI_FILE_PROTOCOL *file;
+	char *header;
+	int len;
+	int rc;
+
+	/* Construct header (without allowing embedded newlines) */
+	if ( strchr ( uri, '\n' ) || ( etag && strchr ( etag, '\n' ) ) ||
+	     ( modified && strchr ( modified, '\n' ) ) ) {
+		rc = -EINVAL_HEADER;
+		goto err_newline;
+	}
+	len = asprintf ( &header, "%s\n%s\n%s\n%zd\n", uri,
+			 ( etag ? etag : "" ), ( modified ? modified : "" ),
+			 image->len );
+	if ( len < 0 ) {
+		rc = -ENOMEM;
+		goto err_header;
+	}
+	if ( len > EFI_CACHE_HEADER_MAX ) {
+		rc = -EINVAL_HEADER;
+		goto err_toolong;
+	}
+
+	/* Discard any existing content */
+	efi_cache_discard ( uri );
+
+	/* Write content file */
+	if ( ( rc = efi_cache_open ( uri, EFI_CACHE_CONTENT, 1,
+				     &file ) ) != 0 )
+		goto err_open_content;
+	if ( ( rc = efi_cache_write ( file, user_to_virt ( image->data, 0 ),
+				      image->len ) ) != 0 ) {
+		file->Delete ( file );
+		goto err_write_content;
+	}
+	file->Close ( file );
+
+	/* Write header file */
+	if ( ( rc = efi_cache_open ( uri, EFI_CACHE_HEADER, 1,
+				     &file ) ) != 0 )
+		goto err_open_header;
+	if ( ( rc = efi_cache_write ( file, header, len ) ) != 0 ) {
+		file->Delete ( file );
+		goto err_write_header;
+	}
+	file->Close ( file );
+
+	/* Success */
+	free ( header );
+	return 0;
+
+ err_write_header:
+ err_open_header:
+	efi_cache_discard ( uri );
+ err_write_content:
+ err_open_content:
+ err_toolong:
+	free ( header );
+ err_header:
+ err_newline:
+	return rc;
+}
+
+/** EFI local disk HTTP image cache store */
+struct http_cache_store efi_cache_store __http_cache_store = {
+	.name = "EFI disk",
+	.lookup = efi_cache_lookup,
+	.restore = efi_cache_restore,
+	.save = efi_cache_save,
+	.discard = efi_cache_discard,
+};
+
+/* Drag in HTTP image cache */
+REQUIRING_SYMBOL ( efi_cache_store );
+REQUIRE_OBJECT ( httpcache );
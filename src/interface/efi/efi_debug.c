@@ -91,6 +91,8 @@ static struct efi_well_known_guid efi_well_known_guids[] = {
 	  "ComponentName2" },
 	{ &efi_console_control_protocol_guid,
 	  "ConsoleControl" },
+	{ &efi_debug_support_protocol_guid,
+	  "DebugSupport" },
 	{ &efi_device_path_protocol_guid,
 	  "DevicePath" },
 	{ &efi_driver_binding_protocol_guid,
@@ -127,6 +129,8 @@ static struct efi_well_known_guid efi_well_known_guids[] = {
 	  "ManagedNetwork" },
 	{ &efi_managed_network_service_binding_protocol_guid,
 	  "ManagedNetworkSb" },
+	{ &efi_mp_services_protocol_guid,
+	  "MpServices" },
 	{ &efi_mtftp4_protocol_guid,
 	  "Mtftp4" },
 	{ &efi_mtftp4_service_binding_protocol_guid,
@@ -161,6 +165,8 @@ static struct efi_well_known_guid efi_well_known_guids[] = {
 	  "Tcp4" },
 	{ &efi_tcp4_service_binding_protocol_guid,
 	  "Tcp4Sb" },
+	{ &efi_timestamp_protocol_guid,
+	  "Timestamp" },
 	{ &efi_tree_protocol_guid,
 	  "TrEE" },
 	{ &efi_udp4_protocol_guid,
@@ -33,6 +33,19 @@ FILE_LICENCE ( GPL2_OR_LATER );
 static EFI_GUID ipxe_download_protocol_guid
 	= IPXE_DOWNLOAD_PROTOCOL_GUID;
 
+/** iPXE download protocol (version 2) GUID */
+static EFI_GUID ipxe_download_protocol_v2_guid
+	= IPXE_DOWNLOAD_PROTOCOL_V2_GUID;
+
+/** Network stack timer period (in units of 100ns) */
+#define EFI_DOWNLOAD_TIMER_PERIOD 10000
+
+/** Network stack timer event */
+static EFI_EVENT efi_download_timer;
+
+/** Number of in-progress downloads using the network stack timer */
+static unsigned int efi_download_timed;
+
 /** A single in-progress file */
 struct efi_download_file {
 	/** Data transfer interface that provides downloaded data */
@@ -49,8 +62,155 @@ struct efi_download_file {
 
 	/** Callback context */
 	void *context;
+
+	/** Caller-supplied buffer, or NULL */
+	uint8_t *buffer;
+	/** Length of caller-supplied buffer */
+	size_t len;
+	/** Minimum length of data per data callback */
+	size_t granularity;
+	/** Start of written data not yet reported via data callback */
+	size_t start;
+	/** End of written data not yet reported via data callback */
+	size_t end;
 };
 
+/**
+ * Run network stack from timer event
+ *
+ * @v event		Timer event
+ * @v context		Event context
+ */
+static EFIAPI void efi_download_tick ( EFI_EVENT event __unused,
+				       void *context __unused ) {
+
+	step();
+}
+
+/**
+ * Start running network stack from timer event
+ *
+ * @ret rc		Return status code
+ */
+static int efi_download_timer_start ( void ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+	EFI_STATUS efirc;
+	int rc;
+
+	/* Do nothing if timer is already running */
+	if ( efi_download_timed++ )
+		return 0;
+
+	/* Create timer event, if not already created */
+	if ( ( ! efi_download_timer ) &&
+	     ( ( efirc = bs->CreateEvent ( ( EVT_TIMER | EVT_NOTIFY_SIGNAL ),
+					   TPL_CALLBACK, efi_download_tick,
+					   NULL, &efi_download_timer ) ) != 0 ) ) {
+		rc = -EEFI ( efirc );
+		DBG ( "Could not create download timer: %s\n",
+		      strerror ( rc ) );
+		goto err_create;
+	}
+
+	/* Start timer */
+	if ( ( efirc = bs->SetTimer ( efi_download_timer, TimerPeriodic,
+				      EFI_DOWNLOAD_TIMER_PERIOD ) ) != 0 ) {
+		rc = -EEFI ( efirc );
+		DBG ( "Could not start download timer: %s\n",
+		      strerror ( rc ) );
+		goto err_set;
+	}
+
+	return 0;
+
+ err_set:
+ err_create:
+	efi_download_timed--;
+	return rc;
+}
+
+/**
+ * Stop running network stack from timer event
+ *
+ */
+static void efi_download_timer_stop ( void ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+
+	/* Stop timer once no downloads require it.  The event itself
+	 * is retained, since we may be running within its notification
+	 * function.
+	 */
+	if ( --efi_download_timed == 0 )
+		bs->SetTimer ( efi_download_timer, TimerCancel, 0 );
+}
+
+/**
+ * Report written data to caller-supplied buffer
+ *
+ * @v file		Data transfer file
+ * @ret rc		Return status code
+ */
+static int efi_download_report ( struct efi_download_file *file ) {
+	size_t len = ( file->end - file->start );
+	EFI_STATUS efirc;
+
+	/* Do nothing if there is no unreported data */
+	if ( ! len )
+		return 0;
+
+	/* Call out to the data handler */
+	efirc = file->data_callback ( file->context,
+				      ( file->buffer + file->start ), len,
+				      file->start );
+	file->start = file->end;
+	if ( efirc != 0 )
+		return -EEFI ( efirc );
+
+	return 0;
+}
+
+/**
+ * Write data to caller-supplied buffer
+ *
+ * @v file		Data transfer file
+ * @v data		Data
+ * @v len		Length of data
+ * @ret rc		Return status code
+ */
+static int efi_download_write ( struct efi_download_file *file,
+				const void *data, size_t len ) {
+	int rc;
+
+	/* Check that data fits within buffer */
+	if ( ( file->pos > file->len ) || ( len > ( file->len - file->pos ) ) ){
+		DBG ( "Download %p overflows %zd-byte buffer\n",
+		      file, file->len );
+		return -EOVERFLOW;
+	}
+	if ( ! len )
+		return 0;
+
+	/* Report any unreported data if this write is not contiguous */
+	if ( file->pos != file->end ) {
+		if ( ( rc = efi_download_report ( file ) ) != 0 )
+			return rc;
+		file->start = file->end = file->pos;
+	}
+
+	/* Copy data to buffer */
+	memcpy ( ( file->buffer + file->pos ), data, len );
+	file->end += len;
+
+	/* Report data once sufficient data has accumulated */
+	if ( file->granularity &&
+	     ( ( file->end - file->start ) >= file->granularity ) ) {
+		if ( ( rc = efi_download_report ( file ) ) != 0 )
+			return rc;
+	}
+
+	return 0;
+}
+
 /* xfer interface */
 
 /**
@@ -61,6 +221,13 @@ struct efi_download_file {
  */
 static void efi_download_close ( struct efi_download_file *file, int rc ) {
 
+	/* Report any remaining data written to caller-supplied buffer */
+	if ( file->buffer ) {
+		if ( rc == 0 )
+			rc = efi_download_report ( file );
+		efi_download_timer_stop();
+	}
+
 	file->finish_callback ( file->context, EFIRC ( rc ) );
 
 	intf_shutdown ( &file->xfer, rc );
@@ -88,11 +255,20 @@ static int efi_download_deliver_iob ( struct efi_download_file *file,
 		file->pos = 0;
 	file->pos += meta->offset;
 
-	/* Call out to the data handler */
-	if ( ( efirc = file->data_callback ( file->context, iobuf->data,
-					     len, file->pos ) ) != 0 ) {
-		rc = -EEFI ( efirc );
-		goto err_callback;
+	/* Write directly to caller-supplied buffer, or call out to
+	 * the data handler.
+	 */
+	if ( file->buffer ) {
+		if ( ( rc = efi_download_write ( file, iobuf->data,
+						 len ) ) != 0 )
+			goto err_callback;
+	} else {
+		if ( ( efirc = file->data_callback ( file->context,
+						     iobuf->data, len,
+						     file->pos ) ) != 0 ) {
+			rc = -EEFI ( efirc );
+			goto err_callback;
+		}
 	}
 
 	/* Update current buffer position */
@@ -155,8 +331,81 @@ efi_download_start ( IPXE_DOWNLOAD_PROTOCOL *This __unused,
 	file->data_callback = DataCallback;
 	file->finish_callback = FinishCallback;
 	file->context = Context;
+	file->buffer = NULL;
+	*File = file;
+	return EFI_SUCCESS;
+}
+
+/**
+ * Start downloading a file directly into a caller-supplied buffer
+ *
+ * @v This		iPXE Download Protocol instance
+ * @v Url		URL to download from
+ * @v Buffer		Buffer to receive data
+ * @v BufferLength	Length of buffer
+ * @v Granularity	Minimum length of data per Data callback
+ * @v DataCallback	Callback that will be invoked when data arrives
+ * @v FinishCallback	Callback that will be invoked when the download ends
+ * @v Context		Context passed to the Data and Finish callbacks
+ * @v File		Token that can be used to abort the download
+ * @ret Status		EFI status code
+ */
+static EFI_STATUS EFIAPI
+efi_download_start_buffer ( IPXE_DOWNLOAD_PROTOCOL *This __unused,
+			    CHAR8 *Url, VOID *Buffer, UINTN BufferLength,
+			    UINTN Granularity,
+			    IPXE_DOWNLOAD_DATA_CALLBACK DataCallback,
+			    IPXE_DOWNLOAD_FINISH_CALLBACK FinishCallback,
+			    VOID *Context,
+			    IPXE_DOWNLOAD_FILE *File ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+	struct efi_download_file *file;
+	EFI_TPL saved_tpl;
+	int rc;
+
+	/* Sanity check */
+	if ( ! Buffer )
+		return EFI_INVALID_PARAMETER;
+
+	/* Prevent the network stack timer from running concurrently */
+	saved_tpl = bs->RaiseTPL ( TPL_CALLBACK );
+
+	/* Allocate and initialise structure */
+	file = zalloc ( sizeof ( *file ) );
+	if ( ! file ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	intf_init ( &file->xfer, &efi_download_file_xfer_desc, NULL );
+	file->data_callback = DataCallback;
+	file->finish_callback = FinishCallback;
+	file->context = Context;
+	file->buffer = Buffer;
+	file->len = BufferLength;
+	file->granularity = Granularity;
+
+	/* Start running network stack from timer event */
+	if ( ( rc = efi_download_timer_start() ) != 0 )
+		goto err_timer;
+
+	/* Open URI */
+	if ( ( rc = xfer_open ( &file->xfer, LOCATION_URI_STRING,
+				Url ) ) != 0 ) {
+		goto err_open;
+	}
+
+	efi_snp_claim();
 	*File = file;
+	bs->RestoreTPL ( saved_tpl );
 	return EFI_SUCCESS;
+
+ err_open:
+	efi_download_timer_stop();
+ err_timer:
+	free ( file );
+ err_alloc:
+	bs->RestoreTPL ( saved_tpl );
+	return EFIRC ( rc );
 }
 
 /**
@@ -173,9 +422,13 @@ static EFI_STATUS EFIAPI
 efi_download_abort ( IPXE_DOWNLOAD_PROTOCOL *This __unused,
 		     IPXE_DOWNLOAD_FILE File,
 		     EFI_STATUS Status ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
 	struct efi_download_file *file = File;
+	EFI_TPL saved_tpl;
 
+	saved_tpl = bs->RaiseTPL ( TPL_CALLBACK );
 	efi_download_close ( file, -EEFI ( Status ) );
+	bs->RestoreTPL ( saved_tpl );
 	return EFI_SUCCESS;
 }
 
@@ -188,7 +441,12 @@ efi_download_abort ( IPXE_DOWNLOAD_PROTOCOL *This __unused,
  */
 static EFI_STATUS EFIAPI
 efi_download_poll ( IPXE_DOWNLOAD_PROTOCOL *This __unused ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+	EFI_TPL saved_tpl;
+
+	saved_tpl = bs->RaiseTPL ( TPL_CALLBACK );
 	step();
+	bs->RestoreTPL ( saved_tpl );
 	return EFI_SUCCESS;
 }
 
@@ -196,7 +454,8 @@ efi_download_poll ( IPXE_DOWNLOAD_PROTOCOL *This __unused ) {
 static IPXE_DOWNLOAD_PROTOCOL ipxe_download_protocol_interface = {
 	.Start = efi_download_start,
 	.Abort = efi_download_abort,
-	.Poll = efi_download_poll
+	.Poll = efi_download_poll,
+	.StartBuffer = efi_download_start_buffer,
 };
 
 /**
@@ -214,6 +473,8 @@ int efi_download_install ( EFI_HANDLE handle ) {
 			&handle,
 			&ipxe_download_protocol_guid,
 			&ipxe_download_protocol_interface,
+			&ipxe_download_protocol_v2_guid,
+			&ipxe_download_protocol_interface,
 			NULL );
 	if ( efirc ) {
 		rc = -EEFI ( efirc );
@@ -236,5 +497,7 @@ void efi_download_uninstall ( EFI_HANDLE handle ) {
 	bs->UninstallMultipleProtocolInterfaces (
 			handle,
 			&ipxe_download_protocol_guid,
+			&ipxe_download_protocol_interface,
+			&ipxe_download_protocol_v2_guid,
 			&ipxe_download_protocol_interface, NULL );
 }
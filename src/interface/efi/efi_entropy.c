@@ -29,6 +29,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/profile.h>
 #include <ipxe/efi/efi.h>
 #include <ipxe/efi/Protocol/Rng.h>
+#include <bits/cpu_entropy.h>
 
 /** @file
  *
@@ -215,8 +216,11 @@ static int efi_get_noise_rng ( noise_sample_t *noise ) {
 static int efi_get_noise ( noise_sample_t *noise ) {
 	int rc;
 
-	/* Try RNG first, falling back to timer ticks */
+	/* Try RNG protocol first, then the CPU random number
+	 * generator, falling back to timer ticks.
+	 */
 	if ( ( ( rc = efi_get_noise_rng ( noise ) ) != 0 ) &&
+	     ( ( rc = cpu_get_noise ( noise ) ) != 0 ) &&
 	     ( ( rc = efi_get_noise_ticks ( noise ) ) != 0 ) )
 		return rc;
 
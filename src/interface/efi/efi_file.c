@@ -38,10 +38,12 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <errno.h>
 #include <wchar.h>
 #include <ipxe/image.h>
+#include <ipxe/cpio.h>
 #include <ipxe/efi/efi.h>
 #include <ipxe/efi/Protocol/SimpleFileSystem.h>
 #include <ipxe/efi/Protocol/BlockIo.h>
 #include <ipxe/efi/Protocol/DiskIo.h>
+#include <ipxe/efi/Protocol/LoadFile2.h>
 #include <ipxe/efi/Guid/FileInfo.h>
 #include <ipxe/efi/Guid/FileSystemInfo.h>
 #include <ipxe/efi/efi_strings.h>
@@ -306,7 +308,7 @@ static EFI_STATUS EFIAPI efi_file_read ( EFI_FILE_PROTOCOL *this,
 	remaining = ( file->image->len - file->pos );
 	if ( *len > remaining )
 		*len = remaining;
-	DBGC ( file, "EFIFILE %s read [%#08zx,%#08zx)\n",
+	DBGC2 ( file, "EFIFILE %s read [%#08zx,%#08zx)\n",
 	       efi_file_name ( file ), file->pos,
 	       ( ( size_t ) ( file->pos + *len ) ) );
 	copy_from_user ( data, file->image->data, file->pos, *len );
@@ -593,6 +595,202 @@ static EFI_DISK_IO_PROTOCOL efi_disk_io_protocol = {
 	.WriteDisk = efi_disk_io_write_disk,
 };
 
+/** Linux initrd vendor media device path GUID */
+#define LINUX_INITRD_VENDOR_GUID					\
+	{ 0x5568e427, 0x68fc, 0x4f3d,					\
+	  { 0xac, 0x74, 0xca, 0x55, 0x52, 0x31, 0xcc, 0x68 } }
+
+/** Linux initrd device path */
+struct efi_file_initrd_path {
+	/** Vendor media device path */
+	VENDOR_DEVICE_PATH vendor;
+	/** End of device path */
+	EFI_DEVICE_PATH_PROTOCOL end;
+} __attribute__ (( packed ));
+
+/** Linux initrd device path
+ *
+ * The Linux EFI stub (from version 5.8 onwards) locates this device
+ * path and uses the EFI_LOAD_FILE2_PROTOCOL installed on it to obtain
+ * the initrd in a single call, rather than reading each initrd via
+ * the simple file system protocol and then copying it again into the
+ * final location.
+ */
+static struct efi_file_initrd_path efi_file_initrd_path = {
+	.vendor = {
+		.Header = {
+			.Type = MEDIA_DEVICE_PATH,
+			.SubType = MEDIA_VENDOR_DP,
+			.Length[0] = sizeof ( efi_file_initrd_path.vendor ),
+		},
+		.Guid = LINUX_INITRD_VENDOR_GUID,
+	},
+	.end = {
+		.Type = END_DEVICE_PATH_TYPE,
+		.SubType = END_ENTIRE_DEVICE_PATH_SUBTYPE,
+		.Length[0] = sizeof ( efi_file_initrd_path.end ),
+	},
+};
+
+/** Linux initrd handle */
+static EFI_HANDLE efi_file_initrd_handle;
+
+/**
+ * Construct Linux initrd
+ *
+ * @v data		Data buffer, or NULL to calculate length only
+ * @ret len		Length of initrd
+ *
+ * All images other than the currently executing image are
+ * concatenated, with a CPIO header prepended to any image that has a
+ * filename, exactly as for a bzImage kernel.  Image data is copied
+ * directly from its location in memory into the caller's buffer.
+ */
+static size_t efi_file_read_initrd ( void *data ) {
+	struct cpio_header cpio;
+	struct image *image;
+	size_t offset = 0;
+	size_t name_len;
+	size_t pad_len;
+
+	for_each_image ( image ) {
+
+		/* Do not include the executing image itself */
+		if ( image == current_image )
+			continue;
+
+		/* Pad to alignment boundary */
+		pad_len = cpio_pad_len ( offset );
+		if ( data )
+			memset ( ( data + offset ), 0, pad_len );
+		offset += pad_len;
+
+		/* Construct CPIO header, if applicable */
+		name_len = cpio_header ( image, &cpio );
+		if ( name_len ) {
+			pad_len = cpio_pad_len ( sizeof ( cpio ) + name_len );
+			if ( data ) {
+				memcpy ( ( data + offset ), &cpio,
+					 sizeof ( cpio ) );
+				memcpy ( ( data + offset + sizeof ( cpio ) ),
+					 cpio_name ( image ),
+					 ( name_len - 1 /* NUL */ ) );
+				memset ( ( data + offset + sizeof ( cpio ) +
+					   name_len - 1 /* NUL */ ), 0,
+					 ( 1 /* NUL */ + pad_len ) );
+			}
+			offset += ( sizeof ( cpio ) + name_len + pad_len );
+		}
+
+		/* Copy image data */
+		if ( data ) {
+			memcpy ( ( data + offset ),
+				 user_to_virt ( image->data, 0 ), image->len );
+		}
+		offset += image->len;
+	}
+
+	return offset;
+}
+
+/**
+ * Load Linux initrd
+ *
+ * @v this		EFI load file 2 protocol
+ * @v path		File path
+ * @v boot		Boot policy
+ * @v len		Buffer size
+ * @v data		Buffer, or NULL
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS EFIAPI
+efi_file_load_initrd ( EFI_LOAD_FILE2_PROTOCOL *this __unused,
+		       EFI_DEVICE_PATH_PROTOCOL *path __unused,
+		       BOOLEAN boot, UINTN *len, VOID *data ) {
+	size_t initrd_len;
+
+	/* Boot policy must be FALSE for EFI_LOAD_FILE2_PROTOCOL */
+	if ( boot )
+		return EFI_UNSUPPORTED;
+
+	/* Check buffer size */
+	initrd_len = efi_file_read_initrd ( NULL );
+	if ( ( ! data ) || ( *len < initrd_len ) ) {
+		*len = initrd_len;
+		return EFI_BUFFER_TOO_SMALL;
+	}
+
+	/* Construct initrd */
+	*len = efi_file_read_initrd ( data );
+	DBGC ( &efi_file_initrd_path, "EFIFILE initrd loaded to %p+%#zx\n",
+	       data, ( ( size_t ) *len ) );
+
+	return 0;
+}
+
+/** Linux initrd load file 2 protocol */
+static EFI_LOAD_FILE2_PROTOCOL efi_file_initrd_load_file2_protocol = {
+	.LoadFile = efi_file_load_initrd,
+};
+
+/**
+ * Install Linux initrd load file 2 protocol
+ *
+ * Failure is not fatal, since the loaded image may not be a Linux
+ * kernel (and may not even use the initrd).
+ */
+static void efi_file_install_initrd ( void ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+	EFI_STATUS efirc;
+	int rc;
+
+	/* Do nothing unless there is at least one candidate initrd */
+	if ( ! efi_file_read_initrd ( NULL ) )
+		return;
+
+	/* Install device path and load file 2 protocols */
+	efi_file_initrd_handle = NULL;
+	if ( ( efirc = bs->InstallMultipleProtocolInterfaces (
+			&efi_file_initrd_handle,
+			&efi_device_path_protocol_guid,
+			&efi_file_initrd_path,
+			&efi_load_file2_protocol_guid,
+			&efi_file_initrd_load_file2_protocol, NULL ) ) != 0 ) {
+		rc = -EEFI ( efirc );
+		DBGC ( &efi_file_initrd_path, "EFIFILE could not install "
+		       "initrd: %s\n", strerror ( rc ) );
+		efi_file_initrd_handle = NULL;
+	}
+}
+
+/**
+ * Uninstall Linux initrd load file 2 protocol
+ *
+ */
+static void efi_file_uninstall_initrd ( void ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+	EFI_STATUS efirc;
+	int rc;
+
+	/* Do nothing if protocols were not installed */
+	if ( ! efi_file_initrd_handle )
+		return;
+
+	/* Uninstall device path and load file 2 protocols */
+	if ( ( efirc = bs->UninstallMultipleProtocolInterfaces (
+			efi_file_initrd_handle,
+			&efi_device_path_protocol_guid,
+			&efi_file_initrd_path,
+			&efi_load_file2_protocol_guid,
+			&efi_file_initrd_load_file2_protocol, NULL ) ) != 0 ) {
+		rc = -EEFI ( efirc );
+		DBGC ( &efi_file_initrd_path, "EFIFILE could not uninstall "
+		       "initrd: %s\n", strerror ( rc ) );
+		/* Oh dear */
+	}
+	efi_file_initrd_handle = NULL;
+}
+
 /**
  * Install EFI simple file system protocol
  *
@@ -663,6 +861,9 @@ int efi_file_install ( EFI_HANDLE handle ) {
 	}
 	assert ( diskio.diskio == &efi_disk_io_protocol );
 
+	/* Install Linux initrd load file 2 protocol */
+	efi_file_install_initrd();
+
 	return 0;
 
 	bs->CloseProtocol ( handle, &efi_disk_io_protocol_guid,
@@ -690,6 +891,9 @@ void efi_file_uninstall ( EFI_HANDLE handle ) {
 	EFI_STATUS efirc;
 	int rc;
 
+	/* Uninstall Linux initrd load file 2 protocol */
+	efi_file_uninstall_initrd();
+
 	/* Close our own disk I/O protocol */
 	bs->CloseProtocol ( handle, &efi_disk_io_protocol_guid,
 			    efi_image_handle, handle );
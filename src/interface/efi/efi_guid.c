@@ -34,6 +34,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/efi/Protocol/ComponentName.h>
 #include <ipxe/efi/Protocol/ComponentName2.h>
 #include <ipxe/efi/Protocol/ConsoleControl/ConsoleControl.h>
+#include <ipxe/efi/Protocol/DebugSupport.h>
 #include <ipxe/efi/Protocol/DevicePath.h>
 #include <ipxe/efi/Protocol/DevicePathToText.h>
 #include <ipxe/efi/Protocol/Dhcp4.h>
@@ -48,6 +49,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/efi/Protocol/LoadFile2.h>
 #include <ipxe/efi/Protocol/LoadedImage.h>
 #include <ipxe/efi/Protocol/ManagedNetwork.h>
+#include <ipxe/efi/Protocol/MpService.h>
 #include <ipxe/efi/Protocol/Mtftp4.h>
 #include <ipxe/efi/Protocol/NetworkInterfaceIdentifier.h>
 #include <ipxe/efi/Protocol/PciIo.h>
@@ -62,6 +64,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/efi/Protocol/SimpleTextOut.h>
 #include <ipxe/efi/Protocol/TcgService.h>
 #include <ipxe/efi/Protocol/Tcp4.h>
+#include <ipxe/efi/Protocol/Timestamp.h>
 #include <ipxe/efi/Protocol/Udp4.h>
 #include <ipxe/efi/Protocol/UgaDraw.h>
 #include <ipxe/efi/Protocol/UnicodeCollation.h>
@@ -127,6 +130,10 @@ EFI_GUID efi_component_name2_protocol_guid
 EFI_GUID efi_console_control_protocol_guid
 	= EFI_CONSOLE_CONTROL_PROTOCOL_GUID;
 
+/** Debug support protocol GUID */
+EFI_GUID efi_debug_support_protocol_guid
+	= EFI_DEBUG_SUPPORT_PROTOCOL_GUID;
+
 /** Device path protocol GUID */
 EFI_GUID efi_device_path_protocol_guid
 	= EFI_DEVICE_PATH_PROTOCOL_GUID;
@@ -195,6 +202,10 @@ EFI_GUID efi_managed_network_protocol_guid
 EFI_GUID efi_managed_network_service_binding_protocol_guid
 	= EFI_MANAGED_NETWORK_SERVICE_BINDING_PROTOCOL_GUID;
 
+/** MP services protocol GUID */
+EFI_GUID efi_mp_services_protocol_guid
+	= EFI_MP_SERVICES_PROTOCOL_GUID;
+
 /** MTFTPv4 protocol GUID */
 EFI_GUID efi_mtftp4_protocol_guid
 	= EFI_MTFTP4_PROTOCOL_GUID;
@@ -263,6 +274,10 @@ EFI_GUID efi_tcp4_protocol_guid
 EFI_GUID efi_tcp4_service_binding_protocol_guid
 	= EFI_TCP4_SERVICE_BINDING_PROTOCOL_GUID;
 
+/** Timestamp protocol GUID */
+EFI_GUID efi_timestamp_protocol_guid
+	= EFI_TIMESTAMP_PROTOCOL_GUID;
+
 /** TrEE protocol GUID */
 EFI_GUID efi_tree_protocol_guid
 	= EFI_TREE_PROTOCOL_GUID;
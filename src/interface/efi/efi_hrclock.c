@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * EFI timestamp protocol high-resolution clock
+ *
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <ipxe/hrclock.h>
+#include <ipxe/efi/efi.h>
+#include <ipxe/efi/Protocol/Timestamp.h>
+
+/** Minimum acceptable counter rollover period (in seconds) */
+#define EFI_HRCLOCK_MIN_WRAP ( 24 * 60 * 60 )
+
+/** Timestamp protocol */
+static EFI_TIMESTAMP_PROTOCOL *efits;
+EFI_REQUEST_PROTOCOL ( EFI_TIMESTAMP_PROTOCOL, &efits );
+
+/**
+ * Read timestamp counter
+ *
+ * @ret count		Current counter value
+ */
+static uint64_t efi_hrclock_read ( void ) {
+
+	return efits->GetTimestamp();
+}
+
+/**
+ * Probe EFI timestamp protocol high-resolution clock
+ *
+ * @ret hz		Counter frequency (in Hz)
+ * @ret rc		Return status code
+ */
+static int efi_hrclock_probe ( uint64_t *hz ) {
+	EFI_TIMESTAMP_PROPERTIES props;
+	EFI_STATUS efirc;
+	int rc;
+
+	/* Check that timestamp protocol is present */
+	if ( ! efits ) {
+		DBGC ( &efits, "EFITS has no timestamp protocol\n" );
+		return -ENOTSUP;
+	}
+
+	/* Get counter properties */
+	if ( ( efirc = efits->GetProperties ( &props ) ) != 0 ) {
+		rc = -EEFI ( efirc );
+		DBGC ( &efits, "EFITS could not get properties: %s\n",
+		       strerror ( rc ) );
+		return rc;
+	}
+	DBGC ( &efits, "EFITS counter runs at %lld Hz up to %#llx\n",
+	       ( ( unsigned long long ) props.Frequency ),
+	       ( ( unsigned long long ) props.EndValue ) );
+
+	/* Reject counters that would roll over within a realistic
+	 * timescale, since we do not attempt to handle rollover.
+	 */
+	if ( ( ! props.Frequency ) ||
+	     ( ( props.EndValue / props.Frequency ) < EFI_HRCLOCK_MIN_WRAP ) ){
+		DBGC ( &efits, "EFITS counter rolls over too quickly\n" );
+		return -ERANGE;
+	}
+
+	*hz = props.Frequency;
+	return 0;
+}
+
+/** EFI timestamp protocol high-resolution clock */
+struct hrclock efi_hrclock __hrclock ( HRCLOCK_NORMAL ) = {
+	.name = "efits",
+	.probe = efi_hrclock_probe,
+	.read = efi_hrclock_read,
+};
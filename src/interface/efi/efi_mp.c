@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * EFI worker CPU cores
+ *
+ * Worker jobs are dispatched to application processors using the
+ * MP services protocol in non-blocking mode.  Completion is detected
+ * by polling the event passed to StartupThisAP().
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <ipxe/init.h>
+#include <ipxe/worker.h>
+#include <ipxe/efi/efi.h>
+#include <ipxe/efi/Protocol/MpService.h>
+
+/** MP services protocol */
+static EFI_MP_SERVICES_PROTOCOL *efimp;
+EFI_REQUEST_PROTOCOL ( EFI_MP_SERVICES_PROTOCOL, &efimp );
+
+/** An EFI worker core */
+struct efi_mp_core {
+	/** Worker core */
+	struct worker_core core;
+	/** Processor number */
+	UINTN index;
+	/** Completion event */
+	EFI_EVENT event;
+	/** Name */
+	char name[16];
+};
+
+/** EFI worker cores */
+static struct efi_mp_core *efi_mp_cores;
+
+/** Number of EFI worker cores */
+static unsigned int efi_mp_count;
+
+/**
+ * Run worker job on application processor
+ *
+ * @v arg		Worker job
+ */
+static VOID EFIAPI efi_mp_run ( VOID *arg ) {
+	struct worker_job *job = arg;
+
+	job->op->run ( job );
+}
+
+/**
+ * Start running job on EFI worker core
+ *
+ * @v core		Worker core
+ * @v job		Worker job
+ * @ret rc		Return status code
+ */
+static int efi_mp_start ( struct worker_core *core, struct worker_job *job ) {
+	struct efi_mp_core *mpcore =
+		container_of ( core, struct efi_mp_core, core );
+	EFI_STATUS efirc;
+	int rc;
+
+	if ( ( efirc = efimp->StartupThisAP ( efimp, efi_mp_run, mpcore->index,
+					      mpcore->event, 0, job,
+					      NULL ) ) != 0 ) {
+		rc = -EEFI ( efirc );
+		return rc;
+	}
+
+	return 0;
+}
+
+/**
+ * Check for job completion on EFI worker core
+ *
+ * @v core		Worker core
+ * @ret done		Job has finished running
+ */
+static int efi_mp_poll ( struct worker_core *core ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+	struct efi_mp_core *mpcore =
+		container_of ( core, struct efi_mp_core, core );
+
+	return ( bs->CheckEvent ( mpcore->event ) == 0 );
+}
+
+/** EFI worker core operations */
+static struct worker_core_operations efi_mp_operations = {
+	.start = efi_mp_start,
+	.poll = efi_mp_poll,
+};
+
+/**
+ * Register EFI worker cores
+ *
+ */
+static void efi_mp_startup ( void ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+	struct efi_mp_core *mpcore;
+	UINTN count;
+	UINTN enabled;
+	UINTN bsp;
+	UINTN i;
+	EFI_STATUS efirc;
+	int rc;
+
+	/* Do nothing unless MP services are available */
+	if ( ! efimp )
+		return;
+
+	/* Identify processors */
+	if ( ( efirc = efimp->GetNumberOfProcessors ( efimp, &count,
+						      &enabled ) ) != 0 ) {
+		rc = -EEFI ( efirc );
+		DBGC ( &efimp, "EFIMP could not count processors: %s\n",
+		       strerror ( rc ) );
+		return;
+	}
+	if ( ( efirc = efimp->WhoAmI ( efimp, &bsp ) ) != 0 ) {
+		rc = -EEFI ( efirc );
+		DBGC ( &efimp, "EFIMP could not identify BSP: %s\n",
+		       strerror ( rc ) );
+		return;
+	}
+	DBGC ( &efimp, "EFIMP found %ld processors (%ld enabled), BSP %ld\n",
+	       ( ( unsigned long ) count ), ( ( unsigned long ) enabled ),
+	       ( ( unsigned long ) bsp ) );
+	if ( count <= 1 )
+		return;
+
+	/* Allocate worker cores */
+	efi_mp_cores = zalloc ( ( count - 1 ) * sizeof ( efi_mp_cores[0] ) );
+	if ( ! efi_mp_cores )
+		return;
+
+	/* Register each application processor as a worker core.
+	 * Disabled processors will fail to start a job, and will be
+	 * dropped by the worker core infrastructure at that point.
+	 */
+	for ( i = 0 ; i < count ; i++ ) {
+		if ( i == bsp )
+			continue;
+		mpcore = &efi_mp_cores[efi_mp_count];
+		if ( ( efirc = bs->CreateEvent ( 0, TPL_CALLBACK, NULL, NULL,
+						 &mpcore->event ) ) != 0 ) {
+			rc = -EEFI ( efirc );
+			DBGC ( &efimp, "EFIMP could not create event: %s\n",
+			       strerror ( rc ) );
+			break;
+		}
+		mpcore->index = i;
+		snprintf ( mpcore->name, sizeof ( mpcore->name ), "AP%ld",
+			   ( ( unsigned long ) i ) );
+		mpcore->core.name = mpcore->name;
+		mpcore->core.op = &efi_mp_operations;
+		worker_register ( &mpcore->core );
+		efi_mp_count++;
+	}
+}
+
+/**
+ * Unregister EFI worker cores
+ *
+ * @v booting		System is shutting down for OS boot
+ */
+static void efi_mp_shutdown ( int booting __unused ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+	struct efi_mp_core *mpcore;
+	unsigned int i;
+
+	/* Unregister worker cores, waiting for any running jobs */
+	for ( i = 0 ; i < efi_mp_count ; i++ ) {
+		mpcore = &efi_mp_cores[i];
+		worker_unregister ( &mpcore->core );
+		bs->CloseEvent ( mpcore->event );
+	}
+
+	/* Free worker cores */
+	free ( efi_mp_cores );
+	efi_mp_cores = NULL;
+	efi_mp_count = 0;
+}
+
+/** EFI worker core startup function */
+struct startup_fn efi_mp_startup_fn __startup_fn ( STARTUP_NORMAL ) = {
+	.startup = efi_mp_startup,
+	.shutdown = efi_mp_shutdown,
+};
@@ -23,6 +23,8 @@
 
 FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
+#include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
 #include <errno.h>
 #include <ipxe/refcnt.h>
@@ -38,6 +40,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/open.h>
 #include <ipxe/dhcppkt.h>
 #include <ipxe/udp.h>
+#include <ipxe/settings.h>
 #include <ipxe/efi/efi.h>
 #include <ipxe/efi/efi_snp.h>
 #include <ipxe/efi/efi_pxe.h>
@@ -96,6 +99,12 @@ struct efi_pxe {
 	struct interface tftp;
 	/** Block size (for TFTP) */
 	size_t blksize;
+	/** Current file position */
+	size_t pos;
+	/** File size (as reported or as received so far) */
+	size_t filesize;
+	/** Only the file size is required */
+	int sizing;
 	/** Overall return status */
 	int rc;
 
@@ -389,8 +398,32 @@ static size_t efi_pxe_tftp_window ( struct efi_pxe *pxe ) {
 static int efi_pxe_tftp_deliver ( struct efi_pxe *pxe,
 				  struct io_buffer *iobuf,
 				  struct xfer_metadata *meta ) {
+	size_t len = iob_len ( iobuf );
+	size_t end;
 	int rc;
 
+	/* Record file size.  A zero-length delivery is a size hint
+	 * (e.g. from a TFTP "tsize" option or an HTTP Content-Length
+	 * header).
+	 */
+	if ( meta->flags & XFER_FL_ABS_OFFSET )
+		pxe->pos = 0;
+	pxe->pos += meta->offset;
+	end = ( pxe->pos + len );
+	if ( end > pxe->filesize )
+		pxe->filesize = end;
+	pxe->pos = end;
+
+	/* If only the file size is required, then stop as soon as
+	 * the size is known, and otherwise discard the data.
+	 */
+	if ( pxe->sizing ) {
+		free_iob ( iobuf );
+		if ( ( len == 0 ) && end )
+			efi_pxe_tftp_close ( pxe, 0 );
+		return 0;
+	}
+
 	/* Deliver to data transfer buffer */
 	if ( ( rc = xferbuf_deliver ( &pxe->buf, iob_disown ( iobuf ),
 				      meta ) ) != 0 )
@@ -414,6 +447,74 @@ static struct interface_operation efi_pxe_tftp_operations[] = {
 static struct interface_descriptor efi_pxe_tftp_desc =
 	INTF_DESC ( struct efi_pxe, tftp, efi_pxe_tftp_operations );
 
+/** PXE TFTP filename HTTP mapping setting */
+const struct setting pxe_http_setting __setting ( SETTING_MISC, pxe-http ) = {
+	.name = "pxe-http",
+	.description = "PXE TFTP filename HTTP base URI",
+	.type = &setting_type_string,
+};
+
+/**
+ * Construct HTTP URI for a PXE TFTP filename, if configured
+ *
+ * @v filename		Filename
+ * @ret uri		URI, or NULL if not configured
+ *
+ * If the "pxe-http" setting provides a base URI, then relative TFTP
+ * filenames are appended to the path of the base URI (with any DOS
+ * path separators converted), allowing loaders that insist on using
+ * TFTP to be served transparently via HTTP.
+ */
+static struct uri * efi_pxe_http_uri ( const char *filename ) {
+	struct uri *base;
+	struct uri *uri = NULL;
+	struct uri tmp;
+	char *base_string;
+	char *path;
+	char *sep;
+
+	/* Fetch base URI, if any */
+	if ( fetch_string_setting_copy ( NULL, &pxe_http_setting,
+					 &base_string ) < 0 )
+		goto err_fetch;
+	if ( ! base_string )
+		goto err_fetch;
+	base = parse_uri ( base_string );
+	if ( ! base )
+		goto err_parse;
+	if ( ! ( uri_is_absolute ( base ) && base->host ) )
+		goto err_absolute;
+
+	/* Construct path */
+	while ( ( *filename == '/' ) || ( *filename == '\\' ) )
+		filename++;
+	if ( asprintf ( &path, "%s%s%s", ( base->path ? base->path : "" ),
+			( ( base->path &&
+			    base->path[ strlen ( base->path ) - 1 ] == '/' ) ?
+			  "" : "/" ), filename ) < 0 )
+		goto err_path;
+	for ( sep = path ; *sep ; sep++ ) {
+		if ( *sep == '\\' )
+			*sep = '/';
+	}
+
+	/* Construct URI */
+	memcpy ( &tmp, base, sizeof ( tmp ) );
+	tmp.path = path;
+	tmp.query = NULL;
+	tmp.fragment = NULL;
+	uri = uri_dup ( &tmp );
+
+	free ( path );
+ err_path:
+ err_absolute:
+	uri_put ( base );
+ err_parse:
+	free ( base_string );
+ err_fetch:
+	return uri;
+}
+
 /**
  * Open (M)TFTP download interface
  *
@@ -425,12 +526,22 @@ static struct interface_descriptor efi_pxe_tftp_desc =
 static int efi_pxe_tftp_open ( struct efi_pxe *pxe, EFI_IP_ADDRESS *ip,
 			       const char *filename ) {
 	struct sockaddr server;
+	struct uri *http_uri;
 	struct uri *uri;
 	int rc;
 
-	/* Parse server address and filename */
+	/* Parse server address and filename, using an HTTP mapping
+	 * if configured.
+	 */
 	efi_pxe_ip_sockaddr ( pxe, ip, &server );
 	uri = pxe_uri ( &server, filename );
+	if ( uri && uri->scheme && ( strcmp ( uri->scheme, "tftp" ) == 0 ) &&
+	     ( http_uri = efi_pxe_http_uri ( filename ) ) ) {
+		uri_put ( uri );
+		uri = http_uri;
+		DBGC ( pxe, "PXE %s mapped %s to %s://%s%s\n", pxe->name,
+		       filename, uri->scheme, uri->host, uri->path );
+	}
 	if ( ! uri ) {
 		DBGC ( pxe, "PXE %s could not parse %s:%s\n", pxe->name,
 		       efi_pxe_ip_ntoa ( pxe, ip ), filename );
@@ -946,8 +1057,11 @@ efi_pxe_mtftp ( EFI_PXE_BASE_CODE_PROTOCOL *base,
 	DBGC ( pxe, "%s\n", ( callback ? " callback" : "" ) );
 
 	/* Fail unless operation is supported */
+	pxe->sizing = ( ( opcode == EFI_PXE_BASE_CODE_TFTP_GET_FILE_SIZE ) ||
+			( opcode == EFI_PXE_BASE_CODE_MTFTP_GET_FILE_SIZE ) );
 	if ( ! ( ( opcode == EFI_PXE_BASE_CODE_TFTP_READ_FILE ) ||
-		 ( opcode == EFI_PXE_BASE_CODE_MTFTP_READ_FILE ) ) ) {
+		 ( opcode == EFI_PXE_BASE_CODE_MTFTP_READ_FILE ) ||
+		 pxe->sizing ) ) {
 		DBGC ( pxe, "PXE %s unsupported MTFTP opcode %d\n",
 		       pxe->name, opcode );
 		rc = -ENOTSUP;
@@ -965,7 +1079,9 @@ efi_pxe_mtftp ( EFI_PXE_BASE_CODE_PROTOCOL *base,
 
 	/* Initialise data transfer buffer */
 	pxe->buf.data = data;
-	pxe->buf.len = *len;
+	pxe->buf.len = ( pxe->sizing ? 0 : *len );
+	pxe->pos = 0;
+	pxe->filesize = 0;
 
 	/* Open download */
 	if ( ( rc = efi_pxe_tftp_open ( pxe, ip,
@@ -976,7 +1092,15 @@ efi_pxe_mtftp ( EFI_PXE_BASE_CODE_PROTOCOL *base,
 	pxe->rc = -EINPROGRESS;
 	while ( pxe->rc == -EINPROGRESS )
 		step();
-	if ( ( rc = pxe->rc ) != 0 ) {
+
+	/* Report file size.  This is also required if the buffer was
+	 * too small, so that the caller can retry with a larger
+	 * buffer.
+	 */
+	rc = pxe->rc;
+	if ( ( rc == 0 ) || ( rc == -ERANGE ) )
+		*len = pxe->filesize;
+	if ( rc != 0 ) {
 		DBGC ( pxe, "PXE %s download failed: %s\n",
 		       pxe->name, strerror ( rc ) );
 		goto err_download;
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * EFI sampling profiler timer source
+ *
+ * Samples are taken using a periodic callback registered via the
+ * debug support protocol, which the firmware invokes from its timer
+ * interrupt handler with the interrupted processor context.  The
+ * sampling rate is therefore the firmware's timer tick rate
+ * (typically 100Hz).
+ *
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <ipxe/init.h>
+#include <ipxe/sampler.h>
+#include <ipxe/efi/efi.h>
+#include <ipxe/efi/Protocol/DebugSupport.h>
+
+/** Start of text section */
+extern char _text[];
+
+/** End of text section */
+extern char _etext[];
+
+/** Debug support protocol */
+static EFI_DEBUG_SUPPORT_PROTOCOL *efidebug;
+EFI_REQUEST_PROTOCOL ( EFI_DEBUG_SUPPORT_PROTOCOL, &efidebug );
+
+#if defined ( __x86_64__ )
+#define EFI_SAMPLER_ISA IsaX64
+#define EFI_SAMPLER_IP( context ) ( (context).SystemContextX64->Rip )
+#elif defined ( __i386__ )
+#define EFI_SAMPLER_ISA IsaIa32
+#define EFI_SAMPLER_IP( context ) ( (context).SystemContextIa32->Eip )
+#elif defined ( __aarch64__ )
+#define EFI_SAMPLER_ISA IsaAArch64
+#define EFI_SAMPLER_IP( context ) ( (context).SystemContextAArch64->ELR )
+#endif
+
+/** Sampling is in progress */
+static int efi_sampler_running;
+
+#ifdef EFI_SAMPLER_ISA
+
+/**
+ * Record sample from periodic callback
+ *
+ * @v context		Interrupted processor context
+ */
+static VOID EFIAPI efi_sampler_callback ( EFI_SYSTEM_CONTEXT context ) {
+	unsigned long offset;
+
+	offset = ( EFI_SAMPLER_IP ( context ) - ( ( intptr_t ) _text ) );
+	if ( offset >= ( ( size_t ) ( _etext - _text ) ) )
+		offset = SAMPLER_EXTERNAL;
+	sampler_record ( offset );
+}
+
+/**
+ * Start sampling
+ *
+ * @ret rc		Return status code
+ */
+static int efi_sampler_start ( void ) {
+	EFI_STATUS efirc;
+	int rc;
+
+	/* Check for a usable debug support protocol */
+	if ( ! efidebug )
+		return -ENOTSUP;
+	if ( efidebug->Isa != EFI_SAMPLER_ISA ) {
+		DBGC ( &efidebug, "EFISAMPLE unsupported ISA %#x\n",
+		       efidebug->Isa );
+		return -ENOTSUP;
+	}
+
+	/* Register periodic callback */
+	if ( ( efirc = efidebug->RegisterPeriodicCallback ( efidebug, 0,
+						efi_sampler_callback ) ) != 0 ) {
+		rc = -EEFI ( efirc );
+		DBGC ( &efidebug, "EFISAMPLE could not register callback: "
+		       "%s\n", strerror ( rc ) );
+		return rc;
+	}
+	efi_sampler_running = 1;
+
+	return 0;
+}
+
+#else /* EFI_SAMPLER_ISA */
+
+static int efi_sampler_start ( void ) {
+	return -ENOTSUP;
+}
+
+#endif /* EFI_SAMPLER_ISA */
+
+/**
+ * Stop sampling
+ *
+ */
+static void efi_sampler_stop ( void ) {
+
+	/* Unregister periodic callback */
+	if ( efi_sampler_running ) {
+		efidebug->RegisterPeriodicCallback ( efidebug, 0, NULL );
+		efi_sampler_running = 0;
+	}
+}
+
+/** EFI sampling profiler timer source */
+struct sampler_source efi_sampler __sampler_source = {
+	.name = "EFI",
+	.section = ".text",
+	.start = efi_sampler_start,
+	.stop = efi_sampler_stop,
+};
+
+/**
+ * Shut down sampling profiler
+ *
+ * @v booting		System is shutting down for OS boot
+ */
+static void efi_sampler_shutdown ( int booting __unused ) {
+
+	/* Ensure callback is unregistered before we are unloaded */
+	sampler_stop();
+}
+
+/** EFI sampling profiler startup function */
+struct startup_fn efi_sampler_startup_fn __startup_fn ( STARTUP_NORMAL ) = {
+	.shutdown = efi_sampler_shutdown,
+};
@@ -28,6 +28,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/vlan.h>
 #include <ipxe/iobuf.h>
 #include <ipxe/in.h>
+#include <ipxe/profile.h>
 #include <ipxe/version.h>
 #include <ipxe/console.h>
 #include <ipxe/efi/efi.h>
@@ -48,6 +49,18 @@ static int efi_snp_claimed;
 /** TPL prior to network devices being claimed */
 static EFI_TPL efi_snp_old_tpl;
 
+/** Packets retrieved per poll profiler */
+static struct profiler efi_snp_poll_profiler __profiler =
+	{ .name = "efisnp.poll" };
+
+/** Receive profiler */
+static struct profiler efi_snp_rx_profiler __profiler =
+	{ .name = "efisnp.rx" };
+
+/** Transmit profiler */
+static struct profiler efi_snp_tx_profiler __profiler =
+	{ .name = "efisnp.tx" };
+
 /* Downgrade user experience if configured to do so
  *
  * The default UEFI user experience for network boot is somewhat
@@ -155,6 +168,7 @@ static void efi_snp_flush ( struct efi_snp_device *snpdev ) {
 		list_del ( &iobuf->list );
 		free_iob ( iobuf );
 	}
+	snpdev->rx_count = 0;
 }
 
 /**
@@ -164,14 +178,31 @@ static void efi_snp_flush ( struct efi_snp_device *snpdev ) {
  */
 static void efi_snp_poll ( struct efi_snp_device *snpdev ) {
 	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+	struct net_device *netdev = snpdev->netdev;
 	struct io_buffer *iobuf;
+	unsigned int count = 0;
 
 	/* Poll network device */
-	netdev_poll ( snpdev->netdev );
+	netdev_poll ( netdev );
 
 	/* Retrieve any received packets */
-	while ( ( iobuf = netdev_rx_dequeue ( snpdev->netdev ) ) ) {
+	while ( ( iobuf = netdev_rx_dequeue ( netdev ) ) ) {
+
+		/* Discard packet if receive queue is full */
+		if ( snpdev->rx_count >= EFI_SNP_MAX_RX ) {
+			netdev_rx_err ( netdev, iobuf, -ENOBUFS );
+			continue;
+		}
+
+		/* Add to receive queue */
 		list_add_tail ( &iobuf->list, &snpdev->rx );
+		snpdev->rx_count++;
+		count++;
+	}
+
+	/* Signal any received packets */
+	if ( count ) {
+		profile_custom ( &efi_snp_poll_profiler, count );
 		snpdev->interrupts |= EFI_SIMPLE_NETWORK_RECEIVE_INTERRUPT;
 		bs->SignalEvent ( &snpdev->snp.WaitForPacket );
 	}
@@ -639,6 +670,9 @@ efi_snp_transmit ( EFI_SIMPLE_NETWORK_PROTOCOL *snp,
 		goto err_claimed;
 	}
 
+	/* Profile transmissions */
+	profile_start ( &efi_snp_tx_profiler );
+
 	/* Raise TPL */
 	saved_tpl = bs->RaiseTPL ( TPL_CALLBACK );
 
@@ -727,6 +761,7 @@ efi_snp_transmit ( EFI_SIMPLE_NETWORK_PROTOCOL *snp,
 	/* Restore TPL */
 	bs->RestoreTPL ( saved_tpl );
 
+	profile_stop ( &efi_snp_tx_profiler );
 	return 0;
 
  err_ring_full:
@@ -782,8 +817,14 @@ efi_snp_receive ( EFI_SIMPLE_NETWORK_PROTOCOL *snp,
 	/* Raise TPL */
 	saved_tpl = bs->RaiseTPL ( TPL_CALLBACK );
 
-	/* Poll the network device */
-	efi_snp_poll ( snpdev );
+	/* Poll the network device only if no packets are already
+	 * queued.  Consumers typically call Receive() repeatedly
+	 * until no packet is returned, and there is no need to incur
+	 * the cost of polling the hardware until the queue has been
+	 * drained.
+	 */
+	if ( list_empty ( &snpdev->rx ) )
+		efi_snp_poll ( snpdev );
 
 	/* Check for an available packet */
 	iobuf = list_first_entry ( &snpdev->rx, struct io_buffer, list );
@@ -795,7 +836,9 @@ efi_snp_receive ( EFI_SIMPLE_NETWORK_PROTOCOL *snp,
 	DBGC2 ( snpdev, "+%zx\n", iob_len ( iobuf ) );
 
 	/* Dequeue packet */
+	profile_start ( &efi_snp_rx_profiler );
 	list_del ( &iobuf->list );
+	snpdev->rx_count--;
 
 	/* Return packet to caller, truncating to buffer length */
 	copy_len = iob_len ( iobuf );
@@ -825,6 +868,7 @@ efi_snp_receive ( EFI_SIMPLE_NETWORK_PROTOCOL *snp,
 
 	/* Check buffer length */
 	rc = ( ( copy_len == *len ) ? 0 : -ERANGE );
+	profile_stop ( &efi_snp_rx_profiler );
 
  out_bad_ll_header:
 	free_iob ( iobuf );
@@ -862,6 +906,10 @@ static VOID EFIAPI efi_snp_wait_for_packet ( EFI_EVENT event __unused,
 	/* Poll the network device */
 	efi_snp_poll ( snpdev );
 
+	/* Signal any packets still queued from a previous poll */
+	if ( ! list_empty ( &snpdev->rx ) )
+		bs->SignalEvent ( &snpdev->snp.WaitForPacket );
+
 	/* Restore TPL */
 	bs->RestoreTPL ( saved_tpl );
 }
@@ -38,6 +38,59 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 /** Equivalent of NOWHERE for user pointers */
 #define UNOWHERE ( ~UNULL )
 
+/**
+ * Resize external memory in place
+ *
+ * @v ptr		Memory previously allocated by umalloc()
+ * @v new_size		Requested size
+ * @ret rc		Return status code
+ *
+ * Shrinking a block frees its trailing pages.  Growing a block
+ * attempts to claim the pages immediately following it, which allows
+ * buffers of unknown final length to grow without repeatedly copying
+ * their contents whenever the adjacent memory is free.
+ */
+static int efi_uresize ( userptr_t ptr, size_t new_size ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+	EFI_PHYSICAL_ADDRESS phys_addr;
+	unsigned int new_pages, old_pages;
+	size_t old_size;
+	EFI_STATUS efirc;
+	int rc;
+
+	/* Calculate old and new page counts */
+	copy_from_user ( &old_size, ptr, -EFI_PAGE_SIZE, sizeof ( old_size ) );
+	old_pages = ( EFI_SIZE_TO_PAGES ( old_size ) + 1 );
+	new_pages = ( EFI_SIZE_TO_PAGES ( new_size ) + 1 );
+	phys_addr = ( user_to_phys ( ptr, -EFI_PAGE_SIZE ) +
+		      EFI_PAGES_TO_SIZE ( ( new_pages < old_pages ) ?
+					  new_pages : old_pages ) );
+
+	/* Free or claim trailing pages as applicable */
+	if ( new_pages < old_pages ) {
+		if ( ( efirc = bs->FreePages ( phys_addr,
+					       ( old_pages - new_pages ) ) ) != 0 ) {
+			rc = -EEFI ( efirc );
+			return rc;
+		}
+	} else if ( new_pages > old_pages ) {
+		if ( ( efirc = bs->AllocatePages ( AllocateAddress,
+						   EfiBootServicesData,
+						   ( new_pages - old_pages ),
+						   &phys_addr ) ) != 0 ) {
+			rc = -EEFI ( efirc );
+			return rc;
+		}
+	}
+
+	/* Record new size */
+	copy_to_user ( ptr, -EFI_PAGE_SIZE, &new_size, sizeof ( new_size ) );
+	DBG ( "EFI resized %d pages at %lx to %d pages\n", old_pages,
+	      user_to_phys ( ptr, -EFI_PAGE_SIZE ), new_pages );
+
+	return 0;
+}
+
 /**
  * Reallocate external memory
  *
@@ -57,6 +110,12 @@ static userptr_t efi_urealloc ( userptr_t old_ptr, size_t new_size ) {
 	EFI_STATUS efirc;
 	int rc;
 
+	/* Resize existing block in place, if possible */
+	if ( new_size && old_ptr && ( old_ptr != UNOWHERE ) &&
+	     ( efi_uresize ( old_ptr, new_size ) == 0 ) ) {
+		return old_ptr;
+	}
+
 	/* Allocate new memory if necessary.  If allocation fails,
 	 * return without touching the old block.
 	 */
@@ -26,6 +26,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/efi/efi_driver.h>
 #include <ipxe/efi/efi_snp.h>
 #include <ipxe/efi/efi_autoboot.h>
+#include <ipxe/efi/efi_cachedhcp.h>
 #include <ipxe/efi/efi_watchdog.h>
 
 /**
@@ -47,6 +48,9 @@ EFI_STATUS EFIAPI _efi_start ( EFI_HANDLE image_handle,
 	/* Record autoboot device (if any) */
 	efi_set_autoboot();
 
+	/* Record cached DHCP packets (if any) */
+	efi_cachedhcp_record ( efi_loaded_image->DeviceHandle );
+
 	/* Claim SNP devices for use by iPXE */
 	efi_snp_claim();
 
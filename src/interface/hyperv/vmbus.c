@@ -498,6 +498,11 @@ int vmbus_open ( struct vmbus_device *vmdev,
 	vmdev->mtu = mtu;
 	vmdev->packet = packet;
 
+	/* We always poll the inbound ring buffer, so ask the host not
+	 * to interrupt us each time it adds a packet.
+	 */
+	vmdev->in->intr_mask = cpu_to_le32 ( 1 );
+
 	DBGC ( vmdev, "VMBUS %s channel GPADL %#08x ring "
 		"[%#08lx,%#08lx,%#08lx)\n", vmdev->dev.name, vmdev->gpadl,
 		virt_to_phys ( vmdev->out ), virt_to_phys ( vmdev->in ),
@@ -602,6 +607,22 @@ static void vmbus_signal_event ( struct vmbus_device *vmdev ) {
 	}
 }
 
+/**
+ * Signal host that outbound ring buffer contains data
+ *
+ * @v vmdev		VMBus device
+ */
+static void vmbus_signal_host ( struct vmbus_device *vmdev ) {
+	struct hv_hypervisor *hv = vmdev->hv;
+	struct vmbus *vmbus = hv->vmbus;
+
+	/* Set channel bit in interrupt page */
+	set_bit ( vmdev->channel, vmbus->intr->out );
+
+	/* Signal the host */
+	vmdev->signal ( vmdev );
+}
+
 /**
  * Fill outbound ring buffer
  *
@@ -677,8 +698,6 @@ static size_t vmbus_consume ( struct vmbus_device *vmdev, size_t cons,
 static int vmbus_send ( struct vmbus_device *vmdev,
 			struct vmbus_packet_header *header,
 			const void *data, size_t len ) {
-	struct hv_hypervisor *hv = vmdev->hv;
-	struct vmbus *vmbus = hv->vmbus;
 	static uint8_t padding[ 8 - 1 ];
 	struct vmbus_packet_footer footer;
 	size_t header_len;
@@ -742,11 +761,14 @@ static int vmbus_send ( struct vmbus_device *vmdev,
 	if ( cons != old_prod )
 		return 0;
 
-	/* Set channel bit in interrupt page */
-	set_bit ( vmdev->channel, vmbus->intr->out );
+	/* Defer signal if we are draining the inbound ring buffer */
+	if ( vmdev->draining ) {
+		vmdev->signal_pending = 1;
+		return 0;
+	}
 
 	/* Signal the host */
-	vmdev->signal ( vmdev );
+	vmbus_signal_host ( vmdev );
 
 	return 0;
 }
@@ -1081,6 +1103,31 @@ int vmbus_poll ( struct vmbus_device *vmdev ) {
 	return 0;
 }
 
+/**
+ * Poll ring buffer until empty
+ *
+ * @v vmdev		VMBus device
+ *
+ * Any host signal required by packets sent while handling received
+ * packets (such as completions) is deferred until the inbound ring
+ * buffer has been drained, so that at most one signal is sent per
+ * call.
+ */
+void vmbus_drain ( struct vmbus_device *vmdev ) {
+
+	/* Handle all received packets */
+	vmdev->draining = 1;
+	while ( vmbus_has_data ( vmdev ) )
+		vmbus_poll ( vmdev );
+	vmdev->draining = 0;
+
+	/* Send any deferred signal */
+	if ( vmdev->signal_pending ) {
+		vmdev->signal_pending = 0;
+		vmbus_signal_host ( vmdev );
+	}
+}
+
 /**
  * Dump channel status (for debugging)
  *
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * Linux high-resolution clock
+ *
+ */
+
+#include <stddef.h>
+#include <ipxe/hrclock.h>
+#include <linux_api.h>
+
+/**
+ * Read time of day
+ *
+ * @ret count		Current counter value
+ */
+static uint64_t linux_hrclock_read ( void ) {
+	struct timeval now;
+
+	linux_gettimeofday ( &now, NULL );
+	return ( ( ( ( uint64_t ) now.tv_sec ) * 1000000ULL ) + now.tv_usec );
+}
+
+/**
+ * Probe Linux high-resolution clock
+ *
+ * @ret hz		Counter frequency (in Hz)
+ * @ret rc		Return status code
+ */
+static int linux_hrclock_probe ( uint64_t *hz ) {
+
+	*hz = 1000000;
+	return 0;
+}
+
+/** Linux high-resolution clock */
+struct hrclock linux_hrclock __hrclock ( HRCLOCK_NORMAL ) = {
+	.name = "linux",
+	.probe = linux_hrclock_probe,
+	.read = linux_hrclock_read,
+};
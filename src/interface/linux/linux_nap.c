@@ -19,6 +19,10 @@
 
 FILE_LICENCE(GPL2_OR_LATER);
 
+#include <ipxe/list.h>
+#include <ipxe/timer.h>
+#include <ipxe/retry.h>
+#include <ipxe/linux.h>
 #include <ipxe/nap.h>
 
 #include <linux_api.h>
@@ -27,7 +31,48 @@ FILE_LICENCE(GPL2_OR_LATER);
  *
  * iPXE CPU sleeping API for linux
  *
+ * There are no interrupts to wake us up, so we instead wait for
+ * activity on any watched file descriptor (including standard
+ * input), or until the next retry timer is due to expire.
+ *
+ */
+
+/** Maximum time to sleep (in ticks)
+ *
+ * Not everything is driven by retry timers (e.g. sleep() polls
+ * currticks() directly), so limit the sleep duration.
+ */
+#define LINUX_NAP_MAX_TICKS ( TICKS_PER_SEC / 10 )
+
+/** Watched file descriptors */
+static LIST_HEAD ( linux_nap_watches );
+
+/** Number of watched file descriptors */
+static unsigned int linux_nap_count;
+
+/**
+ * Watch file descriptor for activity while sleeping
+ *
+ * @v watch		File descriptor watch
+ * @v fd		File descriptor
  */
+void linux_nap_watch ( struct linux_nap_watch *watch, int fd ) {
+
+	watch->fd = fd;
+	list_add_tail ( &watch->list, &linux_nap_watches );
+	linux_nap_count++;
+}
+
+/**
+ * Stop watching file descriptor
+ *
+ * @v watch		File descriptor watch
+ */
+void linux_nap_unwatch ( struct linux_nap_watch *watch ) {
+
+	list_del ( &watch->list );
+	linux_nap_count--;
+}
 
 /**
  * Sleep until next CPU interrupt
@@ -35,7 +80,24 @@ FILE_LICENCE(GPL2_OR_LATER);
  */
 static void linux_cpu_nap(void)
 {
-	linux_usleep(0);
+	struct pollfd pfds[ 1 /* stdin */ + linux_nap_count ];
+	struct linux_nap_watch *watch;
+	unsigned long ticks;
+	unsigned int count = 0;
+	int timeout;
+
+	/* Watch standard input and all registered file descriptors */
+	pfds[count].fd = 0;
+	pfds[count++].events = POLLIN;
+	list_for_each_entry ( watch, &linux_nap_watches, list ) {
+		pfds[count].fd = watch->fd;
+		pfds[count++].events = POLLIN;
+	}
+
+	/* Sleep until activity or the next timer expiry */
+	ticks = retry_remaining ( LINUX_NAP_MAX_TICKS );
+	timeout = ( ( ticks * 1000 ) / TICKS_PER_SEC );
+	linux_poll ( pfds, count, timeout );
 }
 
 PROVIDE_NAP(linux, cpu_nap, linux_cpu_nap);
@@ -90,8 +90,31 @@ struct net80211_probe_ctx {
 
 	/** List of best beacons for each network found so far */
 	struct list_head *beacons;
+
+	/** Channel on which the network was last found, or 0 if unknown */
+	int hint_channel;
+
+	/** Network has been found on its hinted channel */
+	int hint_found;
+};
+
+/** Number of networks for which to remember the channel */
+#define NET80211_PROBE_HINTS	4
+
+/** A record of the channel on which a network was last found */
+struct net80211_probe_hint {
+	/** ESSID of network */
+	char essid[IEEE80211_MAX_SSID_LEN + 1];
+	/** Channel number */
+	int channel;
 };
 
+/** Channels on which networks were last found */
+static struct net80211_probe_hint net80211_probe_hints[NET80211_PROBE_HINTS];
+
+/** Next channel hint slot to be overwritten */
+static unsigned int net80211_probe_hint_next;
+
 /** Context for the association task */
 struct net80211_assoc_ctx {
 	/** Next authentication method to try using */
@@ -1268,6 +1291,74 @@ net80211_marshal_request_info ( struct net80211_device *dev,
 /** Seconds to allow a probe to take if no network has been found */
 #define NET80211_PROBE_TIMEOUT   6
 
+/**
+ * Find channel on which a network was last found
+ *
+ * @v essid	ESSID of network
+ * @ret hint	Channel hint, or NULL if none
+ */
+static struct net80211_probe_hint * net80211_probe_hint ( const char *essid )
+{
+	struct net80211_probe_hint *hint;
+	unsigned int i;
+
+	for ( i = 0 ; i < NET80211_PROBE_HINTS ; i++ ) {
+		hint = &net80211_probe_hints[i];
+		if ( hint->channel && ( strcmp ( hint->essid, essid ) == 0 ) )
+			return hint;
+	}
+	return NULL;
+}
+
+/**
+ * Remember channel on which a network was found
+ *
+ * @v wlan	Network found by probe
+ */
+static void net80211_probe_hint_record ( struct net80211_wlan *wlan )
+{
+	struct net80211_probe_hint *hint;
+
+	hint = net80211_probe_hint ( wlan->essid );
+	if ( ! hint ) {
+		hint = &net80211_probe_hints[net80211_probe_hint_next++ %
+					     NET80211_PROBE_HINTS];
+		strcpy ( hint->essid, wlan->essid );
+	}
+	hint->channel = wlan->channel;
+}
+
+/**
+ * Send active probe request on current channel
+ *
+ * @v ctx	Probe context
+ * @ret rc	Return status code
+ */
+static int net80211_probe_send ( struct net80211_probe_ctx *ctx )
+{
+	struct net80211_device *dev = ctx->dev;
+	struct io_buffer *siob = ctx->probe; /* to send */
+	struct io_buffer *iob;
+	int rc;
+
+	/* make a copy for future use */
+	iob = alloc_iob ( siob->tail - siob->head );
+	iob_reserve ( iob, iob_headroom ( siob ) );
+	memcpy ( iob_put ( iob, iob_len ( siob ) ),
+		 siob->data, iob_len ( siob ) );
+
+	ctx->probe = iob;
+	rc = net80211_tx_mgmt ( dev, IEEE80211_STYPE_PROBE_REQ,
+				eth_broadcast, iob_disown ( siob ) );
+	if ( rc ) {
+		DBGC ( dev, "802.11 %p send probe failed: %s\n",
+		       dev, strerror ( rc ) );
+		return rc;
+	}
+
+	return 0;
+}
+
 /**
  * Begin probe of 802.11 networks
  *
@@ -1282,6 +1373,10 @@ net80211_marshal_request_info ( struct net80211_device *dev,
  * channel; this can allow association with hidden-SSID networks if
  * the SSID is properly specified.
  *
+ * If a specific SSID is given and that network has been found
+ * before, the probe starts on the channel where it was last seen,
+ * and completes as soon as the network is found there again.
+ *
  * A @c NULL return indicates an out-of-memory condition.
  *
  * The returned context must be periodically passed to
@@ -1292,6 +1387,8 @@ struct net80211_probe_ctx * net80211_probe_start ( struct net80211_device *dev,
 						   int active )
 {
 	struct net80211_probe_ctx *ctx = zalloc ( sizeof ( *ctx ) );
+	struct net80211_probe_hint *hint;
+	int i;
 
 	if ( ! ctx )
 		return NULL;
@@ -1337,9 +1434,29 @@ struct net80211_probe_ctx * net80211_probe_start ( struct net80211_device *dev,
 	ctx->beacons = malloc ( sizeof ( *ctx->beacons ) );
 	INIT_LIST_HEAD ( ctx->beacons );
 
+	/* Start on the channel where this network was last seen, if
+	 * known and if that channel is being probed.
+	 */
 	dev->channel = 0;
+	if ( essid[0] && ( hint = net80211_probe_hint ( essid ) ) ) {
+		for ( i = 0 ; i < dev->nr_channels ; i++ ) {
+			if ( dev->channels[i].channel_nr != hint->channel )
+				continue;
+			DBGC ( dev, "802.11 %p probe: trying %s on channel "
+			       "%d first\n", dev, essid, hint->channel );
+			ctx->hint_channel = hint->channel;
+			dev->channel = i;
+			break;
+		}
+	}
 	dev->op->config ( dev, NET80211_CFG_CHANNEL );
 
+	/* Probe immediately on a hinted channel */
+	if ( ctx->hint_channel && ctx->probe ) {
+		udelay ( dev->hw->channel_change_time );
+		net80211_probe_send ( ctx );
+	}
+
 	return ctx;
 }
 
@@ -1381,6 +1498,9 @@ int net80211_probe_step ( struct net80211_probe_ctx *ctx )
 	if ( ctx->ticks_beacon > 0 && now >= ctx->ticks_start + gather_timeout )
 		return +1;
 
+	if ( ctx->hint_found )
+		return +1;
+
 	/* Change channels if necessary */
 	if ( now >= ctx->ticks_channel + ctx->hop_time ) {
 		dev->channel = ( dev->channel + ctx->hop_step )
@@ -1390,25 +1510,9 @@ int net80211_probe_step ( struct net80211_probe_ctx *ctx )
 
 		ctx->ticks_channel = now;
 
-		if ( ctx->probe ) {
-			struct io_buffer *siob = ctx->probe; /* to send */
-
-			/* make a copy for future use */
-			iob = alloc_iob ( siob->tail - siob->head );
-			iob_reserve ( iob, iob_headroom ( siob ) );
-			memcpy ( iob_put ( iob, iob_len ( siob ) ),
-				 siob->data, iob_len ( siob ) );
-
-			ctx->probe = iob;
-			rc = net80211_tx_mgmt ( dev, IEEE80211_STYPE_PROBE_REQ,
-						eth_broadcast,
-						iob_disown ( siob ) );
-			if ( rc ) {
-				DBGC ( dev, "802.11 %p send probe failed: "
-				       "%s\n", dev, strerror ( rc ) );
-				return rc;
-			}
-		}
+		if ( ctx->probe &&
+		     ( ( rc = net80211_probe_send ( ctx ) ) != 0 ) )
+			return rc;
 	}
 
 	/* Check for new management packets */
@@ -1518,6 +1622,8 @@ int net80211_probe_step ( struct net80211_probe_ctx *ctx )
 		}
 
 		ctx->ticks_beacon = now;
+		if ( ctx->essid[0] && ( wlan->channel == ctx->hint_channel ) )
+			ctx->hint_found = 1;
 
 		DBGC2 ( dev, "802.11 %p probe: good beacon for %s (%s)\n",
 			dev, wlan->essid, eth_ntoa ( wlan->bssid ) );
@@ -1553,11 +1659,13 @@ net80211_probe_finish_best ( struct net80211_probe_ctx *ctx )
 			best = wlan;
 	}
 
-	if ( best )
+	if ( best ) {
 		list_del ( &best->list );
-	else
+		net80211_probe_hint_record ( best );
+	} else {
 		DBGC ( ctx->dev, "802.11 %p probe: found nothing for '%s'\n",
 		       ctx->dev, ctx->essid );
+	}
 
 	net80211_free_wlanlist ( ctx->beacons );
 
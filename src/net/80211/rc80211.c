@@ -22,6 +22,7 @@
 FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <stdlib.h>
+#include <ipxe/timer.h>
 #include <ipxe/net80211.h>
 
 /**
@@ -32,116 +33,99 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 /** @page rc80211 Rate control philosophy
  *
- * We want to maximize our transmission speed, to the extent that we
- * can do that without dropping undue numbers of packets. We also
- * don't want to take up very much code space, so our algorithm has to
- * be pretty simple
- *
- * When we receive a packet, we know what rate it was transmitted at,
- * and whether it had to be retransmitted to get to us.
+ * We want to maximize our effective transmission speed, i.e. the
+ * rate at which data actually gets through, rather than the nominal
+ * rate of the radio.  A high rate that needs many retries can be
+ * slower in practice than a lower rate that works first time.  We
+ * also don't want to take up very much code space, so our algorithm
+ * has to be pretty simple.
  *
  * When we send a packet, we hear back how many times it had to be
- * retried to get through, and whether it got through at all.
- *
- * Indications of TX success are more reliable than RX success, but RX
- * information helps us know where to start.
+ * retried to get through, and whether it got through at all.  For
+ * each rate we count the transmission attempts and successes seen
+ * within a short interval (@c RC_INTERVAL).  At the end of each
+ * interval we fold the observed success ratio into an exponentially
+ * weighted moving average of the success probability for that rate,
+ * giving the history three times the weight of the new sample.
  *
- * To handle all of this, we keep for each rate and each direction (TX
- * and RX separately) some state information for the most recent
- * packets on that rate and the number of packets for which we have
- * information. The state is a 32-bit unsigned integer in which two
- * bits represent a packet: 11 if it went through well, 10 if it went
- * through with one retry, 01 if it went through with more than one
- * retry, or 00 if it didn't go through at all. We define the
- * "goodness" for a particular (rate, direction) combination as the
- * sum of all the 2-bit fields, times 33, divided by the number of
- * 2-bit fields containing valid information (16 except when we're
- * starting out). The number produced is between 0 and 99; we use -1
- * for rates with less than 4 RX packets or 1 TX, as an indicator that
- * we do not have enough information to rely on them.
+ * The expected throughput of a rate is its success probability
+ * multiplied by its nominal rate.  Rates which work less than @c
+ * RC_PROB_MIN of the time are treated as useless, since the
+ * retransmissions would dominate.  After each interval we switch to
+ * whichever rate has the best expected throughput.
  *
- * In deciding which rates are best, we find the weighted average of
- * TX and RX goodness, where the weighting is by number of packets
- * with data and TX packets are worth 4 times as much as RX packets.
- * The weighted average is called "net goodness" and is also a number
- * between 0 and 99.  If 3 consecutive packets fail transmission
- * outright, we automatically ratchet down the rate; otherwise, we
- * switch to the best rate whenever the current rate's goodness falls
- * below some threshold, and try increasing our rate when the goodness
- * is very high.
+ * We will never learn that a faster rate has become usable if we
+ * never try it, so one in every @c RC_SAMPLE_INTERVAL transmitted
+ * packets is sent at a sample rate.  Sample rates are chosen in
+ * round-robin order from those whose nominal rate exceeds the
+ * current best expected throughput; a rate that could not beat the
+ * current best even with perfect success is not worth probing.  Once
+ * the sample packet completes we return to the best rate.
  *
- * This system is optimized for iPXE's style of usage. Because normal
- * operation always involves receiving something, we'll make our way
- * to the best rate pretty quickly. We tend to follow the lead of the
- * sending AP in choosing rates, but we won't use rates for long that
- * don't work well for us in transmission. We assume iPXE won't be
- * running for long enough that rate patterns will change much, so we
- * don't have to keep time counters or the like.  And if this doesn't
- * work well in practice there are many ways it could be tweaked.
+ * If @c RC_TX_EMERG_FAIL consecutive packets fail transmission
+ * outright, we do not wait for the end of the interval: the failing
+ * rate is marked as useless and we immediately drop to the next
+ * lower rate.
  *
- * To avoid staying at 1Mbps for a long time, we don't track any
- * transmitted packets until we've set our rate based on received
- * packets.
+ * When we receive a packet we know what rate it was transmitted at.
+ * The AP's choice of rate is a good first guess for our own, so we
+ * start at the rate of the first received data packet and don't
+ * track any transmitted packets until then.  This avoids spending a
+ * long time at 1Mbps while the statistics build up.
  */
 
-/** Two-bit packet status indicator for a packet with no retries */
-#define RC_PKT_OK		0x3
+/** Length of a statistics interval */
+#define RC_INTERVAL		( TICKS_PER_SEC / 10 )
 
-/** Two-bit packet status indicator for a packet with one retry */
-#define RC_PKT_RETRIED_ONCE	0x2
-
-/** Two-bit packet status indicator for a TX packet with multiple retries
- *
- * It is not possible to tell whether an RX packet had one or multiple
- * retries; we rely instead on the fact that failed RX packets won't
- * get to us at all, so if we receive a lot of RX packets on a certain
- * rate it must be pretty good.
- */
-#define RC_PKT_RETRIED_MULTI	0x1
+/** Fixed-point scale factor for success probabilities */
+#define RC_PROB_SCALE		1024
 
-/** Two-bit packet status indicator for a TX packet that was never ACKed
- *
- * It is not possible to tell whether an RX packet was setn if it
- * didn't get through to us, but if we don't see one we won't increase
- * the goodness for its rate. This asymmetry is part of why TX packets
- * are weighted much more heavily than RX.
- */
-#define RC_PKT_FAILED		0x0
+/** Minimum success probability for a rate to be considered usable */
+#define RC_PROB_MIN		( RC_PROB_SCALE / 10 )
 
-/** Number of times to weight TX packets more heavily than RX packets */
-#define RC_TX_FACTOR		4
+/** Number of transmitted packets per sample packet */
+#define RC_SAMPLE_INTERVAL	10
 
 /** Number of consecutive failed TX packets that cause an automatic rate drop */
 #define RC_TX_EMERG_FAIL	3
 
-/** Minimum net goodness below which we will search for a better rate */
-#define RC_GOODNESS_MIN		85
+/** Rate-control statistics for a single rate */
+struct rc80211_rate {
+	/** Transmission attempts within the current interval */
+	unsigned int attempts;
+	/** Successful transmissions within the current interval */
+	unsigned int successes;
+	/** Averaged success probability (scaled by @c RC_PROB_SCALE) */
+	unsigned int prob;
+	/** Averaged success probability is valid */
+	int valid;
+};
 
-/** Maximum net goodness above which we will try to increase our rate */
-#define RC_GOODNESS_MAX		95
+/** A rate control context */
+struct rc80211_ctx
+{
+	/** Statistics for each rate */
+	struct rc80211_rate rates[NET80211_MAX_RATES];
 
-/** Minimum (num RX + @c RC_TX_FACTOR * num TX) to use a certain rate */
-#define RC_UNCERTAINTY_THRESH	4
+	/** Index of rate with best expected throughput */
+	int best;
 
-/** TX direction */
-#define TX	0
+	/** Index of rate being sampled, or negative if not sampling */
+	int sample;
 
-/** RX direction */
-#define RX	1
+	/** Index at which to start looking for the next sample rate */
+	int sample_next;
 
-/** A rate control context */
-struct rc80211_ctx
-{
-	/** Goodness state for each rate, TX and RX */
-	u32 goodness[2][NET80211_MAX_RATES];
+	/** Start of current statistics interval */
+	unsigned long interval_start;
 
-	/** Number of packets recorded for each rate */
-	u8 count[2][NET80211_MAX_RATES];
+	/** Number of consecutive failed TX packets */
+	int failures;
 
 	/** Indication of whether we've set the device rate yet */
 	int started;
 
-	/** Counter of all packets sent and received */
+	/** Counter of all packets sent */
 	int packets;
 };
 
@@ -154,70 +138,28 @@ struct rc80211_ctx
 struct rc80211_ctx * rc80211_init ( struct net80211_device *dev __unused )
 {
 	struct rc80211_ctx *ret = zalloc ( sizeof ( *ret ) );
+
+	if ( ret )
+		ret->sample = -1;
 	return ret;
 }
 
 /**
- * Calculate net goodness for a certain rate
+ * Calculate expected throughput for a certain rate
  *
- * @v ctx	Rate-control context
- * @v rate_idx	Index of rate to calculate net goodness for
+ * @v dev	802.11 device
+ * @v rate_idx	Index of rate
+ * @ret tput	Expected throughput (arbitrary units), or zero if unusable
  */
-static int rc80211_calc_net_goodness ( struct rc80211_ctx *ctx,
-				       int rate_idx )
+static unsigned int rc80211_throughput ( struct net80211_device *dev,
+					 int rate_idx )
 {
-	int sum[2], num[2], dir, pkt;
-
-	for ( dir = 0; dir < 2; dir++ ) {
-		u32 good = ctx->goodness[dir][rate_idx];
-
-		num[dir] = ctx->count[dir][rate_idx];
-		sum[dir] = 0;
-
-		for ( pkt = 0; pkt < num[dir]; pkt++ )
-			sum[dir] += ( good >> ( 2 * pkt ) ) & 0x3;
-	}
+	struct rc80211_rate *rate = &dev->rctl->rates[rate_idx];
 
-	if ( ( num[TX] * RC_TX_FACTOR + num[RX] ) < RC_UNCERTAINTY_THRESH )
-		return -1;
+	if ( ( ! rate->valid ) || ( rate->prob < RC_PROB_MIN ) )
+		return 0;
 
-	return ( 33 * ( sum[TX] * RC_TX_FACTOR + sum[RX] ) /
-		      ( num[TX] * RC_TX_FACTOR + num[RX] ) );
-}
-
-/**
- * Determine the best rate to switch to and return it
- *
- * @v dev		802.11 device
- * @ret rate_idx	Index of the best rate to switch to
- */
-static int rc80211_pick_best ( struct net80211_device *dev )
-{
-	struct rc80211_ctx *ctx = dev->rctl;
-	int best_net_good = 0, best_rate = -1, i;
-
-	for ( i = 0; i < dev->nr_rates; i++ ) {
-		int net_good = rc80211_calc_net_goodness ( ctx, i );
-
-		if ( net_good > best_net_good ||
-		     ( best_net_good > RC_GOODNESS_MIN &&
-		       net_good > RC_GOODNESS_MIN ) ) {
-			best_net_good = net_good;
-			best_rate = i;
-		}
-	}
-
-	if ( best_rate >= 0 ) {
-		int old_good = rc80211_calc_net_goodness ( ctx, dev->rate );
-		if ( old_good != best_net_good )
-			DBGC ( ctx, "802.11 RC %p switching from goodness "
-			       "%d to %d\n", ctx, old_good, best_net_good );
-
-		ctx->started = 1;
-		return best_rate;
-	}
-
-	return dev->rate;
+	return ( rate->prob * dev->rates[rate_idx] );
 }
 
 /**
@@ -232,78 +174,89 @@ static int rc80211_pick_best ( struct net80211_device *dev )
 static inline void rc80211_set_rate ( struct net80211_device *dev,
 				      int rate_idx )
 {
-	DBGC ( dev->rctl, "802.11 RC %p changing rate %d->%d Mbps\n", dev->rctl,
-	       dev->rates[dev->rate] / 10, dev->rates[rate_idx] / 10 );
+	if ( rate_idx == dev->rate )
+		return;
+
+	DBGC2 ( dev->rctl, "802.11 RC %p changing rate %d->%d Mbps\n",
+		dev->rctl, dev->rates[dev->rate] / 10,
+		dev->rates[rate_idx] / 10 );
 
 	net80211_set_rate_idx ( dev, rate_idx );
 }
 
 /**
- * Check rate-control state and change rate if necessary
+ * Fold interval statistics into averages and pick the best rate
  *
  * @v dev	802.11 device
  */
-static void rc80211_maybe_set_new ( struct net80211_device *dev )
+static void rc80211_update_stats ( struct net80211_device *dev )
 {
 	struct rc80211_ctx *ctx = dev->rctl;
-	int net_good;
+	struct rc80211_rate *rate;
+	unsigned int best_tput = 0;
+	unsigned int tput;
+	unsigned int prob;
+	int best = -1;
+	int i;
 
-	net_good = rc80211_calc_net_goodness ( ctx, dev->rate );
-
-	if ( ! ctx->started ) {
-		rc80211_set_rate ( dev, rc80211_pick_best ( dev ) );
-		return;
-	}
-
-	if ( net_good < 0 )	/* insufficient data */
-		return;
+	for ( i = 0; i < dev->nr_rates; i++ ) {
+		rate = &ctx->rates[i];
+
+		/* Update averaged success probability */
+		if ( rate->attempts ) {
+			prob = ( ( rate->successes * RC_PROB_SCALE ) /
+				 rate->attempts );
+			if ( rate->valid ) {
+				rate->prob = ( ( rate->prob * 3 ) + prob ) / 4;
+			} else {
+				rate->prob = prob;
+				rate->valid = 1;
+			}
+			rate->attempts = 0;
+			rate->successes = 0;
+		}
 
-	if ( net_good > RC_GOODNESS_MAX && dev->rate + 1 < dev->nr_rates ) {
-		int higher = rc80211_calc_net_goodness ( ctx, dev->rate + 1 );
-		if ( higher > net_good || higher < 0 )
-			rc80211_set_rate ( dev, dev->rate + 1 );
-		else
-			rc80211_set_rate ( dev, rc80211_pick_best ( dev ) );
+		/* Track best expected throughput */
+		tput = rc80211_throughput ( dev, i );
+		if ( tput > best_tput ) {
+			best_tput = tput;
+			best = i;
+		}
 	}
 
-	if ( net_good < RC_GOODNESS_MIN ) {
-		rc80211_set_rate ( dev, rc80211_pick_best ( dev ) );
+	if ( ( best >= 0 ) && ( best != ctx->best ) ) {
+		DBGC ( ctx, "802.11 RC %p best rate %d->%d Mbps (%d%% "
+		       "success)\n", ctx, dev->rates[ctx->best] / 10,
+		       dev->rates[best] / 10,
+		       ( ctx->rates[best].prob * 100 / RC_PROB_SCALE ) );
+		ctx->best = best;
 	}
 }
 
 /**
- * Update rate-control state
+ * Choose the next rate to sample
  *
  * @v dev		802.11 device
- * @v direction		One of the direction constants TX or RX
- * @v rate_idx		Index of rate at which packet was sent or received
- * @v retries		Number of times packet was retried before success
- * @v failed		If nonzero, the packet failed to get through
+ * @ret rate_idx	Index of rate to sample, or negative if none
  */
-static void rc80211_update ( struct net80211_device *dev, int direction,
-			     int rate_idx, int retries, int failed )
+static int rc80211_pick_sample ( struct net80211_device *dev )
 {
 	struct rc80211_ctx *ctx = dev->rctl;
-	u32 goodness = ctx->goodness[direction][rate_idx];
-
-	if ( ctx->count[direction][rate_idx] < 16 )
-		ctx->count[direction][rate_idx]++;
-
-	goodness <<= 2;
-	if ( failed )
-		goodness |= RC_PKT_FAILED;
-	else if ( retries > 1 )
-		goodness |= RC_PKT_RETRIED_MULTI;
-	else if ( retries )
-		goodness |= RC_PKT_RETRIED_ONCE;
-	else
-		goodness |= RC_PKT_OK;
-
-	ctx->goodness[direction][rate_idx] = goodness;
-
-	ctx->packets++;
+	unsigned int best_tput = rc80211_throughput ( dev, ctx->best );
+	int i;
+	int n;
+
+	for ( n = 0; n < dev->nr_rates; n++ ) {
+		i = ( ( ctx->sample_next + n ) % dev->nr_rates );
+		if ( i == ctx->best )
+			continue;
+		if ( ( dev->rates[i] * RC_PROB_SCALE ) <= best_tput )
+			continue;
+		ctx->sample_next = ( i + 1 );
+		return i;
+	}
 
-	rc80211_maybe_set_new ( dev );
+	return -1;
 }
 
 /**
@@ -316,29 +269,59 @@ static void rc80211_update ( struct net80211_device *dev, int direction,
 void rc80211_update_tx ( struct net80211_device *dev, int retries, int rc )
 {
 	struct rc80211_ctx *ctx = dev->rctl;
+	struct rc80211_rate *rate;
 
 	if ( ! ctx->started )
 		return;
 
-	rc80211_update ( dev, TX, dev->rate, retries, rc );
+	/* Record statistics for the rate in use */
+	rate = &ctx->rates[dev->rate];
+	rate->attempts += ( retries + 1 );
+	if ( rc == 0 ) {
+		rate->successes++;
+		ctx->failures = 0;
+	} else {
+		ctx->failures++;
+	}
 
 	/* Check if the last RC_TX_EMERG_FAIL packets have all failed */
-	if ( ! ( ctx->goodness[TX][dev->rate] &
-		 ( ( 1 << ( 2 * RC_TX_EMERG_FAIL ) ) - 1 ) ) ) {
-		if ( dev->rate == 0 )
-			DBGC ( dev->rctl, "802.11 RC %p saw %d consecutive "
+	if ( ctx->failures >= RC_TX_EMERG_FAIL ) {
+		ctx->failures = 0;
+		rate->prob = 0;
+		rate->valid = 1;
+		if ( dev->rate == 0 ) {
+			DBGC ( ctx, "802.11 RC %p saw %d consecutive "
 			       "failed TX, but cannot lower rate any further\n",
-			       dev->rctl, RC_TX_EMERG_FAIL );
-		else {
-			DBGC ( dev->rctl, "802.11 RC %p lowering rate (%d->%d "
+			       ctx, RC_TX_EMERG_FAIL );
+		} else {
+			DBGC ( ctx, "802.11 RC %p lowering rate (%d->%d "
 			       "Mbps) due to %d consecutive TX failures\n",
-			       dev->rctl, dev->rates[dev->rate] / 10,
+			       ctx, dev->rates[dev->rate] / 10,
 			       dev->rates[dev->rate - 1] / 10,
 			       RC_TX_EMERG_FAIL );
-
-			rc80211_set_rate ( dev, dev->rate - 1 );
+			ctx->best = ( dev->rate - 1 );
 		}
+		ctx->sample = -1;
+		rc80211_set_rate ( dev, ctx->best );
+		return;
 	}
+
+	/* Fold in statistics at the end of each interval */
+	if ( ( currticks() - ctx->interval_start ) >= RC_INTERVAL ) {
+		rc80211_update_stats ( dev );
+		ctx->interval_start = currticks();
+	}
+
+	/* Return to the best rate after a sample packet, or
+	 * periodically try a sample rate.
+	 */
+	if ( ctx->sample >= 0 ) {
+		ctx->sample = -1;
+	} else if ( ( ++ctx->packets % RC_SAMPLE_INTERVAL ) == 0 ) {
+		ctx->sample = rc80211_pick_sample ( dev );
+	}
+	rc80211_set_rate ( dev, ( ( ctx->sample >= 0 ) ?
+				  ctx->sample : ctx->best ) );
 }
 
 /**
@@ -348,17 +331,29 @@ void rc80211_update_tx ( struct net80211_device *dev, int retries, int rc )
  * @v retry	Whether the received packet had been retransmitted
  * @v rate	Rate at which packet was received, in 100 kbps units
  */
-void rc80211_update_rx ( struct net80211_device *dev, int retry, u16 rate )
+void rc80211_update_rx ( struct net80211_device *dev, int retry __unused,
+			 u16 rate )
 {
+	struct rc80211_ctx *ctx = dev->rctl;
 	int ridx;
 
+	/* Only the first received packet is of interest */
+	if ( ctx->started )
+		return;
+
 	for ( ridx = 0; ridx < dev->nr_rates && dev->rates[ridx] != rate;
 	      ridx++ )
 		;
 	if ( ridx >= dev->nr_rates )
 		return;		/* couldn't find the rate */
 
-	rc80211_update ( dev, RX, ridx, retry, 0 );
+	/* Start at the AP's chosen rate */
+	DBGC ( ctx, "802.11 RC %p starting at %d Mbps\n",
+	       ctx, dev->rates[ridx] / 10 );
+	ctx->best = ridx;
+	ctx->interval_start = currticks();
+	ctx->started = 1;
+	rc80211_set_rate ( dev, ridx );
 }
 
 /**
@@ -22,6 +22,8 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <string.h>
 #include <ipxe/net80211.h>
 #include <ipxe/sha1.h>
+#include <ipxe/base16.h>
+#include <ipxe/crypto.h>
 #include <ipxe/wpa.h>
 #include <errno.h>
 
@@ -30,6 +32,76 @@ FILE_LICENCE ( GPL2_OR_LATER );
  * Frontend for WPA using a pre-shared key.
  */
 
+/** Number of cached PMKs */
+#define WPA_PSK_CACHE_SIZE 4
+
+/** A cached PMK
+ *
+ * Deriving the PMK from a passphrase requires 4096 iterations of
+ * PBKDF2-SHA1, which may take several seconds on a slow CPU.  We
+ * cache derived PMKs so that reassociation (or association via a
+ * second device) does not repeat the derivation.  The passphrase
+ * itself is not retained; only its SHA-1 digest is used to identify
+ * the cache entry.
+ */
+struct wpa_psk_cached {
+	/** ESSID (used as PBKDF2 salt) */
+	char essid[IEEE80211_MAX_SSID_LEN+1];
+	/** SHA-1 digest of passphrase */
+	u8 digest[SHA1_DIGEST_SIZE];
+	/** Derived PMK */
+	u8 pmk[WPA_PMK_LEN];
+};
+
+/** PMK cache */
+static struct wpa_psk_cached wpa_psk_cache[WPA_PSK_CACHE_SIZE];
+
+/** Next PMK cache entry to be replaced */
+static unsigned int wpa_psk_cache_next;
+
+/**
+ * Derive PMK from passphrase, using cache if possible
+ *
+ * @v essid	ESSID
+ * @v passphrase Passphrase
+ * @v len	Length of passphrase
+ * @v pmk	PMK to fill in
+ */
+static void wpa_psk_derive ( const char *essid, const char *passphrase,
+			     size_t len, u8 *pmk )
+{
+	u8 sha1_ctx[SHA1_CTX_SIZE];
+	u8 digest[SHA1_DIGEST_SIZE];
+	struct wpa_psk_cached *cached;
+	unsigned int i;
+
+	/* Identify passphrase */
+	digest_init ( &sha1_algorithm, sha1_ctx );
+	digest_update ( &sha1_algorithm, sha1_ctx, passphrase, len );
+	digest_final ( &sha1_algorithm, sha1_ctx, digest );
+
+	/* Use cached PMK, if available */
+	for ( i = 0 ; i < WPA_PSK_CACHE_SIZE ; i++ ) {
+		cached = &wpa_psk_cache[i];
+		if ( ( strcmp ( cached->essid, essid ) == 0 ) &&
+		     ( memcmp ( cached->digest, digest,
+				sizeof ( digest ) ) == 0 ) ) {
+			memcpy ( pmk, cached->pmk, WPA_PMK_LEN );
+			return;
+		}
+	}
+
+	/* Derive PMK */
+	pbkdf2_sha1 ( passphrase, len, essid, strlen ( essid ),
+		      4096, pmk, WPA_PMK_LEN );
+
+	/* Add to cache */
+	cached = &wpa_psk_cache[ wpa_psk_cache_next++ % WPA_PSK_CACHE_SIZE ];
+	strncpy ( cached->essid, essid, ( sizeof ( cached->essid ) - 1 ) );
+	memcpy ( cached->digest, digest, sizeof ( cached->digest ) );
+	memcpy ( cached->pmk, pmk, sizeof ( cached->pmk ) );
+}
+
 /**
  * Initialise WPA-PSK state
  *
@@ -64,11 +136,20 @@ static int wpa_psk_start ( struct net80211_device *dev )
 		return -EACCES;
 	}
 
-	pbkdf2_sha1 ( passphrase, len, dev->essid, strlen ( dev->essid ),
-		      4096, pmk, WPA_PMK_LEN );
-
-	DBGC ( ctx, "WPA-PSK %p: derived PMK from passphrase `%s':\n", ctx,
-	       passphrase );
+	/* A key of exactly 64 hex digits is the PMK itself; anything
+	 * else is a passphrase from which the PMK must be derived.
+	 * This allows a precomputed PMK to be stored (e.g. in
+	 * non-volatile options) in place of the passphrase.
+	 */
+	if ( ( len == ( 2 * WPA_PMK_LEN ) ) &&
+	     ( base16_decode ( passphrase, pmk,
+			       WPA_PMK_LEN ) == WPA_PMK_LEN ) ) {
+		DBGC ( ctx, "WPA-PSK %p: using raw PMK:\n", ctx );
+	} else {
+		wpa_psk_derive ( dev->essid, passphrase, len, pmk );
+		DBGC ( ctx, "WPA-PSK %p: derived PMK from passphrase "
+		       "`%s':\n", ctx, passphrase );
+	}
 	DBGC_HD ( ctx, pmk, WPA_PMK_LEN );
 
 	return wpa_start ( dev, ctx, pmk, WPA_PMK_LEN );
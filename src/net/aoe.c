@@ -43,6 +43,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/ata.h>
 #include <ipxe/device.h>
 #include <ipxe/aoe.h>
+#include <config/general.h>
 
 /** @file
  *
@@ -88,6 +89,19 @@ struct aoe_device {
 	/** Saved timeout value */
 	unsigned long timeout;
 
+	/** List of pending ATA requests */
+	struct list_head requests;
+	/** Maximum number of sectors per AoE command */
+	unsigned int scnt;
+	/** Maximum number of outstanding AoE commands */
+	unsigned int max_window;
+	/** Current number of outstanding AoE commands permitted */
+	unsigned int window;
+	/** Number of outstanding AoE commands */
+	unsigned int outstanding;
+	/** Number of successful AoE commands since the window last grew */
+	unsigned int credit;
+
 	/** Configuration command interface */
 	struct interface config;
 	/** Device is configued */
@@ -97,6 +111,36 @@ struct aoe_device {
 	struct acpi_descriptor desc;
 };
 
+/** An AoE ATA request
+ *
+ * An ATA request may be split into several AoE ATA commands, which
+ * may be outstanding simultaneously.
+ */
+struct aoe_request {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** AoE device */
+	struct aoe_device *aoedev;
+	/** List of pending requests */
+	struct list_head list;
+
+	/** ATA command interface */
+	struct interface ata;
+
+	/** ATA command */
+	struct ata_cmd command;
+	/** Request tag */
+	uint32_t tag;
+	/** Number of sectors */
+	unsigned int count;
+	/** Request may be split into multiple AoE commands */
+	int split;
+	/** Number of sectors issued */
+	unsigned int issued;
+	/** Number of sectors completed */
+	unsigned int completed;
+};
+
 /** An AoE command */
 struct aoe_command {
 	/** Reference count */
@@ -115,6 +159,10 @@ struct aoe_command {
 	struct aoe_command_type *type;
 	/** Command tag */
 	uint32_t tag;
+	/** Containing ATA request (if any) */
+	struct aoe_request *request;
+	/** Number of request sectors covered by this command */
+	unsigned int count;
 
 	/** Retransmission timer */
 	struct retry_timer timer;
@@ -194,6 +242,31 @@ aoecmd_put ( struct aoe_command *aoecmd ) {
 	ref_put ( &aoecmd->refcnt );
 }
 
+/**
+ * Get reference to AoE request
+ *
+ * @v aoereq		AoE request
+ * @ret aoereq		AoE request
+ */
+static inline __attribute__ (( always_inline )) struct aoe_request *
+aoereq_get ( struct aoe_request *aoereq ) {
+	ref_get ( &aoereq->refcnt );
+	return aoereq;
+}
+
+/**
+ * Drop reference to AoE request
+ *
+ * @v aoereq		AoE request
+ */
+static inline __attribute__ (( always_inline )) void
+aoereq_put ( struct aoe_request *aoereq ) {
+	ref_put ( &aoereq->refcnt );
+}
+
+static void aoereq_complete ( struct aoe_request *aoereq, unsigned int count,
+			      int rc );
+
 /**
  * Name AoE device
  *
@@ -246,6 +319,14 @@ static void aoecmd_close ( struct aoe_command *aoecmd, int rc ) {
 		aoecmd_put ( aoecmd );
 	}
 
+	/* Complete portion of containing ATA request, if applicable */
+	if ( aoecmd->request ) {
+		aoedev->outstanding--;
+		aoereq_complete ( aoecmd->request, aoecmd->count, rc );
+		aoereq_put ( aoecmd->request );
+		aoecmd->request = NULL;
+	}
+
 	/* Shut down interfaces */
 	intf_shutdown ( &aoecmd->ata, rc );
 }
@@ -366,10 +447,19 @@ static int aoecmd_rx ( struct aoe_command *aoecmd, struct io_buffer *iobuf,
 static void aoecmd_expired ( struct retry_timer *timer, int fail ) {
 	struct aoe_command *aoecmd =
 		container_of ( timer, struct aoe_command, timer );
+	struct aoe_device *aoedev = aoecmd->aoedev;
 
 	if ( fail ) {
 		aoecmd_close ( aoecmd, -ETIMEDOUT );
 	} else {
+		/* Assume congestion, and halve the window */
+		if ( aoecmd->request ) {
+			aoedev->window = ( ( aoedev->window + 1 ) / 2 );
+			aoedev->credit = 0;
+			DBGC ( aoedev, "AoE %s/%08x retransmitting; window "
+			       "%d\n", aoedev_name ( aoedev ), aoecmd->tag,
+			       aoedev->window );
+		}
 		aoecmd_tx ( aoecmd );
 	}
 }
@@ -542,6 +632,8 @@ static int aoecmd_cfg_rsp ( struct aoe_command *aoecmd, const void *data,
 	struct ll_protocol *ll_protocol = aoedev->netdev->ll_protocol;
 	const struct aoehdr *aoehdr = data;
 	const struct aoecfg *aoecfg = &aoehdr->payload[0].cfg;
+	unsigned int max_scnt;
+	unsigned int bufcnt;
 
 	/* Sanity check */
 	if ( len < ( sizeof ( *aoehdr ) + sizeof ( *aoecfg ) ) ) {
@@ -559,6 +651,29 @@ static int aoecmd_cfg_rsp ( struct aoe_command *aoecmd, const void *data,
 	DBGC ( aoedev, "AoE %s has MAC address %s\n",
 	       aoedev_name ( aoedev ), ll_protocol->ntoa ( aoedev->target ) );
 
+	/* Record maximum number of sectors per command, limited by
+	 * the network device MTU.
+	 */
+	max_scnt = ( ( aoedev->netdev->mtu - sizeof ( *aoehdr ) -
+		       sizeof ( struct aoeata ) ) / ATA_SECTOR_SIZE );
+	aoedev->scnt = ( aoecfg->scnt ? aoecfg->scnt : AOE_MAX_COUNT );
+	if ( aoedev->scnt > max_scnt )
+		aoedev->scnt = max_scnt;
+	if ( ! aoedev->scnt )
+		aoedev->scnt = 1;
+
+	/* Record maximum number of outstanding commands, limited by
+	 * the target's buffer count.
+	 */
+	bufcnt = ntohs ( aoecfg->bufcnt );
+	aoedev->max_window = AOE_MAX_WINDOW;
+	if ( aoedev->max_window > bufcnt )
+		aoedev->max_window = bufcnt;
+	if ( ! aoedev->max_window )
+		aoedev->max_window = 1;
+	DBGC ( aoedev, "AoE %s using %d sectors per command, window %d\n",
+	       aoedev_name ( aoedev ), aoedev->scnt, aoedev->max_window );
+
 	return 0;
 }
 
@@ -647,6 +762,206 @@ static struct aoe_command * aoecmd_create ( struct aoe_device *aoedev,
 	return aoecmd;
 }
 
+/**
+ * Free AoE request
+ *
+ * @v refcnt		Reference counter
+ */
+static void aoereq_free ( struct refcnt *refcnt ) {
+	struct aoe_request *aoereq =
+		container_of ( refcnt, struct aoe_request, refcnt );
+
+	assert ( list_empty ( &aoereq->list ) );
+
+	aoedev_put ( aoereq->aoedev );
+	free ( aoereq );
+}
+
+/**
+ * Close AoE request
+ *
+ * @v aoereq		AoE request
+ * @v rc		Reason for close
+ */
+static void aoereq_close ( struct aoe_request *aoereq, int rc ) {
+	struct aoe_device *aoedev = aoereq->aoedev;
+	struct aoe_command *aoecmd;
+	struct aoe_command *tmp;
+
+	/* Do nothing if already closed */
+	if ( list_empty ( &aoereq->list ) )
+		return;
+
+	/* Remove from list of requests */
+	list_del ( &aoereq->list );
+	INIT_LIST_HEAD ( &aoereq->list );
+
+	/* Abandon any outstanding AoE commands.  Detach each command
+	 * from this request before closing it, so that the command's
+	 * completion is not reported back to this request.
+	 */
+	list_for_each_entry_safe ( aoecmd, tmp, &aoe_commands, list ) {
+		if ( aoecmd->request != aoereq )
+			continue;
+		aoecmd->request = NULL;
+		aoedev->outstanding--;
+		aoereq_put ( aoereq );
+		aoecmd_get ( aoecmd );
+		aoecmd_close ( aoecmd, rc );
+		aoecmd_put ( aoecmd );
+	}
+
+	/* Shut down interfaces */
+	intf_shutdown ( &aoereq->ata, rc );
+
+	/* Drop list's reference */
+	aoereq_put ( aoereq );
+}
+
+/**
+ * Issue next AoE command for an AoE request
+ *
+ * @v aoereq		AoE request
+ * @ret rc		Return status code
+ */
+static int aoereq_issue ( struct aoe_request *aoereq ) {
+	struct aoe_device *aoedev = aoereq->aoedev;
+	struct ata_cmd *command;
+	struct aoe_command *aoecmd;
+	unsigned int count;
+	size_t offset;
+
+	/* Create command */
+	aoecmd = aoecmd_create ( aoedev, &aoecmd_ata );
+	if ( ! aoecmd )
+		return -ENOMEM;
+	command = &aoecmd->command;
+	memcpy ( command, &aoereq->command, sizeof ( *command ) );
+
+	/* Restrict command to the next portion of the request, if
+	 * applicable.
+	 */
+	count = ( aoereq->count - aoereq->issued );
+	if ( aoereq->split ) {
+		if ( count > aoedev->scnt )
+			count = aoedev->scnt;
+		offset = ( aoereq->issued * ATA_SECTOR_SIZE );
+		command->cb.lba.native += aoereq->issued;
+		command->cb.count.native = count;
+		if ( ! command->cb.lba48 ) {
+			command->cb.device &= ATA_DEV_MASK;
+			command->cb.device |= command->cb.lba.bytes.low_prev;
+		}
+		if ( command->data_in_len ) {
+			command->data_in = userptr_add ( command->data_in,
+							 offset );
+			command->data_in_len = ( count * ATA_SECTOR_SIZE );
+		}
+		if ( command->data_out_len ) {
+			command->data_out = userptr_add ( command->data_out,
+							  offset );
+			command->data_out_len = ( count * ATA_SECTOR_SIZE );
+		}
+	}
+	aoecmd->request = aoereq_get ( aoereq );
+	aoecmd->count = count;
+	aoereq->issued += count;
+	aoedev->outstanding++;
+
+	/* Attempt to send command.  Allow failures to be handled by
+	 * the retry timer.
+	 */
+	aoecmd_tx ( aoecmd );
+
+	return 0;
+}
+
+/**
+ * Issue AoE commands for pending AoE requests
+ *
+ * @v aoedev		AoE device
+ * @ret rc		Return status code
+ */
+static int aoedev_issue ( struct aoe_device *aoedev ) {
+	struct aoe_request *aoereq;
+	int rc;
+
+	/* Issue commands until window is full */
+	while ( aoedev->outstanding < aoedev->window ) {
+
+		/* Find first request with unissued sectors */
+		list_for_each_entry ( aoereq, &aoedev->requests, list ) {
+			if ( aoereq->issued < aoereq->count )
+				break;
+		}
+		if ( &aoereq->list == &aoedev->requests )
+			return 0;
+
+		/* Issue command.  Leave the request pending on
+		 * failure, so that it may be retried when an
+		 * outstanding command completes.
+		 */
+		if ( ( rc = aoereq_issue ( aoereq ) ) != 0 ) {
+			DBGC ( aoedev, "AoE %s/%08x could not issue command: "
+			       "%s\n", aoedev_name ( aoedev ), aoereq->tag,
+			       strerror ( rc ) );
+			return rc;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Handle completion of part of an AoE request
+ *
+ * @v aoereq		AoE request
+ * @v count		Number of sectors completed
+ * @v rc		Reason for completion
+ */
+static void aoereq_complete ( struct aoe_request *aoereq, unsigned int count,
+			      int rc ) {
+	struct aoe_device *aoedev = aoereq->aoedev;
+	struct aoe_request *tmp;
+
+	/* Open the window by one command for each window's worth of
+	 * successful commands.
+	 */
+	if ( rc == 0 ) {
+		aoereq->completed += count;
+		if ( ( ++aoedev->credit >= aoedev->window ) &&
+		     ( aoedev->window < aoedev->max_window ) ) {
+			aoedev->window++;
+			aoedev->credit = 0;
+		}
+	}
+
+	/* Close request on completion or failure */
+	if ( ( rc != 0 ) || ( aoereq->completed == aoereq->count ) )
+		aoereq_close ( aoereq, rc );
+
+	/* Issue further commands.  If no commands are outstanding
+	 * then there will be no subsequent opportunity to retry, so
+	 * fail all pending requests.
+	 */
+	if ( ( ( rc = aoedev_issue ( aoedev ) ) != 0 ) &&
+	     ( aoedev->outstanding == 0 ) ) {
+		list_for_each_entry_safe ( aoereq, tmp, &aoedev->requests,
+					   list ) {
+			aoereq_close ( aoereq, rc );
+		}
+	}
+}
+
+/** AoE request ATA interface operations */
+static struct interface_operation aoereq_ata_op[] = {
+	INTF_OP ( intf_close, struct aoe_request *, aoereq_close ),
+};
+
+/** AoE request ATA interface descriptor */
+static struct interface_descriptor aoereq_ata_desc =
+	INTF_DESC ( struct aoe_request, ata, aoereq_ata_op );
+
 /**
  * Issue AoE ATA command
  *
@@ -659,7 +974,10 @@ static int aoedev_ata_command ( struct aoe_device *aoedev,
 				struct interface *parent,
 				struct ata_cmd *command ) {
 	struct net_device *netdev = aoedev->netdev;
-	struct aoe_command *aoecmd;
+	struct aoe_request *aoereq;
+	size_t len;
+	int tag;
+	int rc;
 
 	/* Fail immediately if net device is closed */
 	if ( ! netdev_is_open ( netdev ) ) {
@@ -668,22 +986,53 @@ static int aoedev_ata_command ( struct aoe_device *aoedev,
 		return -EWOULDBLOCK;
 	}
 
-	/* Create command */
-	aoecmd = aoecmd_create ( aoedev, &aoecmd_ata );
-	if ( ! aoecmd )
-		return -ENOMEM;
-	memcpy ( &aoecmd->command, command, sizeof ( aoecmd->command ) );
+	/* Allocate request tag */
+	tag = aoecmd_new_tag();
+	if ( tag < 0 )
+		return tag;
 
-	/* Attempt to send command.  Allow failures to be handled by
-	 * the retry timer.
+	/* Allocate and initialise structure */
+	aoereq = zalloc ( sizeof ( *aoereq ) );
+	if ( ! aoereq )
+		return -ENOMEM;
+	ref_init ( &aoereq->refcnt, aoereq_free );
+	intf_init ( &aoereq->ata, &aoereq_ata_desc, &aoereq->refcnt );
+	aoereq->aoedev = aoedev_get ( aoedev );
+	aoereq->tag = tag;
+	memcpy ( &aoereq->command, command, sizeof ( aoereq->command ) );
+
+	/* Split into multiple AoE commands only if the data buffers
+	 * are exactly the size implied by the sector count.
 	 */
-	aoecmd_tx ( aoecmd );
+	aoereq->count = command->cb.count.native;
+	len = ( aoereq->count * ATA_SECTOR_SIZE );
+	aoereq->split = ( aoereq->count &&
+			  ( command->data_in_len + command->data_out_len ) &&
+			  ( ( command->data_in_len == 0 ) ||
+			    ( command->data_in_len == len ) ) &&
+			  ( ( command->data_out_len == 0 ) ||
+			    ( command->data_out_len == len ) ) );
+	if ( ! aoereq->split )
+		aoereq->count = 1;
+	list_add_tail ( &aoereq->list, &aoedev->requests );
+
+	/* Issue as many commands as the window allows.  Fail
+	 * immediately if nothing could be issued, since there will be
+	 * no subsequent opportunity to retry.
+	 */
+	if ( ( ( rc = aoedev_issue ( aoedev ) ) != 0 ) &&
+	     ( aoedev->outstanding == 0 ) ) {
+		list_del ( &aoereq->list );
+		INIT_LIST_HEAD ( &aoereq->list );
+		aoereq_put ( aoereq );
+		return rc;
+	}
 
-	/* Attach to parent interface, leave reference with command
+	/* Attach to parent interface, leave reference with request
 	 * list, and return.
 	 */
-	intf_plug_plug ( &aoecmd->ata, parent );
-	return aoecmd->tag;
+	intf_plug_plug ( &aoereq->ata, parent );
+	return aoereq->tag;
 }
 
 /**
@@ -734,6 +1083,8 @@ static void aoedev_free ( struct refcnt *refcnt ) {
  * @v rc		Reason for close
  */
 static void aoedev_close ( struct aoe_device *aoedev, int rc ) {
+	struct aoe_request *aoereq;
+	struct aoe_request *tmpreq;
 	struct aoe_command *aoecmd;
 	struct aoe_command *tmp;
 
@@ -741,6 +1092,13 @@ static void aoedev_close ( struct aoe_device *aoedev, int rc ) {
 	intf_shutdown ( &aoedev->ata, rc );
 	intf_shutdown ( &aoedev->config, rc );
 
+	/* Shut down any pending requests */
+	list_for_each_entry_safe ( aoereq, tmpreq, &aoedev->requests, list ) {
+		aoereq_get ( aoereq );
+		aoereq_close ( aoereq, rc );
+		aoereq_put ( aoereq );
+	}
+
 	/* Shut down any active commands */
 	list_for_each_entry_safe ( aoecmd, tmp, &aoe_commands, list ) {
 		if ( aoecmd->aoedev != aoedev )
@@ -847,6 +1205,7 @@ static int aoedev_open ( struct interface *parent, struct net_device *netdev,
 		goto err_zalloc;
 	}
 	ref_init ( &aoedev->refcnt, aoedev_free );
+	INIT_LIST_HEAD ( &aoedev->requests );
 	intf_init ( &aoedev->ata, &aoedev_ata_desc, &aoedev->refcnt );
 	intf_init ( &aoedev->config, &aoedev_config_desc, &aoedev->refcnt );
 	aoedev->netdev = netdev_get ( netdev );
@@ -854,6 +1213,9 @@ static int aoedev_open ( struct interface *parent, struct net_device *netdev,
 	aoedev->minor = minor;
 	memcpy ( aoedev->target, netdev->ll_broadcast,
 		 netdev->ll_protocol->ll_addr_len );
+	aoedev->scnt = AOE_MAX_COUNT;
+	aoedev->max_window = 1;
+	aoedev->window = 1;
 	acpi_init ( &aoedev->desc, &abft_model, &aoedev->refcnt );
 
 	/* Initiate configuration */
@@ -865,7 +1227,7 @@ static int aoedev_open ( struct interface *parent, struct net_device *netdev,
 
 	/* Attach ATA device to parent interface */
 	if ( ( rc = ata_open ( parent, &aoedev->ata, ATA_DEV_MASTER,
-			       AOE_MAX_COUNT ) ) != 0 ) {
+			       AOE_MAX_SECTORS ) ) != 0 ) {
 		DBGC ( aoedev, "AoE %s could not create ATA device: %s\n",
 		       aoedev_name ( aoedev ), strerror ( rc ) );
 		goto err_ata_open;
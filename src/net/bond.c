@@ -0,0 +1,777 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <byteswap.h>
+#include <ipxe/if_ether.h>
+#include <ipxe/ethernet.h>
+#include <ipxe/netdevice.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/retry.h>
+#include <ipxe/timer.h>
+#include <ipxe/in.h>
+#include <ipxe/ip.h>
+#include <ipxe/ipv6.h>
+#include <ipxe/eth_slow.h>
+#include <ipxe/bond.h>
+
+/** @file
+ *
+ * Link aggregation (bonding)
+ *
+ * A bonded device aggregates several Ethernet member devices into a
+ * single logical device, using LACP (IEEE 802.1AX) to negotiate the
+ * aggregation with the attached switch.  Transmitted packets are
+ * spread across all distributing members according to a hash of
+ * their addresses and ports, so that separate flows (e.g. parallel
+ * HTTP range requests) may make use of separate links while each
+ * individual flow remains in order.
+ *
+ * If no LACP partner is present on any member, the bonded device
+ * falls back to using the first member with link up as an individual
+ * link.
+ */
+
+/** A bonded device member */
+struct bond_member {
+	/** Network device */
+	struct net_device *netdev;
+	/** Actor (i.e. our) LACP state */
+	uint8_t state;
+	/** Partner information, as most recently received */
+	struct eth_slow_lacp_entity_tlv partner;
+	/** Partner's view of the actor, as most recently received */
+	struct eth_slow_lacp_entity_tlv seen;
+	/** Time at which partner information was last received */
+	unsigned long updated;
+	/** Number of timer ticks since last LACP transmission */
+	unsigned int idle;
+};
+
+/** Bonded device private data */
+struct bond_device {
+	/** Network device */
+	struct net_device *netdev;
+	/** Members */
+	struct bond_member members[BOND_MAX_MEMBERS];
+	/** Number of members */
+	unsigned int count;
+	/** Members currently available for transmission */
+	struct bond_member *active[BOND_MAX_MEMBERS];
+	/** Number of members currently available for transmission */
+	unsigned int num_active;
+	/** LACP periodic timer */
+	struct retry_timer timer;
+};
+
+/** LACP actor key used for all bonded device members */
+#define BOND_LACP_KEY 1
+
+/** Slow protocols multicast address */
+static const uint8_t bond_slow_address[ETH_ALEN] =
+	{ 0x01, 0x80, 0xc2, 0x00, 0x00, 0x02 };
+
+static struct net_device_operations bond_operations;
+
+/**
+ * Check if LACP partner information is current
+ *
+ * @v member		Bonded device member
+ * @ret is_current	Partner information is current
+ */
+static int bond_partner_current ( struct bond_member *member ) {
+	unsigned long timeout;
+
+	/* Fail if no partner information has been received */
+	if ( ! member->updated )
+		return 0;
+
+	/* Partner information expires after three missed packets */
+	timeout = ( ( member->partner.state & LACP_STATE_FAST ) ?
+		    ( 3 * LACP_INTERVAL_FAST * TICKS_PER_SEC ) :
+		    ( 3 * LACP_INTERVAL_SLOW * TICKS_PER_SEC ) );
+	return ( ( currticks() - member->updated ) < timeout );
+}
+
+/**
+ * Transmit LACP packet on bonded device member
+ *
+ * @v bond		Bonded device
+ * @v member		Bonded device member
+ * @ret rc		Return status code
+ */
+static int bond_lacp_tx ( struct bond_device *bond,
+			  struct bond_member *member ) {
+	struct net_device *netdev = member->netdev;
+	struct io_buffer *iobuf;
+	struct eth_slow_lacp *lacp;
+
+	/* Allocate I/O buffer */
+	iobuf = alloc_iob ( MAX_LL_HEADER_LEN + sizeof ( *lacp ) );
+	if ( ! iobuf )
+		return -ENOMEM;
+	iob_reserve ( iobuf, MAX_LL_HEADER_LEN );
+	lacp = iob_put ( iobuf, sizeof ( *lacp ) );
+	memset ( lacp, 0, sizeof ( *lacp ) );
+
+	/* Construct LACP packet */
+	lacp->header.subtype = ETH_SLOW_SUBTYPE_LACP;
+	lacp->header.version = ETH_SLOW_LACP_VERSION;
+	lacp->actor.tlv.type = ETH_SLOW_TLV_LACP_ACTOR;
+	lacp->actor.tlv.length = ETH_SLOW_TLV_LACP_ACTOR_LEN;
+	lacp->actor.system_priority = htons ( LACP_SYSTEM_PRIORITY_MAX );
+	memcpy ( lacp->actor.system, bond->netdev->ll_addr,
+		 sizeof ( lacp->actor.system ) );
+	lacp->actor.key = htons ( BOND_LACP_KEY );
+	lacp->actor.port_priority = htons ( LACP_PORT_PRIORITY_MAX );
+	lacp->actor.port = htons ( ( member - bond->members ) + 1 );
+	lacp->actor.state = member->state;
+	if ( bond_partner_current ( member ) ) {
+		memcpy ( &lacp->partner, &member->partner,
+			 sizeof ( lacp->partner ) );
+	} else {
+		lacp->actor.state |= LACP_STATE_DEFAULTED;
+	}
+	lacp->partner.tlv.type = ETH_SLOW_TLV_LACP_PARTNER;
+	lacp->partner.tlv.length = ETH_SLOW_TLV_LACP_PARTNER_LEN;
+	lacp->collector.tlv.type = ETH_SLOW_TLV_LACP_COLLECTOR;
+	lacp->collector.tlv.length = ETH_SLOW_TLV_LACP_COLLECTOR_LEN;
+
+	/* Transmit packet */
+	DBGC2 ( bond, "BOND %s member %s TX LACP state %02x\n",
+		bond->netdev->name, netdev->name, lacp->actor.state );
+	member->idle = 0;
+	return net_tx ( iobuf, netdev, &eth_slow_protocol, bond_slow_address,
+			netdev->ll_addr );
+}
+
+/**
+ * Update bonded device state
+ *
+ * @v bond		Bonded device
+ */
+static void bond_update ( struct bond_device *bond ) {
+	struct net_device *netdev = bond->netdev;
+	struct eth_slow_lacp_entity_tlv *aggregator = NULL;
+	struct bond_member *member;
+	struct bond_member *fallback = NULL;
+	uint8_t state;
+	unsigned int i;
+	int rc;
+
+	/* Select the partner with which to aggregate links.  All
+	 * members attached to the same partner system and key are
+	 * aggregated; any other members are left idle.
+	 */
+	bond->num_active = 0;
+	for ( i = 0 ; i < bond->count ; i++ ) {
+		member = &bond->members[i];
+
+		/* Record first usable member as a fallback */
+		if ( netdev_link_ok ( member->netdev ) && ! fallback )
+			fallback = member;
+
+		/* Calculate actor state */
+		state = ( LACP_STATE_ACTIVE | LACP_STATE_FAST |
+			  LACP_STATE_AGGREGATABLE );
+		if ( netdev_link_ok ( member->netdev ) &&
+		     bond_partner_current ( member ) &&
+		     ( member->partner.state & LACP_STATE_AGGREGATABLE ) ) {
+			if ( ! aggregator )
+				aggregator = &member->partner;
+			if ( ( memcmp ( member->partner.system,
+					aggregator->system,
+					sizeof ( aggregator->system ) ) == 0 ) &&
+			     ( member->partner.key == aggregator->key ) ) {
+				state |= LACP_STATE_IN_SYNC;
+				if ( member->partner.state &
+				     LACP_STATE_IN_SYNC ) {
+					state |= ( LACP_STATE_COLLECTING |
+						   LACP_STATE_DISTRIBUTING );
+				}
+			}
+		}
+
+		/* Notify partner of any state change */
+		if ( state != member->state ) {
+			DBGC ( bond, "BOND %s member %s state %02x->%02x\n",
+			       netdev->name, member->netdev->name,
+			       member->state, state );
+			member->state = state;
+			if ( netdev_is_open ( member->netdev ) )
+				bond_lacp_tx ( bond, member );
+		}
+
+		/* Use member for transmission if both ends are ready */
+		if ( ( state & LACP_STATE_DISTRIBUTING ) &&
+		     ( member->partner.state & LACP_STATE_COLLECTING ) ) {
+			bond->active[ bond->num_active++ ] = member;
+		}
+	}
+
+	/* Fall back to an individual link if there is no LACP partner */
+	if ( ( ! aggregator ) && fallback )
+		bond->active[ bond->num_active++ ] = fallback;
+
+	/* Update link state */
+	rc = ( bond->num_active ? 0 : -ENOTCONN );
+	if ( netdev->link_rc != rc )
+		netdev_link_err ( netdev, rc );
+}
+
+/**
+ * Process received LACP packet
+ *
+ * @v bond		Bonded device
+ * @v member		Bonded device member
+ * @v iobuf		I/O buffer
+ * @ret rc		Return status code
+ */
+static int bond_lacp_rx ( struct bond_device *bond,
+			  struct bond_member *member,
+			  struct io_buffer *iobuf ) {
+	struct eth_slow_lacp *lacp = iobuf->data;
+	int changed;
+	int rc;
+
+	/* Sanity check */
+	if ( iob_len ( iobuf ) < sizeof ( *lacp ) ) {
+		rc = -EINVAL;
+		goto done;
+	}
+
+	/* Record partner information */
+	changed = ( memcmp ( &member->partner, &lacp->actor,
+			     sizeof ( member->partner ) ) != 0 );
+	memcpy ( &member->partner, &lacp->actor, sizeof ( member->partner ) );
+	memcpy ( &member->seen, &lacp->partner, sizeof ( member->seen ) );
+	member->updated = currticks();
+	if ( changed ) {
+		DBGC ( bond, "BOND %s member %s partner %s key %04x port "
+		       "%04x state %02x\n", bond->netdev->name,
+		       member->netdev->name,
+		       eth_ntoa ( member->partner.system ),
+		       ntohs ( member->partner.key ),
+		       ntohs ( member->partner.port ),
+		       member->partner.state );
+	}
+
+	/* Update state (which will transmit a response if our own
+	 * state has changed).
+	 */
+	bond_update ( bond );
+
+	/* Respond immediately if partner's view of us is out of date */
+	if ( ( member->seen.state != member->state ) ||
+	     ( member->seen.port !=
+	       htons ( ( member - bond->members ) + 1 ) ) ||
+	     ( memcmp ( member->seen.system, bond->netdev->ll_addr,
+			sizeof ( member->seen.system ) ) != 0 ) ) {
+		if ( member->idle )
+			bond_lacp_tx ( bond, member );
+	}
+
+	rc = 0;
+ done:
+	free_iob ( iobuf );
+	return rc;
+}
+
+/**
+ * Handle LACP periodic timer expiry
+ *
+ * @v timer		Periodic timer
+ * @v fail		Failure indicator
+ */
+static void bond_expired ( struct retry_timer *timer, int fail __unused ) {
+	struct bond_device *bond =
+		container_of ( timer, struct bond_device, timer );
+	struct bond_member *member;
+	unsigned int interval;
+	unsigned int i;
+
+	/* Restart timer */
+	start_timer_fixed ( &bond->timer,
+			    ( LACP_INTERVAL_FAST * TICKS_PER_SEC ) );
+
+	/* Expire any stale partner information */
+	bond_update ( bond );
+
+	/* Transmit periodic LACP packets at the partner's requested
+	 * rate, or at the fast rate if we have no partner.
+	 */
+	for ( i = 0 ; i < bond->count ; i++ ) {
+		member = &bond->members[i];
+		interval = ( ( bond_partner_current ( member ) &&
+			       ! ( member->partner.state & LACP_STATE_FAST ) ) ?
+			     LACP_INTERVAL_SLOW : LACP_INTERVAL_FAST );
+		if ( ( ++member->idle >= interval ) &&
+		     netdev_link_ok ( member->netdev ) ) {
+			bond_lacp_tx ( bond, member );
+		}
+	}
+}
+
+/**
+ * Accumulate data into flow hash
+ *
+ * @v hash		Flow hash
+ * @v data		Data
+ * @v len		Length of data
+ * @ret hash		Updated flow hash
+ */
+static uint32_t bond_hash_add ( uint32_t hash, const void *data, size_t len ) {
+	const uint8_t *bytes = data;
+
+	while ( len-- )
+		hash = ( ( hash * 31 ) + *(bytes++) );
+	return hash;
+}
+
+/**
+ * Calculate flow hash for transmitted packet
+ *
+ * @v iobuf		I/O buffer
+ * @ret hash		Flow hash
+ *
+ * Packets belonging to the same flow will always produce the same
+ * hash value, and so will always be transmitted on the same member.
+ */
+static unsigned int bond_hash ( struct io_buffer *iobuf ) {
+	struct ethhdr *ethhdr = iobuf->data;
+	const uint8_t *data = iobuf->data;
+	size_t len = iob_len ( iobuf );
+	size_t offset = sizeof ( *ethhdr );
+	const struct iphdr *iphdr;
+	const struct ipv6_header *ip6hdr;
+	unsigned int protocol = 0;
+	uint32_t hash;
+
+	/* Start with the link-layer addresses */
+	hash = bond_hash_add ( 0, ethhdr->h_dest, ETH_ALEN );
+	hash = bond_hash_add ( hash, ethhdr->h_source, ETH_ALEN );
+
+	/* Include network-layer addresses, where available */
+	if ( ( ethhdr->h_protocol == htons ( ETH_P_IP ) ) &&
+	     ( len >= ( offset + sizeof ( *iphdr ) ) ) ) {
+		iphdr = ( ( const void * ) ( data + offset ) );
+		hash = bond_hash_add ( hash, &iphdr->src,
+				       ( sizeof ( iphdr->src ) +
+					 sizeof ( iphdr->dest ) ) );
+		offset += ( ( iphdr->verhdrlen & IP_MASK_HLEN ) * 4 );
+		if ( ! ( iphdr->frags & htons ( IP_MASK_MOREFRAGS |
+						IP_MASK_OFFSET ) ) )
+			protocol = iphdr->protocol;
+	} else if ( ( ethhdr->h_protocol == htons ( ETH_P_IPV6 ) ) &&
+		    ( len >= ( offset + sizeof ( *ip6hdr ) ) ) ) {
+		ip6hdr = ( ( const void * ) ( data + offset ) );
+		hash = bond_hash_add ( hash, &ip6hdr->src,
+				       ( sizeof ( ip6hdr->src ) +
+					 sizeof ( ip6hdr->dest ) ) );
+		offset += sizeof ( *ip6hdr );
+		protocol = ip6hdr->next_header;
+	}
+
+	/* Include transport-layer ports, where available */
+	if ( ( ( protocol == IP_TCP ) || ( protocol == IP_UDP ) ) &&
+	     ( len >= ( offset + ( 2 * sizeof ( uint16_t ) ) ) ) ) {
+		hash = bond_hash_add ( hash, ( data + offset ),
+				       ( 2 * sizeof ( uint16_t ) ) );
+	}
+
+	/* Fold hash */
+	hash ^= ( hash >> 16 );
+	hash ^= ( hash >> 8 );
+	return hash;
+}
+
+/**
+ * Open bonded device
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ */
+static int bond_open ( struct net_device *netdev ) {
+	struct bond_device *bond = netdev->priv;
+	struct bond_member *member;
+	unsigned int i;
+	int rc;
+
+	/* Open all members and take over their receive queues */
+	for ( i = 0 ; i < bond->count ; i++ ) {
+		member = &bond->members[i];
+		if ( ( rc = netdev_open ( member->netdev ) ) != 0 ) {
+			DBGC ( bond, "BOND %s could not open %s: %s\n",
+			       netdev->name, member->netdev->name,
+			       strerror ( rc ) );
+			goto err_open;
+		}
+		netdev_rx_freeze ( member->netdev );
+		member->state = 0;
+		member->updated = 0;
+		member->idle = 0;
+	}
+
+	/* Start LACP */
+	start_timer_nodelay ( &bond->timer );
+	bond_update ( bond );
+
+	return 0;
+
+ err_open:
+	while ( i-- ) {
+		member = &bond->members[i];
+		netdev_rx_unfreeze ( member->netdev );
+		netdev_close ( member->netdev );
+	}
+	return rc;
+}
+
+/**
+ * Close bonded device
+ *
+ * @v netdev		Network device
+ */
+static void bond_close ( struct net_device *netdev ) {
+	struct bond_device *bond = netdev->priv;
+	struct bond_member *member;
+	struct io_buffer *iobuf;
+	unsigned int i;
+
+	/* Stop LACP */
+	stop_timer ( &bond->timer );
+
+	/* Release and close all members */
+	for ( i = 0 ; i < bond->count ; i++ ) {
+		member = &bond->members[i];
+		while ( ( iobuf = netdev_rx_dequeue ( member->netdev ) ) )
+			free_iob ( iobuf );
+		netdev_rx_unfreeze ( member->netdev );
+		netdev_close ( member->netdev );
+	}
+	bond->num_active = 0;
+}
+
+/**
+ * Transmit packet on bonded device
+ *
+ * @v netdev		Network device
+ * @v iobuf		I/O buffer
+ * @ret rc		Return status code
+ */
+static int bond_transmit ( struct net_device *netdev,
+			   struct io_buffer *iobuf ) {
+	struct bond_device *bond = netdev->priv;
+	struct bond_member *member;
+	int rc;
+
+	/* Select member */
+	if ( ! bond->num_active )
+		return -ENETUNREACH;
+	member = bond->active[ bond_hash ( iobuf ) % bond->num_active ];
+
+	/* Reclaim I/O buffer from bonded device's TX queue */
+	list_del ( &iobuf->list );
+
+	/* Transmit packet on member device */
+	if ( ( rc = netdev_tx ( member->netdev, iob_disown ( iobuf ) ) ) != 0){
+		DBGC ( bond, "BOND %s could not transmit via %s: %s\n",
+		       netdev->name, member->netdev->name, strerror ( rc ) );
+		/* Cannot return an error status, since that would
+		 * cause the I/O buffer to be double-freed.
+		 */
+		return 0;
+	}
+
+	return 0;
+}
+
+/**
+ * Poll bonded device
+ *
+ * @v netdev		Network device
+ */
+static void bond_poll ( struct net_device *netdev ) {
+	struct bond_device *bond = netdev->priv;
+	struct bond_member *member;
+	struct io_buffer *iobuf;
+	struct ethhdr *ethhdr;
+	struct eth_slow_header *slow;
+	unsigned int i;
+
+	for ( i = 0 ; i < bond->count ; i++ ) {
+		member = &bond->members[i];
+
+		/* Poll member device */
+		netdev_poll ( member->netdev );
+
+		/* Process received packets */
+		while ( ( iobuf = netdev_rx_dequeue ( member->netdev ) ) ) {
+
+			/* Intercept LACP packets */
+			ethhdr = iobuf->data;
+			if ( ( iob_len ( iobuf ) >= ( sizeof ( *ethhdr ) +
+						      sizeof ( *slow ) ) ) &&
+			     ( ethhdr->h_protocol == htons ( ETH_P_SLOW ) ) ) {
+				slow = ( ( void * ) ( ethhdr + 1 ) );
+				if ( slow->subtype == ETH_SLOW_SUBTYPE_LACP ) {
+					iob_pull ( iobuf, sizeof ( *ethhdr ) );
+					bond_lacp_rx ( bond, member, iobuf );
+					continue;
+				}
+			}
+
+			/* Pass all other packets to the bonded device */
+			netdev_rx ( netdev, iobuf );
+		}
+	}
+}
+
+/**
+ * Enable/disable interrupts on bonded device
+ *
+ * @v netdev		Network device
+ * @v enable		Interrupts should be enabled
+ */
+static void bond_irq ( struct net_device *netdev, int enable ) {
+	struct bond_device *bond = netdev->priv;
+	unsigned int i;
+
+	for ( i = 0 ; i < bond->count ; i++ )
+		netdev_irq ( bond->members[i].netdev, enable );
+}
+
+/** Bonded device operations */
+static struct net_device_operations bond_operations = {
+	.open		= bond_open,
+	.close		= bond_close,
+	.transmit	= bond_transmit,
+	.poll		= bond_poll,
+	.irq		= bond_irq,
+};
+
+/**
+ * Find bonded device containing a given member
+ *
+ * @v member		Member network device
+ * @ret bond		Bonded device, or NULL
+ */
+static struct bond_device * bond_find ( struct net_device *member ) {
+	struct net_device *netdev;
+	struct bond_device *bond;
+	unsigned int i;
+
+	for_each_netdev ( netdev ) {
+		if ( netdev->op != &bond_operations )
+			continue;
+		bond = netdev->priv;
+		for ( i = 0 ; i < bond->count ; i++ ) {
+			if ( bond->members[i].netdev == member )
+				return bond;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Create bonded device
+ *
+ * @v members		Member network devices
+ * @v count		Number of member network devices
+ * @ret rc		Return status code
+ */
+int bond_create ( struct net_device **members, unsigned int count ) {
+	struct net_device *netdev;
+	struct bond_device *bond;
+	struct net_device *member;
+	unsigned int index;
+	unsigned int i;
+	unsigned int j;
+	int rc;
+
+	/* Sanity checks */
+	if ( ( count == 0 ) || ( count > BOND_MAX_MEMBERS ) ) {
+		rc = -EINVAL;
+		goto err_sanity;
+	}
+	for ( i = 0 ; i < count ; i++ ) {
+		member = members[i];
+		if ( member->ll_protocol != &ethernet_protocol ) {
+			DBGC ( member, "BOND cannot bond non-Ethernet device "
+			       "%s\n", member->name );
+			rc = -ENOTTY;
+			goto err_sanity;
+		}
+		if ( bond_find ( member ) ) {
+			DBGC ( member, "BOND %s is already bonded\n",
+			       member->name );
+			rc = -EBUSY;
+			goto err_sanity;
+		}
+		for ( j = 0 ; j < i ; j++ ) {
+			if ( members[j] == member ) {
+				rc = -EINVAL;
+				goto err_sanity;
+			}
+		}
+	}
+
+	/* Allocate and initialise structure */
+	netdev = alloc_etherdev ( sizeof ( *bond ) );
+	if ( ! netdev ) {
+		rc = -ENOMEM;
+		goto err_alloc_etherdev;
+	}
+	netdev_init ( netdev, &bond_operations );
+	netdev->dev = members[0]->dev;
+	memcpy ( netdev->hw_addr, members[0]->ll_addr, ETH_ALEN );
+	bond = netdev->priv;
+	bond->netdev = netdev;
+	timer_init ( &bond->timer, bond_expired, &netdev->refcnt );
+
+	/* Construct bonded device name */
+	for ( index = 0 ; ; index++ ) {
+		snprintf ( netdev->name, sizeof ( netdev->name ), "bond%d",
+			   index );
+		if ( ! find_netdev ( netdev->name ) )
+			break;
+	}
+
+	/* Attach members, sharing a single link-layer address */
+	for ( i = 0 ; i < count ; i++ ) {
+		member = members[i];
+		netdev_close ( member );
+		memcpy ( member->ll_addr, netdev->hw_addr, ETH_ALEN );
+		bond->members[i].netdev = netdev_get ( member );
+		if ( ! netdev_irq_supported ( member ) )
+			netdev->state |= NETDEV_IRQ_UNSUPPORTED;
+		if ( netdev->mtu > member->mtu )
+			netdev->mtu = member->mtu;
+		if ( netdev->max_pkt_len > member->max_pkt_len )
+			netdev->max_pkt_len = member->max_pkt_len;
+	}
+	bond->count = count;
+
+	/* Register bonded device */
+	if ( ( rc = register_netdev ( netdev ) ) != 0 ) {
+		DBGC ( bond, "BOND %s could not register: %s\n",
+		       netdev->name, strerror ( rc ) );
+		goto err_register;
+	}
+
+	/* Link is down until at least one member is usable */
+	netdev_link_err ( netdev, -ENOTCONN );
+
+	DBGC ( bond, "BOND %s created with %d members\n",
+	       netdev->name, bond->count );
+	return 0;
+
+	unregister_netdev ( netdev );
+ err_register:
+	for ( i = 0 ; i < bond->count ; i++ ) {
+		member = bond->members[i].netdev;
+		member->ll_protocol->init_addr ( member->hw_addr,
+						 member->ll_addr );
+		netdev_put ( member );
+	}
+	netdev_nullify ( netdev );
+	netdev_put ( netdev );
+ err_alloc_etherdev:
+ err_sanity:
+	return rc;
+}
+
+/**
+ * Destroy bonded device
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ */
+int bond_destroy ( struct net_device *netdev ) {
+	struct bond_device *bond = netdev->priv;
+	struct net_device *member;
+	unsigned int i;
+
+	/* Sanity check */
+	if ( netdev->op != &bond_operations ) {
+		DBGC ( netdev, "BOND %s cannot destroy non-bonded device\n",
+		       netdev->name );
+		return -ENOTTY;
+	}
+
+	DBGC ( bond, "BOND %s destroyed\n", netdev->name );
+
+	/* Remove bonded device */
+	unregister_netdev ( netdev );
+
+	/* Release members, restoring their own link-layer addresses */
+	for ( i = 0 ; i < bond->count ; i++ ) {
+		member = bond->members[i].netdev;
+		member->ll_protocol->init_addr ( member->hw_addr,
+						 member->ll_addr );
+		netdev_put ( member );
+	}
+	bond->count = 0;
+	netdev_nullify ( netdev );
+	netdev_put ( netdev );
+
+	return 0;
+}
+
+/**
+ * Handle member network device state change
+ *
+ * @v member		Member network device
+ */
+static void bond_notify ( struct net_device *member ) {
+	struct bond_device *bond;
+
+	bond = bond_find ( member );
+	if ( bond && netdev_is_open ( bond->netdev ) )
+		bond_update ( bond );
+}
+
+/**
+ * Destroy any bonded device containing a removed member
+ *
+ * @v member		Member network device
+ */
+static void bond_remove ( struct net_device *member ) {
+	struct bond_device *bond;
+
+	bond = bond_find ( member );
+	if ( bond )
+		bond_destroy ( bond->netdev );
+}
+
+/** Bonding driver */
+struct net_driver bond_driver __net_driver = {
+	.name = "Bond",
+	.notify = bond_notify,
+	.remove = bond_remove,
+};
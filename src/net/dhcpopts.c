@@ -267,7 +267,7 @@ static int resize_dhcp_option ( struct dhcp_options *options,
  *
  * @v options		DHCP option block
  * @v tag		DHCP option tag
- * @v data		New value for DHCP option
+ * @v data		New value for DHCP option, or NULL to delete option
  * @v len		Length of value, in bytes
  * @ret offset		Offset of DHCP option, or negative error
  *
@@ -288,7 +288,7 @@ static int set_dhcp_option ( struct dhcp_options *options, unsigned int tag,
 	struct dhcp_option *option;
 	unsigned int encap_tag = DHCP_ENCAPSULATOR ( tag );
 	size_t old_len = 0;
-	size_t new_len = ( len ? ( len + DHCP_OPTION_HEADER_LEN ) : 0 );
+	size_t new_len = ( data ? ( len + DHCP_OPTION_HEADER_LEN ) : 0 );
 	int rc;
 
 	/* Sanity check */
@@ -333,7 +333,7 @@ static int set_dhcp_option ( struct dhcp_options *options, unsigned int tag,
 		return rc;
 
 	/* Copy new data into option, if applicable */
-	if ( len ) {
+	if ( data ) {
 		option = dhcp_option ( options, offset );
 		option->tag = tag;
 		option->len = len;
@@ -375,7 +375,29 @@ int dhcpopt_store ( struct dhcp_options *options, unsigned int tag,
 		    const void *data, size_t len ) {
 	int offset;
 
-	offset = set_dhcp_option ( options, tag, data, len );
+	offset = set_dhcp_option ( options, tag, ( len ? data : NULL ), len );
+	if ( offset < 0 )
+		return offset;
+	return 0;
+}
+
+/**
+ * Store empty DHCP option
+ *
+ * @v options		DHCP option block
+ * @v tag		DHCP option tag
+ * @ret rc		Return status code
+ *
+ * Some DHCP options (such as Rapid Commit) convey information solely
+ * by their presence.  Such options cannot be created via
+ * dhcpopt_store(), since storing a zero-length value deletes the
+ * option.
+ */
+int dhcpopt_store_empty ( struct dhcp_options *options, unsigned int tag ) {
+	static const uint8_t empty[0];
+	int offset;
+
+	offset = set_dhcp_option ( options, tag, empty, 0 );
 	if ( offset < 0 )
 		return offset;
 	return 0;
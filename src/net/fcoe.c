@@ -149,6 +149,9 @@ static uint8_t default_fcf_mac[ETH_ALEN] =
 /** Delay between retrying FIP solicitations */
 #define FCOE_FIP_RETRY_DELAY ( TICKS_PER_SEC )
 
+/** Time allowed for further advertisements once an FCF has been found */
+#define FCOE_FIP_SELECT_DELAY ( TICKS_PER_SEC / 10 )
+
 /** Maximum number of missing discovery advertisements */
 #define FCOE_MAX_FIP_MISSING_KEEPALIVES 4
 
@@ -755,6 +758,18 @@ static int fcoe_fip_rx_advertisement ( struct fcoe_port *fcoe,
 		       ( FIP_A | FIP_S | FIP_F ) ) &&
 		     ( priority->priority < fcoe->priority ) ) {
 
+			/* Select an FCF shortly after the first
+			 * solicited advertisement arrives, rather
+			 * than waiting for the full solicitation
+			 * timeout, while still allowing time for
+			 * any higher-priority FCFs to respond.
+			 */
+			if ( ( fcoe->flags & FCOE_HAVE_NETWORK ) &&
+			     ! ( fcoe->flags & FCOE_HAVE_FIP_FCF ) ) {
+				start_timer_fixed ( &fcoe->timer,
+						    FCOE_FIP_SELECT_DELAY );
+			}
+
 			fcoe->flags |= FCOE_HAVE_FIP_FCF;
 			fcoe->priority = priority->priority;
 			if ( fka_adv_p->flags & FIP_NO_KEEPALIVE ) {
@@ -147,6 +147,12 @@ struct fc_els_prli_descriptor fcp_prli_descriptor __fc_els_prli_descriptor = {
  ******************************************************************************
  */
 
+/** Maximum number of concurrent exchanges used for a single SCSI command */
+#define FCP_MAX_SPLIT 8
+
+/** Minimum length of each part of a split SCSI command */
+#define FCP_MIN_SPLIT_LEN 16384
+
 /** An FCP device */
 struct fcp_device {
 	/** Reference count */
@@ -192,6 +198,19 @@ struct fcp_command {
 	size_t remaining;
 	/** Exchange ID */
 	uint16_t xchg_id;
+
+	/** Lead command
+	 *
+	 * Large READ and WRITE commands are split into several parts,
+	 * each using its own exchange.  Each part holds a reference
+	 * to the lead command, which owns the SCSI command interface.
+	 * A command that has not been split is its own lead command.
+	 */
+	struct fcp_command *lead;
+	/** Number of parts yet to complete (lead command only) */
+	unsigned int pending;
+	/** Aggregate SCSI response (lead command only) */
+	struct scsi_rsp response;
 };
 
 /**
@@ -273,6 +292,8 @@ static void fcpcmd_free ( struct refcnt *refcnt ) {
 	/* Remove from list of commands */
 	list_del ( &fcpcmd->list );
 	fcpdev_put ( fcpcmd->fcpdev );
+	if ( fcpcmd->lead != fcpcmd )
+		fcpcmd_put ( fcpcmd->lead );
 
 	/* Free command */
 	free ( fcpcmd );
@@ -286,6 +307,9 @@ static void fcpcmd_free ( struct refcnt *refcnt ) {
  */
 static void fcpcmd_close ( struct fcp_command *fcpcmd, int rc ) {
 	struct fcp_device *fcpdev = fcpcmd->fcpdev;
+	struct fcp_command *lead = fcpcmd->lead;
+	struct fcp_command *part;
+	struct fcp_command *tmp;
 
 	if ( rc != 0 ) {
 		DBGC ( fcpdev, "FCP %p xchg %04x closed: %s\n",
@@ -295,9 +319,29 @@ static void fcpcmd_close ( struct fcp_command *fcpcmd, int rc ) {
 	/* Stop sending */
 	fcpcmd_stop_send ( fcpcmd );
 
+	/* Mark lead command as no longer active */
+	if ( fcpcmd == lead )
+		fcpcmd->pending = 0;
+
 	/* Shut down interfaces */
 	intf_shutdown ( &fcpcmd->scsi, rc );
 	intf_shutdown ( &fcpcmd->xchg, rc );
+
+	/* A failure of any part is a failure of the whole command */
+	if ( fcpcmd != lead ) {
+		if ( ( rc != 0 ) && lead->pending )
+			fcpcmd_close ( lead, rc );
+		return;
+	}
+
+	/* Shut down any remaining parts */
+	list_for_each_entry_safe ( part, tmp, &fcpdev->fcpcmds, list ) {
+		if ( ( part->lead != fcpcmd ) || ( part == fcpcmd ) )
+			continue;
+		fcpcmd_get ( part );
+		fcpcmd_close ( part, rc );
+		fcpcmd_put ( part );
+	}
 }
 
 /**
@@ -541,6 +585,45 @@ static int fcpcmd_recv_xfer_rdy ( struct fcp_command *fcpcmd,
 	return rc;
 }
 
+/**
+ * Complete part of FCP command
+ *
+ * @v fcpcmd		FCP command
+ * @v response		SCSI response for this part
+ */
+static void fcpcmd_complete ( struct fcp_command *fcpcmd,
+			      struct scsi_rsp *response ) {
+	struct fcp_command *lead = fcpcmd->lead;
+
+	/* Record the first failure, or accumulate any residuals */
+	if ( lead->response.status == 0 ) {
+		if ( response->status != 0 ) {
+			memcpy ( &lead->response, response,
+				 sizeof ( lead->response ) );
+		} else {
+			lead->response.overrun += response->overrun;
+		}
+	}
+
+	/* Terminate this part's exchange */
+	fcpcmd_get ( lead );
+	if ( fcpcmd == lead ) {
+		fcpcmd_stop_send ( fcpcmd );
+		intf_shutdown ( &fcpcmd->xchg, 0 );
+	} else {
+		fcpcmd_close ( fcpcmd, 0 );
+	}
+
+	/* Send SCSI response and terminate command once all parts
+	 * have completed.
+	 */
+	if ( lead->pending && ( --lead->pending == 0 ) ) {
+		scsi_response ( &lead->scsi, &lead->response );
+		fcpcmd_close ( lead, 0 );
+	}
+	fcpcmd_put ( lead );
+}
+
 /**
  * Handle FCP response IU
  *
@@ -618,11 +701,8 @@ static int fcpcmd_recv_rsp ( struct fcp_command *fcpcmd,
 	 */
 	free_iob ( iob_disown ( iobuf ) );
 
-	/* Send SCSI response */
-	scsi_response ( &fcpcmd->scsi, &response );
-
-	/* Terminate command */
-	fcpcmd_close ( fcpcmd, 0 );
+	/* Complete this part of the command */
+	fcpcmd_complete ( fcpcmd, &response );
 
 	rc = 0;
  done:
@@ -729,6 +809,102 @@ static struct interface_descriptor fcpcmd_xchg_desc =
 static struct process_descriptor fcpcmd_process_desc =
 	PROC_DESC ( struct fcp_command, process, fcpcmd_step );
 
+/**
+ * Calculate number of exchanges to use for a SCSI command
+ *
+ * @v command		SCSI command
+ * @ret parts		Number of exchanges
+ *
+ * Large READ and WRITE commands are split into several exchanges, so
+ * that the target may work on several parts of the transfer
+ * concurrently.
+ */
+static unsigned int fcpcmd_split ( struct scsi_cmd *command ) {
+	union scsi_cdb cdb;
+	unsigned int parts;
+	unsigned int count;
+	unsigned int per_part;
+	uint64_t lba;
+	size_t len;
+
+	/* Identify block range, if applicable */
+	memcpy ( &cdb, &command->cdb, sizeof ( cdb ) );
+	if ( scsi_cdb_range ( &cdb, &lba, &count ) != 0 )
+		return 1;
+	len = ( command->data_in_len | command->data_out_len );
+	if ( ( count == 0 ) || ( len % count ) )
+		return 1;
+
+	/* Use as many exchanges as permitted, subject to the minimum
+	 * length for each part.
+	 */
+	parts = FCP_MAX_SPLIT;
+	if ( parts > ( len / FCP_MIN_SPLIT_LEN ) )
+		parts = ( len / FCP_MIN_SPLIT_LEN );
+	if ( parts > count )
+		parts = count;
+	if ( parts <= 1 )
+		return 1;
+
+	/* Recalculate number of parts to use equal-sized parts */
+	per_part = ( ( count + parts - 1 ) / parts );
+	return ( ( count + per_part - 1 ) / per_part );
+}
+
+/**
+ * Create FCP command exchange
+ *
+ * @v fcpdev		FCP device
+ * @v lead		Lead command, or NULL to create a lead command
+ * @v command		SCSI command
+ * @ret fcpcmd		FCP command
+ * @ret rc		Return status code
+ *
+ * On success, the caller inherits the reference to the new command.
+ */
+static int fcpcmd_create ( struct fcp_device *fcpdev,
+			   struct fcp_command *lead, struct scsi_cmd *command,
+			   struct fcp_command **fcpcmd ) {
+	int xchg_id;
+	int rc;
+
+	/* Allocate and initialise structure */
+	*fcpcmd = zalloc ( sizeof ( **fcpcmd ) );
+	if ( ! *fcpcmd )
+		return -ENOMEM;
+	ref_init ( &(*fcpcmd)->refcnt, fcpcmd_free );
+	intf_init ( &(*fcpcmd)->scsi, &fcpcmd_scsi_desc, &(*fcpcmd)->refcnt );
+	intf_init ( &(*fcpcmd)->xchg, &fcpcmd_xchg_desc, &(*fcpcmd)->refcnt );
+	process_init_stopped ( &(*fcpcmd)->process, &fcpcmd_process_desc,
+			       &(*fcpcmd)->refcnt );
+	(*fcpcmd)->fcpdev = fcpdev_get ( fcpdev );
+	(*fcpcmd)->lead = ( lead ? fcpcmd_get ( lead ) : *fcpcmd );
+	list_add_tail ( &(*fcpcmd)->list, &fcpdev->fcpcmds );
+	memcpy ( &(*fcpcmd)->command, command, sizeof ( (*fcpcmd)->command ) );
+
+	/* Create new exchange */
+	if ( ( xchg_id = fc_xchg_originate ( &(*fcpcmd)->xchg,
+					     fcpdev->user.ulp->peer->port,
+					     &fcpdev->user.ulp->peer->port_id,
+					     FC_TYPE_FCP ) ) < 0 ) {
+		rc = xchg_id;
+		DBGC ( fcpdev, "FCP %p could not create exchange: %s\n",
+		       fcpdev, strerror ( rc ) );
+		goto err_xchg_originate;
+	}
+	(*fcpcmd)->xchg_id = xchg_id;
+
+	/* Start sending command IU */
+	fcpcmd_start_send ( *fcpcmd, fcpcmd_send_cmnd );
+
+	return 0;
+
+ err_xchg_originate:
+	fcpcmd_close ( *fcpcmd, rc );
+	ref_put ( &(*fcpcmd)->refcnt );
+	return rc;
+}
+
 /**
  * Issue FCP SCSI command
  *
@@ -741,8 +917,17 @@ static int fcpdev_scsi_command ( struct fcp_device *fcpdev,
 				 struct interface *parent,
 				 struct scsi_cmd *command ) {
 	struct fcp_prli_service_parameters *param = fcpdev->user.ulp->param;
+	struct scsi_cmd part_command;
+	struct fcp_command *lead;
 	struct fcp_command *fcpcmd;
-	int xchg_id;
+	unsigned int parts;
+	unsigned int count;
+	unsigned int per_part;
+	unsigned int i;
+	uint64_t lba;
+	size_t blksize;
+	size_t offset;
+	size_t len;
 	int rc;
 
 	/* Check link */
@@ -762,50 +947,90 @@ static int fcpdev_scsi_command ( struct fcp_device *fcpdev,
 		goto err_target;
 	}
 
-	/* Allocate and initialise structure */
-	fcpcmd = zalloc ( sizeof ( *fcpcmd ) );
-	if ( ! fcpcmd ) {
-		rc = -ENOMEM;
-		goto err_zalloc;
+	/* Create lead command */
+	parts = fcpcmd_split ( command );
+	if ( parts == 1 ) {
+		if ( ( rc = fcpcmd_create ( fcpdev, NULL, command,
+					    &lead ) ) != 0 )
+			goto err_create;
+		lead->pending = 1;
+		goto done;
 	}
-	ref_init ( &fcpcmd->refcnt, fcpcmd_free );
-	intf_init ( &fcpcmd->scsi, &fcpcmd_scsi_desc, &fcpcmd->refcnt );
-	intf_init ( &fcpcmd->xchg, &fcpcmd_xchg_desc, &fcpcmd->refcnt );
-	process_init_stopped ( &fcpcmd->process, &fcpcmd_process_desc,
-			       &fcpcmd->refcnt );
-	fcpcmd->fcpdev = fcpdev_get ( fcpdev );
-	list_add ( &fcpcmd->list, &fcpdev->fcpcmds );
-	memcpy ( &fcpcmd->command, command, sizeof ( fcpcmd->command ) );
 
-	/* Create new exchange */
-	if ( ( xchg_id = fc_xchg_originate ( &fcpcmd->xchg,
-					     fcpdev->user.ulp->peer->port,
-					     &fcpdev->user.ulp->peer->port_id,
-					     FC_TYPE_FCP ) ) < 0 ) {
-		rc = xchg_id;
-		DBGC ( fcpdev, "FCP %p could not create exchange: %s\n",
-		       fcpdev, strerror ( rc ) );
-		goto err_xchg_originate;
+	/* Split command across concurrent exchanges */
+	scsi_cdb_range ( &command->cdb, &lba, &count );
+	blksize = ( ( command->data_in_len | command->data_out_len ) / count );
+	per_part = ( ( count + parts - 1 ) / parts );
+	DBGC2 ( fcpdev, "FCP %p splitting %d blocks into %d exchanges\n",
+		fcpdev, count, parts );
+	lead = NULL;
+	for ( offset = 0, i = 0 ; i < parts ; i++ ) {
+
+		/* Construct command for this part */
+		if ( per_part > count )
+			per_part = count;
+		len = ( per_part * blksize );
+		memcpy ( &part_command, command, sizeof ( part_command ) );
+		scsi_cdb_set_range ( &part_command.cdb, lba, per_part );
+		if ( command->data_in_len ) {
+			part_command.data_in =
+				userptr_add ( command->data_in, offset );
+			part_command.data_in_len = len;
+		}
+		if ( command->data_out_len ) {
+			part_command.data_out =
+				userptr_add ( command->data_out, offset );
+			part_command.data_out_len = len;
+		}
+		lba += per_part;
+		count -= per_part;
+		offset += len;
+
+		/* Create exchange for this part */
+		if ( ( rc = fcpcmd_create ( fcpdev, lead, &part_command,
+					    &fcpcmd ) ) != 0 )
+			goto err_create_part;
+		if ( lead ) {
+			ref_put ( &fcpcmd->refcnt );
+		} else {
+			lead = fcpcmd;
+			lead->pending = parts;
+		}
 	}
-	fcpcmd->xchg_id = xchg_id;
-
-	/* Start sending command IU */
-	fcpcmd_start_send ( fcpcmd, fcpcmd_send_cmnd );
 
+ done:
 	/* Attach to parent interface, mortalise self, and return */
-	intf_plug_plug ( &fcpcmd->scsi, parent );
-	ref_put ( &fcpcmd->refcnt );
-	return ( FCP_TAG_MAGIC | fcpcmd->xchg_id );
-
- err_xchg_originate:
-	fcpcmd_close ( fcpcmd, rc );
-	ref_put ( &fcpcmd->refcnt );
- err_zalloc:
+	intf_plug_plug ( &lead->scsi, parent );
+	ref_put ( &lead->refcnt );
+	return ( FCP_TAG_MAGIC | lead->xchg_id );
+
+ err_create_part:
+	if ( lead ) {
+		fcpcmd_close ( lead, rc );
+		ref_put ( &lead->refcnt );
+	}
+ err_create:
  err_target:
  err_link:
 	return rc;
 }
 
+/**
+ * Find first active FCP command
+ *
+ * @v fcpdev		FCP device
+ * @ret fcpcmd		Active lead command, or NULL
+ */
+static struct fcp_command * fcpdev_first_active ( struct fcp_device *fcpdev ) {
+	struct fcp_command *fcpcmd;
+
+	list_for_each_entry ( fcpcmd, &fcpdev->fcpcmds, list ) {
+		if ( ( fcpcmd->lead == fcpcmd ) && fcpcmd->pending )
+			return fcpcmd;
+	}
+	return NULL;
+}
+
 /**
  * Close FCP device
  *
@@ -814,15 +1039,17 @@ static int fcpdev_scsi_command ( struct fcp_device *fcpdev,
  */
 static void fcpdev_close ( struct fcp_device *fcpdev, int rc ) {
 	struct fcp_command *fcpcmd;
-	struct fcp_command *tmp;
 
 	DBGC ( fcpdev, "FCP %p closed: %s\n", fcpdev, strerror ( rc ) );
 
 	/* Shut down interfaces */
 	intf_shutdown ( &fcpdev->scsi, rc );
 
-	/* Shut down any active commands */
-	list_for_each_entry_safe ( fcpcmd, tmp, &fcpdev->fcpcmds, list ) {
+	/* Shut down any active commands.  Closing a lead command
+	 * closes (and may free) all of its parts, so restart the
+	 * search after each closure.
+	 */
+	while ( ( fcpcmd = fcpdev_first_active ( fcpdev ) ) ) {
 		fcpcmd_get ( fcpcmd );
 		fcpcmd_close ( fcpcmd, rc );
 		fcpcmd_put ( fcpcmd );
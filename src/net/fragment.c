@@ -26,6 +26,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <ipxe/retry.h>
 #include <ipxe/timer.h>
 #include <ipxe/ipstat.h>
@@ -37,6 +38,30 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  *
  */
 
+/**
+ * Free fragment reassembly buffer
+ *
+ * @v fragment		Fragment reassembly buffer
+ */
+static void fragment_free ( struct fragment *fragment ) {
+	struct fragment_reassembler *fragments = fragment->fragments;
+	struct fragment_part *part;
+	struct fragment_part *tmp;
+
+	/* Free all received fragments */
+	list_for_each_entry_safe ( part, tmp, &fragment->parts, list ) {
+		list_del ( &part->list );
+		fragments->used -= part->used;
+		free_iob ( part->iobuf );
+		free ( part );
+	}
+
+	/* Remove from list of fragment reassembly buffers */
+	stop_timer ( &fragment->timer );
+	list_del ( &fragment->list );
+	free ( fragment );
+}
+
 /**
  * Expire fragment reassembly buffer
  *
@@ -48,10 +73,8 @@ static void fragment_expired ( struct retry_timer *timer, int fail __unused ) {
 		container_of ( timer, struct fragment, timer );
 
 	DBGC ( fragment, "FRAG %p expired\n", fragment );
-	free_iob ( fragment->iobuf );
-	list_del ( &fragment->list );
 	fragment->fragments->stats->reasm_fails++;
-	free ( fragment );
+	fragment_free ( fragment );
 }
 
 /**
@@ -74,6 +97,98 @@ static struct fragment * fragment_find ( struct fragment_reassembler *fragments,
 	return NULL;
 }
 
+/**
+ * Discard fragment reassembly buffers to stay within memory limit
+ *
+ * @v fragments		Fragment reassembler
+ * @v fragment		Fragment reassembly buffer to preserve, or NULL
+ * @v used		Memory required for new fragment
+ * @ret rc		Return status code
+ */
+static int fragment_reclaim ( struct fragment_reassembler *fragments,
+			      struct fragment *fragment, size_t used ) {
+	struct fragment *victim;
+
+	/* Discard least recently started reassemblies first */
+	while ( ( fragments->used + used ) > FRAGMENT_MAX_USED ) {
+		list_for_each_entry_reverse ( victim, &fragments->list, list ) {
+			if ( victim != fragment )
+				break;
+		}
+		if ( &victim->list == &fragments->list )
+			break;
+		DBGC ( victim, "FRAG %p discarded to reclaim memory\n",
+		       victim );
+		fragments->stats->reasm_fails++;
+		fragments->stats->reasm_evictions++;
+		fragment_free ( victim );
+	}
+
+	return ( ( ( fragments->used + used ) <= FRAGMENT_MAX_USED ) ?
+		 0 : -ENOBUFS );
+}
+
+/**
+ * Construct reassembled packet
+ *
+ * @v fragment		Fragment reassembly buffer
+ * @v hdrlen		Length of non-fragmentable portion to fill in
+ * @ret iobuf		Reassembled packet, or NULL
+ *
+ * The received fragments are consumed (or freed) by this function.
+ */
+static struct io_buffer * fragment_complete ( struct fragment *fragment,
+					      size_t *hdrlen ) {
+	struct fragment_reassembler *fragments = fragment->fragments;
+	struct fragment_part *first;
+	struct fragment_part *part;
+	struct fragment_part *tmp;
+	struct io_buffer *iobuf;
+	size_t remaining;
+	size_t len;
+
+	/* Use the initial fragment as the basis for the reassembled
+	 * packet, extending it in place if there is sufficient
+	 * tailroom.  Otherwise, allocate a new buffer, preserving the
+	 * I/O buffer headroom to allow for code which modifies and
+	 * resends the buffer (e.g. ICMP echo responses).
+	 */
+	first = list_first_entry ( &fragment->parts, struct fragment_part,
+				   list );
+	iobuf = first->iobuf;
+	remaining = ( fragment->total - first->len );
+	if ( iob_tailroom ( iobuf ) < remaining ) {
+		len = ( iob_headroom ( iobuf ) + iob_len ( iobuf ) +
+			remaining );
+		iobuf = alloc_iob ( len );
+		if ( ! iobuf ) {
+			DBGC ( fragment, "FRAG %p could not allocate %zd-byte "
+			       "reassembly buffer\n", fragment, len );
+			return NULL;
+		}
+		iob_reserve ( iobuf, iob_headroom ( first->iobuf ) );
+		memcpy ( iob_put ( iobuf, iob_len ( first->iobuf ) ),
+			 first->iobuf->data, iob_len ( first->iobuf ) );
+		free_iob ( first->iobuf );
+	}
+	*hdrlen = first->hdrlen;
+	list_del ( &first->list );
+	fragments->used -= first->used;
+	free ( first );
+
+	/* Append remaining fragments in order of offset */
+	list_for_each_entry_safe ( part, tmp, &fragment->parts, list ) {
+		memcpy ( iob_put ( iobuf, part->len ),
+			 ( part->iobuf->data + part->hdrlen ), part->len );
+		list_del ( &part->list );
+		fragments->used -= part->used;
+		free_iob ( part->iobuf );
+		free ( part );
+	}
+
+	return iobuf;
+}
+
 /**
  * Reassemble packet
  *
@@ -84,92 +199,137 @@ static struct fragment * fragment_find ( struct fragment_reassembler *fragments,
  *
  * This function takes ownership of the I/O buffer.  Note that the
  * length of the non-fragmentable portion may be modified.
+ *
+ * Fragments may arrive in any order.  Exact duplicates of (or
+ * fragments wholly contained within) previously received fragments
+ * are silently discarded; any other overlap is treated as an error.
  */
 struct io_buffer * fragment_reassemble ( struct fragment_reassembler *fragments,
 					 struct io_buffer *iobuf,
 					 size_t *hdrlen ) {
 	struct fragment *fragment;
-	struct io_buffer *new_iobuf;
-	size_t new_len;
+	struct fragment_part *part;
+	struct fragment_part *next;
+	struct list_head *prev;
 	size_t offset;
-	size_t expected_offset;
+	size_t len;
+	size_t end;
+	size_t used;
+	size_t expected = 0;
 	int more_frags;
 
 	/* Update statistics */
 	fragments->stats->reasm_reqds++;
 
+	/* Parse fragment */
+	offset = fragments->fragment_offset ( iobuf, *hdrlen );
+	len = ( iob_len ( iobuf ) - *hdrlen );
+	end = ( offset + len );
+	more_frags = fragments->more_fragments ( iobuf, *hdrlen );
+	used = ( sizeof ( *part ) + ( iobuf->end - iobuf->head ) );
+
 	/* Find matching fragment reassembly buffer, if any */
 	fragment = fragment_find ( fragments, iobuf, *hdrlen );
+	DBGC ( fragment, "FRAG %p [%zd,%zd)%s\n", fragment, offset, end,
+	       ( more_frags ? "" : " final" ) );
 
-	/* Drop out-of-order fragments */
-	offset = fragments->fragment_offset ( iobuf, *hdrlen );
-	expected_offset = ( fragment ? ( iob_len ( fragment->iobuf ) -
-					 fragment->hdrlen ) : 0 );
-	if ( offset != expected_offset ) {
-		DBGC ( fragment, "FRAG %p dropping out-of-sequence fragment "
-		       "[%zd,%zd), expected [%zd,...)\n", fragment, offset,
-		       ( offset + iob_len ( iobuf ) - *hdrlen ),
-		       expected_offset );
+	/* Reject fragments lying outside the known packet length */
+	if ( fragment && fragment->total &&
+	     ( ( end > fragment->total ) ||
+	       ( ( ! more_frags ) && ( end != fragment->total ) ) ) ) {
+		DBGC ( fragment, "FRAG %p fragment [%zd,%zd) inconsistent "
+		       "with length %zd\n", fragment, offset, end,
+		       fragment->total );
 		goto drop;
 	}
 
-	/* Create or extend fragment reassembly buffer as applicable */
-	if ( ! fragment ) {
+	/* Locate insertion point, checking for overlaps */
+	prev = ( fragment ? &fragment->parts : NULL );
+	if ( fragment ) {
+		list_for_each_entry ( next, &fragment->parts, list ) {
+			if ( ( next->offset <= offset ) &&
+			     ( ( next->offset + next->len ) >= end ) ) {
+				DBGC ( fragment, "FRAG %p duplicate fragment "
+				       "[%zd,%zd)\n", fragment, offset, end );
+				fragments->stats->reasm_duplicates++;
+				free_iob ( iobuf );
+				return NULL;
+			}
+			if ( ( next->offset < end ) &&
+			     ( ( next->offset + next->len ) > offset ) ) {
+				DBGC ( fragment, "FRAG %p fragment [%zd,%zd) "
+				       "overlaps [%zd,%zd)\n", fragment,
+				       offset, end, next->offset,
+				       ( next->offset + next->len ) );
+				goto drop;
+			}
+			if ( next->offset > offset )
+				break;
+			prev = &next->list;
+			expected = ( next->offset + next->len );
+		}
+	}
 
-		/* Create new fragment reassembly buffer */
+	/* Reject final fragments which truncate already received data */
+	if ( fragment && ( ! more_frags ) &&
+	     ( prev->next != &fragment->parts ) ) {
+		DBGC ( fragment, "FRAG %p final fragment [%zd,%zd) precedes "
+		       "received data\n", fragment, offset, end );
+		goto drop;
+	}
+
+	/* Record fragments not immediately following the received data */
+	if ( ( offset != expected ) ||
+	     ( fragment && ( prev->next != &fragment->parts ) ) )
+		fragments->stats->reasm_reorders++;
+
+	/* Stay within memory limit */
+	if ( fragment_reclaim ( fragments, fragment, used ) != 0 ) {
+		DBGC ( fragment, "FRAG %p exceeded memory limit\n", fragment );
+		goto drop;
+	}
+
+	/* Create fragment reassembly buffer, if applicable */
+	if ( ! fragment ) {
 		fragment = zalloc ( sizeof ( *fragment ) );
 		if ( ! fragment )
 			goto drop;
 		list_add ( &fragment->list, &fragments->list );
 		fragment->iobuf = iobuf;
 		fragment->hdrlen = *hdrlen;
+		INIT_LIST_HEAD ( &fragment->parts );
 		timer_init ( &fragment->timer, fragment_expired, NULL );
 		fragment->fragments = fragments;
-		DBGC ( fragment, "FRAG %p [0,%zd)\n", fragment,
-		       ( iob_len ( iobuf ) - *hdrlen ) );
-
-	} else {
-
-		/* Check if this is the final fragment */
-		more_frags = fragments->more_fragments ( iobuf, *hdrlen );
-		DBGC ( fragment, "FRAG %p [%zd,%zd)%s\n", fragment,
-		       offset, ( offset + iob_len ( iobuf ) - *hdrlen ),
-		       ( more_frags ? "" : " complete" ) );
-
-		/* Extend fragment reassembly buffer.  Preserve I/O
-		 * buffer headroom to allow for code which modifies
-		 * and resends the buffer (e.g. ICMP echo responses).
-		 */
-		iob_pull ( iobuf, *hdrlen );
-		new_len = ( iob_headroom ( fragment->iobuf ) +
-			    iob_len ( fragment->iobuf ) + iob_len ( iobuf ) );
-		new_iobuf = alloc_iob ( new_len );
-		if ( ! new_iobuf ) {
-			DBGC ( fragment, "FRAG %p could not extend reassembly "
-			       "buffer to %zd bytes\n", fragment, new_len );
-			goto drop;
-		}
-		iob_reserve ( new_iobuf, iob_headroom ( fragment->iobuf ) );
-		memcpy ( iob_put ( new_iobuf, iob_len ( fragment->iobuf ) ),
-			 fragment->iobuf->data, iob_len ( fragment->iobuf ) );
-		memcpy ( iob_put ( new_iobuf, iob_len ( iobuf ) ),
-			 iobuf->data, iob_len ( iobuf ) );
-		free_iob ( fragment->iobuf );
-		fragment->iobuf = new_iobuf;
-		free_iob ( iobuf );
-
-		/* Stop fragment reassembly timer */
-		stop_timer ( &fragment->timer );
-
-		/* If this is the final fragment, return it */
-		if ( ! more_frags ) {
-			iobuf = fragment->iobuf;
-			*hdrlen = fragment->hdrlen;
-			list_del ( &fragment->list );
-			free ( fragment );
-			fragments->stats->reasm_oks++;
-			return iobuf;
+		prev = &fragment->parts;
+	}
+
+	/* Record received fragment */
+	part = malloc ( sizeof ( *part ) );
+	if ( ! part )
+		goto drop_fragment;
+	part->iobuf = iobuf;
+	part->hdrlen = *hdrlen;
+	part->offset = offset;
+	part->len = len;
+	part->used = used;
+	list_add ( &part->list, prev );
+	fragments->used += used;
+	fragment->len += len;
+	if ( ! more_frags )
+		fragment->total = end;
+
+	/* If all fragments have been received, return reassembled packet */
+	if ( fragment->total && ( fragment->len == fragment->total ) ) {
+		DBGC ( fragment, "FRAG %p complete [0,%zd)\n",
+		       fragment, fragment->total );
+		iobuf = fragment_complete ( fragment, hdrlen );
+		fragment_free ( fragment );
+		if ( ! iobuf ) {
+			fragments->stats->reasm_fails++;
+			return NULL;
 		}
+		fragments->stats->reasm_oks++;
+		return iobuf;
 	}
 
 	/* (Re)start fragment reassembly timer */
@@ -177,6 +337,9 @@ struct io_buffer * fragment_reassemble ( struct fragment_reassembler *fragments,
 
 	return NULL;
 
+ drop_fragment:
+	if ( list_empty ( &fragment->parts ) )
+		fragment_free ( fragment );
  drop:
 	fragments->stats->reasm_fails++;
 	free_iob ( iobuf );
@@ -25,9 +25,12 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 #include <string.h>
 #include <errno.h>
+#include <byteswap.h>
 #include <ipxe/iobuf.h>
 #include <ipxe/in.h>
+#include <ipxe/ip.h>
 #include <ipxe/tcpip.h>
+#include <ipxe/pmtu.h>
 #include <ipxe/icmp.h>
 
 /** @file
@@ -38,6 +41,49 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 struct icmp_echo_protocol icmpv4_echo_protocol __icmp_echo_protocol;
 
+/**
+ * Process received ICMP destination unreachable packet
+ *
+ * @v iobuf		I/O buffer
+ * @ret rc		Return status code
+ */
+static int icmpv4_rx_unreachable ( struct io_buffer *iobuf ) {
+	struct icmp_unreachable *unreach = iobuf->data;
+	size_t len = iob_len ( iobuf );
+	struct sockaddr_in sin_dest;
+	struct iphdr *iphdr;
+	size_t mtu;
+
+	/* Ignore anything other than "fragmentation needed" */
+	if ( unreach->icmp.code != ICMP_FRAGMENTATION_NEEDED )
+		return 0;
+
+	/* Sanity check */
+	if ( len < ( sizeof ( *unreach ) + sizeof ( *iphdr ) ) ) {
+		DBG ( "ICMP fragmentation needed too short at %zd bytes\n",
+		      len );
+		return -EINVAL;
+	}
+	iphdr = ( ( struct iphdr * ) unreach->data );
+	if ( ( iphdr->verhdrlen & IP_MASK_VER ) != IP_VER ) {
+		DBG ( "ICMP fragmentation needed for non-IPv4 datagram\n" );
+		return -EINVAL;
+	}
+
+	/* Record path MTU.  Routers predating RFC 1191 do not report
+	 * a next-hop MTU, in which case we fall back to the minimum.
+	 */
+	mtu = ntohs ( unreach->mtu );
+	memset ( &sin_dest, 0, sizeof ( sin_dest ) );
+	sin_dest.sin_family = AF_INET;
+	sin_dest.sin_addr = iphdr->dest;
+	DBG ( "ICMP fragmentation needed for %s (MTU %zd)\n",
+	      inet_ntoa ( iphdr->dest ), mtu );
+	pmtu_update ( ( struct sockaddr_tcpip * ) &sin_dest, mtu );
+
+	return 0;
+}
+
 /**
  * Process a received packet
  *
@@ -85,6 +131,9 @@ static int icmpv4_rx ( struct io_buffer *iobuf,
 					      &icmpv4_echo_protocol );
 	case ICMP_ECHO_REPLY:
 		return icmp_rx_echo_reply ( iobuf, st_src );
+	case ICMP_DESTINATION_UNREACHABLE:
+		rc = icmpv4_rx_unreachable ( iobuf );
+		break;
 	default:
 		DBG ( "ICMP ignoring type %d\n", type );
 		rc = 0;
@@ -919,7 +919,7 @@ static void ib_step ( struct process *process __unused ) {
 }
 
 /** Infiniband event queue process */
-PERMANENT_PROCESS ( ib_process, ib_step );
+PERMANENT_PROCESS_PRIORITY ( ib_process, ib_step, PROCESS_PRIORITY_HIGH );
 
 /***************************************************************************
  *
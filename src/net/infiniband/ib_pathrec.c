@@ -28,6 +28,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <string.h>
 #include <byteswap.h>
 #include <errno.h>
+#include <ipxe/timer.h>
 #include <ipxe/infiniband.h>
 #include <ipxe/ib_mi.h>
 #include <ipxe/ib_pathrec.h>
@@ -160,24 +161,44 @@ void ib_destroy_path ( struct ib_device *ibdev, struct ib_path *path ) {
 	free ( path );
 }
 
-/** Number of path cache entries
+/** Number of path cache entries */
+#define IB_NUM_CACHED_PATHS 16
+
+/** Path cache entry lifetime
+ *
+ * A resolved path continues to be used beyond this time, while a
+ * fresh lookup is performed in the background.
+ */
+#define IB_PATH_CACHE_TIMEOUT ( 5 * 60 * TICKS_PER_SEC )
+
+/** Path cache failed lookup holdoff time
  *
- * Must be a power of two.
+ * A failed lookup is not retried until this time has elapsed, to
+ * avoid flooding the subnet administrator with repeated queries.
  */
-#define IB_NUM_CACHED_PATHS 4
+#define IB_PATH_CACHE_HOLDOFF ( 2 * TICKS_PER_SEC )
 
 /** A cached path */
 struct ib_cached_path {
-	/** Path */
+	/** Infiniband device, or NULL if entry is unused */
+	struct ib_device *ibdev;
+	/** Resolved address vector */
+	struct ib_address_vector av;
+	/** Address vector has been resolved */
+	int resolved;
+	/** Status of most recent lookup */
+	int rc;
+	/** Expiry time (or retry time, if most recent lookup failed) */
+	unsigned long expires;
+	/** Time of most recent use */
+	unsigned long used;
+	/** Lookup in progress, if any */
 	struct ib_path *path;
 };
 
 /** Path cache */
 static struct ib_cached_path ib_path_cache[IB_NUM_CACHED_PATHS];
 
-/** Oldest path cache entry index */
-static unsigned int ib_path_cache_idx;
-
 /**
  * Find path cache entry
  *
@@ -192,12 +213,10 @@ ib_find_path_cache_entry ( struct ib_device *ibdev, union ib_gid *dgid ) {
 
 	for ( i = 0 ; i < IB_NUM_CACHED_PATHS ; i++ ) {
 		cached = &ib_path_cache[i];
-		if ( ! cached->path )
-			continue;
-		if ( cached->path->ibdev != ibdev )
+		if ( cached->ibdev != ibdev )
 			continue;
-		if ( memcmp ( &cached->path->av.gid, dgid,
-			      sizeof ( cached->path->av.gid ) ) != 0 )
+		if ( memcmp ( &cached->av.gid, dgid,
+			      sizeof ( cached->av.gid ) ) != 0 )
 			continue;
 		return cached;
 	}
@@ -205,6 +224,54 @@ ib_find_path_cache_entry ( struct ib_device *ibdev, union ib_gid *dgid ) {
 	return NULL;
 }
 
+/**
+ * Allocate path cache entry
+ *
+ * @v ibdev		Infiniband device
+ * @v av		Address vector
+ * @ret cached		Path cache entry
+ *
+ * An unused entry is chosen if possible, otherwise the least recently
+ * used entry is evicted (preferring an entry with no lookup in
+ * progress).
+ */
+static struct ib_cached_path *
+ib_alloc_path_cache_entry ( struct ib_device *ibdev,
+			    struct ib_address_vector *av ) {
+	struct ib_cached_path *cached;
+	struct ib_cached_path *victim = NULL;
+	unsigned long now = currticks();
+	unsigned int i;
+
+	/* Find an unused or least recently used entry */
+	for ( i = 0 ; i < IB_NUM_CACHED_PATHS ; i++ ) {
+		cached = &ib_path_cache[i];
+		if ( ! cached->ibdev ) {
+			victim = cached;
+			break;
+		}
+		if ( ( ! victim ) ||
+		     ( ( victim->path != NULL ) > ( cached->path != NULL ) ) ||
+		     ( ( ( victim->path != NULL ) ==
+			 ( cached->path != NULL ) ) &&
+		       ( ( now - cached->used ) > ( now - victim->used ) ) ) ) {
+			victim = cached;
+		}
+	}
+
+	/* Destroy the old cache entry */
+	if ( victim->path )
+		ib_destroy_path ( victim->ibdev, victim->path );
+	memset ( victim, 0, sizeof ( *victim ) );
+
+	/* Initialise new entry */
+	victim->ibdev = ibdev;
+	memcpy ( &victim->av, av, sizeof ( victim->av ) );
+	victim->used = now;
+
+	return victim;
+}
+
 /**
  * Handle cached path transaction completion
  *
@@ -215,20 +282,30 @@ ib_find_path_cache_entry ( struct ib_device *ibdev, union ib_gid *dgid ) {
  */
 static void ib_cached_path_complete ( struct ib_device *ibdev,
 				      struct ib_path *path, int rc,
-				      struct ib_address_vector *av __unused ) {
+				      struct ib_address_vector *av ) {
 	struct ib_cached_path *cached = ib_path_get_ownerdata ( path );
+	unsigned long now = currticks();
+
+	/* Destroy the completed transaction */
+	ib_destroy_path ( ibdev, path );
+	cached->path = NULL;
+	cached->rc = rc;
 
-	/* If the transaction failed, erase the cache entry */
+	/* Hold off before retrying a failed lookup.  Any previously
+	 * resolved path remains in use in the meantime.
+	 */
 	if ( rc != 0 ) {
-		/* Destroy the old cache entry */
-		ib_destroy_path ( ibdev, path );
-		memset ( cached, 0, sizeof ( *cached ) );
+		cached->expires = ( now + IB_PATH_CACHE_HOLDOFF );
 		return;
 	}
 
-	/* Do not destroy the completed transaction; we still need to
-	 * refer to the resolved path.
-	 */
+	/* Record resolved path */
+	cached->av.lid = av->lid;
+	cached->av.rate = av->rate;
+	cached->av.sl = av->sl;
+	cached->av.gid_present = av->gid_present;
+	cached->resolved = 1;
+	cached->expires = ( now + IB_PATH_CACHE_TIMEOUT );
 }
 
 /** Cached path transaction completion operations */
@@ -236,6 +313,28 @@ static struct ib_path_operations ib_cached_path_op = {
 	.complete = ib_cached_path_complete,
 };
 
+/**
+ * Start path cache entry lookup
+ *
+ * @v cached		Path cache entry
+ * @ret rc		Return status code
+ */
+static int ib_cached_path_lookup ( struct ib_cached_path *cached ) {
+	struct ib_device *ibdev = cached->ibdev;
+
+	/* Create new path */
+	cached->path = ib_create_path ( ibdev, &cached->av,
+					&ib_cached_path_op );
+	if ( ! cached->path ) {
+		DBGC ( ibdev, "IBDEV %s could not create path\n",
+		       ibdev->name );
+		return -ENOMEM;
+	}
+	ib_path_set_ownerdata ( cached->path, cached );
+
+	return 0;
+}
+
 /**
  * Resolve path
  *
@@ -244,49 +343,59 @@ static struct ib_path_operations ib_cached_path_op = {
  * @ret rc		Return status code
  *
  * This provides a non-transactional way to resolve a path, via a
- * cache similar to ARP.
+ * cache similar to ARP.  Lookups for distinct destinations proceed
+ * concurrently, and repeated requests for a destination that is
+ * already being looked up do not generate further queries.
  */
 int ib_resolve_path ( struct ib_device *ibdev, struct ib_address_vector *av ) {
 	union ib_gid *gid = &av->gid;
 	struct ib_cached_path *cached;
-	unsigned int cache_idx;
+	unsigned long now = currticks();
+	int expired;
+	int rc;
 
 	/* Look in cache for a matching entry */
 	cached = ib_find_path_cache_entry ( ibdev, gid );
-	if ( cached && cached->path->av.lid ) {
-		/* Populated entry found */
-		av->lid = cached->path->av.lid;
-		av->rate = cached->path->av.rate;
-		av->sl = cached->path->av.sl;
-		av->gid_present = cached->path->av.gid_present;
-		DBGC2 ( ibdev, "IBDEV %s cache hit for " IB_GID_FMT "\n",
-			ibdev->name, IB_GID_ARGS ( gid ) );
-		return 0;
-	}
-	DBGC ( ibdev, "IBDEV %s cache miss for " IB_GID_FMT "%s\n", ibdev->name,
-	       IB_GID_ARGS ( gid ), ( cached ? " (in progress)" : "" ) );
-
-	/* If lookup is already in progress, do nothing */
-	if ( cached )
+	if ( cached ) {
+		cached->used = now;
+		expired = ( ( ( signed long ) ( now - cached->expires ) ) >= 0 );
+
+		/* Start a fresh lookup if the entry has expired */
+		if ( expired && ( ! cached->path ) ) {
+			DBGC ( ibdev, "IBDEV %s cache refresh for " IB_GID_FMT
+			       "\n", ibdev->name, IB_GID_ARGS ( gid ) );
+			ib_cached_path_lookup ( cached );
+		}
+
+		/* Use resolved path, if available */
+		if ( cached->resolved ) {
+			av->lid = cached->av.lid;
+			av->rate = cached->av.rate;
+			av->sl = cached->av.sl;
+			av->gid_present = cached->av.gid_present;
+			DBGC2 ( ibdev, "IBDEV %s cache hit for " IB_GID_FMT
+				"\n", ibdev->name, IB_GID_ARGS ( gid ) );
+			return 0;
+		}
+
+		/* Report failure during holdoff period */
+		if ( ( cached->rc != 0 ) && ( ! cached->path ) )
+			return cached->rc;
+
+		/* Lookup is in progress */
+		DBGC ( ibdev, "IBDEV %s cache miss for " IB_GID_FMT
+		       " (in progress)\n", ibdev->name, IB_GID_ARGS ( gid ) );
 		return -ENOENT;
+	}
+	DBGC ( ibdev, "IBDEV %s cache miss for " IB_GID_FMT "\n",
+	       ibdev->name, IB_GID_ARGS ( gid ) );
 
-	/* Locate a new cache entry to use */
-	cache_idx = ( (ib_path_cache_idx++) % IB_NUM_CACHED_PATHS );
-	cached = &ib_path_cache[cache_idx];
-
-	/* Destroy the old cache entry */
-	if ( cached->path )
-		ib_destroy_path ( ibdev, cached->path );
-	memset ( cached, 0, sizeof ( *cached ) );
-
-	/* Create new path */
-	cached->path = ib_create_path ( ibdev, av, &ib_cached_path_op );
-	if ( ! cached->path ) {
-		DBGC ( ibdev, "IBDEV %s could not create path\n",
-		       ibdev->name );
-		return -ENOMEM;
+	/* Allocate a new cache entry and start lookup */
+	cached = ib_alloc_path_cache_entry ( ibdev, av );
+	if ( ( rc = ib_cached_path_lookup ( cached ) ) != 0 ) {
+		memset ( cached, 0, sizeof ( *cached ) );
+		return rc;
 	}
-	ib_path_set_ownerdata ( cached->path, cached );
 
 	/* Not found yet */
 	return -ENOENT;
@@ -65,6 +65,8 @@ void iob_pad ( struct io_buffer *iobuf, size_t min_len ) {
 	iob_push ( iobuf, headroom );
 	memmove ( iobuf->data, data, len );
 	iob_unput ( iobuf, headroom );
+	if ( iobuf->flags & IOB_TX_CSUM )
+		iobuf->trans -= headroom;
 
 	/* Pad to minimum packet length */
 	pad_len = ( min_len - iob_len ( iobuf ) );
@@ -56,6 +56,37 @@ static uint8_t next_ident_high = 0;
 /** List of IPv4 miniroutes */
 struct list_head ipv4_miniroutes = LIST_HEAD_INIT ( ipv4_miniroutes );
 
+/** An IPv4 route cache entry */
+struct ipv4_route_cache {
+	/** Routing table generation */
+	unsigned int generation;
+	/** Destination address scope ID */
+	unsigned int scope_id;
+	/** Final destination address */
+	struct in_addr dest;
+	/** Next hop destination address */
+	struct in_addr next_hop;
+	/** Routing table entry, or NULL if cache entry is invalid */
+	struct ipv4_miniroute *miniroute;
+};
+
+/** IPv4 routing table generation
+ *
+ * This is incremented whenever the routing table changes, or the
+ * state of any network device changes, and invalidates the route
+ * cache.
+ */
+static unsigned int ipv4_route_generation;
+
+/** IPv4 route cache
+ *
+ * The transmit path for an established connection will typically
+ * route many consecutive packets to the same destination, and so a
+ * single cached result avoids walking the routing table for each
+ * packet.
+ */
+static struct ipv4_route_cache ipv4_route_cache;
+
 /** IPv4 statistics */
 static struct ip_statistics ipv4_stats;
 
@@ -113,6 +144,7 @@ static int add_ipv4_miniroute ( struct net_device *netdev,
 	} else {
 		list_add ( &miniroute->list, &ipv4_miniroutes );
 	}
+	ipv4_route_generation++;
 
 	return 0;
 }
@@ -134,10 +166,11 @@ static void del_ipv4_miniroute ( struct ipv4_miniroute *miniroute ) {
 	netdev_put ( miniroute->netdev );
 	list_del ( &miniroute->list );
 	free ( miniroute );
+	ipv4_route_generation++;
 }
 
 /**
- * Perform IPv4 routing
+ * Perform IPv4 routing (without using route cache)
  *
  * @v scope_id		Destination address scope ID
  * @v dest		Final destination address
@@ -147,8 +180,8 @@ static void del_ipv4_miniroute ( struct ipv4_miniroute *miniroute ) {
  * If the route requires use of a gateway, the next hop destination
  * address will be overwritten with the gateway address.
  */
-static struct ipv4_miniroute * ipv4_route ( unsigned int scope_id,
-					    struct in_addr *dest ) {
+static struct ipv4_miniroute *
+ipv4_route_uncached ( unsigned int scope_id, struct in_addr *dest ) {
 	struct ipv4_miniroute *miniroute;
 
 	/* Find first usable route in routing table */
@@ -168,6 +201,14 @@ static struct ipv4_miniroute * ipv4_route ( unsigned int scope_id,
 
 		} else {
 
+			/* If a scope ID is specified for a global
+			 * address, then use only routes via the
+			 * specified network device.
+			 */
+			if ( scope_id &&
+			     ( miniroute->netdev->index != scope_id ) )
+				continue;
+
 			/* If destination is an on-link global
 			 * address, then use this route.
 			 */
@@ -189,6 +230,41 @@ static struct ipv4_miniroute * ipv4_route ( unsigned int scope_id,
 	return NULL;
 }
 
+/**
+ * Perform IPv4 routing
+ *
+ * @v scope_id		Destination address scope ID
+ * @v dest		Final destination address
+ * @ret dest		Next hop destination address
+ * @ret miniroute	Routing table entry to use, or NULL if no route
+ *
+ * If the route requires use of a gateway, the next hop destination
+ * address will be overwritten with the gateway address.
+ */
+static struct ipv4_miniroute * ipv4_route ( unsigned int scope_id,
+					    struct in_addr *dest ) {
+	struct ipv4_route_cache *cache = &ipv4_route_cache;
+	struct ipv4_miniroute *miniroute;
+
+	/* Use cached route, if applicable */
+	if ( cache->miniroute &&
+	     ( cache->generation == ipv4_route_generation ) &&
+	     ( cache->dest.s_addr == dest->s_addr ) &&
+	     ( cache->scope_id == scope_id ) ) {
+		*dest = cache->next_hop;
+		return cache->miniroute;
+	}
+
+	/* Find and cache first usable route */
+	cache->dest = *dest;
+	miniroute = ipv4_route_uncached ( scope_id, dest );
+	cache->generation = ipv4_route_generation;
+	cache->scope_id = scope_id;
+	cache->next_hop = *dest;
+	cache->miniroute = miniroute;
+	return miniroute;
+}
+
 /**
  * Determine transmitting network device
  *
@@ -326,6 +402,8 @@ static int ipv4_tx ( struct io_buffer *iobuf,
 	iphdr->verhdrlen = ( IP_VER | ( sizeof ( *iphdr ) / 4 ) );
 	iphdr->service = IP_TOS;
 	iphdr->len = htons ( iob_len ( iobuf ) );	
+	if ( tcpip_protocol->pmtud )
+		iphdr->frags = htons ( IP_MASK_DONOTFRAG );
 	iphdr->ttl = IP_TTL;
 	iphdr->protocol = tcpip_protocol->tcpip_proto;
 	iphdr->dest = sin_dest->sin_addr;
@@ -360,8 +438,14 @@ static int ipv4_tx ( struct io_buffer *iobuf,
 	/* Fix up checksums */
 	if ( trans_csum ) {
 		*trans_csum = ipv4_pshdr_chksum ( iobuf, *trans_csum );
-		if ( ! *trans_csum )
+		if ( iobuf->flags & IOB_TX_CSUM ) {
+			if ( ( rc = tcpip_tx_offload ( iobuf, netdev,
+						       NETDEV_TX_TSO4,
+						       trans_csum ) ) != 0 )
+				goto err;
+		} else if ( ! *trans_csum ) {
 			*trans_csum = tcpip_protocol->zero_csum;
+		}
 	}
 	iphdr->chksum = tcpip_chksum ( iphdr, sizeof ( *iphdr ) );
 
@@ -695,13 +779,49 @@ static const char * ipv4_sock_ntoa ( struct sockaddr *sa ) {
  */
 static int ipv4_sock_aton ( const char *string, struct sockaddr *sa ) {
 	struct sockaddr_in *sin = ( ( struct sockaddr_in * ) sa );
+	struct net_device *netdev;
 	struct in_addr in;
+	char *netdev_string;
+	char *tmp;
+	int rc;
 
-	if ( inet_aton ( string, &in ) ) {
-		sin->sin_addr = in;
-		return 0;
+	/* Create modifiable copy of string */
+	tmp = strdup ( string );
+	if ( ! tmp ) {
+		rc = -ENOMEM;
+		goto err_alloc;
 	}
-	return -EINVAL;
+
+	/* Split at network device name, if present */
+	netdev_string = strchr ( tmp, '%' );
+	if ( netdev_string )
+		*(netdev_string++) = '\0';
+
+	/* Parse IPv4 address portion */
+	if ( ! inet_aton ( tmp, &in ) ) {
+		rc = -EINVAL;
+		goto err_inet_aton;
+	}
+
+	/* Parse explicit network device name, if present */
+	if ( netdev_string ) {
+		netdev = find_netdev ( netdev_string );
+		if ( ! netdev ) {
+			rc = -ENODEV;
+			goto err_find_netdev;
+		}
+		sin->sin_scope_id = netdev->index;
+	}
+
+	/* Copy IPv4 address portion to socket address */
+	sin->sin_addr = in;
+	rc = 0;
+
+ err_find_netdev:
+ err_inet_aton:
+	free ( tmp );
+ err_alloc:
+	return rc;
 }
 
 /** IPv4 protocol */
@@ -718,6 +838,7 @@ struct tcpip_net_protocol ipv4_tcpip_protocol __tcpip_net_protocol = {
 	.name = "IPv4",
 	.sa_family = AF_INET,
 	.header_len = sizeof ( struct iphdr ),
+	.min_mtu = IP_MIN_MTU,
 	.net_protocol = &ipv4_protocol,
 	.tx = ipv4_tx,
 	.netdev = ipv4_netdev,
@@ -922,6 +1043,26 @@ static int ipv4_create_routes ( void ) {
 	return 0;
 }
 
+/**
+ * Handle IPv4 network device or link state change
+ *
+ * @v netdev		Network device
+ */
+static void ipv4_notify ( struct net_device *netdev __unused ) {
+
+	/* Invalidate route cache, since routes via closed network
+	 * devices are not usable.
+	 */
+	ipv4_route_generation++;
+}
+
+/** IPv4 network device driver */
+struct net_driver ipv4_driver __net_driver = {
+	.name = "IPv4",
+	.notify = ipv4_notify,
+	.remove = ipv4_notify,
+};
+
 /** IPv4 settings applicator */
 struct settings_applicator ipv4_settings_applicator __settings_applicator = {
 	.apply = ipv4_create_routes,
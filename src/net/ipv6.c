@@ -59,6 +59,31 @@ FILE_LICENCE ( GPL2_OR_LATER );
 /** List of IPv6 miniroutes */
 struct list_head ipv6_miniroutes = LIST_HEAD_INIT ( ipv6_miniroutes );
 
+/** An IPv6 route cache entry */
+struct ipv6_route_cache {
+	/** Routing table generation */
+	unsigned int generation;
+	/** Destination address scope ID */
+	unsigned int scope_id;
+	/** Final destination address */
+	struct in6_addr dest;
+	/** Next hop is the routing table entry's router */
+	int via_router;
+	/** Routing table entry, or NULL if cache entry is invalid */
+	struct ipv6_miniroute *miniroute;
+};
+
+/** IPv6 routing table generation
+ *
+ * This is incremented whenever the routing table changes, or the
+ * state of any network device changes, and invalidates the route
+ * cache.
+ */
+static unsigned int ipv6_route_generation;
+
+/** IPv6 route cache */
+static struct ipv6_route_cache ipv6_route_cache;
+
 /** IPv6 statistics */
 static struct ip_statistics ipv6_stats;
 
@@ -256,6 +281,7 @@ int ipv6_add_miniroute ( struct net_device *netdev, struct in6_addr *address,
 
 	/* Add to start of routing table */
 	list_add ( &miniroute->list, &ipv6_miniroutes );
+	ipv6_route_generation++;
 
 	/* Set or update address, if applicable */
 	for ( i = 0 ; i < ( sizeof ( address->s6_addr32 ) /
@@ -294,6 +320,7 @@ void ipv6_del_miniroute ( struct ipv6_miniroute *miniroute ) {
 	netdev_put ( miniroute->netdev );
 	list_del ( &miniroute->list );
 	free ( miniroute );
+	ipv6_route_generation++;
 }
 
 /**
@@ -374,6 +401,45 @@ struct ipv6_miniroute * ipv6_route ( unsigned int scope_id,
 	return NULL;
 }
 
+/**
+ * Perform IPv6 routing using route cache
+ *
+ * @v scope_id		Destination address scope ID (for link-local addresses)
+ * @v dest		Final destination address
+ * @ret dest		Next hop destination address
+ * @ret miniroute	Routing table entry to use, or NULL if no route
+ *
+ * The transmit path for an established connection will typically
+ * route many consecutive packets to the same destination, and so a
+ * single cached result avoids walking the routing table for each
+ * packet.
+ */
+static struct ipv6_miniroute * ipv6_route_cached ( unsigned int scope_id,
+						   struct in6_addr **dest ) {
+	struct ipv6_route_cache *cache = &ipv6_route_cache;
+	struct ipv6_miniroute *miniroute;
+	struct in6_addr *final = *dest;
+
+	/* Use cached route, if applicable */
+	if ( cache->miniroute &&
+	     ( cache->generation == ipv6_route_generation ) &&
+	     ( cache->scope_id == scope_id ) &&
+	     ( memcmp ( &cache->dest, final, sizeof ( cache->dest ) ) == 0 ) ) {
+		if ( cache->via_router )
+			*dest = &cache->miniroute->router;
+		return cache->miniroute;
+	}
+
+	/* Find and cache best usable route */
+	miniroute = ipv6_route ( scope_id, dest );
+	cache->generation = ipv6_route_generation;
+	cache->scope_id = scope_id;
+	memcpy ( &cache->dest, final, sizeof ( cache->dest ) );
+	cache->via_router = ( *dest != final );
+	cache->miniroute = miniroute;
+	return miniroute;
+}
+
 /**
  * Determine transmitting network device
  *
@@ -386,7 +452,7 @@ static struct net_device * ipv6_netdev ( struct sockaddr_tcpip *st_dest ) {
 	struct ipv6_miniroute *miniroute;
 
 	/* Find routing table entry */
-	miniroute = ipv6_route ( sin6_dest->sin6_scope_id, &dest );
+	miniroute = ipv6_route_cached ( sin6_dest->sin6_scope_id, &dest );
 	if ( ! miniroute )
 		return NULL;
 
@@ -554,8 +620,8 @@ static int ipv6_tx ( struct io_buffer *iobuf,
 
 	/* Use routing table to identify next hop and transmitting netdev */
 	next_hop = &iphdr->dest;
-	if ( ( miniroute = ipv6_route ( sin6_dest->sin6_scope_id,
-					&next_hop ) ) != NULL ) {
+	if ( ( miniroute = ipv6_route_cached ( sin6_dest->sin6_scope_id,
+					       &next_hop ) ) != NULL ) {
 		src = &miniroute->address;
 		netdev = miniroute->netdev;
 	}
@@ -576,8 +642,14 @@ static int ipv6_tx ( struct io_buffer *iobuf,
 		*trans_csum = ipv6_pshdr_chksum ( iphdr, len,
 						  tcpip_protocol->tcpip_proto,
 						  *trans_csum );
-		if ( ! *trans_csum )
+		if ( iobuf->flags & IOB_TX_CSUM ) {
+			if ( ( rc = tcpip_tx_offload ( iobuf, netdev,
+						       NETDEV_TX_TSO6,
+						       trans_csum ) ) != 0 )
+				goto err;
+		} else if ( ! *trans_csum ) {
 			*trans_csum = tcpip_protocol->zero_csum;
+		}
 	}
 
 	/* Print IPv6 header for debugging */
@@ -1058,6 +1130,7 @@ struct tcpip_net_protocol ipv6_tcpip_protocol __tcpip_net_protocol = {
 	.name = "IPv6",
 	.sa_family = AF_INET6,
 	.header_len = sizeof ( struct ipv6_header ),
+	.min_mtu = IPV6_MIN_MTU,
 	.net_protocol = &ipv6_protocol,
 	.tx = ipv6_tx,
 	.netdev = ipv6_netdev,
@@ -1253,10 +1326,25 @@ static int ipv6_register_settings ( struct net_device *netdev ) {
 	return rc;
 }
 
+/**
+ * Handle IPv6 network device or link state change
+ *
+ * @v netdev		Network device
+ */
+static void ipv6_notify ( struct net_device *netdev __unused ) {
+
+	/* Invalidate route cache, since routes via closed network
+	 * devices are not usable.
+	 */
+	ipv6_route_generation++;
+}
+
 /** IPv6 network device driver */
 struct net_driver ipv6_driver __net_driver = {
 	.name = "IPv6",
 	.probe = ipv6_register_settings,
+	.notify = ipv6_notify,
+	.remove = ipv6_notify,
 };
 
 /**
@@ -1042,6 +1042,16 @@ const struct setting ndp_dnssl_setting __setting ( SETTING_IP_EXTRA, dnssl ) = {
  *
  * IPv6 autoconfiguration
  *
+ * Router solicitation and stateful DHCPv6 are started concurrently,
+ * so that DHCPv6 does not have to wait for the first router
+ * advertisement before beginning its own exchange.  The router
+ * advertisement then determines whether or not the (possibly already
+ * completed) DHCPv6 result is required.
+ *
+ * We do not perform duplicate address detection, and so all
+ * addresses are effectively used optimistically (in the sense of RFC
+ * 4429) as soon as they are configured.
+ *
  */
 
 /** An IPv6 configurator */
@@ -1061,6 +1071,13 @@ struct ipv6conf {
 
 	/** Retransmission timer */
 	struct retry_timer timer;
+
+	/** DHCPv6 status code, or -EINPROGRESS if still in progress */
+	int dhcp_rc;
+	/** DHCPv6 is (or was) stateful */
+	int dhcp_stateful;
+	/** Link was up when last checked */
+	int link_ok;
 };
 
 /** List of IPv6 configurators */
@@ -1115,6 +1132,61 @@ static void ipv6conf_done ( struct ipv6conf *ipv6conf, int rc ) {
 	ref_put ( &ipv6conf->refcnt );
 }
 
+/**
+ * Start DHCPv6 during IPv6 autoconfiguration
+ *
+ * @v ipv6conf		IPv6 configurator
+ * @v stateful		Perform stateful address autoconfiguration
+ * @ret rc		Return status code
+ */
+static int ipv6conf_start_dhcpv6 ( struct ipv6conf *ipv6conf, int stateful ) {
+	struct net_device *netdev = ipv6conf->netdev;
+	int rc;
+
+	/* Shut down any existing DHCPv6 session */
+	intf_restart ( &ipv6conf->dhcp, 0 );
+
+	/* Start DHCPv6 */
+	ipv6conf->dhcp_stateful = stateful;
+	if ( ( rc = start_dhcpv6 ( &ipv6conf->dhcp, netdev,
+				   stateful ) ) != 0 ) {
+		DBGC ( netdev, "NDP %s could not start state%s DHCPv6: %s\n",
+		       netdev->name, ( stateful ? "ful" : "less" ),
+		       strerror ( rc ) );
+		ipv6conf->dhcp_rc = rc;
+		return rc;
+	}
+	ipv6conf->dhcp_rc = -EINPROGRESS;
+
+	return 0;
+}
+
+/**
+ * Handle DHCPv6 completion during IPv6 autoconfiguration
+ *
+ * @v ipv6conf		IPv6 configurator
+ * @v rc		Reason for completion
+ */
+static void ipv6conf_dhcp_done ( struct ipv6conf *ipv6conf, int rc ) {
+	struct net_device *netdev = ipv6conf->netdev;
+
+	/* Record completion */
+	intf_restart ( &ipv6conf->dhcp, rc );
+	ipv6conf->dhcp_rc = rc;
+
+	/* Finish autoconfiguration if router advertisement has
+	 * already been received.
+	 */
+	if ( ! timer_running ( &ipv6conf->timer ) ) {
+		ipv6conf_done ( ipv6conf, rc );
+		return;
+	}
+
+	/* Otherwise, wait for router advertisement */
+	DBGC ( netdev, "NDP %s DHCPv6 finished before router advertisement: "
+	       "%s\n", netdev->name, strerror ( rc ) );
+}
+
 /**
  * Handle IPv6 configurator timer expiry
  *
@@ -1125,9 +1197,13 @@ static void ipv6conf_expired ( struct retry_timer *timer, int fail ) {
 	struct ipv6conf *ipv6conf =
 		container_of ( timer, struct ipv6conf, timer );
 
-	/* If we have failed, terminate autoconfiguration */
+	/* If we have failed, terminate autoconfiguration.  Treat a
+	 * completed stateful DHCPv6 as success even in the absence
+	 * of a router.
+	 */
 	if ( fail ) {
-		ipv6conf_done ( ipv6conf, -ETIMEDOUT );
+		ipv6conf_done ( ipv6conf, ( ( ipv6conf->dhcp_rc == 0 ) ?
+					    0 : -ETIMEDOUT ) );
 		return;
 	}
 
@@ -1179,14 +1255,26 @@ ipv6conf_rx_router_advertisement ( struct net_device *netdev,
 					    radv->option, option_len ) ) != 0 )
 		return rc;
 
-	/* Start DHCPv6 if required */
+	/* Use DHCPv6 if required */
 	if ( radv->flags & ( NDP_ROUTER_MANAGED | NDP_ROUTER_OTHER ) ) {
 		stateful = ( radv->flags & NDP_ROUTER_MANAGED );
-		if ( ( rc = start_dhcpv6 ( &ipv6conf->dhcp, netdev,
-					   stateful ) ) != 0 ) {
-			DBGC ( netdev, "NDP %s could not start state%s DHCPv6: "
-			       "%s\n", netdev->name,
-			       ( stateful ? "ful" : "less" ), strerror ( rc ) );
+
+		/* Finish immediately if DHCPv6 has already succeeded */
+		if ( ipv6conf->dhcp_rc == 0 ) {
+			ipv6conf_done ( ipv6conf, 0 );
+			return 0;
+		}
+
+		/* Continue waiting if a suitable DHCPv6 session is
+		 * already in progress.
+		 */
+		if ( ( ipv6conf->dhcp_rc == -EINPROGRESS ) &&
+		     ( ipv6conf->dhcp_stateful || ! stateful ) )
+			return 0;
+
+		/* Otherwise, (re)start DHCPv6 in the appropriate mode */
+		if ( ( rc = ipv6conf_start_dhcpv6 ( ipv6conf,
+						    stateful ) ) != 0 ) {
 			ipv6conf_done ( ipv6conf, rc );
 			return rc;
 		}
@@ -1210,7 +1298,7 @@ static struct interface_descriptor ipv6conf_job_desc =
 
 /** IPv6 configurator DHCPv6 interface operations */
 static struct interface_operation ipv6conf_dhcp_op[] = {
-	INTF_OP ( intf_close, struct ipv6conf *, ipv6conf_done ),
+	INTF_OP ( intf_close, struct ipv6conf *, ipv6conf_dhcp_done ),
 };
 
 /** IPv6 configurator DHCPv6 interface descriptor */
@@ -1236,16 +1324,62 @@ int start_ipv6conf ( struct interface *job, struct net_device *netdev ) {
 	intf_init ( &ipv6conf->dhcp, &ipv6conf_dhcp_desc, &ipv6conf->refcnt );
 	timer_init ( &ipv6conf->timer, ipv6conf_expired, &ipv6conf->refcnt );
 	ipv6conf->netdev = netdev_get ( netdev );
+	ipv6conf->link_ok = netdev_link_ok ( netdev );
 
 	/* Start timer to initiate router solicitation */
 	start_timer_nodelay ( &ipv6conf->timer );
 
+	/* Start stateful DHCPv6 concurrently with router solicitation.
+	 * Failure is not fatal at this point, since the router
+	 * advertisement may indicate that DHCPv6 is not required.
+	 */
+	ipv6conf_start_dhcpv6 ( ipv6conf, 1 );
+
 	/* Attach parent interface, transfer reference to list, and return */
 	intf_plug_plug ( &ipv6conf->job, job );
 	list_add ( &ipv6conf->list, &ipv6confs );
 	return 0;
 }
 
+/**
+ * Handle network device or link state change
+ *
+ * @v netdev		Network device
+ */
+static void ipv6conf_notify ( struct net_device *netdev ) {
+	struct ipv6conf *ipv6conf;
+	int link_ok;
+
+	/* Identify IPv6 configurator, if any */
+	ipv6conf = ipv6conf_demux ( netdev );
+	if ( ! ipv6conf )
+		return;
+
+	/* Do nothing unless link has just come up */
+	link_ok = netdev_link_ok ( netdev );
+	if ( link_ok == ipv6conf->link_ok )
+		return;
+	ipv6conf->link_ok = link_ok;
+	if ( ! link_ok )
+		return;
+
+	/* Retransmit router solicitation immediately (and reset the
+	 * retransmission backoff) if we are still waiting for a
+	 * router advertisement.
+	 */
+	if ( timer_running ( &ipv6conf->timer ) ) {
+		DBGC ( netdev, "NDP %s link up; soliciting router\n",
+		       netdev->name );
+		start_timer_nodelay ( &ipv6conf->timer );
+	}
+}
+
+/** IPv6 configurator network device driver */
+struct net_driver ipv6conf_driver __net_driver = {
+	.name = "IPv6 configurator",
+	.notify = ipv6conf_notify,
+};
+
 /** IPv6 network device configurator */
 struct net_device_configurator ipv6_configurator __net_device_configurator = {
 	.name = "ipv6",
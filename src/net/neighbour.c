@@ -48,11 +48,53 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 /** Neighbour discovery maximum timeout */
 #define NEIGHBOUR_MAX_TIMEOUT ( TICKS_PER_SEC * 3 )
 
-/** The neighbour cache */
+/** Neighbour cache refresh interval
+ *
+ * A resolved entry that is still in use will be refreshed in the
+ * background once this interval has elapsed.  The existing
+ * link-layer address continues to be used while the refresh is in
+ * flight, so that long-running transfers never stall waiting for
+ * neighbour discovery to complete.
+ */
+#define NEIGHBOUR_REFRESH_INTERVAL ( 60 * TICKS_PER_SEC )
+
+/** Number of neighbour cache hash buckets (must be a power of two) */
+#define NEIGHBOUR_HASH_SIZE 16
+
+/** The neighbour cache (in most-recently-used order) */
 struct list_head neighbours = LIST_HEAD_INIT ( neighbours );
 
+/** Neighbour cache hash buckets */
+static struct list_head neighbour_buckets[NEIGHBOUR_HASH_SIZE];
+
 static void neighbour_expired ( struct retry_timer *timer, int over );
 
+/**
+ * Find neighbour cache hash bucket
+ *
+ * @v net_protocol	Network-layer protocol
+ * @v net_dest		Destination network-layer address
+ * @ret bucket		Hash bucket
+ */
+static struct list_head * neighbour_bucket ( struct net_protocol *net_protocol,
+					     const void *net_dest ) {
+	const uint8_t *bytes = net_dest;
+	struct list_head *bucket;
+	unsigned int hash = 0;
+	unsigned int i;
+
+	/* Hash network-layer address */
+	for ( i = 0 ; i < net_protocol->net_addr_len ; i++ )
+		hash = ( ( hash * 31 ) + bytes[i] );
+	bucket = &neighbour_buckets[ hash & ( NEIGHBOUR_HASH_SIZE - 1 ) ];
+
+	/* Initialise bucket on first use */
+	if ( ! bucket->next )
+		INIT_LIST_HEAD ( bucket );
+
+	return bucket;
+}
+
 /**
  * Free neighbour cache entry
  *
@@ -101,6 +143,8 @@ static struct neighbour * neighbour_create ( struct net_device *netdev,
 
 	/* Transfer ownership to cache */
 	list_add ( &neighbour->list, &neighbours );
+	list_add ( &neighbour->hash,
+		   neighbour_bucket ( net_protocol, net_dest ) );
 
 	DBGC ( neighbour, "NEIGHBOUR %s %s %s created\n", netdev->name,
 	       net_protocol->name, net_protocol->ntoa ( net_dest ) );
@@ -118,17 +162,23 @@ static struct neighbour * neighbour_create ( struct net_device *netdev,
 static struct neighbour * neighbour_find ( struct net_device *netdev,
 					   struct net_protocol *net_protocol,
 					   const void *net_dest ) {
+	struct list_head *bucket = neighbour_bucket ( net_protocol, net_dest );
 	struct neighbour *neighbour;
 
-	list_for_each_entry ( neighbour, &neighbours, list ) {
+	list_for_each_entry ( neighbour, bucket, hash ) {
 		if ( ( neighbour->netdev == netdev ) &&
 		     ( neighbour->net_protocol == net_protocol ) &&
 		     ( memcmp ( neighbour->net_dest, net_dest,
 				net_protocol->net_addr_len ) == 0 ) ) {
 
-			/* Move to start of cache */
-			list_del ( &neighbour->list );
-			list_add ( &neighbour->list, &neighbours );
+			/* Move to start of cache, if not already there.
+			 * Consecutive transmissions to the same next hop
+			 * will therefore find the entry immediately.
+			 */
+			if ( neighbour->list.prev != &neighbours ) {
+				list_del ( &neighbour->list );
+				list_add ( &neighbour->list, &neighbours );
+			}
 
 			return neighbour;
 		}
@@ -185,6 +235,7 @@ static void neighbour_discovered ( struct neighbour *neighbour,
 
 	/* Stop retransmission timer */
 	stop_timer ( &neighbour->timer );
+	neighbour->refreshed = currticks();
 
 	/* Transmit any packets in queue.  Take out a temporary
 	 * reference on the entry to prevent it from going out of
@@ -223,6 +274,7 @@ static void neighbour_destroy ( struct neighbour *neighbour, int rc ) {
 
 	/* Take ownership from cache */
 	list_del ( &neighbour->list );
+	list_del ( &neighbour->hash );
 
 	/* Stop timer */
 	stop_timer ( &neighbour->timer );
@@ -284,6 +336,43 @@ static void neighbour_expired ( struct retry_timer *timer, int fail ) {
 	}
 }
 
+/**
+ * Refresh resolved neighbour cache entry, if stale
+ *
+ * @v neighbour		Neighbour cache entry
+ *
+ * The cached link-layer address remains valid while the refresh
+ * request is outstanding; any reply will update it in place via
+ * neighbour_update().
+ */
+static void neighbour_refresh ( struct neighbour *neighbour ) {
+	struct net_device *netdev = neighbour->netdev;
+	struct net_protocol *net_protocol = neighbour->net_protocol;
+	struct neighbour_discovery *discovery = neighbour->discovery;
+	int rc;
+
+	/* Do nothing unless entry is due for refresh */
+	if ( ( ! discovery ) ||
+	     ( ( currticks() - neighbour->refreshed ) <
+	       NEIGHBOUR_REFRESH_INTERVAL ) )
+		return;
+	neighbour->refreshed = currticks();
+
+	/* Transmit neighbour request */
+	DBGC2 ( neighbour, "NEIGHBOUR %s %s %s refreshing via %s\n",
+		netdev->name, net_protocol->name,
+		net_protocol->ntoa ( neighbour->net_dest ), discovery->name );
+	if ( ( rc = discovery->tx_request ( netdev, net_protocol,
+					    neighbour->net_dest,
+					    neighbour->net_source ) ) != 0 ) {
+		DBGC ( neighbour, "NEIGHBOUR %s %s %s could not transmit %s "
+		       "refresh: %s\n", netdev->name, net_protocol->name,
+		       net_protocol->ntoa ( neighbour->net_dest ),
+		       discovery->name, strerror ( rc ) );
+		/* Ignore error; will retry after next interval */
+	}
+}
+
 /**
  * Transmit packet, determining link-layer address via neighbour discovery
  *
@@ -315,6 +404,7 @@ int neighbour_tx ( struct io_buffer *iobuf, struct net_device *netdev,
 	 * immediately, otherwise queue for later transmission.
 	 */
 	if ( neighbour_has_ll_dest ( neighbour ) ) {
+		neighbour_refresh ( neighbour );
 		return net_tx ( iobuf, netdev, net_protocol, neighbour->ll_dest,
 				ll_source );
 	} else {
@@ -428,5 +518,6 @@ static unsigned int neighbour_discard ( void ) {
  * transfer will cause substantial disruption.
  */
 struct cache_discarder neighbour_discarder __cache_discarder (CACHE_EXPENSIVE)={
+	.name = "neighbour",
 	.discard = neighbour_discard,
 };
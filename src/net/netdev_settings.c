@@ -24,6 +24,7 @@
 FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 #include <string.h>
+#include <strings.h>
 #include <errno.h>
 #include <byteswap.h>
 #include <ipxe/dhcp.h>
@@ -81,6 +82,68 @@ const struct setting mtu_setting __setting ( SETTING_NETDEV, mtu ) = {
 	.type = &setting_type_int16,
 	.tag = DHCP_MTU,
 };
+const struct setting rxring_setting __setting ( SETTING_NETDEV_EXTRA,
+						rxring ) = {
+	.name = "rxring",
+	.description = "Receive ring size",
+	.type = &setting_type_uint16,
+};
+const struct setting txring_setting __setting ( SETTING_NETDEV_EXTRA,
+						txring ) = {
+	.name = "txring",
+	.description = "Transmit ring size",
+	.type = &setting_type_uint16,
+};
+const struct setting rxqueues_setting __setting ( SETTING_NETDEV_EXTRA,
+						  rxqueues ) = {
+	.name = "rxqueues",
+	.description = "Receive queue count",
+	.type = &setting_type_uint16,
+};
+const struct setting lro_setting __setting ( SETTING_NETDEV_EXTRA, lro ) = {
+	.name = "lro",
+	.description = "Large receive offload",
+	.type = &setting_type_uint8,
+};
+
+/**
+ * Get configured descriptor ring size
+ *
+ * @v netdev		Network device
+ * @v setting		Ring size setting
+ * @v count		Default number of descriptors
+ * @v min		Minimum number of descriptors
+ * @v max		Maximum number of descriptors
+ * @ret count		Number of descriptors
+ *
+ * The default, minimum and maximum values must all be powers of two.
+ * Any configured value will be rounded down to a power of two, and
+ * clamped to the supported range.
+ */
+unsigned int netdev_ring_size ( struct net_device *netdev,
+				const struct setting *setting,
+				unsigned int count, unsigned int min,
+				unsigned int max ) {
+	unsigned long value;
+
+	/* Use default value unless a ring size is specified */
+	if ( fetch_uint_setting ( netdev_settings ( netdev ), setting,
+				  &value ) <= 0 )
+		return count;
+
+	/* Clamp to supported range */
+	if ( value < min )
+		value = min;
+	if ( value > max )
+		value = max;
+
+	/* Round down to a power of two */
+	count = ( 1UL << ( fls ( value ) - 1 ) );
+	DBGC ( netdev, "NETDEV %s using %d-entry %s\n",
+	       netdev->name, count, setting->description );
+
+	return count;
+}
 
 /**
  * Store link-layer address setting
@@ -41,6 +41,8 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/profile.h>
 #include <ipxe/fault.h>
 #include <ipxe/vlan.h>
+#include <ipxe/pcap.h>
+#include <ipxe/nap.h>
 #include <ipxe/netdevice.h>
 
 /** @file
@@ -293,10 +295,14 @@ int netdev_tx ( struct net_device *netdev, struct io_buffer *iobuf ) {
 	DBGC2 ( netdev, "NETDEV %s transmitting %p (%p+%zx)\n",
 		netdev->name, iobuf, iobuf->data, iob_len ( iobuf ) );
 	profile_start ( &net_tx_profiler );
+	nap_activity();
 
 	/* Enqueue packet */
 	list_add_tail ( &iobuf->list, &netdev->tx_queue );
 
+	/* Capture packet, if applicable */
+	pcap_capture ( netdev, iobuf, PCAP_TX );
+
 	/* Avoid calling transmit() on unopened network devices */
 	if ( ! netdev_is_open ( netdev ) ) {
 		rc = -ENETUNREACH;
@@ -472,6 +478,10 @@ void netdev_rx ( struct net_device *netdev, struct io_buffer *iobuf ) {
 
 	DBGC2 ( netdev, "NETDEV %s received %p (%p+%zx)\n",
 		netdev->name, iobuf, iobuf->data, iob_len ( iobuf ) );
+	nap_activity();
+
+	/* Capture packet, if applicable */
+	pcap_capture ( netdev, iobuf, PCAP_RX );
 
 	/* Discard packet (for test purposes) if applicable */
 	if ( ( rc = inject_fault ( NETDEV_DISCARD_RATE ) ) != 0 ) {
@@ -486,6 +496,51 @@ void netdev_rx ( struct net_device *netdev, struct io_buffer *iobuf ) {
 	netdev_record_stat ( &netdev->rx_stats, 0 );
 }
 
+/**
+ * Add a burst of packets to receive queue
+ *
+ * @v netdev		Network device
+ * @v burst		List of received I/O buffers
+ *
+ * This is equivalent to calling netdev_rx() for each packet in the
+ * list, but allows a driver that has gathered several completed
+ * receive descriptors in a single poll to hand them to the network
+ * stack in one operation.  The burst list will be left empty.  This
+ * function takes ownership of the I/O buffers.
+ */
+void netdev_rx_burst ( struct net_device *netdev, struct list_head *burst ) {
+	struct io_buffer *iobuf;
+	struct io_buffer *tmp;
+	unsigned int count = 0;
+
+	/* Fall back to individual packets if faults may be injected */
+	if ( NETDEV_DISCARD_RATE ) {
+		list_for_each_entry_safe ( iobuf, tmp, burst, list ) {
+			list_del ( &iobuf->list );
+			netdev_rx ( netdev, iobuf );
+		}
+		return;
+	}
+
+	/* Count packets */
+	list_for_each_entry ( iobuf, burst, list ) {
+		DBGC2 ( netdev, "NETDEV %s received %p (%p+%zx)\n",
+			netdev->name, iobuf, iobuf->data, iob_len ( iobuf ) );
+		pcap_capture ( netdev, iobuf, PCAP_RX );
+		count++;
+	}
+
+	/* Enqueue packets */
+	list_splice_tail_init ( burst, &netdev->rx_queue );
+
+	/* Record activity, if applicable */
+	if ( count )
+		nap_activity();
+
+	/* Update statistics counter */
+	netdev->rx_stats.good += count;
+}
+
 /**
  * Discard received packet
  *
@@ -607,6 +662,7 @@ static void free_netdev ( struct refcnt *refcnt ) {
 	stop_timer ( &netdev->link_block );
 	netdev_tx_flush ( netdev );
 	netdev_rx_flush ( netdev );
+	iob_pool_flush ( &netdev->rx_pool );
 	clear_settings ( netdev_settings ( netdev ) );
 	free ( netdev );
 }
@@ -639,6 +695,7 @@ struct net_device * alloc_netdev ( size_t priv_len ) {
 		INIT_LIST_HEAD ( &netdev->tx_queue );
 		INIT_LIST_HEAD ( &netdev->tx_deferred );
 		INIT_LIST_HEAD ( &netdev->rx_queue );
+		iob_pool_init ( &netdev->rx_pool, &netdev->refcnt );
 		netdev_settings_init ( netdev );
 		config = netdev->configs;
 		for_each_table_entry ( configurator, NET_DEVICE_CONFIGURATORS ){
@@ -832,6 +889,9 @@ void netdev_close ( struct net_device *netdev ) {
 	/* Flush TX and RX queues */
 	netdev_tx_flush ( netdev );
 	netdev_rx_flush ( netdev );
+
+	/* Free any unused RX buffers */
+	iob_pool_flush ( &netdev->rx_pool );
 }
 
 /**
@@ -1137,8 +1197,38 @@ __weak struct net_device * vlan_find ( struct net_device *trunk __unused,
 	return NULL;
 }
 
+/**
+ * Add VLAN tag-stripped packet to queue (when VLAN support is not present)
+ *
+ * @v netdev		Network device
+ * @v tag		VLAN tag, or zero
+ * @v iobuf		I/O buffer
+ */
+__weak void vlan_netdev_rx ( struct net_device *netdev, unsigned int tag,
+			     struct io_buffer *iobuf ) {
+
+	if ( tag == 0 ) {
+		netdev_rx ( netdev, iobuf );
+	} else {
+		netdev_rx_err ( netdev, iobuf, -ENODEV );
+	}
+}
+
+/**
+ * Capture packet (when packet capture support is not present)
+ *
+ * @v netdev		Network device
+ * @v iobuf		I/O buffer
+ * @v direction		Direction
+ */
+__weak void pcap_capture ( struct net_device *netdev __unused,
+			   struct io_buffer *iobuf __unused,
+			   unsigned int direction __unused ) {
+	/* Nothing to do */
+}
+
 /** Networking stack process */
-PERMANENT_PROCESS ( net_process, net_step );
+PERMANENT_PROCESS_PRIORITY ( net_process, net_step, PROCESS_PRIORITY_HIGH );
 
 /**
  * Discard some cached network device data
@@ -1170,9 +1260,32 @@ static unsigned int net_discard ( void ) {
 
 /** Network device cache discarder */
 struct cache_discarder net_discarder __cache_discarder ( CACHE_NORMAL ) = {
+	.name = "netdev",
 	.discard = net_discard,
 };
 
+/**
+ * Discard unused network device RX buffers
+ *
+ * @ret discarded	Number of cached items discarded
+ */
+static unsigned int net_rx_pool_discard ( void ) {
+	struct net_device *netdev;
+	unsigned int discarded = 0;
+
+	for_each_netdev ( netdev )
+		discarded += iob_pool_flush ( &netdev->rx_pool );
+
+	return discarded;
+}
+
+/** Network device RX buffer pool cache discarder */
+struct cache_discarder net_rx_pool_discarder
+	__cache_discarder ( CACHE_CHEAP ) = {
+	.name = "netdev.rxpool",
+	.discard = net_rx_pool_discard,
+};
+
 /**
  * Find network device configurator
  *
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * TCP NewReno congestion control
+ *
+ * This implements the standard slow start, congestion avoidance and
+ * fast recovery algorithms as described in RFC 5681 and RFC 6582.
+ *
+ */
+
+#include <stdint.h>
+#include <ipxe/tcp.h>
+
+/**
+ * Initialise congestion control state
+ *
+ * @v cong		Congestion control state
+ */
+static void newreno_init ( struct tcp_congestion *cong ) {
+	uint32_t mss = cong->mss;
+
+	/* Use initial window as per RFC 6928 */
+	cong->cwnd = ( 2 * mss );
+	if ( cong->cwnd < 14600 )
+		cong->cwnd = 14600;
+	if ( cong->cwnd > ( 10 * mss ) )
+		cong->cwnd = ( 10 * mss );
+
+	/* Use an arbitrarily high initial slow start threshold */
+	cong->ssthresh = ~( ( uint32_t ) 0 );
+	cong->acked = 0;
+}
+
+/**
+ * Handle acknowledgement of new data
+ *
+ * @v cong		Congestion control state
+ * @v len		Length of newly acknowledged data
+ */
+static void newreno_acked ( struct tcp_congestion *cong, uint32_t len ) {
+
+	if ( cong->cwnd < cong->ssthresh ) {
+
+		/* Slow start: increase window by at most one segment
+		 * per acknowledgement.
+		 */
+		if ( len > cong->mss )
+			len = cong->mss;
+		cong->cwnd += len;
+
+	} else {
+
+		/* Congestion avoidance: increase window by one
+		 * segment per window of acknowledged data (i.e. by
+		 * one segment per round-trip time).
+		 */
+		cong->acked += len;
+		if ( cong->acked >= cong->cwnd ) {
+			cong->acked -= cong->cwnd;
+			cong->cwnd += cong->mss;
+		}
+	}
+}
+
+/**
+ * Handle retransmission timeout
+ *
+ * @v cong		Congestion control state
+ * @v flight		Amount of data in flight
+ */
+static void newreno_timeout ( struct tcp_congestion *cong, uint32_t flight ) {
+
+	/* Halve slow start threshold and restart from the loss window */
+	cong->ssthresh = ( flight / 2 );
+	if ( cong->ssthresh < ( 2 * cong->mss ) )
+		cong->ssthresh = ( 2 * cong->mss );
+	cong->cwnd = cong->mss;
+	cong->acked = 0;
+}
+
+/**
+ * Handle entry to fast recovery
+ *
+ * @v cong		Congestion control state
+ * @v flight		Amount of data in flight
+ */
+static void newreno_recovery ( struct tcp_congestion *cong, uint32_t flight ) {
+
+	/* Halve slow start threshold and continue from there.  Any
+	 * further window inflation is provided implicitly by the TCP
+	 * core, which excludes duplicately acknowledged data from the
+	 * amount considered to be in flight.
+	 */
+	cong->ssthresh = ( flight / 2 );
+	if ( cong->ssthresh < ( 2 * cong->mss ) )
+		cong->ssthresh = ( 2 * cong->mss );
+	cong->cwnd = cong->ssthresh;
+	cong->acked = 0;
+}
+
+/**
+ * Handle exit from fast recovery
+ *
+ * @v cong		Congestion control state
+ */
+static void newreno_recovered ( struct tcp_congestion *cong ) {
+
+	/* Continue in congestion avoidance */
+	cong->cwnd = cong->ssthresh;
+	cong->acked = 0;
+}
+
+/** NewReno congestion control algorithm */
+struct tcp_congestion_algorithm newreno_algorithm
+__tcp_congestion_algorithm ( TCP_CONGESTION_DEFAULT ) = {
+	.name = "newreno",
+	.init = newreno_init,
+	.acked = newreno_acked,
+	.timeout = newreno_timeout,
+	.recovery = newreno_recovery,
+	.recovered = newreno_recovered,
+};
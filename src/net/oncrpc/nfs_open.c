@@ -26,6 +26,7 @@
 #include <libgen.h>
 #include <byteswap.h>
 #include <ipxe/time.h>
+#include <ipxe/list.h>
 #include <ipxe/socket.h>
 #include <ipxe/tcpip.h>
 #include <ipxe/in.h>
@@ -50,8 +51,24 @@
 
 FEATURE ( FEATURE_PROTOCOL, "NFS", DHCP_EB_FEATURE_NFS, 1 );
 
+/** Default READ request size (if not negotiated) */
 #define NFS_RSIZE 100000
 
+/** Maximum READ request size */
+#define NFS_MAX_RSIZE ( 1024 * 1024 )
+
+/** Maximum number of concurrent READ requests */
+#define NFS_READ_WINDOW 4
+
+/** Maximum length of a fully buffered (non-READ) reply */
+#define NFS_MAX_REPLY_LEN 4096
+
+/** Length of READ reply to buffer before streaming data */
+#define NFS_READ_PREFIX_LEN 256
+
+/** ONC RPC record marker last fragment flag */
+#define NFS_LAST_FRAGMENT 0x80000000UL
+
 enum nfs_pm_state {
 	NFS_PORTMAP_NONE = 0,
 	NFS_PORTMAP_MOUNTPORT,
@@ -62,21 +79,73 @@ enum nfs_pm_state {
 enum nfs_mount_state {
 	NFS_MOUNT_NONE = 0,
 	NFS_MOUNT_MNT,
-	NFS_MOUNT_UMNT,
 	NFS_MOUNT_CLOSED,
 };
 
 enum nfs_state {
 	NFS_NONE = 0,
+	NFS_FSINFO,
+	NFS_FSINFO_SENT,
 	NFS_LOOKUP,
 	NFS_LOOKUP_SENT,
 	NFS_READLINK,
 	NFS_READLINK_SENT,
 	NFS_READ,
-	NFS_READ_SENT,
 	NFS_CLOSED,
 };
 
+/**
+ * A cached NFS server
+ *
+ * Port mapper results, mount file handles, and directory file handles
+ * are retained for the lifetime of the boot, so that fetching several
+ * files from the same export does not repeat the port mapper, MOUNT,
+ * and LOOKUP round trips.
+ */
+struct nfs_server {
+	/** List of cached servers */
+	struct list_head        list;
+	/** Cached directory file handles */
+	struct list_head        handles;
+	/** Mount daemon port (or zero if unknown) */
+	uint16_t                mount_port;
+	/** NFS daemon port (or zero if unknown) */
+	uint16_t                nfs_port;
+	/** READ request size (or zero if unknown) */
+	uint32_t                rsize;
+	/** Host name */
+	char                    hostname[0];
+};
+
+/**
+ * A cached NFS directory file handle
+ *
+ */
+struct nfs_handle {
+	/** List of cached handles */
+	struct list_head        list;
+	/** File handle */
+	struct nfs_fh           fh;
+	/** Absolute directory path */
+	char                    path[0];
+};
+
+/** Cached NFS servers */
+static LIST_HEAD ( nfs_servers );
+
+/**
+ * A NFS READ request
+ *
+ */
+struct nfs_read_call {
+	/** File offset */
+	uint64_t                offset;
+	/** Byte count (or zero if unused) */
+	uint32_t                count;
+	/** Transaction ID (or zero if not yet sent) */
+	uint32_t                xid;
+};
+
 /**
  * A NFS request
  *
@@ -104,15 +173,41 @@ struct nfs_request {
 	char *                  hostname;
 	struct nfs_uri          uri;
 
+	/** Cached server */
+	struct nfs_server       *server;
+	/** Absolute path of current directory (if cacheable) */
+	char                    *dir;
+	/** Path component currently being looked up */
+	const char              *component;
+
 	struct nfs_fh           readlink_fh;
 	struct nfs_fh           current_fh;
-	uint64_t                file_offset;
 
+	/** Negotiated READ request size */
+	uint32_t                rsize;
+	/** Offset of next READ request */
+	uint64_t                file_offset;
+	/** File size (if known) */
+	uint64_t                filesize;
+	/** File size has been reported to data transfer interface */
+	int                     sized;
+	/** Outstanding READ requests */
+	struct nfs_read_call    reads[NFS_READ_WINDOW];
+
+	/** Partially received reply */
+	struct io_buffer        *reply;
+	/** Length of reply to buffer (including record marker) */
+	size_t                  reply_len;
+	/** Remaining length of current record following buffered reply */
+	size_t                  record_remaining;
+	/** READ reply data remaining to be streamed */
 	size_t                  remaining;
-	int                     eof;
+	/** File offset of READ reply data being streamed */
+	uint64_t                data_offset;
 };
 
 static void nfs_step ( struct nfs_request *nfs );
+static void nfs_start ( struct nfs_request *nfs );
 
 /**
  * Free NFS request
@@ -127,11 +222,138 @@ static void nfs_free ( struct refcnt *refcnt ) {
 
 	nfs_uri_free ( &nfs->uri );
 
+	free_iob ( nfs->reply );
+	free ( nfs->dir );
 	free ( nfs->hostname );
 	free ( nfs->auth_sys.hostname );
 	free ( nfs );
 }
 
+/**
+ * Find or create cached NFS server
+ *
+ * @v hostname		Host name
+ * @ret server		Cached server, or NULL on error
+ */
+static struct nfs_server * nfs_server ( const char *hostname ) {
+	struct nfs_server *server;
+	size_t len;
+
+	/* Find existing server, if any */
+	list_for_each_entry ( server, &nfs_servers, list ) {
+		if ( strcmp ( server->hostname, hostname ) == 0 )
+			return server;
+	}
+
+	/* Create new server */
+	len = ( strlen ( hostname ) + 1 /* NUL */ );
+	server = zalloc ( sizeof ( *server ) + len );
+	if ( ! server )
+		return NULL;
+	INIT_LIST_HEAD ( &server->handles );
+	memcpy ( server->hostname, hostname, len );
+	list_add ( &server->list, &nfs_servers );
+
+	return server;
+}
+
+/**
+ * Find cached directory file handle
+ *
+ * @v server		Cached server
+ * @v path		Absolute directory path
+ * @ret handle		Cached file handle, or NULL if not found
+ */
+static struct nfs_handle * nfs_handle_find ( struct nfs_server *server,
+					     const char *path ) {
+	struct nfs_handle *handle;
+
+	list_for_each_entry ( handle, &server->handles, list ) {
+		if ( strcmp ( handle->path, path ) == 0 )
+			return handle;
+	}
+	return NULL;
+}
+
+/**
+ * Record directory file handle
+ *
+ * @v server		Cached server
+ * @v path		Absolute directory path
+ * @v fh		File handle
+ */
+static void nfs_handle_add ( struct nfs_server *server, const char *path,
+			     const struct nfs_fh *fh ) {
+	struct nfs_handle *handle;
+	size_t len;
+
+	/* Update existing entry, if any */
+	handle = nfs_handle_find ( server, path );
+	if ( handle ) {
+		memcpy ( &handle->fh, fh, sizeof ( handle->fh ) );
+		return;
+	}
+
+	/* Create new entry (failure is not an error) */
+	len = ( strlen ( path ) + 1 /* NUL */ );
+	handle = malloc ( sizeof ( *handle ) + len );
+	if ( ! handle )
+		return;
+	memcpy ( &handle->fh, fh, sizeof ( handle->fh ) );
+	memcpy ( handle->path, path, len );
+	list_add ( &handle->list, &server->handles );
+}
+
+/**
+ * Discard all cached directory file handles for a server
+ *
+ * @v server		Cached server
+ */
+static void nfs_handle_flush ( struct nfs_server *server ) {
+	struct nfs_handle *handle;
+	struct nfs_handle *tmp;
+
+	list_for_each_entry_safe ( handle, tmp, &server->handles, list ) {
+		list_del ( &handle->list );
+		free ( handle );
+	}
+}
+
+/**
+ * Enter a directory
+ *
+ * @v nfs		NFS request
+ * @v component		Path component
+ * @v fh		Directory file handle
+ *
+ * Records the file handle for the new current directory, if the
+ * directory's absolute path is known.
+ */
+static void nfs_enter ( struct nfs_request *nfs, const char *component,
+			const struct nfs_fh *fh ) {
+	char *dir;
+
+	/* Do nothing if the current directory path is unknown */
+	if ( ! nfs->dir )
+		return;
+
+	/* Stop tracking the directory path on any relative traversal */
+	if ( ( strcmp ( component, "." ) == 0 ) ||
+	     ( strcmp ( component, ".." ) == 0 ) ||
+	     ( asprintf ( &dir, "%s/%s",
+			  ( strcmp ( nfs->dir, "/" ) ? nfs->dir : "" ),
+			  component ) < 0 ) ) {
+		free ( nfs->dir );
+		nfs->dir = NULL;
+		return;
+	}
+
+	/* Record file handle */
+	nfs_handle_add ( nfs->server, dir, fh );
+	free ( nfs->dir );
+	nfs->dir = dir;
+}
+
 /**
  * Mark NFS operation as complete
  *
@@ -227,6 +449,7 @@ static int nfs_pm_deliver ( struct nfs_request *nfs,
 		rc = portmap_get_getport_reply ( &getport_reply, &reply );
 		if ( rc != 0 )
 			goto err;
+		nfs->server->mount_port = getport_reply.port;
 
 		rc = nfs_connect ( &nfs->mount_intf, getport_reply.port,
 	                           nfs->hostname );
@@ -245,6 +468,7 @@ static int nfs_pm_deliver ( struct nfs_request *nfs,
 		rc = portmap_get_getport_reply ( &getport_reply, &reply );
 		if ( rc != 0 )
 			goto err;
+		nfs->server->nfs_port = getport_reply.port;
 
 		rc = nfs_connect ( &nfs->nfs_intf, getport_reply.port,
 	                           nfs->hostname );
@@ -284,15 +508,6 @@ static void nfs_mount_step ( struct nfs_request *nfs ) {
 		return;
 	}
 
-	if ( nfs->mount_state == NFS_MOUNT_UMNT ) {
-		DBGC ( nfs, "NFS_OPEN %p UMNT call\n", nfs );
-
-		rc = mount_umnt ( &nfs->mount_intf, &nfs->mount_session,
-		                 nfs_uri_mountpoint ( &nfs->uri ) );
-		if ( rc != 0 )
-			goto err;
-	}
-
 	return;
 err:
 	nfs_done ( nfs, rc );
@@ -342,16 +557,18 @@ static int nfs_mount_deliver ( struct nfs_request *nfs,
 			goto done;
 		}
 
+		/* Record mount file handle.  The mount is retained
+		 * (and cached) for the lifetime of the boot, so the
+		 * mount daemon connection is no longer required.
+		 */
 		nfs->current_fh = mnt_reply.fh;
-		nfs->nfs_state = NFS_LOOKUP;
-		nfs_step ( nfs );
-
-		goto done;
-	}
+		nfs->dir = strdup ( nfs_uri_mountpoint ( &nfs->uri ) );
+		if ( nfs->dir )
+			nfs_handle_add ( nfs->server, nfs->dir, &mnt_reply.fh );
+		intf_shutdown ( &nfs->mount_intf, 0 );
+		nfs->mount_state = NFS_MOUNT_CLOSED;
 
-	if ( nfs->mount_state == NFS_MOUNT_UMNT ) {
-		DBGC ( nfs, "NFS_OPEN %p got UMNT reply\n", nfs );
-		nfs_done ( nfs, 0 );
+		nfs_start ( nfs );
 
 		goto done;
 	}
@@ -364,6 +581,72 @@ done:
 	return 0;
 }
 
+/**
+ * Start NFS operations from the current directory file handle
+ *
+ * @v nfs		NFS request
+ */
+static void nfs_start ( struct nfs_request *nfs ) {
+
+	/* Use cached READ request size, if known */
+	if ( nfs->server->rsize ) {
+		nfs->rsize = nfs->server->rsize;
+		nfs->nfs_state = NFS_LOOKUP;
+	} else {
+		nfs->nfs_state = NFS_FSINFO;
+	}
+	nfs_step ( nfs );
+}
+
+/**
+ * Send READ requests
+ *
+ * @v nfs		NFS request
+ * @ret rc		Return status code
+ *
+ * Up to NFS_READ_WINDOW READ requests may be outstanding at any time.
+ * Requests that received a short reply are reissued for the missing
+ * portion.
+ */
+static int nfs_read_step ( struct nfs_request *nfs ) {
+	struct nfs_read_call *read;
+	unsigned int i;
+	int rc;
+
+	for ( i = 0 ; i < NFS_READ_WINDOW ; i++ ) {
+		read = &nfs->reads[i];
+
+		/* Skip requests that are already outstanding */
+		if ( read->count && read->xid )
+			continue;
+
+		/* Stop if we cannot send */
+		if ( ! xfer_window ( &nfs->nfs_intf ) )
+			break;
+
+		/* Allocate a new request, if applicable */
+		if ( ! read->count ) {
+			if ( nfs->file_offset >= nfs->filesize )
+				continue;
+			read->offset = nfs->file_offset;
+			read->count = nfs->rsize;
+			nfs->file_offset += nfs->rsize;
+		}
+
+		/* Send request */
+		DBGC ( nfs, "NFS_OPEN %p READ call (%#llx+%#x)\n",
+		       nfs, ( ( unsigned long long ) read->offset ),
+		       read->count );
+		if ( ( rc = nfs_read ( &nfs->nfs_intf, &nfs->nfs_session,
+				       &nfs->current_fh, read->offset,
+				       read->count ) ) != 0 )
+			return rc;
+		read->xid = nfs->nfs_session.rpc_id;
+	}
+
+	return 0;
+}
+
 static void nfs_step ( struct nfs_request *nfs ) {
 	int     rc;
 	char    *path_component;
@@ -371,12 +654,25 @@ static void nfs_step ( struct nfs_request *nfs ) {
 	if ( ! xfer_window ( &nfs->nfs_intf ) )
 		return;
 
+	if ( nfs->nfs_state == NFS_FSINFO ) {
+		DBGC ( nfs, "NFS_OPEN %p FSINFO call\n", nfs );
+
+		rc = nfs_fsinfo ( &nfs->nfs_intf, &nfs->nfs_session,
+		                  &nfs->current_fh );
+		if ( rc != 0 )
+			goto err;
+
+		nfs->nfs_state++;
+		return;
+	}
+
 	if ( nfs->nfs_state == NFS_LOOKUP ) {
 		path_component = nfs_uri_next_path_component ( &nfs->uri );
 
 		DBGC ( nfs, "NFS_OPEN %p LOOKUP call (%s)\n", nfs,
                        path_component );
 
+		nfs->component = path_component;
 		rc = nfs_lookup ( &nfs->nfs_intf, &nfs->nfs_session,
 		                  &nfs->current_fh, path_component );
 		if ( rc != 0 )
@@ -400,15 +696,10 @@ static void nfs_step ( struct nfs_request *nfs ) {
 	}
 
 	if ( nfs->nfs_state == NFS_READ ) {
-		DBGC ( nfs, "NFS_OPEN %p READ call\n", nfs );
-
-		rc = nfs_read ( &nfs->nfs_intf, &nfs->nfs_session,
-		                &nfs->current_fh, nfs->file_offset,
-		                NFS_RSIZE );
+		rc = nfs_read_step ( nfs );
 		if ( rc != 0 )
 			goto err;
 
-		nfs->nfs_state++;
 		return;
 	}
 
@@ -417,18 +708,191 @@ err:
 	nfs_done ( nfs, rc );
 }
 
-static int nfs_deliver ( struct nfs_request *nfs,
-                         struct io_buffer *io_buf,
-                         struct xfer_metadata *meta __unused ) {
-	int                     rc;
+/**
+ * Deliver READ reply data
+ *
+ * @v nfs		NFS request
+ * @v io_buf		I/O buffer containing data
+ * @v len		Length of data to deliver from start of I/O buffer
+ * @ret rc		Return status code
+ */
+static int nfs_read_data ( struct nfs_request *nfs, struct io_buffer *io_buf,
+			   size_t len ) {
+	struct xfer_metadata meta;
+	struct io_buffer *data;
+	int rc;
+
+	/* Use I/O buffer directly if possible, otherwise copy */
+	if ( ( len == iob_len ( io_buf ) ) && ( io_buf != nfs->reply ) ) {
+		data = iob_disown ( io_buf );
+	} else {
+		data = xfer_alloc_iob ( &nfs->xfer, len );
+		if ( ! data )
+			return -ENOMEM;
+		memcpy ( iob_put ( data, len ), io_buf->data, len );
+		iob_pull ( io_buf, len );
+	}
+
+	/* Deliver data at the appropriate offset */
+	DBGC2 ( nfs, "NFS_OPEN %p got %zd bytes at %#llx\n", nfs, len,
+		( ( unsigned long long ) nfs->data_offset ) );
+	memset ( &meta, 0, sizeof ( meta ) );
+	meta.flags = XFER_FL_ABS_OFFSET;
+	meta.offset = nfs->data_offset;
+	nfs->data_offset += len;
+	nfs->remaining -= len;
+	if ( ( rc = xfer_deliver ( &nfs->xfer, data, &meta ) ) != 0 )
+		return rc;
+
+	return 0;
+}
+
+/**
+ * Check for completion of file transfer
+ *
+ * @v nfs		NFS request
+ */
+static void nfs_read_check ( struct nfs_request *nfs ) {
+	unsigned int i;
+
+	/* Wait until current reply has been fully streamed */
+	if ( nfs->remaining )
+		return;
+
+	/* Send further requests if the file is not yet complete */
+	for ( i = 0 ; i < NFS_READ_WINDOW ; i++ ) {
+		if ( nfs->reads[i].count ) {
+			nfs_step ( nfs );
+			return;
+		}
+	}
+	if ( nfs->file_offset < nfs->filesize ) {
+		nfs_step ( nfs );
+		return;
+	}
+
+	/* Transfer is complete.  The export remains mounted, since
+	 * its file handles are cached for subsequent requests.
+	 */
+	DBGC ( nfs, "NFS_OPEN %p transfer complete\n", nfs );
+	nfs->nfs_state = NFS_CLOSED;
+	nfs_done ( nfs, 0 );
+}
+
+/**
+ * Handle READ reply
+ *
+ * @v nfs		NFS request
+ * @v reply		ONC RPC reply
+ * @ret rc		Return status code
+ */
+static int nfs_read_reply ( struct nfs_request *nfs,
+			    struct oncrpc_reply *reply ) {
+	struct nfs_read_reply read_reply;
+	struct nfs_read_call *read;
+	unsigned int i;
+	size_t len;
+	int rc;
+
+	/* Identify request */
+	for ( i = 0 ; i < NFS_READ_WINDOW ; i++ ) {
+		read = &nfs->reads[i];
+		if ( read->count && read->xid &&
+		     ( read->xid == reply->rpc_id ) )
+			break;
+	}
+	if ( i == NFS_READ_WINDOW ) {
+		DBGC ( nfs, "NFS_OPEN %p unexpected READ reply %#08x\n",
+		       nfs, reply->rpc_id );
+		return -EPROTO;
+	}
+
+	/* Parse reply */
+	if ( ( rc = nfs_get_read_reply ( &read_reply, reply ) ) != 0 )
+		return rc;
+	DBGC ( nfs, "NFS_OPEN %p got READ reply (%#llx+%#x%s)\n", nfs,
+	       ( ( unsigned long long ) read->offset ), read_reply.count,
+	       ( read_reply.eof ? " EOF" : "" ) );
+	if ( read_reply.count > read->count )
+		return -EPROTO;
+	if ( ( read_reply.count == 0 ) && ! read_reply.eof &&
+	     ( read->offset < nfs->filesize ) )
+		return -EPROTO;
+
+	/* Record file size */
+	if ( read_reply.eof &&
+	     ( ( read->offset + read_reply.count ) < nfs->filesize ) )
+		nfs->filesize = ( read->offset + read_reply.count );
+	if ( read_reply.filesize && ( read_reply.filesize < nfs->filesize ) )
+		nfs->filesize = read_reply.filesize;
+	if ( ( ! nfs->sized ) && read_reply.filesize ) {
+		DBGC2 ( nfs, "NFS_OPEN %p size: %llu bytes\n",
+			nfs, read_reply.filesize );
+		xfer_seek ( &nfs->xfer, read_reply.filesize );
+		nfs->sized = 1;
+	}
+
+	/* Prepare to stream data, part of which may be contained
+	 * within the buffered reply.
+	 */
+	len = iob_len ( reply->data );
+	if ( len > read_reply.count )
+		len = read_reply.count;
+	if ( ( read_reply.count - len ) > nfs->record_remaining )
+		return -EPROTO;
+	nfs->record_remaining -= ( read_reply.count - len );
+	nfs->data_offset = read->offset;
+	nfs->remaining = read_reply.count;
+
+	/* Update request, reissuing the remainder after a short read */
+	read->offset += read_reply.count;
+	read->count -= read_reply.count;
+	read->xid = 0;
+	if ( read->offset >= nfs->filesize )
+		read->count = 0;
+
+	/* Deliver any data contained within the buffered reply */
+	if ( len && ( ( rc = nfs_read_data ( nfs, reply->data,
+					     len ) ) != 0 ) )
+		return rc;
+
+	return 0;
+}
+
+/**
+ * Handle complete (buffered portion of) reply
+ *
+ * @v nfs		NFS request
+ * @v io_buf		I/O buffer containing reply
+ * @ret rc		Return status code
+ */
+static int nfs_reply ( struct nfs_request *nfs, struct io_buffer *io_buf ) {
 	struct oncrpc_reply     reply;
+	int                     rc;
 
-	if ( nfs->remaining == 0 ) {
-		oncrpc_get_reply ( &nfs->nfs_session, &reply, io_buf );
-		if ( reply.accept_state != 0 ) {
-			rc = -EPROTO;
-			goto err;
+	oncrpc_get_reply ( &nfs->nfs_session, &reply, io_buf );
+	if ( reply.accept_state != 0 )
+		return -EPROTO;
+
+	if ( nfs->nfs_state == NFS_FSINFO_SENT ) {
+		struct nfs_fsinfo_reply fsinfo_reply;
+
+		DBGC ( nfs, "NFS_OPEN %p got FSINFO reply\n", nfs );
+
+		/* Fall back to default read size on failure */
+		rc = nfs_get_fsinfo_reply ( &fsinfo_reply, &reply );
+		if ( ( rc == 0 ) && fsinfo_reply.rtmax ) {
+			nfs->rsize = fsinfo_reply.rtmax;
+			if ( nfs->rsize > NFS_MAX_RSIZE )
+				nfs->rsize = NFS_MAX_RSIZE;
 		}
+		DBGC ( nfs, "NFS_OPEN %p using read size %#x\n",
+		       nfs, nfs->rsize );
+		nfs->server->rsize = nfs->rsize;
+
+		nfs->nfs_state = NFS_LOOKUP;
+		nfs_step ( nfs );
+		return 0;
 	}
 
 	if ( nfs->nfs_state == NFS_LOOKUP_SENT ) {
@@ -437,23 +901,33 @@ static int nfs_deliver ( struct nfs_request *nfs,
 		DBGC ( nfs, "NFS_OPEN %p got LOOKUP reply\n", nfs );
 
 		rc = nfs_get_lookup_reply ( &lookup_reply, &reply );
-		if ( rc != 0 )
-			goto err;
+		if ( rc != 0 ) {
+			/* Discard cached handles if any have gone stale */
+			if ( rc == -ESTALE )
+				nfs_handle_flush ( nfs->server );
+			return rc;
+		}
 
 		if ( lookup_reply.ent_type == NFS_ATTR_SYMLINK ) {
 			nfs->readlink_fh = lookup_reply.fh;
 			nfs->nfs_state   = NFS_READLINK;
+			/* Directory path is no longer known */
+			free ( nfs->dir );
+			nfs->dir = NULL;
 		} else {
 			nfs->current_fh = lookup_reply.fh;
 
-			if ( nfs->uri.lookup_pos[0] == '\0' )
+			if ( nfs->uri.lookup_pos[0] == '\0' ) {
 				nfs->nfs_state = NFS_READ;
-			else
+			} else {
+				nfs_enter ( nfs, nfs->component,
+					    &lookup_reply.fh );
 				nfs->nfs_state--;
+			}
 		}
 
 		nfs_step ( nfs );
-		goto done;
+		return 0;
 	}
 
 	if ( nfs->nfs_state == NFS_READLINK_SENT ) {
@@ -464,20 +938,14 @@ static int nfs_deliver ( struct nfs_request *nfs,
 
 		rc = nfs_get_readlink_reply ( &readlink_reply, &reply );
 		if ( rc != 0 )
-			goto err;
+			return rc;
 
 		if ( readlink_reply.path_len == 0 )
-		{
-			rc = -EINVAL;
-			goto err;
-		}
+			return -EINVAL;
 
 		if ( ! ( path = strndup ( readlink_reply.path,
 		                          readlink_reply.path_len ) ) )
-		{
-			rc = -ENOMEM;
-			goto err;
-		}
+			return -ENOMEM;
 
 		nfs_uri_symlink ( &nfs->uri, path );
 		free ( path );
@@ -487,66 +955,122 @@ static int nfs_deliver ( struct nfs_request *nfs,
 
 		nfs->nfs_state = NFS_LOOKUP;
 		nfs_step ( nfs );
-		goto done;
+		return 0;
 	}
 
-	if ( nfs->nfs_state == NFS_READ_SENT ) {
-		if ( nfs->remaining == 0 ) {
-			DBGC ( nfs, "NFS_OPEN %p got READ reply\n", nfs );
-
-			struct nfs_read_reply read_reply;
+	if ( nfs->nfs_state == NFS_READ ) {
+		if ( ( rc = nfs_read_reply ( nfs, &reply ) ) != 0 )
+			return rc;
+		nfs_read_check ( nfs );
+		return 0;
+	}
 
-			rc = nfs_get_read_reply ( &read_reply, &reply );
-			if ( rc != 0 )
-				goto err;
+	return -EPROTO;
+}
 
-			if ( nfs->file_offset == 0 ) {
-				DBGC2 ( nfs, "NFS_OPEN %p size: %llu bytes\n",
-				        nfs, read_reply.filesize );
+/**
+ * Receive data from NFS server
+ *
+ * @v nfs		NFS request
+ * @v io_buf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ *
+ * Replies are reassembled from the TCP byte stream using the ONC RPC
+ * record marking.  Replies other than READ replies are buffered in
+ * their entirety.  For READ replies, only the header is buffered and
+ * the file data is streamed directly to the data transfer interface.
+ */
+static int nfs_deliver ( struct nfs_request *nfs,
+                         struct io_buffer *io_buf,
+                         struct xfer_metadata *meta __unused ) {
+	uint32_t                marker;
+	size_t                  record_len;
+	size_t                  max_len;
+	size_t                  len;
+	int                     rc;
 
-				xfer_seek ( &nfs->xfer, read_reply.filesize );
-				xfer_seek ( &nfs->xfer, 0 );
+	while ( io_buf && iob_len ( io_buf ) ) {
+
+		/* Stream READ reply data, if applicable */
+		if ( nfs->remaining ) {
+			len = iob_len ( io_buf );
+			if ( len > nfs->remaining )
+				len = nfs->remaining;
+			if ( len == iob_len ( io_buf ) ) {
+				/* Entire I/O buffer is consumed */
+				rc = nfs_read_data ( nfs, iob_disown ( io_buf ),
+						     len );
+			} else {
+				rc = nfs_read_data ( nfs, io_buf, len );
 			}
-
-			nfs->file_offset += read_reply.count;
-			nfs->remaining    = read_reply.count;
-			nfs->eof          = read_reply.eof;
+			if ( rc != 0 )
+				goto err;
+			nfs_read_check ( nfs );
+			continue;
 		}
 
-		size_t len = iob_len ( io_buf );
-		if ( len > nfs->remaining )
-			iob_unput ( io_buf, len - nfs->remaining );
-
-		nfs->remaining -= iob_len ( io_buf );
-
-		DBGC ( nfs, "NFS_OPEN %p got %zd bytes\n", nfs,
-		       iob_len ( io_buf ) );
-
-		rc = xfer_deliver_iob ( &nfs->xfer, iob_disown ( io_buf ) );
-		if ( rc != 0 )
-			goto err;
+		/* Discard any unused remainder of the current record */
+		if ( nfs->record_remaining ) {
+			len = iob_len ( io_buf );
+			if ( len > nfs->record_remaining )
+				len = nfs->record_remaining;
+			iob_pull ( io_buf, len );
+			nfs->record_remaining -= len;
+			continue;
+		}
 
-		if ( nfs->remaining == 0 ) {
-			if ( ! nfs->eof ) {
-				nfs->nfs_state--;
-				nfs_step ( nfs );
-			} else {
-				intf_shutdown ( &nfs->nfs_intf, 0 );
-				nfs->nfs_state++;
-				nfs->mount_state++;
-				nfs_mount_step ( nfs );
+		/* Accumulate record marker or buffered reply */
+		len = ( ( nfs->reply_len ? nfs->reply_len : sizeof ( marker ) )
+			- iob_len ( nfs->reply ) );
+		if ( len > iob_len ( io_buf ) )
+			len = iob_len ( io_buf );
+		memcpy ( iob_put ( nfs->reply, len ), io_buf->data, len );
+		iob_pull ( io_buf, len );
+
+		/* Parse record marker, if complete */
+		if ( ( ! nfs->reply_len ) &&
+		     ( iob_len ( nfs->reply ) == sizeof ( marker ) ) ) {
+			memcpy ( &marker, nfs->reply->data, sizeof ( marker ) );
+			marker = ntohl ( marker );
+			if ( ! ( marker & NFS_LAST_FRAGMENT ) ) {
+				DBGC ( nfs, "NFS_OPEN %p fragmented replies "
+				       "not supported\n", nfs );
+				rc = -ENOTSUP;
+				goto err;
 			}
+			record_len = ( marker & ~NFS_LAST_FRAGMENT );
+			max_len = ( ( nfs->nfs_state == NFS_READ ) ?
+				    NFS_READ_PREFIX_LEN : NFS_MAX_REPLY_LEN );
+			if ( record_len > max_len ) {
+				if ( nfs->nfs_state != NFS_READ ) {
+					rc = -E2BIG;
+					goto err;
+				}
+				nfs->record_remaining = ( record_len - max_len );
+				record_len = max_len;
+			}
+			nfs->reply_len = ( sizeof ( marker ) + record_len );
 		}
 
-		return 0;
+		/* Handle reply, if complete */
+		if ( nfs->reply_len &&
+		     ( iob_len ( nfs->reply ) == nfs->reply_len ) ) {
+			nfs->reply_len = 0;
+			rc = nfs_reply ( nfs, nfs->reply );
+			iob_empty ( nfs->reply );
+			if ( rc != 0 )
+				goto err;
+		}
 	}
 
-	rc = -EPROTO;
-err:
-	nfs_done ( nfs, rc );
-done:
 	free_iob ( io_buf );
 	return 0;
+
+ err:
+	free_iob ( io_buf );
+	nfs_done ( nfs, rc );
+	return rc;
 }
 
 /*****************************************************************************
@@ -620,6 +1144,59 @@ err_hostname:
 	return rc;
 }
 
+/**
+ * Connect using cached server information
+ *
+ * @v nfs		NFS request
+ * @v uri		Uniform Resource Identifier
+ * @ret rc		Return status code (-ENOENT if nothing is cached)
+ */
+static int nfs_connect_cached ( struct nfs_request *nfs,
+				const struct uri *uri ) {
+	struct nfs_server *server = nfs->server;
+	struct nfs_handle *handle;
+	int rc;
+
+	/* Do nothing unless port mapper results are cached */
+	if ( ! ( server->mount_port && server->nfs_port ) )
+		return -ENOENT;
+	nfs->pm_state = MFS_PORTMAP_CLOSED;
+
+	/* Connect to NFS daemon */
+	DBGC ( nfs, "NFS_OPEN %p connecting to cached NFS port (%s:%d)\n",
+	       nfs, nfs->hostname, server->nfs_port );
+	if ( ( rc = nfs_connect ( &nfs->nfs_intf, server->nfs_port,
+				  nfs->hostname ) ) != 0 )
+		return rc;
+
+	/* Find deepest cached directory containing the file */
+	while ( ! ( handle = nfs_handle_find ( server,
+				nfs_uri_mountpoint ( &nfs->uri ) ) ) ) {
+		if ( nfs_uri_next_mountpoint ( &nfs->uri ) != 0 )
+			break;
+	}
+
+	/* Use cached directory, if found */
+	if ( handle ) {
+		DBGC ( nfs, "NFS_OPEN %p using cached handle for %s\n",
+		       nfs, handle->path );
+		nfs->current_fh = handle->fh;
+		nfs->dir = strdup ( handle->path );
+		nfs->mount_state = NFS_MOUNT_CLOSED;
+		nfs_start ( nfs );
+		return 0;
+	}
+
+	/* Otherwise, restore original path and mount the export */
+	nfs_uri_free ( &nfs->uri );
+	if ( ( rc = nfs_uri_init ( &nfs->uri, uri ) ) != 0 )
+		return rc;
+	DBGC ( nfs, "NFS_OPEN %p connecting to cached mount port (%s:%d)\n",
+	       nfs, nfs->hostname, server->mount_port );
+	return nfs_connect ( &nfs->mount_intf, server->mount_port,
+			     nfs->hostname );
+}
+
 /**
  * Initiate a NFS connection
  *
@@ -634,6 +1211,14 @@ static int nfs_open ( struct interface *xfer, struct uri *uri ) {
 	nfs = zalloc ( sizeof ( *nfs ) );
 	if ( ! nfs )
 		return -ENOMEM;
+	nfs->rsize = NFS_RSIZE;
+	nfs->filesize = ~( ( uint64_t ) 0 );
+
+	nfs->reply = alloc_iob ( sizeof ( uint32_t ) + NFS_MAX_REPLY_LEN );
+	if ( ! nfs->reply ) {
+		rc = -ENOMEM;
+		goto err_reply;
+	}
 
 	rc = nfs_parse_uri( nfs, uri );
 	if ( rc != 0 )
@@ -653,10 +1238,19 @@ static int nfs_open ( struct interface *xfer, struct uri *uri ) {
 	mount_init_session ( &nfs->mount_session, &nfs->auth_sys.credential );
 	nfs_init_session ( &nfs->nfs_session, &nfs->auth_sys.credential );
 
-	DBGC ( nfs, "NFS_OPEN %p connecting to port mapper (%s:%d)...\n", nfs,
-	       nfs->hostname, PORTMAP_PORT );
+	nfs->server = nfs_server ( nfs->hostname );
+	if ( ! nfs->server ) {
+		rc = -ENOMEM;
+		goto err_server;
+	}
 
-	rc = nfs_connect ( &nfs->pm_intf, PORTMAP_PORT, nfs->hostname );
+	rc = nfs_connect_cached ( nfs, uri );
+	if ( rc == -ENOENT ) {
+		DBGC ( nfs, "NFS_OPEN %p connecting to port mapper "
+		       "(%s:%d)...\n", nfs, nfs->hostname, PORTMAP_PORT );
+		rc = nfs_connect ( &nfs->pm_intf, PORTMAP_PORT,
+				   nfs->hostname );
+	}
 	if ( rc != 0 )
 		goto err_connect;
 
@@ -667,11 +1261,17 @@ static int nfs_open ( struct interface *xfer, struct uri *uri ) {
 	return 0;
 
 err_connect:
+	intf_shutdown ( &nfs->nfs_intf, rc );
+	intf_shutdown ( &nfs->mount_intf, rc );
+	intf_shutdown ( &nfs->pm_intf, rc );
+err_server:
 	free ( nfs->auth_sys.hostname );
 err_cred:
 	nfs_uri_free ( &nfs->uri );
 	free ( nfs->hostname );
 err_uri:
+	free_iob ( nfs->reply );
+err_reply:
 	free ( nfs );
 	return rc;
 }
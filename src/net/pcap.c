@@ -0,0 +1,347 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * Packet capture
+ *
+ * Packets transmitted and received by network devices may be
+ * captured into a fixed-size ring of fixed-size slots in external
+ * memory.  Each slot holds a timestamped, truncated copy of a single
+ * packet.  Once the ring is full, the oldest packets are overwritten.
+ * The ring contents may be exported in pcapng format for analysis
+ * using standard tools.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/netdevice.h>
+#include <ipxe/umalloc.h>
+#include <ipxe/timer.h>
+#include <ipxe/pcap.h>
+
+/** A network device within a capture */
+struct pcap_interface {
+	/** Link type (or zero if unused) */
+	uint16_t linktype;
+	/** Name */
+	char name[NETDEV_NAME_LEN];
+};
+
+/** A packet capture ring */
+struct pcap_ring {
+	/** Packet slots */
+	userptr_t data;
+	/** Number of packet slots */
+	unsigned int count;
+	/** Length of each packet slot */
+	size_t slot_len;
+	/** Number of bytes captured from each packet */
+	size_t snaplen;
+	/** Producer counter */
+	unsigned int prod;
+	/** Capture is in progress */
+	int running;
+	/** Timer tick count at start of capture */
+	unsigned long start_ticks;
+	/** Wall-clock time at start of capture */
+	time_t start_time;
+	/** Network devices */
+	struct pcap_interface interfaces[PCAP_MAX_INTERFACES];
+};
+
+/** Packet capture ring */
+static struct pcap_ring pcap;
+
+/**
+ * Identify link type of network device
+ *
+ * @v netdev		Network device
+ * @ret linktype	pcap link type
+ */
+static unsigned int pcap_linktype ( struct net_device *netdev ) {
+	const char *name = netdev->ll_protocol->name;
+
+	if ( strcmp ( name, "Ethernet" ) == 0 )
+		return LINKTYPE_ETHERNET;
+	if ( strcmp ( name, "802.11" ) == 0 )
+		return LINKTYPE_IEEE802_11;
+	return LINKTYPE_USER0;
+}
+
+/**
+ * Capture packet
+ *
+ * @v netdev		Network device
+ * @v iobuf		I/O buffer
+ * @v direction		Direction
+ */
+void pcap_capture ( struct net_device *netdev, struct io_buffer *iobuf,
+		    unsigned int direction ) {
+	struct pcap_interface *interface;
+	struct pcap_packet packet;
+	size_t len = iob_len ( iobuf );
+	off_t offset;
+
+	/* Do nothing unless capture is in progress */
+	if ( ! pcap.running )
+		return;
+
+	/* Identify interface */
+	if ( netdev->index >= PCAP_MAX_INTERFACES )
+		return;
+	interface = &pcap.interfaces[netdev->index];
+	if ( ! interface->linktype ) {
+		interface->linktype = pcap_linktype ( netdev );
+		memcpy ( interface->name, netdev->name,
+			 sizeof ( interface->name ) );
+	}
+
+	/* Construct packet header */
+	packet.ticks = currticks();
+	packet.len = len;
+	packet.caplen = ( ( len < pcap.snaplen ) ? len : pcap.snaplen );
+	packet.interface = netdev->index;
+	packet.direction = direction;
+
+	/* Record packet, overwriting the oldest if necessary */
+	offset = ( ( pcap.prod++ % pcap.count ) * pcap.slot_len );
+	copy_to_user ( pcap.data, offset, &packet, sizeof ( packet ) );
+	copy_to_user ( pcap.data, ( offset + sizeof ( packet ) ), iobuf->data,
+		       packet.caplen );
+}
+
+/**
+ * Discard captured packets
+ *
+ */
+void pcap_clear ( void ) {
+
+	pcap.running = 0;
+	ufree ( pcap.data );
+	memset ( &pcap, 0, sizeof ( pcap ) );
+}
+
+/**
+ * Start packet capture
+ *
+ * @v count		Number of packets to retain
+ * @v snaplen		Number of bytes to capture from each packet
+ * @ret rc		Return status code
+ *
+ * Any previously captured packets will be discarded.
+ */
+int pcap_start ( unsigned int count, size_t snaplen ) {
+	size_t slot_len;
+
+	/* Sanity check */
+	if ( ( ! count ) || ( ! snaplen ) || ( snaplen > 0xffff ) )
+		return -EINVAL;
+
+	/* Discard any existing capture */
+	pcap_clear();
+
+	/* Allocate ring */
+	slot_len = ( ( sizeof ( struct pcap_packet ) + snaplen + 3 ) & ~3 );
+	pcap.data = umalloc ( count * slot_len );
+	if ( ! pcap.data )
+		return -ENOMEM;
+	pcap.count = count;
+	pcap.slot_len = slot_len;
+	pcap.snaplen = snaplen;
+
+	/* Start capture */
+	pcap.start_time = time ( NULL );
+	pcap.start_ticks = currticks();
+	pcap.running = 1;
+	DBGC ( &pcap, "PCAP capturing %d packets of up to %zd bytes\n",
+	       count, snaplen );
+
+	return 0;
+}
+
+/**
+ * Stop packet capture
+ *
+ * Captured packets are retained until the next call to pcap_start()
+ * or pcap_clear().
+ */
+void pcap_stop ( void ) {
+
+	pcap.running = 0;
+}
+
+/**
+ * Get packet capture statistics
+ *
+ * @v stats		Statistics to fill in
+ */
+void pcap_statistics ( struct pcap_statistics *stats ) {
+
+	stats->running = pcap.running;
+	stats->count = pcap.count;
+	stats->snaplen = pcap.snaplen;
+	if ( pcap.prod > pcap.count ) {
+		stats->retained = pcap.count;
+		stats->dropped = ( pcap.prod - pcap.count );
+	} else {
+		stats->retained = pcap.prod;
+		stats->dropped = 0;
+	}
+}
+
+/**
+ * Append data to exported capture
+ *
+ * @v data		Export buffer
+ * @v len		Length of export buffer
+ * @v offset		Offset within export buffer
+ * @v src		Source data
+ * @v src_off		Offset within source data
+ * @v src_len		Length of source data
+ * @ret offset		New offset within export buffer
+ */
+static size_t pcap_append ( userptr_t data, size_t len, size_t offset,
+			    userptr_t src, off_t src_off, size_t src_len ) {
+
+	if ( ( offset + src_len ) <= len )
+		memcpy_user ( data, offset, src, src_off, src_len );
+	return ( offset + src_len );
+}
+
+/**
+ * Export captured packets in pcapng format
+ *
+ * @v data		Export buffer
+ * @v len		Length of export buffer
+ * @ret len		Length of exported capture
+ *
+ * The export buffer may be too small (or UNULL) to hold the exported
+ * capture, in which case the exported capture will be truncated, and
+ * the returned length may be used to allocate a sufficiently large
+ * buffer.
+ */
+size_t pcap_export ( userptr_t data, size_t len ) {
+	static const uint8_t zero[3];
+	struct pcap_interface *interface;
+	struct pcapng_shb shb;
+	struct pcapng_idb idb;
+	struct pcapng_epb epb;
+	struct pcapng_epb_options opts;
+	struct pcap_packet packet;
+	uint8_t ids[PCAP_MAX_INTERFACES];
+	unsigned long long usecs;
+	unsigned int first;
+	unsigned int id;
+	unsigned int i;
+	size_t offset;
+	size_t pad_len;
+	off_t slot;
+
+	/* Construct section header block */
+	memset ( &shb, 0, sizeof ( shb ) );
+	shb.hdr.type = PCAPNG_SHB;
+	shb.hdr.len = sizeof ( shb );
+	shb.magic = PCAPNG_MAGIC;
+	shb.major = 1;
+	shb.section_len = -1LL;
+	shb.trailer.len = sizeof ( shb );
+	offset = pcap_append ( data, len, 0, virt_to_user ( &shb ), 0,
+			       sizeof ( shb ) );
+
+	/* Construct interface description blocks */
+	for ( id = 0, i = 0 ; i < PCAP_MAX_INTERFACES ; i++ ) {
+		interface = &pcap.interfaces[i];
+		if ( ! interface->linktype )
+			continue;
+		ids[i] = id++;
+		memset ( &idb, 0, sizeof ( idb ) );
+		idb.hdr.type = PCAPNG_IDB;
+		idb.hdr.len = sizeof ( idb );
+		idb.linktype = interface->linktype;
+		idb.snaplen = pcap.snaplen;
+		idb.name_opt.code = PCAPNG_IF_NAME;
+		idb.name_opt.len = sizeof ( idb.name );
+		strncpy ( idb.name, interface->name,
+			  ( sizeof ( idb.name ) - 1 /* NUL */ ) );
+		idb.tsresol_opt.code = PCAPNG_IF_TSRESOL;
+		idb.tsresol_opt.len = 1;
+		idb.tsresol[0] = 6; /* Microseconds */
+		idb.trailer.len = sizeof ( idb );
+		offset = pcap_append ( data, len, offset, virt_to_user ( &idb ),
+				       0, sizeof ( idb ) );
+	}
+
+	/* Construct enhanced packet blocks, oldest first */
+	first = ( ( pcap.prod > pcap.count ) ? ( pcap.prod - pcap.count ) : 0 );
+	for ( i = first ; i != pcap.prod ; i++ ) {
+
+		/* Read packet header */
+		slot = ( ( i % pcap.count ) * pcap.slot_len );
+		copy_from_user ( &packet, pcap.data, slot, sizeof ( packet ) );
+		pad_len = ( ( -packet.caplen ) & 3 );
+
+		/* Construct block header */
+		usecs = ( ( ( ( unsigned long long ) pcap.start_time ) *
+			    1000000ULL ) +
+			  ( ( ( unsigned long long )
+			      ( packet.ticks - pcap.start_ticks ) ) *
+			    1000000ULL / TICKS_PER_SEC ) );
+		memset ( &epb, 0, sizeof ( epb ) );
+		epb.hdr.type = PCAPNG_EPB;
+		epb.hdr.len = ( sizeof ( epb ) + packet.caplen + pad_len +
+				sizeof ( opts ) );
+		epb.interface = ids[packet.interface];
+		epb.ts_high = ( usecs >> 32 );
+		epb.ts_low = usecs;
+		epb.caplen = packet.caplen;
+		epb.len = packet.len;
+		offset = pcap_append ( data, len, offset, virt_to_user ( &epb ),
+				       0, sizeof ( epb ) );
+
+		/* Copy packet data */
+		offset = pcap_append ( data, len, offset, pcap.data,
+				       ( slot + sizeof ( packet ) ),
+				       packet.caplen );
+		offset = pcap_append ( data, len, offset, virt_to_user ( zero ),
+				       0, pad_len );
+
+		/* Construct options and block trailer */
+		memset ( &opts, 0, sizeof ( opts ) );
+		opts.flags_opt.code = PCAPNG_EPB_FLAGS;
+		opts.flags_opt.len = sizeof ( opts.flags );
+		opts.flags = packet.direction;
+		opts.trailer.len = epb.hdr.len;
+		offset = pcap_append ( data, len, offset, virt_to_user ( &opts ),
+				       0, sizeof ( opts ) );
+	}
+
+	return offset;
+}
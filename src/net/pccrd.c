@@ -157,6 +157,7 @@ static char * peerdist_discovery_reply_tag ( char *data, size_t len,
 static char * peerdist_discovery_reply_values ( char *data, size_t len,
 						const char *name ) {
 	char buf[ 2 /* "</" */ + strlen ( name ) + 1 /* ">" */ + 1 /* NUL */ ];
+	size_t buf_len;
 	char *open;
 	char *close;
 	char *start;
@@ -165,12 +166,24 @@ static char * peerdist_discovery_reply_values ( char *data, size_t len,
 	char *out;
 	char c;
 
-	/* Locate opening tag */
-	snprintf ( buf, sizeof ( buf ), "<%s>", name );
-	open = peerdist_discovery_reply_tag ( data, len, buf );
-	if ( ! open )
+	/* Locate opening tag, allowing for the presence of attributes
+	 * (e.g. the "MatchBy" attribute within a Probe's scopes)
+	 */
+	snprintf ( buf, sizeof ( buf ), "<%s", name );
+	buf_len = strlen ( buf );
+	while ( 1 ) {
+		open = peerdist_discovery_reply_tag ( data, len, buf );
+		if ( ! open )
+			return NULL;
+		len -= ( open + buf_len - data );
+		data = ( open + buf_len );
+		if ( len && ( ( *data == '>' ) || isspace ( *data ) ) )
+			break;
+	}
+	end = memchr ( data, '>', len );
+	if ( ! end )
 		return NULL;
-	start = ( open + strlen ( buf ) );
+	start = ( end + 1 );
 	len -= ( start - data );
 	data = start;
 
@@ -284,3 +297,138 @@ int peerdist_discovery_reply ( char *data, size_t len,
 
 	return 0;
 }
+
+/** Discovery probe action */
+#define PEERDIST_DISCOVERY_PROBE_ACTION \
+	"http://schemas.xmlsoap.org/ws/2005/04/discovery/Probe"
+
+/**
+ * Parse discovery probe
+ *
+ * @v data		Probe data (not NUL-terminated, will be modified)
+ * @v len		Length of probe data
+ * @v probe		Discovery probe to fill in
+ * @ret rc		Return status code
+ *
+ * The discovery probe includes pointers to strings within the
+ * modified probe data.
+ */
+int peerdist_discovery_probe ( char *data, size_t len,
+			       struct peerdist_discovery_probe *probe ) {
+	char *action;
+	char *id;
+	char *scopes;
+
+	/* Find <wsa:Action> tag, and ignore anything other than a Probe */
+	action = peerdist_discovery_reply_values ( data, len, "wsa:Action" );
+	if ( ! action ) {
+		DBGC ( probe, "PCCRD %p missing <wsa:Action> tag\n", probe );
+		return -ENOENT;
+	}
+	if ( strcmp ( action, PEERDIST_DISCOVERY_PROBE_ACTION ) != 0 ) {
+		DBGC2 ( probe, "PCCRD %p ignoring action %s\n", probe, action );
+		return -ENOTSUP;
+	}
+
+	/* Find <wsa:MessageID> tag */
+	id = peerdist_discovery_reply_values ( data, len, "wsa:MessageID" );
+	if ( ! ( id && *id ) ) {
+		DBGC ( probe, "PCCRD %p missing <wsa:MessageID> tag\n", probe );
+		return -ENOENT;
+	}
+
+	/* Find <wsd:Scopes> tag */
+	scopes = peerdist_discovery_reply_values ( data, len, "wsd:Scopes" );
+	if ( ! scopes ) {
+		DBGC ( probe, "PCCRD %p missing <wsd:Scopes> tag\n", probe );
+		return -ENOENT;
+	}
+
+	/* Fill in discovery probe */
+	probe->id = id;
+	probe->ids = scopes;
+
+	return 0;
+}
+
+/** Discovery probe match format */
+#define PEERDIST_DISCOVERY_MATCH					      \
+	"<?xml version=\"1.0\" encoding=\"utf-8\"?>"			      \
+	"<soap:Envelope "						      \
+	    "xmlns:soap=\"http://www.w3.org/2003/05/soap-envelope\" "	      \
+	    "xmlns:wsa=\"http://schemas.xmlsoap.org/ws/2004/08/addressing\" " \
+	    "xmlns:wsd=\"http://schemas.xmlsoap.org/ws/2005/04/discovery\" "  \
+	    "xmlns:PeerDist=\"http://schemas.microsoft.com/p2p/"	      \
+			     "2007/09/PeerDistributionDiscovery\">"	      \
+	  "<soap:Header>"						      \
+	    "<wsa:To>"							      \
+	      "http://schemas.xmlsoap.org/ws/2004/08/addressing/"	      \
+	      "role/anonymous"						      \
+	    "</wsa:To>"							      \
+	    "<wsa:Action>"						      \
+	      "http://schemas.xmlsoap.org/ws/2005/04/discovery/ProbeMatches"  \
+	    "</wsa:Action>"						      \
+	    "<wsa:MessageID>"						      \
+	      "urn:uuid:%s"						      \
+	    "</wsa:MessageID>"						      \
+	    "<wsa:RelatesTo>"						      \
+	      "%s"							      \
+	    "</wsa:RelatesTo>"						      \
+	  "</soap:Header>"						      \
+	  "<soap:Body>"							      \
+	    "<wsd:ProbeMatches>"					      \
+	      "<wsd:ProbeMatch>"					      \
+		"<wsa:EndpointReference>"				      \
+		  "<wsa:Address>"					      \
+		    "urn:uuid:%s"					      \
+		  "</wsa:Address>"					      \
+		"</wsa:EndpointReference>"				      \
+		"<wsd:Types>"						      \
+		  "PeerDist:PeerDistData"				      \
+		"</wsd:Types>"						      \
+		"<wsd:Scopes>"						      \
+		  "%s"							      \
+		"</wsd:Scopes>"						      \
+		"<wsd:XAddrs>"						      \
+		  "%s"							      \
+		"</wsd:XAddrs>"						      \
+		"<wsd:MetadataVersion>"					      \
+		  "1"							      \
+		"</wsd:MetadataVersion>"				      \
+		"<PeerDist:PeerDistData>"				      \
+		  "<PeerDist:BlockCount>"				      \
+		    "%s"						      \
+		  "</PeerDist:BlockCount>"				      \
+		"</PeerDist:PeerDistData>"				      \
+	      "</wsd:ProbeMatch>"					      \
+	    "</wsd:ProbeMatches>"					      \
+	  "</soap:Body>"						      \
+	"</soap:Envelope>"
+
+/**
+ * Construct discovery probe match
+ *
+ * @v uuid		Message UUID string
+ * @v relates		Message ID of the probe being answered
+ * @v ids		Space-separated list of segment identifier strings
+ * @v location		Peer location
+ * @v counts		Concatenated block counts (one per segment)
+ * @ret match		Discovery probe match, or NULL on failure
+ *
+ * The probe match is dynamically allocated; the caller must
+ * eventually free() the probe match.
+ */
+char * peerdist_discovery_match ( const char *uuid, const char *relates,
+				  const char *ids, const char *location,
+				  const char *counts ) {
+	char *match;
+	int len;
+
+	/* Construct probe match */
+	len = asprintf ( &match, PEERDIST_DISCOVERY_MATCH, uuid, relates,
+			 uuid, ids, location, counts );
+	if ( len < 0 )
+		return NULL;
+
+	return match;
+}
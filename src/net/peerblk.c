@@ -72,6 +72,17 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  */
 #define PEERBLK_RETRIEVAL_RX_TIMEOUT ( 5 * TICKS_PER_SEC )
 
+/** PeerDist retrieval protocol block download attempt race delay
+ *
+ * If a retrieval protocol download attempt for a block near the
+ * write frontier has not completed within this time, then we start
+ * a concurrent raw download attempt from the origin server and use
+ * whichever attempt completes first.
+ *
+ * This is a policy decision.
+ */
+#define PEERBLK_RACE_TIMEOUT ( 1 * TICKS_PER_SEC )
+
 /** PeerDist maximum number of full download attempt cycles
  *
  * This is the maximum number of times that we will try a full cycle
@@ -137,12 +148,40 @@ static void peerblk_free ( struct refcnt *refcnt ) {
 }
 
 /**
- * Reset PeerDist block download attempt
+ * Reset PeerDist raced raw block download attempt
  *
  * @v peerblk		PeerDist block download
  * @v rc		Reason for reset
  */
-static void peerblk_reset ( struct peerdist_block *peerblk, int rc ) {
+static void peerblk_race_reset ( struct peerdist_block *peerblk, int rc ) {
+
+	/* Stop timer */
+	stop_timer ( &peerblk->race_timer );
+
+	/* Abort any raced download attempt */
+	intf_restart ( &peerblk->race, rc );
+	peerblk->racing = 0;
+
+	/* Empty received data buffer */
+	xferbuf_free ( &peerblk->race_buffer );
+}
+
+/**
+ * Reset PeerDist block download attempt (excluding any raced attempt)
+ *
+ * @v peerblk		PeerDist block download
+ * @v rc		Reason for reset
+ */
+static void peerblk_reset_attempt ( struct peerdist_block *peerblk, int rc ) {
+	unsigned long now = currticks();
+
+	/* Record peer statistics for any retrieval protocol attempt */
+	if ( peerblk->retrieving ) {
+		peerdisc_finish ( peerblk->peer, rc,
+				  ( peerblk->responded - peerblk->requested ),
+				  peerblk->pos, ( now - peerblk->responded ) );
+		peerblk->retrieving = 0;
+	}
 
 	/* Stop decryption process */
 	process_del ( &peerblk->process );
@@ -170,6 +209,21 @@ static void peerblk_reset ( struct peerdist_block *peerblk, int rc ) {
 	assert ( peerblk->start <= peerblk->end );
 }
 
+/**
+ * Reset PeerDist block download attempt
+ *
+ * @v peerblk		PeerDist block download
+ * @v rc		Reason for reset
+ */
+static void peerblk_reset ( struct peerdist_block *peerblk, int rc ) {
+
+	/* Reset download attempt */
+	peerblk_reset_attempt ( peerblk, rc );
+
+	/* Reset any raced download attempt */
+	peerblk_race_reset ( peerblk, rc );
+}
+
 /**
  * Close PeerDist block download
  *
@@ -190,6 +244,7 @@ static void peerblk_close ( struct peerdist_block *peerblk, int rc ) {
 	peerdisc_close ( &peerblk->discovery );
 
 	/* Shut down all interfaces */
+	intf_shutdown ( &peerblk->race, rc );
 	intf_shutdown ( &peerblk->retrieval, rc );
 	intf_shutdown ( &peerblk->raw, rc );
 	intf_shutdown ( &peerblk->xfer, rc );
@@ -309,12 +364,15 @@ static void peerblk_done ( struct peerdist_block *peerblk, int rc ) {
 	return;
 
  err:
-	/* Record failure reason and schedule a retry attempt */
+	/* Record failure reason and schedule a retry attempt, unless
+	 * a raced download attempt is still in progress.
+	 */
 	profile_custom ( &peerblk_attempt_failure_profiler,
 			 ( now - peerblk->attempted ) );
-	peerblk_reset ( peerblk, rc );
+	peerblk_reset_attempt ( peerblk, rc );
 	peerblk->rc = rc;
-	start_timer_nodelay ( &peerblk->timer );
+	if ( ! peerblk->racing )
+		start_timer_nodelay ( &peerblk->timer );
 }
 
 /******************************************************************************
@@ -623,6 +681,10 @@ static int peerblk_retrieval_rx ( struct peerdist_block *peerblk,
 				      start ) ) != 0 )
 		goto err;
 
+	/* Record time of first response */
+	if ( ! peerblk->pos )
+		peerblk->responded = currticks();
+
 	/* Update position */
 	peerblk->pos = end;
 
@@ -1125,6 +1187,233 @@ static void peerblk_retrieval_close ( struct peerdist_block *peerblk, int rc ) {
 	peerblk_done ( peerblk, rc );
 }
 
+/******************************************************************************
+ *
+ * Raced raw block download attempts (using an HTTP range request)
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Check if PeerDist block download is urgent
+ *
+ * @v intf		Interface
+ * @ret urgent		Block download is urgent
+ */
+int peerblk_urgent ( struct interface *intf ) {
+	struct interface *dest;
+	peerblk_urgent_TYPE ( void * ) *op =
+		intf_get_dest_op ( intf, peerblk_urgent, &dest );
+	void *object = intf_object ( dest );
+	int urgent;
+
+	if ( op ) {
+		urgent = op ( object );
+	} else {
+		/* Default is to treat all block downloads as urgent */
+		urgent = 1;
+	}
+
+	intf_put ( dest );
+	return urgent;
+}
+
+/**
+ * Abandon PeerDist raced raw block download attempt
+ *
+ * @v peerblk		PeerDist block download
+ * @v rc		Reason for abandonment
+ */
+static void peerblk_race_abandon ( struct peerdist_block *peerblk, int rc ) {
+
+	DBGC ( peerblk, "PEERBLK %p %d.%d abandoning raced attempt: %s\n",
+	       peerblk, peerblk->segment, peerblk->block, strerror ( rc ) );
+
+	/* Reset raced download attempt */
+	peerblk_race_reset ( peerblk, rc );
+
+	/* Schedule a retry attempt if there is no other attempt in
+	 * progress.
+	 */
+	if ( ! ( timer_running ( &peerblk->timer ) ||
+		 process_running ( &peerblk->process ) ) ) {
+		start_timer_nodelay ( &peerblk->timer );
+	}
+}
+
+/**
+ * Open PeerDist raced raw block download attempt
+ *
+ * @v peerblk		PeerDist block download
+ * @ret rc		Return status code
+ */
+static int peerblk_race_open ( struct peerdist_block *peerblk ) {
+	struct http_request_range range;
+	int rc;
+
+	DBGC2 ( peerblk, "PEERBLK %p %d.%d racing raw range request\n",
+		peerblk, peerblk->segment, peerblk->block );
+
+	/* Construct HTTP range */
+	memset ( &range, 0, sizeof ( range ) );
+	range.start = peerblk->range.start;
+	range.len = ( peerblk->range.end - peerblk->range.start );
+
+	/* Start streaming digest of received data */
+	xferbuf_digest_init ( &peerblk->race_buffer, peerblk->digest,
+			      peerblk->race_digestctx );
+
+	/* Initiate range request to retrieve block */
+	if ( ( rc = http_open ( &peerblk->race, &http_get, peerblk->uri,
+				&range, NULL ) ) != 0 ) {
+		DBGC ( peerblk, "PEERBLK %p %d.%d could not create raced "
+		       "range request: %s\n", peerblk, peerblk->segment,
+		       peerblk->block, strerror ( rc ) );
+		xferbuf_free ( &peerblk->race_buffer );
+		return rc;
+	}
+	peerblk->racing = 1;
+
+	/* Start raced download attempt timer */
+	start_timer_fixed ( &peerblk->race_timer, PEERBLK_RAW_OPEN_TIMEOUT );
+
+	return 0;
+}
+
+/**
+ * Receive PeerDist raced raw data
+ *
+ * @v peerblk		PeerDist block download
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int peerblk_race_rx ( struct peerdist_block *peerblk,
+			     struct io_buffer *iobuf,
+			     struct xfer_metadata *meta ) {
+	int rc;
+
+	/* Add data to buffer */
+	if ( ( rc = xferbuf_deliver ( &peerblk->race_buffer,
+				      iob_disown ( iobuf ), meta ) ) != 0 ) {
+		peerblk_race_abandon ( peerblk, rc );
+		return rc;
+	}
+
+	/* Extend raced download attempt timer */
+	start_timer_fixed ( &peerblk->race_timer, PEERBLK_RAW_RX_TIMEOUT );
+
+	return 0;
+}
+
+/**
+ * Close PeerDist raced raw block download attempt
+ *
+ * @v peerblk		PeerDist block download
+ * @v rc		Reason for close
+ */
+static void peerblk_race_close ( struct peerdist_block *peerblk, int rc ) {
+	struct digest_algorithm *digest = peerblk->digest;
+	struct peerdisc_segment *segment = peerblk->discovery.segment;
+	struct xfer_buffer *xferbuf = &peerblk->race_buffer;
+	struct xfer_metadata meta;
+	struct io_buffer *iobuf;
+	uint8_t hash[digest->digestsize];
+	size_t len;
+
+	/* Restart interface */
+	intf_restart ( &peerblk->race, rc );
+
+	/* Fail immediately if we have an error */
+	if ( rc != 0 )
+		goto err;
+
+	/* Check length and digest.  The streaming digest will have
+	 * been abandoned if any data was received out of order.
+	 */
+	len = ( peerblk->range.end - peerblk->range.start );
+	if ( ( xferbuf->len != len ) || ( ! xferbuf->digest ) ) {
+		rc = -EIO;
+		goto err;
+	}
+	digest_final ( digest, peerblk->race_digestctx, hash );
+	if ( memcmp ( hash, peerblk->hash, peerblk->digestsize ) != 0 ) {
+		DBGC ( peerblk, "PEERBLK %p %d.%d raced digest mismatch\n",
+		       peerblk, peerblk->segment, peerblk->block );
+		rc = -EIO;
+		goto err;
+	}
+
+	/* The raced attempt has won: abort any other download
+	 * attempt (which also resets the trim thresholds to match
+	 * the raw data stream), treating the peer as having timed out.
+	 */
+	DBGC2 ( peerblk, "PEERBLK %p %d.%d raced attempt won\n",
+		peerblk, peerblk->segment, peerblk->block );
+	peerblk_reset_attempt ( peerblk, -ETIMEDOUT );
+
+	/* Deliver trimmed content */
+	len = ( peerblk->end - peerblk->start );
+	iobuf = alloc_iob ( len );
+	if ( ! iobuf ) {
+		rc = -ENOMEM;
+		goto err;
+	}
+	memcpy ( iob_put ( iobuf, len ), ( xferbuf->data + peerblk->start ),
+		 len );
+	memset ( &meta, 0, sizeof ( meta ) );
+	if ( ( rc = peerblk_deliver ( peerblk, iobuf, &meta,
+				      peerblk->start ) ) != 0 )
+		goto err;
+
+	/* Report peer statistics */
+	peerdisc_stat ( &peerblk->xfer, NULL, &segment->peers );
+
+	/* Close download */
+	peerblk_close ( peerblk, 0 );
+	return;
+
+ err:
+	peerblk_race_abandon ( peerblk, rc );
+}
+
+/**
+ * Handle PeerDist raced attempt timer expiry
+ *
+ * @v timer		Raced attempt timer
+ * @v over		Failure indicator
+ */
+static void peerblk_race_expired ( struct retry_timer *timer,
+				   int over __unused ) {
+	struct peerdist_block *peerblk =
+		container_of ( timer, struct peerdist_block, race_timer );
+
+	/* Abandon any stalled raced attempt */
+	if ( peerblk->racing ) {
+		peerblk_race_abandon ( peerblk, -ETIMEDOUT );
+		return;
+	}
+
+	/* Do nothing if the retrieval protocol attempt has already
+	 * finished receiving data.
+	 */
+	if ( process_running ( &peerblk->process ) ||
+	     ( ! timer_running ( &peerblk->timer ) ) )
+		return;
+
+	/* Check again later if this block is not (yet) urgent */
+	if ( ! peerblk_urgent ( &peerblk->xfer ) ) {
+		start_timer_fixed ( &peerblk->race_timer,
+				    PEERBLK_RACE_TIMEOUT );
+		return;
+	}
+
+	/* Race the slow peer against the origin server.  Failure is
+	 * non-fatal, since the retrieval protocol attempt continues.
+	 */
+	peerblk_race_open ( peerblk );
+}
+
 /******************************************************************************
  *
  * Retry policy
@@ -1143,8 +1432,9 @@ static void peerblk_expired ( struct retry_timer *timer, int over __unused ) {
 		container_of ( timer, struct peerdist_block, timer );
 	struct peerdisc_segment *segment = peerblk->discovery.segment;
 	struct peerdisc_peer *head;
+	struct peerdisc_peer *peer;
 	unsigned long now = peerblk_timestamp();
-	const char *location;
+	size_t len;
 	int rc;
 
 	/* Profile discovery timeout, if applicable */
@@ -1165,6 +1455,15 @@ static void peerblk_expired ( struct retry_timer *timer, int over __unused ) {
 		       timer->timeout );
 	}
 
+	/* If a raced download attempt is in progress, then abandon
+	 * only the timed-out attempt and wait for the raced attempt.
+	 */
+	if ( peerblk->racing ) {
+		peerblk_reset_attempt ( peerblk, -ETIMEDOUT );
+		peerblk->rc = -ETIMEDOUT;
+		return;
+	}
+
 	/* Abort any current download attempt */
 	peerblk_reset ( peerblk, -ETIMEDOUT );
 
@@ -1184,31 +1483,46 @@ static void peerblk_expired ( struct retry_timer *timer, int over __unused ) {
 		goto err;
 	}
 
-	/* If we have not yet made any download attempts, then move to
-	 * the start of the peer list.
+	/* If we have not yet made any download attempts, or have just
+	 * made a raw download attempt, then start a new cycle.
 	 */
-	if ( peerblk->peer == NULL )
-		peerblk->peer = head;
+	if ( ( peerblk->peer == NULL ) || ( peerblk->peer == head ) )
+		peerblk->attempts = 0;
+
+	/* Attempt retrieval protocol download from best untried peer */
+	len = ( peerblk->range.end - peerblk->range.start );
+	while ( peerblk->attempts < PEERBLK_MAX_PEER_ATTEMPTS ) {
 
-	/* Attempt retrieval protocol download from next usable peer */
-	list_for_each_entry_continue ( peerblk->peer, &segment->peers, list ) {
+		/* Select best untried peer */
+		peer = peerdisc_select ( segment, len, peerblk->tried,
+					 peerblk->attempts );
+		if ( ! peer )
+			break;
+		peerblk->tried[ peerblk->attempts++ ] = peer;
+		peerblk->peer = peer;
 
 		/* Attempt retrieval protocol download from this peer */
-		location = peerblk->peer->location;
 		if ( ( rc = peerblk_retrieval_open ( peerblk,
-						     location ) ) != 0 ) {
+						     peer->location ) ) != 0 ) {
 			/* Non-fatal: continue to try next peer */
 			continue;
 		}
+		peerdisc_start ( peer );
+		peerblk->retrieving = 1;
+		peerblk->requested = currticks();
+		peerblk->responded = peerblk->requested;
 
-		/* Start download attempt timer */
+		/* Start download attempt and race timers */
 		peerblk->rc = -ETIMEDOUT;
 		start_timer_fixed ( &peerblk->timer,
 				    PEERBLK_RETRIEVAL_OPEN_TIMEOUT );
+		start_timer_fixed ( &peerblk->race_timer,
+				    PEERBLK_RACE_TIMEOUT );
 		return;
 	}
 
 	/* Attempt raw download */
+	peerblk->peer = head;
 	if ( ( rc = peerblk_raw_open ( peerblk ) ) != 0 )
 		goto err;
 
@@ -1282,6 +1596,16 @@ static struct interface_descriptor peerblk_retrieval_desc =
 	INTF_DESC ( struct peerdist_block, retrieval,
 		    peerblk_retrieval_operations );
 
+/** PeerDist block download raced raw data interface operations */
+static struct interface_operation peerblk_race_operations[] = {
+	INTF_OP ( xfer_deliver, struct peerdist_block *, peerblk_race_rx ),
+	INTF_OP ( intf_close, struct peerdist_block *, peerblk_race_close ),
+};
+
+/** PeerDist block download raced raw data interface descriptor */
+static struct interface_descriptor peerblk_race_desc =
+	INTF_DESC ( struct peerdist_block, race, peerblk_race_operations );
+
 /** PeerDist block download decryption process descriptor */
 static struct process_descriptor peerblk_process_desc =
 	PROC_DESC ( struct peerdist_block, process, peerblk_decrypt );
@@ -1310,7 +1634,7 @@ int peerblk_open ( struct interface *xfer, struct uri *uri,
 	int rc;
 
 	/* Allocate and initialise structure */
-	peerblk = zalloc ( sizeof ( *peerblk ) + digest->ctxsize );
+	peerblk = zalloc ( sizeof ( *peerblk ) + ( 2 * digest->ctxsize ) );
 	if ( ! peerblk ) {
 		rc = -ENOMEM;
 		goto err_alloc;
@@ -1320,6 +1644,7 @@ int peerblk_open ( struct interface *xfer, struct uri *uri,
 	intf_init ( &peerblk->raw, &peerblk_raw_desc, &peerblk->refcnt );
 	intf_init ( &peerblk->retrieval, &peerblk_retrieval_desc,
 		    &peerblk->refcnt );
+	intf_init ( &peerblk->race, &peerblk_race_desc, &peerblk->refcnt );
 	peerblk->uri = uri_get ( uri );
 	memcpy ( &peerblk->range, &block->range, sizeof ( peerblk->range ) );
 	memcpy ( &peerblk->trim, &block->trim, sizeof ( peerblk->trim ) );
@@ -1327,16 +1652,20 @@ int peerblk_open ( struct interface *xfer, struct uri *uri,
 	peerblk->digest = info->digest;
 	peerblk->digestsize = digestsize = info->digestsize;
 	peerblk->digestctx = ( ( ( void * ) peerblk ) + sizeof ( *peerblk ) );
+	peerblk->race_digestctx = ( peerblk->digestctx + digest->ctxsize );
 	peerblk->segment = segment->index;
 	memcpy ( peerblk->id, segment->id, sizeof ( peerblk->id ) );
 	memcpy ( peerblk->secret, segment->secret, sizeof ( peerblk->secret ) );
 	peerblk->block = block->index;
 	memcpy ( peerblk->hash, block->hash, sizeof ( peerblk->hash ) );
 	xferbuf_malloc_init ( &peerblk->buffer );
+	xferbuf_malloc_init ( &peerblk->race_buffer );
 	process_init_stopped ( &peerblk->process, &peerblk_process_desc,
 			       &peerblk->refcnt );
 	peerdisc_init ( &peerblk->discovery, &peerblk_discovery_operations );
 	timer_init ( &peerblk->timer, peerblk_expired, &peerblk->refcnt );
+	timer_init ( &peerblk->race_timer, peerblk_race_expired,
+		     &peerblk->refcnt );
 	DBGC2 ( peerblk, "PEERBLK %p %d.%d id %02x%02x%02x%02x%02x..."
 		"%02x%02x%02x [%08zx,%08zx)", peerblk, peerblk->segment,
 		peerblk->block, peerblk->id[0], peerblk->id[1], peerblk->id[2],
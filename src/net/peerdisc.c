@@ -72,6 +72,9 @@ static LIST_HEAD ( peerdisc_segments );
  */
 unsigned int peerdisc_timeout_secs = PEERDISC_DEFAULT_TIMEOUT_SECS;
 
+/** Maximum peer selection penalty for consecutive failures (as a shift) */
+#define PEERDISC_MAX_PENALTY 8
+
 static struct peerdisc_segment * peerdisc_find ( const char *id );
 static int peerdisc_discovered ( struct peerdisc_segment *segment,
 				 const char *location );
@@ -106,6 +109,176 @@ void peerdisc_stat ( struct interface *intf, struct peerdisc_peer *peer,
 	intf_put ( dest );
 }
 
+/**
+ * Find any discovered PeerDist peer with a given location
+ *
+ * @v location		Peer location
+ * @ret peer		Discovered peer, or NULL if not found
+ */
+static struct peerdisc_peer * peerdisc_find_peer ( const char *location ) {
+	struct peerdisc_segment *segment;
+	struct peerdisc_peer *peer;
+
+	/* Look for a matching peer within any segment */
+	list_for_each_entry ( segment, &peerdisc_segments, list ) {
+		list_for_each_entry ( peer, &segment->peers, list ) {
+			if ( strcmp ( peer->location, location ) == 0 )
+				return peer;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Propagate PeerDist peer statistics to all segments
+ *
+ * @v peer		Discovered peer
+ */
+static void peerdisc_propagate ( struct peerdisc_peer *peer ) {
+	struct peerdisc_segment *segment;
+	struct peerdisc_peer *tmp;
+
+	/* Update all peers with the same location */
+	list_for_each_entry ( segment, &peerdisc_segments, list ) {
+		list_for_each_entry ( tmp, &segment->peers, list ) {
+			if ( strcmp ( tmp->location, peer->location ) == 0 ) {
+				memcpy ( &tmp->stats, &peer->stats,
+					 sizeof ( tmp->stats ) );
+			}
+		}
+	}
+}
+
+/**
+ * Record start of download attempt from PeerDist peer
+ *
+ * @v peer		Discovered peer
+ */
+void peerdisc_start ( struct peerdisc_peer *peer ) {
+
+	/* Increment number of download attempts in progress */
+	peer->stats.busy++;
+	peerdisc_propagate ( peer );
+}
+
+/**
+ * Record completion of download attempt from PeerDist peer
+ *
+ * @v peer		Discovered peer
+ * @v rc		Completion status code
+ * @v latency		Time to first response (in ticks)
+ * @v len		Length of data received
+ * @v duration		Time from first response to completion (in ticks)
+ *
+ * A completion status of -ECANCELED indicates an attempt that was
+ * abandoned for reasons unrelated to the peer.
+ */
+void peerdisc_finish ( struct peerdisc_peer *peer, int rc,
+		       unsigned long latency, size_t len,
+		       unsigned long duration ) {
+	struct peerdisc_peer_stats *stats = &peer->stats;
+	unsigned long rate;
+
+	/* Decrement number of download attempts in progress */
+	assert ( stats->busy > 0 );
+	stats->busy--;
+
+	/* Update statistics */
+	if ( rc == 0 ) {
+		rate = ( len / ( duration ? duration : 1 ) );
+		if ( ! rate )
+			rate = 1;
+		if ( stats->rate ) {
+			stats->latency = ( ( ( 3 * stats->latency ) +
+					     latency ) / 4 );
+			stats->rate = ( ( ( 3 * stats->rate ) + rate ) / 4 );
+		} else {
+			stats->latency = latency;
+			stats->rate = rate;
+		}
+		stats->failures = 0;
+	} else if ( rc != -ECANCELED ) {
+		stats->failures++;
+	}
+	DBGC2 ( peer, "PEERDISC %s latency %ld rate %ld failures %d\n",
+		peer->location, stats->latency, stats->rate, stats->failures );
+
+	/* Propagate to all segments */
+	peerdisc_propagate ( peer );
+}
+
+/**
+ * Estimate cost of downloading from PeerDist peer
+ *
+ * @v peer		Discovered peer
+ * @v len		Length of data to be downloaded
+ * @ret cost		Estimated cost (in arbitrary units)
+ */
+static unsigned long peerdisc_cost ( struct peerdisc_peer *peer,
+				     size_t len ) {
+	struct peerdisc_peer_stats *stats = &peer->stats;
+	unsigned long cost;
+	unsigned int penalty;
+
+	/* Estimate time taken to download, assuming that untested
+	 * peers are fast (so that each peer will be tried).
+	 */
+	cost = ( stats->latency + 1 );
+	if ( stats->rate )
+		cost += ( len / stats->rate );
+
+	/* Allow for download attempts already in progress, in order
+	 * to spread downloads across several fast peers.
+	 */
+	cost *= ( stats->busy + 1 );
+
+	/* Penalise peers with consecutive failures */
+	penalty = stats->failures;
+	if ( penalty > PEERDISC_MAX_PENALTY )
+		penalty = PEERDISC_MAX_PENALTY;
+	cost <<= penalty;
+
+	return cost;
+}
+
+/**
+ * Select best PeerDist peer
+ *
+ * @v segment		PeerDist discovery segment
+ * @v len		Length of data to be downloaded
+ * @v exclude		List of peers to exclude
+ * @v count		Number of peers to exclude
+ * @ret peer		Selected peer, or NULL if no peers are available
+ */
+struct peerdisc_peer * peerdisc_select ( struct peerdisc_segment *segment,
+					 size_t len,
+					 struct peerdisc_peer **exclude,
+					 unsigned int count ) {
+	struct peerdisc_peer *peer;
+	struct peerdisc_peer *best = NULL;
+	unsigned long best_cost = 0;
+	unsigned long cost;
+	unsigned int i;
+
+	/* Find lowest-cost peer not already excluded */
+	list_for_each_entry ( peer, &segment->peers, list ) {
+		for ( i = 0 ; i < count ; i++ ) {
+			if ( exclude[i] == peer )
+				break;
+		}
+		if ( i < count )
+			continue;
+		cost = peerdisc_cost ( peer, len );
+		if ( ( ! best ) || ( cost < best_cost ) ) {
+			best = peer;
+			best_cost = cost;
+		}
+	}
+
+	return best;
+}
+
 /******************************************************************************
  *
  * Discovery sockets
@@ -377,6 +550,7 @@ static struct peerdisc_segment * peerdisc_find ( const char *id ) {
 static int peerdisc_discovered ( struct peerdisc_segment *segment,
 				 const char *location ) {
 	struct peerdisc_peer *peer;
+	struct peerdisc_peer *known;
 	struct peerdisc_client *peerdisc;
 	struct peerdisc_client *tmp;
 
@@ -396,6 +570,12 @@ static int peerdisc_discovered ( struct peerdisc_segment *segment,
 		return -ENOMEM;
 	strcpy ( peer->location, location );
 
+	/* Inherit statistics from any other segment's copy of this peer */
+	if ( ( known = peerdisc_find_peer ( location ) ) != NULL ) {
+		memcpy ( &peer->stats, &known->stats,
+			 sizeof ( peer->stats ) );
+	}
+
 	/* Add to end of list of peers */
 	list_add_tail ( &peer->list, &segment->peers );
 
@@ -27,10 +27,13 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <stdio.h>
 #include <errno.h>
 #include <ipxe/uri.h>
+#include <ipxe/iobuf.h>
 #include <ipxe/xferbuf.h>
+#include <ipxe/timer.h>
 #include <ipxe/job.h>
 #include <ipxe/peerblk.h>
 #include <ipxe/peermux.h>
+#include <ipxe/peerserv.h>
 
 /** @file
  *
@@ -38,6 +41,12 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  *
  */
 
+/** PeerDist throughput sample interval
+ *
+ * This is a policy decision.
+ */
+#define PEERMUX_SAMPLE_INTERVAL ( TICKS_PER_SEC / 2 )
+
 /**
  * Free PeerDist download multiplexer
  *
@@ -52,6 +61,18 @@ static void peermux_free ( struct refcnt *refcnt ) {
 	free ( peermux );
 }
 
+/**
+ * Publish completed PeerDist download (when content server is not present)
+ *
+ * @v uri		Original URI
+ * @v info		Content information
+ */
+__weak void peerserv_publish ( struct uri *uri __unused,
+			       const struct peerdist_info *info __unused ) {
+
+	/* Nothing to do */
+}
+
 /**
  * Close PeerDist download multiplexer
  *
@@ -161,7 +182,8 @@ static void peermux_info_close ( struct peerdist_multiplexer *peermux, int rc ){
 	}
 	xfer_seek ( &peermux->xfer, 0 );
 
-	/* Start block download process */
+	/* Start throughput measurement and block download process */
+	peermux->sampled = currticks();
 	process_add ( &peermux->process );
 
 	return;
@@ -180,14 +202,21 @@ static void peermux_step ( struct peerdist_multiplexer *peermux ) {
 	struct peerdist_info_segment *segment = &peermux->cache.segment;
 	struct peerdist_info_block *block = &peermux->cache.block;
 	struct peerdist_multiplexed_block *peermblk;
+	struct peerdist_multiplexed_block *frontier;
 	unsigned int next_segment;
 	unsigned int next_block;
 	int rc;
 
-	/* Stop initiation process if all block downloads are busy */
+	/* Stop initiation process if all block downloads are busy,
+	 * or if the next block would lie outside the window.
+	 */
 	peermblk = list_first_entry ( &peermux->idle,
 				      struct peerdist_multiplexed_block, list );
-	if ( ! peermblk ) {
+	frontier = list_first_entry ( &peermux->busy,
+				      struct peerdist_multiplexed_block, list );
+	if ( ( ! peermblk ) ||
+	     ( frontier && ( ( peermux->sequence - frontier->sequence ) >=
+			     peermux->window ) ) ) {
 		process_del ( &peermux->process );
 		return;
 	}
@@ -209,8 +238,10 @@ static void peermux_step ( struct peerdist_multiplexer *peermux ) {
 		 */
 		if ( next_segment >= info->segments ) {
 			process_del ( &peermux->process );
-			if ( list_empty ( &peermux->busy ) )
+			if ( list_empty ( &peermux->busy ) ) {
+				peerserv_publish ( peermux->uri, info );
 				peermux_close ( peermux, 0 );
+			}
 			return;
 		}
 
@@ -248,7 +279,11 @@ static void peermux_step ( struct peerdist_multiplexer *peermux ) {
 		goto err;
 	}
 
-	/* Move to list of busy block downloads */
+	/* Move to list of busy block downloads.  This list is kept
+	 * in sequence order, so that the first entry is always the
+	 * write frontier.
+	 */
+	peermblk->sequence = peermux->sequence++;
 	list_del ( &peermblk->list );
 	list_add_tail ( &peermblk->list, &peermux->busy );
 
@@ -276,6 +311,9 @@ static int peermux_block_deliver ( struct peerdist_multiplexed_block *peermblk,
 	 */
 	assert ( meta->flags & XFER_FL_ABS_OFFSET );
 
+	/* Record received length for throughput measurement */
+	peermux->sample_len += iob_len ( iobuf );
+
 	/* We can't use a simple passthrough interface descriptor,
 	 * since there are multiple block download interfaces.
 	 */
@@ -298,6 +336,23 @@ peermux_block_buffer ( struct peerdist_multiplexed_block *peermblk ) {
 	return xfer_buffer ( &peermux->xfer );
 }
 
+/**
+ * Check if multiplexed block download is urgent
+ *
+ * @v peermblk		PeerDist multiplexed block download
+ * @ret urgent		Block download is urgent
+ */
+static int peermux_block_urgent ( struct peerdist_multiplexed_block *peermblk ){
+	struct peerdist_multiplexer *peermux = peermblk->peermux;
+	struct peerdist_multiplexed_block *frontier;
+
+	/* Treat block downloads near the write frontier as urgent */
+	frontier = list_first_entry ( &peermux->busy,
+				      struct peerdist_multiplexed_block, list );
+	return ( frontier && ( ( peermblk->sequence - frontier->sequence ) <
+			       PEERMUX_URGENT_BLOCKS ) );
+}
+
 /**
  * Record peer discovery statistics
  *
@@ -327,6 +382,48 @@ static void peermux_block_stat ( struct peerdist_multiplexed_block *peermblk,
 		peermux, stats->local, stats->total, stats->peers );
 }
 
+/**
+ * Adapt block download window to measured throughput
+ *
+ * @v peermux		PeerDist download multiplexer
+ */
+static void peermux_adapt ( struct peerdist_multiplexer *peermux ) {
+	unsigned long now = currticks();
+	unsigned long elapsed = ( now - peermux->sampled );
+	unsigned long rate;
+	unsigned int window = peermux->window;
+
+	/* Do nothing until the sample interval has elapsed */
+	if ( elapsed < PEERMUX_SAMPLE_INTERVAL )
+		return;
+
+	/* Calculate throughput over this sample */
+	rate = ( peermux->sample_len / elapsed );
+
+	/* Grow the window for as long as throughput keeps improving,
+	 * and shrink it if throughput degrades.
+	 */
+	if ( rate > ( peermux->rate + ( peermux->rate / 8 ) ) ) {
+		window += ( ( window + 1 ) / 2 );
+	} else if ( rate < ( peermux->rate - ( peermux->rate / 8 ) ) ) {
+		window -= ( window / 4 );
+	}
+	if ( window > PEERMUX_MAX_BLOCKS )
+		window = PEERMUX_MAX_BLOCKS;
+	if ( window < PEERMUX_MIN_WINDOW )
+		window = PEERMUX_MIN_WINDOW;
+	if ( window != peermux->window ) {
+		DBGC2 ( peermux, "PEERMUX %p window %d (rate %ld->%ld)\n",
+			peermux, window, peermux->rate, rate );
+	}
+
+	/* Start next sample */
+	peermux->window = window;
+	peermux->rate = rate;
+	peermux->sample_len = 0;
+	peermux->sampled = now;
+}
+
 /**
  * Close multiplexed block download
  *
@@ -350,6 +447,9 @@ static void peermux_block_close ( struct peerdist_multiplexed_block *peermblk,
 	/* Restart data transfer interface */
 	intf_restart ( &peermblk->xfer, rc );
 
+	/* Adapt block download window */
+	peermux_adapt ( peermux );
+
 	/* Restart block download initiation process */
 	process_add ( &peermux->process );
 }
@@ -387,6 +487,8 @@ static struct interface_operation peermux_block_operations[] = {
 		  peermux_block_buffer ),
 	INTF_OP ( peerdisc_stat, struct peerdist_multiplexed_block *,
 		  peermux_block_stat ),
+	INTF_OP ( peerblk_urgent, struct peerdist_multiplexed_block *,
+		  peermux_block_urgent ),
 	INTF_OP ( intf_close, struct peerdist_multiplexed_block *,
 		  peermux_block_close ),
 };
@@ -428,6 +530,7 @@ int peermux_filter ( struct interface *xfer, struct interface *info,
 			       &peermux->refcnt );
 	INIT_LIST_HEAD ( &peermux->busy );
 	INIT_LIST_HEAD ( &peermux->idle );
+	peermux->window = PEERMUX_INITIAL_WINDOW;
 	for ( i = 0 ; i < PEERMUX_MAX_BLOCKS ; i++ ) {
 		peermblk = &peermux->block[i];
 		peermblk->peermux = peermux;
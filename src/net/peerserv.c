@@ -0,0 +1,869 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <byteswap.h>
+#include <ipxe/uaccess.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/xfer.h>
+#include <ipxe/open.h>
+#include <ipxe/uri.h>
+#include <ipxe/image.h>
+#include <ipxe/netdevice.h>
+#include <ipxe/settings.h>
+#include <ipxe/timer.h>
+#include <ipxe/uuid.h>
+#include <ipxe/base16.h>
+#include <ipxe/crypto.h>
+#include <ipxe/aes.h>
+#include <ipxe/in.h>
+#include <ipxe/socket.h>
+#include <ipxe/udp.h>
+#include <ipxe/tcp.h>
+#include <ipxe/pccrd.h>
+#include <ipxe/pccrr.h>
+#include <ipxe/peerblk.h>
+#include <ipxe/peerserv.h>
+
+/** @file
+ *
+ * Peer Content Caching and Retrieval (PeerDist) protocol content server
+ *
+ * Content that has been successfully downloaded via PeerDist is
+ * published to other peers on the local network, so that machines
+ * booting together can share blocks amongst themselves rather than
+ * each fetching every block from the origin server.
+ *
+ * Only content that has been fully downloaded and registered as an
+ * image is served.  Each block is verified against the block hash
+ * in the content information at the point of serving it, so that a
+ * modified (or since-freed and reallocated) image can never result
+ * in incorrect data being supplied to a peer.
+ *
+ * The server currently operates only over IPv4.
+ */
+
+/** List of published contents */
+static LIST_HEAD ( peerserv_contents );
+
+/** Number of published contents */
+static unsigned int peerserv_num_contents;
+
+/** List of retrieval connections */
+static LIST_HEAD ( peerserv_connections );
+
+/** Number of retrieval connections */
+static unsigned int peerserv_num_connections;
+
+/** Content server has been started */
+static int peerserv_started;
+
+/******************************************************************************
+ *
+ * Published contents
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Find image holding published content
+ *
+ * @v content		Published content
+ * @ret image		Image, or NULL if not found
+ */
+static struct image * peerserv_image ( struct peerserv_content *content ) {
+	const struct peerdist_info *info = &content->info;
+	struct image *image;
+	char *uri;
+	int match;
+
+	/* Find a registered image with a matching URI and length */
+	for_each_image ( image ) {
+		if ( ! image->uri )
+			continue;
+		if ( image->len != ( info->trim.end - info->trim.start ) )
+			continue;
+		uri = format_uri_alloc ( image->uri );
+		if ( ! uri )
+			continue;
+		match = ( strcmp ( uri, content->uri ) == 0 );
+		free ( uri );
+		if ( match )
+			return image;
+	}
+
+	return NULL;
+}
+
+/**
+ * Find published content segment
+ *
+ * @v id		Segment identifier
+ * @v len		Length of segment identifier
+ * @v segment		Content information segment to fill in
+ * @ret content		Published content, or NULL if not found
+ */
+static struct peerserv_content *
+peerserv_find ( const void *id, size_t len,
+		struct peerdist_info_segment *segment ) {
+	struct peerserv_content *content;
+	unsigned int i;
+
+	list_for_each_entry ( content, &peerserv_contents, list ) {
+		if ( content->info.digestsize != len )
+			continue;
+		for ( i = 0 ; i < content->info.segments ; i++ ) {
+			if ( peerdist_info_segment ( &content->info, segment,
+						     i ) != 0 )
+				break;
+			if ( memcmp ( segment->id, id, len ) == 0 )
+				return content;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Remove published content
+ *
+ * @v content		Published content
+ */
+static void peerserv_remove ( struct peerserv_content *content ) {
+
+	DBGC ( content, "PEERSERV %p withdrawn %s\n", content, content->uri );
+	list_del ( &content->list );
+	peerserv_num_contents--;
+	free ( content );
+}
+
+/******************************************************************************
+ *
+ * Block retrieval
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Read and verify block data
+ *
+ * @v content		Published content
+ * @v block		Content information block
+ * @v image		Image holding content
+ * @v data		Data buffer to fill in
+ * @ret rc		Return status code
+ */
+static int peerserv_verify ( struct peerserv_content *content,
+			     struct peerdist_info_block *block,
+			     struct image *image, void *data ) {
+	const struct peerdist_info *info = &content->info;
+	struct digest_algorithm *digest = info->digest;
+	uint8_t ctx[ digest->ctxsize ];
+	uint8_t out[ digest->digestsize ];
+	size_t len = ( block->range.end - block->range.start );
+
+	/* Read block data from image */
+	copy_from_user ( data, image->data,
+			 ( block->range.start - info->trim.start ), len );
+
+	/* Verify block hash */
+	digest_init ( digest, ctx );
+	digest_update ( digest, ctx, data, len );
+	digest_final ( digest, ctx, out );
+	if ( memcmp ( out, block->hash, info->digestsize ) != 0 ) {
+		DBGC ( content, "PEERSERV %p block [%08zx,%08zx) does not "
+		       "match image %s\n", content, block->range.start,
+		       block->range.end, image->name );
+		return -EACCES;
+	}
+
+	return 0;
+}
+
+/**
+ * Locate servable block
+ *
+ * @v id		Segment identifier
+ * @v digestsize	Length of segment identifier
+ * @v index		Block index
+ * @v segment		Content information segment to fill in
+ * @v block		Content information block to fill in
+ * @v image		Image to fill in
+ * @ret content		Published content, or NULL if not servable
+ */
+static struct peerserv_content *
+peerserv_block ( const void *id, size_t digestsize, unsigned int index,
+		 struct peerdist_info_segment *segment,
+		 struct peerdist_info_block *block, struct image **image ) {
+	struct peerserv_content *content;
+
+	/* Find segment */
+	content = peerserv_find ( id, digestsize, segment );
+	if ( ! content )
+		return NULL;
+
+	/* Find block */
+	if ( peerdist_info_block ( segment, block, index ) != 0 )
+		return NULL;
+
+	/* Serve only blocks lying entirely within the downloaded
+	 * content, since the block hash covers the whole block.
+	 */
+	if ( ( block->trim.start != block->range.start ) ||
+	     ( block->trim.end != block->range.end ) )
+		return NULL;
+
+	/* Find image */
+	*image = peerserv_image ( content );
+	if ( ! *image )
+		return NULL;
+
+	return content;
+}
+
+/**
+ * Close retrieval connection
+ *
+ * @v conn		Retrieval connection
+ * @v rc		Reason for close
+ */
+static void peerserv_close ( struct peerserv_connection *conn, int rc ) {
+
+	DBGC2 ( conn, "PEERSERV %p closed: %s\n", conn, strerror ( rc ) );
+
+	/* Stop timer */
+	stop_timer ( &conn->timer );
+
+	/* Shut down interface */
+	intf_shutdown ( &conn->xfer, rc );
+
+	/* Remove from list of connections and drop list's reference */
+	list_del ( &conn->list );
+	peerserv_num_connections--;
+	ref_put ( &conn->refcnt );
+}
+
+/**
+ * Respond to block fetch request
+ *
+ * @v conn		Retrieval connection
+ * @v body		Request body
+ * @v len		Length of request body
+ * @ret rc		Return status code
+ */
+static int peerserv_respond ( struct peerserv_connection *conn,
+			      const void *body, size_t len ) {
+	const struct {
+		struct peerdist_msg_getblks getblks;
+		struct peerdist_msg_segment segment;
+	} __attribute__ (( packed )) *hdr = body;
+	struct cipher_algorithm *cipher = &aes_cbc_algorithm;
+	size_t blksize = cipher->blocksize;
+	uint8_t cipherctx[ cipher->ctxsize ];
+	uint8_t iv[ blksize ];
+	struct peerdist_info_segment segment;
+	struct peerdist_info_block block;
+	struct peerserv_content *content;
+	struct io_buffer *iobuf;
+	struct image *image = NULL;
+	const void *id = ( hdr + 1 );
+	char header[128];
+	unsigned int index;
+	unsigned int next;
+	size_t digestsize;
+	size_t block_len;
+	size_t data_len;
+	size_t header_len;
+	size_t rsp_len;
+	unsigned int i;
+	int rc;
+
+	/* Parse request header */
+	if ( len < sizeof ( *hdr ) ) {
+		DBGC ( conn, "PEERSERV %p request too short (%zd bytes)\n",
+		       conn, len );
+		return -EINVAL;
+	}
+	if ( hdr->getblks.hdr.type != htonl ( PEERDIST_MSG_GETBLKS_TYPE ) ) {
+		DBGC ( conn, "PEERSERV %p unsupported message type %#08x\n",
+		       conn, ntohl ( hdr->getblks.hdr.type ) );
+		return -ENOTSUP;
+	}
+	digestsize = ntohl ( hdr->segment.digestsize );
+	if ( digestsize > PEERDIST_DIGEST_MAX_SIZE ) {
+		DBGC ( conn, "PEERSERV %p invalid digest size %zd\n",
+		       conn, digestsize );
+		return -EINVAL;
+	}
+
+	/* Parse request segment and block range */
+	{
+		const peerdist_msg_getblks_t ( digestsize, 1, 0 ) *req = body;
+
+		if ( len < sizeof ( *req ) ) {
+			DBGC ( conn, "PEERSERV %p request too short for "
+			       "block range (%zd bytes)\n", conn, len );
+			return -EINVAL;
+		}
+		if ( ( req->ranges.ranges.count == 0 ) ||
+		     ( req->ranges.range[0].count == 0 ) ) {
+			DBGC ( conn, "PEERSERV %p empty block range\n", conn );
+			return -EINVAL;
+		}
+		index = ntohl ( req->ranges.range[0].first );
+
+		/* Locate block */
+		content = peerserv_block ( id, digestsize, index,
+					   &segment, &block, &image );
+	}
+
+	/* Calculate response lengths */
+	block_len = ( content ? ( block.range.end - block.range.start ) : 0 );
+	data_len = ( ( block_len + blksize - 1 ) & ~( blksize - 1 ) );
+	next = ( ( content && ( ( index + 1 ) < segment.blocks ) ) ?
+		 ( index + 1 ) : 0 );
+	{
+		peerblk_msg_blk_t ( digestsize, data_len, 0, blksize ) *rsp;
+		void *data;
+		void *iv_data;
+
+		rsp_len = sizeof ( *rsp );
+		header_len = snprintf ( header, sizeof ( header ),
+					"HTTP/1.1 200 OK\r\n"
+					"Content-Type: application/octet-stream"
+					"\r\nContent-Length: %zd\r\n%s\r\n",
+					rsp_len, ( conn->close ?
+						   "Connection: close\r\n" :
+						   "" ) );
+
+		/* Allocate I/O buffer */
+		iobuf = xfer_alloc_iob ( &conn->xfer, ( header_len + rsp_len ));
+		if ( ! iobuf )
+			return -ENOMEM;
+		memcpy ( iob_put ( iobuf, header_len ), header, header_len );
+		rsp = iob_put ( iobuf, rsp_len );
+		memset ( rsp, 0, rsp_len );
+		data = ( ( ( void * ) rsp ) +
+			 offsetof ( typeof ( *rsp ), msg.block.data ) );
+		iv_data = ( ( ( void * ) rsp ) +
+			    offsetof ( typeof ( *rsp ), msg.iv.data ) );
+
+		/* Read and verify block data */
+		if ( content &&
+		     ( ( rc = peerserv_verify ( content, &block, image,
+						data ) ) != 0 ) )
+			goto err_verify;
+
+		/* Encrypt block data */
+		for ( i = 0 ; i < blksize ; i++ )
+			iv[i] = random();
+		if ( ( rc = cipher_setkey ( cipher, cipherctx, segment.secret,
+					    ( 128 / 8 ) ) ) != 0 )
+			goto err_setkey;
+		cipher_setiv ( cipher, cipherctx, iv );
+		cipher_encrypt ( cipher, cipherctx, data, data, data_len );
+
+		/* Construct response */
+		rsp->hdr.len = htonl ( sizeof ( rsp->msg ) );
+		rsp->msg.blk.hdr.version.raw =
+			htonl ( PEERDIST_MSG_BLK_VERSION );
+		rsp->msg.blk.hdr.type = htonl ( PEERDIST_MSG_BLK_TYPE );
+		rsp->msg.blk.hdr.len = htonl ( sizeof ( rsp->msg ) );
+		rsp->msg.blk.hdr.algorithm = htonl ( PEERDIST_MSG_AES_128_CBC );
+		rsp->msg.segment.segment.digestsize = htonl ( digestsize );
+		memcpy ( rsp->msg.segment.id, id, digestsize );
+		rsp->msg.index = htonl ( index );
+		rsp->msg.next = htonl ( next );
+		rsp->msg.block.block.len = htonl ( data_len );
+		rsp->msg.iv.iv.blksize = htonl ( blksize );
+		memcpy ( iv_data, iv, blksize );
+	}
+	DBGC2 ( conn, "PEERSERV %p serving block %d (%zd bytes)%s\n",
+		conn, index, block_len, ( content ? "" : " (not found)" ) );
+
+	/* Deliver response */
+	return xfer_deliver_iob ( &conn->xfer, iobuf );
+
+ err_setkey:
+ err_verify:
+	free_iob ( iobuf );
+	return rc;
+}
+
+/**
+ * Process received retrieval request data
+ *
+ * @v conn		Retrieval connection
+ * @ret rc		Return status code
+ */
+static int peerserv_process ( struct peerserv_connection *conn ) {
+	char *request = conn->request;
+	char *body;
+	char *line;
+	char *path;
+	size_t content_len = 0;
+	size_t len;
+	int rc;
+
+	/* Process each complete request in turn */
+	while ( 1 ) {
+
+		/* Wait for end of headers */
+		body = strstr ( request, "\r\n\r\n" );
+		if ( ! body ) {
+			if ( conn->len >= ( sizeof ( conn->request ) - 1 ) ) {
+				DBGC ( conn, "PEERSERV %p request too long\n",
+				       conn );
+				return -ENOBUFS;
+			}
+			return 0;
+		}
+		body += 4 /* "\r\n\r\n" */;
+
+		/* Parse request line */
+		if ( strncmp ( request, "POST ", 5 ) != 0 ) {
+			DBGC ( conn, "PEERSERV %p unsupported method\n", conn );
+			return -ENOTSUP;
+		}
+		path = ( request + 5 /* "POST " */ );
+		if ( strncmp ( path, PEERDIST_MAGIC_PATH,
+			       strlen ( PEERDIST_MAGIC_PATH ) ) != 0 ) {
+			DBGC ( conn, "PEERSERV %p unsupported path\n", conn );
+			return -ENOENT;
+		}
+
+		/* Parse headers */
+		for ( line = ( strstr ( request, "\r\n" ) + 2 ) ;
+		      line < ( body - 2 /* "\r\n" */ ) ;
+		      line = ( strstr ( line, "\r\n" ) + 2 ) ) {
+			if ( strncasecmp ( line, "Content-Length:", 15 ) == 0 )
+				content_len = strtoul ( ( line + 15 ),
+						       NULL, 10 );
+			if ( ( strncasecmp ( line, "Connection:", 11 ) == 0 ) &&
+			     ( strncasecmp ( line + 11, " close", 6 ) == 0 ) )
+				conn->close = 1;
+		}
+
+		/* Wait for request body */
+		len = ( ( body - request ) + content_len );
+		if ( len > ( sizeof ( conn->request ) - 1 ) ) {
+			DBGC ( conn, "PEERSERV %p request body too long\n",
+			       conn );
+			return -ENOBUFS;
+		}
+		if ( conn->len < len )
+			return 0;
+
+		/* Send response */
+		rc = peerserv_respond ( conn, body, content_len );
+		if ( rc != 0 )
+			return rc;
+		if ( conn->close ) {
+			peerserv_close ( conn, 0 );
+			return 0;
+		}
+
+		/* Consume request */
+		conn->len -= len;
+		memmove ( request, ( request + len ), ( conn->len + 1 ) );
+		content_len = 0;
+	}
+}
+
+/**
+ * Receive retrieval request data
+ *
+ * @v conn		Retrieval connection
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int peerserv_rx ( struct peerserv_connection *conn,
+			 struct io_buffer *iobuf,
+			 struct xfer_metadata *meta __unused ) {
+	size_t len = iob_len ( iobuf );
+	size_t max = ( sizeof ( conn->request ) - 1 /* NUL */ - conn->len );
+	int rc;
+
+	/* Restart idle timer */
+	start_timer_fixed ( &conn->timer, PEERSERV_IDLE_TIMEOUT );
+
+	/* Accumulate request (which will be rejected if too long) */
+	if ( len > max )
+		len = max;
+	memcpy ( ( conn->request + conn->len ), iobuf->data, len );
+	conn->len += len;
+	conn->request[conn->len] = '\0';
+	free_iob ( iobuf );
+
+	/* Process request */
+	if ( ( rc = peerserv_process ( conn ) ) != 0 )
+		peerserv_close ( conn, rc );
+
+	return 0;
+}
+
+/**
+ * Handle retrieval connection idle timer expiry
+ *
+ * @v timer		Idle timer
+ * @v over		Failure indicator
+ */
+static void peerserv_expired ( struct retry_timer *timer, int over __unused ) {
+	struct peerserv_connection *conn =
+		container_of ( timer, struct peerserv_connection, timer );
+
+	peerserv_close ( conn, -ETIMEDOUT );
+}
+
+/** Retrieval connection interface operations */
+static struct interface_operation peerserv_xfer_operations[] = {
+	INTF_OP ( xfer_deliver, struct peerserv_connection *, peerserv_rx ),
+	INTF_OP ( intf_close, struct peerserv_connection *, peerserv_close ),
+};
+
+/** Retrieval connection interface descriptor */
+static struct interface_descriptor peerserv_xfer_desc =
+	INTF_DESC ( struct peerserv_connection, xfer,
+		    peerserv_xfer_operations );
+
+/**
+ * Accept retrieval connection
+ *
+ * @v listener		TCP listener
+ * @v xfer		Data transfer interface
+ * @v peer		Remote socket address
+ * @ret rc		Return status code
+ */
+static int peerserv_accept ( struct tcp_listener *listener __unused,
+			     struct interface *xfer,
+			     struct sockaddr_tcpip *peer ) {
+	struct peerserv_connection *conn;
+
+	/* Limit number of concurrent connections */
+	if ( peerserv_num_connections >= PEERSERV_MAX_CONNECTIONS )
+		return -EBUSY;
+
+	/* Allocate and initialise structure */
+	conn = zalloc ( sizeof ( *conn ) );
+	if ( ! conn )
+		return -ENOMEM;
+	ref_init ( &conn->refcnt, NULL );
+	intf_init ( &conn->xfer, &peerserv_xfer_desc, &conn->refcnt );
+	timer_init ( &conn->timer, peerserv_expired, &conn->refcnt );
+	DBGC2 ( conn, "PEERSERV %p accepted from %s\n",
+		conn, sock_ntoa ( ( struct sockaddr * ) peer ) );
+
+	/* Start idle timer */
+	start_timer_fixed ( &conn->timer, PEERSERV_IDLE_TIMEOUT );
+
+	/* Attach to parent interface, transfer reference to
+	 * connection list, and return
+	 */
+	intf_plug_plug ( &conn->xfer, xfer );
+	list_add ( &conn->list, &peerserv_connections );
+	peerserv_num_connections++;
+	return 0;
+}
+
+/** Retrieval TCP listener */
+static struct tcp_listener peerserv_listener = {
+	.port = PEERSERV_PORT,
+	.accept = peerserv_accept,
+};
+
+/******************************************************************************
+ *
+ * Discovery
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Respond to discovery probe
+ *
+ * @v intf		Discovery interface
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int peerserv_discovery_rx ( struct interface *intf,
+				   struct io_buffer *iobuf,
+				   struct xfer_metadata *meta ) {
+	struct peerdist_discovery_probe probe;
+	struct peerdist_info_segment segment;
+	struct peerserv_content *content;
+	struct xfer_metadata reply_meta;
+	struct in_addr address;
+	union {
+		union uuid uuid;
+		uint32_t dword[ sizeof ( union uuid ) / sizeof ( uint32_t ) ];
+	} random_uuid;
+	uint8_t raw[PEERDIST_DIGEST_MAX_SIZE];
+	char location[ 16 /* "xxx.xxx.xxx.xxx" */ + 7 /* ":xxxxx" + NUL */ ];
+	char *match;
+	char *buf;
+	char *ids;
+	char *counts;
+	char *id;
+	size_t ids_len = 0;
+	size_t counts_len;
+	unsigned int count = 0;
+	unsigned int i;
+	int len;
+	int rc;
+
+	/* Identify local address */
+	address.s_addr = 0;
+	if ( meta->netdev ) {
+		fetch_ipv4_setting ( netdev_settings ( meta->netdev ),
+				     &ip_setting, &address );
+	}
+	if ( ! ( address.s_addr && meta->src ) ) {
+		rc = -ENETUNREACH;
+		goto err_address;
+	}
+	snprintf ( location, sizeof ( location ), "%s:%d",
+		   inet_ntoa ( address ), PEERSERV_PORT );
+
+	/* Parse probe */
+	if ( ( rc = peerdist_discovery_probe ( iobuf->data, iob_len ( iobuf ),
+					       &probe ) ) != 0 )
+		goto err_probe;
+
+	/* Allocate space for matching segment IDs and block counts */
+	for ( id = probe.ids ; *id ; id += ( strlen ( id ) + 1 /* NUL */ ) ) {
+		ids_len += ( strlen ( id ) + 1 /* space or NUL */ );
+		count++;
+	}
+	counts_len = ( count *
+		       sizeof ( struct peerdist_discovery_block_count ) );
+	buf = malloc ( ids_len + 1 /* NUL */ + counts_len + 1 /* NUL */ );
+	if ( ! buf ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	ids = buf;
+	ids[0] = '\0';
+	counts = ( buf + ids_len + 1 );
+	counts[0] = '\0';
+
+	/* Identify servable segments */
+	for ( id = probe.ids ; *id ; id += ( strlen ( id ) + 1 /* NUL */ ) ) {
+		if ( strlen ( id ) > base16_encoded_len ( sizeof ( raw ) ) )
+			continue;
+		len = base16_decode ( id, raw, sizeof ( raw ) );
+		if ( len < 0 )
+			continue;
+		content = peerserv_find ( raw, len, &segment );
+		if ( ! ( content && peerserv_image ( content ) ) )
+			continue;
+		DBGC2 ( &peerserv_contents, "PEERSERV %p offering %s\n",
+			content, id );
+		if ( ids[0] )
+			strcat ( ids, " " );
+		strcat ( ids, id );
+		sprintf ( ( counts + strlen ( counts ) ), "%08X",
+			  segment.blocks );
+	}
+
+	/* Do nothing unless we have something to offer */
+	if ( ! ids[0] ) {
+		rc = 0;
+		goto no_match;
+	}
+
+	/* Construct probe match */
+	for ( i = 0 ; i < ( sizeof ( random_uuid.dword ) /
+			    sizeof ( random_uuid.dword[0] ) ) ; i++ )
+		random_uuid.dword[i] = random();
+	match = peerdist_discovery_match ( uuid_ntoa ( &random_uuid.uuid ),
+					   probe.id, ids, location, counts );
+	if ( ! match ) {
+		rc = -ENOMEM;
+		goto err_match;
+	}
+
+	/* Send probe match directly to requester */
+	memset ( &reply_meta, 0, sizeof ( reply_meta ) );
+	reply_meta.dest = meta->src;
+	reply_meta.netdev = meta->netdev;
+	if ( ( rc = xfer_deliver_raw_meta ( intf, match, strlen ( match ),
+					    &reply_meta ) ) != 0 ) {
+		DBGC ( &peerserv_contents, "PEERSERV could not send probe "
+		       "match: %s\n", strerror ( rc ) );
+	}
+
+	free ( match );
+ err_match:
+ no_match:
+	free ( buf );
+ err_alloc:
+ err_probe:
+ err_address:
+	free_iob ( iobuf );
+	return rc;
+}
+
+/** Discovery interface operations */
+static struct interface_operation peerserv_discovery_operations[] = {
+	INTF_OP ( xfer_deliver, struct interface *, peerserv_discovery_rx ),
+};
+
+/** Discovery interface descriptor */
+static struct interface_descriptor peerserv_discovery_desc =
+	INTF_DESC_PURE ( peerserv_discovery_operations );
+
+/** Discovery interface */
+static struct interface peerserv_discovery =
+	INTF_INIT ( peerserv_discovery_desc );
+
+/******************************************************************************
+ *
+ * Publishing
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Start content server
+ *
+ * @ret rc		Return status code
+ */
+static int peerserv_start ( void ) {
+	union {
+		struct sockaddr sa;
+		struct sockaddr_in sin;
+	} local;
+	int rc;
+
+	/* Do nothing if already started */
+	if ( peerserv_started )
+		return 0;
+
+	/* Open discovery socket */
+	memset ( &local, 0, sizeof ( local ) );
+	local.sin.sin_family = AF_INET;
+	local.sin.sin_port = htons ( PEERDIST_DISCOVERY_PORT );
+	if ( ( rc = udp_open ( &peerserv_discovery, NULL, &local.sa ) ) != 0 ){
+		DBGC ( &peerserv_contents, "PEERSERV could not open discovery "
+		       "socket: %s\n", strerror ( rc ) );
+		goto err_discovery;
+	}
+
+	/* Start listening for retrieval connections */
+	if ( ( rc = tcp_listen ( &peerserv_listener ) ) != 0 ) {
+		DBGC ( &peerserv_contents, "PEERSERV could not listen: %s\n",
+		       strerror ( rc ) );
+		goto err_listen;
+	}
+
+	DBGC ( &peerserv_contents, "PEERSERV started\n" );
+	peerserv_started = 1;
+	return 0;
+
+	tcp_unlisten ( &peerserv_listener );
+ err_listen:
+	intf_restart ( &peerserv_discovery, rc );
+ err_discovery:
+	return rc;
+}
+
+/**
+ * Publish completed PeerDist download
+ *
+ * @v uri		Original URI
+ * @v info		Content information
+ */
+void peerserv_publish ( struct uri *uri, const struct peerdist_info *info ) {
+	struct peerserv_content *content;
+	struct peerserv_content *tmp;
+	size_t raw_len = info->raw.len;
+	size_t uri_len;
+	void *raw;
+	char *uri_string;
+	int rc;
+
+	/* Format URI */
+	uri_string = format_uri_alloc ( uri );
+	if ( ! uri_string )
+		goto err_uri;
+	uri_len = ( strlen ( uri_string ) + 1 /* NUL */ );
+
+	/* Withdraw any previous copy of this content */
+	list_for_each_entry_safe ( content, tmp, &peerserv_contents, list ) {
+		if ( strcmp ( content->uri, uri_string ) == 0 )
+			peerserv_remove ( content );
+	}
+
+	/* Allocate and initialise structure */
+	content = zalloc ( sizeof ( *content ) + raw_len + uri_len );
+	if ( ! content )
+		goto err_alloc;
+	raw = ( ( ( void * ) content ) + sizeof ( *content ) );
+	content->uri = ( raw + raw_len );
+	memcpy ( content->uri, uri_string, uri_len );
+	copy_from_user ( raw, info->raw.data, 0, raw_len );
+
+	/* Parse our own copy of the content information */
+	if ( ( rc = peerdist_info ( virt_to_user ( raw ), raw_len,
+				    &content->info ) ) != 0 ) {
+		DBGC ( content, "PEERSERV %p could not parse content "
+		       "information: %s\n", content, strerror ( rc ) );
+		goto err_info;
+	}
+
+	/* Start server, if applicable */
+	if ( ( rc = peerserv_start() ) != 0 )
+		goto err_start;
+
+	/* Add to list of published contents, withdrawing the oldest
+	 * content if necessary.
+	 */
+	list_add_tail ( &content->list, &peerserv_contents );
+	peerserv_num_contents++;
+	if ( peerserv_num_contents > PEERSERV_MAX_CONTENTS ) {
+		peerserv_remove ( list_first_entry ( &peerserv_contents,
+						     struct peerserv_content,
+						     list ) );
+	}
+	DBGC ( content, "PEERSERV %p published %s (%d segments)\n",
+	       content, content->uri, content->info.segments );
+
+	free ( uri_string );
+	return;
+
+ err_start:
+ err_info:
+	free ( content );
+ err_alloc:
+	free ( uri_string );
+ err_uri:
+	return;
+}
@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <string.h>
+#include <ipxe/netdevice.h>
+#include <ipxe/tcpip.h>
+#include <ipxe/pmtu.h>
+
+/** @file
+ *
+ * Path MTU discovery
+ *
+ * We maintain a small cache of path MTUs reported via ICMP
+ * "fragmentation needed" or ICMPv6 "packet too big" errors.  The
+ * cached value is applied to all traffic towards the affected
+ * destination, and expires after a fixed timeout so that an
+ * increased path MTU will eventually be used.
+ *
+ */
+
+/** Path MTU cache */
+static struct path_mtu pmtu_cache[PMTU_CACHE_SIZE];
+
+/** Number of valid path MTU cache entries */
+static unsigned int pmtu_count;
+
+/** Path MTU cache generation
+ *
+ * This is incremented whenever a path MTU cache entry is changed,
+ * allowing users such as TCP to avoid looking up the path MTU for
+ * every transmitted packet.
+ */
+unsigned int pmtu_generation;
+
+/**
+ * Check if path MTU cache entry matches destination address
+ *
+ * @v pmtu		Path MTU cache entry
+ * @v tcpip_net		TCP/IP network-layer protocol
+ * @v st_dest		Destination address
+ * @ret is_match	Entry matches destination address
+ */
+static int pmtu_is_match ( struct path_mtu *pmtu,
+			   struct tcpip_net_protocol *tcpip_net,
+			   struct sockaddr_tcpip *st_dest ) {
+
+	return ( pmtu->mtu &&
+		 ( pmtu->dest.st_family == st_dest->st_family ) &&
+		 ( memcmp ( pmtu->dest.pad, st_dest->pad,
+			    tcpip_net->net_protocol->net_addr_len ) == 0 ) );
+}
+
+/**
+ * Find path MTU cache entry
+ *
+ * @v tcpip_net		TCP/IP network-layer protocol
+ * @v st_dest		Destination address
+ * @ret pmtu		Path MTU cache entry, or NULL if not found
+ */
+static struct path_mtu * pmtu_find ( struct tcpip_net_protocol *tcpip_net,
+				     struct sockaddr_tcpip *st_dest ) {
+	struct path_mtu *pmtu;
+	unsigned int i;
+
+	for ( i = 0 ; i < PMTU_CACHE_SIZE ; i++ ) {
+		pmtu = &pmtu_cache[i];
+		if ( ! pmtu_is_match ( pmtu, tcpip_net, st_dest ) )
+			continue;
+
+		/* Discard expired entries */
+		if ( ( currticks() - pmtu->updated ) >= PMTU_TIMEOUT ) {
+			DBGC ( &pmtu_cache, "PMTU %s expired\n",
+			       sock_ntoa ( ( struct sockaddr * ) st_dest ) );
+			pmtu->mtu = 0;
+			pmtu_count--;
+			pmtu_generation++;
+			return NULL;
+		}
+
+		return pmtu;
+	}
+	return NULL;
+}
+
+/**
+ * Limit MTU to path MTU
+ *
+ * @v tcpip_net		TCP/IP network-layer protocol
+ * @v st_dest		Destination address
+ * @v mtu		Link MTU
+ * @ret mtu		Path MTU
+ */
+size_t pmtu_limit ( struct tcpip_net_protocol *tcpip_net,
+		    struct sockaddr_tcpip *st_dest, size_t mtu ) {
+	struct path_mtu *pmtu;
+
+	/* Avoid searching an empty cache */
+	if ( ! pmtu_count )
+		return mtu;
+
+	/* Limit to cached path MTU, if any */
+	pmtu = pmtu_find ( tcpip_net, st_dest );
+	if ( pmtu && ( mtu > pmtu->mtu ) )
+		mtu = pmtu->mtu;
+
+	return mtu;
+}
+
+/**
+ * Record reported path MTU
+ *
+ * @v st_dest		Destination address
+ * @v mtu		Reported path MTU
+ *
+ * Reported values are clamped to the network-layer protocol's
+ * minimum MTU, and are ignored unless they would reduce the path MTU
+ * currently in use.
+ */
+void pmtu_update ( struct sockaddr_tcpip *st_dest, size_t mtu ) {
+	struct tcpip_net_protocol *tcpip_net;
+	struct net_device *netdev;
+	struct path_mtu *pmtu;
+	struct path_mtu *oldest;
+	size_t current;
+	unsigned int i;
+
+	/* Identify network-layer protocol and transmitting device */
+	tcpip_net = tcpip_net_protocol ( st_dest->st_family );
+	if ( ! tcpip_net )
+		return;
+	netdev = tcpip_net->netdev ( st_dest );
+	if ( ! netdev )
+		return;
+
+	/* Clamp to minimum MTU */
+	if ( mtu < tcpip_net->min_mtu )
+		mtu = tcpip_net->min_mtu;
+
+	/* Ignore reports which do not reduce the path MTU */
+	current = pmtu_limit ( tcpip_net, st_dest, netdev->mtu );
+	if ( mtu >= current )
+		return;
+	DBGC ( &pmtu_cache, "PMTU %s reduced from %zd to %zd\n",
+	       sock_ntoa ( ( struct sockaddr * ) st_dest ), current, mtu );
+
+	/* Update existing entry, or replace the oldest entry */
+	pmtu = pmtu_find ( tcpip_net, st_dest );
+	if ( ! pmtu ) {
+		oldest = &pmtu_cache[0];
+		for ( i = 0 ; i < PMTU_CACHE_SIZE ; i++ ) {
+			pmtu = &pmtu_cache[i];
+			if ( ! pmtu->mtu ) {
+				oldest = pmtu;
+				break;
+			}
+			if ( ( currticks() - pmtu->updated ) >
+			     ( currticks() - oldest->updated ) ) {
+				oldest = pmtu;
+			}
+		}
+		pmtu = oldest;
+		if ( ! pmtu->mtu )
+			pmtu_count++;
+		memset ( &pmtu->dest, 0, sizeof ( pmtu->dest ) );
+		pmtu->dest.st_family = st_dest->st_family;
+		memcpy ( pmtu->dest.pad, st_dest->pad,
+			 tcpip_net->net_protocol->net_addr_len );
+	}
+	pmtu->mtu = mtu;
+	pmtu->updated = currticks();
+	pmtu_generation++;
+}
+
+/**
+ * Flush path MTU cache
+ *
+ */
+void pmtu_flush ( void ) {
+
+	memset ( pmtu_cache, 0, sizeof ( pmtu_cache ) );
+	pmtu_count = 0;
+	pmtu_generation++;
+}
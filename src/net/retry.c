@@ -39,6 +39,11 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  *
  * This implementation of the timer is designed to satisfy RFC 2988
  * and therefore be usable as a TCP retransmission timer.
+ *
+ * Running timers are held in a hashed timer wheel, indexed by expiry
+ * time.  Polling examines only the slots for ticks that have elapsed
+ * since the previous poll, so that the cost of polling is independent
+ * of the number of running timers.
  * 
  */
 
@@ -48,8 +53,32 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  */
 #define MIN_TIMEOUT 7
 
-/** List of running timers */
-static LIST_HEAD ( timers );
+/** Number of timer wheel slots (must be a power of two) */
+#define RETRY_WHEEL_SIZE 256
+
+/** Timer wheel slots */
+static struct list_head retry_wheel[RETRY_WHEEL_SIZE];
+
+/** Next tick to be examined by retry_poll() */
+static unsigned long retry_tick;
+
+/** Number of running timers */
+unsigned int retry_running;
+
+/**
+ * Get timer wheel slot
+ *
+ * @v tick		Tick
+ * @ret slot		Timer wheel slot
+ */
+static inline struct list_head * retry_slot ( unsigned long tick ) {
+	struct list_head *slot = &retry_wheel[ tick % RETRY_WHEEL_SIZE ];
+
+	/* Initialise slot, if not already initialised */
+	if ( ! slot->next )
+		INIT_LIST_HEAD ( slot );
+	return slot;
+}
 
 /**
  * Start timer with a specified timeout
@@ -62,12 +91,16 @@ static LIST_HEAD ( timers );
  * be stopped and the timer's callback function will be called.
  */
 void start_timer_fixed ( struct retry_timer *timer, unsigned long timeout ) {
+	unsigned long expiry;
 
-	/* Add to list of running timers (if applicable) */
-	if ( ! timer->running ) {
-		list_add ( &timer->list, &timers );
+	/* Remove from timer wheel, or mark as running */
+	if ( timer->running ) {
+		list_del ( &timer->list );
+	} else {
 		ref_get ( timer->refcnt );
 		timer->running = 1;
+		if ( ! retry_running++ )
+			retry_tick = currticks();
 	}
 
 	/* Record start time */
@@ -76,6 +109,15 @@ void start_timer_fixed ( struct retry_timer *timer, unsigned long timeout ) {
 	/* Record timeout */
 	timer->timeout = timeout;
 
+	/* Add to timer wheel.  A timer that has already expired (or
+	 * will expire at a tick that retry_poll() has already
+	 * examined) is added to the slot that will be examined next.
+	 */
+	expiry = ( timer->start + timeout );
+	if ( ( ( signed long ) ( expiry - retry_tick ) ) < 0 )
+		expiry = retry_tick;
+	list_add_tail ( &timer->list, retry_slot ( expiry ) );
+
 	DBGC2 ( timer, "Timer %p started at time %ld (expires at %ld)\n",
 		timer, timer->start, ( timer->start + timer->timeout ) );
 }
@@ -126,6 +168,7 @@ void stop_timer ( struct retry_timer *timer ) {
 	list_del ( &timer->list );
 	runtime = ( now - timer->start );
 	timer->running = 0;
+	retry_running--;
 	DBGC2 ( timer, "Timer %p stopped at time %ld (ran for %ld)\n",
 		timer, now, runtime );
 
@@ -174,6 +217,7 @@ static void timer_expired ( struct retry_timer *timer ) {
 	assert ( timer->running );
 	list_del ( &timer->list );
 	timer->running = 0;
+	retry_running--;
 	timer->count++;
 
 	/* Back off the timeout value */
@@ -196,21 +240,82 @@ static void timer_expired ( struct retry_timer *timer ) {
  */
 void retry_poll ( void ) {
 	struct retry_timer *timer;
+	struct list_head *slot;
 	unsigned long now = currticks();
 	unsigned long used;
 
-	/* Process at most one timer expiry.  We cannot process
+	/* Do nothing unless at least one timer is running */
+	if ( ! retry_running )
+		return;
+
+	/* Examine each slot at most once, however long it has been
+	 * since the previous poll.
+	 */
+	if ( ( now - retry_tick ) >= RETRY_WHEEL_SIZE )
+		retry_tick = ( now - RETRY_WHEEL_SIZE + 1 );
+
+	/* Examine slots for each tick up to and including the
+	 * current tick.  The slot for the current tick is examined
+	 * again on the next poll, since further timers may be added
+	 * to it in the meantime.
+	 *
+	 * Process at most one timer expiry.  We cannot process
 	 * multiple expiries in one pass, because one timer expiring
 	 * may end up triggering another timer's deletion from the
 	 * list.
 	 */
-	list_for_each_entry ( timer, &timers, list ) {
-		used = ( now - timer->start );
-		if ( used >= timer->timeout ) {
-			timer_expired ( timer );
+	while ( 1 ) {
+		slot = retry_slot ( retry_tick );
+		list_for_each_entry ( timer, slot, list ) {
+			used = ( now - timer->start );
+			if ( used >= timer->timeout ) {
+				timer_expired ( timer );
+				return;
+			}
+		}
+		if ( retry_tick == now )
 			break;
+		retry_tick++;
+	}
+}
+
+/**
+ * Calculate time remaining until the next timer expiry
+ *
+ * @v max		Maximum time of interest, in ticks
+ * @ret remaining	Time remaining until next expiry, in ticks
+ *
+ * This is intended for use by platforms that are able to sleep
+ * until a specified time, rather than merely until the next timer
+ * interrupt.  The returned value will never exceed @c max.
+ */
+unsigned long retry_remaining ( unsigned long max ) {
+	struct retry_timer *timer;
+	struct list_head *slot;
+	unsigned long now = currticks();
+	unsigned long remaining = max;
+	unsigned long used;
+	unsigned int i;
+
+	/* Do nothing unless at least one timer is running */
+	if ( ! retry_running )
+		return remaining;
+
+	/* Find earliest expiry */
+	for ( i = 0 ; i < RETRY_WHEEL_SIZE ; i++ ) {
+		slot = &retry_wheel[i];
+		if ( ! slot->next )
+			continue;
+		list_for_each_entry ( timer, slot, list ) {
+			used = ( now - timer->start );
+			if ( used >= timer->timeout )
+				return 0;
+			if ( ( timer->timeout - used ) < remaining )
+				remaining = ( timer->timeout - used );
 		}
 	}
+
+	return remaining;
 }
 
 /**
@@ -223,4 +328,5 @@ static void retry_step ( struct process *process __unused ) {
 }
 
 /** Retry timer process */
-PERMANENT_PROCESS ( retry_process, retry_step );
+PERMANENT_PROCESS_PRIORITY ( retry_process, retry_step,
+			     PROCESS_PRIORITY_HIGH );
@@ -140,10 +140,18 @@ void rndis_tx_complete_err ( struct rndis_device *rndis,
 	}
 	header = iobuf->data;
 
-	/* Complete buffer */
-	if ( header->type == cpu_to_le32 ( RNDIS_PACKET_MSG ) ) {
+	/* Complete buffer.  A transfer containing several packet
+	 * messages does not correspond to any I/O buffer in the
+	 * network device's TX queue (since the packets within it have
+	 * already been completed), and can be identified by having a
+	 * first message that is shorter than the transfer.
+	 */
+	if ( ( header->type == cpu_to_le32 ( RNDIS_PACKET_MSG ) ) &&
+	     ( header->len == cpu_to_le32 ( len ) ) ) {
 		netdev_tx_complete_err ( netdev, iobuf, rc );
 	} else {
+		if ( rc != 0 )
+			netdev_tx_err ( netdev, NULL, rc );
 		free_iob ( iobuf );
 	}
 }
@@ -174,6 +182,161 @@ static int rndis_tx_data ( struct rndis_device *rndis,
 	return 0;
 }
 
+/**
+ * Calculate length of a packet message within a combined transfer
+ *
+ * @v rndis		RNDIS device
+ * @v len		Length of packet
+ * @ret len		Length of message (including alignment padding)
+ */
+static size_t rndis_tx_msg_len ( struct rndis_device *rndis, size_t len ) {
+	size_t align = rndis->tx_align;
+
+	len += ( sizeof ( struct rndis_header ) +
+		 sizeof ( struct rndis_packet_message ) );
+	return ( ( len + align - 1 ) & ~( align - 1 ) );
+}
+
+/**
+ * Append packet message to combined transfer
+ *
+ * @v rndis		RNDIS device
+ * @v xfer		Combined transfer
+ * @v iobuf		I/O buffer
+ */
+static void rndis_tx_append ( struct rndis_device *rndis,
+			      struct io_buffer *xfer,
+			      struct io_buffer *iobuf ) {
+	struct net_device *netdev = rndis->netdev;
+	struct rndis_header *header;
+	struct rndis_packet_message *msg;
+	size_t len = iob_len ( iobuf );
+	size_t msg_len = rndis_tx_msg_len ( rndis, len );
+	size_t pad_len;
+
+	/* Construct message, including padding for alignment */
+	header = iob_put ( xfer, sizeof ( *header ) );
+	header->type = cpu_to_le32 ( RNDIS_PACKET_MSG );
+	header->len = cpu_to_le32 ( msg_len );
+	msg = iob_put ( xfer, sizeof ( *msg ) );
+	memset ( msg, 0, sizeof ( *msg ) );
+	msg->data.offset = cpu_to_le32 ( sizeof ( *msg ) );
+	msg->data.len = cpu_to_le32 ( len );
+	memcpy ( iob_put ( xfer, len ), iobuf->data, len );
+	pad_len = ( msg_len - ( sizeof ( *header ) + sizeof ( *msg ) + len ) );
+	memset ( iob_put ( xfer, pad_len ), 0, pad_len );
+	rndis->tx_count++;
+
+	/* Complete packet */
+	netdev_tx_complete ( netdev, iobuf );
+}
+
+/**
+ * Transmit pending transfer
+ *
+ * @v rndis		RNDIS device
+ */
+static void rndis_tx_flush ( struct rndis_device *rndis ) {
+	struct net_device *netdev = rndis->netdev;
+	struct io_buffer *iobuf;
+	int rc;
+
+	/* Do nothing unless a transfer is pending */
+	iobuf = rndis->tx_pending;
+	if ( ! iobuf )
+		return;
+	rndis->tx_pending = NULL;
+
+	/* Transmit as a lone packet message or as a combined transfer */
+	if ( rndis->tx_count == 1 ) {
+		if ( ( rc = rndis_tx_data ( rndis, iobuf ) ) != 0 )
+			netdev_tx_complete_err ( netdev, iobuf, rc );
+	} else {
+		if ( ( rc = rndis->op->transmit ( rndis, iobuf ) ) != 0 ) {
+			DBGC ( rndis, "RNDIS %s could not transmit: %s\n",
+			       rndis->name, strerror ( rc ) );
+			netdev_tx_err ( netdev, iobuf, rc );
+		}
+	}
+}
+
+/**
+ * Transmit data packet within a combined transfer
+ *
+ * @v rndis		RNDIS device
+ * @v iobuf		I/O buffer
+ * @ret rc		Return status code
+ *
+ * Packets are accumulated until the device's limits are reached or
+ * until the device is next polled.  A lone packet is transmitted
+ * unmodified; otherwise the packets are copied into a combined
+ * transfer and are completed immediately.
+ */
+static int rndis_tx_combine ( struct rndis_device *rndis,
+			      struct io_buffer *iobuf ) {
+	struct io_buffer *pending;
+	size_t used;
+
+	/* Transmit pending transfer if this packet will not fit */
+	if ( ( pending = rndis->tx_pending ) ) {
+		used = ( ( rndis->tx_count == 1 ) ?
+			 rndis_tx_msg_len ( rndis, iob_len ( pending ) ) :
+			 iob_len ( pending ) );
+		if ( ( rndis->tx_count >= rndis->tx_max_pkts ) ||
+		     ( ( used + rndis_tx_msg_len ( rndis, iob_len ( iobuf ) ) )
+		       > rndis->tx_max_len ) ) {
+			rndis_tx_flush ( rndis );
+		}
+	}
+
+	/* Hold a lone packet unmodified */
+	if ( ! rndis->tx_pending ) {
+		rndis->tx_pending = iobuf;
+		rndis->tx_count = 1;
+		return 0;
+	}
+
+	/* Convert a lone pending packet into a combined transfer */
+	if ( rndis->tx_count == 1 ) {
+		pending = alloc_iob ( rndis->tx_max_len );
+		if ( ! pending ) {
+			/* Transmit pending packet alone instead */
+			rndis_tx_flush ( rndis );
+			rndis->tx_pending = iobuf;
+			rndis->tx_count = 1;
+			return 0;
+		}
+		rndis->tx_count = 0;
+		rndis_tx_append ( rndis, pending, rndis->tx_pending );
+		rndis->tx_pending = pending;
+	}
+
+	/* Append packet */
+	rndis_tx_append ( rndis, rndis->tx_pending, iobuf );
+
+	/* Transmit immediately if full */
+	if ( rndis->tx_count >= rndis->tx_max_pkts )
+		rndis_tx_flush ( rndis );
+
+	return 0;
+}
+
+/**
+ * Discard pending transfer
+ *
+ * @v rndis		RNDIS device
+ */
+static void rndis_tx_discard ( struct rndis_device *rndis ) {
+
+	/* A lone pending packet remains within the network device's
+	 * TX queue, and will be completed when the queue is flushed.
+	 */
+	if ( rndis->tx_pending && ( rndis->tx_count > 1 ) )
+		free_iob ( rndis->tx_pending );
+	rndis->tx_pending = NULL;
+	rndis->tx_count = 0;
+}
+
 /**
  * Defer transmitted packet
  *
@@ -201,6 +364,10 @@ int rndis_tx_defer ( struct rndis_device *rndis, struct io_buffer *iobuf ) {
 	if ( header->type != cpu_to_le32 ( RNDIS_PACKET_MSG ) )
 		return -ENOTSUP;
 
+	/* Fail if this is a combined transfer */
+	if ( header->len != cpu_to_le32 ( iob_len ( iobuf ) ) )
+		return -ENOTSUP;
+
 	/* Strip RNDIS header and packet message header, to return
 	 * this packet to the state in which we received it.
 	 */
@@ -288,7 +455,7 @@ static int rndis_tx_initialise ( struct rndis_device *rndis, unsigned int id ) {
 	msg->id = id; /* Non-endian */
 	msg->major = cpu_to_le32 ( RNDIS_VERSION_MAJOR );
 	msg->minor = cpu_to_le32 ( RNDIS_VERSION_MINOR );
-	msg->mtu = cpu_to_le32 ( RNDIS_MTU );
+	msg->mtu = cpu_to_le32 ( rndis->rx_mtu );
 
 	/* Transmit message */
 	if ( ( rc = rndis_tx_message ( rndis, iobuf,
@@ -313,6 +480,7 @@ static void rndis_rx_initialise ( struct rndis_device *rndis,
 				  struct io_buffer *iobuf ) {
 	struct rndis_initialise_completion *cmplt;
 	size_t len = iob_len ( iobuf );
+	unsigned int align;
 	unsigned int id;
 	int rc;
 
@@ -338,6 +506,23 @@ static void rndis_rx_initialise ( struct rndis_device *rndis,
 		goto err_status;
 	}
 
+	/* Record transmit limits.  Combined transfers are used only
+	 * if supported by both the transport and the device.
+	 */
+	rndis->tx_max_pkts = le32_to_cpu ( cmplt->max_pkts );
+	rndis->tx_max_len = le32_to_cpu ( cmplt->mtu );
+	if ( rndis->tx_max_len > rndis->tx_mtu )
+		rndis->tx_max_len = rndis->tx_mtu;
+	align = le32_to_cpu ( cmplt->align );
+	if ( ( align > RNDIS_MAX_ALIGN ) || ( ! rndis->tx_max_len ) ) {
+		rndis->tx_max_pkts = 1;
+		align = 0;
+	}
+	rndis->tx_align = ( 1 << align );
+	DBGC ( rndis, "RNDIS %s may send %d packets in %zd bytes (align "
+	       "%zd)\n", rndis->name, rndis->tx_max_pkts, rndis->tx_max_len,
+	       rndis->tx_align );
+
 	/* Success */
 	rc = 0;
 
@@ -820,34 +1005,81 @@ static void rndis_rx_message ( struct rndis_device *rndis,
 	netdev_rx_err ( netdev, iobuf, rc );
 }
 
+/**
+ * Check for further messages within received transfer
+ *
+ * @v iobuf		I/O buffer
+ * @v msg_len		Length of first message
+ * @ret more		Transfer contains further messages
+ */
+static int rndis_rx_more ( struct io_buffer *iobuf, size_t msg_len ) {
+	struct rndis_header *next;
+	size_t len = iob_len ( iobuf );
+
+	/* Check for space for a further message header */
+	if ( ( msg_len < sizeof ( *next ) ) || ( msg_len > len ) ||
+	     ( ( len - msg_len ) < sizeof ( *next ) ) )
+		return 0;
+
+	/* Treat a zero-length message as trailing padding */
+	next = ( iobuf->data + msg_len );
+	return ( next->len != 0 );
+}
+
 /**
  * Receive packet from underlying transport layer
  *
  * @v rndis		RNDIS device
  * @v iobuf		I/O buffer
+ *
+ * The transfer may contain several messages, if permitted by the
+ * maximum transfer size advertised to the device.
  */
 void rndis_rx ( struct rndis_device *rndis, struct io_buffer *iobuf ) {
 	struct net_device *netdev = rndis->netdev;
 	struct rndis_header *header;
+	struct io_buffer *msg;
 	unsigned int type;
+	size_t msg_len;
 	int rc;
 
-	/* Sanity check */
-	if ( iob_len ( iobuf ) < sizeof ( *header ) ) {
-		DBGC ( rndis, "RNDIS %s received underlength packet:\n",
-		       rndis->name );
-		DBGC_HDA ( rndis, 0, iobuf->data, iob_len ( iobuf ) );
-		rc = -EINVAL;
-		goto drop;
-	}
-	header = iobuf->data;
+	/* Process each message within the transfer */
+	while ( iobuf ) {
 
-	/* Parse and strip header */
-	type = le32_to_cpu ( header->type );
-	iob_pull ( iobuf, sizeof ( *header ) );
+		/* Sanity check */
+		if ( iob_len ( iobuf ) < sizeof ( *header ) ) {
+			DBGC ( rndis, "RNDIS %s received underlength packet:\n",
+			       rndis->name );
+			DBGC_HDA ( rndis, 0, iobuf->data, iob_len ( iobuf ) );
+			rc = -EINVAL;
+			goto drop;
+		}
+		header = iobuf->data;
+		type = le32_to_cpu ( header->type );
+		msg_len = le32_to_cpu ( header->len );
+
+		/* Copy out this message if followed by further
+		 * messages, otherwise use the transfer directly.
+		 */
+		if ( rndis_rx_more ( iobuf, msg_len ) ) {
+			msg = alloc_iob ( msg_len );
+			if ( msg ) {
+				memcpy ( iob_put ( msg, msg_len ),
+					 iobuf->data, msg_len );
+			} else {
+				netdev_rx_err ( netdev, NULL, -ENOMEM );
+			}
+			iob_pull ( iobuf, msg_len );
+			if ( ! msg )
+				continue;
+		} else {
+			msg = iob_disown ( iobuf );
+		}
 
-	/* Handle message */
-	rndis_rx_message ( rndis, iob_disown ( iobuf ), type );
+		/* Strip header and handle message */
+		iob_pull ( msg, sizeof ( *header ) );
+		rndis_rx_message ( rndis, iob_disown ( msg ), type );
+	}
 
 	return;
 
@@ -946,6 +1178,9 @@ static int rndis_open ( struct net_device *netdev ) {
 static void rndis_close ( struct net_device *netdev ) {
 	struct rndis_device *rndis = netdev->priv;
 
+	/* Discard any pending transfer */
+	rndis_tx_discard ( rndis );
+
 	/* Clear receive filter */
 	rndis_filter ( rndis, 0 );
 
@@ -967,7 +1202,9 @@ static int rndis_transmit ( struct net_device *netdev,
 			    struct io_buffer *iobuf ) {
 	struct rndis_device *rndis = netdev->priv;
 
-	/* Transmit data packet */
+	/* Transmit data packet, combining packets if possible */
+	if ( rndis->tx_max_pkts > 1 )
+		return rndis_tx_combine ( rndis, iobuf );
 	return rndis_tx_data ( rndis, iobuf );
 }
 
@@ -979,6 +1216,9 @@ static int rndis_transmit ( struct net_device *netdev,
 static void rndis_poll ( struct net_device *netdev ) {
 	struct rndis_device *rndis = netdev->priv;
 
+	/* Transmit any pending transfer */
+	rndis_tx_flush ( rndis );
+
 	/* Poll RNDIS device */
 	rndis->op->poll ( rndis );
 }
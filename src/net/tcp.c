@@ -4,6 +4,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <byteswap.h>
+#include <syslog.h>
 #include <ipxe/timer.h>
 #include <ipxe/iobuf.h>
 #include <ipxe/malloc.h>
@@ -15,9 +16,11 @@
 #include <ipxe/open.h>
 #include <ipxe/uri.h>
 #include <ipxe/netdevice.h>
+#include <ipxe/settings.h>
 #include <ipxe/profile.h>
 #include <ipxe/process.h>
 #include <ipxe/tcpip.h>
+#include <ipxe/pmtu.h>
 #include <ipxe/tcp.h>
 
 /** @file
@@ -34,6 +37,8 @@ struct tcp_connection {
 	struct refcnt refcnt;
 	/** List of TCP connections */
 	struct list_head list;
+	/** List of TCP connections within hash bucket */
+	struct list_head hash;
 
 	/** Flags */
 	unsigned int flags;
@@ -47,6 +52,10 @@ struct tcp_connection {
 	unsigned int local_port;
 	/** Maximum segment size */
 	size_t mss;
+	/** Peer maximum segment size, or zero if not yet known */
+	size_t peer_mss;
+	/** Path MTU cache generation used to calculate sender MSS */
+	unsigned int pmtu_generation;
 
 	/** Current TCP state */
 	unsigned int tcp_state;
@@ -65,6 +74,24 @@ struct tcp_connection {
 	 * Equivalent to (SND.NXT-SND.UNA) in RFC 793 terminology.
 	 */
 	uint32_t snd_sent;
+	/** Maximum unacknowledged sequence count
+	 *
+	 * Equivalent to (SND.MAX-SND.UNA), i.e. the highest value of
+	 * @c snd_sent since the start of the current retransmission.
+	 */
+	uint32_t snd_max;
+	/** Recovery point
+	 *
+	 * Equivalent to "recover" in RFC 6582 terminology.
+	 */
+	uint32_t snd_recover;
+	/** Next sequence number to consider for retransmission
+	 *
+	 * Used only during fast recovery.
+	 */
+	uint32_t snd_rtx;
+	/** Number of consecutive duplicate ACKs received */
+	unsigned int dupacks;
 	/** Send window
 	 *
 	 * Equivalent to SND.WND in RFC 793 terminology
@@ -80,6 +107,14 @@ struct tcp_connection {
 	 * Equivalent to RCV.WND in RFC 793 terminology.
 	 */
 	uint32_t rcv_win;
+	/** Number of received segments awaiting delayed acknowledgement */
+	unsigned int rcv_delayed;
+	/** Maximum receive window
+	 *
+	 * This is the upper limit on the advertised receive window,
+	 * which may be increased by receive window auto-tuning.
+	 */
+	uint32_t rcv_win_max;
 	/** Received timestamp value
 	 *
 	 * Updated when a packet is received; copied to ts_recent when
@@ -91,6 +126,50 @@ struct tcp_connection {
 	 * Equivalent to TS.Recent in RFC 1323 terminology.
 	 */
 	uint32_t ts_recent;
+	/** Smoothed round-trip time
+	 *
+	 * This is measured in ticks, scaled by 2^TCP_RTT_SCALE.  A
+	 * value of zero indicates that no (non-negligible) round-trip
+	 * time has yet been measured.
+	 */
+	unsigned long srtt;
+	/** Round-trip time variation
+	 *
+	 * This is measured in ticks, scaled by 2^TCP_RTT_SCALE.
+	 */
+	unsigned long rttvar;
+	/** Retransmission timeout (in ticks, excluding any backoff) */
+	unsigned long rto;
+	/** Retransmission timeout backoff (as a power of two) */
+	unsigned int rto_backoff;
+	/** Number of retransmission events (timeouts and fast
+	 * retransmissions)
+	 */
+	unsigned long retransmits;
+	/** Number of retransmission timeouts */
+	unsigned long timeouts;
+	/** Number of tail loss probes */
+	unsigned long probes;
+	/** Number of data bytes received in order */
+	unsigned long in_octets;
+	/** Number of data bytes acknowledged by peer */
+	unsigned long out_octets;
+	/** Maximum span of out-of-order received data */
+	uint32_t rcv_ooo_max;
+	/** Number of times the peer closed its receive window */
+	unsigned long snd_zero_win;
+	/** Number of times we closed our receive window */
+	unsigned long rcv_zero_win;
+	/** Most recent echoed timestamp used for round-trip timing */
+	uint32_t ts_echoed;
+	/** Sequence number being timed for round-trip measurement */
+	uint32_t rtt_seq;
+	/** Transmission time of sequence number being timed */
+	unsigned long rtt_start;
+	/** Start time of current receive window auto-tuning interval */
+	unsigned long rcv_tune_start;
+	/** Data received during current receive window auto-tuning interval */
+	size_t rcv_tune_len;
 	/** Send window scale
 	 *
 	 * Equivalent to Snd.Wind.Scale in RFC 1323 terminology
@@ -102,11 +181,37 @@ struct tcp_connection {
 	 */
 	uint8_t rcv_win_scale;
 
+	/** Congestion control algorithm */
+	struct tcp_congestion_algorithm *cc;
+	/** Congestion control state */
+	struct tcp_congestion cong;
+
 	/** Selective acknowledgement list (in host-endian order) */
 	struct tcp_sack_block sack[TCP_SACK_MAX];
+	/** Peer selective acknowledgement scoreboard
+	 *
+	 * This is the list of sequence ranges beyond SND.UNA that
+	 * have been selectively acknowledged by the peer, in
+	 * ascending order (and in host-endian order).
+	 */
+	struct tcp_sack_block snd_sack[TCP_SND_SACK_MAX];
+	/** Number of blocks in peer selective acknowledgement scoreboard */
+	unsigned int snd_sack_count;
 
 	/** Transmit queue */
 	struct list_head tx_queue;
+	/** Length of data in transmit queue */
+	size_t tx_len;
+	/** Cached transmit queue position
+	 *
+	 * Segments are generally transmitted from successive
+	 * positions within the transmit queue.  This records the
+	 * I/O buffer most recently used to construct a segment, to
+	 * avoid walking the whole queue for every segment.
+	 */
+	struct io_buffer *tx_cursor;
+	/** Offset of cached transmit queue position within queue */
+	size_t tx_cursor_offset;
 	/** Receive queue */
 	struct list_head rx_queue;
 	/** Transmission process */
@@ -115,6 +220,8 @@ struct tcp_connection {
 	struct retry_timer timer;
 	/** Keepalive timer */
 	struct retry_timer keepalive;
+	/** Delayed acknowledgement timer */
+	struct retry_timer delack;
 	/** Shutdown (TIME_WAIT) timer */
 	struct retry_timer wait;
 
@@ -134,6 +241,18 @@ enum tcp_flags {
 	TCP_ACK_PENDING = 0x0004,
 	/** TCP selective acknowledgement is enabled */
 	TCP_SACK_ENABLED = 0x0008,
+	/** TCP round-trip time measurement is in progress */
+	TCP_RTT_TIMING = 0x0010,
+	/** TCP fast recovery is in progress */
+	TCP_RECOVERY = 0x0020,
+	/** TCP connection was opened passively (via a listener) */
+	TCP_PASSIVE = 0x0040,
+	/** TCP most recently advertised a zero receive window */
+	TCP_RCV_ZERO_WIN = 0x0080,
+	/** TCP retransmission timer is scheduled as a tail loss probe */
+	TCP_TLP_ARMED = 0x0100,
+	/** TCP tail loss probe has been sent for the current flight */
+	TCP_TLP_SENT = 0x0200,
 };
 
 /** TCP internal header
@@ -161,11 +280,54 @@ struct tcp_rx_queued_header {
 	uint8_t reserved[3];
 };
 
+/** A TCP Fast Open cookie cache entry */
+struct tcp_fastopen {
+	/** Peer address (without port) */
+	struct sockaddr_tcpip peer;
+	/** Peer maximum segment size */
+	size_t mss;
+	/** Cookie length, or zero if entry is unused */
+	size_t len;
+	/** Cookie */
+	uint8_t cookie[TCP_FASTOPEN_COOKIE_MAX];
+};
+
 /**
  * List of registered TCP connections
  */
 static LIST_HEAD ( tcp_conns );
 
+/**
+ * List of TCP listeners
+ */
+static LIST_HEAD ( tcp_listeners );
+
+/**
+ * TCP connections, hashed by local port
+ */
+static struct list_head tcp_hash[TCP_HASH_BUCKETS];
+
+/**
+ * Most recently demultiplexed TCP connection
+ *
+ * Received segments tend to arrive in bursts belonging to the same
+ * connection, so the most recent demultiplexing result is checked
+ * before searching the hash bucket.
+ */
+static struct tcp_connection *tcp_demux_last;
+
+/** TCP Fast Open cookie cache */
+static struct tcp_fastopen tcp_fastopen_cache[TCP_FASTOPEN_CACHE_SIZE];
+
+/** Next TCP Fast Open cookie cache entry to be replaced */
+static unsigned int tcp_fastopen_next;
+
+/** Maximum receive rate (in bytes per second), or zero for no limit */
+static unsigned long tcp_rx_rate;
+
+/** TCP congestion control algorithm */
+static struct tcp_congestion_algorithm *tcp_congestion;
+
 /** Transmit profiler */
 static struct profiler tcp_tx_profiler __profiler = { .name = "tcp.tx" };
 
@@ -180,8 +342,11 @@ static struct process_descriptor tcp_process_desc;
 static struct interface_descriptor tcp_xfer_desc;
 static void tcp_expired ( struct retry_timer *timer, int over );
 static void tcp_keepalive_expired ( struct retry_timer *timer, int over );
+static void tcp_delack_expired ( struct retry_timer *timer, int over );
 static void tcp_wait_expired ( struct retry_timer *timer, int over );
-static struct tcp_connection * tcp_demux ( unsigned int local_port );
+static uint32_t tcp_rx_window ( struct tcp_connection *tcp );
+static struct tcp_connection * tcp_demux ( unsigned int local_port,
+					   struct sockaddr_tcpip *peer );
 static int tcp_rx_ack ( struct tcp_connection *tcp, uint32_t ack,
 			uint32_t win );
 
@@ -250,6 +415,18 @@ tcp_dump_flags ( struct tcp_connection *tcp, unsigned int flags ) {
  ***************************************************************************
  */
 
+/**
+ * Get hash bucket for local TCP port
+ *
+ * @v port		Local port number
+ * @ret bucket		Hash bucket
+ */
+static inline __attribute__ (( always_inline )) struct list_head *
+tcp_bucket ( unsigned int port ) {
+
+	return &tcp_hash[ port & ( TCP_HASH_BUCKETS - 1 ) ];
+}
+
 /**
  * Check if local TCP port is available
  *
@@ -257,8 +434,147 @@ tcp_dump_flags ( struct tcp_connection *tcp, unsigned int flags ) {
  * @ret port		Local port number, or negative error
  */
 static int tcp_port_available ( int port ) {
+	struct tcp_listener *listener;
+
+	/* Check for listeners on this port */
+	list_for_each_entry ( listener, &tcp_listeners, list ) {
+		if ( listener->port == ( unsigned int ) port )
+			return -EADDRINUSE;
+	}
+
+	return ( tcp_demux ( port, NULL ) ? -EADDRINUSE : port );
+}
+
+/**
+ * Find TCP Fast Open cookie cache entry
+ *
+ * @v peer		Peer socket address
+ * @ret tfo		Cookie cache entry, or NULL if not found
+ */
+static struct tcp_fastopen * tcp_fastopen_find ( struct sockaddr_tcpip *peer ) {
+	struct tcpip_net_protocol *tcpip_net;
+	struct tcp_fastopen *tfo;
+	unsigned int i;
+
+	/* Identify network-layer protocol */
+	tcpip_net = tcpip_net_protocol ( peer->st_family );
+	if ( ! tcpip_net )
+		return NULL;
+
+	/* Find matching entry */
+	for ( i = 0 ; i < TCP_FASTOPEN_CACHE_SIZE ; i++ ) {
+		tfo = &tcp_fastopen_cache[i];
+		if ( tfo->len && ( tfo->peer.st_family == peer->st_family ) &&
+		     ( memcmp ( tfo->peer.pad, peer->pad,
+				tcpip_net->net_protocol->net_addr_len ) == 0 ))
+			return tfo;
+	}
+	return NULL;
+}
+
+/**
+ * Record TCP Fast Open cookie received from peer
+ *
+ * @v tcp		TCP connection
+ * @v options		TCP options
+ */
+static void tcp_fastopen_update ( struct tcp_connection *tcp,
+				  struct tcp_options *options ) {
+	struct tcpip_net_protocol *tcpip_net;
+	struct tcp_fastopen *tfo;
+	size_t len;
+
+	/* Do nothing unless the peer has provided a cookie */
+	if ( ! options->tfoopt )
+		return;
+	len = ( options->tfoopt->length - sizeof ( *options->tfoopt ) );
+	if ( ( len < TCP_FASTOPEN_COOKIE_MIN ) ||
+	     ( len > TCP_FASTOPEN_COOKIE_MAX ) ) {
+		DBGC ( tcp, "TCP %p ignoring %zd-byte Fast Open cookie\n",
+		       tcp, len );
+		return;
+	}
+	tcpip_net = tcpip_net_protocol ( tcp->peer.st_family );
+	if ( ! tcpip_net )
+		return;
+
+	/* Update existing entry, or replace the next entry */
+	tfo = tcp_fastopen_find ( &tcp->peer );
+	if ( ! tfo ) {
+		tfo = &tcp_fastopen_cache[ tcp_fastopen_next++ %
+					   TCP_FASTOPEN_CACHE_SIZE ];
+		memset ( &tfo->peer, 0, sizeof ( tfo->peer ) );
+		tfo->peer.st_family = tcp->peer.st_family;
+		memcpy ( tfo->peer.pad, tcp->peer.pad,
+			 tcpip_net->net_protocol->net_addr_len );
+	}
+	memcpy ( tfo->cookie, ( options->tfoopt + 1 ), len );
+	tfo->len = len;
+	tfo->mss = tcp->peer_mss;
+	DBGC ( tcp, "TCP %p received %zd-byte Fast Open cookie\n", tcp, len );
+}
+
+/**
+ * Forget TCP Fast Open cookie for peer
+ *
+ * @v tcp		TCP connection
+ */
+static void tcp_fastopen_forget ( struct tcp_connection *tcp ) {
+	struct tcp_fastopen *tfo;
+
+	tfo = tcp_fastopen_find ( &tcp->peer );
+	if ( tfo ) {
+		DBGC ( tcp, "TCP %p forgetting Fast Open cookie\n", tcp );
+		tfo->len = 0;
+	}
+}
+
+/**
+ * Calculate length of data that may be sent along with the SYN
+ *
+ * @v tcp		TCP connection
+ * @ret len		Maximum length of data
+ *
+ * Data may be sent along with the initial transmission of the SYN
+ * only if we hold a Fast Open cookie for the peer, as per RFC 7413.
+ */
+static size_t tcp_fastopen_len ( struct tcp_connection *tcp ) {
+	struct tcp_fastopen *tfo;
+	size_t mss;
+
+	/* Not possible unless the SYN has not yet been sent */
+	if ( ( tcp->tcp_state != TCP_SYN_SENT ) || tcp->snd_max )
+		return 0;
+
+	/* Not possible unless we hold a cookie for the peer */
+	tfo = tcp_fastopen_find ( &tcp->peer );
+	if ( ! tfo )
+		return 0;
+
+	/* Limit to both our and the peer's maximum segment sizes,
+	 * allowing for the options carried by the SYN.
+	 */
+	mss = tcp->mss;
+	if ( mss > tfo->mss )
+		mss = tfo->mss;
+	if ( mss <= TCP_MAX_SYN_OPTIONS_LEN )
+		return 0;
+	return ( mss - TCP_MAX_SYN_OPTIONS_LEN );
+}
 
-	return ( tcp_demux ( port ) ? -EADDRINUSE : port );
+/**
+ * Initialise TCP congestion control
+ *
+ * @v tcp		TCP connection
+ *
+ * The sender maximum segment size starts out as our own maximum segment
+ * size, and will be reduced once the peer's is known.
+ */
+static void tcp_congestion_init ( struct tcp_connection *tcp ) {
+
+	tcp->cc = tcp_congestion;
+	tcp->cong.mss = tcp->mss;
+	tcp->cc->init ( &tcp->cong );
 }
 
 /**
@@ -288,11 +604,15 @@ static int tcp_open ( struct interface *xfer, struct sockaddr *peer,
 	process_init_stopped ( &tcp->process, &tcp_process_desc, &tcp->refcnt );
 	timer_init ( &tcp->timer, tcp_expired, &tcp->refcnt );
 	timer_init ( &tcp->keepalive, tcp_keepalive_expired, &tcp->refcnt );
+	timer_init ( &tcp->delack, tcp_delack_expired, &tcp->refcnt );
 	timer_init ( &tcp->wait, tcp_wait_expired, &tcp->refcnt );
 	tcp->prev_tcp_state = TCP_CLOSED;
 	tcp->tcp_state = TCP_STATE_SENT ( TCP_SYN );
 	tcp_dump_state ( tcp );
 	tcp->snd_seq = random();
+	tcp->snd_recover = tcp->snd_seq;
+	tcp->rcv_win_max = TCP_MAX_WINDOW_SIZE;
+	tcp->rto = TCP_INITIAL_RTO;
 	INIT_LIST_HEAD ( &tcp->tx_queue );
 	INIT_LIST_HEAD ( &tcp->rx_queue );
 	memcpy ( &tcp->peer, st_peer, sizeof ( tcp->peer ) );
@@ -307,6 +627,9 @@ static int tcp_open ( struct interface *xfer, struct sockaddr *peer,
 	}
 	tcp->mss = ( mtu - sizeof ( struct tcp_header ) );
 
+	/* Initialise congestion control */
+	tcp_congestion_init ( tcp );
+
 	/* Bind to local port */
 	port = tcpip_bind ( st_local, tcp_port_available );
 	if ( port < 0 ) {
@@ -318,8 +641,15 @@ static int tcp_open ( struct interface *xfer, struct sockaddr *peer,
 	tcp->local_port = port;
 	DBGC ( tcp, "TCP %p bound to port %d\n", tcp, tcp->local_port );
 
-	/* Start timer to initiate SYN */
-	start_timer_nodelay ( &tcp->timer );
+	/* Start timer to initiate SYN.  If the application may send
+	 * data along with the SYN, then allow it a short time to do
+	 * so.
+	 */
+	if ( tcp_fastopen_len ( tcp ) ) {
+		start_timer_fixed ( &tcp->timer, TCP_FASTOPEN_DELAY );
+	} else {
+		start_timer_nodelay ( &tcp->timer );
+	}
 
 	/* Add a pending operation for the SYN */
 	pending_get ( &tcp->pending_flags );
@@ -329,6 +659,7 @@ static int tcp_open ( struct interface *xfer, struct sockaddr *peer,
 	 */
 	intf_plug_plug ( &tcp->xfer, xfer );
 	list_add ( &tcp->list, &tcp_conns );
+	list_add ( &tcp->hash, tcp_bucket ( tcp->local_port ) );
 	return 0;
 
  err:
@@ -336,6 +667,26 @@ static int tcp_open ( struct interface *xfer, struct sockaddr *peer,
 	return rc;
 }
 
+/**
+ * Log TCP connection statistics
+ *
+ * @v tcp		TCP connection
+ * @v rc		Reason for close
+ */
+static void tcp_log_statistics ( struct tcp_connection *tcp, int rc ) {
+
+	syslog ( LOG_INFO, "TCP %s:%d closed (%s): %ld bytes in, %ld bytes "
+		 "out, %ld retransmits (%ld timeouts), out-of-order max %d, "
+		 "zero windows %ld sent %ld received, send window %d, receive "
+		 "window %d, RTT %ldms\n",
+		 sock_ntoa ( ( struct sockaddr * ) &tcp->peer ),
+		 ntohs ( tcp->peer.st_port ), strerror ( rc ),
+		 tcp->in_octets, tcp->out_octets, tcp->retransmits,
+		 tcp->timeouts, tcp->rcv_ooo_max, tcp->rcv_zero_win,
+		 tcp->snd_zero_win, tcp->snd_win, tcp->rcv_win,
+		 ( ( tcp->srtt * 1000 ) / ( TICKS_PER_SEC << TCP_RTT_SCALE ) ));
+}
+
 /**
  * Close TCP connection
  *
@@ -349,6 +700,10 @@ static void tcp_close ( struct tcp_connection *tcp, int rc ) {
 	struct io_buffer *iobuf;
 	struct io_buffer *tmp;
 
+	/* Log statistics when the data transfer completes */
+	if ( ! ( tcp->flags & TCP_XFER_CLOSED ) )
+		tcp_log_statistics ( tcp, rc );
+
 	/* Close data transfer interface */
 	intf_shutdown ( &tcp->xfer, rc );
 	tcp->flags |= TCP_XFER_CLOSED;
@@ -370,6 +725,7 @@ static void tcp_close ( struct tcp_connection *tcp, int rc ) {
 		}
 
 		/* Free any unsent I/O buffers */
+		tcp->tx_cursor = NULL;
 		list_for_each_entry_safe ( iobuf, tmp, &tcp->tx_queue, list ) {
 			list_del ( &iobuf->list );
 			free_iob ( iobuf );
@@ -385,8 +741,12 @@ static void tcp_close ( struct tcp_connection *tcp, int rc ) {
 		process_del ( &tcp->process );
 		stop_timer ( &tcp->timer );
 		stop_timer ( &tcp->keepalive );
+		stop_timer ( &tcp->delack );
 		stop_timer ( &tcp->wait );
 		list_del ( &tcp->list );
+		list_del ( &tcp->hash );
+		if ( tcp_demux_last == tcp )
+			tcp_demux_last = NULL;
 		ref_put ( &tcp->refcnt );
 		DBGC ( tcp, "TCP %p connection deleted\n", tcp );
 		return;
@@ -422,6 +782,148 @@ static void tcp_close ( struct tcp_connection *tcp, int rc ) {
  ***************************************************************************
  */
 
+/**
+ * Calculate amount of selectively acknowledged data
+ *
+ * @v tcp		TCP connection
+ * @ret len		Length of selectively acknowledged data
+ */
+static uint32_t tcp_sacked ( struct tcp_connection *tcp ) {
+	struct tcp_sack_block *block;
+	uint32_t len = 0;
+	unsigned int i;
+
+	for ( i = 0 ; i < tcp->snd_sack_count ; i++ ) {
+		block = &tcp->snd_sack[i];
+		len += ( block->right - block->left );
+	}
+	return len;
+}
+
+/**
+ * Calculate amount of data in flight
+ *
+ * @v tcp		TCP connection
+ * @ret pipe		Estimated amount of data in flight
+ *
+ * Data that has been selectively acknowledged has left the network.
+ * If selective acknowledgements are not in use, then each duplicate
+ * ACK received during fast recovery is assumed to indicate that one
+ * segment has left the network, as per RFC 6582.
+ */
+static uint32_t tcp_pipe ( struct tcp_connection *tcp ) {
+	uint32_t left;
+
+	/* Calculate amount of data known to have left the network */
+	if ( tcp->flags & TCP_SACK_ENABLED ) {
+		left = tcp_sacked ( tcp );
+	} else if ( tcp->flags & TCP_RECOVERY ) {
+		left = ( tcp->dupacks * tcp->cong.mss );
+	} else {
+		left = 0;
+	}
+
+	return ( ( tcp->snd_sent > left ) ? ( tcp->snd_sent - left ) : 0 );
+}
+
+/**
+ * Calculate send window
+ *
+ * @v tcp		TCP connection
+ * @ret win		Maximum amount of data that may be in flight
+ */
+static uint32_t tcp_send_win ( struct tcp_connection *tcp ) {
+	uint32_t win;
+
+	/* Window is the minimum of the receiver's window and the
+	 * congestion window, limited to conserve memory usage.
+	 */
+	win = tcp->snd_win;
+	if ( win > tcp->cong.cwnd )
+		win = tcp->cong.cwnd;
+	if ( win > TCP_MAX_SEND_WINDOW_SIZE )
+		win = TCP_MAX_SEND_WINDOW_SIZE;
+
+	return win;
+}
+
+/**
+ * Update sender maximum segment size
+ *
+ * @v tcp		TCP connection
+ *
+ * The sender maximum segment size is limited by both the peer's
+ * advertised maximum segment size and the path MTU, and allows space
+ * for a (padded) TCP timestamp option.
+ */
+static void tcp_pmtu ( struct tcp_connection *tcp ) {
+	size_t opts_len = sizeof ( struct tcp_timestamp_padded_option );
+	size_t mtu;
+	size_t mss;
+
+	/* Record path MTU cache generation */
+	tcp->pmtu_generation = pmtu_generation;
+
+	/* Calculate maximum segment size */
+	mtu = tcpip_mtu ( &tcp->peer );
+	if ( mtu <= sizeof ( struct tcp_header ) )
+		return;
+	mss = ( mtu - sizeof ( struct tcp_header ) );
+	if ( mss > tcp->peer_mss )
+		mss = tcp->peer_mss;
+	if ( mss <= opts_len )
+		return;
+	mss -= opts_len;
+
+	/* Update maximum segment size, if changed */
+	if ( mss != tcp->cong.mss ) {
+		DBGC ( tcp, "TCP %p sender MSS changed from %zd to %zd\n",
+		       tcp, tcp->cong.mss, mss );
+		tcp->cong.mss = mss;
+	}
+}
+
+/**
+ * Calculate maximum payload length of a single packet
+ *
+ * @v tcp		TCP connection
+ * @v netdev		Transmitting network device, or NULL
+ * @ret len		Maximum payload length
+ *
+ * Payloads are limited to the path MTU, unless the transmitting
+ * network device is capable of splitting larger packets into
+ * segments of that size.
+ */
+static size_t tcp_xmit_max ( struct tcp_connection *tcp,
+			     struct net_device *netdev ) {
+	unsigned int tso;
+	size_t mss;
+	size_t len;
+
+	/* Update sender maximum segment size if path MTU has changed */
+	if ( tcp->peer_mss && ( tcp->pmtu_generation != pmtu_generation ) )
+		tcp_pmtu ( tcp );
+	mss = tcp->cong.mss;
+
+	/* Identify required segmentation offload capability */
+	tso = ( ( tcp->peer.st_family == AF_INET6 ) ?
+		NETDEV_TX_TSO6 : NETDEV_TX_TSO4 );
+
+	/* Limit to path MTU unless segmentation offload is available */
+	if ( ! ( netdev && ( netdev->offload & NETDEV_TX_CSUM ) &&
+		 ( netdev->offload & tso ) ) )
+		return mss;
+
+	/* Limit to maximum segmentation offload length */
+	if ( netdev->tso_max_len <= ( TCP_MAX_HEADER_LEN + mss ) )
+		return mss;
+	len = ( netdev->tso_max_len - TCP_MAX_HEADER_LEN );
+	if ( len > ( TCP_TSO_MAX_SEGMENTS * TCP_PATH_MTU ) )
+		len = ( TCP_TSO_MAX_SEGMENTS * TCP_PATH_MTU );
+
+	return len;
+}
+
 /**
  * Calculate transmission window
  *
@@ -429,16 +931,41 @@ static void tcp_close ( struct tcp_connection *tcp, int rc ) {
  * @ret len		Maximum length that can be sent in a single packet
  */
 static size_t tcp_xmit_win ( struct tcp_connection *tcp ) {
+	struct net_device *netdev;
+	uint32_t win;
+	uint32_t pipe;
+	size_t max_len;
 	size_t len;
 
 	/* Not ready if we're not in a suitable connection state */
 	if ( ! TCP_CAN_SEND_DATA ( tcp->tcp_state ) )
 		return 0;
 
-	/* Length is the minimum of the receiver's window and the path MTU */
-	len = tcp->snd_win;
-	if ( len > TCP_PATH_MTU )
-		len = TCP_PATH_MTU;
+	/* Length is limited by the space remaining within the
+	 * congestion window, excluding data that is known to have
+	 * left the network.
+	 */
+	win = tcp->cong.cwnd;
+	if ( win > TCP_MAX_SEND_WINDOW_SIZE )
+		win = TCP_MAX_SEND_WINDOW_SIZE;
+	pipe = tcp_pipe ( tcp );
+	if ( win <= pipe )
+		return 0;
+	len = ( win - pipe );
+
+	/* Length is also limited by the receiver's window */
+	if ( tcp->snd_win <= tcp->snd_sent )
+		return 0;
+	if ( len > ( tcp->snd_win - tcp->snd_sent ) )
+		len = ( tcp->snd_win - tcp->snd_sent );
+
+	/* Limit length to the path MTU (or to the maximum
+	 * segmentation offload length, if applicable).
+	 */
+	netdev = tcpip_netdev ( &tcp->peer );
+	max_len = tcp_xmit_max ( tcp, netdev );
+	if ( len > max_len )
+		len = max_len;
 
 	return len;
 }
@@ -450,16 +977,23 @@ static size_t tcp_xmit_win ( struct tcp_connection *tcp ) {
  * @ret len		Length of window
  */
 static size_t tcp_xfer_window ( struct tcp_connection *tcp ) {
+	uint32_t win;
 
-	/* Not ready if data queue is non-empty.  This imposes a limit
-	 * of only one unACKed packet in the TX queue at any time; we
-	 * do this to conserve memory usage.
+	/* Allow the application to fill the send window.  Data
+	 * remains in the TX queue until it has been acknowledged, so
+	 * this also limits the memory consumed by the TX queue.  If
+	 * we're not yet in a suitable connection state, allow only
+	 * as much data as may be sent along with the SYN.
 	 */
-	if ( ! list_empty ( &tcp->tx_queue ) )
+	if ( TCP_CAN_SEND_DATA ( tcp->tcp_state ) ) {
+		win = tcp_send_win ( tcp );
+	} else {
+		win = tcp_fastopen_len ( tcp );
+	}
+	if ( win <= tcp->tx_len )
 		return 0;
 
-	/* Return TCP window length */
-	return tcp_xmit_win ( tcp );
+	return ( win - tcp->tx_len );
 }
 
 /**
@@ -550,43 +1084,123 @@ static unsigned int tcp_sack ( struct tcp_connection *tcp, uint32_t seq ) {
 	return new;
 }
 
+/**
+ * Calculate number of SACK blocks that will fit within a segment
+ *
+ * @v tcp		TCP connection
+ * @v len		Length of data payload
+ * @ret max		Maximum number of SACK blocks
+ *
+ * The sender maximum segment size allows space only for a timestamp
+ * option, and so a full-sized segment has no room for any SACK
+ * blocks unless timestamps are disabled.
+ */
+static unsigned int tcp_sack_max ( struct tcp_connection *tcp, size_t len ) {
+	size_t room;
+	unsigned int max;
+
+	/* Calculate space remaining within each segment */
+	room = ( ( len < tcp->cong.mss ) ? ( tcp->cong.mss - len ) : 0 );
+	if ( ! ( tcp->flags & TCP_TS_ENABLED ) )
+		room += sizeof ( struct tcp_timestamp_padded_option );
+	if ( room < sizeof ( struct tcp_sack_padded_option ) )
+		return 0;
+
+	/* Calculate number of SACK blocks */
+	max = ( ( room - sizeof ( struct tcp_sack_padded_option ) ) /
+		sizeof ( struct tcp_sack_block ) );
+	if ( max > TCP_SACK_MAX )
+		max = TCP_SACK_MAX;
+
+	return max;
+}
+
 /**
  * Process TCP transmit queue
  *
  * @v tcp		TCP connection
+ * @v offset		Offset within transmit queue
  * @v max_len		Maximum length to process
  * @v dest		I/O buffer to fill with data, or NULL
  * @v remove		Remove data from queue
  * @ret len		Length of data processed
  *
  * This processes at most @c max_len bytes from the TCP connection's
- * transmit queue.  Data will be copied into the @c dest I/O buffer
- * (if provided) and, if @c remove is true, removed from the transmit
- * queue.
+ * transmit queue, starting at @c offset bytes from the start of the
+ * queue.  Data will be copied into the @c dest I/O buffer (if
+ * provided) and, if @c remove is true, removed from the transmit
+ * queue.  Data may be removed only from the start of the queue.
  */
-static size_t tcp_process_tx_queue ( struct tcp_connection *tcp, size_t max_len,
+static size_t tcp_process_tx_queue ( struct tcp_connection *tcp,
+				     size_t offset, size_t max_len,
 				     struct io_buffer *dest, int remove ) {
 	struct io_buffer *iobuf;
 	struct io_buffer *tmp;
 	size_t frag_len;
+	size_t start = 0;
 	size_t len = 0;
 
-	list_for_each_entry_safe ( iobuf, tmp, &tcp->tx_queue, list ) {
-		frag_len = iob_len ( iobuf );
-		if ( frag_len > max_len )
-			frag_len = max_len;
-		if ( dest ) {
-			memcpy ( iob_put ( dest, frag_len ), iobuf->data,
-				 frag_len );
-		}
-		if ( remove ) {
+	/* Sanity check */
+	assert ( ( offset == 0 ) || ( ! remove ) );
+
+	/* Remove data from start of queue, if applicable */
+	if ( remove ) {
+		list_for_each_entry_safe ( iobuf, tmp, &tcp->tx_queue, list ) {
+			frag_len = iob_len ( iobuf );
+			if ( frag_len && ( ! max_len ) )
+				break;
+			if ( frag_len > max_len )
+				frag_len = max_len;
+			if ( dest ) {
+				memcpy ( iob_put ( dest, frag_len ),
+					 iobuf->data, frag_len );
+			}
 			iob_pull ( iobuf, frag_len );
+			tcp->tx_len -= frag_len;
 			if ( ! iob_len ( iobuf ) ) {
+				if ( iobuf == tcp->tx_cursor )
+					tcp->tx_cursor = NULL;
 				list_del ( &iobuf->list );
 				free_iob ( iobuf );
 				pending_put ( &tcp->pending_data );
 			}
+			len += frag_len;
+			max_len -= frag_len;
+		}
+
+		/* Adjust cached position */
+		tcp->tx_cursor_offset -= ( ( len < tcp->tx_cursor_offset ) ?
+					   len : tcp->tx_cursor_offset );
+		return len;
+	}
+
+	/* Start from cached position, if it lies before the offset */
+	if ( tcp->tx_cursor && ( tcp->tx_cursor_offset <= offset ) ) {
+		iobuf = tcp->tx_cursor;
+		start = tcp->tx_cursor_offset;
+	} else {
+		iobuf = list_first_entry ( &tcp->tx_queue, struct io_buffer,
+					   list );
+	}
+
+	/* Copy data from queue */
+	for ( ; iobuf && max_len ;
+	      start += iob_len ( iobuf ),
+	      iobuf = list_next_entry ( iobuf, &tcp->tx_queue, list ) ) {
+		frag_len = iob_len ( iobuf );
+		if ( ( offset - start ) >= frag_len )
+			continue;
+		tcp->tx_cursor = iobuf;
+		tcp->tx_cursor_offset = start;
+		frag_len -= ( offset - start );
+		if ( frag_len > max_len )
+			frag_len = max_len;
+		if ( dest ) {
+			memcpy ( iob_put ( dest, frag_len ),
+				 ( iobuf->data + ( offset - start ) ),
+				 frag_len );
 		}
+		offset += frag_len;
 		len += frag_len;
 		max_len -= frag_len;
 	}
@@ -594,18 +1208,73 @@ static size_t tcp_process_tx_queue ( struct tcp_connection *tcp, size_t max_len,
 }
 
 /**
- * Transmit any outstanding data (with selective acknowledgement)
+ * Calculate retransmission timeout
+ *
+ * @v tcp		TCP connection
+ * @ret timeout		Retransmission timeout (in ticks)
+ */
+static unsigned long tcp_rto ( struct tcp_connection *tcp ) {
+
+	return ( tcp->rto << tcp->rto_backoff );
+}
+
+/**
+ * Start retransmission timer
+ *
+ * @v tcp		TCP connection
+ *
+ * Where possible, the timer is scheduled to fire early as a tail loss
+ * probe (as per RFC 8985).  A probe elicits an acknowledgement that
+ * allows a loss at the tail of a flight to be repaired without
+ * waiting for (and collapsing the congestion window upon) a full
+ * retransmission timeout.
+ */
+static void tcp_start_timer ( struct tcp_connection *tcp ) {
+	unsigned long timeout = tcp_rto ( tcp );
+	unsigned long pto;
+
+	/* Schedule a probe only for established connections with
+	 * selective acknowledgements and a measured round-trip time,
+	 * and only once per flight.
+	 */
+	tcp->flags &= ~TCP_TLP_ARMED;
+	if ( ( tcp->flags & TCP_SACK_ENABLED ) &&
+	     ( ! ( tcp->flags & ( TCP_RECOVERY | TCP_TLP_SENT ) ) ) &&
+	     TCP_CAN_SEND_DATA ( tcp->tcp_state ) &&
+	     tcp->srtt && ( tcp->rto_backoff == 0 ) ) {
+
+		/* Allow for a delayed acknowledgement if only a
+		 * single segment is in flight.
+		 */
+		pto = ( 2 * ( tcp->srtt >> TCP_RTT_SCALE ) );
+		if ( tcp->snd_sent <= tcp->cong.mss )
+			pto += TCP_TLP_DELACK;
+		if ( pto < TCP_TLP_MIN )
+			pto = TCP_TLP_MIN;
+		if ( pto < timeout ) {
+			timeout = pto;
+			tcp->flags |= TCP_TLP_ARMED;
+		}
+	}
+
+	start_timer_fixed ( &tcp->timer, timeout );
+}
+
+/**
+ * Transmit a segment
  *
  * @v tcp		TCP connection
+ * @v flags		TCP flags
+ * @v seq		SEQ value (in host-endian order)
+ * @v len		Length of data payload
  * @v sack_seq		SEQ for first selective acknowledgement (if any)
- * 
- * Transmits any outstanding data on the connection.
+ * @ret rc		Return status code
  *
- * Note that even if an error is returned, the retransmission timer
- * will have been started if necessary, and so the stack will
- * eventually attempt to retransmit the failed packet.
+ * The data payload is taken from the transmit queue, starting at the
+ * position corresponding to the specified SEQ value.
  */
-static void tcp_xmit_sack ( struct tcp_connection *tcp, uint32_t sack_seq ) {
+static int tcp_xmit_packet ( struct tcp_connection *tcp, unsigned int flags,
+			     uint32_t seq, size_t len, uint32_t sack_seq ) {
 	struct io_buffer *iobuf;
 	struct tcp_header *tcphdr;
 	struct tcp_mss_option *mssopt;
@@ -614,69 +1283,51 @@ static void tcp_xmit_sack ( struct tcp_connection *tcp, uint32_t sack_seq ) {
 	struct tcp_sack_permitted_padded_option *spopt;
 	struct tcp_sack_padded_option *sackopt;
 	struct tcp_sack_block *sack;
+	struct net_device *netdev;
 	void *payload;
-	unsigned int flags;
 	unsigned int sack_count;
+	unsigned int sack_max;
 	unsigned int i;
-	size_t len = 0;
 	size_t sack_len;
 	uint32_t seq_len;
 	uint32_t max_rcv_win;
+	uint32_t rate_win;
 	uint32_t max_representable_win;
+	struct tcp_fastopen *tfo;
+	struct tcp_fastopen_option *tfoopt;
+	size_t tfo_len;
+	size_t tfo_pad;
+	void *tfo_data;
+	int offer;
 	int rc;
 
 	/* Start profiling */
 	profile_start ( &tcp_tx_profiler );
 
-	/* If retransmission timer is already running, do nothing */
-	if ( timer_running ( &tcp->timer ) )
-		return;
-
-	/* Calculate both the actual (payload) and sequence space
-	 * lengths that we wish to transmit.
-	 */
-	if ( TCP_CAN_SEND_DATA ( tcp->tcp_state ) ) {
-		len = tcp_process_tx_queue ( tcp, tcp_xmit_win ( tcp ),
-					     NULL, 0 );
-	}
-	seq_len = len;
-	flags = TCP_FLAGS_SENDING ( tcp->tcp_state );
-	if ( flags & ( TCP_SYN | TCP_FIN ) ) {
-		/* SYN or FIN consume one byte, and we can never send both */
-		assert ( ! ( ( flags & TCP_SYN ) && ( flags & TCP_FIN ) ) );
-		seq_len++;
-	}
-	tcp->snd_sent = seq_len;
-
-	/* If we have nothing to transmit, stop now */
-	if ( ( seq_len == 0 ) && ! ( tcp->flags & TCP_ACK_PENDING ) )
-		return;
-
-	/* If we are transmitting anything that requires
-	 * acknowledgement (i.e. consumes sequence space), start the
-	 * retransmission timer.  Do this before attempting to
-	 * allocate the I/O buffer, in case allocation itself fails.
-	 */
-	if ( seq_len )
-		start_timer ( &tcp->timer );
+	/* Calculate sequence space length */
+	seq_len = ( len + ( ( flags & ( TCP_SYN | TCP_FIN ) ) ? 1 : 0 ) );
 
 	/* Allocate I/O buffer */
 	iobuf = alloc_iob ( len + TCP_MAX_HEADER_LEN );
 	if ( ! iobuf ) {
 		DBGC ( tcp, "TCP %p could not allocate iobuf for %08x..%08x "
-		       "%08x\n", tcp, tcp->snd_seq, ( tcp->snd_seq + seq_len ),
-		       tcp->rcv_ack );
-		return;
+		       "%08x\n", tcp, seq, ( seq + seq_len ), tcp->rcv_ack );
+		return -ENOMEM;
 	}
 	iob_reserve ( iobuf, TCP_MAX_HEADER_LEN );
 
 	/* Fill data payload from transmit queue */
-	tcp_process_tx_queue ( tcp, len, iobuf, 0 );
+	tcp_process_tx_queue ( tcp, ( seq - tcp->snd_seq ), len, iobuf, 0 );
 
 	/* Expand receive window if possible */
 	max_rcv_win = xfer_window ( &tcp->xfer );
-	if ( max_rcv_win > TCP_MAX_WINDOW_SIZE )
-		max_rcv_win = TCP_MAX_WINDOW_SIZE;
+	if ( max_rcv_win > tcp->rcv_win_max )
+		max_rcv_win = tcp->rcv_win_max;
+	if ( tcp_rx_rate ) {
+		rate_win = tcp_rx_window ( tcp );
+		if ( max_rcv_win > rate_win )
+			max_rcv_win = rate_win;
+	}
 	max_representable_win = ( 0xffff << tcp->rcv_win_scale );
 	if ( max_rcv_win > max_representable_win )
 		max_rcv_win = max_representable_win;
@@ -686,22 +1337,28 @@ static void tcp_xmit_sack ( struct tcp_connection *tcp, uint32_t sack_seq ) {
 
 	/* Fill up the TCP header */
 	payload = iobuf->data;
+	offer = ( ( flags & TCP_SYN ) && ! ( tcp->flags & TCP_PASSIVE ) );
 	if ( flags & TCP_SYN ) {
 		mssopt = iob_push ( iobuf, sizeof ( *mssopt ) );
 		mssopt->kind = TCP_OPTION_MSS;
 		mssopt->length = sizeof ( *mssopt );
 		mssopt->mss = htons ( tcp->mss );
+	}
+	if ( offer || ( ( flags & TCP_SYN ) && tcp->rcv_win_scale ) ) {
 		wsopt = iob_push ( iobuf, sizeof ( *wsopt ) );
 		wsopt->nop = TCP_OPTION_NOP;
 		wsopt->wsopt.kind = TCP_OPTION_WS;
 		wsopt->wsopt.length = sizeof ( wsopt->wsopt );
 		wsopt->wsopt.scale = TCP_RX_WINDOW_SCALE;
+	}
+	if ( offer ||
+	     ( ( flags & TCP_SYN ) && ( tcp->flags & TCP_SACK_ENABLED ) ) ) {
 		spopt = iob_push ( iobuf, sizeof ( *spopt ) );
 		memset ( spopt->nop, TCP_OPTION_NOP, sizeof ( spopt->nop ) );
 		spopt->spopt.kind = TCP_OPTION_SACK_PERMITTED;
 		spopt->spopt.length = sizeof ( spopt->spopt );
 	}
-	if ( ( flags & TCP_SYN ) || ( tcp->flags & TCP_TS_ENABLED ) ) {
+	if ( offer || ( tcp->flags & TCP_TS_ENABLED ) ) {
 		tsopt = iob_push ( iobuf, sizeof ( *tsopt ) );
 		memset ( tsopt->nop, TCP_OPTION_NOP, sizeof ( tsopt->nop ) );
 		tsopt->tsopt.kind = TCP_OPTION_TS;
@@ -709,9 +1366,27 @@ static void tcp_xmit_sack ( struct tcp_connection *tcp, uint32_t sack_seq ) {
 		tsopt->tsopt.tsval = htonl ( currticks() );
 		tsopt->tsopt.tsecr = htonl ( tcp->ts_recent );
 	}
+	if ( offer && ( tcp->rto_backoff == 0 ) ) {
+		/* Send our cookie for the peer (if any) with the
+		 * initial SYN, or an empty option to request a cookie.
+		 */
+		tfo = tcp_fastopen_find ( &tcp->peer );
+		tfo_len = ( sizeof ( *tfoopt ) + ( tfo ? tfo->len : 0 ) );
+		tfo_pad = ( ( -tfo_len ) & 0x03 );
+		tfo_data = iob_push ( iobuf, ( tfo_pad + tfo_len ) );
+		memset ( tfo_data, TCP_OPTION_NOP, tfo_pad );
+		tfoopt = ( tfo_data + tfo_pad );
+		tfoopt->kind = TCP_OPTION_FASTOPEN;
+		tfoopt->length = tfo_len;
+		if ( tfo )
+			memcpy ( ( tfoopt + 1 ), tfo->cookie, tfo->len );
+	}
 	if ( ( tcp->flags & TCP_SACK_ENABLED ) &&
 	     ( ! list_empty ( &tcp->rx_queue ) ) &&
+	     ( ( sack_max = tcp_sack_max ( tcp, len ) ) != 0 ) &&
 	     ( ( sack_count = tcp_sack ( tcp, sack_seq ) ) != 0 ) ) {
+		if ( sack_count > sack_max )
+			sack_count = sack_max;
 		sack_len = ( sack_count * sizeof ( *sack ) );
 		sackopt = iob_push ( iobuf, ( sizeof ( *sackopt ) + sack_len ));
 		memset ( sackopt->nop, TCP_OPTION_NOP, sizeof ( sackopt->nop ));
@@ -730,12 +1405,39 @@ static void tcp_xmit_sack ( struct tcp_connection *tcp, uint32_t sack_seq ) {
 	memset ( tcphdr, 0, sizeof ( *tcphdr ) );
 	tcphdr->src = htons ( tcp->local_port );
 	tcphdr->dest = tcp->peer.st_port;
-	tcphdr->seq = htonl ( tcp->snd_seq );
+	tcphdr->seq = htonl ( seq );
 	tcphdr->ack = htonl ( tcp->rcv_ack );
 	tcphdr->hlen = ( ( payload - iobuf->data ) << 2 );
 	tcphdr->flags = flags;
 	tcphdr->win = htons ( tcp->rcv_win >> tcp->rcv_win_scale );
-	tcphdr->csum = tcpip_chksum ( iobuf->data, iob_len ( iobuf ) );
+
+	/* Record zero window advertisements */
+	if ( tcphdr->win ) {
+		tcp->flags &= ~TCP_RCV_ZERO_WIN;
+	} else if ( ! ( tcp->flags & TCP_RCV_ZERO_WIN ) ) {
+		tcp->flags |= TCP_RCV_ZERO_WIN;
+		tcp->rcv_zero_win++;
+	}
+
+	/* Calculate checksum, or leave it (and any segmentation) to
+	 * the network device if possible.
+	 */
+	netdev = tcpip_netdev ( &tcp->peer );
+	if ( netdev && ( netdev->offload & NETDEV_TX_CSUM ) ) {
+		iobuf->flags |= IOB_TX_CSUM;
+		iobuf->trans = tcphdr;
+		iobuf->trans_len = ( payload - iobuf->data );
+		iobuf->csum_offset = offsetof ( struct tcp_header, csum );
+		tcphdr->csum = TCPIP_EMPTY_CSUM;
+		if ( len > tcp->cong.mss ) {
+			assert ( len <= tcp_xmit_max ( tcp, netdev ) );
+			iobuf->flags |= IOB_TX_TSO;
+			iobuf->mss = tcp->cong.mss;
+		}
+	} else {
+		assert ( len <= tcp->cong.mss );
+		tcphdr->csum = tcpip_chksum ( iobuf->data, iob_len ( iobuf ) );
+	}
 
 	/* Dump header */
 	DBGC2 ( tcp, "TCP %p TX %d->%d %08x..%08x           %08x %4zd",
@@ -749,15 +1451,136 @@ static void tcp_xmit_sack ( struct tcp_connection *tcp, uint32_t sack_seq ) {
 	if ( ( rc = tcpip_tx ( iobuf, &tcp_protocol, NULL, &tcp->peer, NULL,
 			       &tcphdr->csum ) ) != 0 ) {
 		DBGC ( tcp, "TCP %p could not transmit %08x..%08x %08x: %s\n",
-		       tcp, tcp->snd_seq, ( tcp->snd_seq + tcp->snd_sent ),
-		       tcp->rcv_ack, strerror ( rc ) );
-		return;
+		       tcp, seq, ( seq + seq_len ), tcp->rcv_ack,
+		       strerror ( rc ) );
+		return rc;
 	}
 
-	/* Clear ACK-pending flag */
+	/* Clear ACK-pending flag and any delayed acknowledgement */
 	tcp->flags &= ~TCP_ACK_PENDING;
+	tcp->rcv_delayed = 0;
+	stop_timer ( &tcp->delack );
 
 	profile_stop ( &tcp_tx_profiler );
+	return 0;
+}
+
+/**
+ * Transmit a single segment
+ *
+ * @v tcp		TCP connection
+ * @v sack_seq		SEQ for first selective acknowledgement (if any)
+ * @ret seq_len		Sequence space length transmitted
+ *
+ * Transmits the next segment of outstanding data on the connection
+ * (or a pure ACK, if one is pending and no data can be sent).
+ *
+ * Note that even if transmission fails, the retransmission timer
+ * will have been started if necessary, and so the stack will
+ * eventually attempt to retransmit the failed packet.
+ */
+static uint32_t tcp_xmit_segment ( struct tcp_connection *tcp,
+				   uint32_t sack_seq ) {
+	unsigned int flags;
+	size_t max_len;
+	size_t len = 0;
+	uint32_t seq;
+	uint32_t seq_len;
+	int restart;
+
+	/* Calculate both the actual (payload) and sequence space
+	 * lengths that we wish to transmit, starting from the first
+	 * unsent sequence number.
+	 */
+	seq = ( tcp->snd_seq + tcp->snd_sent );
+	if ( TCP_CAN_SEND_DATA ( tcp->tcp_state ) &&
+	     ( tcp->tx_len > tcp->snd_sent ) ) {
+		len = ( tcp->tx_len - tcp->snd_sent );
+		if ( len > tcp_xmit_win ( tcp ) )
+			len = tcp_xmit_win ( tcp );
+	} else if ( ( max_len = tcp_fastopen_len ( tcp ) ) != 0 ) {
+		len = tcp->tx_len;
+		if ( len > max_len )
+			len = max_len;
+	}
+	seq_len = len;
+	flags = TCP_FLAGS_SENDING ( tcp->tcp_state );
+	if ( flags & ( TCP_SYN | TCP_FIN ) ) {
+		/* SYN or FIN consume one byte, and we can never send
+		 * both.  Neither is ever sent along with data (other
+		 * than in the initial transmission of a Fast Open
+		 * SYN), and so any sequence space already in flight
+		 * must include the SYN or FIN itself.
+		 */
+		assert ( ! ( ( flags & TCP_SYN ) && ( flags & TCP_FIN ) ) );
+		if ( tcp->snd_sent ) {
+			flags &= ~( TCP_SYN | TCP_FIN );
+		} else {
+			seq_len++;
+		}
+	}
+
+	/* If we have nothing to transmit, stop now */
+	if ( ( seq_len == 0 ) && ! ( tcp->flags & TCP_ACK_PENDING ) )
+		return 0;
+
+	/* If we are transmitting anything that requires
+	 * acknowledgement (i.e. consumes sequence space), record it
+	 * as being in flight and start the retransmission timer.  Do
+	 * this before attempting to allocate the I/O buffer, in case
+	 * allocation itself fails.
+	 */
+	if ( seq_len ) {
+
+		/* Time this segment if we are not using timestamps,
+		 * and this is not a retransmission (as per Karn's
+		 * algorithm).
+		 */
+		if ( ! ( tcp->flags & ( TCP_TS_ENABLED | TCP_RTT_TIMING ) ) &&
+		     ( tcp->snd_sent >= tcp->snd_max ) ) {
+			tcp->flags |= TCP_RTT_TIMING;
+			tcp->rtt_seq = ( seq + seq_len );
+			tcp->rtt_start = currticks();
+		}
+
+		/* Start retransmission timer, if not already running.
+		 * If nothing is yet in flight, then any running timer
+		 * is the timer used to trigger sending the SYN.  A
+		 * scheduled tail loss probe is rescheduled relative
+		 * to the most recent transmission.
+		 */
+		restart = ( ( ! tcp->snd_sent ) ||
+			    ( ! timer_running ( &tcp->timer ) ) ||
+			    ( tcp->flags & TCP_TLP_ARMED ) );
+
+		/* Update sent counters */
+		tcp->snd_sent += seq_len;
+		if ( tcp->snd_sent > tcp->snd_max )
+			tcp->snd_max = tcp->snd_sent;
+		if ( restart )
+			tcp_start_timer ( tcp );
+	}
+
+	/* Transmit segment */
+	if ( tcp_xmit_packet ( tcp, flags, seq, len, sack_seq ) != 0 )
+		return 0;
+
+	return seq_len;
+}
+
+/**
+ * Transmit any outstanding data (with selective acknowledgement)
+ *
+ * @v tcp		TCP connection
+ * @v sack_seq		SEQ for first selective acknowledgement (if any)
+ *
+ * Transmits as much outstanding data on the connection as the send
+ * window permits.
+ */
+static void tcp_xmit_sack ( struct tcp_connection *tcp, uint32_t sack_seq ) {
+
+	/* Transmit segments until we run out of data or window */
+	while ( tcp_xmit_segment ( tcp, sack_seq ) ) {}
 }
 
 /**
@@ -771,6 +1594,116 @@ static void tcp_xmit ( struct tcp_connection *tcp ) {
 	tcp_xmit_sack ( tcp, tcp->rcv_ack );
 }
 
+/**
+ * Retransmit next lost segment
+ *
+ * @v tcp		TCP connection
+ *
+ * During fast recovery, retransmit the next segment (at or after
+ * the retransmission point) that is believed to have been lost.  If
+ * selective acknowledgements are in use, this is the next hole lying
+ * below a selectively acknowledged block; otherwise it is the first
+ * unacknowledged segment.
+ */
+static void tcp_xmit_rtx ( struct tcp_connection *tcp ) {
+	struct tcp_sack_block *block;
+	uint32_t seq = tcp->snd_rtx;
+	uint32_t end = ( tcp->snd_seq + tcp->snd_sent );
+	unsigned int flags;
+	unsigned int i;
+	size_t len;
+
+	/* Never retransmit anything already acknowledged */
+	if ( tcp_cmp ( seq, tcp->snd_seq ) < 0 )
+		seq = tcp->snd_seq;
+
+	/* Find next hole */
+	if ( tcp->flags & TCP_SACK_ENABLED ) {
+		for ( i = 0 ; i < tcp->snd_sack_count ; i++ ) {
+			block = &tcp->snd_sack[i];
+			if ( tcp_cmp ( block->right, seq ) <= 0 )
+				continue;
+			if ( tcp_cmp ( block->left, seq ) <= 0 ) {
+				seq = block->right;
+				continue;
+			}
+			end = block->left;
+			break;
+		}
+		if ( i == tcp->snd_sack_count )
+			return;
+	} else if ( seq != tcp->snd_seq ) {
+		return;
+	}
+
+	/* Calculate length to retransmit */
+	if ( tcp_cmp ( end, seq ) <= 0 )
+		return;
+	len = ( end - seq );
+	if ( len > tcp->cong.mss )
+		len = tcp->cong.mss;
+	len = tcp_process_tx_queue ( tcp, ( seq - tcp->snd_seq ), len,
+				     NULL, 0 );
+	if ( ! len )
+		return;
+	DBGC ( tcp, "TCP %p retransmitting %08x..%08x\n",
+	       tcp, seq, ( seq + ( uint32_t ) len ) );
+
+	/* Update retransmission point */
+	tcp->snd_rtx = ( seq + len );
+	tcp->retransmits++;
+
+	/* Start retransmission timer, if not already running */
+	if ( ! timer_running ( &tcp->timer ) )
+		tcp_start_timer ( tcp );
+
+	/* Retransmit segment */
+	flags = ( TCP_FLAGS_SENDING ( tcp->tcp_state ) &
+		  ~( TCP_SYN | TCP_FIN ) );
+	tcp_xmit_packet ( tcp, flags, seq, len, tcp->rcv_ack );
+}
+
+/**
+ * Transmit tail loss probe
+ *
+ * @v tcp		TCP connection
+ *
+ * Transmit new data if possible, otherwise retransmit the final
+ * segment in flight, as per RFC 8985.
+ */
+static void tcp_xmit_tlp ( struct tcp_connection *tcp ) {
+	unsigned int flags;
+	uint32_t seq;
+	size_t len;
+
+	/* Mark probe as sent */
+	tcp->flags &= ~TCP_TLP_ARMED;
+	tcp->flags |= TCP_TLP_SENT;
+	tcp->probes++;
+
+	/* Transmit new data, if possible */
+	if ( tcp_xmit_segment ( tcp, tcp->rcv_ack ) ) {
+		DBGC ( tcp, "TCP %p sent new data as probe\n", tcp );
+		return;
+	}
+
+	/* Otherwise, retransmit final segment */
+	len = tcp->snd_sent;
+	if ( len > tcp->cong.mss )
+		len = tcp->cong.mss;
+	seq = ( tcp->snd_seq + tcp->snd_sent - len );
+	len = tcp_process_tx_queue ( tcp, ( seq - tcp->snd_seq ), len,
+				     NULL, 0 );
+	DBGC ( tcp, "TCP %p probing with %08x..%08x\n",
+	       tcp, seq, ( seq + ( uint32_t ) len ) );
+	tcp_start_timer ( tcp );
+	if ( len ) {
+		flags = ( TCP_FLAGS_SENDING ( tcp->tcp_state ) &
+			  ~( TCP_SYN | TCP_FIN ) );
+		tcp_xmit_packet ( tcp, flags, seq, len, tcp->rcv_ack );
+	}
+}
+
 /** TCP process descriptor */
 static struct process_descriptor tcp_process_desc =
 	PROC_DESC_ONCE ( struct tcp_connection, process, tcp_xmit );
@@ -796,7 +1729,10 @@ static void tcp_expired ( struct retry_timer *timer, int over ) {
 		 ( tcp->tcp_state == TCP_CLOSE_WAIT ) ||
 		 ( tcp->tcp_state == TCP_CLOSING_OR_LAST_ACK ) );
 
-	if ( over ) {
+	if ( tcp->flags & TCP_TLP_ARMED ) {
+		/* Send a tail loss probe rather than timing out */
+		tcp_xmit_tlp ( tcp );
+	} else if ( over ) {
 		/* If we have finally timed out and given up,
 		 * terminate the connection
 		 */
@@ -804,7 +1740,31 @@ static void tcp_expired ( struct retry_timer *timer, int over ) {
 		tcp_dump_state ( tcp );
 		tcp_close ( tcp, -ETIMEDOUT );
 	} else {
-		/* Otherwise, retransmit the packet */
+		/* Otherwise, back off the retransmission timeout and
+		 * retransmit starting from the first unacknowledged
+		 * sequence number (unless this is simply the initial
+		 * timer used to trigger sending the SYN).
+		 */
+		if ( tcp->snd_sent ) {
+			if ( ( tcp->tcp_state == TCP_SYN_SENT ) &&
+			     ( tcp->snd_sent > 1 ) ) {
+				/* Data sent along with the SYN may be
+				 * blocked by the network: stop using
+				 * Fast Open for this peer, as per RFC
+				 * 7413.
+				 */
+				tcp_fastopen_forget ( tcp );
+			}
+			tcp->cc->timeout ( &tcp->cong, tcp->snd_sent );
+			tcp->snd_recover = ( tcp->snd_seq + tcp->snd_max );
+			tcp->snd_sent = 0;
+			tcp->snd_sack_count = 0;
+			tcp->dupacks = 0;
+			tcp->rto_backoff++;
+			tcp->retransmits++;
+			tcp->timeouts++;
+			tcp->flags &= ~( TCP_RTT_TIMING | TCP_RECOVERY );
+		}
 		tcp_xmit ( tcp );
 	}
 }
@@ -835,6 +1795,22 @@ static void tcp_keepalive_expired ( struct retry_timer *timer,
 	tcp_xmit ( tcp );
 }
 
+/**
+ * Delayed acknowledgement timer expired
+ *
+ * @v timer		Delayed acknowledgement timer
+ * @v over		Failure indicator
+ */
+static void tcp_delack_expired ( struct retry_timer *timer,
+				 int over __unused ) {
+	struct tcp_connection *tcp =
+		container_of ( timer, struct tcp_connection, delack );
+
+	/* Send acknowledgement */
+	tcp->flags |= TCP_ACK_PENDING;
+	tcp_xmit ( tcp );
+}
+
 /**
  * Shutdown timer expired
  *
@@ -857,82 +1833,235 @@ static void tcp_wait_expired ( struct retry_timer *timer, int over __unused ) {
 }
 
 /**
- * Send RST response to incoming packet
+ * Send RST response to incoming packet
+ *
+ * @v in_tcphdr		TCP header of incoming packet
+ * @ret rc		Return status code
+ */
+static int tcp_xmit_reset ( struct tcp_connection *tcp,
+			    struct sockaddr_tcpip *st_dest,
+			    struct tcp_header *in_tcphdr ) {
+	struct io_buffer *iobuf;
+	struct tcp_header *tcphdr;
+	int rc;
+
+	/* Allocate space for dataless TX buffer */
+	iobuf = alloc_iob ( TCP_MAX_HEADER_LEN );
+	if ( ! iobuf ) {
+		DBGC ( tcp, "TCP %p could not allocate iobuf for RST "
+		       "%08x..%08x %08x\n", tcp, ntohl ( in_tcphdr->ack ),
+		       ntohl ( in_tcphdr->ack ), ntohl ( in_tcphdr->seq ) );
+		return -ENOMEM;
+	}
+	iob_reserve ( iobuf, TCP_MAX_HEADER_LEN );
+
+	/* Construct RST response */
+	tcphdr = iob_push ( iobuf, sizeof ( *tcphdr ) );
+	memset ( tcphdr, 0, sizeof ( *tcphdr ) );
+	tcphdr->src = in_tcphdr->dest;
+	tcphdr->dest = in_tcphdr->src;
+	tcphdr->seq = in_tcphdr->ack;
+	tcphdr->ack = in_tcphdr->seq;
+	tcphdr->hlen = ( ( sizeof ( *tcphdr ) / 4 ) << 4 );
+	tcphdr->flags = ( TCP_RST | TCP_ACK );
+	tcphdr->win = htons ( 0 );
+	tcphdr->csum = tcpip_chksum ( iobuf->data, iob_len ( iobuf ) );
+
+	/* Dump header */
+	DBGC2 ( tcp, "TCP %p TX %d->%d %08x..%08x           %08x %4d",
+		tcp, ntohs ( tcphdr->src ), ntohs ( tcphdr->dest ),
+		ntohl ( tcphdr->seq ), ( ntohl ( tcphdr->seq ) ),
+		ntohl ( tcphdr->ack ), 0 );
+	tcp_dump_flags ( tcp, tcphdr->flags );
+	DBGC2 ( tcp, "\n" );
+
+	/* Transmit packet */
+	if ( ( rc = tcpip_tx ( iobuf, &tcp_protocol, NULL, st_dest,
+			       NULL, &tcphdr->csum ) ) != 0 ) {
+		DBGC ( tcp, "TCP %p could not transmit RST %08x..%08x %08x: "
+		       "%s\n", tcp, ntohl ( in_tcphdr->ack ),
+		       ntohl ( in_tcphdr->ack ), ntohl ( in_tcphdr->seq ),
+		       strerror ( rc ) );
+		return rc;
+	}
+
+	return 0;
+}
+
+/***************************************************************************
+ *
+ * Receive data path
+ *
+ ***************************************************************************
+ */
+
+/**
+ * Check if TCP connection matches local port number and peer
+ *
+ * @v tcp		TCP connection
+ * @v local_port	Local port
+ * @v peer		Remote socket address, or NULL to match any peer
+ * @ret match		Connection matches
+ *
+ * Passively opened connections share the listener's local port, and
+ * so must also be identified by the remote socket address.
+ */
+static int tcp_demux_match ( struct tcp_connection *tcp,
+			     unsigned int local_port,
+			     struct sockaddr_tcpip *peer ) {
+
+	if ( tcp->local_port != local_port )
+		return 0;
+	if ( peer && ( tcp->flags & TCP_PASSIVE ) &&
+	     ( memcmp ( &tcp->peer, peer, sizeof ( tcp->peer ) ) != 0 ) )
+		return 0;
+	return 1;
+}
+
+/**
+ * Identify TCP connection by local port number
+ *
+ * @v local_port	Local port
+ * @v peer		Remote socket address, or NULL to match any peer
+ * @ret tcp		TCP connection, or NULL
+ */
+static struct tcp_connection * tcp_demux ( unsigned int local_port,
+					   struct sockaddr_tcpip *peer ) {
+	struct tcp_connection *tcp;
+
+	/* Check most recent connection first */
+	tcp = tcp_demux_last;
+	if ( tcp && tcp_demux_match ( tcp, local_port, peer ) )
+		return tcp;
+
+	/* Search hash bucket */
+	list_for_each_entry ( tcp, tcp_bucket ( local_port ), hash ) {
+		if ( tcp_demux_match ( tcp, local_port, peer ) ) {
+			tcp_demux_last = tcp;
+			return tcp;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Accept incoming TCP connection
+ *
+ * @v local_port	Local port
+ * @v peer		Remote socket address
+ * @ret tcp		TCP connection, or NULL
+ *
+ * The new connection is created in the same state as an actively
+ * opened connection that has not yet sent its SYN.  Processing the
+ * received SYN will then move it to SYN_RCVD and cause a SYN,ACK to
+ * be transmitted.
+ */
+static struct tcp_connection * tcp_accept ( unsigned int local_port,
+					    struct sockaddr_tcpip *peer ) {
+	struct tcp_listener *listener;
+	struct tcp_connection *tcp;
+	size_t mtu;
+	int rc;
+
+	/* Find listener */
+	list_for_each_entry ( listener, &tcp_listeners, list ) {
+		if ( listener->port == local_port )
+			goto found;
+	}
+	return NULL;
+ found:
+
+	/* Allocate and initialise structure */
+	tcp = zalloc ( sizeof ( *tcp ) );
+	if ( ! tcp )
+		return NULL;
+	DBGC ( tcp, "TCP %p allocated for %s:%d on port %d\n",
+	       tcp, sock_ntoa ( ( struct sockaddr * ) peer ),
+	       ntohs ( peer->st_port ), local_port );
+	ref_init ( &tcp->refcnt, NULL );
+	intf_init ( &tcp->xfer, &tcp_xfer_desc, &tcp->refcnt );
+	process_init_stopped ( &tcp->process, &tcp_process_desc, &tcp->refcnt );
+	timer_init ( &tcp->timer, tcp_expired, &tcp->refcnt );
+	timer_init ( &tcp->keepalive, tcp_keepalive_expired, &tcp->refcnt );
+	timer_init ( &tcp->delack, tcp_delack_expired, &tcp->refcnt );
+	timer_init ( &tcp->wait, tcp_wait_expired, &tcp->refcnt );
+	tcp->flags = TCP_PASSIVE;
+	tcp->prev_tcp_state = TCP_CLOSED;
+	tcp->tcp_state = TCP_STATE_SENT ( TCP_SYN );
+	tcp_dump_state ( tcp );
+	tcp->snd_seq = random();
+	tcp->snd_recover = tcp->snd_seq;
+	tcp->rcv_win_max = TCP_MAX_WINDOW_SIZE;
+	tcp->rto = TCP_INITIAL_RTO;
+	INIT_LIST_HEAD ( &tcp->tx_queue );
+	INIT_LIST_HEAD ( &tcp->rx_queue );
+	memcpy ( &tcp->peer, peer, sizeof ( tcp->peer ) );
+	tcp->local_port = local_port;
+
+	/* Calculate MSS */
+	mtu = tcpip_mtu ( &tcp->peer );
+	if ( ! mtu ) {
+		DBGC ( tcp, "TCP %p has no route to peer\n", tcp );
+		goto err;
+	}
+	tcp->mss = ( mtu - sizeof ( struct tcp_header ) );
+
+	/* Initialise congestion control */
+	tcp_congestion_init ( tcp );
+
+	/* Hand over to listener */
+	if ( ( rc = listener->accept ( listener, &tcp->xfer, peer ) ) != 0 ) {
+		DBGC ( tcp, "TCP %p not accepted: %s\n", tcp, strerror ( rc ) );
+		goto err;
+	}
+
+	/* Add a pending operation for the SYN */
+	pending_get ( &tcp->pending_flags );
+
+	/* Transfer reference to connection list and return */
+	list_add ( &tcp->list, &tcp_conns );
+	list_add ( &tcp->hash, tcp_bucket ( tcp->local_port ) );
+	return tcp;
+
+ err:
+	intf_shutdown ( &tcp->xfer, -ECONNREFUSED );
+	ref_put ( &tcp->refcnt );
+	return NULL;
+}
+
+/**
+ * Start listening for incoming TCP connections
  *
- * @v in_tcphdr		TCP header of incoming packet
+ * @v listener		TCP listener
  * @ret rc		Return status code
  */
-static int tcp_xmit_reset ( struct tcp_connection *tcp,
-			    struct sockaddr_tcpip *st_dest,
-			    struct tcp_header *in_tcphdr ) {
-	struct io_buffer *iobuf;
-	struct tcp_header *tcphdr;
+int tcp_listen ( struct tcp_listener *listener ) {
 	int rc;
 
-	/* Allocate space for dataless TX buffer */
-	iobuf = alloc_iob ( TCP_MAX_HEADER_LEN );
-	if ( ! iobuf ) {
-		DBGC ( tcp, "TCP %p could not allocate iobuf for RST "
-		       "%08x..%08x %08x\n", tcp, ntohl ( in_tcphdr->ack ),
-		       ntohl ( in_tcphdr->ack ), ntohl ( in_tcphdr->seq ) );
-		return -ENOMEM;
-	}
-	iob_reserve ( iobuf, TCP_MAX_HEADER_LEN );
-
-	/* Construct RST response */
-	tcphdr = iob_push ( iobuf, sizeof ( *tcphdr ) );
-	memset ( tcphdr, 0, sizeof ( *tcphdr ) );
-	tcphdr->src = in_tcphdr->dest;
-	tcphdr->dest = in_tcphdr->src;
-	tcphdr->seq = in_tcphdr->ack;
-	tcphdr->ack = in_tcphdr->seq;
-	tcphdr->hlen = ( ( sizeof ( *tcphdr ) / 4 ) << 4 );
-	tcphdr->flags = ( TCP_RST | TCP_ACK );
-	tcphdr->win = htons ( 0 );
-	tcphdr->csum = tcpip_chksum ( iobuf->data, iob_len ( iobuf ) );
-
-	/* Dump header */
-	DBGC2 ( tcp, "TCP %p TX %d->%d %08x..%08x           %08x %4d",
-		tcp, ntohs ( tcphdr->src ), ntohs ( tcphdr->dest ),
-		ntohl ( tcphdr->seq ), ( ntohl ( tcphdr->seq ) ),
-		ntohl ( tcphdr->ack ), 0 );
-	tcp_dump_flags ( tcp, tcphdr->flags );
-	DBGC2 ( tcp, "\n" );
-
-	/* Transmit packet */
-	if ( ( rc = tcpip_tx ( iobuf, &tcp_protocol, NULL, st_dest,
-			       NULL, &tcphdr->csum ) ) != 0 ) {
-		DBGC ( tcp, "TCP %p could not transmit RST %08x..%08x %08x: "
-		       "%s\n", tcp, ntohl ( in_tcphdr->ack ),
-		       ntohl ( in_tcphdr->ack ), ntohl ( in_tcphdr->seq ),
-		       strerror ( rc ) );
+	/* Check that port is available */
+	if ( ( rc = tcp_port_available ( listener->port ) ) < 0 )
 		return rc;
-	}
+
+	/* Add to list of listeners */
+	list_add ( &listener->list, &tcp_listeners );
+	DBGC ( listener, "TCP %p listening on port %d\n",
+	       listener, listener->port );
 
 	return 0;
 }
 
-/***************************************************************************
- *
- * Receive data path
- *
- ***************************************************************************
- */
-
 /**
- * Identify TCP connection by local port number
+ * Stop listening for incoming TCP connections
  *
- * @v local_port	Local port
- * @ret tcp		TCP connection, or NULL
+ * @v listener		TCP listener
+ *
+ * Existing connections accepted via this listener are unaffected.
  */
-static struct tcp_connection * tcp_demux ( unsigned int local_port ) {
-	struct tcp_connection *tcp;
+void tcp_unlisten ( struct tcp_listener *listener ) {
 
-	list_for_each_entry ( tcp, &tcp_conns, list ) {
-		if ( tcp->local_port == local_port )
-			return tcp;
-	}
-	return NULL;
+	list_del ( &listener->list );
+	DBGC ( listener, "TCP %p stopped listening on port %d\n",
+	       listener, listener->port );
 }
 
 /**
@@ -977,7 +2106,8 @@ static int tcp_rx_opts ( struct tcp_connection *tcp,
 		min = sizeof ( *option );
 		switch ( kind ) {
 		case TCP_OPTION_MSS:
-			/* Ignore received MSS */
+			options->mssopt = data;
+			min = sizeof ( *options->mssopt );
 			break;
 		case TCP_OPTION_WS:
 			options->wsopt = data;
@@ -988,12 +2118,17 @@ static int tcp_rx_opts ( struct tcp_connection *tcp,
 			min = sizeof ( *options->spopt );
 			break;
 		case TCP_OPTION_SACK:
-			/* Ignore received SACKs */
+			options->sackopt = data;
+			min = sizeof ( *options->sackopt );
 			break;
 		case TCP_OPTION_TS:
 			options->tsopt = data;
 			min = sizeof ( *options->tsopt );
 			break;
+		case TCP_OPTION_FASTOPEN:
+			options->tfoopt = data;
+			min = sizeof ( *options->tfoopt );
+			break;
 		default:
 			DBGC ( tcp, "TCP %p received unknown option %d\n",
 			       tcp, kind );
@@ -1054,9 +2189,6 @@ static void tcp_rx_seq ( struct tcp_connection *tcp, uint32_t seq_len ) {
 		if ( tcp_cmp ( tcp->sack[sack].right, tcp->rcv_ack ) < 0 )
 			tcp->sack[sack].right = tcp->rcv_ack;
 	}
-
-	/* Mark ACK as pending */
-	tcp->flags |= TCP_ACK_PENDING;
 }
 
 /**
@@ -1073,6 +2205,7 @@ static int tcp_rx_syn ( struct tcp_connection *tcp, uint32_t seq,
 	/* Synchronise sequence numbers on first SYN */
 	if ( ! ( tcp->tcp_state & TCP_STATE_RCVD ( TCP_SYN ) ) ) {
 		tcp->rcv_ack = seq;
+		tcp->rcv_tune_start = currticks();
 		if ( options->tsopt )
 			tcp->flags |= TCP_TS_ENABLED;
 		if ( options->spopt )
@@ -1081,12 +2214,24 @@ static int tcp_rx_syn ( struct tcp_connection *tcp, uint32_t seq,
 			tcp->snd_win_scale = options->wsopt->scale;
 			tcp->rcv_win_scale = TCP_RX_WINDOW_SCALE;
 		}
+		tcp->peer_mss = ( options->mssopt ?
+				  ntohs ( options->mssopt->mss ) :
+				  TCP_DEFAULT_MSS );
+		if ( ! ( tcp->flags & TCP_PASSIVE ) )
+			tcp_fastopen_update ( tcp, options );
 		DBGC ( tcp, "TCP %p using %stimestamps, %sSACK, TX window "
-		       "x%d, RX window x%d\n", tcp,
+		       "x%d, RX window x%d, peer MSS %zd\n", tcp,
 		       ( ( tcp->flags & TCP_TS_ENABLED ) ? "" : "no " ),
 		       ( ( tcp->flags & TCP_SACK_ENABLED ) ? "" : "no " ),
 		       ( 1 << tcp->snd_win_scale ),
-		       ( 1 << tcp->rcv_win_scale ) );
+		       ( 1 << tcp->rcv_win_scale ), tcp->peer_mss );
+
+		/* Calculate sender maximum segment size, and restart
+		 * congestion control using this segment size (since
+		 * no data can yet have been sent).
+		 */
+		tcp_pmtu ( tcp );
+		tcp->cc->init ( &tcp->cong );
 	}
 
 	/* Ignore duplicate SYN */
@@ -1095,6 +2240,7 @@ static int tcp_rx_syn ( struct tcp_connection *tcp, uint32_t seq,
 
 	/* Acknowledge SYN */
 	tcp_rx_seq ( tcp, 1 );
+	tcp->flags |= TCP_ACK_PENDING;
 
 	/* Mark SYN as received and start sending ACKs with each packet */
 	tcp->tcp_state |= ( TCP_STATE_SENT ( TCP_ACK ) |
@@ -1103,6 +2249,206 @@ static int tcp_rx_syn ( struct tcp_connection *tcp, uint32_t seq,
 	return 0;
 }
 
+/**
+ * Add block to peer selective acknowledgement scoreboard
+ *
+ * @v tcp		TCP connection
+ * @v left		Left edge of block (in host-endian order)
+ * @v right		Right edge of block (in host-endian order)
+ */
+static void tcp_sack_add ( struct tcp_connection *tcp, uint32_t left,
+			   uint32_t right ) {
+	struct tcp_sack_block *block;
+	unsigned int i;
+
+	/* Merge with any overlapping or adjacent blocks */
+	for ( i = 0 ; i < tcp->snd_sack_count ; ) {
+		block = &tcp->snd_sack[i];
+		if ( ( tcp_cmp ( right, block->left ) < 0 ) ||
+		     ( tcp_cmp ( left, block->right ) > 0 ) ) {
+			i++;
+			continue;
+		}
+		if ( tcp_cmp ( block->left, left ) < 0 )
+			left = block->left;
+		if ( tcp_cmp ( block->right, right ) > 0 )
+			right = block->right;
+		tcp->snd_sack_count--;
+		memmove ( block, ( block + 1 ),
+			  ( ( tcp->snd_sack_count - i ) * sizeof ( *block ) ) );
+	}
+
+	/* Find insertion point */
+	for ( i = 0 ; i < tcp->snd_sack_count ; i++ ) {
+		if ( tcp_cmp ( left, tcp->snd_sack[i].left ) < 0 )
+			break;
+	}
+
+	/* Discard highest block if scoreboard is full.  This is
+	 * safe, since it can cause only unnecessary retransmission.
+	 */
+	if ( tcp->snd_sack_count == TCP_SND_SACK_MAX ) {
+		if ( i == TCP_SND_SACK_MAX )
+			return;
+		tcp->snd_sack_count--;
+	}
+
+	/* Insert block */
+	block = &tcp->snd_sack[i];
+	memmove ( ( block + 1 ), block,
+		  ( ( tcp->snd_sack_count - i ) * sizeof ( *block ) ) );
+	block->left = left;
+	block->right = right;
+	tcp->snd_sack_count++;
+}
+
+/**
+ * Remove acknowledged data from peer selective acknowledgement scoreboard
+ *
+ * @v tcp		TCP connection
+ */
+static void tcp_sack_trim ( struct tcp_connection *tcp ) {
+	struct tcp_sack_block *block;
+
+	while ( tcp->snd_sack_count ) {
+		block = &tcp->snd_sack[0];
+		if ( tcp_cmp ( block->right, tcp->snd_seq ) > 0 ) {
+			if ( tcp_cmp ( block->left, tcp->snd_seq ) < 0 )
+				block->left = tcp->snd_seq;
+			break;
+		}
+		tcp->snd_sack_count--;
+		memmove ( block, ( block + 1 ),
+			  ( tcp->snd_sack_count * sizeof ( *block ) ) );
+	}
+}
+
+/**
+ * Handle TCP received selective acknowledgements
+ *
+ * @v tcp		TCP connection
+ * @v options		TCP options
+ * @ret new		New data was selectively acknowledged
+ */
+static int tcp_rx_sack ( struct tcp_connection *tcp,
+			 struct tcp_options *options ) {
+	const struct tcp_sack_block *sack;
+	uint32_t old_sacked;
+	uint32_t left;
+	uint32_t right;
+	unsigned int count;
+
+	/* Do nothing unless SACK is enabled and present */
+	if ( ! ( ( tcp->flags & TCP_SACK_ENABLED ) && options->sackopt ) )
+		return 0;
+
+	/* Add each block lying within the data in flight to the
+	 * scoreboard.  This excludes D-SACK blocks (RFC 2883), which
+	 * report data that has already been acknowledged.
+	 */
+	old_sacked = tcp_sacked ( tcp );
+	sack = ( ( ( void * ) options->sackopt ) +
+		 sizeof ( *options->sackopt ) );
+	count = ( ( options->sackopt->length - sizeof ( *options->sackopt ) )
+		  / sizeof ( *sack ) );
+	for ( ; count-- ; sack++ ) {
+		left = ntohl ( sack->left );
+		right = ntohl ( sack->right );
+		if ( ( tcp_cmp ( right, left ) <= 0 ) ||
+		     ( tcp_cmp ( left, tcp->snd_seq ) <= 0 ) ||
+		     ( tcp_cmp ( right, ( tcp->snd_seq + tcp->snd_sent ) ) > 0 ))
+			continue;
+		tcp_sack_add ( tcp, left, right );
+	}
+
+	return ( tcp_sacked ( tcp ) > old_sacked );
+}
+
+/**
+ * Handle TCP received duplicate ACK
+ *
+ * @v tcp		TCP connection
+ */
+static void tcp_rx_dupack ( struct tcp_connection *tcp ) {
+
+	/* Count duplicate ACK */
+	tcp->dupacks++;
+
+	/* If we are already in fast recovery, retransmit the next
+	 * lost segment (if any).
+	 */
+	if ( tcp->flags & TCP_RECOVERY ) {
+		tcp_xmit_rtx ( tcp );
+		return;
+	}
+
+	/* Do nothing until we have evidence of a lost segment.  Any
+	 * data selectively acknowledged in response to a tail loss
+	 * probe is sufficient evidence, since the probe is sent long
+	 * after any reordered segment would have been expected to
+	 * arrive.
+	 */
+	if ( ( tcp->dupacks < TCP_DUPACK_THRESHOLD ) &&
+	     ( tcp_sacked ( tcp ) < ( TCP_DUPACK_THRESHOLD * tcp->cong.mss ) ) &&
+	     ! ( ( tcp->flags & TCP_TLP_SENT ) && tcp_sacked ( tcp ) ) )
+		return;
+
+	/* Avoid entering fast recovery on duplicate ACKs provoked by
+	 * retransmissions following a timeout, as per RFC 6582.
+	 */
+	if ( tcp_cmp ( tcp->snd_seq, tcp->snd_recover ) < 0 )
+		return;
+
+	/* Enter fast recovery */
+	DBGC ( tcp, "TCP %p entering fast recovery at %08x (recover %08x)\n",
+	       tcp, tcp->snd_seq, ( tcp->snd_seq + tcp->snd_max ) );
+	tcp->flags |= TCP_RECOVERY;
+	tcp->flags &= ~TCP_RTT_TIMING;
+	tcp->snd_recover = ( tcp->snd_seq + tcp->snd_max );
+	tcp->snd_rtx = tcp->snd_seq;
+	tcp->cc->recovery ( &tcp->cong, tcp->snd_sent );
+
+	/* Retransmit first lost segment */
+	tcp_xmit_rtx ( tcp );
+}
+
+/**
+ * Update round-trip time estimate
+ *
+ * @v tcp		TCP connection
+ * @v rtt		Measured round-trip time (in ticks)
+ */
+static void tcp_rtt ( struct tcp_connection *tcp, unsigned long rtt ) {
+	unsigned long scaled = ( rtt << TCP_RTT_SCALE );
+	unsigned long delta;
+	unsigned long var;
+	unsigned long rto;
+
+	/* Update smoothed round-trip time and round-trip time
+	 * variation, as per RFC 6298.
+	 */
+	if ( tcp->srtt ) {
+		delta = ( ( scaled > tcp->srtt ) ? ( scaled - tcp->srtt ) :
+			  ( tcp->srtt - scaled ) );
+		tcp->rttvar += ( ( delta >> 2 ) - ( tcp->rttvar >> 2 ) );
+		tcp->srtt += ( rtt - ( tcp->srtt >> TCP_RTT_SCALE ) );
+	} else {
+		tcp->srtt = scaled;
+		tcp->rttvar = ( scaled >> 1 );
+	}
+
+	/* Calculate retransmission timeout, using the tick length as
+	 * the clock granularity.
+	 */
+	var = ( ( 4 * tcp->rttvar ) >> TCP_RTT_SCALE );
+	if ( var < 1 )
+		var = 1;
+	rto = ( ( tcp->srtt >> TCP_RTT_SCALE ) + var );
+	if ( rto < TCP_MIN_RTO )
+		rto = TCP_MIN_RTO;
+	tcp->rto = rto;
+}
+
 /**
  * Handle TCP received ACK
  *
@@ -1118,11 +2464,11 @@ static int tcp_rx_ack ( struct tcp_connection *tcp, uint32_t ack,
 	unsigned int acked_flags;
 
 	/* Check for out-of-range or old duplicate ACKs */
-	if ( ack_len > tcp->snd_sent ) {
+	if ( ack_len > tcp->snd_max ) {
 		DBGC ( tcp, "TCP %p received ACK for %08x..%08x, "
 		       "sent only %08x..%08x\n", tcp, tcp->snd_seq,
 		       ( tcp->snd_seq + ack_len ), tcp->snd_seq,
-		       ( tcp->snd_seq + tcp->snd_sent ) );
+		       ( tcp->snd_seq + tcp->snd_max ) );
 
 		if ( TCP_HAS_BEEN_ESTABLISHED ( tcp->tcp_state ) ) {
 			/* Just ignore what might be old duplicate ACKs */
@@ -1137,6 +2483,8 @@ static int tcp_rx_ack ( struct tcp_connection *tcp, uint32_t ack,
 	}
 
 	/* Update window size */
+	if ( tcp->snd_win && ! win )
+		tcp->snd_zero_win++;
 	tcp->snd_win = win;
 
 	/* Hold off (or start) the keepalive timer, if applicable */
@@ -1152,8 +2500,18 @@ static int tcp_rx_ack ( struct tcp_connection *tcp, uint32_t ack,
 	if ( ack_len == 0 )
 		return 0;
 
-	/* Stop the retransmission timer */
-	stop_timer ( &tcp->timer );
+	/* Complete any round-trip time measurement */
+	if ( ( tcp->flags & TCP_RTT_TIMING ) &&
+	     ( tcp_cmp ( ack, tcp->rtt_seq ) >= 0 ) ) {
+		tcp->flags &= ~TCP_RTT_TIMING;
+		tcp_rtt ( tcp, ( currticks() - tcp->rtt_start ) );
+	}
+
+	/* Reset retransmission timeout backoff, and allow a tail loss
+	 * probe for the new flight.
+	 */
+	tcp->rto_backoff = 0;
+	tcp->flags &= ~TCP_TLP_SENT;
 
 	/* Determine acknowledged flags and data length */
 	len = ack_len;
@@ -1163,14 +2521,62 @@ static int tcp_rx_ack ( struct tcp_connection *tcp, uint32_t ack,
 		len--;
 		pending_put ( &tcp->pending_flags );
 	}
+	tcp->out_octets += len;
 
 	/* Update SEQ and sent counters */
 	tcp->snd_seq = ack;
-	tcp->snd_sent = 0;
+	tcp->snd_max -= ack_len;
+	tcp->snd_sent = ( ( tcp->snd_sent > ack_len ) ?
+			  ( tcp->snd_sent - ack_len ) : 0 );
+
+	/* Retransmit immediately any data sent along with our SYN
+	 * that the peer did not accept, as per RFC 7413.
+	 */
+	if ( ( acked_flags & TCP_SYN ) && tcp->snd_sent ) {
+		DBGC ( tcp, "TCP %p Fast Open data not accepted\n", tcp );
+		tcp->snd_sent = 0;
+		tcp->flags &= ~TCP_RTT_TIMING;
+	}
+
+	/* Remove acknowledged data from scoreboard, and reset the
+	 * duplicate ACK count.
+	 */
+	tcp_sack_trim ( tcp );
+	tcp->dupacks = 0;
+
+	/* Restart the retransmission timer if data remains in
+	 * flight, otherwise stop it.
+	 */
+	if ( tcp->snd_sent ) {
+		tcp_start_timer ( tcp );
+	} else {
+		stop_timer ( &tcp->timer );
+	}
 
 	/* Remove any acknowledged data from transmit queue */
-	tcp_process_tx_queue ( tcp, len, NULL, 1 );
-		
+	tcp_process_tx_queue ( tcp, 0, len, NULL, 1 );
+
+	/* Handle fast recovery or open congestion window, as
+	 * applicable.  A partial acknowledgement during fast recovery
+	 * indicates that a further segment has been lost.
+	 */
+	if ( tcp->flags & TCP_RECOVERY ) {
+		if ( tcp_cmp ( ack, tcp->snd_recover ) >= 0 ) {
+			DBGC ( tcp, "TCP %p exiting fast recovery at %08x\n",
+			       tcp, ack );
+			tcp->flags &= ~TCP_RECOVERY;
+			tcp->cc->recovered ( &tcp->cong );
+		} else {
+			if ( ! ( tcp->flags & TCP_SACK_ENABLED ) )
+				tcp->snd_rtx = ack;
+			tcp_xmit_rtx ( tcp );
+		}
+	} else if ( len ) {
+		tcp->cc->acked ( &tcp->cong, len );
+		if ( tcp->cong.cwnd > TCP_MAX_SEND_WINDOW_SIZE )
+			tcp->cong.cwnd = TCP_MAX_SEND_WINDOW_SIZE;
+	}
+
 	/* Mark SYN/FIN as acknowledged if applicable. */
 	if ( acked_flags )
 		tcp->tcp_state |= TCP_STATE_ACKED ( acked_flags );
@@ -1186,6 +2592,87 @@ static int tcp_rx_ack ( struct tcp_connection *tcp, uint32_t ack,
 	return 0;
 }
 
+/**
+ * Update round-trip time estimate using timestamps
+ *
+ * @v tcp		TCP connection
+ * @v options		TCP options
+ */
+static void tcp_rx_rtt ( struct tcp_connection *tcp,
+			 struct tcp_options *options ) {
+	uint32_t tsecr;
+	uint32_t rtt;
+
+	/* Measure round-trip time using the echoed timestamp, if
+	 * available.  Our timestamp values are simply the current
+	 * tick count, so a zero echoed value almost certainly
+	 * indicates that the peer has not yet seen any of our
+	 * timestamps.  Use each echoed timestamp only once, to avoid
+	 * including idle time (e.g. a server's response time) in the
+	 * measurement.
+	 */
+	if ( ! ( ( tcp->flags & TCP_TS_ENABLED ) && options->tsopt ) )
+		return;
+	tsecr = ntohl ( options->tsopt->tsecr );
+	if ( ( ! tsecr ) || ( tsecr == tcp->ts_echoed ) )
+		return;
+	tcp->ts_echoed = tsecr;
+	rtt = ( currticks() - tsecr );
+	if ( rtt > TCP_MSL )
+		return;
+
+	/* Update round-trip time estimate */
+	tcp_rtt ( tcp, rtt );
+}
+
+/**
+ * Auto-tune receive window
+ *
+ * @v tcp		TCP connection
+ * @v len		Length of newly received data
+ *
+ * The receive window required to sustain the current throughput is
+ * the amount of data received within a single round-trip time.  We
+ * measure the amount of data received during each round-trip time
+ * interval, and allow the window to grow to twice this amount (so
+ * that the sender is never limited by our advertised window).
+ */
+static void tcp_rx_autotune ( struct tcp_connection *tcp, size_t len ) {
+	unsigned long now = currticks();
+	unsigned long elapsed = ( now - tcp->rcv_tune_start );
+	size_t limit;
+	size_t win;
+
+	/* Accumulate data until a full round-trip time has elapsed */
+	tcp->rcv_tune_len += len;
+	if ( elapsed <= ( tcp->srtt >> TCP_RTT_SCALE ) )
+		return;
+
+	/* Calculate required window.  Any data queued out of order
+	 * within the window will consume heap space, so do not allow
+	 * the window to grow beyond half of the available memory
+	 * (but never reduce it below the default maximum window).
+	 */
+	win = ( 2 * tcp->rcv_tune_len );
+	limit = ( freemem / 2 );
+	if ( limit > TCP_MAX_AUTOTUNE_WINDOW_SIZE )
+		limit = TCP_MAX_AUTOTUNE_WINDOW_SIZE;
+	if ( win > limit )
+		win = limit;
+
+	/* Grow maximum window, if applicable */
+	if ( win > tcp->rcv_win_max ) {
+		DBGC ( tcp, "TCP %p RX window %dkB->%zdkB (RTT %ld/%d ticks)\n",
+		       tcp, ( tcp->rcv_win_max / 1024 ), ( win / 1024 ),
+		       tcp->srtt, ( 1 << TCP_RTT_SCALE ) );
+		tcp->rcv_win_max = win;
+	}
+
+	/* Start new measurement interval */
+	tcp->rcv_tune_start = now;
+	tcp->rcv_tune_len = 0;
+}
+
 /**
  * Handle TCP received data
  *
@@ -1212,8 +2699,15 @@ static int tcp_rx_data ( struct tcp_connection *tcp, uint32_t seq,
 	iob_pull ( iobuf, already_rcvd );
 	len -= already_rcvd;
 
-	/* Acknowledge new data */
+	/* Acknowledge new data, allowing the acknowledgement to be
+	 * delayed.
+	 */
 	tcp_rx_seq ( tcp, len );
+	tcp->rcv_delayed++;
+	tcp->in_octets += len;
+
+	/* Auto-tune receive window */
+	tcp_rx_autotune ( tcp, len );
 
 	/* Deliver data to application */
 	profile_start ( &tcp_xfer_profiler );
@@ -1242,6 +2736,7 @@ static int tcp_rx_fin ( struct tcp_connection *tcp, uint32_t seq ) {
 
 	/* Acknowledge FIN */
 	tcp_rx_seq ( tcp, 1 );
+	tcp->flags |= TCP_ACK_PENDING;
 
 	/* Mark FIN as received */
 	tcp->tcp_state |= TCP_STATE_RCVD ( TCP_FIN );
@@ -1397,18 +2892,23 @@ static int tcp_rx ( struct io_buffer *iobuf,
 		    struct sockaddr_tcpip *st_dest __unused,
 		    uint16_t pshdr_csum ) {
 	struct tcp_header *tcphdr = iobuf->data;
+	struct tcp_rx_queued_header *tcpqhdr;
 	struct tcp_connection *tcp;
 	struct tcp_options options;
+	struct io_buffer *queued;
 	size_t hlen;
 	uint16_t csum;
 	uint32_t seq;
 	uint32_t ack;
 	uint16_t raw_win;
 	uint32_t win;
+	uint32_t ooo;
 	unsigned int flags;
 	size_t len;
 	uint32_t seq_len;
 	size_t old_xfer_window;
+	int unacked;
+	int dupack;
 	int rc;
 
 	/* Start profiling */
@@ -1434,17 +2934,23 @@ static int tcp_rx ( struct io_buffer *iobuf,
 		rc = -EINVAL;
 		goto discard;
 	}
-	csum = tcpip_continue_chksum ( pshdr_csum, iobuf->data,
-				       iob_len ( iobuf ) );
-	if ( csum != 0 ) {
-		DBG ( "TCP checksum incorrect (is %04x including checksum "
-		      "field, should be 0000)\n", csum );
-		rc = -EINVAL;
-		goto discard;
+	if ( ! ( iobuf->flags & IOB_CSUM_VERIFIED ) ) {
+		csum = tcpip_continue_chksum ( pshdr_csum, iobuf->data,
+					       iob_len ( iobuf ) );
+		if ( csum != 0 ) {
+			DBG ( "TCP checksum incorrect (is %04x including "
+			      "checksum field, should be 0000)\n", csum );
+			rc = -EINVAL;
+			goto discard;
+		}
 	}
 	
 	/* Parse parameters from header and strip header */
-	tcp = tcp_demux ( ntohs ( tcphdr->dest ) );
+	st_src->st_port = tcphdr->src;
+	tcp = tcp_demux ( ntohs ( tcphdr->dest ), st_src );
+	if ( ( ! tcp ) &&
+	     ( ( tcphdr->flags & ( TCP_SYN | TCP_ACK | TCP_RST ) ) == TCP_SYN ))
+		tcp = tcp_accept ( ntohs ( tcphdr->dest ), st_src );
 	seq = ntohl ( tcphdr->seq );
 	ack = ntohl ( tcphdr->ack );
 	raw_win = ntohs ( tcphdr->win );
@@ -1478,10 +2984,18 @@ static int tcp_rx ( struct io_buffer *iobuf,
 	/* Handle ACK, if present */
 	if ( flags & TCP_ACK ) {
 		win = ( raw_win << tcp->snd_win_scale );
+		unacked = ( ( ack == tcp->snd_seq ) && tcp->snd_sent );
+		dupack = ( unacked && ( seq_len == 0 ) &&
+			   ( win == tcp->snd_win ) );
+		if ( tcp_rx_sack ( tcp, &options ) && unacked )
+			dupack = 1;
 		if ( ( rc = tcp_rx_ack ( tcp, ack, win ) ) != 0 ) {
 			tcp_xmit_reset ( tcp, st_src, tcphdr );
 			goto discard;
 		}
+		tcp_rx_rtt ( tcp, &options );
+		if ( dupack )
+			tcp_rx_dupack ( tcp );
 	}
 
 	/* Force an ACK if this packet is out of order */
@@ -1508,11 +3022,32 @@ static int tcp_rx ( struct io_buffer *iobuf,
 	/* Process receive queue */
 	tcp_process_rx_queue ( tcp );
 
+	/* Record out-of-order queue high water mark */
+	if ( ( queued = list_last_entry ( &tcp->rx_queue, struct io_buffer,
+					  list ) ) ) {
+		tcpqhdr = queued->data;
+		ooo = ( tcpqhdr->nxt - tcp->rcv_ack );
+		if ( ooo > tcp->rcv_ooo_max )
+			tcp->rcv_ooo_max = ooo;
+	}
+
 	/* Dump out any state change as a result of the received packet */
 	tcp_dump_state ( tcp );
 
-	/* Schedule transmission of ACK (and any pending data).  If we
-	 * have received any out-of-order packets (i.e. if the receive
+	/* Acknowledge at least every second segment, otherwise delay
+	 * the acknowledgement in the hope of combining it with that
+	 * for the next segment (or with outgoing data).
+	 */
+	if ( tcp->rcv_delayed >= TCP_DELACK_SEGMENTS ) {
+		tcp->flags |= TCP_ACK_PENDING;
+	} else if ( tcp->rcv_delayed && ! timer_running ( &tcp->delack ) ) {
+		start_timer_fixed ( &tcp->delack, TCP_DELACK_TIMEOUT );
+	}
+
+	/* Schedule transmission of ACK (and any pending data).  ACKs
+	 * for all packets received within a single poll are coalesced
+	 * since the transmission process runs only once.  If we have
+	 * received any out-of-order packets (i.e. if the receive
 	 * queue remains non-empty after processing) then send the ACK
 	 * immediately in order to trigger Fast Retransmission.
 	 */
@@ -1547,6 +3082,7 @@ static int tcp_rx ( struct io_buffer *iobuf,
 struct tcpip_protocol tcp_protocol __tcpip_protocol = {
 	.name = "TCP",
 	.rx = tcp_rx,
+	.pmtud = 1,
 	.tcpip_proto = IP_TCP,
 };
 
@@ -1579,6 +3115,7 @@ static unsigned int tcp_discard ( void ) {
 
 /** TCP cache discarder */
 struct cache_discarder tcp_discarder __cache_discarder ( CACHE_NORMAL ) = {
+	.name = "tcp",
 	.discard = tcp_discard,
 };
 
@@ -1657,6 +3194,77 @@ struct startup_fn tcp_startup_fn __startup_fn ( STARTUP_LATE ) = {
 	.shutdown = tcp_shutdown,
 };
 
+/**
+ * Initialise TCP
+ *
+ */
+static void tcp_init ( void ) {
+	unsigned int i;
+
+	/* Initialise connection hash buckets */
+	for ( i = 0 ; i < TCP_HASH_BUCKETS ; i++ )
+		INIT_LIST_HEAD ( &tcp_hash[i] );
+
+	/* Use first congestion control algorithm */
+	tcp_congestion = table_start ( TCP_CONGESTION_ALGORITHMS );
+}
+
+/** TCP initialisation function */
+struct init_fn tcp_init_fn __init_fn ( INIT_NORMAL ) = {
+	.initialise = tcp_init,
+};
+
+/***************************************************************************
+ *
+ * Statistics
+ *
+ ***************************************************************************
+ */
+
+/**
+ * Get TCP connection statistics
+ *
+ * @v index		Connection index
+ * @v stats		Statistics to fill in
+ * @ret rc		Return status code
+ */
+int tcp_statistics ( unsigned int index, struct tcp_statistics *stats ) {
+	struct tcp_connection *tcp;
+
+	/* Find connection */
+	list_for_each_entry ( tcp, &tcp_conns, list ) {
+		if ( index-- )
+			continue;
+
+		/* Fill in statistics */
+		memset ( stats, 0, sizeof ( *stats ) );
+		memcpy ( &stats->peer, &tcp->peer, sizeof ( stats->peer ) );
+		stats->local_port = tcp->local_port;
+		stats->state = tcp_state ( tcp->tcp_state );
+		stats->rcv_win = tcp->rcv_win;
+		stats->rcv_win_max = tcp->rcv_win_max;
+		stats->rtt = ( ( tcp->srtt * 1000 ) /
+			       ( TICKS_PER_SEC << TCP_RTT_SCALE ) );
+		stats->rto = ( ( tcp->rto * 1000 ) / TICKS_PER_SEC );
+		stats->cwnd = tcp->cong.cwnd;
+		stats->ssthresh = tcp->cong.ssthresh;
+		stats->mss = tcp->cong.mss;
+		stats->congestion = tcp->cc->name;
+		stats->retransmits = tcp->retransmits;
+		stats->timeouts = tcp->timeouts;
+		stats->probes = tcp->probes;
+		stats->in_octets = tcp->in_octets;
+		stats->out_octets = tcp->out_octets;
+		stats->rcv_ooo_max = tcp->rcv_ooo_max;
+		stats->snd_zero_win = tcp->snd_zero_win;
+		stats->rcv_zero_win = tcp->rcv_zero_win;
+		stats->snd_win = tcp->snd_win;
+		return 0;
+	}
+
+	return -ENOENT;
+}
+
 /***************************************************************************
  *
  * Data transfer interface
@@ -1693,6 +3301,7 @@ static int tcp_xfer_deliver ( struct tcp_connection *tcp,
 
 	/* Enqueue packet */
 	list_add_tail ( &iobuf->list, &tcp->tx_queue );
+	tcp->tx_len += iob_len ( iobuf );
 
 	/* Each enqueued packet is a pending operation */
 	pending_get ( &tcp->pending_data );
@@ -1738,6 +3347,66 @@ struct socket_opener tcp_ipv6_socket_opener __socket_opener = {
 /** Linkage hack */
 int tcp_sock_stream = TCP_SOCK_STREAM;
 
+/**
+ * Calculate rate-limited receive window
+ *
+ * @v tcp		TCP connection
+ * @ret win		Maximum receive window
+ *
+ * A sender can deliver at most one window of data per round-trip
+ * time, so limiting the advertised window to the configured rate
+ * multiplied by the round-trip time paces the sender without any
+ * need to drop packets.  The window is never reduced below two
+ * segments, to avoid stalling the connection entirely.
+ */
+static uint32_t tcp_rx_window ( struct tcp_connection *tcp ) {
+	unsigned long rtt;
+	uint64_t win;
+
+	/* Use measured round-trip time, if available */
+	rtt = ( tcp->srtt >> TCP_RTT_SCALE );
+	if ( ! rtt )
+		rtt = TCP_RX_RATE_DEFAULT_RTT;
+
+	/* Calculate window */
+	win = ( ( ( ( uint64_t ) tcp_rx_rate ) * rtt ) / TICKS_PER_SEC );
+	if ( win < ( 2 * tcp->mss ) )
+		win = ( 2 * tcp->mss );
+	if ( win > TCP_MAX_AUTOTUNE_WINDOW_SIZE )
+		win = TCP_MAX_AUTOTUNE_WINDOW_SIZE;
+	return win;
+}
+
+/** TCP maximum receive rate setting */
+const struct setting tcp_rx_rate_setting __setting ( SETTING_MISC,
+						     tcp-rx-rate ) = {
+	.name = "tcp-rx-rate",
+	.description = "TCP maximum receive rate (bytes/sec)",
+	.type = &setting_type_uint32,
+};
+
+/**
+ * Apply TCP settings
+ *
+ * @ret rc		Return status code
+ */
+static int tcp_apply_settings ( void ) {
+
+	/* Fetch maximum receive rate */
+	tcp_rx_rate = fetch_uintz_setting ( NULL, &tcp_rx_rate_setting );
+	if ( tcp_rx_rate ) {
+		DBGC ( &tcp_conns, "TCP limiting receive rate to %ld "
+		       "bytes/sec\n", tcp_rx_rate );
+	}
+
+	return 0;
+}
+
+/** TCP settings applicator */
+struct settings_applicator tcp_settings_applicator __settings_applicator = {
+	.apply = tcp_apply_settings,
+};
+
 /**
  * Open TCP URI
  *
@@ -1765,3 +3434,9 @@ struct uri_opener tcp_uri_opener __uri_opener = {
 	.open		= tcp_open_uri,
 };
 
+/* Drag in objects via tcp_protocol */
+REQUIRING_SYMBOL ( tcp_protocol );
+
+/* Drag in default congestion control algorithm */
+REQUIRE_OBJECT ( newreno );
+
@@ -32,6 +32,8 @@
 #include <ipxe/xfer.h>
 #include <ipxe/open.h>
 #include <ipxe/uri.h>
+#include <ipxe/timer.h>
+#include <ipxe/pool.h>
 #include <ipxe/features.h>
 #include <ipxe/ftp.h>
 
@@ -39,10 +41,25 @@
  *
  * File transfer protocol
  *
+ * A logged-in control connection is returned to a connection pool
+ * once a transfer has completed, and may be reused by a subsequent
+ * request to the same server using the same credentials.  A transfer
+ * interrupted by a failure of the data connection is resumed from
+ * the current position via a new data connection and a "REST"
+ * command.
  */
 
 FEATURE ( FEATURE_PROTOCOL, "FTP", DHCP_EB_FEATURE_FTP, 1 );
 
+/** FTP pooled connection expiry time */
+#define FTP_CONN_EXPIRY ( 10 * TICKS_PER_SEC )
+
+/** Maximum number of consecutive attempts to resume a transfer */
+#define FTP_MAX_RESUMES 3
+
+/** FTP connection pool */
+static LIST_HEAD ( ftp_connection_pool );
+
 /**
  * FTP states
  *
@@ -56,12 +73,26 @@ enum ftp_state {
 	FTP_TYPE,
 	FTP_SIZE,
 	FTP_PASV,
+	FTP_REST,
 	FTP_RETR,
 	FTP_WAIT,
-	FTP_QUIT,
 	FTP_DONE,
 };
 
+/** An FTP control connection */
+struct ftp_connection {
+	/** Reference counter */
+	struct refcnt refcnt;
+	/** Server URI (used only for host, port and credentials) */
+	struct uri *uri;
+	/** Transport layer interface */
+	struct interface socket;
+	/** Control channel interface */
+	struct interface control;
+	/** Pooled connection */
+	struct pooled_connection pool;
+};
+
 /**
  * An FTP request
  *
@@ -91,6 +122,15 @@ struct ftp_request {
 	char passive_text[24]; /* "aaa,bbb,ccc,ddd,eee,fff" */
 	/** File size, as text */
 	char filesize[20];
+	/** Restart offset, as text */
+	char offset_text[21];
+
+	/** Number of bytes received via the data channel */
+	size_t offset;
+	/** Number of consecutive attempts to resume the transfer */
+	unsigned int resumes;
+	/** Transfer must be restarted once current reply is received */
+	int restart;
 };
 
 /**
@@ -124,6 +164,268 @@ static void ftp_done ( struct ftp_request *ftp, int rc ) {
 	intf_shutdown ( &ftp->xfer, rc );
 }
 
+/*****************************************************************************
+ *
+ * FTP control connections
+ *
+ */
+
+/**
+ * Retrieve FTP user for URI
+ *
+ * @v uri		URI
+ * @ret user		FTP user
+ */
+static const char * ftp_uri_user ( struct uri *uri ) {
+	static char *ftp_default_user = "anonymous";
+	return uri->user ? uri->user : ftp_default_user;
+}
+
+/**
+ * Retrieve FTP password for URI
+ *
+ * @v uri		URI
+ * @ret password	FTP password
+ */
+static const char * ftp_uri_password ( struct uri *uri ) {
+	static char *ftp_default_password = "ipxe@ipxe.org";
+	return uri->password ? uri->password : ftp_default_password;
+}
+
+/**
+ * Free FTP control connection
+ *
+ * @v refcnt		Reference counter
+ */
+static void ftp_conn_free ( struct refcnt *refcnt ) {
+	struct ftp_connection *conn =
+		container_of ( refcnt, struct ftp_connection, refcnt );
+
+	uri_put ( conn->uri );
+	free ( conn );
+}
+
+/**
+ * Close FTP control connection
+ *
+ * @v conn		FTP control connection
+ * @v rc		Reason for close
+ */
+static void ftp_conn_close ( struct ftp_connection *conn, int rc ) {
+
+	/* Remove from connection pool, if applicable */
+	pool_del ( &conn->pool );
+
+	/* Shut down interfaces */
+	intf_shutdown ( &conn->socket, rc );
+	intf_shutdown ( &conn->control, rc );
+	DBGC2 ( conn, "FTPCONN %p closed: %s\n", conn, strerror ( rc ) );
+}
+
+/**
+ * Close expired pooled FTP control connection
+ *
+ * @v pool		Pooled connection
+ */
+static void ftp_conn_expired ( struct pooled_connection *pool ) {
+	struct ftp_connection *conn =
+		container_of ( pool, struct ftp_connection, pool );
+
+	/* Log out politely and close connection */
+	xfer_printf ( &conn->socket, "QUIT\r\n" );
+	ftp_conn_close ( conn, 0 /* Not an error to close idle connection */ );
+}
+
+/**
+ * Receive data from transport layer interface
+ *
+ * @v conn		FTP control connection
+ * @v iobuf		I/O buffer
+ * @v meta		Transfer metadata
+ * @ret rc		Return status code
+ */
+static int ftp_conn_socket_deliver ( struct ftp_connection *conn,
+				     struct io_buffer *iobuf,
+				     struct xfer_metadata *meta ) {
+
+	/* Close an idle connection if the server sends anything
+	 * (e.g. a "421" timeout notification), since there is no
+	 * request to receive it.
+	 */
+	if ( ! list_empty ( &conn->pool.list ) ) {
+		DBGC ( conn, "FTPCONN %p unexpected data while idle\n", conn );
+		free_iob ( iobuf );
+		ftp_conn_close ( conn, 0 );
+		return 0;
+	}
+
+	/* Mark connection as alive */
+	pool_alive ( &conn->pool );
+
+	/* Pass on to control channel interface */
+	return xfer_deliver ( &conn->control, iobuf, meta );
+}
+
+/**
+ * Close FTP control connection transport layer interface
+ *
+ * @v conn		FTP control connection
+ * @v rc		Reason for close
+ */
+static void ftp_conn_socket_close ( struct ftp_connection *conn, int rc ) {
+
+	/* If we are a recycled connection that has received nothing
+	 * since being reused, then suggest that the client should
+	 * reopen the connection.
+	 */
+	if ( pool_is_reopenable ( &conn->pool ) )
+		pool_reopen ( &conn->control );
+
+	/* Close the connection */
+	ftp_conn_close ( conn, rc );
+}
+
+/**
+ * Recycle FTP control connection after closing
+ *
+ * @v conn		FTP control connection
+ */
+static void ftp_conn_control_recycle ( struct ftp_connection *conn ) {
+
+	/* Mark connection as recyclable */
+	pool_recyclable ( &conn->pool );
+}
+
+/**
+ * Close FTP control connection control channel interface
+ *
+ * @v conn		FTP control connection
+ * @v rc		Reason for close
+ */
+static void ftp_conn_control_close ( struct ftp_connection *conn, int rc ) {
+
+	/* Add to the connection pool if recyclable and no error
+	 * occurred.
+	 */
+	if ( ( rc == 0 ) && pool_is_recyclable ( &conn->pool ) ) {
+		intf_restart ( &conn->control, rc );
+		pool_add ( &conn->pool, &ftp_connection_pool,
+			   FTP_CONN_EXPIRY );
+		DBGC2 ( conn, "FTPCONN %p pooled %s@%s\n",
+			conn, ftp_uri_user ( conn->uri ), conn->uri->host );
+		return;
+	}
+
+	/* Otherwise, close the connection */
+	ftp_conn_close ( conn, rc );
+}
+
+/** FTP control connection socket interface operations */
+static struct interface_operation ftp_conn_socket_operations[] = {
+	INTF_OP ( xfer_deliver, struct ftp_connection *,
+		  ftp_conn_socket_deliver ),
+	INTF_OP ( intf_close, struct ftp_connection *, ftp_conn_socket_close ),
+};
+
+/** FTP control connection socket interface descriptor */
+static struct interface_descriptor ftp_conn_socket_desc =
+	INTF_DESC_PASSTHRU ( struct ftp_connection, socket,
+			     ftp_conn_socket_operations, control );
+
+/** FTP control connection control channel interface operations */
+static struct interface_operation ftp_conn_control_operations[] = {
+	INTF_OP ( pool_recycle, struct ftp_connection *,
+		  ftp_conn_control_recycle ),
+	INTF_OP ( intf_close, struct ftp_connection *,
+		  ftp_conn_control_close ),
+};
+
+/** FTP control connection control channel interface descriptor */
+static struct interface_descriptor ftp_conn_control_desc =
+	INTF_DESC_PASSTHRU ( struct ftp_connection, control,
+			     ftp_conn_control_operations, socket );
+
+/**
+ * Check if FTP control connection may be reused for a URI
+ *
+ * @v conn		FTP control connection
+ * @v uri		URI
+ * @ret matches		Connection may be reused
+ */
+static int ftp_conn_matches ( struct ftp_connection *conn, struct uri *uri ) {
+
+	return ( ( strcmp ( uri->host, conn->uri->host ) == 0 ) &&
+		 ( uri_port ( uri, FTP_PORT ) ==
+		   uri_port ( conn->uri, FTP_PORT ) ) &&
+		 ( strcmp ( ftp_uri_user ( uri ),
+			    ftp_uri_user ( conn->uri ) ) == 0 ) &&
+		 ( strcmp ( ftp_uri_password ( uri ),
+			    ftp_uri_password ( conn->uri ) ) == 0 ) );
+}
+
+/**
+ * Open FTP control connection
+ *
+ * @v control		Control channel interface
+ * @v uri		URI
+ * @ret rc		Return status code, or positive if reused
+ *
+ * A positive return value indicates that an existing logged-in
+ * connection has been reused from the connection pool.
+ */
+static int ftp_conn_open ( struct interface *control, struct uri *uri ) {
+	struct ftp_connection *conn;
+	struct sockaddr_tcpip server;
+	int rc;
+
+	/* Look for a reusable connection in the pool */
+	list_for_each_entry ( conn, &ftp_connection_pool, pool.list ) {
+		if ( ftp_conn_matches ( conn, uri ) ) {
+
+			/* Remove from connection pool, stop timer,
+			 * attach to parent interface, and return.
+			 */
+			pool_del ( &conn->pool );
+			intf_plug_plug ( &conn->control, control );
+			DBGC2 ( conn, "FTPCONN %p reused %s@%s\n",
+				conn, ftp_uri_user ( uri ), uri->host );
+			return 1;
+		}
+	}
+
+	/* Allocate and initialise structure */
+	conn = zalloc ( sizeof ( *conn ) );
+	if ( ! conn )
+		return -ENOMEM;
+	ref_init ( &conn->refcnt, ftp_conn_free );
+	intf_init ( &conn->socket, &ftp_conn_socket_desc, &conn->refcnt );
+	intf_init ( &conn->control, &ftp_conn_control_desc, &conn->refcnt );
+	pool_init ( &conn->pool, ftp_conn_expired, &conn->refcnt );
+	conn->uri = uri_get ( uri );
+
+	/* Open socket */
+	memset ( &server, 0, sizeof ( server ) );
+	server.st_port = htons ( uri_port ( uri, FTP_PORT ) );
+	if ( ( rc = xfer_open_named_socket ( &conn->socket, SOCK_STREAM,
+					     ( struct sockaddr * ) &server,
+					     uri->host, NULL ) ) != 0 )
+		goto err_open;
+
+	/* Attach to parent interface, mortalise self, and return */
+	intf_plug_plug ( &conn->control, control );
+	ref_put ( &conn->refcnt );
+	DBGC2 ( conn, "FTPCONN %p created %s@%s\n",
+		conn, ftp_uri_user ( uri ), uri->host );
+	return 0;
+
+ err_open:
+	DBGC ( conn, "FTPCONN %p could not open: %s\n",
+	       conn, strerror ( rc ) );
+	ftp_conn_close ( conn, rc );
+	ref_put ( &conn->refcnt );
+	return rc;
+}
+
 /*****************************************************************************
  *
  * FTP control channel
@@ -159,8 +461,7 @@ static const char * ftp_uri_path ( struct ftp_request *ftp ) {
  * @ret user		FTP user
  */
 static const char * ftp_user ( struct ftp_request *ftp ) {
-	static char *ftp_default_user = "anonymous";
-	return ftp->uri->user ? ftp->uri->user : ftp_default_user;
+	return ftp_uri_user ( ftp->uri );
 }
 
 /**
@@ -170,8 +471,19 @@ static const char * ftp_user ( struct ftp_request *ftp ) {
  * @ret password	FTP password
  */
 static const char * ftp_password ( struct ftp_request *ftp ) {
-	static char *ftp_default_password = "ipxe@ipxe.org";
-	return ftp->uri->password ? ftp->uri->password : ftp_default_password;
+	return ftp_uri_password ( ftp->uri );
+}
+
+/**
+ * Retrieve FTP restart offset
+ *
+ * @v ftp		FTP request
+ * @ret offset		FTP restart offset
+ */
+static const char * ftp_offset ( struct ftp_request *ftp ) {
+	snprintf ( ftp->offset_text, sizeof ( ftp->offset_text ), "%zd",
+		   ftp->offset );
+	return ftp->offset_text;
 }
 
 /** FTP control channel strings */
@@ -182,9 +494,9 @@ static struct ftp_control_string ftp_strings[] = {
 	[FTP_TYPE]	= { "TYPE I", NULL },
 	[FTP_SIZE]	= { "SIZE ", ftp_uri_path },
 	[FTP_PASV]	= { "PASV", NULL },
+	[FTP_REST]	= { "REST ", ftp_offset },
 	[FTP_RETR]	= { "RETR ", ftp_uri_path },
 	[FTP_WAIT]	= { NULL, NULL },
-	[FTP_QUIT]	= { "QUIT", NULL },
 	[FTP_DONE]	= { NULL, NULL },
 };
 
@@ -226,6 +538,19 @@ static void ftp_next_state ( struct ftp_request *ftp ) {
 	if ( ftp->state < FTP_DONE )
 		ftp->state++;
 
+	/* Skip "REST" unless resuming an interrupted transfer */
+	if ( ( ftp->state == FTP_REST ) && ( ftp->offset == 0 ) )
+		ftp->state++;
+
+	/* Return control connection to the pool once the transfer
+	 * is complete.
+	 */
+	if ( ftp->state == FTP_DONE ) {
+		pool_recycle ( &ftp->control );
+		ftp_done ( ftp, 0 );
+		return;
+	}
+
 	/* Send control string if needed */
 	ftp_string = &ftp_strings[ftp->state];
 	literal = ftp_string->literal;
@@ -237,6 +562,22 @@ static void ftp_next_state ( struct ftp_request *ftp ) {
 	}
 }
 
+/**
+ * Restart interrupted transfer
+ *
+ * @v ftp		FTP request
+ *
+ * A new data connection is opened, and the transfer is resumed from
+ * the number of bytes already received.
+ */
+static void ftp_restart ( struct ftp_request *ftp ) {
+
+	DBGC ( ftp, "FTP %p resuming from offset %zd\n", ftp, ftp->offset );
+	ftp->restart = 0;
+	ftp->state = FTP_SIZE;
+	ftp_next_state ( ftp );
+}
+
 /**
  * Handle an FTP control channel response
  *
@@ -258,6 +599,15 @@ static void ftp_reply ( struct ftp_request *ftp ) {
 	if ( status_major == '1' )
 		return;
 
+	/* If the data connection failed, then restart the transfer
+	 * once the outstanding command has completed (whether
+	 * successfully or otherwise).
+	 */
+	if ( ftp->restart ) {
+		ftp_restart ( ftp );
+		return;
+	}
+
 	/* If the SIZE command is not supported by the server, we go to
 	 * the next step.
 	 */
@@ -267,11 +617,12 @@ static void ftp_reply ( struct ftp_request *ftp ) {
 	}
 
 	/* Anything other than success (2xx) or, in the case of a
-	 * repsonse to a "USER" command, a password prompt (3xx), is a
-	 * fatal error.
+	 * repsonse to a "USER" or "REST" command, a request for
+	 * further information (3xx), is a fatal error.
 	 */
 	if ( ! ( ( status_major == '2' ) ||
-		 ( ( status_major == '3' ) && ( ftp->state == FTP_USER ) ) ) ){
+		 ( ( status_major == '3' ) && ( ( ftp->state == FTP_USER ) ||
+					      ( ftp->state == FTP_REST ) ) ) )){
 		/* Flag protocol error and close connections */
 		ftp_done ( ftp, -EPROTO );
 		return;
@@ -387,9 +738,57 @@ static int ftp_control_deliver ( struct ftp_request *ftp,
 	return 0;
 }
 
+/**
+ * Open FTP control channel
+ *
+ * @v ftp		FTP request
+ * @ret rc		Return status code
+ */
+static int ftp_connect ( struct ftp_request *ftp ) {
+	int rc;
+
+	/* Reset control channel state */
+	ftp->state = FTP_CONNECT;
+	ftp->recvbuf = ftp->status_text;
+	ftp->recvsize = sizeof ( ftp->status_text ) - 1;
+
+	/* Open control connection */
+	if ( ( rc = ftp_conn_open ( &ftp->control, ftp->uri ) ) < 0 )
+		return rc;
+
+	/* Skip login if an existing connection was reused */
+	if ( rc > 0 ) {
+		ftp->state = FTP_PASS;
+		ftp_next_state ( ftp );
+	}
+
+	return 0;
+}
+
+/**
+ * Reopen stale FTP control channel
+ *
+ * @v ftp		FTP request
+ */
+static void ftp_reopen ( struct ftp_request *ftp ) {
+	int rc;
+
+	/* Close existing connection */
+	intf_restart ( &ftp->control, -ECANCELED );
+
+	/* Reopen connection */
+	if ( ( rc = ftp_connect ( ftp ) ) != 0 ) {
+		DBGC ( ftp, "FTP %p could not reconnect: %s\n",
+		       ftp, strerror ( rc ) );
+		ftp_done ( ftp, rc );
+		return;
+	}
+}
+
 /** FTP control channel interface operations */
 static struct interface_operation ftp_control_operations[] = {
 	INTF_OP ( xfer_deliver, struct ftp_request *, ftp_control_deliver ),
+	INTF_OP ( pool_reopen, struct ftp_request *, ftp_reopen ),
 	INTF_OP ( intf_close, struct ftp_request *, ftp_done ),
 };
 
@@ -403,6 +802,28 @@ static struct interface_descriptor ftp_control_desc =
  *
  */
 
+/**
+ * Receive data via FTP data channel
+ *
+ * @v ftp		FTP request
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int ftp_data_deliver ( struct ftp_request *ftp,
+			      struct io_buffer *iobuf,
+			      struct xfer_metadata *meta ) {
+	size_t len = iob_len ( iobuf );
+
+	/* Record progress, for use if the transfer must be resumed */
+	ftp->offset += len;
+	if ( len )
+		ftp->resumes = 0;
+
+	/* Pass on to data transfer interface */
+	return xfer_deliver ( &ftp->xfer, iobuf, meta );
+}
+
 /**
  * Handle FTP data channel being closed
  *
@@ -413,23 +834,45 @@ static struct interface_descriptor ftp_control_desc =
  * alone; the server will send a completion message via the control
  * channel which we'll pick up.
  *
- * If the data channel is closed due to an error, we abort the request.
+ * If the data channel is closed due to an error, we resume the
+ * transfer via a new data channel if possible, otherwise we abort
+ * the request.
  */
 static void ftp_data_closed ( struct ftp_request *ftp, int rc ) {
 
 	DBGC ( ftp, "FTP %p data connection closed: %s\n",
 	       ftp, strerror ( rc ) );
-	
-	/* If there was an error, close control channel and record status */
-	if ( rc ) {
+
+	/* Move to next state if there was no error */
+	if ( rc == 0 ) {
+		ftp_next_state ( ftp );
+		return;
+	}
+
+	/* Abort if the transfer cannot be resumed */
+	if ( ( ftp->state < FTP_REST ) || ftp->restart ||
+	     ( ftp->resumes >= FTP_MAX_RESUMES ) ) {
 		ftp_done ( ftp, rc );
+		return;
+	}
+	ftp->resumes++;
+
+	/* Close data channel */
+	intf_restart ( &ftp->data, rc );
+
+	/* Restart immediately if the server has already responded to
+	 * the "RETR" command, otherwise wait for its response.
+	 */
+	if ( ftp->state == FTP_WAIT ) {
+		ftp_restart ( ftp );
 	} else {
-		ftp_next_state ( ftp );
+		ftp->restart = 1;
 	}
 }
 
 /** FTP data channel interface operations */
 static struct interface_operation ftp_data_operations[] = {
+	INTF_OP ( xfer_deliver, struct ftp_request *, ftp_data_deliver ),
 	INTF_OP ( intf_close, struct ftp_request *, ftp_data_closed ),
 };
 
@@ -488,7 +931,6 @@ static int ftp_check_string ( const char *string ) {
  */
 static int ftp_open ( struct interface *xfer, struct uri *uri ) {
 	struct ftp_request *ftp;
-	struct sockaddr_tcpip server;
 	int rc;
 
 	/* Sanity checks */
@@ -513,17 +955,11 @@ static int ftp_open ( struct interface *xfer, struct uri *uri ) {
 	intf_init ( &ftp->control, &ftp_control_desc, &ftp->refcnt );
 	intf_init ( &ftp->data, &ftp_data_desc, &ftp->refcnt );
 	ftp->uri = uri_get ( uri );
-	ftp->recvbuf = ftp->status_text;
-	ftp->recvsize = sizeof ( ftp->status_text ) - 1;
 
 	DBGC ( ftp, "FTP %p fetching %s\n", ftp, ftp->uri->path );
 
 	/* Open control connection */
-	memset ( &server, 0, sizeof ( server ) );
-	server.st_port = htons ( uri_port ( uri, FTP_PORT ) );
-	if ( ( rc = xfer_open_named_socket ( &ftp->control, SOCK_STREAM,
-					     ( struct sockaddr * ) &server,
-					     uri->host, NULL ) ) != 0 )
+	if ( ( rc = ftp_connect ( ftp ) ) != 0 )
 		goto err;
 
 	/* Attach to parent interface, mortalise self, and return */
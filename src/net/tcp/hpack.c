@@ -0,0 +1,650 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * HPACK header compression for HTTP/2
+ *
+ * HPACK is documented in RFC 7541.  Received header blocks are fully
+ * decoded (including Huffman-coded strings and the dynamic table).
+ * Transmitted header fields are encoded using only the static table
+ * and literal strings, and so never affect the peer's dynamic table.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <assert.h>
+#include <ipxe/hpack.h>
+
+/* Disambiguate the various error causes */
+#define EINVAL_INTEGER __einfo_error ( EINFO_EINVAL_INTEGER )
+#define EINFO_EINVAL_INTEGER \
+	__einfo_uniqify ( EINFO_EINVAL, 0x01, "Invalid integer" )
+#define EINVAL_STRING __einfo_error ( EINFO_EINVAL_STRING )
+#define EINFO_EINVAL_STRING \
+	__einfo_uniqify ( EINFO_EINVAL, 0x02, "Invalid string" )
+#define EINVAL_HUFFMAN __einfo_error ( EINFO_EINVAL_HUFFMAN )
+#define EINFO_EINVAL_HUFFMAN \
+	__einfo_uniqify ( EINFO_EINVAL, 0x03, "Invalid Huffman code" )
+#define EINVAL_INDEX __einfo_error ( EINFO_EINVAL_INDEX )
+#define EINFO_EINVAL_INDEX \
+	__einfo_uniqify ( EINFO_EINVAL, 0x04, "Invalid table index" )
+#define EINVAL_SIZE __einfo_error ( EINFO_EINVAL_SIZE )
+#define EINFO_EINVAL_SIZE \
+	__einfo_uniqify ( EINFO_EINVAL, 0x05, "Invalid table size" )
+
+/** Maximum shift used when decoding an integer
+ *
+ * This limits decoded integers to around 2^28, which is far larger
+ * than any legitimate index or string length.
+ */
+#define HPACK_INTEGER_MAX_SHIFT 21
+
+/** An HPACK static table entry */
+struct hpack_static {
+	/** Name */
+	const char *name;
+	/** Value */
+	const char *value;
+};
+
+/** An HPACK decoding cursor */
+struct hpack_cursor {
+	/** Data */
+	const uint8_t *data;
+	/** Length of data */
+	size_t len;
+};
+
+/** HPACK static table */
+static const struct hpack_static hpack_static[] = {
+	{ ":authority", "" },
+	{ ":method", "GET" },
+	{ ":method", "POST" },
+	{ ":path", "/" },
+	{ ":path", "/index.html" },
+	{ ":scheme", "http" },
+	{ ":scheme", "https" },
+	{ ":status", "200" },
+	{ ":status", "204" },
+	{ ":status", "206" },
+	{ ":status", "304" },
+	{ ":status", "400" },
+	{ ":status", "404" },
+	{ ":status", "500" },
+	{ "accept-charset", "" },
+	{ "accept-encoding", "gzip, deflate" },
+	{ "accept-language", "" },
+	{ "accept-ranges", "" },
+	{ "accept", "" },
+	{ "access-control-allow-origin", "" },
+	{ "age", "" },
+	{ "allow", "" },
+	{ "authorization", "" },
+	{ "cache-control", "" },
+	{ "content-disposition", "" },
+	{ "content-encoding", "" },
+	{ "content-language", "" },
+	{ "content-length", "" },
+	{ "content-location", "" },
+	{ "content-range", "" },
+	{ "content-type", "" },
+	{ "cookie", "" },
+	{ "date", "" },
+	{ "etag", "" },
+	{ "expect", "" },
+	{ "expires", "" },
+	{ "from", "" },
+	{ "host", "" },
+	{ "if-match", "" },
+	{ "if-modified-since", "" },
+	{ "if-none-match", "" },
+	{ "if-range", "" },
+	{ "if-unmodified-since", "" },
+	{ "last-modified", "" },
+	{ "link", "" },
+	{ "location", "" },
+	{ "max-forwards", "" },
+	{ "proxy-authenticate", "" },
+	{ "proxy-authorization", "" },
+	{ "range", "" },
+	{ "referer", "" },
+	{ "refresh", "" },
+	{ "retry-after", "" },
+	{ "server", "" },
+	{ "set-cookie", "" },
+	{ "strict-transport-security", "" },
+	{ "transfer-encoding", "" },
+	{ "user-agent", "" },
+	{ "vary", "" },
+	{ "via", "" },
+	{ "www-authenticate", "" },
+};
+
+/** Number of Huffman codes of each length */
+static const uint8_t hpack_huffman_counts[HPACK_HUFFMAN_MAX_LEN + 1] = {
+	0, 0, 0, 0, 0, 10, 26, 32, 6, 0, 5, 3, 2, 6, 2, 3, 0, 0, 0, 3, 8, 13,
+	26, 29, 12, 4, 15, 19, 29, 0, 3
+};
+
+/** Huffman-coded symbols, in order of increasing code value */
+static const uint8_t hpack_huffman_symbols[] = {
+	0x30, 0x31, 0x32, 0x61, 0x63, 0x65, 0x69, 0x6f, 0x73, 0x74, 0x20,
+	0x25, 0x2d, 0x2e, 0x2f, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39,
+	0x3d, 0x41, 0x5f, 0x62, 0x64, 0x66, 0x67, 0x68, 0x6c, 0x6d, 0x6e,
+	0x70, 0x72, 0x75, 0x3a, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+	0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f, 0x50, 0x51, 0x52, 0x53,
+	0x54, 0x55, 0x56, 0x57, 0x59, 0x6a, 0x6b, 0x71, 0x76, 0x77, 0x78,
+	0x79, 0x7a, 0x26, 0x2a, 0x2c, 0x3b, 0x58, 0x5a, 0x21, 0x22, 0x28,
+	0x29, 0x3f, 0x27, 0x2b, 0x7c, 0x23, 0x3e, 0x00, 0x24, 0x40, 0x5b,
+	0x5d, 0x7e, 0x5e, 0x7d, 0x3c, 0x60, 0x7b, 0x5c, 0xc3, 0xd0, 0x80,
+	0x82, 0x83, 0xa2, 0xb8, 0xc2, 0xe0, 0xe2, 0x99, 0xa1, 0xa7, 0xac,
+	0xb0, 0xb1, 0xb3, 0xd1, 0xd8, 0xd9, 0xe3, 0xe5, 0xe6, 0x81, 0x84,
+	0x85, 0x86, 0x88, 0x92, 0x9a, 0x9c, 0xa0, 0xa3, 0xa4, 0xa9, 0xaa,
+	0xad, 0xb2, 0xb5, 0xb9, 0xba, 0xbb, 0xbd, 0xbe, 0xc4, 0xc6, 0xe4,
+	0xe8, 0xe9, 0x01, 0x87, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8f, 0x93,
+	0x95, 0x96, 0x97, 0x98, 0x9b, 0x9d, 0x9e, 0xa5, 0xa6, 0xa8, 0xae,
+	0xaf, 0xb4, 0xb6, 0xb7, 0xbc, 0xbf, 0xc5, 0xe7, 0xef, 0x09, 0x8e,
+	0x90, 0x91, 0x94, 0x9f, 0xab, 0xce, 0xd7, 0xe1, 0xec, 0xed, 0xc7,
+	0xcf, 0xea, 0xeb, 0xc0, 0xc1, 0xc8, 0xc9, 0xca, 0xcd, 0xd2, 0xd5,
+	0xda, 0xdb, 0xee, 0xf0, 0xf2, 0xf3, 0xff, 0xcb, 0xcc, 0xd3, 0xd4,
+	0xd6, 0xdd, 0xde, 0xdf, 0xf1, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xfa,
+	0xfb, 0xfc, 0xfd, 0xfe, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+	0x0b, 0x0c, 0x0e, 0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x17,
+	0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x7f, 0xdc, 0xf9,
+	0x0a, 0x0d, 0x16
+};
+
+/**
+ * Decode integer
+ *
+ * @v cursor		Decoding cursor
+ * @v prefix		Number of bits in prefix
+ * @v value		Value to fill in
+ * @ret rc		Return status code
+ */
+static int hpack_integer ( struct hpack_cursor *cursor, unsigned int prefix,
+			   size_t *value ) {
+	unsigned int mask = ( ( 1 << prefix ) - 1 );
+	unsigned int shift = 0;
+	uint8_t byte;
+
+	/* Extract prefix */
+	assert ( cursor->len > 0 );
+	*value = ( *(cursor->data++) & mask );
+	cursor->len--;
+	if ( *value < mask )
+		return 0;
+
+	/* Extract continuation bytes */
+	do {
+		if ( ( ! cursor->len ) || ( shift > HPACK_INTEGER_MAX_SHIFT ) )
+			return -EINVAL_INTEGER;
+		byte = *(cursor->data++);
+		cursor->len--;
+		*value += ( ( ( size_t ) ( byte & 0x7f ) ) << shift );
+		shift += 7;
+	} while ( byte & 0x80 );
+
+	return 0;
+}
+
+/**
+ * Decode Huffman-coded string
+ *
+ * @v data		Huffman-coded data
+ * @v len		Length of Huffman-coded data
+ * @v buf		Buffer to fill in
+ * @ret len		Length of decoded string, or negative error
+ *
+ * The Huffman code is canonical, and so may be decoded using only
+ * the number of codes of each length and the list of symbols in
+ * order of increasing code value.
+ */
+static int hpack_huffman ( const uint8_t *data, size_t len, char *buf ) {
+	char *out = buf;
+	unsigned int count;
+	unsigned int index = 0;
+	unsigned int bits = 0;
+	uint32_t first = 0;
+	uint32_t code = 0;
+	unsigned int bit;
+	uint8_t byte;
+
+	/* Decode symbols */
+	while ( len-- ) {
+		byte = *(data++);
+		for ( bit = 0x80 ; bit ; bit >>= 1 ) {
+
+			/* Add bit to current code */
+			if ( byte & bit )
+				code |= 1;
+			count = hpack_huffman_counts[++bits];
+
+			/* Check for a complete code of this length */
+			if ( ( code - first ) < count ) {
+				*(out++) = hpack_huffman_symbols[ index + code -
+								  first ];
+				index = bits = first = code = 0;
+				continue;
+			}
+
+			/* Fail if code is invalid (or is end-of-string) */
+			if ( bits >= HPACK_HUFFMAN_MAX_LEN )
+				return -EINVAL_HUFFMAN;
+
+			/* Move to codes of the next length */
+			index += count;
+			first = ( ( first + count ) << 1 );
+			code <<= 1;
+		}
+	}
+
+	/* Padding must be shorter than a byte, and must consist of
+	 * the most significant bits of the end-of-string code (i.e.
+	 * must be all ones).
+	 */
+	if ( ( bits >= 8 ) || ( ( code >> 1 ) != ( ( 1U << bits ) - 1 ) ) )
+		return -EINVAL_HUFFMAN;
+
+	return ( out - buf );
+}
+
+/**
+ * Decode string
+ *
+ * @v cursor		Decoding cursor
+ * @v buf		Buffer to fill in
+ * @ret len		Length of decoded string, or negative error
+ *
+ * The buffer must be large enough to hold the decoded string and a
+ * terminating NUL.  Since the shortest Huffman code is five bits, a
+ * string will never decode to more than 8/5 of its encoded length.
+ */
+static int hpack_string ( struct hpack_cursor *cursor, char *buf ) {
+	size_t len;
+	int huffman;
+	int decoded;
+	int rc;
+
+	/* Decode length */
+	if ( ! cursor->len )
+		return -EINVAL_STRING;
+	huffman = ( *(cursor->data) & HPACK_HUFFMAN );
+	if ( ( rc = hpack_integer ( cursor, 7, &len ) ) != 0 )
+		return rc;
+	if ( len > cursor->len )
+		return -EINVAL_STRING;
+
+	/* Decode string */
+	if ( huffman ) {
+		decoded = hpack_huffman ( cursor->data, len, buf );
+		if ( decoded < 0 )
+			return decoded;
+	} else {
+		memcpy ( buf, cursor->data, len );
+		decoded = len;
+	}
+	buf[decoded] = '\0';
+	cursor->data += len;
+	cursor->len -= len;
+
+	return decoded;
+}
+
+/**
+ * Evict entries from dynamic table
+ *
+ * @v table		Dynamic table
+ * @v size		Maximum size to retain
+ */
+static void hpack_evict ( struct hpack_table *table, size_t size ) {
+	struct hpack_entry *entry;
+
+	/* Evict oldest entries until table is small enough */
+	while ( table->used > size ) {
+		entry = list_last_entry ( &table->entries, struct hpack_entry,
+					  list );
+		assert ( entry != NULL );
+		table->used -= entry->size;
+		list_del ( &entry->list );
+		free ( entry );
+	}
+}
+
+/**
+ * Add entry to dynamic table
+ *
+ * @v table		Dynamic table
+ * @v name		Name
+ * @v value		Value
+ * @ret rc		Return status code
+ */
+static int hpack_add ( struct hpack_table *table, const char *name,
+		       const char *value ) {
+	struct hpack_entry *entry;
+	size_t name_len = strlen ( name );
+	size_t value_len = strlen ( value );
+	size_t size = ( name_len + value_len + HPACK_ENTRY_OVERHEAD );
+
+	/* An entry larger than the table simply empties the table */
+	if ( size > table->size ) {
+		hpack_evict ( table, 0 );
+		return 0;
+	}
+
+	/* Allocate and populate entry.  This must happen before
+	 * eviction, since the name may refer to an evicted entry.
+	 */
+	entry = malloc ( sizeof ( *entry ) + name_len + 1 /* NUL */ +
+			 value_len + 1 /* NUL */ );
+	if ( ! entry )
+		return -ENOMEM;
+	entry->size = size;
+	memcpy ( entry->name, name, ( name_len + 1 /* NUL */ ) );
+	entry->value = ( entry->name + name_len + 1 /* NUL */ );
+	memcpy ( entry->value, value, ( value_len + 1 /* NUL */ ) );
+
+	/* Evict entries to make space, and add new entry */
+	hpack_evict ( table, ( table->size - size ) );
+	list_add ( &entry->list, &table->entries );
+	table->used += size;
+
+	return 0;
+}
+
+/**
+ * Look up indexed header field
+ *
+ * @v table		Dynamic table
+ * @v index		Index
+ * @v name		Name to fill in
+ * @v value		Value to fill in
+ * @ret rc		Return status code
+ */
+static int hpack_lookup ( struct hpack_table *table, size_t index,
+			  const char **name, const char **value ) {
+	struct hpack_entry *entry;
+
+	/* Index zero is never valid */
+	if ( ! index )
+		return -EINVAL_INDEX;
+
+	/* Look up in static table */
+	if ( index <= HPACK_STATIC_COUNT ) {
+		*name = hpack_static[ index - 1 ].name;
+		*value = hpack_static[ index - 1 ].value;
+		return 0;
+	}
+
+	/* Look up in dynamic table */
+	index -= ( HPACK_STATIC_COUNT + 1 );
+	list_for_each_entry ( entry, &table->entries, list ) {
+		if ( index-- == 0 ) {
+			*name = entry->name;
+			*value = entry->value;
+			return 0;
+		}
+	}
+
+	return -EINVAL_INDEX;
+}
+
+/**
+ * Free HPACK dynamic table
+ *
+ * @v table		Dynamic table
+ */
+void hpack_fini ( struct hpack_table *table ) {
+
+	/* Evict all entries */
+	hpack_evict ( table, 0 );
+}
+
+/**
+ * Decode header block
+ *
+ * @v table		Dynamic table
+ * @v data		Header block
+ * @v len		Length of header block
+ * @v header		Method to call for each header field
+ * @v opaque		Opaque pointer to pass to method
+ * @ret rc		Return status code
+ *
+ * Header blocks must be decoded in the order received, even if the
+ * decoded header fields are not required, since decoding updates the
+ * dynamic table.
+ */
+int hpack_decode ( struct hpack_table *table, const void *data, size_t len,
+		   int ( * header ) ( void *opaque, const char *name,
+				      const char *value ),
+		   void *opaque ) {
+	struct hpack_cursor cursor;
+	const char *name;
+	const char *value;
+	unsigned int prefix;
+	size_t index;
+	uint8_t type;
+	char *buf;
+	int name_len;
+	int value_len;
+	int rc;
+
+	/* Allocate buffer large enough for any decoded name and value */
+	buf = malloc ( ( ( len * 8 ) / 5 ) + 2 /* NULs */ );
+	if ( ! buf ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+
+	/* Decode header fields */
+	cursor.data = data;
+	cursor.len = len;
+	while ( cursor.len ) {
+		type = *(cursor.data);
+
+		/* Handle indexed header field */
+		if ( type & HPACK_INDEXED ) {
+			if ( ( rc = hpack_integer ( &cursor, 7,
+						    &index ) ) != 0 )
+				goto err;
+			if ( ( rc = hpack_lookup ( table, index, &name,
+						   &value ) ) != 0 )
+				goto err;
+			if ( ( rc = header ( opaque, name, value ) ) != 0 )
+				goto err;
+			continue;
+		}
+
+		/* Handle dynamic table size update */
+		if ( ( type & ~( HPACK_SIZE_UPDATE - 1 ) ) ==
+		     HPACK_SIZE_UPDATE ) {
+			if ( ( rc = hpack_integer ( &cursor, 5,
+						    &index ) ) != 0 )
+				goto err;
+			if ( index > table->limit ) {
+				rc = -EINVAL_SIZE;
+				goto err;
+			}
+			table->size = index;
+			hpack_evict ( table, table->size );
+			continue;
+		}
+
+		/* Handle literal header field */
+		prefix = ( ( type & HPACK_LITERAL_INDEXED ) ? 6 : 4 );
+		if ( ( rc = hpack_integer ( &cursor, prefix, &index ) ) != 0 )
+			goto err;
+		if ( index ) {
+			if ( ( rc = hpack_lookup ( table, index, &name,
+						   &value ) ) != 0 )
+				goto err;
+			name_len = -1;
+		} else {
+			name_len = hpack_string ( &cursor, buf );
+			if ( name_len < 0 ) {
+				rc = name_len;
+				goto err;
+			}
+			name = buf;
+		}
+		value_len = hpack_string ( &cursor, ( buf + name_len + 1 ) );
+		if ( value_len < 0 ) {
+			rc = value_len;
+			goto err;
+		}
+		value = ( buf + name_len + 1 );
+		if ( ( rc = header ( opaque, name, value ) ) != 0 )
+			goto err;
+		if ( ( type & HPACK_LITERAL_INDEXED ) &&
+		     ( ( rc = hpack_add ( table, name, value ) ) != 0 ) )
+			goto err;
+	}
+
+	/* Success */
+	rc = 0;
+
+ err:
+	free ( buf );
+ err_alloc:
+	return rc;
+}
+
+/**
+ * Encode integer
+ *
+ * @v data		Buffer, or NULL
+ * @v type		Representation type bits
+ * @v prefix		Number of bits in prefix
+ * @v value		Value
+ * @ret len		Length of encoded integer
+ */
+static size_t hpack_encode_integer ( uint8_t *data, unsigned int type,
+				     unsigned int prefix, size_t value ) {
+	unsigned int mask = ( ( 1 << prefix ) - 1 );
+	size_t len = 0;
+
+	/* Encode prefix */
+	if ( value < mask ) {
+		if ( data )
+			data[len] = ( type | value );
+		return ( len + 1 );
+	}
+	if ( data )
+		data[len] = ( type | mask );
+	len++;
+	value -= mask;
+
+	/* Encode continuation bytes */
+	for ( ; value >= 0x80 ; value >>= 7 ) {
+		if ( data )
+			data[len] = ( 0x80 | ( value & 0x7f ) );
+		len++;
+	}
+	if ( data )
+		data[len] = value;
+	len++;
+
+	return len;
+}
+
+/**
+ * Encode literal string
+ *
+ * @v data		Buffer, or NULL
+ * @v string		String
+ * @v string_len	Length of string
+ * @v lower		Convert to lower case
+ * @ret len		Length of encoded string
+ */
+static size_t hpack_encode_string ( uint8_t *data, const char *string,
+				    size_t string_len, int lower ) {
+	size_t len;
+	size_t i;
+
+	/* Encode length */
+	len = hpack_encode_integer ( data, 0, 7, string_len );
+
+	/* Encode string */
+	if ( data ) {
+		for ( i = 0 ; i < string_len ; i++ ) {
+			data[ len + i ] = ( lower ? tolower ( string[i] ) :
+					    string[i] );
+		}
+	}
+
+	return ( len + string_len );
+}
+
+/**
+ * Encode header field
+ *
+ * @v data		Buffer, or NULL to calculate length
+ * @v name		Name
+ * @v name_len		Length of name
+ * @v value		Value
+ * @v value_len		Length of value
+ * @ret len		Length of encoded header field
+ *
+ * The header field name is converted to lower case, as required by
+ * HTTP/2.  Header fields are never added to the peer's dynamic table.
+ */
+size_t hpack_encode ( void *data, const char *name, size_t name_len,
+		      const char *value, size_t value_len ) {
+	const struct hpack_static *entry;
+	unsigned int name_index = 0;
+	unsigned int i;
+	size_t len;
+
+	/* Look for matching static table entry */
+	for ( i = 0 ; i < HPACK_STATIC_COUNT ; i++ ) {
+		entry = &hpack_static[i];
+		if ( ( strlen ( entry->name ) != name_len ) ||
+		     ( strncasecmp ( entry->name, name, name_len ) != 0 ) )
+			continue;
+		if ( ( strlen ( entry->value ) == value_len ) &&
+		     ( memcmp ( entry->value, value, value_len ) == 0 ) ) {
+			return hpack_encode_integer ( data, HPACK_INDEXED, 7,
+						      ( i + 1 ) );
+		}
+		if ( ! name_index )
+			name_index = ( i + 1 );
+	}
+
+	/* Encode as literal header field without indexing */
+	len = hpack_encode_integer ( data, HPACK_LITERAL, 4, name_index );
+	if ( ! name_index ) {
+		len += hpack_encode_string ( ( data ? ( data + len ) : NULL ),
+					     name, name_len, 1 );
+	}
+	len += hpack_encode_string ( ( data ? ( data + len ) : NULL ),
+				     value, value_len, 0 );
+
+	return len;
+}
@@ -0,0 +1,1982 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/**
+ * @file
+ *
+ * Hyper Text Transfer Protocol version 2 (HTTP/2)
+ *
+ * HTTP/2 is documented in RFC 9113.  It is negotiated via TLS
+ * application-layer protocol negotiation, and allows many concurrent
+ * requests to be multiplexed as separate streams over a single
+ * connection.
+ *
+ * Each stream presents the same interface as an HTTP/1.1 connection:
+ * the request is received from the HTTP transaction as HTTP/1.1 text
+ * and translated into a HEADERS frame (and any DATA frames), and the
+ * response headers are translated back into HTTP/1.1 text before
+ * being delivered to the HTTP transaction, followed by the response
+ * content.  This allows the existing HTTP core (including all
+ * authentication, redirection and content decoding mechanisms) to be
+ * used unmodified.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <byteswap.h>
+#include <ipxe/uri.h>
+#include <ipxe/timer.h>
+#include <ipxe/xfer.h>
+#include <ipxe/pool.h>
+#include <ipxe/tls.h>
+#include <ipxe/http.h>
+#include <ipxe/http2.h>
+
+/* Disambiguate the various error causes */
+#define EPROTO_FRAME __einfo_error ( EINFO_EPROTO_FRAME )
+#define EINFO_EPROTO_FRAME \
+	__einfo_uniqify ( EINFO_EPROTO, 0x01, "Invalid frame" )
+#define EPROTO_FRAME_SIZE __einfo_error ( EINFO_EPROTO_FRAME_SIZE )
+#define EINFO_EPROTO_FRAME_SIZE \
+	__einfo_uniqify ( EINFO_EPROTO, 0x02, "Invalid frame size" )
+#define EPROTO_SETTINGS __einfo_error ( EINFO_EPROTO_SETTINGS )
+#define EINFO_EPROTO_SETTINGS \
+	__einfo_uniqify ( EINFO_EPROTO, 0x03, "Invalid setting" )
+#define EPROTO_FLOW __einfo_error ( EINFO_EPROTO_FLOW )
+#define EINFO_EPROTO_FLOW \
+	__einfo_uniqify ( EINFO_EPROTO, 0x04, "Invalid flow control window" )
+#define EPROTO_HEADERS __einfo_error ( EINFO_EPROTO_HEADERS )
+#define EINFO_EPROTO_HEADERS \
+	__einfo_uniqify ( EINFO_EPROTO, 0x05, "Invalid header block" )
+#define EPROTO_PUSH __einfo_error ( EINFO_EPROTO_PUSH )
+#define EINFO_EPROTO_PUSH \
+	__einfo_uniqify ( EINFO_EPROTO, 0x06, "Unsolicited server push" )
+#define ECONNRESET_STREAM __einfo_error ( EINFO_ECONNRESET_STREAM )
+#define EINFO_ECONNRESET_STREAM \
+	__einfo_uniqify ( EINFO_ECONNRESET, 0x01, "Stream reset by server" )
+#define ECONNRESET_GOAWAY __einfo_error ( EINFO_ECONNRESET_GOAWAY )
+#define EINFO_ECONNRESET_GOAWAY \
+	__einfo_uniqify ( EINFO_ECONNRESET, 0x02, "Stream refused by server" )
+#define ECONNRESET_CLOSED __einfo_error ( EINFO_ECONNRESET_CLOSED )
+#define EINFO_ECONNRESET_CLOSED \
+	__einfo_uniqify ( EINFO_ECONNRESET, 0x03, "Connection closed" )
+#define EINVAL_REQUEST __einfo_error ( EINFO_EINVAL_REQUEST )
+#define EINFO_EINVAL_REQUEST \
+	__einfo_uniqify ( EINFO_EINVAL, 0x01, "Invalid request" )
+
+/** HTTP/2 idle connection expiry time */
+#define HTTP2_IDLE_TIMEOUT ( 10 * TICKS_PER_SEC )
+
+/** HTTP/2 connections accepting new streams */
+static LIST_HEAD ( http2_connections );
+
+/** A parsed HTTP/1.1 request */
+struct http2_request {
+	/** Method */
+	const char *method;
+	/** Length of method */
+	size_t method_len;
+	/** Request target */
+	const char *path;
+	/** Length of request target */
+	size_t path_len;
+	/** Host (if any) */
+	const char *host;
+	/** Length of host */
+	size_t host_len;
+	/** Header lines (each terminated by CRLF) */
+	const char *headers;
+	/** Length of header lines */
+	size_t headers_len;
+	/** Length of request line and headers (including blank line) */
+	size_t len;
+};
+
+/** A response header translation context */
+struct http2_response {
+	/** Status code (or zero if not yet seen) */
+	unsigned int status;
+	/** Translated header lines, or NULL to discard headers */
+	char *headers;
+	/** Length of translated header lines */
+	size_t len;
+	/** Translation is required */
+	int translate;
+};
+
+/** HTTP/1.1 header fields that are not permitted in HTTP/2 */
+static const char *http2_excluded[] = {
+	"Host", "Connection", "Keep-Alive", "Proxy-Connection",
+	"Transfer-Encoding", "Upgrade", "TE",
+};
+
+/******************************************************************************
+ *
+ * Frame transmission
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Construct frame header
+ *
+ * @v hdr		Frame header to fill in
+ * @v type		Frame type
+ * @v flags		Flags
+ * @v id		Stream identifier
+ * @v len		Payload length
+ */
+static void http2_frame_header ( struct http2_frame_header *hdr,
+				 unsigned int type, unsigned int flags,
+				 uint32_t id, size_t len ) {
+
+	hdr->len[0] = ( len >> 16 );
+	hdr->len[1] = ( len >> 8 );
+	hdr->len[2] = ( len >> 0 );
+	hdr->type = type;
+	hdr->flags = flags;
+	hdr->stream = htonl ( id );
+}
+
+/**
+ * Transmit frame
+ *
+ * @v conn		HTTP/2 connection
+ * @v type		Frame type
+ * @v flags		Flags
+ * @v id		Stream identifier
+ * @v data		Payload
+ * @v len		Payload length
+ * @ret rc		Return status code
+ */
+static int http2_send ( struct http2_connection *conn, unsigned int type,
+			unsigned int flags, uint32_t id, const void *data,
+			size_t len ) {
+	struct http2_frame_header *hdr;
+	struct io_buffer *iobuf;
+
+	/* Allocate I/O buffer */
+	iobuf = xfer_alloc_iob ( &conn->socket, ( sizeof ( *hdr ) + len ) );
+	if ( ! iobuf )
+		return -ENOMEM;
+
+	/* Construct frame */
+	hdr = iob_put ( iobuf, sizeof ( *hdr ) );
+	http2_frame_header ( hdr, type, flags, id, len );
+	memcpy ( iob_put ( iobuf, len ), data, len );
+
+	/* Transmit frame */
+	return xfer_deliver_iob ( &conn->socket, iobuf );
+}
+
+/**
+ * Transmit RST_STREAM frame
+ *
+ * @v conn		HTTP/2 connection
+ * @v id		Stream identifier
+ * @v code		Error code
+ * @ret rc		Return status code
+ */
+static int http2_send_rst_stream ( struct http2_connection *conn,
+				   uint32_t id, unsigned int code ) {
+	struct http2_rst_stream rst;
+
+	rst.code = htonl ( code );
+	return http2_send ( conn, HTTP2_RST_STREAM, 0, id, &rst,
+			    sizeof ( rst ) );
+}
+
+/**
+ * Transmit GOAWAY frame
+ *
+ * @v conn		HTTP/2 connection
+ * @v code		Error code
+ * @ret rc		Return status code
+ */
+static int http2_send_goaway ( struct http2_connection *conn,
+			       unsigned int code ) {
+	struct http2_goaway goaway;
+
+	/* We never accept server-initiated streams */
+	goaway.last = htonl ( 0 );
+	goaway.code = htonl ( code );
+	return http2_send ( conn, HTTP2_GOAWAY, 0, 0, &goaway,
+			    sizeof ( goaway ) );
+}
+
+/**
+ * Transmit WINDOW_UPDATE frame
+ *
+ * @v conn		HTTP/2 connection
+ * @v id		Stream identifier (or zero for the connection)
+ * @v increment		Window size increment
+ * @ret rc		Return status code
+ */
+static int http2_send_window_update ( struct http2_connection *conn,
+				      uint32_t id, size_t increment ) {
+	struct http2_window_update update;
+
+	update.increment = htonl ( increment );
+	return http2_send ( conn, HTTP2_WINDOW_UPDATE, 0, id, &update,
+			    sizeof ( update ) );
+}
+
+/**
+ * Transmit connection preface
+ *
+ * @v conn		HTTP/2 connection
+ * @ret rc		Return status code
+ */
+static int http2_send_preface ( struct http2_connection *conn ) {
+	struct http2_setting settings[] = {
+		{
+			.id = htons ( HTTP2_SETTINGS_ENABLE_PUSH ),
+			.value = htonl ( 0 ),
+		},
+		{
+			.id = htons ( HTTP2_SETTINGS_INITIAL_WINDOW_SIZE ),
+			.value = htonl ( HTTP2_RX_WINDOW ),
+		},
+	};
+	size_t increment;
+	int rc;
+
+	/* Transmit fixed preface */
+	if ( ( rc = xfer_deliver_raw ( &conn->socket, HTTP2_PREFACE,
+				       ( sizeof ( HTTP2_PREFACE ) -
+					 1 /* NUL */ ) ) ) != 0 )
+		return rc;
+
+	/* Transmit settings */
+	if ( ( rc = http2_send ( conn, HTTP2_SETTINGS, 0, 0, settings,
+				 sizeof ( settings ) ) ) != 0 )
+		return rc;
+
+	/* Enlarge connection receive window */
+	increment = ( HTTP2_RX_CONN_WINDOW - HTTP2_DEFAULT_WINDOW );
+	if ( ( rc = http2_send_window_update ( conn, 0, increment ) ) != 0 )
+		return rc;
+
+	return 0;
+}
+
+/******************************************************************************
+ *
+ * Streams
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Free HTTP/2 stream
+ *
+ * @v refcnt		Reference count
+ */
+static void http2_stream_free ( struct refcnt *refcnt ) {
+	struct http2_stream *stream =
+		container_of ( refcnt, struct http2_stream, refcnt );
+
+	ref_put ( &stream->conn->refcnt );
+	free ( stream );
+}
+
+/**
+ * Find HTTP/2 stream
+ *
+ * @v conn		HTTP/2 connection
+ * @v id		Stream identifier
+ * @ret stream		HTTP/2 stream, or NULL if not found
+ */
+static struct http2_stream * http2_stream ( struct http2_connection *conn,
+					    uint32_t id ) {
+	struct http2_stream *stream;
+
+	list_for_each_entry ( stream, &conn->streams, list ) {
+		if ( ( stream->flags & HTTP2_STREAM_SENT ) &&
+		     ( stream->id == id ) )
+			return stream;
+	}
+	return NULL;
+}
+
+/**
+ * Count active HTTP/2 streams
+ *
+ * @v conn		HTTP/2 connection
+ * @ret count		Number of streams with requests transmitted
+ */
+static unsigned int http2_active ( struct http2_connection *conn ) {
+	struct http2_stream *stream;
+	unsigned int count = 0;
+
+	list_for_each_entry ( stream, &conn->streams, list ) {
+		if ( stream->flags & HTTP2_STREAM_SENT )
+			count++;
+	}
+	return count;
+}
+
+static void http2_close ( struct http2_connection *conn, int rc );
+
+/**
+ * Handle removal of HTTP/2 stream
+ *
+ * @v conn		HTTP/2 connection
+ */
+static void http2_idle ( struct http2_connection *conn ) {
+
+	/* Do nothing if connection is already closed */
+	if ( conn->flags & HTTP2_CONN_CLOSED )
+		return;
+
+	/* Allow any waiting streams to proceed */
+	if ( ! list_empty ( &conn->streams ) ) {
+		process_add ( &conn->process );
+		return;
+	}
+
+	/* Close connection if no further streams will be accepted */
+	if ( conn->flags & HTTP2_CONN_GOAWAY ) {
+		http2_close ( conn, 0 );
+		return;
+	}
+
+	/* Otherwise, start idle timer */
+	start_timer_fixed ( &conn->timer, HTTP2_IDLE_TIMEOUT );
+}
+
+/**
+ * Close HTTP/2 stream
+ *
+ * @v stream		HTTP/2 stream
+ * @v rc		Reason for close
+ */
+static void http2_stream_close ( struct http2_stream *stream, int rc ) {
+	struct http2_connection *conn = stream->conn;
+
+	/* Shut down interface */
+	intf_shutdown ( &stream->xfer, rc );
+
+	/* Do nothing more if already removed from the connection */
+	if ( list_empty ( &stream->list ) )
+		return;
+	list_del ( &stream->list );
+	INIT_LIST_HEAD ( &stream->list );
+
+	/* Reset stream if the server may still be sending data */
+	if ( ( stream->flags & HTTP2_STREAM_SENT ) &&
+	     ! ( stream->flags & HTTP2_STREAM_REMOTE_CLOSED ) ) {
+		http2_send_rst_stream ( conn, stream->id, HTTP2_CANCEL );
+	}
+
+	/* Record successful completion, to allow subsequent requests
+	 * to be reopened if the server closes the idle connection.
+	 */
+	if ( ( rc == 0 ) && ( stream->flags & HTTP2_STREAM_RESPONSE ) )
+		conn->flags |= HTTP2_CONN_REUSED;
+
+	/* Discard any untransmitted request content */
+	free_iob ( stream->tx_pending );
+	stream->tx_pending = NULL;
+	if ( rc == 0 ) {
+		DBGC2 ( conn, "HTTP2 %p stream %d closed\n", conn, stream->id );
+	} else {
+		DBGC ( conn, "HTTP2 %p stream %d closed: %s\n",
+		       conn, stream->id, strerror ( rc ) );
+	}
+
+	/* Update connection state */
+	http2_idle ( conn );
+
+	/* Drop connection's reference */
+	ref_put ( &stream->refcnt );
+}
+
+/**
+ * Close HTTP/2 stream and suggest that the client reopen it
+ *
+ * @v stream		HTTP/2 stream
+ * @v rc		Reason for close
+ */
+static void http2_stream_reopen ( struct http2_stream *stream, int rc ) {
+
+	/* Treat stream as closed by the server */
+	stream->flags |= HTTP2_STREAM_REMOTE_CLOSED;
+
+	/* Suggest that the client should reopen the connection, and
+	 * close the stream.
+	 */
+	pool_reopen ( &stream->xfer );
+	http2_stream_close ( stream, rc );
+}
+
+/**
+ * Transmit request content
+ *
+ * @v stream		HTTP/2 stream
+ * @ret rc		Return status code
+ */
+static int http2_stream_tx ( struct http2_stream *stream ) {
+	struct http2_connection *conn = stream->conn;
+	struct io_buffer *pending;
+	unsigned int flags;
+	int32_t window;
+	size_t len;
+	int rc;
+
+	/* Transmit as much as the flow control windows allow */
+	while ( ( pending = stream->tx_pending ) ) {
+
+		/* Calculate fragment length */
+		window = conn->tx_window;
+		if ( window > stream->tx_window )
+			window = stream->tx_window;
+		if ( window <= 0 )
+			return 0;
+		len = iob_len ( pending );
+		if ( len > ( ( size_t ) window ) )
+			len = window;
+		if ( len > conn->tx_frame_size )
+			len = conn->tx_frame_size;
+		flags = ( ( len == iob_len ( pending ) ) ?
+			  HTTP2_END_STREAM : 0 );
+
+		/* Transmit fragment */
+		if ( ( rc = http2_send ( conn, HTTP2_DATA, flags, stream->id,
+					 pending->data, len ) ) != 0 )
+			return rc;
+		iob_pull ( pending, len );
+		conn->tx_window -= len;
+		stream->tx_window -= len;
+
+		/* Record end of request */
+		if ( flags & HTTP2_END_STREAM ) {
+			free_iob ( pending );
+			stream->tx_pending = NULL;
+			stream->flags |= HTTP2_STREAM_LOCAL_CLOSED;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Check HTTP/2 stream transmit window
+ *
+ * @v stream		HTTP/2 stream
+ * @ret len		Length of window
+ */
+static size_t http2_stream_window ( struct http2_stream *stream ) {
+	struct http2_connection *conn = stream->conn;
+
+	/* Transmit only a single request */
+	if ( stream->flags & HTTP2_STREAM_SENT )
+		return 0;
+
+	/* Wait until the server permits another concurrent stream */
+	if ( http2_active ( conn ) >= conn->max_streams )
+		return 0;
+
+	return xfer_window ( &conn->socket );
+}
+
+/**
+ * Get next line of HTTP/1.1 request
+ *
+ * @v data		Data pointer to update
+ * @v remaining		Remaining length to update
+ * @v len		Length of line (excluding CRLF) to fill in
+ * @ret line		Start of line, or NULL if no complete line exists
+ */
+static const char * http2_line ( const char **data, size_t *remaining,
+				 size_t *len ) {
+	const char *line = *data;
+	size_t i;
+
+	for ( i = 1 ; i < *remaining ; i++ ) {
+		if ( ( line[ i - 1 ] == '\r' ) && ( line[i] == '\n' ) ) {
+			*len = ( i - 1 );
+			*data += ( i + 1 );
+			*remaining -= ( i + 1 );
+			return line;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Split HTTP/1.1 header line into name and value
+ *
+ * @v line		Header line (excluding CRLF)
+ * @v len		Length of header line
+ * @v name_len		Length of name to fill in
+ * @v value		Value to fill in
+ * @v value_len		Length of value to fill in
+ * @ret rc		Return status code
+ */
+static int http2_split ( const char *line, size_t len, size_t *name_len,
+			 const char **value, size_t *value_len ) {
+	const char *sep;
+	const char *end = ( line + len );
+
+	/* Locate separator */
+	sep = memchr ( line, ':', len );
+	if ( ( ! sep ) || ( sep == line ) )
+		return -EINVAL_REQUEST;
+	*name_len = ( sep - line );
+
+	/* Strip surrounding whitespace from value */
+	*value = ( sep + 1 );
+	while ( ( *value < end ) && ( **value == ' ' ) )
+		(*value)++;
+	while ( ( end > *value ) && ( end[-1] == ' ' ) )
+		end--;
+	*value_len = ( end - *value );
+
+	return 0;
+}
+
+/**
+ * Parse HTTP/1.1 request
+ *
+ * @v data		Request
+ * @v len		Length of request
+ * @v request		Parsed request to fill in
+ * @ret rc		Return status code
+ */
+static int http2_parse_request ( const char *data, size_t len,
+				 struct http2_request *request ) {
+	const char *start = data;
+	const char *line;
+	const char *sep;
+	const char *value;
+	size_t line_len;
+	size_t name_len;
+	size_t value_len;
+	int rc;
+
+	/* Parse request line */
+	memset ( request, 0, sizeof ( *request ) );
+	line = http2_line ( &data, &len, &line_len );
+	if ( ! line )
+		return -EINVAL_REQUEST;
+	sep = memchr ( line, ' ', line_len );
+	if ( ! sep )
+		return -EINVAL_REQUEST;
+	request->method = line;
+	request->method_len = ( sep - line );
+	request->path = ( sep + 1 );
+	sep = memchr ( request->path, ' ',
+		       ( line_len - request->method_len - 1 ) );
+	if ( ! sep )
+		return -EINVAL_REQUEST;
+	request->path_len = ( sep - request->path );
+
+	/* Parse header lines */
+	request->headers = data;
+	while ( ( line = http2_line ( &data, &len, &line_len ) ) ) {
+
+		/* Stop at end of headers */
+		if ( ! line_len ) {
+			request->len = ( data - start );
+			return 0;
+		}
+
+		/* Record host, if applicable */
+		if ( ( rc = http2_split ( line, line_len, &name_len, &value,
+					  &value_len ) ) != 0 )
+			return rc;
+		if ( ( name_len == 4 ) &&
+		     ( strncasecmp ( line, "Host", name_len ) == 0 ) ) {
+			request->host = value;
+			request->host_len = value_len;
+		}
+		request->headers_len = ( data - request->headers );
+	}
+
+	return -EINVAL_REQUEST;
+}
+
+/**
+ * Encode HTTP/2 request header block
+ *
+ * @v conn		HTTP/2 connection
+ * @v request		Parsed request
+ * @v data		Buffer, or NULL to calculate length
+ * @ret len		Length of header block
+ */
+static size_t http2_encode_request ( struct http2_connection *conn,
+				     struct http2_request *request,
+				     void *data ) {
+	const char *scheme = conn->scheme->name;
+	const char *headers = request->headers;
+	size_t remaining = request->headers_len;
+	const char *line;
+	const char *value;
+	size_t line_len;
+	size_t name_len;
+	size_t value_len;
+	size_t len = 0;
+	unsigned int i;
+
+	/* Encode pseudo-header fields */
+	len += hpack_encode ( ( data ? ( data + len ) : NULL ), ":method", 7,
+			      request->method, request->method_len );
+	len += hpack_encode ( ( data ? ( data + len ) : NULL ), ":scheme", 7,
+			      scheme, strlen ( scheme ) );
+	if ( request->host ) {
+		len += hpack_encode ( ( data ? ( data + len ) : NULL ),
+				      ":authority", 10, request->host,
+				      request->host_len );
+	}
+	len += hpack_encode ( ( data ? ( data + len ) : NULL ), ":path", 5,
+			      request->path, request->path_len );
+
+	/* Encode header fields */
+	while ( ( line = http2_line ( &headers, &remaining, &line_len ) ) ) {
+
+		/* Split header line (already validated) */
+		http2_split ( line, line_len, &name_len, &value, &value_len );
+
+		/* Skip connection-specific header fields */
+		for ( i = 0 ; i < ( sizeof ( http2_excluded ) /
+				    sizeof ( http2_excluded[0] ) ) ; i++ ) {
+			if ( ( strlen ( http2_excluded[i] ) == name_len ) &&
+			     ( strncasecmp ( http2_excluded[i], line,
+					     name_len ) == 0 ) )
+				break;
+		}
+		if ( i < ( sizeof ( http2_excluded ) /
+			   sizeof ( http2_excluded[0] ) ) )
+			continue;
+
+		/* Encode header field */
+		len += hpack_encode ( ( data ? ( data + len ) : NULL ),
+				      line, name_len, value, value_len );
+	}
+
+	return len;
+}
+
+/**
+ * Transmit request header block
+ *
+ * @v conn		HTTP/2 connection
+ * @v id		Stream identifier
+ * @v block		Header block
+ * @v len		Length of header block
+ * @v flags		Flags for HEADERS frame
+ * @ret rc		Return status code
+ */
+static int http2_send_headers ( struct http2_connection *conn, uint32_t id,
+				const void *block, size_t len,
+				unsigned int flags ) {
+	unsigned int type = HTTP2_HEADERS;
+	size_t frag_len;
+	int rc;
+
+	/* Split header block into HEADERS and CONTINUATION frames */
+	do {
+		frag_len = len;
+		if ( frag_len > conn->tx_frame_size )
+			frag_len = conn->tx_frame_size;
+		if ( frag_len == len )
+			flags |= HTTP2_END_HEADERS;
+		if ( ( rc = http2_send ( conn, type, flags, id, block,
+					 frag_len ) ) != 0 )
+			return rc;
+		block += frag_len;
+		len -= frag_len;
+		type = HTTP2_CONTINUATION;
+		flags = 0;
+	} while ( len );
+
+	return 0;
+}
+
+/**
+ * Transmit request on HTTP/2 stream
+ *
+ * @v stream		HTTP/2 stream
+ * @v iobuf		I/O buffer
+ * @v meta		Transfer metadata
+ * @ret rc		Return status code
+ */
+static int http2_stream_deliver ( struct http2_stream *stream,
+				  struct io_buffer *iobuf,
+				  struct xfer_metadata *meta __unused ) {
+	struct http2_connection *conn = stream->conn;
+	struct http2_request request;
+	unsigned int flags;
+	void *block;
+	size_t len;
+	int rc;
+
+	/* Sanity check */
+	if ( stream->flags & HTTP2_STREAM_SENT ) {
+		rc = -EPIPE;
+		goto err_sent;
+	}
+
+	/* Parse request */
+	if ( ( rc = http2_parse_request ( iobuf->data, iob_len ( iobuf ),
+					  &request ) ) != 0 ) {
+		DBGC ( conn, "HTTP2 %p could not parse request:\n", conn );
+		DBGC_HDA ( conn, 0, iobuf->data, iob_len ( iobuf ) );
+		goto err_parse;
+	}
+
+	/* Allocate stream identifier */
+	if ( conn->next_id > HTTP2_STREAM_MASK ) {
+		rc = -ENOSPC;
+		goto err_id;
+	}
+	stream->id = conn->next_id;
+	conn->next_id += 2;
+	stream->flags |= HTTP2_STREAM_SENT;
+
+	/* Construct header block */
+	len = http2_encode_request ( conn, &request, NULL );
+	block = malloc ( len );
+	if ( ! block ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	http2_encode_request ( conn, &request, block );
+	iob_pull ( iobuf, request.len );
+	DBGC2 ( conn, "HTTP2 %p stream %d %.*s %.*s\n", conn, stream->id,
+		( ( int ) request.method_len ), request.method,
+		( ( int ) request.path_len ), request.path );
+
+	/* Transmit header block */
+	flags = ( iob_len ( iobuf ) ? 0 : HTTP2_END_STREAM );
+	if ( ( rc = http2_send_headers ( conn, stream->id, block, len,
+					 flags ) ) != 0 )
+		goto err_send;
+
+	/* Transmit any request content */
+	if ( flags & HTTP2_END_STREAM ) {
+		stream->flags |= HTTP2_STREAM_LOCAL_CLOSED;
+		free_iob ( iobuf );
+	} else {
+		stream->tx_pending = iob_disown ( iobuf );
+		if ( ( rc = http2_stream_tx ( stream ) ) != 0 )
+			goto err_tx;
+	}
+
+	free ( block );
+	return 0;
+
+ err_tx:
+ err_send:
+	free ( block );
+ err_alloc:
+ err_id:
+ err_parse:
+ err_sent:
+	free_iob ( iobuf );
+	return rc;
+}
+
+/** HTTP/2 stream data transfer interface operations */
+static struct interface_operation http2_stream_xfer_operations[] = {
+	INTF_OP ( xfer_window, struct http2_stream *, http2_stream_window ),
+	INTF_OP ( xfer_deliver, struct http2_stream *, http2_stream_deliver ),
+	INTF_OP ( intf_close, struct http2_stream *, http2_stream_close ),
+};
+
+/** HTTP/2 stream data transfer interface descriptor */
+static struct interface_descriptor http2_stream_xfer_desc =
+	INTF_DESC ( struct http2_stream, xfer, http2_stream_xfer_operations );
+
+/**
+ * Open HTTP/2 stream
+ *
+ * @v conn		HTTP/2 connection
+ * @v xfer		Data transfer interface
+ * @ret rc		Return status code
+ */
+static int http2_stream_open ( struct http2_connection *conn,
+			       struct interface *xfer ) {
+	struct http2_stream *stream;
+
+	/* Allocate and initialise structure */
+	stream = zalloc ( sizeof ( *stream ) );
+	if ( ! stream )
+		return -ENOMEM;
+	ref_init ( &stream->refcnt, http2_stream_free );
+	intf_init ( &stream->xfer, &http2_stream_xfer_desc, &stream->refcnt );
+	ref_get ( &conn->refcnt );
+	stream->conn = conn;
+	stream->tx_window = conn->tx_initial;
+
+	/* Add to connection (which takes ownership of our reference)
+	 * and attach to parent interface.
+	 */
+	list_add_tail ( &stream->list, &conn->streams );
+	intf_plug_plug ( &stream->xfer, xfer );
+
+	/* Stop idle timer and schedule notification of the new stream */
+	stop_timer ( &conn->timer );
+	process_add ( &conn->process );
+
+	DBGC2 ( conn, "HTTP2 %p opened stream %p\n", conn, stream );
+	return 0;
+}
+
+/******************************************************************************
+ *
+ * Frame reception
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Handle connection error
+ *
+ * @v conn		HTTP/2 connection
+ * @v code		HTTP/2 error code
+ * @v rc		Reason for close
+ * @ret rc		Reason for close
+ */
+static int http2_error ( struct http2_connection *conn, unsigned int code,
+			 int rc ) {
+
+	DBGC ( conn, "HTTP2 %p connection error %d: %s\n",
+	       conn, code, strerror ( rc ) );
+	http2_send_goaway ( conn, code );
+	http2_close ( conn, rc );
+	return rc;
+}
+
+/**
+ * Receive response content
+ *
+ * @v conn		HTTP/2 connection
+ * @v id		Stream identifier
+ * @v iobuf		I/O buffer, or NULL
+ * @v end		Content ends the stream
+ * @ret rc		Return status code
+ */
+static int http2_rx_content ( struct http2_connection *conn, uint32_t id,
+			      struct io_buffer *iobuf, int end ) {
+	struct http2_stream *stream;
+
+	/* Discard data for closed streams */
+	stream = http2_stream ( conn, id );
+	if ( ( ! stream ) || ( stream->flags & HTTP2_STREAM_REMOTE_CLOSED ) ) {
+		free_iob ( iobuf );
+		return 0;
+	}
+
+	/* Reject content before response headers */
+	if ( ! ( stream->flags & HTTP2_STREAM_RESPONSE ) ) {
+		DBGC ( conn, "HTTP2 %p stream %d data before headers\n",
+		       conn, id );
+		free_iob ( iobuf );
+		return http2_error ( conn, HTTP2_PROTOCOL_ERROR,
+				     -EPROTO_FRAME );
+	}
+
+	/* Pass on to data transfer interface.  Any error will be
+	 * handled by the client closing the stream.
+	 */
+	ref_get ( &stream->refcnt );
+	if ( end )
+		stream->flags |= HTTP2_STREAM_REMOTE_CLOSED;
+	if ( iobuf )
+		xfer_deliver_iob ( &stream->xfer, iobuf );
+	if ( end )
+		http2_stream_close ( stream, 0 );
+	ref_put ( &stream->refcnt );
+
+	return 0;
+}
+
+/**
+ * Account for received DATA frame
+ *
+ * @v conn		HTTP/2 connection
+ * @ret rc		Return status code
+ */
+static int http2_rx_window ( struct http2_connection *conn ) {
+	struct http2_frame_header *hdr = &conn->rx_header;
+	uint32_t id = ( ntohl ( hdr->stream ) & HTTP2_STREAM_MASK );
+	struct http2_stream *stream;
+	int rc;
+
+	/* Update connection window */
+	conn->rx_consumed += conn->rx_len;
+	if ( conn->rx_consumed >= ( HTTP2_RX_CONN_WINDOW / 2 ) ) {
+		if ( ( rc = http2_send_window_update ( conn, 0,
+						conn->rx_consumed ) ) != 0 )
+			return rc;
+		conn->rx_consumed = 0;
+	}
+
+	/* Update stream window, if stream remains open */
+	stream = http2_stream ( conn, id );
+	if ( ( ! stream ) || ( hdr->flags & HTTP2_END_STREAM ) )
+		return 0;
+	stream->rx_consumed += conn->rx_len;
+	if ( stream->rx_consumed >= ( HTTP2_RX_WINDOW / 2 ) ) {
+		if ( ( rc = http2_send_window_update ( conn, id,
+						stream->rx_consumed ) ) != 0 )
+			return rc;
+		stream->rx_consumed = 0;
+	}
+
+	return 0;
+}
+
+/**
+ * Receive padded DATA frame
+ *
+ * @v conn		HTTP/2 connection
+ * @v id		Stream identifier
+ * @v data		Payload
+ * @v len		Length of payload
+ * @ret rc		Return status code
+ */
+static int http2_rx_data ( struct http2_connection *conn, uint32_t id,
+			   const uint8_t *data, size_t len ) {
+	struct http2_frame_header *hdr = &conn->rx_header;
+	struct io_buffer *iobuf;
+	size_t pad_len;
+
+	/* Strip padding */
+	pad_len = data[0];
+	if ( ( pad_len + 1 ) > len ) {
+		DBGC ( conn, "HTTP2 %p invalid DATA padding\n", conn );
+		return http2_error ( conn, HTTP2_PROTOCOL_ERROR,
+				     -EPROTO_FRAME );
+	}
+	len -= ( pad_len + 1 );
+
+	/* Copy content to new I/O buffer */
+	iobuf = alloc_iob ( len );
+	if ( ! iobuf )
+		return -ENOMEM;
+	memcpy ( iob_put ( iobuf, len ), ( data + 1 ), len );
+
+	return http2_rx_content ( conn, id, iobuf,
+				  ( hdr->flags & HTTP2_END_STREAM ) );
+}
+
+/**
+ * Translate response header field
+ *
+ * @v opaque		Response header translation context
+ * @v name		Name
+ * @v value		Value
+ * @ret rc		Return status code
+ */
+static int http2_rx_header ( void *opaque, const char *name,
+			     const char *value ) {
+	struct http2_response *response = opaque;
+	char *headers;
+	size_t len;
+
+	/* Do nothing unless translation is required */
+	if ( ! response->translate )
+		return 0;
+
+	/* Handle pseudo-header fields */
+	if ( name[0] == ':' ) {
+		if ( strcmp ( name, ":status" ) == 0 )
+			response->status = strtoul ( value, NULL, 10 );
+		return 0;
+	}
+
+	/* Append header line */
+	len = ( strlen ( name ) + 2 /* ": " */ + strlen ( value ) +
+		2 /* "\r\n" */ );
+	headers = realloc ( response->headers,
+			    ( response->len + len + 1 /* NUL */ ) );
+	if ( ! headers )
+		return -ENOMEM;
+	response->headers = headers;
+	snprintf ( ( headers + response->len ), ( len + 1 ), "%s: %s\r\n",
+		   name, value );
+	response->len += len;
+
+	return 0;
+}
+
+/**
+ * Receive complete header block
+ *
+ * @v conn		HTTP/2 connection
+ * @ret rc		Return status code
+ */
+static int http2_rx_headers ( struct http2_connection *conn ) {
+	uint32_t id = conn->block_stream;
+	int end = ( conn->block_flags & HTTP2_END_STREAM );
+	struct http2_response response;
+	struct http2_stream *stream;
+	struct io_buffer *iobuf;
+	size_t len;
+	int rc;
+
+	/* Identify stream (if still open) */
+	stream = http2_stream ( conn, id );
+	if ( stream && ( stream->flags & HTTP2_STREAM_REMOTE_CLOSED ) )
+		stream = NULL;
+
+	/* Decode header block.  This must be done even for closed
+	 * streams, in order to maintain the dynamic table.
+	 */
+	memset ( &response, 0, sizeof ( response ) );
+	response.translate =
+		( stream && ! ( stream->flags & HTTP2_STREAM_RESPONSE ) );
+	rc = hpack_decode ( &conn->hpack, conn->block, conn->block_len,
+			    http2_rx_header, &response );
+	free ( conn->block );
+	conn->block = NULL;
+	conn->block_len = 0;
+	conn->block_stream = 0;
+	if ( rc != 0 ) {
+		DBGC ( conn, "HTTP2 %p stream %d could not decode headers: "
+		       "%s\n", conn, id, strerror ( rc ) );
+		free ( response.headers );
+		return http2_error ( conn, HTTP2_COMPRESSION_ERROR, rc );
+	}
+
+	/* Do nothing more unless stream is open */
+	if ( ! stream ) {
+		free ( response.headers );
+		return 0;
+	}
+
+	/* Translate final response headers */
+	if ( response.translate ) {
+
+		/* Check status code */
+		if ( ! response.status ) {
+			DBGC ( conn, "HTTP2 %p stream %d missing status\n",
+			       conn, id );
+			free ( response.headers );
+			http2_send_rst_stream ( conn, id,
+						HTTP2_PROTOCOL_ERROR );
+			stream->flags |= HTTP2_STREAM_REMOTE_CLOSED;
+			http2_stream_close ( stream, -EPROTO_HEADERS );
+			return 0;
+		}
+
+		/* Ignore informational responses */
+		if ( ( response.status < 200 ) && ! end ) {
+			DBGC2 ( conn, "HTTP2 %p stream %d status %d\n",
+				conn, id, response.status );
+			free ( response.headers );
+			return 0;
+		}
+
+		/* Construct HTTP/1.1 response headers */
+		len = snprintf ( NULL, 0, "HTTP/2 %d \r\n", response.status );
+		iobuf = alloc_iob ( len + 1 /* NUL */ + response.len +
+				    2 /* "\r\n" */ );
+		if ( ! iobuf ) {
+			free ( response.headers );
+			return -ENOMEM;
+		}
+		snprintf ( iob_put ( iobuf, len ), ( len + 1 /* NUL */ ),
+			   "HTTP/2 %d \r\n", response.status );
+		memcpy ( iob_put ( iobuf, response.len ), response.headers,
+			 response.len );
+		memcpy ( iob_put ( iobuf, 2 ), "\r\n", 2 );
+		free ( response.headers );
+		DBGC2 ( conn, "HTTP2 %p stream %d status %d\n",
+			conn, id, response.status );
+
+		/* Pass on to data transfer interface */
+		stream->flags |= HTTP2_STREAM_RESPONSE;
+		if ( ( rc = http2_rx_content ( conn, id, iobuf, 0 ) ) != 0 )
+			return rc;
+	}
+
+	/* Handle end of stream (with or without trailers) */
+	stream = http2_stream ( conn, id );
+	if ( end && stream ) {
+		stream->flags |= HTTP2_STREAM_REMOTE_CLOSED;
+		http2_stream_close ( stream, 0 );
+	}
+
+	return 0;
+}
+
+/**
+ * Receive header block fragment
+ *
+ * @v conn		HTTP/2 connection
+ * @v data		Header block fragment
+ * @v len		Length of header block fragment
+ * @ret rc		Return status code
+ */
+static int http2_rx_fragment ( struct http2_connection *conn,
+			       const void *data, size_t len ) {
+	struct http2_frame_header *hdr = &conn->rx_header;
+	void *block;
+
+	/* Check length */
+	if ( ( conn->block_len + len ) > HTTP2_MAX_HEADER_BLOCK ) {
+		DBGC ( conn, "HTTP2 %p header block too long\n", conn );
+		return http2_error ( conn, HTTP2_INTERNAL_ERROR,
+				     -EPROTO_HEADERS );
+	}
+
+	/* Append fragment */
+	block = realloc ( conn->block, ( conn->block_len + len ) );
+	if ( ( ! block ) && ( conn->block_len + len ) )
+		return -ENOMEM;
+	conn->block = block;
+	memcpy ( ( block + conn->block_len ), data, len );
+	conn->block_len += len;
+
+	/* Process header block once complete */
+	if ( hdr->flags & HTTP2_END_HEADERS )
+		return http2_rx_headers ( conn );
+
+	return 0;
+}
+
+/**
+ * Receive HEADERS frame
+ *
+ * @v conn		HTTP/2 connection
+ * @v id		Stream identifier
+ * @v data		Payload
+ * @v len		Length of payload
+ * @ret rc		Return status code
+ */
+static int http2_rx_headers_frame ( struct http2_connection *conn,
+				    uint32_t id, const uint8_t *data,
+				    size_t len ) {
+	struct http2_frame_header *hdr = &conn->rx_header;
+	size_t pad_len = 0;
+
+	/* Check stream identifier */
+	if ( ! id ) {
+		DBGC ( conn, "HTTP2 %p HEADERS without stream\n", conn );
+		return http2_error ( conn, HTTP2_PROTOCOL_ERROR,
+				     -EPROTO_FRAME );
+	}
+
+	/* Strip padding and priority information */
+	if ( hdr->flags & HTTP2_PADDED ) {
+		if ( ! len )
+			goto err_len;
+		pad_len = data[0];
+		data++;
+		len--;
+	}
+	if ( hdr->flags & HTTP2_PRIORITY_INFO ) {
+		if ( len < HTTP2_PRIORITY_LEN )
+			goto err_len;
+		data += HTTP2_PRIORITY_LEN;
+		len -= HTTP2_PRIORITY_LEN;
+	}
+	if ( pad_len > len )
+		goto err_len;
+	len -= pad_len;
+
+	/* Start header block */
+	conn->block_stream = id;
+	conn->block_flags = hdr->flags;
+	return http2_rx_fragment ( conn, data, len );
+
+ err_len:
+	DBGC ( conn, "HTTP2 %p invalid HEADERS padding\n", conn );
+	return http2_error ( conn, HTTP2_PROTOCOL_ERROR, -EPROTO_FRAME );
+}
+
+/**
+ * Receive RST_STREAM frame
+ *
+ * @v conn		HTTP/2 connection
+ * @v id		Stream identifier
+ * @v data		Payload
+ * @v len		Length of payload
+ * @ret rc		Return status code
+ */
+static int http2_rx_rst_stream ( struct http2_connection *conn, uint32_t id,
+				 const void *data, size_t len ) {
+	const struct http2_rst_stream *rst = data;
+	struct http2_stream *stream;
+	unsigned int code;
+
+	/* Check length */
+	if ( len != sizeof ( *rst ) ) {
+		return http2_error ( conn, HTTP2_FRAME_SIZE_ERROR,
+				     -EPROTO_FRAME_SIZE );
+	}
+	code = ntohl ( rst->code );
+
+	/* Ignore resets for closed streams */
+	stream = http2_stream ( conn, id );
+	if ( ! stream )
+		return 0;
+	DBGC ( conn, "HTTP2 %p stream %d reset with error %d\n",
+	       conn, id, code );
+
+	/* Reopen refused streams, otherwise fail the stream */
+	if ( ( code == HTTP2_REFUSED_STREAM ) &&
+	     ! ( stream->flags & HTTP2_STREAM_RESPONSE ) ) {
+		http2_stream_reopen ( stream, -ECONNRESET_STREAM );
+	} else {
+		stream->flags |= HTTP2_STREAM_REMOTE_CLOSED;
+		http2_stream_close ( stream, -ECONNRESET_STREAM );
+	}
+
+	return 0;
+}
+
+/**
+ * Receive SETTINGS frame
+ *
+ * @v conn		HTTP/2 connection
+ * @v data		Payload
+ * @v len		Length of payload
+ * @ret rc		Return status code
+ */
+static int http2_rx_settings ( struct http2_connection *conn,
+			       const void *data, size_t len ) {
+	struct http2_frame_header *hdr = &conn->rx_header;
+	const struct http2_setting *setting = data;
+	struct http2_stream *stream;
+	unsigned int id;
+	uint32_t value;
+	int32_t delta;
+	int rc;
+
+	/* Ignore acknowledgements */
+	if ( hdr->flags & HTTP2_ACK )
+		return 0;
+
+	/* Check length */
+	if ( len % sizeof ( *setting ) ) {
+		return http2_error ( conn, HTTP2_FRAME_SIZE_ERROR,
+				     -EPROTO_FRAME_SIZE );
+	}
+
+	/* Apply settings */
+	for ( ; len ; setting++, len -= sizeof ( *setting ) ) {
+		id = ntohs ( setting->id );
+		value = ntohl ( setting->value );
+		DBGC2 ( conn, "HTTP2 %p setting %d = %d\n", conn, id, value );
+		switch ( id ) {
+		case HTTP2_SETTINGS_MAX_CONCURRENT_STREAMS:
+			conn->max_streams = value;
+			if ( conn->max_streams > HTTP2_MAX_STREAMS )
+				conn->max_streams = HTTP2_MAX_STREAMS;
+			break;
+		case HTTP2_SETTINGS_INITIAL_WINDOW_SIZE:
+			if ( value > HTTP2_MAX_WINDOW ) {
+				return http2_error ( conn,
+						     HTTP2_FLOW_CONTROL_ERROR,
+						     -EPROTO_FLOW );
+			}
+			delta = ( value - conn->tx_initial );
+			list_for_each_entry ( stream, &conn->streams, list )
+				stream->tx_window += delta;
+			conn->tx_initial = value;
+			break;
+		case HTTP2_SETTINGS_MAX_FRAME_SIZE:
+			if ( ( value < HTTP2_DEFAULT_FRAME_SIZE ) ||
+			     ( value > HTTP2_MAX_FRAME_SIZE ) ) {
+				return http2_error ( conn,
+						     HTTP2_PROTOCOL_ERROR,
+						     -EPROTO_SETTINGS );
+			}
+			conn->tx_frame_size = value;
+			break;
+		default:
+			/* Other settings are irrelevant to a client
+			 * that never adds to the server's dynamic table
+			 * and has disabled server push.
+			 */
+			break;
+		}
+	}
+
+	/* Acknowledge settings */
+	if ( ( rc = http2_send ( conn, HTTP2_SETTINGS, HTTP2_ACK, 0,
+				 NULL, 0 ) ) != 0 )
+		return rc;
+
+	/* Allow waiting streams to proceed */
+	process_add ( &conn->process );
+
+	return 0;
+}
+
+/**
+ * Receive PING frame
+ *
+ * @v conn		HTTP/2 connection
+ * @v data		Payload
+ * @v len		Length of payload
+ * @ret rc		Return status code
+ */
+static int http2_rx_ping ( struct http2_connection *conn, const void *data,
+			   size_t len ) {
+	struct http2_frame_header *hdr = &conn->rx_header;
+
+	/* Check length */
+	if ( len != HTTP2_PING_LEN ) {
+		return http2_error ( conn, HTTP2_FRAME_SIZE_ERROR,
+				     -EPROTO_FRAME_SIZE );
+	}
+
+	/* Ignore acknowledgements */
+	if ( hdr->flags & HTTP2_ACK )
+		return 0;
+
+	/* Acknowledge ping */
+	return http2_send ( conn, HTTP2_PING, HTTP2_ACK, 0, data, len );
+}
+
+/**
+ * Receive GOAWAY frame
+ *
+ * @v conn		HTTP/2 connection
+ * @v data		Payload
+ * @v len		Length of payload
+ * @ret rc		Return status code
+ */
+static int http2_rx_goaway ( struct http2_connection *conn, const void *data,
+			     size_t len ) {
+	const struct http2_goaway *goaway = data;
+	struct http2_stream *stream;
+	struct http2_stream *tmp;
+	uint32_t last;
+	unsigned int code;
+
+	/* Check length */
+	if ( len < sizeof ( *goaway ) ) {
+		return http2_error ( conn, HTTP2_FRAME_SIZE_ERROR,
+				     -EPROTO_FRAME_SIZE );
+	}
+	last = ( ntohl ( goaway->last ) & HTTP2_STREAM_MASK );
+	code = ntohl ( goaway->code );
+	DBGC ( conn, "HTTP2 %p GOAWAY after stream %d with error %d\n",
+	       conn, last, code );
+
+	/* Stop accepting new streams */
+	list_del ( &conn->list );
+	INIT_LIST_HEAD ( &conn->list );
+	conn->flags |= HTTP2_CONN_GOAWAY;
+
+	/* Reopen any streams that will not be processed */
+	ref_get ( &conn->refcnt );
+	list_for_each_entry_safe ( stream, tmp, &conn->streams, list ) {
+		if ( ( ! ( stream->flags & HTTP2_STREAM_SENT ) ) ||
+		     ( stream->id > last ) ) {
+			http2_stream_reopen ( stream, -ECONNRESET_GOAWAY );
+		}
+	}
+
+	/* Close connection if no streams remain */
+	if ( list_empty ( &conn->streams ) )
+		http2_close ( conn, 0 );
+	ref_put ( &conn->refcnt );
+
+	return 0;
+}
+
+/**
+ * Receive WINDOW_UPDATE frame
+ *
+ * @v conn		HTTP/2 connection
+ * @v id		Stream identifier
+ * @v data		Payload
+ * @v len		Length of payload
+ * @ret rc		Return status code
+ */
+static int http2_rx_window_update ( struct http2_connection *conn,
+				    uint32_t id, const void *data,
+				    size_t len ) {
+	const struct http2_window_update *update = data;
+	struct http2_stream *stream;
+	int32_t *window;
+	uint32_t increment;
+
+	/* Check length */
+	if ( len != sizeof ( *update ) ) {
+		return http2_error ( conn, HTTP2_FRAME_SIZE_ERROR,
+				     -EPROTO_FRAME_SIZE );
+	}
+	increment = ( ntohl ( update->increment ) & HTTP2_MAX_WINDOW );
+	if ( ! increment ) {
+		return http2_error ( conn, HTTP2_PROTOCOL_ERROR,
+				     -EPROTO_FLOW );
+	}
+
+	/* Identify window */
+	if ( id ) {
+		stream = http2_stream ( conn, id );
+		if ( ! stream )
+			return 0;
+		window = &stream->tx_window;
+	} else {
+		window = &conn->tx_window;
+	}
+
+	/* Update window */
+	if ( ( ( int64_t ) *window + increment ) > HTTP2_MAX_WINDOW ) {
+		return http2_error ( conn, HTTP2_FLOW_CONTROL_ERROR,
+				     -EPROTO_FLOW );
+	}
+	*window += increment;
+
+	/* Resume transmission of any pending request content */
+	process_add ( &conn->process );
+
+	return 0;
+}
+
+/**
+ * Receive complete frame
+ *
+ * @v conn		HTTP/2 connection
+ * @ret rc		Return status code
+ */
+static int http2_rx_frame ( struct http2_connection *conn ) {
+	struct http2_frame_header *hdr = &conn->rx_header;
+	uint32_t id = ( ntohl ( hdr->stream ) & HTTP2_STREAM_MASK );
+	const uint8_t *data = conn->rx_payload;
+	size_t len = conn->rx_len;
+
+	switch ( hdr->type ) {
+	case HTTP2_DATA:
+		return http2_rx_data ( conn, id, data, len );
+	case HTTP2_HEADERS:
+		return http2_rx_headers_frame ( conn, id, data, len );
+	case HTTP2_CONTINUATION:
+		return http2_rx_fragment ( conn, data, len );
+	case HTTP2_RST_STREAM:
+		return http2_rx_rst_stream ( conn, id, data, len );
+	case HTTP2_SETTINGS:
+		return http2_rx_settings ( conn, data, len );
+	case HTTP2_PING:
+		return http2_rx_ping ( conn, data, len );
+	case HTTP2_GOAWAY:
+		return http2_rx_goaway ( conn, data, len );
+	case HTTP2_WINDOW_UPDATE:
+		return http2_rx_window_update ( conn, id, data, len );
+	case HTTP2_PUSH_PROMISE:
+		DBGC ( conn, "HTTP2 %p unsolicited PUSH_PROMISE\n", conn );
+		return http2_error ( conn, HTTP2_PROTOCOL_ERROR,
+				     -EPROTO_PUSH );
+	default:
+		/* Ignore PRIORITY and unknown frame types */
+		return 0;
+	}
+}
+
+/**
+ * Receive complete frame header
+ *
+ * @v conn		HTTP/2 connection
+ * @ret rc		Return status code
+ */
+static int http2_rx_frame_header ( struct http2_connection *conn ) {
+	struct http2_frame_header *hdr = &conn->rx_header;
+	uint32_t id = ( ntohl ( hdr->stream ) & HTTP2_STREAM_MASK );
+	int rc;
+
+	/* Parse frame header */
+	conn->rx_len = ( ( hdr->len[0] << 16 ) | ( hdr->len[1] << 8 ) |
+			 ( hdr->len[2] << 0 ) );
+	conn->rx_remaining = conn->rx_len;
+	conn->flags &= ~HTTP2_CONN_RX_DATA;
+
+	/* Check length against our (default) maximum frame size */
+	if ( conn->rx_len > sizeof ( conn->rx_payload ) ) {
+		DBGC ( conn, "HTTP2 %p frame too large (%zd bytes)\n",
+		       conn, conn->rx_len );
+		return http2_error ( conn, HTTP2_FRAME_SIZE_ERROR,
+				     -EPROTO_FRAME_SIZE );
+	}
+
+	/* A header block may not be interrupted */
+	if ( conn->block_stream &&
+	     ( ( hdr->type != HTTP2_CONTINUATION ) ||
+	       ( id != conn->block_stream ) ) ) {
+		DBGC ( conn, "HTTP2 %p interrupted header block\n", conn );
+		return http2_error ( conn, HTTP2_PROTOCOL_ERROR,
+				     -EPROTO_HEADERS );
+	}
+	if ( ( hdr->type == HTTP2_CONTINUATION ) && ! conn->block_stream ) {
+		DBGC ( conn, "HTTP2 %p unexpected CONTINUATION\n", conn );
+		return http2_error ( conn, HTTP2_PROTOCOL_ERROR,
+				     -EPROTO_HEADERS );
+	}
+
+	/* Handle DATA frames */
+	if ( hdr->type == HTTP2_DATA ) {
+
+		/* Update receive windows */
+		if ( ( rc = http2_rx_window ( conn ) ) != 0 )
+			return rc;
+
+		/* Pass through unpadded content directly */
+		if ( ! ( hdr->flags & HTTP2_PADDED ) )
+			conn->flags |= HTTP2_CONN_RX_DATA;
+	}
+
+	return 0;
+}
+
+/**
+ * Receive directly passed through DATA frame content
+ *
+ * @v conn		HTTP/2 connection
+ * @v iobuf		I/O buffer to update
+ * @ret rc		Return status code
+ */
+static int http2_rx_passthru ( struct http2_connection *conn,
+			       struct io_buffer **iobuf ) {
+	struct http2_frame_header *hdr = &conn->rx_header;
+	uint32_t id = ( ntohl ( hdr->stream ) & HTTP2_STREAM_MASK );
+	struct io_buffer *content;
+	size_t len = iob_len ( *iobuf );
+	size_t remaining = conn->rx_remaining;
+	size_t excess;
+	int end;
+
+	/* Split I/O buffer at end of frame, copying whichever part
+	 * is smaller.
+	 */
+	if ( len > remaining ) {
+		excess = ( len - remaining );
+		if ( remaining <= excess ) {
+			content = alloc_iob ( remaining );
+			if ( ! content )
+				return -ENOMEM;
+			memcpy ( iob_put ( content, remaining ),
+				 (*iobuf)->data, remaining );
+			iob_pull ( *iobuf, remaining );
+		} else {
+			content = iob_disown ( *iobuf );
+			*iobuf = alloc_iob ( excess );
+			if ( ! *iobuf ) {
+				free_iob ( content );
+				return -ENOMEM;
+			}
+			memcpy ( iob_put ( *iobuf, excess ),
+				 ( content->data + remaining ), excess );
+			iob_unput ( content, excess );
+		}
+	} else {
+		content = iob_disown ( *iobuf );
+	}
+
+	/* Pass on to stream */
+	conn->rx_remaining -= iob_len ( content );
+	end = ( ( conn->rx_remaining == 0 ) &&
+		( hdr->flags & HTTP2_END_STREAM ) );
+	return http2_rx_content ( conn, id, content, end );
+}
+
+/**
+ * Receive data from transport layer interface
+ *
+ * @v conn		HTTP/2 connection
+ * @v iobuf		I/O buffer
+ * @v meta		Transfer metadata
+ * @ret rc		Return status code
+ */
+static int http2_socket_deliver ( struct http2_connection *conn,
+				  struct io_buffer *iobuf,
+				  struct xfer_metadata *meta __unused ) {
+	struct http2_frame_header *hdr = &conn->rx_header;
+	size_t len;
+	int rc = 0;
+
+	/* Keep connection alive while processing */
+	ref_get ( &conn->refcnt );
+
+	/* Process frames */
+	while ( iobuf && iob_len ( iobuf ) &&
+		! ( conn->flags & HTTP2_CONN_CLOSED ) ) {
+
+		/* Accumulate frame header */
+		if ( conn->rx_header_len < sizeof ( *hdr ) ) {
+			len = ( sizeof ( *hdr ) - conn->rx_header_len );
+			if ( len > iob_len ( iobuf ) )
+				len = iob_len ( iobuf );
+			memcpy ( ( ( ( void * ) hdr ) + conn->rx_header_len ),
+				 iobuf->data, len );
+			iob_pull ( iobuf, len );
+			conn->rx_header_len += len;
+			if ( conn->rx_header_len < sizeof ( *hdr ) )
+				continue;
+			if ( ( rc = http2_rx_frame_header ( conn ) ) != 0 )
+				goto err;
+		} else if ( conn->flags & HTTP2_CONN_RX_DATA ) {
+
+			/* Pass through DATA frame content */
+			if ( ( rc = http2_rx_passthru ( conn, &iobuf ) ) != 0 )
+				goto err;
+		} else {
+
+			/* Accumulate frame payload */
+			len = conn->rx_remaining;
+			if ( len > iob_len ( iobuf ) )
+				len = iob_len ( iobuf );
+			memcpy ( ( conn->rx_payload + conn->rx_len -
+				   conn->rx_remaining ), iobuf->data, len );
+			iob_pull ( iobuf, len );
+			conn->rx_remaining -= len;
+		}
+
+		/* Process frame once complete */
+		if ( conn->rx_remaining )
+			continue;
+		conn->rx_header_len = 0;
+		if ( conn->flags & HTTP2_CONN_RX_DATA ) {
+			/* Content has already been passed through,
+			 * other than a zero-length frame ending the
+			 * stream.
+			 */
+			if ( ( conn->rx_len == 0 ) &&
+			     ( hdr->flags & HTTP2_END_STREAM ) &&
+			     ( ( rc = http2_rx_content ( conn,
+					( ntohl ( hdr->stream ) &
+					  HTTP2_STREAM_MASK ),
+					NULL, 1 ) ) != 0 ) )
+				goto err;
+		} else {
+			if ( ( rc = http2_rx_frame ( conn ) ) != 0 )
+				goto err;
+		}
+	}
+
+ err:
+	free_iob ( iobuf );
+	if ( rc != 0 )
+		http2_close ( conn, rc );
+	ref_put ( &conn->refcnt );
+	return rc;
+}
+
+/**
+ * Handle transport layer window change
+ *
+ * @v conn		HTTP/2 connection
+ */
+static void http2_socket_window_changed ( struct http2_connection *conn ) {
+
+	/* Allow waiting streams to proceed */
+	process_add ( &conn->process );
+}
+
+/**
+ * Close transport layer interface
+ *
+ * @v conn		HTTP/2 connection
+ * @v rc		Reason for close
+ */
+static void http2_socket_close ( struct http2_connection *conn, int rc ) {
+
+	/* Close connection */
+	http2_close ( conn, rc );
+}
+
+/** HTTP/2 connection socket interface operations */
+static struct interface_operation http2_socket_operations[] = {
+	INTF_OP ( xfer_deliver, struct http2_connection *,
+		  http2_socket_deliver ),
+	INTF_OP ( xfer_window_changed, struct http2_connection *,
+		  http2_socket_window_changed ),
+	INTF_OP ( intf_close, struct http2_connection *, http2_socket_close ),
+};
+
+/** HTTP/2 connection socket interface descriptor */
+static struct interface_descriptor http2_socket_desc =
+	INTF_DESC ( struct http2_connection, socket, http2_socket_operations );
+
+/******************************************************************************
+ *
+ * Connections
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Free HTTP/2 connection
+ *
+ * @v refcnt		Reference count
+ */
+static void http2_free ( struct refcnt *refcnt ) {
+	struct http2_connection *conn =
+		container_of ( refcnt, struct http2_connection, refcnt );
+
+	hpack_fini ( &conn->hpack );
+	free ( conn->block );
+	uri_put ( conn->uri );
+	free ( conn );
+}
+
+/**
+ * Close HTTP/2 connection
+ *
+ * @v conn		HTTP/2 connection
+ * @v rc		Reason for close
+ */
+static void http2_close ( struct http2_connection *conn, int rc ) {
+	struct http2_stream *stream;
+
+	/* Do nothing if already closed */
+	if ( conn->flags & HTTP2_CONN_CLOSED )
+		return;
+	conn->flags |= HTTP2_CONN_CLOSED;
+	ref_get ( &conn->refcnt );
+
+	/* Stop accepting new streams */
+	list_del ( &conn->list );
+	INIT_LIST_HEAD ( &conn->list );
+
+	/* Stop timer and process */
+	stop_timer ( &conn->timer );
+	process_del ( &conn->process );
+
+	/* Close all streams.  Reopen any streams still awaiting a
+	 * response if the connection has previously been reused,
+	 * since the server may simply have closed an idle connection.
+	 */
+	while ( ( stream = list_first_entry ( &conn->streams,
+					      struct http2_stream, list ) ) ) {
+		stream->flags |= HTTP2_STREAM_REMOTE_CLOSED;
+		if ( ( conn->flags & HTTP2_CONN_REUSED ) &&
+		     ! ( stream->flags & HTTP2_STREAM_RESPONSE ) ) {
+			http2_stream_reopen ( stream, rc );
+		} else {
+			http2_stream_close ( stream,
+					     ( rc ? rc : -ECONNRESET_CLOSED ) );
+		}
+	}
+
+	/* Shut down transport layer interface */
+	intf_shutdown ( &conn->socket, rc );
+	if ( rc == 0 ) {
+		DBGC2 ( conn, "HTTP2 %p closed %s://%s\n",
+			conn, conn->scheme->name, conn->uri->host );
+	} else {
+		DBGC ( conn, "HTTP2 %p closed %s://%s: %s\n",
+		       conn, conn->scheme->name, conn->uri->host,
+		       strerror ( rc ) );
+	}
+	ref_put ( &conn->refcnt );
+}
+
+/**
+ * Handle idle timer expiry
+ *
+ * @v timer		Idle timer
+ * @v over		Failure indicator
+ */
+static void http2_expired ( struct retry_timer *timer, int over __unused ) {
+	struct http2_connection *conn =
+		container_of ( timer, struct http2_connection, timer );
+
+	/* Close idle connection */
+	http2_send_goaway ( conn, HTTP2_NO_ERROR );
+	http2_close ( conn, 0 );
+}
+
+/**
+ * HTTP/2 stream notification process
+ *
+ * @v conn		HTTP/2 connection
+ */
+static void http2_step ( struct http2_connection *conn ) {
+	struct http2_stream *stream;
+	struct http2_stream *tmp;
+	int rc;
+
+	/* Keep connection alive while notifying streams */
+	ref_get ( &conn->refcnt );
+
+	/* Transmit pending request content, and notify any streams
+	 * awaiting transmission that the window may have changed.
+	 */
+	list_for_each_entry_safe ( stream, tmp, &conn->streams, list ) {
+		if ( conn->flags & HTTP2_CONN_CLOSED )
+			break;
+		if ( ! ( stream->flags & HTTP2_STREAM_SENT ) ) {
+			xfer_window_changed ( &stream->xfer );
+		} else if ( stream->tx_pending ) {
+			if ( ( rc = http2_stream_tx ( stream ) ) != 0 )
+				http2_stream_close ( stream, rc );
+		}
+	}
+
+	ref_put ( &conn->refcnt );
+}
+
+/** HTTP/2 stream notification process descriptor */
+static struct process_descriptor http2_process_desc =
+	PROC_DESC_ONCE ( struct http2_connection, process, http2_step );
+
+/**
+ * Check if HTTP/2 connection matches server
+ *
+ * @v conn		HTTP/2 connection
+ * @v scheme		HTTP scheme
+ * @v uri		Server URI
+ * @v port		Server port
+ * @ret matches		Connection matches server
+ */
+static int http2_matches ( struct http2_connection *conn,
+			   struct http_scheme *scheme, struct uri *uri,
+			   unsigned int port ) {
+
+	return ( ( scheme == conn->scheme ) &&
+		 ( strcmp ( uri->host, conn->uri->host ) == 0 ) &&
+		 ( port == uri_port ( conn->uri, scheme->port ) ) );
+}
+
+/**
+ * Open request via existing HTTP/2 connection
+ *
+ * @v xfer		Data transfer interface
+ * @v scheme		HTTP scheme
+ * @v uri		Server URI
+ * @v port		Server port
+ * @ret attached	Request was attached, or negative error
+ */
+static int http2_connect ( struct interface *xfer, struct http_scheme *scheme,
+			   struct uri *uri, unsigned int port ) {
+	struct http2_connection *conn;
+	struct list_head *entry;
+	unsigned int count;
+	int rc;
+
+	/* Look for a matching connection with spare capacity */
+	list_for_each_entry ( conn, &http2_connections, list ) {
+
+		/* Check server */
+		if ( ! http2_matches ( conn, scheme, uri, port ) )
+			continue;
+
+		/* Check number of streams */
+		count = 0;
+		list_for_each ( entry, &conn->streams )
+			count++;
+		if ( count >= HTTP2_MAX_STREAMS )
+			continue;
+
+		/* Check that stream identifiers remain available */
+		if ( ( conn->next_id + ( 2 * count ) ) > HTTP2_STREAM_MASK )
+			continue;
+
+		/* Open stream on this connection */
+		if ( ( rc = http2_stream_open ( conn, xfer ) ) != 0 )
+			return rc;
+		return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Take over HTTP connection if HTTP/2 was negotiated
+ *
+ * @v http		HTTP connection
+ * @ret upgraded	Connection was taken over, or negative error
+ */
+static int http2_upgrade ( struct http_connection *http ) {
+	struct http2_connection *conn;
+	const char *protocol;
+	int rc;
+
+	/* Check negotiated protocol */
+	protocol = tls_protocol ( &http->socket );
+	if ( ( ! protocol ) || ( strcmp ( protocol, HTTP2_PROTOCOL ) != 0 ) )
+		return 0;
+
+	/* Allocate and initialise structure */
+	conn = zalloc ( sizeof ( *conn ) );
+	if ( ! conn ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	ref_init ( &conn->refcnt, http2_free );
+	conn->uri = uri_get ( http->uri );
+	conn->scheme = http->scheme;
+	intf_init ( &conn->socket, &http2_socket_desc, &conn->refcnt );
+	INIT_LIST_HEAD ( &conn->list );
+	INIT_LIST_HEAD ( &conn->streams );
+	process_init_stopped ( &conn->process, &http2_process_desc,
+			       &conn->refcnt );
+	timer_init ( &conn->timer, http2_expired, &conn->refcnt );
+	hpack_init ( &conn->hpack, HPACK_DEFAULT_TABLE_SIZE );
+	conn->next_id = 1;
+	conn->tx_window = HTTP2_DEFAULT_WINDOW;
+	conn->tx_initial = HTTP2_DEFAULT_WINDOW;
+	conn->tx_frame_size = HTTP2_DEFAULT_FRAME_SIZE;
+	conn->max_streams = HTTP2_MAX_STREAMS;
+
+	/* Take over transport layer interface */
+	intf_plug_plug ( &conn->socket, http->socket.dest );
+	intf_unplug ( &http->socket );
+
+	/* Transmit connection preface */
+	if ( ( rc = http2_send_preface ( conn ) ) != 0 ) {
+		DBGC ( conn, "HTTP2 %p could not send preface: %s\n",
+		       conn, strerror ( rc ) );
+		goto err_preface;
+	}
+
+	/* Start accepting streams, and start idle timer until the
+	 * first stream is attached.
+	 */
+	list_add_tail ( &conn->list, &http2_connections );
+	start_timer_fixed ( &conn->timer, HTTP2_IDLE_TIMEOUT );
+	DBGC2 ( conn, "HTTP2 %p created %s://%s\n",
+		conn, conn->scheme->name, conn->uri->host );
+
+	/* Drop our reference (now held by transport layer interface) */
+	ref_put ( &conn->refcnt );
+	return 1;
+
+ err_preface:
+	http2_close ( conn, rc );
+	ref_put ( &conn->refcnt );
+ err_alloc:
+	return rc;
+}
+
+/** HTTP/2 protocol */
+struct http_protocol http2_protocol __http_protocol = {
+	.name = HTTP2_PROTOCOL,
+	.connect = http2_connect,
+	.upgrade = http2_upgrade,
+};
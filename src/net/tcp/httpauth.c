@@ -30,11 +30,43 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  *
  */
 
+#include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <strings.h>
 #include <errno.h>
+#include <ipxe/list.h>
+#include <ipxe/uri.h>
 #include <ipxe/http.h>
 
+/** A cached HTTP authentication challenge */
+struct http_auth_cache {
+	/** List of cached challenges */
+	struct list_head list;
+	/** Authentication scheme */
+	struct http_authentication *auth;
+	/** URI scheme */
+	char *scheme;
+	/** Server host name (and port, if any) */
+	char *host;
+	/** Remaining "WWW-Authenticate" header line */
+	char *line;
+	/** Working copy of remaining header line
+	 *
+	 * The header line is modified by parsing, and so is copied
+	 * before each use.
+	 */
+	char *parsed;
+	/** Length of remaining header line */
+	size_t len;
+};
+
+/** Cached authentication challenges, most recently used first */
+static LIST_HEAD ( http_auth_cache );
+
+/** Number of cached authentication challenges */
+static unsigned int http_auth_cache_count;
+
 /**
  * Identify authentication scheme
  *
@@ -54,6 +86,135 @@ static struct http_authentication * http_authentication ( const char *name ) {
 	return NULL;
 }
 
+/**
+ * Find cached authentication challenge
+ *
+ * @v http		HTTP transaction
+ * @ret cache		Cached challenge, or NULL if not found
+ */
+static struct http_auth_cache * http_auth_find ( struct http_transaction *http ){
+	const char *scheme = ( http->uri->scheme ? http->uri->scheme : "" );
+	struct http_auth_cache *cache;
+
+	list_for_each_entry ( cache, &http_auth_cache, list ) {
+		if ( ( strcasecmp ( cache->scheme, scheme ) == 0 ) &&
+		     ( strcasecmp ( cache->host, http->request.host ) == 0 ) ) {
+			return cache;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Record authentication challenge
+ *
+ * @v http		HTTP transaction
+ * @v auth		Authentication scheme
+ * @v line		Remaining header line
+ */
+static void http_auth_record ( struct http_transaction *http,
+			       struct http_authentication *auth,
+			       const char *line ) {
+	const char *scheme = ( http->uri->scheme ? http->uri->scheme : "" );
+	struct http_auth_cache *cache;
+	size_t scheme_len;
+	size_t host_len;
+	size_t len;
+
+	/* Do nothing unless the scheme may be used preemptively */
+	if ( ! ( auth->flags & HTTP_AUTH_PREEMPTIVE ) )
+		return;
+
+	/* Discard any existing challenge for this server, or the
+	 * least recently used challenge if the cache is full.
+	 */
+	cache = http_auth_find ( http );
+	if ( ( ! cache ) && ( http_auth_cache_count >= HTTP_AUTH_CACHE_SIZE ) )
+		cache = list_last_entry ( &http_auth_cache,
+					  struct http_auth_cache, list );
+	if ( cache ) {
+		list_del ( &cache->list );
+		free ( cache );
+		http_auth_cache_count--;
+	}
+
+	/* Allocate and populate cache entry */
+	scheme_len = ( strlen ( scheme ) + 1 /* NUL */ );
+	host_len = ( strlen ( http->request.host ) + 1 /* NUL */ );
+	len = strlen ( line );
+	cache = zalloc ( sizeof ( *cache ) + scheme_len + host_len +
+			 ( 2 * ( len + 1 /* NUL */ ) ) );
+	if ( ! cache )
+		return;
+	cache->auth = auth;
+	cache->scheme = ( ( ( void * ) cache ) + sizeof ( *cache ) );
+	cache->host = ( cache->scheme + scheme_len );
+	cache->line = ( cache->host + host_len );
+	cache->parsed = ( cache->line + len + 1 /* NUL */ );
+	cache->len = len;
+	memcpy ( cache->scheme, scheme, scheme_len );
+	memcpy ( cache->host, http->request.host, host_len );
+	memcpy ( cache->line, line, len );
+	list_add ( &cache->list, &http_auth_cache );
+	http_auth_cache_count++;
+	DBGC2 ( http, "HTTP %p cached %s challenge for %s://%s\n",
+		http, auth->name, cache->scheme, cache->host );
+}
+
+/**
+ * Authenticate preemptively using a cached challenge
+ *
+ * @v http		HTTP transaction
+ *
+ * If a challenge has previously been received from the same server,
+ * then reuse it to authenticate without waiting for the server to
+ * reject the request.
+ */
+void http_auth_preempt ( struct http_transaction *http ) {
+	struct http_auth_cache *cache;
+	struct http_authentication *auth;
+	int rc;
+
+	/* Do nothing if we are responding to an actual challenge */
+	if ( http->request.auth.auth && ( ! http->request.auth.preemptive ) )
+		return;
+
+	/* Do nothing unless we have credentials and a cached challenge */
+	if ( ! http->uri->user )
+		return;
+	cache = http_auth_find ( http );
+	if ( ! cache )
+		return;
+	auth = cache->auth;
+
+	/* Mark cached challenge as most recently used */
+	list_del ( &cache->list );
+	list_add ( &cache->list, &http_auth_cache );
+
+	/* Parse cached challenge */
+	memcpy ( cache->parsed, cache->line, ( cache->len + 1 /* NUL */ ) );
+	memset ( &http->response.auth, 0, sizeof ( http->response.auth ) );
+	http->response.auth.auth = auth;
+	if ( ( rc = auth->parse ( http, cache->parsed ) ) != 0 )
+		goto err;
+
+	/* Perform authentication */
+	http->request.auth.auth = auth;
+	if ( ( rc = auth->authenticate ( http ) ) != 0 )
+		goto err;
+	http->request.auth.preemptive = 1;
+	DBGC2 ( http, "HTTP %p performing preemptive %s authentication\n",
+		http, auth->name );
+
+	return;
+
+ err:
+	DBGC ( http, "HTTP %p could not authenticate preemptively: %s\n",
+	       http, strerror ( rc ) );
+	memset ( &http->request.auth, 0, sizeof ( http->request.auth ) );
+	memset ( &http->response.auth, 0, sizeof ( http->response.auth ) );
+}
+
 /**
  * Parse HTTP "WWW-Authenticate" header
  *
@@ -89,6 +250,17 @@ static int http_parse_www_authenticate ( struct http_transaction *http,
 		return 0;
 	http->response.auth.auth = auth;
 
+	/* Allow a preemptively authenticated request to be retried
+	 * using the new challenge.
+	 */
+	if ( http->request.auth.preemptive ) {
+		http->request.auth.preemptive = 0;
+		http->response.flags |= HTTP_RESPONSE_RETRY;
+	}
+
+	/* Record challenge for reuse in subsequent requests */
+	http_auth_record ( http, auth, line );
+
 	/* Parse remaining header line */
 	if ( ( rc = auth->parse ( http, line ) ) != 0 ) {
 		DBGC ( http, "HTTP %p could not parse %s WWW-Authenticate "
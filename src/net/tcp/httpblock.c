@@ -31,6 +31,9 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  */
 
 #include <stdint.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <assert.h>
 #include <ipxe/uaccess.h>
 #include <ipxe/blocktrans.h>
 #include <ipxe/blockdev.h>
@@ -41,27 +44,75 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #define HTTP_BLKSIZE 512
 
 /**
- * Read from block device
+ * Maximum number of concurrent range requests per block read
+ *
+ * Each range request will use a separate (pooled) HTTP connection.
+ * Splitting a large read across several connections allows the
+ * transfer to proceed at more than one TCP window per round trip.
+ */
+#define HTTP_BLOCK_MAX_FRAGMENTS 4
+
+/** Minimum length of each range request within a split block read */
+#define HTTP_BLOCK_MIN_FRAGMENT_LEN ( 64 * 1024 )
+
+/** A range request forming part of an HTTP block read */
+struct http_block_fragment {
+	/** Containing block read */
+	struct http_block_read *read;
+	/** Data interface */
+	struct interface data;
+	/** Completion status (or -EINPROGRESS) */
+	int rc;
+};
+
+/** An HTTP block read split across several range requests */
+struct http_block_read {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** Block device interface */
+	struct interface block;
+	/** Number of range requests */
+	unsigned int count;
+	/** Number of range requests still in progress */
+	unsigned int remaining;
+	/** Range requests */
+	struct http_block_fragment fragment[HTTP_BLOCK_MAX_FRAGMENTS];
+};
+
+/**
+ * Release block device's own HTTP connection
+ *
+ * @v http		HTTP transaction
+ *
+ * The HTTP transaction representing the block device itself never
+ * transmits its request, since the block device never opens its data
+ * transfer window.  Release its connection once the block device is
+ * in use, so that block device requests are never pipelined behind a
+ * request that will never be transmitted.
+ */
+static void http_block_release ( struct http_transaction *http ) {
+
+	intf_restart ( &http->conn, 0 );
+}
+
+/**
+ * Start a range request to retrieve block(s)
  *
  * @v http		HTTP transaction
  * @v data		Data interface
- * @v lba		Starting logical block address
- * @v count		Number of logical blocks
+ * @v start		Starting offset
  * @v buffer		Data buffer
  * @v len		Length of data buffer
  * @ret rc		Return status code
  */
-int http_block_read ( struct http_transaction *http, struct interface *data,
-		      uint64_t lba, unsigned int count, userptr_t buffer,
-		      size_t len ) {
+static int http_block_open ( struct http_transaction *http,
+			     struct interface *data, size_t start,
+			     userptr_t buffer, size_t len ) {
 	struct http_request_range range;
 	int rc;
 
-	/* Sanity check */
-	assert ( len == ( count * HTTP_BLKSIZE ) );
-
 	/* Construct request range descriptor */
-	range.start = ( lba * HTTP_BLKSIZE );
+	range.start = start;
 	range.len = len;
 
 	/* Start a range request to retrieve the block(s) */
@@ -84,6 +135,179 @@ int http_block_read ( struct http_transaction *http, struct interface *data,
 	return rc;
 }
 
+/**
+ * Close split block read
+ *
+ * @v read		Split block read
+ * @v rc		Reason for close
+ */
+static void http_block_close ( struct http_block_read *read, int rc ) {
+	unsigned int i;
+
+	/* Shut down all range requests */
+	for ( i = 0 ; i < read->count ; i++ )
+		intf_shutdown ( &read->fragment[i].data, rc );
+
+	/* Shut down block device interface */
+	intf_shutdown ( &read->block, rc );
+}
+
+/**
+ * Handle completion of a range request
+ *
+ * @v fragment		Range request
+ * @v rc		Reason for completion
+ */
+static void http_block_fragment_close ( struct http_block_fragment *fragment,
+					int rc ) {
+	struct http_block_read *read = fragment->read;
+
+	/* Ignore duplicate completions */
+	intf_restart ( &fragment->data, rc );
+	if ( fragment->rc != -EINPROGRESS )
+		return;
+	fragment->rc = rc;
+
+	/* Fail the whole read on the first error */
+	if ( rc != 0 ) {
+		DBGC ( read, "HTTPBLK %p range request %d failed: %s\n",
+		       read, ( ( int ) ( fragment - read->fragment ) ),
+		       strerror ( rc ) );
+		http_block_close ( read, rc );
+		return;
+	}
+
+	/* Complete the read once all range requests have completed */
+	assert ( read->remaining > 0 );
+	if ( --read->remaining == 0 )
+		http_block_close ( read, 0 );
+}
+
+/** Split block read block device interface operations */
+static struct interface_operation http_block_operations[] = {
+	INTF_OP ( intf_close, struct http_block_read *, http_block_close ),
+};
+
+/** Split block read block device interface descriptor */
+static struct interface_descriptor http_block_desc =
+	INTF_DESC ( struct http_block_read, block, http_block_operations );
+
+/** Range request data interface operations */
+static struct interface_operation http_block_fragment_operations[] = {
+	INTF_OP ( intf_close, struct http_block_fragment *,
+		  http_block_fragment_close ),
+};
+
+/** Range request data interface descriptor */
+static struct interface_descriptor http_block_fragment_desc =
+	INTF_DESC ( struct http_block_fragment, data,
+		    http_block_fragment_operations );
+
+/**
+ * Read from block device using several concurrent range requests
+ *
+ * @v http		HTTP transaction
+ * @v data		Data interface
+ * @v start		Starting offset
+ * @v buffer		Data buffer
+ * @v len		Length of data buffer
+ * @v count		Number of range requests
+ * @ret rc		Return status code
+ */
+static int http_block_split ( struct http_transaction *http,
+			      struct interface *data, size_t start,
+			      userptr_t buffer, size_t len,
+			      unsigned int count ) {
+	struct http_block_read *read;
+	struct http_block_fragment *fragment;
+	size_t offset;
+	size_t frag_len;
+	unsigned int i;
+	int rc;
+
+	/* Allocate and initialise structure */
+	read = zalloc ( sizeof ( *read ) );
+	if ( ! read ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	ref_init ( &read->refcnt, NULL );
+	intf_init ( &read->block, &http_block_desc, &read->refcnt );
+	read->count = count;
+	read->remaining = count;
+	for ( i = 0 ; i < count ; i++ ) {
+		fragment = &read->fragment[i];
+		fragment->read = read;
+		fragment->rc = -EINPROGRESS;
+		intf_init ( &fragment->data, &http_block_fragment_desc,
+			    &read->refcnt );
+	}
+
+	/* Start range requests, using block-aligned fragment lengths */
+	for ( offset = 0, i = 0 ; i < count ; offset += frag_len, i++ ) {
+		fragment = &read->fragment[i];
+		frag_len = ( ( len - offset ) / ( count - i ) );
+		frag_len = ( ( frag_len + HTTP_BLKSIZE - 1 ) &
+			     ~( HTTP_BLKSIZE - 1 ) );
+		if ( ( rc = http_block_open ( http, &fragment->data,
+					      ( start + offset ),
+					      userptr_add ( buffer, offset ),
+					      frag_len ) ) != 0 )
+			goto err_open;
+	}
+	assert ( offset == len );
+	DBGC2 ( read, "HTTPBLK %p HTTP %p reading %#zx+%#zx via %d range "
+		"requests\n", read, http, start, len, count );
+
+	/* Attach to parent interface, mortalise self, and return */
+	intf_plug_plug ( &read->block, data );
+	ref_put ( &read->refcnt );
+	return 0;
+
+ err_open:
+	http_block_close ( read, rc );
+	ref_put ( &read->refcnt );
+ err_alloc:
+	return rc;
+}
+
+/**
+ * Read from block device
+ *
+ * @v http		HTTP transaction
+ * @v data		Data interface
+ * @v lba		Starting logical block address
+ * @v count		Number of logical blocks
+ * @v buffer		Data buffer
+ * @v len		Length of data buffer
+ * @ret rc		Return status code
+ *
+ * Large reads are split into several concurrent range requests.
+ */
+int http_block_read ( struct http_transaction *http, struct interface *data,
+		      uint64_t lba, unsigned int count, userptr_t buffer,
+		      size_t len ) {
+	size_t start = ( lba * HTTP_BLKSIZE );
+	unsigned int fragments;
+
+	/* Sanity check */
+	assert ( len == ( count * HTTP_BLKSIZE ) );
+
+	/* Release block device's own connection */
+	http_block_release ( http );
+
+	/* Calculate number of range requests */
+	fragments = ( len / HTTP_BLOCK_MIN_FRAGMENT_LEN );
+	if ( fragments > HTTP_BLOCK_MAX_FRAGMENTS )
+		fragments = HTTP_BLOCK_MAX_FRAGMENTS;
+
+	/* Use a single range request for small reads */
+	if ( fragments <= 1 )
+		return http_block_open ( http, data, start, buffer, len );
+
+	return http_block_split ( http, data, start, buffer, len, fragments );
+}
+
 /**
  * Read block device capacity
  *
@@ -95,6 +319,9 @@ int http_block_read_capacity ( struct http_transaction *http,
 			       struct interface *data ) {
 	int rc;
 
+	/* Release block device's own connection */
+	http_block_release ( http );
+
 	/* Start a HEAD request to retrieve the capacity */
 	if ( ( rc = http_open ( data, &http_head, http->uri, NULL,
 				NULL ) ) != 0 )
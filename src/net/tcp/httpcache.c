@@ -0,0 +1,562 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/**
+ * @file
+ *
+ * Hyper Text Transfer Protocol (HTTP) image cache
+ *
+ * Images downloaded via HTTP with an entity tag or a last
+ * modification time are retained in memory (even after being freed
+ * via "imgfree", or discarded by a script that is re-entered), up to
+ * a small number of entries.  Any subsequent request for the same
+ * URI is made conditional upon the cached validators.  If the server
+ * responds with "304 Not Modified", then the content is restored
+ * directly from the cached image without being transferred again.
+ *
+ * The cache holds a reference to the image itself rather than to a
+ * separate copy of its data, so an image that remains registered
+ * consumes no additional memory.  Cached images that are no longer
+ * in use are discarded if memory runs low.
+ *
+ * A persistent store (such as a local disk) may additionally be used
+ * to retain a copy of downloaded content across reboots.  Content
+ * from a persistent store is still revalidated with a conditional
+ * request before use.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <ipxe/list.h>
+#include <ipxe/uri.h>
+#include <ipxe/image.h>
+#include <ipxe/xferbuf.h>
+#include <ipxe/malloc.h>
+#include <ipxe/crypto.h>
+#include <ipxe/downloader.h>
+#include <ipxe/http.h>
+
+/* Disambiguate the various error causes */
+#define EIO_CACHE __einfo_error ( EINFO_EIO_CACHE )
+#define EINFO_EIO_CACHE \
+	__einfo_uniqify ( EINFO_EIO, 0x01, "Cached content unavailable" )
+
+/** Maximum number of cache entries */
+#define HTTP_CACHE_MAX 8
+
+/** An HTTP image cache entry */
+struct http_cache_entry {
+	/** List of cache entries (most recently used first) */
+	struct list_head list;
+	/** URI string */
+	char *uri;
+	/** Entity tag (if any) */
+	char *etag;
+	/** Last modification time (if any) */
+	char *modified;
+	/** Cached image, or NULL if not held in memory */
+	struct image *image;
+	/** Persistent store holding a copy of the content (if any) */
+	struct http_cache_store *store;
+};
+
+/** HTTP image cache */
+static LIST_HEAD ( http_cache );
+
+/** Number of HTTP image cache entries */
+static unsigned int http_cache_count;
+
+/**
+ * Free cache entry
+ *
+ * @v entry		Cache entry
+ */
+static void http_cache_free ( struct http_cache_entry *entry ) {
+
+	DBGC ( &http_cache, "HTTPCACHE discarding %s\n", entry->uri );
+	list_del ( &entry->list );
+	http_cache_count--;
+	image_put ( entry->image );
+	free ( entry->uri );
+	free ( entry->etag );
+	free ( entry->modified );
+	free ( entry );
+}
+
+/**
+ * Find cache entry
+ *
+ * @v uri		URI string
+ * @ret entry		Cache entry, or NULL if not found
+ */
+static struct http_cache_entry * http_cache_find ( const char *uri ) {
+	struct http_cache_entry *entry;
+
+	/* Find cache entry, and mark as most recently used */
+	list_for_each_entry ( entry, &http_cache, list ) {
+		if ( strcmp ( entry->uri, uri ) == 0 ) {
+			list_del ( &entry->list );
+			list_add ( &entry->list, &http_cache );
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Create cache entry
+ *
+ * @v uri		URI string
+ * @v etag		Entity tag, or NULL
+ * @v modified		Last modification time, or NULL
+ * @ret entry		Cache entry, or NULL on error
+ */
+static struct http_cache_entry * http_cache_create ( const char *uri,
+						     const char *etag,
+						     const char *modified ) {
+	struct http_cache_entry *entry;
+
+	/* Make room for new entry, if necessary */
+	if ( http_cache_count >= HTTP_CACHE_MAX ) {
+		http_cache_free ( list_last_entry ( &http_cache,
+						    struct http_cache_entry,
+						    list ) );
+	}
+
+	/* Allocate and populate new entry */
+	entry = zalloc ( sizeof ( *entry ) );
+	if ( ! entry )
+		goto err_alloc;
+	entry->uri = strdup ( uri );
+	if ( ! entry->uri )
+		goto err_uri;
+	if ( etag && ( ! ( entry->etag = strdup ( etag ) ) ) )
+		goto err_etag;
+	if ( modified && ( ! ( entry->modified = strdup ( modified ) ) ) )
+		goto err_modified;
+	list_add ( &entry->list, &http_cache );
+	http_cache_count++;
+
+	return entry;
+
+	free ( entry->modified );
+ err_modified:
+	free ( entry->etag );
+ err_etag:
+	free ( entry->uri );
+ err_uri:
+	free ( entry );
+ err_alloc:
+	DBGC ( &http_cache, "HTTPCACHE could not create entry for %s\n", uri );
+	return NULL;
+}
+
+/**
+ * Find cache entry in persistent stores
+ *
+ * @v uri		URI string
+ * @ret entry		Cache entry, or NULL if not found
+ */
+static struct http_cache_entry * http_cache_lookup ( const char *uri ) {
+	struct http_cache_store *store;
+	struct http_cache_entry *entry;
+	char *etag;
+	char *modified;
+	int rc;
+
+	/* Try each persistent store in turn */
+	for_each_table_entry ( store, HTTP_CACHE_STORES ) {
+
+		/* Look up validators */
+		etag = NULL;
+		modified = NULL;
+		if ( ( rc = store->lookup ( uri, &etag, &modified ) ) != 0 )
+			continue;
+
+		/* Create cache entry */
+		entry = http_cache_create ( uri, etag, modified );
+		free ( etag );
+		free ( modified );
+		if ( ! entry )
+			return NULL;
+		entry->store = store;
+		DBGC ( &http_cache, "HTTPCACHE found %s in %s\n",
+		       uri, store->name );
+		return entry;
+	}
+
+	return NULL;
+}
+
+/**
+ * Discard content from persistent stores
+ *
+ * @v uri		URI string
+ */
+static void http_cache_discard_stores ( const char *uri ) {
+	struct http_cache_store *store;
+
+	/* Discard from each persistent store */
+	for_each_table_entry ( store, HTTP_CACHE_STORES )
+		store->discard ( uri );
+}
+
+/**
+ * Check if HTTP transaction is eligible for caching
+ *
+ * @v http		HTTP transaction
+ * @ret eligible	Transaction is eligible for caching
+ *
+ * Only plain GET requests for a complete resource are eligible.  The
+ * recipient must also provide direct access to its data buffer, since
+ * content restored from the cache is written straight into the
+ * buffer.
+ */
+static int http_cache_eligible ( struct http_transaction *http ) {
+
+	return ( ( http->request.method == &http_get ) &&
+		 ( http->request.range.len == 0 ) &&
+		 ( http->request.content.len == 0 ) &&
+		 ( xfer_buffer ( &http->xfer ) != NULL ) );
+}
+
+/**
+ * Find usable cache entry for HTTP request
+ *
+ * @v http		HTTP transaction
+ * @ret entry		Cache entry, or NULL if not found
+ */
+static struct http_cache_entry *
+http_cache_request ( struct http_transaction *http ) {
+	struct http_cache_entry *entry;
+	char *uri;
+
+	/* Check that request is eligible for caching */
+	if ( ! http_cache_eligible ( http ) )
+		return NULL;
+
+	/* Construct URI string */
+	uri = format_uri_alloc ( http->uri );
+	if ( ! uri )
+		return NULL;
+
+	/* Find cache entry, falling back to persistent stores */
+	entry = http_cache_find ( uri );
+	if ( ! entry )
+		entry = http_cache_lookup ( uri );
+	free ( uri );
+
+	/* Use only entries with complete content */
+	if ( ! ( entry && ( entry->image || entry->store ) ) )
+		return NULL;
+
+	return entry;
+}
+
+/**
+ * Record validators for a new response
+ *
+ * @v http		HTTP transaction
+ * @ret rc		Return status code
+ */
+static int http_cache_record ( struct http_transaction *http ) {
+	struct http_response_cache *cache = &http->response.cache;
+	struct http_cache_entry *entry;
+	char *uri;
+
+	/* Construct URI string */
+	uri = format_uri_alloc ( http->uri );
+	if ( ! uri ) {
+		/* Failure to cache is not fatal to the transaction */
+		return 0;
+	}
+
+	/* Discard any existing content, since it is now stale */
+	if ( ( entry = http_cache_find ( uri ) ) != NULL )
+		http_cache_free ( entry );
+	http_cache_discard_stores ( uri );
+
+	/* Create new entry if response has a usable validator */
+	if ( ( cache->etag || cache->modified ) &&
+	     ( ( entry = http_cache_create ( uri, cache->etag,
+					     cache->modified ) ) != NULL ) ) {
+		DBGC ( &http_cache, "HTTPCACHE awaiting %s%s%s%s%s\n",
+		       entry->uri, ( entry->etag ? " ETag " : "" ),
+		       ( entry->etag ? entry->etag : "" ),
+		       ( entry->modified ? " Last-Modified " : "" ),
+		       ( entry->modified ? entry->modified : "" ) );
+	}
+
+	free ( uri );
+	return 0;
+}
+
+/**
+ * Restore content from cache
+ *
+ * @v http		HTTP transaction
+ * @ret rc		Return status code
+ */
+static int http_cache_restore ( struct http_transaction *http ) {
+	struct http_response_cache *cache = &http->response.cache;
+	struct http_cache_entry *entry;
+	struct xfer_buffer *xferbuf;
+	struct image *image;
+	int rc;
+
+	/* Find cache entry */
+	entry = http_cache_request ( http );
+	if ( ! entry ) {
+		DBGC ( http, "HTTP %p has no cached content\n", http );
+		return -EIO_CACHE;
+	}
+	image = entry->image;
+
+	/* Check that any returned entity tag matches */
+	if ( cache->etag && entry->etag &&
+	     ( strcmp ( cache->etag, entry->etag ) != 0 ) ) {
+		DBGC ( http, "HTTP %p cached ETag %s does not match %s\n",
+		       http, entry->etag, cache->etag );
+		return -EIO_CACHE;
+	}
+
+	/* Copy cached content directly to the data transfer buffer */
+	xferbuf = xfer_buffer ( &http->xfer );
+	assert ( xferbuf != NULL );
+	if ( image ) {
+		rc = xferbuf_write ( xferbuf, 0,
+				     user_to_virt ( image->data, 0 ),
+				     image->len );
+		xferbuf->pos = image->len;
+	} else {
+		rc = entry->store->restore ( entry->uri, xferbuf );
+	}
+	if ( rc != 0 ) {
+		DBGC ( http, "HTTP %p could not restore cached content: %s\n",
+		       http, strerror ( rc ) );
+		/* Discard unusable entry */
+		if ( ! image )
+			entry->store->discard ( entry->uri );
+		http_cache_free ( entry );
+		return rc;
+	}
+
+	/* Mark response as successful */
+	http->response.rc = 0;
+	http->response.flags |= HTTP_RESPONSE_CACHED;
+	DBGC ( http, "HTTP %p restored %zd bytes from %s\n", http,
+	       xferbuf->pos, ( image ? "cache" : entry->store->name ) );
+
+	return 0;
+}
+
+/**
+ * Handle response for caching
+ *
+ * @v http		HTTP transaction
+ * @ret rc		Return status code
+ */
+int http_cache_response ( struct http_transaction *http ) {
+
+	/* Do nothing unless request is eligible for caching */
+	if ( ! http_cache_eligible ( http ) )
+		return 0;
+
+	/* Restore content from cache if not modified */
+	if ( http->response.status == 304 )
+		return http_cache_restore ( http );
+
+	/* Record validators for successful responses */
+	if ( http->response.status == 200 )
+		return http_cache_record ( http );
+
+	return 0;
+}
+
+/**
+ * Save cache entry to persistent store
+ *
+ * @v entry		Cache entry
+ */
+static void http_cache_save ( struct http_cache_entry *entry ) {
+	struct http_cache_store *store;
+	int rc;
+
+	/* Save to first persistent store that accepts the content */
+	for_each_table_entry ( store, HTTP_CACHE_STORES ) {
+		if ( ( rc = store->save ( entry->uri, entry->etag,
+					  entry->modified,
+					  entry->image ) ) == 0 ) {
+			DBGC ( &http_cache, "HTTPCACHE saved %s to %s\n",
+			       entry->uri, store->name );
+			entry->store = store;
+			return;
+		}
+		DBGC ( &http_cache, "HTTPCACHE could not save %s to %s: %s\n",
+		       entry->uri, store->name, strerror ( rc ) );
+	}
+}
+
+/**
+ * Record downloaded image in cache
+ *
+ * @v image		Downloaded image
+ */
+void downloader_cache ( struct image *image ) {
+	struct http_cache_entry *entry;
+	char *uri;
+
+	/* Find cache entry, if any */
+	if ( ! image->uri )
+		return;
+	uri = format_uri_alloc ( image->uri );
+	if ( ! uri )
+		return;
+	entry = http_cache_find ( uri );
+	free ( uri );
+	if ( ! entry )
+		return;
+
+	/* Replace any previously cached image */
+	if ( entry->image != image ) {
+		image_put ( entry->image );
+		entry->image = image_get ( image );
+		DBGC ( &http_cache, "HTTPCACHE cached %s (%zd bytes)\n",
+		       entry->uri, image->len );
+	}
+
+	/* Save to persistent store, if not already present */
+	if ( ! entry->store )
+		http_cache_save ( entry );
+}
+
+/**
+ * Find cached image by digest
+ *
+ * @v digest		Digest algorithm
+ * @v value		Digest value
+ * @ret image		Cached image, or NULL
+ */
+struct image * downloader_cached ( struct digest_algorithm *digest,
+				   const void *value ) {
+	struct http_cache_entry *entry;
+	struct image *image;
+
+	/* Find cached image with a matching precalculated digest */
+	list_for_each_entry ( entry, &http_cache, list ) {
+		image = entry->image;
+		if ( image && ( image->digest == digest ) &&
+		     ( memcmp ( image->digest_value, value,
+				digest->digestsize ) == 0 ) ) {
+			return image;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Construct HTTP "If-None-Match" header
+ *
+ * @v http		HTTP transaction
+ * @v buf		Buffer
+ * @v len		Length of buffer
+ * @ret len		Length of header value, or negative error
+ */
+static int http_format_if_none_match ( struct http_transaction *http,
+				       char *buf, size_t len ) {
+	struct http_cache_entry *entry;
+
+	/* Construct entity tag, if applicable */
+	entry = http_cache_request ( http );
+	if ( ! ( entry && entry->etag ) )
+		return 0;
+	return snprintf ( buf, len, "%s", entry->etag );
+}
+
+/** HTTP "If-None-Match" header */
+struct http_request_header http_request_if_none_match __http_request_header = {
+	.name = "If-None-Match",
+	.format = http_format_if_none_match,
+};
+
+/**
+ * Construct HTTP "If-Modified-Since" header
+ *
+ * @v http		HTTP transaction
+ * @v buf		Buffer
+ * @v len		Length of buffer
+ * @ret len		Length of header value, or negative error
+ */
+static int http_format_if_modified_since ( struct http_transaction *http,
+					   char *buf, size_t len ) {
+	struct http_cache_entry *entry;
+
+	/* Construct modification time, if applicable */
+	entry = http_cache_request ( http );
+	if ( ! ( entry && entry->modified ) )
+		return 0;
+	return snprintf ( buf, len, "%s", entry->modified );
+}
+
+/** HTTP "If-Modified-Since" header */
+struct http_request_header http_request_if_modified_since
+__http_request_header = {
+	.name = "If-Modified-Since",
+	.format = http_format_if_modified_since,
+};
+
+/**
+ * Discard some cached data
+ *
+ * @ret discarded	Number of cached items discarded
+ */
+static unsigned int http_cache_discard ( void ) {
+	struct http_cache_entry *entry;
+
+	/* Discard least recently used entry not otherwise in use */
+	list_for_each_entry_reverse ( entry, &http_cache, list ) {
+
+		/* Skip images for which another reference is held */
+		if ( entry->image && ( entry->image->refcnt.count > 0 ) )
+			continue;
+
+		/* Discard entry */
+		http_cache_free ( entry );
+		return 1;
+	}
+
+	return 0;
+}
+
+/** HTTP image cache discarder */
+struct cache_discarder http_cache_discarder __cache_discarder ( CACHE_NORMAL )={
+	.name = "httpcache",
+	.discard = http_cache_discard,
+};
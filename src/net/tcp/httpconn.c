@@ -28,6 +28,22 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  *
  * Hyper Text Transfer Protocol (HTTP) connection management
  *
+ * Idempotent requests may be pipelined on to a busy connection to
+ * the same server, once the server has indicated that it supports
+ * persistent connections.  Each pipelined request is transmitted as soon as
+ * all preceding requests on the connection have been transmitted,
+ * and is attached to the connection's data transfer interface when
+ * the preceding response has been completely received.  If the
+ * connection closes before a pipelined request receives its
+ * response, the client is asked to reopen the request via a new
+ * connection.
+ *
+ * An alternative protocol (such as HTTP/2) may be negotiated via the
+ * TLS handshake.  Any request (including requests that may not be
+ * pipelined) may be queued on a new connection while negotiation is
+ * in progress.  If an alternative protocol is selected, then all
+ * queued requests are handed over to it.  Otherwise, any queued
+ * requests that may not be pipelined are reopened elsewhere.
  */
 
 #include <stdlib.h>
@@ -48,6 +64,33 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 /** HTTP connection pool */
 static LIST_HEAD ( http_connection_pool );
 
+/** HTTP connections accepting pipelined requests */
+static LIST_HEAD ( http_connection_pipelines );
+
+/** A pipelined HTTP request */
+struct http_pipelined {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** HTTP connection */
+	struct http_connection *conn;
+	/** List of pipelined requests */
+	struct list_head list;
+	/** Data transfer interface */
+	struct interface xfer;
+	/** Flags */
+	unsigned int flags;
+};
+
+/** Pipelined HTTP request flags */
+enum http_pipelined_flags {
+	/** Request has been transmitted */
+	HTTP_PIPELINED_SENT = 0x0001,
+	/** Request has been abandoned by the client */
+	HTTP_PIPELINED_ABANDONED = 0x0002,
+	/** Request may not be pipelined, and is awaiting negotiation */
+	HTTP_PIPELINED_TENTATIVE = 0x0004,
+};
+
 /**
  * Identify HTTP scheme
  *
@@ -84,6 +127,111 @@ static void http_conn_free ( struct refcnt *refcnt ) {
 	free ( conn );
 }
 
+/**
+ * Check if HTTP connection matches server
+ *
+ * @v conn		HTTP connection
+ * @v scheme		HTTP scheme
+ * @v uri		Server URI
+ * @v port		Server port
+ * @v scope_id		Network device scope ID, or zero
+ * @ret matches		Connection matches server
+ */
+static int http_conn_matches ( struct http_connection *conn,
+			       struct http_scheme *scheme, struct uri *uri,
+			       unsigned int port, unsigned int scope_id ) {
+
+	/* Sanity checks */
+	assert ( conn->uri != NULL );
+	assert ( conn->uri->host != NULL );
+
+	return ( ( scheme == conn->scheme ) &&
+		 ( strcmp ( uri->host, conn->uri->host ) == 0 ) &&
+		 ( port == uri_port ( conn->uri, scheme->port ) ) &&
+		 ( scope_id == conn->scope_id ) );
+}
+
+/**
+ * Start accepting pipelined requests on HTTP connection
+ *
+ * @v conn		HTTP connection
+ * @v pipeline		Current request permits pipelining
+ */
+static void http_conn_pipeline ( struct http_connection *conn,
+				 int pipeline ) {
+
+	/* Sanity check */
+	assert ( list_empty ( &conn->list ) );
+	assert ( list_empty ( &conn->pipeline ) );
+
+	/* Accept pipelined requests only if the current request
+	 * itself permits pipelining.  Accept any request while
+	 * protocol negotiation is still in progress.
+	 */
+	conn->flags &= ~( HTTP_CONN_PIPELINE | HTTP_CONN_SENT );
+	if ( pipeline )
+		conn->flags |= HTTP_CONN_PIPELINE;
+	if ( pipeline || ! ( conn->flags & HTTP_CONN_NEGOTIATED ) )
+		list_add_tail ( &conn->list, &http_connection_pipelines );
+}
+
+/**
+ * Stop accepting pipelined requests on HTTP connection
+ *
+ * @v conn		HTTP connection
+ */
+static void http_conn_unpipeline ( struct http_connection *conn ) {
+
+	/* Remove from list of connections accepting pipelined requests */
+	list_del ( &conn->list );
+	INIT_LIST_HEAD ( &conn->list );
+	conn->flags &= ~HTTP_CONN_PIPELINE;
+}
+
+/**
+ * Allow next pipelined request to be transmitted
+ *
+ * @v conn		HTTP connection
+ */
+static void http_conn_pipeline_step ( struct http_connection *conn ) {
+	struct http_pipelined *pipelined;
+
+	/* Do nothing until current request has been transmitted */
+	if ( ! ( conn->flags & HTTP_CONN_SENT ) )
+		return;
+
+	/* Notify first untransmitted request that window has opened */
+	list_for_each_entry ( pipelined, &conn->pipeline, list ) {
+		if ( ! ( pipelined->flags & HTTP_PIPELINED_SENT ) ) {
+			xfer_window_changed ( &pipelined->xfer );
+			return;
+		}
+	}
+}
+
+/**
+ * Remove pipelined request and suggest that the client reopen it
+ *
+ * @v pipelined		Pipelined HTTP request
+ * @v rc		Reason for close
+ */
+static void http_pipelined_reopen ( struct http_pipelined *pipelined,
+				    int rc ) {
+
+	/* Remove from pipeline */
+	list_del ( &pipelined->list );
+	INIT_LIST_HEAD ( &pipelined->list );
+
+	/* Suggest that the client should reopen the connection, and
+	 * close the interface.
+	 */
+	pool_reopen ( &pipelined->xfer );
+	intf_shutdown ( &pipelined->xfer, rc );
+
+	/* Drop pipeline's reference */
+	ref_put ( &pipelined->refcnt );
+}
+
 /**
  * Close HTTP connection
  *
@@ -91,10 +239,21 @@ static void http_conn_free ( struct refcnt *refcnt ) {
  * @v rc		Reason for close
  */
 static void http_conn_close ( struct http_connection *conn, int rc ) {
+	struct http_pipelined *pipelined;
+
+	/* Stop accepting pipelined requests */
+	http_conn_unpipeline ( conn );
 
 	/* Remove from connection pool, if applicable */
 	pool_del ( &conn->pool );
 
+	/* Reopen any requests still awaiting responses */
+	while ( ( pipelined = list_first_entry ( &conn->pipeline,
+						 struct http_pipelined,
+						 list ) ) ) {
+		http_pipelined_reopen ( pipelined, rc );
+	}
+
 	/* Shut down interfaces */
 	intf_shutdown ( &conn->socket, rc );
 	intf_shutdown ( &conn->xfer, rc );
@@ -108,6 +267,96 @@ static void http_conn_close ( struct http_connection *conn, int rc ) {
 	}
 }
 
+/**
+ * Hand over requests to alternative protocol
+ *
+ * @v conn		HTTP connection
+ * @v protocol		Alternative protocol
+ */
+static void http_conn_handover ( struct http_connection *conn,
+				 struct http_protocol *protocol ) {
+	struct http_pipelined *pipelined;
+	unsigned int port = uri_port ( conn->uri, conn->scheme->port );
+	int rc;
+
+	/* Hand over current request */
+	if ( ( rc = protocol->connect ( conn->xfer.dest, conn->scheme,
+					conn->uri, port ) ) <= 0 ) {
+		if ( rc == 0 )
+			rc = -ENOTCONN;
+		DBGC ( conn, "HTTPCONN %p could not hand over request: %s\n",
+		       conn, strerror ( rc ) );
+		intf_shutdown ( &conn->xfer, rc );
+	}
+	intf_nullify ( &conn->xfer );
+	intf_unplug ( &conn->xfer );
+
+	/* Hand over any queued requests */
+	while ( ( pipelined = list_first_entry ( &conn->pipeline,
+						 struct http_pipelined,
+						 list ) ) ) {
+		if ( ( rc = protocol->connect ( pipelined->xfer.dest,
+						conn->scheme, conn->uri,
+						port ) ) <= 0 ) {
+			if ( rc == 0 )
+				rc = -ENOTCONN;
+			DBGC ( conn, "HTTPCONN %p could not hand over "
+			       "request %p: %s\n",
+			       conn, pipelined, strerror ( rc ) );
+			intf_shutdown ( &pipelined->xfer, rc );
+		}
+		list_del ( &pipelined->list );
+		INIT_LIST_HEAD ( &pipelined->list );
+		intf_nullify ( &pipelined->xfer );
+		intf_unplug ( &pipelined->xfer );
+		ref_put ( &pipelined->refcnt );
+	}
+
+	/* Close (now unused) connection */
+	DBGC2 ( conn, "HTTPCONN %p handed over to %s\n",
+		conn, protocol->name );
+	http_conn_close ( conn, 0 );
+}
+
+/**
+ * Complete application-layer protocol negotiation
+ *
+ * @v conn		HTTP connection
+ * @ret upgraded	Connection was taken over, or negative error
+ */
+static int http_conn_negotiate ( struct http_connection *conn ) {
+	struct http_protocol *protocol;
+	struct http_pipelined *pipelined;
+	struct http_pipelined *tmp;
+	int upgraded;
+
+	/* Mark negotiation as complete */
+	conn->flags |= HTTP_CONN_NEGOTIATED;
+
+	/* Hand over to an alternative protocol, if negotiated */
+	for_each_table_entry ( protocol, HTTP_PROTOCOLS ) {
+		upgraded = protocol->upgrade ( conn );
+		if ( upgraded < 0 )
+			return upgraded;
+		if ( upgraded ) {
+			http_conn_handover ( conn, protocol );
+			return upgraded;
+		}
+	}
+
+	/* Otherwise, stop accepting requests that may not be
+	 * pipelined, and reopen any such requests elsewhere.
+	 */
+	if ( ! ( conn->flags & HTTP_CONN_PIPELINE ) )
+		http_conn_unpipeline ( conn );
+	list_for_each_entry_safe ( pipelined, tmp, &conn->pipeline, list ) {
+		if ( pipelined->flags & HTTP_PIPELINED_TENTATIVE )
+			http_pipelined_reopen ( pipelined, -ECANCELED );
+	}
+
+	return 0;
+}
+
 /**
  * Disconnect idle HTTP connection
  *
@@ -140,6 +389,33 @@ static int http_conn_socket_deliver ( struct http_connection *conn,
 	return xfer_deliver ( &conn->xfer, iobuf, meta );
 }
 
+/**
+ * Handle transport layer window change
+ *
+ * @v conn		HTTP connection
+ */
+static void http_conn_socket_window_changed ( struct http_connection *conn ) {
+	int upgraded;
+
+	/* Complete protocol negotiation once transport layer is ready */
+	if ( ( ! ( conn->flags & HTTP_CONN_NEGOTIATED ) ) &&
+	     xfer_window ( &conn->socket ) ) {
+		upgraded = http_conn_negotiate ( conn );
+		if ( upgraded < 0 ) {
+			http_conn_close ( conn, upgraded );
+			return;
+		}
+		if ( upgraded )
+			return;
+	}
+
+	/* Pass on to data transfer interface */
+	xfer_window_changed ( &conn->xfer );
+
+	/* Allow next pipelined request to be transmitted */
+	http_conn_pipeline_step ( conn );
+}
+
 /**
  * Close HTTP connection transport layer interface
  *
@@ -147,6 +423,21 @@ static int http_conn_socket_deliver ( struct http_connection *conn,
  * @v rc		Reason for close
  */
 static void http_conn_socket_close ( struct http_connection *conn, int rc ) {
+	struct http_pipelined *pipelined;
+
+	/* Fail any requests awaiting protocol negotiation, since a new
+	 * connection would be expected to fail in the same way.
+	 */
+	if ( ! ( conn->flags & HTTP_CONN_NEGOTIATED ) ) {
+		while ( ( pipelined = list_first_entry ( &conn->pipeline,
+							 struct http_pipelined,
+							 list ) ) ) {
+			list_del ( &pipelined->list );
+			INIT_LIST_HEAD ( &pipelined->list );
+			intf_shutdown ( &pipelined->xfer, rc );
+			ref_put ( &pipelined->refcnt );
+		}
+	}
 
 	/* If we are reopenable (i.e. we are a recycled connection
 	 * from the connection pool, and we have received no data from
@@ -169,9 +460,109 @@ static void http_conn_xfer_recycle ( struct http_connection *conn ) {
 
 	/* Mark connection as recyclable */
 	pool_recyclable ( &conn->pool );
+	conn->flags |= HTTP_CONN_PERSISTENT;
 	DBGC2 ( conn, "HTTPCONN %p keepalive enabled\n", conn );
 }
 
+/**
+ * Transmit data on HTTP connection
+ *
+ * @v conn		HTTP connection
+ * @v iobuf		I/O buffer
+ * @v meta		Transfer metadata
+ * @ret rc		Return status code
+ */
+static int http_conn_xfer_deliver ( struct http_connection *conn,
+				    struct io_buffer *iobuf,
+				    struct xfer_metadata *meta ) {
+	int rc;
+
+	/* Mark current request as transmitted */
+	conn->flags |= HTTP_CONN_SENT;
+
+	/* Pass on to transport layer interface */
+	rc = xfer_deliver ( &conn->socket, iobuf, meta );
+
+	/* Allow next pipelined request to be transmitted */
+	http_conn_pipeline_step ( conn );
+
+	return rc;
+}
+
+/**
+ * Receive data beyond the end of the current response
+ *
+ * @v conn		HTTP connection
+ * @v iobuf		I/O buffer
+ * @ret rc		Return status code
+ *
+ * Any data received beyond the end of a response belongs to the
+ * response to the next pipelined request, which will already have
+ * been attached to the data transfer interface.
+ */
+static int http_conn_xfer_pushback ( struct http_connection *conn,
+				     struct io_buffer *iobuf ) {
+
+	/* Close connection if there is no request to receive the data */
+	if ( ! list_empty ( &conn->pool.list ) ) {
+		DBGC ( conn, "HTTPCONN %p unexpected data:\n", conn );
+		DBGC_HDA ( conn, 0, iobuf->data, iob_len ( iobuf ) );
+		free_iob ( iobuf );
+		http_conn_close ( conn, -EPROTO );
+		return -EPROTO;
+	}
+
+	/* Mark connection as alive */
+	pool_alive ( &conn->pool );
+
+	/* Pass on to data transfer interface */
+	return xfer_deliver_iob ( &conn->xfer, iobuf );
+}
+
+/**
+ * Attach next pipelined request to HTTP connection
+ *
+ * @v conn		HTTP connection
+ * @v pipelined		Pipelined HTTP request
+ */
+static void http_conn_promote ( struct http_connection *conn,
+				struct http_pipelined *pipelined ) {
+
+	/* Close connection if the next response has been abandoned,
+	 * since there is no way to skip over it.
+	 */
+	if ( pipelined->flags & HTTP_PIPELINED_ABANDONED ) {
+		http_conn_close ( conn, 0 );
+		return;
+	}
+
+	/* Remove from pipeline */
+	list_del ( &pipelined->list );
+	INIT_LIST_HEAD ( &pipelined->list );
+
+	/* Treat as a freshly recycled connection, so that the request
+	 * can be reopened if the server closes the connection before
+	 * sending the response.
+	 */
+	pool_del ( &conn->pool );
+	conn->flags &= ~HTTP_CONN_SENT;
+	if ( pipelined->flags & HTTP_PIPELINED_SENT )
+		conn->flags |= HTTP_CONN_SENT;
+
+	/* Attach client directly to data transfer interface */
+	intf_plug_plug ( &conn->xfer, pipelined->xfer.dest );
+	intf_nullify ( &pipelined->xfer );
+	intf_unplug ( &pipelined->xfer );
+	DBGC2 ( conn, "HTTPCONN %p attached pipelined request %p\n",
+		conn, pipelined );
+
+	/* Drop pipeline's reference */
+	ref_put ( &pipelined->refcnt );
+
+	/* Notify client that window may have changed */
+	xfer_window_changed ( &conn->xfer );
+}
+
 /**
  * Close HTTP connection data transfer interface
  *
@@ -179,12 +570,24 @@ static void http_conn_xfer_recycle ( struct http_connection *conn ) {
  * @v rc		Reason for close
  */
 static void http_conn_xfer_close ( struct http_connection *conn, int rc ) {
+	struct http_pipelined *pipelined;
 
 	/* Add to the connection pool if keepalive is enabled and no
 	 * error occurred.
 	 */
 	if ( ( rc == 0 ) && pool_is_recyclable ( &conn->pool ) ) {
 		intf_restart ( &conn->xfer, rc );
+
+		/* Hand over to the next pipelined request, if any */
+		pipelined = list_first_entry ( &conn->pipeline,
+					       struct http_pipelined, list );
+		if ( pipelined ) {
+			http_conn_promote ( conn, pipelined );
+			return;
+		}
+
+		/* Otherwise, add to the connection pool */
+		http_conn_unpipeline ( conn );
 		pool_add ( &conn->pool, &http_connection_pool,
 			   HTTP_CONN_EXPIRY );
 		DBGC2 ( conn, "HTTPCONN %p pooled %s://%s\n",
@@ -200,6 +603,8 @@ static void http_conn_xfer_close ( struct http_connection *conn, int rc ) {
 static struct interface_operation http_conn_socket_operations[] = {
 	INTF_OP ( xfer_deliver, struct http_connection *,
 		  http_conn_socket_deliver ),
+	INTF_OP ( xfer_window_changed, struct http_connection *,
+		  http_conn_socket_window_changed ),
 	INTF_OP ( intf_close, struct http_connection *,
 		  http_conn_socket_close ),
 };
@@ -211,6 +616,10 @@ static struct interface_descriptor http_conn_socket_desc =
 
 /** HTTP connection data transfer interface operations */
 static struct interface_operation http_conn_xfer_operations[] = {
+	INTF_OP ( xfer_deliver, struct http_connection *,
+		  http_conn_xfer_deliver ),
+	INTF_OP ( http_pushback, struct http_connection *,
+		  http_conn_xfer_pushback ),
 	INTF_OP ( pool_recycle, struct http_connection *,
 		  http_conn_xfer_recycle ),
 	INTF_OP ( intf_close, struct http_connection *,
@@ -222,18 +631,215 @@ static struct interface_descriptor http_conn_xfer_desc =
 	INTF_DESC_PASSTHRU ( struct http_connection, xfer,
 			     http_conn_xfer_operations, socket );
 
+/**
+ * Free pipelined HTTP request
+ *
+ * @v refcnt		Reference count
+ */
+static void http_pipelined_free ( struct refcnt *refcnt ) {
+	struct http_pipelined *pipelined =
+		container_of ( refcnt, struct http_pipelined, refcnt );
+
+	ref_put ( &pipelined->conn->refcnt );
+	free ( pipelined );
+}
+
+/**
+ * Check pipelined HTTP request transmit window
+ *
+ * @v pipelined		Pipelined HTTP request
+ * @ret len		Length of window
+ */
+static size_t http_pipelined_window ( struct http_pipelined *pipelined ) {
+	struct http_connection *conn = pipelined->conn;
+	struct http_pipelined *prev;
+
+	/* Transmit only a single request, and only if permitted */
+	if ( pipelined->flags & ( HTTP_PIPELINED_SENT |
+				  HTTP_PIPELINED_TENTATIVE ) )
+		return 0;
+
+	/* Transmit requests in order */
+	if ( ! ( conn->flags & HTTP_CONN_SENT ) )
+		return 0;
+	list_for_each_entry ( prev, &conn->pipeline, list ) {
+		if ( prev == pipelined )
+			break;
+		if ( ! ( prev->flags & HTTP_PIPELINED_SENT ) )
+			return 0;
+	}
+
+	return xfer_window ( &conn->socket );
+}
+
+/**
+ * Transmit pipelined HTTP request
+ *
+ * @v pipelined		Pipelined HTTP request
+ * @v iobuf		I/O buffer
+ * @v meta		Transfer metadata
+ * @ret rc		Return status code
+ */
+static int http_pipelined_deliver ( struct http_pipelined *pipelined,
+				    struct io_buffer *iobuf,
+				    struct xfer_metadata *meta ) {
+	struct http_connection *conn = pipelined->conn;
+	int rc;
+
+	/* Mark request as transmitted */
+	pipelined->flags |= HTTP_PIPELINED_SENT;
+
+	/* Pass on to transport layer interface */
+	rc = xfer_deliver ( &conn->socket, iobuf, meta );
+
+	/* Allow next pipelined request to be transmitted */
+	http_conn_pipeline_step ( conn );
+
+	return rc;
+}
+
+/**
+ * Close pipelined HTTP request
+ *
+ * @v pipelined		Pipelined HTTP request
+ * @v rc		Reason for close
+ */
+static void http_pipelined_close ( struct http_pipelined *pipelined, int rc ) {
+	struct http_connection *conn = pipelined->conn;
+	struct http_pipelined *next;
+
+	/* Shut down interface */
+	intf_shutdown ( &pipelined->xfer, rc );
+
+	/* Do nothing more if no longer part of the pipeline */
+	if ( list_empty ( &pipelined->list ) )
+		return;
+
+	/* If the request has not yet been transmitted, then simply
+	 * remove it from the pipeline.
+	 */
+	if ( ! ( pipelined->flags & HTTP_PIPELINED_SENT ) ) {
+		list_del ( &pipelined->list );
+		INIT_LIST_HEAD ( &pipelined->list );
+		ref_put ( &pipelined->refcnt );
+		http_conn_pipeline_step ( conn );
+		return;
+	}
+
+	/* Otherwise, the response will still arrive and cannot be
+	 * skipped over.  Leave the abandoned request in place (so
+	 * that the connection will be closed when its response is
+	 * reached), stop accepting pipelined requests, and reopen all
+	 * subsequent requests elsewhere.
+	 */
+	DBGC ( conn, "HTTPCONN %p abandoned pipelined request %p: %s\n",
+	       conn, pipelined, strerror ( rc ) );
+	pipelined->flags |= HTTP_PIPELINED_ABANDONED;
+	http_conn_unpipeline ( conn );
+	while ( ( next = list_next_entry ( pipelined, &conn->pipeline,
+					   list ) ) ) {
+		http_pipelined_reopen ( next, -ECANCELED );
+	}
+}
+
+/** Pipelined HTTP request data transfer interface operations */
+static struct interface_operation http_pipelined_xfer_operations[] = {
+	INTF_OP ( xfer_window, struct http_pipelined *,
+		  http_pipelined_window ),
+	INTF_OP ( xfer_deliver, struct http_pipelined *,
+		  http_pipelined_deliver ),
+	INTF_OP ( intf_close, struct http_pipelined *,
+		  http_pipelined_close ),
+};
+
+/** Pipelined HTTP request data transfer interface descriptor */
+static struct interface_descriptor http_pipelined_xfer_desc =
+	INTF_DESC ( struct http_pipelined, xfer,
+		    http_pipelined_xfer_operations );
+
+/**
+ * Pipeline request on to busy HTTP connection
+ *
+ * @v conn		HTTP connection
+ * @v xfer		Data transfer interface
+ * @v pipeline		Request may be pipelined
+ * @ret rc		Return status code
+ */
+static int http_conn_pipeline_open ( struct http_connection *conn,
+				     struct interface *xfer, int pipeline ) {
+	struct http_pipelined *pipelined;
+
+	/* Allocate and initialise structure */
+	pipelined = zalloc ( sizeof ( *pipelined ) );
+	if ( ! pipelined )
+		return -ENOMEM;
+	ref_init ( &pipelined->refcnt, http_pipelined_free );
+	intf_init ( &pipelined->xfer, &http_pipelined_xfer_desc,
+		    &pipelined->refcnt );
+	ref_get ( &conn->refcnt );
+	pipelined->conn = conn;
+	if ( ! pipeline )
+		pipelined->flags |= HTTP_PIPELINED_TENTATIVE;
+
+	/* Add to pipeline (which takes ownership of our reference)
+	 * and attach to parent interface.
+	 */
+	list_add_tail ( &pipelined->list, &conn->pipeline );
+	intf_plug_plug ( &pipelined->xfer, xfer );
+
+	DBGC2 ( conn, "HTTPCONN %p pipelined request %p\n", conn, pipelined );
+	return 0;
+}
+
+/**
+ * Receive data beyond the end of an HTTP response
+ *
+ * @v intf		Data transfer interface
+ * @v iobuf		I/O buffer
+ * @ret rc		Return status code
+ */
+int http_pushback ( struct interface *intf, struct io_buffer *iobuf ) {
+	struct interface *dest;
+	http_pushback_TYPE ( void * ) *op =
+		intf_get_dest_op ( intf, http_pushback, &dest );
+	void *object = intf_object ( dest );
+	int rc;
+
+	if ( op ) {
+		rc = op ( object, iobuf );
+	} else {
+		/* Default is to discard the data */
+		free_iob ( iobuf );
+		rc = -EPIPE;
+	}
+
+	intf_put ( dest );
+	return rc;
+}
+
 /**
  * Connect to an HTTP server
  *
  * @v xfer		Data transfer interface
  * @v uri		Connection URI
+ * @v pipeline		Request may be pipelined
+ * @v scope_id		Network device scope ID, or zero to use any
  * @ret rc		Return status code
  *
  * HTTP connections are pooled.  The caller should be prepared to
  * receive a pool_reopen() message.
+ *
+ * Requests that may be pipelined will reuse an idle pooled
+ * connection if one is available, and will otherwise be pipelined
+ * on to a busy connection to the same server.  Any request will use
+ * an existing connection via an alternative protocol, if available.
  */
-int http_connect ( struct interface *xfer, struct uri *uri ) {
+int http_connect ( struct interface *xfer, struct uri *uri, int pipeline,
+		   unsigned int scope_id ) {
+	struct http_protocol *protocol;
 	struct http_connection *conn;
+	struct list_head *entry;
+	unsigned int depth;
 	struct http_scheme *scheme;
 	struct sockaddr_tcpip server;
 	struct interface *socket;
@@ -252,6 +858,20 @@ int http_connect ( struct interface *xfer, struct uri *uri ) {
 	/* Identify port */
 	port = uri_port ( uri, scheme->port );
 
+	/* Use an existing alternative protocol connection, if
+	 * possible.  Such connections are not bound to any specific
+	 * network device.
+	 */
+	for_each_table_entry ( protocol, HTTP_PROTOCOLS ) {
+		if ( scope_id )
+			break;
+		rc = protocol->connect ( xfer, scheme, uri, port );
+		if ( rc < 0 )
+			return rc;
+		if ( rc > 0 )
+			return 0;
+	}
+
 	/* Look for a reusable connection in the pool.  Reuse the most
 	 * recent connection in order to accommodate authentication
 	 * schemes that break the stateless nature of HTTP and rely on
@@ -260,19 +880,15 @@ int http_connect ( struct interface *xfer, struct uri *uri ) {
 	 */
 	list_for_each_entry_reverse ( conn, &http_connection_pool, pool.list ) {
 
-		/* Sanity checks */
-		assert ( conn->uri != NULL );
-		assert ( conn->uri->host != NULL );
-
 		/* Reuse connection, if possible */
-		if ( ( scheme == conn->scheme ) &&
-		     ( strcmp ( uri->host, conn->uri->host ) == 0 ) &&
-		     ( port == uri_port ( conn->uri, scheme->port ) ) ) {
+		if ( http_conn_matches ( conn, scheme, uri, port,
+					 scope_id ) ) {
 
 			/* Remove from connection pool, stop timer,
 			 * attach to parent interface, and return.
 			 */
 			pool_del ( &conn->pool );
+			http_conn_pipeline ( conn, pipeline );
 			intf_plug_plug ( &conn->xfer, xfer );
 			DBGC2 ( conn, "HTTPCONN %p reused %s://%s:%d\n", conn,
 				conn->scheme->name, conn->uri->host, port );
@@ -280,6 +896,39 @@ int http_connect ( struct interface *xfer, struct uri *uri ) {
 		}
 	}
 
+	/* Look for a busy connection accepting pipelined requests, or
+	 * a new connection still negotiating its protocol.
+	 */
+	list_for_each_entry ( conn, &http_connection_pipelines, list ) {
+
+		/* Check server */
+		if ( ! http_conn_matches ( conn, scheme, uri, port,
+					   scope_id ) )
+			continue;
+
+		/* Check that request may be queued.  Do not pipeline
+		 * requests until the server has indicated that it will
+		 * not close the connection after the current response,
+		 * since a server closing a connection with unread
+		 * requests will typically send a TCP reset that may
+		 * destroy the end of the current response.
+		 */
+		if ( ! ( ( pipeline &&
+			   ( conn->flags & HTTP_CONN_PERSISTENT ) ) ||
+			 ( ! ( conn->flags & HTTP_CONN_NEGOTIATED ) ) ) )
+			continue;
+
+		/* Check pipeline depth */
+		depth = 0;
+		list_for_each ( entry, &conn->pipeline )
+			depth++;
+		if ( depth >= HTTP_CONN_PIPELINE_MAX )
+			continue;
+
+		/* Pipeline request on to this connection */
+		return http_conn_pipeline_open ( conn, xfer, pipeline );
+	}
+
 	/* Allocate and initialise structure */
 	conn = zalloc ( sizeof ( *conn ) );
 	if ( ! conn ) {
@@ -289,13 +938,23 @@ int http_connect ( struct interface *xfer, struct uri *uri ) {
 	ref_init ( &conn->refcnt, http_conn_free );
 	conn->uri = uri_get ( uri );
 	conn->scheme = scheme;
+	conn->scope_id = scope_id;
 	intf_init ( &conn->socket, &http_conn_socket_desc, &conn->refcnt );
 	intf_init ( &conn->xfer, &http_conn_xfer_desc, &conn->refcnt );
 	pool_init ( &conn->pool, http_conn_expired, &conn->refcnt );
+	INIT_LIST_HEAD ( &conn->list );
+	INIT_LIST_HEAD ( &conn->pipeline );
+
+	/* An alternative protocol may be negotiated only via a
+	 * transport-layer filter (i.e. TLS).
+	 */
+	if ( ! ( scheme->filter && table_num_entries ( HTTP_PROTOCOLS ) ) )
+		conn->flags |= HTTP_CONN_NEGOTIATED;
 
 	/* Open socket */
 	memset ( &server, 0, sizeof ( server ) );
 	server.st_port = htons ( port );
+	server.st_scope_id = scope_id;
 	socket = &conn->socket;
 	if ( scheme->filter &&
 	     ( ( rc = scheme->filter ( socket, uri->host, &socket ) ) != 0 ) )
@@ -306,6 +965,7 @@ int http_connect ( struct interface *xfer, struct uri *uri ) {
 		goto err_open;
 
 	/* Attach to parent interface, mortalise self, and return */
+	http_conn_pipeline ( conn, pipeline );
 	intf_plug_plug ( &conn->xfer, xfer );
 	ref_put ( &conn->refcnt );
 
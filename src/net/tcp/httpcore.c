@@ -86,6 +86,12 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #define EIO_5XX __einfo_error ( EINFO_EIO_5XX )
 #define EINFO_EIO_5XX \
 	__einfo_uniqify ( EINFO_EIO, 0x05, "HTTP 5xx Server Error" )
+#define EIO_CONTENT_CHANGED __einfo_error ( EINFO_EIO_CONTENT_CHANGED )
+#define EINFO_EIO_CONTENT_CHANGED \
+	__einfo_uniqify ( EINFO_EIO, 0x06, "Content changed during transfer" )
+#define EIO_CONTENT_RANGE __einfo_error ( EINFO_EIO_CONTENT_RANGE )
+#define EINFO_EIO_CONTENT_RANGE \
+	__einfo_uniqify ( EINFO_EIO, 0x07, "Content range mismatch" )
 #define ENOENT_404 __einfo_error ( EINFO_ENOENT_404 )
 #define EINFO_ENOENT_404 \
 	__einfo_uniqify ( EINFO_ENOENT, 0x01, "HTTP 404 Not Found" )
@@ -95,6 +101,9 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #define ENOTSUP_TRANSFER __einfo_error ( EINFO_ENOTSUP_TRANSFER )
 #define EINFO_ENOTSUP_TRANSFER \
 	__einfo_uniqify ( EINFO_ENOTSUP, 0x02, "Unsupported transfer encoding" )
+#define EPIPE_STREAM __einfo_error ( EINFO_EPIPE_STREAM )
+#define EINFO_EPIPE_STREAM \
+	__einfo_uniqify ( EINFO_EPIPE, 0x01, "Cannot resend streamed content" )
 #define EPERM_403 __einfo_error ( EINFO_EPERM_403 )
 #define EINFO_EPERM_403 \
 	__einfo_uniqify ( EINFO_EPERM, 0x01, "HTTP 403 Forbidden" )
@@ -105,6 +114,24 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 /** Retry delay used when we cannot understand the Retry-After header */
 #define HTTP_RETRY_SECONDS 5
 
+/** Initial retry delay for an overloaded server with no Retry-After
+ * header
+ */
+#define HTTP_BACKOFF_MIN_SECONDS 1
+
+/** Maximum retry delay for an overloaded server with no Retry-After
+ * header
+ */
+#define HTTP_BACKOFF_MAX_SECONDS 64
+
+/** Maximum number of retries for an overloaded server with no
+ * Retry-After header
+ */
+#define HTTP_BACKOFF_MAX_RETRIES 10
+
+/** Maximum number of consecutive resumption attempts without progress */
+#define HTTP_RESUME_MAX 5
+
 /** Receive profiler */
 static struct profiler http_rx_profiler __profiler = { .name = "http.rx" };
 
@@ -144,6 +171,11 @@ struct http_method http_post = {
 	.name = "POST",
 };
 
+/** HTTP PUT method */
+struct http_method http_put = {
+	.name = "PUT",
+};
+
 /******************************************************************************
  *
  * Utility functions
@@ -180,6 +212,41 @@ static int http_rx_linebuf ( struct http_transaction *http,
 	return 0;
 }
 
+/**
+ * Handle received HTTP line
+ *
+ * @v http		HTTP transaction
+ * @v iobuf		I/O buffer
+ * @v linebuf		Line buffer
+ * @v line		Completed line to fill in, or NULL
+ * @ret rc		Return status code
+ *
+ * A line wholly contained within the I/O buffer is parsed in place
+ * (and remains valid only until the I/O buffer is freed), with the
+ * line buffer used only for lines that span multiple I/O buffers.
+ */
+static int http_rx_line ( struct http_transaction *http,
+			  struct io_buffer *iobuf,
+			  struct line_buffer *linebuf, char **line ) {
+	int consumed;
+	int rc;
+
+	/* Extract line */
+	consumed = line_buffer_inplace ( linebuf, iobuf->data,
+					 iob_len ( iobuf ), line );
+	if ( consumed < 0 ) {
+		rc = consumed;
+		DBGC ( http, "HTTP %p could not buffer line: %s\n",
+		       http, strerror ( rc ) );
+		return rc;
+	}
+
+	/* Consume line */
+	iob_pull ( iobuf, consumed );
+
+	return 0;
+}
+
 /**
  * Get HTTP response token
  *
@@ -264,6 +331,8 @@ static void http_free ( struct refcnt *refcnt ) {
 
 	empty_line_buffer ( &http->response.headers );
 	empty_line_buffer ( &http->linebuf );
+	free ( http->request.resume.validator );
+	uri_put ( http->location );
 	uri_put ( http->uri );
 	free ( http );
 }
@@ -299,6 +368,24 @@ static void http_close_error ( struct http_transaction *http, int rc ) {
 	http_close ( http, ( rc ? rc : -EPIPE ) );
 }
 
+/**
+ * Check if HTTP request may be pipelined
+ *
+ * @v http		HTTP transaction
+ * @ret pipeline	Request may be pipelined
+ *
+ * Only idempotent requests without request content may be pipelined.
+ * Range requests are excluded, since these are used to perform
+ * concurrent downloads via independent connections.
+ */
+static int http_pipelinable ( struct http_transaction *http ) {
+
+	return ( ( ( http->request.method == &http_get ) ||
+		   ( http->request.method == &http_head ) ) &&
+		 ( http->request.content.len == 0 ) &&
+		 ( http->request.range.len == 0 ) );
+}
+
 /**
  * Reopen stale HTTP connection
  *
@@ -307,11 +394,19 @@ static void http_close_error ( struct http_transaction *http, int rc ) {
 static void http_reopen ( struct http_transaction *http ) {
 	int rc;
 
+	/* Streamed content has been consumed and cannot be resent */
+	if ( http->streaming ) {
+		rc = -EPIPE_STREAM;
+		goto err_stream;
+	}
+
 	/* Close existing connection */
 	intf_restart ( &http->conn, -ECANCELED );
 
 	/* Reopen connection */
-	if ( ( rc = http_connect ( &http->conn, http->uri ) ) != 0 ) {
+	if ( ( rc = http_connect ( &http->conn, http->uri,
+				   http_pipelinable ( http ),
+				   http->scope_id ) ) != 0 ) {
 		DBGC ( http, "HTTP %p could not reconnect: %s\n",
 		       http, strerror ( rc ) );
 		goto err_connect;
@@ -326,9 +421,69 @@ static void http_reopen ( struct http_transaction *http ) {
 	return;
 
  err_connect:
+ err_stream:
 	http_close ( http, rc );
 }
 
+/**
+ * Check if interrupted HTTP transfer may be resumed
+ *
+ * @v http		HTTP transaction
+ * @v rc		Reason for connection close
+ * @ret resumable	Transfer may be resumed
+ */
+static int http_resumable ( struct http_transaction *http, int rc ) {
+
+	/* Do not resume unless we have a validator for the content */
+	if ( ! http->request.resume.validator )
+		return 0;
+
+	/* Do not resume an unsuccessful response */
+	if ( http->response.rc != 0 )
+		return 0;
+
+	/* Do not resume a transfer that has completed normally (by
+	 * the server closing a connection with no content length).
+	 */
+	if ( ( rc == 0 ) && ( http->state == &http_transfer_identity.state ) &&
+	     ( ! ( http->response.flags & HTTP_RESPONSE_CONTENT_LEN ) ) )
+		return 0;
+
+	/* Give up after repeated attempts without progress */
+	if ( ( http->resumes >= HTTP_RESUME_MAX ) &&
+	     ( http->pos <= http->request.resume.offset ) )
+		return 0;
+
+	return 1;
+}
+
+/**
+ * Resume interrupted HTTP transfer
+ *
+ * @v http		HTTP transaction
+ * @v rc		Reason for connection close
+ */
+static void http_resume ( struct http_transaction *http, int rc ) {
+
+	/* Reset attempt counter if any progress has been made */
+	if ( http->pos > http->request.resume.offset )
+		http->resumes = 0;
+	http->resumes++;
+
+	/* Record resumption offset */
+	http->request.resume.offset = http->pos;
+	DBGC ( http, "HTTP %p resuming at offset %#zx after %s (attempt "
+	       "%d)\n", http, http->pos, strerror ( rc ), http->resumes );
+
+	/* Reset transfer decoding state */
+	http->len = 0;
+	http->remaining = 0;
+	empty_line_buffer ( &http->linebuf );
+
+	/* Start timer to initiate resumption */
+	start_timer_fixed ( &http->timer, ( http->resumes * TICKS_PER_SEC ) );
+}
+
 /**
  * Handle retry timer expiry
  *
@@ -351,6 +506,24 @@ static void http_expired ( struct retry_timer *timer, int over __unused ) {
 static void http_step ( struct http_transaction *http ) {
 	int rc;
 
+	/* Follow cached redirection, if applicable */
+	if ( http->location ) {
+		DBGC2 ( http, "HTTP %p using cached redirection\n", http );
+		if ( ( rc = xfer_redirect ( &http->xfer, LOCATION_URI,
+					    http->location ) ) != 0 ) {
+			DBGC ( http, "HTTP %p could not redirect: %s\n",
+			       http, strerror ( rc ) );
+		}
+		http_close ( http, rc );
+		return;
+	}
+
+	/* Allow streamed content to be delivered, if applicable */
+	if ( http->streaming ) {
+		xfer_window_changed ( &http->xfer );
+		return;
+	}
+
 	/* Do nothing if we have nothing to transmit */
 	if ( ! http->state->tx )
 		return;
@@ -389,12 +562,25 @@ static void http_step ( struct http_transaction *http ) {
 static int http_conn_deliver ( struct http_transaction *http,
 			       struct io_buffer *iobuf,
 			       struct xfer_metadata *meta __unused ) {
+	struct interface *conn;
+	http_pushback_TYPE ( void * ) *pushback =
+		intf_get_dest_op ( &http->conn, http_pushback, &conn );
+	void *object = intf_object ( conn );
 	int rc;
 
 	/* Handle received data */
 	profile_start ( &http_rx_profiler );
 	while ( iobuf && iob_len ( iobuf ) ) {
 
+		/* Return any data beyond the end of a completed
+		 * response, since this belongs to the response to a
+		 * subsequent pipelined request.
+		 */
+		if ( ( ! http->state ) && pushback ) {
+			pushback ( object, iob_disown ( iobuf ) );
+			break;
+		}
+
 		/* Sanity check */
 		if ( ( ! http->state ) || ( ! http->state->rx ) ) {
 			DBGC ( http, "HTTP %p unexpected data\n", http );
@@ -411,11 +597,13 @@ static int http_conn_deliver ( struct http_transaction *http,
 	free_iob ( iobuf );
 
 	profile_stop ( &http_rx_profiler );
+	intf_put ( conn );
 	return 0;
 
  err:
 	free_iob ( iobuf );
 	http_close ( http, rc );
+	intf_put ( conn );
 	return rc;
 }
 
@@ -434,6 +622,12 @@ static void http_conn_close ( struct http_transaction *http, int rc ) {
 	/* Restart server connection interface */
 	intf_restart ( &http->conn, rc );
 
+	/* Resume interrupted transfer, if applicable */
+	if ( http_resumable ( http, rc ) ) {
+		http_resume ( http, rc );
+		return;
+	}
+
 	/* Hand off to state-specific method */
 	http->state->close ( http, rc );
 }
@@ -458,6 +652,11 @@ static int http_content_deliver ( struct http_transaction *http,
 		return 0;
 	}
 
+	/* Track content position, to allow for resumption */
+	if ( meta->flags & XFER_FL_ABS_OFFSET )
+		http->pos = 0;
+	http->pos += ( meta->offset + iob_len ( iobuf ) );
+
 	/* Deliver to data transfer interface */
 	profile_start ( &http_xfer_profiler );
 	if ( ( rc = xfer_deliver ( &http->xfer, iob_disown ( iobuf ),
@@ -519,8 +718,187 @@ __weak int http_block_read_capacity ( struct http_transaction *http __unused,
 	return -ENOTSUP;
 }
 
+/**
+ * Handle response for caching (when HTTP caching support is not present)
+ *
+ * @v http		HTTP transaction
+ * @ret rc		Return status code
+ */
+__weak int http_cache_response ( struct http_transaction *http __unused ) {
+
+	return 0;
+}
+
+/**
+ * Find cached redirection (when HTTP redirect caching is not present)
+ *
+ * @v http		HTTP transaction
+ * @ret location	Redirection location, or NULL
+ */
+__weak struct uri * http_redirect_cached ( struct http_transaction *http
+					   __unused ) {
+
+	return NULL;
+}
+
+/**
+ * Record redirection (when HTTP redirect caching is not present)
+ *
+ * @v http		HTTP transaction
+ * @v location		Redirection location
+ */
+__weak void http_redirect_record ( struct http_transaction *http __unused,
+				   struct uri *location __unused ) {
+
+	/* Nothing to do */
+}
+
+/**
+ * Authenticate preemptively (when HTTP authentication support is not present)
+ *
+ * @v http		HTTP transaction
+ */
+__weak void http_auth_preempt ( struct http_transaction *http __unused ) {
+
+	/* Nothing to do */
+}
+
+/**
+ * Check flow control window for streamed content
+ *
+ * @v http		HTTP transaction
+ * @ret len		Length of window
+ */
+static size_t http_stream_window ( struct http_transaction *http ) {
+
+	/* Hand off to underlying interface if not streaming */
+	if ( ! http->request.content.stream )
+		return xfer_window ( &http->content );
+
+	/* Block content until request headers have been sent, and
+	 * after the final chunk has been sent.
+	 */
+	if ( ! http->streaming )
+		return 0;
+
+	/* Limit window to that of the server connection */
+	return xfer_window ( &http->conn );
+}
+
+/**
+ * Allocate I/O buffer for streamed content
+ *
+ * @v http		HTTP transaction
+ * @v len		I/O buffer payload length
+ * @ret iobuf		I/O buffer
+ */
+static struct io_buffer * http_stream_alloc_iob ( struct http_transaction *http,
+						  size_t len ) {
+	struct io_buffer *iobuf;
+
+	/* Hand off to underlying interface if not streaming */
+	if ( ! http->request.content.stream )
+		return xfer_alloc_iob ( &http->content, len );
+
+	/* Reserve space for chunk header and trailer */
+	iobuf = alloc_iob ( HTTP_STREAM_HEADER_LEN + len +
+			    HTTP_STREAM_TRAILER_LEN );
+	if ( iobuf )
+		iob_reserve ( iobuf, HTTP_STREAM_HEADER_LEN );
+	return iobuf;
+}
+
+/**
+ * Deliver streamed content
+ *
+ * @v http		HTTP transaction
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int http_stream_deliver ( struct http_transaction *http,
+				 struct io_buffer *iobuf,
+				 struct xfer_metadata *meta ) {
+	struct io_buffer *chunk;
+	char header[ HTTP_STREAM_HEADER_LEN + 1 /* NUL */ ];
+	static const char trailer[] = "\r\n";
+	static const char final[] = "0\r\n\r\n";
+	size_t header_len;
+	size_t len;
+	int rc;
+
+	/* Hand off to underlying interface if not streaming */
+	if ( ! http->request.content.stream )
+		return xfer_deliver ( &http->content, iobuf, meta );
+
+	/* Fail if content is not currently being streamed */
+	if ( ! http->streaming ) {
+		DBGC ( http, "HTTP %p unexpected streamed content\n", http );
+		rc = -EPIPE_STREAM;
+		goto err_streaming;
+	}
+
+	/* Construct chunk header and trailer, copying the data only
+	 * if the I/O buffer lacks sufficient headroom or tailroom.
+	 */
+	len = iob_len ( iobuf );
+	header_len = snprintf ( header, sizeof ( header ), "%zx\r\n", len );
+	if ( ( iob_headroom ( iobuf ) < header_len ) ||
+	     ( iob_tailroom ( iobuf ) < HTTP_STREAM_TRAILER_LEN ) ) {
+		chunk = alloc_iob ( header_len + len +
+				    HTTP_STREAM_TRAILER_LEN );
+		if ( ! chunk ) {
+			rc = -ENOMEM;
+			goto err_alloc;
+		}
+		iob_reserve ( chunk, header_len );
+		memcpy ( iob_put ( chunk, len ), iobuf->data, len );
+		free_iob ( iobuf );
+		iobuf = chunk;
+	}
+	if ( len ) {
+		memcpy ( iob_push ( iobuf, header_len ), header, header_len );
+		memcpy ( iob_put ( iobuf, ( sizeof ( trailer ) - 1 ) ),
+			 trailer, ( sizeof ( trailer ) - 1 ) );
+	}
+
+	/* Append final chunk, if applicable */
+	if ( meta->flags & XFER_FL_OUT ) {
+		memcpy ( iob_put ( iobuf, ( sizeof ( final ) - 1 ) ),
+			 final, ( sizeof ( final ) - 1 ) );
+		http->streaming = 0;
+		DBGC2 ( http, "HTTP %p finished streaming content\n", http );
+	}
+
+	/* Deliver chunk, if non-empty */
+	if ( ! iob_len ( iobuf ) ) {
+		free_iob ( iobuf );
+		return 0;
+	}
+	if ( ( rc = xfer_deliver_iob ( &http->conn,
+				       iob_disown ( iobuf ) ) ) != 0 ) {
+		DBGC ( http, "HTTP %p could not deliver chunk: %s\n",
+		       http, strerror ( rc ) );
+		goto err_deliver;
+	}
+
+	return 0;
+
+ err_deliver:
+ err_alloc:
+ err_streaming:
+	free_iob ( iobuf );
+	return rc;
+}
+
 /** HTTP data transfer interface operations */
 static struct interface_operation http_xfer_operations[] = {
+	INTF_OP ( xfer_deliver, struct http_transaction *,
+		  http_stream_deliver ),
+	INTF_OP ( xfer_window, struct http_transaction *,
+		  http_stream_window ),
+	INTF_OP ( xfer_alloc_iob, struct http_transaction *,
+		  http_stream_alloc_iob ),
 	INTF_OP ( block_read, struct http_transaction *, http_block_read ),
 	INTF_OP ( block_read_capacity, struct http_transaction *,
 		  http_block_read_capacity ),
@@ -574,18 +952,23 @@ static struct process_descriptor http_process_desc =
 	PROC_DESC_ONCE ( struct http_transaction, process, http_step );
 
 /**
- * Open HTTP transaction
+ * Open HTTP transaction via a specified network device
  *
  * @v xfer		Data transfer interface
  * @v method		Request method
  * @v uri		Request URI
  * @v range		Content range (if any)
  * @v content		Request content (if any)
+ * @v scope_id		Network device scope ID, or zero to use any
  * @ret rc		Return status code
+ *
+ * A non-zero scope ID restricts the routing of any connections made
+ * on behalf of this transaction to the specified network device.
  */
-int http_open ( struct interface *xfer, struct http_method *method,
-		struct uri *uri, struct http_request_range *range,
-		struct http_request_content *content ) {
+int http_open_via ( struct interface *xfer, struct http_method *method,
+		    struct uri *uri, struct http_request_range *range,
+		    struct http_request_content *content,
+		    unsigned int scope_id ) {
 	struct http_transaction *http;
 	struct uri request_uri;
 	struct uri request_host;
@@ -635,6 +1018,7 @@ int http_open ( struct interface *xfer, struct http_method *method,
 	process_init ( &http->process, &http_process_desc, &http->refcnt );
 	timer_init ( &http->timer, http_expired, &http->refcnt );
 	http->uri = uri_get ( uri );
+	http->scope_id = scope_id;
 	http->request.method = method;
 	http->request.uri = request_uri_string;
 	http->request.host = request_host_string;
@@ -646,19 +1030,29 @@ int http_open ( struct interface *xfer, struct http_method *method,
 		http->request.content.type = content->type;
 		http->request.content.data = content_data;
 		http->request.content.len = content_len;
+		http->request.content.stream = content->stream;
 		memcpy ( content_data, content->data, content_len );
 	}
 	http->state = &http_request;
 	DBGC2 ( http, "HTTP %p %s://%s%s\n", http, http->uri->scheme,
 		http->request.host, http->request.uri );
 
+	/* Use cached redirection, if available, instead of connecting.
+	 * The redirection is performed by the transmit process, once
+	 * the parent interface has been attached.
+	 */
+	if ( ( http->location = http_redirect_cached ( http ) ) )
+		goto attach;
+
 	/* Open connection */
-	if ( ( rc = http_connect ( &http->conn, uri ) ) != 0 ) {
+	if ( ( rc = http_connect ( &http->conn, uri, http_pipelinable ( http ),
+				   scope_id ) ) != 0 ) {
 		DBGC ( http, "HTTP %p could not connect: %s\n",
 		       http, strerror ( rc ) );
 		goto err_connect;
 	}
 
+ attach:
 	/* Attach to parent interface, mortalise self, and return */
 	intf_plug_plug ( &http->xfer, xfer );
 	ref_put ( &http->refcnt );
@@ -671,6 +1065,23 @@ int http_open ( struct interface *xfer, struct http_method *method,
 	return rc;
 }
 
+/**
+ * Open HTTP transaction
+ *
+ * @v xfer		Data transfer interface
+ * @v method		Request method
+ * @v uri		Request URI
+ * @v range		Content range (if any)
+ * @v content		Request content (if any)
+ * @ret rc		Return status code
+ */
+int http_open ( struct interface *xfer, struct http_method *method,
+		struct uri *uri, struct http_request_range *range,
+		struct http_request_content *content ) {
+
+	return http_open_via ( xfer, method, uri, range, content, 0 );
+}
+
 /**
  * Redirect HTTP transaction
  *
@@ -700,6 +1111,9 @@ static int http_redirect ( struct http_transaction *http,
 		goto err_resolve_uri;
 	}
 
+	/* Record redirection for subsequent requests, if applicable */
+	http_redirect_record ( http, resolved_uri );
+
 	/* Redirect to new URI */
 	if ( ( rc = xfer_redirect ( &http->xfer, LOCATION_URI,
 				    resolved_uri ) ) != 0 ) {
@@ -725,11 +1139,16 @@ static int http_redirect ( struct http_transaction *http,
 static int http_transfer_complete ( struct http_transaction *http ) {
 	struct http_authentication *auth;
 	const char *location;
+	unsigned long delay;
 	int rc;
 
-	/* Keep connection alive if applicable */
-	if ( http->response.flags & HTTP_RESPONSE_KEEPALIVE )
+	/* Keep connection alive if applicable.  A connection on which
+	 * streamed content is still being sent cannot be reused.
+	 */
+	if ( ( http->response.flags & HTTP_RESPONSE_KEEPALIVE ) &&
+	     ( ! http->streaming ) ) {
 		pool_recycle ( &http->conn );
+	}
 
 	/* Restart server connection interface */
 	intf_restart ( &http->conn, 0 );
@@ -747,6 +1166,10 @@ static int http_transfer_complete ( struct http_transaction *http ) {
 		return 0;
 	}
 
+	/* Fail if streamed content would need to be resent */
+	if ( http->request.content.stream )
+		return http->response.rc;
+
 	/* Perform redirection, if applicable */
 	if ( ( location = http->response.location ) ) {
 		if ( ( rc = http_redirect ( http, location ) ) != 0 )
@@ -755,6 +1178,21 @@ static int http_transfer_complete ( struct http_transaction *http ) {
 		return 0;
 	}
 
+	/* Back off from an overloaded server that has not specified
+	 * when to retry, within a limited number of attempts.
+	 */
+	if ( ( http->response.flags & HTTP_RESPONSE_OVERLOAD ) &&
+	     ! ( http->response.flags & HTTP_RESPONSE_RETRY ) ) {
+		if ( http->overloads >= HTTP_BACKOFF_MAX_RETRIES )
+			return http->response.rc;
+		delay = ( HTTP_BACKOFF_MIN_SECONDS << http->overloads );
+		if ( delay > HTTP_BACKOFF_MAX_SECONDS )
+			delay = HTTP_BACKOFF_MAX_SECONDS;
+		http->response.retry_after = delay;
+		http->response.flags |= HTTP_RESPONSE_RETRY;
+		http->overloads++;
+	}
+
 	/* Fail unless a retry is permitted */
 	if ( ! ( http->response.flags & HTTP_RESPONSE_RETRY ) )
 		return http->response.rc;
@@ -790,11 +1228,14 @@ static int http_transfer_complete ( struct http_transaction *http ) {
 		return 0;
 	}
 
-	/* Start timer to initiate retry */
-	DBGC2 ( http, "HTTP %p retrying after %d seconds\n",
-		http, http->response.retry_after );
-	start_timer_fixed ( &http->timer,
-			    ( http->response.retry_after * TICKS_PER_SEC ) );
+	/* Start timer to initiate retry.  Add up to 50% random
+	 * jitter, so that a large number of clients told to retry
+	 * after the same delay do not all return simultaneously.
+	 */
+	delay = ( http->response.retry_after * TICKS_PER_SEC );
+	delay += ( random() % ( ( delay / 2 ) + 1 ) );
+	DBGC2 ( http, "HTTP %p retrying after %ld ticks\n", http, delay );
+	start_timer_fixed ( &http->timer, delay );
 	return 0;
 }
 
@@ -940,6 +1381,9 @@ static int http_format_range ( struct http_transaction *http,
 				  http->request.range.start,
 				  ( http->request.range.start +
 				    http->request.range.len - 1 ) );
+	} else if ( http->request.resume.offset ) {
+		return snprintf ( buf, len, "bytes=%zd-",
+				  http->request.resume.offset );
 	} else {
 		return 0;
 	}
@@ -951,6 +1395,33 @@ struct http_request_header http_request_range __http_request_header = {
 	.format = http_format_range,
 };
 
+/**
+ * Construct HTTP "If-Range" header
+ *
+ * @v http		HTTP transaction
+ * @v buf		Buffer
+ * @v len		Length of buffer
+ * @ret len		Length of header value, or negative error
+ */
+static int http_format_if_range ( struct http_transaction *http,
+				  char *buf, size_t len ) {
+
+	/* Construct validator, if applicable */
+	if ( http->request.resume.offset ) {
+		assert ( http->request.resume.validator != NULL );
+		return snprintf ( buf, len, "%s",
+				  http->request.resume.validator );
+	} else {
+		return 0;
+	}
+}
+
+/** HTTP "If-Range" header */
+struct http_request_header http_request_if_range __http_request_header = {
+	.name = "If-Range",
+	.format = http_format_if_range,
+};
+
 /**
  * Construct HTTP "Content-Type" header
  *
@@ -1001,6 +1472,32 @@ struct http_request_header http_request_content_length __http_request_header = {
 	.format = http_format_content_length,
 };
 
+/**
+ * Construct HTTP "Transfer-Encoding" header
+ *
+ * @v http		HTTP transaction
+ * @v buf		Buffer
+ * @v len		Length of buffer
+ * @ret len		Length of header value, or negative error
+ */
+static int http_format_transfer_encoding ( struct http_transaction *http,
+					   char *buf, size_t len ) {
+
+	/* Use chunked encoding for streamed content, if applicable */
+	if ( http->request.content.stream ) {
+		return snprintf ( buf, len, "chunked" );
+	} else {
+		return 0;
+	}
+}
+
+/** HTTP "Transfer-Encoding" header */
+struct http_request_header http_request_transfer_encoding
+__http_request_header = {
+	.name = "Transfer-Encoding",
+	.format = http_format_transfer_encoding,
+};
+
 /**
  * Construct HTTP "Accept-Encoding" header
  *
@@ -1045,6 +1542,9 @@ static int http_tx_request ( struct http_transaction *http ) {
 	int check_len;
 	int rc;
 
+	/* Reuse any cached authentication challenge */
+	http_auth_preempt ( http );
+
 	/* Calculate request length */
 	len = http_format_headers ( http, NULL, 0 );
 	if ( len < 0 ) {
@@ -1083,6 +1583,13 @@ static int http_tx_request ( struct http_transaction *http ) {
 	/* Move to response headers state */
 	http->state = &http_headers;
 
+	/* Start streaming content, if applicable */
+	if ( http->request.content.stream ) {
+		DBGC2 ( http, "HTTP %p streaming content\n", http );
+		http->streaming = 1;
+		xfer_window_changed ( &http->xfer );
+	}
+
 	return 0;
 
  err_deliver:
@@ -1164,6 +1671,14 @@ static int http_parse_status ( struct http_transaction *http, char *line ) {
 	} else if ( http->response.status == 404 ) {
 		/* 404 Not Found */
 		response_rc = -ENOENT_404;
+	} else if ( http->response.status == 429 ) {
+		/* 429 Too Many Requests */
+		response_rc = -EIO_4XX;
+		http->response.flags |= HTTP_RESPONSE_OVERLOAD;
+	} else if ( http->response.status == 503 ) {
+		/* 503 Service Unavailable */
+		response_rc = -EIO_5XX;
+		http->response.flags |= HTTP_RESPONSE_OVERLOAD;
 	} else if ( status[0] == '4' ) {
 		/* 4xx Client Error (not already specified) */
 		response_rc = -EIO_4XX;
@@ -1365,6 +1880,45 @@ http_response_content_length __http_response_header = {
 	.parse = http_parse_content_length,
 };
 
+/**
+ * Parse HTTP "Content-Range" header
+ *
+ * @v http		HTTP transaction
+ * @v line		Remaining header line
+ * @ret rc		Return status code
+ */
+static int http_parse_content_range ( struct http_transaction *http,
+				      char *line ) {
+	static const char prefix[] = "bytes ";
+	char *endp;
+
+	/* Parse range start, ignoring unrecognised formats (which
+	 * will cause any resumed transfer to fail).
+	 */
+	if ( strncmp ( line, prefix, ( sizeof ( prefix ) - 1 ) ) != 0 )
+		goto unrecognised;
+	line += ( sizeof ( prefix ) - 1 );
+	http->response.content.start = strtoul ( line, &endp, 10 );
+	if ( *endp != '-' )
+		goto unrecognised;
+
+	/* Record that we have a content range start */
+	http->response.flags |= HTTP_RESPONSE_CONTENT_RANGE;
+
+	return 0;
+
+ unrecognised:
+	DBGC ( http, "HTTP %p ignoring Content-Range \"%s\"\n", http, line );
+	return 0;
+}
+
+/** HTTP "Content-Range" header */
+struct http_response_header
+http_response_content_range __http_response_header = {
+	.name = "Content-Range",
+	.parse = http_parse_content_range,
+};
+
 /**
  * Parse HTTP "Content-Encoding" header
  *
@@ -1442,6 +1996,157 @@ struct http_response_header http_response_retry_after __http_response_header = {
 	.parse = http_parse_retry_after,
 };
 
+/**
+ * Parse HTTP "ETag" header
+ *
+ * @v http		HTTP transaction
+ * @v line		Remaining header line
+ * @ret rc		Return status code
+ */
+static int http_parse_etag ( struct http_transaction *http, char *line ) {
+
+	/* Weak entity tags are not suitable for identifying
+	 * byte-identical content.
+	 */
+	if ( strncmp ( line, "W/", 2 ) == 0 ) {
+		DBGC2 ( http, "HTTP %p ignoring weak ETag %s\n", http, line );
+		return 0;
+	}
+
+	/* Store entity tag */
+	http->response.cache.etag = line;
+	return 0;
+}
+
+/** HTTP "ETag" header */
+struct http_response_header http_response_etag __http_response_header = {
+	.name = "ETag",
+	.parse = http_parse_etag,
+};
+
+/**
+ * Parse HTTP "Last-Modified" header
+ *
+ * @v http		HTTP transaction
+ * @v line		Remaining header line
+ * @ret rc		Return status code
+ */
+static int http_parse_last_modified ( struct http_transaction *http,
+				      char *line ) {
+
+	/* Store modification time */
+	http->response.cache.modified = line;
+	return 0;
+}
+
+/** HTTP "Last-Modified" header */
+struct http_response_header http_response_last_modified
+__http_response_header = {
+	.name = "Last-Modified",
+	.parse = http_parse_last_modified,
+};
+
+/**
+ * Parse HTTP "Cache-Control" header
+ *
+ * @v http		HTTP transaction
+ * @v line		Remaining header line
+ * @ret rc		Return status code
+ */
+static int http_parse_cache_control ( struct http_transaction *http,
+				      char *line ) {
+	struct http_response_cache *cache = &http->response.cache;
+	char *directive;
+	char *value;
+	char *endp;
+
+	/* Process recognised directives, ignoring all others */
+	while ( ( directive = http_token ( &line, &value ) ) ) {
+		if ( ( strcasecmp ( directive, "no-store" ) == 0 ) ||
+		     ( strcasecmp ( directive, "no-cache" ) == 0 ) ) {
+			http->response.flags |= HTTP_RESPONSE_NO_STORE;
+		} else if ( ( strcasecmp ( directive, "max-age" ) == 0 ) &&
+			    value ) {
+			cache->max_age = strtoul ( value, &endp, 10 );
+			if ( *endp == '\0' )
+				http->response.flags |= HTTP_RESPONSE_MAX_AGE;
+		}
+	}
+
+	return 0;
+}
+
+/** HTTP "Cache-Control" header */
+struct http_response_header http_response_cache_control
+__http_response_header = {
+	.name = "Cache-Control",
+	.parse = http_parse_cache_control,
+};
+
+/**
+ * Check or record resumption state for received HTTP headers
+ *
+ * @v http		HTTP transaction
+ * @ret rc		Return status code
+ */
+static int http_resume_response ( struct http_transaction *http ) {
+	struct http_request_resume *resume = &http->request.resume;
+	struct http_response_cache *cache = &http->response.cache;
+	const char *validator;
+
+	/* Check response to a resumed request */
+	if ( resume->offset ) {
+
+		/* Accept partial content only at the resumption offset */
+		if ( http->response.status == 206 ) {
+			if ( ! ( ( http->response.flags &
+				   HTTP_RESPONSE_CONTENT_RANGE ) &&
+				 ( http->response.content.start ==
+				   resume->offset ) ) ) {
+				DBGC ( http, "HTTP %p content range does not "
+				       "start at %#zx\n",
+				       http, resume->offset );
+				return -EIO_CONTENT_RANGE;
+			}
+			return 0;
+		}
+
+		/* Any other status is handled as for a new request */
+		if ( http->response.status != 200 )
+			return 0;
+
+		/* Restart from the beginning if the server sent the
+		 * whole content, provided that it will overwrite
+		 * everything received so far.
+		 */
+		if ( ! ( ( http->response.flags & HTTP_RESPONSE_CONTENT_LEN ) &&
+			 ( http->response.content.len >= resume->offset ) ) ) {
+			DBGC ( http, "HTTP %p content changed during "
+			       "transfer\n", http );
+			return -EIO_CONTENT_CHANGED;
+		}
+		DBGC ( http, "HTTP %p restarting transfer\n", http );
+		resume->offset = 0;
+	}
+
+	/* Record validator for successful complete responses that
+	 * are eligible for resumption.
+	 */
+	free ( resume->validator );
+	resume->validator = NULL;
+	if ( ( http->response.status != 200 ) ||
+	     ( http->request.method != &http_get ) ||
+	     ( http->request.range.len != 0 ) ||
+	     ( http->request.content.len != 0 ) ||
+	     ( http->response.content.encoding != NULL ) )
+		return 0;
+	validator = ( cache->etag ? cache->etag : cache->modified );
+	if ( validator )
+		resume->validator = strdup ( validator );
+
+	return 0;
+}
+
 /**
  * Handle received HTTP headers
  *
@@ -1453,6 +2158,7 @@ static int http_rx_headers ( struct http_transaction *http,
 			     struct io_buffer **iobuf ) {
 	struct http_transfer_encoding *transfer;
 	struct http_content_encoding *content;
+	size_t offset;
 	char *line;
 	int rc;
 
@@ -1470,6 +2176,14 @@ static int http_rx_headers ( struct http_transaction *http,
 	if ( ( rc = http_parse_headers ( http ) ) != 0 )
 		return rc;
 
+	/* Update or restore from cache, if applicable */
+	if ( ( rc = http_cache_response ( http ) ) != 0 )
+		return rc;
+
+	/* Check or record resumption state */
+	if ( ( rc = http_resume_response ( http ) ) != 0 )
+		return rc;
+
 	/* Initialise content encoding, if applicable */
 	if ( ( content = http->response.content.encoding ) &&
 	     ( ( rc = content->init ( http ) ) != 0 ) ) {
@@ -1478,14 +2192,22 @@ static int http_rx_headers ( struct http_transaction *http,
 		return rc;
 	}
 
-	/* Presize receive buffer, if we have a content length */
+	/* Presize receive buffer, if we have a content length, and
+	 * move to the resumption offset (if any).
+	 */
+	offset = http->request.resume.offset;
 	if ( http->response.content.len ) {
-		xfer_seek ( &http->transfer, http->response.content.len );
-		xfer_seek ( &http->transfer, 0 );
+		xfer_seek ( &http->transfer,
+			    ( offset + http->response.content.len ) );
 	}
+	if ( http->response.content.len || offset )
+		xfer_seek ( &http->transfer, offset );
 
-	/* Complete transfer if this is a HEAD request */
-	if ( http->request.method == &http_head ) {
+	/* Complete transfer if this is a HEAD request, or if the
+	 * content has been restored from the cache.
+	 */
+	if ( ( http->request.method == &http_head ) ||
+	     ( http->response.flags & HTTP_RESPONSE_CACHED ) ) {
 		if ( ( rc = http_transfer_complete ( http ) ) != 0 )
 			return rc;
 		return 0;
@@ -1549,24 +2271,42 @@ static int http_init_transfer_identity ( struct http_transaction *http ) {
  */
 static int http_rx_transfer_identity ( struct http_transaction *http,
 				       struct io_buffer **iobuf ) {
+	struct io_buffer *payload;
 	size_t len = iob_len ( *iobuf );
+	size_t remaining;
 	int rc;
 
-	/* Update lengths */
-	http->len += len;
-
-	/* Fail if this transfer would overrun the expected content
-	 * length (if any).
-	 */
+	/* Use whole/partial buffer as applicable */
+	remaining = ( http->response.content.len - http->len );
 	if ( ( http->response.flags & HTTP_RESPONSE_CONTENT_LEN ) &&
-	     ( http->len > http->response.content.len ) ) {
-		DBGC ( http, "HTTP %p content length overrun\n", http );
-		return -EIO_CONTENT_LENGTH;
+	     ( len > remaining ) ) {
+
+		/* Partial buffer is to be consumed (with the excess
+		 * belonging to a subsequent pipelined response): copy
+		 * data to a temporary I/O buffer.
+		 */
+		payload = alloc_iob ( remaining );
+		if ( ! payload )
+			return -ENOMEM;
+		memcpy ( iob_put ( payload, remaining ), (*iobuf)->data,
+			 remaining );
+		iob_pull ( *iobuf, remaining );
+		len = remaining;
+
+	} else {
+
+		/* Whole buffer is to be consumed: use original I/O
+		 * buffer as payload.
+		 */
+		payload = iob_disown ( *iobuf );
 	}
 
+	/* Update lengths */
+	http->len += len;
+
 	/* Hand off to content encoding */
 	if ( ( rc = xfer_deliver_iob ( &http->transfer,
-				       iob_disown ( *iobuf ) ) ) != 0 )
+				       iob_disown ( payload ) ) ) != 0 )
 		return rc;
 
 	/* Complete transfer if we have received the expected content
@@ -1659,14 +2399,18 @@ static int http_rx_chunk_len ( struct http_transaction *http,
 	size_t len;
 	int rc;
 
-	/* Receive into temporary line buffer */
-	if ( ( rc = http_rx_linebuf ( http, *iobuf, &http->linebuf ) ) != 0 )
+	/* Receive line */
+	if ( ( rc = http_rx_line ( http, *iobuf, &http->linebuf,
+				   &line ) ) != 0 )
 		return rc;
 
 	/* Wait until we receive a non-empty line */
-	line = buffered_line ( &http->linebuf );
-	if ( ( line == NULL ) || ( line[0] == '\0' ) )
+	if ( line == NULL )
+		return 0;
+	if ( line[0] == '\0' ) {
+		empty_line_buffer ( &http->linebuf );
 		return 0;
+	}
 
 	/* Parse chunk length */
 	http->remaining = strtoul ( line, &endp, 16 );
@@ -1803,14 +2547,18 @@ static int http_rx_trailers ( struct http_transaction *http,
 	char *line;
 	int rc;
 
-	/* Buffer trailer line */
-	if ( ( rc = http_rx_linebuf ( http, *iobuf, &http->linebuf ) ) != 0 )
+	/* Receive trailer line */
+	if ( ( rc = http_rx_line ( http, *iobuf, &http->linebuf,
+				   &line ) ) != 0 )
 		return rc;
+	if ( line == NULL )
+		return 0;
 
 	/* Wait until we see the empty line marking end of trailers */
-	line = buffered_line ( &http->linebuf );
-	if ( ( line == NULL ) || ( line[0] != '\0' ) )
+	if ( line[0] != '\0' ) {
+		empty_line_buffer ( &http->linebuf );
 		return 0;
+	}
 
 	/* Empty line buffer */
 	empty_line_buffer ( &http->linebuf );
@@ -1888,6 +2636,19 @@ static size_t http_params ( struct parameters *params, char *buf, size_t len ) {
 	return len;
 }
 
+/**
+ * Open HTTP multi-connection download (when multi-connection support is
+ * not present)
+ *
+ * @v xfer		Data transfer interface
+ * @v uri		Request URI
+ * @ret rc		Return status code
+ */
+__weak int http_multi_open ( struct interface *xfer, struct uri *uri ) {
+
+	return http_open ( xfer, &http_get, uri, NULL, NULL );
+}
+
 /**
  * Open HTTP transaction for simple GET URI
  *
@@ -1897,7 +2658,7 @@ static size_t http_params ( struct parameters *params, char *buf, size_t len ) {
  */
 static int http_open_get_uri ( struct interface *xfer, struct uri *uri ) {
 
-	return http_open ( xfer, &http_get, uri, NULL, NULL );
+	return http_multi_open ( xfer, uri );
 }
 
 /**
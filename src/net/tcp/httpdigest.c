@@ -302,6 +302,7 @@ struct http_authentication http_digest_auth __http_authentication = {
 	.parse = http_parse_digest_auth,
 	.authenticate = http_digest_authenticate,
 	.format = http_format_digest_auth,
+	.flags = HTTP_AUTH_PREEMPTIVE,
 };
 
 /* Drag in HTTP authentication support */
@@ -0,0 +1,946 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/**
+ * @file
+ *
+ * Hyper Text Transfer Protocol (HTTP) multi-connection downloads
+ *
+ * A download of a resource with a known length is split into a
+ * sequence of byte ranges, which are retrieved concurrently using
+ * independent HTTP transactions (and hence independent connections).
+ * Each range is delivered directly to its absolute offset within the
+ * recipient's data transfer buffer.
+ *
+ * The resource length is obtained via a HEAD request.  If the length
+ * cannot be determined, or if the server does not honour range
+ * requests, or if the recipient does not provide a data transfer
+ * buffer into which ranges may be delivered out of order, then the
+ * download falls back to a single plain GET request.
+ *
+ * If the request URI's host appears in the "http-mirrors" setting,
+ * then every other host in that setting is assumed to serve identical
+ * content at the same path.  All mirrors are probed concurrently,
+ * and the download starts as soon as the first mirror responds.
+ * Other mirrors join the download as their probes complete, provided
+ * that they report the same resource length.  Each range is requested
+ * from the mirror with the lowest expected completion time, based on
+ * its number of outstanding range requests and on its observed
+ * response time.  A mirror that fails to retrieve a range is
+ * abandoned, and the remainder of that range is retrieved from
+ * another mirror without restarting the download.
+ *
+ * If the "http-multilink" setting is enabled, then range requests
+ * are spread across all open network devices, with each connection
+ * routed only via its assigned network device.  This allows a single
+ * download to use the combined bandwidth of independent links.  A
+ * network device that fails to retrieve a range (e.g. because it has
+ * no route to the server) is abandoned, and the remainder of that
+ * range is retrieved via any network device.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <ipxe/refcnt.h>
+#include <ipxe/list.h>
+#include <ipxe/interface.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/xfer.h>
+#include <ipxe/open.h>
+#include <ipxe/process.h>
+#include <ipxe/timer.h>
+#include <ipxe/uri.h>
+#include <ipxe/netdevice.h>
+#include <ipxe/settings.h>
+#include <ipxe/xferbuf.h>
+#include <ipxe/http.h>
+
+/** Maximum number of concurrent range requests */
+#define HTTP_MULTI_MAX_RANGES 16
+
+/** Default number of concurrent range requests */
+#define HTTP_MULTI_DEFAULT_RANGES 4
+
+/** Maximum number of mirrors */
+#define HTTP_MULTI_MAX_MIRRORS 4
+
+/** Length of each range request
+ *
+ * Ranges are handed out to whichever connection becomes idle first,
+ * so that a single slow connection cannot hold up the remainder of
+ * the download for long.
+ */
+#define HTTP_MULTI_RANGE_LEN ( 4 * 1024 * 1024 )
+
+/** An HTTP multi-connection mirror */
+struct http_multi_mirror {
+	/** HTTP multi-connection download */
+	struct http_multiplexer *multi;
+	/** Length probe interface */
+	struct interface probe;
+	/** Mirror URI */
+	struct uri *uri;
+	/** Resource length reported by length probe */
+	size_t len;
+	/** Length probe start time */
+	unsigned long started;
+	/** Expected time to complete a request (in ticks)
+	 *
+	 * This is initially the length probe response time, and is
+	 * subsequently a moving average of range request completion
+	 * times.
+	 */
+	unsigned long cost;
+	/** Number of completed range requests */
+	unsigned int completed;
+	/** Number of busy range requests */
+	unsigned int busy;
+	/** Mirror status
+	 *
+	 * This is -EINPROGRESS while the length probe is in
+	 * progress, zero if the mirror is usable, or the reason for
+	 * abandoning the mirror.
+	 */
+	int rc;
+};
+
+/** An HTTP multi-connection range request */
+struct http_multi_range {
+	/** HTTP multi-connection download */
+	struct http_multiplexer *multi;
+	/** List of range requests */
+	struct list_head list;
+	/** Data transfer interface */
+	struct interface xfer;
+	/** Mirror */
+	struct http_multi_mirror *mirror;
+	/** Request start time */
+	unsigned long started;
+	/** Starting offset within resource */
+	size_t start;
+	/** Range length, or zero for an unbounded (non-range) request */
+	size_t len;
+	/** Current position within range */
+	size_t pos;
+	/** Network device scope ID, or zero to use any network device */
+	unsigned int scope_id;
+};
+
+/** An HTTP multi-connection download */
+struct http_multiplexer {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** Data transfer interface */
+	struct interface xfer;
+
+	/** Resource length, or zero if range requests have not
+	 * been started
+	 */
+	size_t len;
+	/** Starting offset of next range to be requested */
+	size_t next;
+
+	/** Range request initiation process */
+	struct process process;
+	/** List of busy range requests */
+	struct list_head busy;
+	/** List of idle range requests */
+	struct list_head idle;
+	/** Range requests */
+	struct http_multi_range range[HTTP_MULTI_MAX_RANGES];
+
+	/** Number of mirrors */
+	unsigned int mirrors;
+	/** Mirrors (the first being the original request URI) */
+	struct http_multi_mirror mirror[HTTP_MULTI_MAX_MIRRORS];
+};
+
+/** HTTP parallel connection count setting */
+const struct setting http_connections_setting __setting ( SETTING_MISC,
+							  http-connections ) = {
+	.name = "http-connections",
+	.description = "HTTP parallel connections",
+	.type = &setting_type_uint8,
+};
+
+/** HTTP multiple network device setting */
+const struct setting http_multilink_setting __setting ( SETTING_MISC,
+							http-multilink ) = {
+	.name = "http-multilink",
+	.description = "HTTP use all network devices",
+	.type = &setting_type_uint8,
+};
+
+/** HTTP mirror list setting */
+const struct setting http_mirrors_setting __setting ( SETTING_MISC,
+						      http-mirrors ) = {
+	.name = "http-mirrors",
+	.description = "HTTP mirror host names",
+	.type = &setting_type_string,
+};
+
+/**
+ * Free HTTP multi-connection download
+ *
+ * @v refcnt		Reference count
+ */
+static void http_multi_free ( struct refcnt *refcnt ) {
+	struct http_multiplexer *multi =
+		container_of ( refcnt, struct http_multiplexer, refcnt );
+	unsigned int i;
+
+	for ( i = 0 ; i < multi->mirrors ; i++ )
+		uri_put ( multi->mirror[i].uri );
+	free ( multi );
+}
+
+/**
+ * Close HTTP multi-connection download
+ *
+ * @v multi		HTTP multi-connection download
+ * @v rc		Reason for close
+ */
+static void http_multi_close ( struct http_multiplexer *multi, int rc ) {
+	unsigned int i;
+
+	/* Stop range request initiation process */
+	process_del ( &multi->process );
+
+	/* Shut down all range requests */
+	for ( i = 0 ; i < HTTP_MULTI_MAX_RANGES ; i++ )
+		intf_shutdown ( &multi->range[i].xfer, rc );
+
+	/* Shut down all length probes */
+	for ( i = 0 ; i < multi->mirrors ; i++ )
+		intf_shutdown ( &multi->mirror[i].probe, rc );
+
+	/* Shut down data transfer interface */
+	intf_shutdown ( &multi->xfer, rc );
+}
+
+/**
+ * Select mirror for next request
+ *
+ * @v multi		HTTP multi-connection download
+ * @ret mirror		Mirror, or NULL if no mirror is usable
+ */
+static struct http_multi_mirror *
+http_multi_mirror ( struct http_multiplexer *multi ) {
+	struct http_multi_mirror *mirror;
+	struct http_multi_mirror *best = NULL;
+	unsigned long cost;
+	unsigned long best_cost = 0;
+	unsigned int i;
+
+	/* Choose the usable mirror that is expected to complete a
+	 * new request soonest.  A mirror's cost is only a probe
+	 * response time until its first range request completes, so
+	 * avoid giving it a second range request until then (unless
+	 * there is no alternative).
+	 */
+	for ( i = 0 ; i < multi->mirrors ; i++ ) {
+		mirror = &multi->mirror[i];
+		if ( mirror->rc != 0 )
+			continue;
+		if ( mirror->busy && ( ! mirror->completed ) ) {
+			cost = ~0UL;
+		} else {
+			cost = ( ( mirror->busy + 1 ) * mirror->cost );
+		}
+		if ( ( ! best ) || ( cost < best_cost ) ) {
+			best = mirror;
+			best_cost = cost;
+		}
+	}
+
+	return best;
+}
+
+/**
+ * Start a range request
+ *
+ * @v multi		HTTP multi-connection download
+ * @v mirror		Mirror
+ * @v start		Starting offset
+ * @v len		Range length, or zero for an unbounded request
+ * @ret rc		Return status code
+ */
+static int http_multi_start ( struct http_multiplexer *multi,
+			      struct http_multi_mirror *mirror,
+			      size_t start, size_t len ) {
+	struct http_multi_range *range;
+	struct http_request_range request;
+	int rc;
+
+	/* Get an idle range request */
+	range = list_first_entry ( &multi->idle, struct http_multi_range,
+				   list );
+	assert ( range != NULL );
+
+	/* Open HTTP transaction */
+	request.start = start;
+	request.len = len;
+	if ( ( rc = http_open_via ( &range->xfer, &http_get, mirror->uri,
+				    &request, NULL, range->scope_id ) ) != 0 ) {
+		DBGC ( multi, "HTTPMULTI %p could not request [%zd,%zd) from "
+		       "%s: %s\n", multi, start, ( start + len ),
+		       mirror->uri->host, strerror ( rc ) );
+		return rc;
+	}
+	range->mirror = mirror;
+	range->started = currticks();
+	range->start = start;
+	range->len = len;
+	range->pos = 0;
+	mirror->busy++;
+
+	/* Move to list of busy range requests */
+	list_del ( &range->list );
+	list_add_tail ( &range->list, &multi->busy );
+
+	return 0;
+}
+
+/**
+ * Fall back to a single unbounded request
+ *
+ * @v multi		HTTP multi-connection download
+ * @v mirror		Mirror
+ */
+static void http_multi_single ( struct http_multiplexer *multi,
+				struct http_multi_mirror *mirror ) {
+	struct http_multi_range *range;
+	struct http_multi_range *tmp;
+	unsigned int i;
+	int rc;
+
+	/* Stop range request initiation process */
+	process_del ( &multi->process );
+
+	/* Cancel any outstanding length probes */
+	for ( i = 0 ; i < multi->mirrors ; i++ )
+		intf_restart ( &multi->mirror[i].probe, -ECANCELED );
+
+	/* Cancel any outstanding range requests */
+	list_for_each_entry_safe ( range, tmp, &multi->busy, list ) {
+		intf_restart ( &range->xfer, -ECANCELED );
+		range->mirror->busy--;
+		list_del ( &range->list );
+		list_add_tail ( &range->list, &multi->idle );
+	}
+
+	/* Allow the single request to use any network device */
+	list_for_each_entry ( range, &multi->idle, list )
+		range->scope_id = 0;
+
+	/* Request the whole resource with no further ranges to follow */
+	DBGC ( multi, "HTTPMULTI %p using a single connection to %s\n",
+	       multi, mirror->uri->host );
+	multi->len = 0;
+	multi->next = 0;
+	if ( ( rc = http_multi_start ( multi, mirror, 0, 0 ) ) != 0 )
+		http_multi_close ( multi, rc );
+}
+
+/**
+ * Initiate range requests
+ *
+ * @v multi		HTTP multi-connection download
+ */
+static void http_multi_step ( struct http_multiplexer *multi ) {
+	struct http_multi_mirror *mirror;
+	size_t len;
+	int rc;
+
+	/* Stop initiation process if all range requests are busy */
+	if ( list_empty ( &multi->idle ) ) {
+		process_del ( &multi->process );
+		return;
+	}
+
+	/* If we have requested all ranges and have no outstanding
+	 * range requests, then we are finished.
+	 */
+	if ( multi->next >= multi->len ) {
+		process_del ( &multi->process );
+		if ( list_empty ( &multi->busy ) )
+			http_multi_close ( multi, 0 );
+		return;
+	}
+
+	/* Select mirror */
+	mirror = http_multi_mirror ( multi );
+	if ( ! mirror ) {
+		process_del ( &multi->process );
+		return;
+	}
+
+	/* Request next range */
+	len = ( multi->len - multi->next );
+	if ( len > HTTP_MULTI_RANGE_LEN )
+		len = HTTP_MULTI_RANGE_LEN;
+	if ( ( rc = http_multi_start ( multi, mirror, multi->next,
+				       len ) ) != 0 ) {
+		http_multi_close ( multi, rc );
+		return;
+	}
+	multi->next += len;
+}
+
+/**
+ * Redirect HTTP multi-connection download
+ *
+ * @v multi		HTTP multi-connection download
+ * @v type		New location type
+ * @v args		Remaining arguments depend upon location type
+ * @ret rc		Return status code
+ *
+ * Any redirection is passed up to the recipient, which will reopen
+ * the whole download (and hence repeat the length probe) at the new
+ * location.
+ */
+static int http_multi_vredirect ( struct http_multiplexer *multi, int type,
+				  va_list args ) {
+
+	return xfer_vredirect ( &multi->xfer, type, args );
+}
+
+/**
+ * Redirect via mirror
+ *
+ * @v mirror		HTTP multi-connection mirror
+ * @v type		New location type
+ * @v args		Remaining arguments depend upon location type
+ * @ret rc		Return status code
+ *
+ * A redirection from any mirror other than the original request URI
+ * is treated as a failure of that mirror, since it must not replace
+ * the whole download.
+ */
+static int http_multi_mirror_vredirect ( struct http_multi_mirror *mirror,
+					 int type, va_list args ) {
+	struct http_multiplexer *multi = mirror->multi;
+
+	if ( mirror != &multi->mirror[0] )
+		return -ENOTSUP;
+	return http_multi_vredirect ( multi, type, args );
+}
+
+/**
+ * Redirect length probe
+ *
+ * @v mirror		HTTP multi-connection mirror
+ * @v type		New location type
+ * @v args		Remaining arguments depend upon location type
+ * @ret rc		Return status code
+ */
+static int http_multi_probe_vredirect ( struct http_multi_mirror *mirror,
+					int type, va_list args ) {
+
+	return http_multi_mirror_vredirect ( mirror, type, args );
+}
+
+/**
+ * Receive data from length probe
+ *
+ * @v mirror		HTTP multi-connection mirror
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int http_multi_probe_deliver ( struct http_multi_mirror *mirror,
+				      struct io_buffer *iobuf,
+				      struct xfer_metadata *meta ) {
+
+	/* A HEAD request delivers no data, but will presize the
+	 * receive buffer to the content length (if known).
+	 */
+	if ( ( meta->flags & XFER_FL_ABS_OFFSET ) &&
+	     ( ( size_t ) meta->offset > mirror->len ) ) {
+		mirror->len = meta->offset;
+	}
+	free_iob ( iobuf );
+
+	return 0;
+}
+
+/**
+ * Close length probe
+ *
+ * @v mirror		HTTP multi-connection mirror
+ * @v rc		Reason for close
+ */
+static void http_multi_probe_close ( struct http_multi_mirror *mirror,
+				     int rc ) {
+	struct http_multiplexer *multi = mirror->multi;
+	unsigned int i;
+
+	/* Restart interface */
+	intf_restart ( &mirror->probe, rc );
+
+	/* Record response time */
+	mirror->cost = ( currticks() - mirror->started );
+	if ( ! mirror->cost )
+		mirror->cost = 1;
+
+	/* Abandon mirror if the probe failed or reported a length
+	 * that does not match the download already in progress.
+	 */
+	if ( ( rc == 0 ) && multi->len && ( mirror->len != multi->len ) )
+		rc = -ERANGE;
+	mirror->rc = rc;
+	if ( rc != 0 ) {
+		DBGC ( multi, "HTTPMULTI %p abandoning mirror %s: %s\n",
+		       multi, mirror->uri->host, strerror ( rc ) );
+
+		/* Fall back to a single request via the original
+		 * URI if no mirror is usable.  If the probes failed
+		 * because of a genuine error (e.g. a missing file),
+		 * then the single request will report the same
+		 * error.
+		 */
+		if ( ! multi->len ) {
+			for ( i = 0 ; i < multi->mirrors ; i++ ) {
+				if ( multi->mirror[i].rc == -EINPROGRESS )
+					return;
+			}
+			http_multi_single ( multi, &multi->mirror[0] );
+		}
+		return;
+	}
+	DBGC ( multi, "HTTPMULTI %p mirror %s responded in %ld ticks\n",
+	       multi, mirror->uri->host, mirror->cost );
+
+	/* Join any download already in progress */
+	if ( multi->len ) {
+		process_add ( &multi->process );
+		return;
+	}
+
+	/* Fall back to a single request if the resource is too small
+	 * to be worth splitting.
+	 */
+	if ( mirror->len <= HTTP_MULTI_RANGE_LEN ) {
+		http_multi_single ( multi, mirror );
+		return;
+	}
+
+	/* Fall back to a single request unless the recipient provides
+	 * a data transfer buffer, since ranges will complete out of
+	 * order and not every recipient (e.g. a decompression filter)
+	 * can accept data out of order.
+	 */
+	if ( ! xfer_buffer ( &multi->xfer ) ) {
+		DBGC ( multi, "HTTPMULTI %p has no random-access buffer\n",
+		       multi );
+		http_multi_single ( multi, mirror );
+		return;
+	}
+	multi->len = mirror->len;
+	DBGC ( multi, "HTTPMULTI %p fetching %zd bytes in %zd-byte ranges\n",
+	       multi, multi->len, ( ( size_t ) HTTP_MULTI_RANGE_LEN ) );
+
+	/* Presize receive buffer */
+	if ( ( rc = xfer_seek ( &multi->xfer, multi->len ) ) != 0 ) {
+		DBGC ( multi, "HTTPMULTI %p could not presize buffer: %s\n",
+		       multi, strerror ( rc ) );
+		http_multi_close ( multi, rc );
+		return;
+	}
+	xfer_seek ( &multi->xfer, 0 );
+
+	/* Start range request initiation process */
+	process_add ( &multi->process );
+}
+
+/**
+ * Receive data from range request
+ *
+ * @v range		HTTP multi-connection range request
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int http_multi_range_deliver ( struct http_multi_range *range,
+				      struct io_buffer *iobuf,
+				      struct xfer_metadata *meta ) {
+	struct http_multiplexer *multi = range->multi;
+	struct xfer_metadata range_meta;
+	size_t len = iob_len ( iobuf );
+	size_t offset;
+
+	/* Calculate position within range */
+	offset = meta->offset;
+	if ( ! ( meta->flags & XFER_FL_ABS_OFFSET ) )
+		offset += range->pos;
+
+	/* A server that does not honour range requests will return
+	 * the whole resource, and will typically reveal this by
+	 * presizing the receive buffer to the full content length.
+	 * Fall back to a single request if this happens.
+	 */
+	if ( range->len && ( ( offset + len ) > range->len ) ) {
+		DBGC ( multi, "HTTPMULTI %p server ignored range [%zd,%zd)\n",
+		       multi, range->start, ( range->start + range->len ) );
+		free_iob ( iobuf );
+		http_multi_single ( multi, range->mirror );
+		return -ECANCELED;
+	}
+	range->pos = ( offset + len );
+
+	/* Deliver to absolute position within resource */
+	memcpy ( &range_meta, meta, sizeof ( range_meta ) );
+	range_meta.flags |= XFER_FL_ABS_OFFSET;
+	range_meta.offset = ( range->start + offset );
+	return xfer_deliver ( &multi->xfer, iob_disown ( iobuf ),
+			      &range_meta );
+}
+
+/**
+ * Get range request underlying data transfer buffer
+ *
+ * @v range		HTTP multi-connection range request
+ * @ret xferbuf		Data transfer buffer, or NULL on error
+ */
+static struct xfer_buffer *
+http_multi_range_buffer ( struct http_multi_range *range ) {
+	struct http_multiplexer *multi = range->multi;
+
+	/* We can't use a simple passthrough interface descriptor,
+	 * since there are multiple range request interfaces.
+	 */
+	return xfer_buffer ( &multi->xfer );
+}
+
+/**
+ * Redirect range request
+ *
+ * @v range		HTTP multi-connection range request
+ * @v type		New location type
+ * @v args		Remaining arguments depend upon location type
+ * @ret rc		Return status code
+ */
+static int http_multi_range_vredirect ( struct http_multi_range *range,
+					int type, va_list args ) {
+
+	return http_multi_mirror_vredirect ( range->mirror, type, args );
+}
+
+/**
+ * Close range request
+ *
+ * @v range		HTTP multi-connection range request
+ * @v rc		Reason for close
+ */
+static void http_multi_range_close ( struct http_multi_range *range, int rc ) {
+	struct http_multiplexer *multi = range->multi;
+	struct http_multi_mirror *mirror = range->mirror;
+	struct http_multi_range *idle;
+	unsigned int scope_id = range->scope_id;
+	unsigned long elapsed;
+
+	/* Move to list of idle range requests */
+	list_del ( &range->list );
+	list_add_tail ( &range->list, &multi->idle );
+	mirror->busy--;
+
+	/* If a range request failed, then stop using its network
+	 * device (if bound to one) or its mirror (otherwise) for any
+	 * further range requests, and retrieve the remainder of the
+	 * range via any remaining network device or mirror.
+	 */
+	if ( ( rc != 0 ) && ( range->pos < range->len ) ) {
+		if ( scope_id ) {
+			DBGC ( multi, "HTTPMULTI %p abandoning network device "
+			       "%d: %s\n", multi, scope_id, strerror ( rc ) );
+			list_for_each_entry ( idle, &multi->idle, list ) {
+				if ( idle->scope_id == scope_id )
+					idle->scope_id = 0;
+			}
+		} else if ( mirror->rc == 0 ) {
+			DBGC ( multi, "HTTPMULTI %p abandoning mirror %s: "
+			       "%s\n", multi, mirror->uri->host,
+			       strerror ( rc ) );
+			mirror->rc = rc;
+		}
+		if ( ( mirror = http_multi_mirror ( multi ) ) ) {
+			intf_restart ( &range->xfer, rc );
+			list_del ( &range->list );
+			list_add ( &range->list, &multi->idle );
+			if ( ( rc = http_multi_start ( multi, mirror,
+						       ( range->start +
+							 range->pos ),
+						       ( range->len -
+							 range->pos ) ) ) != 0 ){
+				http_multi_close ( multi, rc );
+			}
+			return;
+		}
+	}
+
+	/* If any error occurred, terminate the whole download */
+	if ( rc != 0 ) {
+		http_multi_close ( multi, rc );
+		return;
+	}
+
+	/* Update expected completion time */
+	elapsed = ( currticks() - range->started );
+	if ( mirror->completed++ ) {
+		mirror->cost = ( ( ( 3 * mirror->cost ) + elapsed ) / 4 );
+	} else {
+		mirror->cost = elapsed;
+	}
+	if ( ! mirror->cost )
+		mirror->cost = 1;
+
+	/* Restart data transfer interface */
+	intf_restart ( &range->xfer, rc );
+
+	/* Restart range request initiation process */
+	process_add ( &multi->process );
+}
+
+/** Data transfer interface operations */
+static struct interface_operation http_multi_xfer_operations[] = {
+	INTF_OP ( intf_close, struct http_multiplexer *, http_multi_close ),
+};
+
+/** Data transfer interface descriptor */
+static struct interface_descriptor http_multi_xfer_desc =
+	INTF_DESC ( struct http_multiplexer, xfer, http_multi_xfer_operations );
+
+/** Length probe interface operations */
+static struct interface_operation http_multi_probe_operations[] = {
+	INTF_OP ( xfer_deliver, struct http_multi_mirror *,
+		  http_multi_probe_deliver ),
+	INTF_OP ( xfer_vredirect, struct http_multi_mirror *,
+		  http_multi_probe_vredirect ),
+	INTF_OP ( intf_close, struct http_multi_mirror *,
+		  http_multi_probe_close ),
+};
+
+/** Length probe interface descriptor */
+static struct interface_descriptor http_multi_probe_desc =
+	INTF_DESC ( struct http_multi_mirror, probe,
+		    http_multi_probe_operations );
+
+/** Range request data transfer interface operations */
+static struct interface_operation http_multi_range_operations[] = {
+	INTF_OP ( xfer_deliver, struct http_multi_range *,
+		  http_multi_range_deliver ),
+	INTF_OP ( xfer_buffer, struct http_multi_range *,
+		  http_multi_range_buffer ),
+	INTF_OP ( xfer_vredirect, struct http_multi_range *,
+		  http_multi_range_vredirect ),
+	INTF_OP ( intf_close, struct http_multi_range *,
+		  http_multi_range_close ),
+};
+
+/** Range request data transfer interface descriptor */
+static struct interface_descriptor http_multi_range_desc =
+	INTF_DESC ( struct http_multi_range, xfer,
+		    http_multi_range_operations );
+
+/** Range request initiation process descriptor */
+static struct process_descriptor http_multi_process_desc =
+	PROC_DESC ( struct http_multiplexer, process, http_multi_step );
+
+/**
+ * Add mirror
+ *
+ * @v multi		HTTP multi-connection download
+ * @v uri		Mirror URI
+ */
+static void http_multi_add_mirror ( struct http_multiplexer *multi,
+				    struct uri *uri ) {
+	struct http_multi_mirror *mirror;
+
+	/* Ignore excess mirrors */
+	if ( multi->mirrors >= HTTP_MULTI_MAX_MIRRORS )
+		return;
+
+	/* Initialise mirror */
+	mirror = &multi->mirror[ multi->mirrors++ ];
+	mirror->multi = multi;
+	intf_init ( &mirror->probe, &http_multi_probe_desc, &multi->refcnt );
+	mirror->uri = uri_get ( uri );
+	mirror->rc = -EINPROGRESS;
+}
+
+/**
+ * Add mirrors listed in "http-mirrors" setting
+ *
+ * @v multi		HTTP multi-connection download
+ * @v uri		Request URI
+ *
+ * The mirror list is a whitespace-separated list of host names.  If
+ * the request URI's host appears within the list, then each other
+ * listed host is added as a mirror, using the same scheme, port and
+ * path as the request URI.
+ */
+static void http_multi_add_mirrors ( struct http_multiplexer *multi,
+				     struct uri *uri ) {
+	char *hosts[ HTTP_MULTI_MAX_MIRRORS - 1 ];
+	struct uri mirror_uri;
+	struct uri *dup;
+	unsigned int count = 0;
+	unsigned int i;
+	char *mirrors;
+	char *tmp;
+	char *host;
+	int found = 0;
+
+	/* Fetch mirror list, if any */
+	if ( fetch_string_setting_copy ( NULL, &http_mirrors_setting,
+					 &mirrors ) < 0 )
+		return;
+	if ( ! mirrors )
+		return;
+
+	/* Split mirror list, checking for the request URI's host */
+	tmp = mirrors;
+	while ( ( host = strsep ( &tmp, " \t" ) ) ) {
+		if ( ! *host )
+			continue;
+		if ( strcmp ( host, uri->host ) == 0 ) {
+			found = 1;
+		} else if ( count < ( sizeof ( hosts ) /
+				      sizeof ( hosts[0] ) ) ) {
+			hosts[count++] = host;
+		}
+	}
+
+	/* Add other listed hosts as mirrors */
+	for ( i = 0 ; found && ( i < count ) ; i++ ) {
+		memcpy ( &mirror_uri, uri, sizeof ( mirror_uri ) );
+		mirror_uri.host = hosts[i];
+		dup = uri_dup ( &mirror_uri );
+		if ( ! dup )
+			break;
+		http_multi_add_mirror ( multi, dup );
+		uri_put ( dup );
+	}
+
+	free ( mirrors );
+}
+
+/**
+ * Open HTTP multi-connection download
+ *
+ * @v xfer		Data transfer interface
+ * @v uri		Request URI
+ * @ret rc		Return status code
+ */
+int http_multi_open ( struct interface *xfer, struct uri *uri ) {
+	unsigned int scope_ids[HTTP_MULTI_MAX_RANGES];
+	struct http_multiplexer *multi;
+	struct http_multi_mirror *mirror;
+	struct http_multi_range *range;
+	struct net_device *netdev;
+	unsigned int netdevs = 0;
+	unsigned long count;
+	unsigned int i;
+	int rc;
+
+	/* Determine number of concurrent range requests */
+	if ( fetch_uint_setting ( NULL, &http_connections_setting,
+				  &count ) < 0 ) {
+		count = HTTP_MULTI_DEFAULT_RANGES;
+	}
+	if ( count > HTTP_MULTI_MAX_RANGES )
+		count = HTTP_MULTI_MAX_RANGES;
+
+	/* Use a plain GET request if only one connection is permitted */
+	if ( count <= 1 )
+		return http_open ( xfer, &http_get, uri, NULL, NULL );
+
+	/* Identify network devices to use, if applicable */
+	if ( fetch_intz_setting ( NULL, &http_multilink_setting ) ) {
+		for_each_netdev ( netdev ) {
+			if ( netdevs >= count )
+				break;
+			if ( netdev_is_open ( netdev ) &&
+			     netdev_link_ok ( netdev ) ) {
+				scope_ids[netdevs++] = netdev->index;
+			}
+		}
+	}
+
+	/* Allocate and initialise structure */
+	multi = zalloc ( sizeof ( *multi ) );
+	if ( ! multi ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	ref_init ( &multi->refcnt, http_multi_free );
+	intf_init ( &multi->xfer, &http_multi_xfer_desc, &multi->refcnt );
+	process_init_stopped ( &multi->process, &http_multi_process_desc,
+			       &multi->refcnt );
+	INIT_LIST_HEAD ( &multi->busy );
+	INIT_LIST_HEAD ( &multi->idle );
+	for ( i = 0 ; i < HTTP_MULTI_MAX_RANGES ; i++ ) {
+		range = &multi->range[i];
+		range->multi = multi;
+		INIT_LIST_HEAD ( &range->list );
+		intf_init ( &range->xfer, &http_multi_range_desc,
+			    &multi->refcnt );
+		if ( netdevs > 1 )
+			range->scope_id = scope_ids[ i % netdevs ];
+		if ( i < count )
+			list_add_tail ( &range->list, &multi->idle );
+	}
+	http_multi_add_mirror ( multi, uri );
+	http_multi_add_mirrors ( multi, uri );
+
+	/* Probe resource length via each mirror */
+	for ( i = 0 ; i < multi->mirrors ; i++ ) {
+		mirror = &multi->mirror[i];
+		mirror->started = currticks();
+		if ( ( rc = http_open ( &mirror->probe, &http_head,
+					mirror->uri, NULL, NULL ) ) != 0 ) {
+			DBGC ( multi, "HTTPMULTI %p could not probe length "
+			       "via %s: %s\n", multi, mirror->uri->host,
+			       strerror ( rc ) );
+			/* A failure to probe the original URI is fatal */
+			if ( i == 0 )
+				goto err_probe;
+			mirror->rc = rc;
+		}
+	}
+
+	/* Attach to parent interface, mortalise self, and return */
+	intf_plug_plug ( &multi->xfer, xfer );
+	ref_put ( &multi->refcnt );
+	return 0;
+
+ err_probe:
+	http_multi_close ( multi, rc );
+	ref_put ( &multi->refcnt );
+ err_alloc:
+	return rc;
+}
@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/**
+ * @file
+ *
+ * Hyper Text Transfer Protocol (HTTP) redirection cache
+ *
+ * Redirections received in response to GET requests are recorded
+ * for the remainder of the boot session, so that any subsequent
+ * request for the same URI may be redirected immediately without
+ * contacting the original server.
+ *
+ * Permanent redirections ("301 Moved Permanently" and "308 Permanent
+ * Redirect") are cached indefinitely.  Temporary redirections ("302
+ * Found" and "307 Temporary Redirect") are cached only if the server
+ * explicitly permits this via a "Cache-Control: max-age" directive,
+ * and only for the specified duration.  "303 See Other" is never
+ * cached.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ipxe/list.h>
+#include <ipxe/uri.h>
+#include <ipxe/timer.h>
+#include <ipxe/http.h>
+
+/** Maximum number of cached redirections */
+#define HTTP_REDIRECT_MAX 16
+
+/** A cached HTTP redirection */
+struct http_redirect_entry {
+	/** List of cached redirections (most recently used first) */
+	struct list_head list;
+	/** Original URI string */
+	char *uri;
+	/** Redirection location */
+	struct uri *location;
+	/** Expiry time (in ticks), if not permanent */
+	unsigned long expiry;
+	/** Redirection is permanent */
+	int permanent;
+};
+
+/** Cached redirections */
+static LIST_HEAD ( http_redirects );
+
+/** Number of cached redirections */
+static unsigned int http_redirect_count;
+
+/**
+ * Free cached redirection
+ *
+ * @v entry		Cached redirection
+ */
+static void http_redirect_free ( struct http_redirect_entry *entry ) {
+
+	list_del ( &entry->list );
+	http_redirect_count--;
+	uri_put ( entry->location );
+	free ( entry->uri );
+	free ( entry );
+}
+
+/**
+ * Check if HTTP transaction is eligible for redirection caching
+ *
+ * @v http		HTTP transaction
+ * @ret is_eligible	Transaction is eligible
+ */
+static int http_redirect_eligible ( struct http_transaction *http ) {
+
+	return ( http->request.method == &http_get );
+}
+
+/**
+ * Find cached redirection
+ *
+ * @v uri		URI string
+ * @ret entry		Cached redirection, or NULL if not found
+ */
+static struct http_redirect_entry * http_redirect_find ( const char *uri ) {
+	struct http_redirect_entry *entry;
+	struct http_redirect_entry *tmp;
+
+	list_for_each_entry_safe ( entry, tmp, &http_redirects, list ) {
+
+		/* Discard expired entries */
+		if ( ( ! entry->permanent ) &&
+		     ( ( ( signed long ) ( currticks() - entry->expiry ) ) >=0)){
+			DBGC ( &http_redirects, "HTTPREDIR expired %s\n",
+			       entry->uri );
+			http_redirect_free ( entry );
+			continue;
+		}
+
+		/* Mark matching entry as most recently used */
+		if ( strcmp ( entry->uri, uri ) == 0 ) {
+			list_del ( &entry->list );
+			list_add ( &entry->list, &http_redirects );
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Find cached redirection
+ *
+ * @v http		HTTP transaction
+ * @ret location	Redirection location, or NULL
+ */
+struct uri * http_redirect_cached ( struct http_transaction *http ) {
+	struct http_redirect_entry *entry;
+	char *uri;
+
+	/* Do nothing unless eligible */
+	if ( ! http_redirect_eligible ( http ) )
+		return NULL;
+
+	/* Find cached redirection */
+	uri = format_uri_alloc ( http->uri );
+	if ( ! uri )
+		return NULL;
+	entry = http_redirect_find ( uri );
+	free ( uri );
+	if ( ! entry )
+		return NULL;
+
+	DBGC ( &http_redirects, "HTTPREDIR redirecting %s\n", entry->uri );
+	return uri_get ( entry->location );
+}
+
+/**
+ * Record redirection
+ *
+ * @v http		HTTP transaction
+ * @v location		Redirection location
+ */
+void http_redirect_record ( struct http_transaction *http,
+			    struct uri *location ) {
+	struct http_response *response = &http->response;
+	struct http_redirect_entry *entry;
+	unsigned long max_age = 0;
+	int permanent;
+	char *uri;
+
+	/* Do nothing unless eligible */
+	if ( ! http_redirect_eligible ( http ) )
+		return;
+	if ( response->flags & HTTP_RESPONSE_NO_STORE )
+		return;
+
+	/* Determine cacheability */
+	switch ( response->status ) {
+	case 301:
+	case 308:
+		permanent = 1;
+		break;
+	case 302:
+	case 307:
+		if ( ! ( response->flags & HTTP_RESPONSE_MAX_AGE ) )
+			return;
+		max_age = response->cache.max_age;
+		if ( ! max_age )
+			return;
+		permanent = 0;
+		break;
+	default:
+		return;
+	}
+
+	/* Discard any existing entry */
+	uri = format_uri_alloc ( http->uri );
+	if ( ! uri )
+		return;
+	if ( ( entry = http_redirect_find ( uri ) ) )
+		http_redirect_free ( entry );
+
+	/* Make room for new entry, if necessary */
+	if ( http_redirect_count >= HTTP_REDIRECT_MAX ) {
+		entry = list_last_entry ( &http_redirects,
+					  struct http_redirect_entry, list );
+		http_redirect_free ( entry );
+	}
+
+	/* Allocate and populate new entry */
+	entry = zalloc ( sizeof ( *entry ) );
+	if ( ! entry ) {
+		free ( uri );
+		return;
+	}
+	entry->uri = uri;
+	entry->location = uri_get ( location );
+	entry->permanent = permanent;
+	entry->expiry = ( currticks() + ( max_age * TICKS_PER_SEC ) );
+	list_add ( &entry->list, &http_redirects );
+	http_redirect_count++;
+	DBGC ( &http_redirects, "HTTPREDIR cached %s redirection for %s\n",
+	       ( permanent ? "permanent" : "temporary" ), entry->uri );
+}
@@ -30,6 +30,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  *
  */
 
+#include <string.h>
 #include <ipxe/open.h>
 #include <ipxe/tls.h>
 #include <ipxe/http.h>
@@ -43,9 +44,58 @@ struct uri_opener https_uri_opener __uri_opener = {
 	.open	= http_open_uri,
 };
 
+/** HTTP/1.1 application-layer protocol name */
+#define HTTPS_HTTP11 "http/1.1"
+
+/**
+ * Add HTTPS transport-layer filter
+ *
+ * @v xfer		Data transfer interface
+ * @v name		Host name
+ * @v next		Next interface
+ * @ret rc		Return status code
+ *
+ * Any alternative HTTP protocols are offered via application-layer
+ * protocol negotiation, in order of preference and followed by
+ * HTTP/1.1.
+ */
+static int https_filter ( struct interface *xfer, const char *name,
+			  struct interface **next ) {
+	struct http_protocol *protocol;
+	size_t name_len;
+	size_t len;
+	uint8_t *pos;
+
+	/* Use plain TLS if there are no alternative protocols */
+	if ( ! table_num_entries ( HTTP_PROTOCOLS ) )
+		return add_tls ( xfer, name, next );
+
+	/* Calculate length of protocol list */
+	len = ( 1 /* length */ + strlen ( HTTPS_HTTP11 ) );
+	for_each_table_entry ( protocol, HTTP_PROTOCOLS )
+		len += ( 1 /* length */ + strlen ( protocol->name ) );
+
+	/* Construct protocol list */
+	{
+		uint8_t alpn[len];
+
+		pos = alpn;
+		for_each_table_entry ( protocol, HTTP_PROTOCOLS ) {
+			name_len = strlen ( protocol->name );
+			*(pos++) = name_len;
+			memcpy ( pos, protocol->name, name_len );
+			pos += name_len;
+		}
+		*(pos++) = strlen ( HTTPS_HTTP11 );
+		memcpy ( pos, HTTPS_HTTP11, strlen ( HTTPS_HTTP11 ) );
+
+		return add_tls_alpn ( xfer, name, alpn, sizeof ( alpn ), next );
+	}
+}
+
 /** HTTP URI scheme */
 struct http_scheme https_scheme __http_scheme = {
 	.name = "https",
 	.port = HTTPS_PORT,
-	.filter = add_tls,
+	.filter = https_filter,
 };
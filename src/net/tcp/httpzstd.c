@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/**
+ * @file
+ *
+ * Hyper Text Transfer Protocol (HTTP) Zstandard content encoding
+ *
+ */
+
+#include <ipxe/http.h>
+#include <ipxe/decompress.h>
+#include <ipxe/zstd.h>
+
+/**
+ * Check if Zstandard content encoding is supported
+ *
+ * @v http		HTTP transaction
+ * @ret supported	Zstandard encoding is supported for this request
+ */
+static int http_zstd_supported ( struct http_transaction *http ) {
+
+	/* A range request refers to a range of the decoded content,
+	 * which will not be meaningful if the server chooses to apply
+	 * an encoding.  Refuse to accept encoded ranges.
+	 */
+	return ( http->request.range.len == 0 );
+}
+
+/**
+ * Initialise Zstandard content encoding
+ *
+ * @v http		HTTP transaction
+ * @ret rc		Return status code
+ */
+static int http_zstd_init ( struct http_transaction *http ) {
+
+	return decompress_filter ( &http->content, &http->transfer,
+				   &zstd_decompressor );
+}
+
+/** Zstandard HTTP content encoding */
+struct http_content_encoding zstd_encoding __http_content_encoding = {
+	.name = "zstd",
+	.supported = http_zstd_supported,
+	.init = http_zstd_init,
+};
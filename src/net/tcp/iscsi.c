@@ -45,6 +45,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/features.h>
 #include <ipxe/base16.h>
 #include <ipxe/base64.h>
+#include <ipxe/crc32.h>
 #include <ipxe/ibft.h>
 #include <ipxe/iscsi.h>
 
@@ -93,6 +94,10 @@ FEATURE ( FEATURE_PROTOCOL, "iSCSI", DHCP_EB_FEATURE_ISCSI, 1 );
 	__einfo_error ( EINFO_EIO_TARGET_NO_RESOURCES )
 #define EINFO_EIO_TARGET_NO_RESOURCES \
 	__einfo_uniqify ( EINFO_EIO, 0x02, "Target out of resources" )
+#define EIO_DIGEST \
+	__einfo_error ( EINFO_EIO_DIGEST )
+#define EINFO_EIO_DIGEST \
+	__einfo_uniqify ( EINFO_EIO, 0x03, "Digest mismatch" )
 #define ENOTSUP_INITIATOR_STATUS \
 	__einfo_error ( EINFO_ENOTSUP_INITIATOR_STATUS )
 #define EINFO_ENOTSUP_INITIATOR_STATUS \
@@ -141,11 +146,21 @@ FEATURE ( FEATURE_PROTOCOL, "iSCSI", DHCP_EB_FEATURE_ISCSI, 1 );
 	__einfo_error ( EINFO_EPROTO_VALUE_REJECTED )
 #define EINFO_EPROTO_VALUE_REJECTED					\
 	__einfo_uniqify ( EINFO_EPROTO, 0x06, "Parameter rejected" )
-
-static void iscsi_start_tx ( struct iscsi_session *iscsi );
+#define EPROTO_INVALID_TASK \
+	__einfo_error ( EINFO_EPROTO_INVALID_TASK )
+#define EINFO_EPROTO_INVALID_TASK \
+	__einfo_uniqify ( EINFO_EPROTO, 0x07, "Invalid task" )
+#define EPROTO_INVALID_R2T \
+	__einfo_error ( EINFO_EPROTO_INVALID_R2T )
+#define EINFO_EPROTO_INVALID_R2T \
+	__einfo_uniqify ( EINFO_EPROTO, 0x08, "Invalid R2T" )
+
+static void iscsi_start_tx ( struct iscsi_session *iscsi,
+			     struct iscsi_task *task );
 static void iscsi_start_login ( struct iscsi_session *iscsi );
 static void iscsi_start_data_out ( struct iscsi_session *iscsi,
-				   unsigned int datasn );
+				   struct iscsi_task *task );
+static void iscsi_tx_next ( struct iscsi_session *iscsi );
 
 /**
  * Finish receiving PDU data into buffer
@@ -205,7 +220,6 @@ static void iscsi_free ( struct refcnt *refcnt ) {
 	free ( iscsi->target_password );
 	chap_finish ( &iscsi->chap );
 	iscsi_rx_buffered_data_done ( iscsi );
-	free ( iscsi->command );
 	free ( iscsi );
 }
 
@@ -216,6 +230,7 @@ static void iscsi_free ( struct refcnt *refcnt ) {
  * @v rc		Reason for close
  */
 static void iscsi_close ( struct iscsi_session *iscsi, int rc ) {
+	unsigned int i;
 
 	/* A TCP graceful close is still an error from our point of view */
 	if ( rc == 0 )
@@ -227,19 +242,59 @@ static void iscsi_close ( struct iscsi_session *iscsi, int rc ) {
 	process_del ( &iscsi->process );
 
 	/* Shut down interfaces */
-	intfs_shutdown ( rc, &iscsi->socket, &iscsi->control, &iscsi->data,
-			 NULL );
+	intfs_shutdown ( rc, &iscsi->socket, &iscsi->control, NULL );
+	for ( i = 0 ; i < ISCSI_MAX_TASKS ; i++ ) {
+		iscsi->tasks[i].lead = NULL;
+		iscsi->tasks[i].flags = 0;
+		intf_shutdown ( &iscsi->tasks[i].data, rc );
+	}
 }
 
 /**
  * Assign new iSCSI initiator task tag
  *
- * @v iscsi		iSCSI session
+ * @ret itt		Initiator task tag
  */
-static void iscsi_new_itt ( struct iscsi_session *iscsi ) {
+static uint32_t iscsi_new_itt ( void ) {
 	static uint16_t itt_idx;
 
-	iscsi->itt = ( ISCSI_TAG_MAGIC | (++itt_idx) );
+	return ( ISCSI_TAG_MAGIC | (++itt_idx) );
+}
+
+/**
+ * Get digests in use for a new PDU
+ *
+ * @v iscsi		iSCSI session
+ * @ret digests		Digests in use
+ *
+ * Negotiated digests take effect only once the login phase has
+ * completed.
+ */
+static unsigned int iscsi_digests ( struct iscsi_session *iscsi ) {
+
+	if ( ( iscsi->status & ISCSI_STATUS_PHASE_MASK ) !=
+	     ISCSI_STATUS_FULL_FEATURE_PHASE )
+		return 0;
+	return iscsi->digests;
+}
+
+/**
+ * Transmit data segment of an iSCSI PDU
+ *
+ * @v iscsi		iSCSI session
+ * @v iobuf		I/O buffer containing data segment and padding
+ * @ret rc		Return status code
+ */
+static int iscsi_tx_deliver ( struct iscsi_session *iscsi,
+			      struct io_buffer *iobuf ) {
+
+	/* Calculate data digest, if applicable */
+	if ( iscsi->tx_digests & ISCSI_DATA_DIGEST ) {
+		iscsi->tx_crc = crc32c_le ( 0xffffffffUL, iobuf->data,
+					    iob_len ( iobuf ) );
+	}
+
+	return xfer_deliver_iob ( &iscsi->socket, iobuf );
 }
 
 /**
@@ -278,7 +333,14 @@ static int iscsi_open_connection ( struct iscsi_session *iscsi ) {
 	iscsi->isid_iana_qual = ( random() & 0xffff );
 
 	/* Assign fresh initiator task tag */
-	iscsi_new_itt ( iscsi );
+	iscsi->itt = iscsi_new_itt();
+
+	/* Reset negotiated parameters to their most restrictive values */
+	iscsi->initial_r2t = 1;
+	iscsi->immediate_data = 0;
+	iscsi->first_burst_len = ISCSI_DEFAULT_FIRST_BURST_LEN;
+	iscsi->max_send_len = ISCSI_DEFAULT_MAX_RECV_LEN;
+	iscsi->digests = 0;
 
 	/* Initiate login */
 	iscsi_start_login ( iscsi );
@@ -305,6 +367,7 @@ static void iscsi_close_connection ( struct iscsi_session *iscsi, int rc ) {
 
 	/* Reset TX and RX state machines */
 	iscsi->tx_state = ISCSI_TX_IDLE;
+	iscsi->tx_task = NULL;
 	iscsi->rx_state = ISCSI_RX_BHS;
 	iscsi->rx_offset = 0;
 
@@ -314,39 +377,119 @@ static void iscsi_close_connection ( struct iscsi_session *iscsi, int rc ) {
 }
 
 /**
- * Mark iSCSI SCSI operation as complete
+ * Find iSCSI task by initiator task tag
+ *
+ * @v iscsi		iSCSI session
+ * @v itt		Initiator task tag
+ * @ret task		iSCSI task, or NULL if not found
+ */
+static struct iscsi_task * iscsi_find_task ( struct iscsi_session *iscsi,
+					     uint32_t itt ) {
+	struct iscsi_task *task;
+	unsigned int i;
+
+	for ( i = 0 ; i < ISCSI_MAX_TASKS ; i++ ) {
+		task = &iscsi->tasks[i];
+		if ( ( task->flags & ISCSI_TASK_ACTIVE ) &&
+		     ( task->itt == itt ) )
+			return task;
+	}
+	return NULL;
+}
+
+/**
+ * Find unused iSCSI task
+ *
+ * @v iscsi		iSCSI session
+ * @ret task		iSCSI task, or NULL if none available
+ *
+ * A task may not be reused while it is still the subject of a
+ * partially transmitted PDU.
+ */
+static struct iscsi_task * iscsi_free_task ( struct iscsi_session *iscsi ) {
+	struct iscsi_task *task;
+	unsigned int i;
+
+	for ( i = 0 ; i < ISCSI_MAX_TASKS ; i++ ) {
+		task = &iscsi->tasks[i];
+		if ( ( task->lead == NULL ) && ( task != iscsi->tx_task ) )
+			return task;
+	}
+	return NULL;
+}
+
+/**
+ * Count unused iSCSI tasks
  *
  * @v iscsi		iSCSI session
+ * @ret count		Number of unused tasks
+ */
+static unsigned int iscsi_free_tasks ( struct iscsi_session *iscsi ) {
+	struct iscsi_task *task;
+	unsigned int count = 0;
+	unsigned int i;
+
+	for ( i = 0 ; i < ISCSI_MAX_TASKS ; i++ ) {
+		task = &iscsi->tasks[i];
+		if ( ( task->lead == NULL ) && ( task != iscsi->tx_task ) )
+			count++;
+	}
+	return count;
+}
+
+/**
+ * Mark iSCSI task as complete
+ *
+ * @v task		iSCSI task
  * @v rc		Return status code
  * @v rsp		SCSI response, if any
  *
- * Note that iscsi_scsi_done() will not close the connection, and must
- * therefore be called only when the internal state machines are in an
- * appropriate state, otherwise bad things may happen on the next call
- * to iscsi_scsi_command().  The general rule is to call
- * iscsi_scsi_done() only at the end of receiving a PDU; at this point
- * the TX and RX engines should both be idle.
+ * The SCSI command is completed once all of its constituent tasks
+ * have completed.  Note that iscsi_task_done() will not close the
+ * connection, and must therefore be called only at the end of
+ * receiving a PDU.
  */
-static void iscsi_scsi_done ( struct iscsi_session *iscsi, int rc,
+static void iscsi_task_done ( struct iscsi_task *task, int rc,
 			      struct scsi_rsp *rsp ) {
-	uint32_t itt = iscsi->itt;
+	struct iscsi_task *lead = task->lead;
+	uint32_t itt;
 
-	assert ( iscsi->tx_state == ISCSI_TX_IDLE );
+	/* Release task.  (The lead task is retained until the whole
+	 * SCSI command is complete.)
+	 */
+	task->flags = 0;
+	if ( task != lead )
+		task->lead = NULL;
+
+	/* Record response.  Prefer an error response over a
+	 * successful response, so that any failure is reported.
+	 */
+	if ( rsp && ( ( ! lead->have_rsp ) ||
+		      ( rsp->status && ! lead->rsp.status ) ) ) {
+		memcpy ( &lead->rsp, rsp, sizeof ( lead->rsp ) );
+		lead->have_rsp = 1;
+	}
+
+	/* Wait for all tasks to complete */
+	assert ( lead->pending > 0 );
+	if ( --lead->pending )
+		return;
 
-	/* Clear command */
-	free ( iscsi->command );
-	iscsi->command = NULL;
+	/* Release lead task */
+	lead->lead = NULL;
+	itt = lead->itt;
 
 	/* Send SCSI response, if any */
-	if ( rsp )
-		scsi_response ( &iscsi->data, rsp );
+	if ( lead->have_rsp )
+		scsi_response ( &lead->data, &lead->rsp );
 
 	/* Close SCSI command, if this is still the same command.  (It
 	 * is possible that the command interface has already been
-	 * closed as a result of the SCSI response we sent.)
+	 * closed as a result of the SCSI response we sent, and that
+	 * the task has been reused for a new command.)
 	 */
-	if ( iscsi->itt == itt )
-		intf_restart ( &iscsi->data, rc );
+	if ( lead->itt == itt )
+		intf_restart ( &lead->data, rc );
 }
 
 /****************************************************************************
@@ -359,41 +502,105 @@ static void iscsi_scsi_done ( struct iscsi_session *iscsi, int rc,
  * Build iSCSI SCSI command BHS
  *
  * @v iscsi		iSCSI session
+ * @v task		iSCSI task
  *
  * We don't currently support bidirectional commands (i.e. with both
  * Data-In and Data-Out segments); these would require providing code
  * to generate an AHS, and there doesn't seem to be any need for it at
  * the moment.
  */
-static void iscsi_start_command ( struct iscsi_session *iscsi ) {
+static void iscsi_start_command ( struct iscsi_session *iscsi,
+				  struct iscsi_task *task ) {
 	struct iscsi_bhs_scsi_command *command = &iscsi->tx_bhs.scsi_command;
 
-	assert ( ! ( iscsi->command->data_in && iscsi->command->data_out ) );
+	assert ( ! ( task->command.data_in && task->command.data_out ) );
 
 	/* Construct BHS and initiate transmission */
-	iscsi_start_tx ( iscsi );
+	iscsi_start_tx ( iscsi, task );
 	command->opcode = ISCSI_OPCODE_SCSI_COMMAND;
-	command->flags = ( ISCSI_FLAG_FINAL |
-			   ISCSI_COMMAND_ATTR_SIMPLE );
-	if ( iscsi->command->data_in )
+	command->flags = ISCSI_COMMAND_ATTR_SIMPLE;
+	if ( task->offset == task->end )
+		command->flags |= ISCSI_FLAG_FINAL;
+	if ( task->command.data_in )
 		command->flags |= ISCSI_COMMAND_FLAG_READ;
-	if ( iscsi->command->data_out )
+	if ( task->command.data_out )
 		command->flags |= ISCSI_COMMAND_FLAG_WRITE;
-	/* lengths left as zero */
-	memcpy ( &command->lun, &iscsi->command->lun,
-		 sizeof ( command->lun ) );
-	command->itt = htonl ( iscsi->itt );
-	command->exp_len = htonl ( iscsi->command->data_in_len |
-				   iscsi->command->data_out_len );
-	command->cmdsn = htonl ( iscsi->cmdsn );
+	ISCSI_SET_LENGTHS ( command->lengths, 0, task->immediate_len );
+	memcpy ( &command->lun, &task->command.lun, sizeof ( command->lun ) );
+	command->itt = htonl ( task->itt );
+	command->exp_len = htonl ( task->command.data_in_len |
+				   task->command.data_out_len );
+	command->cmdsn = htonl ( task->cmdsn );
 	command->expstatsn = htonl ( iscsi->statsn + 1 );
-	memcpy ( &command->cdb, &iscsi->command->cdb, sizeof ( command->cdb ));
-	DBGC2 ( iscsi, "iSCSI %p start " SCSI_CDB_FORMAT " %s %#zx\n",
-		iscsi, SCSI_CDB_DATA ( command->cdb ),
-		( iscsi->command->data_in ? "in" : "out" ),
-		( iscsi->command->data_in ?
-		  iscsi->command->data_in_len :
-		  iscsi->command->data_out_len ) );
+	memcpy ( &command->cdb, &task->command.cdb, sizeof ( command->cdb ) );
+	DBGC2 ( iscsi, "iSCSI %p tag %08x CmdSN %#x start " SCSI_CDB_FORMAT
+		" %s %#zx\n", iscsi, task->itt, task->cmdsn,
+		SCSI_CDB_DATA ( command->cdb ),
+		( task->command.data_in ? "in" : "out" ),
+		( task->command.data_in ? task->command.data_in_len :
+		  task->command.data_out_len ) );
+	if ( task->command.data_out ) {
+		DBGC2 ( iscsi, "iSCSI %p tag %08x immediate %#zx unsolicited "
+			"%#zx\n", iscsi, task->itt, task->immediate_len,
+			task->end );
+	}
+}
+
+/**
+ * Complete iSCSI SCSI command PDU transmission
+ *
+ * @v iscsi		iSCSI session
+ * @v task		iSCSI task
+ */
+static void iscsi_command_done ( struct iscsi_session *iscsi __unused,
+				 struct iscsi_task *task ) {
+
+	/* Do nothing if task has already been completed */
+	if ( ! ( task->flags & ISCSI_TASK_TX_COMMAND ) )
+		return;
+	task->flags &= ~ISCSI_TASK_TX_COMMAND;
+
+	/* Start sending any unsolicited data-out PDUs */
+	if ( task->offset < task->end )
+		task->flags |= ISCSI_TASK_TX_DATA;
+}
+
+/**
+ * Transmit data segment of an iSCSI SCSI command PDU
+ *
+ * @v iscsi		iSCSI session
+ * @v task		iSCSI task
+ * @ret rc		Return status code
+ *
+ * For SCSI commands, the data segment consists of any immediate
+ * data.
+ */
+static int iscsi_tx_command ( struct iscsi_session *iscsi,
+			      struct iscsi_task *task ) {
+	struct iscsi_bhs_scsi_command *command = &iscsi->tx_bhs.scsi_command;
+	struct io_buffer *iobuf;
+	size_t len;
+	size_t pad_len;
+
+	len = ISCSI_DATA_LEN ( command->lengths );
+	pad_len = ISCSI_DATA_PAD_LEN ( command->lengths );
+
+	/* Do nothing if there is no immediate data */
+	if ( ! len )
+		return 0;
+
+	assert ( task->command.data_out );
+	assert ( len <= task->command.data_out_len );
+
+	iobuf = xfer_alloc_iob ( &iscsi->socket, ( len + pad_len ) );
+	if ( ! iobuf )
+		return -ENOMEM;
+
+	copy_from_user ( iob_put ( iobuf, len ),
+			 task->command.data_out, 0, len );
+	memset ( iob_put ( iobuf, pad_len ), 0, pad_len );
+
+	return iscsi_tx_deliver ( iscsi, iobuf );
 }
 
 /**
@@ -410,6 +617,7 @@ static int iscsi_rx_scsi_response ( struct iscsi_session *iscsi,
 				    size_t remaining ) {
 	struct iscsi_bhs_scsi_response *response
 		= &iscsi->rx_bhs.scsi_response;
+	struct iscsi_task *task;
 	struct scsi_rsp rsp;
 	uint32_t residual_count;
 	size_t data_len;
@@ -444,8 +652,16 @@ static int iscsi_rx_scsi_response ( struct iscsi_session *iscsi,
 	if ( response->response != ISCSI_RESPONSE_COMMAND_COMPLETE )
 		return -EIO;
 
+	/* Identify task */
+	task = iscsi_find_task ( iscsi, ntohl ( response->itt ) );
+	if ( ! task ) {
+		DBGC ( iscsi, "iSCSI %p received SCSI response for unknown "
+		       "tag %08x\n", iscsi, ntohl ( response->itt ) );
+		return -EPROTO_INVALID_TASK;
+	}
+
 	/* Mark as completed */
-	iscsi_scsi_done ( iscsi, 0, &rsp );
+	iscsi_task_done ( task, 0, &rsp );
 	return 0;
 }
 
@@ -462,14 +678,22 @@ static int iscsi_rx_data_in ( struct iscsi_session *iscsi,
 			      const void *data, size_t len,
 			      size_t remaining ) {
 	struct iscsi_bhs_data_in *data_in = &iscsi->rx_bhs.data_in;
+	struct iscsi_task *task;
 	unsigned long offset;
 
+	/* Identify task */
+	task = iscsi_find_task ( iscsi, ntohl ( data_in->itt ) );
+	if ( ! task ) {
+		DBGC ( iscsi, "iSCSI %p received data-in for unknown tag "
+		       "%08x\n", iscsi, ntohl ( data_in->itt ) );
+		return -EPROTO_INVALID_TASK;
+	}
+
 	/* Copy data to data-in buffer */
 	offset = ntohl ( data_in->offset ) + iscsi->rx_offset;
-	assert ( iscsi->command != NULL );
-	assert ( iscsi->command->data_in );
-	assert ( ( offset + len ) <= iscsi->command->data_in_len );
-	copy_to_user ( iscsi->command->data_in, offset, data, len );
+	assert ( task->command.data_in );
+	assert ( ( offset + len ) <= task->command.data_in_len );
+	copy_to_user ( task->command.data_in, offset, data, len );
 
 	/* Wait for whole SCSI response to arrive */
 	if ( remaining )
@@ -477,15 +701,33 @@ static int iscsi_rx_data_in ( struct iscsi_session *iscsi,
 
 	/* Mark as completed if status is present */
 	if ( data_in->flags & ISCSI_DATA_FLAG_STATUS ) {
-		assert ( ( offset + len ) == iscsi->command->data_in_len );
+		assert ( ( offset + len ) == task->command.data_in_len );
 		assert ( data_in->flags & ISCSI_FLAG_FINAL );
 		/* iSCSI cannot return an error status via a data-in */
-		iscsi_scsi_done ( iscsi, 0, NULL );
+		iscsi_task_done ( task, 0, NULL );
 	}
 
 	return 0;
 }
 
+/**
+ * Start data-out sequence for pending R2T
+ *
+ * @v task		iSCSI task
+ */
+static void iscsi_data_out_sequence ( struct iscsi_task *task ) {
+
+	assert ( task->flags & ISCSI_TASK_R2T );
+	assert ( ! ( task->flags & ISCSI_TASK_TX_DATA ) );
+
+	task->ttt = task->r2t_ttt;
+	task->datasn = 0;
+	task->offset = task->r2t_offset;
+	task->end = ( task->r2t_offset + task->r2t_len );
+	task->flags &= ~ISCSI_TASK_R2T;
+	task->flags |= ISCSI_TASK_TX_DATA;
+}
+
 /**
  * Receive data segment of an iSCSI R2T PDU
  *
@@ -499,12 +741,42 @@ static int iscsi_rx_r2t ( struct iscsi_session *iscsi,
 			  const void *data __unused, size_t len __unused,
 			  size_t remaining __unused ) {
 	struct iscsi_bhs_r2t *r2t = &iscsi->rx_bhs.r2t;
+	struct iscsi_task *task;
+	size_t offset;
+	size_t r2t_len;
+
+	/* Identify task */
+	task = iscsi_find_task ( iscsi, ntohl ( r2t->itt ) );
+	if ( ! task ) {
+		DBGC ( iscsi, "iSCSI %p received R2T for unknown tag %08x\n",
+		       iscsi, ntohl ( r2t->itt ) );
+		return -EPROTO_INVALID_TASK;
+	}
+
+	/* Sanity check */
+	offset = ntohl ( r2t->offset );
+	r2t_len = ntohl ( r2t->len );
+	if ( ( task->flags & ISCSI_TASK_R2T ) ||
+	     ( offset > task->command.data_out_len ) ||
+	     ( r2t_len > ( task->command.data_out_len - offset ) ) ) {
+		DBGC ( iscsi, "iSCSI %p tag %08x invalid R2T %#zx+%#zx\n",
+		       iscsi, task->itt, offset, r2t_len );
+		return -EPROTO_INVALID_R2T;
+	}
 
-	/* Record transfer parameters and trigger first data-out */
-	iscsi->ttt = ntohl ( r2t->ttt );
-	iscsi->transfer_offset = ntohl ( r2t->offset );
-	iscsi->transfer_len = ntohl ( r2t->len );
-	iscsi_start_data_out ( iscsi, 0 );
+	/* Record transfer parameters */
+	task->r2t_ttt = ntohl ( r2t->ttt );
+	task->r2t_offset = offset;
+	task->r2t_len = r2t_len;
+	task->flags |= ISCSI_TASK_R2T;
+
+	/* Start data-out sequence, unless a sequence (of unsolicited
+	 * data) is still in progress.
+	 */
+	if ( ! ( task->flags & ISCSI_TASK_TX_DATA ) ) {
+		iscsi_data_out_sequence ( task );
+		iscsi_tx_next ( iscsi );
+	}
 
 	return 0;
 }
@@ -513,64 +785,74 @@ static int iscsi_rx_r2t ( struct iscsi_session *iscsi,
  * Build iSCSI data-out BHS
  *
  * @v iscsi		iSCSI session
- * @v datasn		Data sequence number within the transfer
- *
+ * @v task		iSCSI task
  */
 static void iscsi_start_data_out ( struct iscsi_session *iscsi,
-				   unsigned int datasn ) {
+				   struct iscsi_task *task ) {
 	struct iscsi_bhs_data_out *data_out = &iscsi->tx_bhs.data_out;
-	unsigned long offset;
-	unsigned long remaining;
-	unsigned long len;
+	size_t remaining;
+	size_t len;
 
-	/* We always send 512-byte Data-Out PDUs; this removes the
-	 * need to worry about the target's MaxRecvDataSegmentLength.
-	 */
-	offset = datasn * 512;
-	remaining = iscsi->transfer_len - offset;
+	/* Send as much as the target is prepared to receive */
+	remaining = ( task->end - task->offset );
 	len = remaining;
-	if ( len > 512 )
-		len = 512;
+	if ( len > iscsi->max_send_len )
+		len = iscsi->max_send_len;
 
 	/* Construct BHS and initiate transmission */
-	iscsi_start_tx ( iscsi );
+	iscsi_start_tx ( iscsi, task );
 	data_out->opcode = ISCSI_OPCODE_DATA_OUT;
 	if ( len == remaining )
 		data_out->flags = ( ISCSI_FLAG_FINAL );
 	ISCSI_SET_LENGTHS ( data_out->lengths, 0, len );
-	data_out->lun = iscsi->command->lun;
-	data_out->itt = htonl ( iscsi->itt );
-	data_out->ttt = htonl ( iscsi->ttt );
+	data_out->lun = task->command.lun;
+	data_out->itt = htonl ( task->itt );
+	data_out->ttt = htonl ( task->ttt );
 	data_out->expstatsn = htonl ( iscsi->statsn + 1 );
-	data_out->datasn = htonl ( datasn );
-	data_out->offset = htonl ( iscsi->transfer_offset + offset );
-	DBGC ( iscsi, "iSCSI %p start data out DataSN %#x len %#lx\n",
-	       iscsi, datasn, len );
+	data_out->datasn = htonl ( task->datasn );
+	data_out->offset = htonl ( task->offset );
+	DBGC2 ( iscsi, "iSCSI %p tag %08x start data out DataSN %#x offset "
+		"%#zx len %#zx\n", iscsi, task->itt, task->datasn,
+		task->offset, len );
+
+	/* Advance within sequence */
+	task->datasn++;
+	task->offset += len;
 }
 
 /**
  * Complete iSCSI data-out PDU transmission
  *
  * @v iscsi		iSCSI session
- *
+ * @v task		iSCSI task
  */
-static void iscsi_data_out_done ( struct iscsi_session *iscsi ) {
+static void iscsi_data_out_done ( struct iscsi_session *iscsi,
+				  struct iscsi_task *task ) {
 	struct iscsi_bhs_data_out *data_out = &iscsi->tx_bhs.data_out;
 
-	/* If we haven't reached the end of the sequence, start
-	 * sending the next data-out PDU.
+	/* Do nothing if task has already been completed, or if we
+	 * haven't reached the end of the sequence.
 	 */
+	if ( ! ( task->flags & ISCSI_TASK_TX_DATA ) )
+		return;
 	if ( ! ( data_out->flags & ISCSI_FLAG_FINAL ) )
-		iscsi_start_data_out ( iscsi, ntohl ( data_out->datasn ) + 1 );
+		return;
+	task->flags &= ~ISCSI_TASK_TX_DATA;
+
+	/* Start any pending R2T sequence */
+	if ( task->flags & ISCSI_TASK_R2T )
+		iscsi_data_out_sequence ( task );
 }
 
 /**
  * Send iSCSI data-out data segment
  *
  * @v iscsi		iSCSI session
+ * @v task		iSCSI task
  * @ret rc		Return status code
  */
-static int iscsi_tx_data_out ( struct iscsi_session *iscsi ) {
+static int iscsi_tx_data_out ( struct iscsi_session *iscsi,
+			       struct iscsi_task *task ) {
 	struct iscsi_bhs_data_out *data_out = &iscsi->tx_bhs.data_out;
 	struct io_buffer *iobuf;
 	unsigned long offset;
@@ -581,19 +863,18 @@ static int iscsi_tx_data_out ( struct iscsi_session *iscsi ) {
 	len = ISCSI_DATA_LEN ( data_out->lengths );
 	pad_len = ISCSI_DATA_PAD_LEN ( data_out->lengths );
 
-	assert ( iscsi->command != NULL );
-	assert ( iscsi->command->data_out );
-	assert ( ( offset + len ) <= iscsi->command->data_out_len );
+	assert ( task->command.data_out );
+	assert ( ( offset + len ) <= task->command.data_out_len );
 
 	iobuf = xfer_alloc_iob ( &iscsi->socket, ( len + pad_len ) );
 	if ( ! iobuf )
 		return -ENOMEM;
 	
 	copy_from_user ( iob_put ( iobuf, len ),
-			 iscsi->command->data_out, offset, len );
+			 task->command.data_out, offset, len );
 	memset ( iob_put ( iobuf, pad_len ), 0, pad_len );
 
-	return xfer_deliver_iob ( &iscsi->socket, iobuf );
+	return iscsi_tx_deliver ( iscsi, iobuf );
 }
 
 /**
@@ -642,14 +923,14 @@ static int iscsi_rx_nop_in ( struct iscsi_session *iscsi,
  * These are the initial set of strings sent in the first login
  * request PDU.  We want the following settings:
  *
- *     HeaderDigest=None
- *     DataDigest=None
+ *     HeaderDigest=None,CRC32C [6]
+ *     DataDigest=None,CRC32C [6]
  *     MaxConnections=1 (irrelevant; we make only one connection anyway) [4]
- *     InitialR2T=Yes [1]
- *     ImmediateData=No (irrelevant; we never send immediate data) [4]
- *     MaxRecvDataSegmentLength=8192 (default; we don't care) [3]
- *     MaxBurstLength=262144 (default; we don't care) [3]
- *     FirstBurstLength=65536 (irrelevant due to other settings) [5]
+ *     InitialR2T=No [1]
+ *     ImmediateData=Yes [1]
+ *     MaxRecvDataSegmentLength=65536 [3]
+ *     MaxBurstLength=16776192 [3]
+ *     FirstBurstLength=262144 [5]
  *     DefaultTime2Wait=0 [2]
  *     DefaultTime2Retain=0 [2]
  *     MaxOutstandingR2T=1
@@ -657,33 +938,40 @@ static int iscsi_rx_nop_in ( struct iscsi_session *iscsi,
  *     DataSequenceInOrder=Yes
  *     ErrorRecoveryLevel=0
  *
- * [1] InitialR2T has an OR resolution function, so the target may
- * force us to use it.  We therefore simplify our logic by always
- * using it.
+ * [1] InitialR2T has an OR resolution function and ImmediateData has
+ * an AND resolution function, so the target may force us to wait for
+ * an R2T before sending any write data.  We use unsolicited data only
+ * if the target explicitly agrees to it.
  *
  * [2] These ensure that we can safely start a new task once we have
  * reconnected after a failure, without having to manually tidy up
  * after the old one.
  *
- * [3] We are quite happy to use the RFC-defined default values for
- * these parameters, but some targets (notably OpenSolaris)
- * incorrectly assume a default value of zero, so we explicitly
- * specify the default values.
+ * [3] Larger values reduce the number of PDUs and R2Ts required for
+ * each command.  (Some targets, notably OpenSolaris, incorrectly
+ * assume a default value of zero, so these must in any case be
+ * specified explicitly.)
  *
  * [4] We are quite happy to use the RFC-defined default values for
  * these parameters, but some targets (notably a QNAP TS-639Pro) fail
  * unless they are supplied, so we explicitly specify the default
  * values.
  *
- * [5] FirstBurstLength is defined to be irrelevant since we already
- * force InitialR2T=Yes and ImmediateData=No, but some targets
- * (notably LIO as of kernel 4.11) fail unless it is specified, so we
- * explicitly specify the default value.
+ * [5] FirstBurstLength limits the amount of unsolicited data that we
+ * may send with each command.  (Some targets, notably LIO as of
+ * kernel 4.11, fail unless it is specified even when unsolicited data
+ * is disabled.)
+ *
+ * [6] The target selects the first value in our list that it
+ * supports.  We list CRC32C first only if digests have been
+ * explicitly requested via the "iscsi-digest" setting, but always
+ * permit them so that we can connect to targets that require them.
  */
 static int iscsi_build_login_request_strings ( struct iscsi_session *iscsi,
 					       void *data, size_t len ) {
 	unsigned int used = 0;
 	const char *auth_method;
+	const char *digest;
 
 	if ( iscsi->status & ISCSI_STATUS_STRINGS_SECURITY ) {
 		/* Default to allowing no authentication */
@@ -729,22 +1017,28 @@ static int iscsi_build_login_request_strings ( struct iscsi_session *iscsi,
 	}
 
 	if ( iscsi->status & ISCSI_STATUS_STRINGS_OPERATIONAL ) {
+		digest = ( iscsi->digest_preferred ?
+			   "CRC32C,None" : "None,CRC32C" );
 		used += ssnprintf ( data + used, len - used,
-				    "HeaderDigest=None%c"
-				    "DataDigest=None%c"
+				    "HeaderDigest=%s%c"
+				    "DataDigest=%s%c"
 				    "MaxConnections=1%c"
-				    "InitialR2T=Yes%c"
-				    "ImmediateData=No%c"
-				    "MaxRecvDataSegmentLength=8192%c"
-				    "MaxBurstLength=262144%c"
-				    "FirstBurstLength=65536%c"
+				    "InitialR2T=No%c"
+				    "ImmediateData=Yes%c"
+				    "MaxRecvDataSegmentLength=%d%c"
+				    "MaxBurstLength=%d%c"
+				    "FirstBurstLength=%d%c"
 				    "DefaultTime2Wait=0%c"
 				    "DefaultTime2Retain=0%c"
 				    "MaxOutstandingR2T=1%c"
 				    "DataPDUInOrder=Yes%c"
 				    "DataSequenceInOrder=Yes%c"
 				    "ErrorRecoveryLevel=0%c",
-				    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 );
+				    digest, 0, digest, 0, 0, 0, 0,
+				    ISCSI_MAX_RECV_LEN, 0,
+				    ISCSI_MAX_BURST_LEN, 0,
+				    ISCSI_FIRST_BURST_LEN, 0, 0, 0, 0, 0, 0,
+				    0 );
 	}
 
 	return used;
@@ -773,7 +1067,7 @@ static void iscsi_start_login ( struct iscsi_session *iscsi ) {
 	}
 
 	/* Construct BHS and initiate transmission */
-	iscsi_start_tx ( iscsi );
+	iscsi_start_tx ( iscsi, NULL );
 	request->opcode = ( ISCSI_OPCODE_LOGIN_REQUEST |
 			    ISCSI_FLAG_IMMEDIATE );
 	request->flags = ( ( iscsi->status & ISCSI_STATUS_PHASE_MASK ) |
@@ -829,7 +1123,7 @@ static int iscsi_tx_login_request ( struct iscsi_session *iscsi ) {
 	iscsi_build_login_request_strings ( iscsi, iobuf->data, len );
 	memset ( iob_put ( iobuf, pad_len ), 0, pad_len );
 
-	return xfer_deliver_iob ( &iscsi->socket, iobuf );
+	return iscsi_tx_deliver ( iscsi, iobuf );
 }
 
 /**
@@ -1097,6 +1391,147 @@ static int iscsi_handle_chap_r_value ( struct iscsi_session *iscsi,
 	return 0;
 }
 
+/**
+ * Handle iSCSI InitialR2T text value
+ *
+ * @v iscsi		iSCSI session
+ * @v value		InitialR2T value
+ * @ret rc		Return status code
+ */
+static int iscsi_handle_initialr2t_value ( struct iscsi_session *iscsi,
+					   const char *value ) {
+
+	iscsi->initial_r2t = ( strcmp ( value, "No" ) != 0 );
+	return 0;
+}
+
+/**
+ * Handle iSCSI ImmediateData text value
+ *
+ * @v iscsi		iSCSI session
+ * @v value		ImmediateData value
+ * @ret rc		Return status code
+ */
+static int iscsi_handle_immediatedata_value ( struct iscsi_session *iscsi,
+					      const char *value ) {
+
+	iscsi->immediate_data = ( strcmp ( value, "Yes" ) == 0 );
+	return 0;
+}
+
+/**
+ * Parse iSCSI digest text value
+ *
+ * @v iscsi		iSCSI session
+ * @v value		Digest value
+ * @v digest		Digest flag
+ * @ret rc		Return status code
+ */
+static int iscsi_digest_value ( struct iscsi_session *iscsi,
+				const char *value, unsigned int digest ) {
+
+	if ( strcmp ( value, "CRC32C" ) == 0 ) {
+		iscsi->digests |= digest;
+	} else if ( strcmp ( value, "None" ) == 0 ) {
+		iscsi->digests &= ~digest;
+	} else {
+		DBGC ( iscsi, "iSCSI %p invalid digest \"%s\"\n",
+		       iscsi, value );
+		return -EPROTO_INVALID_KEY_VALUE_PAIR;
+	}
+	return 0;
+}
+
+/**
+ * Handle iSCSI HeaderDigest text value
+ *
+ * @v iscsi		iSCSI session
+ * @v value		HeaderDigest value
+ * @ret rc		Return status code
+ */
+static int iscsi_handle_headerdigest_value ( struct iscsi_session *iscsi,
+					     const char *value ) {
+
+	return iscsi_digest_value ( iscsi, value, ISCSI_HEADER_DIGEST );
+}
+
+/**
+ * Handle iSCSI DataDigest text value
+ *
+ * @v iscsi		iSCSI session
+ * @v value		DataDigest value
+ * @ret rc		Return status code
+ */
+static int iscsi_handle_datadigest_value ( struct iscsi_session *iscsi,
+					   const char *value ) {
+
+	return iscsi_digest_value ( iscsi, value, ISCSI_DATA_DIGEST );
+}
+
+/**
+ * Parse iSCSI numerical text value
+ *
+ * @v value		Text value
+ * @v max		Maximum value that we will use
+ * @ret num		Numerical value (limited to maximum), or zero if invalid
+ */
+static size_t iscsi_numeric_value ( const char *value, size_t max ) {
+	unsigned long num;
+	char *end;
+
+	num = strtoul ( value, &end, 0 );
+	if ( *end )
+		return 0;
+	if ( num > max )
+		num = max;
+	return num;
+}
+
+/**
+ * Handle iSCSI FirstBurstLength text value
+ *
+ * @v iscsi		iSCSI session
+ * @v value		FirstBurstLength value
+ * @ret rc		Return status code
+ */
+static int iscsi_handle_firstburstlength_value ( struct iscsi_session *iscsi,
+						 const char *value ) {
+	size_t len;
+
+	len = iscsi_numeric_value ( value, ISCSI_FIRST_BURST_LEN );
+	if ( ! len ) {
+		DBGC ( iscsi, "iSCSI %p invalid FirstBurstLength \"%s\"\n",
+		       iscsi, value );
+		return -EPROTO_INVALID_KEY_VALUE_PAIR;
+	}
+	iscsi->first_burst_len = len;
+	return 0;
+}
+
+/**
+ * Handle iSCSI MaxRecvDataSegmentLength text value
+ *
+ * @v iscsi		iSCSI session
+ * @v value		MaxRecvDataSegmentLength value
+ * @ret rc		Return status code
+ *
+ * This is a declarative value: the target is stating the maximum
+ * length of data segment that it is prepared to receive from us.
+ */
+static int iscsi_handle_mrdsl_value ( struct iscsi_session *iscsi,
+				     const char *value ) {
+	size_t len;
+
+	len = iscsi_numeric_value ( value, ISCSI_MAX_RECV_LEN );
+	if ( ! len ) {
+		DBGC ( iscsi, "iSCSI %p invalid MaxRecvDataSegmentLength "
+		       "\"%s\"\n", iscsi, value );
+		return -EPROTO_INVALID_KEY_VALUE_PAIR;
+	}
+	iscsi->max_send_len = len;
+	return 0;
+}
+
 /** An iSCSI text string that we want to handle */
 struct iscsi_string_type {
 	/** String key
@@ -1123,6 +1558,12 @@ static struct iscsi_string_type iscsi_string_types[] = {
 	{ "CHAP_C", iscsi_handle_chap_c_value },
 	{ "CHAP_N", iscsi_handle_chap_n_value },
 	{ "CHAP_R", iscsi_handle_chap_r_value },
+	{ "InitialR2T", iscsi_handle_initialr2t_value },
+	{ "ImmediateData", iscsi_handle_immediatedata_value },
+	{ "FirstBurstLength", iscsi_handle_firstburstlength_value },
+	{ "MaxRecvDataSegmentLength", iscsi_handle_mrdsl_value },
+	{ "HeaderDigest", iscsi_handle_headerdigest_value },
+	{ "DataDigest", iscsi_handle_datadigest_value },
 	{ NULL, NULL }
 };
 
@@ -1330,6 +1771,15 @@ static int iscsi_rx_login_response ( struct iscsi_session *iscsi,
 
 	/* Notify SCSI layer of window change */
 	DBGC ( iscsi, "iSCSI %p entering full feature phase\n", iscsi );
+	DBGC ( iscsi, "iSCSI %p using%s%s%s%s first burst %#zx max data "
+	       "segment %#zx\n", iscsi,
+	       ( iscsi->initial_r2t ? "" : " unsolicited data," ),
+	       ( iscsi->immediate_data ? " immediate data," : "" ),
+	       ( ( iscsi->digests & ISCSI_HEADER_DIGEST ) ?
+		 " header digest," : "" ),
+	       ( ( iscsi->digests & ISCSI_DATA_DIGEST ) ?
+		 " data digest," : "" ),
+	       iscsi->first_burst_len, iscsi->max_send_len );
 	xfer_window_changed ( &iscsi->control );
 
 	return 0;
@@ -1363,16 +1813,20 @@ static void iscsi_tx_resume ( struct iscsi_session *iscsi ) {
  * Start up a new TX PDU
  *
  * @v iscsi		iSCSI session
+ * @v task		iSCSI task, or NULL
  *
  * This initiates the process of sending a new PDU.  Only one PDU may
  * be in transit at any one time.
  */
-static void iscsi_start_tx ( struct iscsi_session *iscsi ) {
+static void iscsi_start_tx ( struct iscsi_session *iscsi,
+			     struct iscsi_task *task ) {
 
 	assert ( iscsi->tx_state == ISCSI_TX_IDLE );
 
 	/* Initialise TX BHS */
 	memset ( &iscsi->tx_bhs, 0, sizeof ( iscsi->tx_bhs ) );
+	iscsi->tx_task = task;
+	iscsi->tx_digests = iscsi_digests ( iscsi );
 
 	/* Flag TX engine to start transmitting */
 	iscsi->tx_state = ISCSI_TX_BHS;
@@ -1402,6 +1856,35 @@ static int iscsi_tx_bhs ( struct iscsi_session *iscsi ) {
 				  sizeof ( iscsi->tx_bhs ) );
 }
 
+/**
+ * Transmit header digest of an iSCSI PDU
+ *
+ * @v iscsi		iSCSI session
+ * @ret rc		Return status code
+ */
+static int iscsi_tx_header_digest ( struct iscsi_session *iscsi ) {
+	uint32_t digest;
+
+	digest = cpu_to_le32 ( ~crc32c_le ( 0xffffffffUL, &iscsi->tx_bhs,
+					     sizeof ( iscsi->tx_bhs ) ) );
+	return xfer_deliver_raw ( &iscsi->socket, &digest,
+				  sizeof ( digest ) );
+}
+
+/**
+ * Transmit data digest of an iSCSI PDU
+ *
+ * @v iscsi		iSCSI session
+ * @ret rc		Return status code
+ */
+static int iscsi_tx_data_digest ( struct iscsi_session *iscsi ) {
+	uint32_t digest;
+
+	digest = cpu_to_le32 ( ~iscsi->tx_crc );
+	return xfer_deliver_raw ( &iscsi->socket, &digest,
+				  sizeof ( digest ) );
+}
+
 /**
  * Transmit data segment of an iSCSI PDU
  *
@@ -1415,8 +1898,10 @@ static int iscsi_tx_data ( struct iscsi_session *iscsi ) {
 	struct iscsi_bhs_common *common = &iscsi->tx_bhs.common;
 
 	switch ( common->opcode & ISCSI_OPCODE_MASK ) {
+	case ISCSI_OPCODE_SCSI_COMMAND:
+		return iscsi_tx_command ( iscsi, iscsi->tx_task );
 	case ISCSI_OPCODE_DATA_OUT:
-		return iscsi_tx_data_out ( iscsi );
+		return iscsi_tx_data_out ( iscsi, iscsi->tx_task );
 	case ISCSI_OPCODE_LOGIN_REQUEST:
 		return iscsi_tx_login_request ( iscsi );
 	default:
@@ -1441,8 +1926,11 @@ static void iscsi_tx_done ( struct iscsi_session *iscsi ) {
 	iscsi_tx_pause ( iscsi );
 
 	switch ( common->opcode & ISCSI_OPCODE_MASK ) {
+	case ISCSI_OPCODE_SCSI_COMMAND:
+		iscsi_command_done ( iscsi, iscsi->tx_task );
+		break;
 	case ISCSI_OPCODE_DATA_OUT:
-		iscsi_data_out_done ( iscsi );
+		iscsi_data_out_done ( iscsi, iscsi->tx_task );
 		break;
 	case ISCSI_OPCODE_LOGIN_REQUEST:
 		iscsi_login_request_done ( iscsi );
@@ -1451,6 +1939,64 @@ static void iscsi_tx_done ( struct iscsi_session *iscsi ) {
 		/* No action */
 		break;
 	}
+	iscsi->tx_task = NULL;
+
+	/* Start next PDU, if any */
+	iscsi_tx_next ( iscsi );
+}
+
+/**
+ * Start next iSCSI task PDU, if any
+ *
+ * @v iscsi		iSCSI session
+ *
+ * Pending data-out sequences take priority over new commands, so
+ * that writes already in progress are not starved.  New commands are
+ * transmitted in CmdSN order, up to the target's MaxCmdSN.
+ */
+static void iscsi_tx_next ( struct iscsi_session *iscsi ) {
+	struct iscsi_task *task;
+	struct iscsi_task *next = NULL;
+	unsigned int i;
+
+	/* Do nothing unless TX engine is idle and login is complete */
+	if ( iscsi->tx_state != ISCSI_TX_IDLE )
+		return;
+	if ( ( iscsi->status & ISCSI_STATUS_PHASE_MASK ) !=
+	     ISCSI_STATUS_FULL_FEATURE_PHASE )
+		return;
+
+	/* Continue any data-out sequence */
+	for ( i = 0 ; i < ISCSI_MAX_TASKS ; i++ ) {
+		task = &iscsi->tasks[i];
+		if ( task->flags & ISCSI_TASK_TX_DATA ) {
+			iscsi_start_data_out ( iscsi, task );
+			return;
+		}
+	}
+
+	/* Find oldest untransmitted command */
+	for ( i = 0 ; i < ISCSI_MAX_TASKS ; i++ ) {
+		task = &iscsi->tasks[i];
+		if ( ! ( task->flags & ISCSI_TASK_TX_COMMAND ) )
+			continue;
+		if ( ( ! next ) ||
+		     ( ( int32_t ) ( task->cmdsn - next->cmdsn ) < 0 ) )
+			next = task;
+	}
+	if ( ! next )
+		return;
+
+	/* Wait until target is prepared to accept command */
+	if ( ( int32_t ) ( next->cmdsn - iscsi->maxcmdsn ) > 0 ) {
+		DBGC2 ( iscsi, "iSCSI %p tag %08x waiting for MaxCmdSN %#x to "
+			"reach %#x\n", iscsi, next->itt, iscsi->maxcmdsn,
+			next->cmdsn );
+		return;
+	}
+
+	/* Start command */
+	iscsi_start_command ( iscsi, next );
 }
 
 /**
@@ -1480,11 +2026,32 @@ static void iscsi_tx_step ( struct iscsi_session *iscsi ) {
 		case ISCSI_TX_AHS:
 			tx = iscsi_tx_nothing;
 			tx_len = 0;
+			next_state = ISCSI_TX_HEADER_DIGEST;
+			break;
+		case ISCSI_TX_HEADER_DIGEST:
+			if ( iscsi->tx_digests & ISCSI_HEADER_DIGEST ) {
+				tx = iscsi_tx_header_digest;
+				tx_len = sizeof ( uint32_t );
+			} else {
+				tx = iscsi_tx_nothing;
+				tx_len = 0;
+			}
 			next_state = ISCSI_TX_DATA;
 			break;
 		case ISCSI_TX_DATA:
 			tx = iscsi_tx_data;
 			tx_len = ISCSI_DATA_LEN ( common->lengths );
+			next_state = ISCSI_TX_DATA_DIGEST;
+			break;
+		case ISCSI_TX_DATA_DIGEST:
+			if ( ( iscsi->tx_digests & ISCSI_DATA_DIGEST ) &&
+			     ISCSI_DATA_LEN ( common->lengths ) ) {
+				tx = iscsi_tx_data_digest;
+				tx_len = sizeof ( uint32_t );
+			} else {
+				tx = iscsi_tx_nothing;
+				tx_len = 0;
+			}
 			next_state = ISCSI_TX_IDLE;
 			break;
 		case ISCSI_TX_IDLE:
@@ -1586,12 +2153,33 @@ static int iscsi_rx_data ( struct iscsi_session *iscsi, const void *data,
 			   size_t len, size_t remaining ) {
 	struct iscsi_bhs_common_response *response
 		= &iscsi->rx_bhs.common_response;
+	unsigned int opcode = ( response->opcode & ISCSI_OPCODE_MASK );
+	uint32_t expcmdsn = ntohl ( response->expcmdsn );
+	uint32_t maxcmdsn = ntohl ( response->maxcmdsn );
+
+	/* Update cmdsn and maxcmdsn.  During login, we adopt the
+	 * target's idea of the next command sequence number.  In the
+	 * full feature phase, MaxCmdSN may only ever increase, and
+	 * is ignored if it is not at least ( ExpCmdSN - 1 ).
+	 */
+	if ( opcode == ISCSI_OPCODE_LOGIN_RESPONSE ) {
+		iscsi->cmdsn = expcmdsn;
+		iscsi->maxcmdsn = maxcmdsn;
+	} else if ( ( ( int32_t ) ( maxcmdsn - expcmdsn + 1 ) >= 0 ) &&
+		    ( ( int32_t ) ( maxcmdsn - iscsi->maxcmdsn ) > 0 ) ) {
+		iscsi->maxcmdsn = maxcmdsn;
+		iscsi_tx_next ( iscsi );
+	}
 
-	/* Update cmdsn and statsn */
-	iscsi->cmdsn = ntohl ( response->expcmdsn );
-	iscsi->statsn = ntohl ( response->statsn );
+	/* Update statsn from PDUs carrying status */
+	if ( ( opcode == ISCSI_OPCODE_LOGIN_RESPONSE ) ||
+	     ( opcode == ISCSI_OPCODE_SCSI_RESPONSE ) ||
+	     ( ( opcode == ISCSI_OPCODE_DATA_IN ) &&
+	       ( response->flags & ISCSI_DATA_FLAG_STATUS ) ) ) {
+		iscsi->statsn = ntohl ( response->statsn );
+	}
 
-	switch ( response->opcode & ISCSI_OPCODE_MASK ) {
+	switch ( opcode ) {
 	case ISCSI_OPCODE_LOGIN_RESPONSE:
 		return iscsi_rx_login_response ( iscsi, data, len, remaining );
 	case ISCSI_OPCODE_SCSI_RESPONSE:
@@ -1611,6 +2199,91 @@ static int iscsi_rx_data ( struct iscsi_session *iscsi, const void *data,
 	}
 }
 
+/**
+ * Check whether or not current RX PDU has a data digest
+ *
+ * @v iscsi		iSCSI session
+ * @ret has_digest	PDU has a data digest
+ */
+static int iscsi_rx_has_data_digest ( struct iscsi_session *iscsi ) {
+	struct iscsi_bhs_common *common = &iscsi->rx_bhs.common;
+
+	return ( ( iscsi->rx_digests & ISCSI_DATA_DIGEST ) &&
+		 ISCSI_DATA_LEN ( common->lengths ) );
+}
+
+/**
+ * Receive and verify digest of an iSCSI PDU
+ *
+ * @v iscsi		iSCSI session
+ * @v data		Received data
+ * @v len		Length of received data
+ * @v remaining		Data remaining after this data
+ * @ret rc		Return status code
+ */
+static int iscsi_rx_digest ( struct iscsi_session *iscsi, const void *data,
+			     size_t len, size_t remaining ) {
+	uint32_t expected;
+	uint32_t actual;
+
+	/* Accumulate digest */
+	memcpy ( &iscsi->rx_digest[iscsi->rx_offset], data, len );
+	if ( remaining )
+		return 0;
+
+	/* Verify digest */
+	expected = ~iscsi->rx_crc;
+	actual = ( ( iscsi->rx_digest[0] << 0 ) |
+		   ( iscsi->rx_digest[1] << 8 ) |
+		   ( iscsi->rx_digest[2] << 16 ) |
+		   ( iscsi->rx_digest[3] << 24 ) );
+	iscsi->rx_crc = 0xffffffffUL;
+	if ( actual != expected ) {
+		DBGC ( iscsi, "iSCSI %p %s digest mismatch (expected %08x, "
+		       "got %08x)\n", iscsi,
+		       ( ( iscsi->rx_state == ISCSI_RX_HEADER_DIGEST ) ?
+			 "header" : "data" ), expected, actual );
+		return -EIO_DIGEST;
+	}
+
+	return 0;
+}
+
+/**
+ * Receive and verify data digest of an iSCSI PDU
+ *
+ * @v iscsi		iSCSI session
+ * @v data		Received data
+ * @v len		Length of received data
+ * @v remaining		Data remaining after this data
+ * @ret rc		Return status code
+ *
+ * The data segment handler is not told that the data segment is
+ * complete until the data digest has been verified.
+ */
+static int iscsi_rx_data_digest ( struct iscsi_session *iscsi,
+				  const void *data, size_t len,
+				  size_t remaining ) {
+	struct iscsi_bhs_common *common = &iscsi->rx_bhs.common;
+	size_t offset = iscsi->rx_offset;
+	size_t digest_len = iscsi->rx_len;
+	int rc;
+
+	/* Receive and verify digest */
+	if ( ( rc = iscsi_rx_digest ( iscsi, data, len, remaining ) ) != 0 )
+		return rc;
+	if ( remaining )
+		return 0;
+
+	/* Complete data segment */
+	iscsi->rx_offset = iscsi->rx_len = ISCSI_DATA_LEN ( common->lengths );
+	rc = iscsi_rx_data ( iscsi, NULL, 0, 0 );
+	iscsi->rx_offset = offset;
+	iscsi->rx_len = digest_len;
+
+	return rc;
+}
+
 /**
  * Receive new data
  *
@@ -1633,30 +2306,60 @@ static int iscsi_socket_deliver ( struct iscsi_session *iscsi,
 	int ( * rx ) ( struct iscsi_session *iscsi, const void *data,
 		       size_t len, size_t remaining );
 	enum iscsi_rx_state next_state;
+	unsigned int digest;
 	size_t frag_len;
 	size_t remaining;
 	int rc;
 
 	while ( 1 ) {
+		digest = 0;
 		switch ( iscsi->rx_state ) {
 		case ISCSI_RX_BHS:
+			if ( ! iscsi->rx_offset ) {
+				iscsi->rx_digests = iscsi_digests ( iscsi );
+				iscsi->rx_crc = 0xffffffffUL;
+			}
 			rx = iscsi_rx_bhs;
 			iscsi->rx_len = sizeof ( iscsi->rx_bhs );
-			next_state = ISCSI_RX_AHS;			
+			digest = ISCSI_HEADER_DIGEST;
+			next_state = ISCSI_RX_AHS;
 			break;
 		case ISCSI_RX_AHS:
 			rx = iscsi_rx_discard;
 			iscsi->rx_len = 4 * ISCSI_AHS_LEN ( common->lengths );
+			digest = ISCSI_HEADER_DIGEST;
+			next_state = ISCSI_RX_HEADER_DIGEST;
+			break;
+		case ISCSI_RX_HEADER_DIGEST:
+			if ( iscsi->rx_digests & ISCSI_HEADER_DIGEST ) {
+				rx = iscsi_rx_digest;
+				iscsi->rx_len = sizeof ( iscsi->rx_digest );
+			} else {
+				rx = iscsi_rx_discard;
+				iscsi->rx_len = 0;
+			}
 			next_state = ISCSI_RX_DATA;
 			break;
 		case ISCSI_RX_DATA:
 			rx = iscsi_rx_data;
 			iscsi->rx_len = ISCSI_DATA_LEN ( common->lengths );
+			digest = ISCSI_DATA_DIGEST;
 			next_state = ISCSI_RX_DATA_PADDING;
 			break;
 		case ISCSI_RX_DATA_PADDING:
 			rx = iscsi_rx_discard;
 			iscsi->rx_len = ISCSI_DATA_PAD_LEN ( common->lengths );
+			digest = ISCSI_DATA_DIGEST;
+			next_state = ISCSI_RX_DATA_DIGEST;
+			break;
+		case ISCSI_RX_DATA_DIGEST:
+			if ( iscsi_rx_has_data_digest ( iscsi ) ) {
+				rx = iscsi_rx_data_digest;
+				iscsi->rx_len = sizeof ( iscsi->rx_digest );
+			} else {
+				rx = iscsi_rx_discard;
+				iscsi->rx_len = 0;
+			}
 			next_state = ISCSI_RX_BHS;
 			break;
 		default:
@@ -1669,6 +2372,14 @@ static int iscsi_socket_deliver ( struct iscsi_session *iscsi,
 		if ( frag_len > iob_len ( iobuf ) )
 			frag_len = iob_len ( iobuf );
 		remaining = iscsi->rx_len - iscsi->rx_offset - frag_len;
+
+		/* Defer completion of a data segment with a data
+		 * digest until the digest has been verified.
+		 */
+		if ( ( iscsi->rx_state == ISCSI_RX_DATA ) &&
+		     iscsi_rx_has_data_digest ( iscsi ) )
+			remaining++;
+
 		if ( ( rc = rx ( iscsi, iobuf->data, frag_len,
 				 remaining ) ) != 0 ) {
 			DBGC ( iscsi, "iSCSI %p could not process received "
@@ -1676,6 +2387,12 @@ static int iscsi_socket_deliver ( struct iscsi_session *iscsi,
 			goto done;
 		}
 
+		/* Update running digest, if applicable */
+		if ( iscsi->rx_digests & digest ) {
+			iscsi->rx_crc = crc32c_le ( iscsi->rx_crc, iobuf->data,
+						    frag_len );
+		}
+
 		iscsi->rx_offset += frag_len;
 		iob_pull ( iobuf, frag_len );
 
@@ -1768,14 +2485,98 @@ static struct interface_descriptor iscsi_socket_desc =
  */
 static size_t iscsi_scsi_window ( struct iscsi_session *iscsi ) {
 
-	if ( ( ( iscsi->status & ISCSI_STATUS_PHASE_MASK ) ==
-	       ISCSI_STATUS_FULL_FEATURE_PHASE ) &&
-	     ( iscsi->command == NULL ) ) {
-		/* We cannot handle concurrent commands */
-		return 1;
-	} else {
+	/* Refuse commands until login is complete */
+	if ( ( iscsi->status & ISCSI_STATUS_PHASE_MASK ) !=
+	     ISCSI_STATUS_FULL_FEATURE_PHASE )
 		return 0;
+
+	return iscsi_free_tasks ( iscsi );
+}
+
+/**
+ * Calculate number of iSCSI tasks to use for a SCSI command
+ *
+ * @v iscsi		iSCSI session
+ * @v command		SCSI command
+ * @ret parts		Number of tasks
+ *
+ * Large READ and WRITE commands are split into several tasks, so
+ * that the target may work on several parts of the transfer
+ * concurrently.
+ */
+static unsigned int iscsi_split ( struct iscsi_session *iscsi,
+				  struct scsi_cmd *command ) {
+	union scsi_cdb cdb;
+	unsigned int parts;
+	unsigned int count;
+	unsigned int per_part;
+	uint64_t lba;
+	size_t len;
+
+	/* Identify block range, if applicable */
+	memcpy ( &cdb, &command->cdb, sizeof ( cdb ) );
+	if ( scsi_cdb_range ( &cdb, &lba, &count ) != 0 )
+		return 1;
+	len = ( command->data_in_len | command->data_out_len );
+	if ( ( count == 0 ) || ( len % count ) )
+		return 1;
+
+	/* Use as many tasks as are available, subject to the minimum
+	 * length for each part.
+	 */
+	parts = iscsi_free_tasks ( iscsi );
+	if ( parts > ( len / ISCSI_MIN_SPLIT_LEN ) )
+		parts = ( len / ISCSI_MIN_SPLIT_LEN );
+	if ( parts > count )
+		parts = count;
+	if ( parts <= 1 )
+		return 1;
+
+	/* Recalculate number of parts to use equal-sized parts */
+	per_part = ( ( count + parts - 1 ) / parts );
+	return ( ( count + per_part - 1 ) / per_part );
+}
+
+/**
+ * Prepare iSCSI task for transmission
+ *
+ * @v iscsi		iSCSI session
+ * @v task		iSCSI task
+ * @v lead		Lead task
+ */
+static void iscsi_task_init ( struct iscsi_session *iscsi,
+			      struct iscsi_task *task,
+			      struct iscsi_task *lead ) {
+	size_t len = task->command.data_out_len;
+	size_t unsolicited = 0;
+
+	/* Assign tag and command sequence number */
+	task->iscsi = iscsi;
+	task->lead = lead;
+	task->itt = iscsi_new_itt();
+	task->cmdsn = iscsi->cmdsn++;
+	task->flags = ( ISCSI_TASK_TX_COMMAND | ISCSI_TASK_ACTIVE );
+
+	/* Determine amount of unsolicited data, if any */
+	if ( ( ! iscsi->initial_r2t ) || iscsi->immediate_data ) {
+		unsolicited = len;
+		if ( unsolicited > iscsi->first_burst_len )
+			unsolicited = iscsi->first_burst_len;
+	}
+	task->immediate_len = 0;
+	if ( iscsi->immediate_data ) {
+		task->immediate_len = unsolicited;
+		if ( task->immediate_len > iscsi->max_send_len )
+			task->immediate_len = iscsi->max_send_len;
 	}
+	if ( iscsi->initial_r2t )
+		unsolicited = task->immediate_len;
+
+	/* Record any unsolicited data-out sequence */
+	task->ttt = ISCSI_TAG_RESERVED;
+	task->datasn = 0;
+	task->offset = task->immediate_len;
+	task->end = unsolicited;
 }
 
 /**
@@ -1789,31 +2590,80 @@ static size_t iscsi_scsi_window ( struct iscsi_session *iscsi ) {
 static int iscsi_scsi_command ( struct iscsi_session *iscsi,
 				struct interface *parent,
 				struct scsi_cmd *command ) {
+	struct iscsi_task *lead;
+	struct iscsi_task *task;
+	unsigned int parts;
+	unsigned int count;
+	unsigned int per_part;
+	unsigned int i;
+	uint64_t lba;
+	size_t blksize;
+	size_t offset;
+	size_t len;
 
-	/* This iSCSI implementation cannot handle multiple concurrent
-	 * commands or commands arriving before login is complete.
+	/* This iSCSI implementation cannot handle commands arriving
+	 * before login is complete, or more concurrent commands than
+	 * it has tasks.
 	 */
 	if ( iscsi_scsi_window ( iscsi ) == 0 ) {
-		DBGC ( iscsi, "iSCSI %p cannot handle concurrent commands\n",
-		       iscsi );
+		DBGC ( iscsi, "iSCSI %p cannot handle more concurrent "
+		       "commands\n", iscsi );
 		return -EOPNOTSUPP;
 	}
 
-	/* Store command */
-	iscsi->command = malloc ( sizeof ( *command ) );
-	if ( ! iscsi->command )
-		return -ENOMEM;
-	memcpy ( iscsi->command, command, sizeof ( *command ) );
-
-	/* Assign new ITT */
-	iscsi_new_itt ( iscsi );
+	/* Allocate lead task */
+	lead = iscsi_free_task ( iscsi );
+	assert ( lead != NULL );
+	memcpy ( &lead->command, command, sizeof ( lead->command ) );
+	lead->have_rsp = 0;
+
+	/* Split command across tasks, if applicable */
+	parts = iscsi_split ( iscsi, command );
+	lead->pending = parts;
+	if ( parts > 1 ) {
+		scsi_cdb_range ( &lead->command.cdb, &lba, &count );
+		blksize = ( ( command->data_in_len | command->data_out_len ) /
+			    count );
+		per_part = ( ( count + parts - 1 ) / parts );
+		DBGC2 ( iscsi, "iSCSI %p splitting %d blocks into %d tasks\n",
+			iscsi, count, parts );
+		for ( offset = 0, i = 0 ; i < parts ; i++ ) {
+			task = ( i ? iscsi_free_task ( iscsi ) : lead );
+			assert ( task != NULL );
+			if ( per_part > count )
+				per_part = count;
+			len = ( per_part * blksize );
+			memcpy ( &task->command, command,
+				 sizeof ( task->command ) );
+			scsi_cdb_set_range ( &task->command.cdb, lba,
+					      per_part );
+			if ( command->data_in ) {
+				task->command.data_in =
+					userptr_add ( command->data_in,
+						      offset );
+				task->command.data_in_len = len;
+			}
+			if ( command->data_out ) {
+				task->command.data_out =
+					userptr_add ( command->data_out,
+						      offset );
+				task->command.data_out_len = len;
+			}
+			iscsi_task_init ( iscsi, task, lead );
+			lba += per_part;
+			count -= per_part;
+			offset += len;
+		}
+	} else {
+		iscsi_task_init ( iscsi, lead, lead );
+	}
 
-	/* Start sending command */
-	iscsi_start_command ( iscsi );
+	/* Start sending command, if possible */
+	iscsi_tx_next ( iscsi );
 
 	/* Attach to parent interface and return */
-	intf_plug_plug ( &iscsi->data, parent );
-	return iscsi->itt;
+	intf_plug_plug ( &lead->data, parent );
+	return lead->itt;
 }
 
 /**
@@ -1842,29 +2692,29 @@ static struct interface_descriptor iscsi_control_desc =
 /**
  * Close iSCSI command
  *
- * @v iscsi		iSCSI session
+ * @v task		iSCSI lead task
  * @v rc		Reason for close
  */
-static void iscsi_command_close ( struct iscsi_session *iscsi, int rc ) {
+static void iscsi_command_close ( struct iscsi_task *task, int rc ) {
 
 	/* Restart interface */
-	intf_restart ( &iscsi->data, rc );
+	intf_restart ( &task->data, rc );
 
 	/* Treat unsolicited command closures mid-command as fatal,
 	 * because we have no code to handle partially-completed PDUs.
 	 */
-	if ( iscsi->command != NULL )
-		iscsi_close ( iscsi, ( ( rc == 0 ) ? -ECANCELED : rc ) );
+	if ( task->lead != NULL )
+		iscsi_close ( task->iscsi, ( ( rc == 0 ) ? -ECANCELED : rc ) );
 }
 
 /** iSCSI SCSI command interface operations */
 static struct interface_operation iscsi_data_op[] = {
-	INTF_OP ( intf_close, struct iscsi_session *, iscsi_command_close ),
+	INTF_OP ( intf_close, struct iscsi_task *, iscsi_command_close ),
 };
 
 /** iSCSI SCSI command interface descriptor */
 static struct interface_descriptor iscsi_data_desc =
-	INTF_DESC ( struct iscsi_session, data, iscsi_data_op );
+	INTF_DESC ( struct iscsi_task, data, iscsi_data_op );
 
 /****************************************************************************
  *
@@ -1891,6 +2741,14 @@ const struct setting initiator_iqn_setting __setting ( SETTING_SANBOOT_EXTRA,
 	.type = &setting_type_string,
 };
 
+/** iSCSI digest setting */
+const struct setting iscsi_digest_setting __setting ( SETTING_SANBOOT_EXTRA,
+						      iscsi-digest ) = {
+	.name = "iscsi-digest",
+	.description = "iSCSI CRC32C digests",
+	.type = &setting_type_uint8,
+};
+
 /** iSCSI reverse username setting */
 const struct setting reverse_username_setting __setting ( SETTING_AUTH_EXTRA,
 							  reverse-username ) = {
@@ -1986,6 +2844,8 @@ static int iscsi_fetch_settings ( struct iscsi_session *iscsi ) {
 				    &iscsi->target_username );
 	fetch_string_setting_copy ( NULL, &reverse_password_setting,
 				    &iscsi->target_password );
+	iscsi->digest_preferred = fetch_intz_setting ( NULL,
+						       &iscsi_digest_setting );
 
 	/* Use explicit initiator IQN if provided */
 	fetch_string_setting_copy ( NULL, &initiator_iqn_setting,
@@ -2066,6 +2926,7 @@ static int iscsi_check_auth ( struct iscsi_session *iscsi ) {
  */
 static int iscsi_open ( struct interface *parent, struct uri *uri ) {
 	struct iscsi_session *iscsi;
+	unsigned int i;
 	int rc;
 
 	/* Sanity check */
@@ -2082,7 +2943,11 @@ static int iscsi_open ( struct interface *parent, struct uri *uri ) {
 	}
 	ref_init ( &iscsi->refcnt, iscsi_free );
 	intf_init ( &iscsi->control, &iscsi_control_desc, &iscsi->refcnt );
-	intf_init ( &iscsi->data, &iscsi_data_desc, &iscsi->refcnt );
+	for ( i = 0 ; i < ISCSI_MAX_TASKS ; i++ ) {
+		iscsi->tasks[i].iscsi = iscsi;
+		intf_init ( &iscsi->tasks[i].data, &iscsi_data_desc,
+			    &iscsi->refcnt );
+	}
 	intf_init ( &iscsi->socket, &iscsi_socket_desc, &iscsi->refcnt );
 	process_init_stopped ( &iscsi->process, &iscsi_process_desc,
 			       &iscsi->refcnt );
@@ -34,6 +34,8 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <byteswap.h>
 #include <ipxe/xfer.h>
 #include <ipxe/open.h>
+#include <ipxe/process.h>
+#include <ipxe/init.h>
 #include <ipxe/tcpip.h>
 #include <ipxe/dhcp.h>
 #include <ipxe/settings.h>
@@ -110,6 +112,17 @@ static struct interface syslogs = INTF_INIT ( syslogs_desc );
 /** Encrypted syslog line buffer */
 static char syslogs_buffer[SYSLOG_BUFSIZE];
 
+/** Encrypted syslog message queue buffer */
+static char syslogs_queue_buffer[SYSLOG_QUEUE_SIZE];
+
+/** Encrypted syslog message queue */
+static struct syslog_queue syslogs_messages = {
+	.xfer = &syslogs,
+	.buffer = syslogs_queue_buffer,
+	.size = sizeof ( syslogs_queue_buffer ),
+	.stream = 1,
+};
+
 /** Encrypted syslog severity */
 static unsigned int syslogs_severity = SYSLOG_DEFAULT_SEVERITY;
 
@@ -167,10 +180,10 @@ static void syslogs_putchar ( int character ) {
 	/* Guard against re-entry */
 	syslogs_entered = 1;
 
-	/* Send log message */
-	if ( ( rc = syslog_send ( &syslogs, syslogs_severity,
-				  syslogs_buffer, "\n" ) ) != 0 ) {
-		DBG ( "SYSLOGS could not send log message: %s\n",
+	/* Queue log message */
+	if ( ( rc = syslog_queue ( &syslogs_messages, syslogs_severity,
+				   syslogs_buffer ) ) != 0 ) {
+		DBG ( "SYSLOGS could not queue log message: %s\n",
 		      strerror ( rc ) );
 	}
 
@@ -178,6 +191,46 @@ static void syslogs_putchar ( int character ) {
 	syslogs_entered = 0;
 }
 
+/**
+ * Transmit queued encrypted syslog messages
+ *
+ * @v process		Process
+ */
+static void syslogs_step ( struct process *process __unused ) {
+
+	/* Do nothing if we are mid-logging or have nothing to send */
+	if ( syslogs_entered ||
+	     ! ( syslogs_messages.len || syslogs_messages.dropped ) )
+		return;
+
+	/* Guard against re-entry */
+	syslogs_entered = 1;
+
+	/* Transmit as many queued messages as the window permits */
+	syslog_flush ( &syslogs_messages );
+
+	/* Clear re-entry flag */
+	syslogs_entered = 0;
+}
+
+/** Encrypted syslog transmission process */
+PERMANENT_PROCESS ( syslogs_process, syslogs_step );
+
+/**
+ * Flush queued encrypted syslog messages on shutdown
+ *
+ * @v booting		System is shutting down for OS boot
+ */
+static void syslogs_shutdown ( int booting __unused ) {
+
+	syslogs_step ( &syslogs_process );
+}
+
+/** Encrypted syslog shutdown function */
+struct startup_fn syslogs_startup_fn __startup_fn ( STARTUP_FINAL ) = {
+	.shutdown = syslogs_shutdown,
+};
+
 /** Encrypted syslog console driver */
 struct console_driver syslogs_console __console_driver = {
 	.putchar = syslogs_putchar,
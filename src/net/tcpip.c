@@ -8,6 +8,7 @@
 #include <ipxe/ipstat.h>
 #include <ipxe/netdevice.h>
 #include <ipxe/tcpip.h>
+#include <ipxe/pmtu.h>
 
 /** @file
  *
@@ -143,12 +144,56 @@ size_t tcpip_mtu ( struct sockaddr_tcpip *st_dest ) {
 	if ( ! netdev )
 		return 0;
 
-	/* Calculate MTU */
-	mtu = ( netdev->mtu - tcpip_net->header_len );
+	/* Calculate MTU, allowing for any known path MTU */
+	mtu = pmtu_limit ( tcpip_net, st_dest, netdev->mtu );
+	mtu -= tcpip_net->header_len;
 
 	return mtu;
 }
 
+/**
+ * Prepare transport-layer checksum for transmit offload
+ *
+ * @v iobuf		I/O buffer
+ * @v netdev		Transmitting network device
+ * @v tso		Required segmentation offload capability
+ * @v trans_csum	Transport-layer checksum over pseudo-header only
+ * @ret rc		Return status code
+ *
+ * The transport layer has left the checksum of the segment itself to
+ * be completed by the network device.  Record the pseudo-header
+ * checksum in the form expected by hardware, or complete the checksum
+ * in software if the transmitting network device is not capable of
+ * doing so.
+ */
+int tcpip_tx_offload ( struct io_buffer *iobuf, struct net_device *netdev,
+		       unsigned int tso, uint16_t *trans_csum ) {
+
+	/* Record partial checksum */
+	*trans_csum = ~*trans_csum;
+
+	/* Leave checksum (and segmentation) to hardware, if possible */
+	if ( ( netdev->offload & NETDEV_TX_CSUM ) &&
+	     ( ( netdev->offload & tso ) ||
+	       ! ( iobuf->flags & IOB_TX_TSO ) ) ) {
+		return 0;
+	}
+
+	/* Segmentation cannot be performed in software */
+	if ( iobuf->flags & IOB_TX_TSO ) {
+		DBGC ( netdev, "TCP/IP %s cannot segment %zd-byte packet\n",
+		       netdev->name, iob_len ( iobuf ) );
+		return -ENOTSUP;
+	}
+
+	/* Complete checksum in software */
+	*trans_csum = tcpip_chksum ( iobuf->trans,
+				     ( iobuf->tail - iobuf->trans ) );
+	iobuf->flags &= ~IOB_TX_CSUM;
+
+	return 0;
+}
+
 /**
  * Calculate continued TCP/IP checkum
  *
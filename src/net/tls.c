@@ -33,10 +33,12 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <errno.h>
 #include <byteswap.h>
 #include <ipxe/pending.h>
+#include <ipxe/malloc.h>
 #include <ipxe/hmac.h>
 #include <ipxe/md5.h>
 #include <ipxe/sha1.h>
 #include <ipxe/sha256.h>
+#include <ipxe/sha512.h>
 #include <ipxe/aes.h>
 #include <ipxe/rsa.h>
 #include <ipxe/iobuf.h>
@@ -47,7 +49,9 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/certstore.h>
 #include <ipxe/rbg.h>
 #include <ipxe/validator.h>
+#include <ipxe/ocsp.h>
 #include <ipxe/tls.h>
+#include <ipxe/trace.h>
 
 /* Disambiguate the various error causes */
 #define EINVAL_CHANGE_CIPHER __einfo_error ( EINFO_EINVAL_CHANGE_CIPHER )
@@ -102,6 +106,31 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define EINFO_EINVAL_MAC						\
 	__einfo_uniqify ( EINFO_EINVAL, 0x0d,				\
 			  "Invalid MAC" )
+#define EINVAL_AUTH __einfo_error ( EINFO_EINVAL_AUTH )
+#define EINFO_EINVAL_AUTH						\
+	__einfo_uniqify ( EINFO_EINVAL, 0x0e,				\
+			  "Invalid authenticated record" )
+#define EINVAL_KEY_EXCHANGE __einfo_error ( EINFO_EINVAL_KEY_EXCHANGE )
+#define EINFO_EINVAL_KEY_EXCHANGE					\
+	__einfo_uniqify ( EINFO_EINVAL, 0x0f,				\
+			  "Invalid Server Key Exchange record" )
+#define EINVAL_TICKET __einfo_error ( EINFO_EINVAL_TICKET )
+#define EINFO_EINVAL_TICKET						\
+	__einfo_uniqify ( EINFO_EINVAL, 0x10,				\
+			  "Invalid New Session Ticket record" )
+#define EINVAL_CERTIFICATE_STATUS \
+	__einfo_error ( EINFO_EINVAL_CERTIFICATE_STATUS )
+#define EINFO_EINVAL_CERTIFICATE_STATUS					\
+	__einfo_uniqify ( EINFO_EINVAL, 0x11,				\
+			  "Invalid Certificate Status record" )
+#define EINVAL_ALPN __einfo_error ( EINFO_EINVAL_ALPN )
+#define EINFO_EINVAL_ALPN						\
+	__einfo_uniqify ( EINFO_EINVAL, 0x12,				\
+			  "Invalid application-layer protocol" )
+#define EINVAL_RECORD_SIZE __einfo_error ( EINFO_EINVAL_RECORD_SIZE )
+#define EINFO_EINVAL_RECORD_SIZE					\
+	__einfo_uniqify ( EINFO_EINVAL, 0x13,				\
+			  "Invalid record size limit" )
 #define EIO_ALERT __einfo_error ( EINFO_EIO_ALERT )
 #define EINFO_EIO_ALERT							\
 	__einfo_uniqify ( EINFO_EINVAL, 0x01,				\
@@ -134,6 +163,14 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define EINFO_ENOMEM_RX_CONCAT						\
 	__einfo_uniqify ( EINFO_ENOMEM, 0x08,				\
 			  "Not enough space to concatenate received data" )
+#define ENOMEM_KEY_EXCHANGE __einfo_error ( EINFO_ENOMEM_KEY_EXCHANGE )
+#define EINFO_ENOMEM_KEY_EXCHANGE					\
+	__einfo_uniqify ( EINFO_ENOMEM, 0x09,				\
+			  "Not enough space for Server Key Exchange record" )
+#define ENOMEM_TICKET __einfo_error ( EINFO_ENOMEM_TICKET )
+#define EINFO_ENOMEM_TICKET						\
+	__einfo_uniqify ( EINFO_ENOMEM, 0x0a,				\
+			  "Not enough space for session ticket" )
 #define ENOTSUP_CIPHER __einfo_error ( EINFO_ENOTSUP_CIPHER )
 #define EINFO_ENOTSUP_CIPHER						\
 	__einfo_uniqify ( EINFO_ENOTSUP, 0x01,				\
@@ -150,6 +187,10 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define EINFO_ENOTSUP_VERSION						\
 	__einfo_uniqify ( EINFO_ENOTSUP, 0x04,				\
 			  "Unsupported protocol version" )
+#define ENOTSUP_CURVE __einfo_error ( EINFO_ENOTSUP_CURVE )
+#define EINFO_ENOTSUP_CURVE						\
+	__einfo_uniqify ( EINFO_ENOTSUP, 0x05,				\
+			  "Unsupported elliptic curve" )
 #define EPERM_ALERT __einfo_error ( EINFO_EPERM_ALERT )
 #define EINFO_EPERM_ALERT						\
 	__einfo_uniqify ( EINFO_EPERM, 0x01,				\
@@ -170,6 +211,14 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define EINFO_EPERM_RENEG_VERIFY					\
 	__einfo_uniqify ( EINFO_EPERM, 0x05,				\
 			  "Secure renegotiation verification failed" )
+#define EPERM_KEY_EXCHANGE __einfo_error ( EINFO_EPERM_KEY_EXCHANGE )
+#define EINFO_EPERM_KEY_EXCHANGE					\
+	__einfo_uniqify ( EINFO_EPERM, 0x06,				\
+			  "Server Key Exchange verification failed" )
+#define EPERM_ALPN __einfo_error ( EINFO_EPERM_ALPN )
+#define EINFO_EPERM_ALPN						\
+	__einfo_uniqify ( EINFO_EPERM, 0x07,				\
+			  "Application-layer protocol not offered" )
 #define EPROTO_VERSION __einfo_error ( EINFO_EPROTO_VERSION )
 #define EINFO_EPROTO_VERSION						\
 	__einfo_uniqify ( EINFO_EPROTO, 0x01,				\
@@ -177,6 +226,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 static int tls_send_plaintext ( struct tls_connection *tls, unsigned int type,
 				const void *data, size_t len );
+static int tls_tx_flush ( struct tls_connection *tls );
 static void tls_clear_cipher ( struct tls_connection *tls,
 			       struct tls_cipherspec *cipherspec );
 
@@ -327,8 +377,14 @@ static void free_tls ( struct refcnt *refcnt ) {
 		list_del ( &iobuf->list );
 		free_iob ( iobuf );
 	}
+	free_iob ( tls->tx_data );
 	x509_put ( tls->cert );
 	x509_chain_put ( tls->chain );
+	free ( tls->server_key );
+	free ( tls->session_ticket );
+	free ( tls->alpn );
+	free ( tls->protocol );
+	ref_put ( &tls->session->refcnt );
 
 	/* Free TLS structure itself */
 	free ( tls );	
@@ -342,10 +398,18 @@ static void free_tls ( struct refcnt *refcnt ) {
  */
 static void tls_close ( struct tls_connection *tls, int rc ) {
 
+	/* Record end of incomplete handshake, if applicable */
+	if ( ! tls_ready ( tls ) )
+		trace_stop ( tls->trace, rc );
+
 	/* Remove pending operations, if applicable */
 	pending_put ( &tls->client_negotiation );
 	pending_put ( &tls->server_negotiation );
 
+	/* Send any pending application data, if closing gracefully */
+	if ( rc == 0 )
+		tls_tx_flush ( tls );
+
 	/* Remove process */
 	process_del ( &tls->process );
 
@@ -496,8 +560,10 @@ static void tls_prf ( struct tls_connection *tls, void *secret,
 	va_start ( seeds, out_len );
 
 	if ( tls->version >= TLS_VERSION_TLS_1_2 ) {
-		/* Use P_SHA256 for TLSv1.2 and later */
-		tls_p_hash_va ( tls, &sha256_algorithm, secret, secret_len,
+		/* Use P_hash with the handshake digest algorithm
+		 * (usually SHA-256) for TLSv1.2 and later
+		 */
+		tls_p_hash_va ( tls, tls->handshake_digest, secret, secret_len,
 				out, out_len, seeds );
 	} else {
 		/* Use combination of P_MD5 and P_SHA-1 for TLSv1.1
@@ -554,21 +620,22 @@ static void tls_prf ( struct tls_connection *tls, void *secret,
  * Generate master secret
  *
  * @v tls		TLS connection
+ * @v pre_master_secret	Pre-master secret
+ * @v pre_master_secret_len Length of pre-master secret
  *
- * The pre-master secret and the client and server random values must
- * already be known.
+ * The client and server random values must already be known.
  */
-static void tls_generate_master_secret ( struct tls_connection *tls ) {
+static void tls_generate_master_secret ( struct tls_connection *tls,
+					 void *pre_master_secret,
+					 size_t pre_master_secret_len ) {
 	DBGC ( tls, "TLS %p pre-master-secret:\n", tls );
-	DBGC_HD ( tls, &tls->pre_master_secret,
-		  sizeof ( tls->pre_master_secret ) );
+	DBGC_HD ( tls, pre_master_secret, pre_master_secret_len );
 	DBGC ( tls, "TLS %p client random bytes:\n", tls );
 	DBGC_HD ( tls, &tls->client_random, sizeof ( tls->client_random ) );
 	DBGC ( tls, "TLS %p server random bytes:\n", tls );
 	DBGC_HD ( tls, &tls->server_random, sizeof ( tls->server_random ) );
 
-	tls_prf_label ( tls, &tls->pre_master_secret,
-			sizeof ( tls->pre_master_secret ),
+	tls_prf_label ( tls, pre_master_secret, pre_master_secret_len,
 			&tls->master_secret, sizeof ( tls->master_secret ),
 			"master secret",
 			&tls->client_random, sizeof ( tls->client_random ),
@@ -588,9 +655,9 @@ static void tls_generate_master_secret ( struct tls_connection *tls ) {
 static int tls_generate_keys ( struct tls_connection *tls ) {
 	struct tls_cipherspec *tx_cipherspec = &tls->tx_cipherspec_pending;
 	struct tls_cipherspec *rx_cipherspec = &tls->rx_cipherspec_pending;
-	size_t hash_size = tx_cipherspec->suite->digest->digestsize;
+	size_t hash_size = tx_cipherspec->suite->mac_len;
 	size_t key_size = tx_cipherspec->suite->key_len;
-	size_t iv_size = tx_cipherspec->suite->cipher->blocksize;
+	size_t iv_size = tx_cipherspec->suite->fixed_iv_len;
 	size_t total = ( 2 * ( hash_size + key_size + iv_size ) );
 	uint8_t key_block[total];
 	uint8_t *key;
@@ -641,16 +708,24 @@ static int tls_generate_keys ( struct tls_connection *tls ) {
 	DBGC_HD ( tls, key, key_size );
 	key += key_size;
 
-	/* TX initialisation vector */
-	cipher_setiv ( tx_cipherspec->suite->cipher,
-		       tx_cipherspec->cipher_ctx, key );
+	/* TX initialisation vector.  Authenticated ciphers construct
+	 * a new initialisation vector for each record.
+	 */
+	memcpy ( tx_cipherspec->fixed_iv, key, iv_size );
+	if ( ! is_auth_cipher ( tx_cipherspec->suite->cipher ) ) {
+		cipher_setiv ( tx_cipherspec->suite->cipher,
+			       tx_cipherspec->cipher_ctx, key );
+	}
 	DBGC ( tls, "TLS %p TX IV:\n", tls );
 	DBGC_HD ( tls, key, iv_size );
 	key += iv_size;
 
 	/* RX initialisation vector */
-	cipher_setiv ( rx_cipherspec->suite->cipher,
-		       rx_cipherspec->cipher_ctx, key );
+	memcpy ( rx_cipherspec->fixed_iv, key, iv_size );
+	if ( ! is_auth_cipher ( rx_cipherspec->suite->cipher ) ) {
+		cipher_setiv ( rx_cipherspec->suite->cipher,
+			       rx_cipherspec->cipher_ctx, key );
+	}
 	DBGC ( tls, "TLS %p RX IV:\n", tls );
 	DBGC_HD ( tls, key, iv_size );
 	key += iv_size;
@@ -669,6 +744,7 @@ static int tls_generate_keys ( struct tls_connection *tls ) {
 
 /** Null cipher suite */
 struct tls_cipher_suite tls_cipher_suite_null = {
+	.exchange = &tls_pubkey_exchange_algorithm,
 	.pubkey = &pubkey_null,
 	.cipher = &cipher_null,
 	.digest = &digest_null,
@@ -726,7 +802,6 @@ static int tls_set_cipher ( struct tls_connection *tls,
 			    struct tls_cipher_suite *suite ) {
 	struct pubkey_algorithm *pubkey = suite->pubkey;
 	struct cipher_algorithm *cipher = suite->cipher;
-	struct digest_algorithm *digest = suite->digest;
 	size_t total;
 	void *dynamic;
 
@@ -734,7 +809,8 @@ static int tls_set_cipher ( struct tls_connection *tls,
 	tls_clear_cipher ( tls, cipherspec );
 	
 	/* Allocate dynamic storage */
-	total = ( pubkey->ctxsize + 2 * cipher->ctxsize + digest->digestsize );
+	total = ( pubkey->ctxsize + 2 * cipher->ctxsize + suite->mac_len +
+		  suite->fixed_iv_len );
 	dynamic = zalloc ( total );
 	if ( ! dynamic ) {
 		DBGC ( tls, "TLS %p could not allocate %zd bytes for crypto "
@@ -747,7 +823,8 @@ static int tls_set_cipher ( struct tls_connection *tls,
 	cipherspec->pubkey_ctx = dynamic;	dynamic += pubkey->ctxsize;
 	cipherspec->cipher_ctx = dynamic;	dynamic += cipher->ctxsize;
 	cipherspec->cipher_next_ctx = dynamic;	dynamic += cipher->ctxsize;
-	cipherspec->mac_secret = dynamic;	dynamic += digest->digestsize;
+	cipherspec->mac_secret = dynamic;	dynamic += suite->mac_len;
+	cipherspec->fixed_iv = dynamic;		dynamic += suite->fixed_iv_len;
 	assert ( ( cipherspec->dynamic + total ) == dynamic );
 
 	/* Store parameters */
@@ -776,6 +853,28 @@ static int tls_select_cipher ( struct tls_connection *tls,
 		return -ENOTSUP_CIPHER;
 	}
 
+	/* Authenticated ciphers require TLSv1.2 or later */
+	if ( is_auth_cipher ( suite->cipher ) &&
+	     ( tls->version < TLS_VERSION_TLS_1_2 ) ) {
+		DBGC ( tls, "TLS %p cannot use cipher %04x before TLSv1.2\n",
+		       tls, ntohs ( cipher_suite ) );
+		return -ENOTSUP_CIPHER;
+	}
+
+	/* Use cipher suite's handshake digest algorithm for TLSv1.2
+	 * and later.
+	 */
+	if ( tls->version >= TLS_VERSION_TLS_1_2 ) {
+		if ( suite->handshake == &sha384_algorithm ) {
+			tls->handshake_digest = &sha384_algorithm;
+			tls->handshake_ctx = tls->handshake_sha384_ctx;
+		} else {
+			assert ( suite->handshake == &sha256_algorithm );
+			tls->handshake_digest = &sha256_algorithm;
+			tls->handshake_ctx = tls->handshake_sha256_ctx;
+		}
+	}
+
 	/* Set ciphers */
 	if ( ( rc = tls_set_cipher ( tls, &tls->tx_cipherspec_pending,
 				     suite ) ) != 0 )
@@ -784,9 +883,9 @@ static int tls_select_cipher ( struct tls_connection *tls,
 				     suite ) ) != 0 )
 		return rc;
 
-	DBGC ( tls, "TLS %p selected %s-%s-%d-%s\n", tls, suite->pubkey->name,
-	       suite->cipher->name, ( suite->key_len * 8 ),
-	       suite->digest->name );
+	DBGC ( tls, "TLS %p selected %s-%s-%s-%d-%s\n", tls,
+	       suite->exchange->name, suite->pubkey->name, suite->cipher->name,
+	       ( suite->key_len * 8 ), suite->digest->name );
 
 	return 0;
 }
@@ -848,6 +947,59 @@ tls_signature_hash_algorithm ( struct pubkey_algorithm *pubkey,
 	return NULL;
 }
 
+/**
+ * Find TLS signature algorithm digest
+ *
+ * @v pubkey		Public-key algorithm
+ * @v code		Signature and hash algorithm identifier
+ * @ret digest		Digest algorithm, or NULL
+ */
+static struct digest_algorithm *
+tls_signature_hash_digest ( struct pubkey_algorithm *pubkey,
+			    struct tls_signature_hash_id code ) {
+	struct tls_signature_hash_algorithm *sig_hash;
+
+	/* Identify signature and hash algorithm */
+	for_each_table_entry ( sig_hash, TLS_SIG_HASH_ALGORITHMS ) {
+		if ( ( sig_hash->pubkey == pubkey ) &&
+		     ( sig_hash->code.signature == code.signature ) &&
+		     ( sig_hash->code.hash == code.hash ) ) {
+			return sig_hash->digest;
+		}
+	}
+
+	return NULL;
+}
+
+/******************************************************************************
+ *
+ * Named curves
+ *
+ ******************************************************************************
+ */
+
+/** Number of supported named curves */
+#define TLS_NUM_NAMED_CURVES table_num_entries ( TLS_NAMED_CURVES )
+
+/**
+ * Identify named curve
+ *
+ * @v named_curve	Named curve specification
+ * @ret curve		Named curve, or NULL
+ */
+static struct tls_named_curve *
+tls_find_named_curve ( unsigned int named_curve ) {
+	struct tls_named_curve *curve;
+
+	/* Identify named curve */
+	for_each_table_entry ( curve, TLS_NAMED_CURVES ) {
+		if ( curve->code == named_curve )
+			return curve;
+	}
+
+	return NULL;
+}
+
 /******************************************************************************
  *
  * Handshake verification
@@ -869,6 +1021,8 @@ static void tls_add_handshake ( struct tls_connection *tls,
 			data, len );
 	digest_update ( &sha256_algorithm, tls->handshake_sha256_ctx,
 			data, len );
+	digest_update ( &sha384_algorithm, tls->handshake_sha384_ctx,
+			data, len );
 }
 
 /**
@@ -877,7 +1031,7 @@ static void tls_add_handshake ( struct tls_connection *tls,
  * @v tls		TLS connection
  * @v out		Output buffer
  *
- * Calculates the MD5+SHA1 or SHA256 digest over all handshake
+ * Calculates the MD5+SHA1, SHA256 or SHA384 digest over all handshake
  * messages seen so far.
  */
 static void tls_verify_handshake ( struct tls_connection *tls, void *out ) {
@@ -888,6 +1042,201 @@ static void tls_verify_handshake ( struct tls_connection *tls, void *out ) {
 	digest_final ( digest, ctx, out );
 }
 
+/******************************************************************************
+ *
+ * Session management
+ *
+ ******************************************************************************
+ */
+
+/** List of TLS sessions */
+static LIST_HEAD ( tls_sessions );
+
+/**
+ * Free TLS session
+ *
+ * @v refcnt		Reference counter
+ */
+static void free_tls_session ( struct refcnt *refcnt ) {
+	struct tls_session *session =
+		container_of ( refcnt, struct tls_session, refcnt );
+
+	/* Free dynamically-allocated resources */
+	free ( session->ticket );
+
+	/* Free session itself */
+	free ( session );
+}
+
+/**
+ * Remove TLS session from list of sessions
+ *
+ * @v session		TLS session
+ */
+static void tls_session_del ( struct tls_session *session ) {
+
+	DBGC ( session, "TLS session %p (%s) removed\n",
+	       session, session->name );
+	list_del ( &session->list );
+	ref_put ( &session->refcnt );
+}
+
+/**
+ * Find or create TLS session
+ *
+ * @v tls		TLS connection
+ * @v name		Server name
+ * @ret rc		Return status code
+ *
+ * Any session ID, session ticket, and master secret recorded in the
+ * session are copied into the connection, to be offered to the server
+ * for resumption in the Client Hello.
+ */
+static int tls_session ( struct tls_connection *tls, const char *name ) {
+	struct tls_session *session;
+	char *name_copy;
+	void *ticket;
+	int rc;
+
+	/* Find existing matching session, if any */
+	list_for_each_entry ( session, &tls_sessions, list ) {
+		if ( strcmp ( name, session->name ) == 0 )
+			goto found;
+	}
+
+	/* Create new session */
+	session = zalloc ( sizeof ( *session ) + strlen ( name ) +
+			   1 /* NUL */ );
+	if ( ! session ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	ref_init ( &session->refcnt, free_tls_session );
+	name_copy = ( ( ( void * ) session ) + sizeof ( *session ) );
+	strcpy ( name_copy, name );
+	session->name = name_copy;
+	list_add ( &session->list, &tls_sessions );
+	DBGC ( session, "TLS session %p (%s) created\n",
+	       session, session->name );
+
+ found:
+	/* Move to head of list of sessions (to record recent use) */
+	list_del ( &session->list );
+	list_add ( &session->list, &tls_sessions );
+
+	/* Record session */
+	ref_get ( &session->refcnt );
+	tls->session = session;
+
+	/* Do nothing more unless session may be resumed */
+	if ( ! ( session->id_len || session->ticket_len ) )
+		return 0;
+
+	/* Copy session ticket, if any */
+	if ( session->ticket_len ) {
+		ticket = malloc ( session->ticket_len );
+		if ( ! ticket ) {
+			rc = -ENOMEM;
+			goto err_ticket;
+		}
+		memcpy ( ticket, session->ticket, session->ticket_len );
+		tls->session_ticket = ticket;
+		tls->session_ticket_len = session->ticket_len;
+	}
+
+	/* Copy session ID, or generate a random session ID when
+	 * presenting a session ticket.  The server will echo back the
+	 * session ID if it accepts the ticket (RFC 5077 section 3.4).
+	 */
+	if ( session->id_len ) {
+		memcpy ( tls->session_id, session->id, session->id_len );
+		tls->session_id_len = session->id_len;
+	} else {
+		tls->session_id_len = sizeof ( tls->session_id );
+		if ( ( rc = tls_generate_random ( tls, tls->session_id,
+						  tls->session_id_len ) ) != 0 )
+			goto err_random;
+	}
+
+	/* Copy master secret */
+	memcpy ( &tls->master_secret, &session->master_secret,
+		 sizeof ( tls->master_secret ) );
+	DBGC ( tls, "TLS %p attempting to resume session %p\n",
+	       tls, session );
+
+	return 0;
+
+ err_random:
+	tls->session_id_len = 0;
+ err_ticket:
+	/* Leave session attached, for cleanup by free_tls() */
+ err_alloc:
+	return rc;
+}
+
+/**
+ * Record TLS session parameters
+ *
+ * @v tls		TLS connection
+ *
+ * Record the parameters of a successfully negotiated session, so
+ * that subsequent connections to the same server may resume it.
+ */
+static void tls_session_update ( struct tls_connection *tls ) {
+	struct tls_session *session = tls->session;
+	void *ticket = NULL;
+
+	/* Do nothing unless session is resumable */
+	if ( ! ( tls->session_id_len || tls->session_ticket_len ) )
+		return;
+
+	/* Copy session ticket, if any.  Failure to allocate the
+	 * ticket is not fatal; the session ID (if any) may still be
+	 * used for resumption.
+	 */
+	if ( tls->session_ticket_len ) {
+		ticket = malloc ( tls->session_ticket_len );
+		if ( ticket ) {
+			memcpy ( ticket, tls->session_ticket,
+				 tls->session_ticket_len );
+		}
+	}
+	free ( session->ticket );
+	session->ticket = ticket;
+	session->ticket_len = ( ticket ? tls->session_ticket_len : 0 );
+
+	/* Record session ID and master secret */
+	memcpy ( session->id, tls->session_id, tls->session_id_len );
+	session->id_len = tls->session_id_len;
+	memcpy ( &session->master_secret, &tls->master_secret,
+		 sizeof ( session->master_secret ) );
+	DBGC ( session, "TLS session %p (%s) updated by TLS %p\n",
+	       session, session->name, tls );
+}
+
+/**
+ * Discard a TLS session
+ *
+ * @ret discarded	Number of cached items discarded
+ */
+static unsigned int tls_session_discard ( void ) {
+	struct tls_session *session;
+
+	/* Discard the least recently used session */
+	list_for_each_entry_reverse ( session, &tls_sessions, list ) {
+		tls_session_del ( session );
+		return 1;
+	}
+
+	return 0;
+}
+
+/** TLS session cache discarder */
+struct cache_discarder tls_discarder __cache_discarder ( CACHE_NORMAL ) = {
+	.name = "tls",
+	.discard = tls_session_discard,
+};
+
 /******************************************************************************
  *
  * Record handling
@@ -910,6 +1259,7 @@ static void tls_restart ( struct tls_connection *tls ) {
 	/* (Re)initialise handshake context */
 	digest_init ( &md5_sha1_algorithm, tls->handshake_md5_sha1_ctx );
 	digest_init ( &sha256_algorithm, tls->handshake_sha256_ctx );
+	digest_init ( &sha384_algorithm, tls->handshake_sha384_ctx );
 	tls->handshake_digest = &sha256_algorithm;
 	tls->handshake_ctx = tls->handshake_sha256_ctx;
 
@@ -958,6 +1308,7 @@ static int tls_send_client_hello ( struct tls_connection *tls ) {
 		uint16_t version;
 		uint8_t random[32];
 		uint8_t session_id_len;
+		uint8_t session_id[tls->session_id_len];
 		uint16_t cipher_suite_len;
 		uint16_t cipher_suites[TLS_NUM_CIPHER_SUITES];
 		uint8_t compression_methods_len;
@@ -979,6 +1330,11 @@ static int tls_send_client_hello ( struct tls_connection *tls ) {
 			struct {
 				uint8_t max;
 			} __attribute__ (( packed )) max_fragment_length;
+			uint16_t record_size_limit_type;
+			uint16_t record_size_limit_len;
+			struct {
+				uint16_t max;
+			} __attribute__ (( packed )) record_size_limit;
 			uint16_t signature_algorithms_type;
 			uint16_t signature_algorithms_len;
 			struct {
@@ -993,10 +1349,54 @@ static int tls_send_client_hello ( struct tls_connection *tls ) {
 				uint8_t data[ tls->secure_renegotiation ?
 					      sizeof ( tls->verify.client ) :0];
 			} __attribute__ (( packed )) renegotiation_info;
+			uint16_t session_ticket_type;
+			uint16_t session_ticket_len;
+			struct {
+				uint8_t data[ tls->session_id_len ?
+					      tls->session_ticket_len : 0 ];
+			} __attribute__ (( packed )) session_ticket;
+			struct {
+				uint16_t type;
+				uint16_t len;
+				struct {
+					uint8_t type;
+					uint16_t responder_id_list_len;
+					uint16_t request_extensions_len;
+				} __attribute__ (( packed )) data;
+			} __attribute__ (( packed )) status_request
+				[ OCSP_ENABLED ? 1 : 0 ];
+			struct {
+				uint16_t type;
+				uint16_t len;
+				struct {
+					uint16_t len;
+					uint16_t code[TLS_NUM_NAMED_CURVES];
+				} __attribute__ (( packed )) data;
+			} __attribute__ (( packed )) named_curve
+				[ TLS_NUM_NAMED_CURVES ? 1 : 0 ];
+			struct {
+				uint16_t type;
+				uint16_t len;
+				struct {
+					uint8_t len;
+					uint8_t format[1];
+				} __attribute__ (( packed )) data;
+			} __attribute__ (( packed )) point_formats
+				[ TLS_NUM_NAMED_CURVES ? 1 : 0 ];
+			struct {
+				uint16_t type;
+				uint16_t len;
+				struct {
+					uint16_t len;
+					uint8_t list[tls->alpn_len];
+				} __attribute__ (( packed )) data;
+			} __attribute__ (( packed )) alpn
+				[ tls->alpn_len ? 1 : 0 ];
 		} __attribute__ (( packed )) extensions;
 	} __attribute__ (( packed )) hello;
 	struct tls_cipher_suite *suite;
 	struct tls_signature_hash_algorithm *sighash;
+	struct tls_named_curve *curve;
 	unsigned int i;
 
 	memset ( &hello, 0, sizeof ( hello ) );
@@ -1005,6 +1405,9 @@ static int tls_send_client_hello ( struct tls_connection *tls ) {
 				      sizeof ( hello.type_length ) ) );
 	hello.version = htons ( tls->version );
 	memcpy ( &hello.random, &tls->client_random, sizeof ( hello.random ) );
+	hello.session_id_len = sizeof ( hello.session_id );
+	memcpy ( hello.session_id, tls->session_id,
+		 sizeof ( hello.session_id ) );
 	hello.cipher_suite_len = htons ( sizeof ( hello.cipher_suites ) );
 	i = 0 ; for_each_table_entry ( suite, TLS_CIPHER_SUITES )
 		hello.cipher_suites[i++] = suite->code;
@@ -1026,6 +1429,12 @@ static int tls_send_client_hello ( struct tls_connection *tls ) {
 		= htons ( sizeof ( hello.extensions.max_fragment_length ) );
 	hello.extensions.max_fragment_length.max
 		= TLS_MAX_FRAGMENT_LENGTH_4096;
+	hello.extensions.record_size_limit_type
+		= htons ( TLS_RECORD_SIZE_LIMIT );
+	hello.extensions.record_size_limit_len
+		= htons ( sizeof ( hello.extensions.record_size_limit ) );
+	hello.extensions.record_size_limit.max
+		= htons ( TLS_MAX_RECORD_LEN );
 	hello.extensions.signature_algorithms_type
 		= htons ( TLS_SIGNATURE_ALGORITHMS );
 	hello.extensions.signature_algorithms_len
@@ -1042,6 +1451,47 @@ static int tls_send_client_hello ( struct tls_connection *tls ) {
 		= sizeof ( hello.extensions.renegotiation_info.data );
 	memcpy ( hello.extensions.renegotiation_info.data, tls->verify.client,
 		 sizeof ( hello.extensions.renegotiation_info.data ) );
+	hello.extensions.session_ticket_type = htons ( TLS_SESSION_TICKET );
+	hello.extensions.session_ticket_len
+		= htons ( sizeof ( hello.extensions.session_ticket ) );
+	memcpy ( hello.extensions.session_ticket.data, tls->session_ticket,
+		 sizeof ( hello.extensions.session_ticket.data ) );
+	if ( OCSP_ENABLED ) {
+		hello.extensions.status_request[0].type
+			= htons ( TLS_STATUS_REQUEST );
+		hello.extensions.status_request[0].len = htons (
+			sizeof ( hello.extensions.status_request[0].data ) );
+		hello.extensions.status_request[0].data.type
+			= TLS_STATUS_REQUEST_OCSP;
+	}
+	if ( TLS_NUM_NAMED_CURVES ) {
+		hello.extensions.named_curve[0].type
+			= htons ( TLS_NAMED_CURVE );
+		hello.extensions.named_curve[0].len = htons (
+			sizeof ( hello.extensions.named_curve[0].data ) );
+		hello.extensions.named_curve[0].data.len = htons (
+			sizeof ( hello.extensions.named_curve[0].data.code ) );
+		i = 0 ; for_each_table_entry ( curve, TLS_NAMED_CURVES )
+			hello.extensions.named_curve[0].data.code[i++] =
+				curve->code;
+		hello.extensions.point_formats[0].type
+			= htons ( TLS_POINT_FORMATS );
+		hello.extensions.point_formats[0].len = htons (
+			sizeof ( hello.extensions.point_formats[0].data ) );
+		hello.extensions.point_formats[0].data.len = sizeof (
+			hello.extensions.point_formats[0].data.format );
+		hello.extensions.point_formats[0].data.format[0]
+			= TLS_POINT_FORMAT_UNCOMPRESSED;
+	}
+	if ( tls->alpn_len ) {
+		hello.extensions.alpn[0].type = htons ( TLS_ALPN );
+		hello.extensions.alpn[0].len = htons (
+			sizeof ( hello.extensions.alpn[0].data ) );
+		hello.extensions.alpn[0].data.len = htons (
+			sizeof ( hello.extensions.alpn[0].data.list ) );
+		memcpy ( hello.extensions.alpn[0].data.list, tls->alpn,
+			 sizeof ( hello.extensions.alpn[0].data.list ) );
+	}
 
 	return tls_send_handshake ( tls, &hello, sizeof ( hello ) );
 }
@@ -1093,12 +1543,12 @@ static int tls_send_certificate ( struct tls_connection *tls ) {
 }
 
 /**
- * Transmit Client Key Exchange record
+ * Transmit Client Key Exchange record using public key exchange
  *
  * @v tls		TLS connection
  * @ret rc		Return status code
  */
-static int tls_send_client_key_exchange ( struct tls_connection *tls ) {
+static int tls_send_client_key_exchange_pubkey ( struct tls_connection *tls ) {
 	struct tls_cipherspec *cipherspec = &tls->tx_cipherspec_pending;
 	struct pubkey_algorithm *pubkey = cipherspec->suite->pubkey;
 	size_t max_len = pubkey_max_len ( pubkey, cipherspec->pubkey_ctx );
@@ -1111,6 +1561,14 @@ static int tls_send_client_key_exchange ( struct tls_connection *tls ) {
 	int len;
 	int rc;
 
+	/* Generate master secret */
+	tls_generate_master_secret ( tls, &tls->pre_master_secret,
+				     sizeof ( tls->pre_master_secret ) );
+
+	/* Generate keys */
+	if ( ( rc = tls_generate_keys ( tls ) ) != 0 )
+		return rc;
+
 	/* Encrypt pre-master secret using server's public key */
 	memset ( &key_xchg, 0, sizeof ( key_xchg ) );
 	len = pubkey_encrypt ( pubkey, cipherspec->pubkey_ctx,
@@ -1136,6 +1594,240 @@ static int tls_send_client_key_exchange ( struct tls_connection *tls ) {
 				    ( sizeof ( key_xchg ) - unused ) );
 }
 
+/** Public key exchange algorithm */
+struct tls_key_exchange_algorithm tls_pubkey_exchange_algorithm = {
+	.name = "pubkey",
+	.exchange = tls_send_client_key_exchange_pubkey,
+};
+
+/**
+ * Verify Diffie-Hellman parameter signature
+ *
+ * @v tls		TLS connection
+ * @v param_len		Diffie-Hellman parameter length
+ * @ret rc		Return status code
+ *
+ * The Diffie-Hellman parameters are held at the start of the Server
+ * Key Exchange record, and are followed by the signature.
+ */
+static int tls_verify_dh_params ( struct tls_connection *tls,
+				  size_t param_len ) {
+	struct tls_cipherspec *cipherspec = &tls->tx_cipherspec_pending;
+	struct pubkey_algorithm *pubkey = cipherspec->suite->pubkey;
+	struct digest_algorithm *digest;
+	int use_sig_hash = ( ( tls->version >= TLS_VERSION_TLS_1_2 ) ? 1 : 0 );
+	const struct {
+		struct tls_signature_hash_id sig_hash[use_sig_hash];
+		uint16_t signature_len;
+		uint8_t signature[0];
+	} __attribute__ (( packed )) *sig;
+	const void *data;
+	size_t remaining;
+	size_t signature_len;
+	int rc;
+
+	/* Signature follows parameters */
+	assert ( param_len <= tls->server_key_len );
+	data = ( tls->server_key + param_len );
+	remaining = ( tls->server_key_len - param_len );
+
+	/* Parse signature */
+	sig = data;
+	if ( ( sizeof ( *sig ) > remaining ) ||
+	     ( ( signature_len = ntohs ( sig->signature_len ) ) >
+	       ( remaining - sizeof ( *sig ) ) ) ) {
+		DBGC ( tls, "TLS %p received underlength Server Key Exchange "
+		       "signature\n", tls );
+		DBGC_HD ( tls, tls->server_key, tls->server_key_len );
+		return -EINVAL_KEY_EXCHANGE;
+	}
+
+	/* Identify digest algorithm.  TLSv1.1 and earlier use
+	 * MD5+SHA1 for RSA signatures and SHA-1 for all other
+	 * signatures (as per RFC 4492).
+	 */
+	if ( use_sig_hash ) {
+		digest = tls_signature_hash_digest ( pubkey, sig->sig_hash[0] );
+		if ( ! digest ) {
+			DBGC ( tls, "TLS %p ServerKeyExchange unsupported "
+			       "signature (%d,%d)\n", tls,
+			       sig->sig_hash[0].signature,
+			       sig->sig_hash[0].hash );
+			return -ENOTSUP_SIG_HASH;
+		}
+	} else {
+		digest = ( ( pubkey == &rsa_algorithm ) ?
+			   &md5_sha1_algorithm : &sha1_algorithm );
+	}
+
+	/* Verify signature */
+	{
+		uint8_t ctx[ digest->ctxsize ];
+		uint8_t hash[ digest->digestsize ];
+
+		/* Calculate digest */
+		digest_init ( digest, ctx );
+		digest_update ( digest, ctx, &tls->client_random,
+				sizeof ( tls->client_random ) );
+		digest_update ( digest, ctx, tls->server_random,
+				sizeof ( tls->server_random ) );
+		digest_update ( digest, ctx, tls->server_key, param_len );
+		digest_final ( digest, ctx, hash );
+
+		/* Verify signature */
+		if ( ( rc = pubkey_verify ( pubkey, cipherspec->pubkey_ctx,
+					    digest, hash, sig->signature,
+					    signature_len ) ) != 0 ) {
+			DBGC ( tls, "TLS %p ServerKeyExchange failed "
+			       "verification: %s\n", tls, strerror ( rc ) );
+			DBGC_HD ( tls, tls->server_key, tls->server_key_len );
+			return -EPERM_KEY_EXCHANGE;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Transmit Client Key Exchange record using ECDHE key exchange
+ *
+ * @v tls		TLS connection
+ * @ret rc		Return status code
+ */
+static int tls_send_client_key_exchange_ecdhe ( struct tls_connection *tls ) {
+	struct tls_named_curve *named_curve;
+	struct elliptic_curve *curve;
+	const struct {
+		uint8_t curve_type;
+		uint16_t named_curve;
+		uint8_t public_len;
+		uint8_t public[0];
+	} __attribute__ (( packed )) *ecdh;
+	size_t param_len;
+	int rc;
+
+	/* Parse ServerKeyExchange record */
+	ecdh = tls->server_key;
+	if ( ( sizeof ( *ecdh ) > tls->server_key_len ) ||
+	     ( ecdh->public_len > ( tls->server_key_len - sizeof ( *ecdh ) ))){
+		DBGC ( tls, "TLS %p received underlength Server Key Exchange\n",
+		       tls );
+		DBGC_HD ( tls, tls->server_key, tls->server_key_len );
+		return -EINVAL_KEY_EXCHANGE;
+	}
+	param_len = ( sizeof ( *ecdh ) + ecdh->public_len );
+
+	/* Verify parameter signature */
+	if ( ( rc = tls_verify_dh_params ( tls, param_len ) ) != 0 )
+		return rc;
+
+	/* Identify named curve */
+	if ( ecdh->curve_type != TLS_NAMED_CURVE_TYPE ) {
+		DBGC ( tls, "TLS %p unsupported curve type %d\n",
+		       tls, ecdh->curve_type );
+		DBGC_HD ( tls, tls->server_key, tls->server_key_len );
+		return -ENOTSUP_CURVE;
+	}
+	named_curve = tls_find_named_curve ( ecdh->named_curve );
+	if ( ! named_curve ) {
+		DBGC ( tls, "TLS %p unsupported named curve %d\n",
+		       tls, ntohs ( ecdh->named_curve ) );
+		DBGC_HD ( tls, tls->server_key, tls->server_key_len );
+		return -ENOTSUP_CURVE;
+	}
+	curve = named_curve->curve;
+	DBGC ( tls, "TLS %p using named curve %s\n", tls, curve->name );
+
+	/* Check key length */
+	if ( ecdh->public_len != curve->pointsize ) {
+		DBGC ( tls, "TLS %p invalid %s key\n", tls, curve->name );
+		DBGC_HD ( tls, tls->server_key, tls->server_key_len );
+		return -EINVAL_KEY_EXCHANGE;
+	}
+
+	/* Construct pre-master secret and ClientKeyExchange record */
+	{
+		size_t len = curve->pointsize;
+		uint8_t private[ curve->keysize ];
+		uint8_t shared[len];
+		uint8_t *secret;
+		size_t secret_len;
+		struct {
+			uint32_t type_length;
+			uint8_t public_len;
+			uint8_t public[len];
+		} __attribute__ (( packed )) key_xchg;
+
+		/* Generate ephemeral private key */
+		if ( ( rc = tls_generate_random ( tls, private,
+						  sizeof ( private ) ) ) != 0){
+			goto err_random;
+		}
+
+		/* Calculate shared secret */
+		if ( ( rc = elliptic_multiply ( curve, ecdh->public, private,
+						shared ) ) != 0 ) {
+			DBGC ( tls, "TLS %p could not exchange %s key: %s\n",
+			       tls, curve->name, strerror ( rc ) );
+			goto err_shared;
+		}
+
+		/* Generate master secret (omitting any format byte) */
+		secret = ( shared + ( named_curve->format ? 1 : 0 ) );
+		secret_len = named_curve->pre_master_secret_len;
+		tls_generate_master_secret ( tls, secret, secret_len );
+
+		/* Generate keys */
+		if ( ( rc = tls_generate_keys ( tls ) ) != 0 )
+			goto err_keys;
+
+		/* Calculate public key */
+		if ( ( rc = elliptic_multiply ( curve, curve->base, private,
+						key_xchg.public ) ) != 0 ) {
+			DBGC ( tls, "TLS %p could not generate %s key: %s\n",
+			       tls, curve->name, strerror ( rc ) );
+			goto err_public;
+		}
+
+		/* Construct and transmit record */
+		key_xchg.type_length =
+			( cpu_to_le32 ( TLS_CLIENT_KEY_EXCHANGE ) |
+			  htonl ( sizeof ( key_xchg ) -
+				  sizeof ( key_xchg.type_length ) ) );
+		key_xchg.public_len = sizeof ( key_xchg.public );
+		rc = tls_send_handshake ( tls, &key_xchg, sizeof ( key_xchg ) );
+
+	err_public:
+	err_keys:
+	err_shared:
+		memset ( shared, 0, sizeof ( shared ) );
+	err_random:
+		memset ( private, 0, sizeof ( private ) );
+	}
+
+	return rc;
+}
+
+/** Ephemeral Elliptic Curve Diffie-Hellman key exchange algorithm */
+struct tls_key_exchange_algorithm tls_ecdhe_exchange_algorithm = {
+	.name = "ecdhe",
+	.exchange = tls_send_client_key_exchange_ecdhe,
+};
+
+/**
+ * Transmit Client Key Exchange record
+ *
+ * @v tls		TLS connection
+ * @ret rc		Return status code
+ */
+static int tls_send_client_key_exchange ( struct tls_connection *tls ) {
+	struct tls_cipherspec *cipherspec = &tls->tx_cipherspec_pending;
+	struct tls_cipher_suite *suite = cipherspec->suite;
+
+	/* Transmit Client Key Exchange record via key exchange algorithm */
+	return suite->exchange->exchange ( tls );
+}
+
 /**
  * Transmit Certificate Verify record
  *
@@ -1274,6 +1966,8 @@ static int tls_send_finished ( struct tls_connection *tls ) {
 
 	/* Mark client as finished */
 	pending_put ( &tls->client_negotiation );
+	if ( tls_ready ( tls ) )
+		trace_stop ( tls->trace, 0 );
 
 	return 0;
 }
@@ -1377,6 +2071,51 @@ static int tls_new_hello_request ( struct tls_connection *tls,
 	return 0;
 }
 
+/**
+ * Record negotiated application-layer protocol
+ *
+ * @v tls		TLS connection
+ * @v name		Protocol name selected by server, or NULL
+ * @v len		Length of protocol name
+ * @ret rc		Return status code
+ */
+static int tls_select_protocol ( struct tls_connection *tls,
+				 const char *name, size_t len ) {
+	const uint8_t *offer;
+	size_t remaining;
+
+	/* Forget any previously negotiated protocol */
+	free ( tls->protocol );
+	tls->protocol = NULL;
+
+	/* Do nothing if server did not select a protocol */
+	if ( ! name )
+		return 0;
+
+	/* Check that protocol was offered */
+	for ( offer = tls->alpn, remaining = tls->alpn_len ; remaining ;
+	      remaining -= ( 1 + offer[0] ), offer += ( 1 + offer[0] ) ) {
+		if ( ( offer[0] == len ) &&
+		     ( memcmp ( &offer[1], name, len ) == 0 ) )
+			break;
+	}
+	if ( ! remaining ) {
+		DBGC ( tls, "TLS %p server selected unoffered "
+		       "application-layer protocol:\n", tls );
+		DBGC_HDA ( tls, 0, name, len );
+		return -EPERM_ALPN;
+	}
+
+	/* Record protocol */
+	tls->protocol = strndup ( name, len );
+	if ( ! tls->protocol )
+		return -ENOMEM;
+	DBGC ( tls, "TLS %p using application-layer protocol \"%s\"\n",
+	       tls, tls->protocol );
+
+	return 0;
+}
+
 /**
  * Receive new Server Hello handshake record
  *
@@ -1412,6 +2151,17 @@ static int tls_new_server_hello ( struct tls_connection *tls,
 		uint8_t len;
 		uint8_t data[0];
 	} __attribute__ (( packed )) *reneg = NULL;
+	const struct {
+		uint16_t len;
+		uint8_t name_len;
+		char name[0];
+	} __attribute__ (( packed )) *alpn = NULL;
+	const struct {
+		uint8_t max;
+	} __attribute__ (( packed )) *max_frag = NULL;
+	const struct {
+		uint16_t max;
+	} __attribute__ (( packed )) *size_limit = NULL;
 	uint16_t version;
 	size_t exts_len;
 	size_t ext_len;
@@ -1476,6 +2226,44 @@ static int tls_new_server_hello ( struct tls_connection *tls,
 					return -EINVAL_HELLO;
 				}
 				break;
+			case htons ( TLS_ALPN ) :
+				alpn = ( ( void * ) ext->data );
+				if ( ( sizeof ( *alpn ) > ext_len ) ||
+				     ( ntohs ( alpn->len ) !=
+				       ( ext_len - sizeof ( alpn->len ) ) ) ||
+				     ( alpn->name_len !=
+				       ( ext_len - sizeof ( *alpn ) ) ) ||
+				     ( alpn->name_len == 0 ) ) {
+					DBGC ( tls, "TLS %p received invalid "
+					       "application-layer protocol\n",
+					       tls );
+					DBGC_HD ( tls, data, len );
+					return -EINVAL_ALPN;
+				}
+				break;
+			case htons ( TLS_MAX_FRAGMENT_LENGTH ) :
+				max_frag = ( ( void * ) ext->data );
+				if ( ( sizeof ( *max_frag ) != ext_len ) ||
+				     ( max_frag->max !=
+				       TLS_MAX_FRAGMENT_LENGTH_4096 ) ) {
+					DBGC ( tls, "TLS %p received invalid "
+					       "maximum fragment length\n",
+					       tls );
+					DBGC_HD ( tls, data, len );
+					return -EINVAL_RECORD_SIZE;
+				}
+				break;
+			case htons ( TLS_RECORD_SIZE_LIMIT ) :
+				size_limit = ( ( void * ) ext->data );
+				if ( ( sizeof ( *size_limit ) != ext_len ) ||
+				     ( ntohs ( size_limit->max ) <
+				       TLS_RECORD_SIZE_LIMIT_MIN ) ) {
+					DBGC ( tls, "TLS %p received invalid "
+					       "record size limit\n", tls );
+					DBGC_HD ( tls, data, len );
+					return -EINVAL_RECORD_SIZE;
+				}
+				break;
 			}
 		}
 	}
@@ -1513,11 +2301,6 @@ static int tls_new_server_hello ( struct tls_connection *tls,
 	if ( ( rc = tls_select_cipher ( tls, hello_b->cipher_suite ) ) != 0 )
 		return rc;
 
-	/* Generate secrets */
-	tls_generate_master_secret ( tls );
-	if ( ( rc = tls_generate_keys ( tls ) ) != 0 )
-		return rc;
-
 	/* Handle secure renegotiation */
 	if ( tls->secure_renegotiation ) {
 
@@ -1542,7 +2325,62 @@ static int tls_new_server_hello ( struct tls_connection *tls,
 		tls->secure_renegotiation = 1;
 	}
 
-	return 0;
+	/* Record maximum transmitted record length.  A record size
+	 * limit overrides any negotiated maximum fragment length.
+	 */
+	tls->tx_max_len = TLS_MAX_RECORD_LEN;
+	if ( size_limit ) {
+		if ( tls->tx_max_len > ntohs ( size_limit->max ) )
+			tls->tx_max_len = ntohs ( size_limit->max );
+	} else if ( max_frag ) {
+		tls->tx_max_len = ( 256 << max_frag->max );
+	}
+	DBGC ( tls, "TLS %p sending records of up to %zd bytes\n",
+	       tls, tls->tx_max_len );
+
+	/* Record negotiated application-layer protocol, if any */
+	if ( ( rc = tls_select_protocol ( tls, ( alpn ? alpn->name : NULL ),
+					  ( alpn ? alpn->name_len : 0 ) ) ) != 0 )
+		return rc;
+
+	/* Check for session resumption */
+	if ( tls->session_id_len &&
+	     ( hello_a->session_id_len == tls->session_id_len ) &&
+	     ( memcmp ( session_id, tls->session_id,
+			tls->session_id_len ) == 0 ) ) {
+
+		/* Server has agreed to resume session using the
+		 * master secret copied from the cached session.
+		 */
+		DBGC ( tls, "TLS %p resuming session %p\n",
+		       tls, tls->session );
+		tls->resumed = 1;
+
+		/* Generate keys */
+		if ( ( rc = tls_generate_keys ( tls ) ) != 0 )
+			return rc;
+
+	} else {
+
+		/* Record new session ID (if any) */
+		if ( hello_a->session_id_len > sizeof ( tls->session_id ) ) {
+			DBGC ( tls, "TLS %p received overlength session ID\n",
+			       tls );
+			DBGC_HD ( tls, data, len );
+			return -EINVAL_HELLO;
+		}
+		memcpy ( tls->session_id, session_id,
+			 hello_a->session_id_len );
+		tls->session_id_len = hello_a->session_id_len;
+		tls->resumed = 0;
+
+		/* Discard any offered session ticket */
+		free ( tls->session_ticket );
+		tls->session_ticket = NULL;
+		tls->session_ticket_len = 0;
+	}
+
+	return 0;
 }
 
 /**
@@ -1663,6 +2501,96 @@ static int tls_new_certificate ( struct tls_connection *tls,
 	return 0;
 }
 
+/**
+ * Receive new Certificate Status handshake record
+ *
+ * @v tls		TLS connection
+ * @v data		Plaintext handshake record
+ * @v len		Length of plaintext handshake record
+ * @ret rc		Return status code
+ */
+static int tls_new_certificate_status ( struct tls_connection *tls,
+					const void *data, size_t len ) {
+	const struct {
+		uint8_t type;
+		tls24_t length;
+		uint8_t response[0];
+	} __attribute__ (( packed )) *status = data;
+	struct x509_certificate *cert;
+	size_t response_len;
+
+	/* Parse header */
+	if ( sizeof ( *status ) > len ) {
+		DBGC ( tls, "TLS %p received underlength Certificate Status\n",
+		       tls );
+		DBGC_HD ( tls, data, len );
+		return -EINVAL_CERTIFICATE_STATUS;
+	}
+	response_len = tls_uint24 ( &status->length );
+	if ( response_len > ( len - sizeof ( *status ) ) ) {
+		DBGC ( tls, "TLS %p received overlength Certificate Status\n",
+		       tls );
+		DBGC_HD ( tls, data, len );
+		return -EINVAL_CERTIFICATE_STATUS;
+	}
+
+	/* Ignore unrecognised status types */
+	if ( status->type != TLS_STATUS_REQUEST_OCSP ) {
+		DBGC ( tls, "TLS %p ignoring Certificate Status type %d\n",
+		       tls, status->type );
+		return 0;
+	}
+
+	/* Identify server certificate */
+	cert = ( tls->chain ? x509_first ( tls->chain ) : NULL );
+	if ( ! cert ) {
+		DBGC ( tls, "TLS %p received Certificate Status without "
+		       "Certificate\n", tls );
+		return -EINVAL_CERTIFICATE_STATUS;
+	}
+
+	/* Record stapled OCSP response for the server certificate.
+	 * The response will be validated only if required.  Ignore
+	 * errors, since the response could still be obtained from
+	 * the OCSP responder.
+	 */
+	DBGC ( tls, "TLS %p received stapled OCSP response\n", tls );
+	ocsp_staple ( cert, status->response, response_len );
+
+	return 0;
+}
+
+/**
+ * Receive new Server Key Exchange handshake record
+ *
+ * @v tls		TLS connection
+ * @v data		Plaintext handshake record
+ * @v len		Length of plaintext handshake record
+ * @ret rc		Return status code
+ */
+static int tls_new_server_key_exchange ( struct tls_connection *tls,
+					 const void *data, size_t len ) {
+
+	/* Free any existing server key exchange record */
+	free ( tls->server_key );
+	tls->server_key_len = 0;
+
+	/* Allocate copy of server key exchange record */
+	tls->server_key = malloc ( len );
+	if ( ! tls->server_key )
+		return -ENOMEM_KEY_EXCHANGE;
+
+	/* Store copy of server key exchange record for later
+	 * processing.  We cannot verify the signature at this point
+	 * since the certificate validation will not yet have
+	 * completed.
+	 */
+	memcpy ( tls->server_key, data, len );
+	tls->server_key_len = len;
+
+	return 0;
+}
+
 /**
  * Receive new Certificate Request handshake record
  *
@@ -1696,6 +2624,56 @@ static int tls_new_certificate_request ( struct tls_connection *tls,
 	return 0;
 }
 
+/**
+ * Receive new New Session Ticket handshake record
+ *
+ * @v tls		TLS connection
+ * @v data		Plaintext handshake record
+ * @v len		Length of plaintext handshake record
+ * @ret rc		Return status code
+ */
+static int tls_new_session_ticket ( struct tls_connection *tls,
+				    const void *data, size_t len ) {
+	const struct {
+		uint32_t lifetime;
+		uint16_t len;
+		uint8_t ticket[0];
+	} __attribute__ (( packed )) *new_ticket = data;
+	size_t ticket_len;
+
+	/* Parse header */
+	if ( sizeof ( *new_ticket ) > len ) {
+		DBGC ( tls, "TLS %p received underlength New Session Ticket\n",
+		       tls );
+		DBGC_HD ( tls, data, len );
+		return -EINVAL_TICKET;
+	}
+	ticket_len = ntohs ( new_ticket->len );
+	if ( ticket_len > ( len - sizeof ( *new_ticket ) ) ) {
+		DBGC ( tls, "TLS %p received overlength New Session Ticket\n",
+		       tls );
+		DBGC_HD ( tls, data, len );
+		return -EINVAL_TICKET;
+	}
+
+	/* Replace any existing session ticket */
+	free ( tls->session_ticket );
+	tls->session_ticket = NULL;
+	tls->session_ticket_len = 0;
+	if ( ! ticket_len )
+		return 0;
+	tls->session_ticket = malloc ( ticket_len );
+	if ( ! tls->session_ticket )
+		return -ENOMEM_TICKET;
+	memcpy ( tls->session_ticket, new_ticket->ticket, ticket_len );
+	tls->session_ticket_len = ticket_len;
+	DBGC ( tls, "TLS %p received session ticket (lifetime %ds):\n",
+	       tls, ntohl ( new_ticket->lifetime ) );
+	DBGC_HDA ( tls, 0, tls->session_ticket, tls->session_ticket_len );
+
+	return 0;
+}
+
 /**
  * Receive new Server Hello Done handshake record
  *
@@ -1766,6 +2744,17 @@ static int tls_new_finished ( struct tls_connection *tls,
 
 	/* Mark server as finished */
 	pending_put ( &tls->server_negotiation );
+	if ( tls_ready ( tls ) )
+		trace_stop ( tls->trace, 0 );
+
+	/* Record session parameters for future resumption */
+	tls_session_update ( tls );
+
+	/* Schedule Change Cipher and Finished, if resuming a session */
+	if ( tls->resumed ) {
+		tls->tx_pending |= ( TLS_TX_CHANGE_CIPHER | TLS_TX_FINISHED );
+		tls_tx_resume ( tls );
+	}
 
 	/* Send notification of a window change */
 	xfer_window_changed ( &tls->plainstream );
@@ -1822,9 +2811,21 @@ static int tls_new_handshake ( struct tls_connection *tls,
 		case TLS_SERVER_HELLO:
 			rc = tls_new_server_hello ( tls, payload, payload_len );
 			break;
+		case TLS_NEW_SESSION_TICKET:
+			rc = tls_new_session_ticket ( tls, payload,
+						      payload_len );
+			break;
 		case TLS_CERTIFICATE:
 			rc = tls_new_certificate ( tls, payload, payload_len );
 			break;
+		case TLS_CERTIFICATE_STATUS:
+			rc = tls_new_certificate_status ( tls, payload,
+							  payload_len );
+			break;
+		case TLS_SERVER_KEY_EXCHANGE:
+			rc = tls_new_server_key_exchange ( tls, payload,
+							   payload_len );
+			break;
 		case TLS_CERTIFICATE_REQUEST:
 			rc = tls_new_certificate_request ( tls, payload,
 							   payload_len );
@@ -2008,167 +3009,241 @@ static void tls_hmac ( struct tls_cipherspec *cipherspec,
 }
 
 /**
- * Allocate and assemble stream-ciphered record from data and MAC portions
+ * Calculate headroom required for transmitted record
  *
  * @v tls		TLS connection
- * @ret data		Data
- * @ret len		Length of data
- * @ret digest		MAC digest
- * @ret plaintext_len	Length of plaintext record
- * @ret plaintext	Allocated plaintext record
- */
-static void * __malloc
-tls_assemble_stream ( struct tls_connection *tls, const void *data, size_t len,
-		      void *digest, size_t *plaintext_len ) {
-	size_t mac_len = tls->tx_cipherspec.suite->digest->digestsize;
-	void *plaintext;
-	void *content;
-	void *mac;
+ * @ret headroom	Required headroom
+ */
+static size_t tls_tx_headroom ( struct tls_connection *tls ) {
+	struct tls_cipher_suite *suite = tls->tx_cipherspec.suite;
+
+	return ( sizeof ( struct tls_header ) + suite->record_iv_len );
+}
+
+/**
+ * Calculate tailroom required for transmitted record
+ *
+ * @v tls		TLS connection
+ * @ret tailroom	Required tailroom
+ */
+static size_t tls_tx_tailroom ( struct tls_connection *tls ) {
+	struct tls_cipher_suite *suite = tls->tx_cipherspec.suite;
+	struct cipher_algorithm *cipher = suite->cipher;
 
-	/* Calculate stream-ciphered struct length */
-	*plaintext_len = ( len + mac_len );
+	return ( suite->mac_len + cipher->blocksize + cipher->authsize );
+}
+
+/**
+ * Allocate I/O buffer for transmitted record
+ *
+ * @v tls		TLS connection
+ * @v len		Length of plaintext data
+ * @ret iobuf		I/O buffer, or NULL on failure
+ *
+ * The I/O buffer will contain sufficient headroom and tailroom to
+ * allow the record to be encrypted in place.
+ */
+static struct io_buffer * tls_alloc_iob ( struct tls_connection *tls,
+					  size_t len ) {
+	size_t headroom = tls_tx_headroom ( tls );
+	size_t tailroom = tls_tx_tailroom ( tls );
+	struct io_buffer *iobuf;
 
-	/* Allocate stream-ciphered struct */
-	plaintext = malloc ( *plaintext_len );
-	if ( ! plaintext )
+	iobuf = xfer_alloc_iob ( &tls->cipherstream,
+				 ( headroom + len + tailroom ) );
+	if ( ! iobuf )
 		return NULL;
-	content = plaintext;
-	mac = ( content + len );
+	iob_reserve ( iobuf, headroom );
+
+	return iobuf;
+}
 
-	/* Fill in stream-ciphered struct */
-	memcpy ( content, data, len );
-	memcpy ( mac, digest, mac_len );
+/**
+ * Construct initialisation vector for an authenticated cipher
+ *
+ * @v cipherspec	Cipher specification
+ * @v seq		Sequence number (in network byte order)
+ * @v record_iv		Explicit record initialisation vector (if any)
+ * @v iv		Initialisation vector to fill in
+ *
+ * Cipher suites with an explicit record initialisation vector (such
+ * as AES-GCM) append it to the fixed initialisation vector.  Cipher
+ * suites without an explicit record initialisation vector (such as
+ * ChaCha20-Poly1305) instead exclusive-OR the sequence number into
+ * the fixed initialisation vector.
+ */
+static void tls_auth_iv ( struct tls_cipherspec *cipherspec, uint64_t seq,
+			  const void *record_iv, void *iv ) {
+	struct tls_cipher_suite *suite = cipherspec->suite;
+	const uint8_t *seq_bytes = ( ( const void * ) &seq );
+	uint8_t *iv_bytes = iv;
+	size_t len = ( suite->fixed_iv_len + suite->record_iv_len );
+	unsigned int i;
 
-	return plaintext;
+	memcpy ( iv, cipherspec->fixed_iv, suite->fixed_iv_len );
+	if ( suite->record_iv_len ) {
+		memcpy ( ( iv + suite->fixed_iv_len ), record_iv,
+			 suite->record_iv_len );
+	} else {
+		assert ( len >= sizeof ( seq ) );
+		for ( i = 0 ; i < sizeof ( seq ) ; i++ )
+			iv_bytes[ len - sizeof ( seq ) + i ] ^= seq_bytes[i];
+	}
 }
 
 /**
- * Allocate and assemble block-ciphered record from data and MAC portions
+ * Send plaintext record using an authenticated cipher
  *
  * @v tls		TLS connection
- * @ret data		Data
- * @ret len		Length of data
- * @ret digest		MAC digest
- * @ret plaintext_len	Length of plaintext record
- * @ret plaintext	Allocated plaintext record
- */
-static void * tls_assemble_block ( struct tls_connection *tls,
-				   const void *data, size_t len,
-				   void *digest, size_t *plaintext_len ) {
-	size_t blocksize = tls->tx_cipherspec.suite->cipher->blocksize;
-	size_t mac_len = tls->tx_cipherspec.suite->digest->digestsize;
-	size_t iv_len;
-	size_t padding_len;
-	void *plaintext;
-	void *iv;
-	void *content;
-	void *mac;
-	void *padding;
-
-	/* TLSv1.1 and later use an explicit IV */
-	iv_len = ( ( tls->version >= TLS_VERSION_TLS_1_1 ) ? blocksize : 0 );
+ * @v type		Record type
+ * @v iobuf		I/O buffer containing plaintext record
+ * @ret rc		Return status code
+ *
+ * The record is encrypted in place, with no separate MAC or padding.
+ */
+static int tls_send_auth ( struct tls_connection *tls, unsigned int type,
+			   struct io_buffer *iobuf ) {
+	struct tls_cipherspec *cipherspec = &tls->tx_cipherspec;
+	struct tls_cipher_suite *suite = cipherspec->suite;
+	struct cipher_algorithm *cipher = suite->cipher;
+	struct tls_auth_header authhdr;
+	struct tls_header *tlshdr;
+	size_t len = iob_len ( iobuf );
+	uint8_t iv[ suite->fixed_iv_len + suite->record_iv_len ];
+	uint64_t seq;
+	int rc;
 
-	/* Calculate block-ciphered struct length */
-	padding_len = ( ( blocksize - 1 ) & -( iv_len + len + mac_len + 1 ) );
-	*plaintext_len = ( iv_len + len + mac_len + padding_len + 1 );
+	/* Use the sequence number as any explicit record
+	 * initialisation vector
+	 */
+	assert ( ( suite->record_iv_len == 0 ) ||
+		 ( suite->record_iv_len == sizeof ( seq ) ) );
+	seq = cpu_to_be64 ( tls->tx_seq );
+	tls_auth_iv ( cipherspec, seq, &seq, iv );
+
+	/* Construct authentication header */
+	authhdr.seq = seq;
+	authhdr.header.type = type;
+	authhdr.header.version = htons ( tls->version );
+	authhdr.header.length = htons ( len );
+
+	/* Encrypt record in place */
+	cipher_setiv ( cipher, cipherspec->cipher_ctx, iv );
+	cipher_encrypt ( cipher, cipherspec->cipher_ctx, &authhdr, NULL,
+			 sizeof ( authhdr ) );
+	cipher_encrypt ( cipher, cipherspec->cipher_ctx, iobuf->data,
+			 iobuf->data, len );
+	cipher_auth ( cipher, cipherspec->cipher_ctx,
+		      iob_put ( iobuf, cipher->authsize ) );
+
+	/* Prepend any explicit nonce, and record header */
+	memcpy ( iob_push ( iobuf, suite->record_iv_len ), &seq,
+		 suite->record_iv_len );
+	tlshdr = iob_push ( iobuf, sizeof ( *tlshdr ) );
+	tlshdr->type = type;
+	tlshdr->version = htons ( tls->version );
+	tlshdr->length = htons ( iob_len ( iobuf ) - sizeof ( *tlshdr ) );
 
-	/* Allocate block-ciphered struct */
-	plaintext = malloc ( *plaintext_len );
-	if ( ! plaintext )
-		return NULL;
-	iv = plaintext;
-	content = ( iv + iv_len );
-	mac = ( content + len );
-	padding = ( mac + mac_len );
+	/* Send ciphertext */
+	if ( ( rc = xfer_deliver_iob ( &tls->cipherstream, iobuf ) ) != 0 ) {
+		DBGC ( tls, "TLS %p could not deliver ciphertext: %s\n",
+		       tls, strerror ( rc ) );
+		return rc;
+	}
 
-	/* Fill in block-ciphered struct */
-	tls_generate_random ( tls, iv, iv_len );
-	memcpy ( content, data, len );
-	memcpy ( mac, digest, mac_len );
-	memset ( padding, padding_len, ( padding_len + 1 ) );
+	/* Update TX state machine to next record */
+	tls->tx_seq += 1;
 
-	return plaintext;
+	return 0;
 }
 
 /**
- * Send plaintext record
+ * Send plaintext record from I/O buffer
  *
  * @v tls		TLS connection
  * @v type		Record type
- * @v data		Plaintext record
- * @v len		Length of plaintext record
+ * @v iobuf		I/O buffer containing plaintext record
  * @ret rc		Return status code
+ *
+ * The record is encrypted in place within the I/O buffer, which will
+ * then be passed down to the ciphertext stream.  The data will be
+ * copied only if the I/O buffer does not have sufficient headroom and
+ * tailroom (as provided by tls_alloc_iob()).
  */
-static int tls_send_plaintext ( struct tls_connection *tls, unsigned int type,
-				const void *data, size_t len ) {
+static int tls_send_record ( struct tls_connection *tls, unsigned int type,
+			     struct io_buffer *iobuf ) {
 	struct tls_header plaintext_tlshdr;
 	struct tls_header *tlshdr;
 	struct tls_cipherspec *cipherspec = &tls->tx_cipherspec;
-	struct cipher_algorithm *cipher = cipherspec->suite->cipher;
-	void *plaintext = NULL;
-	size_t plaintext_len;
-	struct io_buffer *ciphertext = NULL;
-	size_t ciphertext_len;
-	size_t mac_len = cipherspec->suite->digest->digestsize;
-	uint8_t mac[mac_len];
+	struct tls_cipher_suite *suite = cipherspec->suite;
+	struct cipher_algorithm *cipher = suite->cipher;
+	struct io_buffer *copy;
+	size_t len = iob_len ( iobuf );
+	size_t blocksize;
+	size_t iv_len;
+	size_t padding_len;
 	int rc;
 
+	/* Copy to a new I/O buffer if unable to encrypt in place */
+	if ( ( iob_headroom ( iobuf ) < tls_tx_headroom ( tls ) ) ||
+	     ( iob_tailroom ( iobuf ) < tls_tx_tailroom ( tls ) ) ) {
+		copy = tls_alloc_iob ( tls, len );
+		if ( ! copy ) {
+			DBGC ( tls, "TLS %p could not allocate %zd bytes for "
+			       "plaintext\n", tls, len );
+			free_iob ( iobuf );
+			return -ENOMEM_TX_PLAINTEXT;
+		}
+		memcpy ( iob_put ( copy, len ), iobuf->data, len );
+		free_iob ( iobuf );
+		iobuf = copy;
+	}
+
+	DBGC2 ( tls, "Sending plaintext data:\n" );
+	DBGC2_HD ( tls, iobuf->data, len );
+
+	/* Use authenticated encryption, if applicable */
+	if ( is_auth_cipher ( cipher ) )
+		return tls_send_auth ( tls, type, iobuf );
+
 	/* Construct header */
 	plaintext_tlshdr.type = type;
 	plaintext_tlshdr.version = htons ( tls->version );
 	plaintext_tlshdr.length = htons ( len );
 
-	/* Calculate MAC */
-	tls_hmac ( cipherspec, tls->tx_seq, &plaintext_tlshdr, data, len, mac );
-
-	/* Allocate and assemble plaintext struct */
-	if ( is_stream_cipher ( cipher ) ) {
-		plaintext = tls_assemble_stream ( tls, data, len, mac,
-						  &plaintext_len );
-	} else {
-		plaintext = tls_assemble_block ( tls, data, len, mac,
-						 &plaintext_len );
-	}
-	if ( ! plaintext ) {
-		DBGC ( tls, "TLS %p could not allocate %zd bytes for "
-		       "plaintext\n", tls, plaintext_len );
-		rc = -ENOMEM_TX_PLAINTEXT;
-		goto done;
-	}
-
-	DBGC2 ( tls, "Sending plaintext data:\n" );
-	DBGC2_HD ( tls, plaintext, plaintext_len );
-
-	/* Allocate ciphertext */
-	ciphertext_len = ( sizeof ( *tlshdr ) + plaintext_len );
-	ciphertext = xfer_alloc_iob ( &tls->cipherstream, ciphertext_len );
-	if ( ! ciphertext ) {
-		DBGC ( tls, "TLS %p could not allocate %zd bytes for "
-		       "ciphertext\n", tls, ciphertext_len );
-		rc = -ENOMEM_TX_CIPHERTEXT;
-		goto done;
+	/* Append MAC */
+	tls_hmac ( cipherspec, tls->tx_seq, &plaintext_tlshdr, iobuf->data,
+		   len, iob_put ( iobuf, suite->mac_len ) );
+
+	/* Append padding and prepend IV for block ciphers */
+	if ( ! is_stream_cipher ( cipher ) ) {
+		blocksize = cipher->blocksize;
+		iv_len = ( ( tls->version >= TLS_VERSION_TLS_1_1 ) ?
+			   suite->record_iv_len : 0 );
+		padding_len = ( ( blocksize - 1 ) &
+				-( iv_len + iob_len ( iobuf ) + 1 ) );
+		memset ( iob_put ( iobuf, ( padding_len + 1 ) ), padding_len,
+			 ( padding_len + 1 ) );
+		tls_generate_random ( tls, iob_push ( iobuf, iv_len ), iv_len );
 	}
 
-	/* Assemble ciphertext */
-	tlshdr = iob_put ( ciphertext, sizeof ( *tlshdr ) );
-	tlshdr->type = type;
-	tlshdr->version = htons ( tls->version );
-	tlshdr->length = htons ( plaintext_len );
+	/* Encrypt record in place */
 	memcpy ( cipherspec->cipher_next_ctx, cipherspec->cipher_ctx,
 		 cipher->ctxsize );
-	cipher_encrypt ( cipher, cipherspec->cipher_next_ctx, plaintext,
-			 iob_put ( ciphertext, plaintext_len ), plaintext_len );
+	cipher_encrypt ( cipher, cipherspec->cipher_next_ctx, iobuf->data,
+			 iobuf->data, iob_len ( iobuf ) );
 
-	/* Free plaintext as soon as possible to conserve memory */
-	free ( plaintext );
-	plaintext = NULL;
+	/* Prepend record header */
+	tlshdr = iob_push ( iobuf, sizeof ( *tlshdr ) );
+	tlshdr->type = type;
+	tlshdr->version = htons ( tls->version );
+	tlshdr->length = htons ( iob_len ( iobuf ) - sizeof ( *tlshdr ) );
 
 	/* Send ciphertext */
-	if ( ( rc = xfer_deliver_iob ( &tls->cipherstream,
-				       iob_disown ( ciphertext ) ) ) != 0 ) {
+	if ( ( rc = xfer_deliver_iob ( &tls->cipherstream, iobuf ) ) != 0 ) {
 		DBGC ( tls, "TLS %p could not deliver ciphertext: %s\n",
 		       tls, strerror ( rc ) );
-		goto done;
+		return rc;
 	}
 
 	/* Update TX state machine to next record */
@@ -2176,10 +3251,56 @@ static int tls_send_plaintext ( struct tls_connection *tls, unsigned int type,
 	memcpy ( tls->tx_cipherspec.cipher_ctx,
 		 tls->tx_cipherspec.cipher_next_ctx, cipher->ctxsize );
 
- done:
-	free ( plaintext );
-	free_iob ( ciphertext );
-	return rc;
+	return 0;
+}
+
+/**
+ * Send pending coalesced application data
+ *
+ * @v tls		TLS connection
+ * @ret rc		Return status code
+ */
+static int tls_tx_flush ( struct tls_connection *tls ) {
+	struct io_buffer *iobuf = tls->tx_data;
+
+	/* Do nothing unless data is pending */
+	if ( ! iobuf )
+		return 0;
+	tls->tx_data = NULL;
+
+	/* Send record */
+	return tls_send_record ( tls, TLS_TYPE_DATA, iobuf );
+}
+
+/**
+ * Send plaintext record
+ *
+ * @v tls		TLS connection
+ * @v type		Record type
+ * @v data		Plaintext record
+ * @v len		Length of plaintext record
+ * @ret rc		Return status code
+ */
+static int tls_send_plaintext ( struct tls_connection *tls, unsigned int type,
+				const void *data, size_t len ) {
+	struct io_buffer *iobuf;
+	int rc;
+
+	/* Send any pending application data first, to preserve ordering */
+	if ( ( rc = tls_tx_flush ( tls ) ) != 0 )
+		return rc;
+
+	/* Allocate I/O buffer */
+	iobuf = tls_alloc_iob ( tls, len );
+	if ( ! iobuf ) {
+		DBGC ( tls, "TLS %p could not allocate %zd bytes for "
+		       "ciphertext\n", tls, len );
+		return -ENOMEM_TX_CIPHERTEXT;
+	}
+	memcpy ( iob_put ( iobuf, len ), data, len );
+
+	/* Send record */
+	return tls_send_record ( tls, type, iobuf );
 }
 
 /**
@@ -2229,7 +3350,7 @@ static int tls_split_block ( struct tls_connection *tls,
 	/* TLSv1.1 and later use an explicit IV */
 	iobuf = list_first_entry ( rx_data, struct io_buffer, list );
 	iv_len = ( ( tls->version >= TLS_VERSION_TLS_1_1 ) ?
-		   tls->rx_cipherspec.suite->cipher->blocksize : 0 );
+		   tls->rx_cipherspec.suite->record_iv_len : 0 );
 	if ( iob_len ( iobuf ) < iv_len ) {
 		DBGC ( tls, "TLS %p received underlength IV\n", tls );
 		DBGC_HD ( tls, iobuf->data, iob_len ( iobuf ) );
@@ -2267,6 +3388,86 @@ static int tls_split_block ( struct tls_connection *tls,
 	return 0;
 }
 
+/**
+ * Receive new ciphertext record using an authenticated cipher
+ *
+ * @v tls		TLS connection
+ * @v tlshdr		Record header
+ * @v rx_data		List of received data buffers
+ * @ret rc		Return status code
+ */
+static int tls_new_auth ( struct tls_connection *tls,
+			  struct tls_header *tlshdr,
+			  struct list_head *rx_data ) {
+	struct tls_cipherspec *cipherspec = &tls->rx_cipherspec;
+	struct tls_cipher_suite *suite = cipherspec->suite;
+	struct cipher_algorithm *cipher = suite->cipher;
+	struct tls_auth_header authhdr;
+	uint8_t iv[ suite->fixed_iv_len + suite->record_iv_len ];
+	uint8_t verify_auth[ cipher->authsize ];
+	struct io_buffer *iobuf;
+	void *auth;
+	size_t len = 0;
+	int rc;
+
+	/* Extract record initialisation vector */
+	iobuf = list_first_entry ( rx_data, struct io_buffer, list );
+	assert ( iobuf != NULL );
+	if ( iob_len ( iobuf ) < suite->record_iv_len ) {
+		DBGC ( tls, "TLS %p received underlength IV\n", tls );
+		DBGC_HD ( tls, iobuf->data, iob_len ( iobuf ) );
+		return -EINVAL_AUTH;
+	}
+	tls_auth_iv ( cipherspec, cpu_to_be64 ( tls->rx_seq ), iobuf->data,
+		      iv );
+	iob_pull ( iobuf, suite->record_iv_len );
+
+	/* Extract authentication tag */
+	iobuf = list_last_entry ( rx_data, struct io_buffer, list );
+	if ( iob_len ( iobuf ) < cipher->authsize ) {
+		DBGC ( tls, "TLS %p received underlength authentication "
+		       "tag\n", tls );
+		DBGC_HD ( tls, iobuf->data, iob_len ( iobuf ) );
+		return -EINVAL_AUTH;
+	}
+	iob_unput ( iobuf, cipher->authsize );
+	auth = iobuf->tail;
+
+	/* Calculate total length */
+	list_for_each_entry ( iobuf, rx_data, list )
+		len += iob_len ( iobuf );
+
+	/* Construct authentication header */
+	authhdr.seq = cpu_to_be64 ( tls->rx_seq );
+	authhdr.header.type = tlshdr->type;
+	authhdr.header.version = tlshdr->version;
+	authhdr.header.length = htons ( len );
+
+	/* Decrypt the received data */
+	cipher_setiv ( cipher, cipherspec->cipher_ctx, iv );
+	cipher_decrypt ( cipher, cipherspec->cipher_ctx, &authhdr, NULL,
+			 sizeof ( authhdr ) );
+	DBGC2 ( tls, "Received plaintext data:\n" );
+	list_for_each_entry ( iobuf, rx_data, list ) {
+		cipher_decrypt ( cipher, cipherspec->cipher_ctx,
+				 iobuf->data, iobuf->data, iob_len ( iobuf ) );
+		DBGC2_HD ( tls, iobuf->data, iob_len ( iobuf ) );
+	}
+
+	/* Verify authentication tag */
+	cipher_auth ( cipher, cipherspec->cipher_ctx, verify_auth );
+	if ( memcmp ( auth, verify_auth, sizeof ( verify_auth ) ) != 0 ) {
+		DBGC ( tls, "TLS %p failed authentication\n", tls );
+		return -EINVAL_MAC;
+	}
+
+	/* Process plaintext record */
+	if ( ( rc = tls_new_record ( tls, tlshdr->type, rx_data ) ) != 0 )
+		return rc;
+
+	return 0;
+}
+
 /**
  * Receive new ciphertext record
  *
@@ -2289,6 +3490,10 @@ static int tls_new_ciphertext ( struct tls_connection *tls,
 	size_t len = 0;
 	int rc;
 
+	/* Use authenticated decryption, if applicable */
+	if ( is_auth_cipher ( cipher ) )
+		return tls_new_auth ( tls, tlshdr, rx_data );
+
 	/* Decrypt the received data */
 	list_for_each_entry ( iobuf, &tls->rx_data, list ) {
 		cipher_decrypt ( cipher, cipherspec->cipher_ctx,
@@ -2355,6 +3560,19 @@ static size_t tls_plainstream_window ( struct tls_connection *tls ) {
 	return xfer_window ( &tls->cipherstream );
 }
 
+/**
+ * Allocate I/O buffer
+ *
+ * @v tls		TLS connection
+ * @v len		Payload length
+ * @ret iobuf		I/O buffer, or NULL on failure
+ */
+static struct io_buffer *
+tls_plainstream_alloc_iob ( struct tls_connection *tls, size_t len ) {
+
+	return tls_alloc_iob ( tls, len );
+}
+
 /**
  * Deliver datagram as raw data
  *
@@ -2366,29 +3584,87 @@ static size_t tls_plainstream_window ( struct tls_connection *tls ) {
 static int tls_plainstream_deliver ( struct tls_connection *tls,
 				     struct io_buffer *iobuf,
 				     struct xfer_metadata *meta __unused ) {
+	struct io_buffer *pending = tls->tx_data;
+	size_t len = iob_len ( iobuf );
 	int rc;
-	
+
 	/* Refuse unless we are ready to accept data */
 	if ( ! tls_ready ( tls ) ) {
 		rc = -ENOTCONN;
 		goto done;
 	}
 
-	if ( ( rc = tls_send_plaintext ( tls, TLS_TYPE_DATA, iobuf->data,
-					 iob_len ( iobuf ) ) ) != 0 )
+	/* Coalesce into pending record, if possible */
+	if ( pending && ( ( iob_len ( pending ) + len ) <= tls->tx_max_len ) ) {
+
+		/* Expand pending record to a full-sized buffer, if needed */
+		if ( iob_tailroom ( pending ) <
+		     ( len + tls_tx_tailroom ( tls ) ) ) {
+			pending = tls_alloc_iob ( tls, tls->tx_max_len );
+			if ( ! pending )
+				goto flush;
+			memcpy ( iob_put ( pending, iob_len ( tls->tx_data ) ),
+				 tls->tx_data->data, iob_len ( tls->tx_data ) );
+			free_iob ( tls->tx_data );
+			tls->tx_data = pending;
+		}
+
+		/* Append data */
+		memcpy ( iob_put ( pending, len ), iobuf->data, len );
+		rc = 0;
+		goto done;
+	}
+
+ flush:
+	/* Send any existing pending record */
+	if ( ( rc = tls_tx_flush ( tls ) ) != 0 )
 		goto done;
 
+	/* Send any full-sized records */
+	while ( iob_len ( iobuf ) > tls->tx_max_len ) {
+		if ( ( rc = tls_send_plaintext ( tls, TLS_TYPE_DATA,
+						 iobuf->data,
+						 tls->tx_max_len ) ) != 0 )
+			goto done;
+		iob_pull ( iobuf, tls->tx_max_len );
+	}
+
+	/* Hold remaining data as pending record, to be sent (and
+	 * encrypted in place) when the TX process next runs.
+	 */
+	tls->tx_data = iob_disown ( iobuf );
+	tls_tx_resume ( tls );
+
  done:
 	free_iob ( iobuf );
 	return rc;
 }
 
+/**
+ * Identify negotiated application-layer protocol
+ *
+ * @v tls		TLS connection
+ * @ret protocol	Protocol name, or NULL if not negotiated
+ */
+static const char * tls_plainstream_protocol ( struct tls_connection *tls ) {
+
+	/* Protocol is not known until we are ready to accept data */
+	if ( ! tls_ready ( tls ) )
+		return NULL;
+
+	return tls->protocol;
+}
+
 /** TLS plaintext stream interface operations */
 static struct interface_operation tls_plainstream_ops[] = {
 	INTF_OP ( xfer_deliver, struct tls_connection *,
 		  tls_plainstream_deliver ),
 	INTF_OP ( xfer_window, struct tls_connection *,
 		  tls_plainstream_window ),
+	INTF_OP ( xfer_alloc_iob, struct tls_connection *,
+		  tls_plainstream_alloc_iob ),
+	INTF_OP ( tls_protocol, struct tls_connection *,
+		  tls_plainstream_protocol ),
 	INTF_OP ( intf_close, struct tls_connection *, tls_close ),
 };
 
@@ -2684,6 +3960,13 @@ static struct interface_descriptor tls_validator_desc =
 static void tls_tx_step ( struct tls_connection *tls ) {
 	int rc;
 
+	/* Send any pending application data */
+	if ( ( rc = tls_tx_flush ( tls ) ) != 0 ) {
+		DBGC ( tls, "TLS %p could not send data: %s\n",
+		       tls, strerror ( rc ) );
+		goto err;
+	}
+
 	/* Wait for cipherstream to become ready */
 	if ( ! xfer_window ( &tls->cipherstream ) )
 		return;
@@ -2773,8 +4056,43 @@ static struct process_descriptor tls_process_desc =
  ******************************************************************************
  */
 
-int add_tls ( struct interface *xfer, const char *name,
-	      struct interface **next ) {
+/**
+ * Identify negotiated application-layer protocol
+ *
+ * @v intf		Interface
+ * @ret protocol	Protocol name, or NULL if not negotiated
+ */
+const char * tls_protocol ( struct interface *intf ) {
+	struct interface *dest;
+	tls_protocol_TYPE ( void * ) *op =
+		intf_get_dest_op ( intf, tls_protocol, &dest );
+	void *object = intf_object ( dest );
+	const char *protocol;
+
+	if ( op ) {
+		protocol = op ( object );
+	} else {
+		/* Default is to have no negotiated protocol */
+		protocol = NULL;
+	}
+
+	intf_put ( dest );
+	return protocol;
+}
+
+/**
+ * Add TLS on an interface, offering application-layer protocols
+ *
+ * @v xfer		Data transfer interface
+ * @v name		Host name
+ * @v alpn		Offered protocols (length-prefixed names), or NULL
+ * @v alpn_len		Length of offered protocols
+ * @v next		Next interface
+ * @ret rc		Return status code
+ */
+int add_tls_alpn ( struct interface *xfer, const char *name,
+		   const void *alpn, size_t alpn_len,
+		   struct interface **next ) {
 	struct tls_connection *tls;
 	int rc;
 
@@ -2800,6 +4118,16 @@ int add_tls ( struct interface *xfer, const char *name,
 	iob_populate ( &tls->rx_header_iobuf, &tls->rx_header, 0,
 		       sizeof ( tls->rx_header ) );
 	INIT_LIST_HEAD ( &tls->rx_data );
+	tls->tx_max_len = TLS_MAX_RECORD_LEN;
+	if ( alpn_len ) {
+		tls->alpn = malloc ( alpn_len );
+		if ( ! tls->alpn ) {
+			rc = -ENOMEM;
+			goto err_alpn;
+		}
+		memcpy ( tls->alpn, alpn, alpn_len );
+		tls->alpn_len = alpn_len;
+	}
 	if ( ( rc = tls_generate_random ( tls, &tls->client_random.random,
 			  ( sizeof ( tls->client_random.random ) ) ) ) != 0 ) {
 		goto err_random;
@@ -2809,8 +4137,11 @@ int add_tls ( struct interface *xfer, const char *name,
 		      ( sizeof ( tls->pre_master_secret.random ) ) ) ) != 0 ) {
 		goto err_random;
 	}
+	if ( ( rc = tls_session ( tls, name ) ) != 0 )
+		goto err_session;
 
 	/* Start negotiation */
+	tls->trace = trace_start ( "tls %s", ( name ? name : "" ) );
 	tls_restart ( tls );
 
 	/* Attach to parent interface, mortalise self, and return */
@@ -2819,12 +4150,28 @@ int add_tls ( struct interface *xfer, const char *name,
 	ref_put ( &tls->refcnt );
 	return 0;
 
+ err_session:
  err_random:
+ err_alpn:
 	ref_put ( &tls->refcnt );
  err_alloc:
 	return rc;
 }
 
+/**
+ * Add TLS on an interface
+ *
+ * @v xfer		Data transfer interface
+ * @v name		Host name
+ * @v next		Next interface
+ * @ret rc		Return status code
+ */
+int add_tls ( struct interface *xfer, const char *name,
+	      struct interface **next ) {
+
+	return add_tls_alpn ( xfer, name, NULL, 0, next );
+}
+
 /* Drag in objects via add_tls() */
 REQUIRING_SYMBOL ( add_tls );
 
@@ -10,6 +10,7 @@
 #include <ipxe/open.h>
 #include <ipxe/uri.h>
 #include <ipxe/netdevice.h>
+#include <ipxe/init.h>
 #include <ipxe/udp.h>
 
 /** @file
@@ -26,7 +27,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 struct udp_connection {
 	/** Reference counter */
 	struct refcnt refcnt;
-	/** List of UDP connections */
+	/** List of UDP connections within hash bucket */
 	struct list_head list;
 
 	/** Data transfer interface */
@@ -39,30 +40,62 @@ struct udp_connection {
 };
 
 /**
- * List of registered UDP connections
+ * List of registered UDP connections, hashed by local port
+ *
+ * Connections with no local port (i.e. promiscuous connections) are
+ * held in the bucket corresponding to port zero.
  */
-static LIST_HEAD ( udp_conns );
+static struct list_head udp_hash[UDP_HASH_BUCKETS];
 
 /* Forward declatations */
 static struct interface_descriptor udp_xfer_desc;
 struct tcpip_protocol udp_protocol __tcpip_protocol;
 
 /**
- * Check if local UDP port is available
+ * Get hash bucket for local UDP port
+ *
+ * @v port		Local port number (in network-endian order)
+ * @ret bucket		Hash bucket
+ */
+static inline __attribute__ (( always_inline )) struct list_head *
+udp_bucket ( uint16_t port ) {
+
+	return &udp_hash[ ntohs ( port ) & ( UDP_HASH_BUCKETS - 1 ) ];
+}
+
+/**
+ * Check if local UDP port is available within a scope
  *
  * @v port		Local port number
+ * @v scope_id		Network device index, or zero for all devices
  * @ret port		Local port number, or negative error
+ *
+ * Connections bound to different network devices may share the same
+ * local port.
  */
-static int udp_port_available ( int port ) {
+static int udp_port_available_scope ( int port, unsigned int scope_id ) {
 	struct udp_connection *udp;
 
-	list_for_each_entry ( udp, &udp_conns, list ) {
-		if ( udp->local.st_port == htons ( port ) )
+	list_for_each_entry ( udp, udp_bucket ( htons ( port ) ), list ) {
+		if ( ( udp->local.st_port == htons ( port ) ) &&
+		     ( ( scope_id == 0 ) || ( udp->local.st_scope_id == 0 ) ||
+		       ( udp->local.st_scope_id == scope_id ) ) )
 			return -EADDRINUSE;
 	}
 	return port;
 }
 
+/**
+ * Check if local UDP port is available
+ *
+ * @v port		Local port number
+ * @ret port		Local port number, or negative error
+ */
+static int udp_port_available ( int port ) {
+
+	return udp_port_available_scope ( port, 0 );
+}
+
 /**
  * Open a UDP connection
  *
@@ -93,9 +126,18 @@ static int udp_open_common ( struct interface *xfer,
 	if ( st_local )
 		memcpy ( &udp->local, st_local, sizeof ( udp->local ) );
 
-	/* Bind to local port */
+	/* Bind to local port.  An explicit local port bound to a
+	 * specific network device may be shared with connections
+	 * bound to other network devices.
+	 */
 	if ( ! promisc ) {
-		port = tcpip_bind ( st_local, udp_port_available );
+		if ( st_local && st_local->st_port && st_local->st_scope_id ) {
+			port = ntohs ( st_local->st_port );
+			port = udp_port_available_scope ( port,
+							  st_local->st_scope_id );
+		} else {
+			port = tcpip_bind ( st_local, udp_port_available );
+		}
 		if ( port < 0 ) {
 			rc = port;
 			DBGC ( udp, "UDP %p could not bind: %s\n",
@@ -111,7 +153,7 @@ static int udp_open_common ( struct interface *xfer,
 	 * list and return
 	 */
 	intf_plug_plug ( &udp->xfer, xfer );
-	list_add ( &udp->list, &udp_conns );
+	list_add ( &udp->list, udp_bucket ( udp->local.st_port ) );
 	return 0;
 
  err:
@@ -219,20 +261,26 @@ static int udp_tx ( struct udp_connection *udp, struct io_buffer *iobuf,
 }
 
 /**
- * Identify UDP connection by local address
+ * Identify UDP connection by local address within hash bucket
  *
  * @v local		Local address
+ * @v netdev		Network device
+ * @v port		Local port number (in network-endian order)
  * @ret udp		UDP connection, or NULL
  */
-static struct udp_connection * udp_demux ( struct sockaddr_tcpip *local ) {
+static struct udp_connection * udp_demux_bucket ( struct sockaddr_tcpip *local,
+						  struct net_device *netdev,
+						  uint16_t port ) {
 	static const struct sockaddr_tcpip empty_sockaddr = { .pad = { 0, } };
 	struct udp_connection *udp;
 
-	list_for_each_entry ( udp, &udp_conns, list ) {
+	list_for_each_entry ( udp, udp_bucket ( port ), list ) {
 		if ( ( ( udp->local.st_family == local->st_family ) ||
 		       ( udp->local.st_family == 0 ) ) &&
-		     ( ( udp->local.st_port == local->st_port ) ||
-		       ( udp->local.st_port == 0 ) ) &&
+		     ( udp->local.st_port == port ) &&
+		     ( ( udp->local.st_scope_id == 0 ) ||
+		       ( netdev &&
+			 ( udp->local.st_scope_id == netdev->index ) ) ) &&
 		     ( ( memcmp ( udp->local.pad, local->pad,
 				  sizeof ( udp->local.pad ) ) == 0 ) ||
 		       ( memcmp ( udp->local.pad, empty_sockaddr.pad,
@@ -243,6 +291,28 @@ static struct udp_connection * udp_demux ( struct sockaddr_tcpip *local ) {
 	return NULL;
 }
 
+/**
+ * Identify UDP connection by local address
+ *
+ * @v local		Local address
+ * @v netdev		Network device
+ * @ret udp		UDP connection, or NULL
+ *
+ * Connections bound to the specific local port take precedence over
+ * connections with no local port.
+ */
+static struct udp_connection * udp_demux ( struct sockaddr_tcpip *local,
+					   struct net_device *netdev ) {
+	struct udp_connection *udp;
+
+	/* Try connections bound to this local port */
+	if ( ( udp = udp_demux_bucket ( local, netdev, local->st_port ) ) )
+		return udp;
+
+	/* Try connections with no local port */
+	return udp_demux_bucket ( local, netdev, 0 );
+}
+
 /**
  * Process a received packet
  *
@@ -254,7 +324,7 @@ static struct udp_connection * udp_demux ( struct sockaddr_tcpip *local ) {
  * @ret rc		Return status code
  */
 static int udp_rx ( struct io_buffer *iobuf,
-		    struct net_device *netdev __unused,
+		    struct net_device *netdev,
 		    struct sockaddr_tcpip *st_src,
 		    struct sockaddr_tcpip *st_dest, uint16_t pshdr_csum ) {
 	struct udp_header *udphdr = iobuf->data;
@@ -285,7 +355,7 @@ static int udp_rx ( struct io_buffer *iobuf,
 		rc = -EINVAL;
 		goto done;
 	}
-	if ( udphdr->chksum ) {
+	if ( udphdr->chksum && ! ( iobuf->flags & IOB_CSUM_VERIFIED ) ) {
 		csum = tcpip_continue_chksum ( pshdr_csum, iobuf->data, ulen );
 		if ( csum != 0 ) {
 			DBG ( "UDP checksum incorrect (is %04x including "
@@ -298,7 +368,7 @@ static int udp_rx ( struct io_buffer *iobuf,
 	/* Parse parameters from header and strip header */
 	st_src->st_port = udphdr->src;
 	st_dest->st_port = udphdr->dest;
-	udp = udp_demux ( st_dest );
+	udp = udp_demux ( st_dest, netdev );
 	iob_unput ( iobuf, ( iob_len ( iobuf ) - ulen ) );
 	iob_pull ( iobuf, sizeof ( *udphdr ) );
 
@@ -318,6 +388,7 @@ static int udp_rx ( struct io_buffer *iobuf,
 	memset ( &meta, 0, sizeof ( meta ) );
 	meta.src = ( struct sockaddr * ) st_src;
 	meta.dest = ( struct sockaddr * ) st_dest;
+	meta.netdev = netdev;
 	rc = xfer_deliver ( &udp->xfer, iob_disown ( iobuf ), &meta );
 
  done:
@@ -439,3 +510,20 @@ struct uri_opener udp_uri_opener __uri_opener = {
 	.scheme		= "udp",
 	.open		= udp_open_uri,
 };
+
+/**
+ * Initialise UDP
+ *
+ */
+static void udp_init ( void ) {
+	unsigned int i;
+
+	/* Initialise connection hash buckets */
+	for ( i = 0 ; i < UDP_HASH_BUCKETS ; i++ )
+		INIT_LIST_HEAD ( &udp_hash[i] );
+}
+
+/** UDP initialisation function */
+struct init_fn udp_init_fn __init_fn ( INIT_NORMAL ) = {
+	.initialise = udp_init,
+};
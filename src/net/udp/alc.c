@@ -0,0 +1,1065 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <byteswap.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/list.h>
+#include <ipxe/xfer.h>
+#include <ipxe/xferbuf.h>
+#include <ipxe/open.h>
+#include <ipxe/uri.h>
+#include <ipxe/tcpip.h>
+#include <ipxe/timer.h>
+#include <ipxe/retry.h>
+#include <ipxe/rsfec.h>
+
+/** @file
+ *
+ * Asynchronous Layered Coding (ALC) multicast file reception
+ *
+ * This receives a single object from an ALC session (RFC 5775), as
+ * used by FLUTE and similar multicast file delivery protocols.  Only
+ * the Reed-Solomon FEC scheme for GF(2^8) (FEC Encoding ID 5, RFC
+ * 5510) is supported.  Each packet carries:
+ *
+ *  LCT header (RFC 5651) with the codepoint set to the FEC Encoding
+ *  ID, optionally including an EXT_FTI header extension carrying the
+ *  FEC Object Transmission Information.
+ *
+ *  FEC Payload ID: 24-bit source block number and 8-bit encoding
+ *  symbol ID.
+ *
+ *  A single encoding symbol.
+ *
+ * No File Delivery Table is parsed.  The receiver locks on to the
+ * first object (other than the FLUTE FDT object with TOI 0) for
+ * which it receives an EXT_FTI header extension, and writes source
+ * symbols directly into the data transfer buffer as they arrive.
+ * Repair symbols are retained only for incomplete blocks, and are
+ * used to reconstruct any missing source symbols in place once
+ * enough encoding symbols have been received for a block.
+ *
+ * If the URI specifies a server, then the receiver will request
+ * additional repair symbols whenever the session falls idle or the
+ * sender indicates that it has finished transmitting the object.
+ * This negative acknowledgement (NAK) is a unicast UDP packet
+ * containing:
+ *
+ *  32-bit transport session identifier (TSI)
+ *
+ *  32-bit transport object identifier (TOI)
+ *
+ *  A list of 32-bit entries in the format of an FEC Payload ID, with
+ *  the encoding symbol ID field replaced by the number of additional
+ *  encoding symbols required to complete the block.
+ *
+ * NAKs are delayed by a random backoff period, and any new encoding
+ * symbols received during this period (e.g. in response to another
+ * receiver's NAK) will cause the NAK to be deferred.  A sender that
+ * does not support NAKs may instead simply repeat the transmission
+ * of the object.
+ */
+
+/** Default ALC sender port */
+#define ALC_DEFAULT_PORT 4001
+
+/** Default ALC multicast IP address */
+#define ALC_DEFAULT_MULTICAST_IP \
+	( ( 239 << 24 ) | ( 255 << 16 ) | ( 1 << 8 ) | ( 3 << 0 ) )
+
+/** Default ALC multicast port */
+#define ALC_DEFAULT_MULTICAST_PORT 4001
+
+/** LCT version number */
+#define LCT_VERSION 1
+
+/** LCT header extension type for FEC Object Transmission Information */
+#define LCT_EXT_FTI 64
+
+/** Reed-Solomon FEC Encoding ID for GF(2^8) */
+#define ALC_FEC_RS8 5
+
+/** ALC idle timeout
+ *
+ * A NAK will be sent if no new encoding symbols are received within
+ * this period.
+ */
+#define ALC_IDLE_TIMEOUT ( 1 * TICKS_PER_SEC )
+
+/** Maximum ALC retry timeout
+ *
+ * The reception will be abandoned once the retry timeout backs off
+ * beyond this value without any new encoding symbols having been
+ * received.
+ */
+#define ALC_MAX_TIMEOUT ( 30 * TICKS_PER_SEC )
+
+/** Maximum ALC NAK backoff period after the sender closes the object */
+#define ALC_NAK_BACKOFF ( TICKS_PER_SEC / 2 )
+
+/** Maximum number of blocks to request per NAK
+ *
+ * This keeps NAKs well within a single unfragmented datagram.
+ */
+#define ALC_MAX_NAK_BLOCKS 128
+
+/** An LCT header */
+struct lct_header {
+	/** Version, congestion control flag, and protocol-specific
+	 * indication
+	 */
+	uint8_t version;
+	/** Field lengths and close flags */
+	uint8_t flags;
+	/** Header length (in 32-bit words) */
+	uint8_t len;
+	/** Codepoint */
+	uint8_t codepoint;
+} __attribute__ (( packed ));
+
+/** LCT header version */
+#define LCT_VERSION_V( version ) ( (version) >> 4 )
+
+/** LCT congestion control information length (in 32-bit words) */
+#define LCT_VERSION_C( version ) ( ( ( (version) >> 2 ) & 0x03 ) + 1 )
+
+/** LCT transport session identifier length (in 16-bit units) */
+#define LCT_FLAGS_TSI( flags ) \
+	( ( ( (flags) >> 6 ) & 0x02 ) + ( ( (flags) >> 4 ) & 0x01 ) )
+
+/** LCT transport object identifier length (in 16-bit units) */
+#define LCT_FLAGS_TOI( flags ) \
+	( ( ( (flags) >> 4 ) & 0x06 ) + ( ( (flags) >> 4 ) & 0x01 ) )
+
+/** LCT close session flag */
+#define LCT_FLAGS_CLOSE_SESSION 0x02
+
+/** LCT close object flag */
+#define LCT_FLAGS_CLOSE_OBJECT 0x01
+
+/** An EXT_FTI header extension for FEC Encoding ID 5 */
+struct lct_ext_fti {
+	/** Header extension type */
+	uint8_t type;
+	/** Header extension length (in 32-bit words) */
+	uint8_t len;
+	/** Transfer length (high 16 bits) */
+	uint16_t len_hi;
+	/** Transfer length (low 32 bits) */
+	uint32_t len_lo;
+	/** Finite field size parameter */
+	uint8_t m;
+	/** Number of encoding symbols per packet */
+	uint8_t g;
+	/** Encoding symbol length */
+	uint16_t symlen;
+	/** Maximum source block length */
+	uint16_t max_k;
+	/** Maximum number of encoding symbols */
+	uint16_t max_n;
+} __attribute__ (( packed ));
+
+/** FEC Payload ID source block number */
+#define ALC_SBN( id ) ( (id) >> 8 )
+
+/** FEC Payload ID encoding symbol ID */
+#define ALC_ESI( id ) ( (id) & 0xff )
+
+/** Construct FEC Payload ID */
+#define ALC_ID( sbn, esi ) ( ( (sbn) << 8 ) | (esi) )
+
+/** An ALC NAK header */
+struct alc_nak {
+	/** Transport session identifier */
+	uint32_t tsi;
+	/** Transport object identifier */
+	uint32_t toi;
+	/** Requested blocks */
+	uint32_t block[0];
+} __attribute__ (( packed ));
+
+/** An ALC source block */
+struct alc_block {
+	/** Received encoding symbol bitmap */
+	uint8_t received[ ( RSFEC_MAX_N + 7 ) / 8 ];
+	/** Number of distinct encoding symbols received */
+	uint8_t count;
+	/** Block is complete */
+	uint8_t complete;
+	/** Retained repair symbols
+	 *
+	 * Each repair symbol is retained as an I/O buffer with the
+	 * encoding symbol ID as the first byte.
+	 */
+	struct list_head repairs;
+};
+
+/** An ALC request */
+struct alc_request {
+	/** Reference counter */
+	struct refcnt refcnt;
+
+	/** Data transfer interface */
+	struct interface xfer;
+	/** Unicast socket */
+	struct interface socket;
+	/** Multicast socket */
+	struct interface mc_socket;
+
+	/** Retry timer */
+	struct retry_timer timer;
+	/** NAKs may be sent to the sender */
+	int nak;
+	/** Sender has closed the object since the last new symbol */
+	int closing;
+
+	/** Object has been identified */
+	int locked;
+	/** Transport session identifier */
+	uint64_t tsi;
+	/** Transport object identifier */
+	uint64_t toi;
+	/** FEC Object Transmission Information */
+	struct lct_ext_fti fti;
+
+	/** Transfer length */
+	uint64_t len;
+	/** Encoding symbol length */
+	size_t symlen;
+	/** Number of source blocks */
+	unsigned long blocks;
+	/** Number of larger source blocks */
+	unsigned long large;
+	/** Larger and smaller source block erasure codes */
+	struct rsfec_code code[2];
+	/** Source blocks */
+	struct alc_block *block;
+	/** Number of incomplete source blocks */
+	unsigned long remaining;
+
+	/** Number of encoding symbols received */
+	unsigned long received;
+	/** Number of blocks reconstructed using repair symbols */
+	unsigned long repaired;
+	/** Number of NAKs sent */
+	unsigned long naks;
+};
+
+/**
+ * Free an ALC request
+ *
+ * @v refcnt		Reference counter
+ */
+static void alc_free ( struct refcnt *refcnt ) {
+	struct alc_request *alc =
+		container_of ( refcnt, struct alc_request, refcnt );
+	struct io_buffer *iobuf;
+	struct io_buffer *tmp;
+	unsigned long i;
+
+	if ( alc->block ) {
+		for ( i = 0 ; i < alc->blocks ; i++ ) {
+			list_for_each_entry_safe ( iobuf, tmp,
+						   &alc->block[i].repairs,
+						   list ) {
+				list_del ( &iobuf->list );
+				free_iob ( iobuf );
+			}
+		}
+		free ( alc->block );
+	}
+	rsfec_fini ( &alc->code[0] );
+	rsfec_fini ( &alc->code[1] );
+	free ( alc );
+}
+
+/**
+ * Mark ALC request as complete
+ *
+ * @v alc		ALC request
+ * @v rc		Return status code
+ */
+static void alc_finished ( struct alc_request *alc, int rc ) {
+
+	DBGC ( alc, "ALC %p finished with status code %d (%s)\n",
+	       alc, rc, strerror ( rc ) );
+	DBGC ( alc, "ALC %p received %ld symbols, repaired %ld blocks, sent "
+	       "%ld NAKs\n", alc, alc->received, alc->repaired, alc->naks );
+
+	/* Stop the retry timer */
+	stop_timer ( &alc->timer );
+
+	/* Close all data transfer interfaces */
+	intf_shutdown ( &alc->socket, rc );
+	intf_shutdown ( &alc->mc_socket, rc );
+	intf_shutdown ( &alc->xfer, rc );
+}
+
+/**
+ * Get erasure code for source block
+ *
+ * @v alc		ALC request
+ * @v sbn		Source block number
+ * @ret code		Erasure code
+ */
+static struct rsfec_code * alc_code ( struct alc_request *alc,
+				      unsigned long sbn ) {
+
+	return &alc->code[ ( sbn < alc->large ) ? 0 : 1 ];
+}
+
+/**
+ * Get offset of source symbol
+ *
+ * @v alc		ALC request
+ * @v sbn		Source block number
+ * @v esi		Encoding symbol ID
+ * @v len		Length of source symbol within object to fill in
+ * @ret offset		Offset within object
+ */
+static uint64_t alc_offset ( struct alc_request *alc, unsigned long sbn,
+			     unsigned int esi, size_t *len ) {
+	uint64_t symbol;
+	uint64_t offset;
+
+	/* Calculate source symbol number within object */
+	if ( sbn < alc->large ) {
+		symbol = ( ( ( uint64_t ) sbn ) * alc->code[0].k );
+	} else {
+		symbol = ( ( ( ( uint64_t ) alc->large ) * alc->code[0].k ) +
+			   ( ( ( uint64_t ) ( sbn - alc->large ) ) *
+			     alc->code[1].k ) );
+	}
+	symbol += esi;
+	offset = ( symbol * alc->symlen );
+
+	/* Calculate length (the final source symbol may be short) */
+	assert ( offset < alc->len );
+	*len = alc->symlen;
+	if ( *len > ( alc->len - offset ) )
+		*len = ( alc->len - offset );
+
+	return offset;
+}
+
+/****************************************************************************
+ *
+ * TX datapath
+ *
+ */
+
+/**
+ * Send ALC NAK packet
+ *
+ * @v alc		ALC request
+ * @ret rc		Return status code
+ */
+static int alc_tx_nak ( struct alc_request *alc ) {
+	struct io_buffer *iobuf;
+	struct alc_nak *nak;
+	struct alc_block *block;
+	unsigned long sbn;
+	unsigned int count = 0;
+	unsigned int k;
+
+	/* Do nothing unless we can send NAKs for an identified object */
+	if ( ! ( alc->nak && alc->locked ) )
+		return 0;
+
+	/* Allocate I/O buffer */
+	iobuf = xfer_alloc_iob ( &alc->socket, ( sizeof ( *nak ) +
+						 ( ALC_MAX_NAK_BLOCKS *
+						   sizeof ( nak->block[0] ) )));
+	if ( ! iobuf )
+		return -ENOMEM;
+
+	/* Construct NAK for the first incomplete blocks */
+	nak = iob_put ( iobuf, sizeof ( *nak ) );
+	nak->tsi = htonl ( alc->tsi );
+	nak->toi = htonl ( alc->toi );
+	for ( sbn = 0 ; sbn < alc->blocks ; sbn++ ) {
+		block = &alc->block[sbn];
+		if ( block->complete )
+			continue;
+		if ( count++ >= ALC_MAX_NAK_BLOCKS )
+			break;
+		k = alc_code ( alc, sbn )->k;
+		assert ( block->count < k );
+		nak->block[ count - 1 ] = htonl ( ALC_ID ( sbn, ( k -
+							  block->count ) ) );
+		iob_put ( iobuf, sizeof ( nak->block[0] ) );
+	}
+	DBGC ( alc, "ALC %p transmitting NAK for %ld incomplete blocks\n",
+	       alc, alc->remaining );
+	alc->naks++;
+
+	/* Transmit packet */
+	return xfer_deliver_iob ( &alc->socket, iobuf );
+}
+
+/**
+ * Handle ALC retry timer expiry
+ *
+ * @v timer		Retry timer
+ * @v fail		Failure indicator
+ */
+static void alc_timer_expired ( struct retry_timer *timer, int fail ) {
+	struct alc_request *alc =
+		container_of ( timer, struct alc_request, timer );
+
+	if ( fail ) {
+		/* Terminate reception */
+		alc_finished ( alc, -ETIMEDOUT );
+	} else {
+		/* Request repair symbols */
+		start_timer ( timer );
+		alc_tx_nak ( alc );
+	}
+}
+
+/****************************************************************************
+ *
+ * RX datapath
+ *
+ */
+
+/**
+ * Identify object and allocate source blocks
+ *
+ * @v alc		ALC request
+ * @v tsi		Transport session identifier
+ * @v toi		Transport object identifier
+ * @v fti		FEC Object Transmission Information
+ * @ret rc		Return status code
+ */
+static int alc_lock ( struct alc_request *alc, uint64_t tsi, uint64_t toi,
+		      const struct lct_ext_fti *fti ) {
+	uint64_t symbols;
+	uint64_t blocks;
+	unsigned int max_k;
+	unsigned int max_n;
+	unsigned int k;
+	unsigned int i;
+	int rc;
+
+	/* Parse FEC Object Transmission Information */
+	alc->len = ( ( ( ( uint64_t ) ntohs ( fti->len_hi ) ) << 32 ) |
+		     ntohl ( fti->len_lo ) );
+	alc->symlen = ntohs ( fti->symlen );
+	max_k = ntohs ( fti->max_k );
+	max_n = ntohs ( fti->max_n );
+	if ( ( fti->m != 8 ) || ( fti->g != 1 ) ) {
+		DBGC ( alc, "ALC %p unsupported m=%d G=%d\n",
+		       alc, fti->m, fti->g );
+		return -ENOTSUP;
+	}
+	if ( ( alc->len == 0 ) || ( alc->symlen == 0 ) || ( max_k == 0 ) ||
+	     ( max_k > max_n ) || ( max_n > RSFEC_MAX_N ) ) {
+		DBGC ( alc, "ALC %p invalid L=%lld E=%zd B=%d max_n=%d\n",
+		       alc, ( ( unsigned long long ) alc->len ), alc->symlen,
+		       max_k, max_n );
+		return -EINVAL;
+	}
+
+	/* Partition object into source blocks as per RFC 5052 */
+	symbols = ( ( alc->len + alc->symlen - 1 ) / alc->symlen );
+	blocks = ( ( symbols + max_k - 1 ) / max_k );
+	if ( blocks > ( 1UL << 24 ) ) {
+		DBGC ( alc, "ALC %p object too large\n", alc );
+		return -ERANGE;
+	}
+	alc->blocks = blocks;
+	k = ( symbols / blocks );
+	alc->large = ( symbols - ( k * blocks ) );
+	if ( alc->large &&
+	     ( ( rc = rsfec_init ( &alc->code[0], ( k + 1 ),
+				   ( ( k + 1 ) * max_n / max_k ) ) ) != 0 ) )
+		return rc;
+	if ( ( rc = rsfec_init ( &alc->code[1], k,
+				 ( k * max_n / max_k ) ) ) != 0 )
+		return rc;
+	DBGC ( alc, "ALC %p TSI %lld TOI %lld has L=%lld E=%zd B=%d "
+	       "max_n=%d (%ld blocks)\n", alc, ( ( unsigned long long ) tsi ),
+	       ( ( unsigned long long ) toi ),
+	       ( ( unsigned long long ) alc->len ), alc->symlen, max_k, max_n,
+	       alc->blocks );
+
+	/* Allocate source blocks */
+	alc->block = zalloc ( alc->blocks * sizeof ( alc->block[0] ) );
+	if ( ! alc->block )
+		return -ENOMEM;
+	for ( i = 0 ; i < alc->blocks ; i++ )
+		INIT_LIST_HEAD ( &alc->block[i].repairs );
+	alc->remaining = alc->blocks;
+
+	/* Record object */
+	alc->tsi = tsi;
+	alc->toi = toi;
+	memcpy ( &alc->fti, fti, sizeof ( alc->fti ) );
+	alc->locked = 1;
+
+	/* Notify recipient of file size */
+	xfer_seek ( &alc->xfer, alc->len );
+
+	return 0;
+}
+
+/**
+ * Reconstruct missing source symbols
+ *
+ * @v alc		ALC request
+ * @v sbn		Source block number
+ * @ret rc		Return status code
+ */
+static int alc_repair ( struct alc_request *alc, unsigned long sbn ) {
+	struct alc_block *block = &alc->block[sbn];
+	struct rsfec_code *code = alc_code ( alc, sbn );
+	struct xfer_buffer *xferbuf;
+	struct io_buffer *iobuf;
+	uint8_t *data;
+	void **symbols;
+	unsigned int *esis;
+	unsigned int esi;
+	size_t offset;
+	unsigned int i;
+	size_t len;
+	int rc;
+
+	/* Locate data transfer buffer */
+	xferbuf = xfer_buffer ( &alc->xfer );
+	if ( ! xferbuf ) {
+		DBGC ( alc, "ALC %p cannot repair without a data transfer "
+		       "buffer\n", alc );
+		rc = -ENOTSUP;
+		goto err_xfer_buffer;
+	}
+
+	/* Allocate symbols */
+	data = malloc ( code->k * ( alc->symlen + sizeof ( symbols[0] ) +
+				    sizeof ( esis[0] ) ) );
+	if ( ! data ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	symbols = ( ( void * ) ( data + ( code->k * alc->symlen ) ) );
+	esis = ( ( void * ) &symbols[code->k] );
+
+	/* Gather received source symbols */
+	i = 0;
+	for ( esi = 0 ; esi < code->k ; esi++ ) {
+		if ( ! ( block->received[ esi / 8 ] & ( 1 << ( esi % 8 ) ) ) )
+			continue;
+		symbols[i] = ( data + ( i * alc->symlen ) );
+		esis[i] = esi;
+		offset = alc_offset ( alc, sbn, esi, &len );
+		memset ( ( symbols[i] + len ), 0, ( alc->symlen - len ) );
+		if ( ( rc = xferbuf_read ( xferbuf, offset, symbols[i],
+					   len ) ) != 0 ) {
+			goto err_read;
+		}
+		i++;
+	}
+
+	/* Gather retained repair symbols */
+	list_for_each_entry ( iobuf, &block->repairs, list ) {
+		assert ( i < code->k );
+		symbols[i] = ( data + ( i * alc->symlen ) );
+		esis[i] = *( ( uint8_t * ) iobuf->data );
+		memcpy ( symbols[i], ( iobuf->data + 1 ), alc->symlen );
+		i++;
+	}
+	assert ( i == code->k );
+
+	/* Reconstruct source block */
+	if ( ( rc = rsfec_decode ( code, symbols, esis,
+				   alc->symlen ) ) != 0 ) {
+		DBGC ( alc, "ALC %p could not repair block %ld: %s\n",
+		       alc, sbn, strerror ( rc ) );
+		goto err_decode;
+	}
+
+	/* Write out reconstructed source symbols */
+	for ( esi = 0 ; esi < code->k ; esi++ ) {
+		if ( block->received[ esi / 8 ] & ( 1 << ( esi % 8 ) ) )
+			continue;
+		offset = alc_offset ( alc, sbn, esi, &len );
+		if ( ( rc = xferbuf_write ( xferbuf, offset, symbols[esi],
+					    len ) ) != 0 ) {
+			goto err_write;
+		}
+	}
+	alc->repaired++;
+
+ err_write:
+ err_decode:
+ err_read:
+	free ( data );
+ err_alloc:
+ err_xfer_buffer:
+	return rc;
+}
+
+/**
+ * Complete source block
+ *
+ * @v alc		ALC request
+ * @v sbn		Source block number
+ * @ret rc		Return status code
+ */
+static int alc_complete ( struct alc_request *alc, unsigned long sbn ) {
+	struct alc_block *block = &alc->block[sbn];
+	struct io_buffer *iobuf;
+	struct io_buffer *tmp;
+	int rc = 0;
+
+	/* Reconstruct any missing source symbols */
+	if ( ! list_empty ( &block->repairs ) )
+		rc = alc_repair ( alc, sbn );
+
+	/* Discard retained repair symbols */
+	list_for_each_entry_safe ( iobuf, tmp, &block->repairs, list ) {
+		list_del ( &iobuf->list );
+		free_iob ( iobuf );
+	}
+
+	/* Mark block as complete */
+	block->complete = 1;
+	alc->remaining--;
+
+	return rc;
+}
+
+/**
+ * Receive ALC encoding symbol
+ *
+ * @v alc		ALC request
+ * @v iobuf		I/O buffer
+ * @v id		FEC Payload ID
+ * @ret rc		Return status code
+ */
+static int alc_rx_symbol ( struct alc_request *alc, struct io_buffer *iobuf,
+			   uint32_t id ) {
+	struct xfer_metadata meta;
+	struct alc_block *block;
+	struct rsfec_code *code;
+	unsigned long sbn = ALC_SBN ( id );
+	unsigned int esi = ALC_ESI ( id );
+	uint8_t mask = ( 1 << ( esi % 8 ) );
+	uint8_t *bits;
+	size_t len;
+	int rc;
+
+	/* Sanity checks */
+	if ( sbn >= alc->blocks ) {
+		DBGC ( alc, "ALC %p received out-of-range block %ld\n",
+		       alc, sbn );
+		rc = -EINVAL;
+		goto err_discard;
+	}
+	block = &alc->block[sbn];
+	code = alc_code ( alc, sbn );
+	if ( esi >= code->n ) {
+		DBGC ( alc, "ALC %p received out-of-range symbol %ld:%d\n",
+		       alc, sbn, esi );
+		rc = -EINVAL;
+		goto err_discard;
+	}
+
+	/* Discard duplicate or unneeded symbols */
+	bits = &block->received[ esi / 8 ];
+	if ( block->complete || ( *bits & mask ) ) {
+		free_iob ( iobuf );
+		return 0;
+	}
+
+	/* Restart the idle timer */
+	alc->closing = 0;
+	stop_timer ( &alc->timer );
+	start_timer_fixed ( &alc->timer, ALC_IDLE_TIMEOUT );
+
+	if ( esi < code->k ) {
+
+		/* Write source symbol directly to recipient */
+		memset ( &meta, 0, sizeof ( meta ) );
+		meta.flags = XFER_FL_ABS_OFFSET;
+		meta.offset = alc_offset ( alc, sbn, esi, &len );
+		if ( iob_len ( iobuf ) < len ) {
+			DBGC ( alc, "ALC %p received short symbol %ld:%d\n",
+			       alc, sbn, esi );
+			rc = -EINVAL;
+			goto err_discard;
+		}
+		iob_unput ( iobuf, ( iob_len ( iobuf ) - len ) );
+		if ( ( rc = xfer_deliver ( &alc->xfer, iob_disown ( iobuf ),
+					   &meta ) ) != 0 )
+			return rc;
+
+	} else {
+
+		/* Retain repair symbol (including encoding symbol ID) */
+		if ( iob_len ( iobuf ) != alc->symlen ) {
+			DBGC ( alc, "ALC %p received bad repair symbol "
+			       "%ld:%d\n", alc, sbn, esi );
+			rc = -EINVAL;
+			goto err_discard;
+		}
+		*( ( uint8_t * ) iob_push ( iobuf, 1 ) ) = esi;
+		list_add_tail ( &iobuf->list, &block->repairs );
+	}
+
+	/* Record symbol as received */
+	*bits |= mask;
+	alc->received++;
+
+	/* Complete block if we now have sufficient symbols */
+	if ( ++block->count == code->k ) {
+		if ( ( rc = alc_complete ( alc, sbn ) ) != 0 ) {
+			alc_finished ( alc, rc );
+			return rc;
+		}
+		if ( ! alc->remaining )
+			alc_finished ( alc, 0 );
+	}
+
+	return 0;
+
+ err_discard:
+	free_iob ( iobuf );
+	return rc;
+}
+
+/**
+ * Read big-endian variable-length field from LCT header
+ *
+ * @v data		Field
+ * @v len		Length of field (in 16-bit units)
+ * @ret value		Field value
+ */
+static uint64_t alc_field ( const uint8_t *data, unsigned int len ) {
+	uint64_t value = 0;
+
+	for ( len *= 2 ; len-- ; )
+		value = ( ( value << 8 ) | *(data++) );
+	return value;
+}
+
+/**
+ * Receive ALC packet
+ *
+ * @v alc		ALC request
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int alc_mc_socket_deliver ( struct alc_request *alc,
+				   struct io_buffer *iobuf,
+				   struct xfer_metadata *meta __unused ) {
+	const struct lct_header *lct = iobuf->data;
+	const struct lct_ext_fti *fti = NULL;
+	const uint8_t *ext;
+	const uint8_t *data;
+	unsigned int tsi_len;
+	unsigned int toi_len;
+	uint64_t tsi;
+	uint64_t toi;
+	uint32_t id;
+	size_t hdr_len;
+	size_t ext_len;
+	size_t offset;
+	int rc;
+
+	/* Sanity checks */
+	if ( ( iob_len ( iobuf ) < sizeof ( *lct ) ) ||
+	     ( LCT_VERSION_V ( lct->version ) != LCT_VERSION ) ) {
+		DBGC ( alc, "ALC %p received malformed packet\n", alc );
+		rc = -EINVAL;
+		goto err_discard;
+	}
+	hdr_len = ( lct->len * 4 );
+	if ( iob_len ( iobuf ) < ( hdr_len + sizeof ( id ) ) ) {
+		DBGC ( alc, "ALC %p received underlength packet\n", alc );
+		rc = -EINVAL;
+		goto err_discard;
+	}
+	if ( lct->codepoint != ALC_FEC_RS8 ) {
+		DBGC ( alc, "ALC %p unsupported FEC Encoding ID %d\n",
+		       alc, lct->codepoint );
+		rc = -ENOTSUP;
+		goto err_discard;
+	}
+
+	/* Parse transport session and object identifiers */
+	data = iobuf->data;
+	offset = ( sizeof ( *lct ) + ( LCT_VERSION_C ( lct->version ) * 4 ) );
+	tsi_len = LCT_FLAGS_TSI ( lct->flags );
+	toi_len = LCT_FLAGS_TOI ( lct->flags );
+	if ( ( toi_len > 4 ) ||
+	     ( ( offset + ( 2 * ( tsi_len + toi_len ) ) ) > hdr_len ) ) {
+		DBGC ( alc, "ALC %p received unsupported LCT header\n", alc );
+		rc = -ENOTSUP;
+		goto err_discard;
+	}
+	tsi = alc_field ( &data[offset], tsi_len );
+	offset += ( 2 * tsi_len );
+	toi = alc_field ( &data[offset], toi_len );
+	offset += ( 2 * toi_len );
+
+	/* Parse header extensions */
+	while ( offset < hdr_len ) {
+		ext = &data[offset];
+		ext_len = ( ( ext[0] < 128 ) ? ( ext[1] * 4 ) : 4 );
+		if ( ( ext_len == 0 ) || ( ( offset + ext_len ) > hdr_len ) ) {
+			DBGC ( alc, "ALC %p received malformed header "
+			       "extension\n", alc );
+			rc = -EINVAL;
+			goto err_discard;
+		}
+		if ( ( ext[0] == LCT_EXT_FTI ) &&
+		     ( ext_len >= sizeof ( *fti ) ) ) {
+			fti = ( ( const void * ) ext );
+		}
+		offset += ext_len;
+	}
+
+	/* Identify object, if applicable */
+	rc = 0;
+	if ( ! alc->locked ) {
+		if ( ! ( toi && fti ) )
+			goto discard;
+		if ( ( rc = alc_lock ( alc, tsi, toi, fti ) ) != 0 ) {
+			alc_finished ( alc, rc );
+			goto err_discard;
+		}
+	}
+
+	/* Ignore packets for other sessions and objects */
+	if ( ( tsi != alc->tsi ) || ( toi != alc->toi ) )
+		goto discard;
+	if ( fti && ( memcmp ( fti, &alc->fti, sizeof ( *fti ) ) != 0 ) ) {
+		DBGC ( alc, "ALC %p ignoring changed transmission "
+		       "information\n", alc );
+		goto discard;
+	}
+
+	/* Schedule a NAK if the sender has closed the object */
+	if ( ( lct->flags & ( LCT_FLAGS_CLOSE_SESSION |
+			      LCT_FLAGS_CLOSE_OBJECT ) ) &&
+	     alc->nak && ( ! alc->closing ) ) {
+		alc->closing = 1;
+		stop_timer ( &alc->timer );
+		start_timer_fixed ( &alc->timer,
+				    ( ( random() % ALC_NAK_BACKOFF ) + 1 ) );
+	}
+
+	/* Strip headers and receive encoding symbol */
+	id = ntohl ( *( ( uint32_t * ) &data[hdr_len] ) );
+	iob_pull ( iobuf, ( hdr_len + sizeof ( id ) ) );
+	if ( ! iob_len ( iobuf ) )
+		goto discard;
+	return alc_rx_symbol ( alc, iobuf, id );
+
+ err_discard:
+ discard:
+	free_iob ( iobuf );
+	return rc;
+}
+
+/**
+ * Receive ALC unicast packet
+ *
+ * @v alc		ALC request
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int alc_socket_deliver ( struct alc_request *alc,
+				struct io_buffer *iobuf,
+				struct xfer_metadata *meta ) {
+
+	/* Treat unicast packets in the same way as multicast packets */
+	return alc_mc_socket_deliver ( alc, iobuf, meta );
+}
+
+/** ALC unicast socket interface operations */
+static struct interface_operation alc_socket_operations[] = {
+	INTF_OP ( xfer_deliver, struct alc_request *, alc_socket_deliver ),
+	INTF_OP ( intf_close, struct alc_request *, alc_finished ),
+};
+
+/** ALC unicast socket interface descriptor */
+static struct interface_descriptor alc_socket_desc =
+	INTF_DESC ( struct alc_request, socket, alc_socket_operations );
+
+/** ALC multicast socket interface operations */
+static struct interface_operation alc_mc_socket_operations[] = {
+	INTF_OP ( xfer_deliver, struct alc_request *, alc_mc_socket_deliver ),
+	INTF_OP ( intf_close, struct alc_request *, alc_finished ),
+};
+
+/** ALC multicast socket interface descriptor */
+static struct interface_descriptor alc_mc_socket_desc =
+	INTF_DESC ( struct alc_request, mc_socket, alc_mc_socket_operations );
+
+/****************************************************************************
+ *
+ * Data transfer interface
+ *
+ */
+
+/** ALC data transfer interface operations */
+static struct interface_operation alc_xfer_operations[] = {
+	INTF_OP ( intf_close, struct alc_request *, alc_finished ),
+};
+
+/** ALC data transfer interface descriptor */
+static struct interface_descriptor alc_xfer_desc =
+	INTF_DESC ( struct alc_request, xfer, alc_xfer_operations );
+
+/**
+ * Parse ALC URI multicast address
+ *
+ * @v alc		ALC request
+ * @v path		Path portion of x-alc:// URI
+ * @v address		Socket address to fill in
+ * @ret rc		Return status code
+ */
+static int alc_parse_multicast_address ( struct alc_request *alc,
+					 const char *path,
+					 struct sockaddr_in *address ) {
+	char path_dup[ strlen ( path ) /* no +1 */ ];
+	struct in_addr addr;
+	char *sep;
+	char *end;
+
+	/* Create temporary copy of path, minus the leading '/' */
+	assert ( *path == '/' );
+	memcpy ( path_dup, ( path + 1 ) , sizeof ( path_dup ) );
+
+	/* Parse port, if present */
+	sep = strchr ( path_dup, ':' );
+	if ( sep ) {
+		*(sep++) = '\0';
+		address->sin_port = htons ( strtoul ( sep, &end, 0 ) );
+		if ( *end != '\0' ) {
+			DBGC ( alc, "ALC %p invalid multicast port \"%s\"\n",
+			       alc, sep );
+			return -EINVAL;
+		}
+	}
+
+	/* Parse address */
+	if ( inet_aton ( path_dup, &addr ) == 0 ) {
+		DBGC ( alc, "ALC %p invalid multicast address \"%s\"\n",
+		       alc, path_dup );
+		return -EINVAL;
+	}
+	address->sin_addr = addr;
+
+	return 0;
+}
+
+/**
+ * Initiate an ALC request
+ *
+ * @v xfer		Data transfer interface
+ * @v uri		Uniform Resource Identifier
+ * @ret rc		Return status code
+ */
+static int alc_open ( struct interface *xfer, struct uri *uri ) {
+	static const struct sockaddr_in default_multicast = {
+		.sin_family = AF_INET,
+		.sin_port = htons ( ALC_DEFAULT_MULTICAST_PORT ),
+		.sin_addr = { htonl ( ALC_DEFAULT_MULTICAST_IP ) },
+	};
+	struct alc_request *alc;
+	struct sockaddr_tcpip server;
+	struct sockaddr_in multicast;
+	int rc;
+
+	/* Allocate and populate structure */
+	alc = zalloc ( sizeof ( *alc ) );
+	if ( ! alc )
+		return -ENOMEM;
+	ref_init ( &alc->refcnt, alc_free );
+	intf_init ( &alc->xfer, &alc_xfer_desc, &alc->refcnt );
+	intf_init ( &alc->socket, &alc_socket_desc, &alc->refcnt );
+	intf_init ( &alc->mc_socket, &alc_mc_socket_desc, &alc->refcnt );
+	timer_init ( &alc->timer, alc_timer_expired, &alc->refcnt );
+	set_timer_limits ( &alc->timer, 0, ALC_MAX_TIMEOUT );
+
+	/* Open unicast socket, if applicable */
+	if ( uri->host && uri->host[0] ) {
+		memset ( &server, 0, sizeof ( server ) );
+		server.st_port = htons ( uri_port ( uri, ALC_DEFAULT_PORT ) );
+		if ( ( rc = xfer_open_named_socket ( &alc->socket, SOCK_DGRAM,
+						     ( struct sockaddr * )
+						     &server, uri->host,
+						     NULL ) ) != 0 ) {
+			DBGC ( alc, "ALC %p could not open unicast socket: "
+			       "%s\n", alc, strerror ( rc ) );
+			goto err;
+		}
+		alc->nak = 1;
+	}
+
+	/* Open multicast socket */
+	memcpy ( &multicast, &default_multicast, sizeof ( multicast ) );
+	if ( uri->path && uri->path[0] && uri->path[1] &&
+	     ( ( rc = alc_parse_multicast_address ( alc, uri->path,
+						    &multicast ) ) != 0 ) ) {
+		goto err;
+	}
+	if ( ( rc = xfer_open_socket ( &alc->mc_socket, SOCK_DGRAM,
+				 ( struct sockaddr * ) &multicast,
+				 ( struct sockaddr * ) &multicast ) ) != 0 ) {
+		DBGC ( alc, "ALC %p could not open multicast socket: %s\n",
+		       alc, strerror ( rc ) );
+		goto err;
+	}
+
+	/* Start retry timer */
+	start_timer_fixed ( &alc->timer, ALC_IDLE_TIMEOUT );
+
+	/* Attach to parent interface, mortalise self, and return */
+	intf_plug_plug ( &alc->xfer, xfer );
+	ref_put ( &alc->refcnt );
+	return 0;
+
+ err:
+	alc_finished ( alc, rc );
+	ref_put ( &alc->refcnt );
+	return rc;
+}
+
+/** ALC URI opener */
+struct uri_opener alc_uri_opener __uri_opener = {
+	.scheme	= "x-alc",
+	.open	= alc_open,
+};
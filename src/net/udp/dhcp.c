@@ -114,6 +114,15 @@ const struct setting dhcp_server_setting __setting ( SETTING_MISC,
 	.type = &setting_type_ipv4,
 };
 
+/** ProxyDHCP disable setting */
+const struct setting no_pxedhcp_setting __setting ( SETTING_MISC,
+						    no-pxedhcp ) = {
+	.name = "no-pxedhcp",
+	.description = "Ignore ProxyDHCP",
+	.tag = DHCP_EB_NO_PXEDHCP,
+	.type = &setting_type_uint8,
+};
+
 /**
  * Most recent DHCP transaction ID
  *
@@ -190,6 +199,7 @@ struct dhcp_session_state {
 	uint8_t max_timeout_sec;
 };
 
+static struct dhcp_session_state dhcp_state_reboot;
 static struct dhcp_session_state dhcp_state_discover;
 static struct dhcp_session_state dhcp_state_request;
 static struct dhcp_session_state dhcp_state_proxy;
@@ -219,9 +229,13 @@ struct dhcp_session {
 	struct in_addr server;
 	/** DHCP offer priority */
 	int priority;
+	/** Rapid commit DHCPACK (if applicable) */
+	struct dhcp_packet *rapid_ack;
 
 	/** ProxyDHCP protocol extensions should be ignored */
 	int no_pxedhcp;
+	/** ProxyDHCP protocol extensions are disabled locally */
+	int local_no_pxedhcp;
 	/** ProxyDHCP server */
 	struct in_addr proxy_server;
 	/** ProxyDHCP offer */
@@ -254,6 +268,7 @@ static void dhcp_free ( struct refcnt *refcnt ) {
 		container_of ( refcnt, struct dhcp_session, refcnt );
 
 	netdev_put ( dhcp->netdev );
+	dhcppkt_put ( dhcp->rapid_ack );
 	dhcppkt_put ( dhcp->proxy_offer );
 	free ( dhcp );
 }
@@ -316,12 +331,187 @@ static int dhcp_has_pxeopts ( struct dhcp_packet *dhcppkt ) {
 	return 0;
 }
 
+/**
+ * Accept DHCP lease
+ *
+ * @v dhcp		DHCP session
+ * @v dhcppkt		DHCPACK packet
+ */
+static void dhcp_lease ( struct dhcp_session *dhcp,
+			 struct dhcp_packet *dhcppkt ) {
+	struct settings *parent;
+	struct settings *settings;
+	int rc;
+
+	/* Record assigned address */
+	dhcp->local.sin_addr = dhcp->offer;
+
+	/* Register settings */
+	parent = netdev_settings ( dhcp->netdev );
+	settings = &dhcppkt->settings;
+	if ( ( rc = register_settings ( settings, parent,
+					DHCP_SETTINGS_NAME ) ) != 0 ) {
+		DBGC ( dhcp, "DHCP %p could not register settings: %s\n",
+		       dhcp, strerror ( rc ) );
+		dhcp_finished ( dhcp, rc );
+		return;
+	}
+
+	/* Perform ProxyDHCP if applicable */
+	if ( dhcp->proxy_offer /* Have ProxyDHCP offer */ &&
+	     ( ! dhcp->no_pxedhcp ) /* ProxyDHCP not disabled */ ) {
+		if ( dhcp_has_pxeopts ( dhcp->proxy_offer ) ) {
+			/* PXE options already present; register settings
+			 * without performing a ProxyDHCPREQUEST
+			 */
+			settings = &dhcp->proxy_offer->settings;
+			if ( ( rc = register_settings ( settings, NULL,
+					   PROXYDHCP_SETTINGS_NAME ) ) != 0 ) {
+				DBGC ( dhcp, "DHCP %p could not register "
+				       "proxy settings: %s\n",
+				       dhcp, strerror ( rc ) );
+				dhcp_finished ( dhcp, rc );
+				return;
+			}
+		} else {
+			/* PXE options not present; use a ProxyDHCPREQUEST */
+			dhcp_set_state ( dhcp, &dhcp_state_proxy );
+			return;
+		}
+	}
+
+	/* Terminate DHCP */
+	dhcp_finished ( dhcp, 0 );
+}
+
 /****************************************************************************
  *
  * DHCP state machine
  *
  */
 
+/**
+ * Construct transmitted packet for DHCP init-reboot
+ *
+ * @v dhcp		DHCP session
+ * @v dhcppkt		DHCP packet
+ * @v peer		Destination address
+ */
+static int dhcp_reboot_tx ( struct dhcp_session *dhcp,
+			    struct dhcp_packet *dhcppkt,
+			    struct sockaddr_in *peer ) {
+	int rc;
+
+	DBGC ( dhcp, "DHCP %p DHCPREQUEST (init-reboot) for %s\n",
+	       dhcp, inet_ntoa ( dhcp->offer ) );
+
+	/* Set requested IP address */
+	if ( ( rc = dhcppkt_store ( dhcppkt, DHCP_REQUESTED_ADDRESS,
+				    &dhcp->offer,
+				    sizeof ( dhcp->offer ) ) ) != 0 )
+		return rc;
+
+	/* Set server address */
+	peer->sin_addr.s_addr = INADDR_BROADCAST;
+	peer->sin_port = htons ( BOOTPS_PORT );
+
+	return 0;
+}
+
+/**
+ * Abandon DHCP init-reboot
+ *
+ * @v dhcp		DHCP session
+ */
+static void dhcp_reboot_abandon ( struct dhcp_session *dhcp ) {
+
+	/* Forget previous lease and fall back to DHCP discovery */
+	dhcp->offer.s_addr = 0;
+	dhcp_set_state ( dhcp, &dhcp_state_discover );
+}
+
+/**
+ * Handle received packet during DHCP init-reboot
+ *
+ * @v dhcp		DHCP session
+ * @v dhcppkt		DHCP packet
+ * @v peer		DHCP server address
+ * @v msgtype		DHCP message type
+ * @v server_id		DHCP server ID
+ * @v pseudo_id		DHCP server pseudo-ID
+ */
+static void dhcp_reboot_rx ( struct dhcp_session *dhcp,
+			     struct dhcp_packet *dhcppkt,
+			     struct sockaddr_in *peer, uint8_t msgtype,
+			     struct in_addr server_id,
+			     struct in_addr pseudo_id __unused ) {
+	struct in_addr ip;
+
+	DBGC ( dhcp, "DHCP %p %s from %s:%d", dhcp,
+	       dhcp_msgtype_name ( msgtype ), inet_ntoa ( peer->sin_addr ),
+	       ntohs ( peer->sin_port ) );
+	if ( server_id.s_addr != peer->sin_addr.s_addr )
+		DBGC ( dhcp, " (%s)", inet_ntoa ( server_id ) );
+
+	/* Identify leased IP address */
+	ip = dhcppkt->dhcphdr->yiaddr;
+	if ( ip.s_addr )
+		DBGC ( dhcp, " for %s", inet_ntoa ( ip ) );
+	DBGC ( dhcp, "\n" );
+
+	/* Filter out unacceptable responses */
+	if ( peer->sin_port != htons ( BOOTPS_PORT ) )
+		return;
+
+	/* Fall back to DHCP discovery if previous lease is refused */
+	if ( msgtype == DHCPNAK ) {
+		dhcp_reboot_abandon ( dhcp );
+		return;
+	}
+
+	/* Filter out unacceptable responses */
+	if ( msgtype != DHCPACK )
+		return;
+	if ( ip.s_addr != dhcp->offer.s_addr )
+		return;
+
+	/* Accept lease */
+	dhcp->server = server_id;
+	dhcp_lease ( dhcp, dhcppkt );
+}
+
+/**
+ * Handle timer expiry during DHCP init-reboot
+ *
+ * @v dhcp		DHCP session
+ */
+static void dhcp_reboot_expired ( struct dhcp_session *dhcp ) {
+	unsigned long elapsed = ( currticks() - dhcp->start );
+
+	/* Fall back to DHCP discovery if no server responds, since a
+	 * server with no record of the previous lease will remain
+	 * silent.
+	 */
+	if ( elapsed > DHCP_REBOOT_TIMEOUT_SEC * TICKS_PER_SEC ) {
+		dhcp_reboot_abandon ( dhcp );
+		return;
+	}
+
+	/* Retransmit current packet */
+	dhcp_tx ( dhcp );
+}
+
+/** DHCP init-reboot state operations */
+static struct dhcp_session_state dhcp_state_reboot = {
+	.name			= "init-reboot",
+	.tx			= dhcp_reboot_tx,
+	.rx			= dhcp_reboot_rx,
+	.expired		= dhcp_reboot_expired,
+	.tx_msgtype		= DHCPREQUEST,
+	.min_timeout_sec	= DHCP_REQ_START_TIMEOUT_SEC,
+	.max_timeout_sec	= DHCP_REQ_END_TIMEOUT_SEC,
+};
+
 /**
  * Construct transmitted packet for DHCP discovery
  *
@@ -330,11 +520,17 @@ static int dhcp_has_pxeopts ( struct dhcp_packet *dhcppkt ) {
  * @v peer		Destination address
  */
 static int dhcp_discovery_tx ( struct dhcp_session *dhcp,
-			       struct dhcp_packet *dhcppkt __unused,
+			       struct dhcp_packet *dhcppkt,
 			       struct sockaddr_in *peer ) {
+	int rc;
 
 	DBGC ( dhcp, "DHCP %p DHCPDISCOVER\n", dhcp );
 
+	/* Allow server to respond with an immediate DHCPACK */
+	if ( ( rc = dhcpopt_store_empty ( &dhcppkt->options,
+					  DHCP_RAPID_COMMIT ) ) != 0 )
+		return rc;
+
 	/* Set server address */
 	peer->sin_addr.s_addr = INADDR_BROADCAST;
 	peer->sin_port = htons ( BOOTPS_PORT );
@@ -342,6 +538,23 @@ static int dhcp_discovery_tx ( struct dhcp_session *dhcp,
 	return 0;
 }
 
+/**
+ * Complete DHCP discovery
+ *
+ * @v dhcp		DHCP session
+ */
+static void dhcp_discovery_complete ( struct dhcp_session *dhcp ) {
+
+	/* Accept lease immediately if we have a rapid commit DHCPACK */
+	if ( dhcp->rapid_ack ) {
+		dhcp_lease ( dhcp, dhcp->rapid_ack );
+		return;
+	}
+
+	/* Otherwise, transition to DHCPREQUEST */
+	dhcp_set_state ( dhcp, &dhcp_state_request );
+}
+
 /**
  * Handle received packet during DHCP discovery
  *
@@ -363,6 +576,7 @@ static void dhcp_discovery_rx ( struct dhcp_session *dhcp,
 	int has_pxeclient;
 	int8_t priority = 0;
 	uint8_t no_pxedhcp = 0;
+	int rapid;
 	unsigned long elapsed;
 
 	DBGC ( dhcp, "DHCP %p %s from %s:%d", dhcp,
@@ -400,16 +614,25 @@ static void dhcp_discovery_rx ( struct dhcp_session *dhcp,
 			sizeof ( no_pxedhcp ) );
 	if ( no_pxedhcp )
 		DBGC ( dhcp, " nopxe" );
+
+	/* Identify rapid commit DHCPACK */
+	rapid = ( ( msgtype == DHCPACK ) &&
+		  ( dhcppkt_fetch ( dhcppkt, DHCP_RAPID_COMMIT,
+				    NULL, 0 ) >= 0 ) );
+	if ( rapid )
+		DBGC ( dhcp, " rapid" );
 	DBGC ( dhcp, "\n" );
 
 	/* Select as DHCP offer, if applicable */
 	if ( ip.s_addr && ( peer->sin_port == htons ( BOOTPS_PORT ) ) &&
-	     ( ( msgtype == DHCPOFFER ) || ( ! msgtype /* BOOTP */ ) ) &&
-	     ( priority >= dhcp->priority ) ) {
+	     ( ( msgtype == DHCPOFFER ) || ( ! msgtype /* BOOTP */ ) ||
+	       rapid ) && ( priority >= dhcp->priority ) ) {
 		dhcp->offer = ip;
 		dhcp->server = server_id;
 		dhcp->priority = priority;
-		dhcp->no_pxedhcp = no_pxedhcp;
+		dhcp->no_pxedhcp = ( no_pxedhcp || dhcp->local_no_pxedhcp );
+		dhcppkt_put ( dhcp->rapid_ack );
+		dhcp->rapid_ack = ( rapid ? dhcppkt_get ( dhcppkt ) : NULL );
 	}
 
 	/* Select as ProxyDHCP offer, if applicable */
@@ -427,6 +650,8 @@ static void dhcp_discovery_rx ( struct dhcp_session *dhcp,
 	 *  o  The DHCPOFFER instructs us to ignore ProxyDHCPOFFERs, or
 	 *  o  We have a valid ProxyDHCPOFFER, or
 	 *  o  We have allowed sufficient time for ProxyDHCPOFFERs.
+	 *
+	 * A rapid commit DHCPACK is treated as a DHCPOFFER.
 	 */
 
 	/* If we don't yet have a DHCPOFFER, do nothing */
@@ -439,8 +664,8 @@ static void dhcp_discovery_rx ( struct dhcp_session *dhcp,
 		 ( elapsed > DHCP_DISC_PROXY_TIMEOUT_SEC * TICKS_PER_SEC ) ) )
 		return;
 
-	/* Transition to DHCPREQUEST */
-	dhcp_set_state ( dhcp, &dhcp_state_request );
+	/* Complete discovery */
+	dhcp_discovery_complete ( dhcp );
 }
 
 /**
@@ -465,7 +690,7 @@ static void dhcp_discovery_expired ( struct dhcp_session *dhcp ) {
 	/* Give up waiting for ProxyDHCP before we reach the failure point */
 	if ( dhcp->offer.s_addr &&
 	     ( elapsed > DHCP_DISC_PROXY_TIMEOUT_SEC * TICKS_PER_SEC ) ) {
-		dhcp_set_state ( dhcp, &dhcp_state_request );
+		dhcp_discovery_complete ( dhcp );
 		return;
 	}
 
@@ -535,9 +760,6 @@ static void dhcp_request_rx ( struct dhcp_session *dhcp,
 			      struct in_addr server_id,
 			      struct in_addr pseudo_id ) {
 	struct in_addr ip;
-	struct settings *parent;
-	struct settings *settings;
-	int rc;
 
 	DBGC ( dhcp, "DHCP %p %s from %s:%d", dhcp,
 	       dhcp_msgtype_name ( msgtype ), inet_ntoa ( peer->sin_addr ),
@@ -564,45 +786,8 @@ static void dhcp_request_rx ( struct dhcp_session *dhcp,
 	if ( ip.s_addr != dhcp->offer.s_addr )
 		return;
 
-	/* Record assigned address */
-	dhcp->local.sin_addr = ip;
-
-	/* Register settings */
-	parent = netdev_settings ( dhcp->netdev );
-	settings = &dhcppkt->settings;
-	if ( ( rc = register_settings ( settings, parent,
-					DHCP_SETTINGS_NAME ) ) != 0 ) {
-		DBGC ( dhcp, "DHCP %p could not register settings: %s\n",
-		       dhcp, strerror ( rc ) );
-		dhcp_finished ( dhcp, rc );
-		return;
-	}
-
-	/* Perform ProxyDHCP if applicable */
-	if ( dhcp->proxy_offer /* Have ProxyDHCP offer */ &&
-	     ( ! dhcp->no_pxedhcp ) /* ProxyDHCP not disabled */ ) {
-		if ( dhcp_has_pxeopts ( dhcp->proxy_offer ) ) {
-			/* PXE options already present; register settings
-			 * without performing a ProxyDHCPREQUEST
-			 */
-			settings = &dhcp->proxy_offer->settings;
-			if ( ( rc = register_settings ( settings, NULL,
-					   PROXYDHCP_SETTINGS_NAME ) ) != 0 ) {
-				DBGC ( dhcp, "DHCP %p could not register "
-				       "proxy settings: %s\n",
-				       dhcp, strerror ( rc ) );
-				dhcp_finished ( dhcp, rc );
-				return;
-			}
-		} else {
-			/* PXE options not present; use a ProxyDHCPREQUEST */
-			dhcp_set_state ( dhcp, &dhcp_state_proxy );
-			return;
-		}
-	}
-
-	/* Terminate DHCP */
-	dhcp_finished ( dhcp, 0 );
+	/* Accept lease */
+	dhcp_lease ( dhcp, dhcppkt );
 }
 
 /**
@@ -1323,9 +1508,16 @@ static struct sockaddr dhcp_peer = {
  * Starts DHCP on the specified network device.  If successful, the
  * DHCPACK (and ProxyDHCPACK, if applicable) will be registered as
  * option sources.
+ *
+ * If the network device already has a DHCP lease (e.g. a cached
+ * DHCPACK) and ProxyDHCP is disabled, then the previous address will
+ * be requested directly as per the RFC 2131 INIT-REBOOT state.  An
+ * INIT-REBOOT exchange provides no opportunity to receive ProxyDHCP
+ * offers.
  */
 int start_dhcp ( struct interface *job, struct net_device *netdev ) {
 	struct dhcp_session *dhcp;
+	struct settings *settings;
 	int rc;
 
 	/* Allocate and initialise structure */
@@ -1339,7 +1531,18 @@ int start_dhcp ( struct interface *job, struct net_device *netdev ) {
 	dhcp->netdev = netdev_get ( netdev );
 	dhcp->local.sin_family = AF_INET;
 	dhcp->local.sin_port = htons ( BOOTPC_PORT );
+	dhcp->local.sin_scope_id = netdev->index;
 	dhcp->xid = random();
+	dhcp->local_no_pxedhcp =
+		fetch_uintz_setting ( NULL, &no_pxedhcp_setting );
+
+	/* Identify previous lease, if applicable */
+	settings = find_child_settings ( netdev_settings ( netdev ),
+					 DHCP_SETTINGS_NAME );
+	if ( settings && dhcp->local_no_pxedhcp ) {
+		fetch_ipv4_setting ( settings, &ip_setting, &dhcp->offer );
+		dhcp->no_pxedhcp = 1;
+	}
 
 	/* Store DHCP transaction ID for fakedhcp code */
 	dhcp_last_xid = dhcp->xid;
@@ -1349,8 +1552,14 @@ int start_dhcp ( struct interface *job, struct net_device *netdev ) {
 				  ( struct sockaddr * ) &dhcp->local ) ) != 0 )
 		goto err;
 
-	/* Enter DHCPDISCOVER state */
-	dhcp_set_state ( dhcp, &dhcp_state_discover );
+	/* Enter DHCP init-reboot state if we have a previous lease,
+	 * otherwise enter DHCPDISCOVER state.
+	 */
+	if ( dhcp->offer.s_addr ) {
+		dhcp_set_state ( dhcp, &dhcp_state_reboot );
+	} else {
+		dhcp_set_state ( dhcp, &dhcp_state_discover );
+	}
 
 	/* Attach parent interface, mortalise self, and return */
 	intf_plug_plug ( &dhcp->job, job );
@@ -1449,6 +1658,7 @@ int start_pxebs ( struct interface *job, struct net_device *netdev,
 	fetch_ipv4_setting ( netdev_settings ( netdev ), &ip_setting,
 			     &dhcp->local.sin_addr );
 	dhcp->local.sin_port = htons ( BOOTPC_PORT );
+	dhcp->local.sin_scope_id = netdev->index;
 	dhcp->pxe_type = cpu_to_le16 ( pxe_type );
 
 	/* Construct PXE boot server IP address lists */
@@ -29,6 +29,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <stdio.h>
 #include <ctype.h>
 #include <errno.h>
@@ -39,6 +40,8 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/open.h>
 #include <ipxe/resolv.h>
 #include <ipxe/retry.h>
+#include <ipxe/timer.h>
+#include <ipxe/process.h>
 #include <ipxe/tcpip.h>
 #include <ipxe/settings.h>
 #include <ipxe/features.h>
@@ -436,6 +439,125 @@ static const char * dns_type ( uint16_t type ) {
 	}
 }
 
+/** DNS cache */
+LIST_HEAD ( dns_cache );
+
+/**
+ * Free DNS cache entry
+ *
+ * @v entry		DNS cache entry
+ */
+static void dns_cache_del ( struct dns_cache_entry *entry ) {
+
+	list_del ( &entry->list );
+	free ( entry );
+}
+
+/**
+ * Discard expired DNS cache entries
+ *
+ */
+void dns_cache_expire ( void ) {
+	struct dns_cache_entry *entry;
+	struct dns_cache_entry *tmp;
+	unsigned long now = currticks();
+
+	list_for_each_entry_safe ( entry, tmp, &dns_cache, list ) {
+		if ( ( ( long ) ( entry->expiry - now ) ) <= 0 ) {
+			DBG ( "DNS cache expired %s\n", entry->name );
+			dns_cache_del ( entry );
+		}
+	}
+}
+
+/**
+ * Discard all DNS cache entries
+ *
+ */
+void dns_cache_flush ( void ) {
+	struct dns_cache_entry *entry;
+	struct dns_cache_entry *tmp;
+
+	list_for_each_entry_safe ( entry, tmp, &dns_cache, list )
+		dns_cache_del ( entry );
+}
+
+/**
+ * Find DNS cache entry
+ *
+ * @v name		Name as originally requested
+ * @v qtype		Query type
+ * @ret entry		DNS cache entry, or NULL if not found
+ */
+static struct dns_cache_entry * dns_cache_find ( const char *name,
+						 uint16_t qtype ) {
+	struct dns_cache_entry *entry;
+
+	/* Discard any expired entries */
+	dns_cache_expire();
+
+	/* Search for matching entry */
+	list_for_each_entry ( entry, &dns_cache, list ) {
+		if ( ( entry->qtype == qtype ) &&
+		     ( strcasecmp ( entry->name, name ) == 0 ) )
+			return entry;
+	}
+
+	return NULL;
+}
+
+/**
+ * Add DNS cache entry
+ *
+ * @v name		Name as originally requested
+ * @v qtype		Query type
+ * @v sa		Resolved address, or NULL for a negative entry
+ * @v rc		Status code (zero for a positive entry)
+ * @v ttl		Time to live (in seconds)
+ *
+ * The cache is an optimisation only; failure to allocate an entry is
+ * silently ignored.
+ */
+static void dns_cache_add ( const char *name, uint16_t qtype,
+			    struct sockaddr *sa, int rc, unsigned long ttl ) {
+	struct dns_cache_entry *entry;
+	struct dns_cache_entry *tmp;
+	unsigned int count = 0;
+
+	/* Do not cache records with a zero time to live */
+	if ( ! ttl )
+		return;
+	if ( ttl > DNS_CACHE_MAX_TTL )
+		ttl = DNS_CACHE_MAX_TTL;
+
+	/* Discard any existing entry for this name */
+	entry = dns_cache_find ( name, qtype );
+	if ( entry )
+		dns_cache_del ( entry );
+
+	/* Discard oldest entries to make room for the new entry */
+	list_for_each_entry_safe ( entry, tmp, &dns_cache, list ) {
+		if ( ++count >= DNS_CACHE_MAX )
+			dns_cache_del ( entry );
+	}
+
+	/* Allocate and populate entry */
+	entry = zalloc ( sizeof ( *entry ) + strlen ( name ) + 1 /* NUL */ );
+	if ( ! entry )
+		return;
+	if ( sa )
+		memcpy ( &entry->address, sa, sizeof ( entry->address ) );
+	entry->qtype = qtype;
+	entry->rc = rc;
+	entry->expiry = ( currticks() + ( ttl * TICKS_PER_SEC ) );
+	strcpy ( entry->name, name );
+	DBG ( "DNS cache added %s type %s for %lds\n",
+	      entry->name, dns_type ( qtype ), ttl );
+
+	/* Add to cache */
+	list_add ( &entry->list, &dns_cache );
+}
+
 /** A DNS request */
 struct dns_request {
 	/** Reference counter */
@@ -476,6 +598,51 @@ struct dns_request {
 	struct dns_name search;
 	/** Recursion counter */
 	unsigned int recursion;
+	/** Minimum time to live of records used so far (in seconds) */
+	unsigned long ttl;
+	/** Cached result delivery process */
+	struct process process;
+	/** Cached status code */
+	int rc;
+	/** Name as originally requested */
+	char *request;
+};
+
+/** A DNS request for a single address family within a DNS lookup */
+struct dns_lookup_child {
+	/** Containing DNS lookup */
+	struct dns_lookup *lookup;
+	/** Name resolution interface */
+	struct interface resolv;
+	/** Request is running */
+	int running;
+	/** Request status code */
+	int rc;
+	/** Resolved address */
+	union {
+		struct sockaddr sa;
+		struct sockaddr_tcpip st;
+	} address;
+	/** Resolved address has not yet been reported */
+	int pending;
+	/** Resolved address is routable */
+	int routable;
+};
+
+/** A DNS lookup (for all address families) */
+struct dns_lookup {
+	/** Reference counter */
+	struct refcnt refcnt;
+	/** Name resolution interface */
+	struct interface resolv;
+	/** Request for preferred address family */
+	struct dns_lookup_child primary;
+	/** Request for other address family */
+	struct dns_lookup_child secondary;
+	/** Resolution delay timer */
+	struct retry_timer timer;
+	/** At least one address has been reported */
+	int reported;
 };
 
 /**
@@ -486,8 +653,9 @@ struct dns_request {
  */
 static void dns_done ( struct dns_request *dns, int rc ) {
 
-	/* Stop the retry timer */
+	/* Stop the retry timer and cached result process */
 	stop_timer ( &dns->timer );
+	process_del ( &dns->process );
 
 	/* Shut down interfaces */
 	intf_shutdown ( &dns->socket, rc );
@@ -512,6 +680,44 @@ static void dns_resolved ( struct dns_request *dns ) {
 	dns_done ( dns, 0 );
 }
 
+/**
+ * Record time to live of a resource record
+ *
+ * @v dns		DNS request
+ * @v rr		Resource record
+ */
+static void dns_ttl ( struct dns_request *dns, union dns_rr *rr ) {
+	unsigned long ttl = ntohl ( rr->common.ttl );
+
+	/* Treat values with the most significant bit set as zero, as
+	 * per RFC 2181 section 8.
+	 */
+	if ( ttl & 0x80000000UL )
+		ttl = 0;
+
+	/* Record minimum time to live */
+	if ( ttl < dns->ttl )
+		dns->ttl = ttl;
+}
+
+/**
+ * Deliver cached result
+ *
+ * @v dns		DNS request
+ */
+static void dns_cache_step ( struct dns_request *dns ) {
+
+	if ( dns->rc == 0 ) {
+		dns_resolved ( dns );
+	} else {
+		dns_done ( dns, dns->rc );
+	}
+}
+
+/** Cached result delivery process descriptor */
+static struct process_descriptor dns_cache_process_desc =
+	PROC_DESC_ONCE ( struct dns_request, process, dns_cache_step );
+
 /**
  * Construct DNS question
  *
@@ -723,6 +929,9 @@ static int dns_xfer_deliver ( struct dns_request *dns,
 			memcpy ( &dns->address.sin6.sin6_addr,
 				 &rr->aaaa.in6_addr,
 				 sizeof ( dns->address.sin6.sin6_addr ) );
+			dns_ttl ( dns, rr );
+			dns_cache_add ( dns->request, dns->qtype,
+					&dns->address.sa, 0, dns->ttl );
 			dns_resolved ( dns );
 			rc = 0;
 			goto done;
@@ -738,6 +947,9 @@ static int dns_xfer_deliver ( struct dns_request *dns,
 			}
 			dns->address.sin.sin_family = AF_INET;
 			dns->address.sin.sin_addr = rr->a.in_addr;
+			dns_ttl ( dns, rr );
+			dns_cache_add ( dns->request, dns->qtype,
+					&dns->address.sa, 0, dns->ttl );
 			dns_resolved ( dns );
 			rc = 0;
 			goto done;
@@ -754,6 +966,7 @@ static int dns_xfer_deliver ( struct dns_request *dns,
 			}
 
 			/* Found a CNAME record; update query and recurse */
+			dns_ttl ( dns, rr );
 			buf.offset = ( offset + sizeof ( rr->cname ) );
 			DBGC ( dns, "DNS %p found CNAME %s\n",
 			       dns, dns_name ( &buf ) );
@@ -788,20 +1001,12 @@ static int dns_xfer_deliver ( struct dns_request *dns,
 	switch ( qtype ) {
 
 	case htons ( DNS_TYPE_AAAA ):
-		/* We asked for an AAAA record and got nothing; try
-		 * the A.
-		 */
-		DBGC ( dns, "DNS %p found no AAAA record; trying A\n", dns );
-		dns->question->qtype = htons ( DNS_TYPE_A );
-		dns_send_packet ( dns );
-		rc = 0;
-		goto done;
-
 	case htons ( DNS_TYPE_A ):
-		/* We asked for an A record and got nothing;
+		/* We asked for an AAAA or A record and got nothing;
 		 * try the CNAME.
 		 */
-		DBGC ( dns, "DNS %p found no A record; trying CNAME\n", dns );
+		DBGC ( dns, "DNS %p found no %s record; trying CNAME\n",
+		       dns, dns_type ( qtype ) );
 		dns->question->qtype = htons ( DNS_TYPE_CNAME );
 		dns_send_packet ( dns );
 		rc = 0;
@@ -824,6 +1029,8 @@ static int dns_xfer_deliver ( struct dns_request *dns,
 		if ( dns->search.offset == dns->search.len ) {
 			DBGC ( dns, "DNS %p found no CNAME record\n", dns );
 			rc = -ENXIO_NO_RECORD;
+			dns_cache_add ( dns->request, dns->qtype, NULL, rc,
+					DNS_CACHE_NEGATIVE_TTL );
 			dns_done ( dns, rc );
 			goto done;
 		}
@@ -911,34 +1118,29 @@ static struct interface_descriptor dns_resolv_desc =
 	INTF_DESC ( struct dns_request, resolv, dns_resolv_op );
 
 /**
- * Resolve name using DNS
+ * Start DNS request for a single record type
  *
  * @v resolv		Name resolution interface
  * @v name		Name to resolve
  * @v sa		Socket address to fill in
+ * @v qtype		Address record type
  * @ret rc		Return status code
  */
-static int dns_resolv ( struct interface *resolv,
-			const char *name, struct sockaddr *sa ) {
+static int dns_resolv_type ( struct interface *resolv, const char *name,
+			     struct sockaddr *sa, uint16_t qtype ) {
 	struct dns_request *dns;
+	struct dns_cache_entry *entry;
 	struct dns_header *query;
 	size_t search_len;
 	int name_len;
 	int rc;
 
-	/* Fail immediately if no DNS servers */
-	if ( ! nameserver.sa.sa_family ) {
-		DBG ( "DNS not attempting to resolve \"%s\": "
-		      "no DNS servers\n", name );
-		rc = -ENXIO_NO_NAMESERVER;
-		goto err_no_nameserver;
-	}
-
 	/* Determine whether or not to use search list */
 	search_len = ( strchr ( name, '.' ) ? 0 : dns_search.len );
 
 	/* Allocate DNS structure */
-	dns = zalloc ( sizeof ( *dns ) + search_len );
+	dns = zalloc ( sizeof ( *dns ) + search_len + strlen ( name ) +
+		       1 /* NUL */ );
 	if ( ! dns ) {
 		rc = -ENOMEM;
 		goto err_alloc_dns;
@@ -947,22 +1149,39 @@ static int dns_resolv ( struct interface *resolv,
 	intf_init ( &dns->resolv, &dns_resolv_desc, &dns->refcnt );
 	intf_init ( &dns->socket, &dns_socket_desc, &dns->refcnt );
 	timer_init ( &dns->timer, dns_timer_expired, &dns->refcnt );
+	process_init_stopped ( &dns->process, &dns_cache_process_desc,
+			       &dns->refcnt );
 	memcpy ( &dns->address.sa, sa, sizeof ( dns->address.sa ) );
 	dns->search.data = ( ( ( void * ) dns ) + sizeof ( *dns ) );
 	dns->search.len = search_len;
 	memcpy ( dns->search.data, dns_search.data, search_len );
-
-	/* Determine initial query type */
-	switch ( nameserver.sa.sa_family ) {
-	case AF_INET:
-		dns->qtype = htons ( DNS_TYPE_A );
-		break;
-	case AF_INET6:
-		dns->qtype = htons ( DNS_TYPE_AAAA );
-		break;
-	default:
-		rc = -ENOTSUP;
-		goto err_type;
+	dns->request = ( dns->search.data + search_len );
+	strcpy ( dns->request, name );
+	dns->qtype = qtype;
+	dns->ttl = DNS_CACHE_MAX_TTL;
+
+	/* Use cached result, if available */
+	entry = dns_cache_find ( name, qtype );
+	if ( entry ) {
+		DBGC ( dns, "DNS %p using cached result for %s\n",
+		       dns, name );
+		dns->rc = entry->rc;
+		switch ( entry->address.sa.sa_family ) {
+		case AF_INET:
+			dns->address.sin.sin_family = AF_INET;
+			dns->address.sin.sin_addr = entry->address.sin.sin_addr;
+			break;
+		case AF_INET6:
+			dns->address.sin6.sin6_family = AF_INET6;
+			memcpy ( &dns->address.sin6.sin6_addr,
+				 &entry->address.sin6.sin6_addr,
+				 sizeof ( dns->address.sin6.sin6_addr ) );
+			break;
+		default:
+			break;
+		}
+		process_add ( &dns->process );
+		goto attach;
 	}
 
 	/* Construct query */
@@ -993,6 +1212,7 @@ static int dns_resolv ( struct interface *resolv,
 	/* Start timer to trigger first packet */
 	start_timer_nodelay ( &dns->timer );
 
+ attach:
 	/* Attach parent interface, mortalise self, and return */
 	intf_plug_plug ( &dns->resolv, resolv );
 	ref_put ( &dns->refcnt );
@@ -1001,9 +1221,548 @@ static int dns_resolv ( struct interface *resolv,
  err_open_socket:
  err_question:
  err_encode:
- err_type:
 	ref_put ( &dns->refcnt );
  err_alloc_dns:
+	return rc;
+}
+
+/** A DNS request for a single search list suffix within a DNS search */
+struct dns_search_child {
+	/** Containing DNS search */
+	struct dns_search_request *search;
+	/** Name resolution interface */
+	struct interface resolv;
+	/** Request is running */
+	int running;
+	/** Request status code */
+	int rc;
+	/** Resolved address */
+	union {
+		struct sockaddr sa;
+		struct sockaddr_tcpip st;
+	} address;
+	/** Address has been resolved */
+	int resolved;
+};
+
+/** A DNS search (for all search list suffixes) */
+struct dns_search_request {
+	/** Reference counter */
+	struct refcnt refcnt;
+	/** Name resolution interface */
+	struct interface resolv;
+	/** Number of search list suffixes */
+	unsigned int count;
+	/** Requests for each search list suffix, in order of priority */
+	struct dns_search_child child[0];
+};
+
+/**
+ * Close DNS search
+ *
+ * @v search		DNS search
+ * @v rc		Reason for close
+ */
+static void dns_search_close ( struct dns_search_request *search, int rc ) {
+	unsigned int i;
+
+	/* Shut down interfaces */
+	for ( i = 0 ; i < search->count ; i++ )
+		intf_shutdown ( &search->child[i].resolv, rc );
+	intf_shutdown ( &search->resolv, rc );
+}
+
+/**
+ * Report result of DNS search, if known
+ *
+ * @v search		DNS search
+ *
+ * The result is the first address resolved in search list priority
+ * order.  An address resolved via a lower-priority suffix is held
+ * back until all higher-priority requests have failed.
+ */
+static void dns_search_check ( struct dns_search_request *search ) {
+	struct dns_search_child *child;
+	unsigned int i;
+	int rc = -ENXIO_NO_RECORD;
+
+	for ( i = 0 ; i < search->count ; i++ ) {
+		child = &search->child[i];
+
+		/* Report the highest-priority resolved address */
+		if ( child->resolved ) {
+			DBGC ( search, "DNS %p using suffix %d address %s\n",
+			       search, i, sock_ntoa ( &child->address.sa ) );
+			resolv_done ( &search->resolv, &child->address.sa );
+			dns_search_close ( search, 0 );
+			return;
+		}
+
+		/* Wait for any outstanding higher-priority request */
+		if ( child->running )
+			return;
+
+		/* Record most recent failure */
+		if ( child->rc )
+			rc = child->rc;
+	}
+
+	/* All requests have failed */
+	dns_search_close ( search, rc );
+}
+
+/**
+ * Handle address resolved by DNS search request
+ *
+ * @v child		Search list suffix request
+ * @v sa		Completed socket address
+ */
+static void dns_search_resolv_done ( struct dns_search_child *child,
+				     struct sockaddr *sa ) {
+
+	/* Record address.  Only the first address is required. */
+	if ( ! child->resolved ) {
+		memcpy ( &child->address, sa, sizeof ( child->address ) );
+		child->resolved = 1;
+	}
+}
+
+/**
+ * Handle DNS search request completion
+ *
+ * @v child		Search list suffix request
+ * @v rc		Reason for close
+ */
+static void dns_search_child_close ( struct dns_search_child *child,
+				     int rc ) {
+
+	/* Mark request as complete */
+	intf_restart ( &child->resolv, rc );
+	child->running = 0;
+	child->rc = rc;
+
+	/* Report result, if known */
+	dns_search_check ( child->search );
+}
+
+/** DNS search request interface operations */
+static struct interface_operation dns_search_child_op[] = {
+	INTF_OP ( resolv_done, struct dns_search_child *,
+		  dns_search_resolv_done ),
+	INTF_OP ( intf_close, struct dns_search_child *,
+		  dns_search_child_close ),
+};
+
+/** DNS search request interface descriptor */
+static struct interface_descriptor dns_search_child_desc =
+	INTF_DESC ( struct dns_search_child, resolv, dns_search_child_op );
+
+/** DNS search resolver interface operations */
+static struct interface_operation dns_search_resolv_op[] = {
+	INTF_OP ( intf_close, struct dns_search_request *, dns_search_close ),
+};
+
+/** DNS search resolver interface descriptor */
+static struct interface_descriptor dns_search_resolv_desc =
+	INTF_DESC_PASSTHRU ( struct dns_search_request, resolv,
+			     dns_search_resolv_op, child[0].resolv );
+
+/**
+ * Count non-empty names in DNS search list
+ *
+ * @v list		DNS search list
+ * @ret count		Number of names
+ */
+static unsigned int dns_search_count ( struct dns_name *list ) {
+	struct dns_name name;
+	unsigned int count = 0;
+	int offset;
+
+	memcpy ( &name, list, sizeof ( name ) );
+	for ( name.offset = 0 ; name.offset < name.len ;
+	      name.offset = offset ) {
+		offset = dns_skip_search ( &name );
+		if ( offset < 0 )
+			break;
+		count++;
+	}
+	return count;
+}
+
+/**
+ * Start DNS request for a single record type, using the search list
+ *
+ * @v resolv		Name resolution interface
+ * @v name		Name to resolve
+ * @v sa		Socket address to fill in
+ * @v qtype		Address record type
+ * @ret rc		Return status code
+ *
+ * Each candidate name from the search list is queried concurrently,
+ * rather than waiting for each to fail before trying the next.  Each
+ * candidate is a fully qualified name in its own right, and so
+ * positive and negative results are cached per candidate.
+ */
+static int dns_resolv_search ( struct interface *resolv, const char *name,
+			       struct sockaddr *sa, uint16_t qtype ) {
+	struct dns_search_request *search;
+	struct dns_search_child *child;
+	struct dns_name suffix;
+	unsigned int count;
+	unsigned int i;
+	size_t name_len;
+	char *fqdn;
+	int offset;
+	int len;
+	int rc;
+
+	/* Use a single request unless there are multiple candidates */
+	count = ( strchr ( name, '.' ) ? 0 : dns_search_count ( &dns_search ));
+	if ( count <= 1 )
+		return dns_resolv_type ( resolv, name, sa, qtype );
+
+	/* Allocate and initialise structure */
+	search = zalloc ( sizeof ( *search ) +
+			  ( count * sizeof ( search->child[0] ) ) );
+	if ( ! search ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	ref_init ( &search->refcnt, NULL );
+	intf_init ( &search->resolv, &dns_search_resolv_desc,
+		    &search->refcnt );
+	search->count = count;
+	for ( i = 0 ; i < count ; i++ ) {
+		child = &search->child[i];
+		intf_init ( &child->resolv, &dns_search_child_desc,
+			    &search->refcnt );
+		child->search = search;
+		child->running = 1;
+	}
+
+	/* Start a request for each candidate name */
+	memcpy ( &suffix, &dns_search, sizeof ( suffix ) );
+	name_len = strlen ( name );
+	for ( i = 0, suffix.offset = 0 ; i < count ;
+	      i++, suffix.offset = offset ) {
+		child = &search->child[i];
+
+		/* Construct candidate name */
+		offset = dns_skip_search ( &suffix );
+		len = dns_decode ( &suffix, NULL, 0 );
+		if ( ( offset < 0 ) || ( len < 0 ) ) {
+			rc = -EINVAL;
+			goto err_suffix;
+		}
+		fqdn = malloc ( name_len + 1 /* "." */ + len + 1 /* NUL */ );
+		if ( ! fqdn ) {
+			rc = -ENOMEM;
+			goto err_suffix;
+		}
+		memcpy ( fqdn, name, name_len );
+		fqdn[name_len] = '.';
+		dns_decode ( &suffix, ( fqdn + name_len + 1 ), ( len + 1 ) );
+		DBGC ( search, "DNS %p suffix %d is %s\n", search, i, fqdn );
+
+		/* Start request */
+		rc = dns_resolv_type ( &child->resolv, fqdn, sa, qtype );
+		free ( fqdn );
+		if ( rc != 0 )
+			goto err_request;
+	}
+
+	/* Attach parent interface, mortalise self, and return */
+	intf_plug_plug ( &search->resolv, resolv );
+	ref_put ( &search->refcnt );
+	return 0;
+
+ err_request:
+ err_suffix:
+	dns_search_close ( search, rc );
+	ref_put ( &search->refcnt );
+ err_alloc:
+	return rc;
+}
+
+/**
+ * Check if DNS lookup has any outstanding requests
+ *
+ * @v lookup		DNS lookup
+ * @ret running		Lookup has outstanding requests
+ */
+static int dns_lookup_running ( struct dns_lookup *lookup ) {
+
+	return ( lookup->primary.running || lookup->secondary.running );
+}
+
+/**
+ * Report address from DNS lookup
+ *
+ * @v lookup		DNS lookup
+ * @v child		Address family request
+ */
+static void dns_lookup_report ( struct dns_lookup *lookup,
+				struct dns_lookup_child *child ) {
+
+	DBGC ( lookup, "DNS %p reporting %s\n",
+	       lookup, sock_ntoa ( &child->address.sa ) );
+	child->pending = 0;
+	lookup->reported = 1;
+	resolv_done ( &lookup->resolv, &child->address.sa );
+}
+
+/**
+ * Report any pending addresses from DNS lookup
+ *
+ * @v lookup		DNS lookup
+ * @v unroutable	Also report addresses for which we have no route
+ */
+static void dns_lookup_flush ( struct dns_lookup *lookup, int unroutable ) {
+
+	/* Stop resolution delay timer */
+	stop_timer ( &lookup->timer );
+
+	/* Report pending addresses in order of preference */
+	if ( lookup->primary.pending &&
+	     ( lookup->primary.routable || unroutable ) )
+		dns_lookup_report ( lookup, &lookup->primary );
+	if ( lookup->secondary.pending &&
+	     ( lookup->secondary.routable || unroutable ) )
+		dns_lookup_report ( lookup, &lookup->secondary );
+}
+
+/**
+ * Close DNS lookup
+ *
+ * @v lookup		DNS lookup
+ * @v rc		Reason for close
+ */
+static void dns_lookup_close ( struct dns_lookup *lookup, int rc ) {
+
+	/* Stop resolution delay timer */
+	stop_timer ( &lookup->timer );
+
+	/* Shut down interfaces */
+	intf_shutdown ( &lookup->primary.resolv, rc );
+	intf_shutdown ( &lookup->secondary.resolv, rc );
+	intf_shutdown ( &lookup->resolv, rc );
+}
+
+/**
+ * Handle address resolved by DNS request
+ *
+ * @v child		Address family request
+ * @v sa		Completed socket address
+ */
+static void dns_lookup_resolv_done ( struct dns_lookup_child *child,
+				     struct sockaddr *sa ) {
+	struct dns_lookup *lookup = child->lookup;
+
+	/* Record address */
+	memcpy ( &child->address, sa, sizeof ( child->address ) );
+	child->pending = 1;
+
+	/* Defer reporting addresses for which we have no route, in
+	 * case a usable address is found.
+	 */
+	if ( ! tcpip_netdev ( &child->address.st ) ) {
+		DBGC ( lookup, "DNS %p has no route to %s\n",
+		       lookup, sock_ntoa ( &child->address.sa ) );
+		child->routable = 0;
+		return;
+	}
+	child->routable = 1;
+
+	/* Report addresses in the preferred family immediately.
+	 * Report other addresses immediately only if there is no
+	 * outstanding request for the preferred family; otherwise,
+	 * allow a short resolution delay for a preferred address to
+	 * arrive, as described in RFC 8305 section 3.
+	 */
+	if ( ( child == &lookup->primary ) || ( ! lookup->primary.running ) ){
+		dns_lookup_flush ( lookup, 0 );
+	} else {
+		start_timer_fixed ( &lookup->timer, DNS_RESOLUTION_DELAY );
+	}
+}
+
+/**
+ * Handle DNS request completion
+ *
+ * @v child		Address family request
+ * @v rc		Reason for close
+ */
+static void dns_lookup_child_close ( struct dns_lookup_child *child,
+				     int rc ) {
+	struct dns_lookup *lookup = child->lookup;
+	struct dns_lookup_child *other;
+
+	/* Mark request as complete */
+	intf_restart ( &child->resolv, rc );
+	child->running = 0;
+	child->rc = rc;
+
+	/* Report any address waiting for the preferred request */
+	if ( child == &lookup->primary )
+		dns_lookup_flush ( lookup, 0 );
+
+	/* Wait for any outstanding requests */
+	if ( dns_lookup_running ( lookup ) )
+		return;
+
+	/* If no routable address was found, report any address */
+	if ( ! lookup->reported )
+		dns_lookup_flush ( lookup, 1 );
+
+	/* Succeed if any address was reported, otherwise fail with
+	 * the status code for the preferred family (or for the other
+	 * family, if the preferred request did not itself fail).
+	 */
+	if ( lookup->reported ) {
+		rc = 0;
+	} else {
+		other = ( lookup->primary.rc ?
+			  &lookup->primary : &lookup->secondary );
+		rc = ( other->rc ? other->rc : -ENXIO_NO_RECORD );
+	}
+	dns_lookup_close ( lookup, rc );
+}
+
+/**
+ * Handle DNS resolution delay timer expiry
+ *
+ * @v timer		Resolution delay timer
+ * @v fail		Failure indicator
+ */
+static void dns_lookup_expired ( struct retry_timer *timer,
+				 int fail __unused ) {
+	struct dns_lookup *lookup =
+		container_of ( timer, struct dns_lookup, timer );
+
+	DBGC ( lookup, "DNS %p resolution delay expired\n", lookup );
+	dns_lookup_flush ( lookup, 0 );
+}
+
+/** DNS lookup request interface operations */
+static struct interface_operation dns_lookup_child_op[] = {
+	INTF_OP ( resolv_done, struct dns_lookup_child *,
+		  dns_lookup_resolv_done ),
+	INTF_OP ( intf_close, struct dns_lookup_child *,
+		  dns_lookup_child_close ),
+};
+
+/** DNS lookup request interface descriptor */
+static struct interface_descriptor dns_lookup_child_desc =
+	INTF_DESC ( struct dns_lookup_child, resolv, dns_lookup_child_op );
+
+/** DNS lookup resolver interface operations */
+static struct interface_operation dns_lookup_resolv_op[] = {
+	INTF_OP ( intf_close, struct dns_lookup *, dns_lookup_close ),
+};
+
+/** DNS lookup resolver interface descriptor */
+static struct interface_descriptor dns_lookup_resolv_desc =
+	INTF_DESC_PASSTHRU ( struct dns_lookup, resolv, dns_lookup_resolv_op,
+			     primary.resolv );
+
+/**
+ * Start DNS request for a single address family
+ *
+ * @v lookup		DNS lookup
+ * @v child		Address family request
+ * @v name		Name to resolve
+ * @v sa		Socket address to fill in
+ * @v qtype		Address record type
+ * @ret rc		Return status code
+ */
+static int dns_lookup_start ( struct dns_lookup *lookup,
+			      struct dns_lookup_child *child,
+			      const char *name, struct sockaddr *sa,
+			      uint16_t qtype ) {
+	int rc;
+
+	/* Initialise request */
+	intf_init ( &child->resolv, &dns_lookup_child_desc, &lookup->refcnt );
+	child->lookup = lookup;
+
+	/* Start request */
+	if ( ( rc = dns_resolv_search ( &child->resolv, name, sa,
+					qtype ) ) != 0 ) {
+		return rc;
+	}
+	child->running = 1;
+
+	return 0;
+}
+
+/**
+ * Resolve name using DNS
+ *
+ * @v resolv		Name resolution interface
+ * @v name		Name to resolve
+ * @v sa		Socket address to fill in
+ * @ret rc		Return status code
+ *
+ * AAAA and A records are requested concurrently.  Each address found
+ * is reported via resolv_done() in order of preference, so that a
+ * caller which requires only a single address may accept the first
+ * address reported.  The preferred address family is that of the
+ * DNS server, since this is known to be reachable.
+ */
+static int dns_resolv ( struct interface *resolv,
+			const char *name, struct sockaddr *sa ) {
+	struct dns_lookup *lookup;
+	uint16_t primary;
+	uint16_t secondary;
+	int rc;
+
+	/* Fail immediately if no DNS servers */
+	if ( ! nameserver.sa.sa_family ) {
+		DBG ( "DNS not attempting to resolve \"%s\": "
+		      "no DNS servers\n", name );
+		rc = -ENXIO_NO_NAMESERVER;
+		goto err_no_nameserver;
+	}
+
+	/* Allocate and initialise structure */
+	lookup = zalloc ( sizeof ( *lookup ) );
+	if ( ! lookup ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	ref_init ( &lookup->refcnt, NULL );
+	intf_init ( &lookup->resolv, &dns_lookup_resolv_desc,
+		    &lookup->refcnt );
+	timer_init ( &lookup->timer, dns_lookup_expired, &lookup->refcnt );
+	DBGC ( lookup, "DNS %p resolving \"%s\"\n", lookup, name );
+
+	/* Determine preferred query type */
+	if ( nameserver.sa.sa_family == AF_INET6 ) {
+		primary = htons ( DNS_TYPE_AAAA );
+		secondary = htons ( DNS_TYPE_A );
+	} else {
+		primary = htons ( DNS_TYPE_A );
+		secondary = htons ( DNS_TYPE_AAAA );
+	}
+
+	/* Start requests */
+	if ( ( rc = dns_lookup_start ( lookup, &lookup->primary, name, sa,
+				       primary ) ) != 0 )
+		goto err_primary;
+	if ( ( rc = dns_lookup_start ( lookup, &lookup->secondary, name, sa,
+				       secondary ) ) != 0 )
+		goto err_secondary;
+
+	/* Attach parent interface, mortalise self, and return */
+	intf_plug_plug ( &lookup->resolv, resolv );
+	ref_put ( &lookup->refcnt );
+	return 0;
+
+ err_secondary:
+ err_primary:
+	dns_lookup_close ( lookup, rc );
+	ref_put ( &lookup->refcnt );
+ err_alloc:
  err_no_nameserver:
 	return rc;
 }
@@ -1104,10 +1863,6 @@ static void apply_dns_search ( void ) {
 	char *localdomain;
 	int len;
 
-	/* Free existing search list */
-	free ( dns_search.data );
-	memset ( &dns_search, 0, sizeof ( dns_search ) );
-
 	/* Fetch DNS search list */
 	len = fetch_setting_copy ( NULL, &dnssl_setting, NULL, NULL,
 				   &dns_search.data );
@@ -1138,6 +1893,13 @@ static void apply_dns_search ( void ) {
  * @ret rc		Return status code
  */
 static int apply_dns_settings ( void ) {
+	typeof ( nameserver ) old_nameserver;
+	struct dns_name old_search;
+
+	/* Record existing DNS server address and search list */
+	memcpy ( &old_nameserver, &nameserver, sizeof ( old_nameserver ) );
+	memcpy ( &old_search, &dns_search, sizeof ( old_search ) );
+	memset ( &dns_search, 0, sizeof ( dns_search ) );
 
 	/* Fetch DNS server address */
 	nameserver.sa.sa_family = 0;
@@ -1171,6 +1933,21 @@ static int apply_dns_settings ( void ) {
 		DBG ( "\n" );
 	}
 
+	/* Flush DNS cache if the DNS server or search list has
+	 * changed (e.g. due to a new DHCP lease).
+	 */
+	if ( ( memcmp ( &old_nameserver, &nameserver,
+			sizeof ( old_nameserver ) ) != 0 ) ||
+	     ( old_search.len != dns_search.len ) ||
+	     ( dns_search.len && ( memcmp ( old_search.data, dns_search.data,
+					    dns_search.len ) != 0 ) ) ) {
+		DBG ( "DNS flushing cache\n" );
+		dns_cache_flush();
+	}
+
+	/* Free old search list */
+	free ( old_search.data );
+
 	return 0;
 }
 
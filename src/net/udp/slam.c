@@ -106,14 +106,18 @@ FEATURE ( FEATURE_PROTOCOL, "SLAM", DHCP_EB_FEATURE_SLAM, 1 );
  * This is a policy decision equivalent to selecting a TCP window
  * size.
  */
-#define SLAM_MAX_BLOCKS_PER_NACK 4
+#define SLAM_MAX_BLOCKS_PER_NACK 64
 
-/** Maximum SLAM NACK length
- *
- * We only ever send a NACK for a single range of up to @c
- * SLAM_MAX_BLOCKS_PER_NACK blocks.
- */
-#define SLAM_MAX_NACK_LEN ( 7 /* block */ + 7 /* #blocks */ + 1 /* NUL */ )
+/** Maximum number of missing ranges to describe per NACK */
+#define SLAM_MAX_RANGES_PER_NACK 32
+
+/** Maximum SLAM NACK length */
+#define SLAM_MAX_NACK_LEN \
+	( SLAM_MAX_RANGES_PER_NACK * ( 7 /* #received */ + 7 /* #missing */ ) \
+	  + 1 /* NUL */ )
+
+/** Maximum length of batched data passed to the recipient at once */
+#define SLAM_MAX_BATCH_LEN ( 64 * 1024 )
 
 /** SLAM slave timeout */
 #define SLAM_SLAVE_TIMEOUT ( 1 * TICKS_PER_SEC )
@@ -149,6 +153,20 @@ struct slam_request {
 	struct bitmap bitmap;
 	/** NACK sent flag */
 	int nack_sent;
+
+	/** Batched data awaiting delivery to recipient */
+	struct io_buffer *batch;
+	/** First block within batched data */
+	unsigned long batch_block;
+
+	/** Number of data packets received */
+	unsigned long packets;
+	/** Number of duplicate data packets received */
+	unsigned long duplicates;
+	/** Number of NACKs sent */
+	unsigned long nacks;
+	/** Number of blocks requested via NACKs */
+	unsigned long requested;
 };
 
 /**
@@ -161,9 +179,33 @@ static void slam_free ( struct refcnt *refcnt ) {
 		container_of ( refcnt, struct slam_request, refcnt );
 
 	bitmap_free ( &slam->bitmap );
+	free_iob ( slam->batch );
 	free ( slam );
 }
 
+/**
+ * Pass batched data to recipient
+ *
+ * @v slam		SLAM request
+ * @ret rc		Return status code
+ */
+static int slam_flush ( struct slam_request *slam ) {
+	struct xfer_metadata meta;
+	struct io_buffer *iobuf;
+
+	/* Do nothing if there is no batched data */
+	iobuf = slam->batch;
+	if ( ! iobuf )
+		return 0;
+	slam->batch = NULL;
+
+	/* Pass to recipient */
+	memset ( &meta, 0, sizeof ( meta ) );
+	meta.flags = XFER_FL_ABS_OFFSET;
+	meta.offset = ( slam->batch_block * slam->block_size );
+	return xfer_deliver ( &slam->xfer, iobuf, &meta );
+}
+
 /**
  * Mark SLAM request as complete
  *
@@ -172,9 +214,21 @@ static void slam_free ( struct refcnt *refcnt ) {
  */
 static void slam_finished ( struct slam_request *slam, int rc ) {
 	static const uint8_t slam_disconnect[] = { 0 };
+	unsigned long received;
+	unsigned long lost;
+
+	/* Pass any remaining batched data to recipient */
+	if ( rc == 0 )
+		rc = slam_flush ( slam );
 
 	DBGC ( slam, "SLAM %p finished with status code %d (%s)\n",
 	       slam, rc, strerror ( rc ) );
+	received = ( slam->packets - slam->duplicates );
+	lost = ( ( slam->requested > received ) ?
+		 ( slam->requested - received ) : 0 );
+	DBGC ( slam, "SLAM %p received %ld packets (%ld duplicate), sent %ld "
+	       "NACKs for %ld blocks (%ld lost)\n", slam, slam->packets,
+	       slam->duplicates, slam->nacks, slam->requested, lost );
 
 	/* Send a disconnect message if we ever sent anything to the
 	 * server.
@@ -255,6 +309,11 @@ static int slam_tx_nack ( struct slam_request *slam ) {
 	struct io_buffer *iobuf;
 	unsigned long first_block;
 	unsigned long num_blocks;
+	unsigned long requested = 0;
+	unsigned long block = 0;
+	unsigned long gap;
+	unsigned long end;
+	unsigned int ranges = 0;
 	uint8_t *nul;
 	int rc;
 
@@ -270,34 +329,49 @@ static int slam_tx_nack ( struct slam_request *slam ) {
 		goto err_alloc;
 	}
 
-	/* Construct NACK.  We always request only a single packet;
-	 * this allows us to force multicast-TFTP-style flow control
-	 * on the SLAM server, which will otherwise just blast the
-	 * data out as fast as it can.  On a gigabit network, without
-	 * RX checksumming, this would inevitably cause packet drops.
+	/* Construct NACK as a run-length-encoded list of the missing
+	 * ranges, requesting only a limited number of blocks in
+	 * total.  This allows us to force a TCP-like window on the
+	 * SLAM server, which will otherwise just blast the data out
+	 * as fast as it can.  On a gigabit network, without RX
+	 * checksumming, this would inevitably cause packet drops.
 	 */
 	first_block = bitmap_first_gap ( &slam->bitmap );
-	for ( num_blocks = 1 ; ; num_blocks++ ) {
-		if ( num_blocks >= SLAM_MAX_BLOCKS_PER_NACK )
-			break;
-		if ( ( first_block + num_blocks ) >= slam->num_blocks )
-			break;
-		if ( bitmap_test ( &slam->bitmap,
-				   ( first_block + num_blocks ) ) )
+	while ( ( requested < SLAM_MAX_BLOCKS_PER_NACK ) &&
+		( ranges < SLAM_MAX_RANGES_PER_NACK ) ) {
+
+		/* Find next missing range */
+		gap = bitmap_find ( &slam->bitmap, block, 0 );
+		if ( gap >= slam->num_blocks )
 			break;
+		end = bitmap_find ( &slam->bitmap, gap, 1 );
+		if ( end > slam->num_blocks )
+			end = slam->num_blocks;
+		num_blocks = ( end - gap );
+		if ( num_blocks > ( SLAM_MAX_BLOCKS_PER_NACK - requested ) )
+			num_blocks = ( SLAM_MAX_BLOCKS_PER_NACK - requested );
+
+		/* Add received and missing run lengths */
+		if ( ( rc = slam_put_value ( slam, iobuf,
+					     ( gap - block ) ) ) != 0 )
+			goto err_put_value;
+		if ( ( rc = slam_put_value ( slam, iobuf,
+					     num_blocks ) ) != 0 )
+			goto err_put_value;
+		block = ( gap + num_blocks );
+		requested += num_blocks;
+		ranges++;
 	}
 	if ( first_block ) {
-		DBGCP ( slam, "SLAM %p transmitting NACK for blocks "
-			"%ld-%ld\n", slam, first_block,
-			( first_block + num_blocks - 1 ) );
+		DBGCP ( slam, "SLAM %p transmitting NACK for %ld blocks in %d "
+			"ranges from block %ld\n", slam, requested, ranges,
+			first_block );
 	} else {
-		DBGC ( slam, "SLAM %p transmitting initial NACK for blocks "
-		       "0-%ld\n", slam, ( num_blocks - 1 ) );
+		DBGC ( slam, "SLAM %p transmitting initial NACK for %ld blocks "
+		       "in %d ranges\n", slam, requested, ranges );
 	}
-	if ( ( rc = slam_put_value ( slam, iobuf, first_block ) ) != 0 )
-		goto err_put_value;
-	if ( ( rc = slam_put_value ( slam, iobuf, num_blocks ) ) != 0 )
-		goto err_put_value;
+	slam->nacks++;
+	slam->requested += requested;
 	nul = iob_put ( iobuf, 1 );
 	*nul = 0;
 
@@ -467,7 +541,9 @@ static int slam_pull_header ( struct slam_request *slam,
 	       "blocks %ld\n", slam, slam->total_bytes, slam->block_size,
 	       slam->num_blocks );
 
-	/* Discard and reset the bitmap */
+	/* Discard any batched data, and reset the bitmap */
+	free_iob ( slam->batch );
+	slam->batch = NULL;
 	bitmap_free ( &slam->bitmap );
 	memset ( &slam->bitmap, 0, sizeof ( slam->bitmap ) );
 
@@ -499,6 +575,7 @@ static int slam_mc_socket_deliver ( struct slam_request *slam,
 				    struct io_buffer *iobuf,
 				    struct xfer_metadata *rx_meta __unused ) {
 	struct xfer_metadata meta;
+	struct io_buffer *batch;
 	unsigned long packet;
 	size_t len;
 	int rc;
@@ -539,18 +616,51 @@ static int slam_mc_socket_deliver ( struct slam_request *slam,
 		rc = -EINVAL;
 		goto err_discard;
 	}
+	slam->packets++;
 
 	/* If we have already seen this packet, discard it */
 	if ( bitmap_test ( &slam->bitmap, packet ) ) {
+		slam->duplicates++;
 		goto discard;
 	}
 
-	/* Pass to recipient */
-	memset ( &meta, 0, sizeof ( meta ) );
-	meta.flags = XFER_FL_ABS_OFFSET;
-	meta.offset = ( packet * slam->block_size );
-	if ( ( rc = xfer_deliver ( &slam->xfer, iobuf, &meta ) ) != 0 )
-		goto err;
+	/* Pass any batched data to the recipient unless this packet
+	 * continues the batch.
+	 */
+	batch = slam->batch;
+	if ( batch &&
+	     ( ( packet != ( slam->batch_block +
+			     ( iob_len ( batch ) / slam->block_size ) ) ) ||
+	       ( len > iob_tailroom ( batch ) ) ) ) {
+		if ( ( rc = slam_flush ( slam ) ) != 0 )
+			goto err_discard;
+	}
+
+	/* Start a new batch if applicable */
+	if ( ( ! slam->batch ) &&
+	     ( slam->block_size <= ( SLAM_MAX_BATCH_LEN / 2 ) ) ) {
+		slam->batch = alloc_iob ( SLAM_MAX_BATCH_LEN -
+					  ( SLAM_MAX_BATCH_LEN %
+					    slam->block_size ) );
+		slam->batch_block = packet;
+	}
+
+	/* Add to batch, or pass directly to recipient if no batch
+	 * could be allocated.
+	 */
+	if ( slam->batch ) {
+		memcpy ( iob_put ( slam->batch, len ), iobuf->data, len );
+		free_iob ( iobuf );
+		if ( ( iob_tailroom ( slam->batch ) < slam->block_size ) &&
+		     ( ( rc = slam_flush ( slam ) ) != 0 ) )
+			goto err;
+	} else {
+		memset ( &meta, 0, sizeof ( meta ) );
+		meta.flags = XFER_FL_ABS_OFFSET;
+		meta.offset = ( packet * slam->block_size );
+		if ( ( rc = xfer_deliver ( &slam->xfer, iobuf, &meta ) ) != 0 )
+			goto err;
+	}
 
 	/* Mark block as received */
 	bitmap_set ( &slam->bitmap, packet );
@@ -31,10 +31,16 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 #include <ctype.h>
+#include <errno.h>
 #include <byteswap.h>
+#include <ipxe/iobuf.h>
 #include <ipxe/xfer.h>
 #include <ipxe/open.h>
+#include <ipxe/process.h>
+#include <ipxe/init.h>
 #include <ipxe/tcpip.h>
 #include <ipxe/dhcp.h>
 #include <ipxe/dhcpv6.h>
@@ -86,25 +92,99 @@ static char *syslog_hostname;
 static char *syslog_domain;
 
 /**
- * Transmit formatted syslog message
+ * Queue formatted syslog message
  *
- * @v xfer		Data transfer interface
+ * @v queue		Syslog message queue
  * @v severity		Severity
  * @v message		Message
- * @v terminator	Message terminator
  * @ret rc		Return status code
  */
-int syslog_send ( struct interface *xfer, unsigned int severity,
-		  const char *message, const char *terminator ) {
+int syslog_queue ( struct syslog_queue *queue, unsigned int severity,
+		   const char *message ) {
 	const char *hostname = ( syslog_hostname ? syslog_hostname : "" );
 	const char *domain = ( ( hostname[0] && syslog_domain ) ?
 			       syslog_domain : "" );
+	size_t remaining = ( queue->size - queue->len );
+	int len;
+
+	/* Format message into queue */
+	len = snprintf ( ( queue->buffer + queue->len ), remaining,
+			 "<%d>%s%s%s%sipxe: %s%s",
+			 SYSLOG_PRIORITY ( SYSLOG_DEFAULT_FACILITY, severity ),
+			 hostname, ( domain[0] ? "." : "" ), domain,
+			 ( hostname[0] ? " " : "" ), message,
+			 ( queue->stream ? "\n" : "" ) );
+
+	/* Drop message if queue is full */
+	if ( ( ( size_t ) len ) >= remaining ) {
+		queue->dropped++;
+		return -ENOBUFS;
+	}
+
+	/* Record message, including the terminating NUL for datagrams */
+	queue->len += ( len + ( queue->stream ? 0 : 1 ) );
+
+	return 0;
+}
+
+/**
+ * Transmit queued syslog messages
+ *
+ * @v queue		Syslog message queue
+ */
+void syslog_flush ( struct syslog_queue *queue ) {
+	struct io_buffer *iobuf;
+	char notice[32];
+	size_t window;
+	size_t len;
+	size_t msg_len;
+	int rc;
+
+	/* Transmit as much as possible */
+	if ( queue->stream ) {
+
+		/* Coalesce as many messages as the window permits */
+		window = xfer_window ( queue->xfer );
+		len = queue->len;
+		if ( len > window )
+			len = window;
+		if ( len ) {
+			iobuf = xfer_alloc_iob ( queue->xfer, len );
+			if ( ! iobuf )
+				return;
+			memcpy ( iob_put ( iobuf, len ), queue->buffer, len );
+			if ( ( rc = xfer_deliver_iob ( queue->xfer,
+						       iobuf ) ) != 0 ) {
+				DBG ( "SYSLOG could not send log messages: "
+				      "%s\n", strerror ( rc ) );
+			}
+		}
 
-	return xfer_printf ( xfer, "<%d>%s%s%s%sipxe: %s%s",
-			     SYSLOG_PRIORITY ( SYSLOG_DEFAULT_FACILITY,
-					       severity ), hostname,
-			     ( domain[0] ? "." : "" ), domain,
-			     ( hostname[0] ? " " : "" ), message, terminator );
+	} else {
+
+		/* Transmit each message as a separate datagram */
+		for ( len = 0 ; len < queue->len ; len += ( msg_len + 1 ) ) {
+			msg_len = strlen ( queue->buffer + len );
+			if ( ( rc = xfer_deliver_raw ( queue->xfer,
+						       ( queue->buffer + len ),
+						       msg_len ) ) != 0 ) {
+				DBG ( "SYSLOG could not send log message: "
+				      "%s\n", strerror ( rc ) );
+			}
+		}
+	}
+
+	/* Remove transmitted messages from queue */
+	queue->len -= len;
+	memmove ( queue->buffer, ( queue->buffer + len ), queue->len );
+
+	/* Report any dropped messages once the queue has drained */
+	if ( queue->dropped && ( queue->len == 0 ) ) {
+		snprintf ( notice, sizeof ( notice ), "%d messages dropped",
+			   queue->dropped );
+		queue->dropped = 0;
+		syslog_queue ( queue, LOG_WARNING, notice );
+	}
 }
 
 /******************************************************************************
@@ -117,6 +197,16 @@ int syslog_send ( struct interface *xfer, unsigned int severity,
 /** Syslog line buffer */
 static char syslog_buffer[SYSLOG_BUFSIZE];
 
+/** Syslog message queue buffer */
+static char syslog_queue_buffer[SYSLOG_QUEUE_SIZE];
+
+/** Syslog message queue */
+static struct syslog_queue syslog_messages = {
+	.xfer = &syslogger,
+	.buffer = syslog_queue_buffer,
+	.size = sizeof ( syslog_queue_buffer ),
+};
+
 /** Syslog severity */
 static unsigned int syslog_severity = SYSLOG_DEFAULT_SEVERITY;
 
@@ -174,10 +264,10 @@ static void syslog_putchar ( int character ) {
 	/* Guard against re-entry */
 	syslog_entered = 1;
 
-	/* Send log message */
-	if ( ( rc = syslog_send ( &syslogger, syslog_severity,
-				  syslog_buffer, "" ) ) != 0 ) {
-		DBG ( "SYSLOG could not send log message: %s\n",
+	/* Queue log message */
+	if ( ( rc = syslog_queue ( &syslog_messages, syslog_severity,
+				   syslog_buffer ) ) != 0 ) {
+		DBG ( "SYSLOG could not queue log message: %s\n",
 		      strerror ( rc ) );
 	}
 
@@ -185,6 +275,46 @@ static void syslog_putchar ( int character ) {
 	syslog_entered = 0;
 }
 
+/**
+ * Transmit queued syslog messages
+ *
+ * @v process		Process
+ */
+static void syslog_step ( struct process *process __unused ) {
+
+	/* Do nothing if we are mid-logging or have nothing to send */
+	if ( syslog_entered ||
+	     ! ( syslog_messages.len || syslog_messages.dropped ) )
+		return;
+
+	/* Guard against re-entry */
+	syslog_entered = 1;
+
+	/* Transmit queued messages */
+	syslog_flush ( &syslog_messages );
+
+	/* Clear re-entry flag */
+	syslog_entered = 0;
+}
+
+/** Syslog transmission process */
+PERMANENT_PROCESS ( syslog_process, syslog_step );
+
+/**
+ * Flush queued syslog messages on shutdown
+ *
+ * @v booting		System is shutting down for OS boot
+ */
+static void syslog_shutdown ( int booting __unused ) {
+
+	syslog_step ( &syslog_process );
+}
+
+/** Syslog shutdown function */
+struct startup_fn syslog_startup_fn __startup_fn ( STARTUP_FINAL ) = {
+	.shutdown = syslog_shutdown,
+};
+
 /** Syslog console driver */
 struct console_driver syslog_console __console_driver = {
 	.putchar = syslog_putchar,
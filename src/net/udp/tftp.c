@@ -37,6 +37,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/open.h>
 #include <ipxe/uri.h>
 #include <ipxe/tcpip.h>
+#include <ipxe/timer.h>
 #include <ipxe/retry.h>
 #include <ipxe/features.h>
 #include <ipxe/bitmap.h>
@@ -75,6 +76,9 @@ FEATURE ( FEATURE_PROTOCOL, "TFTP", DHCP_EB_FEATURE_TFTP, 1 );
 #define EINVAL_MC_INVALID_PORT __einfo_error ( EINFO_EINVAL_MC_INVALID_PORT )
 #define EINFO_EINVAL_MC_INVALID_PORT __einfo_uniqify \
 	( EINFO_EINVAL, 0x07, "Invalid multicast port" )
+#define EINVAL_WINDOWSIZE __einfo_error ( EINFO_EINVAL_WINDOWSIZE )
+#define EINFO_EINVAL_WINDOWSIZE __einfo_uniqify \
+	( EINFO_EINVAL, 0x08, "Invalid windowsize" )
 
 /**
  * A TFTP request
@@ -108,6 +112,21 @@ struct tftp_request {
 	 * "tsize" option, this value will be zero.
 	 */
 	unsigned long tsize;
+	/** Window size
+	 *
+	 * This is the "windowsize" option (RFC 7440) negotiated with
+	 * the TFTP server, i.e. the number of data blocks that the
+	 * server may send before waiting for an ACK.  (If the TFTP
+	 * server does not support this option, this will default to
+	 * 1).
+	 */
+	unsigned int windowsize;
+	/** Block number most recently acknowledged */
+	unsigned int ack;
+	/** Number of data blocks received since the most recent ACK */
+	unsigned int unacked;
+	/** Maximum block size to request */
+	unsigned int max_blksize;
 	
 	/** Server port
 	 *
@@ -141,6 +160,14 @@ struct tftp_request {
 	size_t filesize;
 	/** Retransmission timer */
 	struct retry_timer timer;
+	/** Smoothed round-trip time (in ticks) */
+	unsigned long srtt;
+	/** Round-trip time variation (in ticks) */
+	unsigned long rttvar;
+	/** Start time of current round-trip time measurement */
+	unsigned long rtt_start;
+	/** Number of consecutive retransmissions */
+	unsigned int backoff;
 };
 
 /** TFTP request flags */
@@ -153,11 +180,40 @@ enum {
 	TFTP_FL_RRQ_MULTICAST = 0x0004,
 	/** Perform MTFTP recovery on timeout */
 	TFTP_FL_MTFTP_RECOVERY = 0x0008,
+	/** Round-trip time measurement is in progress */
+	TFTP_FL_RTT_TIMING = 0x0010,
+	/** Round-trip time estimate is valid */
+	TFTP_FL_RTT_VALID = 0x0020,
+	/** At least one data block has been received */
+	TFTP_FL_RX_DATA = 0x0040,
 };
 
 /** Maximum number of MTFTP open requests before falling back to TFTP */
 #define MTFTP_MAX_TIMEOUTS 3
 
+/** Retransmission timeout used before any round-trip time is measured */
+#define TFTP_INITIAL_TIMEOUT ( TICKS_PER_SEC / 4 )
+
+/** Minimum retransmission timeout */
+#define TFTP_MIN_TIMEOUT ( TICKS_PER_SEC / 8 )
+
+/** Maximum retransmission timeout */
+#define TFTP_MAX_TIMEOUT DEFAULT_MAX_TIMEOUT
+
+/** Number of timeouts awaiting the first data block before reducing
+ * the requested block size
+ */
+#define TFTP_BLKSIZE_TIMEOUTS 3
+
+/** Block sizes to fall back to, in decreasing order
+ *
+ * 1228 bytes is the largest block size that fits within the minimum
+ * IPv6 MTU of 1280 bytes without fragmentation.
+ */
+static const unsigned int tftp_blksizes[] = {
+	1228, TFTP_DEFAULT_BLKSIZE,
+};
+
 /**
  * Free TFTP request
  *
@@ -291,6 +347,75 @@ static int tftp_presize ( struct tftp_request *tftp, size_t filesize ) {
 	return 0;
 }
 
+/**
+ * Update round-trip time estimate
+ *
+ * @v tftp		TFTP connection
+ *
+ * This is called when a response to the most recently transmitted
+ * RRQ or ACK is received.  The round-trip time estimate is updated
+ * as per RFC 6298, unless the request was retransmitted (in which
+ * case the response is ambiguous, as per Karn's algorithm).
+ */
+static void tftp_rtt_update ( struct tftp_request *tftp ) {
+	unsigned long rtt;
+	unsigned long delta;
+
+	/* Reset retransmission backoff */
+	tftp->backoff = 0;
+
+	/* Do nothing unless a measurement is in progress */
+	if ( ! ( tftp->flags & TFTP_FL_RTT_TIMING ) )
+		return;
+	tftp->flags &= ~TFTP_FL_RTT_TIMING;
+	rtt = ( currticks() - tftp->rtt_start );
+
+	/* Update estimates */
+	if ( tftp->flags & TFTP_FL_RTT_VALID ) {
+		delta = ( ( rtt > tftp->srtt ) ?
+			  ( rtt - tftp->srtt ) : ( tftp->srtt - rtt ) );
+		tftp->rttvar = ( ( ( 3 * tftp->rttvar ) + delta ) / 4 );
+		tftp->srtt = ( ( ( 7 * tftp->srtt ) + rtt ) / 8 );
+	} else {
+		tftp->srtt = rtt;
+		tftp->rttvar = ( rtt / 2 );
+		tftp->flags |= TFTP_FL_RTT_VALID;
+	}
+	DBGC2 ( tftp, "TFTP %p RTT %ld (smoothed %ld, variation %ld)\n",
+		tftp, rtt, tftp->srtt, tftp->rttvar );
+}
+
+/**
+ * Calculate retransmission timeout
+ *
+ * @v tftp		TFTP connection
+ * @ret timeout		Retransmission timeout (in ticks)
+ */
+static unsigned long tftp_timeout ( struct tftp_request *tftp ) {
+	unsigned long timeout;
+	unsigned int backoff;
+
+	/* Calculate timeout from round-trip time estimate, if known */
+	if ( tftp->flags & TFTP_FL_RTT_VALID ) {
+		timeout = ( tftp->srtt + ( 4 * tftp->rttvar ) );
+	} else {
+		timeout = TFTP_INITIAL_TIMEOUT;
+	}
+	if ( timeout < TFTP_MIN_TIMEOUT )
+		timeout = TFTP_MIN_TIMEOUT;
+
+	/* Apply exponential backoff */
+	for ( backoff = tftp->backoff ; backoff ; backoff-- ) {
+		if ( timeout >= ( TFTP_MAX_TIMEOUT / 2 ) )
+			break;
+		timeout <<= 1;
+	}
+	if ( timeout > TFTP_MAX_TIMEOUT )
+		timeout = TFTP_MAX_TIMEOUT;
+
+	return timeout;
+}
+
 /**
  * MTFTP multicast receive address
  *
@@ -340,6 +465,7 @@ static int tftp_send_rrq ( struct tftp_request *tftp ) {
 		+ 5 + 1 /* "octet" + NUL */
 		+ 7 + 1 + 5 + 1 /* "blksize" + NUL + ddddd + NUL */
 		+ 5 + 1 + 1 + 1 /* "tsize" + NUL + "0" + NUL */ 
+		+ 10 + 1 + 5 + 1 /* "windowsize" + NUL + ddddd + NUL */
 		+ 9 + 1 + 1 /* "multicast" + NUL + NUL */ );
 	iobuf = xfer_alloc_iob ( &tftp->socket, len );
 	if ( ! iobuf )
@@ -347,8 +473,8 @@ static int tftp_send_rrq ( struct tftp_request *tftp ) {
 
 	/* Determine block size */
 	blksize = xfer_window ( &tftp->xfer );
-	if ( blksize > TFTP_MAX_BLKSIZE )
-		blksize = TFTP_MAX_BLKSIZE;
+	if ( blksize > tftp->max_blksize )
+		blksize = tftp->max_blksize;
 
 	/* Build request */
 	rrq = iob_put ( iobuf, sizeof ( *rrq ) );
@@ -361,6 +487,13 @@ static int tftp_send_rrq ( struct tftp_request *tftp ) {
 					    "blksize%c%zd%ctsize%c0",
 					    0, blksize, 0, 0 ) + 1 );
 	}
+	if ( ( tftp->flags & TFTP_FL_RRQ_SIZES ) &&
+	     ! ( tftp->flags & TFTP_FL_RRQ_MULTICAST ) ) {
+		iob_put ( iobuf, snprintf ( iobuf->tail,
+					    iob_tailroom ( iobuf ),
+					    "windowsize%c%d", 0,
+					    TFTP_MAX_WINDOWSIZE ) + 1 );
+	}
 	if ( tftp->flags & TFTP_FL_RRQ_MULTICAST ) {
 		iob_put ( iobuf, snprintf ( iobuf->tail,
 					    iob_tailroom ( iobuf ),
@@ -391,6 +524,10 @@ static int tftp_send_ack ( struct tftp_request *tftp ) {
 	block = bitmap_first_gap ( &tftp->bitmap );
 	DBGC2 ( tftp, "TFTP %p sending ACK for block %d\n", tftp, block );
 
+	/* Start a new window */
+	tftp->ack = block;
+	tftp->unacked = 0;
+
 	/* Allocate buffer */
 	iobuf = xfer_alloc_iob ( &tftp->socket, sizeof ( *ack ) );
 	if ( ! iobuf )
@@ -455,11 +592,20 @@ static int tftp_send_packet ( struct tftp_request *tftp ) {
 	 */
 	stop_timer ( &tftp->timer );
 	if ( xfer_window ( &tftp->socket ) ) {
-		start_timer ( &tftp->timer );
+		start_timer_fixed ( &tftp->timer, tftp_timeout ( tftp ) );
 	} else {
+		tftp->backoff = 0;
 		start_timer_nodelay ( &tftp->timer );
 	}
 
+	/* Start round-trip time measurement, unless retransmitting */
+	if ( tftp->backoff ) {
+		tftp->flags &= ~TFTP_FL_RTT_TIMING;
+	} else {
+		tftp->flags |= TFTP_FL_RTT_TIMING;
+		tftp->rtt_start = currticks();
+	}
+
 	/* Send RRQ or ACK as appropriate */
 	if ( ! tftp->peer.st_family ) {
 		return tftp_send_rrq ( tftp );
@@ -472,6 +618,59 @@ static int tftp_send_packet ( struct tftp_request *tftp ) {
 	}
 }
 
+/**
+ * Check if the block size should be reduced
+ *
+ * @v tftp		TFTP connection
+ * @ret reduce		Block size should be reduced
+ *
+ * Some networks silently drop large (or fragmented) datagrams.  If
+ * the server has acknowledged our options but no data block has
+ * arrived despite several retransmissions, then assume that the
+ * negotiated block size is too large for the path.
+ */
+static int tftp_blksize_stalled ( struct tftp_request *tftp ) {
+
+	return ( ( tftp->flags & TFTP_FL_RRQ_SIZES ) &&
+		 ( ! ( tftp->flags & TFTP_FL_RRQ_MULTICAST ) ) &&
+		 ( ! ( tftp->flags & TFTP_FL_RX_DATA ) ) &&
+		 ( tftp->peer.st_family ) &&
+		 ( tftp->blksize > TFTP_DEFAULT_BLKSIZE ) &&
+		 ( tftp->backoff >= TFTP_BLKSIZE_TIMEOUTS ) );
+}
+
+/**
+ * Restart transfer with a smaller block size
+ *
+ * @v tftp		TFTP connection
+ * @ret rc		Return status code
+ */
+static int tftp_reduce_blksize ( struct tftp_request *tftp ) {
+	unsigned int i;
+
+	/* Find next smaller block size */
+	for ( i = 0 ; tftp_blksizes[i] >= tftp->blksize ; i++ ) {}
+	DBGC ( tftp, "TFTP %p received no data with blksize %d; retrying "
+	       "with blksize %d\n", tftp, tftp->blksize, tftp_blksizes[i] );
+	tftp->max_blksize = tftp_blksizes[i];
+
+	/* Abort current transfer */
+	tftp_send_error ( tftp, TFTP_ERR_BAD_OPTS, "Retrying with smaller "
+			  "blksize" );
+
+	/* Discard negotiated options and block bitmap */
+	tftp->blksize = TFTP_DEFAULT_BLKSIZE;
+	tftp->windowsize = TFTP_DEFAULT_WINDOWSIZE;
+	tftp->tsize = 0;
+	tftp->filesize = 0;
+	bitmap_free ( &tftp->bitmap );
+	memset ( &tftp->bitmap, 0, sizeof ( tftp->bitmap ) );
+
+	/* Send a fresh RRQ from a new port */
+	tftp->backoff = 0;
+	return tftp_reopen ( tftp );
+}
+
 /**
  * Handle TFTP retransmission timer expiry
  *
@@ -531,6 +730,16 @@ static void tftp_timer_expired ( struct retry_timer *timer, int fail ) {
 			goto err;
 		}
 	}
+
+	/* Back off retransmission timeout */
+	tftp->backoff++;
+
+	/* Reduce block size if large data blocks are being lost */
+	if ( tftp_blksize_stalled ( tftp ) ) {
+		if ( ( rc = tftp_reduce_blksize ( tftp ) ) != 0 )
+			goto err;
+	}
+
 	tftp_send_packet ( tftp );
 	return;
 
@@ -582,6 +791,29 @@ static int tftp_process_tsize ( struct tftp_request *tftp,
 	return 0;
 }
 
+/**
+ * Process TFTP "windowsize" option
+ *
+ * @v tftp		TFTP connection
+ * @v value		Option value
+ * @ret rc		Return status code
+ */
+static int tftp_process_windowsize ( struct tftp_request *tftp,
+				     const char *value ) {
+	char *end;
+
+	tftp->windowsize = strtoul ( value, &end, 10 );
+	if ( *end || ( tftp->windowsize == 0 ) ||
+	     ( tftp->windowsize > TFTP_MAX_WINDOWSIZE ) ) {
+		DBGC ( tftp, "TFTP %p got invalid windowsize \"%s\"\n",
+		       tftp, value );
+		return -EINVAL_WINDOWSIZE;
+	}
+	DBGC ( tftp, "TFTP %p windowsize=%d\n", tftp, tftp->windowsize );
+
+	return 0;
+}
+
 /**
  * Process TFTP "multicast" option
  *
@@ -669,6 +901,7 @@ struct tftp_option {
 static struct tftp_option tftp_options[] = {
 	{ "blksize", tftp_process_blksize },
 	{ "tsize", tftp_process_tsize },
+	{ "windowsize", tftp_process_windowsize },
 	{ "multicast", tftp_process_multicast },
 	{ NULL, NULL }
 };
@@ -757,6 +990,9 @@ static int tftp_rx_oack ( struct tftp_request *tftp, void *buf, size_t len ) {
 			goto done;
 	}
 
+	/* Update round-trip time estimate */
+	tftp_rtt_update ( tftp );
+
 	/* Process tsize information, if available */
 	if ( tftp->tsize ) {
 		if ( ( rc = tftp_presize ( tftp, tftp->tsize ) ) != 0 )
@@ -772,6 +1008,39 @@ static int tftp_rx_oack ( struct tftp_request *tftp, void *buf, size_t len ) {
 	return rc;
 }
 
+/**
+ * Check if an ACK is due
+ *
+ * @v tftp		TFTP connection
+ * @v block		Block number most recently received
+ * @ret due		An ACK should be sent now
+ *
+ * With a window size of one, every block is acknowledged.  With a
+ * larger window size, we acknowledge the final block of each window,
+ * the final block of the file, and (once per gap) any block received
+ * out of order, so that the server may restart its window from the
+ * first missing block as described in RFC 7440.
+ */
+static int tftp_ack_due ( struct tftp_request *tftp, unsigned int block ) {
+	unsigned int gap = bitmap_first_gap ( &tftp->bitmap );
+
+	/* Acknowledge the final block */
+	if ( bitmap_full ( &tftp->bitmap ) )
+		return 1;
+
+	/* Acknowledge at the end of each window */
+	if ( tftp->unacked >= tftp->windowsize )
+		return 1;
+
+	/* Acknowledge immediately when a new gap is detected */
+	if ( ( block > gap ) && ( gap != tftp->ack ) ) {
+		DBGC ( tftp, "TFTP %p missing block %d\n", tftp, gap );
+		return 1;
+	}
+
+	return 0;
+}
+
 /**
  * Receive DATA
  *
@@ -833,11 +1102,26 @@ static int tftp_rx_data ( struct tftp_request *tftp,
 	if ( ( rc = tftp_presize ( tftp, ( offset + data_len ) ) ) != 0 )
 		goto done;
 
+	/* Update round-trip time estimate if this is the block that
+	 * was most recently requested.
+	 */
+	if ( ( block == tftp->ack ) && ! bitmap_test ( &tftp->bitmap, block ) )
+		tftp_rtt_update ( tftp );
+
 	/* Mark block as received */
 	bitmap_set ( &tftp->bitmap, block );
+	tftp->flags |= TFTP_FL_RX_DATA;
+	tftp->unacked++;
 
-	/* Acknowledge block */
-	tftp_send_packet ( tftp );
+	/* Acknowledge block, or restart the retransmission timer to
+	 * await the remainder of the window.
+	 */
+	if ( tftp_ack_due ( tftp, block ) ) {
+		tftp_send_packet ( tftp );
+	} else {
+		stop_timer ( &tftp->timer );
+		start_timer_fixed ( &tftp->timer, tftp_timeout ( tftp ) );
+	}
 
 	/* If all blocks have been received, finish. */
 	if ( bitmap_full ( &tftp->bitmap ) )
@@ -1083,6 +1367,8 @@ static int tftp_core_open ( struct interface *xfer, struct uri *uri,
 	timer_init ( &tftp->timer, tftp_timer_expired, &tftp->refcnt );
 	tftp->uri = uri_get ( uri );
 	tftp->blksize = TFTP_DEFAULT_BLKSIZE;
+	tftp->windowsize = TFTP_DEFAULT_WINDOWSIZE;
+	tftp->max_blksize = TFTP_MAX_BLKSIZE;
 	tftp->flags = flags;
 
 	/* Open socket */
@@ -41,12 +41,18 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/crc32.h>
 #include <ipxe/ocsp.h>
 #include <ipxe/validator.h>
+#include <ipxe/trace.h>
 #include <config/crypto.h>
 
 /** @file
  *
  * Certificate validator
  *
+ * Missing cross-signing certificates and OCSP responses are
+ * downloaded concurrently for all links of the chain.  An OCSP
+ * response may be downloaded before its issuing certificate has been
+ * validated, and will be validated once the issuer becomes valid.
+ *
  */
 
 /** A certificate validator */
@@ -55,23 +61,67 @@ struct validator {
 	struct refcnt refcnt;
 	/** Job control interface */
 	struct interface job;
-	/** Data transfer interface */
-	struct interface xfer;
 
 	/** Process */
 	struct process process;
 
 	/** X.509 certificate chain */
 	struct x509_chain *chain;
-	/** OCSP check */
-	struct ocsp_check *ocsp;
+	/** List of downloads */
+	struct list_head downloads;
+	/** Trace event identifier */
+	unsigned int trace;
+};
+
+/** A certificate validator download */
+struct validator_download {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** List of downloads */
+	struct list_head list;
+	/** Certificate validator */
+	struct validator *validator;
+	/** Data transfer interface */
+	struct interface xfer;
 	/** Data buffer */
 	struct xfer_buffer buffer;
-	/** Action to take upon completed transfer */
-	int ( * done ) ( struct validator *validator, const void *data,
-			 size_t len );
+	/** OCSP check, or NULL for a cross-signing certificate download */
+	struct ocsp_check *ocsp;
+	/** Download has completed */
+	int complete;
 };
 
+/**
+ * Free certificate validator download
+ *
+ * @v refcnt		Reference count
+ */
+static void validator_download_free ( struct refcnt *refcnt ) {
+	struct validator_download *download =
+		container_of ( refcnt, struct validator_download, refcnt );
+
+	ocsp_put ( download->ocsp );
+	xferbuf_free ( &download->buffer );
+	free ( download );
+}
+
+/**
+ * Remove certificate validator download
+ *
+ * @v download		Download
+ * @v rc		Reason for removal
+ */
+static void validator_download_del ( struct validator_download *download,
+				     int rc ) {
+
+	/* Close data transfer interface */
+	intf_shutdown ( &download->xfer, rc );
+
+	/* Remove from list of downloads and drop list's reference */
+	list_del ( &download->list );
+	ref_put ( &download->refcnt );
+}
+
 /**
  * Free certificate validator
  *
@@ -82,9 +132,8 @@ static void validator_free ( struct refcnt *refcnt ) {
 		container_of ( refcnt, struct validator, refcnt );
 
 	DBGC2 ( validator, "VALIDATOR %p freed\n", validator );
+	assert ( list_empty ( &validator->downloads ) );
 	x509_chain_put ( validator->chain );
-	ocsp_put ( validator->ocsp );
-	xferbuf_free ( &validator->buffer );
 	free ( validator );
 }
 
@@ -95,12 +144,20 @@ static void validator_free ( struct refcnt *refcnt ) {
  * @v rc		Reason for finishing
  */
 static void validator_finished ( struct validator *validator, int rc ) {
+	struct validator_download *download;
+	struct validator_download *tmp;
+
+	/* Record end of validation */
+	trace_stop ( validator->trace, rc );
 
 	/* Remove process */
 	process_del ( &validator->process );
 
+	/* Abort all downloads */
+	list_for_each_entry_safe ( download, tmp, &validator->downloads, list )
+		validator_download_del ( download, rc );
+
 	/* Close all interfaces */
-	intf_shutdown ( &validator->xfer, rc );
 	intf_shutdown ( &validator->job, rc );
 }
 
@@ -119,6 +176,211 @@ static struct interface_operation validator_job_operations[] = {
 static struct interface_descriptor validator_job_desc =
 	INTF_DESC ( struct validator, job, validator_job_operations );
 
+/****************************************************************************
+ *
+ * Downloads
+ *
+ */
+
+/**
+ * Receive data
+ *
+ * @v download		Download
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int validator_download_deliver ( struct validator_download *download,
+					struct io_buffer *iobuf,
+					struct xfer_metadata *meta ) {
+	struct validator *validator = download->validator;
+	int rc;
+
+	/* Add data to buffer */
+	if ( ( rc = xferbuf_deliver ( &download->buffer, iob_disown ( iobuf ),
+				      meta ) ) != 0 ) {
+		DBGC ( validator, "VALIDATOR %p could not receive data: %s\n",
+		       validator, strerror ( rc ) );
+		validator_finished ( validator, rc );
+		return rc;
+	}
+
+	return 0;
+}
+
+static int validator_append ( struct validator *validator,
+			      const void *data, size_t len );
+
+/**
+ * Close download data transfer interface
+ *
+ * @v download		Download
+ * @v rc		Reason for close
+ */
+static void validator_download_close ( struct validator_download *download,
+				       int rc ) {
+	struct validator *validator = download->validator;
+	struct xfer_buffer *buffer = &download->buffer;
+
+	/* Close data transfer interface */
+	intf_restart ( &download->xfer, rc );
+
+	/* Check for errors */
+	if ( rc != 0 ) {
+		DBGC ( validator, "VALIDATOR %p transfer failed: %s\n",
+		       validator, strerror ( rc ) );
+		goto err_transfer;
+	}
+	DBGC2 ( validator, "VALIDATOR %p transfer complete\n", validator );
+
+	/* Process completed download */
+	if ( download->ocsp ) {
+
+		/* Record OCSP response.  The response will be
+		 * validated once the issuer has been validated.
+		 */
+		if ( ( rc = ocsp_response ( download->ocsp, buffer->data,
+					    buffer->len ) ) != 0 ) {
+			DBGC ( validator, "VALIDATOR %p could not record OCSP "
+			       "response: %s\n", validator, strerror ( rc ) );
+			goto err_response;
+		}
+		xferbuf_free ( buffer );
+		download->complete = 1;
+
+	} else {
+
+		/* Append cross-signing certificates to chain */
+		if ( ( rc = validator_append ( validator, buffer->data,
+					       buffer->len ) ) != 0 )
+			goto err_append;
+		validator_download_del ( download, 0 );
+	}
+
+	/* Resume validation process */
+	process_add ( &validator->process );
+
+	return;
+
+ err_append:
+ err_response:
+ err_transfer:
+	validator_finished ( validator, rc );
+}
+
+/** Certificate validator download data transfer interface operations */
+static struct interface_operation validator_download_operations[] = {
+	INTF_OP ( xfer_deliver, struct validator_download *,
+		  validator_download_deliver ),
+	INTF_OP ( intf_close, struct validator_download *,
+		  validator_download_close ),
+};
+
+/** Certificate validator download data transfer interface descriptor */
+static struct interface_descriptor validator_download_desc =
+	INTF_DESC ( struct validator_download, xfer,
+		    validator_download_operations );
+
+/**
+ * Start download
+ *
+ * @v validator		Certificate validator
+ * @v uri_string	URI string
+ * @v ocsp		OCSP check, or NULL for a cross-signing certificate
+ * @ret rc		Return status code
+ */
+static int validator_download ( struct validator *validator,
+				const char *uri_string,
+				struct ocsp_check *ocsp ) {
+	struct validator_download *download;
+	int rc;
+
+	/* Allocate and initialise structure */
+	download = zalloc ( sizeof ( *download ) );
+	if ( ! download ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	ref_init ( &download->refcnt, validator_download_free );
+	intf_init ( &download->xfer, &validator_download_desc,
+		    &download->refcnt );
+	download->validator = validator;
+	xferbuf_malloc_init ( &download->buffer );
+	if ( ocsp )
+		download->ocsp = ocsp_get ( ocsp );
+
+	/* Open URI */
+	if ( ( rc = xfer_open_uri_string ( &download->xfer,
+					   uri_string ) ) != 0 ) {
+		DBGC ( validator, "VALIDATOR %p could not open %s: %s\n",
+		       validator, uri_string, strerror ( rc ) );
+		goto err_open;
+	}
+
+	/* Add to list of downloads (transferring reference to list) */
+	list_add_tail ( &download->list, &validator->downloads );
+
+	return 0;
+
+ err_open:
+	intf_shutdown ( &download->xfer, rc );
+	ref_put ( &download->refcnt );
+ err_alloc:
+	return rc;
+}
+
+/**
+ * Find OCSP download for certificate
+ *
+ * @v validator		Certificate validator
+ * @v cert		Certificate being checked
+ * @ret download	Download, or NULL if not found
+ */
+static struct validator_download *
+validator_find_ocsp ( struct validator *validator,
+		      struct x509_certificate *cert ) {
+	struct validator_download *download;
+
+	list_for_each_entry ( download, &validator->downloads, list ) {
+		if ( download->ocsp && ( download->ocsp->cert == cert ) )
+			return download;
+	}
+	return NULL;
+}
+
+/**
+ * Find cross-signing certificate download
+ *
+ * @v validator		Certificate validator
+ * @ret download	Download, or NULL if not found
+ */
+static struct validator_download *
+validator_find_crosscert ( struct validator *validator ) {
+	struct validator_download *download;
+
+	list_for_each_entry ( download, &validator->downloads, list ) {
+		if ( ! download->ocsp )
+			return download;
+	}
+	return NULL;
+}
+
+/**
+ * Check for incomplete downloads
+ *
+ * @v validator		Certificate validator
+ * @ret busy		Downloads are still in progress
+ */
+static int validator_busy ( struct validator *validator ) {
+	struct validator_download *download;
+
+	list_for_each_entry ( download, &validator->downloads, list ) {
+		if ( ! download->complete )
+			return 1;
+	}
+	return 0;
+}
+
 /****************************************************************************
  *
  * Cross-signing certificates
@@ -264,21 +526,9 @@ static int validator_start_download ( struct validator *validator,
 	DBGC ( validator, "VALIDATOR %p downloading cross-signed certificate "
 	       "from %s\n", validator, uri_string );
 
-	/* Set completion handler */
-	validator->done = validator_append;
+	/* Start download */
+	rc = validator_download ( validator, uri_string, NULL );
 
-	/* Open URI */
-	if ( ( rc = xfer_open_uri_string ( &validator->xfer,
-					   uri_string ) ) != 0 ) {
-		DBGC ( validator, "VALIDATOR %p could not open %s: %s\n",
-		       validator, uri_string, strerror ( rc ) );
-		goto err_open_uri_string;
-	}
-
-	/* Success */
-	rc = 0;
-
- err_open_uri_string:
 	free ( uri_string );
  err_alloc_uri_string:
  err_check_uri_string:
@@ -293,158 +543,74 @@ static int validator_start_download ( struct validator *validator,
  */
 
 /**
- * Validate OCSP response
- *
- * @v validator		Certificate validator
- * @v data		Raw OCSP response
- * @v len		Length of raw data
- * @ret rc		Return status code
- */
-static int validator_ocsp_validate ( struct validator *validator,
-				     const void *data, size_t len ) {
-	time_t now;
-	int rc;
-
-	/* Record OCSP response */
-	if ( ( rc = ocsp_response ( validator->ocsp, data, len ) ) != 0 ) {
-		DBGC ( validator, "VALIDATOR %p could not record OCSP "
-		       "response: %s\n", validator, strerror ( rc ) );
-		return rc;
-	}
-
-	/* Validate OCSP response */
-	now = time ( NULL );
-	if ( ( rc = ocsp_validate ( validator->ocsp, now ) ) != 0 ) {
-		DBGC ( validator, "VALIDATOR %p could not validate OCSP "
-		       "response: %s\n", validator, strerror ( rc ) );
-		return rc;
-	}
-
-	/* Drop reference to OCSP check */
-	ocsp_put ( validator->ocsp );
-	validator->ocsp = NULL;
-
-	return 0;
-}
-
-/**
- * Start OCSP check
+ * Start or complete OCSP check
  *
  * @v validator		Certificate validator
  * @v cert		Certificate to check
  * @v issuer		Issuing certificate
+ * @v now		Current time
  * @ret rc		Return status code
  */
-static int validator_start_ocsp ( struct validator *validator,
-				  struct x509_certificate *cert,
-				  struct x509_certificate *issuer ) {
+static int validator_ocsp ( struct validator *validator,
+			    struct x509_certificate *cert,
+			    struct x509_certificate *issuer, time_t now ) {
+	struct validator_download *download;
+	struct ocsp_check *ocsp;
 	const char *uri_string;
 	int rc;
 
+	/* Validate downloaded OCSP response once issuer is valid */
+	download = validator_find_ocsp ( validator, cert );
+	if ( download ) {
+		if ( ! ( download->complete && x509_is_valid ( issuer ) ) )
+			return 0;
+		rc = ocsp_validate ( download->ocsp, now );
+		validator_download_del ( download, rc );
+		if ( rc != 0 ) {
+			DBGC ( validator, "VALIDATOR %p could not validate "
+			       "OCSP response: %s\n", validator, strerror ( rc ) );
+			return rc;
+		}
+		process_add ( &validator->process );
+		return 0;
+	}
+
+	/* Wait for issuer to become valid if a cached (or stapled)
+	 * response is available.
+	 */
+	if ( ( ! x509_is_valid ( issuer ) ) && ocsp_is_cached ( cert, now ) )
+		return 0;
+
 	/* Create OCSP check */
-	assert ( validator->ocsp == NULL );
-	if ( ( rc = ocsp_check ( cert, issuer, &validator->ocsp ) ) != 0 ) {
+	if ( ( rc = ocsp_check ( cert, issuer, &ocsp ) ) != 0 ) {
 		DBGC ( validator, "VALIDATOR %p could not create OCSP check: "
 		       "%s\n", validator, strerror ( rc ) );
-		return rc;
+		goto err_check;
 	}
 
-	/* Set completion handler */
-	validator->done = validator_ocsp_validate;
+	/* Use cached (or stapled) OCSP response, if available */
+	if ( x509_is_valid ( issuer ) && ( ocsp_cached ( ocsp, now ) == 0 ) ) {
+		DBGC ( validator, "VALIDATOR %p used cached OCSP response\n",
+		       validator );
+		process_add ( &validator->process );
+		rc = 0;
+		goto done;
+	}
 
-	/* Open URI */
-	uri_string = validator->ocsp->uri_string;
+	/* Start download */
+	uri_string = ocsp->uri_string;
 	DBGC ( validator, "VALIDATOR %p performing OCSP check at %s\n",
 	       validator, uri_string );
-	if ( ( rc = xfer_open_uri_string ( &validator->xfer,
-					   uri_string ) ) != 0 ) {
-		DBGC ( validator, "VALIDATOR %p could not open %s: %s\n",
-		       validator, uri_string, strerror ( rc ) );
-		return rc;
-	}
-
-	return 0;
-}
-
-/****************************************************************************
- *
- * Data transfer interface
- *
- */
-
-/**
- * Close data transfer interface
- *
- * @v validator		Certificate validator
- * @v rc		Reason for close
- */
-static void validator_xfer_close ( struct validator *validator, int rc ) {
+	if ( ( rc = validator_download ( validator, uri_string, ocsp ) ) != 0 )
+		goto err_download;
 
-	/* Close data transfer interface */
-	intf_restart ( &validator->xfer, rc );
-
-	/* Check for errors */
-	if ( rc != 0 ) {
-		DBGC ( validator, "VALIDATOR %p transfer failed: %s\n",
-		       validator, strerror ( rc ) );
-		goto err_transfer;
-	}
-	DBGC2 ( validator, "VALIDATOR %p transfer complete\n", validator );
-
-	/* Process completed download */
-	assert ( validator->done != NULL );
-	if ( ( rc = validator->done ( validator, validator->buffer.data,
-				       validator->buffer.len ) ) != 0 )
-		goto err_append;
-
-	/* Free downloaded data */
-	xferbuf_free ( &validator->buffer );
-
-	/* Resume validation process */
-	process_add ( &validator->process );
-
-	return;
-
- err_append:
- err_transfer:
-	validator_finished ( validator, rc );
-}
-
-/**
- * Receive data
- *
- * @v validator		Certificate validator
- * @v iobuf		I/O buffer
- * @v meta		Data transfer metadata
- * @ret rc		Return status code
- */
-static int validator_xfer_deliver ( struct validator *validator,
-				    struct io_buffer *iobuf,
-				    struct xfer_metadata *meta ) {
-	int rc;
-
-	/* Add data to buffer */
-	if ( ( rc = xferbuf_deliver ( &validator->buffer, iob_disown ( iobuf ),
-				      meta ) ) != 0 ) {
-		DBGC ( validator, "VALIDATOR %p could not receive data: %s\n",
-		       validator, strerror ( rc ) );
-		validator_finished ( validator, rc );
-		return rc;
-	}
-
-	return 0;
+ done:
+ err_download:
+	ocsp_put ( ocsp );
+ err_check:
+	return rc;
 }
 
-/** Certificate validator data transfer interface operations */
-static struct interface_operation validator_xfer_operations[] = {
-	INTF_OP ( xfer_deliver, struct validator *, validator_xfer_deliver ),
-	INTF_OP ( intf_close, struct validator *, validator_xfer_close ),
-};
-
-/** Certificate validator data transfer interface descriptor */
-static struct interface_descriptor validator_xfer_desc =
-	INTF_DESC ( struct validator, xfer, validator_xfer_operations );
-
 /****************************************************************************
  *
  * Validation process
@@ -462,6 +628,7 @@ static void validator_step ( struct validator *validator ) {
 	struct x509_certificate *issuer = NULL;
 	struct x509_certificate *last;
 	time_t now;
+	int chain_rc;
 	int rc;
 
 	/* Try validating chain.  Try even if the chain is incomplete,
@@ -469,54 +636,56 @@ static void validator_step ( struct validator *validator ) {
 	 * previously.
 	 */
 	now = time ( NULL );
-	if ( ( rc = x509_validate_chain ( validator->chain, now, NULL,
-					  NULL ) ) == 0 ) {
+	if ( ( chain_rc = x509_validate_chain ( validator->chain, now, NULL,
+						NULL ) ) == 0 ) {
 		validator_finished ( validator, 0 );
 		return;
 	}
 
-	/* If there is a certificate that could be validated using
-	 * OCSP, try it.
-	 */
+	/* Start or complete OCSP checks for all links of the chain */
 	list_for_each_entry ( link, &validator->chain->links, list ) {
 		cert = issuer;
 		issuer = link->cert;
-		if ( ! cert )
-			continue;
-		if ( ! x509_is_valid ( issuer ) )
+		if ( ( ! cert ) || x509_is_valid ( cert ) )
 			continue;
-		/* The issuer is valid, but this certificate is not
-		 * yet valid.  If OCSP is applicable, start it.
-		 */
 		if ( ocsp_required ( cert ) ) {
-			/* Start OCSP */
-			if ( ( rc = validator_start_ocsp ( validator, cert,
-							   issuer ) ) != 0 ) {
+			if ( ( rc = validator_ocsp ( validator, cert, issuer,
+						     now ) ) != 0 ) {
 				validator_finished ( validator, rc );
 				return;
 			}
+			if ( process_running ( &validator->process ) )
+				return;
+			continue;
+		}
+		/* The issuer is valid, but this certificate is not
+		 * valid and OCSP is not applicable.  This is a
+		 * permanent failure.
+		 */
+		if ( x509_is_valid ( issuer ) ) {
+			validator_finished ( validator, chain_rc );
 			return;
 		}
-		/* Otherwise, this is a permanent failure */
-		validator_finished ( validator, rc );
-		return;
 	}
 
-	/* If chain ends with a self-issued certificate, then there is
-	 * nothing more to do.
+	/* If chain ends with a certificate that is neither valid nor
+	 * self-issued, then try to download a suitable cross-signing
+	 * certificate.
 	 */
 	last = x509_last ( validator->chain );
-	if ( asn1_compare ( &last->issuer.raw, &last->subject.raw ) == 0 ) {
-		validator_finished ( validator, rc );
-		return;
+	if ( ( ! x509_is_valid ( last ) ) &&
+	     ( asn1_compare ( &last->issuer.raw, &last->subject.raw ) != 0 ) &&
+	     ( ! validator_find_crosscert ( validator ) ) ) {
+		if ( ( rc = validator_start_download ( validator,
+						&last->issuer.raw ) ) != 0 ) {
+			validator_finished ( validator, rc );
+			return;
+		}
 	}
 
-	/* Otherwise, try to download a suitable cross-signing
-	 * certificate.
-	 */
-	if ( ( rc = validator_start_download ( validator,
-					       &last->issuer.raw ) ) != 0 ) {
-		validator_finished ( validator, rc );
+	/* Fail if there is nothing left to wait for */
+	if ( ! validator_busy ( validator ) ) {
+		validator_finished ( validator, chain_rc );
 		return;
 	}
 }
@@ -557,12 +726,12 @@ int create_validator ( struct interface *job, struct x509_chain *chain ) {
 	ref_init ( &validator->refcnt, validator_free );
 	intf_init ( &validator->job, &validator_job_desc,
 		    &validator->refcnt );
-	intf_init ( &validator->xfer, &validator_xfer_desc,
-		    &validator->refcnt );
 	process_init ( &validator->process, &validator_process_desc,
 		       &validator->refcnt );
 	validator->chain = x509_chain_get ( chain );
-	xferbuf_malloc_init ( &validator->buffer );
+	INIT_LIST_HEAD ( &validator->downloads );
+	validator->trace = trace_start ( "validate %s",
+					 x509_name ( x509_first ( chain ) ) );
 
 	/* Attach parent interface, mortalise self, and return */
 	intf_plug_plug ( &validator->job, job );
@@ -45,8 +45,15 @@ FEATURE ( FEATURE_PROTOCOL, "VLAN", DHCP_EB_FEATURE_VLAN, 1 );
 
 struct net_protocol vlan_protocol __net_protocol;
 
+/** Number of VLAN device hash buckets (must be a power of two) */
+#define VLAN_HASH_SIZE 16
+
 /** VLAN device private data */
 struct vlan_device {
+	/** Network device */
+	struct net_device *netdev;
+	/** List of VLAN devices within the same hash bucket */
+	struct list_head hash;
 	/** Trunk network device */
 	struct net_device *trunk;
 	/** VLAN tag */
@@ -55,6 +62,28 @@ struct vlan_device {
 	unsigned int priority;
 };
 
+/** VLAN device hash buckets, indexed by VLAN tag */
+static struct list_head vlan_buckets[VLAN_HASH_SIZE];
+
+/**
+ * Find VLAN device hash bucket
+ *
+ * @v tag		VLAN tag
+ * @ret bucket		Hash bucket
+ */
+static struct list_head * vlan_bucket ( unsigned int tag ) {
+	struct list_head *bucket;
+
+	/* Identify bucket */
+	bucket = &vlan_buckets[ tag & ( VLAN_HASH_SIZE - 1 ) ];
+
+	/* Initialise bucket on first use */
+	if ( ! bucket->next )
+		INIT_LIST_HEAD ( bucket );
+
+	return bucket;
+}
+
 /**
  * Open VLAN device
  *
@@ -91,6 +120,7 @@ static int vlan_transmit ( struct net_device *netdev,
 	struct net_device *trunk = vlan->trunk;
 	struct ll_protocol *ll_protocol;
 	struct vlan_header *vlanhdr;
+	struct ethhdr *ethhdr;
 	uint8_t ll_dest_copy[ETH_ALEN];
 	uint8_t ll_source_copy[ETH_ALEN];
 	const void *ll_dest;
@@ -99,6 +129,23 @@ static int vlan_transmit ( struct net_device *netdev,
 	unsigned int flags;
 	int rc;
 
+	/* Insert VLAN header in place if the trunk is Ethernet.  This
+	 * avoids the need to strip and reconstruct the whole
+	 * link-layer header.
+	 */
+	if ( ( trunk->ll_protocol == &ethernet_protocol ) &&
+	     ( iob_len ( iobuf ) >= ETH_HLEN ) ) {
+		ethhdr = iob_push ( iobuf, sizeof ( *vlanhdr ) );
+		memmove ( ethhdr, ( ( ( void * ) ethhdr ) + sizeof ( *vlanhdr ) ),
+			  ( 2 * ETH_ALEN ) );
+		ethhdr->h_protocol = htons ( ETH_P_8021Q );
+		vlanhdr = ( ( void * ) ( ethhdr + 1 ) );
+		vlanhdr->tci = htons ( VLAN_TCI ( vlan->tag, vlan->priority ) );
+		list_del ( &iobuf->list );
+		netdev_tx ( trunk, iob_disown ( iobuf ) );
+		return 0;
+	}
+
 	/* Strip link-layer header and preserve link-layer header fields */
 	ll_protocol = netdev->ll_protocol;
 	if ( ( rc = ll_protocol->pull ( netdev, iobuf, &ll_dest, &ll_source,
@@ -200,15 +247,11 @@ static void vlan_sync ( struct net_device *netdev ) {
  * @ret netdev		VLAN device, if any
  */
 struct net_device * vlan_find ( struct net_device *trunk, unsigned int tag ) {
-	struct net_device *netdev;
 	struct vlan_device *vlan;
 
-	for_each_netdev ( netdev ) {
-		if ( netdev->op != &vlan_operations )
-			continue;
-		vlan = netdev->priv;
+	list_for_each_entry ( vlan, vlan_bucket ( tag ), hash ) {
 		if ( ( vlan->trunk == trunk ) && ( vlan->tag == tag ) )
-			return netdev;
+			return vlan->netdev;
 	}
 	return NULL;
 }
@@ -286,6 +329,38 @@ struct net_protocol vlan_protocol __net_protocol = {
 	.rx = vlan_rx,
 };
 
+/**
+ * Add VLAN tag-stripped packet to receive queue
+ *
+ * @v netdev		Network device
+ * @v tag		VLAN tag, or zero
+ * @v iobuf		I/O buffer
+ *
+ * This is used by drivers for hardware that strips the VLAN header
+ * from received packets, and allows the packet to be delivered
+ * directly to the VLAN device without passing through vlan_rx().
+ */
+void vlan_netdev_rx ( struct net_device *netdev, unsigned int tag,
+		      struct io_buffer *iobuf ) {
+	struct net_device *vlan;
+
+	/* Deliver untagged (or priority-tagged) packets to trunk */
+	if ( ! tag ) {
+		netdev_rx ( netdev, iobuf );
+		return;
+	}
+
+	/* Identify VLAN device */
+	vlan = vlan_find ( netdev, tag );
+	if ( ! vlan ) {
+		netdev_rx_err ( netdev, iobuf, -ENODEV );
+		return;
+	}
+
+	/* Hand off to VLAN device */
+	netdev_rx ( vlan, iobuf );
+}
+
 /**
  * Get the VLAN tag
  *
@@ -381,6 +456,7 @@ int vlan_create ( struct net_device *trunk, unsigned int tag,
 	netdev->dev = trunk->dev;
 	memcpy ( netdev->hw_addr, trunk->ll_addr, ETH_ALEN );
 	vlan = netdev->priv;
+	vlan->netdev = netdev;
 	vlan->trunk = netdev_get ( trunk );
 	vlan->tag = tag;
 	vlan->priority = priority;
@@ -400,6 +476,9 @@ int vlan_create ( struct net_device *trunk, unsigned int tag,
 		goto err_register;
 	}
 
+	/* Add to VLAN device hash table */
+	list_add ( &vlan->hash, vlan_bucket ( tag ) );
+
 	/* Synchronise with trunk device */
 	vlan_sync ( netdev );
 
@@ -408,6 +487,7 @@ int vlan_create ( struct net_device *trunk, unsigned int tag,
 
 	return 0;
 
+	list_del ( &vlan->hash );
 	unregister_netdev ( netdev );
  err_register:
 	netdev_nullify ( netdev );
@@ -438,6 +518,7 @@ int vlan_destroy ( struct net_device *netdev ) {
 	DBGC ( netdev, "VLAN %s destroyed\n", netdev->name );
 
 	/* Remove VLAN device */
+	list_del ( &vlan->hash );
 	unregister_netdev ( netdev );
 	trunk = vlan->trunk;
 	netdev_nullify ( netdev );
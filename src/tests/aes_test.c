@@ -45,6 +45,15 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/test.h>
 #include "cipher_test.h"
 
+/* Identify architecture-specific accelerated implementation, if any */
+#if defined ( __i386__ ) || defined ( __x86_64__ )
+#define AES_ACCEL aesni_enabled
+#define AES_ACCEL_NAME "AES-NI"
+#elif defined ( __aarch64__ )
+#define AES_ACCEL arm64_aes_enabled
+#define AES_ACCEL_NAME "ARMv8-CE"
+#endif
+
 /** Key used for NIST 128-bit test vectors */
 #define AES_KEY_NIST_128						\
 	KEY ( 0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab,	\
@@ -157,10 +166,11 @@ CIPHER_TEST ( aes_256_cbc, &aes_cbc_algorithm,
 		     0xda, 0x6c, 0x19, 0x07, 0x8c, 0x6a, 0x9d, 0x1b ) );
 
 /**
- * Perform AES self-test
+ * Perform AES self-test using the current backend
  *
+ * @v backend		Backend name
  */
-static void aes_test_exec ( void ) {
+static void aes_test_backend ( const char *backend ) {
 	struct cipher_algorithm *ecb = &aes_ecb_algorithm;
 	struct cipher_algorithm *cbc = &aes_cbc_algorithm;
 	unsigned int keylen;
@@ -175,17 +185,42 @@ static void aes_test_exec ( void ) {
 
 	/* Speed tests */
 	for ( keylen = 128 ; keylen <= 256 ; keylen += 64 ) {
-		DBG ( "AES-%d-ECB encryption required %ld cycles per byte\n",
-		      keylen, cipher_cost_encrypt ( ecb, ( keylen / 8 ) ) );
-		DBG ( "AES-%d-ECB decryption required %ld cycles per byte\n",
-		      keylen, cipher_cost_decrypt ( ecb, ( keylen / 8 ) ) );
-		DBG ( "AES-%d-CBC encryption required %ld cycles per byte\n",
-		      keylen, cipher_cost_encrypt ( cbc, ( keylen / 8 ) ) );
-		DBG ( "AES-%d-CBC decryption required %ld cycles per byte\n",
-		      keylen, cipher_cost_decrypt ( cbc, ( keylen / 8 ) ) );
+		DBG ( "AES-%d-ECB (%s) encryption required %ld cycles per "
+		      "byte\n", keylen, backend,
+		      cipher_cost_encrypt ( ecb, ( keylen / 8 ) ) );
+		DBG ( "AES-%d-ECB (%s) decryption required %ld cycles per "
+		      "byte\n", keylen, backend,
+		      cipher_cost_decrypt ( ecb, ( keylen / 8 ) ) );
+		DBG ( "AES-%d-CBC (%s) encryption required %ld cycles per "
+		      "byte\n", keylen, backend,
+		      cipher_cost_encrypt ( cbc, ( keylen / 8 ) ) );
+		DBG ( "AES-%d-CBC (%s) decryption required %ld cycles per "
+		      "byte\n", keylen, backend,
+		      cipher_cost_decrypt ( cbc, ( keylen / 8 ) ) );
 	}
 }
 
+/**
+ * Perform AES self-test
+ *
+ */
+static void aes_test_exec ( void ) {
+#ifdef AES_ACCEL
+	int accelerated = AES_ACCEL;
+
+	/* Test generic implementation */
+	AES_ACCEL = 0;
+	aes_test_backend ( "generic" );
+	AES_ACCEL = accelerated;
+
+	/* Test accelerated implementation, if available */
+	if ( accelerated )
+		aes_test_backend ( AES_ACCEL_NAME );
+#else
+	aes_test_backend ( "generic" );
+#endif
+}
+
 /** AES self-test */
 struct self_test aes_test __self_test = {
 	.name = "aes",
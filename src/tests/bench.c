@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * Benchmark infrastructure
+ *
+ * Benchmarks measure the throughput of performance-critical code
+ * paths, in order to allow performance regressions to be detected.
+ * Each measurement runs for a fixed wall-clock duration and reports
+ * the achieved operation and data rates, along with the mean and
+ * standard deviation of the per-operation cost as recorded by the
+ * profiler.
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <ipxe/benchmark.h>
+#include <ipxe/timer.h>
+#include <ipxe/init.h>
+#include <ipxe/image.h>
+#include <usr/profstat.h>
+
+/** Duration of each benchmark measurement (in ticks) */
+#define BENCH_DURATION ( TICKS_PER_SEC / 2 )
+
+/** Width of benchmark description column */
+#define BENCH_NAME_WIDTH 24
+
+/**
+ * Start benchmark measurement
+ *
+ * @v bench		Benchmark measurement
+ * @v fmt		Format string for description
+ * @v ...		Arguments
+ */
+void bench_start ( struct bench_measurement *bench, const char *fmt, ... ) {
+	va_list args;
+
+	memset ( bench, 0, sizeof ( *bench ) );
+	va_start ( args, fmt );
+	vsnprintf ( bench->name, sizeof ( bench->name ), fmt, args );
+	va_end ( args );
+	bench->started = currticks();
+}
+
+/**
+ * Check for completion of benchmark measurement
+ *
+ * @v bench		Benchmark measurement
+ * @ret more		Measurement should continue
+ */
+int bench_check ( struct bench_measurement *bench ) {
+
+	bench->elapsed = ( currticks() - bench->started );
+	return ( bench->elapsed < BENCH_DURATION );
+}
+
+/**
+ * Report benchmark measurement
+ *
+ * @v bench		Benchmark measurement
+ */
+void bench_report ( struct bench_measurement *bench ) {
+	uint64_t ops;
+	uint64_t kbps;
+	unsigned int i;
+
+	/* Calculate rates */
+	bench_check ( bench );
+	if ( ! bench->elapsed )
+		bench->elapsed = 1;
+	ops = ( ( ( ( uint64_t ) bench->count ) * TICKS_PER_SEC ) /
+		bench->elapsed );
+	kbps = ( ( bench->len * TICKS_PER_SEC ) / ( bench->elapsed * 1000 ) );
+
+	/* Print results */
+	printf ( "%s", bench->name );
+	for ( i = strlen ( bench->name ) ; i < BENCH_NAME_WIDTH ; i++ )
+		putchar ( ' ' );
+	printf ( " %10lld ops/s", ( ( long long ) ops ) );
+	if ( bench->len ) {
+		printf ( " %7lld.%01lld MB/s",
+			 ( ( long long ) ( kbps / 1000 ) ),
+			 ( ( long long ) ( ( kbps % 1000 ) / 100 ) ) );
+	}
+	if ( bench->profiler.count ) {
+		printf ( " %8ld +/- %ld ticks/op",
+			 profile_mean ( &bench->profiler ),
+			 profile_stddev ( &bench->profiler ) );
+	}
+	printf ( "\n" );
+}
+
+/**
+ * Run all benchmarks
+ *
+ * @ret rc		Return status code
+ */
+static int run_all_benchmarks ( void ) {
+	struct benchmark *benchmark;
+
+	printf ( "Starting benchmarks\n" );
+	for_each_table_entry ( benchmark, BENCHMARKS ) {
+		printf ( "Benchmarking %s:\n", benchmark->name );
+		benchmark->exec();
+	}
+	printf ( "Finished benchmarks\n" );
+	profstat();
+
+	return 0;
+}
+
+static int bench_image_probe ( struct image *image __unused ) {
+	return -ENOTTY;
+}
+
+static int bench_image_exec ( struct image *image __unused ) {
+	return run_all_benchmarks();
+}
+
+static struct image_type bench_image_type = {
+	.name = "benchmarks",
+	.probe = bench_image_probe,
+	.exec = bench_image_exec,
+};
+
+static struct image bench_image = {
+	.refcnt = REF_INIT ( ref_no_free ),
+	.name = "<BENCHMARKS>",
+	.type = &bench_image_type,
+};
+
+static void bench_init ( void ) {
+	int rc;
+
+	/* Register benchmarks image */
+	if ( ( rc = register_image ( &bench_image ) ) != 0 ) {
+		DBG ( "Could not register benchmark image: %s\n",
+		      strerror ( rc ) );
+		/* No way to report failure */
+		return;
+	}
+}
+
+/** Benchmark initialisation function */
+struct init_fn bench_init_fn __init_fn ( INIT_EARLY ) = {
+	.initialise = bench_init,
+};
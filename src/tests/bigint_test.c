@@ -32,11 +32,19 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 /* Forcibly enable assertions */
 #undef NDEBUG
 
+#include <stdlib.h>
 #include <assert.h>
 #include <string.h>
 #include <ipxe/bigint.h>
+#include <ipxe/profile.h>
 #include <ipxe/test.h>
 
+/** Number of sample iterations for profiling */
+#define PROFILE_COUNT 4
+
+/** Size of modulus and exponent used for profiling (in bytes) */
+#define BIGINT_PROFILE_LEN 256
+
 /** Define inline big integer */
 #define BIGINT(...) { __VA_ARGS__ }
 
@@ -556,6 +564,53 @@ void bigint_mod_exp_sample ( const bigint_element_t *base0,
 		      sizeof ( result_raw ) ) == 0 );			\
 	} while ( 0 )
 
+/**
+ * Calculate modular exponentiation cost
+ *
+ * @ret cost		Cost (in cycles per exponentiation)
+ */
+static unsigned long bigint_mod_exp_cost ( void ) {
+	static uint8_t raw[BIGINT_PROFILE_LEN];
+	bigint_t ( bigint_required_size ( sizeof ( raw ) ) ) base;
+	bigint_t ( bigint_required_size ( sizeof ( raw ) ) ) modulus;
+	bigint_t ( bigint_required_size ( sizeof ( raw ) ) ) exponent;
+	bigint_t ( bigint_required_size ( sizeof ( raw ) ) ) result;
+	size_t tmp_len = bigint_mod_exp_tmp_len ( &modulus, &exponent );
+	struct profiler profiler;
+	unsigned int i;
+	void *tmp;
+
+	/* Allocate temporary working space (too large for stack) */
+	tmp = malloc ( tmp_len );
+	ok ( tmp != NULL );
+	if ( ! tmp )
+		return 0;
+
+	/* Construct pseudo-random odd modulus, exponent, and base */
+	srand ( 0x1234568 );
+	for ( i = 0 ; i < sizeof ( raw ) ; i++ )
+		raw[i] = rand();
+	raw[0] |= 0x80;
+	raw[ sizeof ( raw ) - 1 ] |= 0x01;
+	bigint_init ( &modulus, raw, sizeof ( raw ) );
+	for ( i = 0 ; i < sizeof ( raw ) ; i++ )
+		raw[i] = rand();
+	bigint_init ( &exponent, raw, sizeof ( raw ) );
+	raw[0] &= 0x7f;
+	bigint_init ( &base, raw, sizeof ( raw ) );
+
+	/* Profile modular exponentiation */
+	memset ( &profiler, 0, sizeof ( profiler ) );
+	for ( i = 0 ; i < PROFILE_COUNT ; i++ ) {
+		profile_start ( &profiler );
+		bigint_mod_exp ( &base, &modulus, &exponent, &result, tmp );
+		profile_stop ( &profiler );
+	}
+
+	free ( tmp );
+	return profile_mean ( &profiler );
+}
+
 /**
  * Perform big integer self-tests
  *
@@ -2432,6 +2487,10 @@ static void bigint_test_exec ( void ) {
 				     0xfa, 0x83, 0xd4, 0x7c, 0xe9, 0x77,
 				     0x46, 0x91, 0x3a, 0x50, 0x0d, 0x6a,
 				     0x25, 0xd0 ) );
+
+	/* Benchmark modular exponentiation */
+	DBG ( "%d-bit modular exponentiation required %ld cycles\n",
+	      ( 8 * BIGINT_PROFILE_LEN ), bigint_mod_exp_cost() );
 }
 
 /** Big integer self-test */
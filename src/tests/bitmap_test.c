@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+/** @file
+ *
+ * Bitmap tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <string.h>
+#include <ipxe/bitmap.h>
+#include <ipxe/test.h>
+
+/**
+ * Perform bitmap self-tests
+ *
+ */
+static void bitmap_test_exec ( void ) {
+	struct bitmap bitmap;
+	unsigned int i;
+
+	/* Create bitmap spanning several blocks */
+	memset ( &bitmap, 0, sizeof ( bitmap ) );
+	ok ( bitmap_resize ( &bitmap, ( 3 * BITMAP_BLKSIZE + 5 ) ) == 0 );
+	ok ( bitmap_first_gap ( &bitmap ) == 0 );
+	ok ( ! bitmap_full ( &bitmap ) );
+	ok ( bitmap_find ( &bitmap, 0, 0 ) == 0 );
+	ok ( bitmap_find ( &bitmap, 0, 1 ) == bitmap.length );
+
+	/* Set bits out of order */
+	bitmap_set ( &bitmap, 1 );
+	ok ( bitmap_test ( &bitmap, 1 ) );
+	ok ( ! bitmap_test ( &bitmap, 0 ) );
+	ok ( bitmap_first_gap ( &bitmap ) == 0 );
+	bitmap_set ( &bitmap, 0 );
+	ok ( bitmap_first_gap ( &bitmap ) == 2 );
+
+	/* Fill across a block boundary */
+	for ( i = 2 ; i < ( BITMAP_BLKSIZE + 3 ) ; i++ )
+		bitmap_set ( &bitmap, i );
+	ok ( bitmap_first_gap ( &bitmap ) == ( BITMAP_BLKSIZE + 3 ) );
+	bitmap_set ( &bitmap, ( 2 * BITMAP_BLKSIZE + 7 ) );
+	ok ( bitmap_find ( &bitmap, 0, 0 ) == ( BITMAP_BLKSIZE + 3 ) );
+	ok ( bitmap_find ( &bitmap, ( BITMAP_BLKSIZE + 3 ), 1 ) ==
+	     ( 2 * BITMAP_BLKSIZE + 7 ) );
+	ok ( bitmap_find ( &bitmap, ( 2 * BITMAP_BLKSIZE + 7 ), 0 ) ==
+	     ( 2 * BITMAP_BLKSIZE + 8 ) );
+	ok ( bitmap_find ( &bitmap, ( 2 * BITMAP_BLKSIZE + 8 ), 1 ) ==
+	     bitmap.length );
+	ok ( bitmap_find ( &bitmap, bitmap.length, 0 ) == bitmap.length );
+
+	/* Fill remainder of bitmap */
+	for ( i = 0 ; i < bitmap.length ; i++ )
+		bitmap_set ( &bitmap, i );
+	ok ( bitmap_full ( &bitmap ) );
+	ok ( bitmap_first_gap ( &bitmap ) == bitmap.length );
+	ok ( bitmap_find ( &bitmap, 0, 0 ) == bitmap.length );
+	ok ( ! bitmap_test ( &bitmap, bitmap.length ) );
+
+	bitmap_free ( &bitmap );
+}
+
+/** Bitmap self-test */
+struct self_test bitmap_self_test __self_test = {
+	.name = "bitmap",
+	.exec = bitmap_test_exec,
+};
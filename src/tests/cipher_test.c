@@ -44,6 +44,9 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 /** Number of sample iterations for profiling */
 #define PROFILE_COUNT 16
 
+/** Maximum initialisation vector length used for profiling */
+#define CIPHER_COST_MAX_IV_LEN 16
+
 /**
  * Report a cipher encryption test result
  *
@@ -57,17 +60,32 @@ void cipher_encrypt_okx ( struct cipher_test *test, const char *file,
 	size_t len = test->len;
 	uint8_t ctx[cipher->ctxsize];
 	uint8_t ciphertext[len];
+	uint8_t auth[cipher->authsize];
 
 	/* Initialise cipher */
 	okx ( cipher_setkey ( cipher, ctx, test->key, test->key_len ) == 0,
 	      file, line );
 	cipher_setiv ( cipher, ctx, test->iv );
 
+	/* Process additional data, if applicable */
+	if ( test->additional_len ) {
+		cipher_encrypt ( cipher, ctx, test->additional, NULL,
+				test->additional_len );
+	}
+
 	/* Perform encryption */
 	cipher_encrypt ( cipher, ctx, test->plaintext, ciphertext, len );
 
 	/* Compare against expected ciphertext */
 	okx ( memcmp ( ciphertext, test->ciphertext, len ) == 0, file, line );
+
+	/* Compare against expected authentication tag, if applicable */
+	if ( is_auth_cipher ( cipher ) ) {
+		cipher_auth ( cipher, ctx, auth );
+		okx ( test->auth_len == sizeof ( auth ), file, line );
+		okx ( memcmp ( auth, test->auth, sizeof ( auth ) ) == 0,
+		      file, line );
+	}
 }
 
 /**
@@ -83,17 +101,32 @@ void cipher_decrypt_okx ( struct cipher_test *test, const char *file,
 	size_t len = test->len;
 	uint8_t ctx[cipher->ctxsize];
 	uint8_t plaintext[len];
+	uint8_t auth[cipher->authsize];
 
 	/* Initialise cipher */
 	okx ( cipher_setkey ( cipher, ctx, test->key, test->key_len ) == 0,
 	      file, line );
 	cipher_setiv ( cipher, ctx, test->iv );
 
+	/* Process additional data, if applicable */
+	if ( test->additional_len ) {
+		cipher_decrypt ( cipher, ctx, test->additional, NULL,
+				test->additional_len );
+	}
+
 	/* Perform encryption */
 	cipher_decrypt ( cipher, ctx, test->ciphertext, plaintext, len );
 
 	/* Compare against expected plaintext */
 	okx ( memcmp ( plaintext, test->plaintext, len ) == 0, file, line );
+
+	/* Compare against expected authentication tag, if applicable */
+	if ( is_auth_cipher ( cipher ) ) {
+		cipher_auth ( cipher, ctx, auth );
+		okx ( test->auth_len == sizeof ( auth ), file, line );
+		okx ( memcmp ( auth, test->auth, sizeof ( auth ) ) == 0,
+		      file, line );
+	}
 }
 
 /**
@@ -124,13 +157,16 @@ cipher_cost ( struct cipher_algorithm *cipher, size_t key_len,
 			      const void *src, void *dst, size_t len ) ) {
 	static uint8_t random[8192]; /* Too large for stack */
 	uint8_t key[key_len];
-	uint8_t iv[cipher->blocksize];
+	uint8_t iv[ CIPHER_COST_MAX_IV_LEN ];
 	uint8_t ctx[cipher->ctxsize];
 	struct profiler profiler;
 	unsigned long cost;
 	unsigned int i;
 	int rc;
 
+	/* Sanity check */
+	assert ( cipher->blocksize <= sizeof ( iv ) );
+
 	/* Fill buffer with pseudo-random data */
 	srand ( 0x1234568 );
 	for ( i = 0 ; i < sizeof ( random ) ; i++ )
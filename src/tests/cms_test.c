@@ -34,6 +34,8 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 #include <stdint.h>
 #include <string.h>
+#include <ipxe/md5.h>
+#include <ipxe/sha1.h>
 #include <ipxe/sha256.h>
 #include <ipxe/x509.h>
 #include <ipxe/uaccess.h>
@@ -1410,6 +1412,59 @@ static void cms_verify_fail_okx ( struct cms_test_signature *sgn,
 	cms_verify_fail_okx ( sgn, code, name, time, store, root,	\
 			      __FILE__, __LINE__ )
 
+/**
+ * Report signature verification with precalculated digest test result
+ *
+ * @v sgn		Test signature
+ * @v code		Test signed code
+ * @v digested		Test code used to precalculate digest
+ * @v digest		Digest algorithm used to precalculate digest
+ * @v name		Test verification name
+ * @v time		Test verification time
+ * @v store		Test certificate store
+ * @v root		Test root certificate list
+ * @v expected		Expected success
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void cms_verify_digested_okx ( struct cms_test_signature *sgn,
+				      struct cms_test_code *code,
+				      struct cms_test_code *digested,
+				      struct digest_algorithm *digest,
+				      const char *name, time_t time,
+				      struct x509_chain *store,
+				      struct x509_root *root, int expected,
+				      const char *file, unsigned int line ) {
+	uint8_t ctx[digest->ctxsize];
+	uint8_t value[digest->digestsize];
+	struct cms_digest precalc;
+	int rc;
+
+	/* Precalculate digest */
+	digest_init ( digest, ctx );
+	digest_update ( digest, ctx, digested->data, digested->len );
+	digest_final ( digest, ctx, value );
+	precalc.digest = digest;
+	precalc.value = value;
+
+	/* Verify signature */
+	x509_invalidate_chain ( sgn->sig->certificates );
+	rc = cms_verify_digested ( sgn->sig, virt_to_user ( code->data ),
+				   code->len, &precalc, name, time, store,
+				   root );
+	okx ( ( rc == 0 ) == expected, file, line );
+}
+#define cms_verify_digested_ok( sgn, code, digested, digest, name,	\
+				time, store, root )			\
+	cms_verify_digested_okx ( sgn, code, digested, digest, name,	\
+				  time, store, root, 1,			\
+				  __FILE__, __LINE__ )
+#define cms_verify_digested_fail_ok( sgn, code, digested, digest, name,	\
+				     time, store, root )		\
+	cms_verify_digested_okx ( sgn, code, digested, digest, name,	\
+				  time, store, root, 0,			\
+				  __FILE__, __LINE__ )
+
 /**
  * Perform CMS self-tests
  *
@@ -1457,6 +1512,19 @@ static void cms_test_exec ( void ) {
 	cms_verify_fail_ok ( &codesigned_sig, &test_code,
 			     NULL, test_expired, &empty_store, &test_root );
 
+	/* Check precalculated digest is used in place of signed content */
+	cms_verify_digested_ok ( &codesigned_sig, &bad_code, &test_code,
+				 &sha1_algorithm, NULL, test_time,
+				 &empty_store, &test_root );
+	cms_verify_digested_fail_ok ( &codesigned_sig, &test_code, &bad_code,
+				      &sha1_algorithm, NULL, test_time,
+				      &empty_store, &test_root );
+
+	/* Check precalculated digest using a different algorithm is ignored */
+	cms_verify_digested_ok ( &codesigned_sig, &test_code, &bad_code,
+				 &md5_algorithm, NULL, test_time,
+				 &empty_store, &test_root );
+
 	/* Sanity check */
 	assert ( list_empty ( &empty_store.links ) );
 
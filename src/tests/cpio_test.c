@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * CPIO self-tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <ipxe/image.h>
+#include <ipxe/cpio.h>
+#include <ipxe/test.h>
+
+/** A CPIO test */
+struct cpio_test {
+	/** Image length */
+	size_t len;
+	/** Image command line, or NULL */
+	const char *cmdline;
+	/** Expected filename length (including NUL), or zero */
+	size_t name_len;
+	/** Expected file mode field */
+	const char *mode;
+};
+
+/** Define a CPIO test */
+#define CPIO( name, LEN, CMDLINE, NAME_LEN, MODE )			\
+	static struct cpio_test name = {				\
+		.len = LEN,						\
+		.cmdline = CMDLINE,					\
+		.name_len = NAME_LEN,					\
+		.mode = MODE,						\
+	}
+
+/** Prebuilt image (no command line) */
+CPIO ( cpio_prebuilt, 1234, NULL, 0, NULL );
+
+/** Empty command line */
+CPIO ( cpio_empty, 1234, "", 0, NULL );
+
+/** Simple filename */
+CPIO ( cpio_simple, 0x12345, "initrd.img", 11, "000081a4" );
+
+/** Filename with mode */
+CPIO ( cpio_mode, 42, "bin/init mode=755", 9, "000081ed" );
+
+/** Filename with unrelated parameters */
+CPIO ( cpio_param, 42, "etc/hosts foo=bar", 10, "000081a4" );
+
+/**
+ * Report CPIO test result
+ *
+ * @v test		CPIO test
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void cpio_okx ( struct cpio_test *test, const char *file,
+		       unsigned int line ) {
+	struct cpio_header cpio;
+	struct image *image;
+	char expected[8];
+	size_t name_len;
+
+	/* Construct image */
+	image = alloc_image ( NULL );
+	okx ( image != NULL, file, line );
+	if ( ! image )
+		return;
+	image->len = test->len;
+	okx ( image_set_cmdline ( image, test->cmdline ) == 0, file, line );
+
+	/* Construct header */
+	memset ( &cpio, 'x', sizeof ( cpio ) );
+	name_len = cpio_header ( image, &cpio );
+	okx ( name_len == test->name_len, file, line );
+	okx ( cpio_name_len ( image ) ==
+	      ( name_len ? ( name_len - 1 /* NUL */ ) : 0 ), file, line );
+
+	/* Check header, if applicable */
+	if ( name_len ) {
+		okx ( memcmp ( cpio.c_magic, CPIO_MAGIC,
+			       sizeof ( cpio.c_magic ) ) == 0, file, line );
+		okx ( memcmp ( cpio.c_mode, test->mode,
+			       sizeof ( cpio.c_mode ) ) == 0, file, line );
+		okx ( memcmp ( cpio.c_nlink, "00000001",
+			       sizeof ( cpio.c_nlink ) ) == 0, file, line );
+		cpio_set_field ( expected, test->len );
+		okx ( memcmp ( cpio.c_filesize, expected,
+			       sizeof ( cpio.c_filesize ) ) == 0, file, line );
+		cpio_set_field ( expected, name_len );
+		okx ( memcmp ( cpio.c_namesize, expected,
+			       sizeof ( cpio.c_namesize ) ) == 0, file, line );
+		okx ( memcmp ( cpio.c_chksum, "00000000",
+			       sizeof ( cpio.c_chksum ) ) == 0, file, line );
+		okx ( ( ( sizeof ( cpio ) + name_len +
+			  cpio_pad_len ( sizeof ( cpio ) + name_len ) ) %
+			CPIO_ALIGN ) == 0, file, line );
+	}
+
+	/* Free image */
+	image_put ( image );
+}
+#define cpio_ok( test ) cpio_okx ( test, __FILE__, __LINE__ )
+
+/**
+ * Perform CPIO self-tests
+ *
+ */
+static void cpio_test_exec ( void ) {
+
+	/* Header construction */
+	cpio_ok ( &cpio_prebuilt );
+	cpio_ok ( &cpio_empty );
+	cpio_ok ( &cpio_simple );
+	cpio_ok ( &cpio_mode );
+	cpio_ok ( &cpio_param );
+
+	/* Padding */
+	ok ( cpio_pad_len ( 0 ) == 0 );
+	ok ( cpio_pad_len ( 1 ) == 3 );
+	ok ( cpio_pad_len ( 4 ) == 0 );
+	ok ( cpio_pad_len ( 0x6f ) == 1 );
+}
+
+/** CPIO self-test */
+struct self_test cpio_test __self_test = {
+	.name = "cpio",
+	.exec = cpio_test_exec,
+};
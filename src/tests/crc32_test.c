@@ -48,6 +48,8 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 /** A CRC32 test */
 struct crc32_test {
+	/** CRC function */
+	u32 ( * crc ) ( u32 seed, const void *data, size_t len );
 	/** Test data */
 	const void *data;
 	/** Length of test data */
@@ -62,14 +64,16 @@ struct crc32_test {
  * Define a CRC32 test
  *
  * @v name		Test name
+ * @v CRC		CRC function
  * @v DATA		Test data
  * @v SEED		Seed
  * @v CRC32		Expected CRC32
  * @ret test		CRC32 test
  */
-#define CRC32_TEST( name, DATA, SEED, CRC32 )				\
+#define CRC32_TEST( name, CRC, DATA, SEED, CRC32 )			\
 	static const uint8_t name ## _data[] = DATA;			\
 	static struct crc32_test name = {				\
+		.crc = CRC,						\
 		.data = name ## _data,					\
 		.len = sizeof ( name ## _data ),			\
 		.seed = SEED,						\
@@ -83,34 +87,129 @@ struct crc32_test {
  */
 #define crc32_ok( test ) do {						\
 	uint32_t crc32;							\
-	crc32 = crc32_le ( (test)->seed, (test)->data, (test)->len );	\
+	crc32 = (test)->crc ( (test)->seed, (test)->data, (test)->len );	\
 	ok ( crc32 == (test)->crc32 );					\
 	} while ( 0 )
 
+/**
+ * Report a long CRC32 test result
+ *
+ * @v crc		CRC function
+ * @v expected		Expected CRC (with seed of all one bits)
+ * @v file		Test code file
+ * @v line		Test code line
+ *
+ * The test data is long enough to exercise any hardware acceleration,
+ * and is checksummed both in one piece and split at unaligned
+ * offsets.
+ */
+static void crc32_long_okx ( u32 ( * crc ) ( u32 seed, const void *data,
+					     size_t len ),
+			     uint32_t expected, const char *file,
+			     unsigned int line ) {
+	static uint8_t data[1000];
+	uint32_t crc32;
+	unsigned int i;
+
+	/* Construct test data */
+	for ( i = 0 ; i < sizeof ( data ) ; i++ )
+		data[i] = ( ( i * 37 ) + 11 );
+
+	/* Check CRC in one piece */
+	crc32 = crc ( 0xffffffffUL, data, sizeof ( data ) );
+	okx ( crc32 == expected, file, line );
+
+	/* Check CRC split at unaligned offsets */
+	crc32 = crc ( 0xffffffffUL, data, 1 );
+	crc32 = crc ( crc32, ( data + 1 ), 136 );
+	crc32 = crc ( crc32, ( data + 137 ), ( sizeof ( data ) - 137 ) );
+	okx ( crc32 == expected, file, line );
+}
+#define crc32_long_ok( crc, expected ) \
+	crc32_long_okx ( crc, expected, __FILE__, __LINE__ )
+
 /* CRC32 tests */
-CRC32_TEST ( empty_test,
+CRC32_TEST ( empty_test, crc32_le,
 	     DATA ( ),
 	     0x12345678UL, 0x12345678UL );
-CRC32_TEST ( hw_test,
+CRC32_TEST ( hw_test, crc32_le,
 	     DATA ( 'h', 'e', 'l', 'l', 'o', ' ', 'w', 'o', 'r', 'l', 'd' ),
 	     0xffffffffUL, 0xf2b5ee7aUL );
-CRC32_TEST ( hw_split_part1_test,
+CRC32_TEST ( hw_split_part1_test, crc32_le,
 	     DATA ( 'h', 'e', 'l', 'l', 'o' ),
 	     0xffffffffUL, 0xc9ef5979UL );
-CRC32_TEST ( hw_split_part2_test,
+CRC32_TEST ( hw_split_part2_test, crc32_le,
 	     DATA ( ' ', 'w', 'o', 'r', 'l', 'd' ),
 	     0xc9ef5979UL, 0xf2b5ee7aUL );
 
+/* CRC32C tests (including test vectors from RFC 3720 Appendix B.4) */
+CRC32_TEST ( crc32c_empty_test, crc32c_le,
+	     DATA ( ),
+	     0x12345678UL, 0x12345678UL );
+CRC32_TEST ( crc32c_check_test, crc32c_le,
+	     DATA ( '1', '2', '3', '4', '5', '6', '7', '8', '9' ),
+	     0xffffffffUL, 0x1cf96d7cUL );
+CRC32_TEST ( crc32c_zeros_test, crc32c_le,
+	     DATA ( 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 ),
+	     0xffffffffUL, 0x756ec955UL );
+CRC32_TEST ( crc32c_ones_test, crc32c_le,
+	     DATA ( 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff ),
+	     0xffffffffUL, 0x9d5754bcUL );
+CRC32_TEST ( crc32c_hw_split_part1_test, crc32c_le,
+	     DATA ( 'h', 'e', 'l', 'l', 'o' ),
+	     0xffffffffUL, 0x658e44b3UL );
+CRC32_TEST ( crc32c_hw_split_part2_test, crc32c_le,
+	     DATA ( ' ', 'w', 'o', 'r', 'l', 'd' ),
+	     0x658e44b3UL, 0x366b9a55UL );
+
 /**
- * Perform CRC32 self-tests
+ * Perform CRC32 self-tests using the current backend
  *
  */
-static void crc32_test_exec ( void ) {
+static void crc32_test_backend ( void ) {
 
+	/* CRC32 tests */
 	crc32_ok ( &empty_test );
 	crc32_ok ( &hw_test );
 	crc32_ok ( &hw_split_part1_test );
 	crc32_ok ( &hw_split_part2_test );
+	crc32_long_ok ( crc32_le, 0x3c6fa5e2UL );
+
+	/* CRC32C tests */
+	crc32_ok ( &crc32c_empty_test );
+	crc32_ok ( &crc32c_check_test );
+	crc32_ok ( &crc32c_zeros_test );
+	crc32_ok ( &crc32c_ones_test );
+	crc32_ok ( &crc32c_hw_split_part1_test );
+	crc32_ok ( &crc32c_hw_split_part2_test );
+	crc32_long_ok ( crc32c_le, 0xc75282c5UL );
+}
+
+/**
+ * Perform CRC32 self-tests
+ *
+ */
+static void crc32_test_exec ( void ) {
+#if defined ( __i386__ ) || defined ( __x86_64__ )
+	unsigned int accelerated = x86_crc32_accel;
+
+	/* Test generic implementation */
+	x86_crc32_accel = 0;
+	crc32_test_backend();
+	x86_crc32_accel = accelerated;
+
+	/* Test accelerated implementation, if available */
+	if ( accelerated )
+		crc32_test_backend();
+#else
+	crc32_test_backend();
+#endif
 }
 
 /** CRC32 self-test */
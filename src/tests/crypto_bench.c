@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * Cryptographic algorithm benchmarks
+ *
+ * Algorithms are measured using TLS maximum-length records, since
+ * TLS record processing is the dominant use of bulk cryptography
+ * when downloading via HTTPS.
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <ipxe/crypto.h>
+#include <ipxe/hmac.h>
+#include <ipxe/aes.h>
+#include <ipxe/chacha20.h>
+#include <ipxe/md5.h>
+#include <ipxe/sha1.h>
+#include <ipxe/sha256.h>
+#include <ipxe/sha512.h>
+#include <ipxe/benchmark.h>
+
+/** Length of benchmark data (a maximum-length TLS record) */
+#define CRYPTO_BENCH_LEN 16384
+
+/** Benchmark data */
+static uint8_t crypto_bench_data[CRYPTO_BENCH_LEN];
+
+/**
+ * Benchmark cipher algorithm
+ *
+ * @v cipher		Cipher algorithm
+ * @v key_len		Length of key
+ * @v decrypt		Measure decryption (rather than encryption)
+ */
+static void cipher_bench ( struct cipher_algorithm *cipher, size_t key_len,
+			   int decrypt ) {
+	struct bench_measurement bench;
+	uint8_t ctx[cipher->ctxsize];
+	uint8_t key[key_len];
+	uint8_t iv[16];
+	uint8_t auth[16];
+	int rc;
+
+	/* Sanity check */
+	assert ( cipher->authsize <= sizeof ( auth ) );
+
+	/* Initialise cipher */
+	memset ( key, 0x5a, sizeof ( key ) );
+	memset ( iv, 0xa5, sizeof ( iv ) );
+	rc = cipher_setkey ( cipher, ctx, key, key_len );
+	assert ( rc == 0 );
+
+	/* Measure record processing, with a fresh IV per record */
+	bench_start ( &bench, "%s-%zd %s", cipher->name, ( key_len * 8 ),
+		      ( decrypt ? "decrypt" : "encrypt" ) );
+	do {
+		profile_start ( &bench.profiler );
+		cipher_setiv ( cipher, ctx, iv );
+		if ( decrypt ) {
+			cipher_decrypt ( cipher, ctx, crypto_bench_data,
+					 crypto_bench_data,
+					 sizeof ( crypto_bench_data ) );
+		} else {
+			cipher_encrypt ( cipher, ctx, crypto_bench_data,
+					 crypto_bench_data,
+					 sizeof ( crypto_bench_data ) );
+		}
+		if ( is_auth_cipher ( cipher ) )
+			cipher_auth ( cipher, ctx, auth );
+		profile_stop ( &bench.profiler );
+	} while ( bench_continue ( &bench, sizeof ( crypto_bench_data ) ) );
+	bench_report ( &bench );
+}
+
+/**
+ * Benchmark digest algorithm
+ *
+ * @v digest		Digest algorithm
+ */
+static void digest_bench ( struct digest_algorithm *digest ) {
+	struct bench_measurement bench;
+	uint8_t ctx[digest->ctxsize];
+	uint8_t out[digest->digestsize];
+
+	bench_start ( &bench, "%s", digest->name );
+	do {
+		profile_start ( &bench.profiler );
+		digest_init ( digest, ctx );
+		digest_update ( digest, ctx, crypto_bench_data,
+				sizeof ( crypto_bench_data ) );
+		digest_final ( digest, ctx, out );
+		profile_stop ( &bench.profiler );
+	} while ( bench_continue ( &bench, sizeof ( crypto_bench_data ) ) );
+	bench_report ( &bench );
+}
+
+/**
+ * Benchmark HMAC algorithm
+ *
+ * @v digest		Digest algorithm
+ */
+static void hmac_bench ( struct digest_algorithm *digest ) {
+	struct bench_measurement bench;
+	uint8_t ctx[digest->ctxsize];
+	uint8_t out[digest->digestsize];
+	uint8_t key[digest->digestsize];
+	size_t key_len;
+
+	memset ( key, 0x3c, sizeof ( key ) );
+	bench_start ( &bench, "hmac-%s", digest->name );
+	do {
+		profile_start ( &bench.profiler );
+		key_len = sizeof ( key );
+		hmac_init ( digest, ctx, key, &key_len );
+		hmac_update ( digest, ctx, crypto_bench_data,
+			      sizeof ( crypto_bench_data ) );
+		hmac_final ( digest, ctx, key, &key_len, out );
+		profile_stop ( &bench.profiler );
+	} while ( bench_continue ( &bench, sizeof ( crypto_bench_data ) ) );
+	bench_report ( &bench );
+}
+
+/**
+ * Perform cryptographic algorithm benchmarks
+ *
+ */
+static void crypto_bench_exec ( void ) {
+	unsigned int i;
+
+	/* Fill buffer with pseudo-random data */
+	srand ( 0x12345678 );
+	for ( i = 0 ; i < sizeof ( crypto_bench_data ) ; i++ )
+		crypto_bench_data[i] = rand();
+
+	/* Ciphers */
+	cipher_bench ( &aes_cbc_algorithm, 16, 0 );
+	cipher_bench ( &aes_cbc_algorithm, 16, 1 );
+	cipher_bench ( &aes_cbc_algorithm, 32, 1 );
+	cipher_bench ( &aes_gcm_algorithm, 16, 0 );
+	cipher_bench ( &aes_gcm_algorithm, 16, 1 );
+	cipher_bench ( &aes_gcm_algorithm, 32, 1 );
+	cipher_bench ( &chacha20_poly1305_algorithm, 32, 0 );
+	cipher_bench ( &chacha20_poly1305_algorithm, 32, 1 );
+
+	/* Digests */
+	digest_bench ( &md5_algorithm );
+	digest_bench ( &sha1_algorithm );
+	digest_bench ( &sha256_algorithm );
+	digest_bench ( &sha512_algorithm );
+
+	/* HMACs */
+	hmac_bench ( &sha1_algorithm );
+	hmac_bench ( &sha256_algorithm );
+	hmac_bench ( &sha512_algorithm );
+}
+
+/** Cryptographic algorithm benchmarks */
+struct benchmark crypto_benchmark __benchmark = {
+	.name = "crypto",
+	.exec = crypto_bench_exec,
+};
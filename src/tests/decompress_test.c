@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * Image decompression filter self-tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <ipxe/interface.h>
+#include <ipxe/xfer.h>
+#include <ipxe/xferbuf.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/image.h>
+#include <ipxe/decompress.h>
+#include <ipxe/test.h>
+
+/** An image decompression filter test */
+struct decompress_test {
+	/** Received data */
+	const void *data;
+	/** Length of received data */
+	size_t data_len;
+	/** Expected image data */
+	const void *expected;
+	/** Length of expected image data */
+	size_t expected_len;
+};
+
+/** An image decompression filter test sink */
+struct decompress_test_sink {
+	/** Data transfer interface */
+	struct interface xfer;
+	/** Data transfer buffer */
+	struct xfer_buffer buffer;
+	/** Close status code */
+	int rc;
+	/** Sink has been closed */
+	int closed;
+};
+
+/** Define inline data */
+#define DATA(...) { __VA_ARGS__ }
+
+/** Define an image decompression filter test */
+#define DECOMPRESS( name, DATA, EXPECTED )				\
+	static const uint8_t name ## _data[] = DATA;			\
+	static const uint8_t name ## _expected[] = EXPECTED;		\
+	static struct decompress_test name = {				\
+		.data = name ## _data,					\
+		.data_len = sizeof ( name ## _data ),			\
+		.expected = name ## _expected,				\
+		.expected_len = sizeof ( name ## _expected ),		\
+	};
+
+/* gzip compressed "Hello world" */
+DECOMPRESS ( hello_gzip,
+	DATA ( 0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03,
+	       0xf3, 0x48, 0xcd, 0xc9, 0xc9, 0x57, 0x28, 0xcf, 0x2f, 0xca,
+	       0x49, 0x01, 0x00, 0x52, 0x9e, 0xd6, 0x8b, 0x0b, 0x00, 0x00,
+	       0x00 ),
+	DATA ( 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c,
+	       0x64 ) );
+
+/* Uncompressed "Hello world" */
+DECOMPRESS ( hello_plain,
+	DATA ( 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c,
+	       0x64 ),
+	DATA ( 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c,
+	       0x64 ) );
+
+/**
+ * Receive data into test sink
+ *
+ * @v sink		Test sink
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int decompress_test_deliver ( struct decompress_test_sink *sink,
+				     struct io_buffer *iobuf,
+				     struct xfer_metadata *meta ) {
+	return xferbuf_deliver ( &sink->buffer, iobuf, meta );
+}
+
+/**
+ * Close test sink
+ *
+ * @v sink		Test sink
+ * @v rc		Reason for close
+ */
+static void decompress_test_close ( struct decompress_test_sink *sink,
+				    int rc ) {
+	sink->rc = rc;
+	sink->closed = 1;
+	intf_shutdown ( &sink->xfer, rc );
+}
+
+/** Test sink interface operations */
+static struct interface_operation decompress_test_sink_op[] = {
+	INTF_OP ( xfer_deliver, struct decompress_test_sink *,
+		  decompress_test_deliver ),
+	INTF_OP ( intf_close, struct decompress_test_sink *,
+		  decompress_test_close ),
+};
+
+/** Test sink interface descriptor */
+static struct interface_descriptor decompress_test_sink_desc =
+	INTF_DESC ( struct decompress_test_sink, xfer,
+		    decompress_test_sink_op );
+
+/** Test source interface */
+static struct interface decompress_test_source = INTF_INIT ( null_intf_desc );
+
+/**
+ * Deliver range of test data
+ *
+ * @v test		Image decompression filter test
+ * @v offset		Starting offset
+ * @v len		Length of range
+ * @ret rc		Return status code
+ */
+static int decompress_test_range ( struct decompress_test *test,
+				   size_t offset, size_t len ) {
+	struct xfer_metadata meta;
+	struct io_buffer *iobuf;
+
+	iobuf = alloc_iob ( len );
+	if ( ! iobuf )
+		return -ENOMEM;
+	memcpy ( iob_put ( iobuf, len ), ( test->data + offset ), len );
+	memset ( &meta, 0, sizeof ( meta ) );
+	meta.flags = XFER_FL_ABS_OFFSET;
+	meta.offset = offset;
+	return xfer_deliver ( &decompress_test_source, iobuf, &meta );
+}
+
+/**
+ * Report image decompression filter test result
+ *
+ * @v test		Image decompression filter test
+ * @v split		Offset at which to split data into two ranges
+ * @v reverse		Deliver second range first
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void decompress_okx ( struct decompress_test *test, size_t split,
+			     int reverse, const char *file,
+			     unsigned int line ) {
+	struct decompress_test_sink sink;
+	struct interface *source = &decompress_test_source;
+	struct interface *next;
+	size_t first = ( reverse ? split : 0 );
+	size_t second = ( reverse ? 0 : split );
+
+	/* Construct pipeline */
+	memset ( &sink, 0, sizeof ( sink ) );
+	intf_init ( &sink.xfer, &decompress_test_sink_desc, NULL );
+	xferbuf_malloc_init ( &sink.buffer );
+	okx ( image_decompress ( &sink.xfer, &next ) == 0, file, line );
+	intf_plug_plug ( source, next );
+
+	/* Deliver ranges */
+	okx ( decompress_test_range ( test, first,
+				      ( reverse ? ( test->data_len - split ) :
+					split ) ) == 0, file, line );
+	okx ( decompress_test_range ( test, second,
+				      ( reverse ? split :
+					( test->data_len - split ) ) ) == 0,
+	      file, line );
+	intf_shutdown ( source, 0 );
+
+	/* Check result */
+	okx ( sink.closed, file, line );
+	okx ( sink.rc == 0, file, line );
+	okx ( sink.buffer.len == test->expected_len, file, line );
+	okx ( memcmp ( sink.buffer.data, test->expected,
+		       test->expected_len ) == 0, file, line );
+	xferbuf_free ( &sink.buffer );
+}
+#define decompress_ok( test, split, reverse )				\
+	decompress_okx ( test, split, reverse, __FILE__, __LINE__ )
+
+/**
+ * Perform image decompression filter self-tests
+ *
+ */
+static void decompress_test_exec ( void ) {
+
+	/* Compressed data delivered in order */
+	decompress_ok ( &hello_gzip, 0, 0 );
+	decompress_ok ( &hello_gzip, 17, 0 );
+
+	/* Compressed data delivered in two reversed ranges */
+	decompress_ok ( &hello_gzip, 17, 1 );
+	decompress_ok ( &hello_gzip, 2, 1 );
+	decompress_ok ( &hello_gzip, 1, 1 );
+
+	/* Uncompressed data delivered in and out of order */
+	decompress_ok ( &hello_plain, 5, 0 );
+	decompress_ok ( &hello_plain, 5, 1 );
+}
+
+/** Image decompression filter self-test */
+struct self_test decompress_test __self_test = {
+	.name = "decompress",
+	.exec = decompress_test_exec,
+};
+
+/* Drag in gzip image format */
+REQUIRING_SYMBOL ( decompress_test );
+REQUIRE_OBJECT ( gzip_image );
@@ -36,8 +36,12 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <stdlib.h>
 #include <string.h>
 #include <ipxe/deflate.h>
+#include <ipxe/profile.h>
 #include <ipxe/test.h>
 
+/** Number of sample iterations for profiling */
+#define PROFILE_COUNT 16
+
 /** A DEFLATE test */
 struct deflate_test {
 	/** Compression format */
@@ -143,6 +147,128 @@ static struct deflate_test_fragments zlib_fragments[] = {
 	{ { 48, -1UL } },
 };
 
+/** Benchmark word list */
+static const char *deflate_words[16] = {
+	"iPXE", "open", "source", "network", "boot", "firmware", "provides",
+	"full", "PXE", "implementation", "enhanced", "with", "additional",
+	"features", "such", "as",
+};
+
+/** Benchmark random seed */
+#define DEFLATE_BENCHMARK_SEED 0x12345678
+
+/** Benchmark uncompressed length */
+#define DEFLATE_BENCHMARK_LEN 4096
+
+/** Benchmark compressed data
+ *
+ * This is the raw DEFLATE compression of the text generated by
+ * deflate_benchmark_text().
+ */
+static const uint8_t deflate_benchmark_compressed[] = {
+	0x8d, 0x57, 0xd1, 0xae, 0xdb, 0x30, 0x08, 0xfd, 0x95, 0xfe,
+	0xcc, 0xde, 0xf7, 0xb8, 0x57, 0xaf, 0x75, 0x55, 0x6b, 0x6d,
+	0x52, 0xc5, 0xe9, 0xfa, 0xfb, 0x93, 0x71, 0x0c, 0x1c, 0xc0,
+	0xd1, 0xa4, 0xab, 0xdc, 0xda, 0xc1, 0x60, 0xe0, 0x70, 0x20,
+	0x75, 0xfd, 0x6c, 0xd7, 0x7c, 0x29, 0x3f, 0x7f, 0xfd, 0xb8,
+	0xa4, 0xda, 0xfe, 0xd6, 0x77, 0x5e, 0x2e, 0xe9, 0x76, 0x2b,
+	0x7b, 0x59, 0x97, 0xf4, 0xec, 0xeb, 0xda, 0xc5, 0xee, 0x39,
+	0xed, 0x9f, 0x2d, 0xd7, 0xb1, 0x6e, 0xa7, 0xbe, 0x65, 0x7f,
+	0xf4, 0xc7, 0xef, 0x75, 0xdd, 0x2f, 0x4b, 0xde, 0xbf, 0xeb,
+	0xf6, 0x47, 0x6b, 0x68, 0x52, 0xf7, 0xcf, 0x53, 0xfd, 0xb8,
+	0x97, 0xed, 0xf5, 0x4d, 0x5b, 0x96, 0x1f, 0x4a, 0x9c, 0xee,
+	0x32, 0xd4, 0x90, 0xb8, 0x7a, 0x59, 0x3f, 0xd7, 0x87, 0xbb,
+	0x0d, 0x09, 0x1d, 0x9b, 0x74, 0xdd, 0xbe, 0xd1, 0x44, 0xfb,
+	0x79, 0xef, 0x15, 0x9f, 0xa5, 0x9b, 0xe7, 0xe5, 0x91, 0x96,
+	0x6b, 0xbe, 0x35, 0xc9, 0x66, 0xbd, 0xbc, 0xde, 0xcf, 0xfc,
+	0xca, 0xcb, 0x9e, 0x9a, 0xb8, 0x08, 0x9b, 0xfd, 0xf7, 0xb6,
+	0xfe, 0x2d, 0xb7, 0x16, 0x8e, 0x66, 0x6a, 0x5c, 0xd9, 0x08,
+	0xd1, 0x3b, 0x0a, 0x4d, 0x8f, 0x2f, 0xfd, 0x64, 0x83, 0xe4,
+	0xec, 0x71, 0x75, 0x7a, 0x83, 0x3a, 0xd9, 0x32, 0x6f, 0x2b,
+	0x1f, 0x58, 0x09, 0xbf, 0xe4, 0x70, 0xa2, 0x2a, 0x8a, 0xbb,
+	0x49, 0xdd, 0xf1, 0xcf, 0x5c, 0xd6, 0x2c, 0x29, 0x38, 0x92,
+	0xa3, 0xae, 0x49, 0xa7, 0x67, 0x16, 0x28, 0xb2, 0x38, 0xce,
+	0xb5, 0x05, 0xdf, 0xc5, 0x9c, 0x60, 0x1f, 0xc2, 0x88, 0xb0,
+	0x0a, 0x7b, 0xcd, 0x03, 0xae, 0x3d, 0x46, 0x2c, 0x04, 0x86,
+	0xda, 0xc2, 0x6b, 0x9f, 0x00, 0x19, 0xb0, 0x32, 0x9c, 0x63,
+	0x0c, 0x02, 0xce, 0xc6, 0x2e, 0x5d, 0x41, 0x92, 0x31, 0xb6,
+	0x49, 0x13, 0xc5, 0xad, 0xd8, 0x60, 0x69, 0x18, 0x2b, 0xb3,
+	0xe3, 0x35, 0x02, 0x83, 0xbd, 0xb2, 0xa1, 0xe0, 0xdb, 0xb0,
+	0x28, 0x66, 0xc9, 0xa3, 0x82, 0x14, 0x93, 0x29, 0x2e, 0x73,
+	0x53, 0xde, 0x5d, 0xa2, 0x1b, 0x12, 0x30, 0x35, 0x6f, 0xe9,
+	0x8d, 0x2d, 0x1e, 0x16, 0x61, 0x5b, 0x8c, 0x87, 0xe1, 0xb3,
+	0x05, 0x06, 0xe4, 0x68, 0xb8, 0x04, 0x54, 0x10, 0x41, 0x8f,
+	0xac, 0x7b, 0xb2, 0x88, 0x8a, 0xa1, 0x8b, 0x9a, 0xb4, 0xf6,
+	0x3c, 0x4c, 0x10, 0x07, 0x71, 0xb7, 0x14, 0xe3, 0x73, 0xa5,
+	0x76, 0x92, 0x83, 0xb1, 0xb0, 0xce, 0x7f, 0x55, 0x04, 0x89,
+	0x4f, 0x6a, 0x28, 0x55, 0x88, 0x0f, 0x88, 0xfa, 0xc0, 0xeb,
+	0xcc, 0x59, 0xe2, 0x51, 0x84, 0xe8, 0x61, 0x45, 0xa1, 0x39,
+	0x29, 0x65, 0xa4, 0x89, 0xe3, 0x9f, 0x8b, 0xdd, 0x04, 0x8c,
+	0x98, 0x0c, 0xda, 0x1a, 0x27, 0xc0, 0x1f, 0x16, 0xe9, 0xf1,
+	0x1b, 0x2b, 0x4c, 0x3b, 0xad, 0x0a, 0xb7, 0x9a, 0x0e, 0xc6,
+	0x1a, 0x24, 0x81, 0xcf, 0xdb, 0x02, 0xee, 0xa0, 0xa3, 0xb4,
+	0xd6, 0x29, 0x99, 0xfb, 0xba, 0xa1, 0x13, 0xd2, 0x1a, 0x0c,
+	0xd6, 0xac, 0x91, 0x41, 0xed, 0xce, 0x37, 0xa4, 0x25, 0x92,
+	0x89, 0x70, 0xd9, 0x0b, 0xd4, 0x60, 0x01, 0x30, 0x37, 0x34,
+	0x0b, 0xbb, 0x48, 0xef, 0x55, 0x92, 0xb4, 0xd6, 0x05, 0x60,
+	0xc9, 0xaf, 0xaa, 0x9e, 0x2f, 0xef, 0xb8, 0x4d, 0x8d, 0x12,
+	0x1e, 0xb8, 0xd7, 0x77, 0x16, 0x29, 0x4c, 0x16, 0xe9, 0x92,
+	0x47, 0xc4, 0x15, 0xc9, 0xd4, 0xc0, 0x2c, 0x0f, 0xa9, 0x42,
+	0x3b, 0xc6, 0x4e, 0x26, 0xe8, 0x0a, 0x48, 0x26, 0xb2, 0x5a,
+	0x78, 0xe6, 0x88, 0xe2, 0x8b, 0x01, 0xd1, 0x96, 0xe5, 0x48,
+	0x52, 0xcd, 0xd7, 0xd5, 0x21, 0xa6, 0x35, 0xea, 0x52, 0x9d,
+	0xe4, 0x74, 0xe3, 0x20, 0x00, 0xb7, 0x57, 0x7a, 0xb2, 0x72,
+	0xa8, 0xc1, 0x1a, 0x98, 0x0d, 0x1e, 0x1a, 0x20, 0x86, 0xc1,
+	0x78, 0xe2, 0xd2, 0x45, 0x0e, 0xa5, 0x68, 0xd9, 0x52, 0x08,
+	0x5f, 0xc2, 0x00, 0x35, 0x4c, 0x0e, 0x61, 0xf6, 0x7d, 0xf2,
+	0x5c, 0xb0, 0xd0, 0x25, 0xcf, 0xa6, 0xc2, 0x9d, 0xf4, 0x8b,
+	0x1e, 0x4e, 0x89, 0xa4, 0x08, 0x9a, 0x87, 0x1b, 0x8f, 0xb0,
+	0x66, 0x35, 0xd2, 0x67, 0xb1, 0xf4, 0xed, 0xc5, 0xa4, 0x24,
+	0x55, 0x57, 0x62, 0xce, 0x35, 0x81, 0xff, 0xe9, 0x3c, 0xa5,
+	0xdb, 0xbe, 0x0c, 0x0a, 0xf4, 0xf0, 0x33, 0x9c, 0xae, 0x1c,
+	0x69, 0xe1, 0x13, 0x42, 0xb6, 0xe3, 0xb6, 0xa3, 0x79, 0xe9,
+	0xf3, 0x30, 0x5e, 0x33, 0x04, 0xf4, 0x24, 0xe2, 0xd3, 0xef,
+	0x80, 0x6f, 0xe7, 0x75, 0x66, 0x23, 0x9c, 0xe3, 0xd8, 0xa0,
+	0x6c, 0x07, 0x35, 0xa2, 0xeb, 0x3d, 0xa0, 0x75, 0xd7, 0x06,
+	0xfd, 0x77, 0xc4, 0x74, 0x22, 0xc0, 0xd8, 0x92, 0x96, 0x88,
+	0x7c, 0xe3, 0x11, 0xcf, 0xc7, 0xc1, 0x0d, 0x63, 0xe6, 0xf3,
+	0x04, 0xfb, 0x32, 0xb2, 0x03, 0x36, 0xbb, 0x41, 0x87, 0x4d,
+	0x41, 0x78, 0xa3, 0x60, 0x98, 0xe8, 0x30, 0x3c, 0x14, 0xf8,
+	0xca, 0xe3, 0x34, 0x73, 0xd2, 0x0b, 0x4c, 0xfe, 0x7d, 0x4e,
+	0x04, 0x4f, 0x85, 0xe6, 0x04, 0x1f, 0xd3, 0x8e, 0x27, 0xe4,
+	0xcf, 0x06, 0x6c, 0xcd, 0x44, 0x5f, 0x58, 0xd0, 0x85, 0x23,
+	0x2f, 0xe9, 0x61, 0x62, 0xe5, 0x8b, 0xb2, 0x19, 0x87, 0x4e,
+	0x3a, 0xe3, 0x20, 0xf8, 0x74, 0xc4, 0x91, 0x2b, 0x9a, 0xda,
+	0x26, 0x14, 0x1a, 0x8e, 0x54, 0x66, 0x5e, 0x39, 0x43, 0x5f,
+	0xe0, 0xac, 0xe4, 0x66, 0xc6, 0x45, 0x27, 0x23, 0x21, 0x53,
+	0x86, 0x1f, 0xf4, 0x85, 0x14, 0x15, 0x65, 0x9d, 0x8e, 0xab,
+	0xf2, 0x89, 0xfd, 0x0f,
+};
+
+/**
+ * Generate benchmark text
+ *
+ * @v text		Text buffer to fill in
+ */
+static void deflate_benchmark_text ( char *text ) {
+	const char *word;
+	size_t offset = 0;
+	size_t len;
+
+	/* Construct text from randomly chosen words */
+	srand ( DEFLATE_BENCHMARK_SEED );
+	while ( offset < DEFLATE_BENCHMARK_LEN ) {
+		word = deflate_words[ rand() % 16 ];
+		len = strlen ( word );
+		if ( len > ( DEFLATE_BENCHMARK_LEN - offset ) )
+			len = ( DEFLATE_BENCHMARK_LEN - offset );
+		memcpy ( &text[offset], word, len );
+		offset += len;
+		if ( offset < DEFLATE_BENCHMARK_LEN )
+			text[offset++] = ' ';
+	}
+}
+
 /**
  * Report DEFLATE test result
  *
@@ -207,6 +333,51 @@ static void deflate_okx ( struct deflate *deflate,
 #define deflate_ok( deflate, test, frags ) \
 	deflate_okx ( deflate, test, frags, __FILE__, __LINE__ )
 
+/**
+ * Calculate DEFLATE decompression cost
+ *
+ * @v deflate		Decompressor
+ * @ret cost		Cost (in cycles per byte)
+ */
+static unsigned long deflate_cost ( struct deflate *deflate ) {
+	static char expected[DEFLATE_BENCHMARK_LEN]; /* Too large for stack */
+	static char data[DEFLATE_BENCHMARK_LEN];
+	userptr_t compressed = virt_to_user ( deflate_benchmark_compressed );
+	struct deflate_chunk in;
+	struct deflate_chunk out;
+	struct profiler profiler;
+	unsigned long cost;
+	unsigned int i;
+	int rc;
+
+	/* Generate expected text */
+	deflate_benchmark_text ( expected );
+
+	/* Profile decompression */
+	memset ( &profiler, 0, sizeof ( profiler ) );
+	for ( i = 0 ; i < PROFILE_COUNT ; i++ ) {
+		deflate_chunk_init ( &in, compressed, 0,
+				     sizeof ( deflate_benchmark_compressed ) );
+		deflate_chunk_init ( &out, virt_to_user ( data ), 0,
+				     sizeof ( data ) );
+		memset ( data, 0, sizeof ( data ) );
+		profile_start ( &profiler );
+		deflate_init ( deflate, DEFLATE_RAW );
+		rc = deflate_inflate ( deflate, &in, &out );
+		profile_stop ( &profiler );
+		ok ( rc == 0 );
+		ok ( deflate_finished ( deflate ) );
+		ok ( out.offset == sizeof ( data ) );
+		ok ( memcmp ( data, expected, sizeof ( data ) ) == 0 );
+	}
+
+	/* Round to nearest whole number of cycles per byte */
+	cost = ( ( profile_mean ( &profiler ) + ( sizeof ( data ) / 2 ) ) /
+		 sizeof ( data ) );
+
+	return cost;
+}
+
 /**
  * Perform DEFLATE self-test
  *
@@ -237,6 +408,10 @@ static void deflate_test_exec ( void ) {
 				    sizeof ( zlib_fragments[0] ) ) ; i++ ) {
 			deflate_ok ( deflate, &zlib, &zlib_fragments[i] );
 		}
+
+		/* Speed test */
+		DBG ( "DEFLATE required %ld cycles per byte\n",
+		      deflate_cost ( deflate ) );
 	}
 
 	/* Free shared structure */
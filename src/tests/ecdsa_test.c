@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * ECDSA self-tests
+ *
+ * These test vectors are generated using openssl's ecparam, ec, and
+ * dgst tools.
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <string.h>
+#include <ipxe/crypto.h>
+#include <ipxe/ecdsa.h>
+#include <ipxe/sha256.h>
+#include <ipxe/sha512.h>
+#include <ipxe/test.h>
+#include "pubkey_test.h"
+
+/** Define inline public key data */
+#define PUBLIC(...) { __VA_ARGS__ }
+
+/** Define inline plaintext data */
+#define PLAINTEXT(...) { __VA_ARGS__ }
+
+/** Define inline signature data */
+#define SIGNATURE(...) { __VA_ARGS__ }
+
+/** An ECDSA signature self-test */
+struct ecdsa_signature_test {
+	/** Public key */
+	const void *public;
+	/** Public key length */
+	size_t public_len;
+	/** Plaintext */
+	const void *plaintext;
+	/** Plaintext length */
+	size_t plaintext_len;
+	/** Digest algorithm */
+	struct digest_algorithm *digest;
+	/** Signature */
+	const void *signature;
+	/** Signature length */
+	size_t signature_len;
+};
+
+/**
+ * Define an ECDSA signature test
+ *
+ * @v name		Test name
+ * @v PUBLIC		Public key
+ * @v PLAINTEXT		Plaintext
+ * @v DIGEST		Digest algorithm
+ * @v SIGNATURE		Signature
+ * @ret test		Signature test
+ */
+#define ECDSA_SIGNATURE_TEST( name, PUBLIC, PLAINTEXT, DIGEST,		\
+			      SIGNATURE )				\
+	static const uint8_t name ## _public[] = PUBLIC;		\
+	static const uint8_t name ## _plaintext[] = PLAINTEXT;		\
+	static const uint8_t name ## _signature[] = SIGNATURE;		\
+	static struct ecdsa_signature_test name = {			\
+		.public = name ## _public,				\
+		.public_len = sizeof ( name ## _public ),		\
+		.plaintext = name ## _plaintext,			\
+		.plaintext_len = sizeof ( name ## _plaintext ),		\
+		.digest = DIGEST,					\
+		.signature = name ## _signature,			\
+		.signature_len = sizeof ( name ## _signature ),		\
+	}
+
+/**
+ * Report ECDSA signature test result
+ *
+ * @v test		ECDSA signature test
+ */
+#define ecdsa_signature_ok( test ) do {					\
+	uint8_t bad_signature[ (test)->signature_len ];			\
+	pubkey_verify_ok ( &ecdsa_algorithm, (test)->public,		\
+			   (test)->public_len, (test)->digest,		\
+			   (test)->plaintext, (test)->plaintext_len,	\
+			   (test)->signature, (test)->signature_len );	\
+	memcpy ( bad_signature, (test)->signature,			\
+		 sizeof ( bad_signature ) );				\
+	bad_signature[ sizeof ( bad_signature ) - 1 ] ^= 0x01;		\
+	pubkey_verify_fail_ok ( &ecdsa_algorithm, (test)->public,	\
+				(test)->public_len, (test)->digest,	\
+				(test)->plaintext,			\
+				(test)->plaintext_len, bad_signature,	\
+				sizeof ( bad_signature ) );		\
+	memset ( bad_signature, 0, sizeof ( bad_signature ) );		\
+	pubkey_verify_fail_ok ( &ecdsa_algorithm, (test)->public,	\
+				(test)->public_len, (test)->digest,	\
+				(test)->plaintext,			\
+				(test)->plaintext_len, bad_signature,	\
+				sizeof ( bad_signature ) );		\
+	} while ( 0 )
+
+/** "Hello world" ECDSA-with-SHA-256 signature test */
+ECDSA_SIGNATURE_TEST ( sha256_test,
+	PUBLIC ( 0x30, 0x59, 0x30, 0x13, 0x06, 0x07, 0x2a, 0x86, 0x48, 0xce,
+	         0x3d, 0x02, 0x01, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d,
+	         0x03, 0x01, 0x07, 0x03, 0x42, 0x00, 0x04, 0xe6, 0x12, 0xa0,
+	         0x73, 0xa6, 0xd5, 0x1b, 0x88, 0x86, 0x70, 0x1d, 0x5d, 0x69,
+	         0x5d, 0xc9, 0xc4, 0x9c, 0xcb, 0x5e, 0xf7, 0x74, 0x59, 0x07,
+	         0x24, 0x13, 0x41, 0xd1, 0xed, 0x5e, 0x2e, 0xc0, 0xe0, 0x59,
+	         0x91, 0xbe, 0xcd, 0x6e, 0xda, 0x16, 0x32, 0xc0, 0x01, 0x1a,
+	         0xc8, 0xd5, 0x5e, 0xb0, 0xf2, 0xff, 0x7a, 0xcd, 0xed, 0x3e,
+	         0xb1, 0x1b, 0xff, 0xa6, 0x30, 0x54, 0x6a, 0xf5, 0x26, 0x25,
+	         0x09 ),
+	PLAINTEXT ( 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c,
+	            0x64, 0x0a ),
+	&sha256_algorithm,
+	SIGNATURE ( 0x30, 0x46, 0x02, 0x21, 0x00, 0xd4, 0xdb, 0x77, 0x13, 0x4e,
+	            0x52, 0xc5, 0x73, 0x86, 0x59, 0x27, 0xcf, 0xf0, 0x1a, 0x94,
+	            0x8a, 0x27, 0x75, 0x6e, 0xf7, 0x11, 0x9a, 0x6e, 0xcf, 0xaa,
+	            0xca, 0xc3, 0x5e, 0x1b, 0x1f, 0xc7, 0x7e, 0x02, 0x21, 0x00,
+	            0xff, 0xc4, 0x0f, 0x46, 0xb7, 0x1a, 0x85, 0xe0, 0xea, 0x6e,
+	            0x05, 0x2d, 0x6d, 0xff, 0x69, 0x7f, 0xdb, 0x66, 0x44, 0x2c,
+	            0x36, 0x42, 0xca, 0x80, 0x22, 0x28, 0x4b, 0x40, 0x01, 0xf9,
+	            0x2e, 0x13 ) );
+
+/** "Hello world" ECDSA-with-SHA-384 signature test */
+ECDSA_SIGNATURE_TEST ( sha384_test,
+	PUBLIC ( 0x30, 0x59, 0x30, 0x13, 0x06, 0x07, 0x2a, 0x86, 0x48, 0xce,
+	         0x3d, 0x02, 0x01, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d,
+	         0x03, 0x01, 0x07, 0x03, 0x42, 0x00, 0x04, 0xe6, 0x12, 0xa0,
+	         0x73, 0xa6, 0xd5, 0x1b, 0x88, 0x86, 0x70, 0x1d, 0x5d, 0x69,
+	         0x5d, 0xc9, 0xc4, 0x9c, 0xcb, 0x5e, 0xf7, 0x74, 0x59, 0x07,
+	         0x24, 0x13, 0x41, 0xd1, 0xed, 0x5e, 0x2e, 0xc0, 0xe0, 0x59,
+	         0x91, 0xbe, 0xcd, 0x6e, 0xda, 0x16, 0x32, 0xc0, 0x01, 0x1a,
+	         0xc8, 0xd5, 0x5e, 0xb0, 0xf2, 0xff, 0x7a, 0xcd, 0xed, 0x3e,
+	         0xb1, 0x1b, 0xff, 0xa6, 0x30, 0x54, 0x6a, 0xf5, 0x26, 0x25,
+	         0x09 ),
+	PLAINTEXT ( 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c,
+	            0x64, 0x0a ),
+	&sha384_algorithm,
+	SIGNATURE ( 0x30, 0x46, 0x02, 0x21, 0x00, 0x9f, 0x1f, 0x21, 0xdd, 0x74,
+	            0x2e, 0xb4, 0x8d, 0xde, 0x24, 0x03, 0x53, 0x63, 0x43, 0x15,
+	            0x33, 0xb0, 0x87, 0x54, 0x8a, 0xac, 0xf9, 0x7a, 0xc9, 0x0f,
+	            0x39, 0xed, 0xbb, 0x81, 0x7e, 0x69, 0xc5, 0x02, 0x21, 0x00,
+	            0x84, 0xfd, 0xec, 0x07, 0x57, 0x58, 0x21, 0x2b, 0xcf, 0xfa,
+	            0xcb, 0x34, 0x45, 0xb6, 0x85, 0x75, 0xe3, 0x9a, 0x55, 0xc0,
+	            0x62, 0x31, 0x73, 0xc2, 0xf9, 0x05, 0xef, 0xaf, 0x54, 0xca,
+	            0x9f, 0xc5 ) );
+
+/**
+ * Perform ECDSA self-tests
+ *
+ */
+static void ecdsa_test_exec ( void ) {
+
+	ecdsa_signature_ok ( &sha256_test );
+	ecdsa_signature_ok ( &sha384_test );
+}
+
+/** ECDSA self-test */
+struct self_test ecdsa_test __self_test = {
+	.name = "ecdsa",
+	.exec = ecdsa_test_exec,
+};
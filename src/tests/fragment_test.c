@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * Fragment reassembly self-tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <string.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/ipstat.h>
+#include <ipxe/fragment.h>
+#include <ipxe/process.h>
+#include <ipxe/test.h>
+
+/** A test fragment header */
+struct fragment_test_header {
+	/** Identifier */
+	uint16_t ident;
+	/** Fragment offset */
+	uint16_t offset;
+	/** More fragments flag */
+	uint8_t more;
+} __attribute__ (( packed ));
+
+/** Length of test packet data */
+#define FRAGMENT_TEST_LEN 64
+
+/** Test packet data */
+static uint8_t fragment_test_data[FRAGMENT_TEST_LEN];
+
+/**
+ * Check if fragment matches fragment reassembly buffer
+ *
+ * @v fragment		Fragment reassembly buffer
+ * @v iobuf		I/O buffer
+ * @v hdrlen		Length of non-fragmentable potion of I/O buffer
+ * @ret is_fragment	Fragment matches this reassembly buffer
+ */
+static int fragment_test_is_fragment ( struct fragment *fragment,
+				       struct io_buffer *iobuf,
+				       size_t hdrlen __unused ) {
+	struct fragment_test_header *frag_hdr = fragment->iobuf->data;
+	struct fragment_test_header *hdr = iobuf->data;
+
+	return ( hdr->ident == frag_hdr->ident );
+}
+
+/**
+ * Get fragment offset
+ *
+ * @v iobuf		I/O buffer
+ * @v hdrlen		Length of non-fragmentable potion of I/O buffer
+ * @ret offset		Offset
+ */
+static size_t fragment_test_offset ( struct io_buffer *iobuf,
+				     size_t hdrlen __unused ) {
+	struct fragment_test_header *hdr = iobuf->data;
+
+	return hdr->offset;
+}
+
+/**
+ * Check if more fragments exist
+ *
+ * @v iobuf		I/O buffer
+ * @v hdrlen		Length of non-fragmentable potion of I/O buffer
+ * @ret more_frags	More fragments exist
+ */
+static int fragment_test_more ( struct io_buffer *iobuf,
+				size_t hdrlen __unused ) {
+	struct fragment_test_header *hdr = iobuf->data;
+
+	return hdr->more;
+}
+
+/** Test statistics */
+static struct ip_statistics fragment_test_stats;
+
+/** Test fragment reassembler */
+static struct fragment_reassembler fragment_test_reassembler = {
+	.list = LIST_HEAD_INIT ( fragment_test_reassembler.list ),
+	.is_fragment = fragment_test_is_fragment,
+	.fragment_offset = fragment_test_offset,
+	.more_fragments = fragment_test_more,
+	.stats = &fragment_test_stats,
+};
+
+/**
+ * Submit test fragment
+ *
+ * @v ident		Identifier
+ * @v offset		Fragment offset
+ * @v len		Fragment length
+ * @ret iobuf		Reassembled packet, or NULL
+ */
+static struct io_buffer * fragment_test_rx ( unsigned int ident,
+					     size_t offset, size_t len ) {
+	struct fragment_test_header *hdr;
+	struct io_buffer *iobuf;
+	size_t hdrlen = sizeof ( *hdr );
+
+	iobuf = alloc_iob ( sizeof ( *hdr ) + len );
+	assert ( iobuf != NULL );
+	hdr = iob_put ( iobuf, sizeof ( *hdr ) );
+	hdr->ident = ident;
+	hdr->offset = offset;
+	hdr->more = ( ( offset + len ) < FRAGMENT_TEST_LEN );
+	memcpy ( iob_put ( iobuf, len ), &fragment_test_data[offset], len );
+	iobuf = fragment_reassemble ( &fragment_test_reassembler, iobuf,
+				      &hdrlen );
+	if ( iobuf )
+		assert ( hdrlen == sizeof ( *hdr ) );
+	return iobuf;
+}
+
+/**
+ * Check reassembled test packet
+ *
+ * @v iobuf		Reassembled packet, or NULL
+ * @v ident		Expected identifier
+ * @ret ok		Packet is correct
+ */
+static int fragment_test_check ( struct io_buffer *iobuf,
+				 unsigned int ident ) {
+	struct fragment_test_header *hdr;
+	int ok;
+
+	if ( ! iobuf )
+		return 0;
+	hdr = iobuf->data;
+	ok = ( ( hdr->ident == ident ) && ( hdr->offset == 0 ) &&
+	       ( iob_len ( iobuf ) ==
+		 ( sizeof ( *hdr ) + FRAGMENT_TEST_LEN ) ) &&
+	       ( memcmp ( ( iobuf->data + sizeof ( *hdr ) ),
+			  fragment_test_data, FRAGMENT_TEST_LEN ) == 0 ) );
+	free_iob ( iobuf );
+	return ok;
+}
+
+/**
+ * Perform fragment reassembly self-tests
+ *
+ */
+static void fragment_test_exec ( void ) {
+	struct ip_statistics *stats = &fragment_test_stats;
+	unsigned int i;
+
+	/* Construct test data */
+	for ( i = 0 ; i < sizeof ( fragment_test_data ) ; i++ )
+		fragment_test_data[i] = ( i * 7 );
+
+	/* In-order fragments */
+	ok ( fragment_test_rx ( 1, 0, 16 ) == NULL );
+	ok ( fragment_test_rx ( 1, 16, 16 ) == NULL );
+	ok ( fragment_test_rx ( 1, 32, 16 ) == NULL );
+	ok ( fragment_test_check ( fragment_test_rx ( 1, 48, 16 ), 1 ) );
+	ok ( stats->reasm_oks == 1 );
+	ok ( stats->reasm_reorders == 0 );
+
+	/* Reversed fragments */
+	ok ( fragment_test_rx ( 2, 48, 16 ) == NULL );
+	ok ( fragment_test_rx ( 2, 32, 16 ) == NULL );
+	ok ( fragment_test_rx ( 2, 16, 16 ) == NULL );
+	ok ( fragment_test_check ( fragment_test_rx ( 2, 0, 16 ), 2 ) );
+	ok ( stats->reasm_oks == 2 );
+	ok ( stats->reasm_reorders == 4 );
+
+	/* Interleaved datagrams with duplicates */
+	ok ( fragment_test_rx ( 3, 0, 24 ) == NULL );
+	ok ( fragment_test_rx ( 4, 40, 24 ) == NULL );
+	ok ( fragment_test_rx ( 3, 40, 24 ) == NULL );
+	ok ( fragment_test_rx ( 4, 0, 24 ) == NULL );
+	ok ( fragment_test_rx ( 3, 8, 8 ) == NULL );
+	ok ( stats->reasm_duplicates == 1 );
+	ok ( fragment_test_check ( fragment_test_rx ( 4, 24, 16 ), 4 ) );
+	ok ( fragment_test_check ( fragment_test_rx ( 3, 24, 16 ), 3 ) );
+	ok ( stats->reasm_oks == 4 );
+	ok ( stats->reasm_fails == 0 );
+
+	/* Partially overlapping fragment */
+	ok ( fragment_test_rx ( 5, 0, 24 ) == NULL );
+	ok ( fragment_test_rx ( 5, 16, 24 ) == NULL );
+	ok ( stats->reasm_fails == 1 );
+	ok ( fragment_test_rx ( 5, 24, 24 ) == NULL );
+	ok ( fragment_test_check ( fragment_test_rx ( 5, 48, 16 ), 5 ) );
+
+	/* Memory limit */
+	for ( i = 0 ; ( fragment_test_reassembler.used +
+			( 2 * FRAGMENT_TEST_LEN ) ) < FRAGMENT_MAX_USED ; i++ )
+		ok ( fragment_test_rx ( ( 100 + i ), 0, 16 ) == NULL );
+	ok ( fragment_test_rx ( 6, 0, 16 ) == NULL );
+	ok ( fragment_test_rx ( 6, 16, 16 ) == NULL );
+	ok ( stats->reasm_evictions > 0 );
+	ok ( fragment_test_reassembler.used <= FRAGMENT_MAX_USED );
+	ok ( fragment_test_rx ( 6, 32, 16 ) == NULL );
+	ok ( fragment_test_check ( fragment_test_rx ( 6, 48, 16 ), 6 ) );
+	ok ( fragment_test_rx ( 100, 16, 48 ) == NULL );
+
+	/* Expire all outstanding reassemblies */
+	while ( ! list_empty ( &fragment_test_reassembler.list ) )
+		step();
+	ok ( fragment_test_reassembler.used == 0 );
+}
+
+/** Fragment reassembly self-test */
+struct self_test fragment_test __self_test = {
+	.name = "fragment",
+	.exec = fragment_test_exec,
+};
@@ -0,0 +1,300 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * AES-GCM tests
+ *
+ * These test vectors are provided in "The Galois/Counter Mode of
+ * Operation (GCM)" by McGrew and Viega, as referenced by NIST SP
+ * 800-38D.
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <assert.h>
+#include <string.h>
+#include <ipxe/aes.h>
+#include <ipxe/gcm.h>
+#include <ipxe/test.h>
+#include "cipher_test.h"
+
+/** AES-128-GCM Test Case 1 */
+CIPHER_AUTH_TEST ( gcm_128_1, &aes_gcm_algorithm,
+	KEY ( 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 ),
+	IV ( 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	     0x00, 0x00, 0x00, 0x00 ),
+	ADDITIONAL ( ),
+	PLAINTEXT ( ),
+	CIPHERTEXT ( ),
+	AUTH ( 0x58, 0xe2, 0xfc, 0xce, 0xfa, 0x7e, 0x30, 0x61,
+	       0x36, 0x7f, 0x1d, 0x57, 0xa4, 0xe7, 0x45, 0x5a ) );
+
+/** AES-128-GCM Test Case 2 */
+CIPHER_AUTH_TEST ( gcm_128_2, &aes_gcm_algorithm,
+	KEY ( 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 ),
+	IV ( 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	     0x00, 0x00, 0x00, 0x00 ),
+	ADDITIONAL ( ),
+	PLAINTEXT ( 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 ),
+	CIPHERTEXT ( 0x03, 0x88, 0xda, 0xce, 0x60, 0xb6, 0xa3, 0x92,
+		     0xf3, 0x28, 0xc2, 0xb9, 0x71, 0xb2, 0xfe, 0x78 ),
+	AUTH ( 0xab, 0x6e, 0x47, 0xd4, 0x2c, 0xec, 0x13, 0xbd,
+	       0xf5, 0x3a, 0x67, 0xb2, 0x12, 0x57, 0xbd, 0xdf ) );
+
+/** AES-128-GCM Test Case 3 */
+CIPHER_AUTH_TEST ( gcm_128_3, &aes_gcm_algorithm,
+	KEY ( 0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+	      0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08 ),
+	IV ( 0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad,
+	     0xde, 0xca, 0xf8, 0x88 ),
+	ADDITIONAL ( ),
+	PLAINTEXT ( 0xd9, 0x31, 0x32, 0x25, 0xf8, 0x84, 0x06, 0xe5,
+		    0xa5, 0x59, 0x09, 0xc5, 0xaf, 0xf5, 0x26, 0x9a,
+		    0x86, 0xa7, 0xa9, 0x53, 0x15, 0x34, 0xf7, 0xda,
+		    0x2e, 0x4c, 0x30, 0x3d, 0x8a, 0x31, 0x8a, 0x72,
+		    0x1c, 0x3c, 0x0c, 0x95, 0x95, 0x68, 0x09, 0x53,
+		    0x2f, 0xcf, 0x0e, 0x24, 0x49, 0xa6, 0xb5, 0x25,
+		    0xb1, 0x6a, 0xed, 0xf5, 0xaa, 0x0d, 0xe6, 0x57,
+		    0xba, 0x63, 0x7b, 0x39, 0x1a, 0xaf, 0xd2, 0x55 ),
+	CIPHERTEXT ( 0x42, 0x83, 0x1e, 0xc2, 0x21, 0x77, 0x74, 0x24,
+		     0x4b, 0x72, 0x21, 0xb7, 0x84, 0xd0, 0xd4, 0x9c,
+		     0xe3, 0xaa, 0x21, 0x2f, 0x2c, 0x02, 0xa4, 0xe0,
+		     0x35, 0xc1, 0x7e, 0x23, 0x29, 0xac, 0xa1, 0x2e,
+		     0x21, 0xd5, 0x14, 0xb2, 0x54, 0x66, 0x93, 0x1c,
+		     0x7d, 0x8f, 0x6a, 0x5a, 0xac, 0x84, 0xaa, 0x05,
+		     0x1b, 0xa3, 0x0b, 0x39, 0x6a, 0x0a, 0xac, 0x97,
+		     0x3d, 0x58, 0xe0, 0x91, 0x47, 0x3f, 0x59, 0x85 ),
+	AUTH ( 0x4d, 0x5c, 0x2a, 0xf3, 0x27, 0xcd, 0x64, 0xa6,
+	       0x2c, 0xf3, 0x5a, 0xbd, 0x2b, 0xa6, 0xfa, 0xb4 ) );
+
+/** AES-128-GCM Test Case 4 */
+CIPHER_AUTH_TEST ( gcm_128_4, &aes_gcm_algorithm,
+	KEY ( 0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+	      0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08 ),
+	IV ( 0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad,
+	     0xde, 0xca, 0xf8, 0x88 ),
+	ADDITIONAL ( 0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+		     0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+		     0xab, 0xad, 0xda, 0xd2 ),
+	PLAINTEXT ( 0xd9, 0x31, 0x32, 0x25, 0xf8, 0x84, 0x06, 0xe5,
+		    0xa5, 0x59, 0x09, 0xc5, 0xaf, 0xf5, 0x26, 0x9a,
+		    0x86, 0xa7, 0xa9, 0x53, 0x15, 0x34, 0xf7, 0xda,
+		    0x2e, 0x4c, 0x30, 0x3d, 0x8a, 0x31, 0x8a, 0x72,
+		    0x1c, 0x3c, 0x0c, 0x95, 0x95, 0x68, 0x09, 0x53,
+		    0x2f, 0xcf, 0x0e, 0x24, 0x49, 0xa6, 0xb5, 0x25,
+		    0xb1, 0x6a, 0xed, 0xf5, 0xaa, 0x0d, 0xe6, 0x57,
+		    0xba, 0x63, 0x7b, 0x39 ),
+	CIPHERTEXT ( 0x42, 0x83, 0x1e, 0xc2, 0x21, 0x77, 0x74, 0x24,
+		     0x4b, 0x72, 0x21, 0xb7, 0x84, 0xd0, 0xd4, 0x9c,
+		     0xe3, 0xaa, 0x21, 0x2f, 0x2c, 0x02, 0xa4, 0xe0,
+		     0x35, 0xc1, 0x7e, 0x23, 0x29, 0xac, 0xa1, 0x2e,
+		     0x21, 0xd5, 0x14, 0xb2, 0x54, 0x66, 0x93, 0x1c,
+		     0x7d, 0x8f, 0x6a, 0x5a, 0xac, 0x84, 0xaa, 0x05,
+		     0x1b, 0xa3, 0x0b, 0x39, 0x6a, 0x0a, 0xac, 0x97,
+		     0x3d, 0x58, 0xe0, 0x91 ),
+	AUTH ( 0x5b, 0xc9, 0x4f, 0xbc, 0x32, 0x21, 0xa5, 0xdb,
+	       0x94, 0xfa, 0xe9, 0x5a, 0xe7, 0x12, 0x1a, 0x47 ) );
+
+/** AES-256-GCM Test Case 13 */
+CIPHER_AUTH_TEST ( gcm_256_13, &aes_gcm_algorithm,
+	KEY ( 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 ),
+	IV ( 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	     0x00, 0x00, 0x00, 0x00 ),
+	ADDITIONAL ( ),
+	PLAINTEXT ( ),
+	CIPHERTEXT ( ),
+	AUTH ( 0x53, 0x0f, 0x8a, 0xfb, 0xc7, 0x45, 0x36, 0xb9,
+	       0xa9, 0x63, 0xb4, 0xf1, 0xc4, 0xcb, 0x73, 0x8b ) );
+
+/** AES-256-GCM Test Case 14 */
+CIPHER_AUTH_TEST ( gcm_256_14, &aes_gcm_algorithm,
+	KEY ( 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 ),
+	IV ( 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	     0x00, 0x00, 0x00, 0x00 ),
+	ADDITIONAL ( ),
+	PLAINTEXT ( 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 ),
+	CIPHERTEXT ( 0xce, 0xa7, 0x40, 0x3d, 0x4d, 0x60, 0x6b, 0x6e,
+		     0x07, 0x4e, 0xc5, 0xd3, 0xba, 0xf3, 0x9d, 0x18 ),
+	AUTH ( 0xd0, 0xd1, 0xc8, 0xa7, 0x99, 0x99, 0x6b, 0xf0,
+	       0x26, 0x5b, 0x98, 0xb5, 0xd4, 0x8a, 0xb9, 0x19 ) );
+
+/** AES-256-GCM Test Case 15 */
+CIPHER_AUTH_TEST ( gcm_256_15, &aes_gcm_algorithm,
+	KEY ( 0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+	      0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08,
+	      0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+	      0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08 ),
+	IV ( 0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad,
+	     0xde, 0xca, 0xf8, 0x88 ),
+	ADDITIONAL ( ),
+	PLAINTEXT ( 0xd9, 0x31, 0x32, 0x25, 0xf8, 0x84, 0x06, 0xe5,
+		    0xa5, 0x59, 0x09, 0xc5, 0xaf, 0xf5, 0x26, 0x9a,
+		    0x86, 0xa7, 0xa9, 0x53, 0x15, 0x34, 0xf7, 0xda,
+		    0x2e, 0x4c, 0x30, 0x3d, 0x8a, 0x31, 0x8a, 0x72,
+		    0x1c, 0x3c, 0x0c, 0x95, 0x95, 0x68, 0x09, 0x53,
+		    0x2f, 0xcf, 0x0e, 0x24, 0x49, 0xa6, 0xb5, 0x25,
+		    0xb1, 0x6a, 0xed, 0xf5, 0xaa, 0x0d, 0xe6, 0x57,
+		    0xba, 0x63, 0x7b, 0x39, 0x1a, 0xaf, 0xd2, 0x55 ),
+	CIPHERTEXT ( 0x52, 0x2d, 0xc1, 0xf0, 0x99, 0x56, 0x7d, 0x07,
+		     0xf4, 0x7f, 0x37, 0xa3, 0x2a, 0x84, 0x42, 0x7d,
+		     0x64, 0x3a, 0x8c, 0xdc, 0xbf, 0xe5, 0xc0, 0xc9,
+		     0x75, 0x98, 0xa2, 0xbd, 0x25, 0x55, 0xd1, 0xaa,
+		     0x8c, 0xb0, 0x8e, 0x48, 0x59, 0x0d, 0xbb, 0x3d,
+		     0xa7, 0xb0, 0x8b, 0x10, 0x56, 0x82, 0x88, 0x38,
+		     0xc5, 0xf6, 0x1e, 0x63, 0x93, 0xba, 0x7a, 0x0a,
+		     0xbc, 0xc9, 0xf6, 0x62, 0x89, 0x80, 0x15, 0xad ),
+	AUTH ( 0xb0, 0x94, 0xda, 0xc5, 0xd9, 0x34, 0x71, 0xbd,
+	       0xec, 0x1a, 0x50, 0x22, 0x70, 0xe3, 0xcc, 0x6c ) );
+
+/** AES-256-GCM Test Case 16 */
+CIPHER_AUTH_TEST ( gcm_256_16, &aes_gcm_algorithm,
+	KEY ( 0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+	      0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08,
+	      0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+	      0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08 ),
+	IV ( 0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad,
+	     0xde, 0xca, 0xf8, 0x88 ),
+	ADDITIONAL ( 0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+		     0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+		     0xab, 0xad, 0xda, 0xd2 ),
+	PLAINTEXT ( 0xd9, 0x31, 0x32, 0x25, 0xf8, 0x84, 0x06, 0xe5,
+		    0xa5, 0x59, 0x09, 0xc5, 0xaf, 0xf5, 0x26, 0x9a,
+		    0x86, 0xa7, 0xa9, 0x53, 0x15, 0x34, 0xf7, 0xda,
+		    0x2e, 0x4c, 0x30, 0x3d, 0x8a, 0x31, 0x8a, 0x72,
+		    0x1c, 0x3c, 0x0c, 0x95, 0x95, 0x68, 0x09, 0x53,
+		    0x2f, 0xcf, 0x0e, 0x24, 0x49, 0xa6, 0xb5, 0x25,
+		    0xb1, 0x6a, 0xed, 0xf5, 0xaa, 0x0d, 0xe6, 0x57,
+		    0xba, 0x63, 0x7b, 0x39 ),
+	CIPHERTEXT ( 0x52, 0x2d, 0xc1, 0xf0, 0x99, 0x56, 0x7d, 0x07,
+		     0xf4, 0x7f, 0x37, 0xa3, 0x2a, 0x84, 0x42, 0x7d,
+		     0x64, 0x3a, 0x8c, 0xdc, 0xbf, 0xe5, 0xc0, 0xc9,
+		     0x75, 0x98, 0xa2, 0xbd, 0x25, 0x55, 0xd1, 0xaa,
+		     0x8c, 0xb0, 0x8e, 0x48, 0x59, 0x0d, 0xbb, 0x3d,
+		     0xa7, 0xb0, 0x8b, 0x10, 0x56, 0x82, 0x88, 0x38,
+		     0xc5, 0xf6, 0x1e, 0x63, 0x93, 0xba, 0x7a, 0x0a,
+		     0xbc, 0xc9, 0xf6, 0x62 ),
+	AUTH ( 0x76, 0xfc, 0x6e, 0xce, 0x0f, 0x4e, 0x17, 0x68,
+	       0xcd, 0xdf, 0x88, 0x53, 0xbb, 0x2d, 0x55, 0x1b ) );
+
+/**
+ * Report a fragmented GCM encryption test result
+ *
+ * @v test		Cipher test
+ * @v frag_len		Fragment length
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void gcm_fragment_okx ( struct cipher_test *test, size_t frag_len,
+			       const char *file, unsigned int line ) {
+	struct cipher_algorithm *cipher = test->cipher;
+	uint8_t ctx[cipher->ctxsize];
+	uint8_t ciphertext[test->len];
+	uint8_t auth[cipher->authsize];
+	size_t offset;
+	size_t len;
+
+	/* Initialise cipher */
+	okx ( cipher_setkey ( cipher, ctx, test->key, test->key_len ) == 0,
+	      file, line );
+	cipher_setiv ( cipher, ctx, test->iv );
+
+	/* Process additional data in fragments */
+	for ( offset = 0 ; offset < test->additional_len ; offset += len ) {
+		len = ( test->additional_len - offset );
+		if ( len > frag_len )
+			len = frag_len;
+		cipher_encrypt ( cipher, ctx, ( test->additional + offset ),
+				 NULL, len );
+	}
+
+	/* Encrypt data in fragments */
+	for ( offset = 0 ; offset < test->len ; offset += len ) {
+		len = ( test->len - offset );
+		if ( len > frag_len )
+			len = frag_len;
+		cipher_encrypt ( cipher, ctx, ( test->plaintext + offset ),
+				 ( ciphertext + offset ), len );
+	}
+	cipher_auth ( cipher, ctx, auth );
+
+	/* Compare against expected ciphertext and authentication tag */
+	okx ( memcmp ( ciphertext, test->ciphertext, test->len ) == 0,
+	      file, line );
+	okx ( memcmp ( auth, test->auth, sizeof ( auth ) ) == 0, file, line );
+}
+#define gcm_fragment_ok( test, frag_len ) \
+	gcm_fragment_okx ( test, frag_len, __FILE__, __LINE__ )
+
+/**
+ * Perform AES-GCM self-test
+ *
+ */
+static void gcm_test_exec ( void ) {
+	struct cipher_algorithm *gcm = &aes_gcm_algorithm;
+	unsigned int keylen;
+
+	/* Correctness tests */
+	cipher_ok ( &gcm_128_1 );
+	cipher_ok ( &gcm_128_2 );
+	cipher_ok ( &gcm_128_3 );
+	cipher_ok ( &gcm_128_4 );
+	cipher_ok ( &gcm_256_13 );
+	cipher_ok ( &gcm_256_14 );
+	cipher_ok ( &gcm_256_15 );
+	cipher_ok ( &gcm_256_16 );
+
+	/* Fragmentation tests */
+	gcm_fragment_ok ( &gcm_128_4, 1 );
+	gcm_fragment_ok ( &gcm_128_4, 7 );
+	gcm_fragment_ok ( &gcm_256_16, 13 );
+	gcm_fragment_ok ( &gcm_256_16, 17 );
+
+	/* Speed tests */
+	for ( keylen = 128 ; keylen <= 256 ; keylen += 128 ) {
+		DBG ( "AES-%d-GCM encryption required %ld cycles per byte\n",
+		      keylen, cipher_cost_encrypt ( gcm, ( keylen / 8 ) ) );
+		DBG ( "AES-%d-GCM decryption required %ld cycles per byte\n",
+		      keylen, cipher_cost_decrypt ( gcm, ( keylen / 8 ) ) );
+	}
+}
+
+/** AES-GCM self-test */
+struct self_test gcm_test __self_test = {
+	.name = "gcm",
+	.exec = gcm_test_exec,
+};
@@ -0,0 +1,430 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * gzip tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ipxe/umalloc.h>
+#include <ipxe/gzip.h>
+#include <ipxe/gzipenc.h>
+#include <ipxe/test.h>
+
+/** A gzip test */
+struct gzip_test {
+	/** Compressed data */
+	const void *compressed;
+	/** Length of compressed data */
+	size_t compressed_len;
+	/** Expected uncompressed data */
+	const void *expected;
+	/** Length of expected uncompressed data */
+	size_t expected_len;
+};
+
+/** A gzip fragment list */
+struct gzip_test_fragments {
+	/** Fragment lengths */
+	size_t len[8];
+};
+
+/** Define inline data */
+#define DATA(...) { __VA_ARGS__ }
+
+/** Define a gzip test */
+#define GZIP( name, COMPRESSED, EXPECTED )				\
+	static const uint8_t name ## _compressed[] = COMPRESSED;	\
+	static const uint8_t name ## _expected[] = EXPECTED;		\
+	static struct gzip_test name = {				\
+		.compressed = name ## _compressed,			\
+		.compressed_len = sizeof ( name ## _compressed ),	\
+		.expected = name ## _expected,				\
+		.expected_len = sizeof ( name ## _expected ),		\
+	};
+
+/* Empty file */
+GZIP ( empty,
+	  DATA ( 0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03,
+		 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 ),
+	  DATA() );
+
+/* "Hello world" */
+GZIP ( hello_world,
+	  DATA ( 0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03,
+		 0xf3, 0x48, 0xcd, 0xc9, 0xc9, 0x57, 0x28, 0xcf, 0x2f, 0xca,
+		 0x49, 0x01, 0x00, 0x52, 0x9e, 0xd6, 0x8b, 0x0b, 0x00, 0x00,
+		 0x00 ),
+	  DATA ( 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c,
+		 0x64 ) );
+
+/* "Hello world" with original file name */
+GZIP ( named,
+	  DATA ( 0x1f, 0x8b, 0x08, 0x08, 0x00, 0x00, 0x00, 0x6a, 0x00, 0x03,
+		 0x68, 0x65, 0x6c, 0x6c, 0x6f, 0x2e, 0x74, 0x78, 0x74, 0x00,
+		 0xf3, 0x48, 0xcd, 0xc9, 0xc9, 0x57, 0x28, 0xcf, 0x2f, 0xca,
+		 0x49, 0x01, 0x00, 0x52, 0x9e, 0xd6, 0x8b, 0x0b, 0x00, 0x00,
+		 0x00 ),
+	  DATA ( 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c,
+		 0x64 ) );
+
+/* "iPXE" with all optional header fields */
+GZIP ( optional,
+	  DATA ( 0x1f, 0x8b, 0x08, 0x1e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03,
+		 0x06, 0x00, 0x69, 0x70, 0x02, 0x00, 0x78, 0x65, 0x69, 0x70,
+		 0x78, 0x65, 0x00, 0x69, 0x50, 0x58, 0x45, 0x00, 0xb9, 0x52,
+		 0xcb, 0x0c, 0x88, 0x70, 0x05, 0x00, 0x66, 0x2b, 0x02, 0x7f,
+		 0x04, 0x00, 0x00, 0x00 ),
+	  DATA ( 0x69, 0x50, 0x58, 0x45 ) );
+
+/* "Hello world" and "iPXE" as separate members */
+GZIP ( multi,
+	  DATA ( 0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03,
+		 0xf3, 0x48, 0xcd, 0xc9, 0xc9, 0x57, 0x28, 0xcf, 0x2f, 0xca,
+		 0x49, 0x01, 0x00, 0x52, 0x9e, 0xd6, 0x8b, 0x0b, 0x00, 0x00,
+		 0x00, 0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		 0x03, 0xcb, 0x0c, 0x88, 0x70, 0x05, 0x00, 0x66, 0x2b, 0x02,
+		 0x7f, 0x04, 0x00, 0x00, 0x00 ),
+	  DATA ( 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c,
+		 0x64, 0x69, 0x50, 0x58, 0x45 ) );
+
+/* "This specification defines a lossless compressed data format" */
+GZIP ( rfc_sentence,
+	  DATA ( 0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03,
+		 0x0d, 0xc6, 0xdb, 0x09, 0x00, 0x21, 0x0c, 0x04, 0xc0, 0x56,
+		 0xb6, 0x28, 0x1b, 0x08, 0x79, 0x70, 0x01, 0x35, 0xe2, 0xa6,
+		 0x7f, 0xce, 0xf9, 0x9a, 0xf1, 0x25, 0xc1, 0xe3, 0x9a, 0x91,
+		 0x2a, 0x9d, 0xb5, 0x61, 0x1e, 0xb9, 0x9d, 0x10, 0xcc, 0x22,
+		 0xa7, 0x93, 0xd0, 0x5a, 0xe7, 0xbe, 0xb8, 0xc1, 0xa4, 0x05,
+		 0x51, 0x77, 0x49, 0xff, 0x5e, 0xca, 0xe0, 0x2a, 0x3c, 0x00,
+		 0x00, 0x00 ),
+	  DATA ( 0x54, 0x68, 0x69, 0x73, 0x20, 0x73, 0x70, 0x65, 0x63, 0x69,
+		 0x66, 0x69, 0x63, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x20, 0x64,
+		 0x65, 0x66, 0x69, 0x6e, 0x65, 0x73, 0x20, 0x61, 0x20, 0x6c,
+		 0x6f, 0x73, 0x73, 0x6c, 0x65, 0x73, 0x73, 0x20, 0x63, 0x6f,
+		 0x6d, 0x70, 0x72, 0x65, 0x73, 0x73, 0x65, 0x64, 0x20, 0x64,
+		 0x61, 0x74, 0x61, 0x20, 0x66, 0x6f, 0x72, 0x6d, 0x61, 0x74 ) );
+
+/* Lorem ipsum */
+GZIP ( lorem,
+	  DATA ( 0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03,
+		 0x25, 0x8f, 0x51, 0x8e, 0x03, 0x31, 0x08, 0x43, 0xaf, 0xe2,
+		 0x03, 0x54, 0x3d, 0x49, 0x7f, 0xf7, 0x00, 0x34, 0x41, 0x95,
+		 0xa5, 0x10, 0x66, 0x02, 0x59, 0xed, 0xf1, 0x97, 0xe9, 0xfc,
+		 0x81, 0xb0, 0x9f, 0xcd, 0xcb, 0x97, 0x1a, 0x78, 0xc4, 0x36,
+		 0x74, 0x1f, 0xbe, 0x10, 0x4c, 0x88, 0x69, 0x3e, 0xd0, 0x7c,
+		 0x86, 0xb6, 0xd4, 0xdc, 0x0b, 0xd2, 0x79, 0x30, 0x1a, 0xe7,
+		 0x07, 0x3a, 0x58, 0xc7, 0xd0, 0x5e, 0x06, 0x28, 0x77, 0x98,
+		 0x77, 0xa4, 0xda, 0x51, 0x66, 0xce, 0xc6, 0xce, 0xbe, 0x67,
+		 0x62, 0x27, 0x86, 0xbc, 0x0b, 0x0f, 0xcd, 0x1b, 0xad, 0x30,
+		 0xf9, 0x4c, 0x81, 0x0c, 0x9e, 0x5b, 0x9e, 0xf8, 0x49, 0xe8,
+		 0xa4, 0x15, 0x1b, 0xc6, 0x6b, 0xf8, 0xad, 0x55, 0xec, 0x81,
+		 0x73, 0x33, 0x30, 0x3d, 0x72, 0xed, 0x0e, 0xfd, 0xd3, 0xd5,
+		 0x98, 0x92, 0xf4, 0x89, 0x3d, 0x86, 0x58, 0xf3, 0x9b, 0x7c,
+		 0x89, 0x18, 0xbc, 0x92, 0xbe, 0x48, 0x1e, 0x25, 0x86, 0x4a,
+		 0x15, 0xb7, 0xea, 0xe4, 0xf7, 0x03, 0x15, 0x95, 0xcf, 0x7f,
+		 0xc9, 0xf2, 0xee, 0x0d, 0xe7, 0x00, 0x00, 0x00 ),
+	  DATA ( 0x4c, 0x6f, 0x72, 0x65, 0x6d, 0x20, 0x69, 0x70, 0x73, 0x75,
+		 0x6d, 0x20, 0x64, 0x6f, 0x6c, 0x6f, 0x72, 0x20, 0x73, 0x69,
+		 0x74, 0x20, 0x61, 0x6d, 0x65, 0x74, 0x2c, 0x20, 0x63, 0x6f,
+		 0x6e, 0x73, 0x65, 0x63, 0x74, 0x65, 0x74, 0x75, 0x72, 0x20,
+		 0x61, 0x64, 0x69, 0x70, 0x69, 0x73, 0x63, 0x69, 0x6e, 0x67,
+		 0x20, 0x65, 0x6c, 0x69, 0x74, 0x2c, 0x20, 0x73, 0x65, 0x64,
+		 0x20, 0x64, 0x6f, 0x20, 0x65, 0x69, 0x75, 0x73, 0x6d, 0x6f,
+		 0x64, 0x20, 0x74, 0x65, 0x6d, 0x70, 0x6f, 0x72, 0x20, 0x69,
+		 0x6e, 0x63, 0x69, 0x64, 0x69, 0x64, 0x75, 0x6e, 0x74, 0x20,
+		 0x75, 0x74, 0x20, 0x6c, 0x61, 0x62, 0x6f, 0x72, 0x65, 0x20,
+		 0x65, 0x74, 0x20, 0x64, 0x6f, 0x6c, 0x6f, 0x72, 0x65, 0x20,
+		 0x6d, 0x61, 0x67, 0x6e, 0x61, 0x20, 0x61, 0x6c, 0x69, 0x71,
+		 0x75, 0x61, 0x2e, 0x20, 0x55, 0x74, 0x20, 0x65, 0x6e, 0x69,
+		 0x6d, 0x20, 0x61, 0x64, 0x20, 0x6d, 0x69, 0x6e, 0x69, 0x6d,
+		 0x20, 0x76, 0x65, 0x6e, 0x69, 0x61, 0x6d, 0x2c, 0x20, 0x71,
+		 0x75, 0x69, 0x73, 0x20, 0x6e, 0x6f, 0x73, 0x74, 0x72, 0x75,
+		 0x64, 0x20, 0x65, 0x78, 0x65, 0x72, 0x63, 0x69, 0x74, 0x61,
+		 0x74, 0x69, 0x6f, 0x6e, 0x20, 0x75, 0x6c, 0x6c, 0x61, 0x6d,
+		 0x63, 0x6f, 0x20, 0x6c, 0x61, 0x62, 0x6f, 0x72, 0x69, 0x73,
+		 0x20, 0x6e, 0x69, 0x73, 0x69, 0x20, 0x75, 0x74, 0x20, 0x61,
+		 0x6c, 0x69, 0x71, 0x75, 0x69, 0x70, 0x20, 0x65, 0x78, 0x20,
+		 0x65, 0x61, 0x20, 0x63, 0x6f, 0x6d, 0x6d, 0x6f, 0x64, 0x6f,
+		 0x20, 0x63, 0x6f, 0x6e, 0x73, 0x65, 0x71, 0x75, 0x61, 0x74,
+		 0x2e ) );
+
+/* "Hello world" with corrupted CRC */
+GZIP ( bad_crc,
+	  DATA ( 0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03,
+		 0xf3, 0x48, 0xcd, 0xc9, 0xc9, 0x57, 0x28, 0xcf, 0x2f, 0xca,
+		 0x49, 0x01, 0x00, 0x53, 0x9e, 0xd6, 0x8b, 0x0b, 0x00, 0x00,
+		 0x00 ),
+	  DATA ( 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c,
+		 0x64 ) );
+
+/* "Hello world" with corrupted length */
+GZIP ( bad_len,
+	  DATA ( 0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03,
+		 0xf3, 0x48, 0xcd, 0xc9, 0xc9, 0x57, 0x28, 0xcf, 0x2f, 0xca,
+		 0x49, 0x01, 0x00, 0x52, 0x9e, 0xd6, 0x8b, 0x0a, 0x00, 0x00,
+		 0x00 ),
+	  DATA ( 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c,
+		 0x64 ) );
+
+/* "Hello world" with unsupported compression method */
+GZIP ( bad_method,
+	  DATA ( 0x1f, 0x8b, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03,
+		 0xf3, 0x48, 0xcd, 0xc9, 0xc9, 0x57, 0x28, 0xcf, 0x2f, 0xca,
+		 0x49, 0x01, 0x00, 0x52, 0x9e, 0xd6, 0x8b, 0x0b, 0x00, 0x00,
+		 0x00 ),
+	  DATA ( 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c,
+		 0x64 ) );
+
+/* Lorem ipsum fragment list */
+static struct gzip_test_fragments lorem_fragments[] = {
+	{ { 0, 1, 5, -1UL, } },
+	{ { 0, 0, 1, 0, 0, 1, -1UL } },
+	{ { 10, 8, 4, 7, 11, -1UL } },
+	{ { 1, 1, 1, 1, 1, 1, 1, -1UL } },
+	{ { 100, -1UL } },
+};
+
+/**
+ * Report gzip test result
+ *
+ * @v gzip		Decompressor
+ * @v test		gzip test
+ * @v frags		Fragment list, or NULL
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void gzip_okx ( struct gzip *gzip, struct gzip_test *test,
+		       struct gzip_test_fragments *frags,
+		       const char *file, unsigned int line ) {
+	struct deflate_chunk in;
+	struct deflate_chunk out;
+	userptr_t data;
+	size_t frag_len = -1UL;
+	size_t offset = 0;
+	size_t remaining = test->compressed_len;
+	unsigned int i;
+
+	/* Allocate output buffer */
+	data = umalloc ( test->expected_len + DECOMPRESS_SPACE );
+	okx ( data != UNULL, file, line );
+	if ( ! data )
+		return;
+
+	/* Initialise decompressor */
+	gzip_init ( gzip );
+
+	/* Initialise output chunk */
+	deflate_chunk_init ( &out, data, 0,
+			     ( test->expected_len + DECOMPRESS_SPACE ) );
+
+	/* Process input (in fragments, if applicable) */
+	for ( i = 0 ; i < ( sizeof ( frags->len ) /
+			    sizeof ( frags->len[0] ) ) ; i++ ) {
+
+		/* Initialise input chunk */
+		if ( frags )
+			frag_len = frags->len[i];
+		if ( frag_len > remaining )
+			frag_len = remaining;
+		deflate_chunk_init ( &in, virt_to_user ( test->compressed ),
+				     offset, ( offset + frag_len ) );
+
+		/* Decompress this fragment */
+		okx ( gzip_inflate ( gzip, &in, &out ) == 0, file, line );
+		okx ( in.len == ( offset + frag_len ), file, line );
+		okx ( in.offset == in.len, file, line );
+
+		/* Move to next fragment */
+		offset = in.offset;
+		remaining -= frag_len;
+		if ( ! remaining )
+			break;
+
+		/* Check that decompression has not terminated early */
+		okx ( ! gzip_finished ( gzip ), file, line );
+	}
+
+	/* Check decompression has terminated as expected */
+	okx ( gzip_finished ( gzip ), file, line );
+	okx ( offset == test->compressed_len, file, line );
+	okx ( out.offset == test->expected_len, file, line );
+	okx ( memcmp ( user_to_virt ( data, 0 ), test->expected,
+		       test->expected_len ) == 0, file, line );
+
+	ufree ( data );
+}
+#define gzip_ok( gzip, test, frags ) \
+	gzip_okx ( gzip, test, frags, __FILE__, __LINE__ )
+
+/**
+ * Report gzip failure test result
+ *
+ * @v gzip		Decompressor
+ * @v test		gzip test
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void gzip_fail_okx ( struct gzip *gzip, struct gzip_test *test,
+			    const char *file, unsigned int line ) {
+	struct deflate_chunk in;
+	struct deflate_chunk out;
+	userptr_t data;
+
+	/* Allocate output buffer */
+	data = umalloc ( test->expected_len + DECOMPRESS_SPACE );
+	okx ( data != UNULL, file, line );
+	if ( ! data )
+		return;
+
+	/* Initialise decompressor */
+	gzip_init ( gzip );
+
+	/* Check that decompression fails */
+	deflate_chunk_init ( &in, virt_to_user ( test->compressed ), 0,
+			     test->compressed_len );
+	deflate_chunk_init ( &out, data, 0,
+			     ( test->expected_len + DECOMPRESS_SPACE ) );
+	okx ( gzip_inflate ( gzip, &in, &out ) != 0, file, line );
+
+	ufree ( data );
+}
+#define gzip_fail_ok( gzip, test ) \
+	gzip_fail_okx ( gzip, test, __FILE__, __LINE__ )
+
+/**
+ * Report gzip compression test result
+ *
+ * @v gzip		Decompressor
+ * @v data		Uncompressed data
+ * @v len		Length of uncompressed data
+ * @v split		Length of first portion of uncompressed data
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void gzip_encode_okx ( struct gzip *gzip, const void *data, size_t len,
+			      size_t split, const char *file,
+			      unsigned int line ) {
+	struct gzip_encoder *enc;
+	struct gzip_test test;
+	uint8_t *compressed;
+	size_t compressed_len;
+
+	/* Allocate compressor and output buffer */
+	enc = malloc ( sizeof ( *enc ) );
+	okx ( enc != NULL, file, line );
+	compressed = malloc ( gzip_encode_max_len ( split ) +
+			      gzip_encode_max_len ( len - split ) );
+	okx ( compressed != NULL, file, line );
+	if ( ! ( enc && compressed ) )
+		goto err_alloc;
+
+	/* Compress data in two portions */
+	gzip_encode_init ( enc );
+	compressed_len = gzip_encode ( enc, data, split, compressed, 0 );
+	okx ( compressed_len <= gzip_encode_max_len ( split ), file, line );
+	compressed_len += gzip_encode ( enc, ( data + split ), ( len - split ),
+					( compressed + compressed_len ), 1 );
+	okx ( compressed_len <= ( gzip_encode_max_len ( split ) +
+				  gzip_encode_max_len ( len - split ) ),
+	      file, line );
+
+	/* Check that compressed data decompresses correctly */
+	test.compressed = compressed;
+	test.compressed_len = compressed_len;
+	test.expected = data;
+	test.expected_len = len;
+	gzip_okx ( gzip, &test, NULL, file, line );
+
+ err_alloc:
+	free ( compressed );
+	free ( enc );
+}
+#define gzip_encode_ok( gzip, data, len, split ) \
+	gzip_encode_okx ( gzip, data, len, split, __FILE__, __LINE__ )
+
+/**
+ * Perform gzip self-test
+ *
+ */
+static void gzip_test_exec ( void ) {
+	static uint8_t pattern[65536];
+	struct gzip *gzip;
+	unsigned int i;
+
+	/* Allocate shared structure */
+	gzip = malloc ( sizeof ( *gzip ) );
+	ok ( gzip != NULL );
+
+	/* Perform self-tests */
+	if ( gzip ) {
+
+		/* Test as a single pass */
+		gzip_ok ( gzip, &empty, NULL );
+		gzip_ok ( gzip, &hello_world, NULL );
+		gzip_ok ( gzip, &named, NULL );
+		gzip_ok ( gzip, &optional, NULL );
+		gzip_ok ( gzip, &multi, NULL );
+		gzip_ok ( gzip, &rfc_sentence, NULL );
+		gzip_ok ( gzip, &lorem, NULL );
+
+		/* Test fragmentation */
+		for ( i = 0 ; i < ( sizeof ( lorem_fragments ) /
+				    sizeof ( lorem_fragments[0] ) ) ; i++ ) {
+			gzip_ok ( gzip, &lorem, &lorem_fragments[i] );
+		}
+
+		/* Test failure cases */
+		gzip_fail_ok ( gzip, &bad_crc );
+		gzip_fail_ok ( gzip, &bad_len );
+		gzip_fail_ok ( gzip, &bad_method );
+
+		/* Test compression */
+		gzip_encode_ok ( gzip, NULL, 0, 0 );
+		gzip_encode_ok ( gzip, lorem.expected, lorem.expected_len,
+				 lorem.expected_len );
+		gzip_encode_ok ( gzip, lorem.expected, lorem.expected_len,
+				 ( lorem.expected_len / 3 ) );
+		for ( i = 0 ; i < sizeof ( pattern ) ; i++ )
+			pattern[i] = ( ( i * i ) >> ( i & 7 ) );
+		gzip_encode_ok ( gzip, pattern, sizeof ( pattern ), 40000 );
+	}
+
+	/* Free shared structure */
+	free ( gzip );
+}
+
+/** gzip self-test */
+struct self_test gzip_test __self_test = {
+	.name = "gzip",
+	.exec = gzip_test_exec,
+};
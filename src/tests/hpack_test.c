@@ -0,0 +1,315 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * HPACK header compression self-tests
+ *
+ * Decoding test vectors are taken from RFC 7541 Appendix C.
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <ipxe/hpack.h>
+#include <ipxe/test.h>
+
+/** Define inline data */
+#define DATA(...) { __VA_ARGS__ }
+
+/** An HPACK decoding test */
+struct hpack_decode_test {
+	/** Header block */
+	const void *data;
+	/** Length of header block */
+	size_t len;
+	/** Expected decoded header fields ("name: value\n" for each) */
+	const char *headers;
+	/** Expected dynamic table size after decoding */
+	size_t used;
+};
+
+/** Define an HPACK decoding test */
+#define HPACK_DECODE( name, DATA, HEADERS, USED )			\
+	static const uint8_t name ## _data[] = DATA;			\
+	static struct hpack_decode_test name = {			\
+		.data = name ## _data,					\
+		.len = sizeof ( name ## _data ),			\
+		.headers = HEADERS,					\
+		.used = USED,						\
+	}
+
+/** An HPACK encoding test */
+struct hpack_encode_test {
+	/** Name */
+	const char *name;
+	/** Value */
+	const char *value;
+	/** Expected encoding */
+	const void *data;
+	/** Length of expected encoding */
+	size_t len;
+};
+
+/** Define an HPACK encoding test */
+#define HPACK_ENCODE( test, NAME, VALUE, DATA )				\
+	static const uint8_t test ## _data[] = DATA;			\
+	static struct hpack_encode_test test = {			\
+		.name = NAME,						\
+		.value = VALUE,						\
+		.data = test ## _data,					\
+		.len = sizeof ( test ## _data ),			\
+	}
+
+/** RFC 7541 C.4.1: First request (with Huffman coding) */
+HPACK_DECODE ( request1,
+	DATA ( 0x82, 0x86, 0x84, 0x41, 0x8c, 0xf1, 0xe3, 0xc2, 0xe5, 0xf2,
+	       0x3a, 0x6b, 0xa0, 0xab, 0x90, 0xf4, 0xff ),
+	":method: GET\n:scheme: http\n:path: /\n"
+	":authority: www.example.com\n", 57 );
+
+/** RFC 7541 C.4.2: Second request (with Huffman coding) */
+HPACK_DECODE ( request2,
+	DATA ( 0x82, 0x86, 0x84, 0xbe, 0x58, 0x86, 0xa8, 0xeb, 0x10, 0x64,
+	       0x9c, 0xbf ),
+	":method: GET\n:scheme: http\n:path: /\n"
+	":authority: www.example.com\ncache-control: no-cache\n", 110 );
+
+/** RFC 7541 C.4.3: Third request (with Huffman coding) */
+HPACK_DECODE ( request3,
+	DATA ( 0x82, 0x87, 0x85, 0xbf, 0x40, 0x88, 0x25, 0xa8, 0x49, 0xe9,
+	       0x5b, 0xa9, 0x7d, 0x7f, 0x89, 0x25, 0xa8, 0x49, 0xe9, 0x5b,
+	       0xb8, 0xe8, 0xb4, 0xbf ),
+	":method: GET\n:scheme: https\n:path: /index.html\n"
+	":authority: www.example.com\ncustom-key: custom-value\n", 164 );
+
+/** RFC 7541 C.6.1: First response (with Huffman coding) */
+HPACK_DECODE ( response1,
+	DATA ( 0x48, 0x82, 0x64, 0x02, 0x58, 0x85, 0xae, 0xc3, 0x77, 0x1a,
+	       0x4b, 0x61, 0x96, 0xd0, 0x7a, 0xbe, 0x94, 0x10, 0x54, 0xd4,
+	       0x44, 0xa8, 0x20, 0x05, 0x95, 0x04, 0x0b, 0x81, 0x66, 0xe0,
+	       0x82, 0xa6, 0x2d, 0x1b, 0xff, 0x6e, 0x91, 0x9d, 0x29, 0xad,
+	       0x17, 0x18, 0x63, 0xc7, 0x8f, 0x0b, 0x97, 0xc8, 0xe9, 0xae,
+	       0x82, 0xae, 0x43, 0xd3 ),
+	":status: 302\ncache-control: private\n"
+	"date: Mon, 21 Oct 2013 20:13:21 GMT\n"
+	"location: https://www.example.com\n", 222 );
+
+/** RFC 7541 C.6.2: Second response (with Huffman coding and eviction) */
+HPACK_DECODE ( response2,
+	DATA ( 0x48, 0x83, 0x64, 0x0e, 0xff, 0xc1, 0xc0, 0xbf ),
+	":status: 307\ncache-control: private\n"
+	"date: Mon, 21 Oct 2013 20:13:21 GMT\n"
+	"location: https://www.example.com\n", 222 );
+
+/** RFC 7541 C.6.3: Third response (with Huffman coding and eviction) */
+HPACK_DECODE ( response3,
+	DATA ( 0x88, 0xc1, 0x61, 0x96, 0xd0, 0x7a, 0xbe, 0x94, 0x10, 0x54,
+	       0xd4, 0x44, 0xa8, 0x20, 0x05, 0x95, 0x04, 0x0b, 0x81, 0x66,
+	       0xe0, 0x84, 0xa6, 0x2d, 0x1b, 0xff, 0xc0, 0x5a, 0x83, 0x9b,
+	       0xd9, 0xab, 0x77, 0xad, 0x94, 0xe7, 0x82, 0x1d, 0xd7, 0xf2,
+	       0xe6, 0xc7, 0xb3, 0x35, 0xdf, 0xdf, 0xcd, 0x5b, 0x39, 0x60,
+	       0xd5, 0xaf, 0x27, 0x08, 0x7f, 0x36, 0x72, 0xc1, 0xab, 0x27,
+	       0x0f, 0xb5, 0x29, 0x1f, 0x95, 0x87, 0x31, 0x60, 0x65, 0xc0,
+	       0x03, 0xed, 0x4e, 0xe5, 0xb1, 0x06, 0x3d, 0x50, 0x07 ),
+	":status: 200\ncache-control: private\n"
+	"date: Mon, 21 Oct 2013 20:13:22 GMT\n"
+	"location: https://www.example.com\ncontent-encoding: gzip\n"
+	"set-cookie: foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; "
+	"version=1\n", 215 );
+
+/** Dynamic table index beyond end of table */
+HPACK_DECODE ( bad_index, DATA ( 0xc0 ), NULL, 0 );
+
+/** Huffman-coded string with invalid padding */
+HPACK_DECODE ( bad_padding, DATA ( 0x40, 0x81, 0x00, 0x80 ), NULL, 0 );
+
+/** Truncated string */
+HPACK_DECODE ( bad_string, DATA ( 0x00, 0x05, 'a', 'b' ), NULL, 0 );
+
+/** Oversized dynamic table size update */
+HPACK_DECODE ( bad_size, DATA ( 0x3f, 0xe2, 0x1f ), NULL, 0 );
+
+/** Fully indexed header field */
+HPACK_ENCODE ( encode_indexed, ":method", "GET", DATA ( 0x82 ) );
+
+/** Header field with indexed name */
+HPACK_ENCODE ( encode_name, ":path", "/boot.ipxe",
+	DATA ( 0x04, 0x0a, '/', 'b', 'o', 'o', 't', '.', 'i', 'p', 'x', 'e' ) );
+
+/** Header field with indexed name (converted to lower case) */
+HPACK_ENCODE ( encode_lower, "User-Agent", "iPXE 1.0",
+	DATA ( 0x0f, 0x2b, 0x08, 'i', 'P', 'X', 'E', ' ', '1', '.', '0' ) );
+
+/** Header field with literal name (converted to lower case) */
+HPACK_ENCODE ( encode_literal, "X-Custom", "A",
+	DATA ( 0x00, 0x08, 'x', '-', 'c', 'u', 's', 't', 'o', 'm',
+	       0x01, 'A' ) );
+
+/** Decoded header fields */
+struct hpack_test_headers {
+	/** Buffer */
+	char buf[256];
+	/** Used length */
+	size_t len;
+};
+
+/**
+ * Record decoded header field
+ *
+ * @v opaque		Decoded header fields
+ * @v name		Name
+ * @v value		Value
+ * @ret rc		Return status code
+ */
+static int hpack_test_header ( void *opaque, const char *name,
+			       const char *value ) {
+	struct hpack_test_headers *headers = opaque;
+	size_t remaining = ( sizeof ( headers->buf ) - headers->len );
+	size_t len;
+
+	len = snprintf ( ( headers->buf + headers->len ), remaining,
+			 "%s: %s\n", name, value );
+	assert ( len < remaining );
+	headers->len += len;
+
+	return 0;
+}
+
+/**
+ * Report an HPACK decoding test result
+ *
+ * @v table		Dynamic table
+ * @v test		HPACK decoding test
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void hpack_decode_okx ( struct hpack_table *table,
+			       struct hpack_decode_test *test,
+			       const char *file, unsigned int line ) {
+	struct hpack_test_headers headers;
+
+	headers.len = 0;
+	headers.buf[0] = '\0';
+	okx ( hpack_decode ( table, test->data, test->len, hpack_test_header,
+			     &headers ) == 0, file, line );
+	okx ( strcmp ( headers.buf, test->headers ) == 0, file, line );
+	okx ( table->used == test->used, file, line );
+}
+#define hpack_decode_ok( table, test ) \
+	hpack_decode_okx ( table, test, __FILE__, __LINE__ )
+
+/**
+ * Report an HPACK decoding failure test result
+ *
+ * @v table		Dynamic table
+ * @v test		HPACK decoding test
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void hpack_decode_fail_okx ( struct hpack_table *table,
+				    struct hpack_decode_test *test,
+				    const char *file, unsigned int line ) {
+	struct hpack_test_headers headers;
+
+	headers.len = 0;
+	okx ( hpack_decode ( table, test->data, test->len, hpack_test_header,
+			     &headers ) != 0, file, line );
+}
+#define hpack_decode_fail_ok( table, test ) \
+	hpack_decode_fail_okx ( table, test, __FILE__, __LINE__ )
+
+/**
+ * Report an HPACK encoding test result
+ *
+ * @v test		HPACK encoding test
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void hpack_encode_okx ( struct hpack_encode_test *test,
+			       const char *file, unsigned int line ) {
+	size_t name_len = strlen ( test->name );
+	size_t value_len = strlen ( test->value );
+	size_t len;
+
+	len = hpack_encode ( NULL, test->name, name_len, test->value,
+			     value_len );
+	okx ( len == test->len, file, line );
+	{
+		uint8_t data[len];
+
+		okx ( hpack_encode ( data, test->name, name_len, test->value,
+				     value_len ) == len, file, line );
+		okx ( memcmp ( data, test->data, len ) == 0, file, line );
+	}
+}
+#define hpack_encode_ok( test ) hpack_encode_okx ( test, __FILE__, __LINE__ )
+
+/**
+ * Perform HPACK self-tests
+ *
+ */
+static void hpack_test_exec ( void ) {
+	struct hpack_table table;
+
+	/* Requests */
+	hpack_init ( &table, HPACK_DEFAULT_TABLE_SIZE );
+	hpack_decode_ok ( &table, &request1 );
+	hpack_decode_ok ( &table, &request2 );
+	hpack_decode_ok ( &table, &request3 );
+	hpack_fini ( &table );
+
+	/* Responses */
+	hpack_init ( &table, 256 );
+	hpack_decode_ok ( &table, &response1 );
+	hpack_decode_ok ( &table, &response2 );
+	hpack_decode_ok ( &table, &response3 );
+	hpack_fini ( &table );
+
+	/* Invalid header blocks */
+	hpack_init ( &table, HPACK_DEFAULT_TABLE_SIZE );
+	hpack_decode_fail_ok ( &table, &bad_index );
+	hpack_decode_fail_ok ( &table, &bad_padding );
+	hpack_decode_fail_ok ( &table, &bad_string );
+	hpack_decode_fail_ok ( &table, &bad_size );
+	hpack_fini ( &table );
+
+	/* Encoding */
+	hpack_encode_ok ( &encode_indexed );
+	hpack_encode_ok ( &encode_name );
+	hpack_encode_ok ( &encode_lower );
+	hpack_encode_ok ( &encode_literal );
+}
+
+/** HPACK self-test */
+struct self_test hpack_test __self_test = {
+	.name = "hpack",
+	.exec = hpack_test_exec,
+};
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * High-resolution clock self-tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <ipxe/timer.h>
+#include <ipxe/hrclock.h>
+#include <ipxe/test.h>
+
+/**
+ * Perform high-resolution clock self-tests
+ *
+ */
+static void hrclock_test_exec ( void ) {
+	uint64_t before;
+	uint64_t after;
+	uint64_t again;
+
+	/* Check that clock is monotonic */
+	before = hrclock_ns();
+	after = hrclock_ns();
+	ok ( after >= before );
+
+	/* Check that clock advances by at least the delay duration */
+	before = hrclock_ns();
+	mdelay ( 20 );
+	after = hrclock_ns();
+	ok ( ( after - before ) >= ( 20 * 1000 * 1000 ) );
+
+	/* Check that clock does not advance unreasonably quickly */
+	ok ( ( after - before ) < NSECS_PER_SEC );
+
+	/* Check microsecond conversion */
+	again = hrclock_us();
+	ok ( again >= ( after / 1000 ) );
+}
+
+/** High-resolution clock self-test */
+struct self_test hrclock_test __self_test = {
+	.name = "hrclock",
+	.exec = hrclock_test_exec,
+};
@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * Object interface self-tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <string.h>
+#include <ipxe/interface.h>
+#include <ipxe/xfer.h>
+#include <ipxe/profile.h>
+#include <ipxe/test.h>
+
+/** Number of sample iterations for profiling */
+#define PROFILE_COUNT 4096
+
+/** A test sink object */
+struct intf_test_sink {
+	/** Data transfer interface */
+	struct interface xfer;
+	/** Flow control window */
+	size_t window;
+	/** Number of window change notifications received */
+	unsigned int changed;
+};
+
+/** A test pass-through filter object */
+struct intf_test_filter {
+	/** Upper data transfer interface */
+	struct interface up;
+	/** Lower data transfer interface */
+	struct interface down;
+};
+
+/**
+ * Report test sink window
+ *
+ * @v sink		Test sink
+ * @ret len		Window length
+ */
+static size_t intf_test_window ( struct intf_test_sink *sink ) {
+	return sink->window;
+}
+
+/**
+ * Receive test sink window change notification
+ *
+ * @v sink		Test sink
+ */
+static void intf_test_window_changed ( struct intf_test_sink *sink ) {
+	sink->changed++;
+}
+
+/** Test sink interface operations */
+static struct interface_operation intf_test_sink_op[] = {
+	INTF_OP ( xfer_window, struct intf_test_sink *, intf_test_window ),
+	INTF_OP ( xfer_window_changed, struct intf_test_sink *,
+		  intf_test_window_changed ),
+};
+
+/** Test sink interface descriptor */
+static struct interface_descriptor intf_test_sink_desc =
+	INTF_DESC ( struct intf_test_sink, xfer, intf_test_sink_op );
+
+/** Test filter interface operations */
+static struct interface_operation intf_test_filter_op[] = {};
+
+/** Test filter upper interface descriptor */
+static struct interface_descriptor intf_test_up_desc =
+	INTF_DESC_PASSTHRU ( struct intf_test_filter, up,
+			     intf_test_filter_op, down );
+
+/** Test filter lower interface descriptor */
+static struct interface_descriptor intf_test_down_desc =
+	INTF_DESC_PASSTHRU ( struct intf_test_filter, down,
+			     intf_test_filter_op, up );
+
+/** Test sources */
+static struct interface intf_test_source = INTF_INIT ( null_intf_desc );
+
+/** Test sinks */
+static struct intf_test_sink intf_test_sinks[2] = {
+	{ .xfer = INTF_INIT ( intf_test_sink_desc ), .window = 100 },
+	{ .xfer = INTF_INIT ( intf_test_sink_desc ), .window = 200 },
+};
+
+/** Test filters */
+static struct intf_test_filter intf_test_filters[4] = {
+	{ .up = INTF_INIT ( intf_test_up_desc ),
+	  .down = INTF_INIT ( intf_test_down_desc ) },
+	{ .up = INTF_INIT ( intf_test_up_desc ),
+	  .down = INTF_INIT ( intf_test_down_desc ) },
+	{ .up = INTF_INIT ( intf_test_up_desc ),
+	  .down = INTF_INIT ( intf_test_down_desc ) },
+	{ .up = INTF_INIT ( intf_test_up_desc ),
+	  .down = INTF_INIT ( intf_test_down_desc ) },
+};
+
+/**
+ * Perform object interface self-tests
+ *
+ */
+static void interface_test_exec ( void ) {
+	struct intf_test_sink *sink0 = &intf_test_sinks[0];
+	struct intf_test_sink *sink1 = &intf_test_sinks[1];
+	struct interface *source = &intf_test_source;
+	struct profiler profiler;
+	unsigned int i;
+
+	/* Plug source through filter chain into first sink */
+	intf_plug_plug ( source, &intf_test_filters[0].up );
+	for ( i = 1 ; i < ARRAY_SIZE ( intf_test_filters ) ; i++ ) {
+		intf_plug_plug ( &intf_test_filters[ i - 1 ].down,
+				 &intf_test_filters[i].up );
+	}
+	intf_plug_plug ( &intf_test_filters[ i - 1 ].down, &sink0->xfer );
+
+	/* Check operations (including repeated cached lookups) */
+	ok ( xfer_window ( source ) == 100 );
+	ok ( xfer_window ( source ) == 100 );
+	xfer_window_changed ( source );
+	ok ( xfer_window ( source ) == 100 );
+	xfer_window_changed ( source );
+	ok ( sink0->changed == 2 );
+
+	/* Check that replugging within the chain is observed */
+	intf_plug_plug ( &intf_test_filters[ i - 1 ].down, &sink1->xfer );
+	ok ( xfer_window ( source ) == 200 );
+	xfer_window_changed ( source );
+	ok ( sink1->changed == 1 );
+	ok ( sink0->changed == 2 );
+
+	/* Check that nullification and reinitialisation are observed */
+	intf_nullify ( &sink1->xfer );
+	ok ( xfer_window ( source ) == ~( ( size_t ) 0 ) );
+	intf_reinit ( &sink1->xfer );
+	ok ( xfer_window ( source ) == 200 );
+
+	/* Profile lookups through filter chain */
+	memset ( &profiler, 0, sizeof ( profiler ) );
+	for ( i = 0 ; i < PROFILE_COUNT ; i++ ) {
+		profile_start ( &profiler );
+		xfer_window ( source );
+		profile_stop ( &profiler );
+	}
+	DBG ( "INTF window via %zd filters in %ld +/- %ld ticks\n",
+	      ARRAY_SIZE ( intf_test_filters ), profile_mean ( &profiler ),
+	      profile_stddev ( &profiler ) );
+
+	/* Check that shutdown is observed */
+	intf_shutdown ( &intf_test_filters[0].up, 0 );
+	ok ( xfer_window ( source ) == ~( ( size_t ) 0 ) );
+
+	/* Unplug everything */
+	intf_unplug ( source );
+	for ( i = 0 ; i < ARRAY_SIZE ( intf_test_filters ) ; i++ ) {
+		intf_unplug ( &intf_test_filters[i].up );
+		intf_unplug ( &intf_test_filters[i].down );
+		intf_reinit ( &intf_test_filters[i].up );
+	}
+	intf_unplug ( &sink0->xfer );
+	intf_unplug ( &sink1->xfer );
+}
+
+/** Object interface self-test */
+struct self_test interface_test __self_test = {
+	.name = "interface",
+	.exec = interface_test_exec,
+};
@@ -35,6 +35,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <stdint.h>
 #include <string.h>
 #include <assert.h>
+#include <ipxe/refcnt.h>
 #include <ipxe/iobuf.h>
 #include <ipxe/io.h>
 #include <ipxe/test.h>
@@ -99,6 +100,55 @@ static inline void alloc_iob_fail_okx ( size_t len, size_t align, size_t offset,
 #define alloc_iob_fail_ok( len, align, offset ) \
 	alloc_iob_fail_okx ( len, align, offset, __FILE__, __LINE__ )
 
+/**
+ * Perform I/O buffer pool self-tests
+ *
+ */
+static void iob_pool_test_exec ( void ) {
+	struct io_buffer_pool pool;
+	struct refcnt refcnt = REF_INIT ( ref_no_free );
+	struct io_buffer *iobuf;
+	struct io_buffer *reused;
+
+	/* Initialise pool */
+	iob_pool_init ( &pool, &refcnt );
+
+	/* Allocate buffer from empty pool */
+	iobuf = alloc_pool_iob ( &pool, 1536 );
+	ok ( iobuf != NULL );
+	ok ( iob_tailroom ( iobuf ) >= 1536 );
+	ok ( refcnt.count == 1 );
+
+	/* Free buffer back into pool */
+	iob_put ( iobuf, 60 );
+	free_iob ( iobuf );
+	ok ( pool.count == 1 );
+	ok ( refcnt.count == 0 );
+
+	/* Reuse buffer from pool */
+	reused = alloc_pool_iob ( &pool, 1536 );
+	ok ( reused == iobuf );
+	ok ( iob_len ( reused ) == 0 );
+	ok ( iob_tailroom ( reused ) >= 1536 );
+	ok ( pool.count == 0 );
+	ok ( refcnt.count == 1 );
+	free_iob ( reused );
+
+	/* Change buffer length */
+	iobuf = alloc_pool_iob ( &pool, 4096 );
+	ok ( iobuf != NULL );
+	ok ( iob_tailroom ( iobuf ) >= 4096 );
+	ok ( pool.count == 0 );
+	free_iob ( iobuf );
+	ok ( pool.count == 1 );
+	ok ( refcnt.count == 0 );
+
+	/* Flush pool */
+	ok ( iob_pool_flush ( &pool ) == 1 );
+	ok ( pool.count == 0 );
+	ok ( list_empty ( &pool.free ) );
+}
+
 /**
  * Perform I/O buffer self-tests
  *
@@ -122,11 +172,20 @@ static void iobuf_test_exec ( void ) {
 	alloc_iob_ok ( 2048, 2048, 0 );
 	alloc_iob_ok ( 2048, 2048, -10 );
 
+	/* Check reuse of freed buffers with differing alignments */
+	alloc_iob_ok ( 1000, 1024, 0 );
+	alloc_iob_ok ( 1000, 1024, 64 );
+	alloc_iob_ok ( 1000, 64, 32 );
+	alloc_iob_ok ( 1000, 1024, 0 );
+
 	/* Excessively large or excessively aligned allocations should fail */
 	alloc_iob_fail_ok ( -1UL, 0, 0 );
 	alloc_iob_fail_ok ( -1UL, 1024, 0 );
 	alloc_iob_fail_ok ( 0, -1UL, 0 );
 	alloc_iob_fail_ok ( 1024, -1UL, 0 );
+
+	/* Check I/O buffer pools */
+	iob_pool_test_exec();
 }
 
 /** I/O buffer self-test */
@@ -36,6 +36,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <string.h>
 #include <byteswap.h>
 #include <ipxe/in.h>
+#include <ipxe/socket.h>
 #include <ipxe/test.h>
 
 /** Define inline IPv4 address */
@@ -104,6 +105,49 @@ static void inet_aton_fail_okx ( const char *text, const char *file,
 #define inet_aton_fail_ok( text ) \
 	inet_aton_fail_okx ( text, __FILE__, __LINE__ )
 
+/**
+ * Report an IPv4 sock_aton() test result
+ *
+ * @v text		Socket address string
+ * @v addr		Expected IPv4 address
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void ipv4_sock_aton_okx ( const char *text, uint32_t addr,
+				 const char *file, unsigned int line ) {
+	union {
+		struct sockaddr sa;
+		struct sockaddr_in sin;
+	} actual;
+
+	/* Parse socket address */
+	memset ( &actual, 0, sizeof ( actual ) );
+	okx ( sock_aton ( text, &actual.sa ) == 0, file, line );
+	DBG ( "sock_aton ( \"%s\" ) = %s\n", text, sock_ntoa ( &actual.sa ) );
+	okx ( actual.sin.sin_family == AF_INET, file, line );
+	okx ( actual.sin.sin_addr.s_addr == addr, file, line );
+	okx ( actual.sin.sin_scope_id == 0, file, line );
+}
+#define ipv4_sock_aton_ok( text, addr ) \
+	ipv4_sock_aton_okx ( text, addr, __FILE__, __LINE__ )
+
+/**
+ * Report an IPv4 sock_aton() failure test result
+ *
+ * @v text		Socket address string
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void ipv4_sock_aton_fail_okx ( const char *text, const char *file,
+				      unsigned int line ) {
+	struct sockaddr sa;
+
+	/* Attempt to parse socket address */
+	okx ( sock_aton ( text, &sa ) != 0, file, line );
+}
+#define ipv4_sock_aton_fail_ok( text ) \
+	ipv4_sock_aton_fail_okx ( text, __FILE__, __LINE__ )
+
 /**
  * Perform IPv4 self-tests
  *
@@ -145,6 +189,14 @@ static void ipv4_test_exec ( void ) {
 	inet_aton_fail_ok ( "127.0.0" ); /* Too short */
 	inet_aton_fail_ok ( "1.2.3.a" ); /* Invalid characters */
 	inet_aton_fail_ok ( "127.0..1" ); /* Missing bytes */
+
+	/* sock_aton() tests */
+	ipv4_sock_aton_ok ( "10.0.2.15", IPV4 ( 10, 0, 2, 15 ) );
+
+	/* sock_aton() failure tests */
+	ipv4_sock_aton_fail_ok ( "10.0.2.15%" ); /* Empty device name */
+	ipv4_sock_aton_fail_ok ( "10.0.2.15%nonexistent" ); /* No device */
+	ipv4_sock_aton_fail_ok ( "10.0.2%net0" ); /* Invalid address */
 }
 
 /** IPv4 self-test */
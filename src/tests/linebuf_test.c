@@ -269,6 +269,68 @@ static void linebuf_empty_okx ( struct line_buffer *linebuf,
 #define linebuf_empty_ok( linebuf ) \
 	linebuf_empty_okx ( linebuf, __FILE__, __LINE__ )
 
+/**
+ * Report in-place line retrieval test result
+ *
+ * @v test		Line buffer test
+ * @v linebuf		Line buffer
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void linebuf_inplace_okx ( struct linebuf_test *test,
+				  struct line_buffer *linebuf,
+				  const char *file, unsigned int line ) {
+	char copy[ test->len + 1 /* NUL */ ];
+	char *data = copy;
+	size_t remaining = test->len;
+	const char *expected;
+	char *actual;
+	int buffered;
+	int len;
+	unsigned int i;
+
+	/* Construct modifiable copy of data */
+	memcpy ( copy, test->data, sizeof ( copy ) );
+
+	/* Consume data one line at a time */
+	for ( i = 0 ; i < test->count ; i++ ) {
+
+		/* Retrieve line */
+		buffered = ( linebuf->len != 0 );
+		len = line_buffer_inplace ( linebuf, data, remaining, &actual );
+
+		/* Check for success/failure */
+		expected = test->lines[i];
+		if ( expected == linebuf_failure ) {
+			okx ( len < 0, file, line );
+			okx ( remaining > 0, file, line );
+			return;
+		}
+		okx ( len >= 0, file, line );
+		okx ( ( ( size_t ) len ) <= remaining, file, line );
+
+		/* Check expected result */
+		if ( expected == NULL ) {
+			okx ( actual == NULL, file, line );
+		} else {
+			okx ( actual != NULL, file, line );
+			okx ( strcmp ( actual, expected ) == 0, file, line );
+			if ( ! buffered )
+				okx ( actual == data, file, line );
+			empty_line_buffer ( linebuf );
+		}
+
+		/* Consume data */
+		data += len;
+		remaining -= len;
+	}
+
+	/* Check that all data was consumed */
+	okx ( remaining == 0, file, line );
+}
+#define linebuf_inplace_ok( test, linebuf ) \
+	linebuf_inplace_okx ( test, linebuf, __FILE__, __LINE__ )
+
 /**
  * Report line buffer combined test result
  *
@@ -311,6 +373,21 @@ static void linebuf_test_exec ( void ) {
 
 	/* Embedded NULs */
 	linebuf_ok ( &embedded_nuls );
+
+	/* In-place retrieval tests */
+	linebuf_init_ok ( &linebuf );
+	linebuf_inplace_ok ( &simple, &linebuf );
+	linebuf_inplace_ok ( &mixed, &linebuf );
+	linebuf_empty_ok ( &linebuf );
+	linebuf_inplace_ok ( &split_1, &linebuf );
+	linebuf_inplace_ok ( &split_2, &linebuf );
+	linebuf_inplace_ok ( &split_3, &linebuf );
+	linebuf_inplace_ok ( &split_4, &linebuf );
+	linebuf_inplace_ok ( &split_5, &linebuf );
+	linebuf_inplace_ok ( &split_6, &linebuf );
+	linebuf_empty_ok ( &linebuf );
+	linebuf_inplace_ok ( &embedded_nuls, &linebuf );
+	linebuf_empty_ok ( &linebuf );
 }
 
 /** Line buffer self-test */
@@ -264,6 +264,12 @@ static void memcpy_test_exec ( void ) {
 			memcpy_test_speed ( dest_offset, src_offset, 4096 );
 		}
 	}
+
+	/* Bandwidth tests */
+	memcpy_test_speed ( 0, 0, 65536 );
+	memcpy_test_speed ( 1, 3, 65536 );
+	memcpy_test_speed ( 0, 0, 1048576 );
+	memcpy_test_speed ( 1, 3, 1048576 );
 }
 
 /** memcpy() self-test */
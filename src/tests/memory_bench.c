@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * Memory operation benchmarks
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <ipxe/malloc.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/benchmark.h>
+
+/** Length of memory operation benchmark buffers */
+#define MEMORY_BENCH_LEN 65536
+
+/** Source buffer */
+static uint8_t memory_bench_src[ MEMORY_BENCH_LEN + 8 ];
+
+/** Destination buffer */
+static uint8_t memory_bench_dest[ MEMORY_BENCH_LEN + 8 ];
+
+/**
+ * Benchmark memcpy()
+ *
+ * @v len		Length of data
+ * @v offset		Offset of source and destination within buffers
+ */
+static void memcpy_bench ( size_t len, unsigned int offset ) {
+	struct bench_measurement bench;
+	void *dest = ( memory_bench_dest + offset );
+	void *src = ( memory_bench_src + offset );
+
+	/* Sanity check */
+	assert ( ( offset + len ) <= sizeof ( memory_bench_dest ) );
+
+	bench_start ( &bench, "memcpy %zd+%d", len, offset );
+	do {
+		profile_start ( &bench.profiler );
+		memcpy ( dest, src, len );
+		profile_stop ( &bench.profiler );
+	} while ( bench_continue ( &bench, len ) );
+	bench_report ( &bench );
+}
+
+/**
+ * Benchmark memset()
+ *
+ * @v len		Length of data
+ */
+static void memset_bench ( size_t len ) {
+	struct bench_measurement bench;
+
+	/* Sanity check */
+	assert ( len <= sizeof ( memory_bench_dest ) );
+
+	bench_start ( &bench, "memset %zd", len );
+	do {
+		profile_start ( &bench.profiler );
+		memset ( memory_bench_dest, 0, len );
+		profile_stop ( &bench.profiler );
+	} while ( bench_continue ( &bench, len ) );
+	bench_report ( &bench );
+}
+
+/**
+ * Benchmark malloc() and free()
+ *
+ * @v len		Length of allocation
+ */
+static void malloc_bench ( size_t len ) {
+	struct bench_measurement bench;
+	void *ptr;
+
+	bench_start ( &bench, "malloc %zd", len );
+	do {
+		profile_start ( &bench.profiler );
+		ptr = malloc ( len );
+		assert ( ptr != NULL );
+		free ( ptr );
+		profile_stop ( &bench.profiler );
+	} while ( bench_continue ( &bench, 0 ) );
+	bench_report ( &bench );
+}
+
+/**
+ * Benchmark alloc_iob() and free_iob()
+ *
+ * @v len		Length of I/O buffer
+ */
+static void iob_bench ( size_t len ) {
+	struct bench_measurement bench;
+	struct io_buffer *iobuf;
+
+	bench_start ( &bench, "alloc_iob %zd", len );
+	do {
+		profile_start ( &bench.profiler );
+		iobuf = alloc_iob ( len );
+		assert ( iobuf != NULL );
+		free_iob ( iobuf );
+		profile_stop ( &bench.profiler );
+	} while ( bench_continue ( &bench, 0 ) );
+	bench_report ( &bench );
+}
+
+/**
+ * Perform memory operation benchmarks
+ *
+ */
+static void memory_bench_exec ( void ) {
+
+	/* Copies of typical packet and page sizes */
+	memcpy_bench ( 64, 0 );
+	memcpy_bench ( 1460, 0 );
+	memcpy_bench ( 1460, 2 );
+	memcpy_bench ( 4096, 0 );
+	memcpy_bench ( MEMORY_BENCH_LEN, 0 );
+
+	/* Fills */
+	memset_bench ( 4096 );
+	memset_bench ( MEMORY_BENCH_LEN );
+
+	/* Heap allocations */
+	malloc_bench ( 64 );
+	malloc_bench ( 2048 );
+	malloc_bench ( 65536 );
+	iob_bench ( 1536 );
+	iob_bench ( 9018 );
+}
+
+/** Memory operation benchmarks */
+struct benchmark memory_benchmark __benchmark = {
+	.name = "memory",
+	.exec = memory_bench_exec,
+};
@@ -109,6 +109,26 @@ __attribute__ (( noinline )) void * memset_var ( void *dest, unsigned int fill,
 		ok ( memcmp ( ( dest_var + 1 ), zero, len ) == 0 );	\
 	} while ( 0 )
 
+/**
+ * Perform a variable-length memset() test
+ *
+ * @v offset		Offset within buffer
+ * @v len		Length of data
+ * @v fill		Fill pattern
+ */
+#define MEMSET_TEST_VARIABLE( offset, len, fill ) do {			\
+		static uint8_t dest[ offset + len + 1 ];		\
+		unsigned int i;						\
+									\
+		for ( i = 0 ; i < sizeof ( dest ) ; i++ )		\
+			dest[i] = 0xcc;					\
+		memset_var ( ( dest + offset ), fill, len );		\
+		for ( i = 0 ; i < sizeof ( dest ) ; i++ ) {		\
+			ok ( dest[i] == ( ( ( i - offset ) < len ) ?	\
+					  ( ( uint8_t ) fill ) : 0xcc ) );\
+		}							\
+	} while ( 0 )
+
 /**
  * Perform memset() self-tests
  *
@@ -148,6 +168,13 @@ static void memset_test_exec ( void ) {
 	MEMSET_TEST_CONSTANT ( 29 );
 	MEMSET_TEST_CONSTANT ( 30 );
 	MEMSET_TEST_CONSTANT ( 31 );
+
+	/* Variable-length tests */
+	MEMSET_TEST_VARIABLE ( 0, 127, 0 );
+	MEMSET_TEST_VARIABLE ( 1, 128, 0x5a );
+	MEMSET_TEST_VARIABLE ( 3, 129, 0xff );
+	MEMSET_TEST_VARIABLE ( 2, 4099, 0 );
+	MEMSET_TEST_VARIABLE ( 5, 67, 0x1234 );
 }
 
 /** memset() self-test */
@@ -0,0 +1,594 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * Network stack benchmarks
+ *
+ * The receive datapath is measured by attaching a simulated HTTP
+ * server to a loopback network device.  The server responds to each
+ * request by injecting maximum-sized TCP segments directly into the
+ * receive queue (subject to the advertised TCP window), so that each
+ * segment passes through the complete net_rx() -> IPv4 -> TCP ->
+ * HTTP -> data transfer buffer path.
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <byteswap.h>
+#include <assert.h>
+#include <ipxe/device.h>
+#include <ipxe/netdevice.h>
+#include <ipxe/ethernet.h>
+#include <ipxe/if_ether.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/in.h>
+#include <ipxe/ip.h>
+#include <ipxe/tcp.h>
+#include <ipxe/tcpip.h>
+#include <ipxe/neighbour.h>
+#include <ipxe/settings.h>
+#include <ipxe/interface.h>
+#include <ipxe/xfer.h>
+#include <ipxe/xferbuf.h>
+#include <ipxe/umalloc.h>
+#include <ipxe/open.h>
+#include <ipxe/uri.h>
+#include <ipxe/process.h>
+#include <ipxe/benchmark.h>
+
+/** Maximum segment size used by simulated server */
+#define NET_BENCH_MSS 1460
+
+/** Length of each simulated HTTP response body */
+#define NET_BENCH_RESPONSE_LEN ( 4 * 1024 * 1024 )
+
+/** Simulated server initial sequence number */
+#define NET_BENCH_ISS 0x10000000UL
+
+/** Simulated HTTP response header format */
+#define NET_BENCH_HEADER \
+	"HTTP/1.1 200 OK\r\nContent-Length: %d\r\n\r\n"
+
+/** Simulated server URI */
+#define NET_BENCH_URI "http://192.0.2.1/bench"
+
+/** Client IPv4 address */
+#define NET_BENCH_CLIENT_IP 0xc0000202UL
+
+/** Server IPv4 address */
+#define NET_BENCH_SERVER_IP 0xc0000201UL
+
+/** Client MAC address */
+static const uint8_t net_bench_client_mac[ETH_ALEN] =
+	{ 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 };
+
+/** Server MAC address */
+static const uint8_t net_bench_server_mac[ETH_ALEN] =
+	{ 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+
+/** A simulated server segment */
+struct net_bench_segment {
+	/** Ethernet header */
+	struct ethhdr eth;
+	/** IPv4 header */
+	struct iphdr ip;
+	/** TCP header */
+	struct tcp_header tcp;
+	/** TCP options */
+	union {
+		/** SYN options */
+		struct {
+			/** Maximum segment size */
+			struct tcp_mss_option mss;
+			/** Window scale */
+			struct tcp_window_scale_padded_option ws;
+		} __attribute__ (( packed )) syn;
+	} __attribute__ (( packed )) opts[0];
+} __attribute__ (( packed ));
+
+/** Simulated HTTP server state */
+struct net_bench_server {
+	/** Client TCP port, or zero if not connected */
+	uint16_t port;
+	/** Next sequence number to send */
+	uint32_t snd_nxt;
+	/** Highest sequence number acknowledged by client */
+	uint32_t snd_una;
+	/** Client receive window */
+	uint32_t snd_wnd;
+	/** Next sequence number expected from client */
+	uint32_t rcv_nxt;
+	/** Response header is waiting to be sent */
+	int header_pending;
+	/** Response body bytes waiting to be sent */
+	size_t remaining;
+	/** Number of responses started */
+	unsigned int responses;
+};
+
+/** Simulated HTTP server */
+static struct net_bench_server net_bench_server;
+
+/** Response body segment payload */
+static uint8_t net_bench_payload[NET_BENCH_MSS];
+
+/** Partial checksum of response body segment payload */
+static uint16_t net_bench_payload_csum;
+
+/** Benchmark network device */
+static struct net_device *net_bench_netdev;
+
+/** Benchmark parent device */
+static struct device net_bench_device = {
+	.name = "bench",
+	.children = LIST_HEAD_INIT ( net_bench_device.children ),
+	.siblings = LIST_HEAD_INIT ( net_bench_device.siblings ),
+};
+
+/**
+ * Combine two partial TCP/IP checksums
+ *
+ * @v first		Checksum of first (even-length) block
+ * @v second		Checksum of second block
+ * @ret csum		Checksum of combined block
+ */
+static uint16_t net_bench_chksum_add ( uint16_t first, uint16_t second ) {
+	uint32_t sum;
+
+	sum = ( ( ( uint16_t ) ~first ) + ( ( uint16_t ) ~second ) );
+	sum = ( ( sum & 0xffff ) + ( sum >> 16 ) );
+	return ( ( uint16_t ) ~sum );
+}
+
+/**
+ * Inject simulated server segment
+ *
+ * @v flags		TCP flags
+ * @v data		Payload
+ * @v len		Length of payload
+ * @v data_csum		Partial checksum of payload
+ */
+static void net_bench_inject ( unsigned int flags, const void *data,
+			       size_t len, uint16_t data_csum ) {
+	struct net_bench_server *server = &net_bench_server;
+	struct ipv4_pseudo_header pshdr;
+	struct net_bench_segment *seg;
+	struct io_buffer *iobuf;
+	size_t hlen = sizeof ( seg->tcp );
+	uint16_t csum;
+
+	/* Allocate I/O buffer */
+	if ( flags & TCP_SYN )
+		hlen += sizeof ( seg->opts[0].syn );
+	iobuf = alloc_iob ( sizeof ( seg->eth ) + sizeof ( seg->ip ) +
+			    hlen + len );
+	assert ( iobuf != NULL );
+	seg = iob_put ( iobuf, ( sizeof ( seg->eth ) + sizeof ( seg->ip ) +
+				 hlen ) );
+	memcpy ( iob_put ( iobuf, len ), data, len );
+
+	/* Construct Ethernet header */
+	memcpy ( seg->eth.h_dest, net_bench_client_mac, ETH_ALEN );
+	memcpy ( seg->eth.h_source, net_bench_server_mac, ETH_ALEN );
+	seg->eth.h_protocol = htons ( ETH_P_IP );
+
+	/* Construct TCP header */
+	seg->tcp.src = htons ( 80 );
+	seg->tcp.dest = server->port;
+	seg->tcp.seq = htonl ( server->snd_nxt );
+	seg->tcp.ack = htonl ( server->rcv_nxt );
+	seg->tcp.hlen = ( ( hlen / 4 ) << 4 );
+	seg->tcp.flags = ( flags | TCP_ACK );
+	seg->tcp.win = htons ( 0xffff );
+	seg->tcp.csum = 0;
+	seg->tcp.urg = 0;
+	if ( flags & TCP_SYN ) {
+		seg->opts[0].syn.mss.kind = TCP_OPTION_MSS;
+		seg->opts[0].syn.mss.length = sizeof ( seg->opts[0].syn.mss );
+		seg->opts[0].syn.mss.mss = htons ( NET_BENCH_MSS );
+		seg->opts[0].syn.ws.nop = TCP_OPTION_NOP;
+		seg->opts[0].syn.ws.wsopt.kind = TCP_OPTION_WS;
+		seg->opts[0].syn.ws.wsopt.length =
+			sizeof ( seg->opts[0].syn.ws.wsopt );
+		seg->opts[0].syn.ws.wsopt.scale = 0;
+	}
+	pshdr.src.s_addr = htonl ( NET_BENCH_SERVER_IP );
+	pshdr.dest.s_addr = htonl ( NET_BENCH_CLIENT_IP );
+	pshdr.zero_padding = 0;
+	pshdr.protocol = IP_TCP;
+	pshdr.len = htons ( hlen + len );
+	csum = tcpip_continue_chksum ( TCPIP_EMPTY_CSUM, &pshdr,
+				       sizeof ( pshdr ) );
+	csum = tcpip_continue_chksum ( csum, &seg->tcp, hlen );
+	seg->tcp.csum = net_bench_chksum_add ( csum, data_csum );
+
+	/* Construct IPv4 header */
+	seg->ip.verhdrlen = ( IP_VER | ( sizeof ( seg->ip ) / 4 ) );
+	seg->ip.service = 0;
+	seg->ip.len = htons ( sizeof ( seg->ip ) + hlen + len );
+	seg->ip.ident = 0;
+	seg->ip.frags = htons ( IP_MASK_DONOTFRAG );
+	seg->ip.ttl = IP_TTL;
+	seg->ip.protocol = IP_TCP;
+	seg->ip.chksum = 0;
+	seg->ip.src = pshdr.src;
+	seg->ip.dest = pshdr.dest;
+	seg->ip.chksum = tcpip_chksum ( &seg->ip, sizeof ( seg->ip ) );
+
+	/* Update sequence number */
+	server->snd_nxt += ( len + ( ( flags & TCP_SYN ) ? 1 : 0 ) );
+
+	/* Hand off to network stack */
+	netdev_rx ( net_bench_netdev, iobuf );
+}
+
+/**
+ * Send next simulated server segment, if permitted by TCP window
+ *
+ * @ret len		Length of response body data sent
+ */
+static size_t net_bench_send ( void ) {
+	struct net_bench_server *server = &net_bench_server;
+	char header[64];
+	size_t len;
+
+	/* Send response header, if applicable */
+	if ( server->header_pending ) {
+		len = snprintf ( header, sizeof ( header ), NET_BENCH_HEADER,
+				 NET_BENCH_RESPONSE_LEN );
+		net_bench_inject ( TCP_PSH, header, len,
+				   tcpip_chksum ( header, len ) );
+		server->header_pending = 0;
+		return 0;
+	}
+
+	/* Send response body, if permitted by TCP window */
+	len = server->remaining;
+	if ( len > NET_BENCH_MSS )
+		len = NET_BENCH_MSS;
+	if ( ( ! len ) ||
+	     ( ( server->snd_nxt + len - server->snd_una ) >
+	       server->snd_wnd ) ) {
+		return 0;
+	}
+	net_bench_inject ( 0, net_bench_payload, len,
+			   ( ( len == NET_BENCH_MSS ) ?
+			     net_bench_payload_csum :
+			     tcpip_chksum ( net_bench_payload, len ) ) );
+	server->remaining -= len;
+	return len;
+}
+
+/**
+ * Handle segment transmitted by client
+ *
+ * @v netdev		Network device
+ * @v iobuf		I/O buffer
+ * @ret rc		Return status code
+ */
+static int net_bench_transmit ( struct net_device *netdev,
+				struct io_buffer *iobuf ) {
+	struct net_bench_server *server = &net_bench_server;
+	struct net_bench_segment *seg = iobuf->data;
+	size_t hlen;
+	size_t len;
+
+	/* Ignore anything other than TCP segments */
+	if ( ( iob_len ( iobuf ) < sizeof ( *seg ) ) ||
+	     ( seg->eth.h_protocol != htons ( ETH_P_IP ) ) ||
+	     ( seg->ip.protocol != IP_TCP ) ||
+	     ( seg->ip.verhdrlen != ( IP_VER | ( sizeof ( seg->ip ) / 4 ) ) ))
+		goto done;
+	hlen = ( ( seg->tcp.hlen >> 4 ) * 4 );
+	len = ( ntohs ( seg->ip.len ) - sizeof ( seg->ip ) - hlen );
+
+	/* Accept new connections */
+	if ( seg->tcp.flags & TCP_SYN ) {
+		memset ( server, 0, sizeof ( *server ) );
+		server->port = seg->tcp.src;
+		server->snd_nxt = NET_BENCH_ISS;
+		server->snd_una = NET_BENCH_ISS;
+		server->rcv_nxt = ( ntohl ( seg->tcp.seq ) + 1 );
+		net_bench_inject ( TCP_SYN, NULL, 0, TCPIP_EMPTY_CSUM );
+		goto done;
+	}
+
+	/* Ignore segments for any other connection */
+	if ( seg->tcp.src != server->port )
+		goto done;
+
+	/* Record acknowledgement and window */
+	server->snd_una = ntohl ( seg->tcp.ack );
+	server->snd_wnd = ( ntohs ( seg->tcp.win ) << TCP_RX_WINDOW_SCALE );
+
+	/* Start a new response for each request */
+	if ( len && ( ntohl ( seg->tcp.seq ) == server->rcv_nxt ) ) {
+		server->rcv_nxt += len;
+		if ( ! ( server->header_pending || server->remaining ) ) {
+			server->header_pending = 1;
+			server->remaining = NET_BENCH_RESPONSE_LEN;
+			server->responses++;
+		}
+	}
+
+ done:
+	netdev_tx_complete ( netdev, iobuf );
+	return 0;
+}
+
+/**
+ * Open network device
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ */
+static int net_bench_open ( struct net_device *netdev __unused ) {
+	return 0;
+}
+
+/**
+ * Close network device
+ *
+ * @v netdev		Network device
+ */
+static void net_bench_close ( struct net_device *netdev __unused ) {
+	/* Nothing to do */
+}
+
+/**
+ * Poll network device
+ *
+ * @v netdev		Network device
+ */
+static void net_bench_poll ( struct net_device *netdev __unused ) {
+	/* Nothing to do: segments are injected directly */
+}
+
+/** Benchmark network device operations */
+static struct net_device_operations net_bench_operations = {
+	.open		= net_bench_open,
+	.close		= net_bench_close,
+	.transmit	= net_bench_transmit,
+	.poll		= net_bench_poll,
+};
+
+/** A benchmark download */
+struct net_bench_download {
+	/** Data transfer interface */
+	struct interface xfer;
+	/** Data transfer buffer */
+	struct xfer_buffer buffer;
+	/** Downloaded data */
+	userptr_t data;
+	/** Download is in progress */
+	int running;
+	/** Final status code */
+	int rc;
+};
+
+/**
+ * Receive downloaded data
+ *
+ * @v download		Benchmark download
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int net_bench_deliver ( struct net_bench_download *download,
+			       struct io_buffer *iobuf,
+			       struct xfer_metadata *meta ) {
+
+	return xferbuf_deliver ( &download->buffer, iob_disown ( iobuf ),
+				 meta );
+}
+
+/**
+ * Handle download completion
+ *
+ * @v download		Benchmark download
+ * @v rc		Reason for completion
+ */
+static void net_bench_done ( struct net_bench_download *download, int rc ) {
+
+	intf_restart ( &download->xfer, rc );
+	download->running = 0;
+	download->rc = rc;
+}
+
+/** Benchmark download interface operations */
+static struct interface_operation net_bench_xfer_op[] = {
+	INTF_OP ( xfer_deliver, struct net_bench_download *,
+		  net_bench_deliver ),
+	INTF_OP ( intf_close, struct net_bench_download *, net_bench_done ),
+};
+
+/** Benchmark download interface descriptor */
+static struct interface_descriptor net_bench_xfer_desc =
+	INTF_DESC ( struct net_bench_download, xfer, net_bench_xfer_op );
+
+/** Benchmark download */
+static struct net_bench_download net_bench_download = {
+	.xfer = INTF_INIT ( net_bench_xfer_desc ),
+};
+
+/**
+ * Start benchmark download
+ *
+ * @v uri		URI
+ */
+static void net_bench_start ( struct uri *uri ) {
+	struct net_bench_download *download = &net_bench_download;
+	int rc;
+
+	xferbuf_free ( &download->buffer );
+	download->running = 1;
+	if ( ( rc = xfer_open_uri ( &download->xfer, uri ) ) != 0 )
+		net_bench_done ( download, rc );
+	assert ( rc == 0 );
+}
+
+/**
+ * Benchmark TCP/IP checksum
+ *
+ * @v len		Length of data
+ * @v offset		Offset of data within buffer
+ */
+static void tcpip_chksum_bench ( size_t len, unsigned int offset ) {
+	static uint8_t data[ 4096 + 2 ];
+	struct bench_measurement bench;
+
+	/* Sanity check */
+	assert ( ( offset + len ) <= sizeof ( data ) );
+
+	bench_start ( &bench, "tcpip_chksum %zd+%d", len, offset );
+	do {
+		profile_start ( &bench.profiler );
+		tcpip_chksum ( ( data + offset ), len );
+		profile_stop ( &bench.profiler );
+	} while ( bench_continue ( &bench, len ) );
+	bench_report ( &bench );
+}
+
+/**
+ * Benchmark TCP receive datapath
+ *
+ */
+static void tcp_rx_bench ( void ) {
+	struct net_bench_download *download = &net_bench_download;
+	struct bench_measurement bench;
+	struct in_addr client = { .s_addr = htonl ( NET_BENCH_CLIENT_IP ) };
+	struct in_addr server = { .s_addr = htonl ( NET_BENCH_SERVER_IP ) };
+	struct in_addr netmask = { .s_addr = htonl ( 0xffffff00UL ) };
+	struct net_device *netdev;
+	struct settings *settings;
+	struct uri *uri;
+	unsigned int responses;
+	size_t len;
+	int rc;
+
+	/* Create and open network device */
+	netdev = alloc_etherdev ( 0 );
+	assert ( netdev != NULL );
+	netdev_init ( netdev, &net_bench_operations );
+	netdev->dev = &net_bench_device;
+	memcpy ( netdev->hw_addr, net_bench_client_mac, ETH_ALEN );
+	rc = register_netdev ( netdev );
+	assert ( rc == 0 );
+	net_bench_netdev = netdev;
+	rc = netdev_open ( netdev );
+	assert ( rc == 0 );
+	netdev_link_up ( netdev );
+
+	/* Configure static address and neighbour */
+	settings = netdev_settings ( netdev );
+	rc = store_setting ( settings, &ip_setting, &client,
+			     sizeof ( client ) );
+	assert ( rc == 0 );
+	rc = store_setting ( settings, &netmask_setting, &netmask,
+			     sizeof ( netmask ) );
+	assert ( rc == 0 );
+	rc = neighbour_define ( netdev, &ipv4_protocol, &server,
+				net_bench_server_mac );
+	assert ( rc == 0 );
+
+	/* Start first download and allow connection to be established */
+	xferbuf_umalloc_init ( &download->buffer, &download->data );
+	uri = parse_uri ( NET_BENCH_URI );
+	assert ( uri != NULL );
+	net_bench_start ( uri );
+	while ( download->running && ! net_bench_server.responses )
+		step();
+
+	/* Measure receive datapath */
+	responses = net_bench_server.responses;
+	bench_start ( &bench, "tcp/http rx %d", NET_BENCH_MSS );
+	do {
+		/* Start new download when previous download completes */
+		if ( ! download->running ) {
+			assert ( download->rc == 0 );
+			assert ( download->buffer.len ==
+				 NET_BENCH_RESPONSE_LEN );
+			net_bench_start ( uri );
+		}
+
+		/* Inject and process next segment */
+		profile_start ( &bench.profiler );
+		len = net_bench_send();
+		net_poll();
+		profile_stop ( &bench.profiler );
+
+		/* Allow other processes (e.g. HTTP) to run if stalled */
+		if ( ! len )
+			step();
+
+	} while ( ( ! len ) || bench_continue ( &bench, len ) );
+	bench_report ( &bench );
+	printf ( "%d HTTP responses received\n",
+		 ( net_bench_server.responses - responses ) );
+
+	/* Shut down */
+	intf_shutdown ( &download->xfer, 0 );
+	xferbuf_free ( &download->buffer );
+	uri_put ( uri );
+	unregister_netdev ( netdev );
+	netdev_nullify ( netdev );
+	netdev_put ( netdev );
+	net_bench_netdev = NULL;
+}
+
+/**
+ * Perform network stack benchmarks
+ *
+ */
+static void net_bench_exec ( void ) {
+	unsigned int i;
+
+	/* Construct response body segment payload */
+	for ( i = 0 ; i < sizeof ( net_bench_payload ) ; i++ )
+		net_bench_payload[i] = i;
+	net_bench_payload_csum = tcpip_chksum ( net_bench_payload,
+						sizeof ( net_bench_payload ) );
+
+	/* Checksums */
+	tcpip_chksum_bench ( 1460, 0 );
+	tcpip_chksum_bench ( 1460, 2 );
+	tcpip_chksum_bench ( 4096, 0 );
+
+	/* Receive datapath */
+	tcp_rx_bench();
+}
+
+/** Network stack benchmarks */
+struct benchmark net_benchmark __benchmark = {
+	.name = "net",
+	.exec = net_bench_exec,
+};
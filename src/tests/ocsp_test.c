@@ -1789,6 +1789,39 @@ static time_t test_vultr = 1416697736ULL; /* Sat 22 Nov 23:08:56 2014 */
 	ok ( ocsp_validate ( (test)->ocsp, time ) != 0 );		\
 	} while ( 0 )
 
+/**
+ * Report OCSP stapled response test result
+ *
+ * @v test		OCSP test
+ * @v response		Stapled response
+ * @v len		Length of stapled response
+ */
+#define ocsp_staple_ok( test, response, len ) do {			\
+	ok ( ocsp_staple ( (test)->cert->cert, response, len ) == 0 );	\
+	} while ( 0 )
+
+/**
+ * Report OCSP cached response validation test result
+ *
+ * @v test		OCSP test
+ * @v time		Test time
+ */
+#define ocsp_cached_ok( test, time ) do {				\
+	ocsp_prepare_test ( (test) );					\
+	ok ( ocsp_cached ( (test)->ocsp, time ) == 0 );			\
+	} while ( 0 )
+
+/**
+ * Report OCSP cached response validation failure test result
+ *
+ * @v test		OCSP test
+ * @v time		Test time
+ */
+#define ocsp_cached_fail_ok( test, time ) do {				\
+	ocsp_prepare_test ( (test) );					\
+	ok ( ocsp_cached ( (test)->ocsp, time ) != 0 );			\
+	} while ( 0 )
+
 /**
  * Perform OCSP self-tests
  *
@@ -1837,6 +1870,21 @@ static void ocsp_test_exec ( void ) {
 	ocsp_validate_ok ( &vultr_ocsp, test_vultr );
 	ocsp_validate_fail_ok ( &vultr_ocsp, test_stale );
 
+	/* Cached response tests */
+	ocsp_cached_ok ( &barclays_ocsp, test_time );
+	ocsp_cached_fail_ok ( &barclays_ocsp, test_stale );
+	ocsp_cached_fail_ok ( &barclays_ocsp, test_time );
+	ocsp_cached_fail_ok ( &unknown_ocsp, test_time );
+
+	/* Stapled response tests */
+	ocsp_staple_ok ( &barclays_ocsp, barclays_ocsp_response,
+			 sizeof ( barclays_ocsp_response ) );
+	ocsp_cached_ok ( &barclays_ocsp, test_time );
+	ocsp_staple_ok ( &barclays_ocsp, google_ocsp_response,
+			 sizeof ( google_ocsp_response ) );
+	ocsp_cached_fail_ok ( &barclays_ocsp, test_time );
+	ocsp_cached_fail_ok ( &barclays_ocsp, test_time );
+
 	/* Drop OCSP check references */
 	ocsp_put ( unknown_ocsp.ocsp );
 	ocsp_put ( unauthorized_ocsp.ocsp );
@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * NIST P-256 elliptic curve tests
+ *
+ * Test vectors are taken from RFC 5903.
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <string.h>
+#include <ipxe/p256.h>
+#include <ipxe/test.h>
+
+/** Define inline base point */
+#define BASE(...) { __VA_ARGS__ }
+
+/** Define inline scalar */
+#define SCALAR(...) { __VA_ARGS__ }
+
+/** Define inline expected result */
+#define EXPECTED(...) { __VA_ARGS__ }
+
+/** A P-256 test */
+struct p256_test {
+	/** Base point */
+	const uint8_t *base;
+	/** Scalar */
+	const uint8_t *scalar;
+	/** Expected result */
+	const uint8_t *expected;
+};
+
+/**
+ * Define a P-256 test
+ *
+ * @v name		Test name
+ * @v BASE		Base point
+ * @v SCALAR		Scalar
+ * @v EXPECTED		Expected result
+ * @ret test		P-256 test
+ */
+#define P256_TEST( name, BASE, SCALAR, EXPECTED )			\
+	static const uint8_t name ## _base[P256_POINT_SIZE] = BASE;	\
+	static const uint8_t name ## _scalar[P256_SIZE] = SCALAR;	\
+	static const uint8_t name ## _expected[P256_POINT_SIZE] =	\
+		EXPECTED;						\
+	static struct p256_test name = {				\
+		.base = name ## _base,					\
+		.scalar = name ## _scalar,				\
+		.expected = name ## _expected,				\
+	}
+
+/** RFC 5903 section 8.1 initiator's public key */
+P256_TEST ( initiator,
+	BASE ( 0x04, 0x6b, 0x17, 0xd1, 0xf2, 0xe1, 0x2c, 0x42,
+	       0x47, 0xf8, 0xbc, 0xe6, 0xe5, 0x63, 0xa4, 0x40,
+	       0xf2, 0x77, 0x03, 0x7d, 0x81, 0x2d, 0xeb, 0x33,
+	       0xa0, 0xf4, 0xa1, 0x39, 0x45, 0xd8, 0x98, 0xc2,
+	       0x96, 0x4f, 0xe3, 0x42, 0xe2, 0xfe, 0x1a, 0x7f,
+	       0x9b, 0x8e, 0xe7, 0xeb, 0x4a, 0x7c, 0x0f, 0x9e,
+	       0x16, 0x2b, 0xce, 0x33, 0x57, 0x6b, 0x31, 0x5e,
+	       0xce, 0xcb, 0xb6, 0x40, 0x68, 0x37, 0xbf, 0x51,
+	       0xf5 ),
+	SCALAR ( 0xc8, 0x8f, 0x01, 0xf5, 0x10, 0xd9, 0xac, 0x3f,
+	         0x70, 0xa2, 0x92, 0xda, 0xa2, 0x31, 0x6d, 0xe5,
+	         0x44, 0xe9, 0xaa, 0xb8, 0xaf, 0xe8, 0x40, 0x49,
+	         0xc6, 0x2a, 0x9c, 0x57, 0x86, 0x2d, 0x14, 0x33 ),
+	EXPECTED ( 0x04, 0xda, 0xd0, 0xb6, 0x53, 0x94, 0x22, 0x1c,
+	           0xf9, 0xb0, 0x51, 0xe1, 0xfe, 0xca, 0x57, 0x87,
+	           0xd0, 0x98, 0xdf, 0xe6, 0x37, 0xfc, 0x90, 0xb9,
+	           0xef, 0x94, 0x5d, 0x0c, 0x37, 0x72, 0x58, 0x11,
+	           0x80, 0x52, 0x71, 0xa0, 0x46, 0x1c, 0xdb, 0x82,
+	           0x52, 0xd6, 0x1f, 0x1c, 0x45, 0x6f, 0xa3, 0xe5,
+	           0x9a, 0xb1, 0xf4, 0x5b, 0x33, 0xac, 0xcf, 0x5f,
+	           0x58, 0x38, 0x9e, 0x05, 0x77, 0xb8, 0x99, 0x0b,
+	           0xb3 ) );
+
+/** RFC 5903 section 8.1 responder's public key */
+P256_TEST ( responder,
+	BASE ( 0x04, 0x6b, 0x17, 0xd1, 0xf2, 0xe1, 0x2c, 0x42,
+	       0x47, 0xf8, 0xbc, 0xe6, 0xe5, 0x63, 0xa4, 0x40,
+	       0xf2, 0x77, 0x03, 0x7d, 0x81, 0x2d, 0xeb, 0x33,
+	       0xa0, 0xf4, 0xa1, 0x39, 0x45, 0xd8, 0x98, 0xc2,
+	       0x96, 0x4f, 0xe3, 0x42, 0xe2, 0xfe, 0x1a, 0x7f,
+	       0x9b, 0x8e, 0xe7, 0xeb, 0x4a, 0x7c, 0x0f, 0x9e,
+	       0x16, 0x2b, 0xce, 0x33, 0x57, 0x6b, 0x31, 0x5e,
+	       0xce, 0xcb, 0xb6, 0x40, 0x68, 0x37, 0xbf, 0x51,
+	       0xf5 ),
+	SCALAR ( 0xc6, 0xef, 0x9c, 0x5d, 0x78, 0xae, 0x01, 0x2a,
+	         0x01, 0x11, 0x64, 0xac, 0xb3, 0x97, 0xce, 0x20,
+	         0x88, 0x68, 0x5d, 0x8f, 0x06, 0xbf, 0x9b, 0xe0,
+	         0xb2, 0x83, 0xab, 0x46, 0x47, 0x6b, 0xee, 0x53 ),
+	EXPECTED ( 0x04, 0xd1, 0x2d, 0xfb, 0x52, 0x89, 0xc8, 0xd4,
+	           0xf8, 0x12, 0x08, 0xb7, 0x02, 0x70, 0x39, 0x8c,
+	           0x34, 0x22, 0x96, 0x97, 0x0a, 0x0b, 0xcc, 0xb7,
+	           0x4c, 0x73, 0x6f, 0xc7, 0x55, 0x44, 0x94, 0xbf,
+	           0x63, 0x56, 0xfb, 0xf3, 0xca, 0x36, 0x6c, 0xc2,
+	           0x3e, 0x81, 0x57, 0x85, 0x4c, 0x13, 0xc5, 0x8d,
+	           0x6a, 0xac, 0x23, 0xf0, 0x46, 0xad, 0xa3, 0x0f,
+	           0x83, 0x53, 0xe7, 0x4f, 0x33, 0x03, 0x98, 0x72,
+	           0xab ) );
+
+/** RFC 5903 section 8.1 shared secret */
+P256_TEST ( shared,
+	BASE ( 0x04, 0xd1, 0x2d, 0xfb, 0x52, 0x89, 0xc8, 0xd4,
+	       0xf8, 0x12, 0x08, 0xb7, 0x02, 0x70, 0x39, 0x8c,
+	       0x34, 0x22, 0x96, 0x97, 0x0a, 0x0b, 0xcc, 0xb7,
+	       0x4c, 0x73, 0x6f, 0xc7, 0x55, 0x44, 0x94, 0xbf,
+	       0x63, 0x56, 0xfb, 0xf3, 0xca, 0x36, 0x6c, 0xc2,
+	       0x3e, 0x81, 0x57, 0x85, 0x4c, 0x13, 0xc5, 0x8d,
+	       0x6a, 0xac, 0x23, 0xf0, 0x46, 0xad, 0xa3, 0x0f,
+	       0x83, 0x53, 0xe7, 0x4f, 0x33, 0x03, 0x98, 0x72,
+	       0xab ),
+	SCALAR ( 0xc8, 0x8f, 0x01, 0xf5, 0x10, 0xd9, 0xac, 0x3f,
+	         0x70, 0xa2, 0x92, 0xda, 0xa2, 0x31, 0x6d, 0xe5,
+	         0x44, 0xe9, 0xaa, 0xb8, 0xaf, 0xe8, 0x40, 0x49,
+	         0xc6, 0x2a, 0x9c, 0x57, 0x86, 0x2d, 0x14, 0x33 ),
+	EXPECTED ( 0x04, 0xd6, 0x84, 0x0f, 0x6b, 0x42, 0xf6, 0xed,
+	           0xaf, 0xd1, 0x31, 0x16, 0xe0, 0xe1, 0x25, 0x65,
+	           0x20, 0x2f, 0xef, 0x8e, 0x9e, 0xce, 0x7d, 0xce,
+	           0x03, 0x81, 0x24, 0x64, 0xd0, 0x4b, 0x94, 0x42,
+	           0xde, 0x52, 0x2b, 0xde, 0x0a, 0xf0, 0xd8, 0x58,
+	           0x5b, 0x8d, 0xef, 0x9c, 0x18, 0x3b, 0x5a, 0xe3,
+	           0x8f, 0x50, 0x23, 0x52, 0x06, 0xa8, 0x67, 0x4e,
+	           0xcb, 0x5d, 0x98, 0xed, 0xb2, 0x0e, 0xb1, 0x53,
+	           0xa2 ) );
+
+/** Point not on curve (RFC 5903 initiator's public key, corrupted) */
+static const uint8_t p256_not_on_curve[P256_POINT_SIZE] =
+	BASE ( 0x04, 0xda, 0xd0, 0xb6, 0x53, 0x94, 0x22, 0x1c,
+	       0xf9, 0xb0, 0x51, 0xe1, 0xfe, 0xca, 0x57, 0x87,
+	       0xd0, 0x98, 0xdf, 0xe6, 0x37, 0xfc, 0x90, 0xb9,
+	       0xef, 0x94, 0x5d, 0x0c, 0x37, 0x72, 0x58, 0x11,
+	       0x80, 0x52, 0x71, 0xa0, 0x46, 0x1c, 0xdb, 0x82,
+	       0x52, 0xd6, 0x1f, 0x1c, 0x45, 0x6f, 0xa3, 0xe5,
+	       0x9a, 0xb1, 0xf4, 0x5b, 0x33, 0xac, 0xcf, 0x5f,
+	       0x58, 0x38, 0x9e, 0x05, 0x77, 0xb8, 0x99, 0x0b,
+	       0xb2 );
+
+/**
+ * Report a P-256 test result
+ *
+ * @v test		P-256 test
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void p256_okx ( struct p256_test *test, const char *file,
+		       unsigned int line ) {
+	uint8_t result[P256_POINT_SIZE];
+
+	/* Calculate result */
+	okx ( elliptic_multiply ( &p256_curve, test->base, test->scalar,
+				  result ) == 0, file, line );
+	okx ( memcmp ( result, test->expected, sizeof ( result ) ) == 0,
+	      file, line );
+
+	/* Calculate result in place */
+	memcpy ( result, test->base, sizeof ( result ) );
+	okx ( p256_key ( result, test->scalar, result ) == 0, file, line );
+	okx ( memcmp ( result, test->expected, sizeof ( result ) ) == 0,
+	      file, line );
+}
+#define p256_ok( test ) p256_okx ( test, __FILE__, __LINE__ )
+
+/**
+ * Perform P-256 self-tests
+ *
+ */
+static void p256_test_exec ( void ) {
+	uint8_t result[P256_POINT_SIZE];
+	uint8_t zero[P256_SIZE];
+
+	/* Test vectors */
+	p256_ok ( &initiator );
+	p256_ok ( &responder );
+	p256_ok ( &shared );
+
+	/* Base point must match the generator */
+	ok ( memcmp ( p256_curve.base, initiator_base,
+		      sizeof ( initiator_base ) ) == 0 );
+
+	/* Point not on curve must be rejected */
+	ok ( p256_key ( p256_not_on_curve, initiator_scalar, result ) != 0 );
+
+	/* Compressed point must be rejected */
+	memcpy ( result, initiator_expected, sizeof ( result ) );
+	result[0] = 0x02;
+	ok ( p256_key ( result, responder_scalar, result ) != 0 );
+
+	/* Zero scalar must be rejected (result is point at infinity) */
+	memset ( zero, 0, sizeof ( zero ) );
+	ok ( p256_key ( initiator_base, zero, result ) != 0 );
+}
+
+/** P-256 self-test */
+struct self_test p256_test __self_test = {
+	.name = "p256",
+	.exec = p256_test_exec,
+};
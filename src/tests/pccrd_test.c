@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * Peer Content Caching and Retrieval: Discovery Protocol [MS-PCCRD] tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdlib.h>
+#include <string.h>
+#include <ipxe/pccrd.h>
+#include <ipxe/test.h>
+
+/** Test message UUID */
+#define UUID "12345678-9abc-def0-1234-56789abcdef0"
+
+/** Test segment identifier */
+#define ID "B1A6E3C0F41D0E5C0AA83FA0C7D41807A28F763C7D41F2C42C6E6F8B7A7BE1D3"
+
+/** Second test segment identifier */
+#define ID2 "0200000000000000000000000000000000000000000000000000000000000000"
+
+/**
+ * Check that two NUL-separated lists of strings are equal
+ *
+ * @v list		Zero-length-string-terminated list
+ * @v expected		Zero-length-string-terminated expected list
+ * @ret equal		Lists are equal
+ */
+static int pccrd_list_equal ( const char *list, const char *expected ) {
+	size_t len;
+
+	do {
+		len = strlen ( expected );
+		if ( strcmp ( list, expected ) != 0 )
+			return 0;
+		list += ( len + 1 );
+		expected += ( len + 1 );
+	} while ( len );
+
+	return 1;
+}
+
+/**
+ * Perform discovery self-tests
+ *
+ */
+static void pccrd_test_exec ( void ) {
+	struct peerdist_discovery_probe probe;
+	struct peerdist_discovery_reply reply;
+	char *request;
+	char *match;
+
+	/* Parse our own probe */
+	request = peerdist_discovery_request ( UUID, ID );
+	ok ( request != NULL );
+	if ( request ) {
+		ok ( peerdist_discovery_probe ( request, strlen ( request ),
+						&probe ) == 0 );
+		ok ( strcmp ( probe.id, "urn:uuid:" UUID ) == 0 );
+		ok ( pccrd_list_equal ( probe.ids, ID "\0" ) );
+		free ( request );
+	}
+
+	/* Parse our own probe match */
+	match = peerdist_discovery_match ( UUID, "urn:uuid:" UUID,
+					   ID " " ID2, "10.0.0.1:80",
+					   "00000003" "00000000" );
+	ok ( match != NULL );
+	if ( match ) {
+		ok ( peerdist_discovery_probe ( match, strlen ( match ),
+						&probe ) != 0 );
+		free ( match );
+	}
+	match = peerdist_discovery_match ( UUID, "urn:uuid:" UUID,
+					   ID " " ID2, "10.0.0.1:80",
+					   "00000003" "00000000" );
+	ok ( match != NULL );
+	if ( match ) {
+		ok ( peerdist_discovery_reply ( match, strlen ( match ),
+						&reply ) == 0 );
+		ok ( pccrd_list_equal ( reply.ids, ID "\0" ) );
+		ok ( pccrd_list_equal ( reply.locations, "10.0.0.1:80\0" ) );
+		free ( match );
+	}
+}
+
+/** Discovery self-test */
+struct self_test pccrd_test __self_test = {
+	.name = "pccrd",
+	.exec = pccrd_test_exec,
+};
@@ -33,6 +33,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #undef NDEBUG
 
 #include <string.h>
+#include <strings.h>
 #include <assert.h>
 #include <ipxe/test.h>
 #include <ipxe/profile.h>
@@ -103,6 +104,7 @@ static void profile_okx ( struct profile_test *test, const char *file,
 	struct profiler profiler;
 	unsigned long mean;
 	unsigned long stddev;
+	unsigned int total;
 	unsigned int i;
 
 	/* Initialise profiler */
@@ -118,6 +120,24 @@ static void profile_okx ( struct profile_test *test, const char *file,
 	DBGC ( test, "PROFILE calculated mean %ld stddev %ld\n", mean, stddev );
 	okx ( mean == test->mean, file, line );
 	okx ( stddev == test->stddev, file, line );
+
+	/* Check that histogram accounts for every sample */
+	for ( total = 0, i = 0 ; i < PROFILE_HISTOGRAM_BUCKETS ; i++ )
+		total += profiler.histogram[i];
+	okx ( total == test->count, file, line );
+	for ( i = 0 ; i < test->count ; i++ ) {
+		okx ( profiler.histogram[ flsl ( test->samples[i] ) ] != 0,
+		      file, line );
+	}
+
+	/* Check that reset clears all statistics */
+	profile_reset ( &profiler );
+	okx ( profiler.count == 0, file, line );
+	okx ( profile_mean ( &profiler ) == 0, file, line );
+	okx ( profile_stddev ( &profiler ) == 0, file, line );
+	for ( total = 0, i = 0 ; i < PROFILE_HISTOGRAM_BUCKETS ; i++ )
+		total += profiler.histogram[i];
+	okx ( total == 0, file, line );
 }
 #define profile_ok( test ) profile_okx ( test, __FILE__, __LINE__ )
 
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * Retry timer self-tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stddef.h>
+#include <ipxe/timer.h>
+#include <ipxe/retry.h>
+#include <ipxe/test.h>
+
+/** A retry timer test */
+struct retry_test {
+	/** Retry timer */
+	struct retry_timer timer;
+	/** Timeout (in ticks) */
+	unsigned long timeout;
+	/** Expiry time (in ticks), or zero if not yet expired */
+	unsigned long expired;
+	/** Expiry sequence number */
+	unsigned int sequence;
+};
+
+/** Expiry sequence counter */
+static unsigned int retry_test_sequence;
+
+/**
+ * Handle retry timer test expiry
+ *
+ * @v timer		Retry timer
+ * @v over		Failure indicator
+ */
+static void retry_test_expired ( struct retry_timer *timer,
+				 int over __unused ) {
+	struct retry_test *test =
+		container_of ( timer, struct retry_test, timer );
+
+	test->expired = currticks();
+	test->sequence = ++retry_test_sequence;
+}
+
+/** Retry timer tests, in order of expected expiry */
+static struct retry_test retry_tests[] = {
+	{ .timer = TIMER_INIT ( retry_test_expired ), .timeout = 0 },
+	{ .timer = TIMER_INIT ( retry_test_expired ), .timeout = 3 },
+	{ .timer = TIMER_INIT ( retry_test_expired ), .timeout = 40 },
+	{ .timer = TIMER_INIT ( retry_test_expired ), .timeout = 300 },
+	{ .timer = TIMER_INIT ( retry_test_expired ), .timeout = 600 },
+};
+
+/** Retry timer test that is stopped before expiry */
+static struct retry_test retry_stopped =
+	{ .timer = TIMER_INIT ( retry_test_expired ), .timeout = 20 };
+
+/** Retry timer test that is restarted before expiry */
+static struct retry_test retry_restarted =
+	{ .timer = TIMER_INIT ( retry_test_expired ), .timeout = 500 };
+
+/**
+ * Perform retry timer self-tests
+ *
+ */
+static void retry_test_exec ( void ) {
+	struct retry_test *test;
+	unsigned int running = retry_running;
+	unsigned long started;
+	unsigned int i;
+
+	/* Start timers (in reverse order of expiry) */
+	started = currticks();
+	for ( i = 0 ; i < ARRAY_SIZE ( retry_tests ) ; i++ ) {
+		test = &retry_tests[ ARRAY_SIZE ( retry_tests ) - i - 1 ];
+		start_timer_fixed ( &test->timer, test->timeout );
+	}
+	start_timer_fixed ( &retry_stopped.timer, retry_stopped.timeout );
+	start_timer_fixed ( &retry_restarted.timer, retry_restarted.timeout );
+	ok ( retry_running == ( running + 7 ) );
+
+	/* Stop one timer and restart another with a shorter timeout */
+	stop_timer ( &retry_stopped.timer );
+	ok ( ! timer_running ( &retry_stopped.timer ) );
+	start_timer_fixed ( &retry_restarted.timer, 10 );
+	ok ( retry_running == ( running + 6 ) );
+
+	/* Check time remaining until first expiry */
+	ok ( retry_remaining ( TICKS_PER_SEC ) == 0 );
+
+	/* Poll until all timers have expired */
+	while ( ( retry_running > running ) &&
+		( ( currticks() - started ) < ( 2 * TICKS_PER_SEC ) ) ) {
+		retry_poll();
+	}
+	ok ( retry_running == running );
+
+	/* Check that timers expired in order, and not early */
+	for ( i = 0 ; i < ARRAY_SIZE ( retry_tests ) ; i++ ) {
+		test = &retry_tests[i];
+		ok ( ! timer_running ( &test->timer ) );
+		ok ( test->sequence != 0 );
+		ok ( ( test->expired - started ) >= test->timeout );
+		if ( i ) {
+			ok ( test->sequence > retry_tests[ i - 1 ].sequence );
+		}
+	}
+
+	/* Check that stopped timer did not expire */
+	ok ( retry_stopped.sequence == 0 );
+
+	/* Check that restarted timer used the new timeout */
+	ok ( retry_restarted.sequence != 0 );
+	ok ( ( retry_restarted.expired - started ) < 500 );
+
+	/* Check time remaining until expiry */
+	start_timer_fixed ( &retry_stopped.timer, 300 );
+	ok ( retry_remaining ( TICKS_PER_SEC ) <= 300 );
+	ok ( retry_remaining ( 100 ) == 100 );
+	stop_timer ( &retry_stopped.timer );
+
+	/* Check that expiry of a timer started without delay does not
+	 * wait for the timer wheel to advance
+	 */
+	start_timer_nodelay ( &retry_stopped.timer );
+	retry_poll();
+	ok ( retry_stopped.sequence != 0 );
+	ok ( retry_running == running );
+}
+
+/** Retry timer self-test */
+struct self_test retry_test __self_test = {
+	.name = "retry",
+	.exec = retry_test_exec,
+};
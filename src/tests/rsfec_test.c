@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+/** @file
+ *
+ * Reed-Solomon forward error correction tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ipxe/rsfec.h>
+#include <ipxe/test.h>
+
+/** Symbol length used for randomised tests */
+#define RSFEC_TEST_LEN 16
+
+/** Known-answer source symbols */
+static const uint8_t rsfec_source[3][4] = {
+	{ 0x01, 0x02, 0x03, 0x04 },
+	{ 0x05, 0x06, 0x07, 0x08 },
+	{ 0x09, 0x0a, 0x0b, 0x0c },
+};
+
+/** Known-answer repair symbols (k=3, n=6) */
+static const uint8_t rsfec_repair[3][4] = {
+	{ 0x11, 0x12, 0x13, 0x54 },
+	{ 0x21, 0x22, 0x23, 0xb9 },
+	{ 0x41, 0x42, 0x43, 0x17 },
+};
+
+/**
+ * Report known-answer test result
+ *
+ * @v first		First received encoding symbol ID
+ * @v second		Second received encoding symbol ID
+ * @v third		Third received encoding symbol ID
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void rsfec_known_okx ( unsigned int first, unsigned int second,
+			      unsigned int third, const char *file,
+			      unsigned int line ) {
+	const void *source[3] = { rsfec_source[0], rsfec_source[1],
+				  rsfec_source[2] };
+	unsigned int esis[3] = { first, second, third };
+	uint8_t buffers[3][4];
+	void *symbols[3];
+	struct rsfec_code code;
+	unsigned int i;
+
+	/* Initialise code */
+	okx ( rsfec_init ( &code, 3, 6 ) == 0, file, line );
+
+	/* Check encoding */
+	for ( i = 0 ; i < 3 ; i++ ) {
+		symbols[i] = buffers[i];
+		okx ( rsfec_encode ( &code, source, esis[i], symbols[i],
+				     sizeof ( buffers[i] ) ) == 0, file, line );
+		if ( esis[i] >= 3 ) {
+			okx ( memcmp ( symbols[i], rsfec_repair[ esis[i] - 3 ],
+				       sizeof ( buffers[i] ) ) == 0,
+			      file, line );
+		}
+	}
+
+	/* Check decoding */
+	okx ( rsfec_decode ( &code, symbols, esis,
+			     sizeof ( buffers[0] ) ) == 0, file, line );
+	for ( i = 0 ; i < 3 ; i++ ) {
+		okx ( esis[i] == i, file, line );
+		okx ( memcmp ( symbols[i], rsfec_source[i],
+			       sizeof ( rsfec_source[i] ) ) == 0, file, line );
+	}
+
+	rsfec_fini ( &code );
+}
+#define rsfec_known_ok( first, second, third ) \
+	rsfec_known_okx ( first, second, third, __FILE__, __LINE__ )
+
+/**
+ * Report randomised round-trip test result
+ *
+ * @v k			Number of source symbols per block
+ * @v n			Number of encoding symbols per block
+ * @v lost		Number of source symbols lost
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void rsfec_random_okx ( unsigned int k, unsigned int n,
+			       unsigned int lost, const char *file,
+			       unsigned int line ) {
+	uint8_t data[k][RSFEC_TEST_LEN];
+	uint8_t buffers[k][RSFEC_TEST_LEN];
+	const void *source[k];
+	void *symbols[k];
+	unsigned int esis[k];
+	struct rsfec_code code;
+	unsigned int repair;
+	unsigned int i;
+	unsigned int j;
+
+	/* Construct random source symbols */
+	for ( i = 0 ; i < k ; i++ ) {
+		for ( j = 0 ; j < RSFEC_TEST_LEN ; j++ )
+			data[i][j] = random();
+		source[i] = data[i];
+	}
+
+	/* Initialise code */
+	okx ( rsfec_init ( &code, k, n ) == 0, file, line );
+
+	/* Lose evenly spaced source symbols, replacing them with the
+	 * last repair symbols, and present symbols in reverse order.
+	 */
+	repair = n;
+	for ( i = 0 ; i < k ; i++ ) {
+		symbols[ k - i - 1 ] = buffers[i];
+		esis[ k - i - 1 ] = ( ( ( i * lost / k ) !=
+					( ( i + 1 ) * lost / k ) ) ?
+				      --repair : i );
+		okx ( rsfec_encode ( &code, source, esis[ k - i - 1 ],
+				     buffers[i], RSFEC_TEST_LEN ) == 0,
+		      file, line );
+	}
+	okx ( repair == ( n - lost ), file, line );
+
+	/* Reconstruct source symbols */
+	okx ( rsfec_decode ( &code, symbols, esis, RSFEC_TEST_LEN ) == 0,
+	      file, line );
+	for ( i = 0 ; i < k ; i++ ) {
+		okx ( esis[i] == i, file, line );
+		okx ( memcmp ( symbols[i], data[i], RSFEC_TEST_LEN ) == 0,
+		      file, line );
+	}
+
+	rsfec_fini ( &code );
+}
+#define rsfec_random_ok( k, n, lost ) \
+	rsfec_random_okx ( k, n, lost, __FILE__, __LINE__ )
+
+/**
+ * Perform Reed-Solomon forward error correction self-tests
+ *
+ */
+static void rsfec_test_exec ( void ) {
+	struct rsfec_code code;
+	uint8_t buffers[2][4];
+	void *symbols[2] = { buffers[0], buffers[1] };
+	unsigned int esis[2] = { 0, 0 };
+	const void *source[1] = { rsfec_source[0] };
+
+	/* Known-answer tests */
+	rsfec_known_ok ( 0, 1, 2 );
+	rsfec_known_ok ( 2, 0, 1 );
+	rsfec_known_ok ( 3, 1, 2 );
+	rsfec_known_ok ( 0, 5, 4 );
+	rsfec_known_ok ( 5, 3, 4 );
+
+	/* Randomised round-trip tests */
+	rsfec_random_ok ( 1, 2, 1 );
+	rsfec_random_ok ( 8, 12, 4 );
+	rsfec_random_ok ( 32, 48, 3 );
+	rsfec_random_ok ( 64, 96, 32 );
+	rsfec_random_ok ( 200, 255, 55 );
+
+	/* Invalid parameters */
+	ok ( rsfec_init ( &code, 0, 1 ) != 0 );
+	ok ( rsfec_init ( &code, 4, 3 ) != 0 );
+	ok ( rsfec_init ( &code, 4, 256 ) != 0 );
+
+	/* A single-symbol block has repair symbols equal to the source */
+	ok ( rsfec_init ( &code, 1, 3 ) == 0 );
+	ok ( rsfec_encode ( &code, source, 2, buffers[0],
+			    sizeof ( buffers[0] ) ) == 0 );
+	ok ( memcmp ( buffers[0], rsfec_source[0],
+		      sizeof ( buffers[0] ) ) == 0 );
+	ok ( rsfec_encode ( &code, source, 3, buffers[0],
+			    sizeof ( buffers[0] ) ) != 0 );
+	rsfec_fini ( &code );
+
+	/* Duplicate encoding symbols are rejected */
+	ok ( rsfec_init ( &code, 2, 4 ) == 0 );
+	ok ( rsfec_decode ( &code, symbols, esis,
+			    sizeof ( buffers[0] ) ) != 0 );
+	rsfec_fini ( &code );
+}
+
+/** Reed-Solomon forward error correction self-test */
+struct self_test rsfec_test __self_test = {
+	.name = "rsfec",
+	.exec = rsfec_test_exec,
+};
@@ -33,7 +33,10 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #undef NDEBUG
 
 #include <string.h>
+#include <stdio.h>
+#include <byteswap.h>
 #include <ipxe/settings.h>
+#include <ipxe/dhcp.h>
 #include <ipxe/test.h>
 
 /** Define inline raw data */
@@ -256,6 +259,102 @@ static struct setting test_busdevfn_setting = {
 	.type = &setting_type_busdevfn,
 };
 
+/** Test tagged setting */
+static struct setting test_tagged_setting = {
+	.name = "test_tagged",
+	.tag = 0xaf05,
+	.type = &setting_type_string,
+};
+
+/** Test setting with same tag as tagged setting */
+static struct setting test_tagged_alias_setting = {
+	.name = "test_tagged_alias",
+	.tag = 0xaf05,
+	.type = &setting_type_string,
+};
+
+/** Number of settings to store for hashed lookup tests */
+#define TEST_MANY_COUNT 64
+
+/**
+ * Perform hashed lookup self-tests
+ *
+ */
+static void settings_index_test ( void ) {
+	struct setting setting;
+	struct settings *settings;
+	char name[32];
+	char fetched[32];
+	uint32_t value;
+	unsigned int i;
+	int len;
+
+	/* Store many settings */
+	for ( i = 0 ; i < TEST_MANY_COUNT ; i++ ) {
+		snprintf ( name, sizeof ( name ), "test_many_%d", i );
+		memset ( &setting, 0, sizeof ( setting ) );
+		setting.name = name;
+		setting.type = &setting_type_uint32;
+		ok ( storen_setting ( &test_settings, &setting, i ) == 0 );
+	}
+
+	/* Fetch many settings, in reverse order */
+	for ( i = TEST_MANY_COUNT ; i-- ; ) {
+		snprintf ( name, sizeof ( name ), "test_many_%d", i );
+		memset ( &setting, 0, sizeof ( setting ) );
+		setting.name = name;
+		ok ( fetch_setting ( &test_settings, &setting, NULL, NULL,
+				     &value, sizeof ( value ) ) ==
+		     sizeof ( value ) );
+		ok ( ntohl ( value ) == i );
+	}
+
+	/* Delete alternate settings */
+	for ( i = 0 ; i < TEST_MANY_COUNT ; i += 2 ) {
+		snprintf ( name, sizeof ( name ), "test_many_%d", i );
+		memset ( &setting, 0, sizeof ( setting ) );
+		setting.name = name;
+		ok ( delete_setting ( &test_settings, &setting ) == 0 );
+	}
+	for ( i = 0 ; i < TEST_MANY_COUNT ; i++ ) {
+		snprintf ( name, sizeof ( name ), "test_many_%d", i );
+		memset ( &setting, 0, sizeof ( setting ) );
+		setting.name = name;
+		len = fetch_setting ( &test_settings, &setting, NULL, NULL,
+				      NULL, 0 );
+		if ( i & 1 ) {
+			ok ( len == ( ( int ) sizeof ( value ) ) );
+			ok ( delete_setting ( &test_settings, &setting ) == 0 );
+		} else {
+			ok ( len < 0 );
+		}
+	}
+
+	/* Settings with matching tags should be interchangeable */
+	ok ( storef_setting ( &test_settings, &test_tagged_setting,
+			      "tagged" ) == 0 );
+	ok ( fetchf_setting ( &test_settings, &test_tagged_alias_setting,
+			      NULL, NULL, fetched, sizeof ( fetched ) ) > 0 );
+	ok ( strcmp ( fetched, "tagged" ) == 0 );
+	ok ( storef_setting ( &test_settings, &test_tagged_alias_setting,
+			      "alias" ) == 0 );
+	ok ( fetchf_setting ( &test_settings, &test_tagged_setting,
+			      NULL, NULL, fetched, sizeof ( fetched ) ) > 0 );
+	ok ( strcmp ( fetched, "alias" ) == 0 );
+	ok ( delete_setting ( &test_settings, &test_tagged_setting ) == 0 );
+	ok ( fetch_setting ( &test_settings, &test_tagged_alias_setting,
+			     NULL, NULL, NULL, 0 ) < 0 );
+
+	/* Predefined settings should be found by name and by tag */
+	ok ( find_setting ( "hostname" ) == &hostname_setting );
+	ok ( find_setting ( "test_nonexistent" ) == NULL );
+	snprintf ( name, sizeof ( name ), "%d", DHCP_HOST_NAME );
+	ok ( parse_setting_name ( name, find_child_settings, &settings,
+				  &setting ) == 0 );
+	ok ( strcmp ( setting.name, hostname_setting.name ) == 0 );
+	ok ( setting.type == hostname_setting.type );
+}
+
 /**
  * Perform settings self-tests
  *
@@ -426,6 +525,9 @@ static void settings_test_exec ( void ) {
 	fetchf_ok ( &test_settings, &test_busdevfn_setting,
 		    RAW ( 0x00, 0x02, 0x0a, 0x21 ), "0002:0a:04.1" );
 
+	/* Hashed lookups */
+	settings_index_test();
+
 	/* Clear and unregister test settings block */
 	clear_settings ( &test_settings );
 	unregister_settings ( &test_settings );
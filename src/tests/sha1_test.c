@@ -31,15 +31,28 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  *
  *  http://csrc.nist.gov/groups/ST/toolkit/documents/Examples/SHA1.pdf
  *
+ * PBKDF2 test vectors are taken from RFC 6070 and from IEEE Std
+ * 802.11-2007 Annex H.4.
+ *
  */
 
 /* Forcibly enable assertions */
 #undef NDEBUG
 
+#include <string.h>
 #include <ipxe/sha1.h>
 #include <ipxe/test.h>
 #include "digest_test.h"
 
+/* Identify architecture-specific accelerated implementation, if any */
+#if defined ( __i386__ ) || defined ( __x86_64__ )
+#define SHA1_ACCEL shani_enabled
+#define SHA1_ACCEL_NAME "SHA-NI"
+#elif defined ( __aarch64__ )
+#define SHA1_ACCEL arm64_sha1_enabled
+#define SHA1_ACCEL_NAME "ARMv8-CE"
+#endif
+
 /* Empty test vector (digest obtained from "sha1sum /dev/null") */
 DIGEST_TEST ( sha1_empty, &sha1_algorithm, DIGEST_EMPTY,
 	      DIGEST ( 0xda, 0x39, 0xa3, 0xee, 0x5e, 0x6b, 0x4b, 0x0d, 0x32,
@@ -58,20 +71,82 @@ DIGEST_TEST ( sha1_nist_abc_opq, &sha1_algorithm, DIGEST_NIST_ABC_OPQ,
 		       0xae, 0x4a, 0xa1, 0xf9, 0x51, 0x29, 0xe5, 0xe5, 0x46,
 		       0x70, 0xf1 ) );
 
+/** RFC 6070 PBKDF2 test vector (4096 iterations) */
+static const uint8_t pbkdf2_rfc6070[] = {
+	0x4b, 0x00, 0x79, 0x01, 0xb7, 0x65, 0x48, 0x9a, 0xbe, 0xad, 0x49,
+	0xd9, 0x26, 0xf7, 0x21, 0xd0, 0x65, 0xa4, 0x29, 0xc1
+};
+
+/** IEEE 802.11 WPA passphrase test vector */
+static const uint8_t pbkdf2_wpa[] = {
+	0xf4, 0x2c, 0x6f, 0xc5, 0x2d, 0xf0, 0xeb, 0xef, 0x9e, 0xbb, 0x4b,
+	0x90, 0xb3, 0x8a, 0x5f, 0x90, 0x2e, 0x83, 0xfe, 0x1b, 0x13, 0x5a,
+	0x70, 0xe2, 0x3a, 0xed, 0x76, 0x2e, 0x97, 0x10, 0xa1, 0x2e
+};
+
 /**
- * Perform SHA-1 self-test
+ * Report PBKDF2-SHA1 test result
  *
+ * @v passphrase	Passphrase
+ * @v salt		Salt
+ * @v iterations	Number of iterations
+ * @v expected		Expected key
+ * @v len		Length of key
+ * @v file		Test code file
+ * @v line		Test code line
  */
-static void sha1_test_exec ( void ) {
+static void pbkdf2_sha1_okx ( const char *passphrase, const char *salt,
+			      int iterations, const void *expected,
+			      size_t len, const char *file,
+			      unsigned int line ) {
+	uint8_t key[len];
+
+	pbkdf2_sha1 ( passphrase, strlen ( passphrase ), salt,
+		      strlen ( salt ), iterations, key, len );
+	okx ( memcmp ( key, expected, len ) == 0, file, line );
+}
+#define pbkdf2_sha1_ok( passphrase, salt, iterations, expected )	\
+	pbkdf2_sha1_okx ( passphrase, salt, iterations, expected,	\
+			  sizeof ( expected ), __FILE__, __LINE__ )
+
+/**
+ * Perform SHA-1 self-test using the current backend
+ *
+ * @v backend		Backend name
+ */
+static void sha1_test_backend ( const char *backend ) {
 
 	/* Correctness tests */
 	digest_ok ( &sha1_empty );
 	digest_ok ( &sha1_nist_abc );
 	digest_ok ( &sha1_nist_abc_opq );
+	pbkdf2_sha1_ok ( "password", "salt", 4096, pbkdf2_rfc6070 );
+	pbkdf2_sha1_ok ( "password", "IEEE", 4096, pbkdf2_wpa );
 
 	/* Speed tests */
-	DBG ( "SHA1 required %ld cycles per byte\n",
-	      digest_cost ( &sha1_algorithm ) );
+	DBG ( "SHA1 (%s) required %ld cycles per byte\n",
+	      backend, digest_cost ( &sha1_algorithm ) );
+}
+
+/**
+ * Perform SHA-1 self-test
+ *
+ */
+static void sha1_test_exec ( void ) {
+#ifdef SHA1_ACCEL
+	int accelerated = SHA1_ACCEL;
+
+	/* Test generic implementation */
+	SHA1_ACCEL = 0;
+	sha1_test_backend ( "generic" );
+	SHA1_ACCEL = accelerated;
+
+	/* Test accelerated implementation, if available */
+	if ( accelerated )
+		sha1_test_backend ( SHA1_ACCEL_NAME );
+#else
+	sha1_test_backend ( "generic" );
+#endif
 }
 
 /** SHA-1 self-test */
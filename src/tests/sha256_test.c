@@ -41,6 +41,15 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/test.h>
 #include "digest_test.h"
 
+/* Identify architecture-specific accelerated implementation, if any */
+#if defined ( __i386__ ) || defined ( __x86_64__ )
+#define SHA256_ACCEL shani_enabled
+#define SHA256_ACCEL_NAME "SHA-NI"
+#elif defined ( __aarch64__ )
+#define SHA256_ACCEL arm64_sha256_enabled
+#define SHA256_ACCEL_NAME "ARMv8-CE"
+#endif
+
 /* Empty test vector (digest obtained from "sha256sum /dev/null") */
 DIGEST_TEST ( sha256_empty, &sha256_algorithm, DIGEST_EMPTY,
 	      DIGEST ( 0xe3, 0xb0, 0xc4, 0x42, 0x98, 0xfc, 0x1c, 0x14, 0x9a,
@@ -84,10 +93,11 @@ DIGEST_TEST ( sha224_nist_abc_opq, &sha224_algorithm, DIGEST_NIST_ABC_OPQ,
 		       0x25 ) );
 
 /**
- * Perform SHA-256 family self-test
+ * Perform SHA-256 family self-test using the current backend
  *
+ * @v backend		Backend name
  */
-static void sha256_test_exec ( void ) {
+static void sha256_test_backend ( const char *backend ) {
 
 	/* Correctness tests */
 	digest_ok ( &sha256_empty );
@@ -98,10 +108,31 @@ static void sha256_test_exec ( void ) {
 	digest_ok ( &sha224_nist_abc_opq );
 
 	/* Speed tests */
-	DBG ( "SHA256 required %ld cycles per byte\n",
-	      digest_cost ( &sha256_algorithm ) );
-	DBG ( "SHA224 required %ld cycles per byte\n",
-	      digest_cost ( &sha224_algorithm ) );
+	DBG ( "SHA256 (%s) required %ld cycles per byte\n",
+	      backend, digest_cost ( &sha256_algorithm ) );
+	DBG ( "SHA224 (%s) required %ld cycles per byte\n",
+	      backend, digest_cost ( &sha224_algorithm ) );
+}
+
+/**
+ * Perform SHA-256 family self-test
+ *
+ */
+static void sha256_test_exec ( void ) {
+#ifdef SHA256_ACCEL
+	int accelerated = SHA256_ACCEL;
+
+	/* Test generic implementation */
+	SHA256_ACCEL = 0;
+	sha256_test_backend ( "generic" );
+	SHA256_ACCEL = accelerated;
+
+	/* Test accelerated implementation, if available */
+	if ( accelerated )
+		sha256_test_backend ( SHA256_ACCEL_NAME );
+#else
+	sha256_test_backend ( "generic" );
+#endif
 }
 
 /** SHA-256 family self-test */
@@ -104,6 +104,16 @@ static void string_test_exec ( void ) {
 	ok ( strcasecmp ( "Uncle", "Uncle Jack" ) != 0 );
 	ok ( strcasecmp ( "not", "equal" ) != 0 );
 
+	/* Test strncasecmp() */
+	ok ( strncasecmp ( "", "", 0 ) == 0 );
+	ok ( strncasecmp ( "", "", 15 ) == 0 );
+	ok ( strncasecmp ( "Uncle Jack", "Uncle jack", 10 ) == 0 );
+	ok ( strncasecmp ( "Uncle Jack", "uncle JACK", 16 ) == 0 );
+	ok ( strncasecmp ( "Uncle Jack", "Uncle", 5 ) == 0 );
+	ok ( strncasecmp ( "Uncle Jack", "Uncle", 6 ) != 0 );
+	ok ( strncasecmp ( "not", "equal", 0 ) == 0 );
+	ok ( strncasecmp ( "not", "equal", 1 ) != 0 );
+
 	/* Test memcmp() */
 	ok ( memcmp ( "", "", 0 ) == 0 );
 	ok ( memcmp ( "Foo", "Foo", 3 ) == 0 );
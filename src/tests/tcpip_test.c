@@ -40,9 +40,27 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/profile.h>
 #include <ipxe/tcpip.h>
 
+/* Identify architecture-specific accelerated implementations, if any */
+#if defined ( __i386__ ) || defined ( __x86_64__ )
+#define TCPIP_ACCEL x86_tcpip_simd
+#define TCPIP_ACCEL_BACKENDS						\
+	{ X86_TCPIP_SSE2, "SSE2" }, { X86_TCPIP_AVX2, "AVX2" }
+#elif defined ( __aarch64__ )
+#define TCPIP_ACCEL arm64_tcpip_simd
+#define TCPIP_ACCEL_BACKENDS { ARM64_TCPIP_NEON, "NEON" }
+#endif
+
 /** Number of sample iterations for profiling */
 #define PROFILE_COUNT 16
 
+/** An accelerated TCP/IP checksum implementation */
+struct tcpip_backend {
+	/** Accelerated implementation flag */
+	unsigned int accel;
+	/** Name */
+	const char *name;
+};
+
 /** A TCP/IP fixed-data test */
 struct tcpip_test {
 	/** Data */
@@ -123,6 +141,15 @@ TCPIP_RANDOM_TEST ( random_aligned_truncated, 0x12345678UL, 4095, 0 );
 /** Random data (unaligned start and finish) */
 TCPIP_RANDOM_TEST ( partial, 0xcafebabe, 121, 5 );
 
+/** Random data (just too short for vector instructions) */
+TCPIP_RANDOM_TEST ( random_short, 0x87654321UL, 63, 0 );
+
+/** Random data (vector block plus scalar remainder) */
+TCPIP_RANDOM_TEST ( random_remainder, 0x87654321UL, 319, 3 );
+
+/** Random data (typical TCP segment payload alignment) */
+TCPIP_RANDOM_TEST ( random_segment, 0xdeadbeefUL, 1460, 2 );
+
 /**
  * Calculate TCP/IP checksum
  *
@@ -195,7 +222,6 @@ static void tcpip_okx ( struct tcpip_test *test, const char *file,
 static void tcpip_random_okx ( struct tcpip_random_test *test,
 			       const char *file, unsigned int line ) {
 	uint8_t *data = ( tcpip_data + test->offset );
-	struct profiler profiler;
 	uint16_t expected;
 	uint16_t generic_sum;
 	uint16_t sum;
@@ -218,26 +244,45 @@ static void tcpip_random_okx ( struct tcpip_random_test *test,
 	/* Verify optimised tcpip_continue_chksum() result */
 	sum = tcpip_continue_chksum ( TCPIP_EMPTY_CSUM, data, test->len );
 	okx ( sum == expected, file, line );
+}
+#define tcpip_random_ok( test ) tcpip_random_okx ( test, __FILE__, __LINE__ )
+
+/**
+ * Report TCP/IP checksum throughput
+ *
+ * @v backend		Backend name
+ * @v len		Length of data
+ * @v offset		Alignment offset
+ */
+static void tcpip_speed ( const char *backend, size_t len, size_t offset ) {
+	uint8_t *data = ( tcpip_data + offset );
+	struct profiler profiler;
+	unsigned long mean;
+	unsigned int i;
+
+	/* Sanity check */
+	assert ( ( len + offset ) <= sizeof ( tcpip_data ) );
 
 	/* Profile optimised calculation */
 	memset ( &profiler, 0, sizeof ( profiler ) );
 	for ( i = 0 ; i < PROFILE_COUNT ; i++ ) {
 		profile_start ( &profiler );
-		sum = tcpip_continue_chksum ( TCPIP_EMPTY_CSUM, data,
-					      test->len );
+		tcpip_continue_chksum ( TCPIP_EMPTY_CSUM, data, len );
 		profile_stop ( &profiler );
 	}
-	DBG ( "TCPIP checksummed %zd bytes (+%zd) in %ld +/- %ld ticks\n",
-	      test->len, test->offset, profile_mean ( &profiler ),
-	      profile_stddev ( &profiler ) );
+	mean = profile_mean ( &profiler );
+	DBG ( "TCPIP (%s) checksummed %zd bytes (+%zd) in %ld +/- %ld ticks "
+	      "(%ld bytes per 100 ticks)\n", backend, len, offset, mean,
+	      profile_stddev ( &profiler ),
+	      ( mean ? ( ( len * 100 ) / mean ) : 0 ) );
 }
-#define tcpip_random_ok( test ) tcpip_random_okx ( test, __FILE__, __LINE__ )
 
 /**
- * Perform TCP/IP self-tests
+ * Perform TCP/IP self-tests using the current backend
  *
+ * @v backend		Backend name
  */
-static void tcpip_test_exec ( void ) {
+static void tcpip_test_backend ( const char *backend ) {
 
 	tcpip_ok ( &empty );
 	tcpip_ok ( &one_byte );
@@ -251,6 +296,42 @@ static void tcpip_test_exec ( void ) {
 	tcpip_random_ok ( &random_unaligned_2 );
 	tcpip_random_ok ( &random_aligned_truncated );
 	tcpip_random_ok ( &partial );
+	tcpip_random_ok ( &random_short );
+	tcpip_random_ok ( &random_remainder );
+	tcpip_random_ok ( &random_segment );
+
+	/* Speed tests */
+	tcpip_speed ( backend, 4096, 0 );
+	tcpip_speed ( backend, 1460, 2 );
+}
+
+/**
+ * Perform TCP/IP self-tests
+ *
+ */
+static void tcpip_test_exec ( void ) {
+#ifdef TCPIP_ACCEL
+	static const struct tcpip_backend backends[] = {
+		TCPIP_ACCEL_BACKENDS
+	};
+	unsigned int accelerated = TCPIP_ACCEL;
+	unsigned int i;
+
+	/* Test scalar implementation */
+	TCPIP_ACCEL = 0;
+	tcpip_test_backend ( "scalar" );
+
+	/* Test accelerated implementations, if available */
+	for ( i = 0 ; i < ARRAY_SIZE ( backends ) ; i++ ) {
+		if ( ! ( accelerated & backends[i].accel ) )
+			continue;
+		TCPIP_ACCEL = backends[i].accel;
+		tcpip_test_backend ( backends[i].name );
+	}
+	TCPIP_ACCEL = accelerated;
+#else
+	tcpip_test_backend ( "generic" );
+#endif
 }
 
 /** TCP/IP self-test */
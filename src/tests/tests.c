@@ -42,6 +42,7 @@ REQUIRE_OBJECT ( base64_test );
 REQUIRE_OBJECT ( base16_test );
 REQUIRE_OBJECT ( settings_test );
 REQUIRE_OBJECT ( time_test );
+REQUIRE_OBJECT ( hrclock_test );
 REQUIRE_OBJECT ( tcpip_test );
 REQUIRE_OBJECT ( ipv4_test );
 REQUIRE_OBJECT ( ipv6_test );
@@ -56,20 +57,39 @@ REQUIRE_OBJECT ( hmac_drbg_test );
 REQUIRE_OBJECT ( hash_df_test );
 REQUIRE_OBJECT ( bigint_test );
 REQUIRE_OBJECT ( rsa_test );
+REQUIRE_OBJECT ( x25519_test );
+REQUIRE_OBJECT ( p256_test );
+REQUIRE_OBJECT ( ecdsa_test );
 REQUIRE_OBJECT ( x509_test );
 REQUIRE_OBJECT ( ocsp_test );
+REQUIRE_OBJECT ( hpack_test );
 REQUIRE_OBJECT ( cms_test );
 REQUIRE_OBJECT ( pnm_test );
 REQUIRE_OBJECT ( deflate_test );
 REQUIRE_OBJECT ( png_test );
+REQUIRE_OBJECT ( gzip_test );
+REQUIRE_OBJECT ( zstd_test );
+REQUIRE_OBJECT ( xz_test );
 REQUIRE_OBJECT ( dns_test );
 REQUIRE_OBJECT ( uri_test );
 REQUIRE_OBJECT ( profile_test );
 REQUIRE_OBJECT ( setjmp_test );
 REQUIRE_OBJECT ( pccrc_test );
+REQUIRE_OBJECT ( pccrd_test );
+REQUIRE_OBJECT ( rsfec_test );
+REQUIRE_OBJECT ( bitmap_test );
 REQUIRE_OBJECT ( linebuf_test );
 REQUIRE_OBJECT ( iobuf_test );
 REQUIRE_OBJECT ( bitops_test );
 REQUIRE_OBJECT ( der_test );
 REQUIRE_OBJECT ( pem_test );
 REQUIRE_OBJECT ( ntlm_test );
+REQUIRE_OBJECT ( trace_test );
+REQUIRE_OBJECT ( gcm_test );
+REQUIRE_OBJECT ( chacha20_test );
+REQUIRE_OBJECT ( retry_test );
+REQUIRE_OBJECT ( interface_test );
+REQUIRE_OBJECT ( cpio_test );
+REQUIRE_OBJECT ( fragment_test );
+REQUIRE_OBJECT ( worker_test );
+REQUIRE_OBJECT ( decompress_test );
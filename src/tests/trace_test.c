@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * Boot timeline tracing self-tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <string.h>
+#include <ipxe/trace.h>
+#include <ipxe/test.h>
+
+/**
+ * Perform boot timeline tracing self-tests
+ *
+ */
+static void trace_test_exec ( void ) {
+	struct trace_event *event;
+	unsigned int start;
+	unsigned int mark;
+	unsigned int i;
+
+	/* Clear trace */
+	trace_clear();
+	ok ( trace_first() == trace_next );
+
+	/* Record start, instantaneous and stop events */
+	start = trace_start ( "test %d", 1 );
+	mark = trace_next;
+	trace_mark ( "mark" );
+	trace_stop ( start, -1 );
+	ok ( ( trace_next - trace_first() ) == 3 );
+
+	/* Check start event */
+	event = trace_event ( start );
+	ok ( event != NULL );
+	ok ( event->type == TRACE_START );
+	ok ( strcmp ( event->name, "test 1" ) == 0 );
+
+	/* Check instantaneous event */
+	event = trace_event ( mark );
+	ok ( event != NULL );
+	ok ( event->type == TRACE_MARK );
+	ok ( strcmp ( event->name, "mark" ) == 0 );
+
+	/* Check stop event */
+	event = trace_event ( mark + 1 );
+	ok ( event != NULL );
+	ok ( event->type == TRACE_STOP );
+	ok ( event->start == start );
+	ok ( event->rc == -1 );
+	ok ( strcmp ( event->name, "test 1" ) == 0 );
+
+	/* Check that nonexistent events are not returned */
+	ok ( trace_event ( trace_next ) == NULL );
+	ok ( trace_event ( start - 1 ) == NULL );
+
+	/* Check that overwritten events are not returned */
+	for ( i = 0 ; i < TRACE_MAX_EVENTS ; i++ )
+		trace_mark ( "overflow %d", i );
+	ok ( trace_event ( start ) == NULL );
+	ok ( ( trace_next - trace_first() ) == TRACE_MAX_EVENTS );
+	event = trace_event ( trace_first() );
+	ok ( event != NULL );
+	ok ( strcmp ( event->name, "overflow 0" ) == 0 );
+
+	/* Check that stop events for overwritten start events are unnamed */
+	trace_stop ( start, 0 );
+	event = trace_event ( trace_next - 1 );
+	ok ( event != NULL );
+	ok ( event->name[0] == '\0' );
+
+	/* Clear trace */
+	trace_clear();
+	ok ( trace_event ( trace_next - 1 ) == NULL );
+}
+
+/** Boot timeline tracing self-test */
+struct self_test trace_test __self_test = {
+	.name = "trace",
+	.exec = trace_test_exec,
+};
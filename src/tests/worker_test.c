@@ -0,0 +1,279 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * Worker CPU core self-tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <ipxe/process.h>
+#include <ipxe/crypto.h>
+#include <ipxe/sha256.h>
+#include <ipxe/worker.h>
+#include <ipxe/test.h>
+
+/** A worker test job */
+struct worker_test_job {
+	/** Worker job */
+	struct worker_job job;
+	/** Run sequence number, or zero if not yet run */
+	unsigned int ran;
+	/** Completion sequence number, or zero if not yet completed */
+	unsigned int done;
+};
+
+/** A worker test core */
+struct worker_test_core {
+	/** Worker core */
+	struct worker_core core;
+	/** Start status code */
+	int rc;
+	/** Number of jobs started */
+	unsigned int started;
+};
+
+/** Run and completion sequence counter */
+static unsigned int worker_test_sequence;
+
+/**
+ * Run worker test job
+ *
+ * @v job		Worker job
+ */
+static void worker_test_run ( struct worker_job *job ) {
+	struct worker_test_job *test =
+		container_of ( job, struct worker_test_job, job );
+
+	test->ran = ++worker_test_sequence;
+}
+
+/**
+ * Complete worker test job
+ *
+ * @v job		Worker job
+ */
+static void worker_test_done ( struct worker_job *job ) {
+	struct worker_test_job *test =
+		container_of ( job, struct worker_test_job, job );
+
+	test->done = ++worker_test_sequence;
+}
+
+/** Worker test job operations */
+static struct worker_job_operations worker_test_job_operations = {
+	.run = worker_test_run,
+	.done = worker_test_done,
+};
+
+/**
+ * Start running job on worker test core
+ *
+ * @v core		Worker core
+ * @v job		Worker job
+ * @ret rc		Return status code
+ *
+ * The test core runs each job to completion before returning.
+ */
+static int worker_test_start ( struct worker_core *core,
+			       struct worker_job *job ) {
+	struct worker_test_core *test =
+		container_of ( core, struct worker_test_core, core );
+
+	if ( test->rc != 0 )
+		return test->rc;
+	test->started++;
+	job->op->run ( job );
+	return 0;
+}
+
+/**
+ * Check for job completion on worker test core
+ *
+ * @v core		Worker core
+ * @ret done		Job has finished running
+ */
+static int worker_test_poll ( struct worker_core *core __unused ) {
+	return 1;
+}
+
+/** Worker test core operations */
+static struct worker_core_operations worker_test_core_operations = {
+	.start = worker_test_start,
+	.poll = worker_test_poll,
+};
+
+/**
+ * Initialise worker test jobs
+ *
+ * @v tests		Worker test jobs
+ * @v count		Number of worker test jobs
+ */
+static void worker_test_init ( struct worker_test_job *tests,
+			       unsigned int count ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < count ; i++ ) {
+		worker_job_init ( &tests[i].job, &worker_test_job_operations );
+		tests[i].ran = 0;
+		tests[i].done = 0;
+	}
+}
+
+/**
+ * Perform worker self-tests on the boot CPU
+ *
+ */
+static void worker_test_boot ( void ) {
+	struct worker_test_job tests[3];
+
+	/* Submit jobs and cancel one before it is run */
+	worker_test_init ( tests, 3 );
+	worker_submit ( &tests[0].job );
+	worker_submit ( &tests[1].job );
+	worker_submit ( &tests[2].job );
+	worker_cancel ( &tests[1].job );
+	ok ( ! tests[0].ran );
+
+	/* Jobs are run to completion one at a time, in order */
+	while ( ! tests[2].done )
+		step();
+	ok ( tests[0].ran && ( tests[0].done > tests[0].ran ) );
+	ok ( tests[2].ran > tests[0].done );
+	ok ( tests[2].done > tests[2].ran );
+
+	/* Cancelled job is never run or completed */
+	ok ( ! tests[1].ran );
+	ok ( ! tests[1].done );
+}
+
+/**
+ * Perform worker self-tests on registered cores
+ *
+ */
+static void worker_test_cores ( void ) {
+	struct worker_test_core cores[2];
+	struct worker_test_job tests[3];
+	unsigned int count = worker_count();
+	unsigned int i;
+
+	/* Register a working core and a failing core */
+	memset ( cores, 0, sizeof ( cores ) );
+	for ( i = 0 ; i < 2 ; i++ ) {
+		cores[i].core.name = "test";
+		cores[i].core.op = &worker_test_core_operations;
+		worker_register ( &cores[i].core );
+	}
+	cores[1].rc = -ENODEV;
+	ok ( worker_count() == ( count + 2 ) );
+
+	/* Failing core is dropped, and its job is given to another */
+	worker_test_init ( tests, 3 );
+	for ( i = 0 ; i < 3 ; i++ )
+		worker_submit ( &tests[i].job );
+	while ( ! tests[2].done )
+		step();
+	ok ( worker_count() == ( count + 1 ) );
+	ok ( cores[0].started == 3 );
+	ok ( cores[1].started == 0 );
+	for ( i = 0 ; i < 3 ; i++ ) {
+		ok ( tests[i].ran && ( tests[i].done > tests[i].ran ) );
+		if ( i )
+			ok ( tests[i].ran > tests[ i - 1 ].ran );
+	}
+
+	/* Unregister working core */
+	worker_unregister ( &cores[0].core );
+	ok ( worker_count() == count );
+}
+
+/**
+ * Perform digest worker self-tests
+ *
+ */
+static void worker_test_digest ( void ) {
+	struct digest_algorithm *digest = &sha256_algorithm;
+	struct worker_digest wdigests[2];
+	uint8_t ctx[ digest->ctxsize ];
+	uint8_t ctxs[2][ digest->ctxsize ];
+	uint8_t expected[ digest->digestsize ];
+	uint8_t actual[ digest->digestsize ];
+	uint8_t data[1027];
+	unsigned int i;
+
+	/* Construct test data */
+	for ( i = 0 ; i < sizeof ( data ) ; i++ )
+		data[i] = ( i * 7 );
+
+	/* Calculate expected digest directly */
+	digest_init ( digest, ctx );
+	digest_update ( digest, ctx, data, sizeof ( data ) );
+	digest_final ( digest, ctx, expected );
+
+	/* Calculate digest via worker, in two parts */
+	digest_init ( digest, ctx );
+	worker_digest ( digest, ctx, data, 100 );
+	worker_digest ( digest, ctx, ( data + 100 ),
+			( sizeof ( data ) - 100 ) );
+	digest_final ( digest, ctx, actual );
+	ok ( memcmp ( actual, expected, sizeof ( actual ) ) == 0 );
+
+	/* Calculate two independent digests concurrently */
+	for ( i = 0 ; i < 2 ; i++ ) {
+		digest_init ( digest, ctxs[i] );
+		worker_digest_submit ( &wdigests[i], digest, ctxs[i], data,
+				       sizeof ( data ) );
+	}
+	for ( i = 0 ; i < 2 ; i++ ) {
+		worker_digest_wait ( &wdigests[i] );
+		digest_final ( digest, ctxs[i], actual );
+		ok ( memcmp ( actual, expected, sizeof ( actual ) ) == 0 );
+	}
+}
+
+/**
+ * Perform worker self-tests
+ *
+ */
+static void worker_test_exec ( void ) {
+
+	/* Boot CPU fallback tests require no registered cores */
+	if ( worker_count() == 0 )
+		worker_test_boot();
+	worker_test_cores();
+	worker_test_digest();
+}
+
+/** Worker self-test */
+struct self_test worker_test __self_test = {
+	.name = "worker",
+	.exec = worker_test_exec,
+};
@@ -972,6 +972,48 @@ static void x509_validate_chain_fail_okx ( struct x509_test_chain *chn,
 	x509_validate_chain_fail_okx ( chn, time, store, root,		\
 				       __FILE__, __LINE__ )
 
+/**
+ * Report cached certificate validation test result
+ *
+ * @v crt		Test certificate
+ * @v time		Test certificate validation time
+ * @v root		Test root certificate list
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void x509_validate_cached_okx ( struct x509_test_certificate *crt,
+				       time_t time, struct x509_root *root,
+				       const char *file, unsigned int line ) {
+
+	/* Clear validation flag, retaining any cached results */
+	crt->cert->flags &= ~X509_FL_VALIDATED;
+	okx ( x509_validate ( crt->cert, NULL, time, root ) == 0, file, line );
+}
+#define x509_validate_cached_ok( crt, time, root ) \
+	x509_validate_cached_okx ( crt, time, root, __FILE__, __LINE__ )
+
+/**
+ * Report cached certificate validation failure test result
+ *
+ * @v crt		Test certificate
+ * @v time		Test certificate validation time
+ * @v root		Test root certificate list
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void x509_validate_cached_fail_okx ( struct x509_test_certificate *crt,
+					    time_t time,
+					    struct x509_root *root,
+					    const char *file,
+					    unsigned int line ) {
+
+	/* Clear validation flag, retaining any cached results */
+	crt->cert->flags &= ~X509_FL_VALIDATED;
+	okx ( x509_validate ( crt->cert, NULL, time, root ) != 0, file, line );
+}
+#define x509_validate_cached_fail_ok( crt, time, root ) \
+	x509_validate_cached_fail_okx ( crt, time, root, __FILE__, __LINE__ )
+
 /**
  * Perform X.509 self-tests
  *
@@ -1081,6 +1123,25 @@ static void x509_test_exec ( void ) {
 	x509_validate_chain_fail_ok ( &useless_chain, test_ca_expired,
 				      &empty_store, &test_root );
 
+	/* Check cached validation results */
+	x509_validate_chain_ok ( &server_chain, test_time,
+				 &empty_store, &test_root );
+	x509_validate_cached_ok ( &server_crt, test_time, &test_root );
+	x509_validate_cached_ok ( &leaf_crt, test_time, &test_root );
+	x509_validate_cached_fail_ok ( &server_crt, test_expired, &test_root );
+	x509_validate_cached_fail_ok ( &server_crt, test_time, &dummy_root );
+	x509_validate_chain_ok ( &useless_chain, test_time,
+				 &empty_store, &test_root );
+	x509_validate_cached_ok ( &useless_crt, test_expired, &test_root );
+	x509_validate_cached_fail_ok ( &useless_crt, test_ca_expired,
+				       &test_root );
+	test_root.generation++;
+	x509_validate_cached_fail_ok ( &useless_crt, test_time, &test_root );
+	x509_validate_chain_ok ( &server_chain, test_time,
+				 &empty_store, &test_root );
+	x509_invalidate ( server_crt.cert );
+	x509_validate_cached_fail_ok ( &server_crt, test_time, &test_root );
+
 	/* Sanity check */
 	assert ( list_empty ( &empty_store.links ) );
 
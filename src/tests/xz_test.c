@@ -0,0 +1,536 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * xz tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ipxe/umalloc.h>
+#include <ipxe/xz.h>
+#include <ipxe/test.h>
+
+/** A xz test */
+struct xz_test {
+	/** Compressed data */
+	const void *compressed;
+	/** Length of compressed data */
+	size_t compressed_len;
+	/** Expected uncompressed data */
+	const void *expected;
+	/** Length of expected uncompressed data */
+	size_t expected_len;
+};
+
+/** A xz fragment list */
+struct xz_test_fragments {
+	/** Fragment lengths */
+	size_t len[8];
+};
+
+/** Define inline data */
+#define DATA(...) { __VA_ARGS__ }
+
+/** Define a xz test */
+#define XZ( name, COMPRESSED, EXPECTED )				\
+	static const uint8_t name ## _compressed[] = COMPRESSED;	\
+	static const uint8_t name ## _expected[] = EXPECTED;		\
+	static struct xz_test name = {				\
+		.compressed = name ## _compressed,			\
+		.compressed_len = sizeof ( name ## _compressed ),	\
+		.expected = name ## _expected,				\
+		.expected_len = sizeof ( name ## _expected ),		\
+	};
+
+/* Empty stream */
+XZ ( empty,
+	DATA ( 0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00, 0x00, 0x04, 0xe6, 0xd6,
+		 0xb4, 0x46, 0x00, 0x00, 0x00, 0x00, 0x1c, 0xdf, 0x44, 0x21,
+		 0x1f, 0xb6, 0xf3, 0x7d, 0x01, 0x00, 0x00, 0x00, 0x00, 0x04,
+		 0x59, 0x5a ),
+	DATA() );
+
+/* "Hello world" (uncompressed chunk, CRC64) */
+XZ ( hello_world,
+	DATA ( 0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00, 0x00, 0x04, 0xe6, 0xd6,
+		 0xb4, 0x46, 0x02, 0x00, 0x21, 0x01, 0x16, 0x00, 0x00, 0x00,
+		 0x74, 0x2f, 0xe5, 0xa3, 0x01, 0x00, 0x0a, 0x48, 0x65, 0x6c,
+		 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c, 0x64, 0x00, 0x00,
+		 0xbf, 0x56, 0x77, 0xd4, 0xb9, 0xf2, 0xa5, 0xf4, 0x00, 0x01,
+		 0x23, 0x0b, 0xc2, 0x1b, 0xfd, 0x09, 0x1f, 0xb6, 0xf3, 0x7d,
+		 0x01, 0x00, 0x00, 0x00, 0x00, 0x04, 0x59, 0x5a ),
+	DATA ( 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c,
+		 0x64 ) );
+
+/* "Hello world" (CRC32) */
+XZ ( crc32,
+	DATA ( 0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00, 0x00, 0x01, 0x69, 0x22,
+		 0xde, 0x36, 0x02, 0x00, 0x21, 0x01, 0x16, 0x00, 0x00, 0x00,
+		 0x74, 0x2f, 0xe5, 0xa3, 0x01, 0x00, 0x0a, 0x48, 0x65, 0x6c,
+		 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c, 0x64, 0x00, 0x00,
+		 0x52, 0x9e, 0xd6, 0x8b, 0x00, 0x01, 0x1f, 0x0b, 0x3d, 0x62,
+		 0x0e, 0x7a, 0x90, 0x42, 0x99, 0x0d, 0x01, 0x00, 0x00, 0x00,
+		 0x00, 0x01, 0x59, 0x5a ),
+	DATA ( 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c,
+		 0x64 ) );
+
+/* "Hello world" (no check) */
+XZ ( none,
+	DATA ( 0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00, 0x00, 0x00, 0xff, 0x12,
+		 0xd9, 0x41, 0x02, 0x00, 0x21, 0x01, 0x16, 0x00, 0x00, 0x00,
+		 0x74, 0x2f, 0xe5, 0xa3, 0x01, 0x00, 0x0a, 0x48, 0x65, 0x6c,
+		 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c, 0x64, 0x00, 0x00,
+		 0x00, 0x01, 0x1b, 0x0b, 0x39, 0xa7, 0x62, 0x1e, 0x06, 0x72,
+		 0x9e, 0x7a, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x59, 0x5a ),
+	DATA ( 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c,
+		 0x64 ) );
+
+/* "Hello world" (SHA-256) */
+XZ ( sha256,
+	DATA ( 0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00, 0x00, 0x0a, 0xe1, 0xfb,
+		 0x0c, 0xa1, 0x02, 0x00, 0x21, 0x01, 0x16, 0x00, 0x00, 0x00,
+		 0x74, 0x2f, 0xe5, 0xa3, 0x01, 0x00, 0x0a, 0x48, 0x65, 0x6c,
+		 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c, 0x64, 0x00, 0x00,
+		 0x64, 0xec, 0x88, 0xca, 0x00, 0xb2, 0x68, 0xe5, 0xba, 0x1a,
+		 0x35, 0x67, 0x8a, 0x1b, 0x53, 0x16, 0xd2, 0x12, 0xf4, 0xf3,
+		 0x66, 0xb2, 0x47, 0x72, 0x32, 0x53, 0x4a, 0x8a, 0xec, 0xa3,
+		 0x7f, 0x3c, 0x00, 0x01, 0x3b, 0x0b, 0x9b, 0x83, 0xe6, 0x8b,
+		 0x18, 0x9b, 0x4b, 0x9a, 0x01, 0x00, 0x00, 0x00, 0x00, 0x0a,
+		 0x59, 0x5a ),
+	DATA ( 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c,
+		 0x64 ) );
+
+/* "This specification defines a lossless compressed data format" */
+XZ ( rfc_sentence,
+	DATA ( 0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00, 0x00, 0x04, 0xe6, 0xd6,
+		 0xb4, 0x46, 0x02, 0x00, 0x21, 0x01, 0x16, 0x00, 0x00, 0x00,
+		 0x74, 0x2f, 0xe5, 0xa3, 0x01, 0x00, 0x3b, 0x54, 0x68, 0x69,
+		 0x73, 0x20, 0x73, 0x70, 0x65, 0x63, 0x69, 0x66, 0x69, 0x63,
+		 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x20, 0x64, 0x65, 0x66, 0x69,
+		 0x6e, 0x65, 0x73, 0x20, 0x61, 0x20, 0x6c, 0x6f, 0x73, 0x73,
+		 0x6c, 0x65, 0x73, 0x73, 0x20, 0x63, 0x6f, 0x6d, 0x70, 0x72,
+		 0x65, 0x73, 0x73, 0x65, 0x64, 0x20, 0x64, 0x61, 0x74, 0x61,
+		 0x20, 0x66, 0x6f, 0x72, 0x6d, 0x61, 0x74, 0x00, 0x03, 0xbe,
+		 0x16, 0x39, 0xc6, 0xa4, 0xde, 0x09, 0x00, 0x01, 0x54, 0x3c,
+		 0xfc, 0x51, 0x3e, 0xd1, 0x1f, 0xb6, 0xf3, 0x7d, 0x01, 0x00,
+		 0x00, 0x00, 0x00, 0x04, 0x59, 0x5a ),
+	DATA ( 0x54, 0x68, 0x69, 0x73, 0x20, 0x73, 0x70, 0x65, 0x63, 0x69,
+		 0x66, 0x69, 0x63, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x20, 0x64,
+		 0x65, 0x66, 0x69, 0x6e, 0x65, 0x73, 0x20, 0x61, 0x20, 0x6c,
+		 0x6f, 0x73, 0x73, 0x6c, 0x65, 0x73, 0x73, 0x20, 0x63, 0x6f,
+		 0x6d, 0x70, 0x72, 0x65, 0x73, 0x73, 0x65, 0x64, 0x20, 0x64,
+		 0x61, 0x74, 0x61, 0x20, 0x66, 0x6f, 0x72, 0x6d, 0x61, 0x74 ) );
+
+/* "Hello world" and "iPXEiPXE..." as separate blocks */
+XZ ( multi_block,
+	DATA ( 0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00, 0x00, 0x04, 0xe6, 0xd6,
+		 0xb4, 0x46, 0x02, 0x00, 0x21, 0x01, 0x16, 0x00, 0x00, 0x00,
+		 0x74, 0x2f, 0xe5, 0xa3, 0x01, 0x00, 0x0a, 0x48, 0x65, 0x6c,
+		 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c, 0x64, 0x00, 0x00,
+		 0xbf, 0x56, 0x77, 0xd4, 0xb9, 0xf2, 0xa5, 0xf4, 0x02, 0x00,
+		 0x21, 0x01, 0x16, 0x00, 0x00, 0x00, 0x74, 0x2f, 0xe5, 0xa3,
+		 0xe0, 0x00, 0x1f, 0x00, 0x0a, 0x5d, 0x00, 0x34, 0x94, 0x07,
+		 0x04, 0x5f, 0xe1, 0xfd, 0x09, 0xa0, 0x00, 0x00, 0x00, 0x00,
+		 0xde, 0x7d, 0x68, 0xbd, 0xa3, 0x88, 0xc8, 0x84, 0x00, 0x02,
+		 0x23, 0x0b, 0x26, 0x20, 0x00, 0x00, 0xcb, 0x3e, 0x41, 0xb9,
+		 0xb1, 0xc4, 0x67, 0xfb, 0x02, 0x00, 0x00, 0x00, 0x00, 0x04,
+		 0x59, 0x5a ),
+	DATA ( 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c,
+		 0x64, 0x69, 0x50, 0x58, 0x45, 0x69, 0x50, 0x58, 0x45, 0x69,
+		 0x50, 0x58, 0x45, 0x69, 0x50, 0x58, 0x45, 0x69, 0x50, 0x58,
+		 0x45, 0x69, 0x50, 0x58, 0x45, 0x69, 0x50, 0x58, 0x45, 0x69,
+		 0x50, 0x58, 0x45 ) );
+
+/* "Hello world" and "iPXE" as padded separate streams */
+XZ ( multi_stream,
+	DATA ( 0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00, 0x00, 0x04, 0xe6, 0xd6,
+		 0xb4, 0x46, 0x02, 0x00, 0x21, 0x01, 0x16, 0x00, 0x00, 0x00,
+		 0x74, 0x2f, 0xe5, 0xa3, 0x01, 0x00, 0x0a, 0x48, 0x65, 0x6c,
+		 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c, 0x64, 0x00, 0x00,
+		 0xbf, 0x56, 0x77, 0xd4, 0xb9, 0xf2, 0xa5, 0xf4, 0x00, 0x01,
+		 0x23, 0x0b, 0xc2, 0x1b, 0xfd, 0x09, 0x1f, 0xb6, 0xf3, 0x7d,
+		 0x01, 0x00, 0x00, 0x00, 0x00, 0x04, 0x59, 0x5a, 0x00, 0x00,
+		 0x00, 0x00, 0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00, 0x00, 0x01,
+		 0x69, 0x22, 0xde, 0x36, 0x02, 0x00, 0x21, 0x01, 0x16, 0x00,
+		 0x00, 0x00, 0x74, 0x2f, 0xe5, 0xa3, 0x01, 0x00, 0x03, 0x69,
+		 0x50, 0x58, 0x45, 0x00, 0x66, 0x2b, 0x02, 0x7f, 0x00, 0x01,
+		 0x18, 0x04, 0x6b, 0xe9, 0xf0, 0xa5, 0x90, 0x42, 0x99, 0x0d,
+		 0x01, 0x00, 0x00, 0x00, 0x00, 0x01, 0x59, 0x5a, 0x00, 0x00,
+		 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 ),
+	DATA ( 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c,
+		 0x64, 0x69, 0x50, 0x58, 0x45 ) );
+
+/* Lorem ipsum (LZMA chunk) */
+XZ ( lorem,
+	DATA ( 0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00, 0x00, 0x04, 0xe6, 0xd6,
+		 0xb4, 0x46, 0x02, 0x00, 0x21, 0x01, 0x16, 0x00, 0x00, 0x00,
+		 0x74, 0x2f, 0xe5, 0xa3, 0xe0, 0x00, 0xe6, 0x00, 0xb6, 0x5d,
+		 0x00, 0x26, 0x1b, 0xca, 0x46, 0x67, 0x5a, 0xf2, 0x77, 0xb8,
+		 0x7d, 0x86, 0xd8, 0x41, 0xdb, 0x05, 0x35, 0xcd, 0x83, 0xa5,
+		 0x7c, 0x12, 0xa5, 0x05, 0xdb, 0x90, 0xbd, 0x2f, 0x14, 0xd3,
+		 0x71, 0x72, 0x96, 0xa8, 0x8a, 0x7d, 0x84, 0x56, 0x71, 0x8d,
+		 0x6a, 0x22, 0x98, 0xab, 0x9e, 0x3d, 0xc3, 0x55, 0xef, 0xcc,
+		 0xa5, 0xc3, 0xdd, 0x5b, 0x8e, 0xbf, 0x03, 0x81, 0x21, 0x40,
+		 0xd6, 0x26, 0x91, 0x02, 0x45, 0x4f, 0x92, 0xa1, 0x78, 0xbb,
+		 0x8a, 0x00, 0xaf, 0x90, 0x2a, 0x26, 0x92, 0x02, 0x23, 0xe5,
+		 0x5c, 0xb3, 0x2d, 0xe3, 0xe8, 0x5c, 0x2c, 0xfb, 0x32, 0x21,
+		 0xc6, 0x6f, 0x6a, 0x37, 0xb1, 0x66, 0x20, 0xcd, 0xb7, 0x52,
+		 0x7d, 0x66, 0xa4, 0x21, 0x08, 0xd1, 0x44, 0x14, 0x6c, 0x7d,
+		 0x34, 0x90, 0x6d, 0xd6, 0x47, 0xad, 0x5d, 0x5a, 0x90, 0x76,
+		 0x28, 0xc8, 0xe7, 0x8f, 0x78, 0x22, 0x47, 0x07, 0x17, 0x9e,
+		 0x9d, 0x95, 0x7f, 0x6f, 0x30, 0xa4, 0xe0, 0x3a, 0x53, 0xb7,
+		 0x14, 0xb6, 0x42, 0x9d, 0x20, 0xc2, 0xfd, 0x88, 0xb4, 0x49,
+		 0xb1, 0xb6, 0xf7, 0xdb, 0x8c, 0x7f, 0xe2, 0x9d, 0x58, 0x9f,
+		 0x66, 0x55, 0x01, 0x44, 0x9e, 0x4c, 0x21, 0x6c, 0x4d, 0x46,
+		 0x3c, 0x16, 0x9f, 0xf5, 0x53, 0xaa, 0x19, 0xe2, 0xcd, 0xf7,
+		 0xaf, 0x25, 0xfb, 0x00, 0x00, 0x00, 0x7f, 0xbf, 0x6b, 0xd1,
+		 0xcd, 0x6a, 0x28, 0x03, 0x00, 0x01, 0xd2, 0x01, 0xe7, 0x01,
+		 0x00, 0x00, 0xff, 0x53, 0xa9, 0xeb, 0xb1, 0xc4, 0x67, 0xfb,
+		 0x02, 0x00, 0x00, 0x00, 0x00, 0x04, 0x59, 0x5a ),
+	DATA ( 0x4c, 0x6f, 0x72, 0x65, 0x6d, 0x20, 0x69, 0x70, 0x73, 0x75,
+		 0x6d, 0x20, 0x64, 0x6f, 0x6c, 0x6f, 0x72, 0x20, 0x73, 0x69,
+		 0x74, 0x20, 0x61, 0x6d, 0x65, 0x74, 0x2c, 0x20, 0x63, 0x6f,
+		 0x6e, 0x73, 0x65, 0x63, 0x74, 0x65, 0x74, 0x75, 0x72, 0x20,
+		 0x61, 0x64, 0x69, 0x70, 0x69, 0x73, 0x63, 0x69, 0x6e, 0x67,
+		 0x20, 0x65, 0x6c, 0x69, 0x74, 0x2c, 0x20, 0x73, 0x65, 0x64,
+		 0x20, 0x64, 0x6f, 0x20, 0x65, 0x69, 0x75, 0x73, 0x6d, 0x6f,
+		 0x64, 0x20, 0x74, 0x65, 0x6d, 0x70, 0x6f, 0x72, 0x20, 0x69,
+		 0x6e, 0x63, 0x69, 0x64, 0x69, 0x64, 0x75, 0x6e, 0x74, 0x20,
+		 0x75, 0x74, 0x20, 0x6c, 0x61, 0x62, 0x6f, 0x72, 0x65, 0x20,
+		 0x65, 0x74, 0x20, 0x64, 0x6f, 0x6c, 0x6f, 0x72, 0x65, 0x20,
+		 0x6d, 0x61, 0x67, 0x6e, 0x61, 0x20, 0x61, 0x6c, 0x69, 0x71,
+		 0x75, 0x61, 0x2e, 0x20, 0x55, 0x74, 0x20, 0x65, 0x6e, 0x69,
+		 0x6d, 0x20, 0x61, 0x64, 0x20, 0x6d, 0x69, 0x6e, 0x69, 0x6d,
+		 0x20, 0x76, 0x65, 0x6e, 0x69, 0x61, 0x6d, 0x2c, 0x20, 0x71,
+		 0x75, 0x69, 0x73, 0x20, 0x6e, 0x6f, 0x73, 0x74, 0x72, 0x75,
+		 0x64, 0x20, 0x65, 0x78, 0x65, 0x72, 0x63, 0x69, 0x74, 0x61,
+		 0x74, 0x69, 0x6f, 0x6e, 0x20, 0x75, 0x6c, 0x6c, 0x61, 0x6d,
+		 0x63, 0x6f, 0x20, 0x6c, 0x61, 0x62, 0x6f, 0x72, 0x69, 0x73,
+		 0x20, 0x6e, 0x69, 0x73, 0x69, 0x20, 0x75, 0x74, 0x20, 0x61,
+		 0x6c, 0x69, 0x71, 0x75, 0x69, 0x70, 0x20, 0x65, 0x78, 0x20,
+		 0x65, 0x61, 0x20, 0x63, 0x6f, 0x6d, 0x6d, 0x6f, 0x64, 0x6f,
+		 0x20, 0x63, 0x6f, 0x6e, 0x73, 0x65, 0x71, 0x75, 0x61, 0x74,
+		 0x2e ) );
+
+/* Lorem ipsum variations (LZMA matches and repeated matches) */
+XZ ( variations,
+	DATA ( 0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00, 0x00, 0x04, 0xe6, 0xd6,
+		 0xb4, 0x46, 0x02, 0x00, 0x21, 0x01, 0x16, 0x00, 0x00, 0x00,
+		 0x74, 0x2f, 0xe5, 0xa3, 0xe0, 0x02, 0x41, 0x01, 0x15, 0x5d,
+		 0x00, 0x26, 0x1b, 0xca, 0x46, 0x67, 0x5a, 0xf2, 0x77, 0xb8,
+		 0x7d, 0x86, 0xd8, 0x41, 0xdb, 0x05, 0x35, 0xcd, 0x83, 0xa5,
+		 0x7c, 0x12, 0xa5, 0x05, 0xdb, 0x90, 0xbd, 0x2f, 0x14, 0xd3,
+		 0x71, 0x72, 0x96, 0xa8, 0x8a, 0x7d, 0x84, 0x56, 0x71, 0x8d,
+		 0x6a, 0x22, 0x98, 0xab, 0x9e, 0x3d, 0xc3, 0x55, 0xef, 0xcc,
+		 0xa5, 0xc3, 0xdd, 0x5b, 0x8e, 0xbf, 0x03, 0x81, 0x21, 0x40,
+		 0xd6, 0x26, 0x91, 0x02, 0x45, 0x4f, 0x92, 0xa1, 0x78, 0xbb,
+		 0x8a, 0x00, 0xaf, 0x90, 0x2a, 0x26, 0x92, 0x02, 0x23, 0xe5,
+		 0x5c, 0xb3, 0x2d, 0xe3, 0xe8, 0x5c, 0x2c, 0xfb, 0x32, 0x21,
+		 0xc6, 0x6f, 0x6a, 0x37, 0xb1, 0x66, 0x20, 0xcd, 0xb7, 0x52,
+		 0x7d, 0x66, 0xa4, 0x21, 0x08, 0xd1, 0x44, 0x14, 0x6c, 0x7d,
+		 0x34, 0x90, 0x6d, 0xd6, 0x47, 0xad, 0x5d, 0x5a, 0x90, 0x76,
+		 0x28, 0xc8, 0xe7, 0x8f, 0x78, 0x22, 0x47, 0x07, 0x17, 0x9e,
+		 0x9d, 0x95, 0x7f, 0x6f, 0x30, 0xa4, 0xe0, 0x3a, 0x53, 0xb7,
+		 0x14, 0xb6, 0x42, 0x9d, 0x20, 0xc2, 0xfd, 0x88, 0xb4, 0x49,
+		 0xb1, 0xb6, 0xf7, 0xdb, 0x8c, 0x7f, 0xe2, 0x9d, 0x58, 0x9f,
+		 0x66, 0x55, 0x01, 0x44, 0x9e, 0x4c, 0x21, 0x6c, 0x4d, 0x46,
+		 0x3c, 0x16, 0x9f, 0xf5, 0x53, 0xaa, 0x19, 0xe2, 0xcd, 0xfc,
+		 0x44, 0x10, 0x8f, 0x81, 0xb7, 0xa3, 0x17, 0x0f, 0xde, 0x57,
+		 0xda, 0xdd, 0xf7, 0xe0, 0xe6, 0x3f, 0x60, 0x82, 0x8a, 0x81,
+		 0xfe, 0xd6, 0x73, 0x55, 0xcf, 0xc2, 0x46, 0x5c, 0x1e, 0xc3,
+		 0x71, 0x2a, 0xd2, 0x11, 0xda, 0xc7, 0x10, 0x8a, 0x10, 0xeb,
+		 0x09, 0x33, 0x04, 0x8e, 0x7b, 0x80, 0xef, 0xe4, 0xfd, 0x37,
+		 0x02, 0x86, 0x37, 0x47, 0xdf, 0xe6, 0xc8, 0x46, 0xb6, 0x2f,
+		 0x6b, 0x62, 0xc6, 0xf2, 0x2d, 0x9f, 0x12, 0x21, 0xc8, 0xab,
+		 0x56, 0xd6, 0x0d, 0xd0, 0x30, 0x71, 0xb4, 0x85, 0xe3, 0x4c,
+		 0xc7, 0xea, 0x2c, 0x42, 0xb7, 0xd8, 0x92, 0x56, 0xe4, 0x58,
+		 0xdf, 0xdd, 0x8a, 0x23, 0x74, 0xba, 0x1c, 0x1f, 0x00, 0x00,
+		 0x00, 0x00, 0x4b, 0x11, 0xa4, 0x3e, 0xaf, 0xba, 0x05, 0xde,
+		 0x00, 0x01, 0xb1, 0x02, 0xc2, 0x04, 0x00, 0x00, 0x3c, 0xc9,
+		 0x4e, 0xb3, 0xb1, 0xc4, 0x67, 0xfb, 0x02, 0x00, 0x00, 0x00,
+		 0x00, 0x04, 0x59, 0x5a ),
+	DATA ( 0x4c, 0x6f, 0x72, 0x65, 0x6d, 0x20, 0x69, 0x70, 0x73, 0x75,
+		 0x6d, 0x20, 0x64, 0x6f, 0x6c, 0x6f, 0x72, 0x20, 0x73, 0x69,
+		 0x74, 0x20, 0x61, 0x6d, 0x65, 0x74, 0x2c, 0x20, 0x63, 0x6f,
+		 0x6e, 0x73, 0x65, 0x63, 0x74, 0x65, 0x74, 0x75, 0x72, 0x20,
+		 0x61, 0x64, 0x69, 0x70, 0x69, 0x73, 0x63, 0x69, 0x6e, 0x67,
+		 0x20, 0x65, 0x6c, 0x69, 0x74, 0x2c, 0x20, 0x73, 0x65, 0x64,
+		 0x20, 0x64, 0x6f, 0x20, 0x65, 0x69, 0x75, 0x73, 0x6d, 0x6f,
+		 0x64, 0x20, 0x74, 0x65, 0x6d, 0x70, 0x6f, 0x72, 0x20, 0x69,
+		 0x6e, 0x63, 0x69, 0x64, 0x69, 0x64, 0x75, 0x6e, 0x74, 0x20,
+		 0x75, 0x74, 0x20, 0x6c, 0x61, 0x62, 0x6f, 0x72, 0x65, 0x20,
+		 0x65, 0x74, 0x20, 0x64, 0x6f, 0x6c, 0x6f, 0x72, 0x65, 0x20,
+		 0x6d, 0x61, 0x67, 0x6e, 0x61, 0x20, 0x61, 0x6c, 0x69, 0x71,
+		 0x75, 0x61, 0x2e, 0x20, 0x55, 0x74, 0x20, 0x65, 0x6e, 0x69,
+		 0x6d, 0x20, 0x61, 0x64, 0x20, 0x6d, 0x69, 0x6e, 0x69, 0x6d,
+		 0x20, 0x76, 0x65, 0x6e, 0x69, 0x61, 0x6d, 0x2c, 0x20, 0x71,
+		 0x75, 0x69, 0x73, 0x20, 0x6e, 0x6f, 0x73, 0x74, 0x72, 0x75,
+		 0x64, 0x20, 0x65, 0x78, 0x65, 0x72, 0x63, 0x69, 0x74, 0x61,
+		 0x74, 0x69, 0x6f, 0x6e, 0x20, 0x75, 0x6c, 0x6c, 0x61, 0x6d,
+		 0x63, 0x6f, 0x20, 0x6c, 0x61, 0x62, 0x6f, 0x72, 0x69, 0x73,
+		 0x20, 0x6e, 0x69, 0x73, 0x69, 0x20, 0x75, 0x74, 0x20, 0x61,
+		 0x6c, 0x69, 0x71, 0x75, 0x69, 0x70, 0x20, 0x65, 0x78, 0x20,
+		 0x65, 0x61, 0x20, 0x63, 0x6f, 0x6d, 0x6d, 0x6f, 0x64, 0x6f,
+		 0x20, 0x63, 0x6f, 0x6e, 0x73, 0x65, 0x71, 0x75, 0x61, 0x74,
+		 0x2e, 0x4c, 0x6f, 0x72, 0x65, 0x6d, 0x20, 0x69, 0x70, 0x73,
+		 0x75, 0x6d, 0x20, 0x44, 0x4f, 0x4c, 0x4f, 0x52, 0x20, 0x73,
+		 0x69, 0x74, 0x20, 0x61, 0x6d, 0x65, 0x74, 0x2c, 0x20, 0x63,
+		 0x6f, 0x6e, 0x73, 0x65, 0x63, 0x74, 0x65, 0x74, 0x75, 0x72,
+		 0x20, 0x61, 0x64, 0x69, 0x70, 0x69, 0x73, 0x63, 0x69, 0x6e,
+		 0x67, 0x20, 0x65, 0x6c, 0x69, 0x74, 0x2c, 0x20, 0x73, 0x65,
+		 0x64, 0x20, 0x64, 0x6f, 0x20, 0x65, 0x69, 0x75, 0x73, 0x6d,
+		 0x6f, 0x64, 0x20, 0x74, 0x65, 0x6d, 0x70, 0x6f, 0x72, 0x20,
+		 0x69, 0x6e, 0x63, 0x69, 0x64, 0x69, 0x64, 0x75, 0x6e, 0x74,
+		 0x20, 0x75, 0x74, 0x20, 0x6c, 0x61, 0x62, 0x6f, 0x72, 0x65,
+		 0x20, 0x65, 0x74, 0x20, 0x44, 0x4f, 0x4c, 0x4f, 0x52, 0x65,
+		 0x20, 0x6d, 0x61, 0x67, 0x6e, 0x61, 0x20, 0x61, 0x6c, 0x69,
+		 0x71, 0x75, 0x61, 0x2e, 0x20, 0x55, 0x74, 0x20, 0x65, 0x6e,
+		 0x69, 0x6d, 0x20, 0x61, 0x64, 0x20, 0x6d, 0x69, 0x6e, 0x69,
+		 0x6d, 0x20, 0x76, 0x65, 0x6e, 0x69, 0x61, 0x6d, 0x2c, 0x20,
+		 0x71, 0x75, 0x69, 0x73, 0x20, 0x6e, 0x6f, 0x73, 0x74, 0x72,
+		 0x75, 0x64, 0x20, 0x65, 0x78, 0x65, 0x72, 0x63, 0x69, 0x74,
+		 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x20, 0x75, 0x6c, 0x6c, 0x61,
+		 0x6d, 0x63, 0x6f, 0x20, 0x6c, 0x61, 0x62, 0x6f, 0x72, 0x69,
+		 0x73, 0x20, 0x6e, 0x69, 0x73, 0x69, 0x20, 0x75, 0x74, 0x20,
+		 0x61, 0x6c, 0x69, 0x71, 0x75, 0x69, 0x70, 0x20, 0x65, 0x78,
+		 0x20, 0x65, 0x61, 0x20, 0x63, 0x6f, 0x6d, 0x6d, 0x6f, 0x64,
+		 0x6f, 0x20, 0x63, 0x6f, 0x6e, 0x73, 0x65, 0x71, 0x75, 0x61,
+		 0x74, 0x2e, 0x4c, 0x72, 0x6d, 0x69, 0x73, 0x6d, 0x64, 0x6c,
+		 0x72, 0x73, 0x74, 0x61, 0x65, 0x2c, 0x63, 0x6e, 0x65, 0x74,
+		 0x74, 0x72, 0x61, 0x69, 0x69, 0x63, 0x6e, 0x20, 0x6c, 0x74,
+		 0x20, 0x65, 0x20, 0x6f, 0x65, 0x75, 0x6d, 0x64, 0x74, 0x6d,
+		 0x6f, 0x20, 0x6e, 0x69, 0x69, 0x75, 0x74, 0x75, 0x20, 0x61,
+		 0x6f, 0x65, 0x65, 0x20, 0x6f, 0x6f, 0x65, 0x6d, 0x67, 0x61,
+		 0x61, 0x69, 0x75, 0x2e, 0x55, 0x20, 0x6e, 0x6d, 0x61, 0x20,
+		 0x69, 0x69, 0x20, 0x65, 0x69, 0x6d, 0x20, 0x75, 0x73, 0x6e,
+		 0x73, 0x72, 0x64, 0x65, 0x65, 0x63, 0x74, 0x74, 0x6f, 0x20,
+		 0x6c, 0x61, 0x63, 0x20, 0x61, 0x6f, 0x69, 0x20, 0x69, 0x69,
+		 0x75, 0x20, 0x6c, 0x71, 0x69, 0x20, 0x78, 0x65, 0x20, 0x6f,
+		 0x6d, 0x64, 0x20, 0x6f, 0x73, 0x71, 0x61, 0x2e ) );
+
+/* "Hello world" with corrupted check */
+XZ ( bad_check,
+	DATA ( 0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00, 0x00, 0x04, 0xe6, 0xd6,
+		 0xb4, 0x46, 0x02, 0x00, 0x21, 0x01, 0x16, 0x00, 0x00, 0x00,
+		 0x74, 0x2f, 0xe5, 0xa3, 0x01, 0x00, 0x0a, 0x48, 0x65, 0x6c,
+		 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c, 0x64, 0x00, 0x00,
+		 0xbf, 0x56, 0x77, 0xd5, 0xb9, 0xf2, 0xa5, 0xf4, 0x00, 0x01,
+		 0x23, 0x0b, 0xc2, 0x1b, 0xfd, 0x09, 0x1f, 0xb6, 0xf3, 0x7d,
+		 0x01, 0x00, 0x00, 0x00, 0x00, 0x04, 0x59, 0x5a ),
+	DATA ( 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c,
+		 0x64 ) );
+
+/* "Hello world" with unsupported x86 filter */
+XZ ( bcj,
+	DATA ( 0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00, 0x00, 0x04, 0xe6, 0xd6,
+		 0xb4, 0x46, 0x02, 0x01, 0x04, 0x00, 0x21, 0x01, 0x16, 0x00,
+		 0x0d, 0x86, 0x35, 0x1f, 0x01, 0x00, 0x0a, 0x48, 0x65, 0x6c,
+		 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c, 0x64, 0x00, 0x00,
+		 0xbf, 0x56, 0x77, 0xd4, 0xb9, 0xf2, 0xa5, 0xf4, 0x00, 0x01,
+		 0x23, 0x0b, 0xc2, 0x1b, 0xfd, 0x09, 0x1f, 0xb6, 0xf3, 0x7d,
+		 0x01, 0x00, 0x00, 0x00, 0x00, 0x04, 0x59, 0x5a ),
+	DATA ( 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c,
+		 0x64 ) );
+
+/* Lorem ipsum fragment list */
+static struct xz_test_fragments lorem_fragments[] = {
+	{ { 0, 1, 5, -1UL, } },
+	{ { 0, 0, 1, 0, 0, 1, -1UL } },
+	{ { 10, 8, 4, 7, 11, -1UL } },
+	{ { 1, 1, 1, 1, 1, 1, 1, -1UL } },
+	{ { 100, -1UL } },
+};
+
+/**
+ * Report xz test result
+ *
+ * @v xz		Decompressor
+ * @v test		xz test
+ * @v frags		Fragment list, or NULL
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void xz_okx ( struct xz *xz, struct xz_test *test,
+		       struct xz_test_fragments *frags,
+		       const char *file, unsigned int line ) {
+	struct deflate_chunk in;
+	struct deflate_chunk out;
+	userptr_t data;
+	size_t frag_len = -1UL;
+	size_t offset = 0;
+	size_t remaining = test->compressed_len;
+	unsigned int i;
+
+	/* Allocate output buffer */
+	data = umalloc ( test->expected_len + DECOMPRESS_SPACE );
+	okx ( data != UNULL, file, line );
+	if ( ! data )
+		return;
+
+	/* Initialise decompressor */
+	if ( xz_init ( xz ) != 0 ) {
+		okx ( 0, file, line );
+		ufree ( data );
+		return;
+	}
+
+	/* Initialise output chunk */
+	deflate_chunk_init ( &out, data, 0,
+			     ( test->expected_len + DECOMPRESS_SPACE ) );
+
+	/* Process input (in fragments, if applicable) */
+	for ( i = 0 ; i < ( sizeof ( frags->len ) /
+			    sizeof ( frags->len[0] ) ) ; i++ ) {
+
+		/* Initialise input chunk */
+		if ( frags )
+			frag_len = frags->len[i];
+		if ( frag_len > remaining )
+			frag_len = remaining;
+		deflate_chunk_init ( &in, virt_to_user ( test->compressed ),
+				     offset, ( offset + frag_len ) );
+
+		/* Decompress this fragment */
+		okx ( xz_inflate ( xz, &in, &out ) == 0, file, line );
+		okx ( in.len == ( offset + frag_len ), file, line );
+		okx ( in.offset == in.len, file, line );
+
+		/* Move to next fragment */
+		offset = in.offset;
+		remaining -= frag_len;
+		if ( ! remaining )
+			break;
+
+		/* Check that decompression has not terminated early */
+		okx ( ! xz_finished ( xz ), file, line );
+	}
+
+	/* Check decompression has terminated as expected */
+	okx ( xz_finished ( xz ), file, line );
+	okx ( offset == test->compressed_len, file, line );
+	okx ( out.offset == test->expected_len, file, line );
+	okx ( memcmp ( user_to_virt ( data, 0 ), test->expected,
+		       test->expected_len ) == 0, file, line );
+
+	xz_fini ( xz );
+	ufree ( data );
+}
+#define xz_ok( xz, test, frags ) \
+	xz_okx ( xz, test, frags, __FILE__, __LINE__ )
+
+/**
+ * Report xz failure test result
+ *
+ * @v xz		Decompressor
+ * @v test		xz test
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void xz_fail_okx ( struct xz *xz, struct xz_test *test,
+			    const char *file, unsigned int line ) {
+	struct deflate_chunk in;
+	struct deflate_chunk out;
+	userptr_t data;
+
+	/* Allocate output buffer */
+	data = umalloc ( test->expected_len + DECOMPRESS_SPACE );
+	okx ( data != UNULL, file, line );
+	if ( ! data )
+		return;
+
+	/* Initialise decompressor */
+	if ( xz_init ( xz ) != 0 ) {
+		okx ( 0, file, line );
+		ufree ( data );
+		return;
+	}
+
+	/* Check that decompression fails */
+	deflate_chunk_init ( &in, virt_to_user ( test->compressed ), 0,
+			     test->compressed_len );
+	deflate_chunk_init ( &out, data, 0,
+			     ( test->expected_len + DECOMPRESS_SPACE ) );
+	okx ( xz_inflate ( xz, &in, &out ) != 0, file, line );
+
+	xz_fini ( xz );
+	ufree ( data );
+}
+#define xz_fail_ok( xz, test ) \
+	xz_fail_okx ( xz, test, __FILE__, __LINE__ )
+
+/**
+ * Perform xz self-test
+ *
+ */
+static void xz_test_exec ( void ) {
+	struct xz *xz;
+	unsigned int i;
+
+	/* Allocate shared structure */
+	xz = malloc ( sizeof ( *xz ) );
+	ok ( xz != NULL );
+
+	/* Perform self-tests */
+	if ( xz ) {
+
+		/* Test as a single pass */
+		xz_ok ( xz, &empty, NULL );
+		xz_ok ( xz, &hello_world, NULL );
+		xz_ok ( xz, &crc32, NULL );
+		xz_ok ( xz, &none, NULL );
+		xz_ok ( xz, &sha256, NULL );
+		xz_ok ( xz, &rfc_sentence, NULL );
+		xz_ok ( xz, &multi_block, NULL );
+		xz_ok ( xz, &multi_stream, NULL );
+		xz_ok ( xz, &lorem, NULL );
+		xz_ok ( xz, &variations, NULL );
+
+		/* Test fragmentation */
+		for ( i = 0 ; i < ( sizeof ( lorem_fragments ) /
+				    sizeof ( lorem_fragments[0] ) ) ; i++ ) {
+			xz_ok ( xz, &lorem, &lorem_fragments[i] );
+		}
+
+		/* Test failure cases */
+		xz_fail_ok ( xz, &bad_check );
+		xz_fail_ok ( xz, &bcj );
+	}
+
+	/* Free shared structure */
+	free ( xz );
+}
+
+/** xz self-test */
+struct self_test xz_test __self_test = {
+	.name = "xz",
+	.exec = xz_test_exec,
+};
@@ -0,0 +1,376 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+/** @file
+ *
+ * Zstandard tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ipxe/umalloc.h>
+#include <ipxe/zstd.h>
+#include <ipxe/test.h>
+
+/** A Zstandard test */
+struct zstd_test {
+	/** Compressed data */
+	const void *compressed;
+	/** Length of compressed data */
+	size_t compressed_len;
+	/** Expected uncompressed data */
+	const void *expected;
+	/** Length of expected uncompressed data */
+	size_t expected_len;
+};
+
+/** A Zstandard fragment list */
+struct zstd_test_fragments {
+	/** Fragment lengths */
+	size_t len[8];
+};
+
+/** Define inline data */
+#define DATA(...) { __VA_ARGS__ }
+
+/** Define a Zstandard test */
+#define ZSTD( name, COMPRESSED, EXPECTED )				\
+	static const uint8_t name ## _compressed[] = COMPRESSED;	\
+	static const uint8_t name ## _expected[] = EXPECTED;		\
+	static struct zstd_test name = {				\
+		.compressed = name ## _compressed,			\
+		.compressed_len = sizeof ( name ## _compressed ),	\
+		.expected = name ## _expected,				\
+		.expected_len = sizeof ( name ## _expected ),		\
+	};
+
+/* Empty frame */
+ZSTD ( empty,
+	  DATA ( 0x28, 0xb5, 0x2f, 0xfd, 0x24, 0x00, 0x01, 0x00, 0x00, 0x99,
+		 0xe9, 0xd8, 0x51 ),
+	  DATA() );
+
+/* "Hello world" (raw block) */
+ZSTD ( hello_world,
+	  DATA ( 0x28, 0xb5, 0x2f, 0xfd, 0x24, 0x0b, 0x59, 0x00, 0x00, 0x48,
+		 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c, 0x64,
+		 0xd8, 0x76, 0xb3, 0x12 ),
+	  DATA ( 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c,
+		 0x64 ) );
+
+/* "This specification defines a lossless compressed data format" (Huffman
+ * literals, no sequences) */
+ZSTD ( rfc_sentence,
+	  DATA ( 0x28, 0xb5, 0x2f, 0xfd, 0x24, 0x3c, 0x95, 0x01, 0x00, 0xc2,
+		 0x83, 0x0b, 0x0f, 0xc0, 0xb7, 0x01, 0x14, 0xb4, 0x64, 0x9b,
+		 0x84, 0x64, 0xf9, 0xa3, 0x2a, 0x43, 0xc0, 0x27, 0x87, 0x86,
+		 0xc9, 0x2b, 0x1d, 0xb2, 0x9a, 0x7f, 0x9b, 0x32, 0xb2, 0xfa,
+		 0x5b, 0xfc, 0x29, 0x4a, 0xbd, 0x09, 0x9e, 0xad, 0x24, 0xf1,
+		 0x50, 0xe1, 0x61, 0xb9, 0xbc, 0xc7, 0x00, 0x02, 0x00, 0x65,
+		 0x45, 0x27, 0xe5 ),
+	  DATA ( 0x54, 0x68, 0x69, 0x73, 0x20, 0x73, 0x70, 0x65, 0x63, 0x69,
+		 0x66, 0x69, 0x63, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x20, 0x64,
+		 0x65, 0x66, 0x69, 0x6e, 0x65, 0x73, 0x20, 0x61, 0x20, 0x6c,
+		 0x6f, 0x73, 0x73, 0x6c, 0x65, 0x73, 0x73, 0x20, 0x63, 0x6f,
+		 0x6d, 0x70, 0x72, 0x65, 0x73, 0x73, 0x65, 0x64, 0x20, 0x64,
+		 0x61, 0x74, 0x61, 0x20, 0x66, 0x6f, 0x72, 0x6d, 0x61, 0x74 ) );
+
+/* Repeated characters (RLE literals) */
+ZSTD ( repeat,
+	  DATA ( 0x28, 0xb5, 0x2f, 0xfd, 0x24, 0x20, 0x45, 0x00, 0x00, 0x10,
+		 0x79, 0x79, 0x01, 0x00, 0x22, 0xc0, 0x02, 0x66, 0xce, 0x95,
+		 0x34 ),
+	  DATA ( 0x79, 0x79, 0x79, 0x79, 0x79, 0x79, 0x79, 0x79, 0x79, 0x79,
+		 0x79, 0x79, 0x79, 0x79, 0x79, 0x79, 0x79, 0x79, 0x79, 0x79,
+		 0x79, 0x79, 0x79, 0x79, 0x79, 0x79, 0x79, 0x79, 0x79, 0x79,
+		 0x79, 0x79 ) );
+
+/* Runs of characters (RLE sequence codes) */
+ZSTD ( runs,
+	  DATA ( 0x28, 0xb5, 0x2f, 0xfd, 0x24, 0xb4, 0x5d, 0x00, 0x00, 0x18,
+		 0x61, 0x62, 0x61, 0x03, 0x54, 0x01, 0x00, 0x27, 0x00, 0x02,
+		 0xd1, 0x81, 0x3a, 0xf4 ),
+	  DATA ( 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61,
+		 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61,
+		 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61,
+		 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61,
+		 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61,
+		 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61,
+		 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62,
+		 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62,
+		 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62,
+		 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62,
+		 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62,
+		 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62, 0x62,
+		 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61,
+		 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61,
+		 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61,
+		 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61,
+		 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61,
+		 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61, 0x61 ) );
+
+/* "iiiiiPXE" (RLE block and raw block) */
+ZSTD ( rle_block,
+	  DATA ( 0x28, 0xb5, 0x2f, 0xfd, 0x24, 0x08, 0x2a, 0x00, 0x00, 0x69,
+		 0x19, 0x00, 0x00, 0x50, 0x58, 0x45, 0x0a, 0x3f, 0xc5, 0x15 ),
+	  DATA ( 0x69, 0x69, 0x69, 0x69, 0x69, 0x50, 0x58, 0x45 ) );
+
+/* "Hello world", skippable frame, and "iPXE" */
+ZSTD ( multi,
+	  DATA ( 0x28, 0xb5, 0x2f, 0xfd, 0x04, 0x00, 0x59, 0x00, 0x00, 0x48,
+		 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c, 0x64,
+		 0xd8, 0x76, 0xb3, 0x12, 0x5e, 0x2a, 0x4d, 0x18, 0x04, 0x00,
+		 0x00, 0x00, 0x6a, 0x75, 0x6e, 0x6b, 0x28, 0xb5, 0x2f, 0xfd,
+		 0x24, 0x04, 0x21, 0x00, 0x00, 0x69, 0x50, 0x58, 0x45, 0xa0,
+		 0x80, 0xfe, 0x6b ),
+	  DATA ( 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c,
+		 0x64, 0x69, 0x50, 0x58, 0x45 ) );
+
+/* Lorem ipsum (Huffman literals and FSE sequences) */
+ZSTD ( lorem,
+	  DATA ( 0x28, 0xb5, 0x2f, 0xfd, 0x24, 0xe7, 0x95, 0x04, 0x00, 0x52,
+		 0x4d, 0x21, 0x17, 0xa0, 0x25, 0x69, 0x03, 0xf0, 0xb2, 0x37,
+		 0xe9, 0x16, 0xb9, 0x24, 0x56, 0x5b, 0x52, 0x22, 0x39, 0x01,
+		 0xc4, 0x26, 0x03, 0x55, 0x5f, 0x03, 0x83, 0xce, 0x16, 0x95,
+		 0x87, 0xc3, 0x48, 0x68, 0x86, 0xc3, 0x53, 0x1e, 0x94, 0x89,
+		 0xeb, 0xfa, 0xf9, 0x73, 0x1e, 0x87, 0x0d, 0x21, 0xeb, 0xc3,
+		 0xeb, 0xe8, 0x47, 0xa9, 0x41, 0x99, 0xb6, 0x68, 0xe2, 0x39,
+		 0xbf, 0x85, 0x05, 0x9b, 0x5f, 0x0d, 0xd8, 0x7e, 0x37, 0xd3,
+		 0xd8, 0x7e, 0x65, 0x0d, 0xf0, 0x30, 0x5b, 0x9c, 0x8c, 0xe7,
+		 0x04, 0x63, 0x2e, 0x2d, 0x57, 0x41, 0x81, 0x21, 0xd6, 0xb5,
+		 0xde, 0xd2, 0xe9, 0xe3, 0xee, 0x82, 0x84, 0x95, 0x9a, 0xd0,
+		 0x72, 0x5f, 0x46, 0x32, 0x55, 0x5a, 0xd0, 0x93, 0xb2, 0xe0,
+		 0x3e, 0xf2, 0xc4, 0x69, 0x5c, 0x56, 0x4b, 0x47, 0xe5, 0xe1,
+		 0xb0, 0xa0, 0x65, 0x63, 0x7d, 0xba, 0x20, 0x41, 0xb2, 0x6d,
+		 0x12, 0xb7, 0x55, 0x41, 0x80, 0x03, 0x14, 0x06, 0x03, 0x16,
+		 0x2a, 0x9d, 0x31, 0xbd, 0x28, 0x1e, 0x57, 0x83, 0x4b ),
+	  DATA ( 0x4c, 0x6f, 0x72, 0x65, 0x6d, 0x20, 0x69, 0x70, 0x73, 0x75,
+		 0x6d, 0x20, 0x64, 0x6f, 0x6c, 0x6f, 0x72, 0x20, 0x73, 0x69,
+		 0x74, 0x20, 0x61, 0x6d, 0x65, 0x74, 0x2c, 0x20, 0x63, 0x6f,
+		 0x6e, 0x73, 0x65, 0x63, 0x74, 0x65, 0x74, 0x75, 0x72, 0x20,
+		 0x61, 0x64, 0x69, 0x70, 0x69, 0x73, 0x63, 0x69, 0x6e, 0x67,
+		 0x20, 0x65, 0x6c, 0x69, 0x74, 0x2c, 0x20, 0x73, 0x65, 0x64,
+		 0x20, 0x64, 0x6f, 0x20, 0x65, 0x69, 0x75, 0x73, 0x6d, 0x6f,
+		 0x64, 0x20, 0x74, 0x65, 0x6d, 0x70, 0x6f, 0x72, 0x20, 0x69,
+		 0x6e, 0x63, 0x69, 0x64, 0x69, 0x64, 0x75, 0x6e, 0x74, 0x20,
+		 0x75, 0x74, 0x20, 0x6c, 0x61, 0x62, 0x6f, 0x72, 0x65, 0x20,
+		 0x65, 0x74, 0x20, 0x64, 0x6f, 0x6c, 0x6f, 0x72, 0x65, 0x20,
+		 0x6d, 0x61, 0x67, 0x6e, 0x61, 0x20, 0x61, 0x6c, 0x69, 0x71,
+		 0x75, 0x61, 0x2e, 0x20, 0x55, 0x74, 0x20, 0x65, 0x6e, 0x69,
+		 0x6d, 0x20, 0x61, 0x64, 0x20, 0x6d, 0x69, 0x6e, 0x69, 0x6d,
+		 0x20, 0x76, 0x65, 0x6e, 0x69, 0x61, 0x6d, 0x2c, 0x20, 0x71,
+		 0x75, 0x69, 0x73, 0x20, 0x6e, 0x6f, 0x73, 0x74, 0x72, 0x75,
+		 0x64, 0x20, 0x65, 0x78, 0x65, 0x72, 0x63, 0x69, 0x74, 0x61,
+		 0x74, 0x69, 0x6f, 0x6e, 0x20, 0x75, 0x6c, 0x6c, 0x61, 0x6d,
+		 0x63, 0x6f, 0x20, 0x6c, 0x61, 0x62, 0x6f, 0x72, 0x69, 0x73,
+		 0x20, 0x6e, 0x69, 0x73, 0x69, 0x20, 0x75, 0x74, 0x20, 0x61,
+		 0x6c, 0x69, 0x71, 0x75, 0x69, 0x70, 0x20, 0x65, 0x78, 0x20,
+		 0x65, 0x61, 0x20, 0x63, 0x6f, 0x6d, 0x6d, 0x6f, 0x64, 0x6f,
+		 0x20, 0x63, 0x6f, 0x6e, 0x73, 0x65, 0x71, 0x75, 0x61, 0x74,
+		 0x2e ) );
+
+/* "Hello world" with corrupted checksum */
+ZSTD ( bad_checksum,
+	  DATA ( 0x28, 0xb5, 0x2f, 0xfd, 0x24, 0x0b, 0x59, 0x00, 0x00, 0x48,
+		 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c, 0x64,
+		 0xd8, 0x76, 0xb3, 0x13 ),
+	  DATA ( 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c,
+		 0x64 ) );
+
+/* Lorem ipsum fragment list */
+static struct zstd_test_fragments lorem_fragments[] = {
+	{ { 0, 1, 5, -1UL, } },
+	{ { 0, 0, 1, 0, 0, 1, -1UL } },
+	{ { 10, 8, 4, 7, 11, -1UL } },
+	{ { 1, 1, 1, 1, 1, 1, 1, -1UL } },
+	{ { 100, -1UL } },
+};
+
+/**
+ * Report Zstandard test result
+ *
+ * @v zstd		Decompressor
+ * @v test		Zstandard test
+ * @v frags		Fragment list, or NULL
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void zstd_okx ( struct zstd *zstd, struct zstd_test *test,
+		       struct zstd_test_fragments *frags,
+		       const char *file, unsigned int line ) {
+	struct deflate_chunk in;
+	struct deflate_chunk out;
+	userptr_t data;
+	size_t frag_len = -1UL;
+	size_t offset = 0;
+	size_t remaining = test->compressed_len;
+	unsigned int i;
+
+	/* Allocate output buffer */
+	data = umalloc ( test->expected_len + DECOMPRESS_SPACE );
+	okx ( data != UNULL, file, line );
+	if ( ! data )
+		return;
+
+	/* Initialise decompressor */
+	if ( zstd_init ( zstd ) != 0 ) {
+		okx ( 0, file, line );
+		ufree ( data );
+		return;
+	}
+
+	/* Initialise output chunk */
+	deflate_chunk_init ( &out, data, 0,
+			     ( test->expected_len + DECOMPRESS_SPACE ) );
+
+	/* Process input (in fragments, if applicable) */
+	for ( i = 0 ; i < ( sizeof ( frags->len ) /
+			    sizeof ( frags->len[0] ) ) ; i++ ) {
+
+		/* Initialise input chunk */
+		if ( frags )
+			frag_len = frags->len[i];
+		if ( frag_len > remaining )
+			frag_len = remaining;
+		deflate_chunk_init ( &in, virt_to_user ( test->compressed ),
+				     offset, ( offset + frag_len ) );
+
+		/* Decompress this fragment */
+		okx ( zstd_inflate ( zstd, &in, &out ) == 0, file, line );
+		okx ( in.len == ( offset + frag_len ), file, line );
+		okx ( in.offset == in.len, file, line );
+
+		/* Move to next fragment */
+		offset = in.offset;
+		remaining -= frag_len;
+		if ( ! remaining )
+			break;
+
+		/* Check that decompression has not terminated early */
+		okx ( ! zstd_finished ( zstd ), file, line );
+	}
+
+	/* Check decompression has terminated as expected */
+	okx ( zstd_finished ( zstd ), file, line );
+	okx ( offset == test->compressed_len, file, line );
+	okx ( out.offset == test->expected_len, file, line );
+	okx ( memcmp ( user_to_virt ( data, 0 ), test->expected,
+		       test->expected_len ) == 0, file, line );
+
+	zstd_fini ( zstd );
+	ufree ( data );
+}
+#define zstd_ok( zstd, test, frags ) \
+	zstd_okx ( zstd, test, frags, __FILE__, __LINE__ )
+
+/**
+ * Report Zstandard failure test result
+ *
+ * @v zstd		Decompressor
+ * @v test		Zstandard test
+ * @v file		Test code file
+ * @v line		Test code line
+ */
+static void zstd_fail_okx ( struct zstd *zstd, struct zstd_test *test,
+			    const char *file, unsigned int line ) {
+	struct deflate_chunk in;
+	struct deflate_chunk out;
+	userptr_t data;
+
+	/* Allocate output buffer */
+	data = umalloc ( test->expected_len + DECOMPRESS_SPACE );
+	okx ( data != UNULL, file, line );
+	if ( ! data )
+		return;
+
+	/* Initialise decompressor */
+	if ( zstd_init ( zstd ) != 0 ) {
+		okx ( 0, file, line );
+		ufree ( data );
+		return;
+	}
+
+	/* Check that decompression fails */
+	deflate_chunk_init ( &in, virt_to_user ( test->compressed ), 0,
+			     test->compressed_len );
+	deflate_chunk_init ( &out, data, 0,
+			     ( test->expected_len + DECOMPRESS_SPACE ) );
+	okx ( zstd_inflate ( zstd, &in, &out ) != 0, file, line );
+
+	zstd_fini ( zstd );
+	ufree ( data );
+}
+#define zstd_fail_ok( zstd, test ) \
+	zstd_fail_okx ( zstd, test, __FILE__, __LINE__ )
+
+/**
+ * Perform Zstandard self-test
+ *
+ */
+static void zstd_test_exec ( void ) {
+	struct zstd *zstd;
+	unsigned int i;
+
+	/* Allocate shared structure */
+	zstd = malloc ( sizeof ( *zstd ) );
+	ok ( zstd != NULL );
+
+	/* Perform self-tests */
+	if ( zstd ) {
+
+		/* Test as a single pass */
+		zstd_ok ( zstd, &empty, NULL );
+		zstd_ok ( zstd, &hello_world, NULL );
+		zstd_ok ( zstd, &rfc_sentence, NULL );
+		zstd_ok ( zstd, &repeat, NULL );
+		zstd_ok ( zstd, &runs, NULL );
+		zstd_ok ( zstd, &rle_block, NULL );
+		zstd_ok ( zstd, &multi, NULL );
+		zstd_ok ( zstd, &lorem, NULL );
+
+		/* Test fragmentation */
+		for ( i = 0 ; i < ( sizeof ( lorem_fragments ) /
+				    sizeof ( lorem_fragments[0] ) ) ; i++ ) {
+			zstd_ok ( zstd, &lorem, &lorem_fragments[i] );
+		}
+
+		/* Test failure cases */
+		zstd_fail_ok ( zstd, &bad_checksum );
+	}
+
+	/* Free shared structure */
+	free ( zstd );
+}
+
+/** Zstandard self-test */
+struct self_test zstd_test __self_test = {
+	.name = "zstd",
+	.exec = zstd_test_exec,
+};
@@ -40,6 +40,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 #include <ipxe/features.h>
 #include <ipxe/image.h>
 #include <ipxe/timer.h>
+#include <ipxe/device.h>
 #include <usr/ifmgmt.h>
 #include <usr/route.h>
 #include <usr/imgmgmt.h>
@@ -68,6 +69,13 @@ static int ( * is_autoboot_device ) ( struct net_device *netdev );
 #define EINFO_ENOENT_BOOT \
 	__einfo_uniqify ( EINFO_ENOENT, 0x01, "Nothing to boot" )
 
+/* Concurrent configuration of all network devices */
+#ifdef AUTOBOOT_PARALLEL
+#define AUTOBOOT_PARALLEL_ENABLED 1
+#else
+#define AUTOBOOT_PARALLEL_ENABLED 0
+#endif
+
 #define NORMAL	"\033[0m"
 #define BOLD	"\033[1m"
 #define CYAN	"\033[36m"
@@ -376,28 +384,18 @@ static int have_pxe_menu ( void ) {
 }
 
 /**
- * Boot from a network device
+ * Boot from a configured network device
  *
  * @v netdev		Network device
  * @ret rc		Return status code
  */
-int netboot ( struct net_device *netdev ) {
+static int netboot_configured ( struct net_device *netdev ) {
 	struct uri *filename;
 	struct uri *root_path;
 	char *san_filename;
 	int rc;
 
-	/* Close all other network devices */
-	close_all_netdevs();
-
-	/* Open device and display device status */
-	if ( ( rc = ifopen ( netdev ) ) != 0 )
-		goto err_ifopen;
-	ifstat ( netdev );
-
-	/* Configure device */
-	if ( ( rc = ifconf ( netdev, NULL ) ) != 0 )
-		goto err_dhcp;
+	/* Display routing table */
 	route();
 
 	/* Try PXE menu boot, if applicable */
@@ -447,11 +445,63 @@ int netboot ( struct net_device *netdev ) {
 	uri_put ( root_path );
 	uri_put ( filename );
  err_pxe_menu_boot:
- err_dhcp:
- err_ifopen:
 	return rc;
 }
 
+/**
+ * Boot from a network device
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ */
+int netboot ( struct net_device *netdev ) {
+	int rc;
+
+	/* Close all other network devices */
+	close_all_netdevs();
+
+	/* Open device and display device status */
+	if ( ( rc = ifopen ( netdev ) ) != 0 )
+		return rc;
+	ifstat ( netdev );
+
+	/* Configure device */
+	if ( ( rc = ifconf ( netdev, NULL ) ) != 0 )
+		return rc;
+
+	/* Boot from configured device */
+	return netboot_configured ( netdev );
+}
+
+/**
+ * Boot from whichever network device is configured first
+ *
+ * @v filter		Network device filter, or NULL to use all devices
+ * @ret rc		Return status code
+ */
+static int netboot_parallel ( int ( * filter ) ( struct net_device *netdev ) ){
+	struct net_device *netdev;
+	int rc;
+
+	/* Close all network devices */
+	close_all_netdevs();
+
+	/* Open devices and display device status */
+	for_each_netdev ( netdev ) {
+		if ( filter && ( ! filter ( netdev ) ) )
+			continue;
+		if ( ifopen ( netdev ) == 0 )
+			ifstat ( netdev );
+	}
+
+	/* Configure all devices concurrently */
+	if ( ( rc = ifconf_parallel ( NULL, &netdev ) ) != 0 )
+		return rc;
+
+	/* Boot from first configured device */
+	return netboot_configured ( netdev );
+}
+
 /**
  * Test if network device matches the autoboot device bus type and location
  *
@@ -514,6 +564,21 @@ void set_autoboot_ll_addr ( const void *ll_addr, size_t len ) {
 	is_autoboot_device = is_autoboot_ll_addr;
 }
 
+/**
+ * Check for existence of a usable autoboot network device
+ *
+ * @ret have_device	A usable autoboot network device exists
+ */
+static int have_autoboot_device ( void ) {
+	struct net_device *netdev;
+
+	for_each_netdev ( netdev ) {
+		if ( ( ! is_autoboot_device ) || is_autoboot_device ( netdev ) )
+			return 1;
+	}
+	return 0;
+}
+
 /**
  * Boot the system
  */
@@ -521,6 +586,21 @@ static int autoboot ( void ) {
 	struct net_device *netdev;
 	int rc = -ENODEV;
 
+	/* Probe any devices skipped at startup if we have no usable
+	 * network device.
+	 */
+	if ( ! have_autoboot_device() )
+		probe_skipped_devices();
+
+	/* Try booting from all network devices concurrently, if
+	 * applicable.
+	 */
+	if ( AUTOBOOT_PARALLEL_ENABLED ) {
+		rc = netboot_parallel ( is_autoboot_device );
+		printf ( "No more network devices\n" );
+		return rc;
+	}
+
 	/* Try booting from each network device.  If we have a
 	 * specified autoboot device location, then use only devices
 	 * matching that location.
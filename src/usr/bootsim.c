@@ -0,0 +1,521 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <ipxe/refcnt.h>
+#include <ipxe/list.h>
+#include <ipxe/interface.h>
+#include <ipxe/xfer.h>
+#include <ipxe/open.h>
+#include <ipxe/job.h>
+#include <ipxe/monojob.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/uri.h>
+#include <ipxe/socket.h>
+#include <ipxe/in.h>
+#include <ipxe/timer.h>
+#include <ipxe/netdevice.h>
+#include <ipxe/dhcp.h>
+#include <ipxe/settings.h>
+#include <usr/ifmgmt.h>
+#include <usr/autoboot.h>
+#include <usr/bootsim.h>
+
+/** @file
+ *
+ * Multi-client boot simulation
+ *
+ * Each network device acts as an independent client, performing DHCP
+ * and then downloading a boot image.  All clients run concurrently,
+ * allowing the capacity of boot infrastructure to be measured from a
+ * single process (e.g. using several AF_PACKET devices with distinct
+ * MAC addresses sharing one host interface).
+ *
+ */
+
+/** A boot simulation */
+struct bootsim {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** Job control interface */
+	struct interface job;
+	/** List of clients */
+	struct list_head clients;
+	/** Boot image URI, or NULL to use DHCP-supplied filename */
+	struct uri *uri;
+	/** Number of clients */
+	unsigned int count;
+	/** Number of clients still in progress */
+	unsigned int remaining;
+};
+
+/** A boot simulation client */
+struct bootsim_client {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** List of clients */
+	struct list_head list;
+	/** Boot simulation */
+	struct bootsim *sim;
+	/** Network device */
+	struct net_device *netdev;
+	/** DHCP job control interface */
+	struct interface job;
+	/** Boot image data transfer interface */
+	struct interface xfer;
+	/** Start time */
+	unsigned long started;
+	/** DHCP completion time */
+	unsigned long configured;
+	/** Download completion time */
+	unsigned long finished;
+	/** Number of bytes downloaded */
+	size_t len;
+	/** Client is still in progress */
+	int running;
+	/** Final status code */
+	int rc;
+};
+
+/**
+ * Free boot simulation client
+ *
+ * @v refcnt		Reference count
+ */
+static void bootsim_client_free ( struct refcnt *refcnt ) {
+	struct bootsim_client *client =
+		container_of ( refcnt, struct bootsim_client, refcnt );
+
+	netdev_put ( client->netdev );
+	free ( client );
+}
+
+/**
+ * Free boot simulation
+ *
+ * @v refcnt		Reference count
+ */
+static void bootsim_free ( struct refcnt *refcnt ) {
+	struct bootsim *sim = container_of ( refcnt, struct bootsim, refcnt );
+	struct bootsim_client *client;
+	struct bootsim_client *tmp;
+
+	list_for_each_entry_safe ( client, tmp, &sim->clients, list ) {
+		list_del ( &client->list );
+		ref_put ( &client->refcnt );
+	}
+	uri_put ( sim->uri );
+	free ( sim );
+}
+
+/**
+ * Finish boot simulation client
+ *
+ * @v client		Boot simulation client
+ * @v rc		Reason for finishing
+ */
+static void bootsim_client_finish ( struct bootsim_client *client, int rc ) {
+	struct bootsim *sim = client->sim;
+
+	/* Do nothing if already finished */
+	if ( ! client->running )
+		return;
+	client->running = 0;
+	client->rc = rc;
+	client->finished = currticks();
+
+	/* Shut down interfaces */
+	intf_shutdown ( &client->xfer, rc );
+	intf_shutdown ( &client->job, rc );
+
+	/* Finish simulation once all clients have finished */
+	assert ( sim->remaining > 0 );
+	if ( --sim->remaining == 0 )
+		intf_shutdown ( &sim->job, 0 );
+}
+
+/**
+ * Construct boot image URI scoped to a network device
+ *
+ * @v uri		Boot image URI
+ * @v netdev		Network device
+ * @ret scoped		Scoped boot image URI, or NULL on error
+ *
+ * Numeric server addresses are given an explicit scope identifying
+ * the client's network device, so that each client's traffic leaves
+ * via its own network device even when several clients share a
+ * subnet.  Other server names are left unchanged.
+ */
+static struct uri * bootsim_scope_uri ( struct uri *uri,
+					struct net_device *netdev ) {
+	struct sockaddr sa;
+	struct uri tmp;
+	struct uri *scoped;
+	const char *host = uri->host;
+	char *scoped_host;
+	size_t len;
+
+	/* Leave URI unchanged unless host is a numeric address */
+	if ( ( ! host ) || strchr ( host, '%' ) ||
+	     ( sock_aton ( host, &sa ) != 0 ) )
+		return uri_get ( uri );
+
+	/* Construct scoped host name */
+	len = strlen ( host );
+	if ( ( host[0] == '[' ) && ( host[ len - 1 ] == ']' ) ) {
+		if ( asprintf ( &scoped_host, "%.*s%%%s]", ( ( int ) len - 1 ),
+				host, netdev->name ) < 0 )
+			return NULL;
+	} else {
+		if ( asprintf ( &scoped_host, "%s%%%s",
+				host, netdev->name ) < 0 )
+			return NULL;
+	}
+
+	/* Construct scoped URI */
+	memcpy ( &tmp, uri, sizeof ( tmp ) );
+	tmp.host = scoped_host;
+	scoped = uri_dup ( &tmp );
+	free ( scoped_host );
+	return scoped;
+}
+
+/**
+ * Start boot image download
+ *
+ * @v client		Boot simulation client
+ * @ret rc		Return status code
+ */
+static int bootsim_client_fetch ( struct bootsim_client *client ) {
+	struct bootsim *sim = client->sim;
+	struct net_device *netdev = client->netdev;
+	struct settings *settings;
+	struct uri *uri;
+	struct uri *scoped;
+	int rc;
+
+	/* Identify boot image URI */
+	settings = netdev_settings ( netdev );
+	if ( sim->uri ) {
+		uri = uri_get ( sim->uri );
+	} else {
+		uri = fetch_next_server_and_filename ( settings );
+		if ( ! uri ) {
+			rc = -ENOMEM;
+			goto err_uri;
+		}
+	}
+	if ( ! uri_has_path ( uri ) ) {
+		rc = -ENOENT;
+		goto err_path;
+	}
+
+	/* Scope URI to this network device */
+	scoped = bootsim_scope_uri ( uri, netdev );
+	if ( ! scoped ) {
+		rc = -ENOMEM;
+		goto err_scope;
+	}
+
+	/* Start download */
+	if ( ( rc = xfer_open_uri ( &client->xfer, scoped ) ) != 0 )
+		goto err_open;
+
+ err_open:
+	uri_put ( scoped );
+ err_scope:
+ err_path:
+	uri_put ( uri );
+ err_uri:
+	return rc;
+}
+
+/**
+ * Handle DHCP completion
+ *
+ * @v client		Boot simulation client
+ * @v rc		Reason for completion
+ */
+static void bootsim_client_configured ( struct bootsim_client *client,
+					int rc ) {
+
+	/* Record completion time */
+	client->configured = currticks();
+	intf_restart ( &client->job, rc );
+
+	/* Start download, if applicable */
+	if ( ( rc != 0 ) || ( ( rc = bootsim_client_fetch ( client ) ) != 0 ) )
+		bootsim_client_finish ( client, rc );
+}
+
+/**
+ * Receive boot image data
+ *
+ * @v client		Boot simulation client
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int bootsim_client_deliver ( struct bootsim_client *client,
+				    struct io_buffer *iobuf,
+				    struct xfer_metadata *meta __unused ) {
+
+	/* Count and discard data */
+	client->len += iob_len ( iobuf );
+	free_iob ( iobuf );
+	return 0;
+}
+
+/** Boot simulation client DHCP job control interface operations */
+static struct interface_operation bootsim_client_job_op[] = {
+	INTF_OP ( intf_close, struct bootsim_client *,
+		  bootsim_client_configured ),
+};
+
+/** Boot simulation client DHCP job control interface descriptor */
+static struct interface_descriptor bootsim_client_job_desc =
+	INTF_DESC ( struct bootsim_client, job, bootsim_client_job_op );
+
+/** Boot simulation client data transfer interface operations */
+static struct interface_operation bootsim_client_xfer_op[] = {
+	INTF_OP ( xfer_deliver, struct bootsim_client *,
+		  bootsim_client_deliver ),
+	INTF_OP ( intf_close, struct bootsim_client *, bootsim_client_finish ),
+};
+
+/** Boot simulation client data transfer interface descriptor */
+static struct interface_descriptor bootsim_client_xfer_desc =
+	INTF_DESC ( struct bootsim_client, xfer, bootsim_client_xfer_op );
+
+/**
+ * Report boot simulation progress
+ *
+ * @v sim		Boot simulation
+ * @v progress		Progress report to fill in
+ * @ret ongoing_rc	Ongoing job status code (if known)
+ */
+static int bootsim_progress ( struct bootsim *sim,
+			      struct job_progress *progress ) {
+	struct bootsim_client *client;
+
+	/* Treat any data received or any client finishing as progress */
+	progress->completed = ( sim->count - sim->remaining );
+	list_for_each_entry ( client, &sim->clients, list )
+		progress->completed += client->len;
+	return 0;
+}
+
+/**
+ * Abort boot simulation
+ *
+ * @v sim		Boot simulation
+ * @v rc		Reason for abort
+ */
+static void bootsim_close ( struct bootsim *sim, int rc ) {
+	struct bootsim_client *client;
+
+	/* Keep the simulation alive while finishing clients */
+	ref_get ( &sim->refcnt );
+	list_for_each_entry ( client, &sim->clients, list )
+		bootsim_client_finish ( client, rc );
+	intf_shutdown ( &sim->job, rc );
+	ref_put ( &sim->refcnt );
+}
+
+/** Boot simulation job control interface operations */
+static struct interface_operation bootsim_job_op[] = {
+	INTF_OP ( job_progress, struct bootsim *, bootsim_progress ),
+	INTF_OP ( intf_close, struct bootsim *, bootsim_close ),
+};
+
+/** Boot simulation job control interface descriptor */
+static struct interface_descriptor bootsim_job_desc =
+	INTF_DESC ( struct bootsim, job, bootsim_job_op );
+
+/**
+ * Add boot simulation client
+ *
+ * @v sim		Boot simulation
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ */
+static int bootsim_add ( struct bootsim *sim, struct net_device *netdev ) {
+	struct bootsim_client *client;
+	int rc;
+
+	/* Allocate and initialise structure */
+	client = zalloc ( sizeof ( *client ) );
+	if ( ! client )
+		return -ENOMEM;
+	ref_init ( &client->refcnt, bootsim_client_free );
+	intf_init ( &client->job, &bootsim_client_job_desc, &client->refcnt );
+	intf_init ( &client->xfer, &bootsim_client_xfer_desc,
+		    &client->refcnt );
+	client->sim = sim;
+	client->netdev = netdev_get ( netdev );
+	client->started = currticks();
+	client->running = 1;
+	client->rc = -EINPROGRESS;
+	list_add_tail ( &client->list, &sim->clients );
+	sim->count++;
+	sim->remaining++;
+
+	/* Open network device and start DHCP */
+	if ( ( ( rc = ifopen ( netdev ) ) != 0 ) ||
+	     ( ( rc = start_dhcp ( &client->job, netdev ) ) != 0 ) ) {
+		client->configured = currticks();
+		bootsim_client_finish ( client, rc );
+	}
+
+	return 0;
+}
+
+/**
+ * Convert ticks to milliseconds
+ *
+ * @v ticks		Elapsed ticks
+ * @ret ms		Elapsed milliseconds
+ */
+static inline unsigned long bootsim_ms ( unsigned long ticks ) {
+	return ( ticks / TICKS_PER_MS );
+}
+
+/**
+ * Report boot simulation results
+ *
+ * @v sim		Boot simulation
+ * @v elapsed		Total elapsed time (in ticks)
+ * @ret rc		Return status code
+ */
+static int bootsim_report ( struct bootsim *sim, unsigned long elapsed ) {
+	struct bootsim_client *client;
+	struct in_addr address;
+	unsigned long dhcp_ms;
+	unsigned long fetch_ms;
+	unsigned long dhcp_max = 0;
+	unsigned long fetch_max = 0;
+	unsigned long dhcp_total = 0;
+	unsigned long fetch_total = 0;
+	unsigned long total_ms;
+	unsigned int succeeded = 0;
+	size_t len = 0;
+	int rc = 0;
+
+	/* Report each client */
+	list_for_each_entry ( client, &sim->clients, list ) {
+		dhcp_ms = bootsim_ms ( client->configured - client->started );
+		fetch_ms = bootsim_ms ( client->finished - client->configured );
+		address.s_addr = 0;
+		fetch_ipv4_setting ( netdev_settings ( client->netdev ),
+				     &ip_setting, &address );
+		printf ( "%s %s %s dhcp %ldms fetch %ldms %zd bytes: %s\n",
+			 client->netdev->name, netdev_addr ( client->netdev ),
+			 inet_ntoa ( address ), dhcp_ms, fetch_ms, client->len,
+			 ( client->rc ? strerror ( client->rc ) : "ok" ) );
+		len += client->len;
+		if ( client->rc != 0 ) {
+			rc = client->rc;
+			continue;
+		}
+		succeeded++;
+		dhcp_total += dhcp_ms;
+		fetch_total += fetch_ms;
+		if ( dhcp_max < dhcp_ms )
+			dhcp_max = dhcp_ms;
+		if ( fetch_max < fetch_ms )
+			fetch_max = fetch_ms;
+	}
+
+	/* Report aggregate results */
+	total_ms = bootsim_ms ( elapsed );
+	printf ( "%d/%d clients succeeded, %zd bytes in %ldms (%ld kB/s)\n",
+		 succeeded, sim->count, len, total_ms,
+		 ( total_ms ? ( ( unsigned long ) ( len / total_ms ) ) : 0 ) );
+	if ( succeeded ) {
+		printf ( "dhcp avg %ldms max %ldms, fetch avg %ldms max "
+			 "%ldms\n", ( dhcp_total / succeeded ), dhcp_max,
+			 ( fetch_total / succeeded ), fetch_max );
+	}
+
+	return rc;
+}
+
+/**
+ * Simulate concurrent boot of all network devices
+ *
+ * @v uri		Boot image URI, or NULL to use DHCP-supplied filename
+ * @v timeout		Inactivity timeout, in ticks (or zero for no timeout)
+ * @ret rc		Return status code
+ */
+int bootsim ( struct uri *uri, unsigned long timeout ) {
+	struct bootsim *sim;
+	struct net_device *netdev;
+	unsigned long started;
+	int rc;
+
+	/* Allocate and initialise structure */
+	sim = zalloc ( sizeof ( *sim ) );
+	if ( ! sim ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	ref_init ( &sim->refcnt, bootsim_free );
+	intf_init ( &sim->job, &bootsim_job_desc, &sim->refcnt );
+	INIT_LIST_HEAD ( &sim->clients );
+	sim->uri = uri_get ( uri );
+
+	/* Start all clients */
+	started = currticks();
+	sim->remaining++;
+	for_each_netdev ( netdev ) {
+		if ( ( rc = bootsim_add ( sim, netdev ) ) != 0 )
+			goto err_add;
+	}
+	if ( ! sim->count ) {
+		rc = -ENODEV;
+		goto err_none;
+	}
+
+	/* Wait for all clients to finish */
+	intf_plug_plug ( &monojob, &sim->job );
+	if ( --sim->remaining == 0 )
+		intf_shutdown ( &sim->job, 0 );
+	monojob_wait ( "Simulating boot", timeout );
+
+	/* Report results */
+	rc = bootsim_report ( sim, ( currticks() - started ) );
+
+ err_none:
+ err_add:
+	bootsim_close ( sim, rc );
+	ref_put ( &sim->refcnt );
+ err_alloc:
+	return rc;
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdio.h>
+#include <syslog.h>
+#include <ipxe/malloc.h>
+#include <usr/heapstat.h>
+
+/** @file
+ *
+ * Heap statistics
+ *
+ * Allocation sizes and the time spent within the allocator are
+ * recorded by the "malloc.size", "malloc.alloc" and "malloc.discard"
+ * profilers, and may be reported using the profiling commands.
+ *
+ */
+
+/**
+ * Print heap statistics
+ *
+ */
+void heapstat ( void ) {
+	struct cache_discarder *discarder;
+
+	printf ( "Heap: %zdkB (target %zdkB, extended %d times)\n",
+		 ( ( freemem + usedmem ) >> 10 ), ( heaptarget >> 10 ),
+		 heapgrown );
+	printf ( "Used: %zdkB (maximum %zdkB)\n",
+		 ( usedmem >> 10 ), ( maxusedmem >> 10 ) );
+	printf ( "Free: %zdkB\n", ( freemem >> 10 ) );
+	for_each_table_entry ( discarder, CACHE_DISCARDERS ) {
+		printf ( "Discard %s: %ld items in %ld calls\n",
+			 discarder->name, discarder->discarded,
+			 discarder->invoked );
+	}
+}
+
+/**
+ * Record heap statistics to system log
+ *
+ * Statistics are written to all consoles used for logging, as a
+ * line of the form
+ *
+ *   heapstat <size> <used> <maxused> <free> <extended>
+ *
+ * followed by a line of the form
+ *
+ *   heapstat discard <name> <calls> <items>
+ *
+ * for each cache discarder.  Sizes are in bytes.
+ */
+void heapstat_log ( void ) {
+	struct cache_discarder *discarder;
+
+	/* Use log_printf() directly, since this is an explicit
+	 * request that should not be filtered by the compile-time
+	 * LOG_LEVEL.
+	 */
+	log_printf ( "heapstat %zd %zd %zd %zd %d\n", ( freemem + usedmem ),
+		     usedmem, maxusedmem, freemem, heapgrown );
+	for_each_table_entry ( discarder, CACHE_DISCARDERS ) {
+		log_printf ( "heapstat discard %s %ld %ld\n", discarder->name,
+			     discarder->invoked, discarder->discarded );
+	}
+}
+
+/**
+ * Reset heap statistics
+ *
+ */
+void heapstat_reset ( void ) {
+	struct cache_discarder *discarder;
+
+	maxusedmem = usedmem;
+	for_each_table_entry ( discarder, CACHE_DISCARDERS ) {
+		discarder->invoked = 0;
+		discarder->discarded = 0;
+	}
+}
@@ -25,6 +25,7 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <errno.h>
 #include <ipxe/console.h>
@@ -56,6 +57,16 @@ struct errortab ifmgmt_errors[] __errortab = {
 	__einfo_errortab ( EINFO_EADDRNOTAVAIL_CONFIG ),
 };
 
+/** Network devices awaiting link-up during parallel configuration */
+static struct {
+	/** Network devices */
+	struct net_device **netdevs;
+	/** Number of network devices */
+	unsigned int count;
+	/** Time at which waiting started */
+	unsigned long start;
+} ifconf_pending;
+
 /**
  * Open network device
  *
@@ -121,6 +132,10 @@ void ifstat ( struct net_device *netdev ) {
 		printf ( "  [Link status: %s]\n",
 			 strerror ( netdev->link_rc ) );
 	}
+	if ( netdev->rx_stats.nobuf ) {
+		printf ( "  [RX buffer shortages: %d]\n",
+			 netdev->rx_stats.nobuf );
+	}
 	ifstat_errors ( &netdev->tx_stats, "TXE" );
 	ifstat_errors ( &netdev->rx_stats, "RXE" );
 }
@@ -298,3 +313,217 @@ int ifconf ( struct net_device *netdev,
 		 netdev->name, netdev->ll_protocol->ntoa ( netdev->ll_addr ) );
 	return ifpoller_wait ( netdev, configurator, 0, ifconf_progress );
 }
+
+/**
+ * Identify network device with completed configuration
+ *
+ * @v configurator	Network device configurator, or NULL to use all
+ * @ret netdev		Configured network device, or NULL
+ */
+static struct net_device *
+ifconf_parallel_done ( struct net_device_configurator *configurator ) {
+	struct net_device *netdev;
+	struct net_device_configuration *config;
+
+	/* Find first open device with completed configuration */
+	for_each_netdev ( netdev ) {
+		if ( ! netdev_is_open ( netdev ) )
+			continue;
+		if ( netdev_configuration_in_progress ( netdev ) )
+			continue;
+		if ( configurator ) {
+			config = netdev_configuration ( netdev, configurator );
+			if ( config->rc == 0 )
+				return netdev;
+		} else {
+			if ( netdev_configuration_ok ( netdev ) )
+				return netdev;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Start configuration on one of several network devices
+ *
+ * @v netdev		Network device
+ * @v configurator	Network device configurator, or NULL to use all
+ * @ret rc		Return status code
+ */
+static int ifconf_parallel_start ( struct net_device *netdev,
+				   struct net_device_configurator
+				   *configurator ) {
+	int rc;
+
+	/* Start configuration */
+	if ( configurator ) {
+		rc = netdev_configure ( netdev, configurator );
+	} else {
+		rc = netdev_configure_all ( netdev );
+	}
+	if ( rc != 0 ) {
+		printf ( "Could not configure %s: %s\n",
+			 netdev->name, strerror ( rc ) );
+		/* Close device, to avoid memory exhaustion */
+		ifclose ( netdev );
+		return rc;
+	}
+
+	return 0;
+}
+
+/**
+ * Start configuration on any network devices whose link has come up
+ *
+ * @v configurator	Network device configurator, or NULL to use all
+ */
+static void ifconf_parallel_link ( struct net_device_configurator
+				   *configurator ) {
+	struct net_device *netdev;
+	unsigned int i = 0;
+
+	while ( i < ifconf_pending.count ) {
+
+		/* Leave device pending until link is up (or device
+		 * has been closed).
+		 */
+		netdev = ifconf_pending.netdevs[i];
+		if ( netdev_is_open ( netdev ) && ! netdev_link_ok ( netdev ) ) {
+			i++;
+			continue;
+		}
+
+		/* Remove from list of pending devices */
+		ifconf_pending.netdevs[i] =
+			ifconf_pending.netdevs[ --ifconf_pending.count ];
+
+		/* Start configuration */
+		if ( netdev_is_open ( netdev ) )
+			ifconf_parallel_start ( netdev, configurator );
+		netdev_put ( netdev );
+	}
+}
+
+/**
+ * Check parallel configuration progress
+ *
+ * @v ifpoller		Network device poller
+ * @ret ongoing_rc	Ongoing job status code (if known)
+ */
+static int ifconf_parallel_progress ( struct ifpoller *ifpoller ) {
+	struct net_device *netdev;
+	unsigned long elapsed;
+
+	/* Start configuration on any devices whose link has come up */
+	ifconf_parallel_link ( ifpoller->configurator );
+
+	/* Terminate successfully if any device is configured */
+	if ( ifconf_parallel_done ( ifpoller->configurator ) ) {
+		intf_close ( &ifpoller->job, 0 );
+		return 0;
+	}
+
+	/* Do nothing more while any configuration is in progress */
+	for_each_netdev ( netdev ) {
+		if ( netdev_is_open ( netdev ) &&
+		     netdev_configuration_in_progress ( netdev ) )
+			return 0;
+	}
+
+	/* Do nothing more while any device may yet achieve link-up */
+	if ( ifconf_pending.count ) {
+		elapsed = ( currticks() - ifconf_pending.start );
+		if ( elapsed < LINK_WAIT_TIMEOUT )
+			return ifconf_pending.netdevs[0]->link_rc;
+	}
+
+	/* Terminate with failure if all configurations have failed */
+	intf_close ( &ifpoller->job, -EADDRNOTAVAIL_CONFIG );
+	return -EADDRNOTAVAIL_CONFIG;
+}
+
+/**
+ * Perform network device configuration on all open devices concurrently
+ *
+ * @v configurator	Network device configurator, or NULL to use all
+ * @v netdev		Network device to fill in
+ * @ret rc		Return status code
+ *
+ * Configuration is started on every open network device as soon as
+ * its link comes up, and the first device to be configured
+ * successfully is returned.  All other network devices are closed,
+ * to terminate any ongoing configuration.  This avoids waiting for a
+ * link-up or configuration timeout on each unconnected device in
+ * turn.
+ */
+int ifconf_parallel ( struct net_device_configurator *configurator,
+		      struct net_device **netdev ) {
+	struct net_device *candidate;
+	const char *sep = "";
+	unsigned int count = 0;
+	int started = 0;
+	int rc;
+
+	/* Allocate list of devices awaiting link-up */
+	for_each_netdev ( candidate )
+		count++;
+	ifconf_pending.netdevs = malloc ( count * sizeof ( candidate ) );
+	if ( count && ! ifconf_pending.netdevs )
+		return -ENOMEM;
+	ifconf_pending.count = 0;
+	ifconf_pending.start = currticks();
+
+	/* Start configuration on each open device with link up, and
+	 * defer configuration on each open device without link up
+	 * until its link comes up.
+	 */
+	for_each_netdev ( candidate ) {
+		if ( ! netdev_is_open ( candidate ) )
+			continue;
+		netdev_poll ( candidate );
+		if ( ! netdev_link_ok ( candidate ) ) {
+			ifconf_pending.netdevs[ ifconf_pending.count++ ] =
+				netdev_get ( candidate );
+			continue;
+		}
+		if ( ifconf_parallel_start ( candidate, configurator ) != 0 )
+			continue;
+		started++;
+	}
+	if ( ! ( started || ifconf_pending.count ) ) {
+		rc = -ENODEV;
+		goto err_none;
+	}
+
+	/* Wait for first configuration to complete */
+	printf ( "Configuring %s%s%s(",
+		 ( configurator ? "[" : "" ),
+		 ( configurator ? configurator->name : "" ),
+		 ( configurator ? "] " : "" ) );
+	for_each_netdev ( candidate ) {
+		if ( netdev_is_open ( candidate ) ) {
+			printf ( "%s%s", sep, candidate->name );
+			sep = " ";
+		}
+	}
+	printf ( ")" );
+	rc = ifpoller_wait ( NULL, configurator, 0, ifconf_parallel_progress );
+	*netdev = ( rc ? NULL : ifconf_parallel_done ( configurator ) );
+
+	/* Close all other devices */
+	for_each_netdev ( candidate ) {
+		if ( candidate != *netdev )
+			ifclose ( candidate );
+	}
+	if ( *netdev )
+		printf ( "Configured %s\n", ( *netdev )->name );
+
+ err_none:
+	/* Drop any devices still awaiting link-up */
+	while ( ifconf_pending.count )
+		netdev_put ( ifconf_pending.netdevs[ --ifconf_pending.count ] );
+	free ( ifconf_pending.netdevs );
+	ifconf_pending.netdevs = NULL;
+	return rc;
+}
@@ -25,13 +25,22 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdio.h>
 #include <errno.h>
+#include <assert.h>
+#include <ipxe/refcnt.h>
+#include <ipxe/interface.h>
+#include <ipxe/job.h>
+#include <ipxe/process.h>
+#include <ipxe/umalloc.h>
 #include <ipxe/image.h>
 #include <ipxe/downloader.h>
 #include <ipxe/monojob.h>
 #include <ipxe/open.h>
 #include <ipxe/uri.h>
+#include <ipxe/settings.h>
+#include <ipxe/timer.h>
 #include <usr/imgmgmt.h>
 
 /** @file
@@ -41,26 +50,162 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  */
 
 /**
- * Download a new image
+ * Construct redacted URI string
  *
  * @v uri		URI
- * @v timeout		Download timeout
- * @v image		Image to fill in
- * @ret rc		Return status code
+ * @ret string		Redacted URI string, or NULL on error
+ *
+ * The returned string is suitable for displaying to the user as a
+ * download description, and must eventually be freed by the caller.
  */
-int imgdownload ( struct uri *uri, unsigned long timeout,
-		  struct image **image ) {
+static char * imgdownload_redact ( struct uri *uri ) {
 	struct uri uri_redacted;
-	char *uri_string_redacted;
-	int rc;
 
-	/* Construct redacted URI */
 	memcpy ( &uri_redacted, uri, sizeof ( uri_redacted ) );
 	uri_redacted.user = NULL;
 	uri_redacted.password = NULL;
 	uri_redacted.query = NULL;
 	uri_redacted.fragment = NULL;
-	uri_string_redacted = format_uri_alloc ( &uri_redacted );
+	return format_uri_alloc ( &uri_redacted );
+}
+
+/**
+ * Copy image content from an existing source
+ *
+ * @v image		Image to fill in
+ * @ret rc		Return status code
+ *
+ * If the image has an expected digest, then any registered or cached
+ * image already holding content with that digest may be used in place
+ * of downloading the content again.
+ */
+static int imgdownload_local ( struct image *image ) {
+	struct digest_algorithm *digest = image->expected;
+	void *value = image->expected_value;
+	struct image *source;
+	int rc;
+
+	/* Find an existing image with matching content */
+	if ( ! digest )
+		return -ENOENT;
+	source = find_image_digest ( digest, value );
+	if ( ! source )
+		source = downloader_cached ( digest, value );
+	if ( ! source )
+		return -ENOENT;
+	DBGC ( image, "IMAGE %s using content of %s\n",
+	       image->name, source->name );
+
+	/* Copy content */
+	image->data = umalloc ( source->len );
+	if ( ! image->data )
+		return -ENOMEM;
+	memcpy ( user_to_virt ( image->data, 0 ),
+		 user_to_virt ( source->data, 0 ), source->len );
+	image->len = source->len;
+
+	/* Verify copied content */
+	if ( ( rc = image_check_digest ( image ) ) != 0 ) {
+		ufree ( image->data );
+		image->data = UNULL;
+		image->len = 0;
+		return rc;
+	}
+
+	return 0;
+}
+
+/**
+ * Record image download statistic
+ *
+ * @v image		Image
+ * @v name		Statistic name
+ * @v value		Statistic value
+ * @ret rc		Return status code
+ */
+static int imgdownload_store ( struct image *image, const char *name,
+			       unsigned long long value ) {
+	char setting_name[ strlen ( image->name ) + 1 /* "/" */ +
+			   strlen ( name ) + 1 /* NUL */ ];
+	struct settings *settings;
+	struct setting setting;
+	char buf[24];
+	int rc;
+
+	/* Parse setting name (creating settings block if needed) */
+	snprintf ( setting_name, sizeof ( setting_name ), "%s/%s",
+		   image->name, name );
+	if ( ( rc = parse_setting_name ( setting_name,
+					 autovivify_child_settings,
+					 &settings, &setting ) ) != 0 )
+		return rc;
+
+	/* Store value as a string */
+	setting.type = &setting_type_string;
+	snprintf ( buf, sizeof ( buf ), "%lld", value );
+	if ( ( rc = storef_setting ( settings, &setting, buf ) ) != 0 )
+		return rc;
+
+	return 0;
+}
+
+/**
+ * Record image download throughput
+ *
+ * @v image		Image
+ * @v ticks		Time taken to download, in ticks
+ *
+ * The download duration (in milliseconds) and average throughput (in
+ * bytes per second) are stored as ${<image>/duration} and
+ * ${<image>/speed}, for use by scripts.
+ */
+static void imgdownload_record ( struct image *image, unsigned long ticks ) {
+	unsigned long long msecs;
+	unsigned long long speed;
+	int rc;
+
+	/* Calculate throughput */
+	if ( ! ticks )
+		ticks = 1;
+	msecs = ( ( ticks * 1000ULL ) / TICKS_PER_SEC );
+	speed = ( ( ( ( unsigned long long ) image->len ) * TICKS_PER_SEC ) /
+		  ticks );
+	DBGC ( image, "IMAGE %s downloaded %zd bytes in %lldms (%lld "
+	       "bytes/s)\n", image->name, image->len, msecs, speed );
+
+	/* Record in settings */
+	if ( ( ( rc = imgdownload_store ( image, "duration", msecs ) ) != 0 ) ||
+	     ( ( rc = imgdownload_store ( image, "speed", speed ) ) != 0 ) ) {
+		DBGC ( image, "IMAGE %s could not record throughput: %s\n",
+		       image->name, strerror ( rc ) );
+	}
+}
+
+/**
+ * Download a new image with an expected digest
+ *
+ * @v uri		URI
+ * @v timeout		Download timeout
+ * @v digest		Digest algorithm, or NULL
+ * @v value		Expected digest value (if digest is not NULL)
+ * @v image		Image to fill in
+ * @ret rc		Return status code
+ *
+ * If an expected digest is specified, then the image will be verified
+ * against the digest as it is downloaded, and may be satisfied from
+ * any existing image holding identical content.
+ */
+int imgdownload_digest ( struct uri *uri, unsigned long timeout,
+			 struct digest_algorithm *digest, const void *value,
+			 struct image **image ) {
+	char *uri_string_redacted;
+	unsigned long start;
+	unsigned long ticks = 0;
+	int downloaded = 0;
+	int rc;
+
+	/* Construct redacted URI */
+	uri_string_redacted = imgdownload_redact ( uri );
 	if ( ! uri_string_redacted ) {
 		rc = -ENOMEM;
 		goto err_uri_string;
@@ -80,15 +225,30 @@ int imgdownload ( struct uri *uri, unsigned long timeout,
 		goto err_alloc_image;
 	}
 
-	/* Create downloader */
-	if ( ( rc = create_downloader ( &monojob, *image ) ) != 0 ) {
-		printf ( "Could not start download: %s\n", strerror ( rc ) );
-		goto err_create_downloader;
-	}
+	/* Record expected digest, if applicable */
+	if ( digest &&
+	     ( ( rc = image_set_expected ( *image, digest, value ) ) != 0 ) )
+		goto err_set_expected;
 
-	/* Wait for download to complete */
-	if ( ( rc = monojob_wait ( uri_string_redacted, timeout ) ) != 0 )
-		goto err_monojob_wait;
+	/* Use existing content, if available, otherwise download */
+	if ( ( rc = imgdownload_local ( *image ) ) == 0 ) {
+		printf ( "%s... ok (cached)\n", uri_string_redacted );
+	} else {
+		/* Create downloader */
+		if ( ( rc = create_downloader ( &monojob, *image ) ) != 0 ) {
+			printf ( "Could not start download: %s\n",
+				 strerror ( rc ) );
+			goto err_create_downloader;
+		}
+
+		/* Wait for download to complete */
+		start = currticks();
+		if ( ( rc = monojob_wait ( uri_string_redacted,
+					   timeout ) ) != 0 )
+			goto err_monojob_wait;
+		ticks = ( currticks() - start );
+		downloaded = 1;
+	}
 
 	/* Register image */
 	if ( ( rc = register_image ( *image ) ) != 0 ) {
@@ -96,9 +256,14 @@ int imgdownload ( struct uri *uri, unsigned long timeout,
 		goto err_register_image;
 	}
 
+	/* Record download throughput, if applicable */
+	if ( downloaded )
+		imgdownload_record ( *image, ticks );
+
  err_register_image:
  err_monojob_wait:
  err_create_downloader:
+ err_set_expected:
 	image_put ( *image );
  err_alloc_image:
 	uri_put ( uri );
@@ -108,6 +273,20 @@ int imgdownload ( struct uri *uri, unsigned long timeout,
 	return rc;
 }
 
+/**
+ * Download a new image
+ *
+ * @v uri		URI
+ * @v timeout		Download timeout
+ * @v image		Image to fill in
+ * @ret rc		Return status code
+ */
+int imgdownload ( struct uri *uri, unsigned long timeout,
+		  struct image **image ) {
+
+	return imgdownload_digest ( uri, timeout, NULL, NULL, image );
+}
+
 /**
  * Download a new image
  *
@@ -130,6 +309,544 @@ int imgdownload_string ( const char *uri_string, unsigned long timeout,
 	return rc;
 }
 
+/** An image within a concurrent image download */
+struct imgdownloads_image {
+	/** Concurrent image download */
+	struct imgdownloads *batch;
+	/** Job control interface */
+	struct interface job;
+	/** Image */
+	struct image *image;
+	/** Download has completed */
+	int done;
+};
+
+/** A concurrent image download */
+struct imgdownloads {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** Job control interface */
+	struct interface job;
+	/** Download starting process */
+	struct process process;
+	/** Number of images */
+	unsigned int count;
+	/** Number of downloads not yet started */
+	unsigned int unstarted;
+	/** Number of downloads still in progress */
+	unsigned int remaining;
+	/** Images */
+	struct imgdownloads_image images[0];
+};
+
+/**
+ * Free concurrent image download
+ *
+ * @v refcnt		Reference count
+ */
+static void imgdownloads_free ( struct refcnt *refcnt ) {
+	struct imgdownloads *batch =
+		container_of ( refcnt, struct imgdownloads, refcnt );
+	unsigned int i;
+
+	for ( i = 0 ; i < batch->count ; i++ )
+		image_put ( batch->images[i].image );
+	free ( batch );
+}
+
+/**
+ * Terminate concurrent image download
+ *
+ * @v batch		Concurrent image download
+ * @v rc		Reason for termination
+ */
+static void imgdownloads_close ( struct imgdownloads *batch, int rc ) {
+	unsigned int i;
+
+	/* Stop starting downloads */
+	process_del ( &batch->process );
+
+	/* Abort any downloads still in progress */
+	for ( i = 0 ; i < batch->count ; i++ )
+		intf_shutdown ( &batch->images[i].job, rc );
+
+	/* Shut down job control interface */
+	intf_shutdown ( &batch->job, rc );
+}
+
+/**
+ * Report progress of concurrent image download
+ *
+ * @v batch		Concurrent image download
+ * @v progress		Progress report to fill in
+ * @ret ongoing_rc	Ongoing job status code (if known)
+ */
+static int imgdownloads_progress ( struct imgdownloads *batch,
+				   struct job_progress *progress ) {
+	struct job_progress image_progress;
+	unsigned int i;
+
+	/* Sum progress of all downloads */
+	memset ( progress, 0, sizeof ( *progress ) );
+	for ( i = 0 ; i < batch->count ; i++ ) {
+		memset ( &image_progress, 0, sizeof ( image_progress ) );
+		job_progress ( &batch->images[i].job, &image_progress );
+		progress->completed += image_progress.completed;
+		progress->total += image_progress.total;
+		progress->flags |= image_progress.flags;
+	}
+
+	return 0;
+}
+
+/**
+ * Handle completion of a single image download
+ *
+ * @v image		Image within concurrent image download
+ * @v rc		Reason for completion
+ */
+static void imgdownloads_image_done ( struct imgdownloads_image *image,
+				      int rc ) {
+	struct imgdownloads *batch = image->batch;
+
+	/* Shut down interface */
+	intf_shutdown ( &image->job, rc );
+	image->done = 1;
+
+	/* Terminate on first failure, or when all downloads complete */
+	assert ( batch->remaining > 0 );
+	if ( ( rc != 0 ) || ( --batch->remaining == 0 ) )
+		imgdownloads_close ( batch, rc );
+}
+
+/**
+ * Start next image download
+ *
+ * @v batch		Concurrent image download
+ * @ret rc		Return status code
+ */
+static int imgdownloads_start ( struct imgdownloads *batch ) {
+	struct imgdownloads_image *image;
+	int rc;
+
+	/* Sanity check */
+	assert ( batch->unstarted > 0 );
+
+	/* Start download */
+	image = &batch->images[ --batch->unstarted ];
+	if ( ( rc = create_downloader ( &image->job, image->image ) ) != 0 ) {
+		printf ( "Could not start download: %s\n", strerror ( rc ) );
+		return rc;
+	}
+	batch->remaining++;
+
+	return 0;
+}
+
+/**
+ * Start image downloads as buffers are allocated
+ *
+ * @v batch		Concurrent image download
+ *
+ * Downloads are started in reverse order, with each download being
+ * started only once the following image has been allocated its
+ * buffer (which typically happens as soon as the image length is
+ * known) or has completed.  An allocator that grows downwards (such
+ * as the BIOS external heap) will therefore lay out the images in
+ * ascending address order, which allows initrds to be handed over to
+ * an operating system without first being reshuffled in memory.
+ */
+static void imgdownloads_step ( struct imgdownloads *batch ) {
+	struct imgdownloads_image *following;
+	int rc;
+
+	/* Stop when all downloads have been started */
+	if ( ! batch->unstarted ) {
+		process_del ( &batch->process );
+		return;
+	}
+
+	/* Wait until following image has been allocated its buffer */
+	following = &batch->images[batch->unstarted];
+	if ( ! ( following->image->data || following->done ) )
+		return;
+
+	/* Start next download */
+	if ( ( rc = imgdownloads_start ( batch ) ) != 0 )
+		imgdownloads_close ( batch, rc );
+}
+
+/** Concurrent image download process descriptor */
+static struct process_descriptor imgdownloads_process_desc =
+	PROC_DESC ( struct imgdownloads, process, imgdownloads_step );
+
+/** Concurrent image download job control interface operations */
+static struct interface_operation imgdownloads_job_op[] = {
+	INTF_OP ( job_progress, struct imgdownloads *, imgdownloads_progress ),
+	INTF_OP ( intf_close, struct imgdownloads *, imgdownloads_close ),
+};
+
+/** Concurrent image download job control interface descriptor */
+static struct interface_descriptor imgdownloads_job_desc =
+	INTF_DESC ( struct imgdownloads, job, imgdownloads_job_op );
+
+/** Single image download job control interface operations */
+static struct interface_operation imgdownloads_image_job_op[] = {
+	INTF_OP ( intf_close, struct imgdownloads_image *,
+		  imgdownloads_image_done ),
+};
+
+/** Single image download job control interface descriptor */
+static struct interface_descriptor imgdownloads_image_job_desc =
+	INTF_DESC ( struct imgdownloads_image, job,
+		    imgdownloads_image_job_op );
+
+/**
+ * Download new images concurrently
+ *
+ * @v uris		URIs
+ * @v count		Number of URIs
+ * @v timeout		Download timeout
+ * @ret rc		Return status code
+ *
+ * Downloads run concurrently, so that requests to the same server
+ * may share a single connection.  Images are registered (in order)
+ * only if all downloads succeed.
+ */
+int imgdownloads ( struct uri **uris, unsigned int count,
+		   unsigned long timeout ) {
+	struct imgdownloads *batch;
+	struct imgdownloads_image *image;
+	struct uri *uri;
+	char description[32];
+	unsigned int i;
+	int rc;
+
+	/* Allocate and initialise structure */
+	batch = zalloc ( sizeof ( *batch ) +
+			 ( count * sizeof ( batch->images[0] ) ) );
+	if ( ! batch ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	ref_init ( &batch->refcnt, imgdownloads_free );
+	intf_init ( &batch->job, &imgdownloads_job_desc, &batch->refcnt );
+	process_init_stopped ( &batch->process, &imgdownloads_process_desc,
+			       &batch->refcnt );
+	for ( i = 0 ; i < count ; i++ ) {
+		image = &batch->images[i];
+		image->batch = batch;
+		intf_init ( &image->job, &imgdownloads_image_job_desc,
+			    &batch->refcnt );
+	}
+	batch->count = count;
+
+	/* Allocate images */
+	for ( i = 0 ; i < count ; i++ ) {
+		image = &batch->images[i];
+		uri = resolve_uri ( cwuri, uris[i] );
+		if ( ! uri ) {
+			rc = -ENOMEM;
+			goto err_alloc_image;
+		}
+		image->image = alloc_image ( uri );
+		uri_put ( uri );
+		if ( ! image->image ) {
+			rc = -ENOMEM;
+			goto err_alloc_image;
+		}
+	}
+
+	/* Start final download, and start remaining downloads in
+	 * reverse order as each preceding buffer is allocated.
+	 */
+	batch->unstarted = count;
+	if ( ( rc = imgdownloads_start ( batch ) ) != 0 )
+		goto err_create_downloader;
+	process_add ( &batch->process );
+
+	/* Wait for all downloads to complete */
+	intf_plug_plug ( &batch->job, &monojob );
+	snprintf ( description, sizeof ( description ),
+		   "Downloading %d images", count );
+	if ( ( rc = monojob_wait ( description, timeout ) ) != 0 )
+		goto err_monojob_wait;
+
+	/* Register images */
+	for ( i = 0 ; i < count ; i++ ) {
+		image = &batch->images[i];
+		if ( ( rc = register_image ( image->image ) ) != 0 ) {
+			printf ( "Could not register image: %s\n",
+				 strerror ( rc ) );
+			goto err_register_image;
+		}
+	}
+
+ err_register_image:
+ err_monojob_wait:
+ err_create_downloader:
+	imgdownloads_close ( batch, rc );
+ err_alloc_image:
+	ref_put ( &batch->refcnt );
+ err_alloc:
+	return rc;
+}
+
+/** A background image download */
+struct imgprefetch {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** List of background image downloads */
+	struct list_head list;
+	/** Downloader job control interface */
+	struct interface job;
+	/** Waiting job control interface */
+	struct interface monitor;
+	/** Image */
+	struct image *image;
+	/** Download description (redacted URI) */
+	char *description;
+	/** Download status */
+	int rc;
+};
+
+/** List of background image downloads */
+static LIST_HEAD ( imgprefetches );
+
+/**
+ * Free background image download
+ *
+ * @v refcnt		Reference count
+ */
+static void imgprefetch_free ( struct refcnt *refcnt ) {
+	struct imgprefetch *prefetch =
+		container_of ( refcnt, struct imgprefetch, refcnt );
+
+	image_put ( prefetch->image );
+	free ( prefetch->description );
+	free ( prefetch );
+}
+
+/**
+ * Remove background image download from list
+ *
+ * @v prefetch		Background image download
+ *
+ * It is safe to call imgprefetch_remove() multiple times; further
+ * calls will have no effect.
+ */
+static void imgprefetch_remove ( struct imgprefetch *prefetch ) {
+
+	if ( ! list_empty ( &prefetch->list ) ) {
+		list_del ( &prefetch->list );
+		INIT_LIST_HEAD ( &prefetch->list );
+		ref_put ( &prefetch->refcnt );
+	}
+}
+
+/**
+ * Report progress of background image download
+ *
+ * @v prefetch		Background image download
+ * @v progress		Progress report to fill in
+ * @ret ongoing_rc	Ongoing job status code (if known)
+ */
+static int imgprefetch_progress ( struct imgprefetch *prefetch,
+				  struct job_progress *progress ) {
+
+	return job_progress ( &prefetch->job, progress );
+}
+
+/**
+ * Handle completion of background image download
+ *
+ * @v prefetch		Background image download
+ * @v rc		Reason for completion
+ */
+static void imgprefetch_done ( struct imgprefetch *prefetch, int rc ) {
+
+	/* Ignore duplicate completions */
+	if ( prefetch->rc != -EINPROGRESS )
+		return;
+
+	/* Shut down downloader (aborting it if still in progress) */
+	intf_shutdown ( &prefetch->job, rc );
+
+	/* Register image, if download succeeded */
+	if ( ( rc == 0 ) &&
+	     ( ( rc = register_image ( prefetch->image ) ) != 0 ) ) {
+		DBGC ( prefetch, "PREFETCH %s could not register: %s\n",
+		       prefetch->description, strerror ( rc ) );
+	}
+	DBGC ( prefetch, "PREFETCH %s complete: %s\n",
+	       prefetch->description, strerror ( rc ) );
+	prefetch->rc = rc;
+
+	/* Successful downloads need no further tracking.  Failed
+	 * downloads remain in the list until the failure has been
+	 * reported to a waiter.
+	 */
+	if ( rc == 0 )
+		imgprefetch_remove ( prefetch );
+
+	/* Notify any waiter */
+	intf_restart ( &prefetch->monitor, rc );
+}
+
+/** Background image download downloader interface operations */
+static struct interface_operation imgprefetch_job_op[] = {
+	INTF_OP ( intf_close, struct imgprefetch *, imgprefetch_done ),
+};
+
+/** Background image download downloader interface descriptor */
+static struct interface_descriptor imgprefetch_job_desc =
+	INTF_DESC ( struct imgprefetch, job, imgprefetch_job_op );
+
+/** Background image download waiting interface operations */
+static struct interface_operation imgprefetch_monitor_op[] = {
+	INTF_OP ( job_progress, struct imgprefetch *, imgprefetch_progress ),
+	INTF_OP ( intf_close, struct imgprefetch *, imgprefetch_done ),
+};
+
+/** Background image download waiting interface descriptor */
+static struct interface_descriptor imgprefetch_monitor_desc =
+	INTF_DESC ( struct imgprefetch, monitor, imgprefetch_monitor_op );
+
+/**
+ * Start downloading a new image in the background
+ *
+ * @v uri_string	URI string
+ * @v timeout		Download timeout (unused)
+ * @v image		Image to fill in
+ * @ret rc		Return status code
+ *
+ * The image will be registered automatically when the download
+ * completes.  Use imgprefetch_wait() to wait for completion.
+ */
+int imgprefetch ( const char *uri_string, unsigned long timeout __unused,
+		  struct image **image ) {
+	struct imgprefetch *prefetch;
+	struct uri *uri;
+	struct uri *resolved;
+	int rc;
+
+	/* Parse URI */
+	uri = parse_uri ( uri_string );
+	if ( ! uri ) {
+		rc = -ENOMEM;
+		goto err_parse_uri;
+	}
+
+	/* Allocate and initialise structure */
+	prefetch = zalloc ( sizeof ( *prefetch ) );
+	if ( ! prefetch ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	ref_init ( &prefetch->refcnt, imgprefetch_free );
+	INIT_LIST_HEAD ( &prefetch->list );
+	intf_init ( &prefetch->job, &imgprefetch_job_desc,
+		    &prefetch->refcnt );
+	intf_init ( &prefetch->monitor, &imgprefetch_monitor_desc,
+		    &prefetch->refcnt );
+	prefetch->rc = -EINPROGRESS;
+
+	/* Construct redacted URI */
+	prefetch->description = imgdownload_redact ( uri );
+	if ( ! prefetch->description ) {
+		rc = -ENOMEM;
+		goto err_description;
+	}
+
+	/* Resolve URI and allocate image */
+	resolved = resolve_uri ( cwuri, uri );
+	if ( ! resolved ) {
+		rc = -ENOMEM;
+		goto err_resolve_uri;
+	}
+	prefetch->image = alloc_image ( resolved );
+	uri_put ( resolved );
+	if ( ! prefetch->image ) {
+		rc = -ENOMEM;
+		goto err_alloc_image;
+	}
+
+	/* Add to list of background image downloads */
+	ref_get ( &prefetch->refcnt );
+	list_add_tail ( &prefetch->list, &imgprefetches );
+
+	/* Create downloader */
+	if ( ( rc = create_downloader ( &prefetch->job,
+					prefetch->image ) ) != 0 ) {
+		printf ( "Could not start download: %s\n", strerror ( rc ) );
+		imgprefetch_remove ( prefetch );
+		goto err_create_downloader;
+	}
+	DBGC ( prefetch, "PREFETCH %s started\n", prefetch->description );
+
+	/* Return image (which will remain referenced by the list of
+	 * background downloads until the download completes).
+	 */
+	*image = prefetch->image;
+
+ err_create_downloader:
+ err_alloc_image:
+ err_resolve_uri:
+ err_description:
+	ref_put ( &prefetch->refcnt );
+ err_alloc:
+	uri_put ( uri );
+ err_parse_uri:
+	return rc;
+}
+
+/**
+ * Wait for background image downloads to complete
+ *
+ * @v name		Image name, or NULL to wait for all images
+ * @v timeout		Download timeout
+ * @ret rc		Return status code
+ */
+int imgprefetch_wait ( const char *name, unsigned long timeout ) {
+	struct imgprefetch *prefetch;
+	int rc;
+
+	while ( 1 ) {
+
+		/* Find a matching background download, if any */
+		list_for_each_entry ( prefetch, &imgprefetches, list ) {
+			if ( ( ! name ) ||
+			     ( prefetch->image->name &&
+			       ( strcmp ( prefetch->image->name,
+					  name ) == 0 ) ) ) {
+				break;
+			}
+		}
+		if ( &prefetch->list == &imgprefetches )
+			return 0;
+		ref_get ( &prefetch->refcnt );
+
+		/* Wait for download to complete, if applicable */
+		if ( prefetch->rc == -EINPROGRESS ) {
+			intf_plug_plug ( &prefetch->monitor, &monojob );
+			rc = monojob_wait ( prefetch->description, timeout );
+		} else {
+			rc = prefetch->rc;
+			if ( rc != 0 ) {
+				printf ( "Could not download %s: %s\n",
+					 prefetch->description,
+					 strerror ( rc ) );
+			}
+		}
+
+		/* Stop tracking download */
+		imgprefetch_remove ( prefetch );
+		ref_put ( &prefetch->refcnt );
+		if ( rc != 0 )
+			return rc;
+	}
+}
+
 /**
  * Acquire an image
  *
@@ -140,6 +857,11 @@ int imgdownload_string ( const char *uri_string, unsigned long timeout,
  */
 int imgacquire ( const char *name_uri, unsigned long timeout,
 		 struct image **image ) {
+	int rc;
+
+	/* Wait for any background download of this image */
+	if ( ( rc = imgprefetch_wait ( name_uri, timeout ) ) != 0 )
+		return rc;
 
 	/* If we already have an image with the specified name, use it */
 	*image = find_image ( name_uri );
@@ -24,21 +24,92 @@
 FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <time.h>
 #include <syslog.h>
 #include <ipxe/uaccess.h>
+#include <ipxe/list.h>
 #include <ipxe/image.h>
 #include <ipxe/cms.h>
+#include <ipxe/crypto.h>
+#include <ipxe/sha256.h>
+#include <ipxe/base16.h>
 #include <ipxe/validator.h>
 #include <ipxe/monojob.h>
+#include <ipxe/trace.h>
+#include <ipxe/worker.h>
 #include <usr/imgtrust.h>
 
 /** @file
  *
  * Image trust management
  *
+ * A signed manifest lists the SHA-256 digests of any number of
+ * images, in the format produced by "sha256sum".  The manifest itself
+ * is verified once using its CMS signature, after which each listed
+ * image may be verified using only its digest.  Since the digest of
+ * each image is calculated as the image is downloaded (whenever
+ * trusted images are required), this requires no further
+ * cryptographic operations.
+ *
+ * Any listed images that were loaded without a precalculated digest
+ * have their digests calculated in parallel (using any available
+ * worker CPU cores) as soon as the manifest has been loaded.
+ *
+ */
+
+/* Disambiguate the various error causes */
+#define EINVAL_MANIFEST __einfo_error ( EINFO_EINVAL_MANIFEST )
+#define EINFO_EINVAL_MANIFEST \
+	__einfo_uniqify ( EINFO_EINVAL, 0x01, "Invalid manifest line" )
+#define ENOENT_MANIFEST __einfo_error ( EINFO_ENOENT_MANIFEST )
+#define EINFO_ENOENT_MANIFEST \
+	__einfo_uniqify ( EINFO_ENOENT, 0x01, "Image not listed in manifest" )
+#define EACCES_MANIFEST __einfo_error ( EINFO_EACCES_MANIFEST )
+#define EINFO_EACCES_MANIFEST \
+	__einfo_uniqify ( EINFO_EACCES, 0x01, "Image does not match manifest" )
+
+/** A signed manifest entry */
+struct image_manifest_entry {
+	/** List of manifest entries */
+	struct list_head list;
+	/** SHA-256 digest */
+	uint8_t digest[SHA256_DIGEST_SIZE];
+	/** Image name */
+	char name[0];
+};
+
+/** Signed manifest entries */
+static LIST_HEAD ( image_manifest );
+
+/** A pending manifest image digest calculation */
+struct image_manifest_precalc {
+	/** List of pending calculations */
+	struct list_head list;
+	/** Image */
+	struct image *image;
+	/** Digest worker job */
+	struct worker_digest wdigest;
+	/** Digest context */
+	uint8_t ctx[0];
+};
+
+/**
+ * Get digest algorithm to be used while downloading images
+ *
+ * @ret digest		Digest algorithm, or NULL to not digest images
+ *
+ * If trusted images are required, then every image must be verified
+ * before it can be executed.  Digest each image as it is downloaded,
+ * so that verification does not need to reread the whole image.
+ * SHA-256 is the default digest algorithm used when creating CMS
+ * signatures.
  */
+struct digest_algorithm * image_digest_algorithm ( void ) {
+
+	return ( image_trust_required() ? &sha256_algorithm : NULL );
+}
 
 /**
  * Verify image using downloaded signature
@@ -50,15 +121,18 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  */
 int imgverify ( struct image *image, struct image *signature,
 		const char *name ) {
+	struct cms_digest precalc;
 	struct asn1_cursor *data;
 	struct cms_signature *sig;
 	struct cms_signer_info *info;
 	time_t now;
+	unsigned int trace;
 	int next;
 	int rc;
 
 	/* Mark image as untrusted */
 	image_untrust ( image );
+	trace = trace_start ( "verify %s", image->name );
 
 	/* Get raw signature data */
 	next = image_asn1 ( signature, 0, &data );
@@ -85,8 +159,11 @@ int imgverify ( struct image *image, struct image *signature,
 
 	/* Use signature to verify image */
 	now = time ( NULL );
-	if ( ( rc = cms_verify ( sig, image->data, image->len,
-				 name, now, NULL, NULL ) ) != 0 )
+	precalc.digest = image->digest;
+	precalc.value = image->digest_value;
+	if ( ( rc = cms_verify_digested ( sig, image->data, image->len,
+					  ( image->digest ? &precalc : NULL ),
+					  name, now, NULL, NULL ) ) != 0 )
 		goto err_verify;
 
 	/* Drop reference to signature */
@@ -96,6 +173,7 @@ int imgverify ( struct image *image, struct image *signature,
 	/* Mark image as trusted */
 	image_trust ( image );
 	syslog ( LOG_NOTICE, "Image \"%s\" signature OK\n", image->name );
+	trace_stop ( trace, 0 );
 
 	return 0;
 
@@ -108,5 +186,233 @@ int imgverify ( struct image *image, struct image *signature,
  err_asn1:
 	syslog ( LOG_ERR, "Image \"%s\" signature bad: %s\n",
 		 image->name, strerror ( rc ) );
+	trace_stop ( trace, rc );
+	return rc;
+}
+
+/**
+ * Parse signed manifest line
+ *
+ * @v line		Manifest line
+ * @v len		Length of manifest line
+ * @ret rc		Return status code
+ */
+static int imgmanifest_line ( const char *line, size_t len ) {
+	struct image_manifest_entry *entry;
+	char hex[ base16_encoded_len ( SHA256_DIGEST_SIZE ) + 1 /* NUL */ ];
+	const char *name;
+	const char *sep;
+	size_t name_len;
+	int decoded;
+
+	/* Ignore blank lines and comments */
+	while ( len && ( ( line[ len - 1 ] == '\r' ) ||
+			 ( line[ len - 1 ] == ' ' ) ) ) {
+		len--;
+	}
+	if ( ( ! len ) || ( line[0] == '#' ) )
+		return 0;
+
+	/* Parse "<digest>  <name>" or "<digest> *<name>" */
+	if ( ( len < ( sizeof ( hex ) + 1 ) ) ||
+	     ( line[ sizeof ( hex ) - 1 ] != ' ' ) )
+		return -EINVAL_MANIFEST;
+	memcpy ( hex, line, ( sizeof ( hex ) - 1 ) );
+	hex[ sizeof ( hex ) - 1 ] = '\0';
+	name = &line[ sizeof ( hex ) + 1 ];
+	name_len = ( len - sizeof ( hex ) - 1 );
+
+	/* Use only the final path component of the name */
+	while ( ( sep = memchr ( name, '/', name_len ) ) ) {
+		name_len -= ( sep + 1 - name );
+		name = ( sep + 1 );
+	}
+	if ( ! name_len )
+		return -EINVAL_MANIFEST;
+
+	/* Allocate and populate entry */
+	entry = zalloc ( sizeof ( *entry ) + name_len + 1 /* NUL */ );
+	if ( ! entry )
+		return -ENOMEM;
+	decoded = base16_decode ( hex, entry->digest,
+				  sizeof ( entry->digest ) );
+	if ( decoded != ( ( int ) sizeof ( entry->digest ) ) ) {
+		free ( entry );
+		return -EINVAL_MANIFEST;
+	}
+	memcpy ( entry->name, name, name_len );
+	list_add_tail ( &entry->list, &image_manifest );
+	DBGC ( &image_manifest, "IMGMANIFEST added %s\n", entry->name );
+
+	return 0;
+}
+
+/**
+ * Find signed manifest entry
+ *
+ * @v name		Image name
+ * @ret entry		Manifest entry, or NULL if not found
+ *
+ * The most recently loaded entry takes precedence.
+ */
+static struct image_manifest_entry * imgmanifest_find ( const char *name ) {
+	struct image_manifest_entry *entry;
+
+	list_for_each_entry_reverse ( entry, &image_manifest, list ) {
+		if ( strcmp ( entry->name, name ) == 0 )
+			return entry;
+	}
+	return NULL;
+}
+
+/**
+ * Precalculate digests of all loaded images listed in manifest
+ *
+ * The digest calculations for all images are submitted at once, so
+ * that they may run concurrently on separate worker CPU cores.  A
+ * failure to precalculate a digest is not an error, since the digest
+ * will be calculated when the image is verified.
+ */
+static void imgmanifest_precalc ( void ) {
+	struct digest_algorithm *digest = &sha256_algorithm;
+	struct image_manifest_precalc *precalc;
+	struct image_manifest_precalc *tmp;
+	struct image *image;
+	LIST_HEAD ( pending );
+	int rc;
+
+	/* Submit digest calculations */
+	for_each_image ( image ) {
+
+		/* Skip images with an existing digest or no manifest entry */
+		if ( image->digest == digest )
+			continue;
+		if ( ! imgmanifest_find ( image->name ) )
+			continue;
+
+		/* Allocate and submit calculation */
+		precalc = malloc ( sizeof ( *precalc ) + digest->ctxsize );
+		if ( ! precalc )
+			break;
+		precalc->image = image_get ( image );
+		digest_init ( digest, precalc->ctx );
+		worker_digest_submit ( &precalc->wdigest, digest, precalc->ctx,
+				       user_to_virt ( image->data, 0 ),
+				       image->len );
+		list_add_tail ( &precalc->list, &pending );
+	}
+
+	/* Wait for all calculations to complete */
+	list_for_each_entry_safe ( precalc, tmp, &pending, list ) {
+		worker_digest_wait ( &precalc->wdigest );
+		image = precalc->image;
+		if ( ( rc = image_set_digest ( image, digest,
+					       precalc->ctx ) ) != 0 ) {
+			DBGC ( &image_manifest, "IMGMANIFEST could not record "
+			       "%s digest: %s\n", image->name,
+			       strerror ( rc ) );
+		}
+		list_del ( &precalc->list );
+		image_put ( image );
+		free ( precalc );
+	}
+}
+
+/**
+ * Verify and load signed manifest
+ *
+ * @v manifest		Manifest image
+ * @v signature		Image containing signature
+ * @v name		Required common name, or NULL to allow any name
+ * @ret rc		Return status code
+ */
+int imgmanifest ( struct image *manifest, struct image *signature,
+		  const char *name ) {
+	const char *data;
+	const char *line;
+	const char *eol;
+	size_t remaining;
+	size_t len;
+	int rc;
+
+	/* Verify manifest */
+	if ( ( rc = imgverify ( manifest, signature, name ) ) != 0 )
+		return rc;
+
+	/* Parse manifest */
+	data = user_to_virt ( manifest->data, 0 );
+	remaining = manifest->len;
+	for ( line = data ; remaining ; line = ( eol + 1 ) ) {
+		eol = memchr ( line, '\n', remaining );
+		len = ( eol ? ( ( size_t ) ( eol - line ) ) : remaining );
+		if ( ( rc = imgmanifest_line ( line, len ) ) != 0 ) {
+			syslog ( LOG_ERR, "Manifest \"%s\" line %.*s bad: %s\n",
+				 manifest->name, ( ( int ) len ), line,
+				 strerror ( rc ) );
+			return rc;
+		}
+		if ( ! eol )
+			break;
+		remaining -= ( len + 1 );
+	}
+
+	/* Precalculate digests of any listed images */
+	imgmanifest_precalc();
+
+	return 0;
+}
+
+/**
+ * Verify image using signed manifest
+ *
+ * @v image		Image to verify
+ * @ret rc		Return status code
+ */
+int imgverify_manifest ( struct image *image ) {
+	struct digest_algorithm *digest = &sha256_algorithm;
+	struct image_manifest_entry *entry;
+	uint8_t ctx[ digest->ctxsize ];
+	uint8_t out[ digest->digestsize ];
+	const void *value;
+	int rc;
+
+	/* Mark image as untrusted */
+	image_untrust ( image );
+
+	/* Find manifest entry for this image */
+	entry = imgmanifest_find ( image->name );
+	if ( ! entry ) {
+		rc = -ENOENT_MANIFEST;
+		goto err_find;
+	}
+
+	/* Use precalculated digest, if available */
+	if ( image->digest == digest ) {
+		value = image->digest_value;
+	} else {
+		digest_init ( digest, ctx );
+		worker_digest ( digest, ctx, user_to_virt ( image->data, 0 ),
+				image->len );
+		digest_final ( digest, ctx, out );
+		value = out;
+	}
+
+	/* Compare digests */
+	if ( memcmp ( value, entry->digest, sizeof ( entry->digest ) ) != 0 ) {
+		rc = -EACCES_MANIFEST;
+		goto err_digest;
+	}
+
+	/* Mark image as trusted */
+	image_trust ( image );
+	syslog ( LOG_NOTICE, "Image \"%s\" manifest digest OK\n",
+		 image->name );
+
+	return 0;
+
+ err_digest:
+ err_find:
+	syslog ( LOG_ERR, "Image \"%s\" manifest digest bad: %s\n",
+		 image->name, strerror ( rc ) );
 	return rc;
 }
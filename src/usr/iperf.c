@@ -0,0 +1,473 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <byteswap.h>
+#include <ipxe/refcnt.h>
+#include <ipxe/interface.h>
+#include <ipxe/xfer.h>
+#include <ipxe/open.h>
+#include <ipxe/process.h>
+#include <ipxe/monojob.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/socket.h>
+#include <ipxe/tcpip.h>
+#include <ipxe/tcp.h>
+#include <ipxe/timer.h>
+#include <ipxe/profile.h>
+#include <usr/iperf.h>
+
+/** @file
+ *
+ * TCP throughput testing
+ *
+ * This implements the data transfer used by an iperf (version 2) TCP
+ * test.  The client connects to the server and sends a stream of
+ * zero-filled buffers for a fixed duration; the server simply
+ * discards everything it receives.  A leading all-zeroes buffer is
+ * treated by an iperf server as a plain test with no options, so no
+ * further protocol is required.
+ *
+ */
+
+/** An iperf test */
+struct iperf {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** Job control interface */
+	struct interface job;
+	/** Data transfer interface */
+	struct interface xfer;
+	/** Process */
+	struct process process;
+	/** TCP listener (server only) */
+	struct tcp_listener listener;
+	/** TCP listener is active */
+	int listening;
+
+	/** Port number */
+	unsigned int port;
+	/** Buffer length (client only) */
+	size_t len;
+	/** Test duration (client only) */
+	unsigned long duration;
+
+	/** Data transfer has started */
+	int running;
+	/** Start time */
+	unsigned long started;
+	/** Time of most recent interval report */
+	unsigned long reported;
+	/** Total number of bytes transferred */
+	unsigned long long bytes;
+	/** Total number of bytes transferred at most recent report */
+	unsigned long long reported_bytes;
+
+	/** Most recent profiling timestamp */
+	unsigned long timestamp;
+	/** Elapsed profiling timestamp cycles */
+	unsigned long long cycles;
+	/** Profiling timestamp cycles spent in the transmit path */
+	unsigned long long busy;
+};
+
+/**
+ * Display throughput for an interval
+ *
+ * @v from		Start of interval (in ticks since start of test)
+ * @v to		End of interval (in ticks since start of test)
+ * @v bytes		Number of bytes transferred within interval
+ */
+static void iperf_report ( unsigned long from, unsigned long to,
+			   unsigned long long bytes ) {
+	unsigned long long kbps;
+	unsigned long ticks = ( to - from );
+
+	/* Calculate throughput in kbit/s */
+	kbps = ( ticks ? ( ( bytes * 8 * TICKS_PER_SEC ) / ( ticks * 1000 ) )
+		 : 0 );
+
+	printf ( "[%3ld.%ld-%3ld.%ld sec] %8lld KBytes %5lld.%lld Mbits/sec\n",
+		 ( from / TICKS_PER_SEC ),
+		 ( ( ( from % TICKS_PER_SEC ) * 10 ) / TICKS_PER_SEC ),
+		 ( to / TICKS_PER_SEC ),
+		 ( ( ( to % TICKS_PER_SEC ) * 10 ) / TICKS_PER_SEC ),
+		 ( bytes / 1024 ), ( kbps / 1000 ), ( ( kbps % 1000 ) / 100 ) );
+}
+
+/**
+ * Count TCP retransmissions to test peer
+ *
+ * @v iperf		iperf test
+ * @ret retransmits	Number of retransmission events
+ *
+ * The data transfer interface does not identify the underlying TCP
+ * connection, so we count all connections to the test port.
+ */
+static unsigned long iperf_retransmits ( struct iperf *iperf ) {
+	struct tcp_statistics stats;
+	unsigned long retransmits = 0;
+	unsigned int i;
+
+	for ( i = 0 ; tcp_statistics ( i, &stats ) == 0 ; i++ ) {
+		if ( ntohs ( stats.peer.st_port ) == iperf->port )
+			retransmits += stats.retransmits;
+	}
+	return retransmits;
+}
+
+/**
+ * Close iperf test
+ *
+ * @v iperf		iperf test
+ * @v rc		Reason for close
+ */
+static void iperf_close ( struct iperf *iperf, int rc ) {
+
+	/* Stop listening, if applicable */
+	if ( iperf->listening ) {
+		tcp_unlisten ( &iperf->listener );
+		iperf->listening = 0;
+	}
+
+	/* Stop process */
+	process_del ( &iperf->process );
+
+	/* Shut down interfaces */
+	intf_shutdown ( &iperf->xfer, rc );
+	intf_shutdown ( &iperf->job, rc );
+}
+
+/**
+ * Finish iperf test
+ *
+ * @v iperf		iperf test
+ * @v rc		Reason for finishing
+ */
+static void iperf_finish ( struct iperf *iperf, int rc ) {
+	unsigned long elapsed = ( currticks() - iperf->started );
+	unsigned int busy;
+
+	/* Display summary, if applicable */
+	if ( iperf->running ) {
+		printf ( "- - - - - - - - - - - - - - - - - - - - - - - - -\n" );
+		iperf_report ( 0, elapsed, iperf->bytes );
+		if ( iperf->duration ) {
+			busy = ( iperf->cycles ?
+				 ( ( 100 * iperf->busy ) / iperf->cycles ) : 0 );
+			printf ( "Retransmits: %ld, CPU busy in transmit path: "
+				 "%d%%\n", iperf_retransmits ( iperf ), busy );
+		}
+		iperf->running = 0;
+	}
+
+	/* Close test */
+	iperf_close ( iperf, rc );
+}
+
+/**
+ * Send test data
+ *
+ * @v iperf		iperf test
+ * @ret rc		Return status code
+ */
+static int iperf_send ( struct iperf *iperf ) {
+	struct io_buffer *iobuf;
+	unsigned long start;
+	size_t window;
+	size_t len;
+	int rc;
+
+	/* Fill the available transmit window */
+	while ( ( window = xfer_window ( &iperf->xfer ) ) ) {
+
+		/* Allocate and fill buffer */
+		len = iperf->len;
+		if ( len > window )
+			len = window;
+		start = profile_timestamp();
+		iobuf = xfer_alloc_iob ( &iperf->xfer, len );
+		if ( ! iobuf )
+			return 0; /* Retry next time */
+		memset ( iob_put ( iobuf, len ), 0, len );
+
+		/* Send buffer */
+		rc = xfer_deliver_iob ( &iperf->xfer, iobuf );
+		iperf->busy += ( profile_timestamp() - start );
+		if ( rc != 0 )
+			return rc;
+		iperf->bytes += len;
+	}
+
+	return 0;
+}
+
+/**
+ * Run iperf test
+ *
+ * @v iperf		iperf test
+ */
+static void iperf_step ( struct iperf *iperf ) {
+	unsigned long now = currticks();
+	unsigned long timestamp;
+	int rc;
+
+	/* Client starts once the connection is established */
+	if ( ( ! iperf->running ) && iperf->duration &&
+	     xfer_window ( &iperf->xfer ) ) {
+		printf ( "Connected to port %d, sending for %ld seconds\n",
+			 iperf->port, ( iperf->duration / TICKS_PER_SEC ) );
+		iperf->running = 1;
+		iperf->started = iperf->reported = now;
+		iperf->timestamp = profile_timestamp();
+	}
+	if ( ! iperf->running )
+		return;
+
+	/* Accumulate elapsed cycles (in short steps, to avoid
+	 * overflowing a 32-bit timestamp counter).
+	 */
+	timestamp = profile_timestamp();
+	iperf->cycles += ( timestamp - iperf->timestamp );
+	iperf->timestamp = timestamp;
+
+	/* Report each interval */
+	if ( ( now - iperf->reported ) >= TICKS_PER_SEC ) {
+		iperf_report ( ( iperf->reported - iperf->started ),
+			       ( now - iperf->started ),
+			       ( iperf->bytes - iperf->reported_bytes ) );
+		iperf->reported = now;
+		iperf->reported_bytes = iperf->bytes;
+	}
+
+	/* Server has nothing further to do */
+	if ( ! iperf->duration )
+		return;
+
+	/* Finish when test duration has elapsed */
+	if ( ( now - iperf->started ) >= iperf->duration ) {
+		iperf_finish ( iperf, 0 );
+		return;
+	}
+
+	/* Send test data */
+	if ( ( rc = iperf_send ( iperf ) ) != 0 ) {
+		printf ( "Could not send: %s\n", strerror ( rc ) );
+		iperf_finish ( iperf, rc );
+		return;
+	}
+}
+
+/**
+ * Receive test data
+ *
+ * @v iperf		iperf test
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int iperf_deliver ( struct iperf *iperf, struct io_buffer *iobuf,
+			   struct xfer_metadata *meta __unused ) {
+
+	iperf->bytes += iob_len ( iobuf );
+	free_iob ( iobuf );
+	return 0;
+}
+
+/** iperf data transfer interface operations */
+static struct interface_operation iperf_xfer_op[] = {
+	INTF_OP ( xfer_deliver, struct iperf *, iperf_deliver ),
+	INTF_OP ( intf_close, struct iperf *, iperf_finish ),
+};
+
+/** iperf data transfer interface descriptor */
+static struct interface_descriptor iperf_xfer_desc =
+	INTF_DESC ( struct iperf, xfer, iperf_xfer_op );
+
+/** iperf job control interface operations */
+static struct interface_operation iperf_job_op[] = {
+	INTF_OP ( intf_close, struct iperf *, iperf_close ),
+};
+
+/** iperf job control interface descriptor */
+static struct interface_descriptor iperf_job_desc =
+	INTF_DESC ( struct iperf, job, iperf_job_op );
+
+/** iperf process descriptor */
+static struct process_descriptor iperf_process_desc =
+	PROC_DESC ( struct iperf, process, iperf_step );
+
+/**
+ * Accept incoming test connection
+ *
+ * @v listener		TCP listener
+ * @v xfer		Data transfer interface
+ * @v peer		Remote socket address
+ * @ret rc		Return status code
+ */
+static int iperf_accept ( struct tcp_listener *listener,
+			  struct interface *xfer,
+			  struct sockaddr_tcpip *peer ) {
+	struct iperf *iperf =
+		container_of ( listener, struct iperf, listener );
+
+	/* Accept only a single connection */
+	if ( iperf->running )
+		return -EBUSY;
+	printf ( "Accepted connection from %s port %d\n",
+		 sock_ntoa ( ( struct sockaddr * ) peer ),
+		 ntohs ( peer->st_port ) );
+
+	/* Start test */
+	intf_plug_plug ( &iperf->xfer, xfer );
+	iperf->running = 1;
+	iperf->started = iperf->reported = currticks();
+	iperf->timestamp = profile_timestamp();
+
+	return 0;
+}
+
+/**
+ * Create iperf test
+ *
+ * @v port		Port number
+ * @ret iperf		iperf test, or NULL on error
+ */
+static struct iperf * iperf_create ( unsigned int port ) {
+	struct iperf *iperf;
+
+	/* Allocate and initialise structure */
+	iperf = zalloc ( sizeof ( *iperf ) );
+	if ( ! iperf )
+		return NULL;
+	ref_init ( &iperf->refcnt, NULL );
+	intf_init ( &iperf->job, &iperf_job_desc, &iperf->refcnt );
+	intf_init ( &iperf->xfer, &iperf_xfer_desc, &iperf->refcnt );
+	process_init ( &iperf->process, &iperf_process_desc, &iperf->refcnt );
+	iperf->port = port;
+
+	return iperf;
+}
+
+/**
+ * Run iperf test
+ *
+ * @v iperf		iperf test
+ * @ret rc		Return status code
+ */
+static int iperf_run ( struct iperf *iperf ) {
+	int rc;
+
+	/* Attach to parent interface and mortalise self */
+	intf_plug_plug ( &iperf->job, &monojob );
+	ref_put ( &iperf->refcnt );
+
+	/* Wait for test to complete */
+	if ( ( rc = monojob_wait ( NULL, 0 ) ) != 0 ) {
+		printf ( "Finished: %s\n", strerror ( rc ) );
+		return rc;
+	}
+
+	return 0;
+}
+
+/**
+ * Run iperf client
+ *
+ * @v hostname		Server hostname
+ * @v port		Server port
+ * @v duration		Test duration (in ticks)
+ * @v len		Buffer length
+ * @ret rc		Return status code
+ */
+int iperf_client ( const char *hostname, unsigned int port,
+		   unsigned long duration, size_t len ) {
+	struct sockaddr_tcpip peer;
+	struct iperf *iperf;
+	int rc;
+
+	/* Sanity check */
+	if ( ! ( duration && len ) )
+		return -EINVAL;
+
+	/* Create test */
+	iperf = iperf_create ( port );
+	if ( ! iperf )
+		return -ENOMEM;
+	iperf->duration = duration;
+	iperf->len = len;
+
+	/* Open connection */
+	memset ( &peer, 0, sizeof ( peer ) );
+	peer.st_port = htons ( port );
+	if ( ( rc = xfer_open_named_socket ( &iperf->xfer, SOCK_STREAM,
+					     ( struct sockaddr * ) &peer,
+					     hostname, NULL ) ) != 0 ) {
+		printf ( "Could not connect to %s: %s\n",
+			 hostname, strerror ( rc ) );
+		iperf_close ( iperf, rc );
+		ref_put ( &iperf->refcnt );
+		return rc;
+	}
+
+	return iperf_run ( iperf );
+}
+
+/**
+ * Run iperf server
+ *
+ * @v port		Listening port
+ * @ret rc		Return status code
+ *
+ * The server handles a single test connection.
+ */
+int iperf_server ( unsigned int port ) {
+	struct iperf *iperf;
+	int rc;
+
+	/* Create test */
+	iperf = iperf_create ( port );
+	if ( ! iperf )
+		return -ENOMEM;
+
+	/* Start listening */
+	iperf->listener.port = port;
+	iperf->listener.accept = iperf_accept;
+	if ( ( rc = tcp_listen ( &iperf->listener ) ) != 0 ) {
+		printf ( "Could not listen on port %d: %s\n",
+			 port, strerror ( rc ) );
+		iperf_close ( iperf, rc );
+		ref_put ( &iperf->refcnt );
+		return rc;
+	}
+	iperf->listening = 1;
+	printf ( "Listening on TCP port %d\n", port );
+
+	return iperf_run ( iperf );
+}
@@ -24,7 +24,10 @@
 FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 #include <stdio.h>
+#include <byteswap.h>
 #include <ipxe/ipstat.h>
+#include <ipxe/socket.h>
+#include <ipxe/tcp.h>
 #include <usr/ipstat.h>
 
 /** @file
@@ -40,6 +43,8 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 void ipstat ( void ) {
 	struct ip_statistics_family *family;
 	struct ip_statistics *stats;
+	struct tcp_statistics tcp;
+	unsigned int i;
 
 	for_each_table_entry ( family, IP_STATISTICS_FAMILIES ) {
 		stats = family->stats;
@@ -55,6 +60,9 @@ void ipstat ( void ) {
 		printf ( "  ReasmReqds:%ld ReasmOKs:%ld ReasmFails:%ld\n",
 			 stats->reasm_reqds, stats->reasm_oks,
 			 stats->reasm_fails );
+		printf ( "  ReasmReorders:%ld ReasmDuplicates:%ld "
+			 "ReasmEvictions:%ld\n", stats->reasm_reorders,
+			 stats->reasm_duplicates, stats->reasm_evictions );
 		printf ( "  InDelivers:%ld OutRequests:%ld OutNoRoutes:%ld\n",
 			 stats->in_delivers, stats->out_requests,
 			 stats->out_no_routes );
@@ -63,4 +71,22 @@ void ipstat ( void ) {
 			 stats->out_mcast_pkts, stats->out_bcast_pkts,
 			 stats->out_octets );
 	}
+
+	for ( i = 0 ; tcp_statistics ( i, &tcp ) == 0 ; i++ ) {
+		printf ( "TCP port %d to %s:%d %s:\n", tcp.local_port,
+			 sock_ntoa ( ( struct sockaddr * ) &tcp.peer ),
+			 ntohs ( tcp.peer.st_port ), tcp.state );
+		printf ( "  InOctets:%ld OutOctets:%ld\n",
+			 tcp.in_octets, tcp.out_octets );
+		printf ( "  RcvWin:%d RcvWinMax:%d SndWin:%d RTT:%ldms "
+			 "RTO:%ldms\n", tcp.rcv_win, tcp.rcv_win_max,
+			 tcp.snd_win, tcp.rtt, tcp.rto );
+		printf ( "  Cwnd:%d Ssthresh:%d MSS:%zd (%s)\n",
+			 tcp.cwnd, tcp.ssthresh, tcp.mss, tcp.congestion );
+		printf ( "  Retransmits:%ld Timeouts:%ld Probes:%ld "
+			 "OutOfOrderMax:%d\n", tcp.retransmits, tcp.timeouts,
+			 tcp.probes, tcp.rcv_ooo_max );
+		printf ( "  RcvZeroWin:%ld SndZeroWin:%ld\n",
+			 tcp.rcv_zero_win, tcp.snd_zero_win );
+	}
 }
@@ -24,6 +24,8 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <string.h>
 #include <errno.h>
 #include <ipxe/resolv.h>
+#include <ipxe/timer.h>
+#include <ipxe/dns.h>
 #include <ipxe/tcpip.h>
 #include <ipxe/monojob.h>
 #include <ipxe/settings.h>
@@ -201,3 +203,30 @@ int nslookup ( const char *name, const char *setting_name ) {
 
 	return 0;
 }
+
+/**
+ * Show DNS cache
+ *
+ */
+void nslookup_cache ( void ) {
+	struct dns_cache_entry *entry;
+	unsigned long now = currticks();
+	unsigned long remaining;
+
+	/* Discard any expired entries */
+	dns_cache_expire();
+
+	/* Show each entry in turn */
+	list_for_each_entry ( entry, &dns_cache, list ) {
+		remaining = ( ( entry->expiry - now ) / TICKS_PER_SEC );
+		printf ( "%s %s ", entry->name,
+			 ( ( entry->qtype == htons ( DNS_TYPE_AAAA ) ) ?
+			   "AAAA" : "A" ) );
+		if ( entry->rc == 0 ) {
+			printf ( "%s", sock_ntoa ( &entry->address.sa ) );
+		} else {
+			printf ( "(%s)", strerror ( entry->rc ) );
+		}
+		printf ( " expires in %lds\n", remaining );
+	}
+}
@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <ipxe/refcnt.h>
+#include <ipxe/interface.h>
+#include <ipxe/xfer.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/uri.h>
+#include <ipxe/http.h>
+#include <ipxe/image.h>
+#include <ipxe/umalloc.h>
+#include <ipxe/monojob.h>
+#include <ipxe/pcap.h>
+#include <usr/pcapmgmt.h>
+
+/** @file
+ *
+ * Packet capture management
+ *
+ */
+
+/** A packet capture upload */
+struct pcap_upload {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** Job control interface */
+	struct interface job;
+	/** Data transfer interface */
+	struct interface xfer;
+};
+
+/**
+ * Show packet capture status
+ *
+ */
+void pcap_show ( void ) {
+	struct pcap_statistics stats;
+
+	pcap_statistics ( &stats );
+	if ( ! stats.count ) {
+		printf ( "No packet capture\n" );
+		return;
+	}
+	printf ( "Packet capture %s: %d of %d packets retained (%d "
+		 "overwritten), up to %zd bytes each\n",
+		 ( stats.running ? "running" : "stopped" ), stats.retained,
+		 stats.count, stats.dropped, stats.snaplen );
+}
+
+/**
+ * Create image containing captured packets
+ *
+ * @ret image		Image, or NULL on error
+ */
+static struct image * pcap_create_image ( void ) {
+	struct image *image;
+	size_t len;
+
+	/* Allocate image */
+	image = alloc_image ( NULL );
+	if ( ! image )
+		goto err_alloc_image;
+
+	/* Export captured packets */
+	len = pcap_export ( UNULL, 0 );
+	image->data = umalloc ( len );
+	if ( ! image->data )
+		goto err_alloc_data;
+	image->len = pcap_export ( image->data, len );
+	assert ( image->len == len );
+
+	return image;
+
+ err_alloc_data:
+	image_put ( image );
+ err_alloc_image:
+	return NULL;
+}
+
+/**
+ * Save captured packets as an image
+ *
+ * @v name		Image name
+ * @ret rc		Return status code
+ *
+ * The image may be subsequently accessed by a booted operating
+ * system (e.g. as a file within the EFI virtual filesystem).
+ */
+int pcap_save ( const char *name ) {
+	struct image *image;
+	int rc;
+
+	/* Create image */
+	image = pcap_create_image();
+	if ( ! image ) {
+		rc = -ENOMEM;
+		goto err_create;
+	}
+
+	/* Set name */
+	if ( ( rc = image_set_name ( image, name ) ) != 0 )
+		goto err_set_name;
+
+	/* Register image */
+	if ( ( rc = register_image ( image ) ) != 0 )
+		goto err_register;
+
+ err_register:
+ err_set_name:
+	image_put ( image );
+ err_create:
+	return rc;
+}
+
+/**
+ * Discard HTTP response
+ *
+ * @v upload		Packet capture upload
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int pcap_upload_deliver ( struct pcap_upload *upload __unused,
+				 struct io_buffer *iobuf,
+				 struct xfer_metadata *meta __unused ) {
+
+	free_iob ( iobuf );
+	return 0;
+}
+
+/**
+ * Close packet capture upload
+ *
+ * @v upload		Packet capture upload
+ * @v rc		Reason for close
+ */
+static void pcap_upload_close ( struct pcap_upload *upload, int rc ) {
+
+	intf_shutdown ( &upload->xfer, rc );
+	intf_shutdown ( &upload->job, rc );
+}
+
+/** Packet capture upload data transfer interface operations */
+static struct interface_operation pcap_upload_xfer_op[] = {
+	INTF_OP ( xfer_deliver, struct pcap_upload *, pcap_upload_deliver ),
+	INTF_OP ( intf_close, struct pcap_upload *, pcap_upload_close ),
+};
+
+/** Packet capture upload data transfer interface descriptor */
+static struct interface_descriptor pcap_upload_xfer_desc =
+	INTF_DESC ( struct pcap_upload, xfer, pcap_upload_xfer_op );
+
+/** Packet capture upload job control interface operations */
+static struct interface_operation pcap_upload_job_op[] = {
+	INTF_OP ( intf_close, struct pcap_upload *, pcap_upload_close ),
+};
+
+/** Packet capture upload job control interface descriptor */
+static struct interface_descriptor pcap_upload_job_desc =
+	INTF_DESC ( struct pcap_upload, job, pcap_upload_job_op );
+
+/**
+ * Submit captured packets via HTTP POST
+ *
+ * @v uri_string	URI string
+ * @v timeout		Timeout
+ * @ret rc		Return status code
+ *
+ * The captured packets are submitted in pcapng format as the body of
+ * an HTTP POST request, and any response is discarded.
+ */
+int pcap_post ( const char *uri_string, unsigned long timeout ) {
+	struct http_request_content content;
+	struct pcap_upload *upload;
+	struct image *image;
+	struct uri *uri;
+	int rc;
+
+	/* Parse URI */
+	uri = parse_uri ( uri_string );
+	if ( ! uri ) {
+		rc = -ENOMEM;
+		goto err_parse_uri;
+	}
+
+	/* Create image */
+	image = pcap_create_image();
+	if ( ! image ) {
+		rc = -ENOMEM;
+		goto err_create_image;
+	}
+
+	/* Allocate and initialise structure */
+	upload = zalloc ( sizeof ( *upload ) );
+	if ( ! upload ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	ref_init ( &upload->refcnt, NULL );
+	intf_init ( &upload->job, &pcap_upload_job_desc, &upload->refcnt );
+	intf_init ( &upload->xfer, &pcap_upload_xfer_desc, &upload->refcnt );
+
+	/* Open HTTP transaction */
+	content.type = "application/x-pcapng";
+	content.data = user_to_virt ( image->data, 0 );
+	content.len = image->len;
+	if ( ( rc = http_open ( &upload->xfer, &http_post, uri, NULL,
+				&content ) ) != 0 ) {
+		printf ( "Could not start upload: %s\n", strerror ( rc ) );
+		goto err_open;
+	}
+
+	/* Attach to parent interface */
+	intf_plug_plug ( &upload->job, &monojob );
+
+	/* Wait for upload to complete */
+	if ( ( rc = monojob_wait ( uri_string, timeout ) ) != 0 )
+		goto err_wait;
+
+ err_wait:
+ err_open:
+	ref_put ( &upload->refcnt );
+ err_alloc:
+	image_put ( image );
+ err_create_image:
+	uri_put ( uri );
+ err_parse_uri:
+	return rc;
+}
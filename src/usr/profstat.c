@@ -24,7 +24,12 @@
 FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
 
 #include <stdio.h>
+#include <syslog.h>
+#include <ipxe/vsprintf.h>
 #include <ipxe/profile.h>
+#include <ipxe/process.h>
+#include <ipxe/retry.h>
+#include <ipxe/timer.h>
 #include <usr/profstat.h>
 
 /** @file
@@ -33,16 +38,159 @@ FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
  *
  */
 
+/** Number of microseconds over which to measure timestamp rate */
+#define PROFSTAT_RATE_US 10000
+
+/**
+ * Measure profiling timestamp rate
+ *
+ * @ret rate		Timestamp increments per microsecond
+ *
+ * The profiling timestamp is an architecture-specific counter (such
+ * as the x86 TSC, or the AArch64 virtual counter), and so does not
+ * have a fixed rate.
+ */
+static unsigned long profstat_rate ( void ) {
+	unsigned long start;
+
+	start = profile_timestamp();
+	udelay ( PROFSTAT_RATE_US );
+	return ( ( profile_timestamp() - start ) / PROFSTAT_RATE_US );
+}
+
 /**
  * Print profiling statistics
  *
  */
 void profstat ( void ) {
 	struct profiler *profiler;
+	struct process_descriptor *desc;
 
+	printf ( "Timestamps: %ld ticks per us\n", profstat_rate() );
+	printf ( "Retry timers: %d running\n", retry_running );
 	for_each_table_entry ( profiler, PROFILERS ) {
 		printf ( "%s: %ld +/- %ld ticks (%d samples)\n",
 			 profiler->name, profile_mean ( profiler ),
 			 profile_stddev ( profiler ), profiler->count );
 	}
+	list_for_each_entry ( desc, &process_stats, stats ) {
+		printf ( "%s(): %ld ticks (%ld steps, maximum %ld ticks)\n",
+			 desc->name, desc->ticks, desc->steps, desc->max );
+	}
+}
+
+/**
+ * Print profiling histograms
+ *
+ */
+void profstat_histogram ( void ) {
+	struct profiler *profiler;
+	unsigned long min;
+	unsigned int i;
+
+	for_each_table_entry ( profiler, PROFILERS ) {
+
+		/* Skip unused profilers */
+		if ( ! profiler->count )
+			continue;
+
+		/* Print non-empty buckets */
+		printf ( "%s:\n", profiler->name );
+		for ( i = 0 ; i < PROFILE_HISTOGRAM_BUCKETS ; i++ ) {
+			if ( ! profiler->histogram[i] )
+				continue;
+			min = ( i ? ( 1UL << ( i - 1 ) ) : 0 );
+			if ( i == ( PROFILE_HISTOGRAM_BUCKETS - 1 ) ) {
+				printf ( "  %10ld+       : %d\n",
+					 min, profiler->histogram[i] );
+			} else {
+				printf ( "  %10ld-%-10ld: %d\n", min,
+					 ( i ? ( ( min << 1 ) - 1 ) : 0 ),
+					 profiler->histogram[i] );
+			}
+		}
+	}
+}
+
+/**
+ * Record profiling statistics to system log
+ *
+ * Statistics are written to all consoles used for logging (e.g. a
+ * syslog or syslogs console), allowing them to be collected
+ * remotely.  Each profiler is recorded as a single line of the form
+ *
+ *   profstat <name> <count> <mean> <stddev> <bucket>:<count>...
+ *
+ * where each bucket is identified by its index within the histogram.
+ * Only non-empty buckets are recorded.  Each process is recorded as a
+ * single line of the form
+ *
+ *   profstat process <name> <steps> <ticks> <maximum>
+ *
+ * the number of running retry timers is recorded as
+ *
+ *   profstat timers <running>
+ *
+ * and the timestamp rate (in ticks per microsecond) is recorded as
+ *
+ *   profstat rate <rate>
+ */
+void profstat_log ( void ) {
+	struct profiler *profiler;
+	struct process_descriptor *desc;
+	char buf[ PROFILE_HISTOGRAM_BUCKETS * 14 /* " NN:NNNNNNNNNN" */ + 1 ];
+	size_t used;
+	unsigned int i;
+
+	for_each_table_entry ( profiler, PROFILERS ) {
+
+		/* Skip unused profilers */
+		if ( ! profiler->count )
+			continue;
+
+		/* Construct histogram description */
+		buf[0] = '\0';
+		used = 0;
+		for ( i = 0 ; i < PROFILE_HISTOGRAM_BUCKETS ; i++ ) {
+			if ( ! profiler->histogram[i] )
+				continue;
+			used += ssnprintf ( ( buf + used ),
+					    ( sizeof ( buf ) - used ),
+					    " %d:%d", i,
+					    profiler->histogram[i] );
+		}
+
+		/* Record statistics.  Use log_printf() directly, since
+		 * this is an explicit request that should not be
+		 * filtered by the compile-time LOG_LEVEL.
+		 */
+		log_printf ( "profstat %s %d %ld %ld%s\n",
+			     profiler->name, profiler->count,
+			     profile_mean ( profiler ),
+			     profile_stddev ( profiler ), buf );
+	}
+
+	/* Record process statistics */
+	list_for_each_entry ( desc, &process_stats, stats ) {
+		log_printf ( "profstat process %s %ld %ld %ld\n", desc->name,
+			     desc->steps, desc->ticks, desc->max );
+	}
+
+	/* Record retry timer statistics */
+	log_printf ( "profstat timers %d\n", retry_running );
+
+	/* Record timestamp rate */
+	log_printf ( "profstat rate %ld\n", profstat_rate() );
+}
+
+/**
+ * Reset profiling statistics
+ *
+ */
+void profstat_reset ( void ) {
+	struct profiler *profiler;
+
+	for_each_table_entry ( profiler, PROFILERS )
+		profile_reset ( profiler );
+	process_stats_reset();
 }
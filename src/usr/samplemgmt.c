@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <ipxe/sampler.h>
+#include <ipxe/vsprintf.h>
+#include <ipxe/params.h>
+#include <ipxe/uri.h>
+#include <ipxe/image.h>
+#include <usr/imgmgmt.h>
+#include <usr/samplemgmt.h>
+
+/** @file
+ *
+ * Sampling profiler management
+ *
+ */
+
+/** Number of most frequently sampled offsets to show */
+#define SAMPLER_SHOW_MAX 32
+
+/**
+ * Show sampling profiler results
+ *
+ */
+void sampler_show ( void ) {
+	struct sampler_statistics stats;
+	struct sampler_bucket *buckets;
+	unsigned int count;
+	unsigned int i;
+
+	/* Get statistics */
+	sampler_statistics ( &stats );
+	printf ( "Samples: %d total, %d external, %d lost\n",
+		 stats.total, stats.external, stats.lost );
+	if ( ! stats.total )
+		return;
+
+	/* Get most frequently sampled offsets */
+	buckets = malloc ( SAMPLER_SHOW_MAX * sizeof ( buckets[0] ) );
+	if ( ! buckets )
+		return;
+	count = sampler_sort ( buckets, SAMPLER_SHOW_MAX );
+
+	/* Show offsets */
+	printf ( "Offsets within %s:\n", stats.section );
+	for ( i = 0 ; i < count ; i++ ) {
+		printf ( "  %#08lx %8d %3d%%\n", buckets[i].offset,
+			 buckets[i].count,
+			 ( ( buckets[i].count * 100 ) / stats.total ) );
+	}
+
+	free ( buckets );
+}
+
+/**
+ * Describe sampling profiler results
+ *
+ * @v buckets		Histogram buckets
+ * @v count		Number of buckets
+ * @v buf		Buffer to fill in
+ * @v size		Size of buffer
+ * @ret len		Length of description
+ *
+ * Each offset is described as a single line of the form
+ *
+ *   <offset> <count>
+ *
+ * where the offset is in hexadecimal.
+ */
+static size_t sampler_describe ( struct sampler_bucket *buckets,
+				 unsigned int count, char *buf, ssize_t size ) {
+	size_t len = 0;
+	unsigned int i;
+
+	for ( i = 0 ; i < count ; i++ ) {
+		len += ssnprintf ( ( buf + len ), ( size - len ), "%#lx %d\n",
+				   buckets[i].offset, buckets[i].count );
+	}
+	return len;
+}
+
+/**
+ * Submit sampling profiler results via HTTP POST
+ *
+ * @v uri_string	URI string
+ * @v timeout		Timeout
+ * @ret rc		Return status code
+ *
+ * The results are submitted as a form parameter named "samples",
+ * containing one line per sampled offset as described by
+ * sampler_describe().  The section name and the number of external
+ * samples are submitted as form parameters named "section" and
+ * "external".
+ */
+int sampler_post ( const char *uri_string, unsigned long timeout ) {
+	struct sampler_statistics stats;
+	struct sampler_bucket *buckets;
+	struct parameters *params;
+	struct image *image;
+	struct uri *uri;
+	char external[16];
+	unsigned int count;
+	size_t size;
+	char *buf;
+	int rc;
+
+	/* Get all sampled offsets */
+	sampler_statistics ( &stats );
+	buckets = malloc ( SAMPLER_BUCKETS * sizeof ( buckets[0] ) );
+	if ( ! buckets ) {
+		rc = -ENOMEM;
+		goto err_alloc_buckets;
+	}
+	count = sampler_sort ( buckets, SAMPLER_BUCKETS );
+	snprintf ( external, sizeof ( external ), "%d", stats.external );
+
+	/* Describe offsets */
+	size = ( sampler_describe ( buckets, count, NULL, 0 ) + 1 /* NUL */ );
+	buf = malloc ( size );
+	if ( ! buf ) {
+		rc = -ENOMEM;
+		goto err_alloc_buf;
+	}
+	buf[0] = '\0';
+	sampler_describe ( buckets, count, buf, size );
+
+	/* Construct parameter list */
+	params = create_parameters ( NULL );
+	if ( ! params ) {
+		rc = -ENOMEM;
+		goto err_create_parameters;
+	}
+	claim_parameters ( params );
+	if ( ! ( add_parameter ( params, "section",
+				 ( stats.section ? stats.section : "" ) ) &&
+		 add_parameter ( params, "external", external ) &&
+		 add_parameter ( params, "samples", buf ) ) ) {
+		rc = -ENOMEM;
+		goto err_add_parameter;
+	}
+
+	/* Parse URI */
+	uri = parse_uri ( uri_string );
+	if ( ! uri ) {
+		rc = -ENOMEM;
+		goto err_parse_uri;
+	}
+	params_put ( uri->params );
+	uri->params = params_get ( params );
+
+	/* Submit results, and discard any response */
+	if ( ( rc = imgdownload ( uri, timeout, &image ) ) != 0 )
+		goto err_download;
+	unregister_image ( image );
+
+ err_download:
+	uri_put ( uri );
+ err_parse_uri:
+ err_add_parameter:
+	params_put ( params );
+ err_create_parameters:
+	free ( buf );
+ err_alloc_buf:
+	free ( buckets );
+ err_alloc_buckets:
+	return rc;
+}
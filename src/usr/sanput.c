@@ -0,0 +1,379 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <ipxe/refcnt.h>
+#include <ipxe/interface.h>
+#include <ipxe/xfer.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/process.h>
+#include <ipxe/job.h>
+#include <ipxe/monojob.h>
+#include <ipxe/uri.h>
+#include <ipxe/uaccess.h>
+#include <ipxe/sanboot.h>
+#include <ipxe/http.h>
+#include <ipxe/gzipenc.h>
+#include <usr/sanput.h>
+
+/** @file
+ *
+ * SAN device upload
+ *
+ * The contents of a SAN device are read sequentially and streamed to
+ * an HTTP server using a chunked PUT request, optionally compressed
+ * using gzip.  Each disk read is issued as soon as the connection is
+ * able to accept more data, so that reads overlap with transmission
+ * of previously read data from the TCP send queue.
+ *
+ */
+
+/** Maximum length of each disk read */
+#define SANPUT_READ_LEN ( 256 * 1024 )
+
+/** A SAN device upload */
+struct sanput {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** Job control interface */
+	struct interface job;
+	/** Data transfer interface */
+	struct interface xfer;
+	/** Process */
+	struct process process;
+
+	/** SAN device */
+	struct san_device *sandev;
+	/** Flags */
+	unsigned int flags;
+	/** Block size */
+	size_t blksize;
+	/** Number of blocks per read */
+	unsigned int count;
+	/** Next logical block address */
+	uint64_t lba;
+	/** Total number of blocks */
+	uint64_t capacity;
+	/** A disk read is in progress */
+	int reading;
+	/** Final data has been delivered */
+	int sent;
+
+	/** Read buffer (if compressing) */
+	void *buffer;
+	/** Compressor (if compressing) */
+	struct gzip_encoder *enc;
+};
+
+/**
+ * Free SAN device upload
+ *
+ * @v refcnt		Reference count
+ */
+static void sanput_free ( struct refcnt *refcnt ) {
+	struct sanput *sanput = container_of ( refcnt, struct sanput, refcnt );
+
+	sandev_put ( sanput->sandev );
+	free ( sanput->enc );
+	free ( sanput->buffer );
+	free ( sanput );
+}
+
+/**
+ * Close SAN device upload
+ *
+ * @v sanput		SAN device upload
+ * @v rc		Reason for close
+ */
+static void sanput_close ( struct sanput *sanput, int rc ) {
+
+	/* Stop process */
+	process_del ( &sanput->process );
+
+	/* Shut down interfaces */
+	intf_shutdown ( &sanput->xfer, rc );
+	intf_shutdown ( &sanput->job, rc );
+}
+
+/**
+ * Read and send next portion of SAN device
+ *
+ * @v sanput		SAN device upload
+ * @ret rc		Return status code
+ */
+static int sanput_send ( struct sanput *sanput ) {
+	struct xfer_metadata meta;
+	struct io_buffer *iobuf;
+	unsigned int count;
+	size_t max_len;
+	size_t len;
+	void *data;
+	int final;
+	int rc;
+
+	/* Calculate length of this portion */
+	count = sanput->count;
+	if ( count > ( sanput->capacity - sanput->lba ) )
+		count = ( sanput->capacity - sanput->lba );
+	len = ( count * sanput->blksize );
+	final = ( ( sanput->lba + count ) == sanput->capacity );
+
+	/* Allocate I/O buffer */
+	max_len = ( sanput->enc ? gzip_encode_max_len ( len ) : len );
+	iobuf = xfer_alloc_iob ( &sanput->xfer, max_len );
+	if ( ! iobuf ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+
+	/* Read data directly into I/O buffer, unless compressing.
+	 * The read will step the main loop, so guard against being
+	 * rescheduled in the meantime.
+	 */
+	data = ( sanput->buffer ? sanput->buffer : iobuf->data );
+	sanput->reading = 1;
+	rc = sandev_read ( sanput->sandev, sanput->lba, count,
+			   virt_to_user ( data ) );
+	sanput->reading = 0;
+	if ( rc != 0 ) {
+		printf ( "Could not read blocks %#llx+%#x: %s\n",
+			 ( ( unsigned long long ) sanput->lba ), count,
+			 strerror ( rc ) );
+		goto err_read;
+	}
+
+	/* Compress data, if applicable */
+	if ( sanput->enc )
+		len = gzip_encode ( sanput->enc, data, len, iobuf->data, final );
+	iob_put ( iobuf, len );
+
+	/* Deliver data */
+	memset ( &meta, 0, sizeof ( meta ) );
+	if ( final )
+		meta.flags = XFER_FL_OUT;
+	if ( ( rc = xfer_deliver ( &sanput->xfer, iob_disown ( iobuf ),
+				   &meta ) ) != 0 ) {
+		printf ( "Could not send: %s\n", strerror ( rc ) );
+		goto err_deliver;
+	}
+	sanput->lba += count;
+	sanput->sent = final;
+
+	return 0;
+
+ err_deliver:
+ err_read:
+	free_iob ( iobuf );
+ err_alloc:
+	return rc;
+}
+
+/**
+ * Run SAN device upload
+ *
+ * @v sanput		SAN device upload
+ */
+static void sanput_step ( struct sanput *sanput ) {
+	int rc;
+
+	/* Do nothing while a disk read is in progress, or once all
+	 * data has been sent (while awaiting the server's response).
+	 */
+	if ( sanput->reading || sanput->sent )
+		return;
+
+	/* Do nothing until the connection can accept more data */
+	if ( ! xfer_window ( &sanput->xfer ) )
+		return;
+
+	/* Read and send next portion */
+	if ( ( rc = sanput_send ( sanput ) ) != 0 )
+		sanput_close ( sanput, rc );
+}
+
+/**
+ * Receive response data
+ *
+ * @v sanput		SAN device upload
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int sanput_deliver ( struct sanput *sanput __unused,
+			    struct io_buffer *iobuf,
+			    struct xfer_metadata *meta __unused ) {
+
+	/* Discard any response content */
+	free_iob ( iobuf );
+	return 0;
+}
+
+/**
+ * Report upload progress
+ *
+ * @v sanput		SAN device upload
+ * @v progress		Progress report to fill in
+ * @ret ongoing_rc	Ongoing job status code (if known)
+ */
+static int sanput_progress ( struct sanput *sanput,
+			     struct job_progress *progress ) {
+
+	/* Report progress in units of 1kB */
+	progress->completed = ( ( sanput->lba * sanput->blksize ) / 1024 );
+	progress->total = ( ( sanput->capacity * sanput->blksize ) / 1024 );
+	return 0;
+}
+
+/** SAN device upload data transfer interface operations */
+static struct interface_operation sanput_xfer_op[] = {
+	INTF_OP ( xfer_deliver, struct sanput *, sanput_deliver ),
+	INTF_OP ( xfer_window_changed, struct sanput *, sanput_step ),
+	INTF_OP ( intf_close, struct sanput *, sanput_close ),
+};
+
+/** SAN device upload data transfer interface descriptor */
+static struct interface_descriptor sanput_xfer_desc =
+	INTF_DESC ( struct sanput, xfer, sanput_xfer_op );
+
+/** SAN device upload job control interface operations */
+static struct interface_operation sanput_job_op[] = {
+	INTF_OP ( job_progress, struct sanput *, sanput_progress ),
+	INTF_OP ( intf_close, struct sanput *, sanput_close ),
+};
+
+/** SAN device upload job control interface descriptor */
+static struct interface_descriptor sanput_job_desc =
+	INTF_DESC ( struct sanput, job, sanput_job_op );
+
+/** SAN device upload process descriptor */
+static struct process_descriptor sanput_process_desc =
+	PROC_DESC ( struct sanput, process, sanput_step );
+
+/**
+ * Upload SAN device contents
+ *
+ * @v drive		Drive number
+ * @v uri_string	Upload URI string
+ * @v flags		Flags
+ * @ret rc		Return status code
+ */
+int sanput ( unsigned int drive, const char *uri_string,
+	     unsigned int flags ) {
+	struct http_request_content content;
+	struct san_device *sandev;
+	struct sanput *sanput;
+	struct uri *uri;
+	int rc;
+
+	/* Find SAN device */
+	sandev = sandev_find ( drive );
+	if ( ! sandev ) {
+		printf ( "Could not find SAN device %#02x\n", drive );
+		rc = -ENODEV;
+		goto err_find;
+	}
+
+	/* Parse URI */
+	uri = parse_uri ( uri_string );
+	if ( ! uri ) {
+		rc = -ENOMEM;
+		goto err_parse;
+	}
+
+	/* Allocate and initialise structure */
+	sanput = zalloc ( sizeof ( *sanput ) );
+	if ( ! sanput ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	ref_init ( &sanput->refcnt, sanput_free );
+	intf_init ( &sanput->job, &sanput_job_desc, &sanput->refcnt );
+	intf_init ( &sanput->xfer, &sanput_xfer_desc, &sanput->refcnt );
+	process_init_stopped ( &sanput->process, &sanput_process_desc,
+			       &sanput->refcnt );
+	sanput->sandev = sandev_get ( sandev );
+	sanput->flags = flags;
+	sanput->blksize = sandev_blksize ( sandev );
+	sanput->capacity = sandev_capacity ( sandev );
+	sanput->count = ( SANPUT_READ_LEN / sanput->blksize );
+	if ( ! sanput->count )
+		sanput->count = 1;
+
+	/* Allocate compressor, if applicable */
+	if ( flags & SANPUT_GZIP ) {
+		sanput->buffer = malloc ( sanput->count * sanput->blksize );
+		sanput->enc = malloc ( sizeof ( *sanput->enc ) );
+		if ( ! ( sanput->buffer && sanput->enc ) ) {
+			rc = -ENOMEM;
+			goto err_enc;
+		}
+		gzip_encode_init ( sanput->enc );
+	}
+
+	/* Sanity check */
+	if ( ! sanput->capacity ) {
+		printf ( "SAN device %#02x is empty\n", drive );
+		rc = -ENOSPC;
+		goto err_empty;
+	}
+
+	/* Open HTTP transaction */
+	memset ( &content, 0, sizeof ( content ) );
+	content.type = ( sanput->enc ? "application/gzip" :
+			 "application/octet-stream" );
+	content.stream = 1;
+	if ( ( rc = http_open ( &sanput->xfer, &http_put, uri, NULL,
+				&content ) ) != 0 ) {
+		printf ( "Could not open %s: %s\n", uri_string,
+			 strerror ( rc ) );
+		goto err_open;
+	}
+
+	/* Start process, attach to parent interface, and mortalise self */
+	process_add ( &sanput->process );
+	intf_plug_plug ( &sanput->job, &monojob );
+	ref_put ( &sanput->refcnt );
+	uri_put ( uri );
+
+	/* Wait for upload to complete */
+	return monojob_wait ( uri_string, 0 );
+
+ err_open:
+ err_empty:
+ err_enc:
+	sanput_close ( sanput, rc );
+	ref_put ( &sanput->refcnt );
+ err_alloc:
+	uri_put ( uri );
+ err_parse:
+ err_find:
+	return rc;
+}
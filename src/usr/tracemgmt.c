@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2026 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * You can also choose to distribute this program under the terms of
+ * the Unmodified Binary Distribution Licence (as given in the file
+ * COPYING.UBDL), provided that you have satisfied its requirements.
+ */
+
+
+FILE_LICENCE ( GPL2_OR_LATER_OR_UBDL );
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <ipxe/trace.h>
+#include <ipxe/vsprintf.h>
+#include <ipxe/params.h>
+#include <ipxe/uri.h>
+#include <ipxe/image.h>
+#include <usr/imgmgmt.h>
+#include <usr/tracemgmt.h>
+
+/** @file
+ *
+ * Boot timeline tracing
+ *
+ */
+
+/**
+ * Convert nanoseconds to microseconds
+ *
+ * @v nsecs		Nanoseconds
+ * @ret usecs		Microseconds
+ */
+static unsigned long long trace_usecs ( uint64_t nsecs ) {
+
+	return ( nsecs / 1000 );
+}
+
+/**
+ * Describe trace event
+ *
+ * @v id		Event identifier
+ * @v buf		Buffer to fill in
+ * @v size		Size of buffer
+ * @ret len		Length of description
+ *
+ * Each event is described as a single line of the form
+ *
+ *   <timestamp> <type> <id> <name>
+ *
+ * where the timestamp is in microseconds.  Stop events additionally
+ * include the identifier of the corresponding start event, the
+ * elapsed time in microseconds, and the status.
+ */
+static int trace_describe ( unsigned int id, char *buf, ssize_t size ) {
+	struct trace_event *event = trace_event ( id );
+	struct trace_event *started;
+	unsigned long long elapsed;
+	int len;
+
+	/* Ignore events that are no longer retained */
+	if ( ! event )
+		return 0;
+
+	/* Describe event */
+	len = ssnprintf ( buf, size, "%lld %c %d %s",
+			  trace_usecs ( event->nsecs ), event->type, id,
+			  event->name );
+
+	/* Describe duration of activity, if applicable */
+	if ( event->type == TRACE_STOP ) {
+		started = trace_event ( event->start );
+		elapsed = ( started ?
+			    trace_usecs ( event->nsecs - started->nsecs ) : 0 );
+		len += ssnprintf ( ( buf + len ), ( size - len ),
+				   " (%d +%lld: %s)", event->start, elapsed,
+				   ( event->rc ? strerror ( event->rc ) :
+				     "ok" ) );
+	}
+
+	/* Terminate line */
+	len += ssnprintf ( ( buf + len ), ( size - len ), "\n" );
+
+	return len;
+}
+
+/**
+ * Show recorded trace events
+ *
+ */
+void trace_show ( void ) {
+	char buf[ TRACE_NAME_LEN + 80 /* timestamps and status */ ];
+	unsigned int id;
+
+	for ( id = trace_first() ; id != trace_next ; id++ ) {
+		trace_describe ( id, buf, sizeof ( buf ) );
+		printf ( "%s", buf );
+	}
+}
+
+/**
+ * Submit recorded trace events via HTTP POST
+ *
+ * @v uri_string	URI string
+ * @v timeout		Timeout
+ * @ret rc		Return status code
+ *
+ * The trace events are submitted as a form parameter named "trace",
+ * containing one line per event as described by trace_describe().
+ */
+int trace_post ( const char *uri_string, unsigned long timeout ) {
+	struct parameters *params;
+	struct image *image;
+	struct uri *uri;
+	unsigned int first;
+	unsigned int last;
+	unsigned int id;
+	size_t size;
+	size_t len;
+	char *buf;
+	int rc;
+
+	/* Record current range of events */
+	first = trace_first();
+	last = trace_next;
+
+	/* Describe events */
+	for ( size = 1 /* NUL */, id = first ; id != last ; id++ )
+		size += trace_describe ( id, NULL, 0 );
+	buf = malloc ( size );
+	if ( ! buf ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	buf[0] = '\0';
+	for ( len = 0, id = first ; id != last ; id++ )
+		len += trace_describe ( id, ( buf + len ), ( size - len ) );
+
+	/* Construct parameter list */
+	params = create_parameters ( NULL );
+	if ( ! params ) {
+		rc = -ENOMEM;
+		goto err_create_parameters;
+	}
+	claim_parameters ( params );
+	if ( ! add_parameter ( params, "trace", buf ) ) {
+		rc = -ENOMEM;
+		goto err_add_parameter;
+	}
+
+	/* Parse URI */
+	uri = parse_uri ( uri_string );
+	if ( ! uri ) {
+		rc = -ENOMEM;
+		goto err_parse_uri;
+	}
+	params_put ( uri->params );
+	uri->params = params_get ( params );
+
+	/* Submit events, and discard any response */
+	if ( ( rc = imgdownload ( uri, timeout, &image ) ) != 0 )
+		goto err_download;
+	unregister_image ( image );
+
+ err_download:
+	uri_put ( uri );
+ err_parse_uri:
+ err_add_parameter:
+	params_put ( params );
+ err_create_parameters:
+	free ( buf );
+ err_alloc:
+	return rc;
+}
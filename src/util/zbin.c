@@ -16,6 +16,16 @@
 /* LZMA preset choice.  This is a policy decision */
 #define LZMA_PRESET ( LZMA_PRESET_DEFAULT | LZMA_PRESET_EXTREME )
 
+/* LZ4 format constants.  Must match those used by unlz4.S */
+#define LZ4_MIN_MATCH 4
+#define LZ4_MAX_OFFSET 0xffff
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MFLIMIT 12
+
+/* LZ4 match search depth.  This is a policy decision */
+#define LZ4_HASH_BITS 16
+#define LZ4_MAX_CHAIN 1024
+
 struct input_file {
 	void *buf;
 	size_t len;
@@ -326,6 +336,191 @@ static int process_zinfo_pack ( struct input_file *input,
 	return 0;
 }
 
+static uint8_t * lz4_extend ( uint8_t *out, size_t len ) {
+	while ( len >= 0xff ) {
+		*(out++) = 0xff;
+		len -= 0xff;
+	}
+	*(out++) = len;
+	return out;
+}
+
+static int lz4_sequence ( uint8_t **out, uint8_t *end,
+			  const uint8_t *literals, size_t literal_len,
+			  size_t offset, size_t match_len ) {
+	size_t match_code = ( match_len ? ( match_len - LZ4_MIN_MATCH ) : 0 );
+	size_t max_len;
+	uint8_t *token;
+
+	/* Check for sufficient space (including worst-case extensions) */
+	max_len = ( 1 /* token */ + ( literal_len / 0xff ) + 1 + literal_len +
+		    2 /* offset */ + ( match_code / 0xff ) + 1 );
+	if ( ( ( size_t ) ( end - *out ) ) < max_len )
+		return -1;
+
+	/* Construct token and literals */
+	token = (*out)++;
+	*token = ( ( ( literal_len < 0x0f ) ? literal_len : 0x0f ) << 4 );
+	if ( literal_len >= 0x0f )
+		*out = lz4_extend ( *out, ( literal_len - 0x0f ) );
+	memcpy ( *out, literals, literal_len );
+	*out += literal_len;
+
+	/* Construct match, if applicable */
+	if ( match_len ) {
+		*((*out)++) = ( offset & 0xff );
+		*((*out)++) = ( offset >> 8 );
+		*token |= ( ( match_code < 0x0f ) ? match_code : 0x0f );
+		if ( match_code >= 0x0f )
+			*out = lz4_extend ( *out, ( match_code - 0x0f ) );
+	}
+
+	return 0;
+}
+
+static unsigned int lz4_hash ( const uint8_t *data ) {
+	uint32_t value = ( data[0] | ( data[1] << 8 ) | ( data[2] << 16 ) |
+			   ( ( ( uint32_t ) data[3] ) << 24 ) );
+
+	return ( ( value * 2654435761U ) >> ( 32 - LZ4_HASH_BITS ) );
+}
+
+static int lz4_compress ( const uint8_t *src, size_t len, uint8_t *dst,
+			  size_t max_len, size_t *packed_len ) {
+	uint8_t *out = dst;
+	uint8_t *end = ( dst + max_len );
+	ssize_t *head;
+	ssize_t *prev;
+	size_t anchor = 0;
+	size_t pos = 0;
+	size_t limit;
+	size_t match_len;
+	size_t match_pos = 0;
+	size_t best_len;
+	size_t insert;
+	ssize_t candidate;
+	unsigned int chain;
+	unsigned int hash;
+	unsigned int i;
+	int rc = -1;
+
+	/* Allocate hash chains */
+	head = malloc ( ( 1 << LZ4_HASH_BITS ) * sizeof ( head[0] ) );
+	prev = malloc ( ( len + 1 ) * sizeof ( prev[0] ) );
+	if ( ( ! head ) || ( ! prev ) )
+		goto err_alloc;
+	for ( i = 0 ; i < ( 1 << LZ4_HASH_BITS ) ; i++ )
+		head[i] = -1;
+
+	/* Find greedy longest matches.  The final match must start at
+	 * least LZ4_MFLIMIT bytes before the end of the input, and
+	 * the final LZ4_LAST_LITERALS bytes must be literals.
+	 */
+	while ( ( pos + LZ4_MFLIMIT ) <= len ) {
+
+		/* Search hash chain for longest match */
+		hash = lz4_hash ( src + pos );
+		limit = ( len - LZ4_LAST_LITERALS - pos );
+		best_len = 0;
+		candidate = head[hash];
+		for ( chain = 0 ; ( candidate >= 0 ) &&
+			      ( ( pos - candidate ) <= LZ4_MAX_OFFSET ) &&
+			      ( chain < LZ4_MAX_CHAIN ) ; chain++ ) {
+			for ( match_len = 0 ; match_len < limit ; match_len++ ) {
+				if ( src[ candidate + match_len ] !=
+				     src[ pos + match_len ] )
+					break;
+			}
+			if ( match_len > best_len ) {
+				best_len = match_len;
+				match_pos = candidate;
+			}
+			candidate = prev[candidate];
+		}
+
+		/* Skip position if no match was found */
+		if ( best_len < LZ4_MIN_MATCH ) {
+			prev[pos] = head[hash];
+			head[hash] = pos;
+			pos++;
+			continue;
+		}
+
+		/* Emit sequence */
+		if ( lz4_sequence ( &out, end, ( src + anchor ),
+				    ( pos - anchor ), ( pos - match_pos ),
+				    best_len ) != 0 )
+			goto err_overrun;
+
+		/* Add all matched positions to hash chains */
+		for ( insert = pos ; insert < ( pos + best_len ) ; insert++ ) {
+			if ( ( insert + LZ4_MIN_MATCH ) > len )
+				break;
+			hash = lz4_hash ( src + insert );
+			prev[insert] = head[hash];
+			head[hash] = insert;
+		}
+		pos += best_len;
+		anchor = pos;
+	}
+
+	/* Emit final literals */
+	if ( lz4_sequence ( &out, end, ( src + anchor ), ( len - anchor ),
+			    0, 0 ) != 0 )
+		goto err_overrun;
+
+	*packed_len = ( out - dst );
+	rc = 0;
+
+ err_overrun:
+ err_alloc:
+	free ( prev );
+	free ( head );
+	return rc;
+}
+
+static int process_zinfo_pkl4 ( struct input_file *input,
+				struct output_file *output,
+				union zinfo_record *zinfo ) {
+	struct zinfo_pack *pack = &zinfo->pack;
+	size_t offset = pack->offset;
+	size_t len = pack->len;
+	size_t start_len;
+	size_t packed_len = 0;
+	uint32_t *len32;
+
+	if ( ( offset + len ) > input->len ) {
+		fprintf ( stderr, "Input buffer overrun on pack\n" );
+		return -1;
+	}
+
+	output->len = align ( output->len, pack->align );
+	start_len = output->len;
+	len32 = ( output->buf + output->len );
+	output->len += sizeof ( *len32 );
+	if ( output->len > output->max_len ) {
+		fprintf ( stderr, "Output buffer overrun on pack\n" );
+		return -1;
+	}
+
+	if ( lz4_compress ( ( input->buf + offset ), len,
+			    ( output->buf + output->len ),
+			    ( output->max_len - output->len ),
+			    &packed_len ) != 0 ) {
+		fprintf ( stderr, "Compression failure\n" );
+		return -1;
+	}
+	output->len += packed_len;
+	*len32 = packed_len;
+
+	if ( DEBUG ) {
+		fprintf ( stderr, "PKL4 [%#zx,%#zx) to [%#zx,%#zx)\n",
+			  offset, ( offset + len ), start_len, output->len );
+	}
+
+	return 0;
+}
+
 static int process_zinfo_payl ( struct input_file *input
 					__attribute__ (( unused )),
 				struct output_file *output,
@@ -523,6 +718,7 @@ struct zinfo_processor {
 static struct zinfo_processor zinfo_processors[] = {
 	{ "COPY", process_zinfo_copy },
 	{ "PACK", process_zinfo_pack },
+	{ "PKL4", process_zinfo_pkl4 },
 	{ "PAYL", process_zinfo_payl },
 	{ "ADDB", process_zinfo_addb },
 	{ "ADDW", process_zinfo_addw },